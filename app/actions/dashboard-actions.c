@@ -50,6 +50,27 @@ static const GimpActionEntry dashboard_actions[] =
     NC_("dashboard-action", "Reset cumulative data"),
     G_CALLBACK (dashboard_reset_cmd_callback),
     GIMP_HELP_DASHBOARD_RESET },
+
+  { "dashboard-log-record", NULL,
+    NC_("dashboard-action", "_Record Performance Log..."), NULL,
+    NC_("dashboard-action", "Record the dashboard variables and the "
+                            "main thread's stack to a log file, or "
+                            "resume recording to an existing log"),
+    G_CALLBACK (dashboard_log_record_cmd_callback),
+    GIMP_HELP_DASHBOARD_LOG_RECORD },
+
+  { "dashboard-log-stop", GIMP_ICON_PROCESS_STOP,
+    NC_("dashboard-action", "_Stop Recording Performance Log"), NULL,
+    NC_("dashboard-action", "Stop recording the performance log"),
+    G_CALLBACK (dashboard_log_stop_cmd_callback),
+    GIMP_HELP_DASHBOARD_LOG_RECORD },
+
+  { "dashboard-log-export", GIMP_ICON_DOCUMENT_SAVE_AS,
+    NC_("dashboard-action", "_Export Performance Log as Text..."), NULL,
+    NC_("dashboard-action", "Export the recorded performance log "
+                            "as a text file"),
+    G_CALLBACK (dashboard_log_export_cmd_callback),
+    GIMP_HELP_DASHBOARD_LOG_EXPORT }
 };
 
 static const GimpToggleActionEntry dashboard_toggle_actions[] =
@@ -154,6 +175,8 @@ dashboard_actions_update (GimpActionGroup *group,
 
 #define SET_ACTIVE(action,condition) \
         gimp_action_group_set_action_active (group, action, (condition) != 0)
+#define SET_SENSITIVE(action,condition) \
+        gimp_action_group_set_action_sensitive (group, action, (condition) != 0)
 
   switch (gimp_dashboard_get_update_interval (dashboard))
     {
@@ -196,5 +219,13 @@ dashboard_actions_update (GimpActionGroup *group,
   SET_ACTIVE ("dashboard-low-swap-space-warning",
               gimp_dashboard_get_low_swap_space_warning (dashboard));
 
+  SET_SENSITIVE ("dashboard-log-record",
+                 ! gimp_dashboard_log_is_recording (dashboard));
+  SET_SENSITIVE ("dashboard-log-stop",
+                 gimp_dashboard_log_is_recording (dashboard));
+  SET_SENSITIVE ("dashboard-log-export",
+                 gimp_dashboard_log_get_file (dashboard));
+
 #undef SET_ACTIVE
+#undef SET_SENSITIVE
 }
@@ -20,18 +20,44 @@
 #include <gegl.h>
 #include <gtk/gtk.h>
 
+#include "libgimpbase/gimpbase.h"
 #include "libgimpwidgets/gimpwidgets.h"
 
 #include "actions-types.h"
 
+#include "core/gimp.h"
+
 #include "widgets/gimpdashboard.h"
 #include "widgets/gimphelp-ids.h"
 
+#include "dialogs/dialogs.h"
+
 #include "dashboard-commands.h"
 
 #include "gimp-intl.h"
 
 
+#define LOG_RECORD_DIALOG_KEY "gimp-dashboard-log-record-dialog"
+#define LOG_EXPORT_DIALOG_KEY "gimp-dashboard-log-export-dialog"
+
+
+/*  local function prototypes  */
+
+static GtkWidget * dashboard_log_file_dialog_new      (GimpDashboard *dashboard,
+                                                       const gchar   *title,
+                                                       const gchar   *button,
+                                                       const gchar   *role,
+                                                       const gchar   *help_id,
+                                                       GCallback      response);
+
+static void        dashboard_log_record_response      (GtkWidget     *dialog,
+                                                       gint           response_id,
+                                                       GimpDashboard *dashboard);
+static void        dashboard_log_export_response      (GtkWidget     *dialog,
+                                                       gint           response_id,
+                                                       GimpDashboard *dashboard);
+
+
 /*  public functionss */
 
 
@@ -81,3 +107,194 @@ dashboard_low_swap_space_warning_cmd_callback (GtkAction *action,
 
   gimp_dashboard_set_low_swap_space_warning (dashboard, low_swap_space_warning);
 }
+
+void
+dashboard_log_record_cmd_callback (GtkAction *action,
+                                   gpointer   data)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (data);
+  GtkWidget     *dialog;
+
+  dialog = dialogs_get_dialog (G_OBJECT (dashboard), LOG_RECORD_DIALOG_KEY);
+
+  if (! dialog)
+    {
+      GFile *file = gimp_dashboard_log_get_file (dashboard);
+
+      dialog = dashboard_log_file_dialog_new (
+        dashboard,
+        _("Record Performance Log"), _("_Record"),
+        "gimp-dashboard-log-record", GIMP_HELP_DASHBOARD_LOG_RECORD,
+        G_CALLBACK (dashboard_log_record_response));
+
+      /*  choosing an existing log resumes recording to it  */
+      if (file)
+        gtk_file_chooser_set_file (GTK_FILE_CHOOSER (dialog), file, NULL);
+      else
+        gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER (dialog),
+                                           "gimp-performance.log");
+
+      dialogs_attach_dialog (G_OBJECT (dashboard),
+                             LOG_RECORD_DIALOG_KEY, dialog);
+    }
+
+  gtk_window_present (GTK_WINDOW (dialog));
+}
+
+void
+dashboard_log_stop_cmd_callback (GtkAction *action,
+                                 gpointer   data)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (data);
+  GError        *error     = NULL;
+
+  if (! gimp_dashboard_log_stop_recording (dashboard, &error))
+    {
+      gimp_message (gimp_dashboard_get_gimp (dashboard),
+                    G_OBJECT (dashboard), GIMP_MESSAGE_ERROR,
+                    _("Error writing performance log '%s':\n%s"),
+                    gimp_file_get_utf8_name (
+                      gimp_dashboard_log_get_file (dashboard)),
+                    error->message);
+      g_clear_error (&error);
+    }
+}
+
+void
+dashboard_log_export_cmd_callback (GtkAction *action,
+                                   gpointer   data)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (data);
+  GtkWidget     *dialog;
+
+  dialog = dialogs_get_dialog (G_OBJECT (dashboard), LOG_EXPORT_DIALOG_KEY);
+
+  if (! dialog)
+    {
+      GFile *file = gimp_dashboard_log_get_file (dashboard);
+      gchar *basename;
+      gchar *name;
+
+      dialog = dashboard_log_file_dialog_new (
+        dashboard,
+        _("Export Performance Log as Text"), _("_Export"),
+        "gimp-dashboard-log-export", GIMP_HELP_DASHBOARD_LOG_EXPORT,
+        G_CALLBACK (dashboard_log_export_response));
+
+      gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER (dialog),
+                                                      TRUE);
+
+      basename = g_file_get_basename (file);
+      name     = g_strconcat (basename, ".txt", NULL);
+
+      gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER (dialog), name);
+
+      g_free (name);
+      g_free (basename);
+
+      dialogs_attach_dialog (G_OBJECT (dashboard),
+                             LOG_EXPORT_DIALOG_KEY, dialog);
+    }
+
+  gtk_window_present (GTK_WINDOW (dialog));
+}
+
+
+/*  private functions  */
+
+static GtkWidget *
+dashboard_log_file_dialog_new (GimpDashboard *dashboard,
+                               const gchar   *title,
+                               const gchar   *button,
+                               const gchar   *role,
+                               const gchar   *help_id,
+                               GCallback      response)
+{
+  GtkWidget *dialog;
+
+  dialog = gtk_file_chooser_dialog_new (title, NULL,
+                                        GTK_FILE_CHOOSER_ACTION_SAVE,
+
+                                        _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                        button,       GTK_RESPONSE_OK,
+
+                                        NULL);
+
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+  gtk_dialog_set_alternative_button_order (GTK_DIALOG (dialog),
+                                           GTK_RESPONSE_OK,
+                                           GTK_RESPONSE_CANCEL,
+                                           -1);
+
+  gtk_window_set_screen (GTK_WINDOW (dialog),
+                         gtk_widget_get_screen (GTK_WIDGET (dashboard)));
+  gtk_window_set_position (GTK_WINDOW (dialog), GTK_WIN_POS_MOUSE);
+  gtk_window_set_role (GTK_WINDOW (dialog), role);
+
+  g_signal_connect (dialog, "response",
+                    response,
+                    dashboard);
+  g_signal_connect (dialog, "delete-event",
+                    G_CALLBACK (gtk_true),
+                    NULL);
+
+  gimp_help_connect (dialog, gimp_standard_help_func, help_id, NULL);
+
+  return dialog;
+}
+
+static void
+dashboard_log_record_response (GtkWidget     *dialog,
+                               gint           response_id,
+                               GimpDashboard *dashboard)
+{
+  if (response_id == GTK_RESPONSE_OK)
+    {
+      GFile  *file  = gtk_file_chooser_get_file (GTK_FILE_CHOOSER (dialog));
+      GError *error = NULL;
+
+      if (! gimp_dashboard_log_start_recording (dashboard, file, &error))
+        {
+          gimp_message (gimp_dashboard_get_gimp (dashboard),
+                        G_OBJECT (dialog), GIMP_MESSAGE_ERROR,
+                        _("Error recording performance log '%s':\n%s"),
+                        gimp_file_get_utf8_name (file),
+                        error->message);
+          g_clear_error (&error);
+          g_object_unref (file);
+          return;
+        }
+
+      g_object_unref (file);
+    }
+
+  gtk_widget_destroy (dialog);
+}
+
+static void
+dashboard_log_export_response (GtkWidget     *dialog,
+                               gint           response_id,
+                               GimpDashboard *dashboard)
+{
+  if (response_id == GTK_RESPONSE_OK)
+    {
+      GFile  *file  = gtk_file_chooser_get_file (GTK_FILE_CHOOSER (dialog));
+      GError *error = NULL;
+
+      if (! gimp_dashboard_log_export (dashboard, file, &error))
+        {
+          gimp_message (gimp_dashboard_get_gimp (dashboard),
+                        G_OBJECT (dialog), GIMP_MESSAGE_ERROR,
+                        _("Error exporting performance log to '%s':\n%s"),
+                        gimp_file_get_utf8_name (file),
+                        error->message);
+          g_clear_error (&error);
+          g_object_unref (file);
+          return;
+        }
+
+      g_object_unref (file);
+    }
+
+  gtk_widget_destroy (dialog);
+}
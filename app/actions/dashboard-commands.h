@@ -32,5 +32,12 @@ void   dashboard_reset_cmd_callback                  (GtkAction *action,
 void   dashboard_low_swap_space_warning_cmd_callback (GtkAction *action,
                                                       gpointer   data);
 
+void   dashboard_log_record_cmd_callback             (GtkAction *action,
+                                                      gpointer   data);
+void   dashboard_log_stop_cmd_callback               (GtkAction *action,
+                                                      gpointer   data);
+void   dashboard_log_export_cmd_callback             (GtkAction *action,
+                                                      gpointer   data);
+
 
 #endif /* __DASHBOARD_COMMANDS_H__ */
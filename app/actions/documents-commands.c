@@ -70,6 +70,14 @@ static void   documents_open_image    (GtkWidget     *editor,
 static void   documents_raise_display (GimpDisplay   *display,
                                        RaiseClosure  *closure);
 
+static void   documents_remove_dangling_check (GimpThumbnail *thumbnail,
+                                               GdkPixbuf     *pixbuf,
+                                               const GError  *error,
+                                               GimpContainer *container);
+static void   documents_remove_dangling_done  (GObject       *source,
+                                               GAsyncResult  *result,
+                                               GimpContainer *container);
+
 
 
 /*  public functions */
@@ -328,19 +336,9 @@ documents_reload_previews_cmd_callback (GtkAction *action,
 
 static void
 documents_remove_dangling_foreach (GimpImagefile *imagefile,
-                                   GimpContainer *container)
+                                   GPtrArray     *uris)
 {
-  GimpThumbnail *thumbnail = gimp_imagefile_get_thumbnail (imagefile);
-
-  if (gimp_thumbnail_peek_image (thumbnail) == GIMP_THUMB_STATE_NOT_FOUND)
-    {
-      const gchar *uri = gimp_object_get_name (imagefile);
-
-      gtk_recent_manager_remove_item (gtk_recent_manager_get_default (), uri,
-                                      NULL);
-
-      gimp_container_remove (container, GIMP_OBJECT (imagefile));
-    }
+  g_ptr_array_add (uris, (gpointer) gimp_object_get_name (imagefile));
 }
 
 void
@@ -348,18 +346,72 @@ documents_remove_dangling_cmd_callback (GtkAction *action,
                                         gpointer   data)
 {
   GimpContainerEditor *editor = GIMP_CONTAINER_EDITOR (data);
+  GimpContext         *context;
   GimpContainer       *container;
+  GPtrArray           *uris;
 
+  context   = gimp_container_view_get_context (editor->view);
   container = gimp_container_view_get_container (editor->view);
 
+  uris = g_ptr_array_new ();
+
   gimp_container_foreach (container,
                           (GFunc) documents_remove_dangling_foreach,
-                          container);
+                          uris);
+
+  g_ptr_array_add (uris, NULL);
+
+  /*  checking the files can take long with a big or remote history,
+   *  so don't block on it
+   */
+  gimp_thumb_batch_async ((const gchar * const *) uris->pdata,
+                          GIMP_THUMB_BATCH_PEEK,
+                          GIMP_THUMB_SIZE_NORMAL,
+                          NULL, NULL, NULL,
+                          GIMP_GEGL_CONFIG (context->gimp->config)->num_processors,
+                          NULL,
+                          (GimpThumbBatchFunc) documents_remove_dangling_check,
+                          container,
+                          (GAsyncReadyCallback) documents_remove_dangling_done,
+                          g_object_ref (container));
+
+  g_ptr_array_free (uris, TRUE);
 }
 
 
 /*  private functions  */
 
+static void
+documents_remove_dangling_check (GimpThumbnail *thumbnail,
+                                 GdkPixbuf     *pixbuf,
+                                 const GError  *error,
+                                 GimpContainer *container)
+{
+  if (thumbnail->image_state == GIMP_THUMB_STATE_NOT_FOUND)
+    {
+      GimpObject *imagefile;
+
+      gtk_recent_manager_remove_item (gtk_recent_manager_get_default (),
+                                      thumbnail->image_uri, NULL);
+
+      imagefile = gimp_container_get_child_by_name (container,
+                                                    thumbnail->image_uri);
+
+      if (imagefile)
+        gimp_container_remove (container, imagefile);
+    }
+}
+
+static void
+documents_remove_dangling_done (GObject       *source,
+                                GAsyncResult  *result,
+                                GimpContainer *container)
+{
+  gimp_thumb_batch_finish (result, NULL);
+
+  g_object_unref (container);
+}
+
 static void
 documents_open_image (GtkWidget     *editor,
                       GimpContext   *context,
@@ -52,7 +52,12 @@
 
 #include "core/gimp.h"
 #include "core/gimp-batch.h"
+#include "core/gimp-startup.h"
 #include "core/gimp-user-install.h"
+#include "core/gimpdrawableundo.h"
+
+#include "paint/paint-types.h"
+#include "paint/gimppaintcore-record.h"
 
 #include "file/file-open.h"
 
@@ -67,6 +72,7 @@
 #include "language.h"
 #include "sanity.h"
 #include "gimp-debug.h"
+#include "gimp-trace.h"
 
 #include "gimp-intl.h"
 
@@ -161,17 +167,21 @@ app_run (const gchar         *full_prog_name,
          const gchar         *session_name,
          const gchar         *batch_interpreter,
          const gchar        **batch_commands,
+         gint                 batch_workers,
+         guint64              batch_job_memory,
          gboolean             as_new,
          gboolean             no_interface,
          gboolean             no_data,
          gboolean             no_fonts,
          gboolean             no_splash,
          gboolean             be_verbose,
+         gboolean             verbose_timing,
          gboolean             use_shm,
          gboolean             use_cpu_accel,
          gboolean             console_messages,
          gboolean             use_debug_handler,
          gboolean             show_playground,
+         const gchar         *paint_record_file,
          GimpStackTraceMode   stack_trace_mode,
          GimpPDBCompatMode    pdb_compat_mode,
          const gchar         *backtrace_file)
@@ -186,6 +196,9 @@ app_run (const gchar         *full_prog_name,
   GimpLangRc         *temprc;
   gchar              *language = NULL;
 
+  gimp_startup_init (verbose_timing);
+  gimp_paint_core_record_init (paint_record_file);
+
   if (filenames && filenames[0] && ! filenames[1] &&
       g_file_test (filenames[0], G_FILE_TEST_IS_DIR))
     {
@@ -215,6 +228,8 @@ app_run (const gchar         *full_prog_name,
    * purpose of getting the settings language, so that we can initialize
    * it before anything else.
    */
+  gimp_startup_begin ("language");
+
   temprc = gimp_lang_rc_new (alternate_system_gimprc,
                              alternate_gimprc,
                              be_verbose);
@@ -226,9 +241,13 @@ app_run (const gchar         *full_prog_name,
   if (language)
     g_free (language);
 
+  gimp_startup_end ();
+
   /*  Create an instance of the "Gimp" object which is the root of the
    *  core object system
    */
+  gimp_startup_begin ("core");
+
   gimp = gimp_new (full_prog_name,
                    session_name,
                    default_folder,
@@ -243,6 +262,8 @@ app_run (const gchar         *full_prog_name,
                    stack_trace_mode,
                    pdb_compat_mode);
 
+  gimp_startup_end ();
+
   if (default_folder)
     g_object_unref (default_folder);
 
@@ -255,8 +276,11 @@ app_run (const gchar         *full_prog_name,
   if (g_file_query_file_type (gimpdir, G_FILE_QUERY_INFO_NONE, NULL) !=
       G_FILE_TYPE_DIRECTORY)
     {
-      GimpUserInstall *install = gimp_user_install_new (G_OBJECT (gimp),
-                                                        be_verbose);
+      GimpUserInstall *install;
+
+      gimp_startup_begin ("user install");
+
+      install = gimp_user_install_new (G_OBJECT (gimp), be_verbose);
 
 #ifdef GIMP_CONSOLE_COMPILATION
       gimp_user_install_run (install);
@@ -268,6 +292,8 @@ app_run (const gchar         *full_prog_name,
 #endif
 
       gimp_user_install_free (install);
+
+      gimp_startup_end ();
     }
 
   g_object_unref (gimpdir);
@@ -282,7 +308,9 @@ app_run (const gchar         *full_prog_name,
                stack_trace_mode, backtrace_file);
 
 
+  gimp_startup_begin ("gimprc");
   gimp_load_config (gimp, alternate_system_gimprc, alternate_gimprc);
+  gimp_startup_end ();
 
   /*  run the late-stage sanity check.  it's important that this check is run
    *  after the call to language_init() (see comment in sanity_check_late().)
@@ -292,7 +320,12 @@ app_run (const gchar         *full_prog_name,
     app_abort (no_interface, abort_message);
 
   /*  initialize lowlevel stuff  */
+  gimp_startup_begin ("gegl");
   gimp_gegl_init (gimp);
+  gimp_startup_end ();
+
+  /*  remove the undo files of crashed sessions  */
+  gimp_drawable_undo_remove_stale_files ();
 
   /*  Connect our restore_after callback before gui_init() connects
    *  theirs, so ours runs first and can grab the initial monitor
@@ -304,7 +337,11 @@ app_run (const gchar         *full_prog_name,
 
 #ifndef GIMP_CONSOLE_COMPILATION
   if (! no_interface)
-    update_status_func = gui_init (gimp, no_splash);
+    {
+      gimp_startup_begin ("interface");
+      update_status_func = gui_init (gimp, no_splash);
+      gimp_startup_end ();
+    }
 #endif
 
   if (! update_status_func)
@@ -313,17 +350,23 @@ app_run (const gchar         *full_prog_name,
   /*  Create all members of the global Gimp instance which need an already
    *  parsed gimprc, e.g. the data factories
    */
+  gimp_startup_begin ("initialize");
   gimp_initialize (gimp, update_status_func);
+  gimp_startup_end ();
 
   /*  Load all data files
    */
+  gimp_startup_begin ("restore");
   gimp_restore (gimp, update_status_func);
+  gimp_startup_end ();
 
   /*  enable autosave late so we don't autosave when the
    *  monitor resolution is set in gui_init()
    */
   gimp_rc_set_autosave (GIMP_RC (gimp->edit_config), TRUE);
 
+  gimp_startup_finish ();
+
   loop = run_loop = g_main_loop_new (NULL, FALSE);
 
   g_signal_connect_after (gimp, "exit",
@@ -354,6 +397,10 @@ app_run (const gchar         *full_prog_name,
   if (run_loop)
     gimp_batch_run (gimp, batch_interpreter, batch_commands);
 
+  if (run_loop && batch_workers > 0)
+    gimp_batch_run_queue (gimp, batch_interpreter, batch_workers,
+                          batch_job_memory);
+
   if (run_loop)
     {
       gimp_threads_leave (gimp);
@@ -366,8 +413,12 @@ app_run (const gchar         *full_prog_name,
 
   g_main_loop_unref (loop);
 
+  gimp_gegl_exit (gimp);
+
   g_object_unref (gimp);
 
+  gimp_trace_exit ();
+
   gimp_debug_instances ();
 
   errors_exit ();
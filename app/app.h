@@ -37,17 +37,21 @@ void  app_run       (const gchar         *full_prog_name,
                      const gchar         *session_name,
                      const gchar         *batch_interpreter,
                      const gchar        **batch_commands,
+                     gint                 batch_workers,
+                     guint64              batch_job_memory,
                      gboolean             as_new,
                      gboolean             no_interface,
                      gboolean             no_data,
                      gboolean             no_fonts,
                      gboolean             no_splash,
                      gboolean             be_verbose,
+                     gboolean             verbose_timing,
                      gboolean             use_shm,
                      gboolean             use_cpu_accel,
                      gboolean             console_messages,
                      gboolean             use_debug_handler,
                      gboolean             show_playground,
+                     const gchar         *paint_record_file,
                      GimpStackTraceMode   stack_trace_mode,
                      GimpPDBCompatMode    pdb_compat_mode,
                      const gchar         *backtrace_file);
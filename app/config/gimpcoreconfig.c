@@ -96,6 +96,7 @@ enum
   PROP_DEFAULT_GRID,
   PROP_UNDO_LEVELS,
   PROP_UNDO_SIZE,
+  PROP_UNDO_DISK_SIZE,
   PROP_UNDO_PREVIEW_SIZE,
   PROP_FILTER_HISTORY_SIZE,
   PROP_PLUGINRC_PATH,
@@ -113,6 +114,9 @@ enum
   PROP_EXPORT_METADATA_EXIF,
   PROP_EXPORT_METADATA_XMP,
   PROP_EXPORT_METADATA_IPTC,
+  PROP_XCF_LAZY_LOAD,
+  PROP_XCF_ZSTD_LEVEL,
+  PROP_XCF_SAVE_PROJECTION,
   PROP_DEBUG_POLICY,
 
   /* ignored, only for backward compatibility: */
@@ -525,6 +529,13 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                             GIMP_PARAM_STATIC_STRINGS |
                             GIMP_CONFIG_PARAM_CONFIRM);
 
+  GIMP_CONFIG_PROP_MEMSIZE (object_class, PROP_UNDO_DISK_SIZE,
+                            "undo-disk-size",
+                            "Undo disk size",
+                            UNDO_DISK_SIZE_BLURB,
+                            0, GIMP_MAX_MEMSIZE, 0,
+                            GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_ENUM (object_class, PROP_UNDO_PREVIEW_SIZE,
                          "undo-preview-size",
                          "Undo preview size",
@@ -655,6 +666,27 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                             TRUE,
                             GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_LAZY_LOAD,
+                            "xcf-lazy-load",
+                            "Load XCF pixels lazily",
+                            XCF_LAZY_LOAD_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_XCF_ZSTD_LEVEL,
+                        "xcf-zstd-level",
+                        "XCF zstd compression level",
+                        XCF_ZSTD_LEVEL_BLURB,
+                        0, 22, 0,
+                        GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_SAVE_PROJECTION,
+                            "xcf-save-projection",
+                            "Save a projection preview in XCF files",
+                            XCF_SAVE_PROJECTION_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_ENUM (object_class, PROP_DEBUG_POLICY,
                          "debug-policy",
                          "Try generating backtrace upon errors",
@@ -917,6 +949,9 @@ gimp_core_config_set_property (GObject      *object,
     case PROP_UNDO_SIZE:
       core_config->undo_size = g_value_get_uint64 (value);
       break;
+    case PROP_UNDO_DISK_SIZE:
+      core_config->undo_disk_size = g_value_get_uint64 (value);
+      break;
     case PROP_UNDO_PREVIEW_SIZE:
       core_config->undo_preview_size = g_value_get_enum (value);
       break;
@@ -969,6 +1004,15 @@ gimp_core_config_set_property (GObject      *object,
     case PROP_EXPORT_METADATA_IPTC:
       core_config->export_metadata_iptc = g_value_get_boolean (value);
       break;
+    case PROP_XCF_LAZY_LOAD:
+      core_config->xcf_lazy_load = g_value_get_boolean (value);
+      break;
+    case PROP_XCF_ZSTD_LEVEL:
+      core_config->xcf_zstd_level = g_value_get_int (value);
+      break;
+    case PROP_XCF_SAVE_PROJECTION:
+      core_config->xcf_save_projection = g_value_get_boolean (value);
+      break;
     case PROP_DEBUG_POLICY:
       core_config->debug_policy = g_value_get_enum (value);
       break;
@@ -1120,6 +1164,9 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_UNDO_SIZE:
       g_value_set_uint64 (value, core_config->undo_size);
       break;
+    case PROP_UNDO_DISK_SIZE:
+      g_value_set_uint64 (value, core_config->undo_disk_size);
+      break;
     case PROP_UNDO_PREVIEW_SIZE:
       g_value_set_enum (value, core_config->undo_preview_size);
       break;
@@ -1168,6 +1215,15 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_EXPORT_METADATA_IPTC:
       g_value_set_boolean (value, core_config->export_metadata_iptc);
       break;
+    case PROP_XCF_LAZY_LOAD:
+      g_value_set_boolean (value, core_config->xcf_lazy_load);
+      break;
+    case PROP_XCF_ZSTD_LEVEL:
+      g_value_set_int (value, core_config->xcf_zstd_level);
+      break;
+    case PROP_XCF_SAVE_PROJECTION:
+      g_value_set_boolean (value, core_config->xcf_save_projection);
+      break;
     case PROP_DEBUG_POLICY:
       g_value_set_enum (value, core_config->debug_policy);
       break;
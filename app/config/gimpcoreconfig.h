@@ -81,6 +81,7 @@ struct _GimpCoreConfig
   GimpGrid               *default_grid;
   gint                    levels_of_undo;
   guint64                 undo_size;
+  guint64                 undo_disk_size;
   GimpViewSize            undo_preview_size;
   gint                    filter_history_size;
   gchar                  *plug_in_rc_path;
@@ -98,6 +99,9 @@ struct _GimpCoreConfig
   gboolean                export_metadata_exif;
   gboolean                export_metadata_xmp;
   gboolean                export_metadata_iptc;
+  gboolean                xcf_lazy_load;
+  gint                    xcf_zstd_level;
+  gboolean                xcf_save_projection;
   GimpDebugPolicy         debug_policy;
 };
 
@@ -46,9 +46,15 @@ enum
   PROP_0,
   PROP_TEMP_PATH,
   PROP_SWAP_PATH,
+  PROP_SWAP_COMPRESSION,
   PROP_NUM_PROCESSORS,
+  PROP_PLUG_IN_THREADS,
+  PROP_CPU_AFFINITY,
+  PROP_NUMA_NODE,
   PROP_TILE_CACHE_SIZE,
+  PROP_MEMORY_BUDGET,
   PROP_USE_OPENCL,
+  PROP_USE_HUGE_PAGES,
 
   /* ignored, only for backward compatibility: */
   PROP_STINGY_MEMORY_USE
@@ -132,6 +138,13 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                          GIMP_PARAM_STATIC_STRINGS |
                          GIMP_CONFIG_PARAM_RESTART);
 
+  GIMP_CONFIG_PROP_STRING (object_class, PROP_SWAP_COMPRESSION,
+                           "swap-compression",
+                           "Swap compression",
+                           SWAP_COMPRESSION_BLURB,
+                           "fast",
+                           GIMP_PARAM_STATIC_STRINGS);
+
   n_threads = g_get_num_processors ();
 
   max_n_threads =
@@ -147,6 +160,29 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                         1, max_n_threads, n_threads,
                         GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_PROP_INT (object_class, PROP_PLUG_IN_THREADS,
+                        "plug-in-threads",
+                        "Number of threads for plug-ins",
+                        PLUG_IN_THREADS_BLURB,
+                        0, max_n_threads, 0,
+                        GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_STRING (object_class, PROP_CPU_AFFINITY,
+                           "cpu-affinity",
+                           "CPU affinity",
+                           CPU_AFFINITY_BLURB,
+                           NULL,
+                           GIMP_PARAM_STATIC_STRINGS |
+                           GIMP_CONFIG_PARAM_RESTART);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_NUMA_NODE,
+                        "numa-node",
+                        "NUMA node",
+                        NUMA_NODE_BLURB,
+                        -1, 1023, -1,
+                        GIMP_PARAM_STATIC_STRINGS |
+                        GIMP_CONFIG_PARAM_RESTART);
+
   memory_size = gimp_get_physical_memory_size ();
 
   /* limit to the amount one process can handle */
@@ -166,6 +202,14 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                             GIMP_PARAM_STATIC_STRINGS |
                             GIMP_CONFIG_PARAM_CONFIRM);
 
+  GIMP_CONFIG_PROP_MEMSIZE (object_class, PROP_MEMORY_BUDGET,
+                            "memory-budget",
+                            "Memory budget",
+                            MEMORY_BUDGET_BLURB,
+                            0, GIMP_MAX_MEM_PROCESS,
+                            0,
+                            GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_USE_OPENCL,
                             "use-opencl",
                             "Use OpenCL",
@@ -173,6 +217,14 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                             FALSE,
                             GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_USE_HUGE_PAGES,
+                            "use-huge-pages",
+                            "Use huge pages",
+                            USE_HUGE_PAGES_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS |
+                            GIMP_CONFIG_PARAM_RESTART);
+
   /*  only for backward compatibility:  */
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_STINGY_MEMORY_USE,
                             "stingy-memory-use",
@@ -195,6 +247,8 @@ gimp_gegl_config_finalize (GObject *object)
 
   g_free (gegl_config->temp_path);
   g_free (gegl_config->swap_path);
+  g_free (gegl_config->swap_compression);
+  g_free (gegl_config->cpu_affinity);
 
   gimp_debug_remove_instance (object);
 
@@ -219,15 +273,35 @@ gimp_gegl_config_set_property (GObject      *object,
       g_free (gegl_config->swap_path);
       gegl_config->swap_path = g_value_dup_string (value);
       break;
+    case PROP_SWAP_COMPRESSION:
+      g_free (gegl_config->swap_compression);
+      gegl_config->swap_compression = g_value_dup_string (value);
+      break;
     case PROP_NUM_PROCESSORS:
       gegl_config->num_processors = g_value_get_int (value);
       break;
+    case PROP_PLUG_IN_THREADS:
+      gegl_config->plug_in_threads = g_value_get_int (value);
+      break;
+    case PROP_CPU_AFFINITY:
+      g_free (gegl_config->cpu_affinity);
+      gegl_config->cpu_affinity = g_value_dup_string (value);
+      break;
+    case PROP_NUMA_NODE:
+      gegl_config->numa_node = g_value_get_int (value);
+      break;
     case PROP_TILE_CACHE_SIZE:
       gegl_config->tile_cache_size = g_value_get_uint64 (value);
       break;
+    case PROP_MEMORY_BUDGET:
+      gegl_config->memory_budget = g_value_get_uint64 (value);
+      break;
     case PROP_USE_OPENCL:
       gegl_config->use_opencl = g_value_get_boolean (value);
       break;
+    case PROP_USE_HUGE_PAGES:
+      gegl_config->use_huge_pages = g_value_get_boolean (value);
+      break;
 
     case PROP_STINGY_MEMORY_USE:
       /* ignored */
@@ -255,15 +329,33 @@ gimp_gegl_config_get_property (GObject    *object,
     case PROP_SWAP_PATH:
       g_value_set_string (value, gegl_config->swap_path);
       break;
+    case PROP_SWAP_COMPRESSION:
+      g_value_set_string (value, gegl_config->swap_compression);
+      break;
     case PROP_NUM_PROCESSORS:
       g_value_set_int (value, gegl_config->num_processors);
       break;
+    case PROP_PLUG_IN_THREADS:
+      g_value_set_int (value, gegl_config->plug_in_threads);
+      break;
+    case PROP_CPU_AFFINITY:
+      g_value_set_string (value, gegl_config->cpu_affinity);
+      break;
+    case PROP_NUMA_NODE:
+      g_value_set_int (value, gegl_config->numa_node);
+      break;
     case PROP_TILE_CACHE_SIZE:
       g_value_set_uint64 (value, gegl_config->tile_cache_size);
       break;
+    case PROP_MEMORY_BUDGET:
+      g_value_set_uint64 (value, gegl_config->memory_budget);
+      break;
     case PROP_USE_OPENCL:
       g_value_set_boolean (value, gegl_config->use_opencl);
       break;
+    case PROP_USE_HUGE_PAGES:
+      g_value_set_boolean (value, gegl_config->use_huge_pages);
+      break;
 
     case PROP_STINGY_MEMORY_USE:
       /* ignored */
@@ -37,9 +37,15 @@ struct _GimpGeglConfig
 
   gchar    *temp_path;
   gchar    *swap_path;
+  gchar    *swap_compression;
   gint      num_processors;
+  gint      plug_in_threads;
+  gchar    *cpu_affinity;
+  gint      numa_node;
   guint64   tile_cache_size;
+  guint64   memory_budget;
   gboolean  use_opencl;
+  gboolean  use_huge_pages;
 };
 
 struct _GimpGeglConfigClass
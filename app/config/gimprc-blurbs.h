@@ -210,6 +210,21 @@ _("Export XMP metadata by default.")
 #define EXPORT_METADATA_IPTC_BLURB \
 _("Export IPTC metadata by default.")
 
+#define XCF_LAZY_LOAD_BLURB \
+_("When enabled, the pixels of local XCF files are only read when they " \
+  "are first needed, which makes large files open faster.  The file is " \
+  "kept open as long as the image uses it.")
+
+#define XCF_ZSTD_LEVEL_BLURB \
+_("When not zero, XCF files are compressed with zstd at this level " \
+  "instead of with zlib or RLE, which is much faster than zlib at a " \
+  "similar ratio.  Such files can't be opened by older versions of GIMP.")
+
+#define XCF_SAVE_PROJECTION_BLURB \
+_("When enabled, a downscaled copy of the image's projection is saved " \
+  "along with XCF files, and shown while the image is rendered after " \
+  "opening it.  This makes the files somewhat larger.")
+
 #define GENERATE_BACKTRACE_BLURB \
 _("Try generating debug data for bug reporting when appropriate.")
 
@@ -270,6 +285,19 @@ _("Sets the size of the navigation preview available in the lower right " \
 #define NUM_PROCESSORS_BLURB \
 _("Sets how many threads GIMP should use for operations that support it.")
 
+#define PLUG_IN_THREADS_BLURB \
+_("Sets how many threads plug-ins should use for operations that support " \
+  "it.  0 uses num-processors.")
+
+#define CPU_AFFINITY_BLURB \
+_("Restricts GIMP and its plug-ins to the given processors, as a comma " \
+  "separated list of processor numbers and ranges, like \"0-7,16-23\".  " \
+  "Leave empty to use all processors.")
+
+#define NUMA_NODE_BLURB \
+_("Restricts GIMP and its plug-ins to the processors of the given NUMA " \
+  "node.  -1 doesn't restrict them.")
+
 #define PALETTE_PATH_BLURB \
 "Sets the palette search path."
 
@@ -417,6 +445,11 @@ _("Enable the Seamless Clone tool.")
 #define SPACE_BAR_ACTION_BLURB \
 _("What to do when the space bar is pressed in the image window.")
 
+#define SWAP_COMPRESSION_BLURB \
+_("The compression method used for tile data stored in the swap file, one " \
+  "of none, fast, balanced and best.  Compressed tiles take less space on " \
+  "disk, so more of them fit into the system's file cache.")
+
 #define SWAP_PATH_BLURB \
 _("Sets the swap file location. GIMP uses a tile based memory allocation " \
   "scheme. The swap file is used to quickly and easily swap tiles out to " \
@@ -639,12 +672,29 @@ _("Sets an upper limit to the memory that is used per image to keep " \
   "operations on the undo stack. Regardless of this setting, at least " \
   "as many undo-levels as configured can be undone.")
 
+#define UNDO_DISK_SIZE_BLURB \
+_("Sets an upper limit to the disk space that is used per image to keep " \
+  "the pixel data of older operations on the undo stack, once the " \
+  "undo-size limit is reached.  When zero, such operations are dropped " \
+  "instead.")
+
 #define UNDO_PREVIEW_SIZE_BLURB \
 _("Sets the size of the previews in the Undo History.")
 
 #define USE_HELP_BLURB \
 _("When enabled, pressing F1 will open the help browser.")
 
+#define MEMORY_BUDGET_BLURB \
+_("The amount of memory that large operations, like scaling, merging or " \
+  "duplicating images and committing filters, may reserve together.  An " \
+  "operation that doesn't fit into what is left waits for other " \
+  "operations to finish, after releasing caches.  0 means no limit.")
+
+#define USE_HUGE_PAGES_BLURB \
+_("When enabled, image data is allocated so that the system can back it " \
+  "with huge pages, where supported.  This speeds up work on very large " \
+  "images, but memory is returned to the system in larger steps.")
+
 #define USE_OPENCL_BLURB \
 _("When enabled, uses OpenCL for some operations.")
 
@@ -0,0 +1,934 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * GimpRc binary cache
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "config-types.h"
+
+#include "gimprc.h"
+#include "gimprc-cache.h"
+#include "gimprc-unknown.h"
+
+
+/*
+ * The cache is a snapshot of a GimpRc as it is after parsing the
+ * system and the user gimprc.  It is only used while the version of
+ * GIMP, and the paths, sizes and modification times of both gimprc
+ * files and of the unitrc (which defines the units used in them) are
+ * the same as when it was written, and the text files are parsed
+ * otherwise.
+ *
+ * Of the GimpRc itself, only the properties set by the gimprc files
+ * are stored, so that defaults that depend on the machine are still
+ * computed on each start.  Aggregated config objects are stored with
+ * all of their properties.
+ *
+ * The format is native-endian and consists of
+ *
+ *   magic, version, 3 x (path, exists, mtime, mtime usec, size),
+ *   properties, unknown tokens
+ *
+ * where a property is its name, a type tag and the value, objects
+ * are nested lists of properties, and lists end with an empty name.
+ * Objects with properties of other types are stored in their text
+ * serialization.
+ */
+
+#define CACHE_FNAME  "gimprc-cache"
+#define CACHE_MAGIC  "GIMP gimprc cache 1"
+
+#define RECORD_KEY   "gimp-rc-cache-record"
+
+
+typedef enum
+{
+  CACHE_TAG_BOOLEAN = 1,
+  CACHE_TAG_INT,
+  CACHE_TAG_UINT,
+  CACHE_TAG_INT64,
+  CACHE_TAG_UINT64,
+  CACHE_TAG_DOUBLE,
+  CACHE_TAG_ENUM,
+  CACHE_TAG_FLAGS,
+  CACHE_TAG_STRING,
+  CACHE_TAG_RGB,
+  CACHE_TAG_FILE,
+  CACHE_TAG_OBJECT,
+  CACHE_TAG_OBJECT_TEXT
+} CacheTag;
+
+typedef struct
+{
+  const gchar *data;
+  gsize        len;
+  gsize        pos;
+} CacheReader;
+
+typedef struct
+{
+  GObject     *object;
+  GParamSpec  *pspec;
+  GValue       value;
+  const gchar *text;    /* to deserialize into object instead */
+} CacheValue;
+
+
+static void       gimp_rc_cache_notify       (GimpRc       *rc,
+                                              GParamSpec   *pspec,
+                                              GHashTable   *record);
+
+static GFile    * gimp_rc_cache_get_file     (void);
+static void       cache_write_header         (GByteArray   *array,
+                                              GimpRc       *rc);
+static void       cache_write_stamp          (GByteArray   *array,
+                                              GFile        *file);
+static gboolean   cache_write_object         (GByteArray   *array,
+                                              GObject      *object,
+                                              GHashTable   *record);
+static void       cache_write_unknown_token  (const gchar  *key,
+                                              const gchar  *value,
+                                              GByteArray   *array);
+static void       cache_write_string         (GByteArray   *array,
+                                              const gchar  *string);
+
+static gboolean   cache_read_header          (CacheReader  *reader,
+                                              GimpRc       *rc);
+static gboolean   cache_read_object          (CacheReader  *reader,
+                                              GObject      *object,
+                                              GArray       *values);
+static gboolean   cache_read_value           (CacheReader  *reader,
+                                              CacheTag      tag,
+                                              GObject      *object,
+                                              GParamSpec   *pspec,
+                                              GArray       *values);
+static gboolean   cache_read                 (CacheReader  *reader,
+                                              gpointer      dest,
+                                              gsize         size);
+static gboolean   cache_read_string          (CacheReader  *reader,
+                                              const gchar **string);
+
+
+/*  public functions  */
+
+/**
+ * gimp_rc_cache_load:
+ * @rc: a #GimpRc object.
+ *
+ * Restores @rc from the cache if it is still valid for the gimprc
+ * files of @rc.  Nothing is changed if it isn't.
+ *
+ * Return value: %TRUE if @rc was restored from the cache.
+ **/
+gboolean
+gimp_rc_cache_load (GimpRc *rc)
+{
+  GFile       *file;
+  gchar       *path;
+  GMappedFile *mapped;
+  CacheReader  reader;
+  GArray      *values;
+  GSList      *tokens = NULL;
+  GSList      *list;
+  gboolean     success;
+  gint         i;
+
+  g_return_val_if_fail (GIMP_IS_RC (rc), FALSE);
+
+  file = gimp_rc_cache_get_file ();
+  path = g_file_get_path (file);
+  g_object_unref (file);
+
+  if (! path)
+    return FALSE;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+
+  if (! mapped)
+    {
+      g_free (path);
+      return FALSE;
+    }
+
+  reader.data = g_mapped_file_get_contents (mapped);
+  reader.len  = g_mapped_file_get_length (mapped);
+  reader.pos  = 0;
+
+  if (! reader.data || ! reader.len)
+    {
+      g_mapped_file_unref (mapped);
+      g_free (path);
+      return FALSE;
+    }
+
+  values = g_array_new (FALSE, TRUE, sizeof (CacheValue));
+
+  success = (cache_read_header (&reader, rc) &&
+             cache_read_object (&reader, G_OBJECT (rc), values));
+
+  /*  the unknown tokens  */
+  while (success)
+    {
+      const gchar *key;
+      const gchar *value;
+
+      success = cache_read_string (&reader, &key);
+
+      if (! success || ! *key)
+        break;
+
+      success = cache_read_string (&reader, &value);
+
+      if (success)
+        {
+          tokens = g_slist_prepend (tokens, (gpointer) value);
+          tokens = g_slist_prepend (tokens, (gpointer) key);
+        }
+    }
+
+  /*  only touch the rc if all of the cache could be read  */
+  if (success)
+    {
+      if (rc->verbose)
+        g_print ("Restoring configuration from '%s'\n",
+                 gimp_filename_to_utf8 (path));
+
+      g_object_freeze_notify (G_OBJECT (rc));
+
+      for (i = 0; i < values->len; i++)
+        {
+          CacheValue *value = &g_array_index (values, CacheValue, i);
+
+          if (value->text)
+            gimp_config_deserialize_string (GIMP_CONFIG (value->object),
+                                            value->text, -1, NULL, NULL);
+          else
+            g_object_set_property (value->object,
+                                   value->pspec->name, &value->value);
+        }
+
+      for (list = tokens; list; list = g_slist_next (list->next))
+        gimp_rc_add_unknown_token (GIMP_CONFIG (rc),
+                                   list->data, list->next->data);
+
+      g_object_thaw_notify (G_OBJECT (rc));
+    }
+
+  for (i = 0; i < values->len; i++)
+    {
+      CacheValue *value = &g_array_index (values, CacheValue, i);
+
+      if (G_IS_VALUE (&value->value))
+        g_value_unset (&value->value);
+
+      g_object_unref (value->object);
+    }
+
+  g_array_free (values, TRUE);
+  g_slist_free (tokens);
+
+  g_mapped_file_unref (mapped);
+  g_free (path);
+
+  return success;
+}
+
+/**
+ * gimp_rc_cache_begin:
+ * @rc: a #GimpRc object.
+ *
+ * Starts recording which properties of @rc are set, call this before
+ * loading the gimprc files.
+ **/
+void
+gimp_rc_cache_begin (GimpRc *rc)
+{
+  GHashTable *record;
+
+  g_return_if_fail (GIMP_IS_RC (rc));
+
+  record = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_object_set_data_full (G_OBJECT (rc), RECORD_KEY, record,
+                          (GDestroyNotify) g_hash_table_unref);
+
+  g_signal_connect (rc, "notify",
+                    G_CALLBACK (gimp_rc_cache_notify),
+                    record);
+}
+
+/**
+ * gimp_rc_cache_end:
+ * @rc:      a #GimpRc object.
+ * @success: whether the gimprc files were loaded without errors.
+ *
+ * Stops recording and, if @success is %TRUE, writes the cache for
+ * the current state of @rc.
+ **/
+void
+gimp_rc_cache_end (GimpRc   *rc,
+                   gboolean  success)
+{
+  GHashTable *record;
+  GByteArray *array;
+  GFile      *file;
+  GError     *error = NULL;
+
+  g_return_if_fail (GIMP_IS_RC (rc));
+
+  record = g_object_get_data (G_OBJECT (rc), RECORD_KEY);
+
+  g_return_if_fail (record != NULL);
+
+  g_signal_handlers_disconnect_by_func (rc,
+                                        gimp_rc_cache_notify,
+                                        record);
+
+  file = gimp_rc_cache_get_file ();
+
+  if (! success)
+    {
+      /*  don't keep a cache that would hide the errors  */
+      g_file_delete (file, NULL, NULL);
+      g_object_unref (file);
+
+      g_object_set_data (G_OBJECT (rc), RECORD_KEY, NULL);
+      return;
+    }
+
+  array = g_byte_array_new ();
+
+  cache_write_header (array, rc);
+
+  if (cache_write_object (array, G_OBJECT (rc), record))
+    {
+      gimp_rc_foreach_unknown_token (GIMP_CONFIG (rc),
+                                     (GimpConfigForeachFunc)
+                                     cache_write_unknown_token,
+                                     array);
+      cache_write_string (array, "");
+
+      if (! g_file_replace_contents (file,
+                                     (const gchar *) array->data, array->len,
+                                     NULL, FALSE, G_FILE_CREATE_NONE,
+                                     NULL, NULL, &error))
+        {
+          if (rc->verbose)
+            g_print ("Could not write gimprc cache: %s\n", error->message);
+
+          g_clear_error (&error);
+        }
+    }
+  else
+    {
+      /*  there is a property we can't store  */
+      g_file_delete (file, NULL, NULL);
+    }
+
+  g_byte_array_free (array, TRUE);
+  g_object_unref (file);
+
+  g_object_set_data (G_OBJECT (rc), RECORD_KEY, NULL);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_rc_cache_notify (GimpRc     *rc,
+                      GParamSpec *pspec,
+                      GHashTable *record)
+{
+  g_hash_table_add (record, (gpointer) g_intern_string (pspec->name));
+}
+
+static GFile *
+gimp_rc_cache_get_file (void)
+{
+  return gimp_directory_file (CACHE_FNAME, NULL);
+}
+
+static void
+cache_write_header (GByteArray *array,
+                    GimpRc     *rc)
+{
+  GFile *unitrc = gimp_directory_file ("unitrc", NULL);
+
+  cache_write_string (array, CACHE_MAGIC);
+  cache_write_string (array, GIMP_VERSION);
+
+  cache_write_stamp (array, rc->system_gimprc);
+  cache_write_stamp (array, rc->user_gimprc);
+  cache_write_stamp (array, unitrc);
+
+  g_object_unref (unitrc);
+}
+
+static void
+cache_write_stamp (GByteArray *array,
+                   GFile      *file)
+{
+  GFileInfo *info   = NULL;
+  gchar     *path   = NULL;
+  guint8     exists = FALSE;
+  guint64    mtime  = 0;
+  guint32    usec   = 0;
+  guint64    size   = 0;
+
+  if (file)
+    {
+      path = g_file_get_path (file);
+      info = g_file_query_info (file,
+                                G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                                G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                                G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                                G_FILE_QUERY_INFO_NONE,
+                                NULL, NULL);
+    }
+
+  if (info)
+    {
+      exists = TRUE;
+      mtime  = g_file_info_get_attribute_uint64 (info,
+                                                 G_FILE_ATTRIBUTE_TIME_MODIFIED);
+      usec   = g_file_info_get_attribute_uint32 (info,
+                                                 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+      size   = g_file_info_get_size (info);
+
+      g_object_unref (info);
+    }
+
+  cache_write_string (array, path ? path : "");
+  g_byte_array_append (array, &exists,          sizeof (exists));
+  g_byte_array_append (array, (guint8 *) &mtime, sizeof (mtime));
+  g_byte_array_append (array, (guint8 *) &usec,  sizeof (usec));
+  g_byte_array_append (array, (guint8 *) &size,  sizeof (size));
+
+  g_free (path);
+}
+
+static gboolean
+cache_write_object (GByteArray *array,
+                    GObject    *object,
+                    GHashTable *record)
+{
+  GParamSpec **pspecs;
+  guint        n_pspecs;
+  guint        i;
+  gboolean     success = TRUE;
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (object),
+                                           &n_pspecs);
+
+  for (i = 0; success && i < n_pspecs; i++)
+    {
+      GParamSpec *pspec = pspecs[i];
+      GValue      value = G_VALUE_INIT;
+      GType       type  = G_TYPE_FUNDAMENTAL (pspec->value_type);
+      guint8      tag   = 0;
+
+      if (! (pspec->flags & GIMP_CONFIG_PARAM_SERIALIZE))
+        continue;
+
+      if (record                     &&
+          type != G_TYPE_OBJECT      &&
+          type != G_TYPE_INTERFACE   &&
+          ! g_hash_table_contains (record, pspec->name))
+        continue;
+
+      g_value_init (&value, pspec->value_type);
+      g_object_get_property (object, pspec->name, &value);
+
+      switch (type)
+        {
+        case G_TYPE_BOOLEAN: tag = CACHE_TAG_BOOLEAN; break;
+        case G_TYPE_INT:     tag = CACHE_TAG_INT;     break;
+        case G_TYPE_UINT:    tag = CACHE_TAG_UINT;    break;
+        case G_TYPE_INT64:   tag = CACHE_TAG_INT64;   break;
+        case G_TYPE_UINT64:  tag = CACHE_TAG_UINT64;  break;
+        case G_TYPE_DOUBLE:  tag = CACHE_TAG_DOUBLE;  break;
+        case G_TYPE_ENUM:    tag = CACHE_TAG_ENUM;    break;
+        case G_TYPE_FLAGS:   tag = CACHE_TAG_FLAGS;   break;
+        case G_TYPE_STRING:  tag = CACHE_TAG_STRING;  break;
+
+        case G_TYPE_BOXED:
+          if (GIMP_VALUE_HOLDS_RGB (&value))
+            tag = CACHE_TAG_RGB;
+          break;
+
+        case G_TYPE_OBJECT:
+        case G_TYPE_INTERFACE:
+          if (g_type_is_a (pspec->value_type, G_TYPE_FILE))
+            tag = CACHE_TAG_FILE;
+          else if (GIMP_IS_CONFIG (g_value_get_object (&value)))
+            tag = CACHE_TAG_OBJECT;
+          break;
+
+        default:
+          break;
+        }
+
+      if (! tag)
+        {
+          success = FALSE;
+        }
+      else
+        {
+          cache_write_string (array, pspec->name);
+          g_byte_array_append (array, &tag, 1);
+
+          switch (tag)
+            {
+            case CACHE_TAG_BOOLEAN:
+            case CACHE_TAG_INT:
+            case CACHE_TAG_ENUM:
+              {
+                gint32 v;
+
+                if (tag == CACHE_TAG_BOOLEAN)
+                  v = g_value_get_boolean (&value);
+                else if (tag == CACHE_TAG_INT)
+                  v = g_value_get_int (&value);
+                else
+                  v = g_value_get_enum (&value);
+
+                g_byte_array_append (array, (guint8 *) &v, sizeof (v));
+              }
+              break;
+
+            case CACHE_TAG_UINT:
+            case CACHE_TAG_FLAGS:
+              {
+                guint32 v = (tag == CACHE_TAG_UINT ?
+                             g_value_get_uint (&value) :
+                             g_value_get_flags (&value));
+
+                g_byte_array_append (array, (guint8 *) &v, sizeof (v));
+              }
+              break;
+
+            case CACHE_TAG_INT64:
+              {
+                gint64 v = g_value_get_int64 (&value);
+
+                g_byte_array_append (array, (guint8 *) &v, sizeof (v));
+              }
+              break;
+
+            case CACHE_TAG_UINT64:
+              {
+                guint64 v = g_value_get_uint64 (&value);
+
+                g_byte_array_append (array, (guint8 *) &v, sizeof (v));
+              }
+              break;
+
+            case CACHE_TAG_DOUBLE:
+              {
+                gdouble v = g_value_get_double (&value);
+
+                g_byte_array_append (array, (guint8 *) &v, sizeof (v));
+              }
+              break;
+
+            case CACHE_TAG_STRING:
+              {
+                const gchar *v   = g_value_get_string (&value);
+                guint8       set = (v != NULL);
+
+                g_byte_array_append (array, &set, 1);
+
+                if (v)
+                  cache_write_string (array, v);
+              }
+              break;
+
+            case CACHE_TAG_RGB:
+              {
+                GimpRGB v;
+
+                gimp_value_get_rgb (&value, &v);
+
+                g_byte_array_append (array, (guint8 *) &v, sizeof (v));
+              }
+              break;
+
+            case CACHE_TAG_FILE:
+              {
+                GFile  *v   = g_value_get_object (&value);
+                guint8  set = (v != NULL);
+
+                g_byte_array_append (array, &set, 1);
+
+                if (v)
+                  {
+                    gchar *uri = g_file_get_uri (v);
+
+                    cache_write_string (array, uri);
+                    g_free (uri);
+                  }
+              }
+              break;
+
+            case CACHE_TAG_OBJECT:
+              {
+                GimpConfig *v      = g_value_get_object (&value);
+                GByteArray *nested = g_byte_array_new ();
+
+                /*  fall back to the text format for objects with
+                 *  properties we can't store, see above
+                 */
+                if (cache_write_object (nested, G_OBJECT (v), NULL))
+                  {
+                    g_byte_array_append (array, nested->data, nested->len);
+                  }
+                else
+                  {
+                    gchar *text = gimp_config_serialize_to_string (v, NULL);
+
+                    array->data[array->len - 1] = CACHE_TAG_OBJECT_TEXT;
+
+                    cache_write_string (array, text);
+                    g_free (text);
+                  }
+
+                g_byte_array_free (nested, TRUE);
+              }
+              break;
+            }
+        }
+
+      g_value_unset (&value);
+    }
+
+  g_free (pspecs);
+
+  cache_write_string (array, "");
+
+  return success;
+}
+
+static void
+cache_write_unknown_token (const gchar *key,
+                           const gchar *value,
+                           GByteArray  *array)
+{
+  cache_write_string (array, key);
+  cache_write_string (array, value);
+}
+
+static void
+cache_write_string (GByteArray  *array,
+                    const gchar *string)
+{
+  g_byte_array_append (array, (const guint8 *) string, strlen (string) + 1);
+}
+
+static gboolean
+cache_read_header (CacheReader *reader,
+                   GimpRc      *rc)
+{
+  GByteArray  *array;
+  const gchar *string;
+  gboolean     success;
+
+  if (! cache_read_string (reader, &string) || strcmp (string, CACHE_MAGIC))
+    return FALSE;
+
+  if (! cache_read_string (reader, &string) || strcmp (string, GIMP_VERSION))
+    return FALSE;
+
+  /*  the stamps have to be the same as the ones for the current files  */
+  array = g_byte_array_new ();
+
+  cache_write_header (array, rc);
+
+  success = (reader->pos < array->len           &&
+             reader->len >= array->len          &&
+             ! memcmp (reader->data + reader->pos,
+                       array->data + reader->pos,
+                       array->len - reader->pos));
+
+  if (success)
+    reader->pos = array->len;
+
+  g_byte_array_free (array, TRUE);
+
+  return success;
+}
+
+static gboolean
+cache_read_object (CacheReader *reader,
+                   GObject     *object,
+                   GArray      *values)
+{
+  while (TRUE)
+    {
+      const gchar *name;
+      GParamSpec  *pspec;
+      guint8       tag;
+
+      if (! cache_read_string (reader, &name))
+        return FALSE;
+
+      if (! *name)
+        return TRUE;
+
+      if (! cache_read (reader, &tag, 1))
+        return FALSE;
+
+      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (object),
+                                            name);
+
+      if (! pspec || ! (pspec->flags & GIMP_CONFIG_PARAM_SERIALIZE))
+        return FALSE;
+
+      if (! cache_read_value (reader, tag, object, pspec, values))
+        return FALSE;
+    }
+}
+
+static gboolean
+cache_read_value (CacheReader *reader,
+                  CacheTag     tag,
+                  GObject     *object,
+                  GParamSpec  *pspec,
+                  GArray      *values)
+{
+  CacheValue  value = { NULL, };
+  GType       type  = G_TYPE_FUNDAMENTAL (pspec->value_type);
+  gboolean    success;
+
+  if (tag == CACHE_TAG_OBJECT || tag == CACHE_TAG_OBJECT_TEXT)
+    {
+      GObject *child;
+
+      if (type != G_TYPE_OBJECT)
+        return FALSE;
+
+      g_object_get (object, pspec->name, &child, NULL);
+
+      if (! GIMP_IS_CONFIG (child))
+        {
+          if (child)
+            g_object_unref (child);
+
+          return FALSE;
+        }
+
+      if (tag == CACHE_TAG_OBJECT)
+        {
+          success = cache_read_object (reader, child, values);
+        }
+      else
+        {
+          success = cache_read_string (reader, &value.text);
+
+          if (success)
+            {
+              value.object = g_object_ref (child);
+
+              g_array_append_val (values, value);
+            }
+        }
+
+      g_object_unref (child);
+
+      return success;
+    }
+
+  g_value_init (&value.value, pspec->value_type);
+
+  switch (tag)
+    {
+    case CACHE_TAG_BOOLEAN:
+    case CACHE_TAG_INT:
+    case CACHE_TAG_ENUM:
+      {
+        gint32 v;
+
+        success = cache_read (reader, &v, sizeof (v));
+
+        if (tag == CACHE_TAG_BOOLEAN && type == G_TYPE_BOOLEAN)
+          g_value_set_boolean (&value.value, v);
+        else if (tag == CACHE_TAG_INT && type == G_TYPE_INT)
+          g_value_set_int (&value.value, v);
+        else if (tag == CACHE_TAG_ENUM && type == G_TYPE_ENUM)
+          g_value_set_enum (&value.value, v);
+        else
+          success = FALSE;
+      }
+      break;
+
+    case CACHE_TAG_UINT:
+    case CACHE_TAG_FLAGS:
+      {
+        guint32 v;
+
+        success = cache_read (reader, &v, sizeof (v));
+
+        if (tag == CACHE_TAG_UINT && type == G_TYPE_UINT)
+          g_value_set_uint (&value.value, v);
+        else if (tag == CACHE_TAG_FLAGS && type == G_TYPE_FLAGS)
+          g_value_set_flags (&value.value, v);
+        else
+          success = FALSE;
+      }
+      break;
+
+    case CACHE_TAG_INT64:
+      {
+        gint64 v;
+
+        success = (type == G_TYPE_INT64 &&
+                   cache_read (reader, &v, sizeof (v)));
+
+        if (success)
+          g_value_set_int64 (&value.value, v);
+      }
+      break;
+
+    case CACHE_TAG_UINT64:
+      {
+        guint64 v;
+
+        success = (type == G_TYPE_UINT64 &&
+                   cache_read (reader, &v, sizeof (v)));
+
+        if (success)
+          g_value_set_uint64 (&value.value, v);
+      }
+      break;
+
+    case CACHE_TAG_DOUBLE:
+      {
+        gdouble v;
+
+        success = (type == G_TYPE_DOUBLE &&
+                   cache_read (reader, &v, sizeof (v)));
+
+        if (success)
+          g_value_set_double (&value.value, v);
+      }
+      break;
+
+    case CACHE_TAG_STRING:
+      {
+        guint8       set;
+        const gchar *v = NULL;
+
+        success = (type == G_TYPE_STRING     &&
+                   cache_read (reader, &set, 1) &&
+                   (! set || cache_read_string (reader, &v)));
+
+        if (success)
+          g_value_set_string (&value.value, v);
+      }
+      break;
+
+    case CACHE_TAG_RGB:
+      {
+        GimpRGB v;
+
+        success = (GIMP_VALUE_HOLDS_RGB (&value.value) &&
+                   cache_read (reader, &v, sizeof (v)));
+
+        if (success)
+          gimp_value_set_rgb (&value.value, &v);
+      }
+      break;
+
+    case CACHE_TAG_FILE:
+      {
+        guint8       set;
+        const gchar *v = NULL;
+
+        success = (g_type_is_a (pspec->value_type, G_TYPE_FILE) &&
+                   cache_read (reader, &set, 1)                  &&
+                   (! set || cache_read_string (reader, &v)));
+
+        if (success && v)
+          g_value_take_object (&value.value, g_file_new_for_uri (v));
+      }
+      break;
+
+    default:
+      success = FALSE;
+      break;
+    }
+
+  /*  reject values the property wouldn't accept as they are  */
+  if (success && g_param_value_validate (pspec, &value.value))
+    success = FALSE;
+
+  if (success)
+    {
+      value.object = g_object_ref (object);
+      value.pspec  = pspec;
+
+      g_array_append_val (values, value);
+    }
+  else
+    {
+      g_value_unset (&value.value);
+    }
+
+  return success;
+}
+
+static gboolean
+cache_read (CacheReader *reader,
+            gpointer     dest,
+            gsize        size)
+{
+  if (reader->len - reader->pos < size)
+    return FALSE;
+
+  memcpy (dest, reader->data + reader->pos, size);
+
+  reader->pos += size;
+
+  return TRUE;
+}
+
+static gboolean
+cache_read_string (CacheReader  *reader,
+                   const gchar **string)
+{
+  const gchar *end;
+
+  end = memchr (reader->data + reader->pos, '\0', reader->len - reader->pos);
+
+  if (! end || ! g_utf8_validate (reader->data + reader->pos, -1, NULL))
+    return FALSE;
+
+  *string = reader->data + reader->pos;
+
+  reader->pos = end - reader->data + 1;
+
+  return TRUE;
+}
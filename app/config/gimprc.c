@@ -32,6 +32,7 @@
 
 #include "gimpconfig-file.h"
 #include "gimprc.h"
+#include "gimprc-cache.h"
 #include "gimprc-deserialize.h"
 #include "gimprc-serialize.h"
 #include "gimprc-unknown.h"
@@ -273,7 +274,8 @@ gimp_rc_notify (GimpRc     *rc,
  * @verbose:       enable console messages about loading and saving
  *
  * Creates a new GimpRc object and loads the system-wide and the user
- * configuration files.
+ * configuration files, or restores their contents from the gimprc
+ * cache if neither file changed since it was written.
  *
  * Returns: the new #GimpRc.
  */
@@ -298,18 +300,28 @@ gimp_rc_new (GObject  *gimp,
                      "user-gimprc",   user_gimprc,
                      NULL);
 
-  gimp_rc_load_system (rc);
-  gimp_rc_load_user (rc);
+  if (! gimp_rc_cache_load (rc))
+    {
+      gboolean success;
+
+      gimp_rc_cache_begin (rc);
+
+      success = gimp_rc_load_system (rc);
+      success = gimp_rc_load_user (rc) && success;
+
+      gimp_rc_cache_end (rc, success);
+    }
 
   return rc;
 }
 
-void
+gboolean
 gimp_rc_load_system (GimpRc *rc)
 {
-  GError *error = NULL;
+  GError   *error   = NULL;
+  gboolean  success = TRUE;
 
-  g_return_if_fail (GIMP_IS_RC (rc));
+  g_return_val_if_fail (GIMP_IS_RC (rc), FALSE);
 
   if (rc->verbose)
     g_print ("Parsing '%s'\n",
@@ -319,18 +331,25 @@ gimp_rc_load_system (GimpRc *rc)
                                        rc->system_gimprc, NULL, &error))
     {
       if (error->code != GIMP_CONFIG_ERROR_OPEN_ENOENT)
-        g_message ("%s", error->message);
+        {
+          g_message ("%s", error->message);
+
+          success = FALSE;
+        }
 
       g_clear_error (&error);
     }
+
+  return success;
 }
 
-void
+gboolean
 gimp_rc_load_user (GimpRc *rc)
 {
-  GError *error = NULL;
+  GError   *error   = NULL;
+  gboolean  success = TRUE;
 
-  g_return_if_fail (GIMP_IS_RC (rc));
+  g_return_val_if_fail (GIMP_IS_RC (rc), FALSE);
 
   if (rc->verbose)
     g_print ("Parsing '%s'\n",
@@ -344,10 +363,14 @@ gimp_rc_load_user (GimpRc *rc)
           g_message ("%s", error->message);
 
           gimp_config_file_backup_on_error (rc->user_gimprc, "gimprc", NULL);
+
+          success = FALSE;
         }
 
       g_clear_error (&error);
     }
+
+  return success;
 }
 
 void
@@ -563,6 +563,18 @@ typedef enum  /*< pdb-skip >*/
  */
 
 
+typedef enum  /*< pdb-skip, skip >*/
+{
+  GIMP_ALLOCATION_TEMP_BUF,   /*  temporary buffers                  */
+  GIMP_ALLOCATION_DRAWABLE,   /*  the pixels of layers and channels  */
+  GIMP_ALLOCATION_PROJECTION, /*  image and layer group projections  */
+  GIMP_ALLOCATION_CACHE,      /*  view previews and brush transforms */
+  GIMP_ALLOCATION_UNDO,       /*  the undo and redo history          */
+
+  GIMP_N_ALLOCATIONS          /*< skip >*/
+} GimpAllocation;
+
+
 typedef enum  /*< pdb-skip, skip >*/
 {
   GIMP_CONTEXT_PROP_FIRST       =  2,
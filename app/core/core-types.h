@@ -197,12 +197,16 @@ typedef struct _GimpTagged          GimpTagged;      /* dummy typedef */
 
 /*  non-object types  */
 
+typedef struct _GimpBoundaryCache   GimpBoundaryCache;
+typedef struct _GimpBoundaryJob     GimpBoundaryJob;
 typedef struct _GimpBoundSeg        GimpBoundSeg;
 typedef struct _GimpCoords          GimpCoords;
 typedef struct _GimpGradientSegment GimpGradientSegment;
+typedef struct _GimpMaskSummary     GimpMaskSummary;
 typedef struct _GimpPaletteEntry    GimpPaletteEntry;
 typedef struct _GimpSamplePoint     GimpSamplePoint;
 typedef struct _GimpScanConvert     GimpScanConvert;
+typedef struct _GimpSpans           GimpSpans;
 typedef struct _GimpTempBuf         GimpTempBuf;
 typedef         guint32             GimpTattoo;
 
@@ -0,0 +1,176 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-allocation.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gimp-allocation.h"
+
+
+/*  the memory held by each subsystem is accounted in bytes, together
+ *  with the total ever allocated, so that the dashboard can show both
+ *  what is currently held and how fast it is being allocated.
+ *
+ *  buffers are accounted at their nominal size, that is the size of
+ *  their extent, regardless of which of their tiles are actually
+ *  allocated, cached or swapped out.
+ */
+
+
+#define BUFFER_TAG_KEY "gimp-allocation"
+
+
+typedef struct
+{
+  GimpAllocation allocation;
+  gint64         size;
+} BufferTag;
+
+
+/*  local function prototypes  */
+
+static void   gimp_allocation_buffer_tag_free (BufferTag *tag);
+
+
+/*  local variables  */
+
+static GMutex  allocation_mutex;
+static gint64  allocation_live[GIMP_N_ALLOCATIONS];
+static guint64 allocation_total[GIMP_N_ALLOCATIONS];
+
+
+/*  public functions  */
+
+/*  accounts 'size' bytes to 'allocation'.  a positive size is an
+ *  allocation, and a negative size frees memory allocated earlier.
+ */
+void
+gimp_allocation_add (GimpAllocation allocation,
+                     gint64         size)
+{
+  g_return_if_fail (allocation < GIMP_N_ALLOCATIONS);
+
+  g_mutex_lock (&allocation_mutex);
+
+  allocation_live[allocation] += size;
+
+  if (size > 0)
+    allocation_total[allocation] += size;
+
+  g_mutex_unlock (&allocation_mutex);
+}
+
+/*  hands 'size' bytes from one subsystem over to another, without
+ *  counting it as a new allocation
+ */
+void
+gimp_allocation_move (GimpAllocation from,
+                      GimpAllocation to,
+                      gint64         size)
+{
+  g_return_if_fail (from < GIMP_N_ALLOCATIONS);
+  g_return_if_fail (to   < GIMP_N_ALLOCATIONS);
+
+  g_mutex_lock (&allocation_mutex);
+
+  allocation_live[from] -= size;
+  allocation_live[to]   += size;
+
+  g_mutex_unlock (&allocation_mutex);
+}
+
+/*  accounts 'buffer' to 'allocation' for as long as the buffer lives,
+ *  or until it is untagged.  a buffer that is already tagged stays
+ *  accounted to the subsystem that tagged it first, so that e.g. a
+ *  layer group's projection, which is also its drawable buffer, isn't
+ *  counted twice.
+ */
+void
+gimp_allocation_tag_buffer (GeglBuffer     *buffer,
+                            GimpAllocation  allocation)
+{
+  const GeglRectangle *extent;
+  BufferTag           *tag;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (allocation < GIMP_N_ALLOCATIONS);
+
+  if (g_object_get_data (G_OBJECT (buffer), BUFFER_TAG_KEY))
+    return;
+
+  extent = gegl_buffer_get_extent (buffer);
+
+  tag = g_slice_new (BufferTag);
+
+  tag->allocation = allocation;
+  tag->size       = (gint64) extent->width * extent->height *
+                    babl_format_get_bytes_per_pixel (
+                      gegl_buffer_get_format (buffer));
+
+  gimp_allocation_add (tag->allocation, tag->size);
+
+  g_object_set_data_full (G_OBJECT (buffer), BUFFER_TAG_KEY, tag,
+                          (GDestroyNotify) gimp_allocation_buffer_tag_free);
+}
+
+/*  stops accounting 'buffer' to 'allocation', if it was tagged by it,
+ *  for example when the buffer is handed over to the undo history
+ */
+void
+gimp_allocation_untag_buffer (GeglBuffer     *buffer,
+                              GimpAllocation  allocation)
+{
+  BufferTag *tag;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+
+  tag = g_object_get_data (G_OBJECT (buffer), BUFFER_TAG_KEY);
+
+  if (tag && tag->allocation == allocation)
+    g_object_set_data (G_OBJECT (buffer), BUFFER_TAG_KEY, NULL);
+}
+
+void
+gimp_allocation_get_stats (GimpAllocation  allocation,
+                           guint64        *live,
+                           guint64        *total)
+{
+  g_return_if_fail (allocation < GIMP_N_ALLOCATIONS);
+
+  g_mutex_lock (&allocation_mutex);
+
+  if (live)  *live  = MAX (allocation_live[allocation], 0);
+  if (total) *total = allocation_total[allocation];
+
+  g_mutex_unlock (&allocation_mutex);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_allocation_buffer_tag_free (BufferTag *tag)
+{
+  gimp_allocation_add (tag->allocation, -tag->size);
+
+  g_slice_free (BufferTag, tag);
+}
@@ -0,0 +1,40 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-allocation.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_ALLOCATION_H__
+#define __GIMP_ALLOCATION_H__
+
+
+void       gimp_allocation_add          (GimpAllocation  allocation,
+                                         gint64          size);
+void       gimp_allocation_move         (GimpAllocation  from,
+                                         GimpAllocation  to,
+                                         gint64          size);
+
+void       gimp_allocation_tag_buffer   (GeglBuffer     *buffer,
+                                         GimpAllocation  allocation);
+void       gimp_allocation_untag_buffer (GeglBuffer     *buffer,
+                                         GimpAllocation  allocation);
+
+void       gimp_allocation_get_stats    (GimpAllocation  allocation,
+                                         guint64        *live,
+                                         guint64        *total);
+
+
+#endif /* __GIMP_ALLOCATION_H__ */
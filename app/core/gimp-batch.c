@@ -20,6 +20,10 @@
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef G_OS_WIN32
+#include <io.h>
+#endif
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -29,24 +33,108 @@
 
 #include "gimp.h"
 #include "gimp-batch.h"
+#include "gimpcontainer.h"
+#include "gimpcontext.h"
+#include "gimpimage.h"
 #include "gimpparamspecs.h"
 
 #include "pdb/gimppdb.h"
+#include "pdb/gimppdbcontext.h"
 #include "pdb/gimpprocedure.h"
 
+#include "plug-in/gimpplugin.h"
+#include "plug-in/gimppluginmanager.h"
+#define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
+#include "plug-in/gimppluginmanager-call.h"
+#include "plug-in/gimppluginprocedure.h"
+
 #include "gimp-intl.h"
 
 
 #define BATCH_DEFAULT_EVAL_PROC   "plug-in-script-fu-eval"
 
+/*  how often the memory used by the images of queued jobs is checked  */
+#define BATCH_QUEUE_MEMORY_INTERVAL 250 /* ms */
+
+
+typedef struct _GimpBatchQueue GimpBatchQueue;
+typedef struct _GimpBatchJob   GimpBatchJob;
+
+struct _GimpBatchJob
+{
+  GimpBatchQueue *queue;
+  gint            id;
+  gchar          *command;
+  GimpContext    *context;
+  GimpPlugIn     *plug_in;
+  GList          *images;
+  gint64          start_time;
+  gint64          peak_memory;
+  const gchar    *status;
+};
+
+struct _GimpBatchQueue
+{
+  Gimp          *gimp;
+  gchar         *proc_name;
+  GimpProcedure *procedure;
+  gint           n_workers;
+  guint64        memory_limit;
+
+  GIOChannel    *input;
+  guint          input_id;
+  gboolean       input_done;
+  gint           n_jobs;
+
+  GQueue         pending;
+  GList         *running;
+  guint          dispatch_id;
+
+  guint          memory_id;
+};
+
 
 static void  gimp_batch_exit_after_callback (Gimp          *gimp) G_GNUC_NORETURN;
 
+static const gchar * gimp_batch_get_interpreter
+                                            (Gimp          *gimp,
+                                             const gchar   *batch_interpreter);
+
 static void  gimp_batch_run_cmd             (Gimp          *gimp,
                                              const gchar   *proc_name,
                                              GimpProcedure *procedure,
                                              GimpRunMode    run_mode,
                                              const gchar   *cmd);
+static GimpValueArray *
+             gimp_batch_get_cmd_args        (GimpProcedure *procedure,
+                                             GimpRunMode    run_mode,
+                                             const gchar   *cmd);
+
+static gboolean gimp_batch_queue_read       (GIOChannel     *channel,
+                                             GIOCondition    condition,
+                                             GimpBatchQueue *queue);
+static void  gimp_batch_queue_dispatch      (GimpBatchQueue *queue);
+static gboolean gimp_batch_queue_dispatch_idle (GimpBatchQueue *queue);
+static void  gimp_batch_queue_start_job     (GimpBatchQueue *queue,
+                                             GimpBatchJob   *job);
+static void  gimp_batch_queue_finish_job    (GimpBatchQueue *queue,
+                                             GimpBatchJob   *job,
+                                             GimpValueArray *return_vals,
+                                             const GError   *error);
+static GimpBatchJob *
+             gimp_batch_queue_find_job      (GimpBatchQueue *queue,
+                                             GimpContext    *context);
+static gint64 gimp_batch_job_get_memsize    (GimpBatchJob   *job);
+static gboolean gimp_batch_queue_check_memory (GimpBatchQueue *queue);
+static void  gimp_batch_queue_image_add     (GimpContainer  *images,
+                                             GimpImage      *image,
+                                             GimpBatchQueue *queue);
+static void  gimp_batch_queue_image_remove  (GimpContainer  *images,
+                                             GimpImage      *image,
+                                             GimpBatchQueue *queue);
+static void  gimp_batch_queue_job_return    (GimpPlugIn     *plug_in,
+                                             GimpValueArray *return_vals,
+                                             GimpBatchJob   *job);
 
 
 void
@@ -63,19 +151,7 @@ gimp_batch_run (Gimp         *gimp,
                                     G_CALLBACK (gimp_batch_exit_after_callback),
                                     NULL);
 
-  if (! batch_interpreter)
-    {
-      batch_interpreter = g_getenv ("GIMP_BATCH_INTERPRETER");
-
-      if (! batch_interpreter)
-        {
-          batch_interpreter = BATCH_DEFAULT_EVAL_PROC;
-
-          if (gimp->be_verbose)
-            g_printerr (_("No batch interpreter specified, using the default "
-                          "'%s'.\n"), batch_interpreter);
-        }
-    }
+  batch_interpreter = gimp_batch_get_interpreter (gimp, batch_interpreter);
 
   /*  script-fu text console, hardcoded for backward compatibility  */
 
@@ -116,6 +192,90 @@ gimp_batch_run (Gimp         *gimp,
   g_signal_handler_disconnect (gimp, exit_id);
 }
 
+/**
+ * gimp_batch_run_queue:
+ * @gimp:              a #Gimp
+ * @batch_interpreter: the procedure to run the commands with, or %NULL
+ * @n_workers:         how many jobs may run at the same time
+ * @job_memory:        the memory a job's images may use, or 0
+ *
+ * Reads batch commands from stdin, one per line, and runs each of them
+ * as an independent job.  Up to @n_workers jobs run at once, as
+ * separate interpreter processes, each with its own PDB context.
+ * Images created by a job are deleted when it ends.  If @job_memory
+ * is not 0, a job whose images grow beyond it is killed.
+ *
+ * For each job, a JSON object is printed on a line of stdout when it
+ * ends.  GIMP quits once stdin is closed and all jobs have ended.
+ **/
+void
+gimp_batch_run_queue (Gimp        *gimp,
+                      const gchar *batch_interpreter,
+                      gint         n_workers,
+                      guint64      job_memory)
+{
+  GimpBatchQueue *queue;
+  GimpProcedure  *procedure;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  if (n_workers < 1)
+    return;
+
+  batch_interpreter = gimp_batch_get_interpreter (gimp, batch_interpreter);
+
+  procedure = gimp_pdb_lookup_procedure (gimp->pdb, batch_interpreter);
+
+  if (! procedure)
+    {
+      g_message (_("The batch interpreter '%s' is not available. "
+                   "Batch mode disabled."), batch_interpreter);
+      return;
+    }
+
+  queue = g_slice_new0 (GimpBatchQueue);
+
+  queue->gimp      = gimp;
+  queue->proc_name = g_strdup (batch_interpreter);
+  queue->procedure = procedure;
+  queue->n_workers = n_workers;
+
+  queue->memory_limit = job_memory;
+
+  g_queue_init (&queue->pending);
+
+  /*  quit cleanly if a job calls gimp-quit  */
+  g_signal_connect_after (gimp, "exit",
+                          G_CALLBACK (gimp_batch_exit_after_callback),
+                          NULL);
+
+  g_signal_connect (gimp->images, "add",
+                    G_CALLBACK (gimp_batch_queue_image_add),
+                    queue);
+  g_signal_connect (gimp->images, "remove",
+                    G_CALLBACK (gimp_batch_queue_image_remove),
+                    queue);
+
+#ifdef G_OS_WIN32
+  queue->input = g_io_channel_win32_new_fd (_fileno (stdin));
+#else
+  queue->input = g_io_channel_unix_new (0);
+#endif
+
+  g_io_channel_set_encoding (queue->input, NULL, NULL);
+
+  queue->input_id = g_io_add_watch (queue->input,
+                                    G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                    (GIOFunc) gimp_batch_queue_read,
+                                    queue);
+
+  if (queue->memory_limit > 0)
+    queue->memory_id =
+      g_timeout_add (BATCH_QUEUE_MEMORY_INTERVAL,
+                     (GSourceFunc) gimp_batch_queue_check_memory,
+                     queue);
+}
+
 
 /*
  * The purpose of this handler is to exit GIMP cleanly when the batch
@@ -134,17 +294,34 @@ gimp_batch_exit_after_callback (Gimp *gimp)
   exit (EXIT_SUCCESS);
 }
 
-static void
-gimp_batch_run_cmd (Gimp          *gimp,
-                    const gchar   *proc_name,
-                    GimpProcedure *procedure,
-                    GimpRunMode    run_mode,
-                    const gchar   *cmd)
+static const gchar *
+gimp_batch_get_interpreter (Gimp        *gimp,
+                            const gchar *batch_interpreter)
+{
+  if (! batch_interpreter)
+    {
+      batch_interpreter = g_getenv ("GIMP_BATCH_INTERPRETER");
+
+      if (! batch_interpreter)
+        {
+          batch_interpreter = BATCH_DEFAULT_EVAL_PROC;
+
+          if (gimp->be_verbose)
+            g_printerr (_("No batch interpreter specified, using the default "
+                          "'%s'.\n"), batch_interpreter);
+        }
+    }
+
+  return batch_interpreter;
+}
+
+static GimpValueArray *
+gimp_batch_get_cmd_args (GimpProcedure *procedure,
+                         GimpRunMode    run_mode,
+                         const gchar   *cmd)
 {
   GimpValueArray *args;
-  GimpValueArray *return_vals;
-  GError         *error = NULL;
-  gint            i     = 0;
+  gint            i = 0;
 
   args = gimp_procedure_get_arguments (procedure);
 
@@ -156,6 +333,22 @@ gimp_batch_run_cmd (Gimp          *gimp,
       GIMP_IS_PARAM_SPEC_STRING (procedure->args[i]))
     g_value_set_static_string (gimp_value_array_index (args, i++), cmd);
 
+  return args;
+}
+
+static void
+gimp_batch_run_cmd (Gimp          *gimp,
+                    const gchar   *proc_name,
+                    GimpProcedure *procedure,
+                    GimpRunMode    run_mode,
+                    const gchar   *cmd)
+{
+  GimpValueArray *args;
+  GimpValueArray *return_vals;
+  GError         *error = NULL;
+
+  args = gimp_batch_get_cmd_args (procedure, run_mode, cmd);
+
   return_vals =
     gimp_pdb_execute_procedure_by_name_args (gimp->pdb,
                                              gimp_get_user_context (gimp),
@@ -201,3 +394,380 @@ gimp_batch_run_cmd (Gimp          *gimp,
 
   return;
 }
+
+
+/*  the batch queue  */
+
+static gboolean
+gimp_batch_queue_read (GIOChannel     *channel,
+                       GIOCondition    condition,
+                       GimpBatchQueue *queue)
+{
+  gchar     *line = NULL;
+  GIOStatus  status;
+
+  status = g_io_channel_read_line (channel, &line, NULL, NULL, NULL);
+
+  if (status == G_IO_STATUS_AGAIN)
+    return TRUE;
+
+  if (line)
+    {
+      g_strstrip (line);
+
+      if (*line)
+        {
+          GimpBatchJob *job = g_slice_new0 (GimpBatchJob);
+
+          job->queue   = queue;
+          job->id      = ++queue->n_jobs;
+          job->command = line;
+          job->status  = NULL;
+
+          g_queue_push_tail (&queue->pending, job);
+
+          gimp_batch_queue_dispatch (queue);
+        }
+      else
+        {
+          g_free (line);
+        }
+    }
+
+  if (status == G_IO_STATUS_NORMAL)
+    return TRUE;
+
+  /*  end of input, or an error reading it  */
+  queue->input_done = TRUE;
+  queue->input_id   = 0;
+
+  gimp_batch_queue_dispatch (queue);
+
+  return FALSE;
+}
+
+static void
+gimp_batch_queue_dispatch (GimpBatchQueue *queue)
+{
+  while (g_list_length (queue->running) < queue->n_workers &&
+         ! g_queue_is_empty (&queue->pending))
+    {
+      gimp_batch_queue_start_job (queue, g_queue_pop_head (&queue->pending));
+    }
+
+  if (queue->input_done && ! queue->running &&
+      g_queue_is_empty (&queue->pending))
+    {
+      if (queue->gimp->be_verbose)
+        g_print ("EXIT: %s\n", G_STRFUNC);
+
+      gimp_exit (queue->gimp, TRUE);
+    }
+}
+
+static gboolean
+gimp_batch_queue_dispatch_idle (GimpBatchQueue *queue)
+{
+  queue->dispatch_id = 0;
+
+  gimp_batch_queue_dispatch (queue);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_batch_queue_start_job (GimpBatchQueue *queue,
+                            GimpBatchJob   *job)
+{
+  Gimp           *gimp = queue->gimp;
+  GimpValueArray *args;
+  GimpValueArray *return_vals;
+  GError         *error = NULL;
+
+  job->context    = gimp_pdb_context_new (gimp, gimp_get_user_context (gimp),
+                                          TRUE);
+  job->start_time = g_get_monotonic_time ();
+
+  queue->running = g_list_append (queue->running, job);
+
+  args = gimp_batch_get_cmd_args (queue->procedure,
+                                  GIMP_RUN_NONINTERACTIVE, job->command);
+
+  if (GIMP_IS_PLUG_IN_PROCEDURE (queue->procedure) &&
+      queue->procedure->proc_type == GIMP_PLUGIN)
+    {
+      GimpPlugIn *plug_in;
+
+      /*  start the interpreter without waiting for it, the job ends
+       *  when its plug-in does
+       */
+      plug_in =
+        gimp_plug_in_manager_call_run_async (gimp->plug_in_manager,
+                                             job->context, NULL,
+                                             GIMP_PLUG_IN_PROCEDURE (queue->procedure),
+                                             args,
+                                             (GimpPlugInReturnFunc) gimp_batch_queue_job_return,
+                                             job);
+
+      /*  if it failed to start, the job has already ended  */
+      if (plug_in)
+        job->plug_in = plug_in;
+    }
+  else
+    {
+      /*  other interpreters run in the core, one job at a time  */
+      return_vals =
+        gimp_pdb_execute_procedure_by_name_args (gimp->pdb, job->context,
+                                                 NULL, &error,
+                                                 queue->proc_name, args);
+
+      gimp_batch_queue_finish_job (queue, job, return_vals, error);
+
+      gimp_value_array_unref (return_vals);
+      g_clear_error (&error);
+    }
+
+  gimp_value_array_unref (args);
+}
+
+static void
+gimp_batch_json_append_string (GString     *json,
+                               const gchar *str)
+{
+  g_string_append_c (json, '"');
+
+  for (; *str; str++)
+    {
+      switch (*str)
+        {
+        case '"':
+          g_string_append (json, "\\\"");
+          break;
+
+        case '\\':
+          g_string_append (json, "\\\\");
+          break;
+
+        default:
+          if ((guchar) *str < 0x20)
+            g_string_append_printf (json, "\\u%04x", (guchar) *str);
+          else
+            g_string_append_c (json, *str);
+          break;
+        }
+    }
+
+  g_string_append_c (json, '"');
+}
+
+static void
+gimp_batch_queue_finish_job (GimpBatchQueue *queue,
+                             GimpBatchJob   *job,
+                             GimpValueArray *return_vals,
+                             const GError   *error)
+{
+  GString     *json;
+  const gchar *status  = job->status;
+  const gchar *message = NULL;
+  gdouble      seconds;
+  gint         n_images;
+  gchar        buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  seconds = ((g_get_monotonic_time () - job->start_time) /
+             (gdouble) G_TIME_SPAN_SECOND);
+
+  job->peak_memory = MAX (job->peak_memory, gimp_batch_job_get_memsize (job));
+
+  if (! status && return_vals)
+    {
+      switch (g_value_get_enum (gimp_value_array_index (return_vals, 0)))
+        {
+        case GIMP_PDB_EXECUTION_ERROR:
+          status = "execution-error";
+          break;
+
+        case GIMP_PDB_CALLING_ERROR:
+          status = "calling-error";
+          break;
+
+        case GIMP_PDB_PASS_THROUGH:
+        case GIMP_PDB_CANCEL:
+          status = "cancelled";
+          break;
+
+        case GIMP_PDB_SUCCESS:
+          status = "success";
+          break;
+        }
+
+      if (gimp_value_array_length (return_vals) > 1 &&
+          G_VALUE_HOLDS_STRING (gimp_value_array_index (return_vals, 1)))
+        {
+          message = g_value_get_string (gimp_value_array_index (return_vals,
+                                                                1));
+        }
+    }
+
+  if (! status)
+    status = "aborted";
+
+  if (! message && error)
+    message = error->message;
+
+  /*  images are private to the job, get rid of what it left  */
+  n_images = g_list_length (job->images);
+
+  while (job->images)
+    {
+      GimpImage *image = job->images->data;
+
+      job->images = g_list_remove (job->images, image);
+
+      if (gimp_image_get_display_count (image) == 0)
+        g_object_unref (image);
+    }
+
+  json = g_string_new (NULL);
+
+  g_string_append_printf (json, "{ \"job\": %d, \"command\": ", job->id);
+  gimp_batch_json_append_string (json, job->command);
+  g_string_append (json, ", \"status\": ");
+  gimp_batch_json_append_string (json, status);
+
+  if (message)
+    {
+      g_string_append (json, ", \"message\": ");
+      gimp_batch_json_append_string (json, message);
+    }
+
+  g_string_append_printf (json,
+                          ", \"seconds\": %s, \"images\": %d, "
+                          "\"peak-memory\": %" G_GINT64_FORMAT " }",
+                          g_ascii_formatd (buf, sizeof (buf), "%.4f", seconds),
+                          n_images, job->peak_memory);
+
+  g_print ("%s\n", json->str);
+
+  g_string_free (json, TRUE);
+
+  queue->running = g_list_remove (queue->running, job);
+
+  g_object_unref (job->context);
+  g_free (job->command);
+  g_slice_free (GimpBatchJob, job);
+
+  /*  this may run while the job's plug-in is being closed, start the
+   *  next jobs once that is done
+   */
+  if (! queue->dispatch_id)
+    queue->dispatch_id =
+      g_idle_add ((GSourceFunc) gimp_batch_queue_dispatch_idle, queue);
+}
+
+/*  finds the job a context belongs to: the contexts of procedures
+ *  called by a job's interpreter descend from the job's context
+ */
+static GimpBatchJob *
+gimp_batch_queue_find_job (GimpBatchQueue *queue,
+                           GimpContext    *context)
+{
+  for (; context; context = gimp_context_get_parent (context))
+    {
+      GList *list;
+
+      for (list = queue->running; list; list = g_list_next (list))
+        {
+          GimpBatchJob *job = list->data;
+
+          if (job->context == context)
+            return job;
+        }
+    }
+
+  return NULL;
+}
+
+static gint64
+gimp_batch_job_get_memsize (GimpBatchJob *job)
+{
+  GList  *list;
+  gint64  memsize = 0;
+
+  for (list = job->images; list; list = g_list_next (list))
+    memsize += gimp_object_get_memsize (list->data, NULL);
+
+  return memsize;
+}
+
+static gboolean
+gimp_batch_queue_check_memory (GimpBatchQueue *queue)
+{
+  GList *over_limit = NULL;
+  GList *list;
+
+  for (list = queue->running; list; list = g_list_next (list))
+    {
+      GimpBatchJob *job     = list->data;
+      gint64        memsize = gimp_batch_job_get_memsize (job);
+
+      job->peak_memory = MAX (job->peak_memory, memsize);
+
+      if ((guint64) memsize > queue->memory_limit && job->plug_in)
+        over_limit = g_list_prepend (over_limit, job);
+    }
+
+  /*  closing a plug-in finishes its job, and changes the running list  */
+  for (list = over_limit; list; list = g_list_next (list))
+    {
+      GimpBatchJob *job = list->data;
+
+      job->status = "memory-limit";
+
+      gimp_plug_in_close (job->plug_in, TRUE);
+    }
+
+  g_list_free (over_limit);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gimp_batch_queue_image_add (GimpContainer  *images,
+                            GimpImage      *image,
+                            GimpBatchQueue *queue)
+{
+  GimpPlugIn   *plug_in = queue->gimp->plug_in_manager->current_plug_in;
+  GimpBatchJob *job;
+
+  if (! plug_in)
+    return;
+
+  job = gimp_batch_queue_find_job (queue,
+                                   gimp_plug_in_get_proc_frame (plug_in)->main_context);
+
+  if (job)
+    job->images = g_list_prepend (job->images, image);
+}
+
+static void
+gimp_batch_queue_image_remove (GimpContainer  *images,
+                               GimpImage      *image,
+                               GimpBatchQueue *queue)
+{
+  GList *list;
+
+  for (list = queue->running; list; list = g_list_next (list))
+    {
+      GimpBatchJob *job = list->data;
+
+      job->images = g_list_remove (job->images, image);
+    }
+}
+
+static void
+gimp_batch_queue_job_return (GimpPlugIn     *plug_in,
+                             GimpValueArray *return_vals,
+                             GimpBatchJob   *job)
+{
+  gimp_batch_queue_finish_job (job->queue, job, return_vals, NULL);
+}
@@ -19,9 +19,13 @@
 #define __GIMP_BATCH_H__
 
 
-void   gimp_batch_run (Gimp         *gimp,
-                       const gchar  *batch_interpreter,
-                       const gchar **batch_commands);
+void   gimp_batch_run       (Gimp         *gimp,
+                             const gchar  *batch_interpreter,
+                             const gchar **batch_commands);
+void   gimp_batch_run_queue (Gimp         *gimp,
+                             const gchar  *batch_interpreter,
+                             gint          n_workers,
+                             guint64       job_memory);
 
 
 #endif /* __GIMP_BATCH_H__ */
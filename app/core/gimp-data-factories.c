@@ -32,6 +32,7 @@
 #include "gimp-gradients.h"
 #include "gimp-memsize.h"
 #include "gimp-palettes.h"
+#include "gimp-startup.h"
 #include "gimpcontainer.h"
 #include "gimpbrush-load.h"
 #include "gimpbrush.h"
@@ -62,44 +63,44 @@ gimp_data_factories_init (Gimp *gimp)
 {
   static const GimpDataFactoryLoaderEntry brush_loader_entries[] =
   {
-    { gimp_brush_load,           GIMP_BRUSH_FILE_EXTENSION,           FALSE },
-    { gimp_brush_load,           GIMP_BRUSH_PIXMAP_FILE_EXTENSION,    FALSE },
-    { gimp_brush_load_abr,       GIMP_BRUSH_PS_FILE_EXTENSION,        FALSE },
-    { gimp_brush_load_abr,       GIMP_BRUSH_PSP_FILE_EXTENSION,       FALSE },
-    { gimp_brush_generated_load, GIMP_BRUSH_GENERATED_FILE_EXTENSION, TRUE  },
-    { gimp_brush_pipe_load,      GIMP_BRUSH_PIPE_FILE_EXTENSION,      FALSE }
+    { gimp_brush_load,           GIMP_BRUSH_FILE_EXTENSION,           FALSE, TRUE  },
+    { gimp_brush_load,           GIMP_BRUSH_PIXMAP_FILE_EXTENSION,    FALSE, TRUE  },
+    { gimp_brush_load_abr,       GIMP_BRUSH_PS_FILE_EXTENSION,        FALSE, TRUE  },
+    { gimp_brush_load_abr,       GIMP_BRUSH_PSP_FILE_EXTENSION,       FALSE, TRUE  },
+    { gimp_brush_generated_load, GIMP_BRUSH_GENERATED_FILE_EXTENSION, TRUE,  TRUE  },
+    { gimp_brush_pipe_load,      GIMP_BRUSH_PIPE_FILE_EXTENSION,      FALSE, TRUE  }
   };
 
   static const GimpDataFactoryLoaderEntry dynamics_loader_entries[] =
   {
-    { gimp_dynamics_load,        GIMP_DYNAMICS_FILE_EXTENSION,        TRUE  }
+    { gimp_dynamics_load,        GIMP_DYNAMICS_FILE_EXTENSION,        TRUE,  FALSE }
   };
 
   static const GimpDataFactoryLoaderEntry mybrush_loader_entries[] =
   {
-    { gimp_mybrush_load,         GIMP_MYBRUSH_FILE_EXTENSION,         FALSE }
+    { gimp_mybrush_load,         GIMP_MYBRUSH_FILE_EXTENSION,         FALSE, TRUE  }
   };
 
   static const GimpDataFactoryLoaderEntry pattern_loader_entries[] =
   {
-    { gimp_pattern_load,         GIMP_PATTERN_FILE_EXTENSION,         FALSE },
-    { gimp_pattern_load_pixbuf,  NULL /* fallback loader */,          FALSE }
+    { gimp_pattern_load,         GIMP_PATTERN_FILE_EXTENSION,         FALSE, TRUE  },
+    { gimp_pattern_load_pixbuf,  NULL /* fallback loader */,          FALSE, TRUE  }
   };
 
   static const GimpDataFactoryLoaderEntry gradient_loader_entries[] =
   {
-    { gimp_gradient_load,        GIMP_GRADIENT_FILE_EXTENSION,        TRUE  },
-    { gimp_gradient_load_svg,    GIMP_GRADIENT_SVG_FILE_EXTENSION,    FALSE }
+    { gimp_gradient_load,        GIMP_GRADIENT_FILE_EXTENSION,        TRUE,  TRUE  },
+    { gimp_gradient_load_svg,    GIMP_GRADIENT_SVG_FILE_EXTENSION,    FALSE, TRUE  }
   };
 
   static const GimpDataFactoryLoaderEntry palette_loader_entries[] =
   {
-    { gimp_palette_load,         GIMP_PALETTE_FILE_EXTENSION,         TRUE  }
+    { gimp_palette_load,         GIMP_PALETTE_FILE_EXTENSION,         TRUE,  TRUE  }
   };
 
   static const GimpDataFactoryLoaderEntry tool_preset_loader_entries[] =
   {
-    { gimp_tool_preset_load,     GIMP_TOOL_PRESET_FILE_EXTENSION,     TRUE  }
+    { gimp_tool_preset_load,     GIMP_TOOL_PRESET_FILE_EXTENSION,     TRUE,  FALSE }
   };
 
   g_return_if_fail (GIMP_IS_GIMP (gimp));
@@ -315,48 +316,65 @@ gimp_data_factories_load (Gimp               *gimp,
 
   /*  initialize the list of gimp brushes    */
   status_callback (NULL, _("Brushes"), 0.1);
+  gimp_startup_begin ("brushes");
   gimp_data_factory_data_init (gimp->brush_factory, gimp->user_context,
                                gimp->no_data);
+  gimp_startup_end ();
 
   /*  initialize the list of gimp dynamics   */
   status_callback (NULL, _("Dynamics"), 0.15);
+  gimp_startup_begin ("dynamics");
   gimp_data_factory_data_init (gimp->dynamics_factory, gimp->user_context,
                                gimp->no_data);
+  gimp_startup_end ();
 
   /*  initialize the list of mypaint brushes    */
   status_callback (NULL, _("MyPaint Brushes"), 0.2);
+  gimp_startup_begin ("mypaint brushes");
   gimp_data_factory_data_init (gimp->mybrush_factory, gimp->user_context,
                                gimp->no_data);
+  gimp_startup_end ();
 
   /*  initialize the list of gimp patterns   */
   status_callback (NULL, _("Patterns"), 0.3);
+  gimp_startup_begin ("patterns");
   gimp_data_factory_data_init (gimp->pattern_factory, gimp->user_context,
                                gimp->no_data);
+  gimp_startup_end ();
 
   /*  initialize the list of gimp palettes   */
   status_callback (NULL, _("Palettes"), 0.4);
+  gimp_startup_begin ("palettes");
   gimp_data_factory_data_init (gimp->palette_factory, gimp->user_context,
                                gimp->no_data);
+  gimp_startup_end ();
 
   /*  initialize the list of gimp gradients  */
   status_callback (NULL, _("Gradients"), 0.5);
+  gimp_startup_begin ("gradients");
   gimp_data_factory_data_init (gimp->gradient_factory, gimp->user_context,
                                gimp->no_data);
+  gimp_startup_end ();
 
   /*  initialize the color history   */
   status_callback (NULL, _("Color History"), 0.55);
+  gimp_startup_begin ("color history");
   gimp_palettes_load (gimp);
+  gimp_startup_end ();
 
   /*  initialize the list of gimp tool presets if we have a GUI  */
   if (! gimp->no_interface)
     {
       status_callback (NULL, _("Tool Presets"), 0.6);
+      gimp_startup_begin ("tool presets");
       gimp_data_factory_data_init (gimp->tool_preset_factory, gimp->user_context,
                                    gimp->no_data);
+      gimp_startup_end ();
     }
 
   /* update tag cache */
   status_callback (NULL, _("Updating tag cache"), 0.65);
+  gimp_startup_begin ("tag cache");
   gimp_tag_cache_load (gimp->tag_cache);
   gimp_tag_cache_add_container (gimp->tag_cache,
                                 gimp_data_factory_get_container (gimp->brush_factory));
@@ -372,6 +390,7 @@ gimp_data_factories_load (Gimp               *gimp,
                                 gimp_data_factory_get_container (gimp->palette_factory));
   gimp_tag_cache_add_container (gimp->tag_cache,
                                 gimp_data_factory_get_container (gimp->tool_preset_factory));
+  gimp_startup_end ();
 }
 
 void
@@ -0,0 +1,132 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-latency.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-object.h>
+
+#include "core-types.h"
+
+#include "gimp-latency.h"
+
+
+/*  the durations of the last N_SAMPLES occurrences of each timed
+ *  operation are kept, so that the dashboard can show how long they
+ *  currently take, rather than an average over the whole session
+ */
+#define N_SAMPLES 128
+
+
+typedef struct
+{
+  gint64 samples[N_SAMPLES];
+  gint   n_samples;
+  gint   next;
+} GimpLatencyData;
+
+
+/*  local function prototypes  */
+
+static gint   gimp_latency_compare (const gint64 *a,
+                                    const gint64 *b);
+
+
+/*  local variables  */
+
+static GMutex          latency_mutex;
+static GimpLatencyData latency_data[GIMP_N_LATENCIES];
+
+
+/*  public functions  */
+
+/*  records that an occurrence of @latency took @duration microseconds  */
+void
+gimp_latency_record (GimpLatency latency,
+                     gint64      duration)
+{
+  GimpLatencyData *data;
+
+  g_return_if_fail (latency >= 0 && latency < GIMP_N_LATENCIES);
+
+  data = &latency_data[latency];
+
+  g_mutex_lock (&latency_mutex);
+
+  data->samples[data->next] = duration;
+  data->next                = (data->next + 1) % N_SAMPLES;
+  data->n_samples           = MIN (data->n_samples + 1, N_SAMPLES);
+
+  g_mutex_unlock (&latency_mutex);
+}
+
+/*  returns the median, the 95th percentile and the maximum of the
+ *  recent durations of @latency, in seconds, or FALSE if it was never
+ *  recorded
+ */
+gboolean
+gimp_latency_get_stats (GimpLatency  latency,
+                        gdouble     *median,
+                        gdouble     *percentile_95,
+                        gdouble     *maximum)
+{
+  gint64 samples[N_SAMPLES];
+  gint   n_samples;
+
+  g_return_val_if_fail (latency >= 0 && latency < GIMP_N_LATENCIES, FALSE);
+
+  g_mutex_lock (&latency_mutex);
+
+  n_samples = latency_data[latency].n_samples;
+
+  memcpy (samples, latency_data[latency].samples,
+          n_samples * sizeof (gint64));
+
+  g_mutex_unlock (&latency_mutex);
+
+  if (n_samples == 0)
+    return FALSE;
+
+  qsort (samples, n_samples, sizeof (gint64),
+         (GCompareFunc) gimp_latency_compare);
+
+  if (median)
+    *median = samples[n_samples / 2] / (gdouble) G_TIME_SPAN_SECOND;
+
+  if (percentile_95)
+    *percentile_95 = samples[(n_samples * 95) / 100] /
+                     (gdouble) G_TIME_SPAN_SECOND;
+
+  if (maximum)
+    *maximum = samples[n_samples - 1] / (gdouble) G_TIME_SPAN_SECOND;
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static gint
+gimp_latency_compare (const gint64 *a,
+                      const gint64 *b)
+{
+  return (*a > *b) - (*a < *b);
+}
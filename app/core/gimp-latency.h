@@ -0,0 +1,46 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-latency.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_LATENCY_H__
+#define __GIMP_LATENCY_H__
+
+
+/*  what is being timed, see gimp_latency_record()  */
+typedef enum
+{
+  GIMP_LATENCY_DISPLAY_FRAME, /*  drawing the image on a canvas  */
+  GIMP_LATENCY_PAINT_DAB,     /*  painting one dab or motion     */
+  GIMP_LATENCY_PAINT_INPUT,   /*  receiving a painting event to
+                               *  drawing its result on a canvas
+                               */
+
+  GIMP_N_LATENCIES
+} GimpLatency;
+
+
+void       gimp_latency_record          (GimpLatency  latency,
+                                         gint64       duration);
+
+gboolean   gimp_latency_get_stats       (GimpLatency  latency,
+                                         gdouble     *median,
+                                         gdouble     *percentile_95,
+                                         gdouble     *maximum);
+
+
+#endif /* __GIMP_LATENCY_H__ */
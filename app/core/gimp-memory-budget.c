@@ -0,0 +1,219 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-memory-budget.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-memory-budget.h"
+#include "gimptempbuf.h"
+
+
+/* large operations (scaling, precision conversion, merging, duplicating
+ * and committing filters) reserve the memory they are estimated to need
+ * before they start, against the "memory-budget" preference.
+ *
+ * when a reservation doesn't fit into what is left of the budget, the
+ * caches we can drop are released first.  if it still doesn't fit, the
+ * caller waits until other threads' reservations are released, for at
+ * most GIMP_MEMORY_BUDGET_MAX_WAIT.  after that, or when nothing else is
+ * reserved, the operation proceeds anyway and the tile cache swaps, so a
+ * reservation never fails.
+ *
+ * a thread which already holds a reservation never waits, so nested
+ * operations can't deadlock.
+ */
+
+
+#define GIMP_MEMORY_BUDGET_MAX_WAIT (10 * G_TIME_SPAN_SECOND)
+
+
+/*  local function prototypes  */
+
+static void   gimp_memory_budget_notify_budget   (GimpGeglConfig *config);
+static void   gimp_memory_budget_release_caches  (void);
+
+
+/*  local variables  */
+
+static GMutex   gimp_memory_budget_mutex;
+static GCond    gimp_memory_budget_cond;
+static guint64  gimp_memory_budget_limit     = 0;
+static guint64  gimp_memory_budget_reserved  = 0;
+static gint     gimp_memory_budget_n_waiting = 0;
+static GPrivate gimp_memory_budget_n_held;
+
+
+/*  public functions  */
+
+void
+gimp_memory_budget_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  g_signal_connect (config, "notify::memory-budget",
+                    G_CALLBACK (gimp_memory_budget_notify_budget),
+                    NULL);
+
+  gimp_memory_budget_notify_budget (config);
+}
+
+void
+gimp_memory_budget_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_memory_budget_notify_budget,
+                                        NULL);
+
+  g_mutex_lock (&gimp_memory_budget_mutex);
+
+  gimp_memory_budget_limit = 0;
+
+  g_cond_broadcast (&gimp_memory_budget_cond);
+
+  g_mutex_unlock (&gimp_memory_budget_mutex);
+}
+
+/*  reserves 'size' bytes of the budget, waiting for other reservations
+ *  if needed, see above.  returns whether the reservation fits into the
+ *  budget.  each call must be paired with gimp_memory_budget_release()
+ *  of the same size.
+ */
+gboolean
+gimp_memory_budget_reserve (gint64 size)
+{
+  gint     n_held;
+  gboolean fits;
+
+  size   = MAX (size, 0);
+  n_held = GPOINTER_TO_INT (g_private_get (&gimp_memory_budget_n_held));
+
+  g_mutex_lock (&gimp_memory_budget_mutex);
+
+  fits = (gimp_memory_budget_limit == 0 ||
+          gimp_memory_budget_reserved + size <= gimp_memory_budget_limit);
+
+  if (! fits)
+    {
+      gint64 end_time;
+
+      g_mutex_unlock (&gimp_memory_budget_mutex);
+
+      gimp_memory_budget_release_caches ();
+
+      g_mutex_lock (&gimp_memory_budget_mutex);
+
+      end_time = g_get_monotonic_time () + GIMP_MEMORY_BUDGET_MAX_WAIT;
+
+      gimp_memory_budget_n_waiting++;
+
+      while (n_held == 0                     &&
+             gimp_memory_budget_reserved > 0 &&
+             gimp_memory_budget_limit    > 0 &&
+             gimp_memory_budget_reserved + size > gimp_memory_budget_limit)
+        {
+          if (! g_cond_wait_until (&gimp_memory_budget_cond,
+                                   &gimp_memory_budget_mutex,
+                                   end_time))
+            break;
+        }
+
+      gimp_memory_budget_n_waiting--;
+
+      fits = (gimp_memory_budget_limit == 0 ||
+              gimp_memory_budget_reserved + size <= gimp_memory_budget_limit);
+    }
+
+  gimp_memory_budget_reserved += size;
+
+  g_mutex_unlock (&gimp_memory_budget_mutex);
+
+  g_private_set (&gimp_memory_budget_n_held, GINT_TO_POINTER (n_held + 1));
+
+  return fits;
+}
+
+void
+gimp_memory_budget_release (gint64 size)
+{
+  gint n_held;
+
+  size   = MAX (size, 0);
+  n_held = GPOINTER_TO_INT (g_private_get (&gimp_memory_budget_n_held));
+
+  g_return_if_fail (n_held > 0);
+
+  g_private_set (&gimp_memory_budget_n_held, GINT_TO_POINTER (n_held - 1));
+
+  g_mutex_lock (&gimp_memory_budget_mutex);
+
+  gimp_memory_budget_reserved -= MIN ((guint64) size,
+                                      gimp_memory_budget_reserved);
+
+  g_cond_broadcast (&gimp_memory_budget_cond);
+
+  g_mutex_unlock (&gimp_memory_budget_mutex);
+}
+
+void
+gimp_memory_budget_get_stats (guint64 *limit,
+                              guint64 *reserved,
+                              gint    *n_waiting)
+{
+  g_mutex_lock (&gimp_memory_budget_mutex);
+
+  if (limit)     *limit     = gimp_memory_budget_limit;
+  if (reserved)  *reserved  = gimp_memory_budget_reserved;
+  if (n_waiting) *n_waiting = gimp_memory_budget_n_waiting;
+
+  g_mutex_unlock (&gimp_memory_budget_mutex);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_memory_budget_notify_budget (GimpGeglConfig *config)
+{
+  g_mutex_lock (&gimp_memory_budget_mutex);
+
+  gimp_memory_budget_limit = config->memory_budget;
+
+  g_cond_broadcast (&gimp_memory_budget_cond);
+
+  g_mutex_unlock (&gimp_memory_budget_mutex);
+}
+
+static void
+gimp_memory_budget_release_caches (void)
+{
+  gimp_temp_buf_release_pool ();
+}
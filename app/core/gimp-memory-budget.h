@@ -0,0 +1,35 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-memory-budget.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_MEMORY_BUDGET_H__
+#define __GIMP_MEMORY_BUDGET_H__
+
+
+void       gimp_memory_budget_init         (Gimp    *gimp);
+void       gimp_memory_budget_exit         (Gimp    *gimp);
+
+gboolean   gimp_memory_budget_reserve      (gint64   size);
+void       gimp_memory_budget_release      (gint64   size);
+
+void       gimp_memory_budget_get_stats    (guint64 *limit,
+                                            guint64 *reserved,
+                                            gint    *n_waiting);
+
+
+#endif /* __GIMP_MEMORY_BUDGET_H__ */
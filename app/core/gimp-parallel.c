@@ -0,0 +1,504 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-parallel.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  /* for sched_setaffinity() */
+
+#include "config.h"
+
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
+
+
+/* a small worker pool, sized by the "num-processors" preference, used to
+ * split work that is otherwise done on a single core.  the distribute
+ * functions are synchronous: they run one part of the work on the calling
+ * thread, hand the rest to the workers, and return once all parts are
+ * done.  calls made from a worker thread run serially, so nested
+ * distribution is safe.
+ *
+ * the projection and filters can be given fewer threads than the rest,
+ * and the whole process can be bound to a set of processors, so that
+ * several instances can share a machine without oversubscribing it.
+ */
+
+
+#define GIMP_PARALLEL_MAX_THREADS 64
+
+
+typedef struct
+{
+  GimpParallelDistributeFunc  func;
+  gint                        n;
+  gpointer                    user_data;
+
+  GMutex                      mutex;
+  GCond                       cond;
+  gint                        remaining;
+} GimpParallelJob;
+
+typedef struct
+{
+  GimpParallelJob *job;
+  gint             i;
+} GimpParallelTask;
+
+typedef struct
+{
+  GimpParallelDistributeRangeFunc func;
+  gsize                           size;
+  gpointer                        user_data;
+} GimpParallelRangeData;
+
+typedef struct
+{
+  GimpParallelDistributeAreaFunc  func;
+  const GeglRectangle            *area;
+  gboolean                        vertical;
+  gpointer                        user_data;
+} GimpParallelAreaData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_parallel_notify_num_processors (GimpGeglConfig *config);
+static void   gimp_parallel_set_n_threads         (gint            n_threads);
+static void   gimp_parallel_set_affinity          (GimpGeglConfig *config);
+
+static void   gimp_parallel_worker                (GimpParallelTask *task,
+                                                   gpointer          user_data);
+
+static void   gimp_parallel_range_func            (gint              i,
+                                                   gint              n,
+                                                   GimpParallelRangeData *data);
+static void   gimp_parallel_area_func             (gint              i,
+                                                   gint              n,
+                                                   GimpParallelAreaData  *data);
+
+
+/*  local variables  */
+
+static GThreadPool *gimp_parallel_pool      = NULL;
+static gint         gimp_parallel_n_threads = 1;
+static GPrivate     gimp_parallel_is_worker;
+
+
+/*  public functions  */
+
+void
+gimp_parallel_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  gimp_parallel_set_affinity (config);
+
+  g_signal_connect (config, "notify::num-processors",
+                    G_CALLBACK (gimp_parallel_notify_num_processors),
+                    NULL);
+
+  gimp_parallel_notify_num_processors (config);
+}
+
+void
+gimp_parallel_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_parallel_notify_num_processors,
+                                        NULL);
+
+  gimp_parallel_set_n_threads (1);
+}
+
+gint
+gimp_parallel_get_n_threads (void)
+{
+  return gimp_parallel_n_threads;
+}
+
+void
+gimp_parallel_distribute (gint                       max_n,
+                          GimpParallelDistributeFunc func,
+                          gpointer                   user_data)
+{
+  GimpParallelJob   job;
+  GimpParallelTask *tasks;
+  gint              n;
+  gint              i;
+
+  g_return_if_fail (func != NULL);
+
+  n = gimp_parallel_n_threads;
+
+  if (max_n >= 0)
+    n = MIN (n, max_n);
+
+  if (n == 0)
+    return;
+
+  if (n == 1                  ||
+      ! gimp_parallel_pool    ||
+      g_private_get (&gimp_parallel_is_worker))
+    {
+      func (0, 1, user_data);
+
+      return;
+    }
+
+  job.func      = func;
+  job.n         = n;
+  job.user_data = user_data;
+  job.remaining = n - 1;
+
+  g_mutex_init (&job.mutex);
+  g_cond_init (&job.cond);
+
+  tasks = g_newa (GimpParallelTask, n - 1);
+
+  for (i = 1; i < n; i++)
+    {
+      tasks[i - 1].job = &job;
+      tasks[i - 1].i   = i;
+
+      g_thread_pool_push (gimp_parallel_pool, &tasks[i - 1], NULL);
+    }
+
+  func (0, n, user_data);
+
+  g_mutex_lock (&job.mutex);
+
+  while (job.remaining > 0)
+    g_cond_wait (&job.cond, &job.mutex);
+
+  g_mutex_unlock (&job.mutex);
+
+  g_cond_clear (&job.cond);
+  g_mutex_clear (&job.mutex);
+}
+
+void
+gimp_parallel_distribute_range (gsize                           size,
+                                gsize                           min_sub_size,
+                                GimpParallelDistributeRangeFunc func,
+                                gpointer                        user_data)
+{
+  GimpParallelRangeData data;
+  gint                  max_n;
+
+  g_return_if_fail (func != NULL);
+
+  if (size == 0)
+    return;
+
+  if (min_sub_size > 1)
+    max_n = MIN (size / min_sub_size, GIMP_PARALLEL_MAX_THREADS);
+  else
+    max_n = MIN (size, GIMP_PARALLEL_MAX_THREADS);
+
+  max_n = MAX (max_n, 1);
+
+  data.func      = func;
+  data.size      = size;
+  data.user_data = user_data;
+
+  gimp_parallel_distribute (max_n,
+                            (GimpParallelDistributeFunc) gimp_parallel_range_func,
+                            &data);
+}
+
+void
+gimp_parallel_distribute_area (const GeglRectangle            *area,
+                               gsize                           min_sub_area,
+                               GimpParallelDistributeAreaFunc  func,
+                               gpointer                        user_data)
+{
+  GimpParallelAreaData data;
+  gsize                n_pixels;
+  gint                 max_n;
+
+  g_return_if_fail (area != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  n_pixels = (gsize) area->width * (gsize) area->height;
+
+  data.func      = func;
+  data.area      = area;
+  data.vertical  = area->height >= area->width;
+  data.user_data = user_data;
+
+  if (min_sub_area > 1)
+    max_n = MIN (n_pixels / min_sub_area, GIMP_PARALLEL_MAX_THREADS);
+  else
+    max_n = GIMP_PARALLEL_MAX_THREADS;
+
+  /* split along the longer dimension, at most one row or column apiece */
+  max_n = MIN (max_n, data.vertical ? area->height : area->width);
+  max_n = MAX (max_n, 1);
+
+  gimp_parallel_distribute (max_n,
+                            (GimpParallelDistributeFunc) gimp_parallel_area_func,
+                            &data);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_parallel_notify_num_processors (GimpGeglConfig *config)
+{
+  gimp_parallel_set_n_threads (config->num_processors);
+}
+
+static void
+gimp_parallel_set_n_threads (gint n_threads)
+{
+  n_threads = CLAMP (n_threads, 1, GIMP_PARALLEL_MAX_THREADS);
+
+  if (n_threads == gimp_parallel_n_threads &&
+      (n_threads == 1) == (gimp_parallel_pool == NULL))
+    {
+      return;
+    }
+
+  gimp_parallel_n_threads = n_threads;
+
+  if (n_threads == 1)
+    {
+      if (gimp_parallel_pool)
+        {
+          /* wait for all pending tasks, there shouldn't be any */
+          g_thread_pool_free (gimp_parallel_pool, FALSE, TRUE);
+
+          gimp_parallel_pool = NULL;
+        }
+    }
+  else if (! gimp_parallel_pool)
+    {
+      /* the calling thread does its own share of each job */
+      gimp_parallel_pool = g_thread_pool_new ((GFunc) gimp_parallel_worker,
+                                              NULL,
+                                              n_threads - 1, TRUE,
+                                              NULL);
+    }
+  else
+    {
+      g_thread_pool_set_max_threads (gimp_parallel_pool, n_threads - 1,
+                                     NULL);
+    }
+}
+
+#ifdef HAVE_SCHED_SETAFFINITY
+
+/*  parses a list like "0-7,16-23", as used by the "cpu-affinity"
+ *  preference and by the kernel's cpulist files, into 'set'
+ */
+static gboolean
+gimp_parallel_parse_cpu_list (const gchar *list,
+                              cpu_set_t   *set)
+{
+  gchar    **ranges;
+  gboolean   success;
+  gint       i;
+
+  CPU_ZERO (set);
+
+  ranges = g_strsplit (list, ",", -1);
+
+  for (i = 0; ranges[i]; i++)
+    {
+      gchar   *range = g_strstrip (ranges[i]);
+      gchar   *end;
+      guint64  first;
+      guint64  last;
+
+      if (! *range)
+        continue;
+
+      first = g_ascii_strtoull (range, &end, 10);
+
+      if (end == range)
+        break;
+
+      last = first;
+
+      if (*end == '-')
+        {
+          gchar *start = end + 1;
+
+          last = g_ascii_strtoull (start, &end, 10);
+
+          if (end == start)
+            break;
+        }
+
+      if (*end || last < first || last >= CPU_SETSIZE)
+        break;
+
+      for (; first <= last; first++)
+        CPU_SET (first, set);
+    }
+
+  success = ! ranges[i] && CPU_COUNT (set) > 0;
+
+  g_strfreev (ranges);
+
+  return success;
+}
+
+#endif /* HAVE_SCHED_SETAFFINITY */
+
+/*  binds the calling thread to the processors given by the "cpu-affinity"
+ *  and "numa-node" preferences.  this is called before any of GIMP's
+ *  threads exist, and threads and plug-in processes inherit the binding
+ *  of the thread which creates them.
+ */
+static void
+gimp_parallel_set_affinity (GimpGeglConfig *config)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  cpu_set_t set;
+  gboolean  bind = FALSE;
+
+  if (sched_getaffinity (0, sizeof (set), &set) != 0)
+    return;
+
+  if (config->cpu_affinity && *config->cpu_affinity)
+    {
+      cpu_set_t cpus;
+
+      if (gimp_parallel_parse_cpu_list (config->cpu_affinity, &cpus))
+        {
+          CPU_AND (&set, &set, &cpus);
+          bind = TRUE;
+        }
+      else
+        {
+          g_printerr ("Invalid cpu-affinity \"%s\", ignoring it.\n",
+                      config->cpu_affinity);
+        }
+    }
+
+  if (config->numa_node >= 0)
+    {
+      gchar     *filename;
+      gchar     *contents = NULL;
+      cpu_set_t  cpus;
+
+      filename = g_strdup_printf ("/sys/devices/system/node/node%d/cpulist",
+                                  config->numa_node);
+
+      if (g_file_get_contents (filename, &contents, NULL, NULL) &&
+          gimp_parallel_parse_cpu_list (contents, &cpus))
+        {
+          CPU_AND (&set, &set, &cpus);
+          bind = TRUE;
+        }
+      else
+        {
+          g_printerr ("Invalid numa-node %d, ignoring it.\n",
+                      config->numa_node);
+        }
+
+      g_free (contents);
+      g_free (filename);
+    }
+
+  if (bind)
+    {
+      if (CPU_COUNT (&set) == 0 ||
+          sched_setaffinity (0, sizeof (set), &set) != 0)
+        {
+          g_printerr ("Failed to set the CPU affinity, ignoring it.\n");
+        }
+    }
+#endif /* HAVE_SCHED_SETAFFINITY */
+}
+
+static void
+gimp_parallel_worker (GimpParallelTask *task,
+                      gpointer          user_data)
+{
+  GimpParallelJob *job = task->job;
+
+  g_private_set (&gimp_parallel_is_worker, GINT_TO_POINTER (TRUE));
+
+  job->func (task->i, job->n, job->user_data);
+
+  g_mutex_lock (&job->mutex);
+
+  if (--job->remaining == 0)
+    g_cond_signal (&job->cond);
+
+  g_mutex_unlock (&job->mutex);
+}
+
+static void
+gimp_parallel_range_func (gint                   i,
+                          gint                   n,
+                          GimpParallelRangeData *data)
+{
+  gsize offset;
+  gsize size;
+
+  offset = (2 * i       * data->size + n) / (2 * n);
+  size   = (2 * (i + 1) * data->size + n) / (2 * n) - offset;
+
+  data->func (offset, size, data->user_data);
+}
+
+static void
+gimp_parallel_area_func (gint                  i,
+                         gint                  n,
+                         GimpParallelAreaData *data)
+{
+  GeglRectangle sub_area = *data->area;
+
+  if (data->vertical)
+    {
+      sub_area.y      = data->area->y + (2 * i * data->area->height + n) / (2 * n);
+      sub_area.height = data->area->y + (2 * (i + 1) * data->area->height + n) / (2 * n) -
+                        sub_area.y;
+    }
+  else
+    {
+      sub_area.x      = data->area->x + (2 * i * data->area->width + n) / (2 * n);
+      sub_area.width  = data->area->x + (2 * (i + 1) * data->area->width + n) / (2 * n) -
+                        sub_area.x;
+    }
+
+  data->func (&sub_area, data->user_data);
+}
@@ -0,0 +1,279 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-stack-sampler.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  Sampling of the main thread's stack, used by the dashboard's
+ *  performance log.  The sampling thread sends the main thread a
+ *  signal, whose handler stores the main thread's backtrace, and waits
+ *  for it to be stored.  This way, the main thread is sampled wherever
+ *  it is, including while it is stuck in a long operation, which is
+ *  exactly when we are interested in it.
+ *
+ *  This is only implemented where backtrace() is available; elsewhere,
+ *  gimp_stack_sampler_init() returns FALSE and the log is recorded
+ *  without stack samples.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-object.h>
+
+#if defined(G_OS_UNIX) && defined(HAVE_EXECINFO_H)
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+#include "core-types.h"
+
+#include "gimp-stack-sampler.h"
+
+
+#if defined(G_OS_UNIX) && defined(HAVE_EXECINFO_H)
+
+#define STACK_SAMPLER_SUPPORTED
+
+/*  the first frames of a sample are the signal handler and the signal
+ *  trampoline, which are skipped
+ */
+#define SKIPPED_FRAMES  2
+
+#define MAX_FRAMES      (GIMP_STACK_SAMPLER_MAX_FRAMES + SKIPPED_FRAMES)
+
+/*  how long to wait for the main thread to handle the signal, in
+ *  microseconds
+ */
+#define SAMPLE_TIMEOUT  (G_TIME_SPAN_SECOND / 20)
+
+#ifdef SIGRTMIN
+#define SAMPLE_SIGNAL   (SIGRTMIN + 2)
+#else
+#define SAMPLE_SIGNAL   SIGPROF
+#endif
+
+
+enum
+{
+  SAMPLE_IDLE,
+  SAMPLE_REQUESTED,
+  SAMPLE_WRITING,
+  SAMPLE_DONE
+};
+
+
+/*  local function prototypes  */
+
+static void   gimp_stack_sampler_signal_handler (gint signum);
+
+
+/*  local variables  */
+
+static GMutex           sampler_mutex;
+static gint             sampler_ref_count = 0;
+static gboolean         sampler_installed = FALSE;
+static pthread_t        sampler_thread;
+
+static gpointer         sample_frames[MAX_FRAMES];
+static gint             sample_n_frames   = 0;
+static volatile gint    sample_state      = SAMPLE_IDLE;
+
+#endif /* STACK_SAMPLER_SUPPORTED */
+
+
+/*  public functions  */
+
+/*  starts sampling the calling thread, which should be the main
+ *  thread.  returns FALSE if stack sampling is not supported.  every
+ *  successful call should be matched by a call to
+ *  gimp_stack_sampler_exit().
+ */
+gboolean
+gimp_stack_sampler_init (void)
+{
+#ifdef STACK_SAMPLER_SUPPORTED
+  gboolean success = TRUE;
+
+  g_mutex_lock (&sampler_mutex);
+
+  /*  the handler is never uninstalled, since a signal sent just before
+   *  could still be on its way
+   */
+  if (! sampler_installed)
+    {
+      struct sigaction action;
+
+      /*  the first call to backtrace() may load libgcc, which allocates
+       *  memory, and must therefore not happen in the signal handler
+       */
+      backtrace (sample_frames, MAX_FRAMES);
+
+      memset (&action, 0, sizeof (action));
+
+      action.sa_handler = gimp_stack_sampler_signal_handler;
+      action.sa_flags   = SA_RESTART;
+
+      sigemptyset (&action.sa_mask);
+
+      if (sigaction (SAMPLE_SIGNAL, &action, NULL) == 0)
+        {
+          sampler_thread    = pthread_self ();
+          sampler_installed = TRUE;
+        }
+      else
+        {
+          success = FALSE;
+        }
+    }
+
+  if (success)
+    sampler_ref_count++;
+
+  g_mutex_unlock (&sampler_mutex);
+
+  return success;
+#else
+  return FALSE;
+#endif
+}
+
+void
+gimp_stack_sampler_exit (void)
+{
+#ifdef STACK_SAMPLER_SUPPORTED
+  g_mutex_lock (&sampler_mutex);
+
+  if (sampler_ref_count > 0)
+    sampler_ref_count--;
+
+  g_mutex_unlock (&sampler_mutex);
+#endif
+}
+
+/*  stores the current backtrace of the sampled thread in @frames,
+ *  innermost frame first, and returns the number of frames, or 0 if
+ *  the thread could not be sampled in time.  may be called from any
+ *  thread other than the sampled one.
+ */
+gint
+gimp_stack_sampler_sample (guintptr *frames,
+                           gint      max_frames)
+{
+#ifdef STACK_SAMPLER_SUPPORTED
+  gint n_frames = 0;
+
+  g_return_val_if_fail (frames != NULL || max_frames == 0, 0);
+
+  g_mutex_lock (&sampler_mutex);
+
+  if (sampler_ref_count > 0)
+    {
+      gint64 end_time = g_get_monotonic_time () + SAMPLE_TIMEOUT;
+
+      g_atomic_int_set (&sample_state, SAMPLE_REQUESTED);
+
+      if (pthread_kill (sampler_thread, SAMPLE_SIGNAL) == 0)
+        {
+          while (g_atomic_int_get (&sample_state) != SAMPLE_DONE &&
+                 g_get_monotonic_time () < end_time)
+            {
+              g_usleep (50);
+            }
+        }
+
+      /*  if the handler hasn't started by now, withdraw the request, so
+       *  that a late signal doesn't write to sample_frames behind our
+       *  back.  otherwise, it's about to finish.
+       */
+      if (! g_atomic_int_compare_and_exchange (&sample_state,
+                                               SAMPLE_REQUESTED,
+                                               SAMPLE_IDLE))
+        {
+          while (g_atomic_int_get (&sample_state) != SAMPLE_DONE)
+            g_usleep (50);
+
+          n_frames = sample_n_frames - SKIPPED_FRAMES;
+          n_frames = CLAMP (n_frames, 0, max_frames);
+
+          if (n_frames > 0)
+            {
+              gint i;
+
+              for (i = 0; i < n_frames; i++)
+                frames[i] = (guintptr) sample_frames[SKIPPED_FRAMES + i];
+            }
+
+          g_atomic_int_set (&sample_state, SAMPLE_IDLE);
+        }
+    }
+
+  g_mutex_unlock (&sampler_mutex);
+
+  return n_frames;
+#else
+  return 0;
+#endif
+}
+
+/*  returns a newly allocated description of the function containing
+ *  @address, or NULL if it can't be determined
+ */
+gchar *
+gimp_stack_sampler_get_symbol (guintptr address)
+{
+#ifdef STACK_SAMPLER_SUPPORTED
+  gpointer   frame = (gpointer) address;
+  gchar    **names;
+  gchar     *symbol = NULL;
+
+  names = backtrace_symbols (&frame, 1);
+
+  if (names)
+    {
+      symbol = g_strdup (names[0]);
+
+      free (names);
+    }
+
+  return symbol;
+#else
+  return NULL;
+#endif
+}
+
+
+/*  private functions  */
+
+#ifdef STACK_SAMPLER_SUPPORTED
+
+static void
+gimp_stack_sampler_signal_handler (gint signum)
+{
+  if (g_atomic_int_compare_and_exchange (&sample_state,
+                                         SAMPLE_REQUESTED,
+                                         SAMPLE_WRITING))
+    {
+      sample_n_frames = backtrace (sample_frames, MAX_FRAMES);
+
+      g_atomic_int_set (&sample_state, SAMPLE_DONE);
+    }
+}
+
+#endif /* STACK_SAMPLER_SUPPORTED */
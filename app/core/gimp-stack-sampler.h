@@ -0,0 +1,36 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-stack-sampler.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_STACK_SAMPLER_H__
+#define __GIMP_STACK_SAMPLER_H__
+
+
+#define GIMP_STACK_SAMPLER_MAX_FRAMES 64
+
+
+gboolean   gimp_stack_sampler_init       (void);
+void       gimp_stack_sampler_exit       (void);
+
+gint       gimp_stack_sampler_sample     (guintptr *frames,
+                                          gint      max_frames);
+
+gchar    * gimp_stack_sampler_get_symbol (guintptr  address);
+
+
+#endif /* __GIMP_STACK_SAMPLER_H__ */
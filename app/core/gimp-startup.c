@@ -0,0 +1,211 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-startup.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib-object.h>
+
+#include "core-types.h"
+
+#include "gimp-startup.h"
+
+
+/*  startup is timed as a tree of nested phases, from app_run() to the
+ *  main loop being entered.  the result of the current run is kept for
+ *  the dashboard, and printed when GIMP was started with
+ *  --verbose-timing.  phases must be timed from the main thread, and
+ *  nothing is recorded once startup is finished, after which the
+ *  durations can be read from any thread.
+ */
+
+
+typedef struct
+{
+  gchar  *name;
+  gint    depth;
+  gint64  start_time;
+  gint64  duration;
+} Phase;
+
+
+/*  local variables  */
+
+static GArray   *phases         = NULL;
+static GArray   *open_phases    = NULL;
+static gint64    startup_time   = 0;
+static gint64    startup_total  = -1;
+static gboolean  verbose_timing = FALSE;
+
+
+/*  public functions  */
+
+void
+gimp_startup_init (gboolean verbose)
+{
+  g_return_if_fail (phases == NULL);
+
+  phases      = g_array_new (FALSE, FALSE, sizeof (Phase));
+  open_phases = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  startup_time   = g_get_monotonic_time ();
+  verbose_timing = verbose;
+}
+
+void
+gimp_startup_begin (const gchar *format,
+                    ...)
+{
+  Phase   phase;
+  guint   index;
+  va_list args;
+
+  if (! open_phases)
+    return;
+
+  va_start (args, format);
+  phase.name = g_strdup_vprintf (format, args);
+  va_end (args);
+
+  phase.depth      = open_phases->len;
+  phase.start_time = g_get_monotonic_time ();
+  phase.duration   = -1;
+
+  index = phases->len;
+
+  g_array_append_val (phases, phase);
+  g_array_append_val (open_phases, index);
+}
+
+void
+gimp_startup_end (void)
+{
+  Phase *phase;
+  guint  index;
+
+  if (! open_phases)
+    return;
+
+  g_return_if_fail (open_phases->len > 0);
+
+  index = g_array_index (open_phases, guint, open_phases->len - 1);
+  g_array_set_size (open_phases, open_phases->len - 1);
+
+  phase = &g_array_index (phases, Phase, index);
+
+  phase->duration = g_get_monotonic_time () - phase->start_time;
+}
+
+/*  records a phase that was timed by the caller, as a child of the
+ *  currently open phase, for work that overlaps other phases, like
+ *  plug-ins that are queried in parallel
+ */
+void
+gimp_startup_record (const gchar *name,
+                     gint64       start_time,
+                     gint64       end_time)
+{
+  Phase phase;
+
+  g_return_if_fail (name != NULL);
+
+  if (! open_phases)
+    return;
+
+  phase.name       = g_strdup (name);
+  phase.depth      = open_phases->len;
+  phase.start_time = start_time;
+  phase.duration   = end_time - start_time;
+
+  g_array_append_val (phases, phase);
+}
+
+void
+gimp_startup_finish (void)
+{
+  if (! open_phases)
+    return;
+
+  while (open_phases->len > 0)
+    gimp_startup_end ();
+
+  g_array_free (open_phases, TRUE);
+  open_phases = NULL;
+
+  startup_total = g_get_monotonic_time () - startup_time;
+
+  if (verbose_timing)
+    {
+      guint i;
+
+      g_print ("Startup timing:\n");
+
+      for (i = 0; i < phases->len; i++)
+        {
+          const Phase *phase = &g_array_index (phases, Phase, i);
+
+          g_print ("%10.1f ms  %*s%s\n",
+                   phase->duration / 1000.0,
+                   2 * phase->depth, "",
+                   phase->name);
+        }
+
+      g_print ("%10.1f ms  total\n", startup_total / 1000.0);
+    }
+}
+
+/*  returns the total duration, in seconds, of all phases called 'name',
+ *  or of the whole startup if 'name' is NULL
+ */
+gboolean
+gimp_startup_get_duration (const gchar *name,
+                           gdouble     *duration)
+{
+  gint64   total = 0;
+  gboolean found = FALSE;
+  guint    i;
+
+  g_return_val_if_fail (duration != NULL, FALSE);
+
+  if (! phases || open_phases)
+    return FALSE;
+
+  if (! name)
+    {
+      *duration = startup_total / 1000000.0;
+
+      return TRUE;
+    }
+
+  for (i = 0; i < phases->len; i++)
+    {
+      const Phase *phase = &g_array_index (phases, Phase, i);
+
+      if (! strcmp (phase->name, name))
+        {
+          total += phase->duration;
+          found  = TRUE;
+        }
+    }
+
+  *duration = total / 1000000.0;
+
+  return found;
+}
@@ -0,0 +1,39 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-startup.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_STARTUP_H__
+#define __GIMP_STARTUP_H__
+
+
+void       gimp_startup_init         (gboolean      verbose);
+
+void       gimp_startup_begin        (const gchar  *format,
+                                      ...) G_GNUC_PRINTF (1, 2);
+void       gimp_startup_end          (void);
+void       gimp_startup_record       (const gchar  *name,
+                                      gint64        start_time,
+                                      gint64        end_time);
+
+void       gimp_startup_finish       (void);
+
+gboolean   gimp_startup_get_duration (const gchar  *name,
+                                      gdouble      *duration);
+
+
+#endif /* __GIMP_STARTUP_H__ */
@@ -594,6 +594,20 @@ gimp_transform_polygon (const GimpMatrix3 *matrix,
   if (n_vertices == 0)
     return;
 
+  /*  an affine transform never crosses the near plane, so there is
+   *  nothing to clip
+   */
+  if (matrix->coeff[2][0] == 0.0 &&
+      matrix->coeff[2][1] == 0.0 &&
+      matrix->coeff[2][2] == 1.0)
+    {
+      gimp_matrix3_transform_points (matrix, vertices, n_vertices, t_vertices);
+
+      *n_t_vertices = n_vertices;
+
+      return;
+    }
+
   curr.x = matrix->coeff[0][0] * vertices[0].x +
            matrix->coeff[0][1] * vertices[0].y +
            matrix->coeff[0][2];
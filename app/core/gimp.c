@@ -33,6 +33,7 @@
 
 #include "pdb/gimppdb.h"
 #include "pdb/gimp-pdb-compat.h"
+#include "pdb/gimp-pdb-gegl.h"
 #include "pdb/internal-procs.h"
 
 #include "plug-in/gimppluginmanager.h"
@@ -51,6 +52,7 @@
 #include "gimp-memsize.h"
 #include "gimp-modules.h"
 #include "gimp-parasites.h"
+#include "gimp-startup.h"
 #include "gimp-templates.h"
 #include "gimp-units.h"
 #include "gimp-utils.h"
@@ -533,12 +535,21 @@ gimp_real_restore (Gimp               *gimp,
   if (gimp->be_verbose)
     g_print ("INIT: %s\n", G_STRFUNC);
 
+  /*  register the procedures of GEGL operations, which may come
+   *  from modules, so after loading those
+   */
+  gimp_pdb_gegl_procs_register (gimp->pdb);
+
+  gimp_startup_begin ("plug-ins");
   gimp_plug_in_manager_restore (gimp->plug_in_manager,
                                 gimp_get_user_context (gimp), status_callback);
+  gimp_startup_end ();
 
   /*  initialize babl fishes  */
   status_callback (_("Initialization"), "Babl Fishes", 0.0);
+  gimp_startup_begin ("babl fishes");
   gimp_babl_init_fishes (status_callback);
+  gimp_startup_end ();
 
   gimp->restored = TRUE;
 }
@@ -779,25 +790,35 @@ gimp_restore (Gimp               *gimp,
 
   /*  initialize  the global parasite table  */
   status_callback (_("Looking for data files"), _("Parasites"), 0.0);
+  gimp_startup_begin ("parasites");
   gimp_parasiterc_load (gimp);
+  gimp_startup_end ();
 
   /*  initialize the lists of gimp brushes, dynamics, patterns etc.  */
+  gimp_startup_begin ("data");
   gimp_data_factories_load (gimp, status_callback);
+  gimp_startup_end ();
 
   /*  initialize the list of fonts  */
   if (! gimp->no_fonts)
     {
-      status_callback (NULL, _("Fonts (this may take a while)"), 0.7);
-      gimp_fonts_load (gimp, status_callback);
+      status_callback (NULL, _("Fonts"), 0.7);
+      gimp_startup_begin ("fonts");
+      gimp_fonts_load (gimp);
+      gimp_startup_end ();
     }
 
   /*  initialize the template list  */
   status_callback (NULL, _("Templates"), 0.8);
+  gimp_startup_begin ("templates");
   gimp_templates_load (gimp);
+  gimp_startup_end ();
 
   /*  initialize the module list  */
   status_callback (NULL, _("Modules"), 0.9);
+  gimp_startup_begin ("modules");
   gimp_modules_load (gimp);
+  gimp_startup_end ();
 
   g_signal_emit (gimp, gimp_signals[RESTORE], 0, status_callback);
 
@@ -182,6 +182,23 @@ gimp_bezier_desc_translate (GimpBezierDesc *desc,
       }
 }
 
+void
+gimp_bezier_desc_scale (GimpBezierDesc *desc,
+                        gdouble         scale_x,
+                        gdouble         scale_y)
+{
+  gint i, j;
+
+  g_return_if_fail (desc != NULL);
+
+  for (i = 0; i < desc->num_data; i += desc->data[i].header.length)
+    for (j = 1; j < desc->data[i].header.length; ++j)
+      {
+        desc->data[i+j].point.x *= scale_x;
+        desc->data[i+j].point.y *= scale_y;
+      }
+}
+
 GimpBezierDesc *
 gimp_bezier_desc_copy (const GimpBezierDesc *desc)
 {
@@ -192,6 +209,15 @@ gimp_bezier_desc_copy (const GimpBezierDesc *desc)
                                desc->num_data);
 }
 
+gsize
+gimp_bezier_desc_get_memsize (const GimpBezierDesc *desc)
+{
+  if (desc)
+    return sizeof (GimpBezierDesc) + desc->num_data * sizeof (cairo_path_data_t);
+
+  return 0;
+}
+
 void
 gimp_bezier_desc_free (GimpBezierDesc *desc)
 {
@@ -39,8 +39,12 @@ GimpBezierDesc * gimp_bezier_desc_new_from_bound_segs (GimpBoundSeg         *bou
 void             gimp_bezier_desc_translate           (GimpBezierDesc       *desc,
                                                        gdouble               offset_x,
                                                        gdouble               offset_y);
+void             gimp_bezier_desc_scale               (GimpBezierDesc       *desc,
+                                                       gdouble               scale_x,
+                                                       gdouble               scale_y);
 
 GimpBezierDesc * gimp_bezier_desc_copy                (const GimpBezierDesc *desc);
+gsize            gimp_bezier_desc_get_memsize         (const GimpBezierDesc *desc);
 void             gimp_bezier_desc_free                (GimpBezierDesc       *desc);
 
 
@@ -26,12 +26,20 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
+#include "gimpspans.h"
 
 
 /* GimpBoundSeg array growth parameter */
 #define MAX_SEGS_INC  2048
 
+/* the height of the bands a GimpBoundaryCache traces separately, the
+ * same as the tiles of the buffers it is used on
+ */
+#define BAND_SHIFT    6
+#define BAND_HEIGHT   (1 << BAND_SHIFT)
+
 
 typedef struct _GimpBoundary GimpBoundary;
 
@@ -52,6 +60,59 @@ struct _GimpBoundary
   gint          max_empty_segs;
 };
 
+typedef struct _GimpBoundaryBand GimpBoundaryBand;
+
+struct _GimpBoundaryBand
+{
+  GimpBoundSeg *segs;
+  gint          num_segs;
+  gint          num_cut;   /*  the trailing segs, cut at the band's bottom  */
+  gboolean      valid;
+  guint         serial;    /*  incremented when the band is invalidated     */
+};
+
+/*  the parameters gimp_boundary_find() takes  */
+typedef struct
+{
+  GeglRectangle     region;
+  const Babl       *format;
+  GimpBoundaryType  type;
+  gint              x1, y1;
+  gint              x2, y2;
+  gfloat            threshold;
+} GimpBoundaryParams;
+
+struct _GimpBoundaryCache
+{
+  GMutex              mutex;
+
+  gboolean            has_params;
+  GimpBoundaryParams  params;
+  guint               params_serial;
+
+  gint                start;
+  gint                end;
+  gint                first_band;
+  gint                num_bands;
+  GimpBoundaryBand   *bands;
+};
+
+struct _GimpBoundaryJob
+{
+  GeglBuffer         *buffer;
+  GimpBoundaryParams  params;
+  guint               params_serial;
+
+  gint                start;
+  gint                end;
+  gint                first_band;
+
+  gint                num_bands;
+  gint               *band_index;
+  guint              *band_serial;
+  GimpBoundaryBand   *results;
+};
+
 
 /*  local function prototypes  */
 
@@ -78,6 +139,16 @@ static void           find_empty_segs          (const GeglRectangle *region,
                                                 gint                 x2,
                                                 gint                 y2,
                                                 gfloat               threshold);
+static void           find_span_empty_segs     (const GeglRectangle *region,
+                                                const GimpSpans     *spans,
+                                                gint                 scanline,
+                                                gint                 empty_segs[],
+                                                gint                *num_empty,
+                                                GimpBoundaryType     type,
+                                                gint                 x1,
+                                                gint                 y1,
+                                                gint                 x2,
+                                                gint                 y2);
 static void           process_horiz_seg        (GimpBoundary        *boundary,
                                                 gint                 x1,
                                                 gint                 y1,
@@ -91,7 +162,25 @@ static void           make_horiz_segs          (GimpBoundary        *boundary,
                                                 gint                 empty[],
                                                 gint                 num_empty,
                                                 gint                 top);
+static void           get_scanlines            (const GeglRectangle *region,
+                                                GimpBoundaryType     type,
+                                                gint                 y1,
+                                                gint                 y2,
+                                                gint                *start,
+                                                gint                *end);
+static gfloat       * read_scanline            (GeglBuffer          *buffer,
+                                                GeglRectangle       *line_rect,
+                                                const Babl          *format,
+                                                gfloat              *line_data,
+                                                gint                 scanline,
+                                                gint                 first,
+                                                gint                 last);
+static void           get_selected             (const gint          *empty_segs,
+                                                gint                 num_empty,
+                                                guchar              *selected,
+                                                gint                 width);
 static GimpBoundary * generate_boundary        (GeglBuffer          *buffer,
+                                                const GimpSpans     *spans,
                                                 const GeglRectangle *region,
                                                 const Babl          *format,
                                                 GimpBoundaryType     type,
@@ -99,7 +188,17 @@ static GimpBoundary * generate_boundary        (GeglBuffer          *buffer,
                                                 gint                 y1,
                                                 gint                 x2,
                                                 gint                 y2,
-                                                gfloat               threshold);
+                                                gfloat               threshold,
+                                                gint                 start,
+                                                gint                 end,
+                                                gint                *num_cut);
+
+static void           gimp_boundary_cache_clear    (GimpBoundaryCache  *cache);
+static GimpBoundSeg * gimp_boundary_cache_assemble (GimpBoundaryCache  *cache,
+                                                    gint               *num_segs);
+static void           gimp_boundary_job_trace      (gint                i,
+                                                    gint                n,
+                                                    GimpBoundaryJob    *job);
 
 static gint       cmp_segptr_xy1_addr     (const GimpBoundSeg **seg_ptr_a,
                                            const GimpBoundSeg **seg_ptr_b);
@@ -166,6 +265,7 @@ gimp_boundary_find (GeglBuffer          *buffer,
 {
   GimpBoundary  *boundary;
   GeglRectangle  rect = { 0, };
+  gint           start, end;
 
   g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
   g_return_val_if_fail (num_segs != NULL, NULL);
@@ -183,14 +283,376 @@ gimp_boundary_find (GeglBuffer          *buffer,
       rect.height = gegl_buffer_get_height (buffer);
     }
 
-  boundary = generate_boundary (buffer, &rect, format, type,
-                                x1, y1, x2, y2, threshold);
+  get_scanlines (&rect, type, y1, y2, &start, &end);
+
+  boundary = generate_boundary (buffer, NULL, &rect, format, type,
+                                x1, y1, x2, y2, threshold,
+                                start, end, NULL);
+
+  *num_segs = boundary->num_segs;
+
+  return gimp_boundary_free (boundary, FALSE);
+}
+
+/**
+ * gimp_boundary_find_spans:
+ * @spans:    a #GimpSpans
+ * @type:     see gimp_boundary_find()
+ * @x1:       see gimp_boundary_find()
+ * @y1:       see gimp_boundary_find()
+ * @x2:       see gimp_boundary_find()
+ * @y2:       see gimp_boundary_find()
+ * @num_segs: number of returned #GimpBoundSeg's
+ *
+ * Like gimp_boundary_find() on @spans rendered to a buffer, but takes
+ * each scanline's empty segments from the spans instead of reading
+ * and thresholding its pixels.
+ *
+ * Return value: the boundary array.
+ **/
+GimpBoundSeg *
+gimp_boundary_find_spans (const GimpSpans  *spans,
+                          GimpBoundaryType  type,
+                          gint              x1,
+                          gint              y1,
+                          gint              x2,
+                          gint              y2,
+                          gint             *num_segs)
+{
+  GimpBoundary  *boundary;
+  GeglRectangle  rect = { 0, };
+  gint           start, end;
+
+  g_return_val_if_fail (spans != NULL, NULL);
+  g_return_val_if_fail (num_segs != NULL, NULL);
+
+  rect.width  = gimp_spans_get_width  (spans);
+  rect.height = gimp_spans_get_height (spans);
+
+  get_scanlines (&rect, type, y1, y2, &start, &end);
+
+  boundary = generate_boundary (NULL, spans, &rect, NULL, type,
+                                x1, y1, x2, y2, 0.0,
+                                start, end, NULL);
 
   *num_segs = boundary->num_segs;
 
   return gimp_boundary_free (boundary, FALSE);
 }
 
+/**
+ * gimp_boundary_cache_new:
+ *
+ * Creates a cache for the boundary of a buffer, which keeps the
+ * segments of each band of #BAND_HEIGHT scanlines, so that only the
+ * bands which were invalidated using gimp_boundary_cache_invalidate()
+ * need to be traced again.
+ *
+ * Return value: the new #GimpBoundaryCache.
+ **/
+GimpBoundaryCache *
+gimp_boundary_cache_new (void)
+{
+  GimpBoundaryCache *cache = g_slice_new0 (GimpBoundaryCache);
+
+  g_mutex_init (&cache->mutex);
+
+  return cache;
+}
+
+void
+gimp_boundary_cache_free (GimpBoundaryCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  gimp_boundary_cache_clear (cache);
+
+  g_mutex_clear (&cache->mutex);
+
+  g_slice_free (GimpBoundaryCache, cache);
+}
+
+/**
+ * gimp_boundary_cache_invalidate:
+ * @cache: a #GimpBoundaryCache
+ * @rect:  the changed area of the buffer, or %NULL
+ *
+ * Marks the bands whose boundary depends on @rect as to be traced
+ * again, or all of them if @rect is %NULL.  This function may be
+ * called from any thread.
+ **/
+void
+gimp_boundary_cache_invalidate (GimpBoundaryCache   *cache,
+                                const GeglRectangle *rect)
+{
+  gint first = 0;
+  gint last;
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->mutex);
+
+  last = cache->num_bands - 1;
+
+  /*  a band depends on the scanlines above and below it too  */
+  if (rect)
+    {
+      first = MAX (first, ((rect->y - 1) >> BAND_SHIFT) - cache->first_band);
+      last  = MIN (last,  ((rect->y + rect->height) >> BAND_SHIFT) -
+                          cache->first_band);
+    }
+
+  for (i = first; i <= last; i++)
+    {
+      cache->bands[i].valid = FALSE;
+      cache->bands[i].serial++;
+    }
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+/**
+ * gimp_boundary_cache_begin:
+ * @cache:     a #GimpBoundaryCache
+ * @buffer:    the #GeglBuffer to trace
+ * @region:    see gimp_boundary_find()
+ * @format:    see gimp_boundary_find()
+ * @type:      see gimp_boundary_find()
+ * @x1:        see gimp_boundary_find()
+ * @y1:        see gimp_boundary_find()
+ * @x2:        see gimp_boundary_find()
+ * @y2:        see gimp_boundary_find()
+ * @threshold: see gimp_boundary_find()
+ *
+ * Starts updating @cache to the boundary of @buffer.  If any of the
+ * parameters differ from the last time, all bands are traced again.
+ *
+ * The returned job can be run by gimp_boundary_job_run() in any
+ * thread, as long as @buffer doesn't change meanwhile, and must be
+ * finished by gimp_boundary_cache_end().
+ *
+ * Return value: the job tracing the invalid bands of @cache.
+ **/
+GimpBoundaryJob *
+gimp_boundary_cache_begin (GimpBoundaryCache   *cache,
+                           GeglBuffer          *buffer,
+                           const GeglRectangle *region,
+                           const Babl          *format,
+                           GimpBoundaryType     type,
+                           gint                 x1,
+                           gint                 y1,
+                           gint                 x2,
+                           gint                 y2,
+                           gfloat               threshold)
+{
+  GimpBoundaryJob    *job;
+  GimpBoundaryParams  params = { { 0, }, };
+  gint                i;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (babl_format_get_bytes_per_pixel (format) ==
+                        sizeof (gfloat), NULL);
+
+  if (region)
+    {
+      params.region = *region;
+    }
+  else
+    {
+      params.region.width  = gegl_buffer_get_width  (buffer);
+      params.region.height = gegl_buffer_get_height (buffer);
+    }
+
+  params.format    = format;
+  params.type      = type;
+  params.x1        = x1;
+  params.y1        = y1;
+  params.x2        = x2;
+  params.y2        = y2;
+  params.threshold = threshold;
+
+  g_mutex_lock (&cache->mutex);
+
+  if (! cache->has_params                                         ||
+      ! gegl_rectangle_equal (&params.region, &cache->params.region) ||
+      params.format    != cache->params.format                     ||
+      params.type      != cache->params.type                       ||
+      params.x1        != cache->params.x1                         ||
+      params.y1        != cache->params.y1                         ||
+      params.x2        != cache->params.x2                         ||
+      params.y2        != cache->params.y2                         ||
+      params.threshold != cache->params.threshold)
+    {
+      gimp_boundary_cache_clear (cache);
+
+      cache->has_params = TRUE;
+      cache->params     = params;
+      cache->params_serial++;
+
+      get_scanlines (&params.region, type, y1, y2, &cache->start, &cache->end);
+
+      if (cache->start < cache->end)
+        {
+          cache->first_band = cache->start >> BAND_SHIFT;
+          cache->num_bands  = ((cache->end - 1) >> BAND_SHIFT) -
+                              cache->first_band + 1;
+
+          cache->bands = g_new0 (GimpBoundaryBand, cache->num_bands);
+        }
+    }
+
+  job = g_slice_new0 (GimpBoundaryJob);
+
+  job->buffer        = g_object_ref (buffer);
+  job->params        = params;
+  job->params_serial = cache->params_serial;
+  job->start         = cache->start;
+  job->end           = cache->end;
+  job->first_band    = cache->first_band;
+
+  job->band_index  = g_new (gint,             cache->num_bands);
+  job->band_serial = g_new (guint,            cache->num_bands);
+  job->results     = g_new0 (GimpBoundaryBand, cache->num_bands);
+
+  for (i = 0; i < cache->num_bands; i++)
+    {
+      if (! cache->bands[i].valid)
+        {
+          job->band_index[job->num_bands]  = i;
+          job->band_serial[job->num_bands] = cache->bands[i].serial;
+
+          job->num_bands++;
+        }
+    }
+
+  g_mutex_unlock (&cache->mutex);
+
+  return job;
+}
+
+/**
+ * gimp_boundary_job_run:
+ * @job: a #GimpBoundaryJob
+ *
+ * Traces the bands of @job, distributing them across the
+ * gimp-parallel workers.
+ **/
+void
+gimp_boundary_job_run (GimpBoundaryJob *job)
+{
+  g_return_if_fail (job != NULL);
+
+  gimp_parallel_distribute (job->num_bands,
+                            (GimpParallelDistributeFunc)
+                            gimp_boundary_job_trace,
+                            job);
+}
+
+/**
+ * gimp_boundary_job_get_n_bands:
+ * @job: a #GimpBoundaryJob
+ *
+ * Return value: the number of bands @job has to trace, zero if the
+ *               cache was up to date when the job began.
+ **/
+gint
+gimp_boundary_job_get_n_bands (GimpBoundaryJob *job)
+{
+  g_return_val_if_fail (job != NULL, 0);
+
+  return job->num_bands;
+}
+
+/**
+ * gimp_boundary_cache_end:
+ * @cache:    a #GimpBoundaryCache
+ * @job:      the job returned by gimp_boundary_cache_begin()
+ * @segs:     returns the boundary, or %NULL
+ * @num_segs: returns the number of segments in @segs
+ *
+ * Frees @job, after storing the bands it traced in @cache, unless
+ * they were invalidated meanwhile.  If that leaves all bands valid,
+ * returns the boundary in @segs, which is the same as what
+ * gimp_boundary_find() would return, except for the order of the
+ * segments.  Pass %NULL for @segs to only update @cache.
+ *
+ * Return value: %TRUE if all bands are valid, %FALSE if there are
+ *               bands left to trace.
+ **/
+gboolean
+gimp_boundary_cache_end (GimpBoundaryCache  *cache,
+                         GimpBoundaryJob    *job,
+                         GimpBoundSeg      **segs,
+                         gint               *num_segs)
+{
+  gboolean complete = FALSE;
+  gint     i;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+  g_return_val_if_fail (job != NULL, FALSE);
+  g_return_val_if_fail (segs == NULL || num_segs != NULL, FALSE);
+
+  if (segs)
+    {
+      *segs     = NULL;
+      *num_segs = 0;
+    }
+
+  g_mutex_lock (&cache->mutex);
+
+  if (job->params_serial == cache->params_serial)
+    {
+      for (i = 0; i < job->num_bands; i++)
+        {
+          GimpBoundaryBand *band = &cache->bands[job->band_index[i]];
+
+          if (band->serial == job->band_serial[i])
+            {
+              g_free (band->segs);
+
+              band->segs     = job->results[i].segs;
+              band->num_segs = job->results[i].num_segs;
+              band->num_cut  = job->results[i].num_cut;
+              band->valid    = TRUE;
+
+              job->results[i].segs = NULL;
+            }
+        }
+
+      complete = TRUE;
+
+      for (i = 0; i < cache->num_bands; i++)
+        {
+          if (! cache->bands[i].valid)
+            {
+              complete = FALSE;
+              break;
+            }
+        }
+
+      if (complete && segs)
+        *segs = gimp_boundary_cache_assemble (cache, num_segs);
+    }
+
+  g_mutex_unlock (&cache->mutex);
+
+  for (i = 0; i < job->num_bands; i++)
+    g_free (job->results[i].segs);
+
+  g_object_unref (job->buffer);
+
+  g_free (job->band_index);
+  g_free (job->band_serial);
+  g_free (job->results);
+
+  g_slice_free (GimpBoundaryJob, job);
+
+  return complete;
+}
+
 /**
  * gimp_boundary_sort:
  * @segs:       unsorted input segs.
@@ -601,6 +1063,93 @@ find_empty_segs (const GeglRectangle *region,
   empty_segs[(*num_empty)++] = G_MAXINT;
 }
 
+/*  the same as find_empty_segs() on the scanline of @spans rendered,
+ *  the empty segments are the gaps between the spans, clipped to the
+ *  bounds the same way.
+ */
+static void
+find_span_empty_segs (const GeglRectangle *region,
+                      const GimpSpans     *spans,
+                      gint                 scanline,
+                      gint                 empty_segs[],
+                      gint                *num_empty,
+                      GimpBoundaryType     type,
+                      gint                 x1,
+                      gint                 y1,
+                      gint                 x2,
+                      gint                 y2)
+{
+  const gint *span;
+  gint        n_spans;
+  gint        start = 0;
+  gint        end   = 0;
+  gint        i;
+
+  *num_empty = 0;
+
+  empty_segs[(*num_empty)++] = 0;
+
+  if (scanline < region->y || scanline >= (region->y + region->height))
+    {
+      empty_segs[(*num_empty)++] = G_MAXINT;
+      return;
+    }
+
+  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+    {
+      if (scanline < y1 || scanline >= y2)
+        {
+          empty_segs[(*num_empty)++] = G_MAXINT;
+          return;
+        }
+
+      start = x1;
+      end   = x2;
+    }
+  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+    {
+      start = region->x;
+      end   = region->x + region->width;
+      if (scanline < y1 || scanline >= y2)
+        x2 = -1;
+    }
+
+  span = gimp_spans_get_row (spans, scanline, &n_spans);
+
+  for (i = 0; i < n_spans; i++)
+    {
+      gint s1 = MAX (span[2 * i],     start);
+      gint s2 = MIN (span[2 * i + 1], end);
+
+      if (s1 >= s2)
+        continue;
+
+      /*  the bounds to ignore are empty, and may split the span  */
+      if (type == GIMP_BOUNDARY_IGNORE_BOUNDS &&
+          x1 < x2 && s1 < x2 && s2 > x1)
+        {
+          if (s1 < x1)
+            {
+              empty_segs[(*num_empty)++] = s1;
+              empty_segs[(*num_empty)++] = x1;
+            }
+
+          if (s2 > x2)
+            {
+              empty_segs[(*num_empty)++] = x2;
+              empty_segs[(*num_empty)++] = s2;
+            }
+
+          continue;
+        }
+
+      empty_segs[(*num_empty)++] = s1;
+      empty_segs[(*num_empty)++] = s2;
+    }
+
+  empty_segs[(*num_empty)++] = G_MAXINT;
+}
+
 static void
 process_horiz_seg (GimpBoundary *boundary,
                    gint          x1,
@@ -663,8 +1212,77 @@ make_horiz_segs (GimpBoundary *boundary,
     }
 }
 
+static void
+get_scanlines (const GeglRectangle *region,
+               GimpBoundaryType     type,
+               gint                 y1,
+               gint                 y2,
+               gint                *start,
+               gint                *end)
+{
+  *start = 0;
+  *end   = 0;
+
+  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+    {
+      *start = y1;
+      *end   = y2;
+    }
+  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+    {
+      *start = region->y;
+      *end   = region->y + region->height;
+    }
+}
+
+static gfloat *
+read_scanline (GeglBuffer    *buffer,
+               GeglRectangle *line_rect,
+               const Babl    *format,
+               gfloat        *line_data,
+               gint           scanline,
+               gint           first,
+               gint           last)
+{
+  if (scanline < first || scanline >= last)
+    return NULL;
+
+  line_rect->y = scanline;
+  gegl_buffer_get (buffer, line_rect, 1.0, format,
+                   line_data, GEGL_AUTO_ROWSTRIDE,
+                   GEGL_ABYSS_NONE);
+
+  return line_data;
+}
+
+static void
+get_selected (const gint *empty_segs,
+              gint        num_empty,
+              guchar     *selected,
+              gint        width)
+{
+  gint i, x;
+
+  memset (selected, 0, width);
+
+  /*  the selected runs lie between the empty segments  */
+  for (i = 1; i < num_empty - 1; i += 2)
+    {
+      for (x = MAX (empty_segs[i], 0); x < MIN (empty_segs[i + 1], width); x++)
+        selected[x] = TRUE;
+    }
+}
+
+/*  traces the scanlines [start, end) of the boundary of [first, last),
+ *  as returned by get_scanlines().  when that is just a band of the
+ *  scanlines, the vertical segments which are still open at the band's
+ *  top and bottom are set up, respectively closed, as if the scanlines
+ *  above had been traced too.  the closed ones are added last, their
+ *  number is returned in @num_cut.
+ */
 static GimpBoundary *
 generate_boundary (GeglBuffer          *buffer,
+                   const GimpSpans     *spans,
                    const GeglRectangle *region,
                    const Babl          *format,
                    GimpBoundaryType     type,
@@ -672,14 +1290,18 @@ generate_boundary (GeglBuffer          *buffer,
                    gint                 y1,
                    gint                 x2,
                    gint                 y2,
-                   gfloat               threshold)
+                   gfloat               threshold,
+                   gint                 start,
+                   gint                 end,
+                   gint                *num_cut)
 {
   GimpBoundary  *boundary;
   GeglRectangle  line_rect = { 0, };
+  gfloat        *line_buf  = NULL;
   gfloat        *line_data;
   gint           scanline;
   gint           i;
-  gint           start, end;
+  gint           first, last;
   gint          *tmp_segs;
 
   gint          num_empty_n = 0;
@@ -688,59 +1310,101 @@ generate_boundary (GeglBuffer          *buffer,
 
   boundary = gimp_boundary_new (region);
 
-  line_rect.width  = gegl_buffer_get_width (buffer);
-  line_rect.height = 1;
+  if (! spans)
+    {
+      line_rect.width  = gegl_buffer_get_width (buffer);
+      line_rect.height = 1;
 
-  line_data = g_alloca (sizeof (gfloat) * line_rect.width);
+      line_buf = g_alloca (sizeof (gfloat) * line_rect.width);
+    }
 
-  start = 0;
-  end   = 0;
+  get_scanlines (region, type, y1, y2, &first, &last);
 
-  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+  /*  Find the empty segments for the previous and current scanlines  */
+  if (spans)
     {
-      start = y1;
-      end   = y2;
+      find_span_empty_segs (region, spans,
+                            start - 1, boundary->empty_segs_l, &num_empty_l,
+                            type, x1, y1, x2, y2);
+      find_span_empty_segs (region, spans,
+                            start, boundary->empty_segs_c, &num_empty_c,
+                            type, x1, y1, x2, y2);
     }
-  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+  else
     {
-      start = region->y;
-      end   = region->y + region->height;
+      line_data = read_scanline (buffer, &line_rect, format, line_buf,
+                                 start - 1, first, last);
+
+      find_empty_segs (region, line_data,
+                       start - 1, boundary->empty_segs_l,
+                       boundary->max_empty_segs, &num_empty_l,
+                       type, x1, y1, x2, y2,
+                       threshold);
+
+      line_rect.y = start;
+      gegl_buffer_get (buffer, &line_rect, 1.0, format,
+                       line_buf, GEGL_AUTO_ROWSTRIDE,
+                       GEGL_ABYSS_NONE);
+
+      find_empty_segs (region, line_buf,
+                       start, boundary->empty_segs_c,
+                       boundary->max_empty_segs, &num_empty_c,
+                       type, x1, y1, x2, y2,
+                       threshold);
     }
 
-  /*  Find the empty segments for the previous and current scanlines  */
-  find_empty_segs (region, NULL,
-                   start - 1, boundary->empty_segs_l,
-                   boundary->max_empty_segs, &num_empty_l,
-                   type, x1, y1, x2, y2,
-                   threshold);
-
-  line_rect.y = start;
-  gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                   line_data, GEGL_AUTO_ROWSTRIDE,
-                   GEGL_ABYSS_NONE);
+  /*  A vertical segment is open at the band's top if an odd number of
+   *  horizontal segments above has an end on it.  Counting the ends on
+   *  the scanlines above telescopes to whether a vertical edge crosses
+   *  the last one; of the ends on the band's top, only those of the
+   *  lower edges of the previous scanline have been processed.
+   */
+  if (start > first)
+    {
+      gint    width = region->x + region->width + 1;
+      guchar *above = g_new (guchar, width);
+      guchar *below = g_new (guchar, width);
+      gint    x;
 
-  find_empty_segs (region, line_data,
-                   start, boundary->empty_segs_c,
-                   boundary->max_empty_segs, &num_empty_c,
-                   type, x1, y1, x2, y2,
-                   threshold);
+      get_selected (boundary->empty_segs_l, num_empty_l, above, width);
+      get_selected (boundary->empty_segs_c, num_empty_c, below, width);
+
+      for (x = 0; x < width; x++)
+        {
+          gboolean a = x > 0 && above[x - 1];
+          gboolean b = above[x];
+          gboolean c = x > 0 && below[x - 1];
+          gboolean d = below[x];
+
+          if ((a != b) != ((a && ! c) != (b && ! d)))
+            boundary->vert_segs[x] = start;
+        }
+
+      g_free (above);
+      g_free (below);
+    }
 
   for (scanline = start; scanline < end; scanline++)
     {
       /*  find the empty segment list for the next scanline  */
-      line_rect.y = scanline + 1;
-      if (scanline + 1 == end)
-        line_data = NULL;
+      if (spans)
+        {
+          find_span_empty_segs (region, spans,
+                                scanline + 1, boundary->empty_segs_n,
+                                &num_empty_n,
+                                type, x1, y1, x2, y2);
+        }
       else
-        gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                         line_data, GEGL_AUTO_ROWSTRIDE,
-                         GEGL_ABYSS_NONE);
-
-      find_empty_segs (region, line_data,
-                       scanline + 1, boundary->empty_segs_n,
-                       boundary->max_empty_segs, &num_empty_n,
-                       type, x1, y1, x2, y2,
-                       threshold);
+        {
+          line_data = read_scanline (buffer, &line_rect, format, line_buf,
+                                     scanline + 1, first, last);
+
+          find_empty_segs (region, line_data,
+                           scanline + 1, boundary->empty_segs_n,
+                           boundary->max_empty_segs, &num_empty_n,
+                           type, x1, y1, x2, y2,
+                           threshold);
+        }
 
       /*  process the segments on the current scanline  */
       for (i = 1; i < num_empty_c - 1; i += 2)
@@ -766,9 +1430,163 @@ generate_boundary (GeglBuffer          *buffer,
       boundary->empty_segs_n = tmp_segs;
     }
 
+  if (num_cut)
+    *num_cut = 0;
+
+  /*  close the vertical segments which continue below the band, on
+   *  the side of the band's last scanline they have selected pixels
+   */
+  if (end < last)
+    {
+      gint    width    = region->x + region->width + 1;
+      guchar *selected = g_new (guchar, width);
+      gint    x;
+
+      get_selected (boundary->empty_segs_l, num_empty_l, selected, width);
+
+      for (x = 0; x < width; x++)
+        {
+          if (boundary->vert_segs[x] >= 0 && boundary->vert_segs[x] < end)
+            {
+              gimp_boundary_add_seg (boundary,
+                                     x, boundary->vert_segs[x], x, end,
+                                     selected[x]);
+
+              if (num_cut)
+                (*num_cut)++;
+            }
+        }
+
+      g_free (selected);
+    }
+
   return boundary;
 }
 
+static void
+gimp_boundary_cache_clear (GimpBoundaryCache *cache)
+{
+  gint i;
+
+  for (i = 0; i < cache->num_bands; i++)
+    g_free (cache->bands[i].segs);
+
+  g_clear_pointer (&cache->bands, g_free);
+
+  cache->num_bands  = 0;
+  cache->has_params = FALSE;
+}
+
+/*  concatenates the bands, joining the vertical segments which were
+ *  cut at the bottom of one band with their continuation at the top
+ *  of the next
+ */
+static GimpBoundSeg *
+gimp_boundary_cache_assemble (GimpBoundaryCache *cache,
+                              gint              *num_segs)
+{
+  GimpBoundSeg *segs;
+  gint          width = cache->params.region.x + cache->params.region.width + 1;
+  gint         *cut;
+  gint         *next_cut;
+  gint         *tmp;
+  gint          n = 0;
+  gint          b, i;
+
+  for (b = 0; b < cache->num_bands; b++)
+    n += cache->bands[b].num_segs;
+
+  if (n == 0)
+    {
+      *num_segs = 0;
+
+      return NULL;
+    }
+
+  segs     = g_new (GimpBoundSeg, n);
+  cut      = g_new (gint, width);
+  next_cut = g_new (gint, width);
+
+  for (i = 0; i < width; i++)
+    cut[i] = -1;
+
+  n = 0;
+
+  for (b = 0; b < cache->num_bands; b++)
+    {
+      const GimpBoundaryBand *band  = &cache->bands[b];
+      gint                    start = MAX (cache->start,
+                                           (cache->first_band + b) << BAND_SHIFT);
+
+      for (i = 0; i < width; i++)
+        next_cut[i] = -1;
+
+      for (i = 0; i < band->num_segs; i++)
+        {
+          const GimpBoundSeg *seg = &band->segs[i];
+          gint                index;
+
+          if (seg->x1 == seg->x2 && seg->y1 == start &&
+              seg->x1 >= 0 && seg->x1 < width && cut[seg->x1] >= 0)
+            {
+              index = cut[seg->x1];
+
+              segs[index].y2   = seg->y2;
+              segs[index].open = seg->open;
+
+              cut[seg->x1] = -1;
+            }
+          else
+            {
+              index = n++;
+
+              segs[index] = *seg;
+            }
+
+          if (i >= band->num_segs - band->num_cut)
+            next_cut[seg->x1] = index;
+        }
+
+      tmp      = cut;
+      cut      = next_cut;
+      next_cut = tmp;
+    }
+
+  g_free (cut);
+  g_free (next_cut);
+
+  *num_segs = n;
+
+  return segs;
+}
+
+static void
+gimp_boundary_job_trace (gint             i,
+                         gint             n,
+                         GimpBoundaryJob *job)
+{
+  for (; i < job->num_bands; i += n)
+    {
+      GimpBoundaryBand *result = &job->results[i];
+      GimpBoundary     *boundary;
+      gint              band   = job->first_band + job->band_index[i];
+
+      boundary = generate_boundary (job->buffer, NULL,
+                                    &job->params.region,
+                                    job->params.format,
+                                    job->params.type,
+                                    job->params.x1, job->params.y1,
+                                    job->params.x2, job->params.y2,
+                                    job->params.threshold,
+                                    MAX (job->start, band << BAND_SHIFT),
+                                    MIN (job->end, (band + 1) << BAND_SHIFT),
+                                    &result->num_cut);
+
+      result->num_segs = boundary->num_segs;
+      result->segs     = gimp_boundary_free (boundary, FALSE);
+    }
+}
+
 /*  sorting utility functions  */
 
 static inline gint
@@ -52,6 +52,35 @@ GimpBoundSeg * gimp_boundary_find      (GeglBuffer          *buffer,
                                         gint                 y2,
                                         gfloat               threshold,
                                         gint                *num_segs);
+GimpBoundSeg * gimp_boundary_find_spans (const GimpSpans    *spans,
+                                         GimpBoundaryType    type,
+                                         gint                x1,
+                                         gint                y1,
+                                         gint                x2,
+                                         gint                y2,
+                                         gint               *num_segs);
+
+GimpBoundaryCache * gimp_boundary_cache_new        (void);
+void                gimp_boundary_cache_free       (GimpBoundaryCache   *cache);
+void                gimp_boundary_cache_invalidate (GimpBoundaryCache   *cache,
+                                                    const GeglRectangle *rect);
+GimpBoundaryJob   * gimp_boundary_cache_begin      (GimpBoundaryCache   *cache,
+                                                    GeglBuffer          *buffer,
+                                                    const GeglRectangle *region,
+                                                    const Babl          *format,
+                                                    GimpBoundaryType     type,
+                                                    gint                 x1,
+                                                    gint                 y1,
+                                                    gint                 x2,
+                                                    gint                 y2,
+                                                    gfloat               threshold);
+void                gimp_boundary_job_run          (GimpBoundaryJob     *job);
+gint                gimp_boundary_job_get_n_bands  (GimpBoundaryJob     *job);
+gboolean            gimp_boundary_cache_end        (GimpBoundaryCache   *cache,
+                                                    GimpBoundaryJob     *job,
+                                                    GimpBoundSeg       **segs,
+                                                    gint                *num_segs);
+
 GimpBoundSeg * gimp_boundary_sort      (const GimpBoundSeg  *segs,
                                         gint                 num_segs,
                                         gint                *num_groups);
@@ -30,6 +30,14 @@
 #include "gimptempbuf.h"
 
 
+/*  the outline of large brushes is traced on the brush transformed to at
+ *  most this size, and then scaled up.  the reference scale doesn't
+ *  depend on the requested scale, so that all sizes of the brush share
+ *  one cached reference outline.
+ */
+#define REFERENCE_SIZE 128
+
+
 static GimpBezierDesc *
 gimp_brush_transform_boundary_exact (GimpBrush *brush,
                                      gdouble    scale,
@@ -97,11 +105,49 @@ gimp_brush_transform_boundary_approx (GimpBrush *brush,
                                       gdouble    aspect_ratio,
                                       gdouble    angle,
                                       gboolean   reflect,
-                                      gdouble    hardness)
+                                      gdouble    hardness,
+                                      gint       width,
+                                      gint       height)
 {
-  return gimp_brush_transform_boundary_exact (brush,
-                                              scale, aspect_ratio,
-                                              angle, reflect, hardness);
+  const GimpBezierDesc *reference;
+  GimpBezierDesc       *path;
+  gdouble               reference_scale;
+  gint                  brush_width;
+  gint                  brush_height;
+  gint                  reference_width;
+  gint                  reference_height;
+
+  gimp_brush_transform_size (brush, 1.0, 0.0, 0.0, FALSE,
+                             &brush_width, &brush_height);
+
+  reference_scale = (gdouble) REFERENCE_SIZE / MAX (brush_width, brush_height);
+
+  if (reference_scale >= scale)
+    {
+      return gimp_brush_transform_boundary_exact (brush,
+                                                  scale, aspect_ratio,
+                                                  angle, reflect, hardness);
+    }
+
+  /*  the transformed reference is within the size limit of the exact
+   *  outline, even when rotated, so this doesn't recurse
+   */
+  reference = gimp_brush_transform_boundary (brush,
+                                             reference_scale, aspect_ratio,
+                                             angle, reflect, hardness,
+                                             &reference_width,
+                                             &reference_height);
+
+  if (! reference)
+    return NULL;
+
+  path = gimp_bezier_desc_copy (reference);
+
+  gimp_bezier_desc_scale (path,
+                          (gdouble) width  / reference_width,
+                          (gdouble) height / reference_height);
+
+  return path;
 }
 
 GimpBezierDesc *
@@ -126,5 +172,6 @@ gimp_brush_real_transform_boundary (GimpBrush *brush,
 
   return gimp_brush_transform_boundary_approx (brush,
                                                scale, aspect_ratio,
-                                               angle, reflect, hardness);
+                                               angle, reflect, hardness,
+                                               *width, *height);
 }
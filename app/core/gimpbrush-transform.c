@@ -238,10 +238,19 @@ gimp_brush_real_transform_mask (GimpBrush *brush,
       return result;
     }*/
 
-  gimp_matrix3_transform_point (&matrix, 0,          0,           &tlx, &tly);
-  gimp_matrix3_transform_point (&matrix, dest_width, 0,           &trx, &try);
-  gimp_matrix3_transform_point (&matrix, 0,          dest_height, &blx, &bly);
-  gimp_matrix3_transform_point (&matrix, dest_width, dest_height, &brx, &bry);
+  {
+    GimpVector2 corners[4] = { { 0,          0           },
+                               { dest_width, 0           },
+                               { 0,          dest_height },
+                               { dest_width, dest_height } };
+
+    gimp_matrix3_transform_points (&matrix, corners, 4, corners);
+
+    tlx = corners[0].x; tly = corners[0].y;
+    trx = corners[1].x; try = corners[1].y;
+    blx = corners[2].x; bly = corners[2].y;
+    brx = corners[3].x; bry = corners[3].y;
+  }
 
 
   /* in image space, calc U (what was horizontal originally)
@@ -523,10 +532,19 @@ gimp_brush_real_transform_pixmap (GimpBrush *brush,
   dest = gimp_temp_buf_get_data (result);
   src  = gimp_temp_buf_get_data (source);
 
-  gimp_matrix3_transform_point (&matrix, 0,          0,           &tlx, &tly);
-  gimp_matrix3_transform_point (&matrix, dest_width, 0,           &trx, &try);
-  gimp_matrix3_transform_point (&matrix, 0,          dest_height, &blx, &bly);
-  gimp_matrix3_transform_point (&matrix, dest_width, dest_height, &brx, &bry);
+  {
+    GimpVector2 corners[4] = { { 0,          0           },
+                               { dest_width, 0           },
+                               { 0,          dest_height },
+                               { dest_width, dest_height } };
+
+    gimp_matrix3_transform_points (&matrix, corners, 4, corners);
+
+    tlx = corners[0].x; tly = corners[0].y;
+    trx = corners[1].x; try = corners[1].y;
+    blx = corners[2].x; bly = corners[2].y;
+    brx = corners[3].x; bry = corners[3].y;
+  }
 
 
   /* in image space, calc U (what was horizontal originally)
@@ -710,24 +728,16 @@ gimp_brush_transform_bounding_box (GimpBrush         *brush,
 {
   const gdouble  w = gimp_brush_get_width  (brush);
   const gdouble  h = gimp_brush_get_height (brush);
-  gdouble        x1, x2, x3, x4;
-  gdouble        y1, y2, y3, y4;
-  gdouble        temp_x;
-  gdouble        temp_y;
-
-  gimp_matrix3_transform_point (matrix, 0, 0, &x1, &y1);
-  gimp_matrix3_transform_point (matrix, w, 0, &x2, &y2);
-  gimp_matrix3_transform_point (matrix, 0, h, &x3, &y3);
-  gimp_matrix3_transform_point (matrix, w, h, &x4, &y4);
+  gdouble        x1, y1;
+  gdouble        x2, y2;
 
-  temp_x = MIN (MIN (x1, x2), MIN (x3, x4));
-  temp_y = MIN (MIN (y1, y2), MIN (y3, y4));
+  gimp_matrix3_transform_bounds (matrix, 0, 0, w, h, &x1, &y1, &x2, &y2);
 
-  *width  = (gint) ceil (MAX (MAX (x1, x2), MAX (x3, x4)) - temp_x);
-  *height = (gint) ceil (MAX (MAX (y1, y2), MAX (y3, y4)) - temp_y);
+  *width  = (gint) ceil (x2 - x1);
+  *height = (gint) ceil (y2 - y1);
 
-  *x = floor (temp_x);
-  *y = floor (temp_y);
+  *x = floor (x1);
+  *y = floor (y1);
 
   /* Transform size can not be less than 1 px */
   *width  = MAX (1, *width);
@@ -17,6 +17,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
@@ -26,6 +28,7 @@
 
 #include "core-types.h"
 
+#include "gimp-allocation.h"
 #include "gimpbezierdesc.h"
 #include "gimpbrush.h"
 #include "gimpbrush-boundary.h"
@@ -94,6 +97,19 @@ static gboolean      gimp_brush_real_want_null_motion (GimpBrush            *bru
 
 static gchar       * gimp_brush_get_checksum          (GimpTagged           *tagged);
 
+static GeglNode    * gimp_brush_get_op_key            (GeglNode             *op,
+                                                       gint                  width,
+                                                       gint                  height);
+static void          gimp_brush_apply_op              (GimpTempBuf          *buf,
+                                                       GeglNode             *op,
+                                                       GeglNode             *key);
+
+static void          gimp_brush_quantize_transform    (GimpBrush            *brush,
+                                                       gdouble              *scale,
+                                                       gdouble              *aspect_ratio,
+                                                       gdouble              *angle,
+                                                       gdouble              *hardness);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpBrush, gimp_brush, GIMP_TYPE_DATA,
                          G_IMPLEMENT_INTERFACE (GIMP_TYPE_TAGGED,
@@ -244,6 +260,13 @@ gimp_brush_get_memsize (GimpObject *object,
   memsize += gimp_temp_buf_get_memsize (brush->priv->mask);
   memsize += gimp_temp_buf_get_memsize (brush->priv->pixmap);
 
+  memsize += gimp_object_get_memsize (GIMP_OBJECT (brush->priv->mask_cache),
+                                      NULL);
+  memsize += gimp_object_get_memsize (GIMP_OBJECT (brush->priv->pixmap_cache),
+                                      NULL);
+  memsize += gimp_object_get_memsize (GIMP_OBJECT (brush->priv->boundary_cache),
+                                      NULL);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -289,6 +312,15 @@ gimp_brush_get_new_preview (GimpViewable *viewable,
 
       if (scale != 1.0)
         {
+          /*  scaling big brushes down is what makes previews
+           *  expensive, so only these go through the disk cache
+           */
+          return_buf = gimp_data_load_cached_preview (GIMP_DATA (brush),
+                                                      width, height);
+
+          if (return_buf)
+            return return_buf;
+
           gimp_brush_begin_use (brush);
 
           if (GIMP_IS_BRUSH_GENERATED (brush))
@@ -367,6 +399,9 @@ gimp_brush_get_new_preview (GimpViewable *viewable,
       gimp_temp_buf_unref ((GimpTempBuf *) mask_buf);
 
       gimp_brush_end_use (brush);
+
+      gimp_data_save_cached_preview (GIMP_DATA (brush), width, height,
+                                     return_buf);
     }
 
   return return_buf;
@@ -414,13 +449,19 @@ static void
 gimp_brush_real_begin_use (GimpBrush *brush)
 {
   brush->priv->mask_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'M', 'm');
+    gimp_brush_cache_new ((GDestroyNotify)         gimp_temp_buf_unref,
+                          (GimpBrushCacheSizeFunc) gimp_temp_buf_get_memsize,
+                          'M', 'm');
 
   brush->priv->pixmap_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'P', 'p');
+    gimp_brush_cache_new ((GDestroyNotify)         gimp_temp_buf_unref,
+                          (GimpBrushCacheSizeFunc) gimp_temp_buf_get_memsize,
+                          'P', 'p');
 
   brush->priv->boundary_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free, 'B', 'b');
+    gimp_brush_cache_new ((GDestroyNotify)         gimp_bezier_desc_free,
+                          (GimpBrushCacheSizeFunc) gimp_bezier_desc_get_memsize,
+                          'B', 'b');
 }
 
 static void
@@ -485,6 +526,191 @@ gimp_brush_get_checksum (GimpTagged *tagged)
   return checksum_string;
 }
 
+/*  the cache key of a plain flip of the mask, which is what the mirror
+ *  symmetry's operations amount to.  flips are keyed by their kind
+ *  instead of by the operation, whose nodes are recreated whenever the
+ *  paint size changes, so that the flipped masks stay cached.  no
+ *  GeglNode lives at those addresses.
+ */
+#define FLIP_KEY(flip_x, flip_y) \
+  ((GeglNode *) GINT_TO_POINTER (((flip_x) ? 1 : 0) | ((flip_y) ? 2 : 0)))
+
+static gboolean
+gimp_brush_get_op_flip (GeglNode *op,
+                        gint      width,
+                        gint      height,
+                        gboolean *flip_x,
+                        gboolean *flip_y)
+{
+  const gchar *operation = gegl_node_get_operation (op);
+  gdouble      origin_x;
+  gdouble      origin_y;
+
+  *flip_x = FALSE;
+  *flip_y = FALSE;
+
+  if (! g_strcmp0 (operation, "gegl:reflect"))
+    {
+      gdouble x, y;
+
+      gegl_node_get (op,
+                     "origin-x", &origin_x,
+                     "origin-y", &origin_y,
+                     "x",        &x,
+                     "y",        &y,
+                     NULL);
+
+      /*  reflection about the vertical or horizontal center line  */
+      if (x == 0.0 && y != 0.0 && origin_x * 2.0 == width)
+        *flip_x = TRUE;
+      else if (y == 0.0 && x != 0.0 && origin_y * 2.0 == height)
+        *flip_y = TRUE;
+    }
+  else if (! g_strcmp0 (operation, "gegl:rotate"))
+    {
+      gdouble degrees;
+
+      gegl_node_get (op,
+                     "origin-x", &origin_x,
+                     "origin-y", &origin_y,
+                     "degrees",  &degrees,
+                     NULL);
+
+      /*  half a turn about the center  */
+      if (fmod (fabs (degrees), 360.0) == 180.0 &&
+          origin_x * 2.0 == width               &&
+          origin_y * 2.0 == height)
+        {
+          *flip_x = TRUE;
+          *flip_y = TRUE;
+        }
+    }
+
+  return *flip_x || *flip_y;
+}
+
+static GeglNode *
+gimp_brush_get_op_key (GeglNode *op,
+                       gint      width,
+                       gint      height)
+{
+  gboolean flip_x;
+  gboolean flip_y;
+
+  if (op && gimp_brush_get_op_flip (op, width, height, &flip_x, &flip_y))
+    return FLIP_KEY (flip_x, flip_y);
+
+  return op;
+}
+
+static void
+gimp_brush_flip_temp_buf (GimpTempBuf *buf,
+                          gboolean     flip_x,
+                          gboolean     flip_y)
+{
+  gint    width  = gimp_temp_buf_get_width  (buf);
+  gint    height = gimp_temp_buf_get_height (buf);
+  gint    bpp    = babl_format_get_bytes_per_pixel (gimp_temp_buf_get_format (buf));
+  gint    stride = width * bpp;
+  guchar *data   = gimp_temp_buf_get_data (buf);
+  guchar  pixel[16];
+  gint    x, y;
+
+  g_return_if_fail (bpp <= sizeof (pixel));
+
+  if (flip_y)
+    {
+      guchar *row = g_malloc (stride);
+
+      for (y = 0; y < height / 2; y++)
+        {
+          guchar *top    = data + y                * stride;
+          guchar *bottom = data + (height - 1 - y) * stride;
+
+          memcpy (row,    top,    stride);
+          memcpy (top,    bottom, stride);
+          memcpy (bottom, row,    stride);
+        }
+
+      g_free (row);
+    }
+
+  if (flip_x)
+    {
+      for (y = 0; y < height; y++)
+        {
+          guchar *row = data + y * stride;
+
+          for (x = 0; x < width / 2; x++)
+            {
+              guchar *left  = row + x               * bpp;
+              guchar *right = row + (width - 1 - x) * bpp;
+
+              memcpy (pixel, left,  bpp);
+              memcpy (left,  right, bpp);
+              memcpy (right, pixel, bpp);
+            }
+        }
+    }
+}
+
+/*  applies a symmetry operation to a freshly transformed mask or pixmap.
+ *  plain flips are done exactly, without resampling.
+ */
+static void
+gimp_brush_apply_op (GimpTempBuf *buf,
+                     GeglNode    *op,
+                     GeglNode    *key)
+{
+  GeglNode   *graph, *source, *target;
+  GeglBuffer *buffer;
+
+  if (key != op)
+    {
+      gint flip = GPOINTER_TO_INT (key);
+
+      gimp_brush_flip_temp_buf (buf, flip & 1, flip & 2);
+
+      return;
+    }
+
+  buffer = gimp_temp_buf_create_buffer (buf);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer", buffer,
+                                NULL);
+  gegl_node_add_child (graph, op);
+  target = gegl_node_new_child (graph,
+                                "operation", "gegl:write-buffer",
+                                "buffer", buffer,
+                                NULL);
+
+  gegl_node_link_many (source, op, target, NULL);
+  gegl_node_blit (target, 1.0,
+                  GEGL_RECTANGLE (0, 0,
+                                  gegl_buffer_get_width (buffer),
+                                  gegl_buffer_get_height (buffer)),
+                  NULL, NULL, 0, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+  g_object_unref (buffer);
+}
+
+static void
+gimp_brush_quantize_transform (GimpBrush *brush,
+                               gdouble   *scale,
+                               gdouble   *aspect_ratio,
+                               gdouble   *angle,
+                               gdouble   *hardness)
+{
+  gint size = MAX (gimp_temp_buf_get_width  (brush->priv->mask),
+                   gimp_temp_buf_get_height (brush->priv->mask));
+
+  gimp_brush_cache_quantize (size, scale, aspect_ratio, angle, hardness);
+}
+
 /*  public functions  */
 
 GimpData *
@@ -577,11 +803,16 @@ gimp_brush_transform_size (GimpBrush     *brush,
                            gint          *width,
                            gint          *height)
 {
+  gdouble hardness = 1.0;
+
   g_return_if_fail (GIMP_IS_BRUSH (brush));
   g_return_if_fail (scale > 0.0);
   g_return_if_fail (width != NULL);
   g_return_if_fail (height != NULL);
 
+  gimp_brush_quantize_transform (brush,
+                                 &scale, &aspect_ratio, &angle, &hardness);
+
   if (scale             == 1.0 &&
       aspect_ratio      == 0.0 &&
       fmod (angle, 0.5) == 0.0)
@@ -607,19 +838,26 @@ gimp_brush_transform_mask (GimpBrush *brush,
                            gdouble    hardness)
 {
   const GimpTempBuf *mask;
+  GeglNode          *key;
   gint               width;
   gint               height;
-  gdouble            effective_hardness = hardness;
+  gdouble            effective_hardness;
 
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
   g_return_val_if_fail (scale > 0.0, NULL);
 
+  gimp_brush_quantize_transform (brush,
+                                 &scale, &aspect_ratio, &angle, &hardness);
+  effective_hardness = hardness;
+
   gimp_brush_transform_size (brush,
                              scale, aspect_ratio, angle, reflect,
                              &width, &height);
 
+  key = gimp_brush_get_op_key (op, width, height);
+
   mask = gimp_brush_cache_get (brush->priv->mask_cache,
-                               op, width, height,
+                               key, width, height,
                                scale, aspect_ratio, angle, reflect, hardness);
 
   if (! mask)
@@ -657,36 +895,14 @@ gimp_brush_transform_mask (GimpBrush *brush,
                                                            effective_hardness);
 
       if (op)
-        {
-          GeglNode   *graph, *source, *target;
-          GeglBuffer *buffer = gimp_temp_buf_create_buffer ((GimpTempBuf *) mask);
-
-          graph  = gegl_node_new ();
-          source = gegl_node_new_child (graph,
-                                        "operation", "gegl:buffer-source",
-                                        "buffer", buffer,
-                                        NULL);
-          gegl_node_add_child (graph, op);
-          target = gegl_node_new_child (graph,
-                                        "operation", "gegl:write-buffer",
-                                        "buffer", buffer,
-                                        NULL);
-
-          gegl_node_link_many (source, op, target, NULL);
-          gegl_node_blit (target, 1.0,
-                          GEGL_RECTANGLE (0, 0,
-                                          gegl_buffer_get_width (buffer),
-                                          gegl_buffer_get_height (buffer)),
-                          NULL, NULL, 0, GEGL_BLIT_DEFAULT);
-
-
-          g_object_unref (graph);
-          g_object_unref (buffer);
-        }
+        gimp_brush_apply_op ((GimpTempBuf *) mask, op, key);
+
+      gimp_temp_buf_set_allocation ((GimpTempBuf *) mask,
+                                    GIMP_ALLOCATION_CACHE);
 
       gimp_brush_cache_add (brush->priv->mask_cache,
                             (gpointer) mask,
-                            op, width, height,
+                            key, width, height,
                             scale, aspect_ratio, angle, reflect, effective_hardness);
     }
 
@@ -703,20 +919,27 @@ gimp_brush_transform_pixmap (GimpBrush *brush,
                              gdouble    hardness)
 {
   const GimpTempBuf *pixmap;
+  GeglNode          *key;
   gint               width;
   gint               height;
-  gdouble            effective_hardness = hardness;
+  gdouble            effective_hardness;
 
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
   g_return_val_if_fail (brush->priv->pixmap != NULL, NULL);
   g_return_val_if_fail (scale > 0.0, NULL);
 
+  gimp_brush_quantize_transform (brush,
+                                 &scale, &aspect_ratio, &angle, &hardness);
+  effective_hardness = hardness;
+
   gimp_brush_transform_size (brush,
                              scale, aspect_ratio, angle, reflect,
                              &width, &height);
 
+  key = gimp_brush_get_op_key (op, width, height);
+
   pixmap = gimp_brush_cache_get (brush->priv->pixmap_cache,
-                                 op, width, height,
+                                 key, width, height,
                                  scale, aspect_ratio, angle, reflect, hardness);
 
   if (! pixmap)
@@ -749,35 +972,14 @@ gimp_brush_transform_pixmap (GimpBrush *brush,
                                                                effective_hardness);
 
       if (op)
-        {
-          GeglNode   *graph, *source, *target;
-          GeglBuffer *buffer = gimp_temp_buf_create_buffer ((GimpTempBuf *) pixmap);
-
-          graph  = gegl_node_new ();
-          source = gegl_node_new_child (graph,
-                                        "operation", "gegl:buffer-source",
-                                        "buffer", buffer,
-                                        NULL);
-          gegl_node_add_child (graph, op);
-          target = gegl_node_new_child (graph,
-                                        "operation", "gegl:write-buffer",
-                                        "buffer", buffer,
-                                        NULL);
-
-          gegl_node_link_many (source, op, target, NULL);
-          gegl_node_blit (target, 1.0,
-                          GEGL_RECTANGLE (0, 0,
-                                          gegl_buffer_get_width (buffer),
-                                          gegl_buffer_get_height (buffer)),
-                          NULL, NULL, 0, GEGL_BLIT_DEFAULT);
-
-          g_object_unref (graph);
-          g_object_unref (buffer);
-        }
+        gimp_brush_apply_op ((GimpTempBuf *) pixmap, op, key);
+
+      gimp_temp_buf_set_allocation ((GimpTempBuf *) pixmap,
+                                    GIMP_ALLOCATION_CACHE);
 
       gimp_brush_cache_add (brush->priv->pixmap_cache,
                             (gpointer) pixmap,
-                            op, width, height,
+                            key, width, height,
                             scale, aspect_ratio, angle, reflect, effective_hardness);
     }
 
@@ -801,6 +1003,9 @@ gimp_brush_transform_boundary (GimpBrush *brush,
   g_return_val_if_fail (width != NULL, NULL);
   g_return_val_if_fail (height != NULL, NULL);
 
+  gimp_brush_quantize_transform (brush,
+                                 &scale, &aspect_ratio, &angle, &hardness);
+
   gimp_brush_transform_size (brush,
                              scale, aspect_ratio, angle, reflect,
                              width, height);
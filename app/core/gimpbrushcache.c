@@ -22,21 +22,31 @@
 
 #include <gegl.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "core-types.h"
 
+#include "gimp-memsize.h"
 #include "gimpbrushcache.h"
 
 #include "gimp-log.h"
 #include "gimp-intl.h"
 
 
-#define MAX_CACHED_DATA 20
+/*  the largest distance, in pixels, by which quantizing the transform
+ *  may move the outline of the transformed brush
+ */
+#define QUANTIZE_STEP 0.5
+
+#define HARDNESS_STEPS 256
 
 
 enum
 {
   PROP_0,
-  PROP_DATA_DESTROY
+  PROP_DATA_DESTROY,
+  PROP_DATA_SIZE,
+  PROP_MAX_SIZE
 };
 
 
@@ -45,6 +55,8 @@ typedef struct _GimpBrushCacheUnit GimpBrushCacheUnit;
 struct _GimpBrushCacheUnit
 {
   gpointer  data;
+  gsize     size;
+  GList     link;
 
   gint      width;
   gint      height;
@@ -57,16 +69,26 @@ struct _GimpBrushCacheUnit
 };
 
 
-static void   gimp_brush_cache_constructed  (GObject      *object);
-static void   gimp_brush_cache_finalize     (GObject      *object);
-static void   gimp_brush_cache_set_property (GObject      *object,
-                                             guint         property_id,
-                                             const GValue *value,
-                                             GParamSpec   *pspec);
-static void   gimp_brush_cache_get_property (GObject      *object,
-                                             guint         property_id,
-                                             GValue       *value,
-                                             GParamSpec   *pspec);
+static void       gimp_brush_cache_constructed  (GObject            *object);
+static void       gimp_brush_cache_finalize     (GObject            *object);
+static void       gimp_brush_cache_set_property (GObject            *object,
+                                                 guint               property_id,
+                                                 const GValue       *value,
+                                                 GParamSpec         *pspec);
+static void       gimp_brush_cache_get_property (GObject            *object,
+                                                 guint               property_id,
+                                                 GValue             *value,
+                                                 GParamSpec         *pspec);
+
+static gint64     gimp_brush_cache_get_memsize  (GimpObject         *object,
+                                                 gint64             *gui_size);
+
+static guint      gimp_brush_cache_unit_hash    (GimpBrushCacheUnit *unit);
+static gboolean   gimp_brush_cache_unit_equal   (GimpBrushCacheUnit *unit1,
+                                                 GimpBrushCacheUnit *unit2);
+
+static void       gimp_brush_cache_remove_unit  (GimpBrushCache     *cache,
+                                                 GimpBrushCacheUnit *unit);
 
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
@@ -77,23 +99,44 @@ G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 static void
 gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
 {
-  GObjectClass  *object_class = G_OBJECT_CLASS (klass);
+  GObjectClass    *object_class      = G_OBJECT_CLASS (klass);
+  GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
 
-  object_class->constructed  = gimp_brush_cache_constructed;
-  object_class->finalize     = gimp_brush_cache_finalize;
-  object_class->set_property = gimp_brush_cache_set_property;
-  object_class->get_property = gimp_brush_cache_get_property;
+  object_class->constructed      = gimp_brush_cache_constructed;
+  object_class->finalize         = gimp_brush_cache_finalize;
+  object_class->set_property     = gimp_brush_cache_set_property;
+  object_class->get_property     = gimp_brush_cache_get_property;
+
+  gimp_object_class->get_memsize = gimp_brush_cache_get_memsize;
 
   g_object_class_install_property (object_class, PROP_DATA_DESTROY,
                                    g_param_spec_pointer ("data-destroy",
                                                          NULL, NULL,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_DATA_SIZE,
+                                   g_param_spec_pointer ("data-size",
+                                                         NULL, NULL,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_MAX_SIZE,
+                                   g_param_spec_int64 ("max-size",
+                                                       NULL, NULL,
+                                                       0, G_MAXINT64,
+                                                       GIMP_BRUSH_CACHE_DEFAULT_MAX_SIZE,
+                                                       GIMP_PARAM_READWRITE |
+                                                       G_PARAM_CONSTRUCT));
 }
 
 static void
-gimp_brush_cache_init (GimpBrushCache *brush)
+gimp_brush_cache_init (GimpBrushCache *cache)
 {
+  cache->units = g_hash_table_new ((GHashFunc)  gimp_brush_cache_unit_hash,
+                                   (GEqualFunc) gimp_brush_cache_unit_equal);
+
+  g_queue_init (&cache->lru);
 }
 
 static void
@@ -104,6 +147,7 @@ gimp_brush_cache_constructed (GObject *object)
   G_OBJECT_CLASS (parent_class)->constructed (object);
 
   gimp_assert (cache->data_destroy != NULL);
+  gimp_assert (cache->data_size != NULL);
 }
 
 static void
@@ -113,6 +157,8 @@ gimp_brush_cache_finalize (GObject *object)
 
   gimp_brush_cache_clear (cache);
 
+  g_clear_pointer (&cache->units, g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -130,6 +176,21 @@ gimp_brush_cache_set_property (GObject      *object,
       cache->data_destroy = g_value_get_pointer (value);
       break;
 
+    case PROP_DATA_SIZE:
+      cache->data_size = g_value_get_pointer (value);
+      break;
+
+    case PROP_MAX_SIZE:
+      cache->max_size = g_value_get_int64 (value);
+
+      /*  keep the most recently used unit, it may still be in use  */
+      while (cache->size > cache->max_size &&
+             cache->lru.length > 1)
+        {
+          gimp_brush_cache_remove_unit (cache, cache->lru.tail->data);
+        }
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -150,26 +211,105 @@ gimp_brush_cache_get_property (GObject    *object,
       g_value_set_pointer (value, cache->data_destroy);
       break;
 
+    case PROP_DATA_SIZE:
+      g_value_set_pointer (value, cache->data_size);
+      break;
+
+    case PROP_MAX_SIZE:
+      g_value_set_int64 (value, cache->max_size);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
     }
 }
 
+static gint64
+gimp_brush_cache_get_memsize (GimpObject *object,
+                              gint64     *gui_size)
+{
+  GimpBrushCache *cache   = GIMP_BRUSH_CACHE (object);
+  gint64          memsize = 0;
+
+  memsize += gimp_g_hash_table_get_memsize (cache->units, 0);
+  memsize += cache->size;
+
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
+}
+
+static guint
+gimp_brush_cache_double_hash (gdouble value)
+{
+  /*  0.0 and -0.0 compare equal, make sure they hash equal too  */
+  if (value == 0.0)
+    value = 0.0;
+
+  return g_double_hash (&value);
+}
+
+static guint
+gimp_brush_cache_unit_hash (GimpBrushCacheUnit *unit)
+{
+  guint hash;
+
+  hash = unit->width * 31 + unit->height;
+
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->scale);
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->aspect_ratio);
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->angle);
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->hardness);
+  hash = hash * 31 + (unit->reflect ? 1 : 0);
+  hash = hash * 31 + g_direct_hash (unit->op);
+
+  return hash;
+}
+
+static gboolean
+gimp_brush_cache_unit_equal (GimpBrushCacheUnit *unit1,
+                             GimpBrushCacheUnit *unit2)
+{
+  return (unit1->width        == unit2->width        &&
+          unit1->height       == unit2->height       &&
+          unit1->scale        == unit2->scale        &&
+          unit1->aspect_ratio == unit2->aspect_ratio &&
+          unit1->angle        == unit2->angle        &&
+          unit1->reflect      == unit2->reflect      &&
+          unit1->hardness     == unit2->hardness     &&
+          unit1->op           == unit2->op);
+}
+
+static void
+gimp_brush_cache_remove_unit (GimpBrushCache     *cache,
+                              GimpBrushCacheUnit *unit)
+{
+  g_hash_table_remove (cache->units, unit);
+  g_queue_unlink (&cache->lru, &unit->link);
+
+  cache->size -= unit->size;
+
+  cache->data_destroy (unit->data);
+  g_slice_free (GimpBrushCacheUnit, unit);
+}
+
 
 /*  public functions  */
 
 GimpBrushCache *
-gimp_brush_cache_new (GDestroyNotify  data_destroy,
-                      gchar           debug_hit,
-                      gchar           debug_miss)
+gimp_brush_cache_new (GDestroyNotify          data_destroy,
+                      GimpBrushCacheSizeFunc  data_size,
+                      gchar                   debug_hit,
+                      gchar                   debug_miss)
 {
   GimpBrushCache *cache;
 
   g_return_val_if_fail (data_destroy != NULL, NULL);
+  g_return_val_if_fail (data_size != NULL, NULL);
 
   cache =  g_object_new (GIMP_TYPE_BRUSH_CACHE,
                          "data-destroy", data_destroy,
+                         "data-size",    data_size,
                          NULL);
 
   cache->debug_hit  = debug_hit;
@@ -183,20 +323,52 @@ gimp_brush_cache_clear (GimpBrushCache *cache)
 {
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
 
-  if (cache->cached_units)
-    {
-      GList *iter;
+  while (cache->lru.head)
+    gimp_brush_cache_remove_unit (cache, cache->lru.head->data);
+}
 
-      for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-        {
-          GimpBrushCacheUnit *unit = iter->data;
+/*  rounds the transform parameters so that transforms which differ by
+ *  less than what is visible at the brush's size share a cache unit.
+ *  'size' is the larger dimension of the untransformed brush.  the
+ *  identity transform, and rotations by multiples of a quarter turn,
+ *  are preserved exactly.
+ */
+void
+gimp_brush_cache_quantize (gint     size,
+                           gdouble *scale,
+                           gdouble *aspect_ratio,
+                           gdouble *angle,
+                           gdouble *hardness)
+{
+  gdouble extent;
+  gdouble n;
 
-          cache->data_destroy (unit->data);
-        }
+  g_return_if_fail (scale != NULL);
+  g_return_if_fail (aspect_ratio != NULL);
+  g_return_if_fail (angle != NULL);
+  g_return_if_fail (hardness != NULL);
 
-      g_list_free_full (cache->cached_units, g_free);
-      cache->cached_units = NULL;
-    }
+  size = MAX (size, 1);
+
+  /*  the transformed size, in steps  */
+  extent = RINT (*scale * size / QUANTIZE_STEP);
+  extent = MAX (extent, 1.0) * QUANTIZE_STEP;
+
+  *scale = extent / size;
+
+  /*  each unit of aspect ratio squeezes the brush by 1/20 of its size  */
+  n = ceil (extent / (20.0 * QUANTIZE_STEP));
+
+  *aspect_ratio = RINT (*aspect_ratio * n) / n;
+
+  /*  a multiple of four steps per turn, the corners of the brush move by
+   *  at most one step
+   */
+  n = 4.0 * ceil (G_PI * extent * G_SQRT2 / (4.0 * QUANTIZE_STEP));
+
+  *angle = RINT (*angle * n) / n;
+
+  *hardness = RINT (*hardness * HARDNESS_STEPS) / HARDNESS_STEPS;
 }
 
 gconstpointer
@@ -210,36 +382,32 @@ gimp_brush_cache_get (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList *iter;
+  GimpBrushCacheUnit  key;
+  GimpBrushCacheUnit *unit;
 
   g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
+  key.width        = width;
+  key.height       = height;
+  key.scale        = scale;
+  key.aspect_ratio = aspect_ratio;
+  key.angle        = angle;
+  key.reflect      = reflect;
+  key.hardness     = hardness;
+  key.op           = op;
+
+  unit = g_hash_table_lookup (cache->units, &key);
+
+  if (unit)
     {
-      GimpBrushCacheUnit *unit = iter->data;
-
-      if (unit->data                         &&
-          unit->width        == width        &&
-          unit->height       == height       &&
-          unit->scale        == scale        &&
-          unit->aspect_ratio == aspect_ratio &&
-          unit->angle        == angle        &&
-          unit->reflect      == reflect      &&
-          unit->hardness     == hardness     &&
-          unit->op           == op)
-        {
-          if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-            g_printerr ("%c", cache->debug_hit);
+      if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
+        g_printerr ("%c", cache->debug_hit);
 
-          /* Make the returned cached brush first in the list. */
-          cache->cached_units = g_list_remove_link (cache->cached_units, iter);
-          iter->next = cache->cached_units;
-          if (cache->cached_units)
-            cache->cached_units->prev = iter;
-          cache->cached_units = iter;
+      /* Make the returned cached brush the most recently used one. */
+      g_queue_unlink (&cache->lru, &unit->link);
+      g_queue_push_head_link (&cache->lru, &unit->link);
 
-          return (gconstpointer) unit->data;
-        }
+      return (gconstpointer) unit->data;
     }
 
   if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
@@ -260,37 +428,17 @@ gimp_brush_cache_add (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList              *iter;
   GimpBrushCacheUnit *unit;
-  GList              *last   = NULL;
-  gint                length = 0;
 
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
   g_return_if_fail (data != NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-    {
-      unit = iter->data;
-
-      if (data == unit->data)
-        return;
-
-      length++;
-      last = iter;
-    }
-
-  if (length > MAX_CACHED_DATA)
-    {
-      unit = last->data;
-
-      cache->data_destroy (unit->data);
-      cache->cached_units = g_list_delete_link (cache->cached_units, last);
-      g_free (unit);
-    }
-
-  unit = g_new0 (GimpBrushCacheUnit, 1);
+  unit = g_slice_new0 (GimpBrushCacheUnit);
 
   unit->data         = data;
+  unit->size         = sizeof (GimpBrushCacheUnit) + cache->data_size (data);
+  unit->link.data    = unit;
+
   unit->width        = width;
   unit->height       = height;
   unit->scale        = scale;
@@ -300,5 +448,30 @@ gimp_brush_cache_add (GimpBrushCache *cache,
   unit->hardness     = hardness;
   unit->op           = op;
 
-  cache->cached_units = g_list_prepend (cache->cached_units, unit);
+  if (g_hash_table_contains (cache->units, unit))
+    {
+      GimpBrushCacheUnit *old = g_hash_table_lookup (cache->units, unit);
+
+      if (old->data == data)
+        {
+          g_slice_free (GimpBrushCacheUnit, unit);
+          return;
+        }
+
+      gimp_brush_cache_remove_unit (cache, old);
+    }
+
+  g_hash_table_add (cache->units, unit);
+  g_queue_push_head_link (&cache->lru, &unit->link);
+
+  cache->size += unit->size;
+
+  /*  evict the least recently used units, but never the one just added,
+   *  the caller is about to use it
+   */
+  while (cache->size > cache->max_size &&
+         cache->lru.length > 1)
+    {
+      gimp_brush_cache_remove_unit (cache, cache->lru.tail->data);
+    }
 }
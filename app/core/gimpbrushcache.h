@@ -33,18 +33,28 @@
 #define GIMP_BRUSH_CACHE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIMP_TYPE_BRUSH_CACHE, GimpBrushCacheClass))
 
 
+#define GIMP_BRUSH_CACHE_DEFAULT_MAX_SIZE (16 * 1024 * 1024)
+
+
+typedef gsize (* GimpBrushCacheSizeFunc) (gconstpointer data);
+
+
 typedef struct _GimpBrushCacheClass GimpBrushCacheClass;
 
 struct _GimpBrushCache
 {
-  GimpObject      parent_instance;
+  GimpObject              parent_instance;
 
-  GDestroyNotify  data_destroy;
+  GDestroyNotify          data_destroy;
+  GimpBrushCacheSizeFunc  data_size;
+  gint64                  max_size;
 
-  GList          *cached_units;
+  GHashTable             *units;
+  GQueue                  lru;
+  gint64                  size;
 
-  gchar           debug_hit;
-  gchar           debug_miss;
+  gchar                   debug_hit;
+  gchar                   debug_miss;
 };
 
 struct _GimpBrushCacheClass
@@ -55,12 +65,19 @@ struct _GimpBrushCacheClass
 
 GType            gimp_brush_cache_get_type (void) G_GNUC_CONST;
 
-GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify  data_destory,
-                                            gchar           debug_hit,
-                                            gchar           debug_miss);
+GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify          data_destory,
+                                            GimpBrushCacheSizeFunc  data_size,
+                                            gchar                   debug_hit,
+                                            gchar                   debug_miss);
 
 void             gimp_brush_cache_clear    (GimpBrushCache *cache);
 
+void             gimp_brush_cache_quantize (gint            size,
+                                            gdouble        *scale,
+                                            gdouble        *aspect_ratio,
+                                            gdouble        *angle,
+                                            gdouble        *hardness);
+
 gconstpointer    gimp_brush_cache_get      (GimpBrushCache *cache,
                                             GeglNode       *op,
                                             gint            width,
@@ -31,6 +31,7 @@
 
 #include "gimpchannel.h"
 #include "gimpchannel-combine.h"
+#include "gimpspans.h"
 
 
 void
@@ -41,20 +42,38 @@ gimp_channel_combine_rect (GimpChannel    *mask,
                            gint            w,
                            gint            h)
 {
-  GeglBuffer *buffer;
+  GimpSpans *spans;
 
   g_return_if_fail (GIMP_IS_CHANNEL (mask));
 
-  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+  spans = gimp_channel_get_spans (mask);
 
-  if (! gimp_gegl_mask_combine_rect (buffer, op, x, y, w, h))
-    return;
+  if (spans)
+    {
+      if (! gimp_rectangle_intersect (x, y, w, h,
+                                      0, 0,
+                                      gimp_item_get_width  (GIMP_ITEM (mask)),
+                                      gimp_item_get_height (GIMP_ITEM (mask)),
+                                      &x, &y, &w, &h))
+        return;
 
-  gimp_rectangle_intersect (x, y, w, h,
-                            0, 0,
-                            gimp_item_get_width  (GIMP_ITEM (mask)),
-                            gimp_item_get_height (GIMP_ITEM (mask)),
-                            &x, &y, &w, &h);
+      gimp_spans_combine_rect (spans, op, x, y, w, h);
+
+      gimp_channel_spans_changed (mask, x, y, w, h);
+    }
+  else
+    {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+
+      if (! gimp_gegl_mask_combine_rect (buffer, op, x, y, w, h))
+        return;
+
+      gimp_rectangle_intersect (x, y, w, h,
+                                0, 0,
+                                gimp_item_get_width  (GIMP_ITEM (mask)),
+                                gimp_item_get_height (GIMP_ITEM (mask)),
+                                &x, &y, &w, &h);
+    }
 
   /*  Determine new boundary  */
   if (mask->bounds_known && (op == GIMP_CHANNEL_OP_ADD) && ! mask->empty)
@@ -151,23 +170,51 @@ gimp_channel_combine_ellipse_rect (GimpChannel    *mask,
                                    gdouble         b,
                                    gboolean        antialias)
 {
-  GeglBuffer *buffer;
+  GimpSpans *spans;
 
   g_return_if_fail (GIMP_IS_CHANNEL (mask));
   g_return_if_fail (a >= 0.0 && b >= 0.0);
   g_return_if_fail (op != GIMP_CHANNEL_OP_INTERSECT);
 
-  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+  /*  antialiased edges aren't binary, they go to the buffer, which
+   *  drops the spans
+   */
+  spans = antialias ? NULL : gimp_channel_get_spans (mask);
 
-  if (! gimp_gegl_mask_combine_ellipse_rect (buffer, op, x, y, w, h,
-                                             a, b, antialias))
-    return;
+  if (spans)
+    {
+      gint rx, ry, rw, rh;
 
-  gimp_rectangle_intersect (x, y, w, h,
-                            0, 0,
-                            gimp_item_get_width  (GIMP_ITEM (mask)),
-                            gimp_item_get_height (GIMP_ITEM (mask)),
-                            &x, &y, &w, &h);
+      if (! gimp_rectangle_intersect (x, y, w, h,
+                                      0, 0,
+                                      gimp_item_get_width  (GIMP_ITEM (mask)),
+                                      gimp_item_get_height (GIMP_ITEM (mask)),
+                                      &rx, &ry, &rw, &rh))
+        return;
+
+      gimp_spans_combine_ellipse_rect (spans, op, x, y, w, h, a, b);
+
+      x = rx;
+      y = ry;
+      w = rw;
+      h = rh;
+
+      gimp_channel_spans_changed (mask, x, y, w, h);
+    }
+  else
+    {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+
+      if (! gimp_gegl_mask_combine_ellipse_rect (buffer, op, x, y, w, h,
+                                                 a, b, antialias))
+        return;
+
+      gimp_rectangle_intersect (x, y, w, h,
+                                0, 0,
+                                gimp_item_get_width  (GIMP_ITEM (mask)),
+                                gimp_item_get_height (GIMP_ITEM (mask)),
+                                &x, &y, &w, &h);
+    }
 
   /*  determine new boundary  */
   if (mask->bounds_known && (op == GIMP_CHANNEL_OP_ADD) && ! mask->empty)
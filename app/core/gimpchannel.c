@@ -32,7 +32,7 @@
 #include "paint/gimppaintoptions.h"
 
 #include "gegl/gimp-gegl-apply-operation.h"
-#include "gegl/gimp-gegl-mask.h"
+#include "gegl/gimp-gegl-loops.h"
 #include "gegl/gimp-gegl-nodes.h"
 
 #include "gimp.h"
@@ -48,10 +48,13 @@
 #include "gimpchannel-select.h"
 #include "gimpcontext.h"
 #include "gimpdrawable-fill.h"
+#include "gimpdrawable-private.h"
 #include "gimpdrawable-stroke.h"
 #include "gimpmarshal.h"
+#include "gimpmasksummary.h"
 #include "gimppaintinfo.h"
 #include "gimppickable.h"
+#include "gimpspans.h"
 #include "gimpstrokeoptions.h"
 
 #include "gimp-intl.h"
@@ -60,10 +63,19 @@
 enum
 {
   COLOR_CHANGED,
+  BOUNDARY_CHANGED,
   LAST_SIGNAL
 };
 
 
+typedef struct
+{
+  GimpChannel     *channel;
+  GimpBoundaryJob *job_in;
+  GimpBoundaryJob *job_out;
+} GimpChannelTrace;
+
+
 static void gimp_channel_pickable_iface_init (GimpPickableInterface *iface);
 
 static void       gimp_channel_finalize      (GObject           *object);
@@ -151,6 +163,12 @@ static void       gimp_channel_convert_type  (GimpDrawable      *drawable,
                                               GeglDitherMethod   mask_dither_type,
                                               gboolean           push_undo,
                                               GimpProgress      *progress);
+static void       gimp_channel_update          (GimpDrawable       *drawable,
+                                                gint                x,
+                                                gint                y,
+                                                gint                width,
+                                                gint                height);
+static GeglBuffer * gimp_channel_get_buffer    (GimpDrawable       *drawable);
 static void gimp_channel_invalidate_boundary   (GimpDrawable       *drawable);
 static void gimp_channel_get_active_components (GimpDrawable       *drawable,
                                                 gboolean           *active);
@@ -213,6 +231,16 @@ static void       gimp_channel_real_flood    (GimpChannel         *channel,
 static void      gimp_channel_buffer_changed (GeglBuffer          *buffer,
                                               const GeglRectangle *rect,
                                               GimpChannel         *channel);
+static void      gimp_channel_flush_buffer_changed
+                                             (GimpChannel         *channel);
+
+static void      gimp_channel_trace_boundary (GimpChannel         *channel,
+                                              gint                 x1,
+                                              gint                 y1,
+                                              gint                 x2,
+                                              gint                 y2);
+static gpointer  gimp_channel_trace_thread   (GimpChannelTrace    *trace);
+static gboolean  gimp_channel_trace_idle     (GimpChannelTrace    *trace);
 
 
 G_DEFINE_TYPE_WITH_CODE (GimpChannel, gimp_channel, GIMP_TYPE_DRAWABLE,
@@ -243,6 +271,15 @@ gimp_channel_class_init (GimpChannelClass *klass)
                   gimp_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
 
+  channel_signals[BOUNDARY_CHANGED] =
+    g_signal_new ("boundary-changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_FIRST,
+                  G_STRUCT_OFFSET (GimpChannelClass, boundary_changed),
+                  NULL, NULL,
+                  gimp_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+
   object_class->finalize            = gimp_channel_finalize;
 
   gimp_object_class->get_memsize    = gimp_channel_get_memsize;
@@ -286,6 +323,8 @@ gimp_channel_class_init (GimpChannelClass *klass)
   item_class->lower_failed         = _("Channel cannot be lowered more.");
 
   drawable_class->convert_type          = gimp_channel_convert_type;
+  drawable_class->update                = gimp_channel_update;
+  drawable_class->get_buffer            = gimp_channel_get_buffer;
   drawable_class->invalidate_boundary   = gimp_channel_invalidate_boundary;
   drawable_class->get_active_components = gimp_channel_get_active_components;
   drawable_class->get_active_mask       = gimp_channel_get_active_mask;
@@ -333,6 +372,10 @@ gimp_channel_init (GimpChannel *channel)
   channel->y1             = 0;
   channel->x2             = 0;
   channel->y2             = 0;
+
+  channel->boundary_cache_in  = gimp_boundary_cache_new ();
+  channel->boundary_cache_out = gimp_boundary_cache_new ();
+  channel->mask_summary       = gimp_mask_summary_new ();
 }
 
 static void
@@ -358,6 +401,12 @@ gimp_channel_finalize (GObject *object)
       channel->segs_out = NULL;
     }
 
+  g_clear_pointer (&channel->boundary_cache_in,  gimp_boundary_cache_free);
+  g_clear_pointer (&channel->boundary_cache_out, gimp_boundary_cache_free);
+  g_clear_pointer (&channel->mask_summary,       gimp_mask_summary_free);
+
+  g_clear_pointer (&channel->spans, gimp_spans_free);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -366,11 +415,18 @@ gimp_channel_get_memsize (GimpObject *object,
                           gint64     *gui_size)
 {
   GimpChannel *channel = GIMP_CHANNEL (object);
+  gint64       memsize = 0;
+
+  if (channel->spans)
+    memsize += gimp_spans_get_memsize (channel->spans);
+
+  memsize += gimp_mask_summary_get_memsize (channel->mask_summary);
 
   *gui_size += channel->num_segs_in  * sizeof (GimpBoundSeg);
   *gui_size += channel->num_segs_out * sizeof (GimpBoundSeg);
 
-  return GIMP_OBJECT_CLASS (parent_class)->get_memsize (object, gui_size);
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
 }
 
 static gchar *
@@ -483,15 +539,28 @@ gimp_channel_bounds (GimpItem *item,
 {
   GimpChannel *channel = GIMP_CHANNEL (item);
 
-  if (! channel->bounds_known)
+  gimp_channel_flush_buffer_changed (channel);
+
+  if (! channel->bounds_known && channel->spans)
+    {
+      channel->empty = ! gimp_spans_bounds (channel->spans,
+                                            &channel->x1,
+                                            &channel->y1,
+                                            &channel->x2,
+                                            &channel->y2);
+
+      channel->bounds_known = TRUE;
+    }
+  else if (! channel->bounds_known)
     {
       GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-      channel->empty = ! gimp_gegl_mask_bounds (buffer,
-                                                &channel->x1,
-                                                &channel->y1,
-                                                &channel->x2,
-                                                &channel->y2);
+      channel->empty = ! gimp_mask_summary_bounds (channel->mask_summary,
+                                                   buffer,
+                                                   &channel->x1,
+                                                   &channel->y1,
+                                                   &channel->x2,
+                                                   &channel->y2);
 
       channel->bounds_known = TRUE;
     }
@@ -941,9 +1010,9 @@ gimp_channel_convert_type (GimpDrawable     *drawable,
 
   if (mask_dither_type == GEGL_DITHER_NONE)
     {
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
-                        GEGL_ABYSS_NONE,
-                        dest_buffer, NULL);
+      gimp_gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
+                             GEGL_ABYSS_NONE,
+                             dest_buffer, NULL);
     }
   else
     {
@@ -961,6 +1030,53 @@ gimp_channel_convert_type (GimpDrawable     *drawable,
   g_object_unref (dest_buffer);
 }
 
+static void
+gimp_channel_update (GimpDrawable *drawable,
+                     gint          x,
+                     gint          y,
+                     gint          width,
+                     gint          height)
+{
+  GimpChannel *channel = GIMP_CHANNEL (drawable);
+
+  /*  whoever changed the buffer is done with it now  */
+  gimp_channel_flush_buffer_changed (channel);
+
+  GIMP_DRAWABLE_CLASS (parent_class)->update (drawable, x, y, width, height);
+}
+
+/*  a channel with spans renders them into its buffer only once the
+ *  buffer is actually asked for
+ */
+static GeglBuffer *
+gimp_channel_get_buffer (GimpDrawable *drawable)
+{
+  GimpChannel *channel = GIMP_CHANNEL (drawable);
+  GeglBuffer  *buffer;
+
+  buffer = GIMP_DRAWABLE_CLASS (parent_class)->get_buffer (drawable);
+
+  if (channel->spans_dirty && buffer)
+    {
+      channel->spans_dirty = FALSE;
+
+      /*  writing the spans doesn't change the mask, don't let the
+       *  "changed" handler drop them
+       */
+      g_signal_handlers_block_by_func (buffer,
+                                       gimp_channel_buffer_changed,
+                                       channel);
+
+      gimp_spans_render (channel->spans, buffer);
+
+      g_signal_handlers_unblock_by_func (buffer,
+                                         gimp_channel_buffer_changed,
+                                         channel);
+    }
+
+  return buffer;
+}
+
 static void
 gimp_channel_invalidate_boundary (GimpDrawable *drawable)
 {
@@ -997,6 +1113,8 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
   GimpChannel *channel    = GIMP_CHANNEL (drawable);
   GeglBuffer  *old_buffer = gimp_drawable_get_buffer (drawable);
 
+  gimp_channel_flush_buffer_changed (channel);
+
   if (old_buffer)
     {
       g_signal_handlers_disconnect_by_func (old_buffer,
@@ -1013,6 +1131,14 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
                               G_CALLBACK (gimp_channel_buffer_changed),
                               channel);
 
+  /*  the old buffer got the spans rendered above, if it was needed  */
+  g_clear_pointer (&channel->spans, gimp_spans_free);
+  channel->spans_dirty = FALSE;
+
+  gimp_boundary_cache_invalidate (channel->boundary_cache_in,  NULL);
+  gimp_boundary_cache_invalidate (channel->boundary_cache_out, NULL);
+  gimp_mask_summary_invalidate   (channel->mask_summary,       NULL);
+
   if (gimp_filter_peek_node (GIMP_FILTER (channel)))
     {
       const Babl *color_format;
@@ -1036,15 +1162,22 @@ gimp_channel_get_opacity_at (GimpPickable *pickable,
   GimpChannel *channel = GIMP_CHANNEL (pickable);
   gdouble      value   = GIMP_OPACITY_TRANSPARENT;
 
+  gimp_channel_flush_buffer_changed (channel);
+
   if (x >= 0 && x < gimp_item_get_width  (GIMP_ITEM (channel)) &&
       y >= 0 && y < gimp_item_get_height (GIMP_ITEM (channel)))
     {
-      if (! channel->bounds_known ||
-          (! channel->empty &&
-           x >= channel->x1 &&
-           x <  channel->x2 &&
-           y >= channel->y1 &&
-           y <  channel->y2))
+      if (channel->spans)
+        {
+          if (gimp_spans_get_value (channel->spans, x, y))
+            value = GIMP_OPACITY_OPAQUE;
+        }
+      else if (! channel->bounds_known ||
+               (! channel->empty &&
+                x >= channel->x1 &&
+                x <  channel->x2 &&
+                y >= channel->y1 &&
+                y <  channel->y2))
         {
           gegl_buffer_sample (gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
                               x, y, NULL, &value, babl_format ("Y double"),
@@ -1066,59 +1199,33 @@ gimp_channel_real_boundary (GimpChannel         *channel,
                             gint                 x2,
                             gint                 y2)
 {
+  gimp_channel_flush_buffer_changed (channel);
+
   if (! channel->boundary_known)
     {
       gint x3, y3, x4, y4;
 
-      /* free the out of date boundary segments */
-      g_free (channel->segs_in);
-      g_free (channel->segs_out);
-
       if (gimp_item_bounds (GIMP_ITEM (channel), &x3, &y3, &x4, &y4))
         {
-          GeglBuffer    *buffer;
-          GeglRectangle  rect = { x3, y3, x4, y4 };
-
-          x4 += x3;
-          y4 += y3;
-
-          buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
-
-          channel->segs_out = gimp_boundary_find (buffer, &rect,
-                                                  babl_format ("Y float"),
-                                                  GIMP_BOUNDARY_IGNORE_BOUNDS,
-                                                  x1, y1, x2, y2,
-                                                  GIMP_BOUNDARY_HALF_WAY_LINEAR,
-                                                  &channel->num_segs_out);
-          x1 = MAX (x1, x3);
-          y1 = MAX (y1, y3);
-          x2 = MIN (x2, x4);
-          y2 = MIN (y2, y4);
-
-          if (x2 > x1 && y2 > y1)
-            {
-              channel->segs_in = gimp_boundary_find (buffer, NULL,
-                                                     babl_format ("Y float"),
-                                                     GIMP_BOUNDARY_WITHIN_BOUNDS,
-                                                     x1, y1, x2, y2,
-                                                     GIMP_BOUNDARY_HALF_WAY_LINEAR,
-                                                     &channel->num_segs_in);
-            }
-          else
-            {
-              channel->segs_in     = NULL;
-              channel->num_segs_in = 0;
-            }
+          /*  sets boundary_known, unless the trace runs in the
+           *  background, in which case the out of date boundary
+           *  segments are returned meanwhile
+           */
+          gimp_channel_trace_boundary (channel, x1, y1, x2, y2);
         }
       else
         {
+          /* free the out of date boundary segments */
+          g_free (channel->segs_in);
+          g_free (channel->segs_out);
+
           channel->segs_in      = NULL;
           channel->segs_out     = NULL;
           channel->num_segs_in  = 0;
           channel->num_segs_out = 0;
-        }
 
-      channel->boundary_known = TRUE;
+          channel->boundary_known = TRUE;
+        }
     }
 
   *segs_in      = channel->segs_in;
@@ -1134,13 +1241,23 @@ gimp_channel_real_is_empty (GimpChannel *channel)
 {
   GeglBuffer *buffer;
 
+  gimp_channel_flush_buffer_changed (channel);
+
   if (channel->bounds_known)
     return channel->empty;
 
-  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
+  if (channel->spans)
+    {
+      if (! gimp_spans_is_empty (channel->spans))
+        return FALSE;
+    }
+  else
+    {
+      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-  if (! gimp_gegl_mask_is_empty (buffer))
-    return FALSE;
+      if (! gimp_mask_summary_is_empty (channel->mask_summary, buffer))
+        return FALSE;
+    }
 
   /*  The mask is empty, meaning we can set the bounds as known  */
   if (channel->segs_in)
@@ -1226,6 +1343,9 @@ gimp_channel_real_clear (GimpChannel *channel,
                          const gchar *undo_desc,
                          gboolean     push_undo)
 {
+  gint width  = gimp_item_get_width  (GIMP_ITEM (channel));
+  gint height = gimp_item_get_height (GIMP_ITEM (channel));
+
   if (push_undo)
     {
       if (! undo_desc)
@@ -1234,18 +1354,10 @@ gimp_channel_real_clear (GimpChannel *channel,
       gimp_channel_push_undo (channel, undo_desc);
     }
 
-  if (channel->bounds_known && ! channel->empty)
-    {
-      gegl_buffer_clear (gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
-                         GEGL_RECTANGLE (channel->x1, channel->y1,
-                                         channel->x2 - channel->x1,
-                                         channel->y2 - channel->y1));
-    }
-  else
-    {
-      gegl_buffer_clear (gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
-                         NULL);
-    }
+  /*  start over with empty spans, the buffer is cleared when it's
+   *  needed
+   */
+  gimp_channel_set_spans (channel, gimp_spans_new (width, height));
 
   /*  we know the bounds  */
   channel->bounds_known = TRUE;
@@ -1262,17 +1374,20 @@ static void
 gimp_channel_real_all (GimpChannel *channel,
                        gboolean     push_undo)
 {
-  GeglColor *color;
+  GimpSpans *spans;
+  gint       width  = gimp_item_get_width  (GIMP_ITEM (channel));
+  gint       height = gimp_item_get_height (GIMP_ITEM (channel));
 
   if (push_undo)
     gimp_channel_push_undo (channel,
                             GIMP_CHANNEL_GET_CLASS (channel)->all_desc);
 
-  /*  clear the channel  */
-  color = gegl_color_new ("#fff");
-  gegl_buffer_set_color (gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
-                         NULL, color);
-  g_object_unref (color);
+  /*  fill the channel  */
+  spans = gimp_spans_new (width, height);
+  gimp_spans_combine_rect (spans, GIMP_CHANNEL_OP_REPLACE,
+                           0, 0, width, height);
+
+  gimp_channel_set_spans (channel, spans);
 
   /*  we know the bounds  */
   channel->bounds_known = TRUE;
@@ -1518,12 +1633,224 @@ gimp_channel_real_flood (GimpChannel *channel,
   gimp_drawable_update (GIMP_DRAWABLE (channel), x, y, width, height);
 }
 
+/*  this runs on whichever thread writes the buffer, possibly on
+ *  several of them at once.  the caches can be invalidated from any
+ *  thread, everything else is left to
+ *  gimp_channel_flush_buffer_changed(), on the main thread
+ */
 static void
 gimp_channel_buffer_changed (GeglBuffer          *buffer,
                              const GeglRectangle *rect,
                              GimpChannel         *channel)
 {
-  gimp_drawable_invalidate_boundary (GIMP_DRAWABLE (channel));
+  gimp_boundary_cache_invalidate (channel->boundary_cache_in,  rect);
+  gimp_boundary_cache_invalidate (channel->boundary_cache_out, rect);
+  gimp_mask_summary_invalidate   (channel->mask_summary,       rect);
+
+  g_atomic_int_set (&channel->buffer_changed, TRUE);
+}
+
+static void
+gimp_channel_flush_buffer_changed (GimpChannel *channel)
+{
+  if (g_atomic_int_compare_and_exchange (&channel->buffer_changed,
+                                         TRUE, FALSE))
+    {
+      /*  the pixels were changed behind the spans' back, the buffer
+       *  is the mask from now on
+       */
+      g_clear_pointer (&channel->spans, gimp_spans_free);
+      channel->spans_dirty = FALSE;
+
+      gimp_drawable_invalidate_boundary (GIMP_DRAWABLE (channel));
+    }
+}
+
+/*  traces the boundary using the channel's caches, so that only the
+ *  bands of the mask which changed since the last trace are traced
+ *  again.  if the boundary was asked for using
+ *  gimp_channel_boundary_async(), and there are bands to trace, they
+ *  are traced in a thread and "boundary-changed" is emitted when done.
+ */
+static void
+gimp_channel_trace_boundary (GimpChannel *channel,
+                             gint         x1,
+                             gint         y1,
+                             gint         x2,
+                             gint         y2)
+{
+  GeglBuffer      *buffer;
+  GimpBoundaryJob *job_in  = NULL;
+  GimpBoundaryJob *job_out;
+  GimpBoundSeg    *segs_in = NULL;
+  GimpBoundSeg    *segs_out;
+  gint             num_segs_in = 0;
+  gint             num_segs_out;
+  gint             x3, y3, x4, y4;
+  gboolean         complete;
+
+  /*  spans are traced directly, and quickly, one span end at a time  */
+  if (channel->spans)
+    {
+      g_free (channel->segs_in);
+      g_free (channel->segs_out);
+
+      x3 = MAX (x1, 0);
+      y3 = MAX (y1, 0);
+      x4 = MIN (x2, gimp_item_get_width  (GIMP_ITEM (channel)));
+      y4 = MIN (y2, gimp_item_get_height (GIMP_ITEM (channel)));
+
+      channel->segs_out = gimp_boundary_find_spans (channel->spans,
+                                                    GIMP_BOUNDARY_IGNORE_BOUNDS,
+                                                    x1, y1, x2, y2,
+                                                    &channel->num_segs_out);
+
+      if (x4 > x3 && y4 > y3)
+        {
+          channel->segs_in = gimp_boundary_find_spans (channel->spans,
+                                                       GIMP_BOUNDARY_WITHIN_BOUNDS,
+                                                       x3, y3, x4, y4,
+                                                       &channel->num_segs_in);
+        }
+      else
+        {
+          channel->segs_in     = NULL;
+          channel->num_segs_in = 0;
+        }
+
+      channel->boundary_known = TRUE;
+
+      return;
+    }
+
+  /*  the running trace will emit "boundary-changed" anyway  */
+  if (channel->boundary_async && channel->boundary_tracing)
+    return;
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
+
+  /*  clip the inside boundary to the buffer rather than to the mask
+   *  bounds, which gives the same segments but doesn't change the
+   *  cache's parameters whenever the mask bounds change
+   */
+  x3 = MAX (x1, 0);
+  y3 = MAX (y1, 0);
+  x4 = MIN (x2, gegl_buffer_get_width  (buffer));
+  y4 = MIN (y2, gegl_buffer_get_height (buffer));
+
+  /*  the thread traces a copy-on-write snapshot of the mask  */
+  if (channel->boundary_async)
+    buffer = gegl_buffer_dup (buffer);
+  else
+    g_object_ref (buffer);
+
+  job_out = gimp_boundary_cache_begin (channel->boundary_cache_out,
+                                       buffer, NULL,
+                                       babl_format ("Y float"),
+                                       GIMP_BOUNDARY_IGNORE_BOUNDS,
+                                       x1, y1, x2, y2,
+                                       GIMP_BOUNDARY_HALF_WAY_LINEAR);
+
+  if (x4 > x3 && y4 > y3)
+    job_in = gimp_boundary_cache_begin (channel->boundary_cache_in,
+                                        buffer, NULL,
+                                        babl_format ("Y float"),
+                                        GIMP_BOUNDARY_WITHIN_BOUNDS,
+                                        x3, y3, x4, y4,
+                                        GIMP_BOUNDARY_HALF_WAY_LINEAR);
+
+  g_object_unref (buffer);
+
+  if (channel->boundary_async &&
+      (gimp_boundary_job_get_n_bands (job_out) > 0 ||
+       (job_in && gimp_boundary_job_get_n_bands (job_in) > 0)))
+    {
+      GimpChannelTrace *trace = g_slice_new (GimpChannelTrace);
+
+      trace->channel = g_object_ref (channel);
+      trace->job_in  = job_in;
+      trace->job_out = job_out;
+
+      channel->boundary_tracing = TRUE;
+
+      g_thread_unref (g_thread_new ("boundary",
+                                    (GThreadFunc) gimp_channel_trace_thread,
+                                    trace));
+
+      return;
+    }
+
+  gimp_boundary_job_run (job_out);
+
+  complete = gimp_boundary_cache_end (channel->boundary_cache_out, job_out,
+                                      &segs_out, &num_segs_out);
+
+  if (job_in)
+    {
+      gimp_boundary_job_run (job_in);
+
+      complete &= gimp_boundary_cache_end (channel->boundary_cache_in, job_in,
+                                           &segs_in, &num_segs_in);
+    }
+
+  if (complete)
+    {
+      g_free (channel->segs_in);
+      g_free (channel->segs_out);
+
+      channel->segs_in      = segs_in;
+      channel->segs_out     = segs_out;
+      channel->num_segs_in  = num_segs_in;
+      channel->num_segs_out = num_segs_out;
+
+      channel->boundary_known = TRUE;
+    }
+  else
+    {
+      g_free (segs_in);
+      g_free (segs_out);
+    }
+}
+
+static gpointer
+gimp_channel_trace_thread (GimpChannelTrace *trace)
+{
+  gimp_boundary_job_run (trace->job_out);
+
+  if (trace->job_in)
+    gimp_boundary_job_run (trace->job_in);
+
+  g_idle_add ((GSourceFunc) gimp_channel_trace_idle, trace);
+
+  return NULL;
+}
+
+static gboolean
+gimp_channel_trace_idle (GimpChannelTrace *trace)
+{
+  GimpChannel *channel = trace->channel;
+
+  /*  only store the traced bands in the caches, the boundary is
+   *  assembled when it's asked for again, with the bounds it's
+   *  asked for then
+   */
+  gimp_boundary_cache_end (channel->boundary_cache_out, trace->job_out,
+                           NULL, NULL);
+
+  if (trace->job_in)
+    gimp_boundary_cache_end (channel->boundary_cache_in, trace->job_in,
+                             NULL, NULL);
+
+  channel->boundary_tracing = FALSE;
+
+  if (! channel->boundary_known)
+    g_signal_emit (channel, channel_signals[BOUNDARY_CHANGED], 0);
+
+  g_object_unref (channel);
+
+  g_slice_free (GimpChannelTrace, trace);
+
+  return G_SOURCE_REMOVE;
 }
 
 
@@ -1798,6 +2125,107 @@ gimp_channel_push_undo (GimpChannel *channel,
                              undo_desc, channel);
 }
 
+/**
+ * gimp_channel_get_spans:
+ * @channel: a #GimpChannel
+ *
+ * Returns: the spans @channel is made of, or %NULL if its buffer is
+ *          all there is.  Change them in place, followed by a call to
+ *          gimp_channel_spans_changed().
+ **/
+GimpSpans *
+gimp_channel_get_spans (GimpChannel *channel)
+{
+  g_return_val_if_fail (GIMP_IS_CHANNEL (channel), NULL);
+
+  gimp_channel_flush_buffer_changed (channel);
+
+  return channel->spans;
+}
+
+/**
+ * gimp_channel_set_spans:
+ * @channel: a #GimpChannel
+ * @spans:   the new content of @channel, or %NULL
+ *
+ * Replaces the content of @channel by @spans, which @channel takes
+ * ownership of.  The buffer is rendered only when it's asked for.
+ * Passing %NULL renders the current spans and lets @channel forget
+ * about them.
+ **/
+void
+gimp_channel_set_spans (GimpChannel *channel,
+                        GimpSpans   *spans)
+{
+  g_return_if_fail (GIMP_IS_CHANNEL (channel));
+  g_return_if_fail (spans == NULL ||
+                    (gimp_spans_get_width  (spans) ==
+                     gimp_item_get_width  (GIMP_ITEM (channel)) &&
+                     gimp_spans_get_height (spans) ==
+                     gimp_item_get_height (GIMP_ITEM (channel))));
+
+  gimp_channel_flush_buffer_changed (channel);
+
+  if (! spans)
+    {
+      if (channel->spans)
+        {
+          gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
+
+          g_clear_pointer (&channel->spans, gimp_spans_free);
+        }
+
+      return;
+    }
+
+  if (channel->spans)
+    gimp_spans_free (channel->spans);
+
+  channel->spans = spans;
+
+  gimp_channel_spans_changed (channel, 0, 0,
+                              gimp_spans_get_width  (spans),
+                              gimp_spans_get_height (spans));
+}
+
+/**
+ * gimp_channel_spans_changed:
+ * @channel: a #GimpChannel with spans
+ * @x:       the x coordinate of the changed area
+ * @y:       the y coordinate of the changed area
+ * @width:   the width of the changed area
+ * @height:  the height of the changed area
+ *
+ * Tells @channel its spans were changed.  This invalidates the bounds
+ * and boundary, like a change to the buffer would.  If the buffer is
+ * part of a graph, it's brought up to date right away, otherwise
+ * when it's next asked for.
+ **/
+void
+gimp_channel_spans_changed (GimpChannel *channel,
+                            gint         x,
+                            gint         y,
+                            gint         width,
+                            gint         height)
+{
+  g_return_if_fail (GIMP_IS_CHANNEL (channel));
+  g_return_if_fail (channel->spans != NULL);
+
+  channel->spans_dirty = TRUE;
+
+  gimp_boundary_cache_invalidate (channel->boundary_cache_in,
+                                  GEGL_RECTANGLE (x, y, width, height));
+  gimp_boundary_cache_invalidate (channel->boundary_cache_out,
+                                  GEGL_RECTANGLE (x, y, width, height));
+  gimp_mask_summary_invalidate   (channel->mask_summary,
+                                  GEGL_RECTANGLE (x, y, width, height));
+
+  gimp_drawable_invalidate_boundary (GIMP_DRAWABLE (channel));
+
+  if (GIMP_DRAWABLE (channel)->private->buffer_source_node)
+    gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
+}
+
 
 /******************************/
 /*  selection mask functions  */
@@ -1852,6 +2280,50 @@ gimp_channel_boundary (GimpChannel         *channel,
                                                      x2, y2);
 }
 
+/**
+ * gimp_channel_boundary_async:
+ * @channel: a #GimpChannel
+ *
+ * Like gimp_channel_boundary(), but if the boundary is out of date,
+ * traces it in the background and returns the out of date boundary
+ * meanwhile.  "boundary-changed" is emitted when the trace is done,
+ * after which the boundary should be asked for again.
+ *
+ * Return value: see gimp_channel_boundary().
+ **/
+gboolean
+gimp_channel_boundary_async (GimpChannel         *channel,
+                             const GimpBoundSeg **segs_in,
+                             const GimpBoundSeg **segs_out,
+                             gint                *num_segs_in,
+                             gint                *num_segs_out,
+                             gint                 x1,
+                             gint                 y1,
+                             gint                 x2,
+                             gint                 y2)
+{
+  gboolean retval;
+
+  g_return_val_if_fail (GIMP_IS_CHANNEL (channel), FALSE);
+  g_return_val_if_fail (segs_in != NULL, FALSE);
+  g_return_val_if_fail (segs_out != NULL, FALSE);
+  g_return_val_if_fail (num_segs_in != NULL, FALSE);
+  g_return_val_if_fail (num_segs_out != NULL, FALSE);
+
+  channel->boundary_async = TRUE;
+
+  retval = GIMP_CHANNEL_GET_CLASS (channel)->boundary (channel,
+                                                       segs_in, segs_out,
+                                                       num_segs_in,
+                                                       num_segs_out,
+                                                       x1, y1,
+                                                       x2, y2);
+
+  channel->boundary_async = FALSE;
+
+  return retval;
+}
+
 gboolean
 gimp_channel_is_empty (GimpChannel *channel)
 {
@@ -53,6 +53,16 @@ struct _GimpChannel
   gboolean      bounds_known;      /*  recalculate the bounds?        */
   gint          x1, y1;            /*  coordinates for bounding box   */
   gint          x2, y2;            /*  lower right hand coordinate    */
+
+  GimpBoundaryCache *boundary_cache_in;  /*  per-band boundary caches   */
+  GimpBoundaryCache *boundary_cache_out;
+  gboolean           boundary_tracing;   /*  a trace is running         */
+  gboolean           boundary_async;     /*  don't wait for the trace   */
+  GimpMaskSummary   *mask_summary;       /*  per-tile bounds            */
+
+  GimpSpans         *spans;              /*  the exact mask, or NULL    */
+  gboolean           spans_dirty;        /*  the buffer is out of date  */
+  gint               buffer_changed;     /*  atomic, see the handler    */
 };
 
 struct _GimpChannelClass
@@ -61,6 +71,7 @@ struct _GimpChannelClass
 
   /*  signals  */
   void     (* color_changed) (GimpChannel             *channel);
+  void     (* boundary_changed) (GimpChannel          *channel);
 
   /*  virtual functions  */
   gboolean (* boundary)      (GimpChannel             *channel,
@@ -159,6 +170,15 @@ void          gimp_channel_set_show_masked    (GimpChannel       *channel,
 void          gimp_channel_push_undo          (GimpChannel       *mask,
                                                const gchar       *undo_desc);
 
+GimpSpans   * gimp_channel_get_spans          (GimpChannel       *channel);
+void          gimp_channel_set_spans          (GimpChannel       *channel,
+                                               GimpSpans         *spans);
+void          gimp_channel_spans_changed      (GimpChannel       *channel,
+                                               gint               x,
+                                               gint               y,
+                                               gint               width,
+                                               gint               height);
+
 
 /*  selection mask functions  */
 
@@ -175,6 +195,15 @@ gboolean      gimp_channel_boundary           (GimpChannel            *mask,
                                                gint                    y1,
                                                gint                    x2,
                                                gint                    y2);
+gboolean      gimp_channel_boundary_async     (GimpChannel            *mask,
+                                               const GimpBoundSeg    **segs_in,
+                                               const GimpBoundSeg    **segs_out,
+                                               gint                   *num_segs_in,
+                                               gint                   *num_segs_out,
+                                               gint                    x1,
+                                               gint                    y1,
+                                               gint                    x2,
+                                               gint                    y2);
 gboolean      gimp_channel_is_empty           (GimpChannel            *mask);
 
 void          gimp_channel_feather            (GimpChannel            *mask,
@@ -20,6 +20,9 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -32,6 +35,7 @@
 #include "gimpmarshal.h"
 #include "gimptag.h"
 #include "gimptagged.h"
+#include "gimptempbuf.h"
 
 #include "gimp-intl.h"
 
@@ -42,6 +46,10 @@ enum
   LAST_SIGNAL
 };
 
+#define PREVIEW_CACHE_DIR   "previewcache"
+#define PREVIEW_CACHE_MAGIC "GIMP-DATA-PREVIEW-1"
+
+
 enum
 {
   PROP_0,
@@ -113,6 +121,12 @@ static GList    * gimp_data_get_tags          (GimpTagged          *tagged);
 static gchar    * gimp_data_get_identifier    (GimpTagged          *tagged);
 static gchar    * gimp_data_get_checksum      (GimpTagged          *tagged);
 
+static gchar    * gimp_data_get_preview_cache_key
+                                              (GimpData            *data,
+                                               gint                 width,
+                                               gint                 height,
+                                               GFile              **cache_file);
+
 
 static guint data_signals[LAST_SIGNAL] = { 0 };
 
@@ -1112,6 +1126,149 @@ gimp_data_get_mtime (GimpData *data)
   return private->mtime;
 }
 
+/**
+ * gimp_data_load_cached_preview:
+ * @data:   a #GimpData object
+ * @width:  the width the preview was requested with
+ * @height: the height the preview was requested with
+ *
+ * Looks up a preview of @data previously stored with
+ * gimp_data_save_cached_preview(), possibly in an earlier session.
+ * Cached previews are keyed on the data's file, name and the
+ * requested size, and are ignored once the file's mtime changes.
+ *
+ * Return value: the cached preview, or %NULL.
+ **/
+GimpTempBuf *
+gimp_data_load_cached_preview (GimpData *data,
+                               gint      width,
+                               gint      height)
+{
+  GimpTempBuf *temp_buf = NULL;
+  GFile       *cache_file;
+  gchar       *key;
+  gchar       *contents;
+  gsize        length;
+
+  g_return_val_if_fail (GIMP_IS_DATA (data), NULL);
+
+  key = gimp_data_get_preview_cache_key (data, width, height, &cache_file);
+
+  if (! key)
+    return NULL;
+
+  if (g_file_load_contents (cache_file, NULL, &contents, &length,
+                            NULL, NULL))
+    {
+      gsize key_len = strlen (key) + 1;
+
+      /*  the file starts with the key including its terminating zero,
+       *  then the preview's size and babl format, then the pixels
+       */
+      if (length > key_len && ! memcmp (contents, key, key_len))
+        {
+          gchar **header = g_strsplit (contents + key_len, "
+", 4);
+
+          if (g_strv_length (header) == 4)
+            {
+              gint        buf_width  = atoi (header[0]);
+              gint        buf_height = atoi (header[1]);
+              const Babl *format     = NULL;
+
+              if (babl_format_exists (header[2]))
+                format = babl_format (header[2]);
+
+              if (format && buf_width > 0 && buf_height > 0)
+                {
+                  gsize header_len = (strlen (header[0]) +
+                                      strlen (header[1]) +
+                                      strlen (header[2]) + 3);
+                  gsize data_len   = ((gsize) buf_width * buf_height *
+                                      babl_format_get_bytes_per_pixel (format));
+
+                  if (length == key_len + header_len + data_len)
+                    {
+                      temp_buf = gimp_temp_buf_new (buf_width, buf_height,
+                                                    format);
+
+                      memcpy (gimp_temp_buf_get_data (temp_buf),
+                              contents + key_len + header_len,
+                              data_len);
+                    }
+                }
+            }
+
+          g_strfreev (header);
+        }
+
+      g_free (contents);
+    }
+
+  g_object_unref (cache_file);
+  g_free (key);
+
+  return temp_buf;
+}
+
+/**
+ * gimp_data_save_cached_preview:
+ * @data:     a #GimpData object
+ * @width:    the width the preview was requested with
+ * @height:   the height the preview was requested with
+ * @temp_buf: the rendered preview
+ *
+ * Stores @temp_buf on disk, so gimp_data_load_cached_preview() can
+ * return it without rendering it again.  Does nothing for data that
+ * isn't backed by an unmodified file.
+ **/
+void
+gimp_data_save_cached_preview (GimpData          *data,
+                               gint               width,
+                               gint               height,
+                               const GimpTempBuf *temp_buf)
+{
+  GFile       *cache_file;
+  GFile       *cache_dir;
+  gchar       *key;
+  GString     *contents;
+  const Babl  *format;
+
+  g_return_if_fail (GIMP_IS_DATA (data));
+  g_return_if_fail (temp_buf != NULL);
+
+  key = gimp_data_get_preview_cache_key (data, width, height, &cache_file);
+
+  if (! key)
+    return;
+
+  format = gimp_temp_buf_get_format (temp_buf);
+
+  contents = g_string_new (NULL);
+
+  g_string_append_len (contents, key, strlen (key) + 1);
+  g_string_append_printf (contents, "%d\n%d\n%s\n",
+                          gimp_temp_buf_get_width  (temp_buf),
+                          gimp_temp_buf_get_height (temp_buf),
+                          babl_get_name (format));
+  g_string_append_len (contents,
+                       (const gchar *) gimp_temp_buf_get_data (temp_buf),
+                       gimp_temp_buf_get_data_size (temp_buf));
+
+  cache_dir = g_file_get_parent (cache_file);
+  g_file_make_directory (cache_dir, NULL, NULL);
+  g_object_unref (cache_dir);
+
+  /*  the cache is only an optimization, ignore errors  */
+  g_file_replace_contents (cache_file, contents->str, contents->len,
+                           NULL, FALSE, G_FILE_CREATE_NONE,
+                           NULL, NULL, NULL);
+
+  g_string_free (contents, TRUE);
+  g_object_unref (cache_file);
+  g_free (key);
+}
+
 gboolean
 gimp_data_is_copyable (GimpData *data)
 {
@@ -1255,6 +1412,53 @@ gimp_data_compare (GimpData *data1,
   return GIMP_DATA_GET_CLASS (data1)->compare (data1, data2);
 }
 
+static gchar *
+gimp_data_get_preview_cache_key (GimpData  *data,
+                                 gint       width,
+                                 gint       height,
+                                 GFile    **cache_file)
+{
+  GimpDataPrivate *private = GIMP_DATA_GET_PRIVATE (data);
+  gchar           *uri;
+  gchar           *key;
+  gchar           *checksum;
+  gchar           *basename;
+
+  if (! private->file   ||
+      ! private->mtime  ||
+      private->dirty    ||
+      private->internal ||
+      private->freeze_count > 0)
+    {
+      return NULL;
+    }
+
+  uri = g_file_get_uri (private->file);
+
+  key = g_strdup_printf (PREVIEW_CACHE_MAGIC "\n%s\n%s\n%dx%d\n%"
+                         G_GINT64_FORMAT,
+                         uri,
+                         gimp_object_get_name (data),
+                         width, height,
+                         private->mtime);
+
+  g_free (uri);
+
+  /*  name the file after everything except the mtime, so an outdated
+   *  preview gets replaced instead of accumulating
+   */
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5,
+                                            key, strrchr (key, '\n') - key);
+  basename = g_strconcat (checksum, ".preview", NULL);
+
+  *cache_file = gimp_directory_file (PREVIEW_CACHE_DIR, basename, NULL);
+
+  g_free (basename);
+  g_free (checksum);
+
+  return key;
+}
+
 /**
  * gimp_data_error_quark:
  *
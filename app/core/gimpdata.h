@@ -108,6 +108,14 @@ void          gimp_data_set_mtime        (GimpData     *data,
                                           gint64        mtime);
 gint64        gimp_data_get_mtime        (GimpData     *data);
 
+GimpTempBuf * gimp_data_load_cached_preview (GimpData          *data,
+                                             gint               width,
+                                             gint               height);
+void          gimp_data_save_cached_preview (GimpData          *data,
+                                             gint               width,
+                                             gint               height,
+                                             const GimpTempBuf *temp_buf);
+
 gboolean      gimp_data_is_copyable      (GimpData     *data);
 void          gimp_data_copy             (GimpData     *data,
                                           GimpData     *src_data);
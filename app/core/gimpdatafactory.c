@@ -33,6 +33,7 @@
 #include "core-types.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-utils.h"
 #include "gimpcontext.h"
 #include "gimpdata.h"
@@ -53,6 +54,26 @@ typedef void (* GimpDataForeachFunc) (GimpDataFactory *factory,
                                       gpointer         user_data);
 
 
+typedef struct
+{
+  const GimpDataFactoryLoaderEntry *loader;
+  GFile                            *file;
+  GFile                            *top_directory;
+  guint64                           mtime;
+  gboolean                          dir_writable;
+  gboolean                          loaded;
+  GList                            *data_list;
+  GError                           *error;
+} GimpDataFactoryLoadJob;
+
+typedef struct
+{
+  GimpContext  *context;
+  GPtrArray    *jobs;
+  gint          next_job;
+} GimpDataFactoryLoadJobs;
+
+
 struct _GimpDataFactoryPriv
 {
   Gimp                             *gimp;
@@ -89,18 +110,26 @@ static GFile * gimp_data_factory_get_save_dir   (GimpDataFactory     *factory,
                                                  GError             **error);
 
 static void    gimp_data_factory_load_directory (GimpDataFactory     *factory,
-                                                 GimpContext         *context,
+                                                 GPtrArray           *jobs,
                                                  GHashTable          *cache,
                                                  gboolean             dir_writable,
                                                  GFile               *directory,
                                                  GFile               *top_directory);
 static void    gimp_data_factory_load_data      (GimpDataFactory     *factory,
-                                                 GimpContext         *context,
+                                                 GPtrArray           *jobs,
                                                  GHashTable          *cache,
                                                  gboolean             dir_writable,
                                                  GFile               *file,
                                                  GFileInfo           *info,
                                                  GFile               *top_directory);
+static void    gimp_data_factory_load_jobs      (GimpDataFactory     *factory,
+                                                 GimpContext         *context,
+                                                 GPtrArray           *jobs);
+static void    gimp_data_factory_load_job_run   (GimpDataFactoryLoadJob *job,
+                                                 GimpContext         *context);
+static void    gimp_data_factory_load_job_insert
+                                                (GimpDataFactory     *factory,
+                                                 GimpDataFactoryLoadJob *job);
 
 
 G_DEFINE_TYPE (GimpDataFactory, gimp_data_factory, GIMP_TYPE_OBJECT)
@@ -323,11 +352,12 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
                              GimpContext     *context,
                              GHashTable      *cache)
 {
-  gchar *p;
-  gchar *wp;
-  GList *path;
-  GList *writable_path;
-  GList *list;
+  gchar     *p;
+  gchar     *wp;
+  GList     *path;
+  GList     *writable_path;
+  GList     *list;
+  GPtrArray *jobs;
 
   g_object_get (factory->priv->gimp->config,
                 factory->priv->path_property_name,     &p,
@@ -340,6 +370,8 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
   g_free (p);
   g_free (wp);
 
+  jobs = g_ptr_array_new ();
+
   for (list = path; list; list = g_list_next (list))
     {
       gboolean dir_writable = FALSE;
@@ -348,12 +380,16 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
                               (GCompareFunc) gimp_file_compare))
         dir_writable = TRUE;
 
-      gimp_data_factory_load_directory (factory, context, cache,
+      gimp_data_factory_load_directory (factory, jobs, cache,
                                         dir_writable,
                                         list->data,
                                         list->data);
     }
 
+  gimp_data_factory_load_jobs (factory, context, jobs);
+
+  g_ptr_array_free (jobs, TRUE);
+
   g_list_free_full (path,          (GDestroyNotify) g_object_unref);
   g_list_free_full (writable_path, (GDestroyNotify) g_object_unref);
 }
@@ -779,7 +815,7 @@ gimp_data_factory_get_save_dir (GimpDataFactory  *factory,
 
 static void
 gimp_data_factory_load_directory (GimpDataFactory *factory,
-                                  GimpContext     *context,
+                                  GPtrArray       *jobs,
                                   GHashTable      *cache,
                                   gboolean         dir_writable,
                                   GFile           *directory,
@@ -815,14 +851,14 @@ gimp_data_factory_load_directory (GimpDataFactory *factory,
 
           if (file_type == G_FILE_TYPE_DIRECTORY)
             {
-              gimp_data_factory_load_directory (factory, context, cache,
+              gimp_data_factory_load_directory (factory, jobs, cache,
                                                 dir_writable,
                                                 child,
                                                 top_directory);
             }
           else if (file_type == G_FILE_TYPE_REGULAR)
             {
-              gimp_data_factory_load_data (factory, context, cache,
+              gimp_data_factory_load_data (factory, jobs, cache,
                                            dir_writable,
                                            child, info,
                                            top_directory);
@@ -838,19 +874,17 @@ gimp_data_factory_load_directory (GimpDataFactory *factory,
 
 static void
 gimp_data_factory_load_data (GimpDataFactory *factory,
-                             GimpContext     *context,
+                             GPtrArray       *jobs,
                              GHashTable      *cache,
                              gboolean         dir_writable,
                              GFile           *file,
                              GFileInfo       *info,
                              GFile           *top_directory)
 {
-  const GimpDataFactoryLoaderEntry *loader    = NULL;
-  GList                            *data_list = NULL;
-  GInputStream                     *input;
+  const GimpDataFactoryLoaderEntry *loader = NULL;
+  GimpDataFactoryLoadJob           *job;
   guint64                           mtime;
   gint                              i;
-  GError                           *error = NULL;
 
   for (i = 0; i < factory->priv->n_loader_entries; i++)
     {
@@ -890,23 +924,106 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
         }
     }
 
-  input = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+  /*  the file is only loaded later, by gimp_data_factory_load_jobs(),
+   *  which can load many files at once
+   */
+  job = g_slice_new0 (GimpDataFactoryLoadJob);
+
+  job->loader        = loader;
+  job->file          = g_object_ref (file);
+  job->top_directory = g_object_ref (top_directory);
+  job->mtime         = mtime;
+  job->dir_writable  = dir_writable;
+
+  g_ptr_array_add (jobs, job);
+}
+
+static void
+gimp_data_factory_load_jobs_func (gint                     i,
+                                  gint                     n,
+                                  GimpDataFactoryLoadJobs *load_jobs)
+{
+  gint index;
+
+  /*  files differ a lot in size, so hand them out one by one rather
+   *  than splitting the array into equal parts
+   */
+  while ((index = g_atomic_int_add (&load_jobs->next_job, 1)) <
+         (gint) load_jobs->jobs->len)
+    {
+      GimpDataFactoryLoadJob *job = g_ptr_array_index (load_jobs->jobs,
+                                                       index);
+
+      if (job->loader->threadsafe)
+        gimp_data_factory_load_job_run (job, load_jobs->context);
+    }
+}
+
+static void
+gimp_data_factory_load_jobs (GimpDataFactory *factory,
+                             GimpContext     *context,
+                             GPtrArray       *jobs)
+{
+  GimpDataFactoryLoadJobs load_jobs;
+  gint                    i;
+
+  load_jobs.context  = context;
+  load_jobs.jobs     = jobs;
+  load_jobs.next_job = 0;
+
+  /*  decode the files of thread-safe loaders in parallel  */
+  if (jobs->len > 1)
+    {
+      gimp_parallel_distribute (jobs->len,
+                                (GimpParallelDistributeFunc)
+                                gimp_data_factory_load_jobs_func,
+                                &load_jobs);
+    }
+
+  /*  ...and add everything to the containers in directory order, so
+   *  the result doesn't depend on which file finished first
+   */
+  for (i = 0; i < jobs->len; i++)
+    {
+      GimpDataFactoryLoadJob *job = g_ptr_array_index (jobs, i);
+
+      if (! job->loaded)
+        gimp_data_factory_load_job_run (job, context);
+
+      gimp_data_factory_load_job_insert (factory, job);
+
+      g_object_unref (job->file);
+      g_object_unref (job->top_directory);
+
+      g_slice_free (GimpDataFactoryLoadJob, job);
+    }
+}
+
+static void
+gimp_data_factory_load_job_run (GimpDataFactoryLoadJob *job,
+                                GimpContext            *context)
+{
+  GFile        *file = job->file;
+  GInputStream *input;
+
+  input = G_INPUT_STREAM (g_file_read (file, NULL, &job->error));
 
   if (input)
     {
       GInputStream *buffered = g_buffered_input_stream_new (input);
 
-      data_list = loader->load_func (context, file, buffered, &error);
+      job->data_list = job->loader->load_func (context, file, buffered,
+                                               &job->error);
 
-      if (error)
+      if (job->error)
         {
-          g_prefix_error (&error,
+          g_prefix_error (&job->error,
                           _("Error loading '%s': "),
                           gimp_file_get_utf8_name (file));
         }
-      else if (! data_list)
+      else if (! job->data_list)
         {
-          g_set_error (&error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+          g_set_error (&job->error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
                        _("Error loading '%s'"),
                        gimp_file_get_utf8_name (file));
         }
@@ -916,11 +1033,20 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
     }
   else
     {
-      g_prefix_error (&error,
+      g_prefix_error (&job->error,
                       _("Could not open '%s' for reading: "),
                       gimp_file_get_utf8_name (file));
     }
 
+  job->loaded = TRUE;
+}
+
+static void
+gimp_data_factory_load_job_insert (GimpDataFactory        *factory,
+                                   GimpDataFactoryLoadJob *job)
+{
+  GList *data_list = job->data_list;
+
   if (G_LIKELY (data_list))
     {
       GList    *list;
@@ -929,7 +1055,7 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
       gboolean  writable  = FALSE;
       gboolean  deletable = FALSE;
 
-      uri = g_file_get_uri (file);
+      uri = g_file_get_uri (job->file);
 
       obsolete = (strstr (uri, GIMP_OBSOLETE_DATA_DIR_NAME) != 0);
 
@@ -938,16 +1064,16 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
       /* obsolete files are immutable, don't check their writability */
       if (! obsolete)
         {
-          deletable = (g_list_length (data_list) == 1 && dir_writable);
-          writable  = (deletable && loader->writable);
+          deletable = (g_list_length (data_list) == 1 && job->dir_writable);
+          writable  = (deletable && job->loader->writable);
         }
 
       for (list = data_list; list; list = g_list_next (list))
         {
           GimpData *data = list->data;
 
-          gimp_data_set_file (data, file, writable, deletable);
-          gimp_data_set_mtime (data, mtime);
+          gimp_data_set_file (data, job->file, writable, deletable);
+          gimp_data_set_mtime (data, job->mtime);
           gimp_data_clean (data);
 
           if (obsolete)
@@ -957,7 +1083,7 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
             }
           else
             {
-              gimp_data_set_folder_tags (data, top_directory);
+              gimp_data_set_folder_tags (data, job->top_directory);
 
               gimp_container_add (factory->priv->container,
                                   GIMP_OBJECT (data));
@@ -973,10 +1099,10 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
    *  of data objects *and* an error message if loading failed after
    *  something was already loaded
    */
-  if (G_UNLIKELY (error))
+  if (G_UNLIKELY (job->error))
     {
       gimp_message (factory->priv->gimp, NULL, GIMP_MESSAGE_ERROR,
-                    _("Failed to load data:\n\n%s"), error->message);
-      g_clear_error (&error);
+                    _("Failed to load data:\n\n%s"), job->error->message);
+      g_clear_error (&job->error);
     }
 }
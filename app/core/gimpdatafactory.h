@@ -41,6 +41,7 @@ struct _GimpDataFactoryLoaderEntry
   GimpDataLoadFunc  load_func;
   const gchar      *extension;
   gboolean          writable;
+  gboolean          threadsafe; /* load_func may run on any thread */
 };
 
 
@@ -37,6 +37,34 @@
 #include "gimp-intl.h"
 
 
+#define DISTMAP_CACHE_KEY "gimp-drawable-blend-distmap-cache"
+
+
+/*  The last shapeburst distance map computed for a drawable, kept as
+ *  long as the selection and, if it was used, the drawable's alpha
+ *  don't change, so the blend tool doesn't compute it again each time
+ *  it starts on the same drawable.
+ */
+typedef struct
+{
+  GeglBuffer         *buffer;
+  GeglDistanceMetric  metric;
+  GeglRectangle       region;
+  gint                off_x;
+  gint                off_y;
+  gboolean            uses_alpha;
+} DistmapCache;
+
+
+static void   gimp_drawable_blend_distmap_cache_set        (GimpDrawable        *drawable,
+                                                            GeglBuffer          *buffer,
+                                                            GeglDistanceMetric   metric,
+                                                            const GeglRectangle *region,
+                                                            gboolean             uses_alpha);
+static void   gimp_drawable_blend_distmap_cache_invalidate (GimpDrawable        *drawable);
+static void   gimp_drawable_blend_distmap_cache_free       (DistmapCache        *cache);
+
+
 /*  public functions  */
 
 void
@@ -142,11 +170,14 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
                                         const GeglRectangle *region,
                                         GimpProgress        *progress)
 {
-  GimpChannel *mask;
-  GimpImage   *image;
-  GeglBuffer  *dist_buffer;
-  GeglBuffer  *temp_buffer;
-  GeglNode    *shapeburst;
+  GimpChannel  *mask;
+  GimpImage    *image;
+  GeglBuffer   *dist_buffer;
+  GeglBuffer   *temp_buffer;
+  GeglNode     *shapeburst;
+  DistmapCache *cache;
+  gboolean      uses_alpha = FALSE;
+  gint          off_x, off_y;
 
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
   g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), NULL);
@@ -154,6 +185,19 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
 
   image = gimp_item_get_image (GIMP_ITEM (drawable));
 
+  gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+  cache = g_object_get_data (G_OBJECT (drawable), DISTMAP_CACHE_KEY);
+
+  if (cache                                         &&
+      cache->metric == metric                       &&
+      gegl_rectangle_equal (&cache->region, region) &&
+      cache->off_x  == off_x                        &&
+      cache->off_y  == off_y)
+    {
+      return g_object_ref (cache->buffer);
+    }
+
   /*  allocate the distance map  */
   dist_buffer = gegl_buffer_new (region, babl_format ("Y float"));
 
@@ -166,10 +210,8 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
   if (! gimp_channel_is_empty (mask))
     {
       gint x, y, width, height;
-      gint off_x, off_y;
 
       gimp_item_mask_intersect (GIMP_ITEM (drawable), &x, &y, &width, &height);
-      gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
 
       /*  copy the mask to the temp mask  */
       gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)),
@@ -191,6 +233,8 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
                             GEGL_ABYSS_NONE,
                             temp_buffer, region);
           gegl_buffer_set_format (temp_buffer, NULL);
+
+          uses_alpha = TRUE;
         }
       else
         {
@@ -220,5 +264,81 @@ gimp_drawable_blend_shapeburst_distmap (GimpDrawable        *drawable,
 
   g_object_unref (temp_buffer);
 
+  gimp_drawable_blend_distmap_cache_set (drawable, dist_buffer,
+                                         metric, region, uses_alpha);
+
   return dist_buffer;
 }
+
+
+/*  private functions  */
+
+static void
+gimp_drawable_blend_distmap_cache_set (GimpDrawable        *drawable,
+                                       GeglBuffer          *buffer,
+                                       GeglDistanceMetric   metric,
+                                       const GeglRectangle *region,
+                                       gboolean             uses_alpha)
+{
+  GimpImage    *image = gimp_item_get_image (GIMP_ITEM (drawable));
+  DistmapCache *cache;
+
+  gimp_drawable_blend_distmap_cache_invalidate (drawable);
+
+  cache = g_slice_new (DistmapCache);
+
+  cache->buffer     = g_object_ref (buffer);
+  cache->metric     = metric;
+  cache->region     = *region;
+  cache->uses_alpha = uses_alpha;
+
+  gimp_item_get_offset (GIMP_ITEM (drawable), &cache->off_x, &cache->off_y);
+
+  g_object_set_data_full (G_OBJECT (drawable), DISTMAP_CACHE_KEY, cache,
+                          (GDestroyNotify) gimp_drawable_blend_distmap_cache_free);
+
+  /*  the distance map depends on the selection in any case, because
+   *  it decides whether the selection or the alpha is used
+   */
+  g_signal_connect_object (image, "mask-changed",
+                           G_CALLBACK (gimp_drawable_blend_distmap_cache_invalidate),
+                           drawable, G_CONNECT_SWAPPED);
+
+  if (uses_alpha)
+    {
+      g_signal_connect (drawable, "update",
+                        G_CALLBACK (gimp_drawable_blend_distmap_cache_invalidate),
+                        NULL);
+      g_signal_connect (drawable, "alpha-changed",
+                        G_CALLBACK (gimp_drawable_blend_distmap_cache_invalidate),
+                        NULL);
+    }
+}
+
+static void
+gimp_drawable_blend_distmap_cache_invalidate (GimpDrawable *drawable)
+{
+  GimpImage *image;
+
+  if (! g_object_get_data (G_OBJECT (drawable), DISTMAP_CACHE_KEY))
+    return;
+
+  image = gimp_item_get_image (GIMP_ITEM (drawable));
+
+  g_signal_handlers_disconnect_by_func (image,
+                                        gimp_drawable_blend_distmap_cache_invalidate,
+                                        drawable);
+  g_signal_handlers_disconnect_by_func (drawable,
+                                        gimp_drawable_blend_distmap_cache_invalidate,
+                                        NULL);
+
+  g_object_set_data (G_OBJECT (drawable), DISTMAP_CACHE_KEY, NULL);
+}
+
+static void
+gimp_drawable_blend_distmap_cache_free (DistmapCache *cache)
+{
+  g_object_unref (cache->buffer);
+
+  g_slice_free (DistmapCache, cache);
+}
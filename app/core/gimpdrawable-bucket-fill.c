@@ -27,7 +27,6 @@
 #include "core-types.h"
 
 #include "gegl/gimp-gegl-apply-operation.h"
-#include "gegl/gimp-gegl-mask.h"
 #include "gegl/gimp-gegl-mask-combine.h"
 #include "gegl/gimp-gegl-utils.h"
 
@@ -60,6 +59,7 @@ gimp_drawable_bucket_fill (GimpDrawable         *drawable,
   GimpPickable *pickable;
   GeglBuffer   *buffer;
   GeglBuffer   *mask_buffer;
+  GeglRectangle mask_bounds;
   gboolean      antialias;
   gint          x, y, width, height;
   gint          mask_offset_x = 0;
@@ -95,11 +95,24 @@ gimp_drawable_bucket_fill (GimpDrawable         *drawable,
                                                          fill_criterion,
                                                          diagonal_neighbors,
                                                          (gint) seed_x,
-                                                         (gint) seed_y);
+                                                         (gint) seed_y,
+                                                         &mask_bounds);
 
-  gimp_gegl_mask_bounds (mask_buffer, &x, &y, &width, &height);
-  width  -= x;
-  height -= y;
+  if (gegl_rectangle_is_empty (&mask_bounds))
+    {
+      /*  Nothing to fill; bail.  */
+
+      g_object_unref (mask_buffer);
+
+      gimp_unset_busy (image->gimp);
+
+      return;
+    }
+
+  x      = mask_bounds.x;
+  y      = mask_bounds.y;
+  width  = mask_bounds.width;
+  height = mask_bounds.height;
 
   /*  If there is a selection, inersect the region bounds
    *  with the selection bounds, to avoid processing areas
@@ -22,11 +22,13 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
 #include "libgimpbase/gimpbase.h"
+#include "libgimpmath/gimpmath.h"
 
 #include "core-types.h"
 
 #include "gegl/gimp-gegl-utils.h"
 
+#include "gimp-parallel.h"
 #include "gimpchannel.h"
 #include "gimpdrawable.h"
 #include "gimpdrawable-foreground-extract.h"
@@ -36,6 +38,41 @@
 #include "gimp-intl.h"
 
 
+/*  known trimap pixels around the unknown region that are passed on to
+ *  the matting engine, so that it sees the colors at the region's edge
+ */
+#define UNKNOWN_MARGIN        32
+
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
+typedef struct
+{
+  GeglBuffer    *trimap;
+  GMutex         mutex;
+  gint           x1, y1;
+  gint           x2, y2;
+} UnknownBoundsData;
+
+
+/*  local function prototypes  */
+
+static gboolean     foreground_extract_unknown_bounds (GeglBuffer          *trimap,
+                                                       const GeglRectangle *area,
+                                                       GeglRectangle       *bounds);
+static void         foreground_extract_unknown_area   (const GeglRectangle *area,
+                                                       UnknownBoundsData   *data);
+static GeglBuffer * foreground_extract                (GimpDrawable        *drawable,
+                                                       GimpMattingEngine    engine,
+                                                       gint                 global_iterations,
+                                                       gint                 levin_levels,
+                                                       gint                 levin_active_levels,
+                                                       GeglBuffer          *trimap,
+                                                       gint                 max_pixels,
+                                                       gboolean            *is_coarse,
+                                                       GimpProgress        *progress);
+
+
 /*  public functions  */
 
 GeglBuffer *
@@ -46,6 +83,158 @@ gimp_drawable_foreground_extract (GimpDrawable      *drawable,
                                   gint               levin_active_levels,
                                   GeglBuffer        *trimap,
                                   GimpProgress      *progress)
+{
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (trimap), NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
+
+  return foreground_extract (drawable, engine,
+                             global_iterations,
+                             levin_levels, levin_active_levels,
+                             trimap, 0, NULL, progress);
+}
+
+/**
+ * gimp_drawable_foreground_extract_preview:
+ * @drawable:   the #GimpDrawable to extract the foreground of
+ * @max_pixels: the maximal number of pixels to solve for
+ * @is_coarse:  return location for whether the result is approximate
+ *
+ * Like gimp_drawable_foreground_extract(), but if the trimap's unknown
+ * region is larger than @max_pixels, the matting is solved on a
+ * downscaled copy of the region and the result is scaled back up.  The
+ * result is meant as an immediate preview, to be replaced by the full
+ * resolution result when there is time for it.
+ *
+ * Return value: the alpha matte, in image coordinates.
+ */
+GeglBuffer *
+gimp_drawable_foreground_extract_preview (GimpDrawable      *drawable,
+                                          GimpMattingEngine  engine,
+                                          gint               global_iterations,
+                                          gint               levin_levels,
+                                          gint               levin_active_levels,
+                                          GeglBuffer        *trimap,
+                                          gint               max_pixels,
+                                          gboolean          *is_coarse,
+                                          GimpProgress      *progress)
+{
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (trimap), NULL);
+  g_return_val_if_fail (max_pixels > 0, NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
+
+  return foreground_extract (drawable, engine,
+                             global_iterations,
+                             levin_levels, levin_active_levels,
+                             trimap, max_pixels, is_coarse, progress);
+}
+
+
+/*  private functions  */
+
+/*  finds the bounds of the trimap's unknown pixels inside @area  */
+static gboolean
+foreground_extract_unknown_bounds (GeglBuffer          *trimap,
+                                   const GeglRectangle *area,
+                                   GeglRectangle       *bounds)
+{
+  UnknownBoundsData data;
+  GeglRectangle     rect;
+
+  if (! gegl_rectangle_intersect (&rect, area, gegl_buffer_get_extent (trimap)))
+    return FALSE;
+
+  data.trimap = trimap;
+  data.x1     = G_MAXINT;
+  data.y1     = G_MAXINT;
+  data.x2     = G_MININT;
+  data.y2     = G_MININT;
+
+  g_mutex_init (&data.mutex);
+
+  gimp_parallel_distribute_area (&rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 foreground_extract_unknown_area,
+                                 &data);
+
+  g_mutex_clear (&data.mutex);
+
+  if (data.x2 < data.x1)
+    return FALSE;
+
+  bounds->x      = data.x1;
+  bounds->y      = data.y1;
+  bounds->width  = data.x2 - data.x1;
+  bounds->height = data.y2 - data.y1;
+
+  return TRUE;
+}
+
+static void
+foreground_extract_unknown_area (const GeglRectangle *area,
+                                 UnknownBoundsData   *data)
+{
+  GeglBufferIterator *iter;
+  gint                x1 = G_MAXINT;
+  gint                y1 = G_MAXINT;
+  gint                x2 = G_MININT;
+  gint                y2 = G_MININT;
+
+  iter = gegl_buffer_iterator_new (data->trimap, area, 0,
+                                   babl_format ("Y float"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat  *src = iter->data[0];
+      GeglRectangle *roi = &iter->roi[0];
+      gint           x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        {
+          for (x = roi->x; x < roi->x + roi->width; x++, src++)
+            {
+              if (*src > 0.0f && *src < 1.0f)
+                {
+                  x1 = MIN (x1, x);
+                  y1 = MIN (y1, y);
+                  x2 = MAX (x2, x + 1);
+                  y2 = MAX (y2, y + 1);
+                }
+            }
+        }
+    }
+
+  if (x2 > x1)
+    {
+      g_mutex_lock (&data->mutex);
+
+      data->x1 = MIN (data->x1, x1);
+      data->y1 = MIN (data->y1, y1);
+      data->x2 = MAX (data->x2, x2);
+      data->y2 = MAX (data->y2, y2);
+
+      g_mutex_unlock (&data->mutex);
+    }
+}
+
+/*  the matting engines solve for the trimap's unknown pixels only,
+ *  the known pixels pass through.  we therefore run the engine on the
+ *  unknown region and a margin of known pixels around it, and take
+ *  all other pixels from the trimap.  if @max_pixels is positive, the
+ *  region is downscaled to at most that many pixels first.
+ */
+static GeglBuffer *
+foreground_extract (GimpDrawable      *drawable,
+                    GimpMattingEngine  engine,
+                    gint               global_iterations,
+                    gint               levin_levels,
+                    gint               levin_active_levels,
+                    GeglBuffer        *trimap,
+                    gint               max_pixels,
+                    gboolean          *is_coarse,
+                    GimpProgress      *progress)
 {
   GeglBuffer    *drawable_buffer;
   GeglNode      *gegl;
@@ -53,14 +242,51 @@ gimp_drawable_foreground_extract (GimpDrawable      *drawable,
   GeglNode      *trimap_node;
   GeglNode      *matting_node;
   GeglNode      *output_node;
+  GeglNode      *node;
   GeglBuffer    *buffer;
   GeglProcessor *processor;
+  GeglRectangle  drawable_rect;
+  GeglRectangle  unknown;
+  GeglRectangle  solve;
+  gdouble        scale = 1.0;
   gdouble        value;
   gint           off_x, off_y;
 
-  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
-  g_return_val_if_fail (GEGL_IS_BUFFER (trimap), NULL);
-  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
+  if (is_coarse)
+    *is_coarse = FALSE;
+
+  gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+  drawable_rect.x      = off_x;
+  drawable_rect.y      = off_y;
+  drawable_rect.width  = gimp_item_get_width  (GIMP_ITEM (drawable));
+  drawable_rect.height = gimp_item_get_height (GIMP_ITEM (drawable));
+
+  buffer = gegl_buffer_new (&drawable_rect, babl_format ("Y float"));
+
+  /*  the known pixels are the trimap's  */
+  gegl_buffer_copy (trimap, &drawable_rect, GEGL_ABYSS_NONE,
+                    buffer, &drawable_rect);
+
+  if (! foreground_extract_unknown_bounds (trimap, &drawable_rect, &unknown))
+    return buffer;
+
+  solve.x      = unknown.x      - UNKNOWN_MARGIN;
+  solve.y      = unknown.y      - UNKNOWN_MARGIN;
+  solve.width  = unknown.width  + 2 * UNKNOWN_MARGIN;
+  solve.height = unknown.height + 2 * UNKNOWN_MARGIN;
+
+  gegl_rectangle_intersect (&solve, &solve, &drawable_rect);
+
+  if (max_pixels > 0 &&
+      (gint64) unknown.width * unknown.height > max_pixels)
+    {
+      scale = sqrt ((gdouble) max_pixels /
+                    ((gdouble) unknown.width * unknown.height));
+
+      if (is_coarse)
+        *is_coarse = TRUE;
+    }
 
   progress = gimp_progress_start (progress, FALSE,
                                   _("Computing alpha of unknown pixels"));
@@ -78,9 +304,8 @@ gimp_drawable_foreground_extract (GimpDrawable      *drawable,
                                     "buffer",    drawable_buffer,
                                     NULL);
   output_node = gegl_node_new_child (gegl,
-                                     "operation", "gegl:buffer-sink",
-                                     "buffer",    &buffer,
-                                     "format",    NULL,
+                                     "operation", "gegl:write-buffer",
+                                     "buffer",    buffer,
                                      NULL);
 
   if (engine == GIMP_MATTING_ENGINE_GLOBAL)
@@ -99,39 +324,86 @@ gimp_drawable_foreground_extract (GimpDrawable      *drawable,
                                           NULL);
     }
 
-  gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
-
+  /*  work in image coordinates, on the solved region only  */
   if (off_x || off_y)
     {
-      GeglNode *pre;
-      GeglNode *post;
-
-      pre = gegl_node_new_child (gegl,
-                                 "operation", "gegl:translate",
-                                 "x", -1.0 * off_x,
-                                 "y", -1.0 * off_y,
-                                 NULL);
-      post = gegl_node_new_child (gegl,
+      node = gegl_node_new_child (gegl,
                                   "operation", "gegl:translate",
                                   "x", 1.0 * off_x,
                                   "y", 1.0 * off_y,
                                   NULL);
 
-      gegl_node_connect_to (trimap_node,   "output", pre, "input");
-      gegl_node_connect_to (pre,  "output", matting_node, "aux");
-      gegl_node_link_many (input_node, matting_node, post, output_node, NULL);
+      gegl_node_link (input_node, node);
+      input_node = node;
     }
-  else
+
+  node = gegl_node_new_child (gegl,
+                              "operation", "gegl:crop",
+                              "x",         (gdouble) solve.x,
+                              "y",         (gdouble) solve.y,
+                              "width",     (gdouble) solve.width,
+                              "height",    (gdouble) solve.height,
+                              NULL);
+  gegl_node_link (input_node, node);
+  input_node = node;
+
+  node = gegl_node_new_child (gegl,
+                              "operation", "gegl:crop",
+                              "x",         (gdouble) solve.x,
+                              "y",         (gdouble) solve.y,
+                              "width",     (gdouble) solve.width,
+                              "height",    (gdouble) solve.height,
+                              NULL);
+  gegl_node_link (trimap_node, node);
+  trimap_node = node;
+
+  if (scale < 1.0)
     {
-      gegl_node_connect_to (input_node,   "output",
-                            matting_node, "input");
-      gegl_node_connect_to (trimap_node,  "output",
-                            matting_node, "aux");
-      gegl_node_connect_to (matting_node, "output",
-                            output_node,  "input");
+      /*  the trimap's classes must not be blended by the sampler  */
+      node = gegl_node_new_child (gegl,
+                                  "operation", "gegl:scale-ratio",
+                                  "x",         scale,
+                                  "y",         scale,
+                                  "sampler",   GEGL_SAMPLER_NEAREST,
+                                  NULL);
+      gegl_node_link (trimap_node, node);
+      trimap_node = node;
+
+      node = gegl_node_new_child (gegl,
+                                  "operation", "gegl:scale-ratio",
+                                  "x",         scale,
+                                  "y",         scale,
+                                  "sampler",   GEGL_SAMPLER_LINEAR,
+                                  NULL);
+      gegl_node_link (input_node, node);
+      input_node = node;
+    }
+
+  gegl_node_connect_to (input_node,   "output",
+                        matting_node, "input");
+  gegl_node_connect_to (trimap_node,  "output",
+                        matting_node, "aux");
+
+  node = matting_node;
+
+  if (scale < 1.0)
+    {
+      GeglNode *upscale;
+
+      upscale = gegl_node_new_child (gegl,
+                                     "operation", "gegl:scale-ratio",
+                                     "x",         1.0 / scale,
+                                     "y",         1.0 / scale,
+                                     "sampler",   GEGL_SAMPLER_LINEAR,
+                                     NULL);
+      gegl_node_link (node, upscale);
+      node = upscale;
     }
 
-  processor = gegl_node_new_processor (output_node, NULL);
+  gegl_node_link (node, output_node);
+
+  /*  only write the unknown region, the margin is known anyway  */
+  processor = gegl_node_new_processor (output_node, &unknown);
 
   while (gegl_processor_work (processor, &value))
     {
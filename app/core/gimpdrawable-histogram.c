@@ -35,6 +35,68 @@
 #include "gimpimage.h"
 
 
+/*  the drawable keeps the histograms of fixed-size blocks of its buffer,
+ *  and recounts only the blocks touched by updates, so that recomputing
+ *  the histogram of a large drawable after a brush stroke is cheap, and
+ *  repeated analysis of unchanged pixels (levels stretch, equalize,
+ *  threshold...) is almost free.  the blocks are counted through the
+ *  selection mask, if any, and also recounted when the mask changes.
+ *  the cache is only used when the unfiltered buffer is counted.
+ */
+
+#define CACHE_KEY        "gimp-drawable-histogram-cache"
+#define CACHE_BLOCK_SIZE 512
+
+
+typedef struct
+{
+  GeglBuffer     *buffer;      /* weak reference, NULL once finalized */
+  GeglRectangle   extent;
+  const Babl     *format;
+  gboolean        linear;
+
+  GimpChannel    *mask;        /* weak pointer, NULL if unmasked */
+  gint            mask_off_x;
+  gint            mask_off_y;
+
+  gint            n_blocks_x;
+  gint            n_blocks_y;
+  GimpHistogram **blocks;      /* NULL for blocks that need recounting */
+} HistogramCache;
+
+
+/*  local function prototypes  */
+
+static void   histogram_cache_free       (HistogramCache *cache);
+static void   histogram_cache_clear      (HistogramCache *cache);
+static void   histogram_cache_update     (GimpDrawable   *drawable,
+                                          gint            x,
+                                          gint            y,
+                                          gint            width,
+                                          gint            height,
+                                          HistogramCache *cache);
+static void   histogram_cache_mask_update
+                                         (GimpDrawable   *mask,
+                                          gint            x,
+                                          gint            y,
+                                          gint            width,
+                                          gint            height,
+                                          HistogramCache *cache);
+static void   histogram_cache_set_mask   (HistogramCache *cache,
+                                          GimpChannel    *mask);
+static void   histogram_cache_set_buffer (HistogramCache *cache,
+                                          GeglBuffer     *buffer);
+static void   histogram_cache_buffer_notify
+                                         (HistogramCache *cache,
+                                          GObject        *where_the_buffer_was);
+static void   histogram_cache_calculate  (GimpDrawable        *drawable,
+                                          GimpHistogram       *histogram,
+                                          GimpChannel         *mask,
+                                          const GeglRectangle *rect);
+
+
+/*  public functions  */
+
 void
 gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
                                    GimpHistogram *histogram,
@@ -147,7 +209,15 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
           g_object_ref (buffer);
         }
 
-      if (! gimp_channel_is_empty (mask))
+      if (gimp_channel_is_empty (mask))
+        mask = NULL;
+
+      if (buffer == gimp_drawable_get_buffer (drawable))
+        {
+          histogram_cache_calculate (drawable, histogram, mask,
+                                     GEGL_RECTANGLE (x, y, width, height));
+        }
+      else if (mask)
         {
           gint off_x, off_y;
 
@@ -169,3 +239,264 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
       g_object_unref (buffer);
     }
 }
+
+
+/*  private functions  */
+
+static void
+histogram_cache_free (HistogramCache *cache)
+{
+  histogram_cache_clear (cache);
+  histogram_cache_set_mask (cache, NULL);
+  histogram_cache_set_buffer (cache, NULL);
+
+  g_slice_free (HistogramCache, cache);
+}
+
+static void
+histogram_cache_clear (HistogramCache *cache)
+{
+  gint i;
+
+  for (i = 0; i < cache->n_blocks_x * cache->n_blocks_y; i++)
+    {
+      if (cache->blocks[i])
+        g_object_unref (cache->blocks[i]);
+    }
+
+  g_clear_pointer (&cache->blocks, g_free);
+
+  cache->format     = NULL;
+  cache->n_blocks_x = 0;
+  cache->n_blocks_y = 0;
+}
+
+static void
+histogram_cache_update (GimpDrawable   *drawable,
+                        gint            x,
+                        gint            y,
+                        gint            width,
+                        gint            height,
+                        HistogramCache *cache)
+{
+  gint x1, y1, x2, y2;
+  gint bx, by;
+
+  if (! cache->blocks || width <= 0 || height <= 0)
+    return;
+
+  x -= cache->extent.x;
+  y -= cache->extent.y;
+
+  if (x + width <= 0 || y + height <= 0)
+    return;
+
+  x1 = MAX (x, 0) / CACHE_BLOCK_SIZE;
+  y1 = MAX (y, 0) / CACHE_BLOCK_SIZE;
+  x2 = MIN ((x + width  - 1) / CACHE_BLOCK_SIZE, cache->n_blocks_x - 1);
+  y2 = MIN ((y + height - 1) / CACHE_BLOCK_SIZE, cache->n_blocks_y - 1);
+
+  for (by = y1; by <= y2; by++)
+    for (bx = x1; bx <= x2; bx++)
+      {
+        GimpHistogram **block = &cache->blocks[by * cache->n_blocks_x + bx];
+
+        if (*block)
+          {
+            g_object_unref (*block);
+            *block = NULL;
+          }
+      }
+}
+
+static void
+histogram_cache_mask_update (GimpDrawable   *mask,
+                             gint            x,
+                             gint            y,
+                             gint            width,
+                             gint            height,
+                             HistogramCache *cache)
+{
+  /*  the mask is in image coordinates, the blocks in the drawable's  */
+  histogram_cache_update (NULL,
+                          x - cache->mask_off_x, y - cache->mask_off_y,
+                          width, height,
+                          cache);
+}
+
+static void
+histogram_cache_set_mask (HistogramCache *cache,
+                          GimpChannel    *mask)
+{
+  if (mask == cache->mask)
+    return;
+
+  if (cache->mask)
+    {
+      g_signal_handlers_disconnect_by_func (cache->mask,
+                                            histogram_cache_mask_update,
+                                            cache);
+      g_object_remove_weak_pointer (G_OBJECT (cache->mask),
+                                    (gpointer) &cache->mask);
+    }
+
+  cache->mask = mask;
+
+  if (cache->mask)
+    {
+      g_object_add_weak_pointer (G_OBJECT (cache->mask),
+                                 (gpointer) &cache->mask);
+      g_signal_connect (cache->mask, "update",
+                        G_CALLBACK (histogram_cache_mask_update),
+                        cache);
+    }
+}
+
+static void
+histogram_cache_set_buffer (HistogramCache *cache,
+                            GeglBuffer     *buffer)
+{
+  if (buffer == cache->buffer)
+    return;
+
+  if (cache->buffer)
+    g_object_weak_unref (G_OBJECT (cache->buffer),
+                         (GWeakNotify) histogram_cache_buffer_notify,
+                         cache);
+
+  cache->buffer = buffer;
+
+  if (cache->buffer)
+    g_object_weak_ref (G_OBJECT (cache->buffer),
+                       (GWeakNotify) histogram_cache_buffer_notify,
+                       cache);
+}
+
+/*  a new buffer may be allocated at the address of the finalized one,
+ *  so its blocks must not outlive it
+ */
+static void
+histogram_cache_buffer_notify (HistogramCache *cache,
+                               GObject        *where_the_buffer_was)
+{
+  cache->buffer = NULL;
+
+  histogram_cache_clear (cache);
+}
+
+static void
+histogram_cache_calculate (GimpDrawable        *drawable,
+                           GimpHistogram       *histogram,
+                           GimpChannel         *mask,
+                           const GeglRectangle *rect)
+{
+  GeglBuffer          *buffer = gimp_drawable_get_buffer (drawable);
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  const Babl          *format = gegl_buffer_get_format (buffer);
+  HistogramCache      *cache;
+  GimpHistogram      **blocks;
+  GeglBuffer          *mask_buffer = NULL;
+  gboolean             linear = gimp_histogram_get_linear (histogram);
+  gint                 off_x  = 0;
+  gint                 off_y  = 0;
+  gint                 n_blocks;
+  gint                 x1, y1, x2, y2;
+  gint                 bx, by;
+
+  cache = g_object_get_data (G_OBJECT (drawable), CACHE_KEY);
+
+  if (! cache)
+    {
+      cache = g_slice_new0 (HistogramCache);
+
+      g_object_set_data_full (G_OBJECT (drawable), CACHE_KEY, cache,
+                              (GDestroyNotify) histogram_cache_free);
+
+      g_signal_connect (drawable, "update",
+                        G_CALLBACK (histogram_cache_update),
+                        cache);
+    }
+
+  if (mask)
+    {
+      gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+      mask_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+    }
+
+  if (cache->buffer != buffer                         ||
+      ! gegl_rectangle_equal (&cache->extent, extent) ||
+      cache->format != format                         ||
+      cache->linear != linear                         ||
+      cache->mask   != mask                           ||
+      cache->mask_off_x != off_x                      ||
+      cache->mask_off_y != off_y)
+    {
+      histogram_cache_clear (cache);
+      histogram_cache_set_mask (cache, mask);
+      histogram_cache_set_buffer (cache, buffer);
+
+      cache->extent     = *extent;
+      cache->format     = format;
+      cache->linear     = linear;
+      cache->mask_off_x = off_x;
+      cache->mask_off_y = off_y;
+      cache->n_blocks_x = (extent->width  + CACHE_BLOCK_SIZE - 1) /
+                          CACHE_BLOCK_SIZE;
+      cache->n_blocks_y = (extent->height + CACHE_BLOCK_SIZE - 1) /
+                          CACHE_BLOCK_SIZE;
+      cache->blocks     = g_new0 (GimpHistogram *,
+                                  cache->n_blocks_x * cache->n_blocks_y);
+    }
+
+  /*  only the blocks intersecting the mask bounds contribute  */
+  x1 = (rect->x - extent->x) / CACHE_BLOCK_SIZE;
+  y1 = (rect->y - extent->y) / CACHE_BLOCK_SIZE;
+  x2 = (rect->x - extent->x + rect->width  - 1) / CACHE_BLOCK_SIZE;
+  y2 = (rect->y - extent->y + rect->height - 1) / CACHE_BLOCK_SIZE;
+
+  blocks   = g_new (GimpHistogram *, (x2 - x1 + 1) * (y2 - y1 + 1));
+  n_blocks = 0;
+
+  for (by = y1; by <= y2; by++)
+    for (bx = x1; bx <= x2; bx++)
+      {
+        GimpHistogram **block = &cache->blocks[by * cache->n_blocks_x + bx];
+
+        if (! *block)
+          {
+            GeglRectangle rect;
+
+            gegl_rectangle_intersect (&rect,
+                                      GEGL_RECTANGLE (extent->x +
+                                                      bx * CACHE_BLOCK_SIZE,
+                                                      extent->y +
+                                                      by * CACHE_BLOCK_SIZE,
+                                                      CACHE_BLOCK_SIZE,
+                                                      CACHE_BLOCK_SIZE),
+                                      extent);
+
+            *block = gimp_histogram_new (linear);
+
+            if (mask_buffer)
+              {
+                gimp_histogram_calculate (*block, buffer, &rect,
+                                          mask_buffer,
+                                          GEGL_RECTANGLE (rect.x + off_x,
+                                                          rect.y + off_y,
+                                                          rect.width,
+                                                          rect.height));
+              }
+            else
+              {
+                gimp_histogram_calculate (*block, buffer, &rect, NULL, NULL);
+              }
+          }
+
+        blocks[n_blocks++] = *block;
+      }
+
+  gimp_histogram_merge (histogram, blocks, n_blocks);
+
+  g_free (blocks);
+}
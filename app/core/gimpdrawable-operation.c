@@ -28,14 +28,21 @@
 #include "core-types.h"
 
 #include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-utils.h"
 
+#include "gimpchannel.h"
 #include "gimpdrawable.h"
 #include "gimpdrawable-operation.h"
 #include "gimpdrawable-shadow.h"
+#include "gimpimage.h"
 #include "gimpprogress.h"
 #include "gimpsettings.h"
 
 
+static gboolean   gimp_drawable_operation_in_place (GimpDrawable *drawable,
+                                                    GeglNode     *operation);
+
+
 /*  public functions  */
 
 void
@@ -58,15 +65,39 @@ gimp_drawable_apply_operation (GimpDrawable *drawable,
                                   &rect.width, &rect.height))
     return;
 
-  dest_buffer = gimp_drawable_get_shadow_buffer (drawable);
+  if (gimp_drawable_operation_in_place (drawable, operation))
+    {
+      GeglBuffer *undo_buffer;
+
+      dest_buffer = gimp_drawable_get_buffer (drawable);
+
+      /*  shares its tiles with the drawable, so only the tiles the
+       *  operation writes to get copied
+       */
+      undo_buffer = gimp_gegl_buffer_dup_area (dest_buffer, &rect);
 
-  gimp_gegl_apply_operation (gimp_drawable_get_buffer (drawable),
-                             progress, undo_desc,
-                             operation,
-                             dest_buffer, &rect, FALSE);
+      gimp_drawable_push_undo (drawable, undo_desc, undo_buffer,
+                               rect.x, rect.y, rect.width, rect.height);
 
-  gimp_drawable_merge_shadow_buffer (drawable, TRUE, undo_desc);
-  gimp_drawable_free_shadow_buffer (drawable);
+      g_object_unref (undo_buffer);
+
+      gimp_gegl_apply_operation (dest_buffer,
+                                 progress, undo_desc,
+                                 operation,
+                                 dest_buffer, &rect, FALSE);
+    }
+  else
+    {
+      dest_buffer = gimp_drawable_get_shadow_buffer (drawable);
+
+      gimp_gegl_apply_operation (gimp_drawable_get_buffer (drawable),
+                                 progress, undo_desc,
+                                 operation,
+                                 dest_buffer, &rect, FALSE);
+
+      gimp_drawable_merge_shadow_buffer (drawable, TRUE, undo_desc);
+      gimp_drawable_free_shadow_buffer (drawable);
+    }
 
   gimp_drawable_update (drawable, rect.x, rect.y, rect.width, rect.height);
 
@@ -103,3 +134,27 @@ gimp_drawable_apply_operation_by_name (GimpDrawable *drawable,
 
   g_object_unref (node);
 }
+
+
+/*  private functions  */
+
+/*  the operation can write straight into the drawable's buffer if it
+ *  is a point operation and gimp_drawable_merge_shadow_buffer() would
+ *  replace every pixel of the result anyway, i.e. there is no selection
+ *  to mask it with and all components are affected
+ */
+static gboolean
+gimp_drawable_operation_in_place (GimpDrawable *drawable,
+                                  GeglNode     *operation)
+{
+  GimpImage   *image = gimp_item_get_image (GIMP_ITEM (drawable));
+  GimpChannel *mask  = gimp_image_get_mask (image);
+
+  if (GIMP_DRAWABLE (mask) != drawable && ! gimp_channel_is_empty (mask))
+    return FALSE;
+
+  if (gimp_drawable_get_active_mask (drawable) != GIMP_COMPONENT_MASK_ALL)
+    return FALSE;
+
+  return gimp_gegl_node_is_point_operation (operation);
+}
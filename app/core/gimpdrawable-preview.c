@@ -32,6 +32,7 @@
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-loops.h"
+#include "gegl/gimptilehandlervalidate.h"
 
 #include "gimp.h"
 #include "gimpchannel.h"
@@ -43,6 +44,25 @@
 #include "gimptempbuf.h"
 
 
+typedef struct
+{
+  GeglBuffer    *buffer;
+  GeglRectangle  rect;
+  gdouble        scale;
+  const Babl    *format;
+} SubPreviewData;
+
+
+/*  local function prototypes  */
+
+static void   sub_preview_data_free                     (SubPreviewData *data);
+
+static void   gimp_drawable_get_sub_preview_async_func  (GTask          *task,
+                                                         GimpDrawable   *drawable,
+                                                         SubPreviewData *data,
+                                                         GCancellable   *cancellable);
+
+
 /*  public functions  */
 
 GimpTempBuf *
@@ -176,6 +196,107 @@ gimp_drawable_get_sub_preview (GimpDrawable *drawable,
   return preview;
 }
 
+/*  like gimp_drawable_get_sub_preview(), but renders the preview on
+ *  another thread.  the preview is rendered from a reference to the
+ *  drawable's current buffer; drawables whose buffer is rendered on
+ *  demand are previewed synchronously.
+ */
+void
+gimp_drawable_get_sub_preview_async (GimpDrawable        *drawable,
+                                     gint                 src_x,
+                                     gint                 src_y,
+                                     gint                 src_width,
+                                     gint                 src_height,
+                                     gint                 dest_width,
+                                     gint                 dest_height,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  GimpItem       *item;
+  GimpImage      *image;
+  GeglBuffer     *buffer;
+  GTask          *task;
+  SubPreviewData *data;
+  gdouble         scale;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+  g_return_if_fail (src_x >= 0);
+  g_return_if_fail (src_y >= 0);
+  g_return_if_fail (src_width  > 0);
+  g_return_if_fail (src_height > 0);
+  g_return_if_fail (dest_width  > 0);
+  g_return_if_fail (dest_height > 0);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  item = GIMP_ITEM (drawable);
+
+  g_return_if_fail ((src_x + src_width)  <= gimp_item_get_width  (item));
+  g_return_if_fail ((src_y + src_height) <= gimp_item_get_height (item));
+
+  image = gimp_item_get_image (item);
+
+  task = g_task_new (drawable, cancellable, callback, user_data);
+
+  buffer = gimp_drawable_get_buffer (drawable);
+
+  if (! image->gimp->config->layer_previews)
+    {
+      g_task_return_pointer (task, NULL, NULL);
+    }
+  else if (gimp_tile_handler_validate_get_assigned (buffer))
+    {
+      /*  the buffer's contents are rendered on demand, which can only
+       *  be done on the main thread
+       */
+      g_task_return_pointer (task,
+                             gimp_drawable_get_sub_preview (drawable,
+                                                            src_x,
+                                                            src_y,
+                                                            src_width,
+                                                            src_height,
+                                                            dest_width,
+                                                            dest_height),
+                             (GDestroyNotify) gimp_temp_buf_unref);
+    }
+  else
+    {
+      scale = MIN ((gdouble) dest_width  / (gdouble) src_width,
+                   (gdouble) dest_height / (gdouble) src_height);
+
+      data = g_slice_new (SubPreviewData);
+
+      data->buffer      = g_object_ref (buffer);
+      data->rect.x      = RINT ((gdouble) src_x * scale);
+      data->rect.y      = RINT ((gdouble) src_y * scale);
+      data->rect.width  = dest_width;
+      data->rect.height = dest_height;
+      data->scale       = scale;
+      data->format      = gimp_drawable_get_preview_format (drawable);
+
+      g_task_set_task_data (task, data,
+                            (GDestroyNotify) sub_preview_data_free);
+
+      g_task_run_in_thread (task,
+                            (GTaskThreadFunc)
+                            gimp_drawable_get_sub_preview_async_func);
+    }
+
+  g_object_unref (task);
+}
+
+GimpTempBuf *
+gimp_drawable_get_sub_preview_finish (GimpDrawable  *drawable,
+                                      GAsyncResult  *result,
+                                      GError       **error)
+{
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, drawable), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 GdkPixbuf *
 gimp_drawable_get_sub_pixbuf (GimpDrawable *drawable,
                               gint          src_x,
@@ -271,3 +392,37 @@ gimp_drawable_get_sub_pixbuf (GimpDrawable *drawable,
 
   return pixbuf;
 }
+
+
+/*  private functions  */
+
+static void
+sub_preview_data_free (SubPreviewData *data)
+{
+  g_object_unref (data->buffer);
+
+  g_slice_free (SubPreviewData, data);
+}
+
+static void
+gimp_drawable_get_sub_preview_async_func (GTask          *task,
+                                          GimpDrawable   *drawable,
+                                          SubPreviewData *data,
+                                          GCancellable   *cancellable)
+{
+  GimpTempBuf *preview;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  preview = gimp_temp_buf_new (data->rect.width, data->rect.height,
+                               data->format);
+
+  gegl_buffer_get (data->buffer, &data->rect, data->scale,
+                   gimp_temp_buf_get_format (preview),
+                   gimp_temp_buf_get_data (preview),
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+  g_task_return_pointer (task, preview,
+                         (GDestroyNotify) gimp_temp_buf_unref);
+}
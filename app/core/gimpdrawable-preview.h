@@ -43,6 +43,21 @@ GimpTempBuf * gimp_drawable_get_sub_preview    (GimpDrawable *drawable,
                                                 gint          src_height,
                                                 gint          dest_width,
                                                 gint          dest_height);
+void          gimp_drawable_get_sub_preview_async
+                                               (GimpDrawable        *drawable,
+                                                gint                 src_x,
+                                                gint                 src_y,
+                                                gint                 src_width,
+                                                gint                 src_height,
+                                                gint                 dest_width,
+                                                gint                 dest_height,
+                                                GCancellable        *cancellable,
+                                                GAsyncReadyCallback  callback,
+                                                gpointer             user_data);
+GimpTempBuf * gimp_drawable_get_sub_preview_finish
+                                               (GimpDrawable        *drawable,
+                                                GAsyncResult        *result,
+                                                GError             **error);
 GdkPixbuf   * gimp_drawable_get_sub_pixbuf     (GimpDrawable *drawable,
                                                 gint          src_x,
                                                 gint          src_y,
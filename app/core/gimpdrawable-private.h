@@ -23,6 +23,9 @@ struct _GimpDrawablePrivate
   GeglBuffer     *buffer; /* buffer for drawable data */
   GeglBuffer     *shadow; /* shadow buffer            */
 
+  GeglBuffer            *scaled_buffer; /* see gimp_drawable_prepare_scale() */
+  GimpInterpolationType  scaled_interpolation;
+
   GeglNode       *source_node;
   GeglNode       *buffer_source_node;
   GimpContainer  *filter_stack;
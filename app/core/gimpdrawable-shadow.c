@@ -59,9 +59,13 @@ gimp_drawable_get_shadow_buffer (GimpDrawable *drawable)
         }
     }
 
-  drawable->private->shadow = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                                               width, height),
-                                               format);
+  /*  start out as a copy-on-write duplicate of the drawable, so the
+   *  shadow only allocates the tiles that actually get written to,
+   *  instead of a whole second copy of the drawable
+   */
+  drawable->private->shadow =
+    gimp_gegl_buffer_dup_area (gimp_drawable_get_buffer (drawable),
+                               GEGL_RECTANGLE (0, 0, width, height));
 
   return drawable->private->shadow;
 }
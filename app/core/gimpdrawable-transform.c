@@ -34,6 +34,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-transform-resize.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
@@ -141,6 +142,146 @@ gimp_drawable_transform_buffer_affine (GimpDrawable           *drawable,
   return new_buffer;
 }
 
+/*  flips and rotations by multiples of 90 degrees only move pixels
+ *  around, so each tile of the result is filled from a single rectangle
+ *  of the source, on several threads at once.  the source rectangle
+ *  is first optionally transposed, then optionally mirrored.
+ */
+
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  gint                 bpp;
+  gboolean             transpose;
+  gboolean             flip_x;
+  gboolean             flip_y;
+} RemapData;
+
+static void
+gimp_drawable_transform_remap_area (const GeglRectangle *area,
+                                    RemapData           *data)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle      *roi;
+  guchar             *block      = NULL;
+  gsize               block_size = 0;
+  const gint          bpp        = data->bpp;
+
+  iter = gegl_buffer_iterator_new (data->dest_buffer, area, 0, NULL,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+  roi = &iter->roi[0];
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      guchar        *dest = iter->data[0];
+      GeglRectangle  src_roi;
+      gint           x    = roi->x - data->dest_rect->x;
+      gint           y    = roi->y - data->dest_rect->y;
+      gint           i, j;
+
+      if (data->transpose)
+        gegl_rectangle_set (&src_roi, y, x, roi->height, roi->width);
+      else
+        gegl_rectangle_set (&src_roi, x, y, roi->width, roi->height);
+
+      if (data->flip_x)
+        src_roi.x = data->src_rect->width - src_roi.x - src_roi.width;
+
+      if (data->flip_y)
+        src_roi.y = data->src_rect->height - src_roi.y - src_roi.height;
+
+      src_roi.x += data->src_rect->x;
+      src_roi.y += data->src_rect->y;
+
+      if (block_size < (gsize) src_roi.width * src_roi.height * bpp)
+        {
+          block_size = (gsize) src_roi.width * src_roi.height * bpp;
+
+          g_free (block);
+          block = g_malloc (block_size);
+        }
+
+      gegl_buffer_get (data->src_buffer, &src_roi, 1.0, NULL, block,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      if (! data->transpose && ! data->flip_x)
+        {
+          /*  whole rows stay in one piece  */
+          for (j = 0; j < roi->height; j++)
+            {
+              gint b = data->flip_y ? roi->height - 1 - j : j;
+
+              memcpy (dest, block + b * roi->width * bpp, roi->width * bpp);
+
+              dest += roi->width * bpp;
+            }
+
+          continue;
+        }
+
+      for (j = 0; j < roi->height; j++)
+        {
+          for (i = 0; i < roi->width; i++)
+            {
+              gint a = data->transpose ? j : i;
+              gint b = data->transpose ? i : j;
+
+              if (data->flip_x)
+                a = src_roi.width - 1 - a;
+
+              if (data->flip_y)
+                b = src_roi.height - 1 - b;
+
+              memcpy (dest, block + (b * src_roi.width + a) * bpp, bpp);
+
+              dest += bpp;
+            }
+        }
+    }
+
+  g_free (block);
+}
+
+static void
+gimp_drawable_transform_remap (GeglBuffer          *src_buffer,
+                               const GeglRectangle *src_rect,
+                               GeglBuffer          *dest_buffer,
+                               const GeglRectangle *dest_rect,
+                               gboolean             transpose,
+                               gboolean             flip_x,
+                               gboolean             flip_y)
+{
+  RemapData data;
+
+  g_return_if_fail (gegl_buffer_get_format (src_buffer) ==
+                    gegl_buffer_get_format (dest_buffer));
+  g_return_if_fail (transpose ?
+                    (src_rect->width  == dest_rect->height &&
+                     src_rect->height == dest_rect->width) :
+                    (src_rect->width  == dest_rect->width &&
+                     src_rect->height == dest_rect->height));
+
+  data.src_buffer  = src_buffer;
+  data.src_rect    = src_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = dest_rect;
+  data.bpp         = babl_format_get_bytes_per_pixel (
+                       gegl_buffer_get_format (dest_buffer));
+  data.transpose   = transpose;
+  data.flip_x      = flip_x;
+  data.flip_y      = flip_y;
+
+  gimp_parallel_distribute_area (dest_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_drawable_transform_remap_area,
+                                 &data);
+}
+
 GeglBuffer *
 gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
                                      GimpContext         *context,
@@ -162,7 +303,6 @@ gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
   gint           orig_width, orig_height;
   gint           new_x, new_y;
   gint           new_width, new_height;
-  gint           i;
 
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
   g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), NULL);
@@ -262,48 +402,21 @@ gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
   if (new_width == 0 && new_height == 0)
     return new_buffer;
 
+  gegl_rectangle_set (&src_rect,  orig_x, orig_y, orig_width, orig_height);
+  gegl_rectangle_set (&dest_rect, new_x,  new_y,  new_width,  new_height);
+
   switch (flip_type)
     {
     case GIMP_ORIENTATION_HORIZONTAL:
-      src_rect.x      = orig_x;
-      src_rect.y      = orig_y;
-      src_rect.width  = 1;
-      src_rect.height = orig_height;
-
-      dest_rect.x      = new_x + new_width - 1;
-      dest_rect.y      = new_y;
-      dest_rect.width  = 1;
-      dest_rect.height = new_height;
-
-      for (i = 0; i < orig_width; i++)
-        {
-          src_rect.x  = i + orig_x;
-          dest_rect.x = new_x + new_width - i - 1;
-
-          gegl_buffer_copy (orig_buffer, &src_rect, GEGL_ABYSS_NONE,
-                            new_buffer, &dest_rect);
-        }
+      gimp_drawable_transform_remap (orig_buffer, &src_rect,
+                                     new_buffer,  &dest_rect,
+                                     FALSE, TRUE, FALSE);
       break;
 
     case GIMP_ORIENTATION_VERTICAL:
-      src_rect.x      = orig_x;
-      src_rect.y      = orig_y;
-      src_rect.width  = orig_width;
-      src_rect.height = 1;
-
-      dest_rect.x      = new_x;
-      dest_rect.y      = new_y + new_height - 1;
-      dest_rect.width  = new_width;
-      dest_rect.height = 1;
-
-      for (i = 0; i < orig_height; i++)
-        {
-          src_rect.y  = i + orig_y;
-          dest_rect.y = new_y + new_height - i - 1;
-
-          gegl_buffer_copy (orig_buffer, &src_rect, GEGL_ABYSS_NONE,
-                            new_buffer, &dest_rect);
-        }
+      gimp_drawable_transform_remap (orig_buffer, &src_rect,
+                                     new_buffer,  &dest_rect,
+                                     FALSE, FALSE, TRUE);
       break;
 
     case GIMP_ORIENTATION_UNKNOWN:
@@ -369,7 +482,6 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable      *drawable,
   GeglRectangle  dest_rect;
   gint           orig_x, orig_y;
   gint           orig_width, orig_height;
-  gint           orig_bpp;
   gint           new_x, new_y;
   gint           new_width, new_height;
 
@@ -388,7 +500,6 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable      *drawable,
   orig_y      = orig_offset_y;
   orig_width  = gegl_buffer_get_width (orig_buffer);
   orig_height = gegl_buffer_get_height (orig_buffer);
-  orig_bpp    = babl_format_get_bytes_per_pixel (gegl_buffer_get_format (orig_buffer));
 
   switch (rotate_type)
     {
@@ -549,113 +660,21 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable      *drawable,
   switch (rotate_type)
     {
     case GIMP_ROTATE_90:
-      {
-        guchar *buf = g_new (guchar, new_height * orig_bpp);
-        gint    i;
-
-        /* Not cool, we leak memory if we return, but anyway that is
-         * never supposed to happen. If we see this warning, a bug has
-         * to be fixed!
-         */
-        g_return_val_if_fail (new_height == orig_width, NULL);
-
-        src_rect.y      = orig_y + orig_height - 1;
-        src_rect.height = 1;
-
-        dest_rect.x     = new_x;
-        dest_rect.width = 1;
-
-        for (i = 0; i < orig_height; i++)
-          {
-            src_rect.y  = orig_y + orig_height - 1 - i;
-            dest_rect.x = new_x + i;
-
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
+      gimp_drawable_transform_remap (orig_buffer, &src_rect,
+                                     new_buffer,  &dest_rect,
+                                     TRUE, FALSE, TRUE);
       break;
 
     case GIMP_ROTATE_180:
-      {
-        guchar *buf = g_new (guchar, new_width * orig_bpp);
-        gint    i, j, k;
-
-        /* Not cool, we leak memory if we return, but anyway that is
-         * never supposed to happen. If we see this warning, a bug has
-         * to be fixed!
-         */
-        g_return_val_if_fail (new_width == orig_width, NULL);
-
-        src_rect.y      = orig_y + orig_height - 1;
-        src_rect.height = 1;
-
-        dest_rect.y      = new_y;
-        dest_rect.height = 1;
-
-        for (i = 0; i < orig_height; i++)
-          {
-            src_rect.y  = orig_y + orig_height - 1 - i;
-            dest_rect.y = new_y + i;
-
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-
-            for (j = 0; j < orig_width / 2; j++)
-              {
-                guchar *left  = buf + j * orig_bpp;
-                guchar *right = buf + (orig_width - 1 - j) * orig_bpp;
-
-                for (k = 0; k < orig_bpp; k++)
-                  {
-                    guchar tmp = left[k];
-                    left[k]    = right[k];
-                    right[k]   = tmp;
-                  }
-              }
-
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
+      gimp_drawable_transform_remap (orig_buffer, &src_rect,
+                                     new_buffer,  &dest_rect,
+                                     FALSE, TRUE, TRUE);
       break;
 
     case GIMP_ROTATE_270:
-      {
-        guchar *buf = g_new (guchar, new_width * orig_bpp);
-        gint    i;
-
-        /* Not cool, we leak memory if we return, but anyway that is
-         * never supposed to happen. If we see this warning, a bug has
-         * to be fixed!
-         */
-        g_return_val_if_fail (new_width == orig_height, NULL);
-
-        src_rect.x     = orig_x + orig_width - 1;
-        src_rect.width = 1;
-
-        dest_rect.y      = new_y;
-        dest_rect.height = 1;
-
-        for (i = 0; i < orig_width; i++)
-          {
-            src_rect.x  = orig_x + orig_width - 1 - i;
-            dest_rect.y = new_y + i;
-
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
+      gimp_drawable_transform_remap (orig_buffer, &src_rect,
+                                     new_buffer,  &dest_rect,
+                                     TRUE, TRUE, FALSE);
       break;
     }
 
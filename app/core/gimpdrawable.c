@@ -28,8 +28,10 @@
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-loops.h"
 #include "gegl/gimp-gegl-utils.h"
 
+#include "gimp-allocation.h"
 #include "gimp-memsize.h"
 #include "gimp-utils.h"
 #include "gimpchannel.h"
@@ -48,6 +50,7 @@
 #include "gimpmarshal.h"
 #include "gimppickable.h"
 #include "gimpprogress.h"
+#include "gimpprojectable.h"
 
 #include "gimp-log.h"
 
@@ -312,7 +315,12 @@ gimp_drawable_finalize (GObject *object)
 {
   GimpDrawable *drawable = GIMP_DRAWABLE (object);
 
+  if (drawable->private->buffer)
+    gimp_allocation_untag_buffer (drawable->private->buffer,
+                                  GIMP_ALLOCATION_DRAWABLE);
+
   g_clear_object (&drawable->private->buffer);
+  g_clear_object (&drawable->private->scaled_buffer);
 
   gimp_drawable_free_shadow_buffer (drawable);
 
@@ -440,7 +448,16 @@ gimp_drawable_duplicate (GimpItem *item,
       GimpDrawable  *new_drawable = GIMP_DRAWABLE (new_item);
       GeglBuffer    *new_buffer;
 
-      new_buffer = gegl_buffer_dup (gimp_drawable_get_buffer (drawable));
+      /*  drawables that render their own buffer, i.e. layer groups,
+       *  share the tiles their original has rendered later, see
+       *  gimp_projection_share_tiles(); copying the buffer here would
+       *  make the original render all of it
+       */
+      if (GIMP_IS_PROJECTABLE (new_drawable))
+        new_buffer = gegl_buffer_new (gegl_buffer_get_extent (gimp_drawable_get_buffer (drawable)),
+                                      gimp_drawable_get_format (drawable));
+      else
+        new_buffer = gegl_buffer_dup (gimp_drawable_get_buffer (drawable));
 
       gimp_drawable_set_buffer (new_drawable, FALSE, NULL, new_buffer);
       g_object_unref (new_buffer);
@@ -461,18 +478,37 @@ gimp_drawable_scale (GimpItem              *item,
   GimpDrawable *drawable = GIMP_DRAWABLE (item);
   GeglBuffer   *new_buffer;
 
-  new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                                new_width, new_height),
-                                gimp_drawable_get_format (drawable));
+  new_buffer = drawable->private->scaled_buffer;
+  drawable->private->scaled_buffer = NULL;
+
+  /*  use the buffer computed by gimp_drawable_prepare_scale(), if it
+   *  matches the requested scale
+   */
+  if (new_buffer                                                       &&
+      (gegl_buffer_get_width  (new_buffer)         != new_width         ||
+       gegl_buffer_get_height (new_buffer)         != new_height        ||
+       gegl_buffer_get_format (new_buffer)         !=
+       gimp_drawable_get_format (drawable)                              ||
+       drawable->private->scaled_interpolation != interpolation_type))
+    {
+      g_clear_object (&new_buffer);
+    }
 
-  gimp_gegl_apply_scale (gimp_drawable_get_buffer (drawable),
-                         progress, C_("undo-type", "Scale"),
-                         new_buffer,
-                         interpolation_type,
-                         ((gdouble) new_width /
-                          gimp_item_get_width  (item)),
-                         ((gdouble) new_height /
-                          gimp_item_get_height (item)));
+  if (! new_buffer)
+    {
+      new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                    new_width, new_height),
+                                    gimp_drawable_get_format (drawable));
+
+      gimp_gegl_apply_scale (gimp_drawable_get_buffer (drawable),
+                             progress, C_("undo-type", "Scale"),
+                             new_buffer,
+                             interpolation_type,
+                             ((gdouble) new_width /
+                              gimp_item_get_width  (item)),
+                             ((gdouble) new_height /
+                              gimp_item_get_height (item)));
+    }
 
   gimp_drawable_set_buffer_full (drawable, gimp_item_is_attached (item), NULL,
                                  new_buffer,
@@ -749,8 +785,9 @@ gimp_drawable_real_convert_type (GimpDrawable      *drawable,
                                      gimp_item_get_height (GIMP_ITEM (drawable))),
                      new_format);
 
-  gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL, GEGL_ABYSS_NONE,
-                    dest_buffer, NULL);
+  gimp_gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
+                         GEGL_ABYSS_NONE,
+                         dest_buffer, NULL);
 
   gimp_drawable_set_buffer (drawable, push_undo, NULL, dest_buffer);
   g_object_unref (dest_buffer);
@@ -788,11 +825,19 @@ gimp_drawable_real_set_buffer (GimpDrawable *drawable,
     {
       old_has_alpha = gimp_drawable_has_alpha (drawable);
 
+      /*  the old buffer now only lives on in the undo history, which
+       *  accounts for it itself
+       */
+      gimp_allocation_untag_buffer (drawable->private->buffer,
+                                    GIMP_ALLOCATION_DRAWABLE);
+
       g_object_unref (drawable->private->buffer);
     }
 
   drawable->private->buffer = buffer;
 
+  gimp_allocation_tag_buffer (buffer, GIMP_ALLOCATION_DRAWABLE);
+
   if (drawable->private->buffer_source_node)
     gegl_node_set (drawable->private->buffer_source_node,
                    "buffer", gimp_drawable_get_buffer (drawable),
@@ -822,13 +867,8 @@ gimp_drawable_real_push_undo (GimpDrawable *drawable,
 {
   if (! buffer)
     {
-      buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
-                                gimp_drawable_get_format (drawable));
-
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
-                        GEGL_RECTANGLE (x, y, width, height), GEGL_ABYSS_NONE,
-                        buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      buffer = gimp_gegl_buffer_dup_area (gimp_drawable_get_buffer (drawable),
+                                          GEGL_RECTANGLE (x, y, width, height));
     }
   else
     {
@@ -1210,6 +1250,63 @@ gimp_drawable_steal_buffer (GimpDrawable *drawable,
   g_object_unref (buffer);
 }
 
+/**
+ * gimp_drawable_prepare_scale:
+ * @drawable:           a #GimpDrawable
+ * @new_width:          the width the drawable will be scaled to
+ * @new_height:         the height the drawable will be scaled to
+ * @interpolation_type: the interpolation that will be used
+ *
+ * Renders the scaled contents of @drawable ahead of time, without
+ * modifying the drawable.  A following gimp_item_scale() with the same
+ * size and interpolation uses the prepared buffer instead of scaling
+ * again.
+ *
+ * The drawable's buffer must have been retrieved with
+ * gimp_drawable_get_buffer() beforehand; after that, this function may
+ * be called from any thread, as long as no other thread accesses
+ * @drawable at the same time.
+ **/
+void
+gimp_drawable_prepare_scale (GimpDrawable          *drawable,
+                             gint                   new_width,
+                             gint                   new_height,
+                             GimpInterpolationType  interpolation_type)
+{
+  GimpItem   *item;
+  GeglBuffer *buffer;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+  g_return_if_fail (new_width > 0 && new_height > 0);
+
+  item = GIMP_ITEM (drawable);
+
+  g_clear_object (&drawable->private->scaled_buffer);
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, new_width, new_height),
+                            gimp_drawable_get_format (drawable));
+
+  gimp_gegl_apply_scale (drawable->private->buffer,
+                         NULL, NULL,
+                         buffer,
+                         interpolation_type,
+                         ((gdouble) new_width /
+                          gimp_item_get_width  (item)),
+                         ((gdouble) new_height /
+                          gimp_item_get_height (item)));
+
+  drawable->private->scaled_buffer        = buffer;
+  drawable->private->scaled_interpolation = interpolation_type;
+}
+
+void
+gimp_drawable_clear_prepared_scale (GimpDrawable *drawable)
+{
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  g_clear_object (&drawable->private->scaled_buffer);
+}
+
 GeglNode *
 gimp_drawable_get_source_node (GimpDrawable *drawable)
 {
@@ -192,6 +192,13 @@ void            gimp_drawable_set_buffer_full    (GimpDrawable       *drawable,
 void            gimp_drawable_steal_buffer       (GimpDrawable       *drawable,
                                                   GimpDrawable       *src_drawable);
 
+void            gimp_drawable_prepare_scale      (GimpDrawable       *drawable,
+                                                  gint                new_width,
+                                                  gint                new_height,
+                                                  GimpInterpolationType interpolation_type);
+void            gimp_drawable_clear_prepared_scale
+                                                 (GimpDrawable       *drawable);
+
 GeglNode      * gimp_drawable_get_source_node    (GimpDrawable       *drawable);
 GeglNode      * gimp_drawable_get_mode_node      (GimpDrawable       *drawable);
 
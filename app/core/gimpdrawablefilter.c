@@ -40,6 +40,7 @@
 #include "gegl/gimpapplicator.h"
 #include "gegl/gimp-gegl-utils.h"
 
+#include "gimp-memory-budget.h"
 #include "gimpchannel.h"
 #include "gimpdrawable-filters.h"
 #include "gimpdrawablefilter.h"
@@ -47,6 +48,18 @@
 #include "gimpmarshal.h"
 #include "gimpprogress.h"
 
+#include "gimp-trace.h"
+
+
+/*  while the filter's parameters are being changed, it is previewed at
+ *  a reduced resolution, with at most this many pixels, and only
+ *  rendered at full resolution once they didn't change for
+ *  PROXY_REFINE_DELAY milliseconds
+ */
+#define PROXY_MAX_PIXELS   (512 * 512)
+#define PROXY_MAX_SCALE    8
+#define PROXY_REFINE_DELAY 300
+
 
 enum
 {
@@ -66,6 +79,8 @@ struct _GimpDrawableFilter
   gboolean                preview_enabled;
   GimpAlignmentType       preview_alignment;
   gdouble                 preview_position;
+  gboolean                preview_has_area;
+  GeglRectangle           preview_area;
   gdouble                 opacity;
   GimpLayerMode           paint_mode;
   GimpLayerColorSpace     blend_space;
@@ -76,10 +91,15 @@ struct _GimpDrawableFilter
 
   GeglRectangle           filter_area;
 
+  gint                    proxy_scale;
+  guint                   proxy_refine_id;
+
   GeglNode               *translate;
   GeglNode               *crop;
   GeglNode               *cast_before;
   GeglNode               *transform_before;
+  GeglNode               *proxy_before;
+  GeglNode               *proxy_after;
   GeglNode               *transform_after;
   GeglNode               *cast_after;
   GimpApplicator         *applicator;
@@ -93,13 +113,20 @@ static void       gimp_drawable_filter_sync_region      (GimpDrawableFilter  *fi
 static void       gimp_drawable_filter_sync_preview     (GimpDrawableFilter  *filter,
                                                          gboolean             old_enabled,
                                                          GimpAlignmentType    old_alignment,
-                                                         gdouble              old_position);
+                                                         gdouble              old_position,
+                                                         const GeglRectangle *old_area);
 static void       gimp_drawable_filter_sync_opacity     (GimpDrawableFilter  *filter);
 static void       gimp_drawable_filter_sync_mode        (GimpDrawableFilter  *filter);
 static void       gimp_drawable_filter_sync_affect      (GimpDrawableFilter  *filter);
 static void       gimp_drawable_filter_sync_mask        (GimpDrawableFilter  *filter);
 static void       gimp_drawable_filter_sync_transform   (GimpDrawableFilter  *filter);
 static void       gimp_drawable_filter_sync_gamma_hack  (GimpDrawableFilter  *filter);
+static void       gimp_drawable_filter_sync_proxy       (GimpDrawableFilter  *filter,
+                                                         gint                 proxy_scale);
+
+static gint       gimp_drawable_filter_get_proxy_scale  (GimpDrawableFilter  *filter);
+static void       gimp_drawable_filter_cancel_refine    (GimpDrawableFilter  *filter);
+static gboolean   gimp_drawable_filter_refine           (GimpDrawableFilter  *filter);
 
 static gboolean   gimp_drawable_filter_is_filtering     (GimpDrawableFilter  *filter);
 static gboolean   gimp_drawable_filter_add_filter       (GimpDrawableFilter  *filter);
@@ -155,6 +182,7 @@ gimp_drawable_filter_init (GimpDrawableFilter *drawable_filter)
   drawable_filter->blend_space       = GIMP_LAYER_COLOR_SPACE_AUTO;
   drawable_filter->composite_space   = GIMP_LAYER_COLOR_SPACE_AUTO;
   drawable_filter->composite_mode    = GIMP_LAYER_COMPOSITE_AUTO;
+  drawable_filter->proxy_scale       = 1;
 }
 
 static void
@@ -162,6 +190,8 @@ gimp_drawable_filter_dispose (GObject *object)
 {
   GimpDrawableFilter *drawable_filter = GIMP_DRAWABLE_FILTER (object);
 
+  gimp_drawable_filter_cancel_refine (drawable_filter);
+
   if (drawable_filter->drawable)
     gimp_drawable_filter_remove_filter (drawable_filter);
 
@@ -223,6 +253,12 @@ gimp_drawable_filter_new (GimpDrawable *drawable,
   filter->transform_before = gegl_node_new_child (node,
                                                   "operation", "gegl:nop",
                                                   NULL);
+  filter->proxy_before = gegl_node_new_child (node,
+                                              "operation", "gegl:nop",
+                                              NULL);
+  filter->proxy_after = gegl_node_new_child (node,
+                                             "operation", "gegl:nop",
+                                             NULL);
   filter->transform_after = gegl_node_new_child (node,
                                                  "operation", "gegl:nop",
                                                  NULL);
@@ -239,11 +275,13 @@ gimp_drawable_filter_new (GimpDrawable *drawable,
                            filter->crop,
                            filter->cast_before,
                            filter->transform_before,
+                           filter->proxy_before,
                            filter->operation,
                            NULL);
     }
 
   gegl_node_link_many (filter->operation,
+                       filter->proxy_after,
                        filter->transform_after,
                        filter->cast_after,
                        NULL);
@@ -299,7 +337,49 @@ gimp_drawable_filter_set_preview (GimpDrawableFilter  *filter,
 
       gimp_drawable_filter_sync_preview (filter,
                                          old_enabled,
-                                         old_alignment, old_position);
+                                         old_alignment, old_position,
+                                         filter->preview_has_area ?
+                                         &filter->preview_area : NULL);
+    }
+}
+
+/*  restricts the preview to 'area', in image coordinates, which is
+ *  usually the part of the image which is visible on the canvas.  the
+ *  rest of the drawable is rendered unfiltered until it becomes part of
+ *  'area', and is only filtered when the filter is committed.  pass
+ *  NULL to preview the whole drawable.
+ */
+void
+gimp_drawable_filter_set_preview_area (GimpDrawableFilter  *filter,
+                                       const GeglRectangle *area)
+{
+  gboolean      old_has_area;
+  GeglRectangle old_area;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE_FILTER (filter));
+
+  if (! area && ! filter->preview_has_area)
+    return;
+
+  if (area && filter->preview_has_area &&
+      gegl_rectangle_equal (area, &filter->preview_area))
+    return;
+
+  old_has_area = filter->preview_has_area;
+  old_area     = filter->preview_area;
+
+  filter->preview_has_area = (area != NULL);
+
+  if (area)
+    filter->preview_area = *area;
+
+  if (gimp_drawable_filter_is_filtering (filter))
+    {
+      gimp_drawable_filter_sync_preview (filter,
+                                         filter->preview_enabled,
+                                         filter->preview_alignment,
+                                         filter->preview_position,
+                                         old_has_area ? &old_area : NULL);
     }
 }
 
@@ -389,6 +469,25 @@ gimp_drawable_filter_apply (GimpDrawableFilter  *filter,
   g_return_if_fail (gimp_item_is_attached (GIMP_ITEM (filter->drawable)));
 
   gimp_drawable_filter_add_filter (filter);
+
+  /*  render a low resolution proxy first, and refine it when the
+   *  filter stops changing
+   */
+  gimp_drawable_filter_cancel_refine (filter);
+  gimp_drawable_filter_sync_proxy (filter,
+                                   gimp_drawable_filter_get_proxy_scale (filter));
+
+  if (filter->proxy_scale > 1)
+    {
+      filter->proxy_refine_id =
+        g_timeout_add (PROXY_REFINE_DELAY,
+                       (GSourceFunc) gimp_drawable_filter_refine,
+                       filter);
+
+      /*  the whole proxy changes, not only 'area'  */
+      area = NULL;
+    }
+
   gimp_drawable_filter_update_drawable (filter, area);
 }
 
@@ -404,13 +503,33 @@ gimp_drawable_filter_commit (GimpDrawableFilter *filter,
                         FALSE);
   g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
 
+  gimp_drawable_filter_cancel_refine (filter);
+
   if (gimp_drawable_filter_is_filtering (filter))
     {
+      gint64 reserved;
+
+      /*  never merge the proxy  */
+      gimp_drawable_filter_sync_proxy (filter, 1);
+
+      /*  account for the merged pixels against the memory budget  */
+      reserved = gimp_drawable_estimate_memsize (
+        filter->drawable,
+        gimp_drawable_get_component_type (filter->drawable),
+        filter->filter_area.width,
+        filter->filter_area.height);
+
+      gimp_memory_budget_reserve (reserved);
+
+      GIMP_TRACE_BEGIN ("drawable-filter-commit");
       success = gimp_drawable_merge_filter (filter->drawable,
                                             GIMP_FILTER (filter),
                                             progress,
                                             gimp_object_get_name (filter),
                                             cancellable);
+      GIMP_TRACE_END ("drawable-filter-commit");
+
+      gimp_memory_budget_release (reserved);
 
       gimp_drawable_filter_remove_filter (filter);
 
@@ -425,6 +544,8 @@ gimp_drawable_filter_abort (GimpDrawableFilter *filter)
 {
   g_return_if_fail (GIMP_IS_DRAWABLE_FILTER (filter));
 
+  gimp_drawable_filter_cancel_refine (filter);
+
   if (gimp_drawable_filter_remove_filter (filter))
     {
       gimp_drawable_filter_update_drawable (filter, NULL);
@@ -474,11 +595,12 @@ gimp_drawable_filter_sync_region (GimpDrawableFilter *filter)
 }
 
 static void
-gimp_drawable_filter_get_preview_rect (GimpDrawableFilter *filter,
-                                       gboolean            enabled,
-                                       GimpAlignmentType   alignment,
-                                       gdouble             position,
-                                       GeglRectangle      *rect)
+gimp_drawable_filter_get_preview_rect (GimpDrawableFilter  *filter,
+                                       gboolean             enabled,
+                                       GimpAlignmentType    alignment,
+                                       gdouble              position,
+                                       const GeglRectangle *area,
+                                       GeglRectangle       *rect)
 {
   gint width;
   gint height;
@@ -517,13 +639,28 @@ gimp_drawable_filter_get_preview_rect (GimpDrawableFilter *filter,
           g_return_if_reached ();
         }
     }
+
+  if (area)
+    {
+      GeglRectangle drawable_area = *area;
+      gint          off_x, off_y;
+
+      gimp_item_get_offset (GIMP_ITEM (filter->drawable), &off_x, &off_y);
+
+      drawable_area.x -= off_x;
+      drawable_area.y -= off_y;
+
+      if (! gegl_rectangle_intersect (rect, rect, &drawable_area))
+        *rect = *GEGL_RECTANGLE (0, 0, 0, 0);
+    }
 }
 
 static void
-gimp_drawable_filter_sync_preview (GimpDrawableFilter *filter,
-                                   gboolean            old_enabled,
-                                   GimpAlignmentType   old_alignment,
-                                   gdouble             old_position)
+gimp_drawable_filter_sync_preview (GimpDrawableFilter  *filter,
+                                   gboolean             old_enabled,
+                                   GimpAlignmentType    old_alignment,
+                                   gdouble              old_position,
+                                   const GeglRectangle *old_area)
 {
   GeglRectangle old_rect;
   GeglRectangle new_rect;
@@ -532,16 +669,20 @@ gimp_drawable_filter_sync_preview (GimpDrawableFilter *filter,
                                          old_enabled,
                                          old_alignment,
                                          old_position,
+                                         old_area,
                                          &old_rect);
 
   gimp_drawable_filter_get_preview_rect (filter,
                                          filter->preview_enabled,
                                          filter->preview_alignment,
                                          filter->preview_position,
+                                         filter->preview_has_area ?
+                                         &filter->preview_area : NULL,
                                          &new_rect);
 
   gimp_applicator_set_preview (filter->applicator,
-                               filter->preview_enabled,
+                               filter->preview_enabled ||
+                               filter->preview_has_area,
                                &new_rect);
 
   if (old_rect.x      != new_rect.x     ||
@@ -779,6 +920,91 @@ gimp_drawable_filter_sync_gamma_hack (GimpDrawableFilter *filter)
     }
 }
 
+static void
+gimp_drawable_filter_sync_proxy (GimpDrawableFilter *filter,
+                                 gint                proxy_scale)
+{
+  if (proxy_scale == filter->proxy_scale)
+    return;
+
+  filter->proxy_scale = proxy_scale;
+
+  if (proxy_scale > 1)
+    {
+      gegl_node_set (filter->proxy_before,
+                     "operation", "gegl:scale-ratio",
+                     "x",         1.0 / proxy_scale,
+                     "y",         1.0 / proxy_scale,
+                     "sampler",   GEGL_SAMPLER_LINEAR,
+                     NULL);
+
+      gegl_node_set (filter->proxy_after,
+                     "operation", "gegl:scale-ratio",
+                     "x",         (gdouble) proxy_scale,
+                     "y",         (gdouble) proxy_scale,
+                     "sampler",   GEGL_SAMPLER_NEAREST,
+                     NULL);
+    }
+  else
+    {
+      gegl_node_set (filter->proxy_before,
+                     "operation", "gegl:nop",
+                     NULL);
+
+      gegl_node_set (filter->proxy_after,
+                     "operation", "gegl:nop",
+                     NULL);
+    }
+}
+
+static gint
+gimp_drawable_filter_get_proxy_scale (GimpDrawableFilter *filter)
+{
+  gdouble n_pixels;
+  gint    proxy_scale = 1;
+
+  /*  operations without an input render their whole output area, and
+   *  can't be previewed through a proxy
+   */
+  if (! gegl_node_has_pad (filter->operation, "input"))
+    return 1;
+
+  n_pixels = (gdouble) filter->filter_area.width *
+                       filter->filter_area.height;
+
+  while (proxy_scale < PROXY_MAX_SCALE &&
+         n_pixels / (proxy_scale * proxy_scale) > PROXY_MAX_PIXELS)
+    {
+      proxy_scale *= 2;
+    }
+
+  return proxy_scale;
+}
+
+static void
+gimp_drawable_filter_cancel_refine (GimpDrawableFilter *filter)
+{
+  if (filter->proxy_refine_id)
+    {
+      g_source_remove (filter->proxy_refine_id);
+
+      filter->proxy_refine_id = 0;
+    }
+}
+
+static gboolean
+gimp_drawable_filter_refine (GimpDrawableFilter *filter)
+{
+  filter->proxy_refine_id = 0;
+
+  gimp_drawable_filter_sync_proxy (filter, 1);
+
+  if (gimp_drawable_filter_is_filtering (filter))
+    gimp_drawable_filter_update_drawable (filter, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
 static gboolean
 gimp_drawable_filter_is_filtering (GimpDrawableFilter *filter)
 {
@@ -800,7 +1026,9 @@ gimp_drawable_filter_add_filter (GimpDrawableFilter *filter)
       gimp_drawable_filter_sync_preview (filter,
                                          filter->preview_enabled,
                                          filter->preview_alignment,
-                                         filter->preview_position);
+                                         filter->preview_position,
+                                         filter->preview_has_area ?
+                                         &filter->preview_area : NULL);
       gimp_drawable_filter_sync_opacity (filter);
       gimp_drawable_filter_sync_mode (filter);
       gimp_drawable_filter_sync_affect (filter);
@@ -849,6 +1077,8 @@ gimp_drawable_filter_remove_filter (GimpDrawableFilter *filter)
                                             gimp_drawable_filter_affect_changed,
                                             filter);
 
+      gimp_drawable_filter_cancel_refine (filter);
+
       gimp_drawable_remove_filter (filter->drawable,
                                    GIMP_FILTER (filter));
 
@@ -61,6 +61,9 @@ void       gimp_drawable_filter_set_preview    (GimpDrawableFilter  *filter,
                                                 gboolean             enabled,
                                                 GimpAlignmentType    alignment,
                                                 gdouble              split_position);
+void       gimp_drawable_filter_set_preview_area
+                                               (GimpDrawableFilter  *filter,
+                                                const GeglRectangle *area);
 void       gimp_drawable_filter_set_opacity    (GimpDrawableFilter  *filter,
                                                 gdouble              opacity);
 void       gimp_drawable_filter_set_mode       (GimpDrawableFilter  *filter,
@@ -17,14 +17,26 @@
 
 #include "config.h"
 
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
+#include <glib/gstdio.h>
+
+#ifdef G_OS_WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#endif
 
 #include "libgimpbase/gimpbase.h"
 
 #include "core-types.h"
 
 #include "gimp-memsize.h"
+#include "gimp-utils.h"
 #include "gimpimage.h"
 #include "gimpdrawable.h"
 #include "gimpdrawableundo.h"
@@ -57,6 +69,9 @@ static void     gimp_drawable_undo_pop          (GimpUndo            *undo,
                                                  GimpUndoAccumulator *accum);
 static void     gimp_drawable_undo_free         (GimpUndo            *undo,
                                                  GimpUndoMode         undo_mode);
+static gint64   gimp_drawable_undo_spill        (GimpUndo            *undo);
+
+static gboolean gimp_drawable_undo_pid_is_alive (gint                 pid);
 
 
 G_DEFINE_TYPE (GimpDrawableUndo, gimp_drawable_undo, GIMP_TYPE_ITEM_UNDO)
@@ -79,6 +94,7 @@ gimp_drawable_undo_class_init (GimpDrawableUndoClass *klass)
 
   undo_class->pop                = gimp_drawable_undo_pop;
   undo_class->free               = gimp_drawable_undo_free;
+  undo_class->spill              = gimp_drawable_undo_spill;
 
   g_object_class_install_property (object_class, PROP_BUFFER,
                                    g_param_spec_object ("buffer", NULL, NULL,
@@ -174,7 +190,9 @@ gimp_drawable_undo_get_memsize (GimpObject *object,
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (object);
   gint64            memsize       = 0;
 
-  memsize += gimp_gegl_buffer_get_memsize (drawable_undo->buffer);
+  /*  a buffer that was moved to disk doesn't take any memory  */
+  if (! drawable_undo->disk_path)
+    memsize += gimp_gegl_buffer_get_memsize (drawable_undo->buffer);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -204,5 +222,158 @@ gimp_drawable_undo_free (GimpUndo     *undo,
   g_clear_object (&drawable_undo->buffer);
   g_clear_object (&drawable_undo->applied_buffer);
 
+  if (drawable_undo->disk_path)
+    {
+      g_unlink (drawable_undo->disk_path);
+
+      g_clear_pointer (&drawable_undo->disk_path, g_free);
+    }
+
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static gint64
+gimp_drawable_undo_spill (GimpUndo *undo)
+{
+  static gint       disk_id = 0;
+
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+  GeglBuffer       *buffer;
+  const Babl       *format;
+  gchar            *swap_dir;
+  gchar            *basename;
+  gint              width;
+  gint              height;
+
+  if (! drawable_undo->buffer || drawable_undo->disk_path)
+    return 0;
+
+  g_object_get (gegl_config (),
+                "swap", &swap_dir,
+                NULL);
+
+  /*  the undo data goes next to the swap, and stays in memory if the
+   *  swap is disabled
+   */
+  if (! swap_dir || ! g_file_test (swap_dir, G_FILE_TEST_IS_DIR))
+    {
+      g_free (swap_dir);
+
+      return 0;
+    }
+
+  format = gegl_buffer_get_format (drawable_undo->buffer);
+  width  = gegl_buffer_get_width  (drawable_undo->buffer);
+  height = gegl_buffer_get_height (drawable_undo->buffer);
+
+  basename = g_strdup_printf ("gimp-undo-%d-%d.gegl",
+                              gimp_get_pid (),
+                              g_atomic_int_add (&disk_id, 1));
+
+  drawable_undo->disk_path = g_build_filename (swap_dir, basename, NULL);
+
+  g_free (basename);
+  g_free (swap_dir);
+
+  buffer = g_object_new (GEGL_TYPE_BUFFER,
+                         "format", format,
+                         "x",      0,
+                         "y",      0,
+                         "width",  width,
+                         "height", height,
+                         "path",   drawable_undo->disk_path,
+                         NULL);
+
+  gegl_buffer_copy (drawable_undo->buffer, NULL, GEGL_ABYSS_NONE,
+                    buffer, NULL);
+  gegl_buffer_flush (buffer);
+
+  g_object_unref (drawable_undo->buffer);
+  drawable_undo->buffer = buffer;
+
+  return (gint64) babl_format_get_bytes_per_pixel (format) * width * height;
+}
+
+
+/*  public functions  */
+
+/**
+ * gimp_drawable_undo_remove_stale_files:
+ *
+ * Removes the undo files which GIMP processes that are no longer
+ * running left behind in the swap directory, because they crashed or
+ * were killed before they could free their undo steps.
+ **/
+void
+gimp_drawable_undo_remove_stale_files (void)
+{
+  GDir        *dir;
+  const gchar *basename;
+  gchar       *swap_dir;
+
+  g_object_get (gegl_config (),
+                "swap", &swap_dir,
+                NULL);
+
+  if (! swap_dir)
+    return;
+
+  dir = g_dir_open (swap_dir, 0, NULL);
+
+  if (dir)
+    {
+      while ((basename = g_dir_read_name (dir)))
+        {
+          const gchar *pid_str;
+          gchar       *end;
+          gchar       *path;
+          gint         pid;
+
+          if (! g_str_has_prefix (basename, "gimp-undo-") ||
+              ! g_str_has_suffix (basename, ".gegl"))
+            continue;
+
+          pid_str = basename + strlen ("gimp-undo-");
+          pid     = strtol (pid_str, &end, 10);
+
+          if (end == pid_str || *end != '-' ||
+              pid == gimp_get_pid ()        ||
+              gimp_drawable_undo_pid_is_alive (pid))
+            continue;
+
+          path = g_build_filename (swap_dir, basename, NULL);
+
+          g_unlink (path);
+          g_free (path);
+        }
+
+      g_dir_close (dir);
+    }
+
+  g_free (swap_dir);
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_drawable_undo_pid_is_alive (gint pid)
+{
+#ifdef G_OS_WIN32
+  HANDLE   process;
+  gboolean alive = FALSE;
+
+  process = OpenProcess (SYNCHRONIZE, FALSE, pid);
+
+  if (process)
+    {
+      alive = (WaitForSingleObject (process, 0) == WAIT_TIMEOUT);
+
+      CloseHandle (process);
+    }
+
+  return alive;
+#else
+  return kill (pid, 0) == 0 || errno == EPERM;
+#endif
+}
@@ -41,6 +41,8 @@ struct _GimpDrawableUndo
   gint          x;
   gint          y;
 
+  gchar        *disk_path;
+
   /* stuff for "Fade" */
   GeglBuffer             *applied_buffer;
   GimpLayerMode           paint_mode;
@@ -56,7 +58,9 @@ struct _GimpDrawableUndoClass
 };
 
 
-GType   gimp_drawable_undo_get_type (void) G_GNUC_CONST;
+GType   gimp_drawable_undo_get_type           (void) G_GNUC_CONST;
+
+void    gimp_drawable_undo_remove_stale_files (void);
 
 
 #endif /* __GIMP_DRAWABLE_UNDO_H__ */
@@ -39,6 +39,19 @@
 #define EPSILON 1e-10
 
 
+/*  a segment's endpoint colors, looked up once for all the samples
+ *  taken from the segment
+ */
+typedef struct
+{
+  GimpGradientSegment *seg;
+  GimpRGB              left;
+  GimpRGB              right;
+  GimpHSV              left_hsv;
+  GimpHSV              right_hsv;
+} GimpGradientSegmentColors;
+
+
 static void          gimp_gradient_tagged_iface_init (GimpTaggedInterface *iface);
 static void          gimp_gradient_finalize          (GObject             *object);
 
@@ -78,6 +91,25 @@ static void          gimp_gradient_get_flat_color    (GimpContext         *conte
                                                       const GimpRGB       *color,
                                                       GimpGradientColor    color_type,
                                                       GimpRGB             *flat_color);
+static void          gimp_gradient_get_colors_internal
+                                                     (GimpGradient        *gradient,
+                                                      GimpContext         *context,
+                                                      const gdouble       *positions,
+                                                      gdouble              left,
+                                                      gdouble              right,
+                                                      gint                 n_colors,
+                                                      gboolean             reverse,
+                                                      GimpRGB             *colors);
+
+static void          gimp_gradient_segment_colors_init
+                                                     (GimpGradient              *gradient,
+                                                      GimpContext               *context,
+                                                      GimpGradientSegment       *seg,
+                                                      GimpGradientSegmentColors *colors);
+static void          gimp_gradient_segment_colors_eval
+                                                     (const GimpGradientSegmentColors *colors,
+                                                      gdouble                          pos,
+                                                      GimpRGB                         *color);
 
 
 static inline gdouble  gimp_gradient_calc_linear_factor            (gdouble  middle,
@@ -200,35 +232,32 @@ gimp_gradient_get_new_preview (GimpViewable *viewable,
                                gint          width,
                                gint          height)
 {
-  GimpGradient        *gradient = GIMP_GRADIENT (viewable);
-  GimpGradientSegment *seg      = NULL;
-  GimpTempBuf         *temp_buf;
-  guchar              *buf;
-  guchar              *p;
-  guchar              *row;
-  gint                 x, y;
-  gdouble              dx, cur_x;
-  GimpRGB              color;
+  GimpGradient *gradient = GIMP_GRADIENT (viewable);
+  GimpTempBuf  *temp_buf;
+  GimpRGB      *colors;
+  guchar       *buf;
+  guchar       *p;
+  guchar       *row;
+  gint          x, y;
+
+  colors = g_new (GimpRGB, width);
+  p      = row = g_malloc (width * 4);
 
-  dx    = 1.0 / (width - 1);
-  cur_x = 0.0;
-  p     = row = g_malloc (width * 4);
+  gimp_gradient_get_uniform_colors (gradient, context, 0.0, 1.0,
+                                    width, FALSE, colors);
 
   /* Create lines to fill the image */
 
   for (x = 0; x < width; x++)
     {
-      seg = gimp_gradient_get_color_at (gradient, context, seg, cur_x,
-                                        FALSE, &color);
-
-      *p++ = ROUND (color.r * 255.0);
-      *p++ = ROUND (color.g * 255.0);
-      *p++ = ROUND (color.b * 255.0);
-      *p++ = ROUND (color.a * 255.0);
-
-      cur_x += dx;
+      *p++ = ROUND (colors[x].r * 255.0);
+      *p++ = ROUND (colors[x].g * 255.0);
+      *p++ = ROUND (colors[x].b * 255.0);
+      *p++ = ROUND (colors[x].a * 255.0);
     }
 
+  g_free (colors);
+
   temp_buf = gimp_temp_buf_new (width, height, babl_format ("R'G'B'A u8"));
 
   buf = gimp_temp_buf_get_data (temp_buf);
@@ -433,12 +462,7 @@ gimp_gradient_get_color_at (GimpGradient        *gradient,
                             gboolean             reverse,
                             GimpRGB             *color)
 {
-  gdouble  factor = 0.0;
-  gdouble  seg_len;
-  gdouble  middle;
-  GimpRGB  left_color;
-  GimpRGB  right_color;
-  GimpRGB  rgb;
+  GimpGradientSegmentColors colors;
 
   g_return_val_if_fail (GIMP_IS_GRADIENT (gradient), NULL);
   g_return_val_if_fail (color != NULL, NULL);
@@ -450,119 +474,71 @@ gimp_gradient_get_color_at (GimpGradient        *gradient,
 
   seg = gimp_gradient_get_segment_at_internal (gradient, seg, pos);
 
-  seg_len = seg->right - seg->left;
-
-  if (seg_len < EPSILON)
-    {
-      middle = 0.5;
-      pos    = 0.5;
-    }
-  else
-    {
-      middle = (seg->middle - seg->left) / seg_len;
-      pos    = (pos - seg->left) / seg_len;
-    }
-
-  switch (seg->type)
-    {
-    case GIMP_GRADIENT_SEGMENT_LINEAR:
-      factor = gimp_gradient_calc_linear_factor (middle, pos);
-      break;
-
-    case GIMP_GRADIENT_SEGMENT_CURVED:
-      factor = gimp_gradient_calc_curved_factor (middle, pos);
-      break;
-
-    case GIMP_GRADIENT_SEGMENT_SINE:
-      factor = gimp_gradient_calc_sine_factor (middle, pos);
-      break;
-
-    case GIMP_GRADIENT_SEGMENT_SPHERE_INCREASING:
-      factor = gimp_gradient_calc_sphere_increasing_factor (middle, pos);
-      break;
-
-    case GIMP_GRADIENT_SEGMENT_SPHERE_DECREASING:
-      factor = gimp_gradient_calc_sphere_decreasing_factor (middle, pos);
-      break;
-
-    default:
-      g_warning ("%s: Unknown gradient type %d.", G_STRFUNC, seg->type);
-      break;
-    }
-
-  /* Get left/right colors */
-
-  gimp_gradient_segment_get_left_flat_color (gradient,
-                                             context, seg, &left_color);
-
-  gimp_gradient_segment_get_right_flat_color (gradient,
-                                              context, seg, &right_color);
-
-  /* Calculate color components */
-
-  if (seg->color == GIMP_GRADIENT_SEGMENT_RGB)
-    {
-      rgb.r = left_color.r + (right_color.r - left_color.r) * factor;
-      rgb.g = left_color.g + (right_color.g - left_color.g) * factor;
-      rgb.b = left_color.b + (right_color.b - left_color.b) * factor;
-    }
-  else
-    {
-      GimpHSV left_hsv;
-      GimpHSV right_hsv;
-
-      gimp_rgb_to_hsv (&left_color,  &left_hsv);
-      gimp_rgb_to_hsv (&right_color, &right_hsv);
-
-      left_hsv.s = left_hsv.s + (right_hsv.s - left_hsv.s) * factor;
-      left_hsv.v = left_hsv.v + (right_hsv.v - left_hsv.v) * factor;
-
-      switch (seg->color)
-        {
-        case GIMP_GRADIENT_SEGMENT_HSV_CCW:
-          if (left_hsv.h < right_hsv.h)
-            {
-              left_hsv.h += (right_hsv.h - left_hsv.h) * factor;
-            }
-          else
-            {
-              left_hsv.h += (1.0 - (left_hsv.h - right_hsv.h)) * factor;
-
-              if (left_hsv.h > 1.0)
-                left_hsv.h -= 1.0;
-            }
-          break;
-
-        case GIMP_GRADIENT_SEGMENT_HSV_CW:
-          if (right_hsv.h < left_hsv.h)
-            {
-              left_hsv.h -= (left_hsv.h - right_hsv.h) * factor;
-            }
-          else
-            {
-              left_hsv.h -= (1.0 - (right_hsv.h - left_hsv.h)) * factor;
-
-              if (left_hsv.h < 0.0)
-                left_hsv.h += 1.0;
-            }
-          break;
-
-        default:
-          g_warning ("%s: Unknown coloring mode %d",
-                     G_STRFUNC, (gint) seg->color);
-          break;
-        }
+  gimp_gradient_segment_colors_init (gradient, context, seg, &colors);
+  gimp_gradient_segment_colors_eval (&colors, pos, color);
 
-      gimp_hsv_to_rgb (&left_hsv, &rgb);
-    }
+  return seg;
+}
 
-  /* Calculate alpha */
+/**
+ * gimp_gradient_get_colors:
+ * @gradient:    a gradient
+ * @context:     a context
+ * @positions:   positions in the gradient (between 0.0 and 1.0)
+ * @n_positions: the number of positions
+ * @reverse:     when %TRUE, use the reversed gradient
+ * @colors:      returns @n_positions colors
+ *
+ * Evaluates the gradient at all of @positions at once, which is much
+ * faster than calling gimp_gradient_get_color_at() for each of them.
+ * The positions can be in any order, but each segment is only looked
+ * up once if they are sorted.
+ **/
+void
+gimp_gradient_get_colors (GimpGradient  *gradient,
+                          GimpContext   *context,
+                          const gdouble *positions,
+                          gint           n_positions,
+                          gboolean       reverse,
+                          GimpRGB       *colors)
+{
+  g_return_if_fail (GIMP_IS_GRADIENT (gradient));
+  g_return_if_fail (positions != NULL || n_positions == 0);
+  g_return_if_fail (colors != NULL || n_positions == 0);
 
-  rgb.a = left_color.a + (right_color.a - left_color.a) * factor;
+  gimp_gradient_get_colors_internal (gradient, context, positions,
+                                     0.0, 0.0, n_positions, reverse,
+                                     colors);
+}
 
-  *color = rgb;
+/**
+ * gimp_gradient_get_uniform_colors:
+ * @gradient: a gradient
+ * @context:  a context
+ * @left:     the position of the first color
+ * @right:    the position of the last color
+ * @n_colors: the number of colors
+ * @reverse:  when %TRUE, use the reversed gradient
+ * @colors:   returns @n_colors colors
+ *
+ * Fills @colors with @n_colors colors evenly spaced between @left and
+ * @right, inclusive, such as for a lookup table or a preview.
+ **/
+void
+gimp_gradient_get_uniform_colors (GimpGradient *gradient,
+                                  GimpContext  *context,
+                                  gdouble       left,
+                                  gdouble       right,
+                                  gint          n_colors,
+                                  gboolean      reverse,
+                                  GimpRGB      *colors)
+{
+  g_return_if_fail (GIMP_IS_GRADIENT (gradient));
+  g_return_if_fail (colors != NULL || n_colors == 0);
 
-  return seg;
+  gimp_gradient_get_colors_internal (gradient, context, NULL,
+                                     left, right, n_colors, reverse,
+                                     colors);
 }
 
 GimpGradientSegment *
@@ -2119,6 +2095,185 @@ gimp_gradient_get_segment_at_internal (GimpGradient        *gradient,
   return seg;
 }
 
+static void
+gimp_gradient_get_colors_internal (GimpGradient  *gradient,
+                                   GimpContext   *context,
+                                   const gdouble *positions,
+                                   gdouble        left,
+                                   gdouble        right,
+                                   gint           n_colors,
+                                   gboolean       reverse,
+                                   GimpRGB       *colors)
+{
+  GimpGradientSegmentColors  seg_colors = { NULL, };
+  GimpGradientSegment       *seg        = NULL;
+  gdouble                    delta      = 0.0;
+  gint                       i;
+
+  if (! positions && n_colors > 1)
+    delta = (right - left) / (n_colors - 1);
+
+  for (i = 0; i < n_colors; i++)
+    {
+      gdouble pos;
+
+      if (positions)
+        pos = positions[i];
+      else
+        pos = left + delta * i;
+
+      pos = CLAMP (pos, 0.0, 1.0);
+
+      if (reverse)
+        pos = 1.0 - pos;
+
+      /*  seeding the search with the last segment makes it free for
+       *  sorted positions
+       */
+      seg = gimp_gradient_get_segment_at_internal (gradient, seg, pos);
+
+      if (seg != seg_colors.seg)
+        gimp_gradient_segment_colors_init (gradient, context, seg,
+                                           &seg_colors);
+
+      gimp_gradient_segment_colors_eval (&seg_colors, pos, &colors[i]);
+    }
+}
+
+static void
+gimp_gradient_segment_colors_init (GimpGradient              *gradient,
+                                   GimpContext               *context,
+                                   GimpGradientSegment       *seg,
+                                   GimpGradientSegmentColors *colors)
+{
+  colors->seg = seg;
+
+  gimp_gradient_segment_get_left_flat_color (gradient,
+                                             context, seg, &colors->left);
+
+  gimp_gradient_segment_get_right_flat_color (gradient,
+                                              context, seg, &colors->right);
+
+  if (seg->color != GIMP_GRADIENT_SEGMENT_RGB)
+    {
+      gimp_rgb_to_hsv (&colors->left,  &colors->left_hsv);
+      gimp_rgb_to_hsv (&colors->right, &colors->right_hsv);
+    }
+}
+
+static void
+gimp_gradient_segment_colors_eval (const GimpGradientSegmentColors *colors,
+                                   gdouble                          pos,
+                                   GimpRGB                         *color)
+{
+  const GimpGradientSegment *seg    = colors->seg;
+  gdouble                    factor = 0.0;
+  gdouble                    seg_len;
+  gdouble                    middle;
+  GimpRGB                    rgb;
+
+  seg_len = seg->right - seg->left;
+
+  if (seg_len < EPSILON)
+    {
+      middle = 0.5;
+      pos    = 0.5;
+    }
+  else
+    {
+      middle = (seg->middle - seg->left) / seg_len;
+      pos    = (pos - seg->left) / seg_len;
+    }
+
+  switch (seg->type)
+    {
+    case GIMP_GRADIENT_SEGMENT_LINEAR:
+      factor = gimp_gradient_calc_linear_factor (middle, pos);
+      break;
+
+    case GIMP_GRADIENT_SEGMENT_CURVED:
+      factor = gimp_gradient_calc_curved_factor (middle, pos);
+      break;
+
+    case GIMP_GRADIENT_SEGMENT_SINE:
+      factor = gimp_gradient_calc_sine_factor (middle, pos);
+      break;
+
+    case GIMP_GRADIENT_SEGMENT_SPHERE_INCREASING:
+      factor = gimp_gradient_calc_sphere_increasing_factor (middle, pos);
+      break;
+
+    case GIMP_GRADIENT_SEGMENT_SPHERE_DECREASING:
+      factor = gimp_gradient_calc_sphere_decreasing_factor (middle, pos);
+      break;
+
+    default:
+      g_warning ("%s: Unknown gradient type %d.", G_STRFUNC, seg->type);
+      break;
+    }
+
+  /* Calculate color components */
+
+  if (seg->color == GIMP_GRADIENT_SEGMENT_RGB)
+    {
+      rgb.r = colors->left.r + (colors->right.r - colors->left.r) * factor;
+      rgb.g = colors->left.g + (colors->right.g - colors->left.g) * factor;
+      rgb.b = colors->left.b + (colors->right.b - colors->left.b) * factor;
+    }
+  else
+    {
+      GimpHSV left_hsv  = colors->left_hsv;
+      GimpHSV right_hsv = colors->right_hsv;
+
+      left_hsv.s = left_hsv.s + (right_hsv.s - left_hsv.s) * factor;
+      left_hsv.v = left_hsv.v + (right_hsv.v - left_hsv.v) * factor;
+
+      switch (seg->color)
+        {
+        case GIMP_GRADIENT_SEGMENT_HSV_CCW:
+          if (left_hsv.h < right_hsv.h)
+            {
+              left_hsv.h += (right_hsv.h - left_hsv.h) * factor;
+            }
+          else
+            {
+              left_hsv.h += (1.0 - (left_hsv.h - right_hsv.h)) * factor;
+
+              if (left_hsv.h > 1.0)
+                left_hsv.h -= 1.0;
+            }
+          break;
+
+        case GIMP_GRADIENT_SEGMENT_HSV_CW:
+          if (right_hsv.h < left_hsv.h)
+            {
+              left_hsv.h -= (left_hsv.h - right_hsv.h) * factor;
+            }
+          else
+            {
+              left_hsv.h -= (1.0 - (right_hsv.h - left_hsv.h)) * factor;
+
+              if (left_hsv.h < 0.0)
+                left_hsv.h += 1.0;
+            }
+          break;
+
+        default:
+          g_warning ("%s: Unknown coloring mode %d",
+                     G_STRFUNC, (gint) seg->color);
+          break;
+        }
+
+      gimp_hsv_to_rgb (&left_hsv, &rgb);
+    }
+
+  /* Calculate alpha */
+
+  rgb.a = colors->left.a + (colors->right.a - colors->left.a) * factor;
+
+  *color = rgb;
+}
+
 static void
 gimp_gradient_get_flat_color (GimpContext       *context,
                               const GimpRGB     *color,
@@ -77,6 +77,20 @@ GimpGradientSegment * gimp_gradient_get_color_at   (GimpGradient        *gradien
                                                     gdouble              pos,
                                                     gboolean             reverse,
                                                     GimpRGB             *color);
+void                  gimp_gradient_get_colors     (GimpGradient        *gradient,
+                                                    GimpContext         *context,
+                                                    const gdouble       *positions,
+                                                    gint                 n_positions,
+                                                    gboolean             reverse,
+                                                    GimpRGB             *colors);
+void                  gimp_gradient_get_uniform_colors
+                                                   (GimpGradient        *gradient,
+                                                    GimpContext         *context,
+                                                    gdouble              left,
+                                                    gdouble              right,
+                                                    gint                 n_colors,
+                                                    gboolean             reverse,
+                                                    GimpRGB             *colors);
 GimpGradientSegment * gimp_gradient_get_segment_at (GimpGradient  *grad,
                                                     gdouble        pos);
 void                  gimp_gradient_split_at       (GimpGradient         *gradient,
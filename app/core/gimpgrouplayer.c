@@ -577,6 +577,10 @@ gimp_group_layer_duplicate (GimpItem *item,
       GET_PRIVATE (new_group)->reallocate_projection = TRUE;
 
       gimp_group_layer_resume_resize (new_group, FALSE);
+
+      /*  and take over what the original has already rendered  */
+      gimp_projection_share_tiles (new_private->projection,
+                                   private->projection);
     }
 
   return new_item;
@@ -1074,6 +1078,11 @@ gimp_group_layer_effective_mode_changed (GimpLayer *layer)
 
   private->pass_through = pass_through;
 
+  /*  the children of pass-through groups are composited in the parent's
+   *  graph, so only render the group's own projection when it's read
+   */
+  gimp_projection_set_lazy (private->projection, pass_through);
+
   gimp_group_layer_update_source_node (group);
   gimp_group_layer_update_mode_node (group);
 
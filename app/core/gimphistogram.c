@@ -31,6 +31,7 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimphistogram.h"
 
 
@@ -42,6 +43,9 @@ enum
   PROP_VALUES
 };
 
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
 struct _GimpHistogramPrivate
 {
   gboolean  linear;
@@ -50,6 +54,19 @@ struct _GimpHistogramPrivate
   gdouble  *values;
 };
 
+typedef struct
+{
+  GimpHistogram       *histogram;
+  GeglBuffer          *buffer;
+  const GeglRectangle *buffer_rect;
+  GeglBuffer          *mask;
+  const GeglRectangle *mask_rect;
+  const Babl          *format;
+  gint                 n_components;
+
+  GMutex               mutex;
+} CalculateContext;
+
 
 /*  local function prototypes  */
 
@@ -66,6 +83,9 @@ static void     gimp_histogram_get_property (GObject       *object,
 static gint64   gimp_histogram_get_memsize  (GimpObject    *object,
                                              gint64        *gui_size);
 
+static void     gimp_histogram_calculate_area
+                                            (const GeglRectangle *area,
+                                             CalculateContext    *context);
 static void     gimp_histogram_alloc_values (GimpHistogram *histogram,
                                              gint           n_components,
                                              gint           n_bins);
@@ -233,12 +253,10 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
                           const GeglRectangle *mask_rect)
 {
   GimpHistogramPrivate *priv;
-  GeglBufferIterator   *iter;
+  CalculateContext      context;
   const Babl           *format;
   gint                  n_components;
   gint                  n_bins;
-  gfloat                n_bins_1f;
-  gfloat                temp;
 
   g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
   g_return_if_fail (GEGL_IS_BUFFER (buffer));
@@ -318,178 +336,83 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
 
   gimp_histogram_alloc_values (histogram, n_components, n_bins);
 
-  iter = gegl_buffer_iterator_new (buffer, buffer_rect, 0, format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-
-  if (mask)
-    gegl_buffer_iterator_add (iter, mask, mask_rect, 0,
-                              babl_format ("Y float"),
-                              GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-
-  n_bins_1f = priv->n_bins - 1;
-
-#define VALUE(c,i) (*(temp = (i) * n_bins_1f,                                  \
-                      &priv->values[(c) * priv->n_bins +                       \
-                                    SIGNED_ROUND (SAFE_CLAMP (temp,            \
-                                                              0.0f,            \
-                                                              n_bins_1f))]))
-
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *data   = iter->data[0];
-      gint          length = iter->length;
-      gfloat        max;
-      gfloat        luminance;
-
-      if (mask)
-        {
-          const gfloat *mask_data = iter->data[1];
-
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (0, data[0]) += masked;
+  context.histogram    = histogram;
+  context.buffer       = buffer;
+  context.buffer_rect  = buffer_rect;
+  context.mask         = mask;
+  context.mask_rect    = mask_rect;
+  context.format       = format;
+  context.n_components = n_components;
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
+  g_mutex_init (&context.mutex);
 
-            case 2:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[1];
+  gimp_parallel_distribute_area (buffer_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_histogram_calculate_area,
+                                 &context);
 
-                  VALUE (0, data[0]) += weight * masked;
-                  VALUE (1, data[1]) += masked;
+  g_mutex_clear (&context.mutex);
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (1, data[0]) += masked;
-                  VALUE (2, data[1]) += masked;
-                  VALUE (3, data[2]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += masked;
-
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (4, luminance) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[3];
-
-                  VALUE (1, data[0]) += weight * masked;
-                  VALUE (2, data[1]) += weight * masked;
-                  VALUE (3, data[2]) += weight * masked;
-                  VALUE (4, data[3]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += weight * masked;
-
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (5, luminance) += weight * masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-            }
-        }
-      else /* no mask */
-        {
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  VALUE (0, data[0]) += 1.0;
-
-                  data += n_components;
-                }
-              break;
-
-            case 2:
-              while (length--)
-                {
-                  const gdouble weight = data[1];
+  g_object_notify (G_OBJECT (histogram), "values");
 
-                  VALUE (0, data[0]) += weight;
-                  VALUE (1, data[1]) += 1.0;
+  g_object_thaw_notify (G_OBJECT (histogram));
+}
 
-                  data += n_components;
-                }
-              break;
+/**
+ * gimp_histogram_merge:
+ * @histogram:    a %GimpHistogram
+ * @histograms:   an array of histograms
+ * @n_histograms: the number of histograms in @histograms
+ *
+ * Sets the values of @histogram to the sum of the values of
+ * @histograms, which must all have the same number of channels and
+ * bins.
+ **/
+void
+gimp_histogram_merge (GimpHistogram  *histogram,
+                      GimpHistogram **histograms,
+                      gint            n_histograms)
+{
+  GimpHistogramPrivate *priv;
+  GimpHistogramPrivate *first;
+  gint                  n_values;
+  gint                  i, j;
 
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  VALUE (1, data[0]) += 1.0;
-                  VALUE (2, data[1]) += 1.0;
-                  VALUE (3, data[2]) += 1.0;
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+  g_return_if_fail (histograms != NULL || n_histograms == 0);
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += 1.0;
+  if (n_histograms == 0 || ! histograms[0]->priv->values)
+    {
+      gimp_histogram_clear_values (histogram);
+      return;
+    }
 
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (4, luminance) += 1.0;
+  priv  = histogram->priv;
+  first = histograms[0]->priv;
 
-                  data += n_components;
-                }
-              break;
+  for (i = 1; i < n_histograms; i++)
+    {
+      g_return_if_fail (histograms[i]->priv->n_channels == first->n_channels &&
+                        histograms[i]->priv->n_bins     == first->n_bins);
+    }
 
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble weight = data[3];
+  g_object_freeze_notify (G_OBJECT (histogram));
 
-                  VALUE (1, data[0]) += weight;
-                  VALUE (2, data[1]) += weight;
-                  VALUE (3, data[2]) += weight;
-                  VALUE (4, data[3]) += 1.0;
+  gimp_histogram_alloc_values (histogram, first->n_channels - 2, first->n_bins);
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += weight;
+  n_values = priv->n_channels * priv->n_bins;
 
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (5, luminance) += weight;
+  for (i = 0; i < n_histograms; i++)
+    {
+      const gdouble *values = histograms[i]->priv->values;
 
-                  data += n_components;
-                }
-              break;
-            }
-        }
+      for (j = 0; j < n_values; j++)
+        priv->values[j] += values[j];
     }
 
   g_object_notify (G_OBJECT (histogram), "values");
 
   g_object_thaw_notify (G_OBJECT (histogram));
-
-#undef VALUE
 }
 
 void
@@ -627,6 +550,14 @@ gimp_histogram_n_bins (GimpHistogram *histogram)
   return histogram->priv->n_bins;
 }
 
+gboolean
+gimp_histogram_get_linear (GimpHistogram *histogram)
+{
+  g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), FALSE);
+
+  return histogram->priv->linear;
+}
+
 gdouble
 gimp_histogram_get_count (GimpHistogram        *histogram,
                           GimpHistogramChannel  channel,
@@ -951,6 +882,209 @@ gimp_histogram_get_std_dev (GimpHistogram        *histogram,
 
 /*  private functions  */
 
+static void
+gimp_histogram_calculate_area (const GeglRectangle *area,
+                               CalculateContext    *context)
+{
+  GimpHistogramPrivate *priv         = context->histogram->priv;
+  const gint            n_components = context->n_components;
+  GeglBufferIterator   *iter;
+  GeglRectangle         mask_area;
+  gdouble              *values;
+  gfloat                n_bins_1f;
+  gfloat                temp;
+  gint                  i;
+
+  iter = gegl_buffer_iterator_new (context->buffer, area, 0, context->format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  if (context->mask)
+    {
+      mask_area    = *area;
+      mask_area.x += context->mask_rect->x - context->buffer_rect->x;
+      mask_area.y += context->mask_rect->y - context->buffer_rect->y;
+
+      gegl_buffer_iterator_add (iter, context->mask, &mask_area, 0,
+                                babl_format ("Y float"),
+                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+    }
+
+  n_bins_1f = priv->n_bins - 1;
+
+  /*  count into a private array, and merge it into the histogram below,
+   *  so that the areas can be counted concurrently
+   */
+  values = g_new0 (gdouble, priv->n_channels * priv->n_bins);
+
+#define VALUE(c,i) (*(temp = (i) * n_bins_1f,                                  \
+                      &values[(c) * priv->n_bins +                             \
+                              SIGNED_ROUND (SAFE_CLAMP (temp,                  \
+                                                        0.0f,                  \
+                                                        n_bins_1f))]))
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *data   = iter->data[0];
+      gint          length = iter->length;
+      gfloat        max;
+      gfloat        luminance;
+
+      if (context->mask)
+        {
+          const gfloat *mask_data = iter->data[1];
+
+          switch (n_components)
+            {
+            case 1:
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (0, data[0]) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 2:
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = data[1];
+
+                  VALUE (0, data[0]) += weight * masked;
+                  VALUE (1, data[1]) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (1, data[0]) += masked;
+                  VALUE (2, data[1]) += masked;
+                  VALUE (3, data[2]) += masked;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += masked;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (4, luminance) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = data[3];
+
+                  VALUE (1, data[0]) += weight * masked;
+                  VALUE (2, data[1]) += weight * masked;
+                  VALUE (3, data[2]) += weight * masked;
+                  VALUE (4, data[3]) += masked;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += weight * masked;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (5, luminance) += weight * masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+            }
+        }
+      else /* no mask */
+        {
+          switch (n_components)
+            {
+            case 1:
+              while (length--)
+                {
+                  VALUE (0, data[0]) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 2:
+              while (length--)
+                {
+                  const gdouble weight = data[1];
+
+                  VALUE (0, data[0]) += weight;
+                  VALUE (1, data[1]) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (length--)
+                {
+                  VALUE (1, data[0]) += 1.0;
+                  VALUE (2, data[1]) += 1.0;
+                  VALUE (3, data[2]) += 1.0;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += 1.0;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (4, luminance) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble weight = data[3];
+
+                  VALUE (1, data[0]) += weight;
+                  VALUE (2, data[1]) += weight;
+                  VALUE (3, data[2]) += weight;
+                  VALUE (4, data[3]) += 1.0;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += weight;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (5, luminance) += weight;
+
+                  data += n_components;
+                }
+              break;
+            }
+        }
+    }
+
+  g_mutex_lock (&context->mutex);
+
+  for (i = 0; i < priv->n_channels * priv->n_bins; i++)
+    priv->values[i] += values[i];
+
+  g_mutex_unlock (&context->mutex);
+
+  g_free (values);
+
+#undef VALUE
+}
+
 static void
 gimp_histogram_alloc_values (GimpHistogram *histogram,
                              gint           n_components,
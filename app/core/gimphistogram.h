@@ -59,6 +59,9 @@ void            gimp_histogram_calculate     (GimpHistogram        *histogram,
                                               const GeglRectangle  *buffer_rect,
                                               GeglBuffer           *mask,
                                               const GeglRectangle  *mask_rect);
+void            gimp_histogram_merge         (GimpHistogram        *histogram,
+                                              GimpHistogram       **histograms,
+                                              gint                  n_histograms);
 
 void            gimp_histogram_clear_values  (GimpHistogram        *histogram);
 
@@ -92,6 +95,7 @@ gdouble         gimp_histogram_get_component (GimpHistogram        *histogram,
                                               gint                  bin);
 gint            gimp_histogram_n_channels    (GimpHistogram        *histogram);
 gint            gimp_histogram_n_bins        (GimpHistogram        *histogram);
+gboolean        gimp_histogram_get_linear    (GimpHistogram        *histogram);
 
 
 #endif /* __GIMP_HISTOGRAM_H__ */
@@ -146,6 +146,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpcontainer.h"
 #include "gimpdrawable.h"
 #include "gimperror.h"
@@ -178,6 +179,8 @@
 
 #define BITS_IN_SAMPLE 8
 
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
 #define R_SHIFT  (BITS_IN_SAMPLE-PRECISION_R)
 #define G_SHIFT  (BITS_IN_SAMPLE-PRECISION_G)
 #define B_SHIFT  (BITS_IN_SAMPLE-PRECISION_B)
@@ -199,6 +202,11 @@ typedef void (* Pass2InitFunc) (QuantizeObj *quantize_obj);
 typedef void (* Pass2Func)     (QuantizeObj *quantize_obj,
                                 GimpLayer   *layer,
                                 GeglBuffer  *new_buffer);
+typedef void (* Pass2AreaFunc) (QuantizeObj         *quantize_obj,
+                                GimpLayer           *layer,
+                                GeglBuffer          *new_buffer,
+                                const GeglRectangle *area,
+                                gulong              *index_used_count);
 typedef void (* CleanupFunc)   (QuantizeObj *quantize_obj);
 
 typedef gulong ColorFreq;
@@ -471,8 +479,11 @@ struct _QuantizeObj
   Pass1Func     first_pass;       /* first pass over image data creates colormap  */
   Pass2InitFunc second_pass_init; /* Initialize data which persists over invocations */
   Pass2Func     second_pass;      /* second pass maps from image data to colormap */
+  Pass2AreaFunc second_pass_area; /* same, for passes which map each pixel on its own */
   CleanupFunc   delete_func;      /* function to clean up data associated with private */
 
+  gboolean      cache_inverse_cmap;       /* remember the inverse colormap   */
+
   GimpPalette  *custom_palette;           /* The custom palette, if any        */
 
   gint          desired_number_of_colors; /* Number of colors we will allow    */
@@ -488,6 +499,8 @@ struct _QuantizeObj
   GimpProgress *progress;
   gint          nth_layer;
   gint          n_layers;
+
+  GMutex        mutex;                    /* protects index_used_count     */
 };
 
 typedef struct
@@ -528,6 +541,13 @@ static void          generate_histogram_rgb  (CFHistogram   histogram,
                                               GimpProgress *progress,
                                               gint          nth_layer,
                                               gint          n_layers);
+static void          generate_histogram_rgb_parallel
+                                             (CFHistogram   histogram,
+                                              GList        *layers,
+                                              gboolean      dither_alpha,
+                                              GimpProgress *progress,
+                                              gint          nth_layer,
+                                              gint          n_layers);
 
 static QuantizeObj * initialize_median_cut   (GimpImageBaseType      old_type,
                                               gint                   max_colors,
@@ -542,6 +562,11 @@ static void          compute_color_lin8      (QuantizeObj           *quantobj,
                                               boxptr                 boxp,
                                               const int              icolor);
 
+static void          median_cut_pass2_layers (QuantizeObj           *quantobj,
+                                              GimpLayer            **layers,
+                                              GeglBuffer           **new_buffers,
+                                              gint                   n_layers);
+
 
 static guchar    found_cols[MAXNUMCOLORS][3];
 static gint      num_found_cols;
@@ -765,6 +790,8 @@ gimp_image_convert_indexed (GimpImage               *image,
   GList             *all_layers;
   GList             *list;
   GimpColorProfile  *dest_profile = NULL;
+  GimpLayer        **layers;
+  GeglBuffer       **new_buffers;
   gint               nth_layer;
   gint               n_layers;
 
@@ -866,6 +893,17 @@ gimp_image_convert_indexed (GimpImage               *image,
               generate_histogram_gray (quantobj->histogram,
                                        layer, dither_alpha);
             }
+          else if (needs_quantize)
+            {
+              /* Once we know we have to quantize, count the
+               * remaining layers all at once.
+               */
+              generate_histogram_rgb_parallel (quantobj->histogram,
+                                               list, dither_alpha,
+                                               progress,
+                                               nth_layer, n_layers);
+              break;
+            }
           else
             {
               /* Note: generate_histogram_rgb may set needs_quantize
@@ -958,6 +996,9 @@ gimp_image_convert_indexed (GimpImage               *image,
   if (quantobj)
     quantobj->n_layers = n_layers;
 
+  layers      = g_new  (GimpLayer *,  n_layers);
+  new_buffers = g_new0 (GeglBuffer *, n_layers);
+
   for (list = all_layers, nth_layer = 0;
        list;
        list = g_list_next (list), nth_layer++)
@@ -965,6 +1006,8 @@ gimp_image_convert_indexed (GimpImage               *image,
       GimpLayer *layer = list->data;
       gboolean   quantize;
 
+      layers[nth_layer] = layer;
+
       if (gimp_item_is_text_layer (GIMP_ITEM (layer)))
         quantize = dither_text_layers;
       else
@@ -972,24 +1015,30 @@ gimp_image_convert_indexed (GimpImage               *image,
 
       if (quantize)
         {
-          GeglBuffer *new_buffer;
-          gboolean    has_alpha;
+          gboolean has_alpha;
 
           has_alpha = gimp_drawable_has_alpha (GIMP_DRAWABLE (layer));
 
-          new_buffer =
+          new_buffers[nth_layer] =
             gegl_buffer_new (GEGL_RECTANGLE (0, 0,
                                              gimp_item_get_width  (GIMP_ITEM (layer)),
                                              gimp_item_get_height (GIMP_ITEM (layer))),
                              gimp_image_get_layer_format (image,
                                                           has_alpha));
+        }
+    }
 
-          quantobj->nth_layer = nth_layer;
-          quantobj->second_pass (quantobj, layer, new_buffer);
+  median_cut_pass2_layers (quantobj, layers, new_buffers, n_layers);
 
+  for (nth_layer = 0; nth_layer < n_layers; nth_layer++)
+    {
+      GimpLayer *layer = layers[nth_layer];
+
+      if (new_buffers[nth_layer])
+        {
           gimp_drawable_set_buffer (GIMP_DRAWABLE (layer), TRUE, NULL,
-                                    new_buffer);
-          g_object_unref (new_buffer);
+                                    new_buffers[nth_layer]);
+          g_object_unref (new_buffers[nth_layer]);
         }
       else
         {
@@ -1003,6 +1052,9 @@ gimp_image_convert_indexed (GimpImage               *image,
         }
     }
 
+  g_free (layers);
+  g_free (new_buffers);
+
   /*  Set the final palette on the image  */
   if (remove_duplicates && (palette_type != GIMP_CONVERT_PALETTE_GENERATE))
     {
@@ -1348,6 +1400,257 @@ generate_histogram_rgb (CFHistogram   histogram,
 }
 
 
+/*  Once we know that the image needs to be quantized, histogramming
+ *  is a plain sum over all pixels, so the remaining layers are split
+ *  into row bands which are counted by several threads at once.  Each
+ *  thread counts into its own histogram, and the histograms are added
+ *  up at the end.
+ */
+
+#define HISTOGRAM_BAND_HEIGHT       128
+#define HISTOGRAM_MIN_THREAD_PIXELS (1024 * 1024)
+
+typedef struct
+{
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  GeglRectangle  rect;
+  gint           offsetx;
+  gint           offsety;
+} HistogramBand;
+
+typedef struct
+{
+  CFHistogram    histogram;
+  CFHistogram   *thread_histograms;
+  gint           n_thread_histograms;
+  HistogramBand *bands;
+  gint           n_bands;
+  gint           next_band;
+  gint           n_done_bands;
+  gboolean       dither_alpha;
+  GimpProgress  *progress;
+  gint           nth_layer;
+  gint           n_layers;
+} HistogramData;
+
+static void
+generate_histogram_rgb_band (CFHistogram          histogram,
+                             const HistogramBand *band,
+                             gboolean             dither_alpha)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle      *roi;
+  gint                bpp;
+  gboolean            has_alpha;
+
+  bpp       = babl_format_get_bytes_per_pixel (band->format);
+  has_alpha = babl_format_has_alpha (band->format);
+
+  iter = gegl_buffer_iterator_new (band->buffer, &band->rect, 0, band->format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  roi = &iter->roi[0];
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const guchar *data   = iter->data[0];
+      gint          length = iter->length;
+
+      if (has_alpha && dither_alpha)
+        {
+          gint col     = roi->x + band->offsetx;
+          gint coledge = col + roi->width;
+          gint row     = roi->y + band->offsety;
+
+          while (length--)
+            {
+              if (data[ALPHA] >= DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
+                (*HIST_RGB (histogram, data[RED], data[GREEN], data[BLUE]))++;
+
+              col++;
+              if (col == coledge)
+                {
+                  col = roi->x + band->offsetx;
+                  row++;
+                }
+
+              data += bpp;
+            }
+        }
+      else if (has_alpha)
+        {
+          while (length--)
+            {
+              if (data[ALPHA] > 127)
+                (*HIST_RGB (histogram, data[RED], data[GREEN], data[BLUE]))++;
+
+              data += bpp;
+            }
+        }
+      else
+        {
+          while (length--)
+            {
+              (*HIST_RGB (histogram, data[RED], data[GREEN], data[BLUE]))++;
+
+              data += bpp;
+            }
+        }
+    }
+}
+
+static void
+generate_histogram_rgb_thread (gint           i,
+                               gint           n,
+                               HistogramData *data)
+{
+  CFHistogram histogram;
+  gint        band;
+
+  /*  the calling thread counts right into the result  */
+  if (i == 0)
+    {
+      histogram = data->histogram;
+    }
+  else
+    {
+      histogram = g_new0 (ColorFreq,
+                          HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
+
+      data->thread_histograms[i - 1] = histogram;
+    }
+
+  while ((band = g_atomic_int_add (&data->next_band, 1)) < data->n_bands)
+    {
+      gint n_done;
+
+      generate_histogram_rgb_band (histogram, &data->bands[band],
+                                   data->dither_alpha);
+
+      n_done = g_atomic_int_add (&data->n_done_bands, 1) + 1;
+
+      /*  only report progress from the calling thread  */
+      if (i == 0 && data->progress)
+        {
+          gimp_progress_set_value (data->progress,
+                                   (data->nth_layer +
+                                    (gdouble) (data->n_layers -
+                                               data->nth_layer) *
+                                    n_done / data->n_bands) /
+                                   (gdouble) data->n_layers);
+        }
+    }
+}
+
+static void
+generate_histogram_rgb_sum (gsize          offset,
+                            gsize          size,
+                            HistogramData *data)
+{
+  gint i;
+
+  for (i = 0; i < data->n_thread_histograms; i++)
+    {
+      const ColorFreq *src  = data->thread_histograms[i];
+      ColorFreq       *dest = data->histogram + offset;
+      gsize            j;
+
+      /*  not all threads might have been started  */
+      if (! src)
+        continue;
+
+      src += offset;
+
+      for (j = 0; j < size; j++)
+        dest[j] += src[j];
+    }
+}
+
+static void
+generate_histogram_rgb_parallel (CFHistogram   histogram,
+                                 GList        *layers,
+                                 gboolean      dither_alpha,
+                                 GimpProgress *progress,
+                                 gint          nth_layer,
+                                 gint          n_layers)
+{
+  HistogramData  data  = { 0, };
+  GArray        *bands;
+  GList         *list;
+  gint64         n_pixels = 0;
+  gint           max_threads;
+  gint           i;
+
+  bands = g_array_new (FALSE, FALSE, sizeof (HistogramBand));
+
+  for (list = layers; list; list = g_list_next (list))
+    {
+      GimpDrawable  *drawable = list->data;
+      HistogramBand  band;
+      gint           width;
+      gint           height;
+      gint           y;
+
+      band.buffer = gimp_drawable_get_buffer (drawable);
+      band.format = gimp_drawable_get_format (drawable);
+
+      g_return_if_fail (band.format == babl_format ("R'G'B' u8") ||
+                        band.format == babl_format ("R'G'B'A u8"));
+
+      gimp_item_get_offset (GIMP_ITEM (drawable),
+                            &band.offsetx, &band.offsety);
+
+      width  = gimp_item_get_width  (GIMP_ITEM (drawable));
+      height = gimp_item_get_height (GIMP_ITEM (drawable));
+
+      for (y = 0; y < height; y += HISTOGRAM_BAND_HEIGHT)
+        {
+          gegl_rectangle_set (&band.rect,
+                              0, y,
+                              width, MIN (HISTOGRAM_BAND_HEIGHT, height - y));
+
+          g_array_append_val (bands, band);
+        }
+
+      n_pixels += (gint64) width * height;
+    }
+
+  /*  each extra thread costs a histogram to clear and to add up,
+   *  make sure it has enough pixels to count to be worth it
+   */
+  max_threads = MAX (1, n_pixels / HISTOGRAM_MIN_THREAD_PIXELS);
+  max_threads = MIN (max_threads, gimp_parallel_get_n_threads ());
+
+  data.histogram           = histogram;
+  data.thread_histograms   = g_new0 (CFHistogram, max_threads);
+  data.n_thread_histograms = max_threads - 1;
+  data.bands               = (HistogramBand *) bands->data;
+  data.n_bands             = bands->len;
+  data.dither_alpha        = dither_alpha;
+  data.progress            = progress;
+  data.nth_layer           = nth_layer;
+  data.n_layers            = n_layers;
+
+  gimp_parallel_distribute (max_threads,
+                            (GimpParallelDistributeFunc) generate_histogram_rgb_thread,
+                            &data);
+
+  if (data.n_thread_histograms > 0)
+    {
+      gimp_parallel_distribute_range (HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS,
+                                      HIST_G_ELEMS * HIST_B_ELEMS,
+                                      (GimpParallelDistributeRangeFunc) generate_histogram_rgb_sum,
+                                      &data);
+    }
+
+  for (i = 0; i < data.n_thread_histograms; i++)
+    g_free (data.thread_histograms[i]);
+
+  g_free (data.thread_histograms);
+  g_array_free (bands, TRUE);
+}
+
+
 
 static boxptr
 find_split_candidate (const boxptr  boxlist,
@@ -2806,9 +3109,11 @@ custompal_pass1 (QuantizeObj *quantobj)
  */
 
 static void
-median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
-                                 GimpLayer   *layer,
-                                 GeglBuffer  *new_buffer)
+median_cut_pass2_no_dither_gray (QuantizeObj         *quantobj,
+                                 GimpLayer           *layer,
+                                 GeglBuffer          *new_buffer,
+                                 const GeglRectangle *area,
+                                 gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -2819,7 +3124,6 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
   gint                src_bpp;
   gint                dest_bpp;
   gint                has_alpha;
-  gulong             *index_used_count = quantobj->index_used_count;
   gboolean            dither_alpha     = quantobj->want_dither_alpha;
   gint                offsetx, offsety;
 
@@ -2834,12 +3138,12 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
   has_alpha = babl_format_has_alpha (src_format);
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -2906,9 +3210,11 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
 }
 
 static void
-median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
-                                    GimpLayer   *layer,
-                                    GeglBuffer  *new_buffer)
+median_cut_pass2_fixed_dither_gray (QuantizeObj         *quantobj,
+                                    GimpLayer           *layer,
+                                    GeglBuffer          *new_buffer,
+                                    const GeglRectangle *area,
+                                    gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -2925,7 +3231,6 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
   gint                err2;
   Color              *color1;
   Color              *color2;
-  gulong             *index_used_count = quantobj->index_used_count;
   gboolean            dither_alpha     = quantobj->want_dither_alpha;
   gint                offsetx, offsety;
 
@@ -2940,12 +3245,12 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
   has_alpha = babl_format_has_alpha (src_format);
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -3074,9 +3379,11 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
 }
 
 static void
-median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
-                                GimpLayer   *layer,
-                                GeglBuffer  *new_buffer)
+median_cut_pass2_no_dither_rgb (QuantizeObj         *quantobj,
+                                GimpLayer           *layer,
+                                GeglBuffer          *new_buffer,
+                                const GeglRectangle *area,
+                                gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -3094,12 +3401,6 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
   gint                alpha_pix        = ALPHA;
   gboolean            dither_alpha     = quantobj->want_dither_alpha;
   gint                offsetx, offsety;
-  gulong             *index_used_count = quantobj->index_used_count;
-  glong               total_size       = 0;
-  glong               layer_size;
-  gint                count            = 0;
-  gint                nth_layer        = quantobj->nth_layer;
-  gint                n_layers         = quantobj->n_layers;
 
   gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
 
@@ -3121,25 +3422,20 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
     }
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
-
   while (gegl_buffer_iterator_next (iter))
     {
       const guchar *src  = iter->data[0];
       guchar       *dest = iter->data[1];
       gint          row;
 
-      total_size += src_roi->height * src_roi->width;
-
       for (row = 0; row < src_roi->height; row++)
         {
           gint col;
@@ -3195,18 +3491,15 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
               dest += dest_bpp;
             }
         }
-
-      if (quantobj->progress && (count % 16 == 0))
-         gimp_progress_set_value (quantobj->progress,
-                                  (nth_layer + ((gdouble) total_size)/
-                                   layer_size) / (gdouble) n_layers);
     }
 }
 
 static void
-median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
-                                   GimpLayer   *layer,
-                                   GeglBuffer  *new_buffer)
+median_cut_pass2_fixed_dither_rgb (QuantizeObj         *quantobj,
+                                   GimpLayer           *layer,
+                                   GeglBuffer          *new_buffer,
+                                   const GeglRectangle *area,
+                                   gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -3230,12 +3523,6 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
   gint                alpha_pix        = ALPHA;
   gboolean            dither_alpha     = quantobj->want_dither_alpha;
   gint                offsetx, offsety;
-  gulong             *index_used_count = quantobj->index_used_count;
-  glong               total_size       = 0;
-  glong               layer_size;
-  gint                count            = 0;
-  gint                nth_layer        = quantobj->nth_layer;
-  gint                n_layers         = quantobj->n_layers;
 
   gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
 
@@ -3257,25 +3544,20 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
     }
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
-
   while (gegl_buffer_iterator_next (iter))
     {
       const guchar *src  = iter->data[0];
       guchar       *dest = iter->data[1];
       gint          row;
 
-      total_size += src_roi->height * src_roi->width;
-
       for (row = 0; row < src_roi->height; row++)
         {
           gint col;
@@ -3430,18 +3712,15 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
               dest += dest_bpp;
             }
         }
-
-      if (quantobj->progress && (count % 16 == 0))
-        gimp_progress_set_value (quantobj->progress,
-                                 (nth_layer + ((gdouble) total_size)/
-                                  layer_size) / (gdouble) n_layers);
     }
 }
 
 static void
-median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
-                                        GimpLayer   *layer,
-                                        GeglBuffer  *new_buffer)
+median_cut_pass2_nodestruct_dither_rgb (QuantizeObj         *quantobj,
+                                        GimpLayer           *layer,
+                                        GeglBuffer          *new_buffer,
+                                        const GeglRectangle *area,
+                                        gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   const Babl         *src_format;
@@ -3472,12 +3751,12 @@ median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
   has_alpha = babl_format_has_alpha (src_format);
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -3873,6 +4152,102 @@ median_cut_pass2_fs_dither_gray (QuantizeObj *quantobj,
   g_free (dest_buf);
 }
 
+/*  The inverse colormap of fixed (web, custom and mono) palettes is
+ *  remembered across conversions, so that converting a batch of images
+ *  to the same palette only has to look up the nearest colors once.
+ *  The first conversion fills the inverse colormap lazily, as usual;
+ *  once the palette is used again, the rest of it is computed up front,
+ *  in parallel.
+ */
+
+typedef struct
+{
+  Color     cmap[256];
+  gint      n_colors;
+  guint16  *cells;    /* colormap index + 1 of each histogram cell, or 0 */
+  gboolean  complete;
+} InverseCmapCache;
+
+static InverseCmapCache inverse_cmap_cache;
+
+static gboolean
+inverse_cmap_cache_matches (QuantizeObj *quantobj)
+{
+  return (inverse_cmap_cache.cells &&
+          inverse_cmap_cache.n_colors == quantobj->actual_number_of_colors &&
+          ! memcmp (inverse_cmap_cache.cmap, quantobj->cmap,
+                    quantobj->actual_number_of_colors * sizeof (Color)));
+}
+
+static void
+inverse_cmap_cache_fill_range (gsize        offset,
+                               gsize        size,
+                               QuantizeObj *quantobj)
+{
+  gint R, G, B;
+
+  for (R = offset; R < offset + size; R++)
+    {
+      for (G = 0; G < HIST_G_ELEMS; G++)
+        {
+          for (B = 0; B < HIST_B_ELEMS; B++)
+            {
+              if (*HIST_LIN (quantobj->histogram, R, G, B) == 0)
+                fill_inverse_cmap_rgb (quantobj, quantobj->histogram, R, G, B);
+            }
+        }
+    }
+}
+
+static void
+inverse_cmap_cache_save (QuantizeObj *quantobj)
+{
+  const gint n_cells = HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS;
+  gint       i;
+
+  if (! inverse_cmap_cache_matches (quantobj))
+    {
+      if (! inverse_cmap_cache.cells)
+        inverse_cmap_cache.cells = g_new (guint16, n_cells);
+
+      memcpy (inverse_cmap_cache.cmap, quantobj->cmap,
+              quantobj->actual_number_of_colors * sizeof (Color));
+
+      inverse_cmap_cache.n_colors = quantobj->actual_number_of_colors;
+      inverse_cmap_cache.complete = FALSE;
+    }
+
+  if (! inverse_cmap_cache.complete)
+    {
+      for (i = 0; i < n_cells; i++)
+        inverse_cmap_cache.cells[i] = quantobj->histogram[i];
+    }
+}
+
+static void
+inverse_cmap_cache_load (QuantizeObj *quantobj)
+{
+  const gint n_cells = HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS;
+  gint       i;
+
+  if (! inverse_cmap_cache_matches (quantobj))
+    return;
+
+  for (i = 0; i < n_cells; i++)
+    quantobj->histogram[i] = inverse_cmap_cache.cells[i];
+
+  if (! inverse_cmap_cache.complete)
+    {
+      gimp_parallel_distribute_range (HIST_R_ELEMS, 1,
+                                      (GimpParallelDistributeRangeFunc) inverse_cmap_cache_fill_range,
+                                      quantobj);
+
+      inverse_cmap_cache_save (quantobj);
+
+      inverse_cmap_cache.complete = TRUE;
+    }
+}
+
 static void
 median_cut_pass2_rgb_init (QuantizeObj *quantobj)
 {
@@ -3893,6 +4268,9 @@ median_cut_pass2_rgb_init (QuantizeObj *quantobj)
                             &quantobj->clin[i].green,
                             &quantobj->clin[i].blue);
     }
+
+  if (quantobj->cache_inverse_cmap)
+    inverse_cmap_cache_load (quantobj);
 }
 
 static void
@@ -4281,9 +4659,163 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 }
 
 
+/*  The pixel-local passes are split into areas which are mapped by
+ *  several threads at once.  Note that the inverse colormap in the
+ *  histogram is then filled lazily from several threads; this is
+ *  fine since every cell only ever receives one value, which only
+ *  depends on the colormap.
+ */
+
+typedef struct
+{
+  QuantizeObj *quantobj;
+  GimpLayer   *layer;
+  GeglBuffer  *new_buffer;
+} Pass2AreaData;
+
+static void
+median_cut_pass2_parallel_area (const GeglRectangle *area,
+                                Pass2AreaData       *data)
+{
+  QuantizeObj *quantobj              = data->quantobj;
+  gulong       index_used_count[256] = { 0, };
+  gint         i;
+
+  quantobj->second_pass_area (quantobj, data->layer, data->new_buffer,
+                              area, index_used_count);
+
+  g_mutex_lock (&quantobj->mutex);
+
+  for (i = 0; i < 256; i++)
+    quantobj->index_used_count[i] += index_used_count[i];
+
+  g_mutex_unlock (&quantobj->mutex);
+}
+
+static void
+median_cut_pass2_parallel (QuantizeObj *quantobj,
+                           GimpLayer   *layer,
+                           GeglBuffer  *new_buffer)
+{
+  Pass2AreaData data;
+
+  data.quantobj   = quantobj;
+  data.layer      = layer;
+  data.new_buffer = new_buffer;
+
+  gimp_parallel_distribute_area (gegl_buffer_get_extent (new_buffer),
+                                 MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc) median_cut_pass2_parallel_area,
+                                 &data);
+
+  if (quantobj->progress)
+    gimp_progress_set_value (quantobj->progress,
+                             (quantobj->nth_layer + 1) /
+                             (gdouble) quantobj->n_layers);
+}
+
+
+/*  Error diffusion can't be split within a layer, so whole layers are
+ *  dithered by several threads at once instead.
+ */
+
+typedef struct
+{
+  QuantizeObj  *quantobj;
+  GimpLayer   **layers;
+  GeglBuffer  **new_buffers;
+  gint          n_layers;
+  gint          next_layer;
+} Pass2LayersData;
+
+static void
+median_cut_pass2_layers_func (gint             i,
+                              gint             n,
+                              Pass2LayersData *data)
+{
+  QuantizeObj quantobj;
+  gint        nth_layer;
+  gint        j;
+
+  /*  each thread works on a copy of the quantizer, which has its own
+   *  index counts, and shares the histogram and colormap
+   */
+  quantobj = *data->quantobj;
+
+  memset (quantobj.index_used_count, 0, sizeof (quantobj.index_used_count));
+
+  /*  only report progress from the calling thread  */
+  if (i != 0)
+    quantobj.progress = NULL;
+
+  while ((nth_layer = g_atomic_int_add (&data->next_layer, 1)) <
+         data->n_layers)
+    {
+      if (! data->new_buffers[nth_layer])
+        continue;
+
+      quantobj.nth_layer = nth_layer;
+
+      quantobj.second_pass (&quantobj,
+                            data->layers[nth_layer],
+                            data->new_buffers[nth_layer]);
+    }
+
+  g_mutex_lock (&data->quantobj->mutex);
+
+  for (j = 0; j < 256; j++)
+    data->quantobj->index_used_count[j] += quantobj.index_used_count[j];
+
+  g_mutex_unlock (&data->quantobj->mutex);
+}
+
+static void
+median_cut_pass2_layers (QuantizeObj  *quantobj,
+                         GimpLayer   **layers,
+                         GeglBuffer  **new_buffers,
+                         gint          n_layers)
+{
+  if (quantobj->second_pass_area)
+    {
+      gint nth_layer;
+
+      /*  these already run in parallel within each layer  */
+      for (nth_layer = 0; nth_layer < n_layers; nth_layer++)
+        {
+          if (! new_buffers[nth_layer])
+            continue;
+
+          quantobj->nth_layer = nth_layer;
+
+          quantobj->second_pass (quantobj,
+                                 layers[nth_layer], new_buffers[nth_layer]);
+        }
+    }
+  else
+    {
+      Pass2LayersData data;
+
+      data.quantobj    = quantobj;
+      data.layers      = layers;
+      data.new_buffers = new_buffers;
+      data.n_layers    = n_layers;
+      data.next_layer  = 0;
+
+      gimp_parallel_distribute (n_layers,
+                                (GimpParallelDistributeFunc) median_cut_pass2_layers_func,
+                                &data);
+    }
+}
+
+
 static void
 delete_median_cut (QuantizeObj *quantobj)
 {
+  if (quantobj->cache_inverse_cmap)
+    inverse_cmap_cache_save (quantobj);
+
+  g_mutex_clear (&quantobj->mutex);
+
   g_free (quantobj->histogram);
   g_free (quantobj);
 }
@@ -4339,6 +4871,7 @@ initialize_median_cut (GimpImageBaseType       type,
     quantobj->histogram = g_new (ColorFreq,
                                  HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
 
+  quantobj->second_pass_area         = NULL;
   quantobj->custom_palette           = custom_palette;
   quantobj->desired_number_of_colors = num_colors;
   quantobj->want_dither_alpha        = want_dither_alpha;
@@ -4374,7 +4907,8 @@ initialize_median_cut (GimpImageBaseType       type,
               g_warning("Uh-oh, bad dither type, W1");
             case GIMP_CONVERT_DITHER_NONE:
               quantobj->second_pass_init = median_cut_pass2_rgb_init;
-              quantobj->second_pass = median_cut_pass2_no_dither_rgb;
+              quantobj->second_pass = median_cut_pass2_parallel;
+              quantobj->second_pass_area = median_cut_pass2_no_dither_rgb;
               break;
             case GIMP_CONVERT_DITHER_FS:
               quantobj->error_freedom = 0;
@@ -4388,7 +4922,8 @@ initialize_median_cut (GimpImageBaseType       type,
               break;
             case GIMP_CONVERT_DITHER_FIXED:
               quantobj->second_pass_init = median_cut_pass2_rgb_init;
-              quantobj->second_pass = median_cut_pass2_fixed_dither_rgb;
+              quantobj->second_pass = median_cut_pass2_parallel;
+              quantobj->second_pass_area = median_cut_pass2_fixed_dither_rgb;
               break;
             }
         }
@@ -4401,7 +4936,8 @@ initialize_median_cut (GimpImageBaseType       type,
               g_warning("Uh-oh, bad dither type, W2");
             case GIMP_CONVERT_DITHER_NONE:
               quantobj->second_pass_init = median_cut_pass2_gray_init;
-              quantobj->second_pass = median_cut_pass2_no_dither_gray;
+              quantobj->second_pass = median_cut_pass2_parallel;
+              quantobj->second_pass_area = median_cut_pass2_no_dither_gray;
               break;
             case GIMP_CONVERT_DITHER_FS:
               quantobj->error_freedom = 0;
@@ -4415,7 +4951,8 @@ initialize_median_cut (GimpImageBaseType       type,
               break;
             case GIMP_CONVERT_DITHER_FIXED:
               quantobj->second_pass_init = median_cut_pass2_gray_init;
-              quantobj->second_pass = median_cut_pass2_fixed_dither_gray;
+              quantobj->second_pass = median_cut_pass2_parallel;
+              quantobj->second_pass_area = median_cut_pass2_fixed_dither_gray;
               break;
             }
         }
@@ -4444,7 +4981,8 @@ initialize_median_cut (GimpImageBaseType       type,
         {
         case GIMP_CONVERT_DITHER_NONE:
           quantobj->second_pass_init = median_cut_pass2_rgb_init;
-          quantobj->second_pass = median_cut_pass2_no_dither_rgb;
+          quantobj->second_pass = median_cut_pass2_parallel;
+          quantobj->second_pass_area = median_cut_pass2_no_dither_rgb;
           break;
         case GIMP_CONVERT_DITHER_FS:
           quantobj->error_freedom = 0;
@@ -4458,11 +4996,13 @@ initialize_median_cut (GimpImageBaseType       type,
           break;
         case GIMP_CONVERT_DITHER_NODESTRUCT:
           quantobj->second_pass_init = NULL;
-          quantobj->second_pass = median_cut_pass2_nodestruct_dither_rgb;
+          quantobj->second_pass = median_cut_pass2_parallel;
+          quantobj->second_pass_area = median_cut_pass2_nodestruct_dither_rgb;
           break;
         case GIMP_CONVERT_DITHER_FIXED:
           quantobj->second_pass_init = median_cut_pass2_rgb_init;
-          quantobj->second_pass = median_cut_pass2_fixed_dither_rgb;
+          quantobj->second_pass = median_cut_pass2_parallel;
+          quantobj->second_pass_area = median_cut_pass2_fixed_dither_rgb;
           break;
         }
       break;
@@ -4473,5 +5013,12 @@ initialize_median_cut (GimpImageBaseType       type,
 
   quantobj->delete_func = delete_median_cut;
 
+  /*  only fixed palettes are worth remembering the inverse colormap of  */
+  quantobj->cache_inverse_cmap =
+    (palette_type != GIMP_CONVERT_PALETTE_GENERATE &&
+     quantobj->second_pass_init == median_cut_pass2_rgb_init);
+
+  g_mutex_init (&quantobj->mutex);
+
   return quantobj;
 }
@@ -29,7 +29,9 @@
 #include "core-types.h"
 
 #include "gegl/gimp-babl.h"
+#include "gegl/gimp-gegl-loops.h"
 
+#include "gimp-memory-budget.h"
 #include "gimpdrawable.h"
 #include "gimpdrawable-operation.h"
 #include "gimpimage.h"
@@ -62,6 +64,7 @@ gimp_image_convert_precision (GimpImage        *image,
   const gchar      *undo_desc    = NULL;
   GimpProgress     *sub_progress = NULL;
   gint              nth_drawable, n_drawables;
+  gint64            reserved     = 0;
 
   g_return_if_fail (GIMP_IS_IMAGE (image));
   g_return_if_fail (precision != gimp_image_get_precision (image));
@@ -74,6 +77,26 @@ gimp_image_convert_precision (GimpImage        *image,
 
   n_drawables = g_list_length (all_drawables) + 1 /* + selection */;
 
+  /*  account for the converted pixels against the memory budget  */
+  for (list = all_drawables; list; list = g_list_next (list))
+    {
+      GimpItem *item = list->data;
+
+      reserved += gimp_drawable_estimate_memsize (
+        GIMP_DRAWABLE (item),
+        gimp_babl_component_type (precision),
+        gimp_item_get_width  (item),
+        gimp_item_get_height (item));
+    }
+
+  reserved += gimp_drawable_estimate_memsize (
+    GIMP_DRAWABLE (gimp_image_get_mask (image)),
+    gimp_babl_component_type (precision),
+    gimp_image_get_width  (image),
+    gimp_image_get_height (image));
+
+  gimp_memory_budget_reserve (reserved);
+
   if (progress)
     sub_progress = gimp_sub_progress_new (progress);
 
@@ -172,6 +195,12 @@ gimp_image_convert_precision (GimpImage        *image,
         new_profile = g_object_ref (old_profile);
     }
 
+  /*  text layers are re-rendered instead of converted, lay them
+   *  all out at once instead of one after the other
+   */
+  if (text_layer_dither_type == GEGL_DITHER_NONE)
+    gimp_text_layers_prepare_render (all_drawables);
+
   for (list = all_drawables, nth_drawable = 0;
        list;
        list = g_list_next (list), nth_drawable++)
@@ -224,9 +253,9 @@ gimp_image_convert_precision (GimpImage        *image,
                                               gimp_image_get_height (image)),
                               gimp_image_get_mask_format (image));
 
-    gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)), NULL,
-                      GEGL_ABYSS_NONE,
-                      buffer, NULL);
+    gimp_gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)), NULL,
+                           GEGL_ABYSS_NONE,
+                           buffer, NULL);
 
     gimp_drawable_set_buffer (GIMP_DRAWABLE (mask), FALSE, NULL, buffer);
     g_object_unref (buffer);
@@ -242,6 +271,8 @@ gimp_image_convert_precision (GimpImage        *image,
   gimp_image_precision_changed (image);
   g_object_thaw_notify (G_OBJECT (image));
 
+  gimp_memory_budget_release (reserved);
+
   if (sub_progress)
     g_object_unref (sub_progress);
 
@@ -38,6 +38,8 @@
 #include "gimpprogress.h"
 #include "gimpsubprogress.h"
 
+#include "text/gimptextlayer.h"
+
 #include "gimp-intl.h"
 
 
@@ -123,6 +125,11 @@ gimp_image_convert_type (GimpImage          *image,
         dest_profile = gimp_image_get_builtin_color_profile (image);
     }
 
+  /*  text layers are re-rendered instead of converted, lay them
+   *  all out at once instead of one after the other
+   */
+  gimp_text_layers_prepare_render (all_layers);
+
   for (list = all_layers, nth_layer = 0;
        list;
        list = g_list_next (list), nth_layer++)
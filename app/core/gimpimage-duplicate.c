@@ -42,6 +42,7 @@
 #include "gimplayermask.h"
 #include "gimplayer-floating-selection.h"
 #include "gimpparasitelist.h"
+#include "gimpprojection.h"
 #include "gimpsamplepoint.h"
 
 #include "vectors/gimpvectors.h"
@@ -81,6 +82,8 @@ static void          gimp_image_duplicate_parasites        (GimpImage *image,
                                                             GimpImage *new_image);
 static void          gimp_image_duplicate_color_profile    (GimpImage *image,
                                                             GimpImage *new_image);
+static void          gimp_image_duplicate_projection       (GimpImage *image,
+                                                            GimpImage *new_image);
 
 
 GimpImage *
@@ -160,6 +163,9 @@ gimp_image_duplicate (GimpImage *image)
   /*  Copy the quick mask info  */
   gimp_image_duplicate_quick_mask (image, new_image);
 
+  /*  Share the already rendered parts of the projection  */
+  gimp_image_duplicate_projection (image, new_image);
+
   gimp_image_undo_enable (new_image);
 
   return new_image;
@@ -486,7 +492,7 @@ gimp_image_duplicate_metadata (GimpImage *image,
 
   if (metadata)
     {
-      metadata = gimp_metadata_duplicate (metadata);
+      metadata = gimp_image_copy_metadata (image);
       gimp_image_set_metadata (new_image, metadata, FALSE);
       g_object_unref (metadata);
     }
@@ -526,3 +532,11 @@ gimp_image_duplicate_color_profile (GimpImage *image,
 
   gimp_image_set_color_profile (new_image, profile, NULL);
 }
+
+static void
+gimp_image_duplicate_projection (GimpImage *image,
+                                 GimpImage *new_image)
+{
+  gimp_projection_share_tiles (gimp_image_get_projection (new_image),
+                               gimp_image_get_projection (image));
+}
@@ -31,10 +31,12 @@
 #include "gegl/gimp-gegl-apply-operation.h"
 #include "gegl/gimp-gegl-nodes.h"
 #include "gegl/gimp-gegl-utils.h"
+#include "gegl/gimptilehandlervalidate.h"
 
 #include "vectors/gimpvectors.h"
 
 #include "gimp.h"
+#include "gimp-memory-budget.h"
 #include "gimpcontext.h"
 #include "gimperror.h"
 #include "gimpgrouplayer.h"
@@ -49,16 +51,40 @@
 #include "gimpparasitelist.h"
 #include "gimppickable.h"
 #include "gimpprojectable.h"
+#include "gimpprojection.h"
 #include "gimpundostack.h"
 
 #include "gimp-intl.h"
 
 
-static GimpLayer * gimp_image_merge_layers (GimpImage     *image,
-                                            GimpContainer *container,
-                                            GSList        *merge_list,
-                                            GimpContext   *context,
-                                            GimpMergeType  merge_type);
+/*  the height of the bands in which merged layers are rendered, when
+ *  some of their tiles can be discarded after use
+ */
+#define MERGE_BAND_HEIGHT 256
+
+
+static GimpLayer * gimp_image_merge_layers          (GimpImage     *image,
+                                                     GimpContainer *container,
+                                                     GSList        *merge_list,
+                                                     GimpContext   *context,
+                                                     GimpMergeType  merge_type);
+static GList     * gimp_image_merge_add_discardable (GList         *drawables,
+                                                     GimpDrawable  *drawable);
+static GList     * gimp_image_merge_get_discardable (GSList        *merge_list);
+static void        gimp_image_merge_discard         (GList         *drawables,
+                                                     gint           y1,
+                                                     gint           y2);
+static void        gimp_image_merge_render          (GeglNode      *node,
+                                                     GeglBuffer    *buffer,
+                                                     gint           y,
+                                                     GSList        *merge_list);
+static gboolean    gimp_image_merge_is_projection   (GimpImage     *image,
+                                                     GimpContainer *container,
+                                                     GSList        *merge_list,
+                                                     gint           x1,
+                                                     gint           y1,
+                                                     gint           x2,
+                                                     gint           y2);
 
 
 /*  public functions  */
@@ -452,6 +478,9 @@ gimp_image_merge_layers (GimpImage     *image,
   GeglNode         *last_node;
   GeglNode         *last_node_source;
   GimpParasiteList *parasites;
+  gint64            reserved;
+  GimpRGB           bg;
+  gboolean          use_projection;
 
   g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
@@ -538,16 +567,25 @@ gimp_image_merge_layers (GimpImage     *image,
   if ((x2 - x1) == 0 || (y2 - y1) == 0)
     return NULL;
 
+  /*  account for the merged layer against the memory budget  */
+  reserved = (gint64) (x2 - x1) * (y2 - y1) *
+             babl_format_get_bytes_per_pixel (
+               gimp_image_get_layer_format (image, TRUE));
+
+  gimp_memory_budget_reserve (reserved);
+
   bottom_layer = layer;
 
   flatten_node = NULL;
 
+  use_projection = gimp_image_merge_is_projection (image, container,
+                                                   merge_list,
+                                                   x1, y1, x2, y2);
+
   if (merge_type == GIMP_FLATTEN_IMAGE ||
       (gimp_drawable_is_indexed (GIMP_DRAWABLE (layer)) &&
        ! gimp_drawable_has_alpha (GIMP_DRAWABLE (layer))))
     {
-      GimpRGB bg;
-
       merge_layer = gimp_layer_new (image, (x2 - x1), (y2 - y1),
                                     gimp_image_get_layer_format (image, FALSE),
                                     gimp_object_get_name (bottom_layer),
@@ -558,6 +596,8 @@ gimp_image_merge_layers (GimpImage     *image,
         {
           g_warning ("%s: could not allocate merge layer", G_STRFUNC);
 
+          gimp_memory_budget_release (reserved);
+
           return NULL;
         }
 
@@ -566,8 +606,11 @@ gimp_image_merge_layers (GimpImage     *image,
       gimp_pickable_srgb_to_image_color (GIMP_PICKABLE (layer),
                                          &bg, &bg);
 
-      flatten_node = gimp_gegl_create_flatten_node (
-        &bg, gimp_layer_get_real_composite_space (bottom_layer));
+      if (! use_projection)
+        {
+          flatten_node = gimp_gegl_create_flatten_node (
+            &bg, gimp_layer_get_real_composite_space (bottom_layer));
+        }
 
       position = 0;
     }
@@ -589,6 +632,8 @@ gimp_image_merge_layers (GimpImage     *image,
         {
           g_warning ("%s: could not allocate merge layer", G_STRFUNC);
 
+          gimp_memory_budget_release (reserved);
+
           return NULL;
         }
 
@@ -602,44 +647,77 @@ gimp_image_merge_layers (GimpImage     *image,
 
   gimp_item_set_offset (GIMP_ITEM (merge_layer), x1, y1);
 
-  offset_node = gegl_node_new_child (node,
-                                     "operation", "gegl:translate",
-                                     "x",         (gdouble) -x1,
-                                     "y",         (gdouble) -y1,
-                                     NULL);
-
-  if (flatten_node)
+  if (use_projection)
     {
-      gegl_node_add_child (node, flatten_node);
-      g_object_unref (flatten_node);
+      /*  the image's projection already holds the merged layers, reuse
+       *  its tiles instead of compositing them again
+       */
+      GimpPickable *projection = GIMP_PICKABLE (gimp_image_get_projection (image));
+      GeglBuffer   *buffer;
+
+      gimp_pickable_flush (projection);
+
+      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (merge_layer));
+
+      /*  the projection renders its tiles as they are read, which must
+       *  not happen on several threads at once, so copy it on this
+       *  thread, and only then flatten the copy
+       */
+      gegl_buffer_copy (gimp_pickable_get_buffer (projection),
+                        GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1),
+                        GEGL_ABYSS_NONE,
+                        buffer,
+                        GEGL_RECTANGLE (0, 0, x2 - x1, y2 - y1));
 
-      gegl_node_link_many (source_node, flatten_node, offset_node, NULL);
+      if (merge_type == GIMP_FLATTEN_IMAGE)
+        {
+          gimp_gegl_apply_flatten (buffer, NULL, NULL,
+                                   buffer,
+                                   &bg,
+                                   gimp_layer_get_real_composite_space (bottom_layer));
+        }
     }
   else
     {
-      gegl_node_link_many (source_node, offset_node, NULL);
-    }
+      offset_node = gegl_node_new_child (node,
+                                         "operation", "gegl:translate",
+                                         "x",         (gdouble) -x1,
+                                         "y",         (gdouble) -y1,
+                                         NULL);
 
-  /*  Disconnect the bottom-layer node's input  */
-  last_node        = gimp_filter_get_node (GIMP_FILTER (bottom_layer));
-  last_node_source = gegl_node_get_producer (last_node, "input", NULL);
+      if (flatten_node)
+        {
+          gegl_node_add_child (node, flatten_node);
+          g_object_unref (flatten_node);
 
-  gegl_node_disconnect (last_node, "input");
+          gegl_node_link_many (source_node, flatten_node, offset_node, NULL);
+        }
+      else
+        {
+          gegl_node_link_many (source_node, offset_node, NULL);
+        }
 
-  /*  Render the graph into the merge layer  */
-  gegl_node_blit_buffer (offset_node,
-                         gimp_drawable_get_buffer (GIMP_DRAWABLE (merge_layer)),
-                         NULL, 0, GEGL_ABYSS_NONE);
+      /*  Disconnect the bottom-layer node's input  */
+      last_node        = gimp_filter_get_node (GIMP_FILTER (bottom_layer));
+      last_node_source = gegl_node_get_producer (last_node, "input", NULL);
 
-  /*  Reconnect the bottom-layer node's input  */
-  if (last_node_source)
-    gegl_node_link (last_node_source, last_node);
+      gegl_node_disconnect (last_node, "input");
 
-  /*  Clean up the graph  */
-  gegl_node_remove_child (node, offset_node);
+      /*  Render the graph into the merge layer  */
+      gimp_image_merge_render (offset_node,
+                               gimp_drawable_get_buffer (GIMP_DRAWABLE (merge_layer)),
+                               y1, merge_list);
 
-  if (flatten_node)
-    gegl_node_remove_child (node, flatten_node);
+      /*  Reconnect the bottom-layer node's input  */
+      if (last_node_source)
+        gegl_node_link (last_node_source, last_node);
+
+      /*  Clean up the graph  */
+      gegl_node_remove_child (node, offset_node);
+
+      if (flatten_node)
+        gegl_node_remove_child (node, flatten_node);
+    }
 
   /* Copy the tattoo and parasites of the bottom layer to the new layer */
   gimp_item_set_tattoo (GIMP_ITEM (merge_layer),
@@ -683,5 +761,221 @@ gimp_image_merge_layers (GimpImage     *image,
 
   gimp_drawable_update (GIMP_DRAWABLE (merge_layer), 0, 0, -1, -1);
 
+  gimp_memory_budget_release (reserved);
+
   return merge_layer;
 }
+
+static GList *
+gimp_image_merge_add_discardable (GList        *drawables,
+                                  GimpDrawable *drawable)
+{
+  GimpTileHandlerValidate *validate;
+
+  validate =
+    gimp_tile_handler_validate_get_assigned (gimp_drawable_get_buffer (drawable));
+
+  if (validate && validate->discardable)
+    drawables = g_list_prepend (drawables, drawable);
+
+  return drawables;
+}
+
+/*  returns the drawables taking part in the merge whose tiles can be
+ *  discarded, and validated again, such as the ones of lazily loaded
+ *  layers
+ */
+static GList *
+gimp_image_merge_get_discardable (GSList *merge_list)
+{
+  GList  *drawables = NULL;
+  GSList *layers;
+
+  for (layers = merge_list; layers; layers = g_slist_next (layers))
+    {
+      GList *items;
+      GList *list;
+
+      if (gimp_viewable_get_children (layers->data))
+        {
+          GimpContainer *children = gimp_viewable_get_children (layers->data);
+
+          items = gimp_item_stack_get_item_list (GIMP_ITEM_STACK (children));
+        }
+      else
+        {
+          items = g_list_prepend (NULL, layers->data);
+        }
+
+      for (list = items; list; list = g_list_next (list))
+        {
+          GimpLayer *layer = list->data;
+
+          /*  the buffers of groups are their projections  */
+          if (! gimp_viewable_get_children (GIMP_VIEWABLE (layer)))
+            {
+              drawables = gimp_image_merge_add_discardable (drawables,
+                                                            GIMP_DRAWABLE (layer));
+            }
+
+          if (gimp_layer_get_mask (layer))
+            {
+              drawables = gimp_image_merge_add_discardable (
+                drawables, GIMP_DRAWABLE (gimp_layer_get_mask (layer)));
+            }
+        }
+
+      g_list_free (items);
+    }
+
+  return drawables;
+}
+
+/*  discards the tiles of 'drawables' in the image rows between 'y1'
+ *  and 'y2', which have been rendered, including the tiles which
+ *  started above 'y1'
+ */
+static void
+gimp_image_merge_discard (GList *drawables,
+                          gint   y1,
+                          gint   y2)
+{
+  GList *list;
+
+  for (list = drawables; list; list = g_list_next (list))
+    {
+      GimpDrawable            *drawable = list->data;
+      GimpTileHandlerValidate *validate;
+      GeglRectangle            rect;
+      gint                     off_x, off_y;
+
+      validate =
+        gimp_tile_handler_validate_get_assigned (gimp_drawable_get_buffer (drawable));
+
+      gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+      rect.y      = MAX (y1 - off_y, 0);
+      rect.y     -= rect.y % validate->tile_height;
+      rect.height = MIN (y2 - off_y, gimp_item_get_height (GIMP_ITEM (drawable)));
+
+      /*  the last row of tiles extends past the drawable  */
+      if (rect.height == gimp_item_get_height (GIMP_ITEM (drawable)))
+        rect.height += validate->tile_height - 1;
+
+      rect.height -= rect.y;
+
+      rect.x      = 0;
+      rect.width  = gimp_item_get_width (GIMP_ITEM (drawable)) +
+                    validate->tile_width - 1;
+
+      if (rect.height > 0)
+        gimp_tile_handler_validate_discard (validate, &rect);
+    }
+}
+
+static void
+gimp_image_merge_render (GeglNode   *node,
+                         GeglBuffer *buffer,
+                         gint        y,
+                         GSList     *merge_list)
+{
+  GList *drawables = gimp_image_merge_get_discardable (merge_list);
+
+  if (drawables)
+    {
+      /*  render the merge layer in bands, and drop the tiles of the
+       *  discardable drawables that have been used, so that lazily
+       *  loaded layers only need to be in memory one band at a time
+       */
+      gint width  = gegl_buffer_get_width  (buffer);
+      gint height = gegl_buffer_get_height (buffer);
+      gint band_y;
+
+      for (band_y = 0; band_y < height; band_y += MERGE_BAND_HEIGHT)
+        {
+          gint band_height = MIN (MERGE_BAND_HEIGHT, height - band_y);
+
+          gegl_node_blit_buffer (node, buffer,
+                                 GEGL_RECTANGLE (0, band_y, width, band_height),
+                                 0, GEGL_ABYSS_NONE);
+
+          gimp_image_merge_discard (drawables,
+                                    y + band_y, y + band_y + band_height);
+        }
+
+      g_list_free (drawables);
+    }
+  else
+    {
+      gegl_node_blit_buffer (node, buffer, NULL, 0, GEGL_ABYSS_NONE);
+    }
+}
+
+/*  returns whether merging 'merge_list' into the area from 'x1', 'y1'
+ *  to 'x2', 'y2' gives exactly the image's projection, i.e. whether
+ *  all of the image's visible layers are merged, over the whole
+ *  image, and nothing else contributes to the projection
+ */
+static gboolean
+gimp_image_merge_is_projection (GimpImage     *image,
+                                GimpContainer *container,
+                                GSList        *merge_list,
+                                gint           x1,
+                                gint           y1,
+                                gint           x2,
+                                gint           y2)
+{
+  GList *drawables;
+  GList *list;
+  gint   n_visible = 0;
+
+  if (container != gimp_image_get_layers (image))
+    return FALSE;
+
+  if (x1 != 0 || y1 != 0                 ||
+      x2 != gimp_image_get_width  (image) ||
+      y2 != gimp_image_get_height (image))
+    return FALSE;
+
+  if (gimp_image_get_floating_selection (image) ||
+      gimp_image_get_visible_mask (image) != GIMP_COMPONENT_MASK_ALL)
+    return FALSE;
+
+  for (list = gimp_image_get_channel_iter (image);
+       list;
+       list = g_list_next (list))
+    {
+      if (gimp_item_get_visible (list->data))
+        return FALSE;
+    }
+
+  for (list = gimp_image_get_layer_iter (image);
+       list;
+       list = g_list_next (list))
+    {
+      if (gimp_item_get_visible (list->data))
+        {
+          if (! g_slist_find (merge_list, list->data))
+            return FALSE;
+
+          n_visible++;
+        }
+    }
+
+  if (n_visible != g_slist_length (merge_list))
+    return FALSE;
+
+  /*  lazily loaded layers are better merged band by band, see
+   *  gimp_image_merge_render()
+   */
+  drawables = gimp_image_merge_get_discardable (merge_list);
+
+  if (drawables)
+    {
+      g_list_free (drawables);
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
@@ -56,6 +56,11 @@ gimp_image_set_metadata (GimpImage    *image,
 
   private = GIMP_IMAGE_GET_PRIVATE (image);
 
+  /*  also when the metadata stays the same, callers may have modified
+   *  it in place before setting it again
+   */
+  g_clear_pointer (&private->metadata_string, g_free);
+
   if (metadata != private->metadata)
     {
       if (push_undo)
@@ -105,3 +110,72 @@ gimp_image_set_metadata (GimpImage    *image,
       g_object_notify (G_OBJECT (image), "metadata");
     }
 }
+
+/**
+ * gimp_image_get_metadata_string:
+ * @image: a #GimpImage
+ *
+ * Returns the image's metadata serialized to XML, as it is passed to
+ * plug-ins and saved to XCF. The string is cached until the metadata
+ * changes, so asking for it repeatedly doesn't serialize the whole
+ * metadata each time.
+ *
+ * Return value: the serialized metadata, or %NULL if the image has
+ *               none. The string is owned by @image.
+ **/
+const gchar *
+gimp_image_get_metadata_string (GimpImage *image)
+{
+  GimpImagePrivate *private;
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+
+  private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  if (private->metadata && ! private->metadata_string)
+    private->metadata_string = gimp_metadata_serialize (private->metadata);
+
+  return private->metadata_string;
+}
+
+/**
+ * gimp_image_copy_metadata:
+ * @image: a #GimpImage
+ *
+ * Like gimp_metadata_duplicate(), but reuses the cached serialized
+ * metadata of @image.
+ *
+ * Return value: a copy of the image's metadata, or %NULL.
+ **/
+GimpMetadata *
+gimp_image_copy_metadata (GimpImage *image)
+{
+  const gchar *metadata_string;
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+
+  metadata_string = gimp_image_get_metadata_string (image);
+
+  if (metadata_string)
+    return gimp_metadata_deserialize (metadata_string);
+
+  return NULL;
+}
+
+/**
+ * gimp_image_metadata_changed:
+ * @image: a #GimpImage
+ *
+ * Must be called after the image's metadata was modified in place.
+ **/
+void
+gimp_image_metadata_changed (GimpImage *image)
+{
+  GimpImagePrivate *private;
+
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  g_clear_pointer (&private->metadata_string, g_free);
+}
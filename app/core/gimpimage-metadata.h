@@ -19,10 +19,14 @@
 #define __GIMP_IMAGE_METADATA_H__
 
 
-GimpMetadata * gimp_image_get_metadata (GimpImage    *image);
-void           gimp_image_set_metadata (GimpImage    *image,
-                                        GimpMetadata *metadata,
-                                        gboolean      push_undo);
+GimpMetadata * gimp_image_get_metadata        (GimpImage    *image);
+void           gimp_image_set_metadata        (GimpImage    *image,
+                                               GimpMetadata *metadata,
+                                               gboolean      push_undo);
+
+const gchar  * gimp_image_get_metadata_string (GimpImage    *image);
+GimpMetadata * gimp_image_copy_metadata       (GimpImage    *image);
+void           gimp_image_metadata_changed    (GimpImage    *image);
 
 
 #endif /* __GIMP_IMAGE_METADATA_H__ */
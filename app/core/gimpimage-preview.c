@@ -17,6 +17,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
@@ -31,12 +33,40 @@
 #include "gimpimage.h"
 #include "gimpimage-color-profile.h"
 #include "gimpimage-preview.h"
+#include "gimpimage-private.h"
 #include "gimppickable.h"
 #include "gimpprojectable.h"
 #include "gimpprojection.h"
 #include "gimptempbuf.h"
 
 
+/*  the image keeps its last few scaled previews, and the areas of the
+ *  projection which changed since each of them was fetched, so only
+ *  those areas need to be fetched again when a preview is requested.
+ *  fetching goes through gegl_buffer_get() at the preview's scale, which
+ *  reads from the projection's mipmap levels.
+ */
+
+#define MAX_PREVIEW_CACHES 4
+
+
+typedef struct
+{
+  GimpTempBuf    *buf;
+  gint            image_width;
+  gint            image_height;
+  cairo_region_t *dirty;       /* in image coordinates, NULL if clean */
+} PreviewCache;
+
+
+static void   gimp_image_preview_cache_free  (PreviewCache        *cache);
+static void   gimp_image_preview_cache_fetch (GimpImage           *image,
+                                              PreviewCache        *cache,
+                                              const GeglRectangle *rect);
+
+
+/*  public functions  */
+
 void
 gimp_image_get_preview_size (GimpViewable *viewable,
                              gint          size,
@@ -108,12 +138,8 @@ gimp_image_get_new_preview (GimpViewable *viewable,
   GimpImage   *image = GIMP_IMAGE (viewable);
   const Babl  *format;
   gboolean     linear;
+  GimpTempBuf *cache;
   GimpTempBuf *buf;
-  gdouble      scale_x;
-  gdouble      scale_y;
-
-  scale_x = (gdouble) width  / (gdouble) gimp_image_get_width  (image);
-  scale_y = (gdouble) height / (gdouble) gimp_image_get_height (image);
 
   format = gimp_projectable_get_format (GIMP_PROJECTABLE (image));
   linear = gimp_babl_format_get_linear (format);
@@ -123,14 +149,11 @@ gimp_image_get_new_preview (GimpViewable *viewable,
                                                   linear),
                              babl_format_has_alpha (format));
 
-  buf = gimp_temp_buf_new (width, height, format);
+  cache = gimp_image_preview_get_cache (image, width, height, format);
 
-  gegl_buffer_get (gimp_pickable_get_buffer (GIMP_PICKABLE (image)),
-                   GEGL_RECTANGLE (0, 0, width, height),
-                   MIN (scale_x, scale_y),
-                   gimp_temp_buf_get_format (buf),
-                   gimp_temp_buf_get_data (buf),
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+  buf = gimp_temp_buf_copy (cache);
+
+  gimp_temp_buf_unref (cache);
 
   return buf;
 }
@@ -143,13 +166,9 @@ gimp_image_get_new_pixbuf (GimpViewable *viewable,
 {
   GimpImage          *image = GIMP_IMAGE (viewable);
   GdkPixbuf          *pixbuf;
-  gdouble             scale_x;
-  gdouble             scale_y;
+  GimpTempBuf        *cache;
   GimpColorTransform *transform;
 
-  scale_x = (gdouble) width  / (gdouble) gimp_image_get_width  (image);
-  scale_y = (gdouble) height / (gdouble) gimp_image_get_height (image);
-
   pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
                            width, height);
 
@@ -157,25 +176,15 @@ gimp_image_get_new_pixbuf (GimpViewable *viewable,
 
   if (transform)
     {
-      GimpTempBuf *temp_buf;
-      GeglBuffer  *src_buf;
-      GeglBuffer  *dest_buf;
+      GeglBuffer *src_buf;
+      GeglBuffer *dest_buf;
 
-      temp_buf = gimp_temp_buf_new (width, height,
-                                    gimp_pickable_get_format (GIMP_PICKABLE (image)));
+      cache = gimp_image_preview_get_cache (image, width, height,
+                                            gimp_pickable_get_format (GIMP_PICKABLE (image)));
 
-      gegl_buffer_get (gimp_pickable_get_buffer (GIMP_PICKABLE (image)),
-                       GEGL_RECTANGLE (0, 0, width, height),
-                       MIN (scale_x, scale_y),
-                       gimp_temp_buf_get_format (temp_buf),
-                       gimp_temp_buf_get_data (temp_buf),
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
-
-      src_buf  = gimp_temp_buf_create_buffer (temp_buf);
+      src_buf  = gimp_temp_buf_create_buffer (cache);
       dest_buf = gimp_pixbuf_create_buffer (pixbuf);
 
-      gimp_temp_buf_unref (temp_buf);
-
       gimp_color_transform_process_buffer (transform,
                                            src_buf,
                                            GEGL_RECTANGLE (0, 0,
@@ -188,14 +197,190 @@ gimp_image_get_new_pixbuf (GimpViewable *viewable,
     }
   else
     {
-      gegl_buffer_get (gimp_pickable_get_buffer (GIMP_PICKABLE (image)),
-                       GEGL_RECTANGLE (0, 0, width, height),
-                       MIN (scale_x, scale_y),
-                       gimp_pixbuf_get_format (pixbuf),
-                       gdk_pixbuf_get_pixels (pixbuf),
-                       gdk_pixbuf_get_rowstride (pixbuf),
-                       GEGL_ABYSS_CLAMP);
+      const Babl *format = gimp_pixbuf_get_format (pixbuf);
+      gint        bpp    = babl_format_get_bytes_per_pixel (format);
+      gint        y;
+
+      cache = gimp_image_preview_get_cache (image, width, height, format);
+
+      for (y = 0; y < height; y++)
+        {
+          memcpy (gdk_pixbuf_get_pixels (pixbuf) +
+                  y * gdk_pixbuf_get_rowstride (pixbuf),
+                  gimp_temp_buf_get_data (cache) + y * width * bpp,
+                  width * bpp);
+        }
     }
 
+  gimp_temp_buf_unref (cache);
+
   return pixbuf;
 }
+
+
+/*  returns a reference to an up-to-date preview of the given size and
+ *  format, which must not be modified
+ */
+GimpTempBuf *
+gimp_image_preview_get_cache (GimpImage  *image,
+                              gint        width,
+                              gint        height,
+                              const Babl *format)
+{
+  GimpImagePrivate *private      = GIMP_IMAGE_GET_PRIVATE (image);
+  gint              image_width  = gimp_image_get_width  (image);
+  gint              image_height = gimp_image_get_height (image);
+  PreviewCache     *cache        = NULL;
+  GList            *list;
+
+  for (list = private->preview_caches; list; list = g_list_next (list))
+    {
+      PreviewCache *c = list->data;
+
+      if (gimp_temp_buf_get_width  (c->buf) == width        &&
+          gimp_temp_buf_get_height (c->buf) == height       &&
+          gimp_temp_buf_get_format (c->buf) == format       &&
+          c->image_width                    == image_width  &&
+          c->image_height                   == image_height)
+        {
+          cache = c;
+
+          /*  most recently used first  */
+          private->preview_caches =
+            g_list_remove_link (private->preview_caches, list);
+          private->preview_caches =
+            g_list_concat (list, private->preview_caches);
+          break;
+        }
+    }
+
+  if (! cache)
+    {
+      cache = g_slice_new0 (PreviewCache);
+
+      cache->buf          = gimp_temp_buf_new (width, height, format);
+      cache->image_width  = image_width;
+      cache->image_height = image_height;
+
+      gimp_temp_buf_set_allocation (cache->buf, GIMP_ALLOCATION_CACHE);
+
+      gimp_image_preview_cache_fetch (image, cache,
+                                      GEGL_RECTANGLE (0, 0, width, height));
+
+      private->preview_caches = g_list_prepend (private->preview_caches,
+                                                cache);
+
+      if (g_list_length (private->preview_caches) > MAX_PREVIEW_CACHES)
+        {
+          list = g_list_last (private->preview_caches);
+
+          gimp_image_preview_cache_free (list->data);
+          private->preview_caches =
+            g_list_delete_link (private->preview_caches, list);
+        }
+    }
+  else if (cache->dirty)
+    {
+      gdouble scale;
+      gint    n_rects;
+      gint    i;
+
+      scale = MIN ((gdouble) width  / (gdouble) image_width,
+                   (gdouble) height / (gdouble) image_height);
+
+      n_rects = cairo_region_num_rectangles (cache->dirty);
+
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+          GeglRectangle         area;
+          gint                  x1, y1, x2, y2;
+
+          cairo_region_get_rectangle (cache->dirty, i, &rect);
+
+          /*  grow by a preview pixel for the downscaling filter  */
+          x1 = floor (rect.x * scale) - 1;
+          y1 = floor (rect.y * scale) - 1;
+          x2 = ceil ((rect.x + rect.width)  * scale) + 1;
+          y2 = ceil ((rect.y + rect.height) * scale) + 1;
+
+          if (gegl_rectangle_intersect (&area,
+                                        GEGL_RECTANGLE (x1, y1,
+                                                        x2 - x1, y2 - y1),
+                                        GEGL_RECTANGLE (0, 0, width, height)))
+            {
+              gimp_image_preview_cache_fetch (image, cache, &area);
+            }
+        }
+
+      g_clear_pointer (&cache->dirty, cairo_region_destroy);
+    }
+
+  return gimp_temp_buf_ref (cache->buf);
+}
+
+void
+gimp_image_preview_update_area (GimpImage *image,
+                                gint       x,
+                                gint       y,
+                                gint       width,
+                                gint       height)
+{
+  GimpImagePrivate      *private = GIMP_IMAGE_GET_PRIVATE (image);
+  cairo_rectangle_int_t  rect    = { x, y, width, height };
+  GList                 *list;
+
+  for (list = private->preview_caches; list; list = g_list_next (list))
+    {
+      PreviewCache *cache = list->data;
+
+      if (! cache->dirty)
+        cache->dirty = cairo_region_create ();
+
+      cairo_region_union_rectangle (cache->dirty, &rect);
+    }
+}
+
+void
+gimp_image_preview_free_caches (GimpImage *image)
+{
+  GimpImagePrivate *private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  g_list_free_full (private->preview_caches,
+                    (GDestroyNotify) gimp_image_preview_cache_free);
+  private->preview_caches = NULL;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_image_preview_cache_free (PreviewCache *cache)
+{
+  gimp_temp_buf_unref (cache->buf);
+  g_clear_pointer (&cache->dirty, cairo_region_destroy);
+
+  g_slice_free (PreviewCache, cache);
+}
+
+static void
+gimp_image_preview_cache_fetch (GimpImage           *image,
+                                PreviewCache        *cache,
+                                const GeglRectangle *rect)
+{
+  GimpTempBuf *buf    = cache->buf;
+  const Babl  *format = gimp_temp_buf_get_format (buf);
+  gint         width  = gimp_temp_buf_get_width  (buf);
+  gint         bpp    = babl_format_get_bytes_per_pixel (format);
+  gdouble      scale;
+
+  scale = MIN ((gdouble) width / (gdouble) cache->image_width,
+               (gdouble) gimp_temp_buf_get_height (buf) /
+               (gdouble) cache->image_height);
+
+  gegl_buffer_get (gimp_pickable_get_buffer (GIMP_PICKABLE (image)),
+                   rect, scale, format,
+                   gimp_temp_buf_get_data (buf) +
+                   rect->y * width * bpp + rect->x * bpp,
+                   width * bpp, GEGL_ABYSS_CLAMP);
+}
@@ -45,4 +45,19 @@ GdkPixbuf   * gimp_image_get_new_pixbuf   (GimpViewable *viewable,
                                            gint          height);
 
 
+/*  the preview cache used by the functions above
+ */
+
+GimpTempBuf * gimp_image_preview_get_cache   (GimpImage    *image,
+                                              gint          width,
+                                              gint          height,
+                                              const Babl   *format);
+void          gimp_image_preview_update_area (GimpImage    *image,
+                                              gint          x,
+                                              gint          y,
+                                              gint          width,
+                                              gint          height);
+void          gimp_image_preview_free_caches (GimpImage    *image);
+
+
 #endif /* __GIMP_IMAGE_PREVIEW_H__ */
@@ -68,6 +68,7 @@ struct _GimpImagePrivate
   GimpColorTransform *transform_from_srgb_double;
 
   GimpMetadata      *metadata;              /*  image's metadata             */
+  gchar             *metadata_string;       /*  serialized metadata cache    */
 
   GFile             *file;                  /*  the image's XCF file         */
   GFile             *imported_file;         /*  the image's source file      */
@@ -80,9 +81,13 @@ struct _GimpImagePrivate
   gint               dirty;                 /*  dirty flag -- # of ops       */
   gint64             dirty_time;            /*  time when image became dirty */
   gint               export_dirty;          /*  'dirty' but for export       */
+  gboolean           busy;                  /*  being saved in background    */
 
   gint               undo_freeze_count;     /*  counts the _freeze's         */
 
+  gint               tree_batch_count;      /*  nested tree batches          */
+  gboolean           tree_batch_undo_group; /*  batch opened an undo group   */
+
   gint               instance_count;        /*  number of instances          */
   gint               disp_count;            /*  number of displays           */
 
@@ -91,6 +96,7 @@ struct _GimpImagePrivate
   GimpProjection    *projection;            /*  projection layers & channels */
   GeglNode          *graph;                 /*  GEGL projection graph        */
   GeglNode          *visible_mask;          /*  component visibility node    */
+  GList             *preview_caches;        /*  see gimpimage-preview.c      */
 
   GList             *symmetries;            /*  Painting symmetries          */
   GimpSymmetry      *active_symmetry;       /*  Active symmetry              */
@@ -126,6 +132,7 @@ struct _GimpImagePrivate
   GimpUndoStack     *redo_stack;            /*  stack for redo operations    */
   gint               group_count;           /*  nested undo groups           */
   GimpUndoType       pushing_undo_group;    /*  undo group status flag       */
+  gint64             undo_memsize;          /*  of both stacks, for the total */
 
   /*  Signal emission accumulator  */
   GimpImageFlushAccumulator  flush_accum;
@@ -42,6 +42,12 @@
 #define CHANNEL_WAS_ACTIVE (0x2)
 
 
+/*  local function prototypes  */
+
+static void   gimp_image_quick_mask_set_in_projection (GimpChannel *mask,
+                                                       gboolean     in_projection);
+
+
 /*  public functions  */
 
 void
@@ -106,10 +112,20 @@ gimp_image_set_quick_mask_state (GimpImage *image,
           if (private->quick_mask_inverted)
             gimp_channel_invert (mask, FALSE);
 
+          /*  keep the new channel out of the projection before adding
+           *  it, so that adding it doesn't invalidate the image
+           */
+          gimp_image_quick_mask_set_in_projection (mask, FALSE);
+
           gimp_image_add_channel (image, mask, NULL, 0, TRUE);
 
           gimp_image_undo_group_end (image);
         }
+      else
+        {
+          /*  the channel was added by an undo step or a file load  */
+          gimp_image_quick_mask_set_in_projection (mask, FALSE);
+        }
     }
   else
     {
@@ -131,6 +147,8 @@ gimp_image_set_quick_mask_state (GimpImage *image,
                                mask);
           gimp_image_remove_channel (image, mask, TRUE, NULL);
 
+          gimp_image_quick_mask_set_in_projection (mask, TRUE);
+
           if (! channel_was_active)
             gimp_image_unset_active_channel (image);
 
@@ -210,3 +228,21 @@ gimp_image_get_quick_mask_inverted (GimpImage *image)
 
   return GIMP_IMAGE_GET_PRIVATE (image)->quick_mask_inverted;
 }
+
+
+/*  private functions  */
+
+/*  the quick mask is not part of the image's projection, the displays
+ *  composite it on top of the rendered projection instead.  toggling
+ *  quick mask, painting on it or changing its color therefore doesn't
+ *  re-render the layer stack.
+ */
+static void
+gimp_image_quick_mask_set_in_projection (GimpChannel *mask,
+                                         gboolean     in_projection)
+{
+  gimp_item_bind_visible_to_active (GIMP_ITEM (mask), in_projection);
+
+  if (! in_projection)
+    gimp_filter_set_active (GIMP_FILTER (mask), FALSE);
+}
@@ -22,8 +22,14 @@
 
 #include "core-types.h"
 
+#include "config/gimpgeglconfig.h"
+
 #include "gimp.h"
+#include "gimp-memory-budget.h"
+#include "gimp-parallel.h"
+#include "gimpchannel.h"
 #include "gimpcontainer.h"
+#include "gimpdrawable.h"
 #include "gimpguide.h"
 #include "gimpgrouplayer.h"
 #include "gimpimage.h"
@@ -42,6 +48,41 @@
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  GimpDrawable *drawable;
+  gint          width;
+  gint          height;
+  gint64        size;
+} ScaleJob;
+
+typedef struct
+{
+  GArray                *jobs;
+  GimpInterpolationType  interpolation_type;
+  gint64                 max_batch_size;
+  gint                   n_applied;
+  gint                   n_prepared;
+  gint                   batch_end;
+  gint                   next_job;
+} ScaleData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_image_scale_add_job        (ScaleData    *data,
+                                               GimpDrawable *drawable,
+                                               gint          width,
+                                               gint          height);
+static void   gimp_image_scale_prepare_func   (gint          i,
+                                               gint          n,
+                                               ScaleData    *data);
+static void   gimp_image_scale_prepare        (ScaleData    *data,
+                                               gint          n_jobs);
+
+
+/*  public functions  */
+
 void
 gimp_image_scale (GimpImage             *image,
                   gint                   new_width,
@@ -50,6 +91,7 @@ gimp_image_scale (GimpImage             *image,
                   GimpProgress          *progress)
 {
   GimpProgress *sub_progress;
+  ScaleData     data;
   GList        *all_layers;
   GList        *all_channels;
   GList        *all_vectors;
@@ -62,6 +104,8 @@ gimp_image_scale (GimpImage             *image,
   gdouble       img_scale_h      = 1.0;
   gint          progress_steps;
   gint          progress_current = 0;
+  gint64        reserved         = 0;
+  gint          i;
 
   g_return_if_fail (GIMP_IS_IMAGE (image));
   g_return_if_fail (new_width > 0 && new_height > 0);
@@ -110,6 +154,55 @@ gimp_image_scale (GimpImage             *image,
                 "height", new_height,
                 NULL);
 
+  /*  Collect the drawables to scale, in the order they are scaled below.
+   *  Their pixels are scaled ahead of time, several at once, by
+   *  gimp_image_scale_prepare(); the items themselves, and the undo
+   *  steps, are still updated one at a time, in the usual order.
+   */
+  data.jobs               = g_array_new (FALSE, FALSE, sizeof (ScaleJob));
+  data.interpolation_type = interpolation_type;
+  data.max_batch_size     =
+    GIMP_GEGL_CONFIG (image->gimp->config)->tile_cache_size / 2;
+  data.n_applied          = 0;
+  data.n_prepared         = 0;
+
+  for (list = all_channels; list; list = g_list_next (list))
+    gimp_image_scale_add_job (&data, list->data, new_width, new_height);
+
+  gimp_image_scale_add_job (&data, GIMP_DRAWABLE (gimp_image_get_mask (image)),
+                            new_width, new_height);
+
+  for (list = all_layers; list; list = g_list_next (list))
+    {
+      GimpItem  *item = list->data;
+      GimpLayer *layer = list->data;
+      gint       width;
+      gint       height;
+
+      if (gimp_viewable_get_children (GIMP_VIEWABLE (item)))
+        continue;
+
+      width  = ROUND (img_scale_w * (gdouble) gimp_item_get_width  (item));
+      height = ROUND (img_scale_h * (gdouble) gimp_item_get_height (item));
+
+      gimp_image_scale_add_job (&data, GIMP_DRAWABLE (layer), width, height);
+
+      if (gimp_layer_get_mask (layer))
+        {
+          gimp_image_scale_add_job (&data,
+                                    GIMP_DRAWABLE (gimp_layer_get_mask (layer)),
+                                    width, height);
+        }
+    }
+
+  /*  Account for the scaled pixels against the memory budget before
+   *  allocating any of them
+   */
+  for (i = 0; i < data.jobs->len; i++)
+    reserved += g_array_index (data.jobs, ScaleJob, i).size;
+
+  gimp_memory_budget_reserve (reserved);
+
   /*  Scale all channels  */
   for (list = all_channels; list; list = g_list_next (list))
     {
@@ -118,6 +211,8 @@ gimp_image_scale (GimpImage             *image,
       gimp_sub_progress_set_step (GIMP_SUB_PROGRESS (sub_progress),
                                   progress_current++, progress_steps);
 
+      gimp_image_scale_prepare (&data, 1);
+
       gimp_item_scale (item,
                        new_width, new_height, 0, 0,
                        interpolation_type, sub_progress);
@@ -140,6 +235,8 @@ gimp_image_scale (GimpImage             *image,
   gimp_sub_progress_set_step (GIMP_SUB_PROGRESS (sub_progress),
                               progress_current++, progress_steps);
 
+  gimp_image_scale_prepare (&data, 1);
+
   gimp_item_scale (GIMP_ITEM (gimp_image_get_mask (image)),
                    new_width, new_height, 0, 0,
                    interpolation_type, sub_progress);
@@ -159,6 +256,10 @@ gimp_image_scale (GimpImage             *image,
           continue;
         }
 
+      gimp_image_scale_prepare (&data,
+                                gimp_layer_get_mask (GIMP_LAYER (item)) ?
+                                2 : 1);
+
       if (! gimp_item_scale_by_factors (item,
                                         img_scale_w, img_scale_h,
                                         interpolation_type, sub_progress))
@@ -223,6 +324,18 @@ gimp_image_scale (GimpImage             *image,
 
   gimp_image_undo_group_end (image);
 
+  /*  drop prepared buffers that ended up not being used  */
+  for (i = 0; i < data.jobs->len; i++)
+    {
+      ScaleJob *job = &g_array_index (data.jobs, ScaleJob, i);
+
+      gimp_drawable_clear_prepared_scale (job->drawable);
+    }
+
+  g_array_free (data.jobs, TRUE);
+
+  gimp_memory_budget_release (reserved);
+
   g_list_free (all_layers);
   g_list_free (all_channels);
   g_list_free (all_vectors);
@@ -319,3 +432,108 @@ gimp_image_scale_check (GimpImage *image,
 
   return GIMP_IMAGE_SCALE_OK;
 }
+
+
+/*  private functions  */
+
+static void
+gimp_image_scale_add_job (ScaleData    *data,
+                          GimpDrawable *drawable,
+                          gint          width,
+                          gint          height)
+{
+  ScaleJob job = { 0, };
+
+  job.drawable = drawable;
+
+  /*  items which won't be scaled through gimp_drawable_scale() still
+   *  get a job, so that the jobs line up with the items, but there is
+   *  nothing to prepare for them
+   */
+  if (width > 0 && height > 0 &&
+      ! (GIMP_IS_CHANNEL (drawable)            &&
+         GIMP_CHANNEL (drawable)->bounds_known &&
+         GIMP_CHANNEL (drawable)->empty))
+    {
+      job.width  = width;
+      job.height = height;
+      job.size   = (gint64) width * height *
+                   babl_format_get_bytes_per_pixel (
+                     gimp_drawable_get_format (drawable));
+    }
+
+  g_array_append_val (data->jobs, job);
+}
+
+static void
+gimp_image_scale_prepare_func (gint       i,
+                               gint       n,
+                               ScaleData *data)
+{
+  gint index;
+
+  while ((index = g_atomic_int_add (&data->next_job, 1)) < data->batch_end)
+    {
+      ScaleJob *job = &g_array_index (data->jobs, ScaleJob, index);
+
+      if (job->size > 0)
+        {
+          gimp_drawable_prepare_scale (job->drawable,
+                                       job->width, job->height,
+                                       data->interpolation_type);
+        }
+    }
+}
+
+/*  Makes sure the next @n_jobs jobs are prepared before their items are
+ *  scaled.  Jobs are prepared in batches, whose total size is limited by
+ *  half the tile cache, so that the prepared buffers, which stay alive
+ *  until their item is scaled, don't exhaust the memory.
+ */
+static void
+gimp_image_scale_prepare (ScaleData *data,
+                          gint       n_jobs)
+{
+  gint first = data->n_applied;
+  gint last  = MIN (data->n_applied + n_jobs, data->jobs->len);
+
+  data->n_applied = last;
+
+  if (data->n_prepared >= last)
+    return;
+
+  if (gimp_parallel_get_n_threads () > 1)
+    {
+      gint64 batch_size = 0;
+      gint   end;
+      gint   n_threads;
+
+      for (end = first; end < data->jobs->len; end++)
+        {
+          ScaleJob *job = &g_array_index (data->jobs, ScaleJob, end);
+
+          if (end >= last && batch_size + job->size > data->max_batch_size)
+            break;
+
+          batch_size += job->size;
+
+          if (job->size > 0)
+            gimp_drawable_get_buffer (job->drawable);
+        }
+
+      data->next_job  = first;
+      data->batch_end = end;
+
+      n_threads = MIN (end - first, gimp_parallel_get_n_threads ());
+
+      if (n_threads > 1)
+        {
+          gimp_parallel_distribute (n_threads,
+                                    (GimpParallelDistributeFunc)
+                                      gimp_image_scale_prepare_func,
+                                    data);
+        }
+
+      data->n_prepared = end;
+    }
+}
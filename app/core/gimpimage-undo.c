@@ -25,6 +25,7 @@
 #include "config/gimpcoreconfig.h"
 
 #include "gimp.h"
+#include "gimp-allocation.h"
 #include "gimp-utils.h"
 #include "gimpdrawableundo.h"
 #include "gimpimage.h"
@@ -42,11 +43,22 @@ static void          gimp_image_undo_pop_stack       (GimpImage     *image,
                                                       GimpUndoStack *redo_stack,
                                                       GimpUndoMode   undo_mode);
 static void          gimp_image_undo_free_space      (GimpImage     *image);
+static gboolean      gimp_image_undo_spill_oldest    (GimpImage     *image);
+static gint64        gimp_image_undo_get_disk_size   (GimpImage     *image);
 static void          gimp_image_undo_free_redo       (GimpImage     *image);
 
 static GimpDirtyMask gimp_image_undo_dirty_from_type (GimpUndoType   undo_type);
 
 
+/*  local variables  */
+
+/*  the memory used by the undo stacks of all images, shown in the
+ *  dashboard
+ */
+static GMutex  total_memsize_mutex;
+static guint64 total_memsize = 0;
+
+
 /*  public functions  */
 
 gboolean
@@ -249,6 +261,8 @@ gimp_image_undo_free (GimpImage *image)
   gimp_undo_free (GIMP_UNDO (private->undo_stack), GIMP_UNDO_MODE_UNDO);
   gimp_undo_free (GIMP_UNDO (private->redo_stack), GIMP_UNDO_MODE_REDO);
 
+  gimp_image_undo_update_memsize (image);
+
   /* If the image was dirty, but could become clean by redo-ing
    * some actions, then it should now become 'infinitely' dirty.
    * This is because we've just nuked the actions that would allow
@@ -454,6 +468,9 @@ gimp_image_undo_can_compress (GimpImage    *image,
       if (undo && undo->undo_type == undo_type &&
           g_type_is_a (G_TYPE_FROM_INSTANCE (undo), object_type))
         {
+          /*  the caller is going to modify the undo  */
+          gimp_undo_memsize_changed (undo);
+
           return undo;
         }
     }
@@ -490,6 +507,55 @@ gimp_image_undo_get_fadeable (GimpImage *image)
 }
 
 
+/*  updates the image's share of gimp_image_undo_get_total_memsize(),
+ *  called whenever its undo stacks change
+ */
+void
+gimp_image_undo_update_memsize (GimpImage *image)
+{
+  GimpImagePrivate *private;
+  gint64            memsize = 0;
+
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  if (private->undo_stack)
+    memsize += gimp_object_get_memsize (GIMP_OBJECT (private->undo_stack),
+                                        NULL);
+  if (private->redo_stack)
+    memsize += gimp_object_get_memsize (GIMP_OBJECT (private->redo_stack),
+                                        NULL);
+
+  if (memsize != private->undo_memsize)
+    {
+      g_mutex_lock (&total_memsize_mutex);
+
+      total_memsize += memsize;
+      total_memsize -= private->undo_memsize;
+
+      g_mutex_unlock (&total_memsize_mutex);
+
+      gimp_allocation_add (GIMP_ALLOCATION_UNDO,
+                           memsize - private->undo_memsize);
+
+      private->undo_memsize = memsize;
+    }
+}
+
+guint64
+gimp_image_undo_get_total_memsize (void)
+{
+  guint64 memsize;
+
+  g_mutex_lock (&total_memsize_mutex);
+  memsize = total_memsize;
+  g_mutex_unlock (&total_memsize_mutex);
+
+  return memsize;
+}
+
+
 /*  private functions  */
 
 static void
@@ -549,33 +615,51 @@ gimp_image_undo_free_space (GimpImage *image)
   gint              min_undo_levels;
   gint              max_undo_levels;
   gint64            undo_size;
+  gint64            undo_disk_size;
 
   container = private->undo_stack->undos;
 
   min_undo_levels = image->gimp->config->levels_of_undo;
   max_undo_levels = 1024; /* FIXME */
   undo_size       = image->gimp->config->undo_size;
+  undo_disk_size  = image->gimp->config->undo_disk_size;
 
 #ifdef DEBUG_IMAGE_UNDO
   g_printerr ("undo_steps: %d    undo_bytes: %ld\n",
               gimp_container_get_n_children (container),
-              (glong) gimp_object_get_memsize (GIMP_OBJECT (container), NULL));
+              (glong) gimp_object_get_memsize (GIMP_OBJECT (private->undo_stack), NULL));
 #endif
 
   /*  keep at least min_undo_levels undo steps  */
   if (gimp_container_get_n_children (container) <= min_undo_levels)
     return;
 
-  while ((gimp_object_get_memsize (GIMP_OBJECT (container), NULL) > undo_size) ||
+  while ((gimp_object_get_memsize (GIMP_OBJECT (private->undo_stack),
+                                   NULL) > undo_size)                  ||
+         (gimp_image_undo_get_disk_size (image) > undo_disk_size)      ||
          (gimp_container_get_n_children (container) > max_undo_levels))
     {
-      GimpUndo *freed = gimp_undo_stack_free_bottom (private->undo_stack,
-                                                     GIMP_UNDO_MODE_UNDO);
+      GimpUndo *freed;
+
+      /*  rather than freeing the oldest undo step, move the oldest
+       *  undo step that is still in memory to disk, as long as there
+       *  is room for it
+       */
+      if (undo_disk_size > 0                                             &&
+          gimp_container_get_n_children (container) <= max_undo_levels &&
+          gimp_image_undo_get_disk_size (image) <= undo_disk_size       &&
+          gimp_image_undo_spill_oldest (image))
+        {
+          continue;
+        }
+
+      freed = gimp_undo_stack_free_bottom (private->undo_stack,
+                                           GIMP_UNDO_MODE_UNDO);
 
 #ifdef DEBUG_IMAGE_UNDO
       g_printerr ("freed one step: undo_steps: %d    undo_bytes: %ld\n",
                   gimp_container_get_n_children (container),
-                  (glong) gimp_object_get_memsize (GIMP_OBJECT (container),
+                  (glong) gimp_object_get_memsize (GIMP_OBJECT (private->undo_stack),
                                                    NULL));
 #endif
 
@@ -588,6 +672,49 @@ gimp_image_undo_free_space (GimpImage *image)
     }
 }
 
+static gboolean
+gimp_image_undo_spill_oldest (GimpImage *image)
+{
+  GimpImagePrivate *private   = GIMP_IMAGE_GET_PRIVATE (image);
+  GimpContainer    *container = private->undo_stack->undos;
+  GList            *list;
+
+  for (list = GIMP_LIST (container)->queue->tail;
+       list;
+       list = g_list_previous (list))
+    {
+      GimpUndo *undo = list->data;
+
+      /*  steps that can't be moved to disk are only marked as
+       *  spilled, skip them so that they don't count as progress
+       */
+      if (! undo->spilled && gimp_undo_spill (undo) > 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gint64
+gimp_image_undo_get_disk_size (GimpImage *image)
+{
+  GimpImagePrivate *private   = GIMP_IMAGE_GET_PRIVATE (image);
+  GimpContainer    *container = private->undo_stack->undos;
+  gint64            disk_size = 0;
+  GList            *list;
+
+  for (list = GIMP_LIST (container)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *undo = list->data;
+
+      disk_size += undo->disk_size;
+    }
+
+  return disk_size;
+}
+
 static void
 gimp_image_undo_free_redo (GimpImage *image)
 {
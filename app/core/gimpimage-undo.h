@@ -55,5 +55,9 @@ GimpUndo      * gimp_image_undo_can_compress    (GimpImage     *image,
 
 GimpUndo      * gimp_image_undo_get_fadeable    (GimpImage     *image);
 
+void            gimp_image_undo_update_memsize  (GimpImage     *image);
+guint64         gimp_image_undo_get_total_memsize
+                                                (void);
+
 
 #endif /* __GIMP_IMAGE__UNDO_H__ */
@@ -216,6 +216,13 @@ static void         gimp_image_srgb_to_pixel     (GimpPickable      *pickable,
                                                   const Babl        *format,
                                                   gpointer           pixel);
 
+static void     gimp_image_projection_update     (GimpProjection    *projection,
+                                                  gboolean           now,
+                                                  gint               x,
+                                                  gint               y,
+                                                  gint               width,
+                                                  gint               height,
+                                                  GimpImage         *image);
 static void     gimp_image_mask_update           (GimpDrawable      *drawable,
                                                   gint               x,
                                                   gint               y,
@@ -724,6 +731,10 @@ gimp_image_init (GimpImage *image)
 
   private->projection          = gimp_projection_new (GIMP_PROJECTABLE (image));
 
+  g_signal_connect (private->projection, "update",
+                    G_CALLBACK (gimp_image_projection_update),
+                    image);
+
   private->symmetries          = NULL;
   private->active_symmetry     = NULL;
 
@@ -1032,6 +1043,7 @@ gimp_image_finalize (GObject *object)
 
   g_clear_object (&private->projection);
   g_clear_object (&private->graph);
+  gimp_image_preview_free_caches (image);
   private->visible_mask = NULL;
 
   if (private->colormap)
@@ -1041,6 +1053,7 @@ gimp_image_finalize (GObject *object)
     _gimp_image_free_color_profile (image);
 
   g_clear_object (&private->metadata);
+  g_clear_pointer (&private->metadata_string, g_free);
   g_clear_object (&private->file);
   g_clear_object (&private->imported_file);
   g_clear_object (&private->exported_file);
@@ -1083,6 +1096,8 @@ gimp_image_finalize (GObject *object)
   g_clear_object (&private->undo_stack);
   g_clear_object (&private->redo_stack);
 
+  gimp_image_undo_update_memsize (image);
+
   if (image->gimp && image->gimp->image_table)
     {
       gimp_id_table_remove (image->gimp->image_table, private->ID);
@@ -1220,9 +1235,12 @@ gimp_image_size_changed (GimpViewable *viewable)
 
   metadata = gimp_image_get_metadata (image);
   if (metadata)
-    gimp_metadata_set_pixel_size (metadata,
-                                  gimp_image_get_width  (image),
-                                  gimp_image_get_height (image));
+    {
+      gimp_metadata_set_pixel_size (metadata,
+                                    gimp_image_get_width  (image),
+                                    gimp_image_get_height (image));
+      gimp_image_metadata_changed (image);
+    }
 
   gimp_projectable_structure_changed (GIMP_PROJECTABLE (image));
 }
@@ -1275,6 +1293,8 @@ gimp_image_real_precision_changed (GimpImage *image)
           gimp_metadata_set_bits_per_sample (metadata, 64);
           break;
         }
+
+      gimp_image_metadata_changed (image);
     }
 
   gimp_projectable_structure_changed (GIMP_PROJECTABLE (image));
@@ -1293,6 +1313,7 @@ gimp_image_real_resolution_changed (GimpImage *image)
       gimp_image_get_resolution (image, &xres, &yres);
       gimp_metadata_set_resolution (metadata, xres, yres,
                                     gimp_image_get_unit (image));
+      gimp_image_metadata_changed (image);
     }
 }
 
@@ -1323,6 +1344,7 @@ gimp_image_real_unit_changed (GimpImage *image)
       gimp_image_get_resolution (image, &xres, &yres);
       gimp_metadata_set_resolution (metadata, xres, yres,
                                     gimp_image_get_unit (image));
+      gimp_image_metadata_changed (image);
     }
 }
 
@@ -1558,6 +1580,18 @@ gimp_image_get_graph (GimpProjectable *projectable)
   return private->graph;
 }
 
+static void
+gimp_image_projection_update (GimpProjection *projection,
+                              gboolean        now,
+                              gint            x,
+                              gint            y,
+                              gint            width,
+                              gint            height,
+                              GimpImage      *image)
+{
+  gimp_image_preview_update_area (image, x, y, width, height);
+}
+
 static void
 gimp_image_mask_update (GimpDrawable *drawable,
                         gint          x,
@@ -1615,6 +1649,11 @@ gimp_image_channel_name_changed (GimpChannel *channel,
   else if (gimp_image_get_quick_mask_state (image) &&
            ! gimp_image_get_quick_mask (image))
     {
+      /*  the quick mask was renamed, and is an ordinary channel now,
+       *  which is part of the projection again
+       */
+      gimp_item_bind_visible_to_active (GIMP_ITEM (channel), TRUE);
+
       gimp_image_set_quick_mask_state (image, FALSE);
     }
 }
@@ -3181,6 +3220,8 @@ gimp_image_undo_event (GimpImage     *image,
                     GIMP_IS_UNDO (undo));
 
   g_signal_emit (image, gimp_image_signals[UNDO_EVENT], 0, event, undo);
+
+  gimp_image_undo_update_memsize (image);
 }
 
 
@@ -3319,6 +3360,21 @@ gimp_image_is_export_dirty (GimpImage *image)
   return GIMP_IMAGE_GET_PRIVATE (image)->export_dirty != 0;
 }
 
+/**
+ * gimp_image_get_dirty_count:
+ * @image:
+ *
+ * Returns: The number of operations by which the image differs from
+ *          its saved state, negative if they were undone past it.
+ **/
+gint
+gimp_image_get_dirty_count (GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), 0);
+
+  return GIMP_IMAGE_GET_PRIVATE (image)->dirty;
+}
+
 gint64
 gimp_image_get_dirty_time (GimpImage *image)
 {
@@ -3327,6 +3383,32 @@ gimp_image_get_dirty_time (GimpImage *image)
   return GIMP_IMAGE_GET_PRIVATE (image)->dirty_time;
 }
 
+/**
+ * gimp_image_set_busy:
+ * @image:
+ * @busy:
+ *
+ * Marks @image as being saved in the background, while the main loop
+ * keeps running.  It must not be closed or saved again meanwhile, and
+ * GIMP must not quit.
+ **/
+void
+gimp_image_set_busy (GimpImage *image,
+                     gboolean   busy)
+{
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  GIMP_IMAGE_GET_PRIVATE (image)->busy = busy ? TRUE : FALSE;
+}
+
+gboolean
+gimp_image_is_busy (GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+
+  return GIMP_IMAGE_GET_PRIVATE (image)->busy;
+}
+
 /**
  * gimp_image_saved:
  * @image:
@@ -3371,6 +3453,10 @@ gimp_image_flush (GimpImage *image)
 {
   g_return_if_fail (GIMP_IS_IMAGE (image));
 
+  /*  flushed once when the batch ends  */
+  if (GIMP_IMAGE_GET_PRIVATE (image)->tree_batch_count > 0)
+    return;
+
   gimp_projectable_flush (GIMP_PROJECTABLE (image),
                           GIMP_IMAGE_GET_PRIVATE (image)->flush_accum.preview_invalidated);
 }
@@ -4701,6 +4787,83 @@ gimp_image_remove_vectors (GimpImage   *image,
     gimp_image_undo_group_end (image);
 }
 
+/**
+ * gimp_image_begin_tree_batch:
+ * @image:     a #GimpImage
+ * @undo_desc: the description of the batch's undo group, or %NULL
+ *
+ * Starts a batch of changes to @image's layers, channels and paths,
+ * e.g. when a script adds many layers.  Until the matching
+ * gimp_image_end_tree_batch(), the views of the item trees and the
+ * image preview are not updated, the image's displays are not
+ * flushed, and all undo steps are collected in a single undo group.
+ * Batches can be nested.
+ **/
+void
+gimp_image_begin_tree_batch (GimpImage   *image,
+                             const gchar *undo_desc)
+{
+  GimpImagePrivate *private;
+
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  private->tree_batch_count++;
+
+  if (private->tree_batch_count > 1)
+    return;
+
+  private->tree_batch_undo_group =
+    gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_MISC, undo_desc);
+
+  gimp_viewable_preview_freeze (GIMP_VIEWABLE (image));
+
+  gimp_container_freeze (gimp_image_get_layers (image));
+  gimp_container_freeze (gimp_image_get_channels (image));
+  gimp_container_freeze (gimp_image_get_vectors (image));
+}
+
+void
+gimp_image_end_tree_batch (GimpImage *image)
+{
+  GimpImagePrivate *private;
+
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  g_return_if_fail (private->tree_batch_count > 0);
+
+  private->tree_batch_count--;
+
+  if (private->tree_batch_count > 0)
+    return;
+
+  gimp_container_thaw (gimp_image_get_vectors (image));
+  gimp_container_thaw (gimp_image_get_channels (image));
+  gimp_container_thaw (gimp_image_get_layers (image));
+
+  gimp_viewable_preview_thaw (GIMP_VIEWABLE (image));
+
+  if (private->tree_batch_undo_group)
+    {
+      gimp_image_undo_group_end (image);
+
+      private->tree_batch_undo_group = FALSE;
+    }
+
+  gimp_image_flush (image);
+}
+
+gboolean
+gimp_image_is_tree_batch (GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+
+  return GIMP_IMAGE_GET_PRIVATE (image)->tree_batch_count > 0;
+}
+
 gboolean
 gimp_image_coords_in_active_pickable (GimpImage        *image,
                                       const GimpCoords *coords,
@@ -281,9 +281,17 @@ void            gimp_image_clean_all             (GimpImage          *image);
 void            gimp_image_export_clean_all      (GimpImage          *image);
 gint            gimp_image_is_dirty              (GimpImage          *image);
 gboolean        gimp_image_is_export_dirty       (GimpImage          *image);
+gint            gimp_image_get_dirty_count       (GimpImage          *image);
 gint64          gimp_image_get_dirty_time        (GimpImage          *image);
 
 
+/*  the image is being saved in the background  */
+
+void            gimp_image_set_busy              (GimpImage          *image,
+                                                  gboolean            busy);
+gboolean        gimp_image_is_busy               (GimpImage          *image);
+
+
 /*  flush this image's displays  */
 
 void            gimp_image_flush                 (GimpImage          *image);
@@ -433,6 +441,11 @@ void            gimp_image_remove_vectors        (GimpImage          *image,
                                                   gboolean            push_undo,
                                                   GimpVectors        *new_active);
 
+void            gimp_image_begin_tree_batch      (GimpImage          *image,
+                                                  const gchar        *undo_desc);
+void            gimp_image_end_tree_batch        (GimpImage          *image);
+gboolean        gimp_image_is_tree_batch         (GimpImage          *image);
+
 gboolean    gimp_image_coords_in_active_pickable (GimpImage          *image,
                                                   const GimpCoords   *coords,
                                                   gboolean            sample_merged,
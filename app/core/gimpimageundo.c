@@ -193,8 +193,7 @@ gimp_image_undo_constructed (GObject *object)
       break;
 
     case GIMP_UNDO_IMAGE_METADATA:
-      image_undo->metadata =
-        gimp_metadata_duplicate (gimp_image_get_metadata (image));
+      image_undo->metadata = gimp_image_copy_metadata (image);
       break;
 
     case GIMP_UNDO_PARASITE_ATTACH:
@@ -487,7 +486,7 @@ gimp_image_undo_pop (GimpUndo            *undo,
       {
         GimpMetadata *metadata;
 
-        metadata = gimp_metadata_duplicate (gimp_image_get_metadata (image));
+        metadata = gimp_image_copy_metadata (image);
 
         gimp_image_set_metadata (image, image_undo->metadata, FALSE);
 
@@ -57,6 +57,7 @@ struct _GimpItemTreePrivate
   GimpItem   *active_item;
 
   GHashTable *name_hash;
+  GHashTable *number_hash;
 };
 
 #define GIMP_ITEM_TREE_GET_PRIVATE(object) \
@@ -139,7 +140,9 @@ gimp_item_tree_init (GimpItemTree *tree)
 {
   GimpItemTreePrivate *private = GIMP_ITEM_TREE_GET_PRIVATE (tree);
 
-  private->name_hash = g_hash_table_new (g_str_hash, g_str_equal);
+  private->name_hash   = g_hash_table_new (g_str_hash, g_str_equal);
+  private->number_hash = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, NULL);
 }
 
 static void
@@ -168,7 +171,8 @@ gimp_item_tree_finalize (GObject *object)
   GimpItemTree        *tree    = GIMP_ITEM_TREE (object);
   GimpItemTreePrivate *private = GIMP_ITEM_TREE_GET_PRIVATE (tree);
 
-  g_clear_pointer (&private->name_hash, g_hash_table_unref);
+  g_clear_pointer (&private->name_hash,   g_hash_table_unref);
+  g_clear_pointer (&private->number_hash, g_hash_table_unref);
   g_clear_object (&tree->container);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -470,6 +474,7 @@ gimp_item_tree_remove_item (GimpItemTree *tree,
 
   g_hash_table_remove (private->name_hash,
                        gimp_object_get_name (item));
+  g_hash_table_remove_all (private->number_hash);
 
   children = gimp_viewable_get_children (GIMP_VIEWABLE (item));
 
@@ -633,6 +638,7 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
     {
       g_hash_table_remove (private->name_hash,
                            gimp_object_get_name (item));
+      g_hash_table_remove_all (private->number_hash);
 
       gimp_object_set_name (GIMP_OBJECT (item), new_name);
     }
@@ -650,7 +656,10 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
     {
       gchar      *name        = g_strdup (gimp_object_get_name (item));
       gchar      *new_name    = NULL;
+      gchar      *number_key;
       gint        number      = 0;
+      gint        last_number;
+      gboolean    contiguous;
       gint        precision   = 1;
       GRegex     *end_numbers = g_regex_new (" ?#([0-9]+)\\s*$", 0, 0, NULL);
       GMatchInfo *match_info  = NULL;
@@ -675,6 +684,20 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
       g_match_info_free (match_info);
       g_regex_unref (end_numbers);
 
+      /*  number_hash remembers, for each name, the last number up to
+       *  which all numbers starting from 1 are taken, so that adding
+       *  many items of the same name doesn't probe all of them again.
+       *  It is cleared whenever a name is removed.
+       */
+      number_key  = g_strdup_printf ("%d:%s", precision, name);
+      last_number = GPOINTER_TO_INT (g_hash_table_lookup (private->number_hash,
+                                                          number_key));
+
+      contiguous = (number <= last_number);
+
+      if (contiguous)
+        number = last_number;
+
       do
         {
           number++;
@@ -688,6 +711,12 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
         }
       while (g_hash_table_lookup (private->name_hash, new_name));
 
+      if (contiguous)
+        g_hash_table_insert (private->number_hash,
+                             number_key, GINT_TO_POINTER (number));
+      else
+        g_free (number_key);
+
       g_free (name);
 
       gimp_object_take_name (GIMP_OBJECT (item), new_name);
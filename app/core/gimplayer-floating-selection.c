@@ -24,20 +24,33 @@
 
 #include "core-types.h"
 
+#include "operations/layer-modes/gimp-layer-modes.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-utils.h"
+
 #include "gimpboundary.h"
-#include "gimpdrawable-filters.h"
 #include "gimpdrawable-floating-selection.h"
 #include "gimperror.h"
+#include "gimpfilter.h"
 #include "gimpimage.h"
 #include "gimpimage-undo.h"
 #include "gimpimage-undo-push.h"
 #include "gimplayer.h"
 #include "gimplayer-floating-selection.h"
 #include "gimplayermask.h"
+#include "gimpprojection.h"
 
 #include "gimp-intl.h"
 
 
+static void     floating_sel_merge          (GimpLayer           *layer,
+                                             GimpDrawable        *drawable,
+                                             GimpFilter          *filter);
+static gboolean floating_sel_is_transparent (GeglBuffer          *buffer,
+                                             const GeglRectangle *rect);
+
+
 /* public functions  */
 
 void
@@ -142,7 +155,7 @@ floating_sel_anchor (GimpLayer *layer)
 
   if (filter)
     {
-      gimp_drawable_merge_filter (drawable, filter, NULL, NULL, FALSE);
+      floating_sel_merge (layer, drawable, filter);
       g_object_unref (filter);
     }
 
@@ -329,3 +342,159 @@ floating_sel_invalidate (GimpLayer *layer)
   /*  Invalidate the boundary  */
   layer->fs.boundary_known = FALSE;
 }
+
+
+/*  private functions  */
+
+/*  like gimp_drawable_merge_filter(), but only processes the tiles of
+ *  the drawable which the floating selection doesn't leave fully
+ *  transparent.  the undo buffer shares its tiles with the drawable, so
+ *  only the tiles that actually change take memory
+ */
+static void
+floating_sel_merge (GimpLayer    *layer,
+                    GimpDrawable *drawable,
+                    GimpFilter   *filter)
+{
+  GimpImage     *image     = gimp_item_get_image (GIMP_ITEM (drawable));
+  GeglBuffer    *buffer    = gimp_drawable_get_buffer (drawable);
+  GeglBuffer    *fs_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  GeglNode      *node      = gimp_filter_get_node (filter);
+  GeglBuffer    *undo_buffer;
+  GeglRectangle  rect;
+  GeglRectangle  fs_rect;
+  gboolean       fs_skip_clear;
+  gint           off_x, off_y;
+  gint           dr_off_x, dr_off_y;
+  gint           shift_x, shift_y;
+  gint           tile_width, tile_height;
+  gint           x0, y0;
+  gint           x, y;
+
+  if (! gimp_item_mask_intersect (GIMP_ITEM (drawable),
+                                  &rect.x, &rect.y,
+                                  &rect.width, &rect.height))
+    return;
+
+  gimp_item_get_offset (GIMP_ITEM (layer),    &off_x,    &off_y);
+  gimp_item_get_offset (GIMP_ITEM (drawable), &dr_off_x, &dr_off_y);
+
+  /*  the floating selection's bounds, in drawable coordinates  */
+  fs_rect.x      = off_x - dr_off_x;
+  fs_rect.y      = off_y - dr_off_y;
+  fs_rect.width  = gegl_buffer_get_width  (fs_buffer);
+  fs_rect.height = gegl_buffer_get_height (fs_buffer);
+
+  if (! gegl_rectangle_intersect (&rect, &rect, &fs_rect))
+    return;
+
+  /*  transparent parts of the floating selection only leave the
+   *  drawable alone if its composite mode keeps the destination
+   */
+  fs_skip_clear =
+    babl_format_has_alpha (gegl_buffer_get_format (fs_buffer)) &&
+    (gimp_layer_mode_get_included_region (gimp_layer_get_mode (layer),
+                                          gimp_layer_get_composite_mode (layer)) &
+     GIMP_LAYER_COMPOSITE_REGION_DESTINATION);
+
+  undo_buffer = gimp_gegl_buffer_dup_area (buffer, &rect);
+
+  gimp_projection_stop_rendering (gimp_image_get_projection (image));
+
+  g_object_get (buffer,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  /*  the drawable's tile boundaries at or before the rect's origin  */
+  x0 = rect.x - ((rect.x + shift_x) % tile_width  + tile_width)  % tile_width;
+  y0 = rect.y - ((rect.y + shift_y) % tile_height + tile_height) % tile_height;
+
+  /*  process each row of tiles in spans of tiles that need it, writing
+   *  the other tiles would unshare them from the undo buffer
+   */
+  for (y = y0; y < rect.y + rect.height; y += tile_height)
+    {
+      GeglRectangle span = { 0, };
+
+      for (x = x0; x < rect.x + rect.width; x += tile_width)
+        {
+          GeglRectangle tile;
+          gboolean      needed = FALSE;
+
+          if (gegl_rectangle_intersect (&tile,
+                                        GEGL_RECTANGLE (x, y,
+                                                        tile_width,
+                                                        tile_height),
+                                        &rect))
+            {
+              GeglRectangle fs_tile = tile;
+
+              fs_tile.x -= fs_rect.x;
+              fs_tile.y -= fs_rect.y;
+
+              needed = (! fs_skip_clear ||
+                        ! floating_sel_is_transparent (fs_buffer, &fs_tile));
+            }
+
+          if (needed)
+            {
+              if (span.width)
+                gegl_rectangle_bounding_box (&span, &span, &tile);
+              else
+                span = tile;
+            }
+          else if (span.width)
+            {
+              gimp_gegl_apply_operation (buffer, NULL, NULL, node,
+                                         buffer, &span, FALSE);
+
+              span.width = 0;
+            }
+        }
+
+      if (span.width)
+        gimp_gegl_apply_operation (buffer, NULL, NULL, node,
+                                   buffer, &span, FALSE);
+    }
+
+  gimp_drawable_push_undo (drawable, NULL, undo_buffer,
+                           rect.x, rect.y,
+                           rect.width, rect.height);
+
+  g_object_unref (undo_buffer);
+
+  gimp_drawable_update (drawable,
+                        rect.x, rect.y,
+                        rect.width, rect.height);
+}
+
+static gboolean
+floating_sel_is_transparent (GeglBuffer          *buffer,
+                             const GeglRectangle *rect)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (buffer, rect, 0, babl_format ("A float"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *data = iter->data[0];
+      gint          i;
+
+      for (i = 0; i < iter->length; i++)
+        {
+          if (data[i])
+            {
+              gegl_buffer_iterator_stop (iter);
+
+              return FALSE;
+            }
+        }
+    }
+
+  return TRUE;
+}
@@ -28,6 +28,7 @@
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-loops.h"
+#include "gegl/gimp-gegl-utils.h"
 
 #include "gimpbuffer.h"
 #include "gimpimage.h"
@@ -42,6 +43,8 @@ static void   gimp_layer_new_convert_buffer (GimpLayer         *layer,
                                              GeglBuffer        *src_buffer,
                                              GimpColorProfile  *src_profile,
                                              GError           **error);
+static void   gimp_layer_new_share_buffer   (GimpLayer         *layer,
+                                             GeglBuffer        *src_buffer);
 
 
 /*  public functions  */
@@ -223,10 +226,20 @@ gimp_layer_new_convert_buffer (GimpLayer         *layer,
   GimpImage        *image       = gimp_item_get_image (GIMP_ITEM (layer));
   GeglBuffer       *dest_buffer = gimp_drawable_get_buffer (drawable);
   GimpColorProfile *dest_profile;
+  gboolean          same_format;
+
+  same_format =
+    (gegl_buffer_get_format (src_buffer) == gegl_buffer_get_format (dest_buffer) &&
+     gegl_buffer_get_width  (src_buffer) == gegl_buffer_get_width  (dest_buffer)  &&
+     gegl_buffer_get_height (src_buffer) == gegl_buffer_get_height (dest_buffer));
 
   if (! gimp_image_get_is_color_managed (image))
     {
-      gegl_buffer_copy (src_buffer, NULL, GEGL_ABYSS_NONE, dest_buffer, NULL);
+      if (same_format)
+        gimp_layer_new_share_buffer (layer, src_buffer);
+      else
+        gegl_buffer_copy (src_buffer, NULL, GEGL_ABYSS_NONE, dest_buffer, NULL);
+
       return;
     }
 
@@ -240,8 +253,31 @@ gimp_layer_new_convert_buffer (GimpLayer         *layer,
   dest_profile =
     gimp_color_managed_get_color_profile (GIMP_COLOR_MANAGED (layer));
 
+  if (same_format &&
+      gimp_color_transform_can_gegl_copy (src_profile, dest_profile))
+    {
+      gimp_layer_new_share_buffer (layer, src_buffer);
+      return;
+    }
+
   gimp_gegl_convert_color_profile (src_buffer,  NULL, src_profile,
                                    dest_buffer, NULL, dest_profile,
                                    GIMP_COLOR_RENDERING_INTENT_PERCEPTUAL,
                                    TRUE, NULL);
 }
+
+/*  gives the layer a copy of 'src_buffer' that shares its tiles, so
+ *  pasting or floating pixels costs no memory until either is changed
+ */
+static void
+gimp_layer_new_share_buffer (GimpLayer  *layer,
+                             GeglBuffer *src_buffer)
+{
+  GeglBuffer *buffer;
+
+  buffer = gimp_gegl_buffer_dup_area (src_buffer,
+                                      gegl_buffer_get_extent (src_buffer));
+
+  gimp_drawable_set_buffer (GIMP_DRAWABLE (layer), FALSE, NULL, buffer);
+  g_object_unref (buffer);
+}
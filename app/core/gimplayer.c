@@ -32,6 +32,7 @@
 #include "core-types.h"
 
 #include "operations/layer-modes/gimp-layer-modes.h"
+#include "operations/layer-modes/gimpoperationlayermode.h"
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-apply-operation.h"
@@ -267,6 +268,7 @@ static void  gimp_layer_real_get_effective_mode (GimpLayer          *layer,
 static gboolean
           gimp_layer_real_get_excludes_backdrop (GimpLayer          *layer);
 
+static void       gimp_layer_update_mask_area   (GimpLayer          *layer);
 static void       gimp_layer_layer_mask_update  (GimpDrawable       *layer_mask,
                                                  gint                x,
                                                  gint                y,
@@ -776,14 +778,28 @@ static gchar *
 gimp_layer_get_description (GimpViewable  *viewable,
                             gchar        **tooltip)
 {
-  if (gimp_layer_is_floating_sel (GIMP_LAYER (viewable)))
+  GimpLayer *layer = GIMP_LAYER (viewable);
+  gchar     *description;
+  gint64     render_cost;
+
+  if (gimp_layer_is_floating_sel (layer))
     {
       return g_strdup_printf (_("Floating Selection\n(%s)"),
                               gimp_object_get_name (viewable));
     }
 
-  return GIMP_VIEWABLE_CLASS (parent_class)->get_description (viewable,
-                                                              tooltip);
+  description = GIMP_VIEWABLE_CLASS (parent_class)->get_description (viewable,
+                                                                     tooltip);
+
+  render_cost = gimp_layer_get_render_cost (layer);
+
+  if (tooltip && ! *tooltip && render_cost > 0)
+    {
+      *tooltip = g_strdup_printf (_("%s\nRender cost: %.1f ms"),
+                                  description, render_cost / 1000.0);
+    }
+
+  return description;
 }
 
 static GeglNode *
@@ -1581,9 +1597,45 @@ gimp_layer_real_convert_type (GimpLayer        *layer,
                               gboolean          push_undo,
                               GimpProgress     *progress)
 {
-  GimpDrawable *drawable = GIMP_DRAWABLE (layer);
-  GeglBuffer   *src_buffer;
-  GeglBuffer   *dest_buffer;
+  GimpDrawable     *drawable    = GIMP_DRAWABLE (layer);
+  GimpColorProfile *src_profile = NULL;
+  GeglBuffer       *src_buffer;
+  GeglBuffer       *dest_buffer;
+  gint              bits;
+
+  if (dest_profile)
+    {
+      src_profile =
+        gimp_color_managed_get_color_profile (GIMP_COLOR_MANAGED (layer));
+
+      /*  don't go through a color transform which would only copy  */
+      if (gimp_color_transform_can_gegl_copy (src_profile, dest_profile))
+        dest_profile = NULL;
+    }
+
+  bits = (babl_format_get_bytes_per_pixel (new_format) * 8 /
+          babl_format_get_n_components (new_format));
+
+  dest_buffer =
+    gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                     gimp_item_get_width  (GIMP_ITEM (layer)),
+                                     gimp_item_get_height (GIMP_ITEM (layer))),
+                     new_format);
+
+  if (layer_dither_type != GEGL_DITHER_NONE && ! dest_profile)
+    {
+      /*  without a profile conversion, dither right into the new
+       *  buffer instead of into a full-size copy of the old one
+       */
+      gimp_gegl_apply_dither (gimp_drawable_get_buffer (drawable),
+                              NULL, NULL,
+                              dest_buffer, 1 << bits, layer_dither_type);
+
+      gimp_drawable_set_buffer (drawable, push_undo, NULL, dest_buffer);
+      g_object_unref (dest_buffer);
+
+      return;
+    }
 
   if (layer_dither_type == GEGL_DITHER_NONE)
     {
@@ -1591,33 +1643,19 @@ gimp_layer_real_convert_type (GimpLayer        *layer,
     }
   else
     {
-      gint bits;
-
       src_buffer =
         gegl_buffer_new (GEGL_RECTANGLE (0, 0,
                                          gimp_item_get_width  (GIMP_ITEM (layer)),
                                          gimp_item_get_height (GIMP_ITEM (layer))),
                          gimp_drawable_get_format (drawable));
 
-      bits = (babl_format_get_bytes_per_pixel (new_format) * 8 /
-              babl_format_get_n_components (new_format));
-
       gimp_gegl_apply_dither (gimp_drawable_get_buffer (drawable),
                               NULL, NULL,
                               src_buffer, 1 << bits, layer_dither_type);
     }
 
-  dest_buffer =
-    gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                     gimp_item_get_width  (GIMP_ITEM (layer)),
-                                     gimp_item_get_height (GIMP_ITEM (layer))),
-                     new_format);
-
   if (dest_profile)
     {
-      GimpColorProfile *src_profile =
-        gimp_color_managed_get_color_profile (GIMP_COLOR_MANAGED (layer));
-
       gimp_gegl_convert_color_profile (src_buffer,  NULL, src_profile,
                                        dest_buffer, NULL, dest_profile,
                                        GIMP_COLOR_RENDERING_INTENT_PERCEPTUAL,
@@ -1625,7 +1663,8 @@ gimp_layer_real_convert_type (GimpLayer        *layer,
     }
   else
     {
-      gegl_buffer_copy (src_buffer, NULL, GEGL_ABYSS_NONE, dest_buffer, NULL);
+      gimp_gegl_buffer_copy (src_buffer, NULL, GEGL_ABYSS_NONE,
+                             dest_buffer, NULL);
     }
 
   gimp_drawable_set_buffer (drawable, push_undo, NULL, dest_buffer);
@@ -1658,6 +1697,30 @@ gimp_layer_real_get_excludes_backdrop (GimpLayer *layer)
   return ! (included_region & GIMP_LAYER_COMPOSITE_REGION_DESTINATION);
 }
 
+/*  updates the part of the layer which applying or not applying its mask
+ *  makes a difference for, instead of the whole layer
+ */
+static void
+gimp_layer_update_mask_area (GimpLayer *layer)
+{
+  GArray *rects;
+  gint    i;
+
+  rects = gimp_layer_mask_get_translucent_area (layer->mask);
+
+  for (i = 0; i < rects->len; i++)
+    {
+      const GeglRectangle *rect = &g_array_index (rects, GeglRectangle, i);
+
+      gimp_drawable_update (GIMP_DRAWABLE (layer),
+                            rect->x, rect->y, rect->width, rect->height);
+    }
+
+  g_array_free (rects, TRUE);
+
+  gimp_viewable_invalidate_preview (GIMP_VIEWABLE (layer));
+}
+
 static void
 gimp_layer_layer_mask_update (GimpDrawable *drawable,
                               gint          x,
@@ -1768,11 +1831,14 @@ gimp_layer_add_mask (GimpLayer      *layer,
       gimp_layer_update_mode_node (layer);
     }
 
-  if (gimp_layer_get_apply_mask (layer) ||
-      gimp_layer_get_show_mask (layer))
+  if (gimp_layer_get_show_mask (layer))
     {
       gimp_drawable_update (GIMP_DRAWABLE (layer), 0, 0, -1, -1);
     }
+  else if (gimp_layer_get_apply_mask (layer))
+    {
+      gimp_layer_update_mask_area (layer);
+    }
 
   g_signal_connect (mask, "update",
                     G_CALLBACK (gimp_layer_layer_mask_update),
@@ -2143,7 +2209,11 @@ gimp_layer_set_apply_mask (GimpLayer *layer,
             }
         }
 
-      gimp_drawable_update (GIMP_DRAWABLE (layer), 0, 0, -1, -1);
+      /*  a shown mask hides whether it's applied  */
+      if (! gimp_layer_get_show_mask (layer))
+        gimp_layer_update_mask_area (layer);
+      else
+        gimp_viewable_invalidate_preview (GIMP_VIEWABLE (layer));
 
       g_signal_emit (layer, layer_signals[APPLY_MASK_CHANGED], 0);
     }
@@ -2666,6 +2736,32 @@ gimp_layer_get_excludes_backdrop (GimpLayer *layer)
   return layer->excludes_backdrop;
 }
 
+/* returns the time, in microseconds, spent compositing the layer onto its
+ * backdrop since the projection last started rendering, for a group layer
+ * this includes compositing its projection.
+ * filters applied to the layer, and the layer's children, are not included.
+ */
+gint64
+gimp_layer_get_render_cost (GimpLayer *layer)
+{
+  GeglNode      *mode_node;
+  GeglOperation *operation;
+
+  g_return_val_if_fail (GIMP_IS_LAYER (layer), 0);
+
+  if (! gimp_filter_peek_node (GIMP_FILTER (layer)))
+    return 0;
+
+  mode_node = gimp_drawable_get_mode_node (GIMP_DRAWABLE (layer));
+  operation = gegl_node_get_gegl_operation (mode_node);
+
+  if (! GIMP_IS_OPERATION_LAYER_MODE (operation))
+    return 0;
+
+  return gimp_operation_layer_mode_get_render_cost (
+    GIMP_OPERATION_LAYER_MODE (operation));
+}
+
 void
 gimp_layer_set_lock_alpha (GimpLayer *layer,
                            gboolean   lock_alpha,
@@ -226,6 +226,8 @@ void            gimp_layer_get_effective_mode  (GimpLayer            *layer,
 
 gboolean      gimp_layer_get_excludes_backdrop (GimpLayer            *layer);
 
+gint64          gimp_layer_get_render_cost     (GimpLayer            *layer);
+
 void            gimp_layer_set_lock_alpha      (GimpLayer            *layer,
                                                 gboolean              lock_alpha,
                                                 gboolean              push_undo);
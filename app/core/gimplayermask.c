@@ -28,6 +28,7 @@
 #include "core-types.h"
 
 #include "gegl/gimp-babl.h"
+#include "gegl/gimp-gegl-mask.h"
 
 #include "gimperror.h"
 #include "gimpimage.h"
@@ -38,6 +39,16 @@
 #include "gimp-intl.h"
 
 
+enum
+{
+  TILE_UNKNOWN,
+  TILE_OPAQUE,
+  TILE_TRANSLUCENT
+};
+
+
+static void            gimp_layer_mask_finalize           (GObject           *object);
+
 static gboolean        gimp_layer_mask_is_attached        (GimpItem          *item);
 static gboolean        gimp_layer_mask_is_content_locked  (GimpItem          *item);
 static gboolean        gimp_layer_mask_is_position_locked (GimpItem          *item);
@@ -57,6 +68,13 @@ static void            gimp_layer_mask_convert_type       (GimpDrawable      *dr
                                                            GeglDitherMethod   mask_dither_type,
                                                            gboolean           push_undo,
                                                            GimpProgress      *progress);
+static void            gimp_layer_mask_update             (GimpDrawable      *drawable,
+                                                           gint               x,
+                                                           gint               y,
+                                                           gint               width,
+                                                           gint               height);
+
+static void            gimp_layer_mask_validate_tiles     (GimpLayerMask     *layer_mask);
 
 
 G_DEFINE_TYPE (GimpLayerMask, gimp_layer_mask, GIMP_TYPE_CHANNEL)
@@ -67,10 +85,13 @@ G_DEFINE_TYPE (GimpLayerMask, gimp_layer_mask, GIMP_TYPE_CHANNEL)
 static void
 gimp_layer_mask_class_init (GimpLayerMaskClass *klass)
 {
+  GObjectClass      *object_class   = G_OBJECT_CLASS (klass);
   GimpViewableClass *viewable_class = GIMP_VIEWABLE_CLASS (klass);
   GimpItemClass     *item_class     = GIMP_ITEM_CLASS (klass);
   GimpDrawableClass *drawable_class = GIMP_DRAWABLE_CLASS (klass);
 
+  object_class->finalize            = gimp_layer_mask_finalize;
+
   viewable_class->default_icon_name = "gimp-layer-mask";
 
   item_class->is_attached        = gimp_layer_mask_is_attached;
@@ -83,6 +104,7 @@ gimp_layer_mask_class_init (GimpLayerMaskClass *klass)
   item_class->to_selection_desc  = C_("undo-type", "Layer Mask to Selection");
 
   drawable_class->convert_type   = gimp_layer_mask_convert_type;
+  drawable_class->update         = gimp_layer_mask_update;
 }
 
 static void
@@ -91,6 +113,16 @@ gimp_layer_mask_init (GimpLayerMask *layer_mask)
   layer_mask->layer = NULL;
 }
 
+static void
+gimp_layer_mask_finalize (GObject *object)
+{
+  GimpLayerMask *layer_mask = GIMP_LAYER_MASK (object);
+
+  g_clear_pointer (&layer_mask->tiles, g_free);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gimp_layer_mask_is_content_locked (GimpItem *item)
 {
@@ -182,6 +214,105 @@ gimp_layer_mask_convert_type (GimpDrawable      *drawable,
                                                     progress);
 }
 
+static void
+gimp_layer_mask_update (GimpDrawable *drawable,
+                        gint          x,
+                        gint          y,
+                        gint          width,
+                        gint          height)
+{
+  GimpLayerMask *layer_mask = GIMP_LAYER_MASK (drawable);
+
+  if (layer_mask->tiles && width > 0 && height > 0)
+    {
+      gint x1, y1, x2, y2;
+      gint tx, ty;
+
+      x1 = MAX ((x - layer_mask->tiles_x) / layer_mask->tile_width, 0);
+      y1 = MAX ((y - layer_mask->tiles_y) / layer_mask->tile_height, 0);
+      x2 = MIN ((x + width  - 1 - layer_mask->tiles_x) / layer_mask->tile_width,
+                layer_mask->n_tiles_x - 1);
+      y2 = MIN ((y + height - 1 - layer_mask->tiles_y) / layer_mask->tile_height,
+                layer_mask->n_tiles_y - 1);
+
+      for (ty = y1; ty <= y2; ty++)
+        for (tx = x1; tx <= x2; tx++)
+          layer_mask->tiles[ty * layer_mask->n_tiles_x + tx] = TILE_UNKNOWN;
+    }
+
+  GIMP_DRAWABLE_CLASS (parent_class)->update (drawable, x, y, width, height);
+}
+
+static void
+gimp_layer_mask_validate_tiles (GimpLayerMask *layer_mask)
+{
+  GeglBuffer          *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer_mask));
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  gint                 shift_x, shift_y;
+  gint                 tile_width, tile_height;
+  gint                 tx, ty;
+
+  g_object_get (buffer,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  if (layer_mask->tiles_buffer != buffer ||
+      layer_mask->tile_width   != tile_width ||
+      layer_mask->tile_height  != tile_height)
+    {
+      g_clear_pointer (&layer_mask->tiles, g_free);
+    }
+
+  if (! layer_mask->tiles)
+    {
+      layer_mask->tiles_buffer = buffer;
+      layer_mask->tile_width   = tile_width;
+      layer_mask->tile_height  = tile_height;
+
+      /*  the buffer's tile boundaries at or before its origin  */
+      layer_mask->tiles_x = extent->x -
+                            ((extent->x + shift_x) % tile_width +
+                             tile_width) % tile_width;
+      layer_mask->tiles_y = extent->y -
+                            ((extent->y + shift_y) % tile_height +
+                             tile_height) % tile_height;
+
+      layer_mask->n_tiles_x = (extent->x + extent->width - layer_mask->tiles_x +
+                               tile_width - 1) / tile_width;
+      layer_mask->n_tiles_y = (extent->y + extent->height - layer_mask->tiles_y +
+                               tile_height - 1) / tile_height;
+
+      layer_mask->tiles = g_new0 (guint8,
+                                  layer_mask->n_tiles_x * layer_mask->n_tiles_y);
+    }
+
+  for (ty = 0; ty < layer_mask->n_tiles_y; ty++)
+    for (tx = 0; tx < layer_mask->n_tiles_x; tx++)
+      {
+        guint8 *tile = &layer_mask->tiles[ty * layer_mask->n_tiles_x + tx];
+
+        if (*tile == TILE_UNKNOWN)
+          {
+            GeglRectangle rect;
+
+            gegl_rectangle_intersect (&rect,
+                                      GEGL_RECTANGLE (layer_mask->tiles_x +
+                                                      tx * tile_width,
+                                                      layer_mask->tiles_y +
+                                                      ty * tile_height,
+                                                      tile_width,
+                                                      tile_height),
+                                      extent);
+
+            *tile = gimp_gegl_mask_is_full (buffer, &rect) ?
+                    TILE_OPAQUE : TILE_TRANSLUCENT;
+          }
+      }
+}
+
 GimpLayerMask *
 gimp_layer_mask_new (GimpImage     *image,
                      gint           width,
@@ -267,3 +398,81 @@ gimp_layer_mask_get_layer (GimpLayerMask *layer_mask)
 
   return layer_mask->layer;
 }
+
+/*  returns the area of the mask which is not fully opaque, i.e. the
+ *  area of the layer affected by applying the mask, as an array of
+ *  GeglRectangles
+ */
+GArray *
+gimp_layer_mask_get_translucent_area (GimpLayerMask *layer_mask)
+{
+  GeglBuffer          *buffer;
+  const GeglRectangle *extent;
+  GArray              *rects;
+  gint                 tx, ty;
+
+  g_return_val_if_fail (GIMP_IS_LAYER_MASK (layer_mask), NULL);
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer_mask));
+  extent = gegl_buffer_get_extent (buffer);
+
+  gimp_layer_mask_validate_tiles (layer_mask);
+
+  rects = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
+
+  for (ty = 0; ty < layer_mask->n_tiles_y; ty++)
+    {
+      tx = 0;
+
+      while (tx < layer_mask->n_tiles_x)
+        {
+          GeglRectangle  span;
+          GeglRectangle *last;
+          gint           start;
+
+          if (layer_mask->tiles[ty * layer_mask->n_tiles_x + tx] ==
+              TILE_OPAQUE)
+            {
+              tx++;
+              continue;
+            }
+
+          start = tx;
+
+          while (tx < layer_mask->n_tiles_x &&
+                 layer_mask->tiles[ty * layer_mask->n_tiles_x + tx] !=
+                 TILE_OPAQUE)
+            {
+              tx++;
+            }
+
+          gegl_rectangle_intersect (&span,
+                                    GEGL_RECTANGLE (layer_mask->tiles_x +
+                                                    start * layer_mask->tile_width,
+                                                    layer_mask->tiles_y +
+                                                    ty * layer_mask->tile_height,
+                                                    (tx - start) *
+                                                    layer_mask->tile_width,
+                                                    layer_mask->tile_height),
+                                    extent);
+
+          /*  merge with the same span of the previous row  */
+          last = rects->len ?
+                 &g_array_index (rects, GeglRectangle, rects->len - 1) : NULL;
+
+          if (last                       &&
+              last->x      == span.x     &&
+              last->width  == span.width &&
+              last->y + last->height == span.y)
+            {
+              last->height += span.height;
+            }
+          else
+            {
+              g_array_append_val (rects, span);
+            }
+        }
+    }
+
+  return rects;
+}
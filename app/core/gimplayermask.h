@@ -37,6 +37,18 @@ struct _GimpLayerMask
   GimpChannel  parent_instance;
 
   GimpLayer   *layer;
+
+  /*  which tiles of the mask are fully opaque, so toggling the mask
+   *  only needs to update the others
+   */
+  GeglBuffer  *tiles_buffer;   /* not referenced, only compared */
+  gint         tiles_x;
+  gint         tiles_y;
+  gint         tile_width;
+  gint         tile_height;
+  gint         n_tiles_x;
+  gint         n_tiles_y;
+  guint8      *tiles;
 };
 
 struct _GimpLayerMaskClass
@@ -63,5 +75,8 @@ void            gimp_layer_mask_set_layer       (GimpLayerMask *layer_mask,
                                                  GimpLayer     *layer);
 GimpLayer     * gimp_layer_mask_get_layer       (GimpLayerMask *layer_mask);
 
+GArray        * gimp_layer_mask_get_translucent_area
+                                                (GimpLayerMask *layer_mask);
+
 
 #endif /* __GIMP_LAYER_MASK_H__ */
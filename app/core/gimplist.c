@@ -73,6 +73,12 @@ static GimpObject * gimp_list_get_child_by_index (GimpContainer *container,
 static gint         gimp_list_get_child_index    (GimpContainer *container,
                                                   GimpObject    *object);
 
+static void         gimp_list_invalidate_index   (GimpList      *list);
+static gboolean     gimp_list_ensure_index       (GimpList      *list);
+static void         gimp_list_name_index_add     (GimpList      *list,
+                                                  GimpObject    *object);
+static void         gimp_list_name_index_remove  (GimpList      *list,
+                                                  GimpObject    *object);
 static void         gimp_list_uniquefy_name      (GimpList      *gimp_list,
                                                   GimpObject    *object);
 static void         gimp_list_object_renamed     (GimpObject    *object,
@@ -148,6 +154,11 @@ gimp_list_finalize (GObject *object)
       list->queue = NULL;
     }
 
+  g_clear_pointer (&list->object_names, g_hash_table_unref);
+  g_clear_pointer (&list->name_hash,    g_hash_table_unref);
+  g_clear_pointer (&list->index_hash,   g_hash_table_unref);
+  g_clear_pointer (&list->index_array,  g_ptr_array_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -163,6 +174,19 @@ gimp_list_set_property (GObject      *object,
     {
     case PROP_UNIQUE_NAMES:
       list->unique_names = g_value_get_boolean (value);
+
+      /*  keep an index of the children's names, so that finding
+       *  children by name and uniquefying names doesn't need to
+       *  scan the whole list
+       */
+      if (list->unique_names && ! list->name_hash)
+        {
+          list->name_hash    = g_hash_table_new_full (g_str_hash,
+                                                      g_str_equal,
+                                                      g_free, NULL);
+          list->object_names = g_hash_table_new (g_direct_hash,
+                                                 g_direct_equal);
+        }
       break;
     case PROP_SORT_FUNC:
       gimp_list_set_sort_func (list, g_value_get_pointer (value));
@@ -222,6 +246,19 @@ gimp_list_get_memsize (GimpObject *object,
       memsize += gimp_g_queue_get_memsize (list->queue, 0);
     }
 
+  if (list->name_hash)
+    {
+      memsize += gimp_g_hash_table_get_memsize (list->name_hash, 0);
+      memsize += gimp_g_hash_table_get_memsize (list->object_names, 0);
+    }
+
+  if (list->index_array)
+    {
+      memsize += sizeof (GPtrArray) +
+                 list->index_array->len * sizeof (gpointer);
+      memsize += gimp_g_hash_table_get_memsize (list->index_hash, 0);
+    }
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -243,7 +280,10 @@ gimp_list_add (GimpContainer *container,
   GimpList *list = GIMP_LIST (container);
 
   if (list->unique_names)
-    gimp_list_uniquefy_name (list, object);
+    {
+      gimp_list_uniquefy_name (list, object);
+      gimp_list_name_index_add (list, object);
+    }
 
   if (list->unique_names || list->sort_func)
     g_signal_connect (object, "name-changed",
@@ -264,6 +304,8 @@ gimp_list_add (GimpContainer *container,
       g_queue_push_head (list->queue, object);
     }
 
+  gimp_list_invalidate_index (list);
+
   GIMP_CONTAINER_CLASS (parent_class)->add (container, object);
 }
 
@@ -278,8 +320,13 @@ gimp_list_remove (GimpContainer *container,
                                           gimp_list_object_renamed,
                                           list);
 
+  if (list->unique_names)
+    gimp_list_name_index_remove (list, object);
+
   g_queue_remove (list->queue, object);
 
+  gimp_list_invalidate_index (list);
+
   GIMP_CONTAINER_CLASS (parent_class)->remove (container, object);
 }
 
@@ -296,6 +343,8 @@ gimp_list_reorder (GimpContainer *container,
     g_queue_push_tail (list->queue, object);
   else
     g_queue_push_nth (list->queue, object, new_index);
+
+  gimp_list_invalidate_index (list);
 }
 
 static void
@@ -313,6 +362,9 @@ gimp_list_have (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  if (list->index_valid)
+    return g_hash_table_contains (list->index_hash, object);
+
   return g_queue_find (list->queue, object) ? TRUE : FALSE;
 }
 
@@ -333,6 +385,9 @@ gimp_list_get_child_by_name (GimpContainer *container,
   GimpList *list = GIMP_LIST (container);
   GList    *glist;
 
+  if (list->name_hash)
+    return g_hash_table_lookup (list->name_hash, name);
+
   for (glist = list->queue->head; glist; glist = g_list_next (glist))
     {
       GimpObject *object = glist->data;
@@ -350,6 +405,14 @@ gimp_list_get_child_by_index (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  if (gimp_list_ensure_index (list))
+    {
+      if (index < 0 || index >= (gint) list->index_array->len)
+        return NULL;
+
+      return g_ptr_array_index (list->index_array, index);
+    }
+
   return g_queue_peek_nth (list->queue, index);
 }
 
@@ -359,6 +422,10 @@ gimp_list_get_child_index (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  if (gimp_list_ensure_index (list))
+    return GPOINTER_TO_INT (g_hash_table_lookup (list->index_hash,
+                                                 object)) - 1;
+
   return g_queue_index (list->queue, (gpointer) object);
 }
 
@@ -445,6 +512,7 @@ gimp_list_reverse (GimpList *list)
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       g_queue_reverse (list->queue);
+      gimp_list_invalidate_index (list);
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -509,6 +577,7 @@ gimp_list_sort (GimpList     *list,
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       g_queue_sort (list->queue, gimp_list_sort_func, sort_func);
+      gimp_list_invalidate_index (list);
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -530,28 +599,99 @@ gimp_list_sort_by_name (GimpList *list)
 
 /*  private functions  */
 
+static void
+gimp_list_invalidate_index (GimpList *list)
+{
+  list->index_valid     = FALSE;
+  list->n_index_lookups = 0;
+}
+
+/*  The index cache maps positions to children and back.  It is only
+ *  built once the children are looked up by position more than once
+ *  between two changes of the list, so that a single lookup after a
+ *  change doesn't pay for building it, while repeated lookups (like
+ *  walking a layer stack by index) don't walk the list each time.
+ */
+static gboolean
+gimp_list_ensure_index (GimpList *list)
+{
+  GList *glist;
+  gint   i;
+
+  if (list->index_valid)
+    return TRUE;
+
+  if (++list->n_index_lookups < 2)
+    return FALSE;
+
+  if (! list->index_array)
+    {
+      list->index_array = g_ptr_array_new ();
+      list->index_hash  = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+  else
+    {
+      g_ptr_array_set_size (list->index_array, 0);
+      g_hash_table_remove_all (list->index_hash);
+    }
+
+  for (glist = list->queue->head, i = 0;
+       glist;
+       glist = g_list_next (glist), i++)
+    {
+      g_ptr_array_add (list->index_array, glist->data);
+      g_hash_table_insert (list->index_hash,
+                           glist->data, GINT_TO_POINTER (i + 1));
+    }
+
+  list->index_valid = TRUE;
+
+  return TRUE;
+}
+
+static void
+gimp_list_name_index_add (GimpList   *list,
+                          GimpObject *object)
+{
+  const gchar *name = gimp_object_get_name (object);
+
+  if (name)
+    {
+      gchar *key = g_strdup (name);
+
+      g_hash_table_insert (list->name_hash,    key,    object);
+      g_hash_table_insert (list->object_names, object, key);
+    }
+}
+
+static void
+gimp_list_name_index_remove (GimpList   *list,
+                             GimpObject *object)
+{
+  gchar *key = g_hash_table_lookup (list->object_names, object);
+
+  if (key)
+    {
+      g_hash_table_remove (list->object_names, object);
+
+      /*  frees key  */
+      g_hash_table_remove (list->name_hash, key);
+    }
+}
+
 static void
 gimp_list_uniquefy_name (GimpList   *gimp_list,
                          GimpObject *object)
 {
-  gchar *name = (gchar *) gimp_object_get_name (object);
-  GList *list;
+  gchar      *name = (gchar *) gimp_object_get_name (object);
+  GimpObject *object2;
 
   if (! name)
     return;
 
-  for (list = gimp_list->queue->head; list; list = g_list_next (list))
-    {
-      GimpObject  *object2 = list->data;
-      const gchar *name2   = gimp_object_get_name (object2);
-
-      if (object != object2 &&
-          name2             &&
-          ! strcmp (name, name2))
-        break;
-    }
+  object2 = g_hash_table_lookup (gimp_list->name_hash, name);
 
-  if (list)
+  if (object2 && object2 != object)
     {
       gchar *ext;
       gchar *new_name   = NULL;
@@ -591,18 +731,9 @@ gimp_list_uniquefy_name (GimpList   *gimp_list,
 
           new_name = g_strdup_printf ("%s #%d", name, unique_ext);
 
-          for (list = gimp_list->queue->head; list; list = g_list_next (list))
-            {
-              GimpObject  *object2 = list->data;
-              const gchar *name2   = gimp_object_get_name (object2);
-
-              if (object != object2 &&
-                  name2             &&
-                  ! strcmp (new_name, name2))
-                break;
-            }
+          object2 = g_hash_table_lookup (gimp_list->name_hash, new_name);
         }
-      while (list);
+      while (object2 && object2 != object);
 
       g_free (name);
 
@@ -620,7 +751,9 @@ gimp_list_object_renamed (GimpObject *object,
                                        gimp_list_object_renamed,
                                        list);
 
+      gimp_list_name_index_remove (list, object);
       gimp_list_uniquefy_name (list, object);
+      gimp_list_name_index_add (list, object);
 
       g_signal_handlers_unblock_by_func (object,
                                          gimp_list_object_renamed,
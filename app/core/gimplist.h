@@ -41,6 +41,12 @@ struct _GimpList
 
   GQueue        *queue;
   gboolean       unique_names;
+  GHashTable    *name_hash;     /*  name -> object, for unique names  */
+  GHashTable    *object_names;  /*  object -> name in name_hash       */
+  GPtrArray     *index_array;   /*  index -> object, cache            */
+  GHashTable    *index_hash;    /*  object -> index + 1, cache        */
+  gboolean       index_valid;
+  gint           n_index_lookups;
   GCompareFunc   sort_func;
   gboolean       append;
 };
@@ -0,0 +1,415 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpmasksummary.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  a grid of per-tile summaries of a mask buffer: the extent of the
+ *  non-zero pixels of each tile.  only the tiles which changed since
+ *  the last query are scanned again, the bounds and emptiness of the
+ *  whole mask are then put together from the grid.
+ *
+ *  the summary is invalidated from the buffer's "changed" handler,
+ *  which runs on whichever threads write the buffer, so the cells'
+ *  validity is only touched with the summary's mutex held.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gimp-parallel.h"
+#include "gimpmasksummary.h"
+
+
+/*  the size of the summarized tiles, the same as the tiles of the
+ *  buffers it is used on
+ */
+#define CELL_SHIFT            6
+#define CELL_SIZE             (1 << CELL_SHIFT)
+
+#define MIN_PARALLEL_SUB_SIZE 4
+
+
+typedef struct _GimpMaskSummaryCell GimpMaskSummaryCell;
+
+struct _GimpMaskSummaryCell
+{
+  gboolean valid;
+  gint     x1, y1;  /*  the extent of the cell's non-zero pixels,   */
+  gint     x2, y2;  /*  empty if x1 >= x2                           */
+};
+
+struct _GimpMaskSummary
+{
+  GMutex               mutex;
+
+  gint                 width;
+  gint                 height;
+  gint                 n_cols;
+  gint                 n_rows;
+  GimpMaskSummaryCell *cells;
+};
+
+typedef struct
+{
+  GimpMaskSummary *summary;
+  GeglBuffer      *buffer;
+  gint            *indices;
+} UpdateData;
+
+
+static void   gimp_mask_summary_update       (GimpMaskSummary *summary,
+                                              GeglBuffer      *buffer);
+static void   gimp_mask_summary_update_cells (gsize            offset,
+                                              gsize            size,
+                                              UpdateData      *data);
+
+
+/*  public functions  */
+
+GimpMaskSummary *
+gimp_mask_summary_new (void)
+{
+  GimpMaskSummary *summary = g_slice_new0 (GimpMaskSummary);
+
+  g_mutex_init (&summary->mutex);
+
+  return summary;
+}
+
+void
+gimp_mask_summary_free (GimpMaskSummary *summary)
+{
+  g_return_if_fail (summary != NULL);
+
+  g_mutex_clear (&summary->mutex);
+
+  g_free (summary->cells);
+
+  g_slice_free (GimpMaskSummary, summary);
+}
+
+gint64
+gimp_mask_summary_get_memsize (GimpMaskSummary *summary)
+{
+  g_return_val_if_fail (summary != NULL, 0);
+
+  return sizeof (GimpMaskSummary) +
+         (gint64) summary->n_cols * summary->n_rows *
+         sizeof (GimpMaskSummaryCell);
+}
+
+/**
+ * gimp_mask_summary_invalidate:
+ * @summary: a #GimpMaskSummary
+ * @rect:    the changed area of the mask, or %NULL
+ *
+ * Marks the tiles intersecting @rect, or all tiles if @rect is %NULL,
+ * to be scanned again on the next query.
+ **/
+void
+gimp_mask_summary_invalidate (GimpMaskSummary     *summary,
+                              const GeglRectangle *rect)
+{
+  gint col1 = 0;
+  gint row1 = 0;
+  gint col2;
+  gint row2;
+  gint col, row;
+
+  g_return_if_fail (summary != NULL);
+
+  if (rect && (rect->width <= 0 || rect->height <= 0))
+    return;
+
+  g_mutex_lock (&summary->mutex);
+
+  col2 = summary->n_cols;
+  row2 = summary->n_rows;
+
+  if (rect)
+    {
+      col1 = MAX (col1, rect->x >> CELL_SHIFT);
+      row1 = MAX (row1, rect->y >> CELL_SHIFT);
+      col2 = MIN (col2, ((rect->x + rect->width  - 1) >> CELL_SHIFT) + 1);
+      row2 = MIN (row2, ((rect->y + rect->height - 1) >> CELL_SHIFT) + 1);
+    }
+
+  for (row = row1; row < row2; row++)
+    {
+      GimpMaskSummaryCell *cell = summary->cells + row * summary->n_cols;
+
+      for (col = col1; col < col2; col++)
+        cell[col].valid = FALSE;
+    }
+
+  g_mutex_unlock (&summary->mutex);
+}
+
+/**
+ * gimp_mask_summary_bounds:
+ * @summary: a #GimpMaskSummary
+ * @buffer:  the mask @summary summarizes
+ * @x1:      return location for the left edge of the bounds
+ * @y1:      return location for the top edge of the bounds
+ * @x2:      return location for the right edge of the bounds
+ * @y2:      return location for the bottom edge of the bounds
+ *
+ * The same as gimp_gegl_mask_bounds(), but only the tiles which
+ * changed since the last query are scanned.
+ *
+ * Returns: %FALSE if @buffer is empty.
+ **/
+gboolean
+gimp_mask_summary_bounds (GimpMaskSummary *summary,
+                          GeglBuffer      *buffer,
+                          gint            *x1,
+                          gint            *y1,
+                          gint            *x2,
+                          gint            *y2)
+{
+  gint tx1, ty1, tx2, ty2;
+  gint i;
+
+  g_return_val_if_fail (summary != NULL, FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (x1 != NULL, FALSE);
+  g_return_val_if_fail (y1 != NULL, FALSE);
+  g_return_val_if_fail (x2 != NULL, FALSE);
+  g_return_val_if_fail (y2 != NULL, FALSE);
+
+  gimp_mask_summary_update (summary, buffer);
+
+  tx1 = summary->width;
+  ty1 = summary->height;
+  tx2 = 0;
+  ty2 = 0;
+
+  for (i = 0; i < summary->n_cols * summary->n_rows; i++)
+    {
+      const GimpMaskSummaryCell *cell = &summary->cells[i];
+
+      if (cell->x1 < cell->x2)
+        {
+          tx1 = MIN (tx1, cell->x1);
+          ty1 = MIN (ty1, cell->y1);
+          tx2 = MAX (tx2, cell->x2);
+          ty2 = MAX (ty2, cell->y2);
+        }
+    }
+
+  if (tx1 >= tx2)
+    {
+      *x1 = 0;
+      *y1 = 0;
+      *x2 = summary->width;
+      *y2 = summary->height;
+
+      return FALSE;
+    }
+
+  *x1 = tx1;
+  *y1 = ty1;
+  *x2 = tx2;
+  *y2 = ty2;
+
+  return TRUE;
+}
+
+/**
+ * gimp_mask_summary_is_empty:
+ * @summary: a #GimpMaskSummary
+ * @buffer:  the mask @summary summarizes
+ *
+ * The same as gimp_gegl_mask_is_empty(), but the tiles which didn't
+ * change since the last query are not scanned.
+ *
+ * Returns: %TRUE if @buffer is empty.
+ **/
+gboolean
+gimp_mask_summary_is_empty (GimpMaskSummary *summary,
+                            GeglBuffer      *buffer)
+{
+  gint     n_cells;
+  gboolean found = FALSE;
+  gint     i;
+
+  g_return_val_if_fail (summary != NULL, FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+
+  /*  a single valid, non-empty tile answers it without any scanning  */
+  g_mutex_lock (&summary->mutex);
+
+  if (summary->width  == gegl_buffer_get_width  (buffer) &&
+      summary->height == gegl_buffer_get_height (buffer))
+    {
+      n_cells = summary->n_cols * summary->n_rows;
+
+      for (i = 0; i < n_cells && ! found; i++)
+        {
+          if (summary->cells[i].valid &&
+              summary->cells[i].x1 < summary->cells[i].x2)
+            found = TRUE;
+        }
+    }
+
+  g_mutex_unlock (&summary->mutex);
+
+  if (found)
+    return FALSE;
+
+  gimp_mask_summary_update (summary, buffer);
+
+  n_cells = summary->n_cols * summary->n_rows;
+
+  for (i = 0; i < n_cells; i++)
+    {
+      if (summary->cells[i].x1 < summary->cells[i].x2)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_mask_summary_update (GimpMaskSummary *summary,
+                          GeglBuffer      *buffer)
+{
+  UpdateData  data;
+  gint       *indices = NULL;
+  gint        n_cells;
+  gint        n       = 0;
+  gint        i;
+
+  g_mutex_lock (&summary->mutex);
+
+  if (summary->width  != gegl_buffer_get_width  (buffer) ||
+      summary->height != gegl_buffer_get_height (buffer))
+    {
+      summary->width  = gegl_buffer_get_width  (buffer);
+      summary->height = gegl_buffer_get_height (buffer);
+      summary->n_cols = (summary->width  + CELL_SIZE - 1) >> CELL_SHIFT;
+      summary->n_rows = (summary->height + CELL_SIZE - 1) >> CELL_SHIFT;
+
+      g_free (summary->cells);
+      summary->cells = g_new0 (GimpMaskSummaryCell,
+                               summary->n_cols * summary->n_rows);
+    }
+
+  n_cells = summary->n_cols * summary->n_rows;
+
+  for (i = 0; i < n_cells; i++)
+    {
+      if (! summary->cells[i].valid)
+        n++;
+    }
+
+  if (n > 0)
+    {
+      indices = g_new (gint, n);
+
+      /*  the cells are marked valid before they are scanned, so that a
+       *  change during the scan invalidates them again
+       */
+      for (i = 0, n = 0; i < n_cells; i++)
+        {
+          if (! summary->cells[i].valid)
+            {
+              summary->cells[i].valid = TRUE;
+
+              indices[n++] = i;
+            }
+        }
+    }
+
+  g_mutex_unlock (&summary->mutex);
+
+  if (n == 0)
+    return;
+
+  data.summary = summary;
+  data.buffer  = buffer;
+  data.indices = indices;
+
+  gimp_parallel_distribute_range (n, MIN_PARALLEL_SUB_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_mask_summary_update_cells,
+                                  &data);
+
+  g_free (indices);
+}
+
+static void
+gimp_mask_summary_update_cells (gsize       offset,
+                                gsize       size,
+                                UpdateData *data)
+{
+  GimpMaskSummary *summary = data->summary;
+  gfloat          *pixels;
+  gsize            i;
+
+  pixels = g_new (gfloat, CELL_SIZE * CELL_SIZE);
+
+  for (i = offset; i < offset + size; i++)
+    {
+      GimpMaskSummaryCell *cell = &summary->cells[data->indices[i]];
+      GeglRectangle        rect;
+      const gfloat        *row;
+      gint                 y;
+
+      rect.x      = (data->indices[i] % summary->n_cols) << CELL_SHIFT;
+      rect.y      = (data->indices[i] / summary->n_cols) << CELL_SHIFT;
+      rect.width  = MIN (CELL_SIZE, summary->width  - rect.x);
+      rect.height = MIN (CELL_SIZE, summary->height - rect.y);
+
+      gegl_buffer_get (data->buffer, &rect, 1.0,
+                       babl_format ("Y float"), pixels,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      cell->x1 = rect.x + rect.width;
+      cell->y1 = rect.y + rect.height;
+      cell->x2 = rect.x;
+      cell->y2 = rect.y;
+
+      for (y = 0, row = pixels; y < rect.height; y++, row += rect.width)
+        {
+          gint first = 0;
+          gint last  = rect.width - 1;
+
+          while (first < rect.width && ! row[first])
+            first++;
+
+          if (first == rect.width)
+            continue;
+
+          while (! row[last])
+            last--;
+
+          cell->x1 = MIN (cell->x1, rect.x + first);
+          cell->x2 = MAX (cell->x2, rect.x + last + 1);
+          cell->y1 = MIN (cell->y1, rect.y + y);
+          cell->y2 = rect.y + y + 1;
+        }
+    }
+
+  g_free (pixels);
+}
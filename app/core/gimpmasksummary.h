@@ -0,0 +1,42 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpmasksummary.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_MASK_SUMMARY_H__
+#define __GIMP_MASK_SUMMARY_H__
+
+
+GimpMaskSummary * gimp_mask_summary_new         (void);
+void              gimp_mask_summary_free        (GimpMaskSummary     *summary);
+
+gint64            gimp_mask_summary_get_memsize (GimpMaskSummary     *summary);
+
+void              gimp_mask_summary_invalidate  (GimpMaskSummary     *summary,
+                                                 const GeglRectangle *rect);
+
+gboolean          gimp_mask_summary_bounds      (GimpMaskSummary     *summary,
+                                                 GeglBuffer          *buffer,
+                                                 gint                *x1,
+                                                 gint                *y1,
+                                                 gint                *x2,
+                                                 gint                *y2);
+gboolean          gimp_mask_summary_is_empty    (GimpMaskSummary     *summary,
+                                                 GeglBuffer          *buffer);
+
+
+#endif /* __GIMP_MASK_SUMMARY_H__ */
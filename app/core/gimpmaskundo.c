@@ -27,6 +27,7 @@
 #include "gimp-memsize.h"
 #include "gimpchannel.h"
 #include "gimpmaskundo.h"
+#include "gimpspans.h"
 
 
 enum
@@ -105,7 +106,13 @@ gimp_mask_undo_constructed (GObject *object)
   item     = GIMP_ITEM_UNDO (object)->item;
   drawable = GIMP_DRAWABLE (item);
 
-  if (gimp_item_bounds (item, &x, &y, &w, &h))
+  /*  spans are small, and copying them doesn't render the mask  */
+  if (gimp_channel_get_spans (GIMP_CHANNEL (item)))
+    {
+      mask_undo->spans =
+        gimp_spans_copy (gimp_channel_get_spans (GIMP_CHANNEL (item)));
+    }
+  else if (gimp_item_bounds (item, &x, &y, &w, &h))
     {
       mask_undo->buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, w, h),
                                            gimp_drawable_get_format (drawable));
@@ -172,6 +179,9 @@ gimp_mask_undo_get_memsize (GimpObject *object,
 
   memsize += gimp_gegl_buffer_get_memsize (mask_undo->buffer);
 
+  if (mask_undo->spans)
+    memsize += gimp_spans_get_memsize (mask_undo->spans);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -185,7 +195,8 @@ gimp_mask_undo_pop (GimpUndo            *undo,
   GimpItem     *item      = GIMP_ITEM_UNDO (undo)->item;
   GimpDrawable *drawable  = GIMP_DRAWABLE (item);
   GimpChannel  *channel   = GIMP_CHANNEL (item);
-  GeglBuffer   *new_buffer;
+  GeglBuffer   *new_buffer = NULL;
+  GimpSpans    *new_spans  = NULL;
   const Babl   *format;
   gint          x, y, w, h;
   gint          width  = 0;
@@ -193,7 +204,14 @@ gimp_mask_undo_pop (GimpUndo            *undo,
 
   GIMP_UNDO_CLASS (parent_class)->pop (undo, undo_mode, accum);
 
-  if (gimp_item_bounds (item, &x, &y, &w, &h))
+  if (gimp_channel_get_spans (channel))
+    {
+      new_spans = gimp_spans_copy (gimp_channel_get_spans (channel));
+
+      x = 0;
+      y = 0;
+    }
+  else if (gimp_item_bounds (item, &x, &y, &w, &h))
     {
       new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, w, h),
                                     gimp_drawable_get_format (drawable));
@@ -207,10 +225,6 @@ gimp_mask_undo_pop (GimpUndo            *undo,
       gegl_buffer_clear (gimp_drawable_get_buffer (drawable),
                          GEGL_RECTANGLE (x, y, w, h));
     }
-  else
-    {
-      new_buffer = NULL;
-    }
 
   format = gimp_drawable_get_format (drawable);
 
@@ -228,6 +242,32 @@ gimp_mask_undo_pop (GimpUndo            *undo,
       g_object_unref (buffer);
     }
 
+  if (mask_undo->spans)
+    {
+      /*  the spans know their bounds, and render the whole buffer  */
+      gimp_channel_set_spans (channel, mask_undo->spans);
+
+      mask_undo->spans  = new_spans;
+      mask_undo->buffer = new_buffer;
+      mask_undo->x      = x;
+      mask_undo->y      = y;
+      mask_undo->format = format;
+
+      gimp_drawable_update (drawable, 0, 0, -1, -1);
+
+      return;
+    }
+
+  /*  the current spans were never cleared from the buffer, empty
+   *  spans clear it without rendering them first
+   */
+  if (gimp_channel_get_spans (channel))
+    {
+      gimp_channel_set_spans (channel,
+                              gimp_spans_new (gimp_item_get_width  (item),
+                                              gimp_item_get_height (item)));
+    }
+
   if (mask_undo->buffer)
     {
       width  = gegl_buffer_get_width  (mask_undo->buffer);
@@ -266,6 +306,7 @@ gimp_mask_undo_pop (GimpUndo            *undo,
   channel->bounds_known = TRUE;
 
   /*  set the new mask undo parameters  */
+  mask_undo->spans  = new_spans;
   mask_undo->buffer = new_buffer;
   mask_undo->x      = x;
   mask_undo->y      = y;
@@ -281,6 +322,7 @@ gimp_mask_undo_free (GimpUndo     *undo,
   GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
 
   g_clear_object (&mask_undo->buffer);
+  g_clear_pointer (&mask_undo->spans, gimp_spans_free);
 
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
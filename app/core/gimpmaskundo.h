@@ -40,6 +40,7 @@ struct _GimpMaskUndo
   gboolean      convert_format;
 
   GeglBuffer   *buffer;
+  GimpSpans    *spans;
   gint          x;
   gint          y;
   const Babl   *format;
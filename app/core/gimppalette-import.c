@@ -52,11 +52,9 @@ gimp_palette_import_from_gradient (GimpGradient *gradient,
                                    const gchar  *palette_name,
                                    gint          n_colors)
 {
-  GimpPalette         *palette;
-  GimpGradientSegment *seg = NULL;
-  gdouble              dx, cur_x;
-  GimpRGB              color;
-  gint                 i;
+  GimpPalette *palette;
+  GimpRGB     *colors;
+  gint         i;
 
   g_return_val_if_fail (GIMP_IS_GRADIENT (gradient), NULL);
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
@@ -65,14 +63,15 @@ gimp_palette_import_from_gradient (GimpGradient *gradient,
 
   palette = GIMP_PALETTE (gimp_palette_new (context, palette_name));
 
-  dx = 1.0 / (n_colors - 1);
+  colors = g_new (GimpRGB, n_colors);
 
-  for (i = 0, cur_x = 0; i < n_colors; i++, cur_x += dx)
-    {
-      seg = gimp_gradient_get_color_at (gradient, context,
-                                        seg, cur_x, reverse, &color);
-      gimp_palette_add_entry (palette, -1, NULL, &color);
-    }
+  gimp_gradient_get_uniform_colors (gradient, context, 0.0, 1.0,
+                                    n_colors, reverse, colors);
+
+  for (i = 0; i < n_colors; i++)
+    gimp_palette_add_entry (palette, -1, NULL, &colors[i]);
+
+  g_free (colors);
 
   return palette;
 }
@@ -24,7 +24,10 @@
 
 #include "core-types.h"
 
+#include "gegl/gimptilehandlervalidate.h"
+
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpimage.h"
 #include "gimppickable.h"
 #include "gimppickable-auto-shrink.h"
@@ -42,6 +45,43 @@ typedef gboolean (* ColorsEqualFunc) (guchar *col1,
                                       guchar *col2);
 
 
+/*  the area to shrink is split into blocks, whose contents are only
+ *  scanned once: the bounding box of the pixels in a block which differ
+ *  from the background is kept, and is what the passes from the other
+ *  edges look at when they reach the block.  the blocks of a row or
+ *  column are scanned on several threads at once.
+ */
+#define AUTO_SHRINK_BLOCK_SIZE 64
+
+typedef enum
+{
+  AUTO_SHRINK_BLOCK_UNKNOWN,
+  AUTO_SHRINK_BLOCK_EMPTY,
+  AUTO_SHRINK_BLOCK_CONTENT
+} AutoShrinkBlockState;
+
+typedef struct
+{
+  AutoShrinkBlockState state;
+  GeglRectangle        rect;    /*  the block's area                   */
+  GeglRectangle        bounds;  /*  its content's bounds, if CONTENT   */
+} AutoShrinkBlock;
+
+typedef struct
+{
+  GeglBuffer       *buffer;
+  ColorsEqualFunc   colors_equal_func;
+  guchar           *bgcolor;
+  AutoShrinkBlock  *blocks;
+  gint              n_blocks_x;
+  gint              n_blocks_y;
+  AutoShrinkBlock **queue;
+  gint              n_queued;
+  gint              next_queued;
+  gboolean          parallel;
+} AutoShrinkData;
+
+
 /*  local function prototypes  */
 
 static AutoShrinkType   gimp_pickable_guess_bgcolor (GimpPickable *pickable,
@@ -55,6 +95,26 @@ static gboolean         gimp_pickable_colors_equal  (guchar       *col1,
 static gboolean         gimp_pickable_colors_alpha  (guchar       *col1,
                                                      guchar       *col2);
 
+static void       gimp_pickable_auto_shrink_scan_block (AutoShrinkData  *data,
+                                                        AutoShrinkBlock *block,
+                                                        guchar          *buf);
+static void       gimp_pickable_auto_shrink_scan_func  (gint             i,
+                                                        gint             n,
+                                                        AutoShrinkData  *data);
+static gboolean   gimp_pickable_auto_shrink_scan       (AutoShrinkData  *data,
+                                                        gint             bx1,
+                                                        gint             by1,
+                                                        gint             bx2,
+                                                        gint             by2,
+                                                        GeglRectangle   *bounds);
+static gboolean   gimp_pickable_auto_shrink_bounds     (GeglBuffer      *buffer,
+                                                        ColorsEqualFunc  colors_equal_func,
+                                                        guchar          *bgcolor,
+                                                        gint            *x1,
+                                                        gint            *y1,
+                                                        gint            *x2,
+                                                        gint            *y2);
+
 
 /*  public functions  */
 
@@ -70,14 +130,9 @@ gimp_pickable_auto_shrink (GimpPickable *pickable,
                            gint         *shrunk_height)
 {
   GeglBuffer      *buffer;
-  GeglRectangle    rect;
   ColorsEqualFunc  colors_equal_func;
   guchar           bgcolor[MAX_CHANNELS] = { 0, 0, 0, 0 };
-  guchar          *buf = NULL;
   gint             x1, y1, x2, y2;
-  gint             width, height;
-  const Babl      *format;
-  gint             x, y, abort;
   GimpAutoShrink   retval = GIMP_AUTO_SHRINK_UNSHRINKABLE;
 
   g_return_val_if_fail (GIMP_IS_PICKABLE (pickable), FALSE);
@@ -109,8 +164,6 @@ gimp_pickable_auto_shrink (GimpPickable *pickable,
   *shrunk_width  = x2 - x1;
   *shrunk_height = y2 - y1;
 
-  format = babl_format ("R'G'B'A u8");
-
   switch (gimp_pickable_guess_bgcolor (pickable, bgcolor,
                                        x1, x2 - 1, y1, y2 - 1))
     {
@@ -125,90 +178,16 @@ gimp_pickable_auto_shrink (GimpPickable *pickable,
       break;
     }
 
-  width  = x2 - x1;
-  height = y2 - y1;
-
-  /* The following could be optimized further by processing
-   * the smaller side first instead of defaulting to width    --Sven
+  /*  Find the bounding box of the pixels which differ from the
+   *  background, scanning blocks inward from each edge, see
+   *  AutoShrinkBlock.
    */
-
-  buf = g_malloc (MAX (width, height) * 4);
-
-  /* Check how many of the top lines are uniform/transparent. */
-  rect.x      = x1;
-  rect.y      = 0;
-  rect.width  = width;
-  rect.height = 1;
-
-  abort = FALSE;
-  for (y = y1; y < y2 && !abort; y++)
-    {
-      rect.y = y;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (x = 0; x < width && !abort; x++)
-        abort = ! colors_equal_func (bgcolor, buf + x * 4);
-    }
-  if (y == y2 && !abort)
+  if (! gimp_pickable_auto_shrink_bounds (buffer, colors_equal_func, bgcolor,
+                                          &x1, &y1, &x2, &y2))
     {
       retval = GIMP_AUTO_SHRINK_EMPTY;
       goto FINISH;
     }
-  y1 = y - 1;
-
-  /* Check how many of the bottom lines are uniform/transparent. */
-  rect.x      = x1;
-  rect.y      = 0;
-  rect.width  = width;
-  rect.height = 1;
-
-  abort = FALSE;
-  for (y = y2; y > y1 && !abort; y--)
-    {
-      rect.y = y - 1;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (x = 0; x < width && !abort; x++)
-        abort = ! colors_equal_func  (bgcolor, buf + x * 4);
-    }
-  y2 = y + 1;
-
-  /* compute a new height for the next operations */
-  height = y2 - y1;
-
-  /* Check how many of the left lines are uniform/transparent. */
-  rect.x      = 0;
-  rect.y      = y1;
-  rect.width  = 1;
-  rect.height = height;
-
-  abort = FALSE;
-  for (x = x1; x < x2 && !abort; x++)
-    {
-      rect.x = x;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (y = 0; y < height && !abort; y++)
-        abort = ! colors_equal_func (bgcolor, buf + y * 4);
-    }
-  x1 = x - 1;
-
-  /* Check how many of the right lines are uniform/transparent. */
-  rect.x      = 0;
-  rect.y      = y1;
-  rect.width  = 1;
-  rect.height = height;
-
-  abort = FALSE;
-  for (x = x2; x > x1 && !abort; x--)
-    {
-      rect.x = x - 1;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (y = 0; y < height && !abort; y++)
-        abort = ! colors_equal_func (bgcolor, buf + y * 4);
-    }
-  x2 = x + 1;
 
   if (x1      != start_x     ||
       y1      != start_y     ||
@@ -225,7 +204,6 @@ gimp_pickable_auto_shrink (GimpPickable *pickable,
 
  FINISH:
 
-  g_free (buf);
   gimp_unset_busy (gimp_pickable_get_image (pickable)->gimp);
 
   return retval;
@@ -310,3 +288,246 @@ gimp_pickable_colors_alpha (guchar *dummy,
 {
   return (col[ALPHA] == 0);
 }
+
+/*  computes the bounds of the pixels of 'block' which differ from the
+ *  background.  'buf' has room for a block of R'G'B'A u8 pixels.
+ */
+static void
+gimp_pickable_auto_shrink_scan_block (AutoShrinkData  *data,
+                                      AutoShrinkBlock *block,
+                                      guchar          *buf)
+{
+  const GeglRectangle *rect = &block->rect;
+  gint                 x1   = rect->width;
+  gint                 y1   = rect->height;
+  gint                 x2   = 0;
+  gint                 y2   = 0;
+  gint                 x, y;
+
+  gegl_buffer_get (data->buffer, rect, 1.0, babl_format ("R'G'B'A u8"), buf,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (y = 0; y < rect->height; y++)
+    {
+      guchar *row = buf + y * rect->width * 4;
+
+      for (x = 0; x < rect->width; x++)
+        {
+          if (! data->colors_equal_func (data->bgcolor, row + x * 4))
+            {
+              x1 = MIN (x1, x);
+              break;
+            }
+        }
+
+      if (x == rect->width)
+        continue;
+
+      for (x = rect->width - 1; x >= x1; x--)
+        {
+          if (! data->colors_equal_func (data->bgcolor, row + x * 4))
+            {
+              x2 = MAX (x2, x + 1);
+              break;
+            }
+        }
+
+      y1 = MIN (y1, y);
+      y2 = y + 1;
+    }
+
+  if (y2 > y1)
+    {
+      block->state  = AUTO_SHRINK_BLOCK_CONTENT;
+      block->bounds = *GEGL_RECTANGLE (rect->x + x1, rect->y + y1,
+                                       x2 - x1,      y2 - y1);
+    }
+  else
+    {
+      block->state = AUTO_SHRINK_BLOCK_EMPTY;
+    }
+}
+
+static void
+gimp_pickable_auto_shrink_scan_func (gint            i,
+                                     gint            n,
+                                     AutoShrinkData *data)
+{
+  guchar *buf = g_malloc (AUTO_SHRINK_BLOCK_SIZE * AUTO_SHRINK_BLOCK_SIZE * 4);
+  gint    index;
+
+  while ((index = g_atomic_int_add (&data->next_queued, 1)) < data->n_queued)
+    gimp_pickable_auto_shrink_scan_block (data, data->queue[index], buf);
+
+  g_free (buf);
+}
+
+/*  scans the blocks from 'bx1', 'by1' to 'bx2', 'by2' which haven't
+ *  been scanned yet, and returns the union of their contents' bounds,
+ *  if any
+ */
+static gboolean
+gimp_pickable_auto_shrink_scan (AutoShrinkData *data,
+                                gint            bx1,
+                                gint            by1,
+                                gint            bx2,
+                                gint            by2,
+                                GeglRectangle  *bounds)
+{
+  gboolean found = FALSE;
+  gint     bx, by;
+
+  data->n_queued    = 0;
+  data->next_queued = 0;
+
+  for (by = by1; by < by2; by++)
+    for (bx = bx1; bx < bx2; bx++)
+      {
+        AutoShrinkBlock *block = &data->blocks[by * data->n_blocks_x + bx];
+
+        if (block->state == AUTO_SHRINK_BLOCK_UNKNOWN)
+          data->queue[data->n_queued++] = block;
+      }
+
+  if (data->n_queued > 0)
+    {
+      gimp_parallel_distribute (data->parallel ?
+                                MIN (data->n_queued,
+                                     gimp_parallel_get_n_threads ()) : 1,
+                                (GimpParallelDistributeFunc)
+                                gimp_pickable_auto_shrink_scan_func,
+                                data);
+    }
+
+  for (by = by1; by < by2; by++)
+    for (bx = bx1; bx < bx2; bx++)
+      {
+        AutoShrinkBlock *block = &data->blocks[by * data->n_blocks_x + bx];
+
+        if (block->state == AUTO_SHRINK_BLOCK_CONTENT)
+          {
+            if (found)
+              gegl_rectangle_bounding_box (bounds, bounds, &block->bounds);
+            else
+              *bounds = block->bounds;
+
+            found = TRUE;
+          }
+      }
+
+  return found;
+}
+
+/*  shrinks 'x1', 'y1', 'x2', 'y2' to the bounds of the pixels of
+ *  'buffer' which differ from the background, and returns FALSE if
+ *  there are none
+ */
+static gboolean
+gimp_pickable_auto_shrink_bounds (GeglBuffer      *buffer,
+                                  ColorsEqualFunc  colors_equal_func,
+                                  guchar          *bgcolor,
+                                  gint            *x1,
+                                  gint            *y1,
+                                  gint            *x2,
+                                  gint            *y2)
+{
+  AutoShrinkData data;
+  GeglRectangle  bounds;
+  gint           top, bottom;
+  gint           left, right;
+  gint           bx, by;
+
+  if (*x2 <= *x1 || *y2 <= *y1)
+    return FALSE;
+
+  data.buffer            = buffer;
+  data.colors_equal_func = colors_equal_func;
+  data.bgcolor           = bgcolor;
+  data.n_blocks_x        = (*x2 - *x1 + AUTO_SHRINK_BLOCK_SIZE - 1) /
+                           AUTO_SHRINK_BLOCK_SIZE;
+  data.n_blocks_y        = (*y2 - *y1 + AUTO_SHRINK_BLOCK_SIZE - 1) /
+                           AUTO_SHRINK_BLOCK_SIZE;
+  data.blocks            = g_new (AutoShrinkBlock,
+                                  data.n_blocks_x * data.n_blocks_y);
+  data.queue             = g_new (AutoShrinkBlock *,
+                                  data.n_blocks_x * data.n_blocks_y);
+
+  /*  buffers which render their tiles when they are accessed, like the
+   *  projection, can't be read on several threads at once
+   */
+  data.parallel = ! gimp_tile_handler_validate_get_assigned (buffer);
+
+  for (by = 0; by < data.n_blocks_y; by++)
+    for (bx = 0; bx < data.n_blocks_x; bx++)
+      {
+        AutoShrinkBlock *block = &data.blocks[by * data.n_blocks_x + bx];
+        gint             x     = *x1 + bx * AUTO_SHRINK_BLOCK_SIZE;
+        gint             y     = *y1 + by * AUTO_SHRINK_BLOCK_SIZE;
+
+        block->state = AUTO_SHRINK_BLOCK_UNKNOWN;
+        block->rect  = *GEGL_RECTANGLE (x, y,
+                                        MIN (AUTO_SHRINK_BLOCK_SIZE, *x2 - x),
+                                        MIN (AUTO_SHRINK_BLOCK_SIZE, *y2 - y));
+      }
+
+  /*  the first row of blocks from the top with content gives the top
+   *  edge, and so on.  all content lies between the top and bottom
+   *  rows of blocks, so the left and right passes only scan those
+   */
+  for (top = 0; top < data.n_blocks_y; top++)
+    {
+      if (gimp_pickable_auto_shrink_scan (&data,
+                                          0, top, data.n_blocks_x, top + 1,
+                                          &bounds))
+        {
+          *y1 = bounds.y;
+          break;
+        }
+    }
+
+  if (top == data.n_blocks_y)
+    {
+      g_free (data.blocks);
+      g_free (data.queue);
+
+      return FALSE;
+    }
+
+  for (bottom = data.n_blocks_y - 1; bottom >= top; bottom--)
+    {
+      if (gimp_pickable_auto_shrink_scan (&data,
+                                          0, bottom, data.n_blocks_x, bottom + 1,
+                                          &bounds))
+        {
+          *y2 = bounds.y + bounds.height;
+          break;
+        }
+    }
+
+  for (left = 0; left < data.n_blocks_x; left++)
+    {
+      if (gimp_pickable_auto_shrink_scan (&data,
+                                          left, top, left + 1, bottom + 1,
+                                          &bounds))
+        {
+          *x1 = bounds.x;
+          break;
+        }
+    }
+
+  for (right = data.n_blocks_x - 1; right >= left; right--)
+    {
+      if (gimp_pickable_auto_shrink_scan (&data,
+                                          right, top, right + 1, bottom + 1,
+                                          &bounds))
+        {
+          *x2 = bounds.x + bounds.width;
+          break;
+        }
+    }
+
+  g_free (data.blocks);
+  g_free (data.queue);
+
+  return TRUE;
+}
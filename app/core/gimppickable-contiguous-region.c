@@ -30,18 +30,90 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimp-utils.h" /* GIMP_TIMER */
 #include "gimppickable.h"
 #include "gimppickable-contiguous-region.h"
 
 
+/*  the source is read, and its difference to the seed color computed,
+ *  one whole tile at a time, the first time the fill reaches the tile
+ */
+#define TILE_SHIFT 6
+#define TILE_SIZE  (1 << TILE_SHIFT)
+#define TILE_MASK  (TILE_SIZE - 1)
+
+/*  at most this many tiles are kept in memory, about 32 MB with their
+ *  masks.  the oldest ones make room for new ones: their differences
+ *  are dropped and computed again if the fill comes back, and their
+ *  masks are stored in the mask buffer and read back from there
+ */
+#define MAX_CACHED_TILES 1024
+
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
+typedef struct
+{
+  gint y;
+  gint old_y;
+  gint start;
+  gint end;
+} Segment;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  GeglBuffer          *mask_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  gboolean             antialias;
+  gfloat               threshold;
+  const gfloat        *col;
+
+  gint                 width;
+  gint                 height;
+  gint                 n_tile_cols;
+  gint                 n_tile_rows;
+
+  gfloat             **diff_tiles;
+  gfloat             **mask_tiles;
+  gboolean            *mask_stored;
+
+  gint                 cached_tiles[MAX_CACHED_TILES];
+  gint                 first_cached_tile;
+  gint                 n_cached_tiles;
+
+  gint                 fetch_tiles[9];
+  gint                 n_fetch_tiles;
+} ContiguousRegion;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  GeglBuffer          *mask_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  gboolean             antialias;
+  gfloat               threshold;
+  const gfloat        *col;
+} ByColorData;
+
+
 /*  local function prototypes  */
 
 static const Babl * choose_format         (GeglBuffer          *buffer,
                                            GimpSelectCriterion  select_criterion,
                                            gint                *n_components,
                                            gboolean            *has_alpha);
-static gfloat   pixel_difference          (const gfloat        *col1,
+static inline gfloat
+                pixel_difference          (const gfloat        *col1,
                                            const gfloat        *col2,
                                            gboolean             antialias,
                                            gfloat               threshold,
@@ -49,7 +121,26 @@ static gfloat   pixel_difference          (const gfloat        *col1,
                                            gboolean             has_alpha,
                                            gboolean             select_transparent,
                                            GimpSelectCriterion  select_criterion);
-static void     push_segment              (GQueue              *segment_queue,
+static void     pixel_difference_row      (const gfloat        *col,
+                                           const gfloat        *src,
+                                           gfloat              *dest,
+                                           gint                 n_pixels,
+                                           gboolean             antialias,
+                                           gfloat               threshold,
+                                           gint                 n_components,
+                                           gboolean             has_alpha,
+                                           gboolean             select_transparent,
+                                           GimpSelectCriterion  select_criterion);
+static void     by_color_area             (const GeglRectangle *area,
+                                           ByColorData         *data);
+static void     compute_tiles             (gint                 i,
+                                           gint                 n,
+                                           ContiguousRegion    *region);
+static void     uncache_tile              (ContiguousRegion    *region);
+static void     fetch_tiles               (ContiguousRegion    *region,
+                                           gint                 tile_x,
+                                           gint                 tile_y);
+static void     push_segment              (GArray              *segment_stack,
                                            gint                 y,
                                            gint                 old_y,
                                            gint                 start,
@@ -57,28 +148,16 @@ static void     push_segment              (GQueue              *segment_queue,
                                            gint                 new_y,
                                            gint                 new_start,
                                            gint                 new_end);
-static void     pop_segment               (GQueue              *segment_queue,
+static void     pop_segment               (GArray              *segment_stack,
                                            gint                *y,
                                            gint                *old_y,
                                            gint                *start,
                                            gint                *end);
-static gboolean find_contiguous_segment   (const gfloat        *col,
-                                           GeglBuffer          *src_buffer,
-                                           GeglBuffer          *mask_buffer,
-                                           const Babl          *src_format,
-                                           const Babl          *mask_format,
-                                           gint                 n_components,
-                                           gboolean             has_alpha,
-                                           gint                 width,
-                                           gboolean             select_transparent,
-                                           GimpSelectCriterion  select_criterion,
-                                           gboolean             antialias,
-                                           gfloat               threshold,
+static gboolean find_contiguous_segment   (ContiguousRegion    *region,
                                            gint                 initial_x,
                                            gint                 initial_y,
                                            gint                *start,
-                                           gint                *end,
-                                           gfloat              *row);
+                                           gint                *end);
 static void     find_contiguous_region    (GeglBuffer          *src_buffer,
                                            GeglBuffer          *mask_buffer,
                                            const Babl          *format,
@@ -91,11 +170,16 @@ static void     find_contiguous_region    (GeglBuffer          *src_buffer,
                                            gboolean             diagonal_neighbors,
                                            gint                 x,
                                            gint                 y,
-                                           const gfloat        *col);
+                                           const gfloat        *col,
+                                           GeglRectangle       *bounds);
 
 
 /*  public functions  */
 
+/*  @mask_bounds, if not NULL, returns the bounds of the region, which
+ *  are tracked while filling, so callers don't need to scan the whole
+ *  mask for them.  They are empty if nothing was selected.
+ */
 GeglBuffer *
 gimp_pickable_contiguous_region_by_seed (GimpPickable        *pickable,
                                          gboolean             antialias,
@@ -104,12 +188,14 @@ gimp_pickable_contiguous_region_by_seed (GimpPickable        *pickable,
                                          GimpSelectCriterion  select_criterion,
                                          gboolean             diagonal_neighbors,
                                          gint                 x,
-                                         gint                 y)
+                                         gint                 y,
+                                         GeglRectangle       *mask_bounds)
 {
   GeglBuffer    *src_buffer;
   GeglBuffer    *mask_buffer;
   const Babl    *format;
   GeglRectangle  extent;
+  GeglRectangle  bounds = { 0, };
   gint           n_components;
   gboolean       has_alpha;
   gfloat         start_col[MAX_CHANNELS];
@@ -155,11 +241,14 @@ gimp_pickable_contiguous_region_by_seed (GimpPickable        *pickable,
                               format, n_components, has_alpha,
                               select_transparent, select_criterion,
                               antialias, threshold, diagonal_neighbors,
-                              x, y, start_col);
+                              x, y, start_col, &bounds);
 
       GIMP_TIMER_END("foo");
     }
 
+  if (mask_bounds)
+    *mask_bounds = bounds;
+
   return mask_buffer;
 }
 
@@ -177,13 +266,13 @@ gimp_pickable_contiguous_region_by_color (GimpPickable        *pickable,
    *  fuzzy_select.  Modify the pickable's mask to reflect the
    *  additional selection
    */
-  GeglBufferIterator *iter;
-  GeglBuffer         *src_buffer;
-  GeglBuffer         *mask_buffer;
-  const Babl         *format;
-  gint                n_components;
-  gboolean            has_alpha;
-  gfloat              start_col[MAX_CHANNELS];
+  GeglBuffer  *src_buffer;
+  GeglBuffer  *mask_buffer;
+  const Babl  *format;
+  gint         n_components;
+  gboolean     has_alpha;
+  gfloat       start_col[MAX_CHANNELS];
+  ByColorData  data;
 
   g_return_val_if_fail (GIMP_IS_PICKABLE (pickable), NULL);
   g_return_val_if_fail (color != NULL, NULL);
@@ -215,35 +304,22 @@ gimp_pickable_contiguous_region_by_color (GimpPickable        *pickable,
   mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
                                  babl_format ("Y float"));
 
-  iter = gegl_buffer_iterator_new (src_buffer,
-                                   NULL, 0, format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-
-  gegl_buffer_iterator_add (iter, mask_buffer,
-                            NULL, 0, babl_format ("Y float"),
-                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *src   = iter->data[0];
-      gfloat       *dest  = iter->data[1];
-      gint          count = iter->length;
-
-      while (count--)
-        {
-          /*  Find how closely the colors match  */
-          *dest = pixel_difference (start_col, src,
-                                    antialias,
-                                    threshold,
-                                    n_components,
-                                    has_alpha,
-                                    select_transparent,
-                                    select_criterion);
-
-          src  += n_components;
-          dest += 1;
-        }
-    }
+  data.src_buffer         = src_buffer;
+  data.mask_buffer        = mask_buffer;
+  data.format             = format;
+  data.n_components       = n_components;
+  data.has_alpha          = has_alpha;
+  data.select_transparent = select_transparent;
+  data.select_criterion   = select_criterion;
+  data.antialias          = antialias;
+  data.threshold          = threshold;
+  data.col                = start_col;
+
+  gimp_parallel_distribute_area (gegl_buffer_get_extent (src_buffer),
+                                 MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 by_color_area,
+                                 &data);
 
   return mask_buffer;
 }
@@ -304,7 +380,7 @@ choose_format (GeglBuffer          *buffer,
   return format;
 }
 
-static gfloat
+static inline gfloat
 pixel_difference (const gfloat        *col1,
                   const gfloat        *col2,
                   gboolean             antialias,
@@ -407,8 +483,269 @@ pixel_difference (const gfloat        *col1,
     }
 }
 
+/*  there is one loop for each criterion, in which pixel_difference()
+ *  is inlined with the criterion known, so that the compiler can drop
+ *  the criterion switch from the loop, and vectorize it
+ */
+#define PIXEL_DIFFERENCE_ROW_CASE(criterion)                           \
+    case criterion:                                                    \
+      for (i = 0; i < n_pixels; i++)                                   \
+        {                                                              \
+          dest[i] = pixel_difference (col, src + i * n_components,     \
+                                      antialias, threshold,            \
+                                      n_components, has_alpha,         \
+                                      select_transparent, criterion);  \
+        }                                                              \
+      break
+
+static void
+pixel_difference_row (const gfloat        *col,
+                      const gfloat        *src,
+                      gfloat              *dest,
+                      gint                 n_pixels,
+                      gboolean             antialias,
+                      gfloat               threshold,
+                      gint                 n_components,
+                      gboolean             has_alpha,
+                      gboolean             select_transparent,
+                      GimpSelectCriterion  select_criterion)
+{
+  gint i;
+
+  switch (select_criterion)
+    {
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_COMPOSITE);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_R);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_G);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_B);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_A);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_H);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_S);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_V);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_LCH_L);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_LCH_C);
+    PIXEL_DIFFERENCE_ROW_CASE (GIMP_SELECT_CRITERION_LCH_H);
+    }
+}
+
+#undef PIXEL_DIFFERENCE_ROW_CASE
+
+static void
+by_color_area (const GeglRectangle *area,
+               ByColorData         *data)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (data->src_buffer,
+                                   area, 0, data->format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, data->mask_buffer,
+                            area, 0, babl_format ("Y float"),
+                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      /*  Find how closely the colors match  */
+      pixel_difference_row (data->col, iter->data[0], iter->data[1],
+                            iter->length,
+                            data->antialias,
+                            data->threshold,
+                            data->n_components,
+                            data->has_alpha,
+                            data->select_transparent,
+                            data->select_criterion);
+    }
+}
+
+/*  computes the difference to the seed color of every pixel of the
+ *  tiles in region->fetch_tiles, and reads back their stored masks.
+ *  the tiles are independent, so this runs in parallel.
+ */
 static void
-push_segment (GQueue *segment_queue,
+compute_tiles (gint              i,
+               gint              n,
+               ContiguousRegion *region)
+{
+  gfloat *src = g_new (gfloat, TILE_SIZE * TILE_SIZE * region->n_components);
+  gint    t;
+
+  for (t = i; t < region->n_fetch_tiles; t += n)
+    {
+      gint           tile   = region->fetch_tiles[t];
+      gfloat        *diff   = g_new (gfloat, TILE_SIZE * TILE_SIZE);
+      GeglRectangle  rect;
+      gint           y;
+
+      rect.x      = (tile % region->n_tile_cols) * TILE_SIZE;
+      rect.y      = (tile / region->n_tile_cols) * TILE_SIZE;
+      rect.width  = MIN (TILE_SIZE, region->width  - rect.x);
+      rect.height = MIN (TILE_SIZE, region->height - rect.y);
+
+      gegl_buffer_get (region->src_buffer, &rect, 1.0, region->format,
+                       src,
+                       TILE_SIZE * region->n_components * sizeof (gfloat),
+                       GEGL_ABYSS_NONE);
+
+      for (y = 0; y < rect.height; y++)
+        {
+          pixel_difference_row (region->col,
+                                src  + y * TILE_SIZE * region->n_components,
+                                diff + y * TILE_SIZE,
+                                rect.width,
+                                region->antialias,
+                                region->threshold,
+                                region->n_components,
+                                region->has_alpha,
+                                region->select_transparent,
+                                region->select_criterion);
+        }
+
+      region->diff_tiles[tile] = diff;
+
+      if (region->mask_stored[tile])
+        {
+          gfloat *mask = g_new (gfloat, TILE_SIZE * TILE_SIZE);
+
+          gegl_buffer_get (region->mask_buffer, &rect, 1.0,
+                           babl_format ("Y float"),
+                           mask, TILE_SIZE * sizeof (gfloat),
+                           GEGL_ABYSS_NONE);
+
+          region->mask_tiles[tile] = mask;
+        }
+    }
+
+  g_free (src);
+}
+
+/*  drops the oldest cached tile, storing its mask in the mask buffer  */
+static void
+uncache_tile (ContiguousRegion *region)
+{
+  gint tile = region->cached_tiles[region->first_cached_tile];
+
+  region->first_cached_tile = (region->first_cached_tile + 1) %
+                              MAX_CACHED_TILES;
+  region->n_cached_tiles--;
+
+  if (region->mask_tiles[tile])
+    {
+      GeglRectangle rect;
+
+      rect.x      = (tile % region->n_tile_cols) * TILE_SIZE;
+      rect.y      = (tile / region->n_tile_cols) * TILE_SIZE;
+      rect.width  = MIN (TILE_SIZE, region->width  - rect.x);
+      rect.height = MIN (TILE_SIZE, region->height - rect.y);
+
+      gegl_buffer_set (region->mask_buffer, &rect, 0,
+                       babl_format ("Y float"),
+                       region->mask_tiles[tile],
+                       TILE_SIZE * sizeof (gfloat));
+
+      g_clear_pointer (&region->mask_tiles[tile], g_free);
+
+      region->mask_stored[tile] = TRUE;
+    }
+
+  g_clear_pointer (&region->diff_tiles[tile], g_free);
+}
+
+/*  fetches the tile at (tile_x, tile_y), together with the neighboring
+ *  tiles which weren't fetched yet, since the fill is likely to reach
+ *  them next
+ */
+static void
+fetch_tiles (ContiguousRegion *region,
+             gint              tile_x,
+             gint              tile_y)
+{
+  gint x, y;
+  gint i;
+
+  region->n_fetch_tiles = 0;
+
+  for (y = MAX (tile_y - 1, 0);
+       y <= MIN (tile_y + 1, region->n_tile_rows - 1);
+       y++)
+    {
+      for (x = MAX (tile_x - 1, 0);
+           x <= MIN (tile_x + 1, region->n_tile_cols - 1);
+           x++)
+        {
+          gint tile = y * region->n_tile_cols + x;
+
+          if (! region->diff_tiles[tile])
+            region->fetch_tiles[region->n_fetch_tiles++] = tile;
+        }
+    }
+
+  while (region->n_cached_tiles + region->n_fetch_tiles > MAX_CACHED_TILES)
+    uncache_tile (region);
+
+  for (i = 0; i < region->n_fetch_tiles; i++)
+    {
+      region->cached_tiles[(region->first_cached_tile +
+                            region->n_cached_tiles) % MAX_CACHED_TILES] =
+        region->fetch_tiles[i];
+
+      region->n_cached_tiles++;
+    }
+
+  gimp_parallel_distribute (region->n_fetch_tiles,
+                            (GimpParallelDistributeFunc) compute_tiles,
+                            region);
+}
+
+static inline gfloat
+get_diff (ContiguousRegion *region,
+          gint              x,
+          gint              y)
+{
+  gint tile = (y >> TILE_SHIFT) * region->n_tile_cols + (x >> TILE_SHIFT);
+
+  if (G_UNLIKELY (! region->diff_tiles[tile]))
+    fetch_tiles (region, x >> TILE_SHIFT, y >> TILE_SHIFT);
+
+  return region->diff_tiles[tile][((y & TILE_MASK) << TILE_SHIFT) +
+                                  (x & TILE_MASK)];
+}
+
+static inline gfloat
+get_mask (ContiguousRegion *region,
+          gint              x,
+          gint              y)
+{
+  gint tile = (y >> TILE_SHIFT) * region->n_tile_cols + (x >> TILE_SHIFT);
+
+  /*  a stored mask is read back along with the tile  */
+  if (G_UNLIKELY (! region->diff_tiles[tile] && region->mask_stored[tile]))
+    fetch_tiles (region, x >> TILE_SHIFT, y >> TILE_SHIFT);
+
+  if (! region->mask_tiles[tile])
+    return 0.0;
+
+  return region->mask_tiles[tile][((y & TILE_MASK) << TILE_SHIFT) +
+                                  (x & TILE_MASK)];
+}
+
+static inline void
+set_mask (ContiguousRegion *region,
+          gint              x,
+          gint              y,
+          gfloat            value)
+{
+  gint tile = (y >> TILE_SHIFT) * region->n_tile_cols + (x >> TILE_SHIFT);
+
+  if (G_UNLIKELY (! region->mask_tiles[tile]))
+    region->mask_tiles[tile] = g_new0 (gfloat, TILE_SIZE * TILE_SIZE);
+
+  region->mask_tiles[tile][((y & TILE_MASK) << TILE_SHIFT) +
+                           (x & TILE_MASK)] = value;
+}
+
+static void
+push_segment (GArray *segment_stack,
               gint    y,
               gint    old_y,
               gint    start,
@@ -417,21 +754,20 @@ push_segment (GQueue *segment_queue,
               gint    new_start,
               gint    new_end)
 {
-  /* To avoid excessive memory allocation (y, old_y, start, end) tuples are
-   * stored in interleaved format:
-   *
-   * [y1] [old_y1] [start1] [end1] [y2] [old_y2] [start2] [end2]
-   */
+  Segment segment;
+
+  segment.y     = new_y;
+  segment.old_y = y;
 
   if (new_y != old_y)
     {
       /* If the new segment's y-coordinate is different than the old (source)
        * segment's y-coordinate, push the entire segment.
        */
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_start));
-      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_end));
+      segment.start = new_start;
+      segment.end   = new_end;
+
+      g_array_append_val (segment_stack, segment);
     }
   else
     {
@@ -443,139 +779,83 @@ push_segment (GQueue *segment_queue,
        */
       if (new_start < start)
         {
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_start));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (start + 1));
+          segment.start = new_start;
+          segment.end   = start + 1;
+
+          g_array_append_val (segment_stack, segment);
         }
 
       if (new_end > end)
         {
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (end - 1));
-          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_end));
+          segment.start = end - 1;
+          segment.end   = new_end;
+
+          g_array_append_val (segment_stack, segment);
         }
     }
 }
 
 static void
-pop_segment (GQueue *segment_queue,
+pop_segment (GArray *segment_stack,
              gint   *y,
              gint   *old_y,
              gint   *start,
              gint   *end)
 {
-  *y     = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
-  *old_y = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
-  *start = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
-  *end   = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
-}
+  const Segment *segment = &g_array_index (segment_stack, Segment,
+                                           segment_stack->len - 1);
+
+  *y     = segment->y;
+  *old_y = segment->old_y;
+  *start = segment->start;
+  *end   = segment->end;
 
-/* #define FETCH_ROW 1 */
+  g_array_set_size (segment_stack, segment_stack->len - 1);
+}
 
 static gboolean
-find_contiguous_segment (const gfloat        *col,
-                         GeglBuffer          *src_buffer,
-                         GeglBuffer          *mask_buffer,
-                         const Babl          *src_format,
-                         const Babl          *mask_format,
-                         gint                 n_components,
-                         gboolean             has_alpha,
-                         gint                 width,
-                         gboolean             select_transparent,
-                         GimpSelectCriterion  select_criterion,
-                         gboolean             antialias,
-                         gfloat               threshold,
-                         gint                 initial_x,
-                         gint                 initial_y,
-                         gint                *start,
-                         gint                *end,
-                         gfloat              *row)
+find_contiguous_segment (ContiguousRegion *region,
+                         gint              initial_x,
+                         gint              initial_y,
+                         gint             *start,
+                         gint             *end)
 {
-  gfloat *s;
-  gfloat  mask_row[width];
-  gfloat  diff;
-
-#ifdef FETCH_ROW
-  gegl_buffer_get (src_buffer, GEGL_RECTANGLE (0, initial_y, width, 1), 1.0,
-                   src_format,
-                   row, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-  s = row + initial_x * n_components;
-#else
-  s = g_alloca (n_components * sizeof (gfloat));
-
-  gegl_buffer_sample (src_buffer, initial_x, initial_y, NULL, s, src_format,
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
+  gfloat diff;
 
-  diff = pixel_difference (col, s, antialias, threshold,
-                           n_components, has_alpha, select_transparent,
-                           select_criterion);
+  diff = get_diff (region, initial_x, initial_y);
 
   /* check the starting pixel */
   if (! diff)
     return FALSE;
 
-  mask_row[initial_x] = diff;
+  set_mask (region, initial_x, initial_y, diff);
 
   *start = initial_x - 1;
-#ifdef FETCH_ROW
-  s = row + *start * n_components;
-#endif
 
   while (*start >= 0)
     {
-#ifndef FETCH_ROW
-      gegl_buffer_sample (src_buffer, *start, initial_y, NULL, s, src_format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
+      diff = get_diff (region, *start, initial_y);
       if (diff == 0.0)
         break;
 
-      mask_row[*start] = diff;
+      set_mask (region, *start, initial_y, diff);
 
       (*start)--;
-#ifdef FETCH_ROW
-      s -= n_components;
-#endif
     }
 
   *end = initial_x + 1;
-#ifdef FETCH_ROW
-  s = row + *end * n_components;
-#endif
 
-  while (*end < width)
+  while (*end < region->width)
     {
-#ifndef FETCH_ROW
-      gegl_buffer_sample (src_buffer, *end, initial_y, NULL, s, src_format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
+      diff = get_diff (region, *end, initial_y);
       if (diff == 0.0)
         break;
 
-      mask_row[*end] = diff;
+      set_mask (region, *end, initial_y, diff);
 
       (*end)++;
-#ifdef FETCH_ROW
-      s += n_components;
-#endif
     }
 
-  gegl_buffer_set (mask_buffer, GEGL_RECTANGLE (*start + 1, initial_y,
-                                                *end - *start - 1, 1),
-                   0, mask_format, &mask_row[*start + 1],
-                   GEGL_AUTO_ROWSTRIDE);
-
   return TRUE;
 }
 
@@ -592,38 +872,61 @@ find_contiguous_region (GeglBuffer          *src_buffer,
                         gboolean             diagonal_neighbors,
                         gint                 x,
                         gint                 y,
-                        const gfloat        *col)
+                        const gfloat        *col,
+                        GeglRectangle       *bounds)
 {
-  const Babl *mask_format = babl_format ("Y float");
-  gint        old_y;
-  gint        start, end;
-  gint        new_start, new_end;
-  GQueue     *segment_queue;
-  gfloat     *row = NULL;
-
-#ifdef FETCH_ROW
-  row = g_new (gfloat, gegl_buffer_get_width (src_buffer) * n_components);
-#endif
-
-  segment_queue = g_queue_new ();
-
-  push_segment (segment_queue,
+  ContiguousRegion  region;
+  gint              old_y;
+  gint              start, end;
+  gint              new_start, new_end;
+  GArray           *segment_stack;
+  gint              n_tiles;
+  gint              x1, y1, x2, y2;
+
+  region.src_buffer         = src_buffer;
+  region.mask_buffer        = mask_buffer;
+  region.format             = format;
+  region.n_components       = n_components;
+  region.has_alpha          = has_alpha;
+  region.select_transparent = select_transparent;
+  region.select_criterion   = select_criterion;
+  region.antialias          = antialias;
+  region.threshold          = threshold;
+  region.col                = col;
+
+  region.width              = gegl_buffer_get_width  (src_buffer);
+  region.height             = gegl_buffer_get_height (src_buffer);
+  region.n_tile_cols        = (region.width  + TILE_SIZE - 1) / TILE_SIZE;
+  region.n_tile_rows        = (region.height + TILE_SIZE - 1) / TILE_SIZE;
+
+  n_tiles = region.n_tile_cols * region.n_tile_rows;
+
+  region.diff_tiles         = g_new0 (gfloat *,  n_tiles);
+  region.mask_tiles         = g_new0 (gfloat *,  n_tiles);
+  region.mask_stored        = g_new0 (gboolean, n_tiles);
+
+  region.first_cached_tile  = 0;
+  region.n_cached_tiles     = 0;
+
+  segment_stack = g_array_sized_new (FALSE, FALSE, sizeof (Segment), 256);
+
+  x1 = region.width;
+  y1 = region.height;
+  x2 = 0;
+  y2 = 0;
+
+  push_segment (segment_stack,
                 y, /* dummy values: */ -1, 0, 0,
                 y, x - 1, x + 1);
 
   do
     {
-      pop_segment (segment_queue,
+      pop_segment (segment_stack,
                    &y, &old_y, &start, &end);
 
       for (x = start + 1; x < end; x++)
         {
-          gfloat val;
-
-          gegl_buffer_sample (mask_buffer, x, y, NULL, &val,
-                              mask_format,
-                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          if (val != 0.0)
+          if (get_mask (&region, x, y) != 0.0)
             {
               /* If the current pixel is selected, then we've already visited
                * the next pixel.  (Note that we assume that the maximal image
@@ -633,15 +936,8 @@ find_contiguous_region (GeglBuffer          *src_buffer,
               continue;
             }
 
-          if (! find_contiguous_segment (col, src_buffer, mask_buffer,
-                                         format, mask_format,
-                                         n_components,
-                                         has_alpha,
-                                         gegl_buffer_get_width (src_buffer),
-                                         select_transparent, select_criterion,
-                                         antialias, threshold, x, y,
-                                         &new_start, &new_end,
-                                         row))
+          if (! find_contiguous_segment (&region, x, y,
+                                         &new_start, &new_end))
             continue;
 
           /* We can skip directly to `new_end + 1` on the next iteration, since
@@ -652,36 +948,49 @@ find_contiguous_region (GeglBuffer          *src_buffer,
            */
           x = new_end;
 
+          x1 = MIN (x1, new_start + 1);
+          x2 = MAX (x2, new_end);
+          y1 = MIN (y1, y);
+          y2 = MAX (y2, y + 1);
+
           if (diagonal_neighbors)
             {
               if (new_start >= 0)
                 new_start--;
 
-              if (new_end < gegl_buffer_get_width (src_buffer))
+              if (new_end < region.width)
                 new_end++;
             }
 
-          if (y + 1 < gegl_buffer_get_height (src_buffer))
+          if (y + 1 < region.height)
             {
-              push_segment (segment_queue,
+              push_segment (segment_stack,
                             y, old_y, start, end,
                             y + 1, new_start, new_end);
             }
 
           if (y - 1 >= 0)
             {
-              push_segment (segment_queue,
+              push_segment (segment_stack,
                             y, old_y, start, end,
                             y - 1, new_start, new_end);
             }
 
         }
     }
-  while (! g_queue_is_empty (segment_queue));
+  while (segment_stack->len > 0);
+
+  g_array_free (segment_stack, TRUE);
+
+  if (x1 < x2)
+    gegl_rectangle_set (bounds, x1, y1, x2 - x1, y2 - y1);
+  else
+    gegl_rectangle_set (bounds, 0, 0, 0, 0);
 
-  g_queue_free (segment_queue);
+  while (region.n_cached_tiles > 0)
+    uncache_tile (&region);
 
-#ifdef FETCH_ROW
-  g_free (row);
-#endif
+  g_free (region.diff_tiles);
+  g_free (region.mask_tiles);
+  g_free (region.mask_stored);
 }
@@ -26,7 +26,8 @@ GeglBuffer * gimp_pickable_contiguous_region_by_seed  (GimpPickable        *pick
                                                        GimpSelectCriterion  select_criterion,
                                                        gboolean             diagonal_neighbors,
                                                        gint                 x,
-                                                       gint                 y);
+                                                       gint                 y,
+                                                       GeglRectangle       *mask_bounds);
 
 GeglBuffer * gimp_pickable_contiguous_region_by_color (GimpPickable        *pickable,
                                                        gboolean             antialias,
@@ -313,24 +313,45 @@ gimp_pickable_pick_color (GimpPickable *pickable,
 
   if (sample_average)
     {
-      gint    count        = 0;
-      gdouble color_avg[4] = { 0.0, 0.0, 0.0, 0.0 };
-      gint    radius       = (gint) average_radius;
-      gint    i, j;
+      GeglBuffer    *buffer       = gimp_pickable_get_buffer (pickable);
+      gdouble        color_avg[4] = { 0.0, 0.0, 0.0, 0.0 };
+      gint           radius       = (gint) average_radius;
+      GeglRectangle  rect;
+      gdouble       *row;
+      gint           count;
+      gint           i, j;
 
       format = babl_format ("RaGaBaA double");
 
-      for (i = x - radius; i <= x + radius; i++)
-        for (j = y - radius; j <= y + radius; j++)
-          if (gimp_pickable_get_pixel_at (pickable, i, j, format, sample))
-            {
-              count++;
+      /*  fetch the part of the window inside the pickable one row at
+       *  a time, instead of sampling each pixel on its own
+       */
+      gegl_rectangle_intersect (&rect,
+                                GEGL_RECTANGLE (x - radius, y - radius,
+                                                2 * radius + 1,
+                                                2 * radius + 1),
+                                gegl_buffer_get_extent (buffer));
+
+      row = g_new (gdouble, 4 * rect.width);
+
+      for (j = rect.y; j < rect.y + rect.height; j++)
+        {
+          gegl_buffer_get (buffer, GEGL_RECTANGLE (rect.x, j, rect.width, 1),
+                           1.0, format, row,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-              color_avg[RED]   += sample[RED];
-              color_avg[GREEN] += sample[GREEN];
-              color_avg[BLUE]  += sample[BLUE];
-              color_avg[ALPHA] += sample[ALPHA];
+          for (i = 0; i < rect.width; i++)
+            {
+              color_avg[RED]   += row[4 * i + RED];
+              color_avg[GREEN] += row[4 * i + GREEN];
+              color_avg[BLUE]  += row[4 * i + BLUE];
+              color_avg[ALPHA] += row[4 * i + ALPHA];
             }
+        }
+
+      g_free (row);
+
+      count = rect.width * rect.height;
 
       sample[RED]   = color_avg[RED]   / count;
       sample[GREEN] = color_avg[GREEN] / count;
@@ -31,7 +31,10 @@
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-utils.h"
 
+#include "operations/layer-modes/gimpoperationlayermode.h"
+
 #include "gimp.h"
+#include "gimp-allocation.h"
 #include "gimp-memsize.h"
 #include "gimpimage.h"
 #include "gimpmarshal.h"
@@ -42,17 +45,42 @@
 
 #include "gimp-log.h"
 #include "gimp-priorities.h"
+#include "gimp-trace.h"
 
 
-/*  chunk size for one iteration of the chunk renderer  */
+/*  initial chunk size for one iteration of the chunk renderer  */
 static gint GIMP_PROJECTION_CHUNK_WIDTH  = 256;
 static gint GIMP_PROJECTION_CHUNK_HEIGHT = 128;
 
+/*  whether the chunk size adapts to the measured rendering cost, it
+ *  doesn't when a fixed size is requested through the environment
+ */
+static gboolean GIMP_PROJECTION_ADAPTIVE_CHUNKS = TRUE;
+
 /*  how much time, in seconds, do we allow chunk rendering to take,
  *  aiming for 15fps
  */
 static gdouble GIMP_PROJECTION_CHUNK_TIME = 0.0666;
 
+/*  how much time, in seconds, one iteration of the chunk renderer should
+ *  take when the chunk size is adaptive.  a fraction of the above, so
+ *  that the last iteration doesn't overshoot it by much
+ */
+static gdouble GIMP_PROJECTION_ITERATION_TIME = 0.0166;
+
+/*  bounds of the adaptive chunk size.  the chunk size is always one of
+ *  MIN_CHUNK_WIDTH x MIN_CHUNK_HEIGHT times a power of two, which keeps
+ *  the chunk grids of different sizes aligned
+ */
+#define GIMP_PROJECTION_MIN_CHUNK_WIDTH   64
+#define GIMP_PROJECTION_MIN_CHUNK_HEIGHT  32
+#define GIMP_PROJECTION_MAX_CHUNK_LEVEL    5
+
+/*  the highest mipmap level the chunk renderer leaves level 0 of the
+ *  projection unrendered for
+ */
+#define GIMP_PROJECTION_MAX_PRIORITY_LEVEL 8
+
 
 enum
 {
@@ -73,15 +101,12 @@ struct _GimpProjectionChunkRender
 {
   guint           idle_id;
 
-  gint            x;
-  gint            y;
-  gint            width;
-  gint            height;
-
-  gint            work_x;
-  gint            work_y;
+  gint            chunk_width;
+  gint            chunk_height;
+  gdouble         pixel_cost;      /*  seconds per pixel, 0.0 if unknown */
 
   cairo_region_t *update_region;   /*  flushed update region */
+  guint64         backlog;         /*  pixels left in update_region      */
 };
 
 struct _GimpProjectionPrivate
@@ -92,10 +117,12 @@ struct _GimpProjectionPrivate
   GimpTileHandlerValidate   *validate_handler;
 
   gint                       priority;
+  gboolean                   lazy;
 
   cairo_region_t            *update_region;
   GimpProjectionChunkRender  chunk_render;
   cairo_rectangle_int_t      priority_rect;
+  gint                       priority_level;
 
   gboolean                   invalidate_preview;
 };
@@ -148,11 +175,22 @@ static void        gimp_projection_add_update_area       (GimpProjection  *proj,
 static void        gimp_projection_flush_whenever        (GimpProjection  *proj,
                                                           gboolean         now);
 static void        gimp_projection_chunk_render_start    (GimpProjection  *proj);
+static void        gimp_projection_reset_render_cost     (GeglNode        *node);
 static void        gimp_projection_chunk_render_stop     (GimpProjection  *proj);
 static gboolean    gimp_projection_chunk_render_callback (gpointer         data);
 static void        gimp_projection_chunk_render_init     (GimpProjection  *proj);
 static gboolean    gimp_projection_chunk_render_iteration(GimpProjection  *proj);
-static gboolean    gimp_projection_chunk_render_next_area(GimpProjection  *proj);
+static gboolean    gimp_projection_chunk_render_next_chunk
+                                                         (GimpProjection  *proj,
+                                                          GeglRectangle   *chunk);
+static void        gimp_projection_chunk_render_update_backlog
+                                                         (GimpProjection  *proj);
+static void        gimp_projection_chunk_render_update_size
+                                                         (GimpProjection  *proj,
+                                                          gint64           elapsed,
+                                                          const GeglRectangle *chunk);
+static void        gimp_projection_paint_chunk           (GimpProjection  *proj,
+                                                          GeglRectangle   *chunk);
 static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gboolean         now,
                                                           gint             x,
@@ -181,6 +219,12 @@ G_DEFINE_TYPE_WITH_CODE (GimpProjection, gimp_projection, GIMP_TYPE_OBJECT,
 
 static guint projection_signals[LAST_SIGNAL] = { 0 };
 
+/*  the pixels queued for rendering by all projections, shown in the
+ *  dashboard
+ */
+static GMutex  backlog_mutex;
+static guint64 total_backlog = 0;
+
 
 static void
 gimp_projection_class_init (GimpProjectionClass *klass)
@@ -226,8 +270,9 @@ gimp_projection_class_init (GimpProjectionClass *klass)
       if (width  > 0 && width  <= 8192 &&
           height > 0 && height <= 8192)
         {
-          GIMP_PROJECTION_CHUNK_WIDTH  = width;
-          GIMP_PROJECTION_CHUNK_HEIGHT = height;
+          GIMP_PROJECTION_CHUNK_WIDTH     = width;
+          GIMP_PROJECTION_CHUNK_HEIGHT    = height;
+          GIMP_PROJECTION_ADAPTIVE_CHUNKS = FALSE;
         }
     }
 }
@@ -238,6 +283,9 @@ gimp_projection_init (GimpProjection *proj)
   proj->priv = G_TYPE_INSTANCE_GET_PRIVATE (proj,
                                             GIMP_TYPE_PROJECTION,
                                             GimpProjectionPrivate);
+
+  proj->priv->chunk_render.chunk_width  = GIMP_PROJECTION_CHUNK_WIDTH;
+  proj->priv->chunk_render.chunk_height = GIMP_PROJECTION_CHUNK_HEIGHT;
 }
 
 static void
@@ -345,6 +393,24 @@ gimp_projection_estimate_memsize (GimpImageBaseType type,
   return bytes * (gint64) width * (gint64) height * 1.33;
 }
 
+/**
+ * gimp_projection_get_render_backlog:
+ *
+ * Return value: the number of pixels all projections still have to
+ *               render in the background.
+ **/
+guint64
+gimp_projection_get_render_backlog (void)
+{
+  guint64 backlog;
+
+  g_mutex_lock (&backlog_mutex);
+  backlog = total_backlog;
+  g_mutex_unlock (&backlog_mutex);
+
+  return backlog;
+}
+
 
 static void
 gimp_projection_pickable_flush (GimpPickable *pickable)
@@ -401,6 +467,9 @@ gimp_projection_get_buffer (GimpPickable *pickable)
       proj->priv->buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
                                             format);
 
+      gimp_allocation_tag_buffer (proj->priv->buffer,
+                                  GIMP_ALLOCATION_PROJECTION);
+
       proj->priv->validate_handler =
         GIMP_TILE_HANDLER_VALIDATE (
           gimp_tile_handler_projectable_new (proj->priv->projectable));
@@ -522,6 +591,29 @@ gimp_projection_get_priority (GimpProjection *proj)
   return proj->priv->priority;
 }
 
+/*  A lazy projection doesn't render flushed updates in the background,
+ *  it only invalidates them, and they are rendered when the buffer is
+ *  read.  This is for projections which are rarely looked at, like
+ *  those of pass-through groups, whose children are composited
+ *  directly into the parent's graph.
+ */
+void
+gimp_projection_set_lazy (GimpProjection *proj,
+                          gboolean        lazy)
+{
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+
+  proj->priv->lazy = lazy ? TRUE : FALSE;
+}
+
+gboolean
+gimp_projection_get_lazy (GimpProjection *proj)
+{
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), FALSE);
+
+  return proj->priv->lazy;
+}
+
 void
 gimp_projection_set_priority_rect (GimpProjection *proj,
                                    gint            x,
@@ -545,22 +637,221 @@ gimp_projection_set_priority_rect (GimpProjection *proj,
   x -= off_x;
   y -= off_y;
 
+  /*  the chunk renderer picks up the new priority rect with its next
+   *  chunk
+   */
   if (gimp_rectangle_intersect (x, y, w, h,
                                 0, 0, width, height,
                                 &rect.x, &rect.y, &rect.width, &rect.height))
     {
       proj->priv->priority_rect = rect;
+    }
+}
+
+/*  sets the scale the projection is mostly looked at, i.e. the scale of
+ *  the active display.  when it's 1/2 or less, the chunk renderer only
+ *  invalidates the projection, and lets the display pull the mipmap
+ *  level it needs, which is rendered directly at that level's scale,
+ *  see GimpTileHandlerValidate.  level 0 is then rendered on demand.
+ */
+void
+gimp_projection_set_priority_scale (GimpProjection *proj,
+                                    gdouble         scale)
+{
+  gint level = 0;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+  g_return_if_fail (scale > 0.0);
+
+  /*  the nearest level at or above the scale, like gegl_buffer_get()
+   *  picks it
+   */
+  while (scale <= 0.5 && level < GIMP_PROJECTION_MAX_PRIORITY_LEVEL)
+    {
+      scale *= 2.0;
+      level++;
+    }
+
+  if (level == proj->priv->priority_level)
+    return;
+
+  if (level == 0 && proj->priv->validate_handler)
+    {
+      cairo_region_t *dirty_region;
+
+      /*  queue what was left unrendered at level 0 for rendering  */
+      dirty_region = proj->priv->validate_handler->dirty_region;
+
+      if (! cairo_region_is_empty (dirty_region))
+        {
+          if (proj->priv->update_region)
+            cairo_region_union (proj->priv->update_region, dirty_region);
+          else
+            proj->priv->update_region = cairo_region_copy (dirty_region);
+        }
+    }
+
+  proj->priv->priority_level = level;
+
+  if (level == 0)
+    gimp_projection_flush (proj);
+}
+
+/*  sets a prerendered copy of mipmap level 'level' of the projection,
+ *  such as one stored with the image, which the levels at and above it
+ *  are taken from instead of being rendered, until the image changes.
+ *  the whole projection is left unrendered, and level 0 is rendered
+ *  when it is needed.
+ */
+void
+gimp_projection_set_prerendered_level (GimpProjection *proj,
+                                       GeglBuffer     *buffer,
+                                       gint            level)
+{
+  gint off_x, off_y;
+  gint width, height;
 
-      if (proj->priv->chunk_render.idle_id)
-        gimp_projection_chunk_render_init (proj);
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (level > 0 &&
+                    level <= GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS);
+
+  /* create the buffer if it doesn't exist */
+  gimp_projection_get_buffer (GIMP_PICKABLE (proj));
+
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+  gimp_projectable_get_size   (proj->priv->projectable, &width, &height);
+
+  /*  drop the pending updates, they are covered by invalidating the
+   *  whole projection, which the prerendered level is then used for
+   */
+  if (proj->priv->chunk_render.idle_id)
+    gimp_projection_chunk_render_stop (proj);
+
+  g_clear_pointer (&proj->priv->update_region, cairo_region_destroy);
+  g_clear_pointer (&proj->priv->chunk_render.update_region,
+                   cairo_region_destroy);
+
+  gimp_tile_handler_validate_invalidate (proj->priv->validate_handler,
+                                         GEGL_RECTANGLE (0, 0, width, height));
+
+  gimp_tile_handler_validate_set_prerendered (proj->priv->validate_handler,
+                                              buffer, level);
+
+  proj->priv->invalidate_preview = TRUE;
+
+  g_signal_emit (proj, projection_signals[UPDATE], 0,
+                 TRUE, off_x, off_y, width, height);
+}
+
+/*  makes 'proj' share the tiles 'src_proj' has already rendered,
+ *  copy-on-write, when both render the same thing, such as the
+ *  projections of a duplicated image or layer group and of their
+ *  original.  the rest of 'proj' is rendered as usual.
+ */
+void
+gimp_projection_share_tiles (GimpProjection *proj,
+                             GimpProjection *src_proj)
+{
+  GeglBuffer     *buffer;
+  GeglBuffer     *src_buffer;
+  cairo_region_t *valid_region;
+  cairo_region_t *dirty_region;
+  gint            off_x, off_y;
+  gint            width, height;
+  gint            n_rects;
+  gint            i;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+  g_return_if_fail (GIMP_IS_PROJECTION (src_proj));
+
+  src_buffer = src_proj->priv->buffer;
+
+  if (! src_buffer)
+    return;
+
+  /* create the buffer if it doesn't exist */
+  buffer = gimp_projection_get_buffer (GIMP_PICKABLE (proj));
+
+  if (gegl_buffer_get_format (buffer) != gegl_buffer_get_format (src_buffer) ||
+      ! gegl_rectangle_equal (gegl_buffer_get_extent (buffer),
+                              gegl_buffer_get_extent (src_buffer)))
+    {
+      return;
+    }
+
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+  gimp_projectable_get_size   (proj->priv->projectable, &width, &height);
+
+  /*  what the source hasn't rendered, or has pending updates for  */
+  dirty_region = cairo_region_copy (src_proj->priv->validate_handler->dirty_region);
+
+  if (src_proj->priv->update_region)
+    cairo_region_union (dirty_region, src_proj->priv->update_region);
+
+  if (src_proj->priv->chunk_render.update_region)
+    cairo_region_union (dirty_region, src_proj->priv->chunk_render.update_region);
+
+  valid_region = cairo_region_create_rectangle (
+    (cairo_rectangle_int_t *) GEGL_RECTANGLE (0, 0, width, height));
+  cairo_region_subtract (valid_region, dirty_region);
+
+  /*  drop the pending updates, everything is invalidated below, and
+   *  what can't be shared is queued again
+   */
+  if (proj->priv->chunk_render.idle_id)
+    gimp_projection_chunk_render_stop (proj);
+
+  g_clear_pointer (&proj->priv->update_region, cairo_region_destroy);
+  g_clear_pointer (&proj->priv->chunk_render.update_region,
+                   cairo_region_destroy);
+
+  gimp_tile_handler_validate_invalidate (proj->priv->validate_handler,
+                                         GEGL_RECTANGLE (0, 0, width, height));
+
+  n_rects = cairo_region_num_rectangles (valid_region);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (valid_region, i, &rect);
+
+      gimp_tile_handler_validate_undo_invalidate (proj->priv->validate_handler,
+                                                  (GeglRectangle *) &rect);
+
+      gegl_buffer_copy (src_buffer, (GeglRectangle *) &rect, GEGL_ABYSS_NONE,
+                        buffer,     (GeglRectangle *) &rect);
+    }
+
+  n_rects = cairo_region_num_rectangles (dirty_region);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (dirty_region, i, &rect);
+
+      gimp_projection_add_update_area (proj,
+                                       rect.x + off_x, rect.y + off_y,
+                                       rect.width, rect.height);
     }
+
+  cairo_region_destroy (valid_region);
+  cairo_region_destroy (dirty_region);
+
+  proj->priv->invalidate_preview = TRUE;
+
+  g_signal_emit (proj, projection_signals[UPDATE], 0,
+                 TRUE, off_x, off_y, width, height);
+
+  gimp_projection_flush (proj);
 }
 
 void
 gimp_projection_stop_rendering (GimpProjection *proj)
 {
   GimpProjectionChunkRender *chunk_render;
-  cairo_rectangle_int_t      rect;
 
   g_return_if_fail (GIMP_IS_PROJECTION (proj));
 
@@ -585,17 +876,6 @@ gimp_projection_stop_rendering (GimpProjection *proj)
       g_clear_pointer (&chunk_render->update_region, cairo_region_destroy);
     }
 
-  rect.x      = chunk_render->x;
-  rect.y      = chunk_render->work_y;
-  rect.width  = chunk_render->width;
-  rect.height = chunk_render->height - (chunk_render->work_y - chunk_render->y);
-
-  /* FIXME this is too much, the entire current row */
-  if (proj->priv->update_region)
-    cairo_region_union_rectangle (proj->priv->update_region, &rect);
-  else
-    proj->priv->update_region = cairo_region_create_rectangle (&rect);
-
   gimp_projection_chunk_render_stop (proj);
 }
 
@@ -696,7 +976,7 @@ gimp_projection_flush_whenever (GimpProjection *proj,
 {
   if (proj->priv->update_region)
     {
-      if (now)  /* Synchronous */
+      if (now || proj->priv->lazy)  /* Synchronous, or on demand */
         {
           gint n_rects = cairo_region_num_rectangles (proj->priv->update_region);
           gint i;
@@ -715,6 +995,13 @@ gimp_projection_flush_whenever (GimpProjection *proj,
                                           rect.width,
                                           rect.height);
             }
+
+          if (! now && proj->priv->invalidate_preview)
+            {
+              proj->priv->invalidate_preview = FALSE;
+
+              gimp_projectable_invalidate_preview (proj->priv->projectable);
+            }
         }
       else  /* Asynchronous */
         {
@@ -740,12 +1027,35 @@ gimp_projection_chunk_render_start (GimpProjection *proj)
 {
   g_return_if_fail (proj->priv->chunk_render.idle_id == 0);
 
+  /*  the layers' render cost is that of the last render  */
+  gimp_projection_reset_render_cost (
+    gimp_projectable_get_graph (proj->priv->projectable));
+
   proj->priv->chunk_render.idle_id =
     g_idle_add_full (GIMP_PRIORITY_PROJECTION_IDLE + proj->priv->priority,
                      gimp_projection_chunk_render_callback, proj,
                      NULL);
 }
 
+static void
+gimp_projection_reset_render_cost (GeglNode *node)
+{
+  GeglOperation *operation = gegl_node_get_gegl_operation (node);
+  GSList        *children;
+  GSList        *list;
+
+  if (GIMP_IS_OPERATION_LAYER_MODE (operation))
+    gimp_operation_layer_mode_reset_render_cost (
+      GIMP_OPERATION_LAYER_MODE (operation));
+
+  children = gegl_node_get_children (node);
+
+  for (list = children; list; list = g_slist_next (list))
+    gimp_projection_reset_render_cost (list->data);
+
+  g_slist_free (children);
+}
+
 static void
 gimp_projection_chunk_render_stop (GimpProjection *proj)
 {
@@ -753,6 +1063,8 @@ gimp_projection_chunk_render_stop (GimpProjection *proj)
 
   g_source_remove (proj->priv->chunk_render.idle_id);
   proj->priv->chunk_render.idle_id = 0;
+
+  gimp_projection_chunk_render_update_backlog (proj);
 }
 
 static gboolean
@@ -782,6 +1094,9 @@ gimp_projection_chunk_render_callback (gpointer data)
 
   gimp_projectable_end_render (proj->priv->projectable);
 
+  if (retval)
+    gimp_projection_chunk_render_update_backlog (proj);
+
   GIMP_LOG (PROJECTION, "%d chunks in %f seconds\n",
             chunks, g_timer_elapsed (timer, NULL));
   g_timer_destroy (timer);
@@ -812,28 +1127,11 @@ gimp_projection_chunk_render_init (GimpProjection *proj)
         }
     }
 
-  /* If a chunk renderer was already running, merge the remainder of
-   * its unrendered area with the update_areas list, and make it start
-   * work on the next unrendered area in the list.
+  /* The chunk renderer cuts its chunks directly out of its update
+   * region, so if it was already running, it simply continues with
+   * the merged region.
    */
-  if (chunk_render->idle_id)
-    {
-      cairo_rectangle_int_t rect;
-
-      rect.x      = chunk_render->x;
-      rect.y      = chunk_render->work_y;
-      rect.width  = chunk_render->width;
-      rect.height = (chunk_render->height -
-                     (chunk_render->work_y - chunk_render->y));
-
-      if (chunk_render->update_region)
-        cairo_region_union_rectangle (chunk_render->update_region, &rect);
-      else
-        chunk_render->update_region = cairo_region_create_rectangle (&rect);
-
-      gimp_projection_chunk_render_next_area (proj);
-    }
-  else
+  if (! chunk_render->idle_id)
     {
       if (chunk_render->update_region == NULL)
         {
@@ -842,10 +1140,10 @@ gimp_projection_chunk_render_init (GimpProjection *proj)
           return;
         }
 
-      gimp_projection_chunk_render_next_area (proj);
-
       gimp_projection_chunk_render_start (proj);
     }
+
+  gimp_projection_chunk_render_update_backlog (proj);
 }
 
 /* Unless specified otherwise, projection re-rendering is organised by
@@ -853,83 +1151,163 @@ gimp_projection_chunk_render_init (GimpProjection *proj)
  * them into bite-sized chunks which are chewed on in an idle
  * function. This greatly improves responsiveness for many GIMP
  * operations.  -- Adam
+ *
+ * Each iteration renders one chunk.  Chunks are picked outwards from
+ * the center of the priority rect, and their size follows the measured
+ * rendering cost.  The chunks are not rendered on several threads at
+ * once: they are all blitted from the projectable's graph, and the GEGL
+ * we require doesn't support processing one graph from several threads
+ * concurrently.
  */
 static gboolean
 gimp_projection_chunk_render_iteration (GimpProjection *proj)
 {
   GimpProjectionChunkRender *chunk_render = &proj->priv->chunk_render;
-  gint                       work_x       = chunk_render->work_x;
-  gint                       work_y       = chunk_render->work_y;
-  gint                       work_w;
-  gint                       work_h;
+  GeglRectangle              chunk;
 
-  work_w = MIN (GIMP_PROJECTION_CHUNK_WIDTH,
-                chunk_render->x + chunk_render->width - work_x);
-
-  work_h = MIN (GIMP_PROJECTION_CHUNK_HEIGHT,
-                chunk_render->y + chunk_render->height - work_y);
+  if (gimp_projection_chunk_render_next_chunk (proj, &chunk))
+    {
+      gint64 start_time = g_get_monotonic_time ();
 
-  gimp_projection_paint_area (proj, TRUE /* sic! */,
-                              work_x, work_y, work_w, work_h);
+      GIMP_TRACE_BEGIN ("projection-render-chunk");
+      gimp_projection_paint_chunk (proj, &chunk);
+      GIMP_TRACE_END ("projection-render-chunk");
 
-  chunk_render->work_x += work_w;
+      gimp_projection_chunk_render_update_size (proj,
+                                                g_get_monotonic_time () -
+                                                start_time,
+                                                &chunk);
+    }
 
-  if (chunk_render->work_x >= chunk_render->x + chunk_render->width)
+  if (! chunk_render->update_region)
     {
-      chunk_render->work_x = chunk_render->x;
-
-      chunk_render->work_y += work_h;
-
-      if (chunk_render->work_y >= chunk_render->y + chunk_render->height)
+      if (proj->priv->invalidate_preview)
         {
-          if (! gimp_projection_chunk_render_next_area (proj))
-            {
-              if (proj->priv->invalidate_preview)
-                {
-                  /* invalidate the preview here since it is constructed from
-                   * the projection
-                   */
-                  proj->priv->invalidate_preview = FALSE;
-
-                  gimp_projectable_invalidate_preview (proj->priv->projectable);
-                }
-
-              /* FINISHED */
-              return FALSE;
-            }
+          /* invalidate the preview here since it is constructed from
+           * the projection
+           */
+          proj->priv->invalidate_preview = FALSE;
+
+          gimp_projectable_invalidate_preview (proj->priv->projectable);
         }
+
+      /* FINISHED */
+      return FALSE;
     }
 
   /* Still work to do. */
   return TRUE;
 }
 
-static gboolean
-gimp_projection_chunk_render_next_area (GimpProjection *proj)
+/* Unlike the update region, which is only changed by the main thread,
+ * the backlog is also read by the dashboard's sampling thread.  It
+ * counts the pixels left to render while the chunk renderer runs, and
+ * is zero while it doesn't.
+ */
+static void
+gimp_projection_chunk_render_update_backlog (GimpProjection *proj)
 {
   GimpProjectionChunkRender *chunk_render = &proj->priv->chunk_render;
-  cairo_region_t            *next_region;
-  cairo_rectangle_int_t      rect;
+  guint64                    backlog      = 0;
+
+  if (chunk_render->idle_id && chunk_render->update_region)
+    {
+      gint n_rects = cairo_region_num_rectangles (chunk_render->update_region);
+      gint i;
+
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (chunk_render->update_region, i, &rect);
+
+          backlog += (guint64) rect.width * rect.height;
+        }
+    }
+
+  if (backlog != chunk_render->backlog)
+    {
+      g_mutex_lock (&backlog_mutex);
+
+      total_backlog += backlog;
+      total_backlog -= chunk_render->backlog;
+
+      g_mutex_unlock (&backlog_mutex);
+
+      chunk_render->backlog = backlog;
+    }
+}
+
+/* Cuts the next chunk out of the update region: the chunk-grid cell
+ * closest to the center of the priority rect, intersected with the
+ * region's rectangle it was found in.  Picking chunks this way renders
+ * the visible area first, spreading outwards from its center.
+ */
+static gboolean
+gimp_projection_chunk_render_next_chunk (GimpProjection *proj,
+                                         GeglRectangle  *chunk)
+{
+  GimpProjectionChunkRender   *chunk_render = &proj->priv->chunk_render;
+  const cairo_rectangle_int_t *priority     = &proj->priv->priority_rect;
+  cairo_rectangle_int_t        rect;
+  cairo_rectangle_int_t        best_rect    = { 0, };
+  gint64                       best_dist    = G_MAXINT64;
+  gint                         n_rects;
+  gint                         center_x;
+  gint                         center_y;
+  gint                         x, y;
+  gint                         cell_x, cell_y;
+  gint                         i;
 
   if (! chunk_render->update_region)
     return FALSE;
 
-  if (cairo_region_is_empty (chunk_render->update_region))
+  n_rects = cairo_region_num_rectangles (chunk_render->update_region);
+
+  if (n_rects == 0)
     {
       g_clear_pointer (&chunk_render->update_region, cairo_region_destroy);
 
       return FALSE;
     }
 
-  next_region = cairo_region_copy (chunk_render->update_region);
-  cairo_region_intersect_rectangle (next_region, &proj->priv->priority_rect);
+  center_x = priority->x + priority->width  / 2;
+  center_y = priority->y + priority->height / 2;
 
-  if (cairo_region_is_empty (next_region))
-    cairo_region_get_rectangle (chunk_render->update_region, 0, &rect);
-  else
-    cairo_region_get_rectangle (next_region, 0, &rect);
+  for (i = 0; i < n_rects && best_dist > 0; i++)
+    {
+      gint64 dx, dy;
+      gint64 dist;
+
+      cairo_region_get_rectangle (chunk_render->update_region, i, &rect);
+
+      dx = CLAMP (center_x, rect.x, rect.x + rect.width  - 1) - center_x;
+      dy = CLAMP (center_y, rect.y, rect.y + rect.height - 1) - center_y;
+
+      dist = dx * dx + dy * dy;
 
-  cairo_region_destroy (next_region);
+      if (dist < best_dist)
+        {
+          best_rect = rect;
+          best_dist = dist;
+        }
+    }
+
+  /*  the point of the rectangle closest to the center, and the cell of
+   *  the chunk grid containing it.  update areas are never negative.
+   */
+  x = CLAMP (center_x, best_rect.x, best_rect.x + best_rect.width  - 1);
+  y = CLAMP (center_y, best_rect.y, best_rect.y + best_rect.height - 1);
+
+  cell_x = x - x % chunk_render->chunk_width;
+  cell_y = y - y % chunk_render->chunk_height;
+
+  gimp_rectangle_intersect (cell_x, cell_y,
+                            chunk_render->chunk_width,
+                            chunk_render->chunk_height,
+                            best_rect.x, best_rect.y,
+                            best_rect.width, best_rect.height,
+                            &rect.x, &rect.y, &rect.width, &rect.height);
 
   cairo_region_subtract_rectangle (chunk_render->update_region, &rect);
 
@@ -938,17 +1316,60 @@ gimp_projection_chunk_render_next_area (GimpProjection *proj)
       g_clear_pointer (&chunk_render->update_region, cairo_region_destroy);
     }
 
-  chunk_render->x      = rect.x;
-  chunk_render->y      = rect.y;
-  chunk_render->width  = rect.width;
-  chunk_render->height = rect.height;
-
-  chunk_render->work_x = chunk_render->x;
-  chunk_render->work_y = chunk_render->y;
+  *chunk = *GEGL_RECTANGLE (rect.x, rect.y, rect.width, rect.height);
 
   return TRUE;
 }
 
+/* Updates the per-pixel rendering cost from the time it took to render
+ * 'chunk', and picks the chunk size whose rendering is expected to fit
+ * within GIMP_PROJECTION_ITERATION_TIME.
+ */
+static void
+gimp_projection_chunk_render_update_size (GimpProjection      *proj,
+                                          gint64               elapsed,
+                                          const GeglRectangle *chunk)
+{
+  GimpProjectionChunkRender *chunk_render = &proj->priv->chunk_render;
+  gdouble                    chunk_pixels;
+  gdouble                    cost;
+  gint                       level;
+
+  if (! GIMP_PROJECTION_ADAPTIVE_CHUNKS)
+    return;
+
+  chunk_pixels = (gdouble) chunk->width * chunk->height;
+
+  /*  the cost of chunks clipped by the update region is dominated by
+   *  overhead, and would make the chunks shrink needlessly
+   */
+  if (chunk_pixels < (gdouble) chunk_render->chunk_width *
+                               chunk_render->chunk_height / 4.0)
+    return;
+
+  cost = (elapsed / (gdouble) G_TIME_SPAN_SECOND) / chunk_pixels;
+
+  if (chunk_render->pixel_cost > 0.0)
+    chunk_render->pixel_cost = (chunk_render->pixel_cost + cost) / 2.0;
+  else
+    chunk_render->pixel_cost = cost;
+
+  chunk_pixels = (GIMP_PROJECTION_ITERATION_TIME /
+                  MAX (chunk_render->pixel_cost, 1e-12));
+
+  for (level = 0; level < GIMP_PROJECTION_MAX_CHUNK_LEVEL; level++)
+    {
+      gdouble next_pixels = ((gdouble) (GIMP_PROJECTION_MIN_CHUNK_WIDTH  << (level + 1)) *
+                                       (GIMP_PROJECTION_MIN_CHUNK_HEIGHT << (level + 1)));
+
+      if (next_pixels > chunk_pixels)
+        break;
+    }
+
+  chunk_render->chunk_width  = GIMP_PROJECTION_MIN_CHUNK_WIDTH  << level;
+  chunk_render->chunk_height = GIMP_PROJECTION_MIN_CHUNK_HEIGHT << level;
+}
+
 static void
 gimp_projection_paint_area (GimpProjection *proj,
                             gboolean        now,
@@ -996,6 +1417,56 @@ gimp_projection_paint_area (GimpProjection *proj,
 }
 
 
+static void
+gimp_projection_paint_chunk (GimpProjection *proj,
+                             GeglRectangle  *chunk)
+{
+  gint     off_x, off_y;
+  gint     width, height;
+  gboolean lazy;
+
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+  gimp_projectable_get_size   (proj->priv->projectable, &width, &height);
+
+  if (! gimp_rectangle_intersect (chunk->x, chunk->y,
+                                  chunk->width, chunk->height,
+                                  0, 0, width, height,
+                                  &chunk->x, &chunk->y,
+                                  &chunk->width, &chunk->height))
+    return;
+
+  /*  when zoomed out, leave the rendering to the display, which pulls
+   *  the mipmap level it needs
+   */
+  lazy = (proj->priv->priority_level > 0 && proj->priv->validate_handler);
+
+  if (proj->priv->validate_handler)
+    {
+      gimp_tile_handler_validate_invalidate (proj->priv->validate_handler,
+                                             chunk);
+
+      if (! lazy)
+        gimp_tile_handler_validate_undo_invalidate (proj->priv->validate_handler,
+                                                    chunk);
+    }
+
+  if (! lazy)
+    {
+      GeglNode *graph = gimp_projectable_get_graph (proj->priv->projectable);
+
+      gegl_node_blit_buffer (graph, proj->priv->buffer,
+                             chunk, 0, GEGL_ABYSS_NONE);
+    }
+
+  g_signal_emit (proj, projection_signals[UPDATE], 0,
+                 TRUE,
+                 chunk->x + off_x,
+                 chunk->y + off_y,
+                 chunk->width,
+                 chunk->height);
+}
+
+
 /*  image callbacks  */
 
 static void
@@ -1006,6 +1477,17 @@ gimp_projection_projectable_invalidate (GimpProjectable *projectable,
                                         gint             h,
                                         GimpProjection  *proj)
 {
+  if (proj->priv->validate_handler)
+    {
+      gint off_x, off_y;
+
+      gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+
+      gimp_tile_handler_validate_expire_prerendered (
+        proj->priv->validate_handler,
+        GEGL_RECTANGLE (x - off_x, y - off_y, w, h));
+    }
+
   gimp_projection_add_update_area (proj, x, y, w, h);
 }
 
@@ -61,11 +61,26 @@ void             gimp_projection_set_priority      (GimpProjection    *projectio
                                                     gint               priority);
 gint             gimp_projection_get_priority      (GimpProjection    *projection);
 
+void             gimp_projection_set_lazy          (GimpProjection    *projection,
+                                                    gboolean           lazy);
+gboolean         gimp_projection_get_lazy          (GimpProjection    *projection);
+
 void             gimp_projection_set_priority_rect (GimpProjection    *proj,
                                                     gint               x,
                                                     gint               y,
                                                     gint               width,
                                                     gint               height);
+void             gimp_projection_set_priority_scale
+                                                   (GimpProjection    *proj,
+                                                    gdouble            scale);
+
+void             gimp_projection_set_prerendered_level
+                                                   (GimpProjection    *proj,
+                                                    GeglBuffer        *buffer,
+                                                    gint               level);
+
+void             gimp_projection_share_tiles       (GimpProjection    *proj,
+                                                    GimpProjection    *src_proj);
 
 void             gimp_projection_stop_rendering    (GimpProjection    *proj);
 
@@ -78,5 +93,7 @@ gint64           gimp_projection_estimate_memsize  (GimpImageBaseType  type,
                                                     gint               width,
                                                     gint               height);
 
+guint64          gimp_projection_get_render_backlog (void);
+
 
 #endif /*  __GIMP_PROJECTION_H__  */
@@ -29,11 +29,15 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
 #include "gimpbezierdesc.h"
 #include "gimpscanconvert.h"
 
 
+#define MIN_PARALLEL_SUB_AREA (128 * 128)
+
+
 struct _GimpScanConvert
 {
   gdouble         ratio_xy;
@@ -56,6 +60,33 @@ struct _GimpScanConvert
   GArray         *path_data;
 };
 
+typedef struct
+{
+  GimpScanConvert *sc;
+  GeglBuffer      *buffer;
+  gint             off_x;
+  gint             off_y;
+  gboolean         replace;
+  gboolean         antialias;
+  gdouble          value;
+  cairo_path_t     path;
+} RenderData;
+
+
+/*  local function prototypes  */
+
+static void     gimp_scan_convert_setup         (GimpScanConvert     *sc,
+                                                 cairo_t             *cr,
+                                                 RenderData          *data);
+static gboolean gimp_scan_convert_get_extents   (GimpScanConvert     *sc,
+                                                 RenderData          *data,
+                                                 GeglRectangle       *area);
+static void     gimp_scan_convert_clear_outside (GeglBuffer          *buffer,
+                                                 const GeglRectangle *extent,
+                                                 const GeglRectangle *area);
+static void     gimp_scan_convert_render_area   (const GeglRectangle *area,
+                                                 RenderData          *data);
+
 
 /*  public functions  */
 
@@ -496,23 +527,21 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
                                gboolean         antialias,
                                gdouble          value)
 {
-  const Babl         *format;
-  GeglBufferIterator *iter;
-  GeglRectangle      *roi;
-  cairo_t            *cr;
-  cairo_surface_t    *surface;
-  cairo_path_t        path;
-  gint                bpp;
-  gint                x, y;
-  gint                width, height;
+  const GeglRectangle *extent;
+  RenderData           data;
+  GeglRectangle        area;
+  gint                 x, y;
+  gint                 width, height;
 
   g_return_if_fail (sc != NULL);
   g_return_if_fail (GEGL_IS_BUFFER (buffer));
 
-  x      = 0;
-  y      = 0;
-  width  = gegl_buffer_get_width  (buffer);
-  height = gegl_buffer_get_height (buffer);
+  extent = gegl_buffer_get_extent (buffer);
+
+  x      = extent->x;
+  y      = extent->y;
+  width  = extent->width;
+  height = extent->height;
 
   if (sc->clip && ! gimp_rectangle_intersect (x, y, width, height,
                                               sc->clip_x, sc->clip_y,
@@ -520,23 +549,209 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
                                               &x, &y, &width, &height))
     return;
 
-  path.status   = CAIRO_STATUS_SUCCESS;
-  path.data     = (cairo_path_data_t *) sc->path_data->data;
-  path.num_data = sc->path_data->len;
+  data.sc        = sc;
+  data.buffer    = buffer;
+  data.off_x     = off_x;
+  data.off_y     = off_y;
+  data.replace   = replace;
+  data.antialias = antialias;
+  data.value     = value;
+
+  data.path.status   = CAIRO_STATUS_SUCCESS;
+  data.path.data     = (cairo_path_data_t *) sc->path_data->data;
+  data.path.num_data = sc->path_data->len;
+
+  /*  only the tiles covered by the path need to be rasterized, the
+   *  rest of the buffer is at most cleared
+   */
+  if (! gimp_scan_convert_get_extents (sc, &data, &area) ||
+      ! gimp_rectangle_intersect (x, y, width, height,
+                                  area.x, area.y, area.width, area.height,
+                                  &area.x, &area.y,
+                                  &area.width, &area.height))
+    {
+      area.width  = 0;
+      area.height = 0;
+    }
+
+  if (replace)
+    gimp_scan_convert_clear_outside (buffer, extent, &area);
+
+  if (area.width > 0 && area.height > 0)
+    {
+      gimp_parallel_distribute_area (&area, MIN_PARALLEL_SUB_AREA,
+                                     (GimpParallelDistributeAreaFunc)
+                                     gimp_scan_convert_render_area,
+                                     &data);
+    }
+}
+
+
+/*  private functions  */
+
+static void
+gimp_scan_convert_setup (GimpScanConvert *sc,
+                         cairo_t         *cr,
+                         RenderData      *data)
+{
+  cairo_set_source_rgba (cr, 0, 0, 0, data->value);
+  cairo_append_path (cr, &data->path);
+
+  cairo_set_antialias (cr, data->antialias ?
+                       CAIRO_ANTIALIAS_GRAY : CAIRO_ANTIALIAS_NONE);
+  cairo_set_miter_limit (cr, sc->miter);
+
+  if (sc->do_stroke)
+    {
+      cairo_set_line_cap (cr,
+                          sc->cap == GIMP_CAP_BUTT ? CAIRO_LINE_CAP_BUTT :
+                          sc->cap == GIMP_CAP_ROUND ? CAIRO_LINE_CAP_ROUND :
+                          CAIRO_LINE_CAP_SQUARE);
+      cairo_set_line_join (cr,
+                           sc->join == GIMP_JOIN_MITER ? CAIRO_LINE_JOIN_MITER :
+                           sc->join == GIMP_JOIN_ROUND ? CAIRO_LINE_JOIN_ROUND :
+                           CAIRO_LINE_JOIN_BEVEL);
+
+      cairo_set_line_width (cr, sc->width);
+
+      if (sc->dash_info)
+        cairo_set_dash (cr,
+                        (double *) sc->dash_info->data,
+                        sc->dash_info->len,
+                        sc->dash_offset);
+
+      cairo_scale (cr, 1.0, sc->ratio_xy);
+    }
+  else
+    {
+      cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+    }
+}
+
+/*  returns the area of the buffer the path can touch, in buffer
+ *  coordinates, or FALSE if it touches nothing
+ */
+static gboolean
+gimp_scan_convert_get_extents (GimpScanConvert *sc,
+                               RenderData      *data,
+                               GeglRectangle   *area)
+{
+  cairo_surface_t *surface;
+  cairo_t         *cr;
+  gdouble          x1, y1;
+  gdouble          x2, y2;
+
+  if (data->path.num_data == 0)
+    return FALSE;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, 1, 1);
+  cr = cairo_create (surface);
+
+  gimp_scan_convert_setup (sc, cr, data);
+
+  if (sc->do_stroke)
+    cairo_stroke_extents (cr, &x1, &y1, &x2, &y2);
+  else
+    cairo_fill_extents (cr, &x1, &y1, &x2, &y2);
+
+  /*  the stroke extents are in the scaled user space  */
+  cairo_user_to_device (cr, &x1, &y1);
+  cairo_user_to_device (cr, &x2, &y2);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+
+  if (x2 <= x1 || y2 <= y1)
+    return FALSE;
+
+  /*  leave a pixel of slack for the rasterizer's rounding  */
+  area->x      = floor (x1) - 1 - data->off_x;
+  area->y      = floor (y1) - 1 - data->off_y;
+  area->width  = ceil (x2) + 1 - data->off_x - area->x;
+  area->height = ceil (y2) + 1 - data->off_y - area->y;
+
+  return TRUE;
+}
+
+/*  clears the parts of @extent outside of @area, which is contained
+ *  in @extent, or empty
+ */
+static void
+gimp_scan_convert_clear_outside (GeglBuffer          *buffer,
+                                 const GeglRectangle *extent,
+                                 const GeglRectangle *area)
+{
+  GeglRectangle rect;
+
+  if (area->width <= 0 || area->height <= 0)
+    {
+      gegl_buffer_clear (buffer, extent);
+
+      return;
+    }
+
+  /*  above  */
+  rect = *extent;
+  rect.height = area->y - extent->y;
+
+  if (rect.height > 0)
+    gegl_buffer_clear (buffer, &rect);
+
+  /*  below  */
+  rect = *extent;
+  rect.y      = area->y + area->height;
+  rect.height = extent->y + extent->height - rect.y;
+
+  if (rect.height > 0)
+    gegl_buffer_clear (buffer, &rect);
+
+  /*  left  */
+  rect.x      = extent->x;
+  rect.y      = area->y;
+  rect.width  = area->x - extent->x;
+  rect.height = area->height;
+
+  if (rect.width > 0)
+    gegl_buffer_clear (buffer, &rect);
+
+  /*  right  */
+  rect.x     = area->x + area->width;
+  rect.width = extent->x + extent->width - rect.x;
+
+  if (rect.width > 0)
+    gegl_buffer_clear (buffer, &rect);
+}
+
+/*  rasterizes the path into @area, one buffer tile at a time.  each
+ *  tile gets its own cairo surface, so that the areas are independent
+ *  and can be rendered in parallel.
+ */
+static void
+gimp_scan_convert_render_area (const GeglRectangle *area,
+                               RenderData          *data)
+{
+  const Babl         *format;
+  GeglBufferIterator *iter;
+  GeglRectangle      *roi;
+  cairo_t            *cr;
+  cairo_surface_t    *surface;
+  gint                bpp;
 
   format = babl_format ("Y u8");
   bpp    = babl_format_get_bytes_per_pixel (format);
 
-  iter = gegl_buffer_iterator_new (buffer, NULL, 0, format,
-                                   GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0, format,
+                                   data->replace ?
+                                   GEGL_ACCESS_WRITE : GEGL_ACCESS_READWRITE,
+                                   GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
 
   while (gegl_buffer_iterator_next (iter))
     {
-      guchar     *data    = iter->data[0];
-      guchar     *tmp_buf = NULL;
-      const gint  stride  = cairo_format_stride_for_width (CAIRO_FORMAT_A8,
-                                                           roi->width);
+      guchar     *data_buf = iter->data[0];
+      guchar     *tmp_buf  = NULL;
+      const gint  stride   = cairo_format_stride_for_width (CAIRO_FORMAT_A8,
+                                                            roi->width);
 
       /*  cairo rowstrides are always multiples of 4, whereas
        *  maskPR.rowstride can be anything, so to be able to create an
@@ -547,9 +762,9 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
         {
           tmp_buf = g_alloca (stride * roi->height);
 
-          if (! replace)
+          if (! data->replace)
             {
-              const guchar *src  = data;
+              const guchar *src  = data_buf;
               guchar       *dest = tmp_buf;
               gint          i;
 
@@ -564,57 +779,29 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
         }
 
       surface = cairo_image_surface_create_for_data (tmp_buf ?
-                                                     tmp_buf : data,
+                                                     tmp_buf : data_buf,
                                                      CAIRO_FORMAT_A8,
                                                      roi->width, roi->height,
                                                      stride);
 
       cairo_surface_set_device_offset (surface,
-                                       -off_x - roi->x,
-                                       -off_y - roi->y);
+                                       -data->off_x - roi->x,
+                                       -data->off_y - roi->y);
       cr = cairo_create (surface);
       cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
 
-      if (replace)
+      if (data->replace)
         {
           cairo_set_source_rgba (cr, 0, 0, 0, 0);
           cairo_paint (cr);
         }
 
-      cairo_set_source_rgba (cr, 0, 0, 0, value);
-      cairo_append_path (cr, &path);
-
-      cairo_set_antialias (cr, antialias ?
-                           CAIRO_ANTIALIAS_GRAY : CAIRO_ANTIALIAS_NONE);
-      cairo_set_miter_limit (cr, sc->miter);
+      gimp_scan_convert_setup (data->sc, cr, data);
 
-      if (sc->do_stroke)
-        {
-          cairo_set_line_cap (cr,
-                              sc->cap == GIMP_CAP_BUTT ? CAIRO_LINE_CAP_BUTT :
-                              sc->cap == GIMP_CAP_ROUND ? CAIRO_LINE_CAP_ROUND :
-                              CAIRO_LINE_CAP_SQUARE);
-          cairo_set_line_join (cr,
-                               sc->join == GIMP_JOIN_MITER ? CAIRO_LINE_JOIN_MITER :
-                               sc->join == GIMP_JOIN_ROUND ? CAIRO_LINE_JOIN_ROUND :
-                               CAIRO_LINE_JOIN_BEVEL);
-
-          cairo_set_line_width (cr, sc->width);
-
-          if (sc->dash_info)
-            cairo_set_dash (cr,
-                            (double *) sc->dash_info->data,
-                            sc->dash_info->len,
-                            sc->dash_offset);
-
-          cairo_scale (cr, 1.0, sc->ratio_xy);
-          cairo_stroke (cr);
-        }
+      if (data->sc->do_stroke)
+        cairo_stroke (cr);
       else
-        {
-          cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
-          cairo_fill (cr);
-        }
+        cairo_fill (cr);
 
       cairo_destroy (cr);
       cairo_surface_destroy (surface);
@@ -622,7 +809,7 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
       if (tmp_buf)
         {
           const guchar *src  = tmp_buf;
-          guchar       *dest = data;
+          guchar       *dest = data_buf;
           gint          i;
 
           for (i = 0; i < roi->height; i++)
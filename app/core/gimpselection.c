@@ -26,7 +26,9 @@
 #include "core-types.h"
 
 #include "gegl/gimp-babl.h"
-#include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-loops.h"
+#include "gegl/gimp-gegl-mask.h"
+#include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
 #include "gimp-edit.h"
@@ -140,6 +142,11 @@ static void       gimp_selection_shrink        (GimpChannel         *channel,
 static void       gimp_selection_flood         (GimpChannel         *channel,
                                                 gboolean             push_undo);
 
+static void       gimp_selection_mask_buffer   (GeglBuffer          *mask_buffer,
+                                                gint                 mask_x,
+                                                gint                 mask_y,
+                                                GeglBuffer          *buffer);
+
 
 G_DEFINE_TYPE (GimpSelection, gimp_selection, GIMP_TYPE_CHANNEL)
 
@@ -779,14 +786,24 @@ gimp_selection_extract (GimpSelection *selection,
 
   src_buffer = gimp_pickable_get_buffer (pickable);
 
-  /*  Allocate the temp buffer  */
-  dest_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, x2 - x1, y2 - y1),
-                                 dest_format);
+  /*  First, copy the pixels, possibly doing INDEXED->RGB and adding
+   *  alpha.  without a conversion, the copy shares the source's tiles
+   */
+  if (dest_format == gegl_buffer_get_format (src_buffer))
+    {
+      dest_buffer =
+        gimp_gegl_buffer_dup_area (src_buffer,
+                                   GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1));
+    }
+  else
+    {
+      dest_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, x2 - x1, y2 - y1),
+                                     dest_format);
 
-  /*  First, copy the pixels, possibly doing INDEXED->RGB and adding alpha  */
-  gegl_buffer_copy (src_buffer,  GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1),
-                    GEGL_ABYSS_NONE,
-                    dest_buffer, GEGL_RECTANGLE (0, 0, 0, 0));
+      gegl_buffer_copy (src_buffer,  GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1),
+                        GEGL_ABYSS_NONE,
+                        dest_buffer, GEGL_RECTANGLE (0, 0, 0, 0));
+    }
 
   if (non_empty)
     {
@@ -796,11 +813,9 @@ gimp_selection_extract (GimpSelection *selection,
 
       mask_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (selection));
 
-      gimp_gegl_apply_opacity (dest_buffer, NULL, NULL, dest_buffer,
-                               mask_buffer,
-                               - (off_x + x1),
-                               - (off_y + y1),
-                               1.0);
+      gimp_selection_mask_buffer (mask_buffer,
+                                  off_x + x1, off_y + y1,
+                                  dest_buffer);
 
       if (cut_image)
         {
@@ -911,3 +926,58 @@ gimp_selection_float (GimpSelection *selection,
 
   return layer;
 }
+
+
+/*  private functions  */
+
+/*  masks 'buffer' with the selection one of its tiles at a time, and
+ *  leaves fully selected tiles alone, so that tiles shared with the
+ *  buffer it was copied from stay shared
+ */
+static void
+gimp_selection_mask_buffer (GeglBuffer *mask_buffer,
+                            gint        mask_x,
+                            gint        mask_y,
+                            GeglBuffer *buffer)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  gint                 shift_x;
+  gint                 shift_y;
+  gint                 tile_width;
+  gint                 tile_height;
+  gint                 x0, y0;
+  gint                 x, y;
+
+  g_object_get (buffer,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  /*  the tile boundaries at or before the extent's origin  */
+  x0 = extent->x - ((extent->x + shift_x) % tile_width  + tile_width)  % tile_width;
+  y0 = extent->y - ((extent->y + shift_y) % tile_height + tile_height) % tile_height;
+
+  for (y = y0; y < extent->y + extent->height; y += tile_height)
+    {
+      for (x = x0; x < extent->x + extent->width; x += tile_width)
+        {
+          GeglRectangle rect;
+          GeglRectangle mask_rect;
+
+          gegl_rectangle_intersect (&rect,
+                                    GEGL_RECTANGLE (x, y,
+                                                    tile_width, tile_height),
+                                    extent);
+
+          mask_rect    = rect;
+          mask_rect.x += mask_x;
+          mask_rect.y += mask_y;
+
+          if (! gimp_gegl_mask_is_full (mask_buffer, &mask_rect))
+            gimp_gegl_apply_mask (mask_buffer, &mask_rect,
+                                  buffer, &rect, 1.0);
+        }
+    }
+}
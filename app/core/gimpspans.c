@@ -0,0 +1,737 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpspans.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  a run-length representation of a binary mask, as made by
+ *  rectangle and non-antialiased ellipse selections.  each row is a
+ *  sorted list of the disjoint spans of fully selected pixels, and
+ *  runs of identical rows are stored once, as a band.  a rectangle
+ *  takes a single band, whatever its size.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core-types.h"
+
+#include "gegl/gimp-gegl-mask-combine.h"
+
+#include "gimpspans.h"
+
+
+typedef struct _GimpSpansBand GimpSpansBand;
+
+struct _GimpSpansBand
+{
+  gint    y1;
+  gint    y2;
+  GArray *spans;  /*  the x1, x2 pairs of the spans, never empty  */
+};
+
+struct _GimpSpans
+{
+  gint    width;
+  gint    height;
+  GArray *bands;  /*  sorted by y, rows without spans have no band  */
+};
+
+
+typedef void (* GimpSpansRowFunc) (gint      y,
+                                   gint     *x1,
+                                   gint     *x2,
+                                   gpointer  data);
+
+typedef struct
+{
+  gint    x0, x1;     /*  the horizontal clip  */
+  gint    x, y;
+  gint    w, h;
+  gdouble a, b;
+} EllipseRectData;
+
+
+static void     gimp_spans_combine     (GimpSpans        *spans,
+                                        GimpChannelOps    op,
+                                        gint              y1,
+                                        gint              y2,
+                                        GimpSpansRowFunc  row_func,
+                                        gpointer          row_data);
+static GArray * gimp_spans_copy_row    (const GArray     *row);
+static GArray * gimp_spans_combine_row (const GArray     *row,
+                                        GimpChannelOps    op,
+                                        gint              x1,
+                                        gint              x2);
+static void     gimp_spans_append      (GArray           *bands,
+                                        gint              y1,
+                                        gint              y2,
+                                        GArray           *row);
+static gint     gimp_spans_find_band   (const GimpSpans  *spans,
+                                        gint              y);
+
+static void     rect_row_func          (gint              y,
+                                        gint             *x1,
+                                        gint             *x2,
+                                        gint             *rect);
+static void     ellipse_rect_row_func  (gint              y,
+                                        gint             *x1,
+                                        gint             *x2,
+                                        EllipseRectData  *data);
+
+
+/*  public functions  */
+
+GimpSpans *
+gimp_spans_new (gint width,
+                gint height)
+{
+  GimpSpans *spans;
+
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+
+  spans = g_slice_new (GimpSpans);
+
+  spans->width  = width;
+  spans->height = height;
+  spans->bands  = g_array_new (FALSE, FALSE, sizeof (GimpSpansBand));
+
+  return spans;
+}
+
+GimpSpans *
+gimp_spans_copy (const GimpSpans *spans)
+{
+  GimpSpans *copy;
+  guint      i;
+
+  g_return_val_if_fail (spans != NULL, NULL);
+
+  copy = gimp_spans_new (spans->width, spans->height);
+
+  for (i = 0; i < spans->bands->len; i++)
+    {
+      GimpSpansBand band = g_array_index (spans->bands, GimpSpansBand, i);
+
+      band.spans = gimp_spans_copy_row (band.spans);
+
+      g_array_append_val (copy->bands, band);
+    }
+
+  return copy;
+}
+
+void
+gimp_spans_free (GimpSpans *spans)
+{
+  guint i;
+
+  g_return_if_fail (spans != NULL);
+
+  for (i = 0; i < spans->bands->len; i++)
+    g_array_free (g_array_index (spans->bands, GimpSpansBand, i).spans, TRUE);
+
+  g_array_free (spans->bands, TRUE);
+
+  g_slice_free (GimpSpans, spans);
+}
+
+gint
+gimp_spans_get_width (const GimpSpans *spans)
+{
+  g_return_val_if_fail (spans != NULL, 0);
+
+  return spans->width;
+}
+
+gint
+gimp_spans_get_height (const GimpSpans *spans)
+{
+  g_return_val_if_fail (spans != NULL, 0);
+
+  return spans->height;
+}
+
+gint64
+gimp_spans_get_memsize (const GimpSpans *spans)
+{
+  gint64 memsize;
+  guint  i;
+
+  g_return_val_if_fail (spans != NULL, 0);
+
+  memsize = sizeof (GimpSpans) + spans->bands->len * sizeof (GimpSpansBand);
+
+  for (i = 0; i < spans->bands->len; i++)
+    memsize += g_array_index (spans->bands, GimpSpansBand, i).spans->len *
+               sizeof (gint);
+
+  return memsize;
+}
+
+/**
+ * gimp_spans_combine_rect:
+ * @spans: a #GimpSpans
+ * @op:    how to combine the rectangle
+ * @x:     x coordinate of the rectangle
+ * @y:     y coordinate of the rectangle
+ * @w:     width of the rectangle
+ * @h:     height of the rectangle
+ *
+ * Does to @spans what gimp_gegl_mask_combine_rect() does to a buffer.
+ **/
+void
+gimp_spans_combine_rect (GimpSpans      *spans,
+                         GimpChannelOps  op,
+                         gint            x,
+                         gint            y,
+                         gint            w,
+                         gint            h)
+{
+  gint rect[2];
+
+  g_return_if_fail (spans != NULL);
+
+  if (! gimp_rectangle_intersect (x, y, w, h,
+                                  0, 0, spans->width, spans->height,
+                                  &x, &y, &w, &h))
+    return;
+
+  /*  like gimp_gegl_mask_combine_rect(), intersecting clears the rect  */
+  if (op == GIMP_CHANNEL_OP_INTERSECT)
+    op = GIMP_CHANNEL_OP_SUBTRACT;
+
+  rect[0] = x;
+  rect[1] = x + w;
+
+  gimp_spans_combine (spans, op, y, y + h,
+                      (GimpSpansRowFunc) rect_row_func, rect);
+}
+
+/**
+ * gimp_spans_combine_ellipse_rect:
+ * @spans: a #GimpSpans
+ * @op:    how to combine the elliptic rect
+ * @x:     x coordinate of upper left corner of bounding rect
+ * @y:     y coordinate of upper left corner of bounding rect
+ * @w:     width of bounding rect
+ * @h:     height of bounding rect
+ * @a:     elliptic a-constant applied to corners
+ * @b:     elliptic b-constant applied to corners
+ *
+ * Does to @spans what a non-antialiased
+ * gimp_gegl_mask_combine_ellipse_rect() does to a buffer.
+ **/
+void
+gimp_spans_combine_ellipse_rect (GimpSpans      *spans,
+                                 GimpChannelOps  op,
+                                 gint            x,
+                                 gint            y,
+                                 gint            w,
+                                 gint            h,
+                                 gdouble         a,
+                                 gdouble         b)
+{
+  EllipseRectData data;
+  gint            x0, y0;
+  gint            width, height;
+
+  g_return_if_fail (spans != NULL);
+  g_return_if_fail (a >= 0.0 && b >= 0.0);
+  g_return_if_fail (op != GIMP_CHANNEL_OP_INTERSECT);
+
+  if (! gimp_rectangle_intersect (x, y, w, h,
+                                  0, 0, spans->width, spans->height,
+                                  &x0, &y0, &width, &height))
+    return;
+
+  data.x0 = x0;
+  data.x1 = x0 + width;
+  data.x  = x;
+  data.y  = y;
+  data.w  = w;
+  data.h  = h;
+  data.a  = a;
+  data.b  = b;
+
+  gimp_spans_combine (spans, op, y0, y0 + height,
+                      (GimpSpansRowFunc) ellipse_rect_row_func, &data);
+}
+
+gboolean
+gimp_spans_is_empty (const GimpSpans *spans)
+{
+  g_return_val_if_fail (spans != NULL, TRUE);
+
+  return spans->bands->len == 0;
+}
+
+/**
+ * gimp_spans_bounds:
+ * @spans: a #GimpSpans
+ * @x1:    returns the left side of the bounds
+ * @y1:    returns the top side of the bounds
+ * @x2:    returns the right side of the bounds
+ * @y2:    returns the bottom side of the bounds
+ *
+ * Like gimp_gegl_mask_bounds(), but walks the bands instead of the
+ * pixels.
+ *
+ * Return value: %FALSE if @spans is empty.
+ **/
+gboolean
+gimp_spans_bounds (const GimpSpans *spans,
+                   gint            *x1,
+                   gint            *y1,
+                   gint            *x2,
+                   gint            *y2)
+{
+  const GimpSpansBand *band;
+  guint                i;
+
+  g_return_val_if_fail (spans != NULL, FALSE);
+  g_return_val_if_fail (x1 != NULL && y1 != NULL, FALSE);
+  g_return_val_if_fail (x2 != NULL && y2 != NULL, FALSE);
+
+  if (spans->bands->len == 0)
+    {
+      *x1 = 0;
+      *y1 = 0;
+      *x2 = spans->width;
+      *y2 = spans->height;
+
+      return FALSE;
+    }
+
+  *x1 = spans->width;
+  *x2 = 0;
+
+  for (i = 0; i < spans->bands->len; i++)
+    {
+      band = &g_array_index (spans->bands, GimpSpansBand, i);
+
+      *x1 = MIN (*x1, g_array_index (band->spans, gint, 0));
+      *x2 = MAX (*x2, g_array_index (band->spans, gint, band->spans->len - 1));
+    }
+
+  *y1 = g_array_index (spans->bands, GimpSpansBand, 0).y1;
+  *y2 = band->y2;
+
+  return TRUE;
+}
+
+gboolean
+gimp_spans_get_value (const GimpSpans *spans,
+                      gint             x,
+                      gint             y)
+{
+  const gint *row;
+  gint        n_spans;
+  gint        lo, hi;
+
+  g_return_val_if_fail (spans != NULL, FALSE);
+
+  row = gimp_spans_get_row (spans, y, &n_spans);
+
+  /*  find the first span ending after x  */
+  lo = 0;
+  hi = n_spans;
+
+  while (lo < hi)
+    {
+      gint mid = (lo + hi) / 2;
+
+      if (row[2 * mid + 1] <= x)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo < n_spans && row[2 * lo] <= x;
+}
+
+/**
+ * gimp_spans_get_row:
+ * @spans:   a #GimpSpans
+ * @y:       the row
+ * @n_spans: returns the number of spans of row @y
+ *
+ * Return value: the x1, x2 pairs of the spans of row @y, owned by
+ *               @spans.
+ **/
+const gint *
+gimp_spans_get_row (const GimpSpans *spans,
+                    gint             y,
+                    gint            *n_spans)
+{
+  gint i;
+
+  g_return_val_if_fail (spans != NULL, NULL);
+  g_return_val_if_fail (n_spans != NULL, NULL);
+
+  i = gimp_spans_find_band (spans, y);
+
+  if (i < spans->bands->len &&
+      g_array_index (spans->bands, GimpSpansBand, i).y1 <= y)
+    {
+      const GimpSpansBand *band = &g_array_index (spans->bands,
+                                                  GimpSpansBand, i);
+
+      *n_spans = band->spans->len / 2;
+
+      return (const gint *) band->spans->data;
+    }
+
+  *n_spans = 0;
+
+  return NULL;
+}
+
+/**
+ * gimp_spans_render:
+ * @spans:  a #GimpSpans
+ * @buffer: the mask to render to
+ *
+ * Replaces the contents of @buffer with @spans, setting the spans'
+ * pixels to 1.0 and all others to 0.0.
+ **/
+void
+gimp_spans_render (const GimpSpans *spans,
+                   GeglBuffer      *buffer)
+{
+  GeglColor *color;
+  guint      i;
+
+  g_return_if_fail (spans != NULL);
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+
+  gegl_buffer_clear (buffer, NULL);
+
+  color = gegl_color_new ("#fff");
+
+  for (i = 0; i < spans->bands->len; i++)
+    {
+      const GimpSpansBand *band = &g_array_index (spans->bands,
+                                                  GimpSpansBand, i);
+      const gint          *span = (const gint *) band->spans->data;
+      guint                j;
+
+      for (j = 0; j < band->spans->len; j += 2)
+        {
+          gegl_buffer_set_color (buffer,
+                                 GEGL_RECTANGLE (span[j], band->y1,
+                                                 span[j + 1] - span[j],
+                                                 band->y2 - band->y1),
+                                 color);
+        }
+    }
+
+  g_object_unref (color);
+}
+
+
+/*  private functions  */
+
+/*  combines the span row_func() returns for each of the rows
+ *  [y1, y2) with the spans of the row.  the bands are rebuilt in one
+ *  pass, and the rows are only combined where either the band or the
+ *  span changes.
+ */
+static void
+gimp_spans_combine (GimpSpans        *spans,
+                    GimpChannelOps    op,
+                    gint              y1,
+                    gint              y2,
+                    GimpSpansRowFunc  row_func,
+                    gpointer          row_data)
+{
+  GArray *bands;
+  guint   n_bands = spans->bands->len;
+  guint   i       = 0;
+  gint    y;
+
+  if (y1 >= y2)
+    return;
+
+  bands = g_array_sized_new (FALSE, FALSE, sizeof (GimpSpansBand),
+                             n_bands + 2);
+
+  /*  the bands above, the one crossing y1 is split  */
+  for (; i < n_bands; i++)
+    {
+      GimpSpansBand *band = &g_array_index (spans->bands, GimpSpansBand, i);
+
+      if (band->y1 >= y1)
+        break;
+
+      if (band->y2 > y1)
+        {
+          gimp_spans_append (bands, band->y1, y1,
+                             gimp_spans_copy_row (band->spans));
+          break;
+        }
+
+      gimp_spans_append (bands, band->y1, band->y2, band->spans);
+      band->spans = NULL;
+    }
+
+  /*  the combined rows  */
+  for (y = y1; y < y2;)
+    {
+      GimpSpansBand *band = NULL;
+      gint           piece_y1 = y;
+      gint           end      = y2;
+      gint           x1, x2;
+
+      if (i < n_bands)
+        {
+          band = &g_array_index (spans->bands, GimpSpansBand, i);
+
+          if (band->y1 > y)
+            {
+              end  = MIN (end, band->y1);
+              band = NULL;
+            }
+          else
+            {
+              end = MIN (end, band->y2);
+            }
+        }
+
+      row_func (y, &x1, &x2, row_data);
+
+      /*  extend the piece over the rows with the same span  */
+      for (y++; y < end; y++)
+        {
+          gint next_x1, next_x2;
+
+          row_func (y, &next_x1, &next_x2, row_data);
+
+          if (next_x1 != x1 || next_x2 != x2)
+            break;
+        }
+
+      if (band || op == GIMP_CHANNEL_OP_ADD || op == GIMP_CHANNEL_OP_REPLACE)
+        {
+          gimp_spans_append (bands, piece_y1, y,
+                             gimp_spans_combine_row (band ? band->spans : NULL,
+                                                     op, x1, x2));
+        }
+
+      if (band && y >= band->y2)
+        i++;
+    }
+
+  /*  the bands below, the one crossing y2 is split  */
+  for (; i < n_bands; i++)
+    {
+      GimpSpansBand *band = &g_array_index (spans->bands, GimpSpansBand, i);
+
+      if (band->y1 < y2)
+        {
+          gimp_spans_append (bands, y2, band->y2,
+                             gimp_spans_copy_row (band->spans));
+          continue;
+        }
+
+      gimp_spans_append (bands, band->y1, band->y2, band->spans);
+      band->spans = NULL;
+    }
+
+  for (i = 0; i < n_bands; i++)
+    {
+      GimpSpansBand *band = &g_array_index (spans->bands, GimpSpansBand, i);
+
+      if (band->spans)
+        g_array_free (band->spans, TRUE);
+    }
+
+  g_array_free (spans->bands, TRUE);
+
+  spans->bands = bands;
+}
+
+static GArray *
+gimp_spans_copy_row (const GArray *row)
+{
+  GArray *copy = g_array_sized_new (FALSE, FALSE, sizeof (gint), row->len);
+
+  g_array_append_vals (copy, row->data, row->len);
+
+  return copy;
+}
+
+/*  returns a new row, the spans of @row combined with [x1, x2)  */
+static GArray *
+gimp_spans_combine_row (const GArray   *row,
+                        GimpChannelOps  op,
+                        gint            x1,
+                        gint            x2)
+{
+  const gint *span   = row ? (const gint *) row->data : NULL;
+  guint       len    = row ? row->len : 0;
+  GArray     *result = g_array_sized_new (FALSE, FALSE, sizeof (gint),
+                                          len + 2);
+  guint       i;
+
+  if (x1 >= x2)
+    {
+      g_array_append_vals (result, span, len);
+
+      return result;
+    }
+
+  switch (op)
+    {
+    case GIMP_CHANNEL_OP_ADD:
+    case GIMP_CHANNEL_OP_REPLACE:
+      /*  the spans before, merge the overlapping and touching ones,
+       *  then the spans after
+       */
+      for (i = 0; i < len && span[i + 1] < x1; i += 2)
+        g_array_append_vals (result, span + i, 2);
+
+      for (; i < len && span[i] <= x2; i += 2)
+        {
+          x1 = MIN (x1, span[i]);
+          x2 = MAX (x2, span[i + 1]);
+        }
+
+      g_array_append_val (result, x1);
+      g_array_append_val (result, x2);
+
+      g_array_append_vals (result, span + i, len - i);
+      break;
+
+    case GIMP_CHANNEL_OP_SUBTRACT:
+    case GIMP_CHANNEL_OP_INTERSECT:
+      for (i = 0; i < len; i += 2)
+        {
+          if (span[i] < x1)
+            {
+              gint end = MIN (span[i + 1], x1);
+
+              g_array_append_val (result, span[i]);
+              g_array_append_val (result, end);
+            }
+
+          if (span[i + 1] > x2)
+            {
+              gint start = MAX (span[i], x2);
+
+              g_array_append_val (result, start);
+              g_array_append_val (result, span[i + 1]);
+            }
+        }
+      break;
+    }
+
+  return result;
+}
+
+/*  appends the rows [y1, y2) with spans @row to @bands, taking
+ *  ownership of @row.  rows without spans are dropped, and the band
+ *  is merged into the last one if they have the same spans.
+ */
+static void
+gimp_spans_append (GArray *bands,
+                   gint    y1,
+                   gint    y2,
+                   GArray *row)
+{
+  GimpSpansBand band;
+
+  if (row->len == 0 || y1 >= y2)
+    {
+      g_array_free (row, TRUE);
+      return;
+    }
+
+  if (bands->len > 0)
+    {
+      GimpSpansBand *last = &g_array_index (bands, GimpSpansBand,
+                                            bands->len - 1);
+
+      if (last->y2 == y1                 &&
+          last->spans->len == row->len   &&
+          ! memcmp (last->spans->data, row->data, row->len * sizeof (gint)))
+        {
+          last->y2 = y2;
+
+          g_array_free (row, TRUE);
+          return;
+        }
+    }
+
+  band.y1    = y1;
+  band.y2    = y2;
+  band.spans = row;
+
+  g_array_append_val (bands, band);
+}
+
+/*  returns the index of the first band ending below row y  */
+static gint
+gimp_spans_find_band (const GimpSpans *spans,
+                      gint             y)
+{
+  gint lo = 0;
+  gint hi = spans->bands->len;
+
+  while (lo < hi)
+    {
+      gint mid = (lo + hi) / 2;
+
+      if (g_array_index (spans->bands, GimpSpansBand, mid).y2 <= y)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+static void
+rect_row_func (gint  y,
+               gint *x1,
+               gint *x2,
+               gint *rect)
+{
+  *x1 = rect[0];
+  *x2 = rect[1];
+}
+
+static void
+ellipse_rect_row_func (gint             y,
+                       gint            *x1,
+                       gint            *x2,
+                       EllipseRectData *data)
+{
+  gimp_gegl_mask_get_ellipse_rect_span (data->x, data->y, data->w, data->h,
+                                        data->a, data->b, y, x1, x2);
+
+  *x1 = MAX (*x1, data->x0);
+  *x2 = MIN (*x2, data->x1);
+
+  /*  an empty span is the same on all rows it's empty on  */
+  if (*x1 >= *x2)
+    *x1 = *x2 = 0;
+}
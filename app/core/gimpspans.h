@@ -0,0 +1,66 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpspans.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_SPANS_H__
+#define __GIMP_SPANS_H__
+
+
+GimpSpans  * gimp_spans_new                  (gint             width,
+                                              gint             height);
+GimpSpans  * gimp_spans_copy                 (const GimpSpans *spans);
+void         gimp_spans_free                 (GimpSpans       *spans);
+
+gint         gimp_spans_get_width            (const GimpSpans *spans);
+gint         gimp_spans_get_height           (const GimpSpans *spans);
+
+gint64       gimp_spans_get_memsize          (const GimpSpans *spans);
+
+void         gimp_spans_combine_rect         (GimpSpans       *spans,
+                                              GimpChannelOps   op,
+                                              gint             x,
+                                              gint             y,
+                                              gint             w,
+                                              gint             h);
+void         gimp_spans_combine_ellipse_rect (GimpSpans       *spans,
+                                              GimpChannelOps   op,
+                                              gint             x,
+                                              gint             y,
+                                              gint             w,
+                                              gint             h,
+                                              gdouble          a,
+                                              gdouble          b);
+
+gboolean     gimp_spans_is_empty             (const GimpSpans *spans);
+gboolean     gimp_spans_bounds               (const GimpSpans *spans,
+                                              gint            *x1,
+                                              gint            *y1,
+                                              gint            *x2,
+                                              gint            *y2);
+gboolean     gimp_spans_get_value            (const GimpSpans *spans,
+                                              gint             x,
+                                              gint             y);
+const gint * gimp_spans_get_row              (const GimpSpans *spans,
+                                              gint             y,
+                                              gint            *n_spans);
+
+void         gimp_spans_render               (const GimpSpans *spans,
+                                              GeglBuffer      *buffer);
+
+
+#endif /* __GIMP_SPANS_H__ */
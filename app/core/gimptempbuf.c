@@ -29,19 +29,63 @@
 
 #include "libgimpcolor/gimpcolor.h"
 
+#include "gimp-allocation.h"
 #include "gimptempbuf.h"
 
 
+/*  the data of temporary buffers is allocated from a pool of free blocks,
+ *  binned into size classes, so that the same-sized buffers allocated for
+ *  each dab of a stroke reuse memory instead of going through malloc ()
+ *  and page faults every time.  small and very large blocks bypass the
+ *  pool.
+ */
+#define POOL_MIN_BLOCK_SHIFT  10                        /* blocks > 1 KiB   */
+#define POOL_MAX_BLOCK_SHIFT  24                        /* blocks <= 16 MiB */
+#define POOL_SUB_CLASSES      4                         /* per power of two */
+#define POOL_N_CLASSES        ((POOL_MAX_BLOCK_SHIFT - POOL_MIN_BLOCK_SHIFT) * \
+                               POOL_SUB_CLASSES)
+#define POOL_MAX_SIZE         (32 * 1024 * 1024)        /* of free blocks   */
+
+
+typedef struct _GimpTempBufBlock GimpTempBufBlock;
+
+struct _GimpTempBufBlock
+{
+  GimpTempBufBlock *next;
+};
+
 struct _GimpTempBuf
 {
-  gint        ref_count;
-  gint        width;
-  gint        height;
-  const Babl *format;
-  guchar     *data;
+  gint            ref_count;
+  gint            width;
+  gint            height;
+  const Babl     *format;
+  guchar         *data;
+  GimpAllocation  allocation;
 };
 
 
+/*  local function prototypes  */
+
+static gint     gimp_temp_buf_pool_get_class (gsize     size,
+                                              gsize    *block_size);
+static gpointer gimp_temp_buf_pool_alloc     (gsize     size);
+static void     gimp_temp_buf_pool_free      (gpointer  data,
+                                              gsize     size);
+
+
+/*  local variables  */
+
+static GMutex            pool_mutex;
+static GimpTempBufBlock *pool_blocks[POOL_N_CLASSES];
+static guint64           pool_size;
+static guint64           total_size;
+static guint64           pool_hits;
+static guint64           pool_misses;
+
+
+/*  public functions  */
+
 GimpTempBuf *
 gimp_temp_buf_new (gint        width,
                    gint        height,
@@ -59,11 +103,14 @@ gimp_temp_buf_new (gint        width,
 
   temp = g_slice_new (GimpTempBuf);
 
-  temp->ref_count = 1;
-  temp->width     = width;
-  temp->height    = height;
-  temp->format    = format;
-  temp->data      = gegl_malloc ((gsize) width * height * bpp);
+  temp->ref_count  = 1;
+  temp->width      = width;
+  temp->height     = height;
+  temp->format     = format;
+  temp->data       = gimp_temp_buf_pool_alloc ((gsize) width * height * bpp);
+  temp->allocation = GIMP_ALLOCATION_TEMP_BUF;
+
+  gimp_allocation_add (temp->allocation, (gsize) width * height * bpp);
 
   return temp;
 }
@@ -152,7 +199,11 @@ gimp_temp_buf_unref (GimpTempBuf *buf)
   if (buf->ref_count < 1)
     {
       if (buf->data)
-        gegl_free (buf->data);
+        gimp_temp_buf_pool_free (buf->data,
+                                 gimp_temp_buf_get_data_size (buf));
+
+      gimp_allocation_add (buf->allocation,
+                           - (gint64) gimp_temp_buf_get_data_size (buf));
 
       g_slice_free (GimpTempBuf, buf);
     }
@@ -262,6 +313,24 @@ gimp_temp_buf_data_clear (GimpTempBuf *buf)
   return buf->data;
 }
 
+/*  accounts the buffer's memory to another subsystem than temporary
+ *  buffers, when it is kept around, e.g. in a cache
+ */
+void
+gimp_temp_buf_set_allocation (GimpTempBuf    *buf,
+                              GimpAllocation  allocation)
+{
+  g_return_if_fail (buf != NULL);
+
+  if (allocation != buf->allocation)
+    {
+      gimp_allocation_move (buf->allocation, allocation,
+                            gimp_temp_buf_get_data_size (buf));
+
+      buf->allocation = allocation;
+    }
+}
+
 gsize
 gimp_temp_buf_get_memsize (const GimpTempBuf *buf)
 {
@@ -346,3 +415,165 @@ gimp_gegl_buffer_get_temp_buf (GeglBuffer *buffer)
 
   return g_object_get_data (G_OBJECT (buffer), "gimp-temp-buf");
 }
+
+void
+gimp_temp_buf_get_pool_stats (guint64 *total,
+                              guint64 *pooled,
+                              guint64 *hits,
+                              guint64 *misses)
+{
+  g_mutex_lock (&pool_mutex);
+
+  if (total)  *total  = total_size;
+  if (pooled) *pooled = pool_size;
+  if (hits)   *hits   = pool_hits;
+  if (misses) *misses = pool_misses;
+
+  g_mutex_unlock (&pool_mutex);
+}
+
+guint64
+gimp_temp_buf_get_pool_limit (void)
+{
+  return POOL_MAX_SIZE;
+}
+
+/*  frees all blocks kept in the pool, and returns their size  */
+guint64
+gimp_temp_buf_release_pool (void)
+{
+  GimpTempBufBlock *blocks[POOL_N_CLASSES];
+  guint64           released = 0;
+  gint              i;
+
+  g_mutex_lock (&pool_mutex);
+
+  for (i = 0; i < POOL_N_CLASSES; i++)
+    {
+      blocks[i]      = pool_blocks[i];
+      pool_blocks[i] = NULL;
+    }
+
+  released    = pool_size;
+  total_size -= pool_size;
+  pool_size   = 0;
+
+  g_mutex_unlock (&pool_mutex);
+
+  for (i = 0; i < POOL_N_CLASSES; i++)
+    {
+      while (blocks[i])
+        {
+          GimpTempBufBlock *block = blocks[i];
+
+          blocks[i] = block->next;
+
+          gegl_free (block);
+        }
+    }
+
+  return released;
+}
+
+
+/*  private functions  */
+
+static gint
+gimp_temp_buf_pool_get_class (gsize  size,
+                              gsize *block_size)
+{
+  gsize base;
+  gsize step;
+  gint  shift;
+  gint  sub_class;
+
+  if (size <= ((gsize) 1 << POOL_MIN_BLOCK_SHIFT) ||
+      size >  ((gsize) 1 << POOL_MAX_BLOCK_SHIFT))
+    {
+      *block_size = size;
+
+      return -1;
+    }
+
+  /*  the smallest of the POOL_SUB_CLASSES equally spaced sizes in
+   *  (2^shift, 2^(shift+1)] which fits 'size'
+   */
+  shift     = g_bit_nth_msf (size - 1, -1);
+  base      = (gsize) 1 << shift;
+  step      = base / POOL_SUB_CLASSES;
+  sub_class = (size - base + step - 1) / step;
+
+  *block_size = base + sub_class * step;
+
+  return (shift - POOL_MIN_BLOCK_SHIFT) * POOL_SUB_CLASSES + sub_class - 1;
+}
+
+static gpointer
+gimp_temp_buf_pool_alloc (gsize size)
+{
+  GimpTempBufBlock *block = NULL;
+  gsize             block_size;
+  gint              pool_class;
+
+  pool_class = gimp_temp_buf_pool_get_class (size, &block_size);
+
+  g_mutex_lock (&pool_mutex);
+
+  if (pool_class >= 0)
+    {
+      block = pool_blocks[pool_class];
+
+      if (block)
+        {
+          pool_blocks[pool_class] = block->next;
+          pool_size              -= block_size;
+
+          pool_hits++;
+        }
+      else
+        {
+          pool_misses++;
+        }
+    }
+
+  if (! block)
+    total_size += block_size;
+
+  g_mutex_unlock (&pool_mutex);
+
+  if (! block)
+    block = gegl_malloc (block_size);
+
+  return block;
+}
+
+static void
+gimp_temp_buf_pool_free (gpointer data,
+                         gsize    size)
+{
+  gsize block_size;
+  gint  pool_class;
+
+  pool_class = gimp_temp_buf_pool_get_class (size, &block_size);
+
+  g_mutex_lock (&pool_mutex);
+
+  if (pool_class >= 0 && pool_size + block_size <= POOL_MAX_SIZE)
+    {
+      GimpTempBufBlock *block = data;
+
+      block->next             = pool_blocks[pool_class];
+      pool_blocks[pool_class] = block;
+      pool_size              += block_size;
+
+      g_mutex_unlock (&pool_mutex);
+
+      return;
+    }
+
+  total_size -= block_size;
+
+  g_mutex_unlock (&pool_mutex);
+
+  gegl_free (data);
+}
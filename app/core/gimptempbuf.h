@@ -45,6 +45,9 @@ gsize         gimp_temp_buf_get_data_size   (const GimpTempBuf *buf);
 
 guchar      * gimp_temp_buf_data_clear      (GimpTempBuf       *buf);
 
+void          gimp_temp_buf_set_allocation  (GimpTempBuf       *buf,
+                                             GimpAllocation     allocation);
+
 gsize         gimp_temp_buf_get_memsize     (const GimpTempBuf *buf);
 
 GeglBuffer  * gimp_temp_buf_create_buffer   (GimpTempBuf       *temp_buf) G_GNUC_WARN_UNUSED_RESULT;
@@ -52,6 +55,13 @@ GdkPixbuf   * gimp_temp_buf_create_pixbuf   (GimpTempBuf       *temp_buf) G_GNUC
 
 GimpTempBuf * gimp_gegl_buffer_get_temp_buf (GeglBuffer        *buffer);
 
+void          gimp_temp_buf_get_pool_stats  (guint64           *total,
+                                             guint64           *pooled,
+                                             guint64           *hits,
+                                             guint64           *misses);
+guint64       gimp_temp_buf_get_pool_limit  (void);
+guint64       gimp_temp_buf_release_pool    (void);
+
 
 
 #endif  /*  __GIMP_TEMP_BUF_H__  */
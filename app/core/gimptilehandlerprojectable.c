@@ -29,6 +29,7 @@
 
 static void   gimp_tile_handler_projectable_validate (GimpTileHandlerValidate *validate,
                                                       const GeglRectangle     *rect,
+                                                      gdouble                  scale,
                                                       const Babl              *format,
                                                       gpointer                 dest_buf,
                                                       gint                     dest_stride);
@@ -58,6 +59,7 @@ gimp_tile_handler_projectable_init (GimpTileHandlerProjectable *projectable)
 static void
 gimp_tile_handler_projectable_validate (GimpTileHandlerValidate *validate,
                                         const GeglRectangle     *rect,
+                                        gdouble                  scale,
                                         const Babl              *format,
                                         gpointer                 dest_buf,
                                         gint                     dest_stride)
@@ -69,7 +71,7 @@ gimp_tile_handler_projectable_validate (GimpTileHandlerValidate *validate,
 
   gimp_projectable_begin_render (handler->projectable);
 
-  gegl_node_blit (graph, 1.0, rect, format,
+  gegl_node_blit (graph, scale, rect, format,
                   dest_buf, dest_stride,
                   GEGL_BLIT_DEFAULT);
 
@@ -83,7 +85,9 @@ gimp_tile_handler_projectable_new (GimpProjectable *projectable)
 
   g_return_val_if_fail (GIMP_IS_PROJECTABLE (projectable), NULL);
 
-  handler = g_object_new (GIMP_TYPE_TILE_HANDLER_PROJECTABLE, NULL);
+  handler = g_object_new (GIMP_TYPE_TILE_HANDLER_PROJECTABLE,
+                          "render-levels", TRUE,
+                          NULL);
 
   handler->projectable = projectable;
 
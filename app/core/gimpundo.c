@@ -143,6 +143,7 @@ gimp_undo_class_init (GimpUndoClass *klass)
 
   klass->pop                        = gimp_undo_real_pop;
   klass->free                       = gimp_undo_real_free;
+  klass->spill                      = NULL;
 
   g_object_class_install_property (object_class, PROP_IMAGE,
                                    g_param_spec_object ("image", NULL, NULL,
@@ -174,7 +175,8 @@ gimp_undo_class_init (GimpUndoClass *klass)
 static void
 gimp_undo_init (GimpUndo *undo)
 {
-  undo->time = time (NULL);
+  undo->time    = time (NULL);
+  undo->memsize = -1;
 }
 
 static void
@@ -380,6 +382,58 @@ gimp_undo_free (GimpUndo     *undo,
   g_signal_emit (undo, undo_signals[FREE], 0, undo_mode);
 }
 
+/*  moves the undo's pixel data to disk, so that it no longer counts
+ *  towards the undo memory, and returns the size of the moved data.
+ *  only the first call has an effect.
+ */
+gint64
+gimp_undo_spill (GimpUndo *undo)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), 0);
+
+  if (! undo->spilled)
+    {
+      undo->spilled = TRUE;
+
+      if (GIMP_UNDO_GET_CLASS (undo)->spill)
+        undo->disk_size = GIMP_UNDO_GET_CLASS (undo)->spill (undo);
+
+      gimp_undo_memsize_changed (undo);
+    }
+
+  return undo->disk_size;
+}
+
+/*  returns the undo's memsize like gimp_object_get_memsize(), but only
+ *  computes it again after gimp_undo_memsize_changed() was called, so
+ *  that summing up a long undo stack doesn't walk all of its contents.
+ */
+gint64
+gimp_undo_get_cached_memsize (GimpUndo *undo,
+                              gint64   *gui_size)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), 0);
+
+  if (undo->memsize < 0)
+    {
+      undo->memsize = gimp_object_get_memsize (GIMP_OBJECT (undo),
+                                               &undo->gui_memsize);
+    }
+
+  if (gui_size)
+    *gui_size = undo->gui_memsize;
+
+  return undo->memsize;
+}
+
+void
+gimp_undo_memsize_changed (GimpUndo *undo)
+{
+  g_return_if_fail (GIMP_IS_UNDO (undo));
+
+  undo->memsize = -1;
+}
+
 typedef struct _GimpUndoIdle GimpUndoIdle;
 
 struct _GimpUndoIdle
@@ -494,6 +548,8 @@ gimp_undo_create_preview_private (GimpUndo    *undo,
   undo->preview = gimp_viewable_get_new_preview (preview_viewable, context,
                                                  width, height);
 
+  gimp_undo_memsize_changed (undo);
+
   gimp_viewable_invalidate_preview (GIMP_VIEWABLE (undo));
 }
 
@@ -510,6 +566,8 @@ gimp_undo_refresh_preview (GimpUndo    *undo,
   if (undo->preview)
     {
       g_clear_pointer (&undo->preview, gimp_temp_buf_unref);
+      gimp_undo_memsize_changed (undo);
+
       gimp_undo_create_preview (undo, context, FALSE);
     }
 }
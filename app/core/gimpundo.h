@@ -61,6 +61,12 @@ struct _GimpUndo
 
   GimpTempBuf      *preview;
   guint             preview_idle_id;
+
+  gboolean          spilled;        /* was the undo moved to disk         */
+  gint64            disk_size;      /* size of the data moved to disk     */
+
+  gint64            memsize;        /* cached memsize, or -1              */
+  gint64            gui_memsize;    /* cached gui memsize                 */
 };
 
 struct _GimpUndoClass
@@ -70,8 +76,10 @@ struct _GimpUndoClass
   void (* pop)  (GimpUndo            *undo,
                  GimpUndoMode         undo_mode,
                  GimpUndoAccumulator *accum);
-  void (* free) (GimpUndo            *undo,
-                 GimpUndoMode         undo_mode);
+  void   (* free)  (GimpUndo            *undo,
+                    GimpUndoMode         undo_mode);
+
+  gint64 (* spill) (GimpUndo            *undo);
 };
 
 
@@ -82,6 +90,12 @@ void          gimp_undo_pop             (GimpUndo            *undo,
                                          GimpUndoAccumulator *accum);
 void          gimp_undo_free            (GimpUndo            *undo,
                                          GimpUndoMode         undo_mode);
+gint64        gimp_undo_spill           (GimpUndo            *undo);
+
+gint64        gimp_undo_get_cached_memsize
+                                        (GimpUndo            *undo,
+                                         gint64              *gui_size);
+void          gimp_undo_memsize_changed (GimpUndo            *undo);
 
 void          gimp_undo_create_preview  (GimpUndo            *undo,
                                          GimpContext         *context,
@@ -22,6 +22,7 @@
 
 #include "core-types.h"
 
+#include "gimp-memsize.h"
 #include "gimpimage.h"
 #include "gimplist.h"
 #include "gimpundo.h"
@@ -38,6 +39,7 @@ static void    gimp_undo_stack_pop         (GimpUndo            *undo,
                                             GimpUndoAccumulator *accum);
 static void    gimp_undo_stack_free        (GimpUndo            *undo,
                                             GimpUndoMode         undo_mode);
+static gint64  gimp_undo_stack_spill       (GimpUndo            *undo);
 
 
 G_DEFINE_TYPE (GimpUndoStack, gimp_undo_stack, GIMP_TYPE_UNDO)
@@ -58,6 +60,7 @@ gimp_undo_stack_class_init (GimpUndoStackClass *klass)
 
   undo_class->pop                = gimp_undo_stack_pop;
   undo_class->free               = gimp_undo_stack_free;
+  undo_class->spill              = gimp_undo_stack_spill;
 }
 
 static void
@@ -83,7 +86,12 @@ gimp_undo_stack_get_memsize (GimpObject *object,
   GimpUndoStack *stack   = GIMP_UNDO_STACK (object);
   gint64         memsize = 0;
 
-  memsize += gimp_object_get_memsize (GIMP_OBJECT (stack->undos), gui_size);
+  /*  use the undos' cached memsizes, instead of walking their contents  */
+  memsize += gimp_g_object_get_memsize (G_OBJECT (stack->undos));
+  memsize += gimp_g_queue_get_memsize_foreach (GIMP_LIST (stack->undos)->queue,
+                                               (GimpMemsizeFunc)
+                                               gimp_undo_get_cached_memsize,
+                                               gui_size);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -127,6 +135,25 @@ gimp_undo_stack_free (GimpUndo     *undo,
   gimp_container_clear (stack->undos);
 }
 
+static gint64
+gimp_undo_stack_spill (GimpUndo *undo)
+{
+  GimpUndoStack *stack     = GIMP_UNDO_STACK (undo);
+  gint64         disk_size = 0;
+  GList         *list;
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      disk_size += gimp_undo_spill (child);
+    }
+
+  return disk_size;
+}
+
 GimpUndoStack *
 gimp_undo_stack_new (GimpImage *image)
 {
@@ -145,6 +172,9 @@ gimp_undo_stack_push_undo (GimpUndoStack *stack,
   g_return_if_fail (GIMP_IS_UNDO (undo));
 
   gimp_container_add (stack->undos, GIMP_OBJECT (undo));
+
+  gimp_undo_memsize_changed (undo);
+  gimp_undo_memsize_changed (GIMP_UNDO (stack));
 }
 
 GimpUndo *
@@ -164,6 +194,8 @@ gimp_undo_stack_pop_undo (GimpUndoStack       *stack,
       gimp_container_remove (stack->undos, GIMP_OBJECT (undo));
       gimp_undo_pop (undo, undo_mode, accum);
 
+      gimp_undo_memsize_changed (GIMP_UNDO (stack));
+
       return undo;
     }
 
@@ -185,6 +217,8 @@ gimp_undo_stack_free_bottom (GimpUndoStack *stack,
       gimp_container_remove (stack->undos, GIMP_OBJECT (undo));
       gimp_undo_free (undo, undo_mode);
 
+      gimp_undo_memsize_changed (GIMP_UNDO (stack));
+
       return undo;
     }
 
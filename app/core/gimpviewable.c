@@ -32,6 +32,7 @@
 
 #include "core-types.h"
 
+#include "gimp-allocation.h"
 #include "gimp-memsize.h"
 #include "gimpcontainer.h"
 #include "gimpcontext.h"
@@ -894,6 +895,9 @@ gimp_viewable_get_preview (GimpViewable *viewable,
     temp_buf = viewable_class->get_new_preview (viewable, context,
                                                 width, height);
 
+  if (temp_buf)
+    gimp_temp_buf_set_allocation (temp_buf, GIMP_ALLOCATION_CACHE);
+
   private->preview_temp_buf = temp_buf;
 
   return temp_buf;
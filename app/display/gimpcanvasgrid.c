@@ -35,6 +35,7 @@
 #include "gimpcanvas-style.h"
 #include "gimpcanvasgrid.h"
 #include "gimpdisplayshell.h"
+#include "gimpdisplayshell-transform.h"
 
 
 enum
@@ -70,6 +71,14 @@ static void             gimp_canvas_grid_get_property (GObject        *object,
                                                        guint           property_id,
                                                        GValue         *value,
                                                        GParamSpec     *pspec);
+static gint           * gimp_canvas_grid_get_lines    (GimpCanvasItem *item,
+                                                       gboolean        vertical,
+                                                       gdouble         offset,
+                                                       gdouble         spacing,
+                                                       gdouble         lo,
+                                                       gdouble         hi,
+                                                       gboolean        include_hi,
+                                                       gint           *n_lines);
 static void             gimp_canvas_grid_draw         (GimpCanvasItem *item,
                                                        cairo_t        *cr);
 static cairo_region_t * gimp_canvas_grid_get_extents  (GimpCanvasItem *item);
@@ -178,6 +187,57 @@ gimp_canvas_grid_get_property (GObject    *object,
     }
 }
 
+/*  returns the display coordinates of the grid lines at image
+ *  coordinates offset + i * spacing which lie within [lo, hi], or
+ *  [lo, hi) if ! include_hi, so that only the grid lines intersecting
+ *  the exposed area need to be visited and transformed
+ */
+static gint *
+gimp_canvas_grid_get_lines (GimpCanvasItem *item,
+                            gboolean        vertical,
+                            gdouble         offset,
+                            gdouble         spacing,
+                            gdouble         lo,
+                            gdouble         hi,
+                            gboolean        include_hi,
+                            gint           *n_lines)
+{
+  gint   *lines;
+  gint64  i, i_min, i_max;
+
+  i_min = MAX (ceil ((lo - offset) / spacing), 0);
+  i_max = floor ((hi - offset) / spacing);
+
+  *n_lines = 0;
+
+  if (i_max < i_min)
+    return NULL;
+
+  lines = g_new (gint, i_max - i_min + 1);
+
+  for (i = i_min; i <= i_max; i++)
+    {
+      gdouble pos = offset + i * spacing;
+      gint    x_real, y_real;
+
+      if (pos < lo || pos > hi || (pos == hi && ! include_hi))
+        continue;
+
+      if (vertical)
+        {
+          gimp_canvas_item_transform_xy (item, pos, 0, &x_real, &y_real);
+          lines[(*n_lines)++] = x_real;
+        }
+      else
+        {
+          gimp_canvas_item_transform_xy (item, 0, pos, &x_real, &y_real);
+          lines[(*n_lines)++] = y_real;
+        }
+    }
+
+  return lines;
+}
+
 static void
 gimp_canvas_grid_draw (GimpCanvasItem *item,
                        cairo_t        *cr)
@@ -188,12 +248,17 @@ gimp_canvas_grid_draw (GimpCanvasItem *item,
   gdouble                xspacing, yspacing;
   gdouble                xoffset, yoffset;
   gboolean               vert, horz;
-  gdouble                x, y;
   gdouble                dx1, dy1, dx2, dy2;
+  gdouble                ix1, iy1, ix2, iy2;
   gint                   x0, x1, x2, x3;
   gint                   y0, y1, y2, y3;
-  gint                   x_real, y_real;
   gint                   width, height;
+  gint                  *xs = NULL;
+  gint                  *ys = NULL;
+  gint                   n_xs = 0;
+  gint                   n_ys = 0;
+  gboolean               inclusive;
+  gint                   i, j;
 
 #define CROSSHAIR 2
 
@@ -225,27 +290,51 @@ gimp_canvas_grid_draw (GimpCanvasItem *item,
   xoffset = fmod (xoffset, xspacing);
   yoffset = fmod (yoffset, yspacing);
 
+  /*  the exposed area in image coordinates, grown by the crosshair
+   *  size and a pixel for rounding
+   */
+  gimp_display_shell_unzoom_xy_f (shell,
+                                  x1 - CROSSHAIR - 1, y1 - CROSSHAIR - 1,
+                                  &ix1, &iy1);
+  gimp_display_shell_unzoom_xy_f (shell,
+                                  x2 + CROSSHAIR + 1, y2 + CROSSHAIR + 1,
+                                  &ix2, &iy2);
+
+  /*  dots and intersections are drawn on the image's right and bottom
+   *  edges too, lines aren't
+   */
+  inclusive = (gimp_grid_get_style (private->grid) == GIMP_GRID_DOTS ||
+               gimp_grid_get_style (private->grid) == GIMP_GRID_INTERSECTIONS);
+
+  if (vert)
+    xs = gimp_canvas_grid_get_lines (item, TRUE, xoffset, xspacing,
+                                     MAX (ix1, 0),
+                                     MIN (ix2, width),
+                                     inclusive || ix2 < width,
+                                     &n_xs);
+
+  if (horz)
+    ys = gimp_canvas_grid_get_lines (item, FALSE, yoffset, yspacing,
+                                     MAX (iy1, 0),
+                                     MIN (iy2, height),
+                                     inclusive || iy2 < height,
+                                     &n_ys);
+
   switch (gimp_grid_get_style (private->grid))
     {
     case GIMP_GRID_DOTS:
       if (vert && horz)
         {
-          for (x = xoffset; x <= width; x += xspacing)
+          for (i = 0; i < n_xs; i++)
             {
-              if (x < 0)
-                continue;
-
-              gimp_canvas_item_transform_xy (item, x, 0, &x_real, &y_real);
+              gint x_real = xs[i];
 
               if (x_real < x1 || x_real >= x2)
                 continue;
 
-              for (y = yoffset; y <= height; y += yspacing)
+              for (j = 0; j < n_ys; j++)
                 {
-                  if (y < 0)
-                    continue;
-
-                  gimp_canvas_item_transform_xy (item, x, y, &x_real, &y_real);
+                  gint y_real = ys[j];
 
                   if (y_real >= y1 && y_real < y2)
                     {
@@ -260,22 +349,16 @@ gimp_canvas_grid_draw (GimpCanvasItem *item,
     case GIMP_GRID_INTERSECTIONS:
       if (vert && horz)
         {
-          for (x = xoffset; x <= width; x += xspacing)
+          for (i = 0; i < n_xs; i++)
             {
-              if (x < 0)
-                continue;
-
-              gimp_canvas_item_transform_xy (item, x, 0, &x_real, &y_real);
+              gint x_real = xs[i];
 
               if (x_real + CROSSHAIR < x1 || x_real - CROSSHAIR >= x2)
                 continue;
 
-              for (y = yoffset; y <= height; y += yspacing)
+              for (j = 0; j < n_ys; j++)
                 {
-                  if (y < 0)
-                    continue;
-
-                  gimp_canvas_item_transform_xy (item, x, y, &x_real, &y_real);
+                  gint y_real = ys[j];
 
                   if (y_real + CROSSHAIR < y1 || y_real - CROSSHAIR >= y2)
                     continue;
@@ -314,42 +397,33 @@ gimp_canvas_grid_draw (GimpCanvasItem *item,
       gimp_canvas_item_transform_xy (item, 0, 0, &x0, &y0);
       gimp_canvas_item_transform_xy (item, width, height, &x3, &y3);
 
-      if (vert)
+      for (i = 0; i < n_xs; i++)
         {
-          for (x = xoffset; x < width; x += xspacing)
-            {
-              if (x < 0)
-                continue;
-
-              gimp_canvas_item_transform_xy (item, x, 0, &x_real, &y_real);
+          gint x_real = xs[i];
 
-              if (x_real >= x1 && x_real < x2)
-                {
-                  cairo_move_to (cr, x_real + 0.5, y0);
-                  cairo_line_to (cr, x_real + 0.5, y3 + 1);
-                }
+          if (x_real >= x1 && x_real < x2)
+            {
+              cairo_move_to (cr, x_real + 0.5, y0);
+              cairo_line_to (cr, x_real + 0.5, y3 + 1);
             }
         }
 
-      if (horz)
+      for (j = 0; j < n_ys; j++)
         {
-          for (y = yoffset; y < height; y += yspacing)
-            {
-              if (y < 0)
-                continue;
+          gint y_real = ys[j];
 
-              gimp_canvas_item_transform_xy (item, 0, y, &x_real, &y_real);
-
-              if (y_real >= y1 && y_real < y2)
-                {
-                  cairo_move_to (cr, x0,     y_real + 0.5);
-                  cairo_line_to (cr, x3 + 1, y_real + 0.5);
-                }
+          if (y_real >= y1 && y_real < y2)
+            {
+              cairo_move_to (cr, x0,     y_real + 0.5);
+              cairo_line_to (cr, x3 + 1, y_real + 0.5);
             }
         }
       break;
     }
 
+  g_free (xs);
+  g_free (ys);
+
   _gimp_canvas_item_stroke (item, cr);
 }
 
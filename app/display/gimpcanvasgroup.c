@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <math.h>
+
 #include <gegl.h>
 #include <gtk/gtk.h>
 
@@ -28,6 +30,8 @@
 
 #include "display-types.h"
 
+#include "core/gimpimage.h"
+
 #include "gimpcanvasgroup.h"
 #include "gimpdisplayshell.h"
 
@@ -42,9 +46,24 @@ enum
 
 struct _GimpCanvasGroupPrivate
 {
-  GQueue   *items;
-  gboolean  group_stroking;
-  gboolean  group_filling;
+  GQueue     *items;
+  gboolean    group_stroking;
+  gboolean    group_filling;
+
+  /*  the extents of the children, dropped when a child updates or the
+   *  view changes, so unchanged children outside the exposed area can
+   *  be skipped without asking them for their extents again
+   */
+  GHashTable *extents;
+  gdouble     scale_x;
+  gdouble     scale_y;
+  gint        offset_x;
+  gint        offset_y;
+  gdouble     rotate_angle;
+  gboolean    flip_horizontally;
+  gboolean    flip_vertically;
+  gint        image_width;
+  gint        image_height;
 };
 
 
@@ -70,6 +89,11 @@ static void             gimp_canvas_group_child_update (GimpCanvasItem  *item,
                                                         cairo_region_t  *region,
                                                         GimpCanvasGroup *group);
 
+static void             gimp_canvas_group_check_view   (GimpCanvasGroup *group);
+static cairo_region_t * gimp_canvas_group_child_extents
+                                                       (GimpCanvasGroup *group,
+                                                        GimpCanvasItem  *item);
+
 
 G_DEFINE_TYPE (GimpCanvasGroup, gimp_canvas_group, GIMP_TYPE_CANVAS_ITEM)
 
@@ -112,7 +136,11 @@ gimp_canvas_group_init (GimpCanvasGroup *group)
                                              GIMP_TYPE_CANVAS_GROUP,
                                              GimpCanvasGroupPrivate);
 
-  group->priv->items = g_queue_new ();
+  group->priv->items   = g_queue_new ();
+  group->priv->extents = g_hash_table_new_full (g_direct_hash,
+                                                g_direct_equal,
+                                                NULL,
+                                                (GDestroyNotify) cairo_region_destroy);
 }
 
 static void
@@ -127,6 +155,8 @@ gimp_canvas_group_finalize (GObject *object)
   g_queue_free (group->priv->items);
   group->priv->items = NULL;
 
+  g_clear_pointer (&group->priv->extents, g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -180,12 +210,37 @@ static void
 gimp_canvas_group_draw (GimpCanvasItem *item,
                         cairo_t        *cr)
 {
-  GimpCanvasGroup *group = GIMP_CANVAS_GROUP (item);
-  GList           *list;
+  GimpCanvasGroup       *group = GIMP_CANVAS_GROUP (item);
+  GList                 *list;
+  cairo_rectangle_int_t  clip;
+  gdouble                x1, y1, x2, y2;
+
+  gimp_canvas_group_check_view (group);
+
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+
+  x1 = CLAMP (floor (x1), -G_MAXINT / 4, G_MAXINT / 4);
+  y1 = CLAMP (floor (y1), -G_MAXINT / 4, G_MAXINT / 4);
+  x2 = CLAMP (ceil  (x2), -G_MAXINT / 4, G_MAXINT / 4);
+  y2 = CLAMP (ceil  (y2), -G_MAXINT / 4, G_MAXINT / 4);
+
+  clip.x      = x1;
+  clip.y      = y1;
+  clip.width  = x2 - x1;
+  clip.height = y2 - y1;
 
   for (list = group->priv->items->head; list; list = g_list_next (list))
     {
       GimpCanvasItem *sub_item = list->data;
+      cairo_region_t *region;
+
+      /*  items without extents are always drawn  */
+      region = gimp_canvas_group_child_extents (group, sub_item);
+
+      if (region &&
+          cairo_region_contains_rectangle (region,
+                                           &clip) == CAIRO_REGION_OVERLAP_OUT)
+        continue;
 
       gimp_canvas_item_draw (sub_item, cr);
     }
@@ -204,20 +259,22 @@ gimp_canvas_group_get_extents (GimpCanvasItem *item)
   cairo_region_t  *region = NULL;
   GList           *list;
 
+  gimp_canvas_group_check_view (group);
+
   for (list = group->priv->items->head; list; list = g_list_next (list))
     {
       GimpCanvasItem *sub_item   = list->data;
-      cairo_region_t *sub_region = gimp_canvas_item_get_extents (sub_item);
+      cairo_region_t *sub_region;
+
+      sub_region = gimp_canvas_group_child_extents (group, sub_item);
+
+      if (! sub_region)
+        continue;
 
       if (! region)
-        {
-          region = sub_region;
-        }
-      else if (sub_region)
-        {
-          cairo_region_union (region, sub_region);
-          cairo_region_destroy (sub_region);
-        }
+        region = cairo_region_copy (sub_region);
+      else
+        cairo_region_union (region, sub_region);
     }
 
   return region;
@@ -245,10 +302,66 @@ gimp_canvas_group_child_update (GimpCanvasItem  *item,
                                 cairo_region_t  *region,
                                 GimpCanvasGroup *group)
 {
+  g_hash_table_remove (group->priv->extents, item);
+
   if (_gimp_canvas_item_needs_update (GIMP_CANVAS_ITEM (group)))
     _gimp_canvas_item_update (GIMP_CANVAS_ITEM (group), region);
 }
 
+static void
+gimp_canvas_group_check_view (GimpCanvasGroup *group)
+{
+  GimpCanvasGroupPrivate *priv  = group->priv;
+  GimpDisplayShell       *shell = gimp_canvas_item_get_shell (GIMP_CANVAS_ITEM (group));
+  GimpImage              *image = gimp_canvas_item_get_image (GIMP_CANVAS_ITEM (group));
+  gint                    image_width  = image ? gimp_image_get_width  (image) : 0;
+  gint                    image_height = image ? gimp_image_get_height (image) : 0;
+
+  /*  zooming, scrolling and resizing move all items without any of
+   *  them emitting "update"
+   */
+  if (priv->scale_x           != shell->scale_x           ||
+      priv->scale_y           != shell->scale_y           ||
+      priv->offset_x          != shell->offset_x          ||
+      priv->offset_y          != shell->offset_y          ||
+      priv->rotate_angle      != shell->rotate_angle      ||
+      priv->flip_horizontally != shell->flip_horizontally ||
+      priv->flip_vertically   != shell->flip_vertically   ||
+      priv->image_width       != image_width              ||
+      priv->image_height      != image_height)
+    {
+      g_hash_table_remove_all (priv->extents);
+
+      priv->scale_x           = shell->scale_x;
+      priv->scale_y           = shell->scale_y;
+      priv->offset_x          = shell->offset_x;
+      priv->offset_y          = shell->offset_y;
+      priv->rotate_angle      = shell->rotate_angle;
+      priv->flip_horizontally = shell->flip_horizontally;
+      priv->flip_vertically   = shell->flip_vertically;
+      priv->image_width       = image_width;
+      priv->image_height      = image_height;
+    }
+}
+
+/*  returns the cached extents of a child, owned by the group  */
+static cairo_region_t *
+gimp_canvas_group_child_extents (GimpCanvasGroup *group,
+                                 GimpCanvasItem  *item)
+{
+  cairo_region_t *region;
+
+  if (! g_hash_table_lookup_extended (group->priv->extents, item,
+                                      NULL, (gpointer *) &region))
+    {
+      region = gimp_canvas_item_get_extents (item);
+
+      g_hash_table_insert (group->priv->extents, item, region);
+    }
+
+  return region;
+}
+
 
 /*  public functions  */
 
@@ -278,6 +391,8 @@ gimp_canvas_group_add_item (GimpCanvasGroup *group,
 
   g_queue_push_tail (group->priv->items, g_object_ref (item));
 
+  g_hash_table_remove (group->priv->extents, item);
+
   if (_gimp_canvas_item_needs_update (GIMP_CANVAS_ITEM (group)))
     {
       cairo_region_t *region = gimp_canvas_item_get_extents (item);
@@ -309,6 +424,8 @@ gimp_canvas_group_remove_item (GimpCanvasGroup *group,
 
   g_queue_delete_link (group->priv->items, list);
 
+  g_hash_table_remove (group->priv->extents, item);
+
   if (group->priv->group_stroking)
     gimp_canvas_item_resume_stroking (item);
 
@@ -599,6 +599,18 @@ gimp_canvas_item_transform_xy_f (GimpCanvasItem *item,
   gimp_display_shell_zoom_xy_f (item->private->shell, x, y, tx, ty);
 }
 
+void
+gimp_canvas_item_transform_points (GimpCanvasItem    *item,
+                                   const GimpVector2 *points,
+                                   GimpVector2       *t_points,
+                                   gint               n_points)
+{
+  g_return_if_fail (GIMP_IS_CANVAS_ITEM (item));
+
+  gimp_display_shell_zoom_points (item->private->shell,
+                                  points, t_points, n_points);
+}
+
 /**
  * gimp_canvas_item_transform_distance:
  * @item: a #GimpCanvasItem
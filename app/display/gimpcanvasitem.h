@@ -113,6 +113,10 @@ void             gimp_canvas_item_transform_xy_f   (GimpCanvasItem   *item,
                                                     gdouble           y,
                                                     gdouble          *tx,
                                                     gdouble          *ty);
+void             gimp_canvas_item_transform_points (GimpCanvasItem    *item,
+                                                    const GimpVector2 *points,
+                                                    GimpVector2       *t_points,
+                                                    gint               n_points);
 gdouble          gimp_canvas_item_transform_distance
                                                    (GimpCanvasItem   *item,
                                                     gdouble           x1,
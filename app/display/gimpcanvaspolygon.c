@@ -243,34 +243,21 @@ gimp_canvas_polygon_transform (GimpCanvasItem *item,
                               private->points, private->n_points, FALSE,
                               points, n_points);
 
-      for (i = 0; i < *n_points; i++)
-        {
-          gimp_canvas_item_transform_xy_f (item,
-                                           points[i].x,
-                                           points[i].y,
-                                           &points[i].x,
-                                           &points[i].y);
-
-          points[i].x = floor (points[i].x) + 0.5;
-          points[i].y = floor (points[i].y) + 0.5;
-        }
+      gimp_canvas_item_transform_points (item, points, points, *n_points);
     }
   else
     {
-      for (i = 0; i < private->n_points; i++)
-        {
-          gimp_canvas_item_transform_xy_f (item,
-                                           private->points[i].x,
-                                           private->points[i].y,
-                                           &points[i].x,
-                                           &points[i].y);
-
-          points[i].x = floor (points[i].x) + 0.5;
-          points[i].y = floor (points[i].y) + 0.5;
-        }
+      gimp_canvas_item_transform_points (item, private->points, points,
+                                         private->n_points);
 
       *n_points = private->n_points;
     }
+
+  for (i = 0; i < *n_points; i++)
+    {
+      points[i].x = floor (points[i].x) + 0.5;
+      points[i].y = floor (points[i].y) + 0.5;
+    }
 }
 
 static void
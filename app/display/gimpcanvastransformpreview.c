@@ -44,6 +44,9 @@
 #include "gimpdisplayshell.h"
 
 
+#define MAX_PROXY_LEVEL 8
+
+
 enum
 {
   PROP_0,
@@ -78,6 +81,14 @@ struct _GimpCanvasTransformPreviewPrivate
   GimpDrawable *node_mask;
   gdouble       node_opacity;
   GimpMatrix3   node_matrix;
+
+  /*  downscaled copies of the drawable and the mask, used instead of
+   *  them while the preview is minified by at least a factor of 2
+   */
+  GeglBuffer   *proxy;
+  GeglBuffer   *mask_proxy;
+  gint          node_level;
+  gint          node_mask_level;
 };
 
 #define GET_PRIVATE(transform_preview) \
@@ -104,6 +115,10 @@ static cairo_region_t * gimp_canvas_transform_preview_get_extents  (GimpCanvasIt
 
 static void             gimp_canvas_transform_preview_sync_node    (GimpCanvasItem *item);
 
+static gint             gimp_canvas_transform_preview_get_level    (const GimpMatrix3 *matrix);
+static GeglBuffer     * gimp_canvas_transform_preview_create_proxy (GeglBuffer     *buffer,
+                                                                    gint            level);
+
 
 G_DEFINE_TYPE (GimpCanvasTransformPreview, gimp_canvas_transform_preview,
                GIMP_TYPE_CANVAS_ITEM)
@@ -192,6 +207,9 @@ gimp_canvas_transform_preview_dispose (GObject *object)
 
   g_clear_object (&private->node);
 
+  g_clear_object (&private->proxy);
+  g_clear_object (&private->mask_proxy);
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -431,6 +449,7 @@ gimp_canvas_transform_preview_sync_node (GimpCanvasItem *item)
   gint                               offset_x, offset_y;
   GimpMatrix3                        matrix;
   gboolean                           has_mask;
+  gint                               level;
 
   if (! private->node)
     {
@@ -473,9 +492,11 @@ gimp_canvas_transform_preview_sync_node (GimpCanvasItem *item)
                            private->transform_node,
                            NULL);
 
-      private->node_drawable = NULL;
-      private->node_mask     = NULL;
-      private->node_opacity  = 1.0;
+      private->node_drawable   = NULL;
+      private->node_mask       = NULL;
+      private->node_opacity    = 1.0;
+      private->node_level      = 0;
+      private->node_mask_level = 0;
       gimp_matrix3_identity (&private->node_matrix);
     }
 
@@ -486,15 +507,43 @@ gimp_canvas_transform_preview_sync_node (GimpCanvasItem *item)
   gimp_matrix3_mult (&private->transform, &matrix);
   gimp_matrix3_scale (&matrix, shell->scale_x, shell->scale_y);
 
+  level = gimp_canvas_transform_preview_get_level (&matrix);
+
+  if (level > 0)
+    {
+      GimpMatrix3 proxy_matrix;
+
+      /*  map the proxy's pixels to the drawable's before transforming  */
+      gimp_matrix3_identity (&proxy_matrix);
+      gimp_matrix3_scale (&proxy_matrix, 1 << level, 1 << level);
+      gimp_matrix3_mult (&matrix, &proxy_matrix);
+
+      matrix = proxy_matrix;
+    }
+
   has_mask = gimp_item_mask_bounds (GIMP_ITEM (private->drawable),
                                     NULL, NULL, NULL, NULL);
 
-  if (private->drawable != private->node_drawable)
+  if (private->drawable != private->node_drawable ||
+      level             != private->node_level)
     {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (private->drawable);
+
       private->node_drawable = private->drawable;
+      private->node_level    = level;
+
+      g_clear_object (&private->proxy);
+
+      if (level > 0)
+        {
+          private->proxy =
+            gimp_canvas_transform_preview_create_proxy (buffer, level);
+
+          buffer = private->proxy;
+        }
 
       gegl_node_set (private->source_node,
-                     "buffer", gimp_drawable_get_buffer (private->drawable),
+                     "buffer", buffer,
                      NULL);
       gegl_node_set (private->convert_format_node,
                      "format", gimp_drawable_get_format_with_alpha (private->drawable),
@@ -529,12 +578,26 @@ gimp_canvas_transform_preview_sync_node (GimpCanvasItem *item)
     {
       GimpDrawable *mask = GIMP_DRAWABLE (gimp_image_get_mask (image));
 
-      if (mask != private->node_mask)
+      if (mask  != private->node_mask ||
+          level != private->node_mask_level)
         {
-          private->node_mask = mask;
+          GeglBuffer *buffer = gimp_drawable_get_buffer (mask);
+
+          private->node_mask       = mask;
+          private->node_mask_level = level;
+
+          g_clear_object (&private->mask_proxy);
+
+          if (level > 0)
+            {
+              private->mask_proxy =
+                gimp_canvas_transform_preview_create_proxy (buffer, level);
+
+              buffer = private->mask_proxy;
+            }
 
           gegl_node_set (private->mask_source_node,
-                         "buffer", gimp_drawable_get_buffer (mask),
+                         "buffer", buffer,
                          NULL);
 
           gegl_node_connect_to (private->mask_source_node, "output",
@@ -545,6 +608,8 @@ gimp_canvas_transform_preview_sync_node (GimpCanvasItem *item)
     {
       private->node_mask = NULL;
 
+      g_clear_object (&private->mask_proxy);
+
       gegl_node_disconnect (private->opacity_node, "aux");
     }
 
@@ -565,6 +630,57 @@ gimp_canvas_transform_preview_sync_node (GimpCanvasItem *item)
     }
 }
 
+/*  returns the number of times the drawable can be halved without the
+ *  preview, which @matrix maps it to, losing detail
+ */
+static gint
+gimp_canvas_transform_preview_get_level (const GimpMatrix3 *matrix)
+{
+  gdouble scale;
+  gint    level = 0;
+
+  scale = sqrt (fabs (matrix->coeff[0][0] * matrix->coeff[1][1] -
+                      matrix->coeff[0][1] * matrix->coeff[1][0]));
+
+  while (scale <= 0.5 && level < MAX_PROXY_LEVEL)
+    {
+      scale *= 2.0;
+      level++;
+    }
+
+  return level;
+}
+
+static GeglBuffer *
+gimp_canvas_transform_preview_create_proxy (GeglBuffer *buffer,
+                                            gint        level)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  const Babl          *format = gegl_buffer_get_format (buffer);
+  GeglBuffer          *proxy;
+  GeglBufferIterator  *iter;
+  GeglRectangle        rect;
+  gdouble              scale  = 1.0 / (1 << level);
+
+  rect.x      = floor (extent->x * scale);
+  rect.y      = floor (extent->y * scale);
+  rect.width  = ceil ((extent->x + extent->width)  * scale) - rect.x;
+  rect.height = ceil ((extent->y + extent->height) * scale) - rect.y;
+
+  proxy = gegl_buffer_new (&rect, format);
+
+  iter = gegl_buffer_iterator_new (proxy, &rect, 0, format,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gegl_buffer_get (buffer, &iter->roi[0], scale, format, iter->data[0],
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
+  return proxy;
+}
+
 
 /* public functions */
 
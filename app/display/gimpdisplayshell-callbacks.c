@@ -26,8 +26,10 @@
 #include "display-types.h"
 
 #include "core/gimp.h"
+#include "core/gimp-latency.h"
 #include "core/gimpimage.h"
 #include "core/gimpimage-quick-mask.h"
+#include "core/gimpprojection.h"
 
 #include "widgets/gimpcairo-wilber.h"
 #include "widgets/gimpuimanager.h"
@@ -47,6 +49,7 @@
 #include "gimpimagewindow.h"
 #include "gimpnavigationeditor.h"
 
+#include "gimp-trace.h"
 #include "git-version.h"
 
 #include "gimp-intl.h"
@@ -246,7 +249,27 @@ gimp_display_shell_canvas_expose (GtkWidget        *widget,
 
       if (gimp_display_get_image (shell->display))
         {
+          gint64 start_time = g_get_monotonic_time ();
+
           gimp_display_shell_canvas_draw_image (shell, cr);
+
+          gimp_latency_record (GIMP_LATENCY_DISPLAY_FRAME,
+                               g_get_monotonic_time () - start_time);
+
+          /*  painted input only reaches the screen once the projection
+           *  has rendered it, so don't count exposes of stale content
+           */
+          if (shell->paint_input_time &&
+              gimp_projection_get_render_backlog () == 0)
+            {
+              gint64 latency = g_get_monotonic_time () -
+                               shell->paint_input_time;
+
+              gimp_latency_record (GIMP_LATENCY_PAINT_INPUT, latency);
+              GIMP_TRACE_COUNTER ("paint-input-latency", latency);
+
+              shell->paint_input_time = 0;
+            }
         }
       else
         {
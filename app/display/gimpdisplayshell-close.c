@@ -90,6 +90,10 @@ gimp_display_shell_close (GimpDisplayShell *shell,
   if (shell->display->gimp->busy)
     return;
 
+  /*  don't close an image which is being saved in the background  */
+  if (image && gimp_image_is_busy (image))
+    return;
+
   /*  If the image has been modified, give the user a chance to save
    *  it before nuking it--this only applies if its the last view
    *  to an image canvas.  (a image with disp_count = 1)
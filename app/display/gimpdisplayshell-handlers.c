@@ -33,6 +33,7 @@
 
 #include "core/gimp.h"
 #include "core/gimp-cairo.h"
+#include "core/gimpchannel.h"
 #include "core/gimpguide.h"
 #include "core/gimpimage.h"
 #include "core/gimpimage-grid.h"
@@ -89,6 +90,9 @@ static void   gimp_display_shell_name_changed_handler       (GimpImage        *i
 static void   gimp_display_shell_selection_invalidate_handler
                                                             (GimpImage        *image,
                                                              GimpDisplayShell *shell);
+static void   gimp_display_shell_mask_boundary_changed_handler
+                                                            (GimpChannel      *mask,
+                                                             GimpDisplayShell *shell);
 static void   gimp_display_shell_size_changed_detailed_handler
                                                             (GimpImage        *image,
                                                              gint              previous_origin_x,
@@ -100,6 +104,16 @@ static void   gimp_display_shell_resolution_changed_handler (GimpImage        *i
                                                              GimpDisplayShell *shell);
 static void   gimp_display_shell_quick_mask_changed_handler (GimpImage        *image,
                                                              GimpDisplayShell *shell);
+static void   gimp_display_shell_quick_mask_update_handler  (GimpDrawable     *drawable,
+                                                             gint              x,
+                                                             gint              y,
+                                                             gint              width,
+                                                             gint              height,
+                                                             GimpDisplayShell *shell);
+static void   gimp_display_shell_quick_mask_visible_handler (GimpItem         *item,
+                                                             GimpDisplayShell *shell);
+static void   gimp_display_shell_set_quick_mask             (GimpDisplayShell *shell,
+                                                             GimpChannel      *quick_mask);
 static void   gimp_display_shell_guide_add_handler          (GimpImage        *image,
                                                              GimpGuide        *guide,
                                                              GimpDisplayShell *shell);
@@ -217,6 +231,9 @@ gimp_display_shell_connect (GimpDisplayShell *shell)
   g_signal_connect (image, "selection-invalidate",
                     G_CALLBACK (gimp_display_shell_selection_invalidate_handler),
                     shell);
+  g_signal_connect (gimp_image_get_mask (image), "boundary-changed",
+                    G_CALLBACK (gimp_display_shell_mask_boundary_changed_handler),
+                    shell);
   g_signal_connect (image, "size-changed-detailed",
                     G_CALLBACK (gimp_display_shell_size_changed_detailed_handler),
                     shell);
@@ -520,6 +537,8 @@ gimp_display_shell_disconnect (GimpDisplayShell *shell)
                                            list->data);
     }
 
+  gimp_display_shell_set_quick_mask (shell, NULL);
+
   g_signal_handlers_disconnect_by_func (image,
                                         gimp_display_shell_quick_mask_changed_handler,
                                         shell);
@@ -529,6 +548,9 @@ gimp_display_shell_disconnect (GimpDisplayShell *shell)
   g_signal_handlers_disconnect_by_func (image,
                                         gimp_display_shell_size_changed_detailed_handler,
                                         shell);
+  g_signal_handlers_disconnect_by_func (gimp_image_get_mask (image),
+                                        gimp_display_shell_mask_boundary_changed_handler,
+                                        shell);
   g_signal_handlers_disconnect_by_func (image,
                                         gimp_display_shell_selection_invalidate_handler,
                                         shell);
@@ -588,6 +610,13 @@ gimp_display_shell_selection_invalidate_handler (GimpImage        *image,
   gimp_display_shell_selection_undraw (shell);
 }
 
+static void
+gimp_display_shell_mask_boundary_changed_handler (GimpChannel      *mask,
+                                                  GimpDisplayShell *shell)
+{
+  gimp_display_shell_selection_undraw (shell);
+}
+
 static void
 gimp_display_shell_resolution_changed_handler (GimpImage        *image,
                                                GimpDisplayShell *shell)
@@ -649,6 +678,82 @@ gimp_display_shell_quick_mask_changed_handler (GimpImage        *image,
   g_signal_handlers_unblock_by_func (shell->quick_mask_button,
                                      gimp_display_shell_quick_mask_toggled,
                                      shell);
+
+  gimp_display_shell_set_quick_mask (shell,
+                                     quick_mask_state ?
+                                     gimp_image_get_quick_mask (image) : NULL);
+}
+
+static void
+gimp_display_shell_quick_mask_update_handler (GimpDrawable     *drawable,
+                                              gint              x,
+                                              gint              y,
+                                              gint              width,
+                                              gint              height,
+                                              GimpDisplayShell *shell)
+{
+  gint off_x, off_y;
+
+  if (! gimp_item_get_visible (GIMP_ITEM (drawable)))
+    return;
+
+  gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+  if (width < 0 || height < 0)
+    {
+      x      = 0;
+      y      = 0;
+      width  = gimp_item_get_width  (GIMP_ITEM (drawable));
+      height = gimp_item_get_height (GIMP_ITEM (drawable));
+    }
+
+  gimp_display_update_area (shell->display, FALSE,
+                            x + off_x, y + off_y, width, height);
+}
+
+static void
+gimp_display_shell_quick_mask_visible_handler (GimpItem         *item,
+                                               GimpDisplayShell *shell)
+{
+  gimp_display_shell_expose_full (shell);
+}
+
+/*  the quick mask isn't part of the projection, it is composited on
+ *  top of it by gimp_display_shell_render(), so its changes need to be
+ *  exposed here
+ */
+static void
+gimp_display_shell_set_quick_mask (GimpDisplayShell *shell,
+                                   GimpChannel      *quick_mask)
+{
+  if (quick_mask == shell->quick_mask)
+    return;
+
+  if (shell->quick_mask)
+    {
+      g_signal_handlers_disconnect_by_func (shell->quick_mask,
+                                            gimp_display_shell_quick_mask_update_handler,
+                                            shell);
+      g_signal_handlers_disconnect_by_func (shell->quick_mask,
+                                            gimp_display_shell_quick_mask_visible_handler,
+                                            shell);
+
+      g_clear_object (&shell->quick_mask);
+    }
+
+  if (quick_mask)
+    {
+      shell->quick_mask = g_object_ref (quick_mask);
+
+      g_signal_connect (quick_mask, "update",
+                        G_CALLBACK (gimp_display_shell_quick_mask_update_handler),
+                        shell);
+      g_signal_connect (quick_mask, "visibility-changed",
+                        G_CALLBACK (gimp_display_shell_quick_mask_visible_handler),
+                        shell);
+    }
+
+  gimp_display_shell_expose_full (shell);
 }
 
 static void
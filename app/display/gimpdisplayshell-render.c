@@ -30,6 +30,8 @@
 
 #include "gegl/gimp-gegl-utils.h"
 
+#include "core/gimp-parallel.h"
+#include "core/gimpchannel.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpimage.h"
 #include "core/gimppickable.h"
@@ -44,6 +46,50 @@
 #include "gimpdisplayshell-scroll.h"
 #include "gimpdisplayxfer.h"
 
+#include "gimp-trace.h"
+
+
+/*  the minimal number of pixels rendered by each thread  */
+#define GIMP_DISPLAY_SHELL_RENDER_MIN_AREA (64 * 64)
+
+
+typedef struct
+{
+  GimpDisplayShell *shell;
+  GeglBuffer       *buffer;
+#ifdef USE_NODE_BLIT
+  GeglNode         *node;
+#endif
+  const Babl       *format;
+  gint              x;
+  gint              y;
+  gdouble           scale;
+  guchar           *cairo_data;
+  gint              cairo_stride;
+  GeglBuffer       *cairo_buffer;
+  gboolean          can_convert_to_u8;
+  guchar           *mask_data;
+  gint              mask_stride;
+  GeglBuffer       *quick_mask_buffer;
+  gint              quick_mask_offset_x;
+  gint              quick_mask_offset_y;
+  gboolean          quick_mask_inverted;
+  guchar           *quick_mask_data;
+  gint              quick_mask_stride;
+} RenderData;
+
+
+static void   gimp_display_shell_render_area (const GeglRectangle *area,
+                                              RenderData          *data);
+static void   gimp_display_shell_render_mask (GeglBuffer          *mask,
+                                              gint                 offset_x,
+                                              gint                 offset_y,
+                                              gboolean             inverted,
+                                              const GeglRectangle *src_rect,
+                                              gdouble              scale,
+                                              guchar              *mask_data,
+                                              gint                 mask_stride);
+
 
 void
 gimp_display_shell_render (GimpDisplayShell *shell,
@@ -55,10 +101,7 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                            gdouble           scale)
 {
   GimpImage       *image;
-  GeglBuffer      *buffer;
-#ifdef USE_NODE_BLIT
-  GeglNode        *node;
-#endif
+  RenderData       data;
   cairo_surface_t *xfer;
   gint             xfer_src_x;
   gint             xfer_src_y;
@@ -66,7 +109,6 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   gint             mask_src_y = 0;
   gint             cairo_stride;
   guchar          *cairo_data;
-  GeglBuffer      *cairo_buffer;
 
   g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
   g_return_if_fail (cr != NULL);
@@ -74,13 +116,21 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   g_return_if_fail (h > 0 && h <= GIMP_DISPLAY_RENDER_BUF_HEIGHT);
   g_return_if_fail (scale > 0.0);
 
-  image  = gimp_display_get_image (shell->display);
-  buffer = gimp_pickable_get_buffer (GIMP_PICKABLE (image));
+  GIMP_TRACE_BEGIN ("display-shell-render");
+
+  image = gimp_display_get_image (shell->display);
+
+  data.shell  = shell;
+  data.buffer = gimp_pickable_get_buffer (GIMP_PICKABLE (image));
 #ifdef USE_NODE_BLIT
-  node   = gimp_projectable_get_graph (GIMP_PROJECTABLE (image));
+  data.node   = gimp_projectable_get_graph (GIMP_PROJECTABLE (image));
 
   gimp_projectable_begin_render (GIMP_PROJECTABLE (image));
 #endif
+  data.format = gimp_projectable_get_format (GIMP_PROJECTABLE (image));
+  data.x      = x;
+  data.y      = y;
+  data.scale  = scale;
 
   xfer = gimp_display_xfer_get_surface (shell->xfer, w, h,
                                         &xfer_src_x, &xfer_src_y);
@@ -89,27 +139,26 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   cairo_data   = cairo_image_surface_get_data (xfer) +
                  xfer_src_y * cairo_stride + xfer_src_x * 4;
 
-  cairo_buffer = gegl_buffer_linear_new_from_data (cairo_data,
-                                                   babl_format ("cairo-ARGB32"),
-                                                   GEGL_RECTANGLE (0, 0, w, h),
-                                                   cairo_stride,
-                                                   NULL, NULL);
+  data.cairo_data   = cairo_data;
+  data.cairo_stride = cairo_stride;
+  data.cairo_buffer = gegl_buffer_linear_new_from_data (cairo_data,
+                                                        babl_format ("cairo-ARGB32"),
+                                                        GEGL_RECTANGLE (0, 0, w, h),
+                                                        cairo_stride,
+                                                        NULL, NULL);
+
+  data.can_convert_to_u8 = TRUE;
 
   if (shell->profile_transform ||
       gimp_display_shell_has_filter (shell))
     {
-      gboolean can_convert_to_u8;
-
-      /*  if there is a profile transform or a display filter, we need
-       *  to use temp buffers
-       */
-
-      can_convert_to_u8 = gimp_display_shell_profile_can_convert_to_u8 (shell);
+      data.can_convert_to_u8 =
+        gimp_display_shell_profile_can_convert_to_u8 (shell);
 
       /*  create the filter buffer if we have filters, or can't convert
        *  to u8 directly
        */
-      if ((gimp_display_shell_has_filter (shell) || ! can_convert_to_u8) &&
+      if ((gimp_display_shell_has_filter (shell) || ! data.can_convert_to_u8) &&
           ! shell->filter_buffer)
         {
           gint fw = GIMP_DISPLAY_RENDER_BUF_WIDTH;
@@ -130,6 +179,160 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                                               (GDestroyNotify) gegl_free,
                                               shell->filter_data);
         }
+    }
+
+  data.mask_data   = NULL;
+  data.mask_stride = 0;
+
+  if (shell->mask)
+    {
+      if (! shell->mask_surface)
+        {
+          shell->mask_surface =
+            cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                        GIMP_DISPLAY_RENDER_BUF_WIDTH,
+                                        GIMP_DISPLAY_RENDER_BUF_HEIGHT);
+        }
+
+      cairo_surface_mark_dirty (shell->mask_surface);
+
+      data.mask_stride = cairo_image_surface_get_stride (shell->mask_surface);
+      data.mask_data   = cairo_image_surface_get_data (shell->mask_surface) +
+                         mask_src_y * data.mask_stride + mask_src_x;
+    }
+
+  data.quick_mask_data = NULL;
+
+  if (shell->quick_mask &&
+      gimp_item_get_visible (GIMP_ITEM (shell->quick_mask)))
+    {
+      if (! shell->quick_mask_surface)
+        {
+          shell->quick_mask_surface =
+            cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                        GIMP_DISPLAY_RENDER_BUF_WIDTH,
+                                        GIMP_DISPLAY_RENDER_BUF_HEIGHT);
+        }
+
+      cairo_surface_mark_dirty (shell->quick_mask_surface);
+
+      /*  get the buffer here, it may have to be rendered first  */
+      data.quick_mask_buffer =
+        gimp_drawable_get_buffer (GIMP_DRAWABLE (shell->quick_mask));
+
+      gimp_item_get_offset (GIMP_ITEM (shell->quick_mask),
+                            &data.quick_mask_offset_x,
+                            &data.quick_mask_offset_y);
+
+      data.quick_mask_inverted =
+        gimp_channel_get_show_masked (shell->quick_mask);
+
+      data.quick_mask_stride =
+        cairo_image_surface_get_stride (shell->quick_mask_surface);
+      data.quick_mask_data =
+        cairo_image_surface_get_data (shell->quick_mask_surface);
+    }
+
+  /*  render the area in horizontal bands, in parallel.  display filters
+   *  are not required to be thread-safe, so with filters, render the
+   *  whole area at once.
+   */
+  if (! gimp_display_shell_has_filter (shell))
+    {
+      gimp_parallel_distribute_area (GEGL_RECTANGLE (0, 0, w, h),
+                                     GIMP_DISPLAY_SHELL_RENDER_MIN_AREA,
+                                     (GimpParallelDistributeAreaFunc)
+                                     gimp_display_shell_render_area,
+                                     &data);
+    }
+  else
+    {
+      gimp_display_shell_render_area (GEGL_RECTANGLE (0, 0, w, h), &data);
+    }
+
+  g_object_unref (data.cairo_buffer);
+
+#ifdef USE_NODE_BLIT
+  gimp_projectable_end_render (GIMP_PROJECTABLE (image));
+#endif
+
+  /*  we wrote to the surface's data directly  */
+  cairo_surface_mark_dirty_rectangle (xfer, xfer_src_x, xfer_src_y, w, h);
+
+  /*  put it to the screen  */
+  cairo_set_source_surface (cr, xfer,
+                            x - xfer_src_x,
+                            y - xfer_src_y);
+  cairo_paint (cr);
+
+  /*  the quick mask is composited here instead of in the projection  */
+  if (data.quick_mask_data)
+    {
+      GimpRGB color;
+
+      gimp_channel_get_color (shell->quick_mask, &color);
+
+      gimp_cairo_set_source_rgba (cr, &color);
+      cairo_mask_surface (cr, shell->quick_mask_surface, x, y);
+    }
+
+  if (shell->mask)
+    {
+      gimp_cairo_set_source_rgba (cr, &shell->mask_color);
+      cairo_mask_surface (cr, shell->mask_surface,
+                          x - mask_src_x,
+                          y - mask_src_y);
+    }
+
+  GIMP_TRACE_END ("display-shell-render");
+}
+
+
+/*  private functions  */
+
+/*  renders 'area', given relative to the render origin, into the
+ *  corresponding part of the transfer surface and the scratch buffers.
+ *  the parts of the scratch buffers used by different areas don't
+ *  overlap, so disjoint areas can be rendered concurrently, as long as
+ *  there are no display filters.
+ */
+static void
+gimp_display_shell_render_area (const GeglRectangle *area,
+                                RenderData          *data)
+{
+  GimpDisplayShell *shell = data->shell;
+  GeglRectangle     src_rect;
+  guchar           *cairo_data;
+
+  src_rect = *GEGL_RECTANGLE (data->x + area->x, data->y + area->y,
+                              area->width, area->height);
+
+  cairo_data = data->cairo_data +
+               area->y * data->cairo_stride + area->x * 4;
+
+  if (shell->profile_transform ||
+      gimp_display_shell_has_filter (shell))
+    {
+      guchar *profile_data = NULL;
+      guchar *filter_data  = NULL;
+
+      /*  if there is a profile transform or a display filter, we need
+       *  to use temp buffers
+       */
+
+      if (shell->profile_data)
+        {
+          profile_data = shell->profile_data +
+                         area->y * shell->profile_stride +
+                         area->x * babl_format_get_bytes_per_pixel (data->format);
+        }
+
+      if (shell->filter_data)
+        {
+          filter_data = shell->filter_data +
+                        area->y * shell->filter_stride +
+                        area->x * babl_format_get_bytes_per_pixel (shell->filter_format);
+        }
 
       if (! gimp_display_shell_has_filter (shell) || shell->filter_transform)
         {
@@ -137,16 +340,16 @@ gimp_display_shell_render (GimpDisplayShell *shell,
            *  load the projection pixels into the profile_buffer
            */
 #ifndef USE_NODE_BLIT
-          gegl_buffer_get (buffer,
-                           GEGL_RECTANGLE (x, y, w, h), scale,
-                           gimp_projectable_get_format (GIMP_PROJECTABLE (image)),
-                           shell->profile_data, shell->profile_stride,
+          gegl_buffer_get (data->buffer,
+                           &src_rect, data->scale,
+                           data->format,
+                           profile_data, shell->profile_stride,
                            GEGL_ABYSS_CLAMP);
 #else
-          gegl_node_blit (node,
-                          scale, GEGL_RECTANGLE (x, y, w, h),
-                          gimp_projectable_get_format (GIMP_PROJECTABLE (image)),
-                          shell->profile_data, shell->profile_stride,
+          gegl_node_blit (data->node,
+                          data->scale, &src_rect,
+                          data->format,
+                          profile_data, shell->profile_stride,
                           GEGL_BLIT_CACHE);
 #endif
         }
@@ -155,16 +358,16 @@ gimp_display_shell_render (GimpDisplayShell *shell,
           /*  otherwise, load the pixels directly into the filter_buffer
            */
 #ifndef USE_NODE_BLIT
-          gegl_buffer_get (buffer,
-                           GEGL_RECTANGLE (x, y, w, h), scale,
+          gegl_buffer_get (data->buffer,
+                           &src_rect, data->scale,
                            shell->filter_format,
-                           shell->filter_data, shell->filter_stride,
+                           filter_data, shell->filter_stride,
                            GEGL_ABYSS_CLAMP);
 #else
-          gegl_node_blit (node,
-                          scale, GEGL_RECTANGLE (x, y, w, h),
+          gegl_node_blit (data->node,
+                          data->scale, &src_rect,
                           shell->filter_format,
-                          shell->filter_data, shell->filter_stride,
+                          filter_data, shell->filter_stride,
                           GEGL_BLIT_CACHE);
 #endif
         }
@@ -176,9 +379,9 @@ gimp_display_shell_render (GimpDisplayShell *shell,
         {
           gimp_color_transform_process_buffer (shell->filter_transform,
                                                shell->profile_buffer,
-                                               GEGL_RECTANGLE (0, 0, w, h),
+                                               area,
                                                shell->filter_buffer,
-                                               GEGL_RECTANGLE (0, 0, w, h));
+                                               area);
         }
 
       /*  if there are filters, apply them
@@ -193,15 +396,15 @@ gimp_display_shell_render (GimpDisplayShell *shell,
            */
           filter_buffer = g_object_new (GEGL_TYPE_BUFFER,
                                         "source", shell->filter_buffer,
-                                        "shift-x", -x,
-                                        "shift-y", -y,
+                                        "shift-x", -data->x,
+                                        "shift-y", -data->y,
                                         NULL);
 
           /*  convert the filter_buffer in place
            */
           gimp_color_display_stack_convert_buffer (shell->filter_stack,
                                                    filter_buffer,
-                                                   GEGL_RECTANGLE (x, y, w, h));
+                                                   &src_rect);
 
           g_object_unref (filter_buffer);
         }
@@ -217,20 +420,20 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                */
               gimp_color_transform_process_buffer (shell->profile_transform,
                                                    shell->filter_buffer,
-                                                   GEGL_RECTANGLE (0, 0, w, h),
+                                                   area,
                                                    shell->filter_buffer,
-                                                   GEGL_RECTANGLE (0, 0, w, h));
+                                                   area);
             }
-          else if (! can_convert_to_u8)
+          else if (! data->can_convert_to_u8)
             {
               /*  otherwise, if we can't convert to u8 directly, convert
                *  the pixels from the profile_buffer to the filter_buffer
                */
               gimp_color_transform_process_buffer (shell->profile_transform,
                                                    shell->profile_buffer,
-                                                   GEGL_RECTANGLE (0, 0, w, h),
+                                                   area,
                                                    shell->filter_buffer,
-                                                   GEGL_RECTANGLE (0, 0, w, h));
+                                                   area);
             }
           else
             {
@@ -239,21 +442,21 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                */
               gimp_color_transform_process_buffer (shell->profile_transform,
                                                    shell->profile_buffer,
-                                                   GEGL_RECTANGLE (0, 0, w, h),
-                                                   cairo_buffer,
-                                                   GEGL_RECTANGLE (0, 0, w, h));
+                                                   area,
+                                                   data->cairo_buffer,
+                                                   area);
             }
         }
 
       /*  finally, copy the filter buffer to the cairo-ARGB32 buffer,
        *  if necessary
        */
-      if (gimp_display_shell_has_filter (shell) || ! can_convert_to_u8)
+      if (gimp_display_shell_has_filter (shell) || ! data->can_convert_to_u8)
         {
           gegl_buffer_get (shell->filter_buffer,
-                           GEGL_RECTANGLE (0, 0, w, h), 1.0,
+                           area, 1.0,
                            babl_format ("cairo-ARGB32"),
-                           cairo_data, cairo_stride,
+                           cairo_data, data->cairo_stride,
                            GEGL_ABYSS_CLAMP);
         }
     }
@@ -263,83 +466,86 @@ gimp_display_shell_render (GimpDisplayShell *shell,
        *  cairo-ARGB32 buffer
        */
 #ifndef USE_NODE_BLIT
-      gegl_buffer_get (buffer,
-                       GEGL_RECTANGLE (x, y, w, h), scale,
+      gegl_buffer_get (data->buffer,
+                       &src_rect, data->scale,
                        babl_format ("cairo-ARGB32"),
-                       cairo_data, cairo_stride,
+                       cairo_data, data->cairo_stride,
                        GEGL_ABYSS_CLAMP);
 #else
-      gegl_node_blit (node,
-                      scale, GEGL_RECTANGLE (x, y, w, h),
+      gegl_node_blit (data->node,
+                      data->scale, &src_rect,
                       babl_format ("cairo-ARGB32"),
-                      cairo_data, cairo_stride,
+                      cairo_data, data->cairo_stride,
                       GEGL_BLIT_CACHE);
 #endif
     }
 
-  g_object_unref (cairo_buffer);
-
-#ifdef USE_NODE_BLIT
-  gimp_projectable_end_render (GIMP_PROJECTABLE (image));
-#endif
-
-  if (shell->mask)
+  if (data->quick_mask_data)
     {
-      if (! shell->mask_surface)
-        {
-          shell->mask_surface =
-            cairo_image_surface_create (CAIRO_FORMAT_A8,
-                                        GIMP_DISPLAY_RENDER_BUF_WIDTH,
-                                        GIMP_DISPLAY_RENDER_BUF_HEIGHT);
-        }
-
-      cairo_surface_mark_dirty (shell->mask_surface);
+      gimp_display_shell_render_mask (data->quick_mask_buffer,
+                                      data->quick_mask_offset_x,
+                                      data->quick_mask_offset_y,
+                                      data->quick_mask_inverted,
+                                      &src_rect, data->scale,
+                                      data->quick_mask_data +
+                                      area->y * data->quick_mask_stride +
+                                      area->x,
+                                      data->quick_mask_stride);
+    }
 
-      cairo_stride = cairo_image_surface_get_stride (shell->mask_surface);
-      cairo_data   = cairo_image_surface_get_data (shell->mask_surface) +
-                     mask_src_y * cairo_stride + mask_src_x;
+  if (data->mask_data)
+    {
+      gimp_display_shell_render_mask (shell->mask,
+                                      shell->mask_offset_x,
+                                      shell->mask_offset_y,
+                                      shell->mask_inverted,
+                                      &src_rect, data->scale,
+                                      data->mask_data +
+                                      area->y * data->mask_stride +
+                                      area->x,
+                                      data->mask_stride);
+    }
+}
 
-      gegl_buffer_get (shell->mask,
-                       GEGL_RECTANGLE (x - floor (shell->mask_offset_x * scale),
-                                       y - floor (shell->mask_offset_y * scale),
-                                       w, h),
-                       scale,
-                       babl_format ("Y u8"),
-                       cairo_data, cairo_stride,
-                       GEGL_ABYSS_NONE);
+/*  renders the part of 'mask' under 'src_rect', which is given in
+ *  scaled image coordinates, into 'mask_data'
+ */
+static void
+gimp_display_shell_render_mask (GeglBuffer          *mask,
+                                gint                 offset_x,
+                                gint                 offset_y,
+                                gboolean             inverted,
+                                const GeglRectangle *src_rect,
+                                gdouble              scale,
+                                guchar              *mask_data,
+                                gint                 mask_stride)
+{
+  gegl_buffer_get (mask,
+                   GEGL_RECTANGLE (src_rect->x - floor (offset_x * scale),
+                                   src_rect->y - floor (offset_y * scale),
+                                   src_rect->width, src_rect->height),
+                   scale,
+                   babl_format ("Y u8"),
+                   mask_data, mask_stride,
+                   GEGL_ABYSS_NONE);
+
+  if (inverted)
+    {
+      gint mask_height = src_rect->height;
 
-      if (shell->mask_inverted)
+      while (mask_height--)
         {
-          gint mask_height = h;
+          gint    mask_width = src_rect->width;
+          guchar *d          = mask_data;
 
-          while (mask_height--)
+          while (mask_width--)
             {
-              gint    mask_width = w;
-              guchar *d          = cairo_data;
+              guchar inv = 255 - *d;
 
-              while (mask_width--)
-                {
-                  guchar inv = 255 - *d;
-
-                  *d++ = inv;
-                }
-
-              cairo_data += cairo_stride;
+              *d++ = inv;
             }
-        }
-    }
 
-  /*  put it to the screen  */
-  cairo_set_source_surface (cr, xfer,
-                            x - xfer_src_x,
-                            y - xfer_src_y);
-  cairo_paint (cr);
-
-  if (shell->mask)
-    {
-      gimp_cairo_set_source_rgba (cr, &shell->mask_color);
-      cairo_mask_surface (cr, shell->mask_surface,
-                          x - mask_src_x,
-                          y - mask_src_y);
+          mask_data += mask_stride;
+        }
     }
 }
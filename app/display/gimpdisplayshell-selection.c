@@ -17,6 +17,9 @@
 
 #include "config.h"
 
+#include <math.h>
+#include <string.h>
+
 #include <gegl.h>
 #include <gtk/gtk.h>
 
@@ -39,6 +42,12 @@
 #include "gimpdisplayshell-transform.h"
 
 
+/*  selections with more boundary segments than this are drawn once,
+ *  without marching ants
+ */
+#define MAX_ANIMATED_SEGS 100000
+
+
 struct _Selection
 {
   GimpDisplayShell *shell;            /*  shell that owns the selection     */
@@ -55,6 +64,17 @@ struct _Selection
   gboolean          show_selection;   /*  is the selection visible?         */
   guint             timeout;          /*  timer for successive draws        */
   cairo_pattern_t  *segs_in_mask;     /*  cache for rendered segments       */
+  GdkRectangle      segs_in_bounds;   /*  window area covered by segs_in    */
+
+  gboolean          segs_valid;       /*  segments match boundary and view  */
+  gdouble           scale_x;          /*  view the segments were made for   */
+  gdouble           scale_y;
+  gint              offset_x;
+  gint              offset_y;
+  gint              disp_width;
+  gint              disp_height;
+  gboolean          rotated;
+  cairo_matrix_t    rotate_transform;
 };
 
 
@@ -67,6 +87,8 @@ static void      selection_draw           (Selection          *selection);
 static void      selection_undraw         (Selection          *selection);
 
 static void      selection_render_mask    (Selection          *selection);
+static void      selection_get_bounds     (Selection          *selection,
+                                           GdkRectangle       *bounds);
 
 static void      selection_zoom_segs      (Selection          *selection,
                                            const GimpBoundSeg *src_segs,
@@ -74,6 +96,7 @@ static void      selection_zoom_segs      (Selection          *selection,
                                            gint                n_segs);
 static void      selection_generate_segs  (Selection          *selection);
 static void      selection_free_segs      (Selection          *selection);
+static gboolean  selection_segs_valid     (Selection          *selection);
 
 static gboolean  selection_start_timeout  (Selection          *selection);
 static gboolean  selection_timeout        (Selection          *selection);
@@ -144,6 +167,9 @@ gimp_display_shell_selection_undraw (GimpDisplayShell *shell)
   g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
   g_return_if_fail (shell->selection != NULL);
 
+  /*  the boundary changed, the segments are regenerated on restart  */
+  shell->selection->segs_valid = FALSE;
+
   if (gimp_display_get_image (shell->display))
     {
       selection_undraw (shell->selection);
@@ -254,6 +280,10 @@ selection_draw (Selection *selection)
 
       cr = gdk_cairo_create (gtk_widget_get_window (selection->shell->canvas));
 
+      /*  only the area covered by the boundary changes between steps  */
+      gdk_cairo_rectangle (cr, &selection->segs_in_bounds);
+      cairo_clip (cr);
+
       gimp_display_shell_draw_selection_in (selection->shell, cr,
                                             selection->segs_in_mask,
                                             selection->index % 8);
@@ -310,6 +340,58 @@ selection_render_mask (Selection *selection)
   cairo_surface_destroy (surface);
 }
 
+static void
+selection_get_bounds (Selection    *selection,
+                      GdkRectangle *bounds)
+{
+  GdkWindow    *window = gtk_widget_get_window (selection->shell->canvas);
+  GdkRectangle  area;
+  gdouble       x1, y1, x2, y2;
+  gint          i;
+
+  x1 = x2 = selection->segs_in[0].x1;
+  y1 = y2 = selection->segs_in[0].y1;
+
+  for (i = 0; i < selection->n_segs_in; i++)
+    {
+      const GimpSegment *seg = &selection->segs_in[i];
+
+      x1 = MIN (x1, MIN (seg->x1, seg->x2));
+      y1 = MIN (y1, MIN (seg->y1, seg->y2));
+      x2 = MAX (x2, MAX (seg->x1, seg->x2));
+      y2 = MAX (y2, MAX (seg->y1, seg->y2));
+    }
+
+  if (selection->shell->rotate_transform)
+    {
+      gdouble xs[4] = { x1, x2, x1, x2 };
+      gdouble ys[4] = { y1, y1, y2, y2 };
+
+      for (i = 0; i < 4; i++)
+        cairo_matrix_transform_point (selection->shell->rotate_transform,
+                                      &xs[i], &ys[i]);
+
+      x1 = MIN (MIN (xs[0], xs[1]), MIN (xs[2], xs[3]));
+      y1 = MIN (MIN (ys[0], ys[1]), MIN (ys[2], ys[3]));
+      x2 = MAX (MAX (xs[0], xs[1]), MAX (xs[2], xs[3]));
+      y2 = MAX (MAX (ys[0], ys[1]), MAX (ys[2], ys[3]));
+    }
+
+  /*  leave room for the line width and square caps  */
+  bounds->x      = floor (x1) - 1;
+  bounds->y      = floor (y1) - 1;
+  bounds->width  = ceil (x2) + 2 - bounds->x;
+  bounds->height = ceil (y2) + 2 - bounds->y;
+
+  area.x      = 0;
+  area.y      = 0;
+  area.width  = gdk_window_get_width  (window);
+  area.height = gdk_window_get_height (window);
+
+  if (! gdk_rectangle_intersect (bounds, &area, bounds))
+    bounds->width = bounds->height = 0;
+}
+
 static void
 selection_zoom_segs (Selection          *selection,
                      const GimpBoundSeg *src_segs,
@@ -365,12 +447,14 @@ selection_generate_segs (Selection *selection)
   const GimpBoundSeg *segs_out;
 
   /*  Ask the image for the boundary of its selected region...
-   *  Then transform that information into a new buffer of GimpSegments
+   *  Then transform that information into a new buffer of GimpSegments.
+   *  If the boundary is being traced, this is the previous boundary,
+   *  and the selection is redrawn on "boundary-changed"
    */
-  gimp_channel_boundary (gimp_image_get_mask (image),
-                         &segs_in, &segs_out,
-                         &selection->n_segs_in, &selection->n_segs_out,
-                         0, 0, 0, 0);
+  gimp_channel_boundary_async (gimp_image_get_mask (image),
+                               &segs_in, &segs_out,
+                               &selection->n_segs_in, &selection->n_segs_out,
+                               0, 0, 0, 0);
 
   if (selection->n_segs_in)
     {
@@ -378,6 +462,7 @@ selection_generate_segs (Selection *selection)
       selection_zoom_segs (selection, segs_in,
                            selection->segs_in, selection->n_segs_in);
 
+      selection_get_bounds (selection, &selection->segs_in_bounds);
       selection_render_mask (selection);
     }
   else
@@ -396,6 +481,21 @@ selection_generate_segs (Selection *selection)
     {
       selection->segs_out = NULL;
     }
+
+  /*  remember the view, the segments stay valid as long as it and the
+   *  boundary don't change
+   */
+  selection->segs_valid  = TRUE;
+  selection->scale_x     = selection->shell->scale_x;
+  selection->scale_y     = selection->shell->scale_y;
+  selection->offset_x    = selection->shell->offset_x;
+  selection->offset_y    = selection->shell->offset_y;
+  selection->disp_width  = selection->shell->disp_width;
+  selection->disp_height = selection->shell->disp_height;
+  selection->rotated     = selection->shell->rotate_transform != NULL;
+
+  if (selection->rotated)
+    selection->rotate_transform = *selection->shell->rotate_transform;
 }
 
 static void
@@ -408,20 +508,54 @@ selection_free_segs (Selection *selection)
   selection->segs_out = NULL;
 
   g_clear_pointer (&selection->segs_in_mask, cairo_pattern_destroy);
+
+  selection->segs_valid = FALSE;
+}
+
+static gboolean
+selection_segs_valid (Selection *selection)
+{
+  GimpDisplayShell *shell = selection->shell;
+
+  if (! selection->segs_valid                        ||
+      selection->scale_x     != shell->scale_x     ||
+      selection->scale_y     != shell->scale_y     ||
+      selection->offset_x    != shell->offset_x    ||
+      selection->offset_y    != shell->offset_y    ||
+      selection->disp_width  != shell->disp_width  ||
+      selection->disp_height != shell->disp_height ||
+      selection->rotated     != (shell->rotate_transform != NULL))
+    return FALSE;
+
+  if (selection->rotated &&
+      memcmp (&selection->rotate_transform, shell->rotate_transform,
+              sizeof (cairo_matrix_t)))
+    return FALSE;
+
+  return TRUE;
 }
 
 static gboolean
 selection_start_timeout (Selection *selection)
 {
-  selection_free_segs (selection);
   selection->timeout = 0;
 
   if (! gimp_display_get_image (selection->shell->display))
-    return FALSE;
+    {
+      selection_free_segs (selection);
+      return FALSE;
+    }
 
-  selection_generate_segs (selection);
+  /*  every expose restarts the selection, only zoom and stroke the
+   *  boundary again if it or the view changed
+   */
+  if (! selection_segs_valid (selection))
+    {
+      selection_free_segs (selection);
+      selection_generate_segs (selection);
 
-  selection->index = 0;
+      selection->index = 0;
+    }
 
   /*  Draw the ants  */
   if (selection->show_selection)
@@ -446,7 +580,8 @@ selection_start_timeout (Selection *selection)
           cairo_destroy (cr);
         }
 
-      if (selection->segs_in && selection->shell_visible)
+      if (selection->segs_in && selection->shell_visible &&
+          selection->n_segs_in <= MAX_ANIMATED_SEGS)
         selection->timeout = g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE,
                                                  config->marching_ants_speed,
                                                  (GSourceFunc) selection_timeout,
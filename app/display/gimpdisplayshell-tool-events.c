@@ -368,6 +368,9 @@ gimp_display_shell_buffer_stroke (GimpMotionBuffer *buffer,
   if (active_tool &&
       gimp_tool_control_is_active (active_tool->control))
     {
+      if (! shell->paint_input_time)
+        shell->paint_input_time = gimp_motion_buffer_get_input_time (buffer);
+
       tool_manager_motion_active (gimp,
                                   coords, time, state,
                                   display);
@@ -768,6 +771,9 @@ gimp_display_shell_canvas_tool_events_internal (GtkWidget         *canvas,
                 image_coords.velocity = last_motion.velocity;
                 image_coords.direction = last_motion.direction;
 
+                /*  the first dab of a stroke is painted right here  */
+                shell->paint_input_time = g_get_monotonic_time ();
+
                 tool_manager_button_press_active (gimp,
                                                   &image_coords,
                                                   time, state,
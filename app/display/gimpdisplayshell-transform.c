@@ -275,6 +275,38 @@ gimp_display_shell_zoom_segments (GimpDisplayShell   *shell,
     }
 }
 
+/**
+ * gimp_display_shell_zoom_points:
+ * @shell:       a #GimpDisplayShell
+ * @src_points:  array of points in image coordinates
+ * @dest_points: returns the corresponding points in display coordinates
+ * @n_points:    number of points
+ *
+ * Zooms an array of points from image coordinates to display
+ * coordinates, like gimp_display_shell_zoom_xy_f() does for a single
+ * point.  @src_points and @dest_points may be the same array.
+ **/
+void
+gimp_display_shell_zoom_points (GimpDisplayShell  *shell,
+                                const GimpVector2 *src_points,
+                                GimpVector2       *dest_points,
+                                gint               n_points)
+{
+  const gdouble scale_x  = shell->scale_x;
+  const gdouble scale_y  = shell->scale_y;
+  const gdouble offset_x = shell->offset_x;
+  const gdouble offset_y = shell->offset_y;
+  gint          i;
+
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  for (i = 0; i < n_points; i++)
+    {
+      dest_points[i].x = PROJ_ROUND (src_points[i].x * scale_x) - offset_x;
+      dest_points[i].y = PROJ_ROUND (src_points[i].y * scale_y) - offset_y;
+    }
+}
+
 /**
  * gimp_display_shell_rotate_coords:
  * @shell:          a #GimpDisplayShell
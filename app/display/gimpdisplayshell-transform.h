@@ -59,6 +59,10 @@ void  gimp_display_shell_zoom_segments                 (GimpDisplayShell   *shel
                                                         gint                n_segs,
                                                         gdouble             offset_x,
                                                         gdouble             offset_y);
+void  gimp_display_shell_zoom_points                   (GimpDisplayShell   *shell,
+                                                        const GimpVector2  *src_points,
+                                                        GimpVector2        *dest_points,
+                                                        gint                n_points);
 
 
 /*  rotate: functions to transform from unrotated and unflipped but
@@ -820,6 +820,7 @@ gimp_display_shell_dispose (GObject *object)
     }
 
   g_clear_pointer (&shell->mask_surface, cairo_surface_destroy);
+  g_clear_pointer (&shell->quick_mask_surface, cairo_surface_destroy);
   g_clear_pointer (&shell->checkerboard, cairo_pattern_destroy);
 
   gimp_display_shell_profile_finalize (shell);
@@ -1029,6 +1030,8 @@ gimp_display_shell_set_priority_viewport (GimpDisplayShell *shell)
 
       gimp_display_shell_untransform_viewport (shell, &x, &y, &width, &height);
       gimp_projection_set_priority_rect (projection, x, y, width, height);
+      gimp_projection_set_priority_scale (projection,
+                                          MAX (shell->scale_x, shell->scale_y));
     }
 }
 
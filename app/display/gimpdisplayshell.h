@@ -168,6 +168,7 @@ struct _GimpDisplayShell
 
   GimpDisplayXfer   *xfer;             /*  manages image buffer transfers     */
   cairo_surface_t   *mask_surface;     /*  buffer for rendering the mask      */
+  cairo_surface_t   *quick_mask_surface; /*  buffer for rendering quick mask  */
   cairo_pattern_t   *checkerboard;     /*  checkerboard pattern               */
 
   gint               paused_count;
@@ -206,7 +207,12 @@ struct _GimpDisplayShell
   GimpRGB            mask_color;
   gboolean           mask_inverted;
 
+  GimpChannel       *quick_mask;       /*  composited on the projection       */
+
   GimpMotionBuffer  *motion_buffer;
+  gint64             paint_input_time; /*  receive time of the oldest input
+                                        *  painted but not drawn yet
+                                        */
 
   GQueue            *zoom_focus_pointer_queue;
 
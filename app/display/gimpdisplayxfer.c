@@ -28,7 +28,14 @@
 #include "gimpdisplayxfer.h"
 
 
-#define NUM_PAGES 2
+/*  the render surfaces are created similar to the window, which makes
+ *  them shared-memory images where the backend supports it, so pixels
+ *  are rendered straight into memory the display server reads from.
+ *  switching to a page waits until the server is done with it, so use
+ *  three pages, to make that wait unlikely while the other two are
+ *  still being transferred.
+ */
+#define NUM_PAGES 3
 
 typedef struct _RTree     RTree;
 typedef struct _RTreeNode RTreeNode;
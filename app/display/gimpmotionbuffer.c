@@ -39,6 +39,12 @@
 #define DIRECTION_RADIUS     (1.0 / MAX (scale_x, scale_y))
 #define SMOOTH_FACTOR        0.3
 
+/* while coalescing, queued events which lie within this many screen
+ * pixels of the segment joining their neighbours are merged into it
+ */
+#define COALESCE_PRECISION   1.0
+#define COALESCE_PRESSURE    0.02
+
 
 enum
 {
@@ -75,6 +81,13 @@ static void     gimp_motion_buffer_interpolate_stroke  (GimpMotionBuffer *buffer
                                                         GimpCoords       *coords);
 static gboolean gimp_motion_buffer_event_queue_timeout (GimpMotionBuffer *buffer);
 
+static void     gimp_motion_buffer_coalesce_events     (GimpMotionBuffer *buffer,
+                                                        gint              n_events);
+static void     gimp_motion_buffer_emit_strokes        (GimpMotionBuffer *buffer,
+                                                        GdkModifierType   state,
+                                                        guint32           time);
+static gboolean gimp_motion_buffer_coalesce_idle       (GimpMotionBuffer *buffer);
+
 
 G_DEFINE_TYPE (GimpMotionBuffer, gimp_motion_buffer, GIMP_TYPE_OBJECT)
 
@@ -136,6 +149,12 @@ gimp_motion_buffer_dispose (GObject *object)
       buffer->event_delay_timeout = 0;
     }
 
+  if (buffer->coalesce_idle)
+    {
+      g_source_remove (buffer->coalesce_idle);
+      buffer->coalesce_idle = 0;
+    }
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -208,6 +227,8 @@ gimp_motion_buffer_begin_stroke (GimpMotionBuffer *buffer,
   buffer->last_read_motion_time = time;
 
   *last_motion = buffer->last_coords;
+
+  buffer->last_stroke_coords = buffer->last_coords;
 }
 
 void
@@ -222,6 +243,17 @@ gimp_motion_buffer_end_stroke (GimpMotionBuffer *buffer)
     }
 
   gimp_motion_buffer_event_queue_timeout (buffer);
+
+  /*  the tool must see all of the stroke before it ends  */
+  if (buffer->coalesce_idle)
+    {
+      g_source_remove (buffer->coalesce_idle);
+      buffer->coalesce_idle = 0;
+
+      gimp_motion_buffer_emit_strokes (buffer,
+                                       buffer->coalesce_state,
+                                       buffer->coalesce_time);
+    }
 }
 
 /**
@@ -426,6 +458,12 @@ gimp_motion_buffer_motion_event (GimpMotionBuffer *buffer,
 
   g_array_append_val (buffer->event_queue, *coords);
 
+  /*  we are called right from the canvas event handler, so this is when
+   *  the event was received, as far as input latency is concerned
+   */
+  if (! buffer->input_time)
+    buffer->input_time = g_get_monotonic_time ();
+
   buffer->last_coords            = *coords;
   buffer->last_motion_time       = time;
   buffer->last_motion_delta_time = delta_time;
@@ -444,13 +482,41 @@ gimp_motion_buffer_get_last_motion_time (GimpMotionBuffer *buffer)
   return buffer->last_read_motion_time;
 }
 
+/**
+ * gimp_motion_buffer_get_input_time:
+ * @buffer: a #GimpMotionBuffer
+ *
+ * Returns: the monotonic time the oldest of the events currently being
+ *          emitted by the "stroke" signal was received, or 0 when
+ *          called outside of a "stroke" handler.
+ */
+gint64
+gimp_motion_buffer_get_input_time (GimpMotionBuffer *buffer)
+{
+  g_return_val_if_fail (GIMP_IS_MOTION_BUFFER (buffer), 0);
+
+  return buffer->stroke_input_time;
+}
+
+/**
+ * gimp_motion_buffer_request_stroke:
+ * @buffer:
+ * @state:
+ * @time:
+ *
+ * Emits "stroke" for the queued events.  When the stroke handlers
+ * take longer than the time between two events, the buffer switches
+ * to coalescing: the events are handed over from an idle handler,
+ * once all pending input has been read, and the events which lie
+ * close enough to the line between their neighbours are merged into
+ * a single segment, so that the latency stays bounded.
+ **/
 void
 gimp_motion_buffer_request_stroke (GimpMotionBuffer *buffer,
                                    GdkModifierType   state,
                                    guint32           time)
 {
   GdkModifierType  event_state;
-  gint             keep = 0;
 
   g_return_if_fail (GIMP_IS_MOTION_BUFFER (buffer));
 
@@ -458,8 +524,6 @@ gimp_motion_buffer_request_stroke (GimpMotionBuffer *buffer,
     {
       /* If we are in delay we use LAST state, not current */
       event_state = buffer->last_active_state;
-
-      keep = 1; /* Holding one event in buf */
     }
   else
     {
@@ -475,14 +539,22 @@ gimp_motion_buffer_request_stroke (GimpMotionBuffer *buffer,
 
   buffer->last_active_state = state;
 
-  while (buffer->event_queue->len > keep)
+  if (buffer->coalesce)
     {
-      GimpCoords buf_coords;
-
-      gimp_motion_buffer_pop_event_queue (buffer, &buf_coords);
+      buffer->coalesce_state = event_state;
+      buffer->coalesce_time  = time;
 
-      g_signal_emit (buffer, motion_buffer_signals[STROKE], 0,
-                     &buf_coords, time, event_state);
+      if (! buffer->coalesce_idle)
+        {
+          buffer->coalesce_idle =
+            g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                             (GSourceFunc) gimp_motion_buffer_coalesce_idle,
+                             buffer, NULL);
+        }
+    }
+  else
+    {
+      gimp_motion_buffer_emit_strokes (buffer, event_state, time);
     }
 
   if (buffer->event_delay)
@@ -592,3 +664,147 @@ gimp_motion_buffer_event_queue_timeout (GimpMotionBuffer *buffer)
 
   return FALSE;
 }
+
+/* removes those of the first 'n_events' queued events which lie within
+ * COALESCE_PRECISION screen pixels, and COALESCE_PRESSURE pressure, of
+ * the segment joining the preceding and following kept events.  the
+ * last event is always kept.
+ */
+static void
+gimp_motion_buffer_coalesce_events (GimpMotionBuffer *buffer,
+                                    gint              n_events)
+{
+  GArray     *queue = buffer->event_queue;
+  GimpCoords *events;
+  GimpCoords  anchor;
+  gint        start;
+  gint        n_kept = 0;
+  gint        i;
+
+  if (n_events < 3)
+    return;
+
+  events = &g_array_index (queue, GimpCoords, 0);
+  anchor = buffer->last_stroke_coords;
+  start  = 0;
+
+  for (i = 1; i < n_events; i++)
+    {
+      const GimpCoords *end       = &events[i];
+      gdouble           precision = COALESCE_PRECISION /
+                                    MAX (end->xscale, end->yscale);
+      gdouble           dx        = end->x - anchor.x;
+      gdouble           dy        = end->y - anchor.y;
+      gdouble           length2   = SQR (dx) + SQR (dy);
+      gboolean          fits      = TRUE;
+      gint              j;
+
+      /*  can all the events since the last kept one be merged into the
+       *  segment from it to this one?
+       */
+      for (j = start; j < i && fits; j++)
+        {
+          const GimpCoords *c = &events[j];
+          gdouble           t = 0.0;
+          gdouble           x, y;
+
+          if (length2 > 0.0)
+            {
+              t = ((c->x - anchor.x) * dx + (c->y - anchor.y) * dy) / length2;
+              t = CLAMP (t, 0.0, 1.0);
+            }
+
+          x = anchor.x + t * dx;
+          y = anchor.y + t * dy;
+
+          if (SQR (c->x - x) + SQR (c->y - y) > SQR (precision) ||
+              fabs (c->pressure -
+                    (anchor.pressure + t * (end->pressure - anchor.pressure))) >
+              COALESCE_PRESSURE)
+            {
+              fits = FALSE;
+            }
+        }
+
+      if (! fits)
+        {
+          /*  keep the previous event, and start a new segment there  */
+          anchor = events[i - 1];
+          events[n_kept++] = anchor;
+          start = i;
+        }
+    }
+
+  events[n_kept++] = events[n_events - 1];
+
+  if (n_kept < n_events)
+    g_array_remove_range (queue, n_kept, n_events - n_kept);
+}
+
+static void
+gimp_motion_buffer_emit_strokes (GimpMotionBuffer *buffer,
+                                 GdkModifierType   state,
+                                 guint32           time)
+{
+  gint keep = 0;
+  gint n_events;
+
+  if (buffer->event_delay)
+    keep = 1; /* Holding one event in buf */
+
+  n_events = (gint) buffer->event_queue->len - keep;
+
+  if (n_events <= 0)
+    return;
+
+  if (buffer->coalesce)
+    gimp_motion_buffer_coalesce_events (buffer, n_events);
+
+  buffer->stroke_input_time = buffer->input_time;
+
+  /*  a held-back event keeps the receive time of the emitted ones, which
+   *  overestimates its latency by at most one event
+   */
+  if (! keep)
+    buffer->input_time = 0;
+
+  while (buffer->event_queue->len > keep)
+    {
+      GimpCoords buf_coords;
+      gint64     start = g_get_monotonic_time ();
+      gdouble    duration;
+
+      gimp_motion_buffer_pop_event_queue (buffer, &buf_coords);
+
+      g_signal_emit (buffer, motion_buffer_signals[STROKE], 0,
+                     &buf_coords, time, state);
+
+      buffer->last_stroke_coords = buf_coords;
+
+      duration = (g_get_monotonic_time () - start) / 1000.0;
+
+      buffer->stroke_duration = (buffer->stroke_duration * (1 - SMOOTH_FACTOR) +
+                                 duration * SMOOTH_FACTOR);
+    }
+
+  /*  coalesce while the handlers take longer than the time between
+   *  two events
+   */
+  buffer->stroke_input_time = 0;
+
+  buffer->coalesce = (buffer->last_motion_delta_time > 0.0 &&
+                      buffer->stroke_duration >
+                      buffer->last_motion_delta_time);
+}
+
+static gboolean
+gimp_motion_buffer_coalesce_idle (GimpMotionBuffer *buffer)
+{
+  buffer->coalesce_idle = 0;
+
+  gimp_motion_buffer_emit_strokes (buffer,
+                                   buffer->coalesce_state,
+                                   buffer->coalesce_time);
+
+  return FALSE;
+}
@@ -56,6 +56,24 @@ struct _GimpMotionBuffer
 
   gint               event_delay_timeout;
   GdkModifierType    last_active_state;
+
+  gdouble            stroke_duration;   /* smoothed time, in ms, taken by
+                                         *  the stroke handlers
+                                         */
+  gboolean           coalesce;          /* TRUE if the handlers can't keep
+                                         *  up with the events
+                                         */
+  guint              coalesce_idle;
+  GdkModifierType    coalesce_state;
+  guint32            coalesce_time;
+  GimpCoords         last_stroke_coords;
+
+  gint64             input_time;        /* monotonic time the oldest queued
+                                         *  event was received
+                                         */
+  gint64             stroke_input_time; /* the same, for the events being
+                                         *  emitted
+                                         */
 };
 
 struct _GimpMotionBufferClass
@@ -87,6 +105,7 @@ gboolean   gimp_motion_buffer_motion_event         (GimpMotionBuffer *buffer,
                                                     guint32           time,
                                                     gboolean          event_fill);
 guint32    gimp_motion_buffer_get_last_motion_time (GimpMotionBuffer *buffer);
+gint64     gimp_motion_buffer_get_input_time       (GimpMotionBuffer *buffer);
 
 void       gimp_motion_buffer_request_stroke       (GimpMotionBuffer *buffer,
                                                     GdkModifierType   state,
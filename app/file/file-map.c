@@ -0,0 +1,592 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * file-map.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* runs load -> process -> export over all files matching a pattern.
+ *
+ * the core is single threaded, so the parallelism comes from the
+ * plug-ins: every stage that is a plug-in procedure is started without
+ * waiting for it, and up to max_jobs files are in flight at any time,
+ * each in whatever stage it has reached.  procedures living in the core
+ * (like xcf-load or script-fu scripts) run synchronously when their
+ * file gets to them.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimp-gui.h"
+#include "core/gimpcontext.h"
+#include "core/gimpimage.h"
+#include "core/gimpparamspecs.h"
+#include "core/gimpprogress.h"
+
+#include "pdb/gimppdb.h"
+#include "pdb/gimppdbcontext.h"
+#include "pdb/gimpprocedure.h"
+
+#define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
+#include "plug-in/gimppluginmanager-call.h"
+#include "plug-in/gimppluginmanager-file.h"
+#include "plug-in/gimppluginprocedure.h"
+
+#include "file-map.h"
+
+#include "gimp-intl.h"
+
+
+typedef enum
+{
+  FILE_MAP_LOAD,
+  FILE_MAP_PROCESS,
+  FILE_MAP_EXPORT
+} FileMapStage;
+
+typedef struct _FileMap     FileMap;
+typedef struct _FileMapItem FileMapItem;
+
+struct _FileMap
+{
+  Gimp          *gimp;
+  GimpContext   *context;
+  GimpProgress  *progress;
+  GimpProcedure *procedure;
+  const gchar   *output;
+  gint           max_jobs;
+
+  GList         *files;     /*  GFiles not started yet        */
+  GQueue         ready;     /*  items waiting for their stage  */
+  gint           n_files;
+  gint           n_running;
+  gint           n_processed;
+  gint           n_failed;
+
+  guint          idle_id;
+  GMainLoop     *main_loop;
+};
+
+struct _FileMapItem
+{
+  FileMap      *map;
+  GFile        *file;
+  GFile        *output;
+  GimpContext  *context;
+  FileMapStage  stage;
+  gint          image_ID;  /*  the image may be deleted between stages  */
+};
+
+
+static GList    * file_map_glob          (const gchar     *pattern,
+                                          GError         **error);
+
+static void       file_map_set_run_mode  (GValue          *value);
+
+static gboolean   file_map_idle          (FileMap         *map);
+static void       file_map_schedule      (FileMap         *map);
+
+static void       file_map_item_run      (FileMapItem     *item);
+static void       file_map_item_return   (GimpPlugIn      *plug_in,
+                                          GimpValueArray  *return_vals,
+                                          FileMapItem     *item);
+static void       file_map_item_advance  (FileMapItem     *item,
+                                          GimpValueArray  *return_vals,
+                                          const GError    *error);
+static void       file_map_item_finish   (FileMapItem     *item,
+                                          gboolean         success,
+                                          const gchar     *failure);
+
+
+/*  public functions  */
+
+gboolean
+file_map (Gimp          *gimp,
+          GimpContext   *context,
+          GimpProgress  *progress,
+          const gchar   *pattern,
+          const gchar   *proc_name,
+          const gchar   *output,
+          gint           max_jobs,
+          gint          *n_processed,
+          gint          *n_failed,
+          GError       **error)
+{
+  FileMap map = { 0, };
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), FALSE);
+  g_return_val_if_fail (GIMP_IS_CONTEXT (context), FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
+  g_return_val_if_fail (pattern != NULL, FALSE);
+  g_return_val_if_fail (output != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! strstr (output, "%s"))
+    {
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                           _("The output file name must contain '%s' "
+                             "for the input file's name"));
+      return FALSE;
+    }
+
+  if (proc_name && *proc_name)
+    {
+      map.procedure = gimp_pdb_lookup_procedure (gimp->pdb, proc_name);
+
+      if (! map.procedure)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                       _("Procedure '%s' not found"), proc_name);
+          return FALSE;
+        }
+
+      if (map.procedure->num_args < 3                           ||
+          ! GIMP_IS_PARAM_SPEC_IMAGE_ID    (map.procedure->args[1]) ||
+          ! GIMP_IS_PARAM_SPEC_DRAWABLE_ID (map.procedure->args[2]))
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                       _("Procedure '%s' does not take a run mode, "
+                         "an image and a drawable"), proc_name);
+          return FALSE;
+        }
+    }
+
+  map.files = file_map_glob (pattern, error);
+
+  if (! map.files && error && *error)
+    return FALSE;
+
+  map.gimp     = gimp;
+  map.context  = context;
+  map.progress = progress;
+  map.output   = output;
+  map.max_jobs = max_jobs > 0 ? max_jobs : g_get_num_processors ();
+  map.n_files  = g_list_length (map.files);
+
+  g_queue_init (&map.ready);
+
+  if (map.files)
+    {
+      if (progress)
+        gimp_progress_start (progress, FALSE, _("Processing %d files"),
+                             map.n_files);
+
+      map.main_loop = g_main_loop_new (NULL, FALSE);
+
+      file_map_schedule (&map);
+
+      gimp_threads_leave (gimp);
+      g_main_loop_run (map.main_loop);
+      gimp_threads_enter (gimp);
+
+      g_main_loop_unref (map.main_loop);
+
+      if (progress)
+        gimp_progress_end (progress);
+    }
+
+  if (n_processed)
+    *n_processed = map.n_processed;
+
+  if (n_failed)
+    *n_failed = map.n_failed;
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static void
+file_map_set_run_mode (GValue *value)
+{
+  /*  plug-ins take the run mode as an int32, core procedures as an enum  */
+  if (G_VALUE_HOLDS_ENUM (value))
+    g_value_set_enum (value, GIMP_RUN_NONINTERACTIVE);
+  else
+    g_value_set_int (value, GIMP_RUN_NONINTERACTIVE);
+}
+
+/*  only the file name part of the pattern may contain wildcards  */
+static GList *
+file_map_glob (const gchar  *pattern,
+               GError      **error)
+{
+  gchar        *dirname  = g_path_get_dirname (pattern);
+  gchar        *basename = g_path_get_basename (pattern);
+  GPatternSpec *spec;
+  GDir         *dir;
+  const gchar  *name;
+  GList        *files    = NULL;
+
+  dir = g_dir_open (dirname, 0, error);
+
+  if (! dir)
+    {
+      g_free (dirname);
+      g_free (basename);
+
+      return NULL;
+    }
+
+  spec = g_pattern_spec_new (basename);
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      gchar *filename;
+
+      if (! g_pattern_match_string (spec, name))
+        continue;
+
+      filename = g_build_filename (dirname, name, NULL);
+
+      if (g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+        files = g_list_prepend (files, filename);
+      else
+        g_free (filename);
+    }
+
+  g_pattern_spec_free (spec);
+  g_dir_close (dir);
+  g_free (dirname);
+  g_free (basename);
+
+  files = g_list_sort (files, (GCompareFunc) strcmp);
+
+  /*  turn the names into files, in place  */
+  {
+    GList *list;
+
+    for (list = files; list; list = g_list_next (list))
+      {
+        gchar *filename = list->data;
+
+        list->data = g_file_new_for_path (filename);
+        g_free (filename);
+      }
+  }
+
+  return files;
+}
+
+static gboolean
+file_map_idle (FileMap *map)
+{
+  FileMapItem *item;
+
+  map->idle_id = 0;
+
+  /*  move files already in flight along first, so that finished images
+   *  are exported and released before new ones get loaded
+   */
+  while ((item = g_queue_pop_head (&map->ready)))
+    file_map_item_run (item);
+
+  while (map->files && map->n_running < map->max_jobs)
+    {
+      item = g_slice_new0 (FileMapItem);
+
+      item->map     = map;
+      item->file    = map->files->data;
+      item->context = gimp_pdb_context_new (map->gimp, map->context, TRUE);
+      item->stage   = FILE_MAP_LOAD;
+
+      map->files = g_list_delete_link (map->files, map->files);
+      map->n_running++;
+
+      file_map_item_run (item);
+    }
+
+  if (! map->files && map->n_running == 0 && ! map->idle_id)
+    g_main_loop_quit (map->main_loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+file_map_schedule (FileMap *map)
+{
+  if (! map->idle_id)
+    map->idle_id = g_idle_add ((GSourceFunc) file_map_idle, map);
+}
+
+static void
+file_map_item_run (FileMapItem *item)
+{
+  FileMap        *map       = item->map;
+  Gimp           *gimp      = map->gimp;
+  GimpProcedure  *procedure = NULL;
+  GimpValueArray *args;
+  GimpValueArray *return_vals;
+  GimpImage      *image     = NULL;
+  GimpDrawable   *drawable  = NULL;
+  GError         *error     = NULL;
+
+  switch (item->stage)
+    {
+    case FILE_MAP_LOAD:
+      procedure = (GimpProcedure *)
+        gimp_plug_in_manager_file_procedure_find (gimp->plug_in_manager,
+                                                  GIMP_FILE_PROCEDURE_GROUP_OPEN,
+                                                  item->file, &error);
+      break;
+
+    case FILE_MAP_PROCESS:
+      procedure = map->procedure;
+      break;
+
+    case FILE_MAP_EXPORT:
+      {
+        const gchar *subst    = strstr (map->output, "%s");
+        gchar       *basename = g_file_get_basename (item->file);
+        gchar       *ext      = strrchr (basename, '.');
+        gchar       *filename;
+
+        if (ext && ext != basename)
+          *ext = '\0';
+
+        filename = g_strdup_printf ("%.*s%s%s",
+                                    (gint) (subst - map->output), map->output,
+                                    basename, subst + 2);
+
+        item->output = g_file_new_for_path (filename);
+
+        g_free (filename);
+        g_free (basename);
+
+        procedure = (GimpProcedure *)
+          gimp_plug_in_manager_file_procedure_find (gimp->plug_in_manager,
+                                                    GIMP_FILE_PROCEDURE_GROUP_EXPORT,
+                                                    item->output, &error);
+      }
+      break;
+    }
+
+  if (! procedure)
+    {
+      file_map_item_finish (item, FALSE, error ? error->message : NULL);
+      g_clear_error (&error);
+      return;
+    }
+
+  if (item->image_ID)
+    {
+      image = gimp_image_get_by_ID (gimp, item->image_ID);
+
+      if (! image)
+        {
+          file_map_item_finish (item, FALSE,
+                                _("The image was deleted"));
+          return;
+        }
+
+      drawable = gimp_image_get_active_drawable (image);
+
+      if (! drawable)
+        {
+          file_map_item_finish (item, FALSE,
+                                _("The image has no active drawable"));
+          return;
+        }
+    }
+
+  /*  arguments past the ones we set keep their defaults  */
+  args = gimp_procedure_get_arguments (procedure);
+
+  file_map_set_run_mode (gimp_value_array_index (args, 0));
+
+  if (item->stage == FILE_MAP_LOAD)
+    {
+      gchar *path = g_file_get_path (item->file);
+      gchar *uri  = g_file_get_uri (item->file);
+
+      if (GIMP_PLUG_IN_PROCEDURE (procedure)->handles_uri)
+        g_value_set_string (gimp_value_array_index (args, 1), uri);
+      else
+        g_value_set_string (gimp_value_array_index (args, 1), path);
+
+      g_value_set_string (gimp_value_array_index (args, 2), uri);
+
+      g_free (path);
+      g_free (uri);
+    }
+  else
+    {
+      gimp_value_set_image    (gimp_value_array_index (args, 1), image);
+      gimp_value_set_drawable (gimp_value_array_index (args, 2), drawable);
+
+      if (item->stage == FILE_MAP_EXPORT)
+        {
+          gchar *path = g_file_get_path (item->output);
+          gchar *uri  = g_file_get_uri (item->output);
+
+          if (GIMP_PLUG_IN_PROCEDURE (procedure)->handles_uri)
+            g_value_set_string (gimp_value_array_index (args, 3), uri);
+          else
+            g_value_set_string (gimp_value_array_index (args, 3), path);
+
+          g_value_set_string (gimp_value_array_index (args, 4), uri);
+
+          g_free (path);
+          g_free (uri);
+        }
+    }
+
+  if (GIMP_IS_PLUG_IN_PROCEDURE (procedure) &&
+      procedure->proc_type == GIMP_PLUGIN)
+    {
+      /*  don't wait, the item moves on when the plug-in returns  */
+      gimp_plug_in_manager_call_run_async (gimp->plug_in_manager,
+                                           item->context, NULL,
+                                           GIMP_PLUG_IN_PROCEDURE (procedure),
+                                           args,
+                                           (GimpPlugInReturnFunc) file_map_item_return,
+                                           item);
+    }
+  else
+    {
+      return_vals =
+        gimp_pdb_execute_procedure_by_name_args (gimp->pdb, item->context,
+                                                 NULL, &error,
+                                                 gimp_object_get_name (procedure),
+                                                 args);
+
+      file_map_item_advance (item, return_vals, error);
+
+      gimp_value_array_unref (return_vals);
+      g_clear_error (&error);
+    }
+
+  gimp_value_array_unref (args);
+}
+
+static void
+file_map_item_return (GimpPlugIn     *plug_in,
+                      GimpValueArray *return_vals,
+                      FileMapItem    *item)
+{
+  file_map_item_advance (item, return_vals, NULL);
+}
+
+static void
+file_map_item_advance (FileMapItem    *item,
+                       GimpValueArray *return_vals,
+                       const GError   *error)
+{
+  FileMap           *map    = item->map;
+  GimpPDBStatusType  status = GIMP_PDB_EXECUTION_ERROR;
+
+  if (return_vals && gimp_value_array_length (return_vals) > 0)
+    status = g_value_get_enum (gimp_value_array_index (return_vals, 0));
+
+  if (status != GIMP_PDB_SUCCESS)
+    {
+      file_map_item_finish (item, FALSE,
+                            error ? error->message :
+                            status == GIMP_PDB_CANCEL ? _("Cancelled") : NULL);
+      return;
+    }
+
+  switch (item->stage)
+    {
+    case FILE_MAP_LOAD:
+      {
+        GimpImage *image = NULL;
+
+        if (gimp_value_array_length (return_vals) > 1)
+          image = gimp_value_get_image (gimp_value_array_index (return_vals, 1),
+                                        map->gimp);
+
+        if (! image)
+          {
+            file_map_item_finish (item, FALSE, NULL);
+            return;
+          }
+
+        item->image_ID = gimp_image_get_ID (image);
+      }
+
+      item->stage = map->procedure ? FILE_MAP_PROCESS : FILE_MAP_EXPORT;
+      break;
+
+    case FILE_MAP_PROCESS:
+      item->stage = FILE_MAP_EXPORT;
+      break;
+
+    case FILE_MAP_EXPORT:
+      file_map_item_finish (item, TRUE, NULL);
+      return;
+    }
+
+  /*  we may be called from a closing plug-in, run the next stage from
+   *  the main loop
+   */
+  g_queue_push_tail (&map->ready, item);
+  file_map_schedule (map);
+}
+
+static void
+file_map_item_finish (FileMapItem *item,
+                      gboolean     success,
+                      const gchar *failure)
+{
+  FileMap   *map   = item->map;
+  GimpImage *image = NULL;
+
+  if (success)
+    {
+      map->n_processed++;
+    }
+  else
+    {
+      map->n_failed++;
+
+      gimp_message (map->gimp, G_OBJECT (map->progress),
+                    GIMP_MESSAGE_WARNING,
+                    _("Processing '%s' failed: %s"),
+                    gimp_file_get_utf8_name (item->file),
+                    failure ? failure : _("Unknown error"));
+    }
+
+  if (item->image_ID)
+    image = gimp_image_get_by_ID (map->gimp, item->image_ID);
+
+  if (image && gimp_image_get_display_count (image) == 0)
+    g_object_unref (image);
+
+  if (map->progress)
+    gimp_progress_set_value (map->progress,
+                             (gdouble) (map->n_processed + map->n_failed) /
+                             map->n_files);
+
+  g_object_unref (item->file);
+  g_clear_object (&item->output);
+  g_object_unref (item->context);
+  g_slice_free (FileMapItem, item);
+
+  map->n_running--;
+
+  file_map_schedule (map);
+}
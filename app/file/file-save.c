@@ -71,6 +71,7 @@ file_save (Gimp                *gimp,
   gchar             *uri        = NULL;
   gint32             image_ID;
   gint32             drawable_ID;
+  gint               dirty;
   GError            *my_error   = NULL;
 
   g_return_val_if_fail (GIMP_IS_GIMP (gimp), GIMP_PDB_CALLING_ERROR);
@@ -89,6 +90,14 @@ file_save (Gimp                *gimp,
   g_object_ref (image);
   g_object_ref (file);
 
+  /*  the image is still being written in the background  */
+  if (gimp_image_is_busy (image))
+    {
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("The image is still being saved"));
+      goto out;
+    }
+
   drawable = gimp_image_get_active_drawable (image);
 
   if (! drawable)
@@ -170,6 +179,9 @@ file_save (Gimp                *gimp,
   image_ID    = gimp_image_get_ID (image);
   drawable_ID = gimp_item_get_ID (GIMP_ITEM (drawable));
 
+  /*  the image can be changed while it is being saved  */
+  dirty = gimp_image_get_dirty_count (image);
+
   return_vals =
     gimp_pdb_execute_procedure_by_name (image->gimp->pdb,
                                         gimp_get_user_context (gimp),
@@ -224,7 +236,16 @@ file_save (Gimp                *gimp,
            */
           gimp_image_set_imported_file (image, NULL);
 
+          dirty = gimp_image_get_dirty_count (image) - dirty;
+
           gimp_image_clean_all (image);
+
+          /*  keep the changes that didn't make it into the file  */
+          for (; dirty > 0; dirty--)
+            gimp_image_dirty (image, GIMP_DIRTY_ALL);
+
+          for (; dirty < 0; dirty++)
+            gimp_image_clean (image, GIMP_DIRTY_ALL);
         }
       else if (export_backward)
         {
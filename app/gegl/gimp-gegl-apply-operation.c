@@ -26,13 +26,17 @@
 #include <gio/gio.h>
 #include <gegl.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "gimp-gegl-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimp-transform-utils.h"
 #include "core/gimp-utils.h"
 #include "core/gimpprogress.h"
 
 #include "gimp-gegl-apply-operation.h"
+#include "gimp-gegl-loops.h"
 #include "gimp-gegl-nodes.h"
 #include "gegl/gimp-gegl-utils.h"
 
@@ -63,6 +67,43 @@ gimp_gegl_apply_operation_cancel (GimpProgress *progress,
   *cancel = TRUE;
 }
 
+/*  the size of the tiles gimp_gegl_apply_cached_operation() renders
+ *  one after the other, reporting progress and checking for cancellation
+ *  after each.  the operation's graph belongs to the caller and can't be
+ *  processed from several threads at once, so the tiles are all
+ *  rendered on the calling thread
+ */
+#define APPLY_TILE_SIZE 128
+
+static void
+gimp_gegl_apply_cached_operation_add_tiles (GArray                      *tiles,
+                                            const cairo_rectangle_int_t *rect)
+{
+  gint x, y;
+
+  /*  align the tiles to a grid, so that they match the buffers' tiles  */
+  for (y = rect->y; y < rect->y + rect->height; )
+    {
+      gint y2 = MIN (rect->y + rect->height,
+                     (y / APPLY_TILE_SIZE + 1) * APPLY_TILE_SIZE);
+
+      for (x = rect->x; x < rect->x + rect->width; )
+        {
+          gint          x2 = MIN (rect->x + rect->width,
+                                  (x / APPLY_TILE_SIZE + 1) * APPLY_TILE_SIZE);
+          GeglRectangle tile;
+
+          tile = *GEGL_RECTANGLE (x, y, x2 - x, y2 - y);
+
+          g_array_append_val (tiles, tile);
+
+          x = x2;
+        }
+
+      y = y2;
+    }
+}
+
 gboolean
 gimp_gegl_apply_cached_operation (GeglBuffer          *src_buffer,
                                   GimpProgress        *progress,
@@ -76,14 +117,17 @@ gimp_gegl_apply_cached_operation (GeglBuffer          *src_buffer,
                                   gint                 n_valid_rects,
                                   gboolean             cancellable)
 {
-  GeglNode      *gegl;
-  GeglNode      *dest_node;
-  GeglNode      *operation_src_node = NULL;
-  GeglRectangle  rect = { 0, };
-  GeglProcessor *processor          = NULL;
-  gboolean       progress_started   = FALSE;
-  gdouble        value;
-  gboolean       cancel             = FALSE;
+  GeglNode       *gegl;
+  GeglNode       *operation_src_node = NULL;
+  GeglRectangle   rect = { 0, };
+  cairo_region_t *region;
+  GArray         *tiles;
+  gint            done_pixels        = 0;
+  gint            all_pixels;
+  gboolean        progress_started   = FALSE;
+  gboolean        cancel             = FALSE;
+  gint            n_rects;
+  gint            i;
 
   g_return_val_if_fail (src_buffer == NULL || GEGL_IS_BUFFER (src_buffer), FALSE);
   g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
@@ -113,9 +157,10 @@ gimp_gegl_apply_cached_operation (GeglBuffer          *src_buffer,
       GeglNode *src_node;
 
       /* dup() because reading and writing the same buffer doesn't
-       * work with area ops when using a processor. See bug #701875.
+       * work with area ops when the output is written in tiles, see
+       * bug #701875.
        */
-      if (progress && (src_buffer == dest_buffer))
+      if (src_buffer == dest_buffer)
         src_buffer = gegl_buffer_dup (src_buffer);
       else
         g_object_ref (src_buffer);
@@ -151,18 +196,8 @@ gimp_gegl_apply_cached_operation (GeglBuffer          *src_buffer,
                             operation, "input");
     }
 
-  dest_node = gegl_node_new_child (gegl,
-                                   "operation", "gegl:write-buffer",
-                                   "buffer",    dest_buffer,
-                                   NULL);
-
-  gegl_node_connect_to (operation, "output",
-                        dest_node, "input");
-
   if (progress)
     {
-      processor = gegl_node_new_processor (dest_node, &rect);
-
       if (gimp_progress_is_active (progress))
         {
           if (undo_desc)
@@ -184,101 +219,64 @@ gimp_gegl_apply_cached_operation (GeglBuffer          *src_buffer,
         }
     }
 
-  if (cache)
-    {
-      cairo_region_t *region;
-      gint            all_pixels;
-      gint            done_pixels = 0;
-      gint            n_rects;
-      gint            i;
+  tiles      = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
+  all_pixels = rect.width * rect.height;
 
-      region = cairo_region_create_rectangle ((cairo_rectangle_int_t *) &rect);
+  region = cairo_region_create_rectangle ((cairo_rectangle_int_t *) &rect);
 
-      all_pixels = rect.width * rect.height;
+  /*  copy what is already cached, and only render the rest  */
+  for (i = 0; i < n_valid_rects; i++)
+    {
+      gegl_buffer_copy (cache,       valid_rects + i, GEGL_ABYSS_NONE,
+                        dest_buffer, valid_rects + i);
 
-      for (i = 0; i < n_valid_rects; i++)
-        {
-          gegl_buffer_copy (cache,       valid_rects + i, GEGL_ABYSS_NONE,
-                            dest_buffer, valid_rects + i);
+      cairo_region_subtract_rectangle (region,
+                                       (cairo_rectangle_int_t *)
+                                       valid_rects + i);
 
-          cairo_region_subtract_rectangle (region,
-                                           (cairo_rectangle_int_t *)
-                                           valid_rects + i);
+      done_pixels += valid_rects[i].width * valid_rects[i].height;
 
-          done_pixels += valid_rects[i].width * valid_rects[i].height;
+      if (progress)
+        gimp_progress_set_value (progress,
+                                 (gdouble) done_pixels /
+                                 (gdouble) all_pixels);
+    }
 
-          if (progress)
-            gimp_progress_set_value (progress,
-                                     (gdouble) done_pixels /
-                                     (gdouble) all_pixels);
-        }
+  n_rects = cairo_region_num_rectangles (region);
 
-      n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t render_rect;
 
-      for (i = 0; ! cancel && (i < n_rects); i++)
-        {
-          cairo_rectangle_int_t render_rect;
-
-          cairo_region_get_rectangle (region, i, &render_rect);
-
-          if (progress)
-            {
-              gint rect_pixels = render_rect.width * render_rect.height;
-
-#ifdef REUSE_PROCESSOR
-              gegl_processor_set_rectangle (processor,
-                                            (GeglRectangle *) &render_rect);
-#else
-              g_object_unref (processor);
-              processor = gegl_node_new_processor (dest_node,
-                                                   (GeglRectangle *) &render_rect);
-#endif
-
-              while (! cancel && gegl_processor_work (processor, &value))
-                {
-                  gimp_progress_set_value (progress,
-                                           ((gdouble) done_pixels +
-                                            value * rect_pixels) /
-                                           (gdouble) all_pixels);
-
-                  if (cancellable)
-                    while (! cancel && g_main_context_pending (NULL))
-                      g_main_context_iteration (NULL, FALSE);
-                }
-
-              done_pixels += rect_pixels;
-            }
-          else
-            {
-              gegl_node_blit (dest_node, 1.0, (GeglRectangle *) &render_rect,
-                              NULL, NULL, 0, GEGL_BLIT_DEFAULT);
-            }
-        }
+      cairo_region_get_rectangle (region, i, &render_rect);
 
-      cairo_region_destroy (region);
+      gimp_gegl_apply_cached_operation_add_tiles (tiles, &render_rect);
     }
-  else
+
+  cairo_region_destroy (region);
+
+  for (i = 0; i < (gint) tiles->len && ! cancel; i++)
     {
+      const GeglRectangle *tile = &g_array_index (tiles, GeglRectangle, i);
+
+      gegl_node_blit_buffer (operation, dest_buffer, tile,
+                             0, GEGL_ABYSS_NONE);
+
+      done_pixels += tile->width * tile->height;
+
       if (progress)
         {
-          while (! cancel && gegl_processor_work (processor, &value))
-            {
-              gimp_progress_set_value (progress, value);
-
-              if (cancellable)
-                while (! cancel && g_main_context_pending (NULL))
-                  g_main_context_iteration (NULL, FALSE);
-            }
-        }
-      else
-        {
-          gegl_node_blit (dest_node, 1.0, &rect,
-                          NULL, NULL, 0, GEGL_BLIT_DEFAULT);
+          gimp_progress_set_value (progress,
+                                   (gdouble) done_pixels /
+                                   (gdouble) all_pixels);
+
+          if (cancellable)
+            while (! cancel && g_main_context_pending (NULL))
+              g_main_context_iteration (NULL, FALSE);
         }
     }
 
-  if (processor)
-    g_object_unref (processor);
+  g_array_free (tiles, TRUE);
 
   g_object_unref (gegl);
 
@@ -638,6 +636,56 @@ gimp_gegl_apply_opacity (GeglBuffer    *src_buffer,
   g_object_unref (node);
 }
 
+/*  downscaling the whole buffer is done by gimp_gegl_scale(), which is
+ *  much faster than sampling the source for each destination pixel
+ */
+static gboolean
+gimp_gegl_apply_scale_separable (GeglBuffer            *src_buffer,
+                                 GimpProgress          *progress,
+                                 const gchar           *undo_desc,
+                                 GeglBuffer            *dest_buffer,
+                                 GimpInterpolationType  interpolation_type,
+                                 gdouble                x,
+                                 gdouble                y)
+{
+  const GeglRectangle *src_rect  = gegl_buffer_get_extent (src_buffer);
+  const GeglRectangle *dest_rect = gegl_buffer_get_extent (dest_buffer);
+  gboolean             progress_started = FALSE;
+
+  if (interpolation_type == GIMP_INTERPOLATION_NONE ||
+      x > 1.0 || y > 1.0                            ||
+      src_rect->x  != 0 || src_rect->y  != 0        ||
+      dest_rect->x != 0 || dest_rect->y != 0        ||
+      dest_rect->width  != ROUND (src_rect->width  * x) ||
+      dest_rect->height != ROUND (src_rect->height * y))
+    {
+      return FALSE;
+    }
+
+  if (progress)
+    {
+      if (gimp_progress_is_active (progress))
+        {
+          if (undo_desc)
+            gimp_progress_set_text_literal (progress, undo_desc);
+        }
+      else
+        {
+          gimp_progress_start (progress, FALSE, "%s", undo_desc);
+
+          progress_started = TRUE;
+        }
+    }
+
+  gimp_gegl_scale (src_buffer, src_rect, dest_buffer, dest_rect,
+                   interpolation_type, progress);
+
+  if (progress_started)
+    gimp_progress_end (progress);
+
+  return TRUE;
+}
+
 void
 gimp_gegl_apply_scale (GeglBuffer            *src_buffer,
                        GimpProgress          *progress,
@@ -653,6 +701,11 @@ gimp_gegl_apply_scale (GeglBuffer            *src_buffer,
   g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
   g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
 
+  if (gimp_gegl_apply_scale_separable (src_buffer, progress, undo_desc,
+                                       dest_buffer, interpolation_type,
+                                       x, y))
+    return;
+
   node = gegl_node_new_child (NULL,
                               "operation", "gegl:scale-ratio",
                               "origin-x",   0.0,
@@ -713,6 +766,146 @@ gimp_gegl_apply_threshold (GeglBuffer    *src_buffer,
   g_object_unref (node);
 }
 
+/*  the height of the bands gimp_gegl_apply_transform() renders on
+ *  several threads at once
+ */
+#define TRANSFORM_BAND_HEIGHT 64
+
+typedef struct
+{
+  GeglBuffer            *src_buffer;
+  GeglBuffer            *dest_buffer;
+  GimpMatrix3           *transform;
+  GimpInterpolationType  interpolation_type;
+  GimpProgress          *progress;
+  GeglRectangle          rect;
+  gint                   n_bands;
+  gint                   next_band;
+  gint                   n_done;
+} TransformData;
+
+/*  each thread renders the bands it picks through a graph of its own,
+ *  so that each has its own sampler
+ */
+static void
+gimp_gegl_apply_transform_func (gint           i,
+                                gint           n,
+                                TransformData *data)
+{
+  GeglNode *graph;
+  GeglNode *src_node;
+  GeglNode *node;
+  gint      band;
+
+  graph = gegl_node_new ();
+
+  src_node = gegl_node_new_child (graph,
+                                  "operation", "gegl:buffer-source",
+                                  "buffer",    data->src_buffer,
+                                  NULL);
+
+  node = gegl_node_new_child (graph,
+                              "operation", "gegl:transform",
+                              "near-z",    GIMP_TRANSFORM_NEAR_Z,
+                              "sampler",   data->interpolation_type,
+                              NULL);
+
+  gimp_gegl_node_set_matrix (node, data->transform);
+
+  gegl_node_connect_to (src_node, "output",
+                        node,     "input");
+
+  while ((band = g_atomic_int_add (&data->next_band, 1)) < data->n_bands)
+    {
+      GeglRectangle rect = data->rect;
+      gint          n_done;
+
+      rect.y      += band * TRANSFORM_BAND_HEIGHT;
+      rect.height  = MIN (TRANSFORM_BAND_HEIGHT,
+                          data->rect.y + data->rect.height - rect.y);
+
+      gegl_node_blit_buffer (node, data->dest_buffer, &rect,
+                             0, GEGL_ABYSS_NONE);
+
+      n_done = g_atomic_int_add (&data->n_done, 1) + 1;
+
+      /*  thread 0 is the calling thread  */
+      if (i == 0 && data->progress)
+        {
+          gimp_progress_set_value (data->progress,
+                                   (gdouble) n_done / data->n_bands);
+        }
+    }
+
+  g_object_unref (graph);
+}
+
+/*  returns whether 'transform' only moves the source by whole pixels,
+ *  and if so, by how much
+ */
+static gboolean
+gimp_gegl_transform_is_translation (const GimpMatrix3 *transform,
+                                    gint              *x,
+                                    gint              *y)
+{
+  const gdouble tx = transform->coeff[0][2];
+  const gdouble ty = transform->coeff[1][2];
+
+  if (transform->coeff[0][0] == 1.0 && transform->coeff[0][1] == 0.0 &&
+      transform->coeff[1][0] == 0.0 && transform->coeff[1][1] == 1.0 &&
+      transform->coeff[2][0] == 0.0 && transform->coeff[2][1] == 0.0 &&
+      transform->coeff[2][2] == 1.0                                  &&
+      tx == floor (tx) && ty == floor (ty))
+    {
+      *x = tx;
+      *y = ty;
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*  returns whether 'transform' only scales 'src_rect' down, onto
+ *  whole pixels, and if so, onto which rectangle
+ */
+static gboolean
+gimp_gegl_transform_is_downscale (const GimpMatrix3   *transform,
+                                  const GeglRectangle *src_rect,
+                                  GeglRectangle       *dest_rect)
+{
+  const gdouble sx      = transform->coeff[0][0];
+  const gdouble sy      = transform->coeff[1][1];
+  const gdouble tx      = transform->coeff[0][2];
+  const gdouble ty      = transform->coeff[1][2];
+  const gdouble epsilon = 1e-6;
+  gdouble       x1, y1;
+  gdouble       x2, y2;
+
+  if (transform->coeff[0][1] != 0.0 || transform->coeff[1][0] != 0.0 ||
+      transform->coeff[2][0] != 0.0 || transform->coeff[2][1] != 0.0 ||
+      transform->coeff[2][2] != 1.0                                  ||
+      sx <= 0.0 || sx > 1.0                                          ||
+      sy <= 0.0 || sy > 1.0)
+    return FALSE;
+
+  x1 = sx * src_rect->x + tx;
+  y1 = sy * src_rect->y + ty;
+  x2 = sx * (src_rect->x + src_rect->width)  + tx;
+  y2 = sy * (src_rect->y + src_rect->height) + ty;
+
+  if (fabs (x1 - RINT (x1)) > epsilon || fabs (y1 - RINT (y1)) > epsilon ||
+      fabs (x2 - RINT (x2)) > epsilon || fabs (y2 - RINT (y2)) > epsilon)
+    return FALSE;
+
+  dest_rect->x      = RINT (x1);
+  dest_rect->y      = RINT (y1);
+  dest_rect->width  = RINT (x2) - dest_rect->x;
+  dest_rect->height = RINT (y2) - dest_rect->y;
+
+  return ! gegl_rectangle_is_empty (dest_rect);
+}
+
 void
 gimp_gegl_apply_transform (GeglBuffer            *src_buffer,
                            GimpProgress          *progress,
@@ -721,21 +914,84 @@ gimp_gegl_apply_transform (GeglBuffer            *src_buffer,
                            GimpInterpolationType  interpolation_type,
                            GimpMatrix3           *transform)
 {
-  GeglNode *node;
+  const GeglRectangle *src_rect;
+  const GeglRectangle *dest_extent;
+  GeglRectangle        dest_rect;
+  gint                 x, y;
 
   g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
   g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
   g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
 
-  node = gegl_node_new_child (NULL,
-                              "operation", "gegl:transform",
-                              "near-z",    GIMP_TRANSFORM_NEAR_Z,
-                              "sampler",   interpolation_type,
-                              NULL);
+  src_rect    = gegl_buffer_get_extent (src_buffer);
+  dest_extent = gegl_buffer_get_extent (dest_buffer);
 
-  gimp_gegl_node_set_matrix (node, transform);
+  if (progress && ! gimp_progress_is_active (progress))
+    progress = NULL;
 
-  gimp_gegl_apply_operation (src_buffer, progress, undo_desc,
-                             node, dest_buffer, NULL, FALSE);
-  g_object_unref (node);
+  if (progress && undo_desc)
+    gimp_progress_set_text_literal (progress, undo_desc);
+
+  if (gimp_gegl_transform_is_translation (transform, &x, &y))
+    {
+      /*  a plain copy  */
+      GeglRectangle src_area;
+
+      gegl_buffer_clear (dest_buffer, dest_extent);
+
+      if (gegl_rectangle_intersect (&dest_rect,
+                                    GEGL_RECTANGLE (src_rect->x + x,
+                                                    src_rect->y + y,
+                                                    src_rect->width,
+                                                    src_rect->height),
+                                    dest_extent))
+        {
+          src_area    = dest_rect;
+          src_area.x -= x;
+          src_area.y -= y;
+
+          gimp_gegl_buffer_copy (src_buffer,  &src_area, GEGL_ABYSS_NONE,
+                                 dest_buffer, &dest_rect);
+        }
+    }
+  else if (interpolation_type != GIMP_INTERPOLATION_NONE                 &&
+           gimp_gegl_transform_is_downscale (transform, src_rect,
+                                             &dest_rect)                 &&
+           gegl_rectangle_contains (dest_extent, &dest_rect))
+    {
+      /*  a separable scale, see gimp_gegl_scale()  */
+      gegl_buffer_clear (dest_buffer, dest_extent);
+
+      gimp_gegl_scale (src_buffer,  src_rect,
+                       dest_buffer, &dest_rect,
+                       interpolation_type, progress);
+    }
+  else
+    {
+      TransformData data;
+
+      data.src_buffer         = src_buffer;
+      data.dest_buffer        = dest_buffer;
+      data.transform          = transform;
+      data.interpolation_type = interpolation_type;
+      data.progress           = progress;
+      data.rect               = *dest_extent;
+      data.n_bands            = (dest_extent->height +
+                                 TRANSFORM_BAND_HEIGHT - 1) /
+                                TRANSFORM_BAND_HEIGHT;
+      data.next_band          = 0;
+      data.n_done             = 0;
+
+      if (data.n_bands > 0)
+        {
+          gimp_parallel_distribute (MIN (data.n_bands,
+                                         gimp_parallel_get_n_threads ()),
+                                    (GimpParallelDistributeFunc)
+                                    gimp_gegl_apply_transform_func,
+                                    &data);
+        }
+    }
+
+  if (progress)
+    gimp_progress_set_value (progress, 1.0);
 }
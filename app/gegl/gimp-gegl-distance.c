@@ -0,0 +1,447 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-gegl-distance.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  the elliptic structuring elements of gimp:grow, gimp:shrink and
+ *  gimp:border, applied in time independent of their radius.  the
+ *  elements are symmetric and their height only shrinks away from their
+ *  center column, so it is enough to know the vertical distance to the
+ *  nearest feature in each column, which is found first.  each row is
+ *  then done in a couple of linear passes: for the binary element of
+ *  grow and shrink, as the union of the spans each column covers, and
+ *  for the density of border, using the lower envelope of parabolas
+ *  from Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled
+ *  Functions".
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "gimp-gegl-types.h"
+
+#include "gimp-gegl-distance.h"
+
+#include "core/gimp-parallel.h"
+
+
+#define MIN_PARALLEL_SUB_SIZE 64
+
+
+typedef struct
+{
+  gfloat   *data;
+  gint      width;
+  gint      height;
+  gint      radius_x;
+  gint      radius_y;
+  gboolean  border_is_feature;
+  gboolean  feather;
+  gint     *spans;
+} DistanceData;
+
+
+static void   gimp_gegl_distance_columns     (gsize         offset,
+                                              gsize         size,
+                                              DistanceData *data);
+static void   gimp_gegl_distance_dilate_rows (gsize         offset,
+                                              gsize         size,
+                                              DistanceData *data);
+static void   gimp_gegl_distance_border_rows (gsize         offset,
+                                              gsize         size,
+                                              DistanceData *data);
+
+
+/*  public functions  */
+
+/**
+ * gimp_gegl_distance_dilate:
+ * @data:              a @width x @height array of floats
+ * @width:             the width of @data
+ * @height:            the height of @data
+ * @radius_x:          the horizontal radius of the element
+ * @radius_y:          the vertical radius of the element
+ * @border_is_feature: whether the pixels around @data are features
+ *
+ * On input, the non-zero pixels of @data are the features.  On
+ * output, @data is 1.0 within the elliptic element gimp:grow uses
+ * around each feature, and 0.0 elsewhere.
+ **/
+void
+gimp_gegl_distance_dilate (gfloat   *data,
+                           gint      width,
+                           gint      height,
+                           gint      radius_x,
+                           gint      radius_y,
+                           gboolean  border_is_feature)
+{
+  DistanceData  distance_data;
+  gint         *spans;
+  gint          dx;
+  gint          dy;
+
+  g_return_if_fail (data != NULL);
+  g_return_if_fail (width > 0 && height > 0);
+  g_return_if_fail (radius_x > 0 && radius_y > 0);
+
+  /*  the half-width of the element at each vertical distance from its
+   *  center, from the same column heights gimp:grow computes
+   */
+  spans = g_new (gint, radius_y + 1);
+
+  for (dx = 0, dy = radius_y; dx <= radius_x; dx++)
+    {
+      gdouble tmp  = dx > 0 ? dx - 0.5 : 0.0;
+      gint    circ = RINT (radius_y /
+                           (gdouble) radius_x *
+                           sqrt (SQR (radius_x) - SQR (tmp)));
+
+      for (; dy > circ; dy--)
+        spans[dy] = dx - 1;
+    }
+
+  for (; dy >= 0; dy--)
+    spans[dy] = radius_x;
+
+  distance_data.data              = data;
+  distance_data.width             = width;
+  distance_data.height            = height;
+  distance_data.radius_x          = radius_x;
+  distance_data.radius_y          = radius_y;
+  distance_data.border_is_feature = border_is_feature;
+  distance_data.feather           = FALSE;
+  distance_data.spans             = spans;
+
+  gimp_parallel_distribute_range (width, MIN_PARALLEL_SUB_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_gegl_distance_columns,
+                                  &distance_data);
+
+  gimp_parallel_distribute_range (height, MIN_PARALLEL_SUB_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_gegl_distance_dilate_rows,
+                                  &distance_data);
+
+  g_free (spans);
+}
+
+/**
+ * gimp_gegl_distance_border:
+ * @data:     a @width x @height array of floats
+ * @width:    the width of @data
+ * @height:   the height of @data
+ * @radius_x: the horizontal radius of the border
+ * @radius_y: the vertical radius of the border
+ * @feather:  whether the border fades out towards its radius
+ *
+ * On input, the non-zero pixels of @data are the transitional pixels
+ * of a selection.  On output, @data holds the border density
+ * gimp:border computes around them.
+ **/
+void
+gimp_gegl_distance_border (gfloat   *data,
+                           gint      width,
+                           gint      height,
+                           gint      radius_x,
+                           gint      radius_y,
+                           gboolean  feather)
+{
+  DistanceData distance_data;
+
+  g_return_if_fail (data != NULL);
+  g_return_if_fail (width > 0 && height > 0);
+  g_return_if_fail (radius_x > 0 && radius_y > 0);
+
+  distance_data.data              = data;
+  distance_data.width             = width;
+  distance_data.height            = height;
+  distance_data.radius_x          = radius_x;
+  distance_data.radius_y          = radius_y;
+  distance_data.border_is_feature = FALSE;
+  distance_data.feather           = feather;
+  distance_data.spans             = NULL;
+
+  gimp_parallel_distribute_range (width, MIN_PARALLEL_SUB_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_gegl_distance_columns,
+                                  &distance_data);
+
+  gimp_parallel_distribute_range (height, MIN_PARALLEL_SUB_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_gegl_distance_border_rows,
+                                  &distance_data);
+}
+
+
+/*  private functions  */
+
+/*  replaces the features of columns [offset, offset + size) with the
+ *  vertical distance to the nearest feature in the column.  the
+ *  columns are walked a row at a time, so memory is accessed in order.
+ */
+static void
+gimp_gegl_distance_columns (gsize         offset,
+                            gsize         size,
+                            DistanceData *data)
+{
+  const gint  width = data->width;
+  gfloat      edge;
+  gfloat     *row;
+  gint        x, y;
+
+  edge = data->border_is_feature ? 1.0f : GIMP_GEGL_DISTANCE_INFINITY;
+
+  row = data->data;
+
+  for (x = offset; x < offset + size; x++)
+    row[x] = row[x] ? 0.0f : edge;
+
+  for (y = 1; y < data->height; y++)
+    {
+      row += width;
+
+      for (x = offset; x < offset + size; x++)
+        {
+          if (row[x])
+            row[x] = 0.0f;
+          else
+            row[x] = MIN (row[x - width] + 1.0f, GIMP_GEGL_DISTANCE_INFINITY);
+        }
+    }
+
+  for (x = offset; x < offset + size; x++)
+    row[x] = MIN (row[x], edge);
+
+  for (y = data->height - 2; y >= 0; y--)
+    {
+      row -= width;
+
+      for (x = offset; x < offset + size; x++)
+        row[x] = MIN (row[x], row[x + width] + 1.0f);
+    }
+}
+
+/*  replaces the column distances of rows [offset, offset + size) with
+ *  whether any column's span covers the pixel.  a span covering a pixel
+ *  starts left of it or ends right of it, so one pass from each side
+ *  is enough.
+ */
+static void
+gimp_gegl_distance_dilate_rows (gsize         offset,
+                                gsize         size,
+                                DistanceData *data)
+{
+  const gint  width    = data->width;
+  const gint  radius_y = data->radius_y;
+  const gint *spans    = data->spans;
+  gboolean   *covered;
+  gint        x, y;
+
+  covered = g_new (gboolean, width);
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gfloat *row = data->data + (gsize) y * width;
+      gint    end;
+      gint    start;
+
+      /*  the columns around the row are features right at its edges  */
+      end   = data->border_is_feature ? spans[0] - 1     : -1;
+      start = data->border_is_feature ? width - spans[0] : width;
+
+      for (x = 0; x < width; x++)
+        {
+          if (row[x] <= radius_y)
+            end = MAX (end, x + spans[(gint) row[x]]);
+
+          covered[x] = end >= x;
+        }
+
+      for (x = width - 1; x >= 0; x--)
+        {
+          if (row[x] <= radius_y)
+            start = MIN (start, x - spans[(gint) row[x]]);
+
+          row[x] = (covered[x] || start <= x) ? 1.0f : 0.0f;
+        }
+    }
+
+  g_free (covered);
+}
+
+/*  the distance gimp:border's density is computed from, which is below
+ *  1.0 within the ellipse
+ */
+static inline gdouble
+gimp_gegl_distance_border_dist (gint dx,
+                                gint dy,
+                                gint radius_x,
+                                gint radius_y)
+{
+  gdouble tmpx = dx > 0 ? dx - 0.5 : 0.0;
+  gdouble tmpy = dy > 0 ? dy - 0.5 : 0.0;
+
+  return ((tmpy * tmpy) / (radius_y * radius_y) +
+          (tmpx * tmpx) / (radius_x * radius_x));
+}
+
+static inline void
+gimp_gegl_distance_add_parabola (gdouble  q,
+                                 gdouble  f,
+                                 gint     column,
+                                 gdouble *v,
+                                 gdouble *h,
+                                 gdouble *z,
+                                 gint    *c,
+                                 gint    *k)
+{
+  gdouble s = 0.0;
+
+  /*  drop the parabolas the new one hides in the lower envelope  */
+  while (*k >= 0)
+    {
+      s = ((f + q * q) - (h[*k] + v[*k] * v[*k])) / (2.0 * (q - v[*k]));
+
+      if (s > z[*k])
+        break;
+
+      (*k)--;
+    }
+
+  (*k)++;
+
+  v[*k] = q;
+  h[*k] = f;
+  z[*k] = *k ? s : -G_MAXDOUBLE;
+  c[*k] = column;
+}
+
+/*  replaces the column distances of rows [offset, offset + size) with
+ *  the border density.  a column @dx pixels away contributes half a
+ *  pixel less than @dx horizontally, which is a parabola rooted half a
+ *  pixel towards the pixel; rooting them all half a pixel to the right
+ *  only overestimates the columns right of the pixel, and vice versa,
+ *  so the nearest column is the better of the two envelopes, or the
+ *  pixel's own column.
+ */
+static void
+gimp_gegl_distance_border_rows (gsize         offset,
+                                gsize         size,
+                                DistanceData *data)
+{
+  const gint  width    = data->width;
+  const gint  radius_x = data->radius_x;
+  const gint  radius_y = data->radius_y;
+  gdouble    *v;    /* the roots of the parabolas in the lower envelope */
+  gdouble    *h;    /* their heights */
+  gdouble    *z;    /* the start of their ranges */
+  gint       *c;    /* the columns they belong to */
+  gdouble    *dist; /* the distance to the nearest column so far */
+  gint        x, y;
+
+  v    = g_new (gdouble, width);
+  h    = g_new (gdouble, width);
+  z    = g_new (gdouble, width);
+  c    = g_new (gint,    width);
+  dist = g_new (gdouble, width);
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gfloat *row = data->data + (gsize) y * width;
+      gint    side;
+
+      for (x = 0; x < width; x++)
+        {
+          if (row[x] <= radius_y)
+            dist[x] = gimp_gegl_distance_border_dist (0, (gint) row[x],
+                                                      radius_x, radius_y);
+          else
+            dist[x] = G_MAXDOUBLE;
+        }
+
+      for (side = -1; side <= 1; side += 2)
+        {
+          gint k = -1;
+          gint j;
+
+          for (x = 0; x < width; x++)
+            {
+              if (row[x] <= radius_y)
+                {
+                  gdouble f;
+
+                  /*  the horizontal distance is in pixels  */
+                  f = SQR (radius_x) *
+                      gimp_gegl_distance_border_dist (0, (gint) row[x],
+                                                      radius_x, radius_y);
+
+                  gimp_gegl_distance_add_parabola (x - side * 0.5, f, x,
+                                                   v, h, z, c, &k);
+                }
+            }
+
+          /*  no transitions within reach of the row  */
+          if (k < 0)
+            break;
+
+          for (x = 0, j = 0; x < width; x++)
+            {
+              while (j < k && z[j + 1] < x)
+                j++;
+
+              if (c[j] != x)
+                {
+                  gdouble d;
+
+                  d = gimp_gegl_distance_border_dist (ABS (x - c[j]),
+                                                      (gint) row[c[j]],
+                                                      radius_x, radius_y);
+
+                  dist[x] = MIN (dist[x], d);
+                }
+            }
+        }
+
+      for (x = 0; x < width; x++)
+        {
+          gfloat a;
+
+          if (dist[x] < 1.0)
+            {
+              if (data->feather)
+                a = 1.0 - sqrt (dist[x]);
+              else
+                a = 1.0;
+            }
+          else
+            {
+              a = 0.0;
+            }
+
+          row[x] = a;
+        }
+    }
+
+  g_free (v);
+  g_free (h);
+  g_free (z);
+  g_free (c);
+  g_free (dist);
+}
@@ -0,0 +1,41 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-gegl-distance.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_GEGL_DISTANCE_H__
+#define __GIMP_GEGL_DISTANCE_H__
+
+
+#define GIMP_GEGL_DISTANCE_INFINITY 1e20f
+
+
+void   gimp_gegl_distance_dilate (gfloat   *data,
+                                  gint      width,
+                                  gint      height,
+                                  gint      radius_x,
+                                  gint      radius_y,
+                                  gboolean  border_is_feature);
+void   gimp_gegl_distance_border (gfloat   *data,
+                                  gint      width,
+                                  gint      height,
+                                  gint      radius_x,
+                                  gint      radius_y,
+                                  gboolean  feather);
+
+
+#endif /* __GIMP_GEGL_DISTANCE_H__ */
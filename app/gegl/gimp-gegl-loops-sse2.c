@@ -124,4 +124,191 @@ gimp_gegl_smudge_with_paint_process_sse2 (gfloat       *accum,
     }
 }
 
+/* helper function of gimp_gegl_convolve_row_sse2(), applies the offset,
+ * the absolute value and the clamping to a pair of totals
+ */
+static inline __m128
+gimp_gegl_convolve_finish_sse2 (__m128d  v_total,
+                                __m128d  v_offset,
+                                gboolean absolute)
+{
+  v_total = _mm_add_pd (v_total, v_offset);
+
+  if (absolute)
+    {
+      __m128d v_negative = _mm_cmplt_pd (v_total, _mm_setzero_pd ());
+
+      v_total = _mm_or_pd (_mm_and_pd    (v_negative,
+                                          _mm_sub_pd (_mm_setzero_pd (),
+                                                      v_total)),
+                           _mm_andnot_pd (v_negative, v_total));
+    }
+
+  /* the operand order matches CLAMP(), including for -0.0 */
+  v_total = _mm_max_pd (_mm_setzero_pd (), v_total);
+  v_total = _mm_min_pd (_mm_set1_pd (1.0), v_total);
+
+  return _mm_cvtpd_ps (v_total);
+}
+
+/* helper function of gimp_gegl_convolve(), convolves 'count' 4-component
+ * pixels whose kernel lies entirely inside the source.  'src' points to
+ * the top-left source pixel of the first pixel's kernel.
+ *
+ * the products and sums are formed in the same precision and order as
+ * in the generic code, so that the results are identical
+ */
+void
+gimp_gegl_convolve_row_sse2 (const gfloat *src,
+                             gint          src_rowstride,
+                             const gfloat *kernel,
+                             gint          kernel_size,
+                             gdouble       divisor,
+                             gboolean      absolute,
+                             gfloat        offset,
+                             gboolean      alpha_weighting,
+                             gfloat       *dest,
+                             gint          count)
+{
+  const __m128d v_one     = _mm_set1_pd (1.0);
+  const __m128d v_offset  = _mm_set1_pd (offset);
+  const __m128d v_divisor = _mm_set1_pd (divisor);
+
+  while (count--)
+    {
+      const gfloat *m    = kernel;
+      __m128d       v_rg = _mm_setzero_pd ();
+      __m128d       v_ba = _mm_setzero_pd ();
+      gint          i, j;
+
+      if (alpha_weighting)
+        {
+          gdouble weighted_divisor = 0.0;
+
+          for (j = 0; j < kernel_size; j++)
+            {
+              const gfloat *s = src + j * src_rowstride;
+
+              for (i = 0; i < kernel_size; i++, m++, s += 4)
+                {
+                  const gfloat a = s[3];
+
+                  if (a)
+                    {
+                      gdouble mult_alpha = *m * a;
+                      __m128  v_s        = _mm_loadu_ps (s);
+                      __m128d v_mult     = _mm_set1_pd (mult_alpha);
+
+                      weighted_divisor += mult_alpha;
+
+                      /* alpha accumulates mult_alpha * 1.0, which is exact */
+                      v_rg = _mm_add_pd (v_rg,
+                                         _mm_mul_pd (v_mult,
+                                                     _mm_cvtps_pd (v_s)));
+                      v_ba = _mm_add_pd (v_ba,
+                                         _mm_mul_pd (v_mult,
+                                                     _mm_move_sd (v_one,
+                                                                  _mm_cvtps_pd (_mm_movehl_ps (v_s, v_s)))));
+                    }
+                }
+            }
+
+          if (weighted_divisor == 0.0)
+            weighted_divisor = divisor;
+
+          v_rg = _mm_div_pd (v_rg, _mm_set1_pd (weighted_divisor));
+          v_ba = _mm_div_pd (v_ba, _mm_setr_pd (weighted_divisor, divisor));
+        }
+      else
+        {
+          for (j = 0; j < kernel_size; j++)
+            {
+              const gfloat *s = src + j * src_rowstride;
+
+              for (i = 0; i < kernel_size; i++, m++, s += 4)
+                {
+                  __m128 v_p = _mm_mul_ps (_mm_set1_ps (*m), _mm_loadu_ps (s));
+
+                  v_rg = _mm_add_pd (v_rg, _mm_cvtps_pd (v_p));
+                  v_ba = _mm_add_pd (v_ba,
+                                     _mm_cvtps_pd (_mm_movehl_ps (v_p, v_p)));
+                }
+            }
+
+          v_rg = _mm_div_pd (v_rg, v_divisor);
+          v_ba = _mm_div_pd (v_ba, v_divisor);
+        }
+
+      _mm_storeu_ps (dest,
+                     _mm_movelh_ps (gimp_gegl_convolve_finish_sse2 (v_rg,
+                                                                    v_offset,
+                                                                    absolute),
+                                    gimp_gegl_convolve_finish_sse2 (v_ba,
+                                                                    v_offset,
+                                                                    absolute)));
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+/* helper function of gimp_gegl_scale(), scales 'count' 4-component
+ * pixels of one row horizontally.  destination pixel i is the sum of
+ * the 'n[i]' source pixels starting at 'start[i] - src_offset', using
+ * the weights at 'weights + i * max_n'.
+ */
+void
+gimp_gegl_scale_row_sse2 (const gfloat *src,
+                          gint          src_offset,
+                          const gint   *start,
+                          const gint   *n,
+                          const gfloat *weights,
+                          gint          max_n,
+                          gfloat       *dest,
+                          gint          count)
+{
+  while (count--)
+    {
+      const gfloat *s     = src + (*start - src_offset) * 4;
+      __m128        v_sum = _mm_setzero_ps ();
+      gint          i;
+
+      for (i = 0; i < *n; i++, s += 4)
+        {
+          v_sum = _mm_add_ps (v_sum,
+                              _mm_mul_ps (_mm_set1_ps (weights[i]),
+                                          _mm_loadu_ps (s)));
+        }
+
+      _mm_storeu_ps (dest, v_sum);
+
+      start++;
+      n++;
+      weights += max_n;
+      dest    += 4;
+    }
+}
+
+/* helper function of gimp_gegl_scale(), adds 'weight' times the
+ * 'count' floats of 'src' to 'dest'
+ */
+void
+gimp_gegl_scale_accumulate_sse2 (const gfloat *src,
+                                 gfloat        weight,
+                                 gfloat       *dest,
+                                 gint          count)
+{
+  const __m128 v_weight = _mm_set1_ps (weight);
+
+  for (; count >= 4; count -= 4, src += 4, dest += 4)
+    {
+      _mm_storeu_ps (dest,
+                     _mm_add_ps (_mm_loadu_ps (dest),
+                                 _mm_mul_ps (v_weight, _mm_loadu_ps (src))));
+    }
+
+  while (count--)
+    *dest++ += weight * *src++;
+}
+
 #endif /* COMPILE_SSE2_INTRINISICS */
@@ -34,6 +34,31 @@ void   gimp_gegl_smudge_with_paint_process_sse2 (gfloat       *accum,
                                                  gfloat        flow,
                                                  gfloat        rate);
 
+void   gimp_gegl_convolve_row_sse2              (const gfloat *src,
+                                                 gint          src_rowstride,
+                                                 const gfloat *kernel,
+                                                 gint          kernel_size,
+                                                 gdouble       divisor,
+                                                 gboolean      absolute,
+                                                 gfloat        offset,
+                                                 gboolean      alpha_weighting,
+                                                 gfloat       *dest,
+                                                 gint          count);
+
+void   gimp_gegl_scale_row_sse2                 (const gfloat *src,
+                                                 gint          src_offset,
+                                                 const gint   *start,
+                                                 const gint   *n,
+                                                 const gfloat *weights,
+                                                 gint          max_n,
+                                                 gfloat       *dest,
+                                                 gint          count);
+
+void   gimp_gegl_scale_accumulate_sse2          (const gfloat *src,
+                                                 gfloat        weight,
+                                                 gfloat       *dest,
+                                                 gint          count);
+
 #endif /* COMPILE_SSE2_INTRINISICS */
 
 
@@ -36,10 +36,303 @@
 #include "gimp-gegl-loops.h"
 #include "gimp-gegl-loops-sse2.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpprogress.h"
 
 
+/*  the loops below are split across the gimp-parallel workers by
+ *  destination area, each part running its own buffer iterator
+ */
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglAbyssPolicy      abyss_policy;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+} CopyData;
+
+static void
+gimp_gegl_buffer_copy_area (const GeglRectangle *area,
+                            CopyData            *data)
+{
+  GeglRectangle dest_area = *area;
+
+  dest_area.x += data->dest_rect->x - data->src_rect->x;
+  dest_area.y += data->dest_rect->y - data->src_rect->y;
+
+  gegl_buffer_copy (data->src_buffer,  area, data->abyss_policy,
+                    data->dest_buffer, &dest_area);
+}
+
+/*  GEGL shares the source's tiles with the destination, instead of
+ *  copying pixels, when the formats match and the offset between the
+ *  two rectangles is a whole number of tiles
+ */
+static gboolean
+gimp_gegl_buffer_copy_shares_tiles (GeglBuffer          *src_buffer,
+                                    const GeglRectangle *src_rect,
+                                    GeglBuffer          *dest_buffer,
+                                    const GeglRectangle *dest_rect)
+{
+  gint src_tile_width,  src_tile_height;
+  gint dest_tile_width, dest_tile_height;
+
+  if (gegl_buffer_get_format (src_buffer) !=
+      gegl_buffer_get_format (dest_buffer))
+    return FALSE;
+
+  g_object_get (src_buffer,
+                "tile-width",  &src_tile_width,
+                "tile-height", &src_tile_height,
+                NULL);
+  g_object_get (dest_buffer,
+                "tile-width",  &dest_tile_width,
+                "tile-height", &dest_tile_height,
+                NULL);
+
+  return (src_tile_width  == dest_tile_width                    &&
+          src_tile_height == dest_tile_height                   &&
+          (src_rect->x - dest_rect->x) % src_tile_width  == 0 &&
+          (src_rect->y - dest_rect->y) % src_tile_height == 0);
+}
+
+/*  like gegl_buffer_copy(), but copies pixels on several threads at
+ *  once whenever GEGL can't just share the tiles
+ */
+void
+gimp_gegl_buffer_copy (GeglBuffer          *src_buffer,
+                       const GeglRectangle *src_rect,
+                       GeglAbyssPolicy      abyss_policy,
+                       GeglBuffer          *dest_buffer,
+                       const GeglRectangle *dest_rect)
+{
+  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+
+  if (! src_rect)
+    src_rect = gegl_buffer_get_extent (src_buffer);
+
+  if (! dest_rect)
+    dest_rect = src_rect;
+
+  if (gimp_gegl_buffer_copy_shares_tiles (src_buffer,  src_rect,
+                                          dest_buffer, dest_rect))
+    {
+      gegl_buffer_copy (src_buffer,  src_rect, abyss_policy,
+                        dest_buffer, dest_rect);
+    }
+  else
+    {
+      CopyData data;
+
+      data.src_buffer   = src_buffer;
+      data.src_rect     = src_rect;
+      data.abyss_policy = abyss_policy;
+      data.dest_buffer  = dest_buffer;
+      data.dest_rect    = dest_rect;
+
+      gimp_parallel_distribute_area (src_rect, MIN_PARALLEL_SUB_AREA,
+                                     (GimpParallelDistributeAreaFunc)
+                                     gimp_gegl_buffer_copy_area,
+                                     &data);
+    }
+}
+
+
+typedef struct
+{
+  GeglBuffer   *dest_buffer;
+  const Babl   *dest_format;
+  gint          dest_components;
+  const gfloat *src;
+  gint          src_width;
+  gint          src_height;
+  gint          src_rowstride;
+  gint          components;
+  const gfloat *kernel;
+  gint          kernel_size;
+  gdouble       divisor;
+  gboolean      absolute;
+  gfloat        offset;
+  gboolean      alpha_weighting;
+  gboolean      sse2;
+} ConvolveData;
+
+
+/* helper function of gimp_gegl_convolve_area(), convolves the pixels
+ * [x1, x2) of row y, clamping the kernel to the source
+ */
+static void
+gimp_gegl_convolve_pixels (const ConvolveData *data,
+                           gint                x1,
+                           gint                x2,
+                           gint                y,
+                           gfloat             *d)
+{
+  const gfloat *src         = data->src;
+  const gint    components  = data->components;
+  const gint    a_component = components - 1;
+  const gint    margin      = data->kernel_size / 2;
+  const gint    src_x2      = data->src_width  - 1;
+  const gint    src_y2      = data->src_height - 1;
+  const gdouble divisor     = data->divisor;
+  const gfloat  offset      = data->offset;
+  gint          x;
+
+  if (data->alpha_weighting)
+    {
+      for (x = x1; x < x2; x++)
+        {
+          const gfloat *m                = data->kernel;
+          gdouble       total[4]         = { 0.0, 0.0, 0.0, 0.0 };
+          gdouble       weighted_divisor = 0.0;
+          gint          i, j, b;
+
+          for (j = y - margin; j <= y + margin; j++)
+            {
+              for (i = x - margin; i <= x + margin; i++, m++)
+                {
+                  gint          xx = CLAMP (i, 0, src_x2);
+                  gint          yy = CLAMP (j, 0, src_y2);
+                  const gfloat *s  = src + yy * data->src_rowstride + xx * components;
+                  const gfloat  a  = s[a_component];
+
+                  if (a)
+                    {
+                      gdouble mult_alpha = *m * a;
+
+                      weighted_divisor += mult_alpha;
+
+                      for (b = 0; b < a_component; b++)
+                        total[b] += mult_alpha * s[b];
+
+                      total[a_component] += mult_alpha;
+                    }
+                }
+            }
+
+          if (weighted_divisor == 0.0)
+            weighted_divisor = divisor;
+
+          for (b = 0; b < a_component; b++)
+            total[b] /= weighted_divisor;
+
+          total[a_component] /= divisor;
+
+          for (b = 0; b < components; b++)
+            {
+              total[b] += offset;
+
+              if (data->absolute && total[b] < 0.0)
+                total[b] = - total[b];
+
+              *d++ = CLAMP (total[b], 0.0, 1.0);
+            }
+        }
+    }
+  else
+    {
+      for (x = x1; x < x2; x++)
+        {
+          const gfloat *m        = data->kernel;
+          gdouble       total[4] = { 0.0, 0.0, 0.0, 0.0 };
+          gint          i, j, b;
+
+          for (j = y - margin; j <= y + margin; j++)
+            {
+              for (i = x - margin; i <= x + margin; i++, m++)
+                {
+                  gint          xx = CLAMP (i, 0, src_x2);
+                  gint          yy = CLAMP (j, 0, src_y2);
+                  const gfloat *s  = src + yy * data->src_rowstride + xx * components;
+
+                  for (b = 0; b < components; b++)
+                    total[b] += *m * s[b];
+                }
+            }
+
+          for (b = 0; b < components; b++)
+            {
+              total[b] = total[b] / divisor + offset;
+
+              if (data->absolute && total[b] < 0.0)
+                total[b] = - total[b];
+
+              *d++ = CLAMP (total[b], 0.0, 1.0);
+            }
+        }
+    }
+}
+
+static void
+gimp_gegl_convolve_area (const GeglRectangle *area,
+                         ConvolveData        *data)
+{
+  GeglBufferIterator *dest_iter;
+
+  dest_iter = gegl_buffer_iterator_new (data->dest_buffer, area, 0,
+                                        data->dest_format,
+                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (dest_iter))
+    {
+      /*  Convolve the src image using the convolution kernel, writing
+       *  to dest Convolve is not tile-enabled--use accordingly
+       */
+      gfloat     *dest       = dest_iter->data[0];
+      const gint  components = data->components;
+      const gint  margin     = data->kernel_size / 2;
+      const gint  dest_x1    = dest_iter->roi[0].x;
+      const gint  dest_y1    = dest_iter->roi[0].y;
+      const gint  dest_x2    = dest_iter->roi[0].x + dest_iter->roi[0].width;
+      const gint  dest_y2    = dest_iter->roi[0].y + dest_iter->roi[0].height;
+      gint        y;
+
+      for (y = dest_y1; y < dest_y2; y++)
+        {
+#if COMPILE_SSE2_INTRINISICS
+          /*  the pixels whose kernel lies entirely inside the source
+           *  don't need clamping, and go through the SSE2 row kernel
+           */
+          if (data->sse2      &&
+              components == 4 &&
+              y >= margin     &&
+              y <  data->src_height - margin)
+            {
+              gint x1 = CLAMP (margin, dest_x1, dest_x2);
+              gint x2 = CLAMP (data->src_width - margin, x1, dest_x2);
+
+              gimp_gegl_convolve_pixels (data, dest_x1, x1, y, dest);
+
+              gimp_gegl_convolve_row_sse2 (data->src +
+                                           (y  - margin) * data->src_rowstride +
+                                           (x1 - margin) * components,
+                                           data->src_rowstride,
+                                           data->kernel, data->kernel_size,
+                                           data->divisor, data->absolute,
+                                           data->offset, data->alpha_weighting,
+                                           dest + (x1 - dest_x1) * components,
+                                           x2 - x1);
+
+              gimp_gegl_convolve_pixels (data, x2, dest_x2, y,
+                                         dest + (x2 - dest_x1) * components);
+            }
+          else
+#endif
+            {
+              gimp_gegl_convolve_pixels (data, dest_x1, dest_x2, y, dest);
+            }
+
+          dest += dest_iter->roi[0].width * data->dest_components;
+        }
+    }
+}
+
 void
 gimp_gegl_convolve (GeglBuffer          *src_buffer,
                     const GeglRectangle *src_rect,
@@ -51,14 +344,13 @@ gimp_gegl_convolve (GeglBuffer          *src_buffer,
                     GimpConvolutionType  mode,
                     gboolean             alpha_weighting)
 {
-  GeglBufferIterator *dest_iter;
-  gfloat             *src;
-  gint                src_rowstride;
+  ConvolveData  data;
+  gfloat       *src;
+  const Babl   *src_format;
+  const Babl   *dest_format;
 
-  const Babl         *src_format;
-  const Babl         *dest_format;
-  gint                src_components;
-  gint                dest_components;
+  if (! dest_rect)
+    dest_rect = gegl_buffer_get_extent (dest_buffer);
 
   src_format = gegl_buffer_get_format (src_buffer);
 
@@ -82,143 +374,480 @@ gimp_gegl_convolve (GeglBuffer          *src_buffer,
                                     GIMP_PRECISION_FLOAT_LINEAR,
                                     babl_format_has_alpha (dest_format));
 
-  src_components  = babl_format_get_n_components (src_format);
-  dest_components = babl_format_get_n_components (dest_format);
-
-  /* Set up dest iterator */
-  dest_iter = gegl_buffer_iterator_new (dest_buffer, dest_rect, 0, dest_format,
-                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+  data.dest_buffer     = dest_buffer;
+  data.dest_format     = dest_format;
+  data.dest_components = babl_format_get_n_components (dest_format);
+  data.components      = babl_format_get_n_components (src_format);
+  data.src_width       = src_rect->width;
+  data.src_height      = src_rect->height;
+  data.src_rowstride   = data.components * src_rect->width;
+  data.kernel          = kernel;
+  data.kernel_size     = kernel_size;
+  data.divisor         = divisor;
+  data.alpha_weighting = alpha_weighting;
+  data.sse2            = (gimp_cpu_accel_get_support () &
+                          GIMP_CPU_ACCEL_X86_SSE2) != 0;
+
+  /*  If the mode is NEGATIVE_CONVOL, the offset should be 128  */
+  if (mode == GIMP_NEGATIVE_CONVOL)
+    {
+      data.offset   = 0.5;
+      data.absolute = FALSE;
+    }
+  else
+    {
+      data.offset   = 0.0;
+      data.absolute = (mode != GIMP_NORMAL_CONVOL);
+    }
 
   /* Get source pixel data */
-  src_rowstride = src_components * src_rect->width;
-  src = g_malloc (sizeof(gfloat) * src_rowstride * src_rect->height);
+  src = g_malloc (sizeof(gfloat) * data.src_rowstride * src_rect->height);
   gegl_buffer_get (src_buffer, src_rect, 1.0, src_format, src,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  while (gegl_buffer_iterator_next (dest_iter))
+  data.src = src;
+
+  gimp_parallel_distribute_area (dest_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_gegl_convolve_area,
+                                 &data);
+
+  g_free (src);
+}
+
+/*  the weights of one axis of gimp_gegl_scale(): destination pixel i
+ *  is the sum of 'n[i]' source pixels, starting at 'start[i]', with
+ *  the weights at 'weights + i * max_n'
+ */
+typedef struct
+{
+  gint   *start;
+  gint   *n;
+  gfloat *weights;
+  gint    max_n;
+} ScaleWeights;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  const Babl          *format;
+  gint                 components;
+  ScaleWeights         x_weights;
+  ScaleWeights         y_weights;
+  gint                 chunk_width;
+  gint                 chunk_height;
+  gboolean             sse2;
+} ScaleData;
+
+
+static gdouble
+gimp_gegl_scale_kernel (GimpInterpolationType interpolation_type,
+                        gdouble               x)
+{
+  x = fabs (x);
+
+  switch (interpolation_type)
     {
-      /*  Convolve the src image using the convolution kernel, writing
-       *  to dest Convolve is not tile-enabled--use accordingly
-       */
-      gfloat       *dest        = dest_iter->data[0];
-      const gint    components  = src_components;
-      const gint    a_component = components - 1;
-      const gint    margin      = kernel_size / 2;
-      const gint    x1          = 0;
-      const gint    y1          = 0;
-      const gint    x2          = src_rect->width  - 1;
-      const gint    y2          = src_rect->height - 1;
-      const gint    dest_x1     = dest_iter->roi[0].x;
-      const gint    dest_y1     = dest_iter->roi[0].y;
-      const gint    dest_x2     = dest_iter->roi[0].x + dest_iter->roi[0].width;
-      const gint    dest_y2     = dest_iter->roi[0].y + dest_iter->roi[0].height;
-      gint          x, y;
-      gfloat        offset;
-
-      /*  If the mode is NEGATIVE_CONVOL, the offset should be 128  */
-      if (mode == GIMP_NEGATIVE_CONVOL)
-        {
-          offset = 0.5;
-          mode = GIMP_NORMAL_CONVOL;
-        }
+    case GIMP_INTERPOLATION_LINEAR:
+      return MAX (1.0 - x, 0.0);
+
+    case GIMP_INTERPOLATION_CUBIC:
+      /*  catmull-rom  */
+      if (x < 1.0)
+        return (1.5 * x - 2.5) * x * x + 1.0;
+      else if (x < 2.0)
+        return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
       else
-        {
-          offset = 0.0;
-        }
+        return 0.0;
 
-      for (y = dest_y1; y < dest_y2; y++)
+    default:
+      g_return_val_if_reached (0.0);
+    }
+}
+
+/*  nohalo and lohalo are meant not to produce halos, so they get a
+ *  plain box filter, i.e. each destination pixel is the average of
+ *  the source area it covers.  linear and cubic get their kernel,
+ *  stretched over the covered area.  source pixels outside the
+ *  source are clamped to its edge.
+ */
+static void
+gimp_gegl_scale_weights_init (ScaleWeights          *weights,
+                              gint                   src_length,
+                              gint                   dest_length,
+                              GimpInterpolationType  interpolation_type)
+{
+  gdouble scale   = (gdouble) dest_length / (gdouble) src_length;
+  gdouble support;
+  gint    i;
+
+  switch (interpolation_type)
+    {
+    case GIMP_INTERPOLATION_LINEAR:
+      support = 1.0 / MIN (scale, 1.0);
+      break;
+
+    case GIMP_INTERPOLATION_CUBIC:
+      support = 2.0 / MIN (scale, 1.0);
+      break;
+
+    default:
+      support = 0.5 / scale;
+      break;
+    }
+
+  weights->max_n   = MIN ((gint) ceil (2.0 * support) + 2, src_length);
+  weights->start   = g_new  (gint,   dest_length);
+  weights->n       = g_new  (gint,   dest_length);
+  weights->weights = g_new0 (gfloat, dest_length * weights->max_n);
+
+  for (i = 0; i < dest_length; i++)
+    {
+      gfloat  *w      = weights->weights + i * weights->max_n;
+      gdouble  center = (i + 0.5) / scale;
+      gdouble  x1     = center - support;
+      gdouble  x2     = center + support;
+      gint     first  = floor (x1);
+      gint     last   = ceil (x2) - 1;
+      gint     start  = CLAMP (first, 0, src_length - 1);
+      gint     end    = CLAMP (last,  0, src_length - 1) + 1;
+      gdouble  total  = 0.0;
+      gint     j;
+
+      weights->start[i] = start;
+      weights->n[i]     = end - start;
+
+      for (j = first; j <= last; j++)
         {
-          gfloat *d = dest;
+          gdouble weight;
 
-          if (alpha_weighting)
+          if (interpolation_type == GIMP_INTERPOLATION_LINEAR ||
+              interpolation_type == GIMP_INTERPOLATION_CUBIC)
             {
-              for (x = dest_x1; x < dest_x2; x++)
-                {
-                  const gfloat *m                = kernel;
-                  gdouble       total[4]         = { 0.0, 0.0, 0.0, 0.0 };
-                  gdouble       weighted_divisor = 0.0;
-                  gint          i, j, b;
+              weight = gimp_gegl_scale_kernel (interpolation_type,
+                                               (j + 0.5 - center) *
+                                               MIN (scale, 1.0));
+            }
+          else
+            {
+              weight = MIN (x2, j + 1) - MAX (x1, j);
+            }
 
-                  for (j = y - margin; j <= y + margin; j++)
-                    {
-                      for (i = x - margin; i <= x + margin; i++, m++)
-                        {
-                          gint          xx = CLAMP (i, x1, x2);
-                          gint          yy = CLAMP (j, y1, y2);
-                          const gfloat *s  = src + yy * src_rowstride + xx * components;
-                          const gfloat  a  = s[a_component];
+          w[CLAMP (j, 0, src_length - 1) - start] += weight;
+          total                                   += weight;
+        }
+
+      if (total != 0.0)
+        {
+          for (j = 0; j < weights->n[i]; j++)
+            w[j] /= total;
+        }
+    }
+}
 
-                          if (a)
-                            {
-                              gdouble mult_alpha = *m * a;
+static void
+gimp_gegl_scale_weights_free (ScaleWeights *weights)
+{
+  g_free (weights->start);
+  g_free (weights->n);
+  g_free (weights->weights);
+}
 
-                              weighted_divisor += mult_alpha;
+/* helper function of gimp_gegl_scale_area(), scales 'count' pixels
+ * of one row horizontally.  'src' holds the source pixels starting at
+ * 'src_offset'.
+ */
+static void
+gimp_gegl_scale_row (const ScaleData *data,
+                     const gfloat    *src,
+                     gint             src_offset,
+                     gint             dest_x,
+                     gfloat          *dest,
+                     gint             count)
+{
+  const ScaleWeights *weights    = &data->x_weights;
+  const gint          components = data->components;
 
-                              for (b = 0; b < a_component; b++)
-                                total[b] += mult_alpha * s[b];
+#if COMPILE_SSE2_INTRINISICS
+  if (data->sse2 && components == 4)
+    {
+      gimp_gegl_scale_row_sse2 (src, src_offset,
+                                weights->start + dest_x,
+                                weights->n     + dest_x,
+                                weights->weights + dest_x * weights->max_n,
+                                weights->max_n,
+                                dest, count);
+      return;
+    }
+#endif
 
-                              total[a_component] += mult_alpha;
-                            }
-                        }
-                    }
+  while (count--)
+    {
+      const gfloat *s = src + (weights->start[dest_x] - src_offset) *
+                              components;
+      const gfloat *w = weights->weights + dest_x * weights->max_n;
+      gint          n = weights->n[dest_x];
+      gint          c;
+      gint          i;
 
-                  if (weighted_divisor == 0.0)
-                    weighted_divisor = divisor;
+      for (c = 0; c < components; c++)
+        dest[c] = 0.0f;
 
-                  for (b = 0; b < a_component; b++)
-                    total[b] /= weighted_divisor;
+      for (i = 0; i < n; i++, s += components)
+        {
+          for (c = 0; c < components; c++)
+            dest[c] += w[i] * s[c];
+        }
 
-                  total[a_component] /= divisor;
+      dest += components;
+      dest_x++;
+    }
+}
 
-                  for (b = 0; b < components; b++)
-                    {
-                      total[b] += offset;
+/* helper function of gimp_gegl_scale_area(), adds 'weight' times the
+ * 'count' floats of 'src' to 'dest'
+ */
+static inline void
+gimp_gegl_scale_accumulate (const ScaleData *data,
+                            const gfloat    *src,
+                            gfloat           weight,
+                            gfloat          *dest,
+                            gint             count)
+{
+#if COMPILE_SSE2_INTRINISICS
+  if (data->sse2)
+    {
+      gimp_gegl_scale_accumulate_sse2 (src, weight, dest, count);
+      return;
+    }
+#endif
 
-                      if (mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
-                        total[b] = - total[b];
+  while (count--)
+    *dest++ += weight * *src++;
+}
 
-                      *d++ = CLAMP (total[b], 0.0, 1.0);
-                    }
-                }
+static void
+gimp_gegl_scale_area (const GeglRectangle *area,
+                      ScaleData           *data)
+{
+  const ScaleWeights *x_weights  = &data->x_weights;
+  const ScaleWeights *y_weights  = &data->y_weights;
+  const gint          components = data->components;
+  gfloat             *src        = NULL;
+  gfloat             *tmp        = NULL;
+  gfloat             *dest;
+  gsize               src_size   = 0;
+  gsize               tmp_size   = 0;
+  GeglRectangle       chunk;
+
+  dest = g_new (gfloat,
+                data->chunk_width * data->chunk_height * components);
+
+  for (chunk.y = area->y;
+       chunk.y < area->y + area->height;
+       chunk.y += chunk.height)
+    {
+      chunk.height = MIN (data->chunk_height,
+                          area->y + area->height - chunk.y);
+
+      for (chunk.x = area->x;
+           chunk.x < area->x + area->width;
+           chunk.x += chunk.width)
+        {
+          GeglRectangle src_chunk;
+          gint          dest_x;
+          gint          dest_y;
+          gint          rowstride;
+          gint          y;
+
+          chunk.width = MIN (data->chunk_width,
+                             area->x + area->width - chunk.x);
+
+          dest_x = chunk.x - data->dest_rect->x;
+          dest_y = chunk.y - data->dest_rect->y;
+
+          /*  the source ranges grow monotonically with the destination
+           *  position, so the first and last pixels bound the chunk
+           */
+          src_chunk.x      = x_weights->start[dest_x];
+          src_chunk.y      = y_weights->start[dest_y];
+          src_chunk.width  = x_weights->start[dest_x + chunk.width - 1] +
+                             x_weights->n[dest_x + chunk.width - 1] -
+                             src_chunk.x;
+          src_chunk.height = y_weights->start[dest_y + chunk.height - 1] +
+                             y_weights->n[dest_y + chunk.height - 1] -
+                             src_chunk.y;
+
+          if (src_size < (gsize) src_chunk.width * src_chunk.height)
+            {
+              src_size = (gsize) src_chunk.width * src_chunk.height;
+              src      = g_renew (gfloat, src, src_size * components);
             }
-          else
+
+          if (tmp_size < (gsize) chunk.width * src_chunk.height)
             {
-              for (x = dest_x1; x < dest_x2; x++)
-                {
-                  const gfloat *m        = kernel;
-                  gdouble       total[4] = { 0.0, 0.0, 0.0, 0.0 };
-                  gint          i, j, b;
+              tmp_size = (gsize) chunk.width * src_chunk.height;
+              tmp      = g_renew (gfloat, tmp, tmp_size * components);
+            }
 
-                  for (j = y - margin; j <= y + margin; j++)
-                    {
-                      for (i = x - margin; i <= x + margin; i++, m++)
-                        {
-                          gint          xx = CLAMP (i, x1, x2);
-                          gint          yy = CLAMP (j, y1, y2);
-                          const gfloat *s  = src + yy * src_rowstride + xx * components;
-
-                          for (b = 0; b < components; b++)
-                            total[b] += *m * s[b];
-                        }
-                    }
+          gegl_buffer_get (data->src_buffer,
+                           GEGL_RECTANGLE (data->src_rect->x + src_chunk.x,
+                                           data->src_rect->y + src_chunk.y,
+                                           src_chunk.width,
+                                           src_chunk.height),
+                           1.0, data->format, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
 
-                  for (b = 0; b < components; b++)
-                    {
-                      total[b] = total[b] / divisor + offset;
+          /*  scale horizontally, each source row into 'tmp'  */
+          rowstride = chunk.width * components;
 
-                      if (mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
-                        total[b] = - total[b];
+          for (y = 0; y < src_chunk.height; y++)
+            {
+              gimp_gegl_scale_row (data,
+                                   src + y * src_chunk.width * components,
+                                   src_chunk.x,
+                                   dest_x,
+                                   tmp + y * rowstride,
+                                   chunk.width);
+            }
 
-                      *d++ = CLAMP (total[b], 0.0, 1.0);
-                    }
-                }
+          /*  scale vertically, from the rows of 'tmp' into 'dest'  */
+          for (y = 0; y < chunk.height; y++)
+            {
+              const gfloat *w = y_weights->weights +
+                                (dest_y + y) * y_weights->max_n;
+              const gfloat *t = tmp + (y_weights->start[dest_y + y] -
+                                       src_chunk.y) * rowstride;
+              gfloat       *d = dest + y * rowstride;
+              gint          i;
+
+              memset (d, 0, rowstride * sizeof (gfloat));
+
+              for (i = 0; i < y_weights->n[dest_y + y]; i++, t += rowstride)
+                gimp_gegl_scale_accumulate (data, t, w[i], d, rowstride);
             }
 
-          dest += dest_iter->roi[0].width * dest_components;
+          gegl_buffer_set (data->dest_buffer, &chunk, 0,
+                           data->format, dest, GEGL_AUTO_ROWSTRIDE);
         }
     }
 
   g_free (src);
+  g_free (tmp);
+  g_free (dest);
+}
+
+/*  scales @src_rect of @src_buffer to @dest_rect of @dest_buffer, as
+ *  two separable passes with precomputed weights, on several threads
+ *  at once.  meant for downscaling, where it is much faster than
+ *  sampling the source for each destination pixel.  the pixels are
+ *  filtered as premultiplied linear float.
+ */
+void
+gimp_gegl_scale (GeglBuffer            *src_buffer,
+                 const GeglRectangle   *src_rect,
+                 GeglBuffer            *dest_buffer,
+                 const GeglRectangle   *dest_rect,
+                 GimpInterpolationType  interpolation_type,
+                 GimpProgress          *progress)
+{
+  ScaleData          data;
+  const Babl        *format;
+  GimpImageBaseType  base_type;
+  GeglRectangle      band;
+
+  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
+
+  if (! src_rect)
+    src_rect = gegl_buffer_get_extent (src_buffer);
+
+  if (! dest_rect)
+    dest_rect = gegl_buffer_get_extent (dest_buffer);
+
+  if (gegl_rectangle_is_empty (src_rect) ||
+      gegl_rectangle_is_empty (dest_rect))
+    return;
+
+  format = gegl_buffer_get_format (dest_buffer);
+
+  if (babl_format_is_palette (format))
+    base_type = GIMP_RGB;
+  else
+    base_type = gimp_babl_format_get_base_type (format);
+
+  if (base_type == GIMP_GRAY)
+    {
+      if (babl_format_has_alpha (format))
+        data.format = babl_format ("YaA float");
+      else
+        data.format = babl_format ("Y float");
+    }
+  else
+    {
+      if (babl_format_has_alpha (format))
+        data.format = babl_format ("RaGaBaA float");
+      else
+        data.format = babl_format ("RGB float");
+    }
+
+  data.src_buffer   = src_buffer;
+  data.src_rect     = src_rect;
+  data.dest_buffer  = dest_buffer;
+  data.dest_rect    = dest_rect;
+  data.components   = babl_format_get_n_components (data.format);
+  data.sse2         = (gimp_cpu_accel_get_support () &
+                       GIMP_CPU_ACCEL_X86_SSE2) != 0;
+
+  gimp_gegl_scale_weights_init (&data.x_weights,
+                                src_rect->width, dest_rect->width,
+                                interpolation_type);
+  gimp_gegl_scale_weights_init (&data.y_weights,
+                                src_rect->height, dest_rect->height,
+                                interpolation_type);
+
+  /*  keep the source pixels of a chunk at around 512x512  */
+  data.chunk_width  = CLAMP (512 * dest_rect->width  / src_rect->width,
+                             1, 256);
+  data.chunk_height = CLAMP (512 * dest_rect->height / src_rect->height,
+                             1, 256);
+
+  /*  without a progress, do it all at once, otherwise in bands of rows,
+   *  updating the progress in between
+   */
+  band = *dest_rect;
+
+  if (progress)
+    band.height = MIN (data.chunk_height * gimp_parallel_get_n_threads (),
+                       dest_rect->height);
+
+  for (band.y = dest_rect->y;
+       band.y < dest_rect->y + dest_rect->height;
+       band.y += band.height)
+    {
+      band.height = MIN (band.height,
+                         dest_rect->y + dest_rect->height - band.y);
+
+      gimp_parallel_distribute_area (&band, MIN_PARALLEL_SUB_AREA,
+                                     (GimpParallelDistributeAreaFunc)
+                                     gimp_gegl_scale_area,
+                                     &data);
+
+      if (progress)
+        {
+          gimp_progress_set_value (progress,
+                                   (gdouble) (band.y + band.height -
+                                              dest_rect->y) /
+                                   (gdouble) dest_rect->height);
+        }
+    }
+
+  gimp_gegl_scale_weights_free (&data.x_weights);
+  gimp_gegl_scale_weights_free (&data.y_weights);
 }
 
 static inline gfloat
@@ -231,35 +860,42 @@ odd_powf (gfloat x,
     return -powf (-x, y);
 }
 
-void
-gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
-                     const GeglRectangle *src_rect,
-                     GeglBuffer          *dest_buffer,
-                     const GeglRectangle *dest_rect,
-                     gdouble              exposure,
-                     GimpDodgeBurnType    type,
-                     GimpTransferMode     mode)
+typedef struct
 {
-  GeglBufferIterator *iter;
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  gdouble              exposure;
+  GimpTransferMode     mode;
+  gfloat               factor;
+} DodgeBurnData;
 
-  if (type == GIMP_DODGE_BURN_TYPE_BURN)
-    exposure = -exposure;
+static void
+gimp_gegl_dodgeburn_area (const GeglRectangle *area,
+                          DodgeBurnData       *data)
+{
+  GeglBufferIterator *iter;
+  const gdouble       exposure = data->exposure;
+  const gfloat        factor   = data->factor;
 
-  iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0,
+  iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
                                    babl_format ("R'G'B'A float"),
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
+  gegl_buffer_iterator_add (iter, data->dest_buffer,
+                            GEGL_RECTANGLE (data->dest_rect->x +
+                                            area->x - data->src_rect->x,
+                                            data->dest_rect->y +
+                                            area->y - data->src_rect->y,
+                                            area->width,
+                                            area->height), 0,
                             babl_format ("R'G'B'A float"),
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
-  switch (mode)
+  switch (data->mode)
     {
-      gfloat factor;
-
     case GIMP_TRANSFER_HIGHLIGHTS:
-      factor = 1.0 + exposure * (0.333333);
-
       while (gegl_buffer_iterator_next (iter))
         {
           gfloat *src   = iter->data[0];
@@ -278,11 +914,6 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
       break;
 
     case GIMP_TRANSFER_MIDTONES:
-      if (exposure < 0)
-        factor = 1.0 - exposure * (0.333333);
-      else
-        factor = 1.0 / (1.0 + exposure);
-
       while (gegl_buffer_iterator_next (iter))
         {
           gfloat *src   = iter->data[0];
@@ -301,11 +932,6 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
       break;
 
     case GIMP_TRANSFER_SHADOWS:
-      if (exposure >= 0)
-        factor = 0.333333 * exposure;
-      else
-        factor = -0.333333 * exposure;
-
       while (gegl_buffer_iterator_next (iter))
         {
           gfloat *src   = iter->data[0];
@@ -352,6 +978,60 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
     }
 }
 
+void
+gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
+                     const GeglRectangle *src_rect,
+                     GeglBuffer          *dest_buffer,
+                     const GeglRectangle *dest_rect,
+                     gdouble              exposure,
+                     GimpDodgeBurnType    type,
+                     GimpTransferMode     mode)
+{
+  DodgeBurnData data;
+
+  if (type == GIMP_DODGE_BURN_TYPE_BURN)
+    exposure = -exposure;
+
+  if (! src_rect)
+    src_rect = gegl_buffer_get_extent (src_buffer);
+
+  if (! dest_rect)
+    dest_rect = gegl_buffer_get_extent (dest_buffer);
+
+  data.src_buffer  = src_buffer;
+  data.src_rect    = src_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = dest_rect;
+  data.exposure    = exposure;
+  data.mode        = mode;
+
+  switch (mode)
+    {
+    case GIMP_TRANSFER_HIGHLIGHTS:
+      data.factor = 1.0 + exposure * (0.333333);
+      break;
+
+    case GIMP_TRANSFER_MIDTONES:
+      if (exposure < 0)
+        data.factor = 1.0 - exposure * (0.333333);
+      else
+        data.factor = 1.0 / (1.0 + exposure);
+      break;
+
+    case GIMP_TRANSFER_SHADOWS:
+      if (exposure >= 0)
+        data.factor = 0.333333 * exposure;
+      else
+        data.factor = -0.333333 * exposure;
+      break;
+    }
+
+  gimp_parallel_distribute_area (src_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_gegl_dodgeburn_area,
+                                 &data);
+}
+
 /* helper function of gimp_gegl_smudge_with_paint_process()
    src and dest can be the same address
  */
@@ -428,6 +1108,79 @@ gimp_gegl_smudge_with_paint_process (gfloat       *accum,
     }
 }
 
+typedef struct
+{
+  GeglBuffer          *accum_buffer;
+  const GeglRectangle *accum_rect;
+  GeglBuffer          *canvas_buffer;
+  const GeglRectangle *canvas_rect;
+  const gfloat        *brush_color;
+  gfloat               brush_a;
+  GeglBuffer          *paint_buffer;
+  GeglAccessMode       paint_buffer_access_mode;
+  gboolean             no_erasing;
+  gfloat               flow;
+  gfloat               rate;
+  gboolean             sse2;
+} SmudgeWithPaintData;
+
+static void
+gimp_gegl_smudge_with_paint_area (const GeglRectangle *area,
+                                  SmudgeWithPaintData *data)
+{
+  GeglBufferIterator *iter;
+  const gint          dx = area->x - data->accum_rect->x;
+  const gint          dy = area->y - data->accum_rect->y;
+
+  iter = gegl_buffer_iterator_new (data->accum_buffer, area, 0,
+                                   babl_format ("RGBA float"),
+                                   GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, data->canvas_buffer,
+                            GEGL_RECTANGLE (data->canvas_rect->x + dx,
+                                            data->canvas_rect->y + dy,
+                                            area->width, area->height), 0,
+                            babl_format ("RGBA float"),
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, data->paint_buffer,
+                            GEGL_RECTANGLE (dx, dy,
+                                            area->width, area->height), 0,
+                            babl_format ("RGBA float"),
+                            data->paint_buffer_access_mode, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat       *accum      = iter->data[0];
+      const gfloat *canvas     = iter->data[1];
+      gfloat       *paint      = iter->data[2];
+      gint          count      = iter->length;
+
+#if COMPILE_SSE2_INTRINISICS
+      if (data->sse2 && ((guintptr) accum                                  |
+                         (guintptr) canvas                                 |
+                         (guintptr) (data->brush_color ? data->brush_color :
+                                                         paint)            |
+                         (guintptr) paint) % 16 == 0)
+        {
+          gimp_gegl_smudge_with_paint_process_sse2 (accum, canvas, paint, count,
+                                                    data->brush_color,
+                                                    data->brush_a,
+                                                    data->no_erasing,
+                                                    data->flow, data->rate);
+        }
+      else
+#endif
+        {
+          gimp_gegl_smudge_with_paint_process (accum, canvas, paint, count,
+                                               data->brush_color,
+                                               data->brush_a,
+                                               data->no_erasing,
+                                               data->flow, data->rate);
+        }
+    }
+}
+
 /*  smudge painting calculation. Currently only smudge tool uses this function
  *  Accum = rate*Accum + (1-rate)*Canvas
  *  if brush_color!=NULL
@@ -446,26 +1199,15 @@ gimp_gegl_smudge_with_paint (GeglBuffer          *accum_buffer,
                              gdouble              flow,
                              gdouble              rate)
 {
-  GeglBufferIterator *iter;
-  gfloat              brush_color_float[4];
-  gfloat              brush_a = flow;
-  GeglAccessMode      paint_buffer_access_mode = (brush_color ?
-                                                  GEGL_ACCESS_WRITE :
-                                                  GEGL_ACCESS_READWRITE);
-  gboolean            sse2 = (gimp_cpu_accel_get_support () &
-                              GIMP_CPU_ACCEL_X86_SSE2);
-
-  iter = gegl_buffer_iterator_new (accum_buffer, accum_rect, 0,
-                                   babl_format ("RGBA float"),
-                                   GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+  SmudgeWithPaintData  data;
+  gfloat               brush_color_float[4];
+  gfloat               brush_a = flow;
 
-  gegl_buffer_iterator_add (iter, canvas_buffer, canvas_rect, 0,
-                            babl_format ("RGBA float"),
-                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  if (! accum_rect)
+    accum_rect = gegl_buffer_get_extent (accum_buffer);
 
-  gegl_buffer_iterator_add (iter, paint_buffer, GEGL_RECTANGLE (0, 0, 0, 0), 0,
-                            babl_format ("RGBA float"),
-                            paint_buffer_access_mode, GEGL_ABYSS_NONE);
+  if (! canvas_rect)
+    canvas_rect = gegl_buffer_get_extent (canvas_buffer);
 
   /* convert brush color from double to float */
   if (brush_color)
@@ -479,35 +1221,26 @@ gimp_gegl_smudge_with_paint (GeglBuffer          *accum_buffer,
       brush_a *= brush_color_ptr[3];
     }
 
-  while (gegl_buffer_iterator_next (iter))
-    {
-      gfloat       *accum      = iter->data[0];
-      const gfloat *canvas     = iter->data[1];
-      gfloat       *paint      = iter->data[2];
-      gint          count      = iter->length;
-
-#if COMPILE_SSE2_INTRINISICS
-      if (sse2 && ((guintptr) accum                                     |
-                   (guintptr) canvas                                    |
-                   (guintptr) (brush_color ? brush_color_float : paint) |
-                   (guintptr) paint) % 16 == 0)
-        {
-          gimp_gegl_smudge_with_paint_process_sse2 (accum, canvas, paint, count,
-                                                    brush_color ? brush_color_float :
-                                                                  NULL,
-                                                    brush_a,
-                                                    no_erasing, flow, rate);
-        }
-      else
-#endif
-        {
-          gimp_gegl_smudge_with_paint_process (accum, canvas, paint, count,
-                                               brush_color ? brush_color_float :
-                                                             NULL,
-                                               brush_a,
-                                               no_erasing, flow, rate);
-        }
-    }
+  data.accum_buffer             = accum_buffer;
+  data.accum_rect               = accum_rect;
+  data.canvas_buffer            = canvas_buffer;
+  data.canvas_rect              = canvas_rect;
+  data.brush_color              = brush_color ? brush_color_float : NULL;
+  data.brush_a                  = brush_a;
+  data.paint_buffer             = paint_buffer;
+  data.paint_buffer_access_mode = (brush_color ?
+                                   GEGL_ACCESS_WRITE :
+                                   GEGL_ACCESS_READWRITE);
+  data.no_erasing               = no_erasing;
+  data.flow                     = flow;
+  data.rate                     = rate;
+  data.sse2                     = (gimp_cpu_accel_get_support () &
+                                   GIMP_CPU_ACCEL_X86_SSE2) != 0;
+
+  gimp_parallel_distribute_area (accum_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_gegl_smudge_with_paint_area,
+                                 &data);
 }
 
 void
@@ -810,12 +1543,18 @@ gimp_gegl_convert_color_profile (GeglBuffer               *src_buffer,
 
       GIMP_TIMER_END ("converting buffer");
 
+      /*  the transform may be shared, see gimp_color_transform_new()  */
+      if (progress)
+        g_signal_handlers_disconnect_by_func (transform,
+                                              gimp_progress_set_value,
+                                              progress);
+
       g_object_unref (transform);
     }
   else
     {
-      gegl_buffer_copy (src_buffer,  src_rect, GEGL_ABYSS_NONE,
-                        dest_buffer, dest_rect);
+      gimp_gegl_buffer_copy (src_buffer,  src_rect, GEGL_ABYSS_NONE,
+                             dest_buffer, dest_rect);
 
       if (progress)
         gimp_progress_set_value (progress, 1.0);
@@ -22,6 +22,12 @@
 #define __GIMP_GEGL_LOOPS_H__
 
 
+void   gimp_gegl_buffer_copy           (GeglBuffer               *src_buffer,
+                                        const GeglRectangle      *src_rect,
+                                        GeglAbyssPolicy           abyss_policy,
+                                        GeglBuffer               *dest_buffer,
+                                        const GeglRectangle      *dest_rect);
+
 /*  this is a pretty stupid port of concolve_region() that only works
  *  on a linear source buffer
  */
@@ -35,6 +41,13 @@ void   gimp_gegl_convolve              (GeglBuffer               *src_buffer,
                                         GimpConvolutionType       mode,
                                         gboolean                  alpha_weighting);
 
+void   gimp_gegl_scale                 (GeglBuffer               *src_buffer,
+                                        const GeglRectangle      *src_rect,
+                                        GeglBuffer               *dest_buffer,
+                                        const GeglRectangle      *dest_rect,
+                                        GimpInterpolationType     interpolation_type,
+                                        GimpProgress             *progress);
+
 void   gimp_gegl_dodgeburn             (GeglBuffer               *src_buffer,
                                         const GeglRectangle      *src_rect,
                                         GeglBuffer               *dest_buffer,
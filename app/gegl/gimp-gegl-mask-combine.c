@@ -142,6 +142,67 @@ gimp_gegl_mask_combine_span (gfloat         *data,
     }
 }
 
+/**
+ * gimp_gegl_mask_get_ellipse_rect_span:
+ * @x:       x coordinate of upper left corner of bounding rect
+ * @y:       y coordinate of upper left corner of bounding rect
+ * @w:       width of bounding rect
+ * @h:       height of bounding rect
+ * @a:       elliptic a-constant applied to corners
+ * @b:       elliptic b-constant applied to corners
+ * @py:      the row, within [@y, @y + @h)
+ * @x_start: returns the first pixel of the row within the elliptic rect
+ * @x_end:   returns the pixel after the last one
+ *
+ * Returns the pixels of row @py which a non-antialiased
+ * gimp_gegl_mask_combine_ellipse_rect() sets, unclipped.
+ **/
+void
+gimp_gegl_mask_get_ellipse_rect_span (gint     x,
+                                      gint     y,
+                                      gint     w,
+                                      gint     h,
+                                      gdouble  a,
+                                      gdouble  b,
+                                      gint     py,
+                                      gint    *x_start,
+                                      gint    *x_end)
+{
+  gdouble ellipse_center_x;
+  gdouble ellipse_center_y;
+  gdouble half_ellipse_width_at_y;
+
+  /* Make sure the elliptic corners fit into the rect */
+  a = MIN (a, w / 2.0);
+  b = MIN (b, h / 2.0);
+
+  if (py >= y + b && py < y + h - b)
+    {
+      /*  we are on a row without rounded corners  */
+      *x_start = x;
+      *x_end   = x + w;
+
+      return;
+    }
+
+  ellipse_center_x = x + a;
+
+  /* Match the ellipse center y with our current y */
+  if (py < y + b)
+    ellipse_center_y = y + b;
+  else
+    ellipse_center_y = y + h - b;
+
+  /* Use the normal equation for an ellipse with an arbitrary center
+   * (ellipse_center_x, ellipse_center_y).
+   */
+  half_ellipse_width_at_y =
+    sqrt (SQR (a) - SQR (a) * SQR (py + 0.5f - ellipse_center_y) / SQR (b));
+
+  *x_start = ROUND (ellipse_center_x - half_ellipse_width_at_y);
+  *x_end   = ROUND (ellipse_center_x + w - 2 * a + half_ellipse_width_at_y);
+}
+
 /**
  * gimp_gegl_mask_combine_ellipse_rect:
  * @mask:      the channel with which to combine the elliptic rect
@@ -236,23 +297,13 @@ gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
               ellipse_center_y = y + h - b;
             }
 
-          /* For a non-antialiased ellipse, use the normal equation
-           * for an ellipse with an arbitrary center
-           * (ellipse_center_x, ellipse_center_y).
-           */
           if (! antialias)
             {
-              gdouble half_ellipse_width_at_y;
-              gint    x_start;
-              gint    x_end;
-
-              half_ellipse_width_at_y =
-                sqrt (a_sqr -
-                      a_sqr * SQR (py + 0.5f - ellipse_center_y) / b_sqr);
+              gint x_start;
+              gint x_end;
 
-              x_start = ROUND (ellipse_center_x - half_ellipse_width_at_y);
-              x_end   = ROUND (ellipse_center_x + w - 2 * a +
-                               half_ellipse_width_at_y);
+              gimp_gegl_mask_get_ellipse_rect_span (x, y, w, h, a, b, py,
+                                                    &x_start, &x_end);
 
               gimp_gegl_mask_combine_span (data, op,
                                            MAX (x_start - px, 0),
@@ -41,6 +41,15 @@ gboolean   gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
                                                 gdouble         a,
                                                 gdouble         b,
                                                 gboolean        antialias);
+void       gimp_gegl_mask_get_ellipse_rect_span (gint          x,
+                                                 gint          y,
+                                                 gint          w,
+                                                 gint          h,
+                                                 gdouble       a,
+                                                 gdouble       b,
+                                                 gint          py,
+                                                 gint         *x_start,
+                                                 gint         *x_end);
 gboolean   gimp_gegl_mask_combine_buffer       (GeglBuffer     *mask,
                                                 GeglBuffer     *add_on,
                                                 GimpChannelOps  op,
@@ -158,3 +158,33 @@ gimp_gegl_mask_is_empty (GeglBuffer *buffer)
 
   return TRUE;
 }
+
+gboolean
+gimp_gegl_mask_is_full (GeglBuffer          *buffer,
+                        const GeglRectangle *rect)
+{
+  GeglBufferIterator *iter;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+
+  iter = gegl_buffer_iterator_new (buffer, rect, 0, babl_format ("Y float"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *data = iter->data[0];
+      gint    i;
+
+      for (i = 0; i < iter->length; i++)
+        {
+          if (data[i] < 1.0f)
+            {
+              gegl_buffer_iterator_stop (iter);
+
+              return FALSE;
+            }
+        }
+    }
+
+  return TRUE;
+}
@@ -25,6 +25,8 @@ gboolean   gimp_gegl_mask_bounds   (GeglBuffer *buffer,
                                     gint        *x2,
                                     gint        *y2);
 gboolean   gimp_gegl_mask_is_empty (GeglBuffer *buffer);
+gboolean   gimp_gegl_mask_is_full  (GeglBuffer          *buffer,
+                                    const GeglRectangle *rect);
 
 
 #endif /* __GIMP_GEGL_MASK_H__ */
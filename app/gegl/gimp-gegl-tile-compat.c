@@ -27,6 +27,26 @@
 #include "gimp-gegl-tile-compat.h"
 
 
+typedef struct
+{
+  GeglBuffer    *buffer;
+  GeglRectangle  rect;
+} PrefetchData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_gegl_buffer_prefetch_func (PrefetchData *data,
+                                              gpointer      user_data);
+
+
+/*  local variables  */
+
+static GThreadPool *prefetch_pool = NULL;
+
+
+/*  public functions  */
+
 gint
 gimp_gegl_buffer_get_n_tile_rows (GeglBuffer *buffer,
                                   gint        tile_height)
@@ -77,3 +97,57 @@ gimp_gegl_buffer_get_tile_rect (GeglBuffer    *buffer,
 
   return TRUE;
 }
+
+/* reads the tiles of 'rect' into the tile cache on a background
+ * thread, so that, if they were swapped out, they are available by the
+ * time the caller gets to them.  this is meant for sequential access,
+ * where the next area is known in advance.
+ */
+void
+gimp_gegl_buffer_prefetch (GeglBuffer          *buffer,
+                           const GeglRectangle *rect)
+{
+  PrefetchData *data;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (rect != NULL);
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return;
+
+  if (g_once_init_enter (&prefetch_pool))
+    {
+      GThreadPool *pool;
+
+      pool = g_thread_pool_new ((GFunc) gimp_gegl_buffer_prefetch_func,
+                                NULL, 1, FALSE, NULL);
+
+      g_once_init_leave (&prefetch_pool, pool);
+    }
+
+  data = g_slice_new (PrefetchData);
+
+  data->buffer = g_object_ref (buffer);
+  data->rect   = *rect;
+
+  g_thread_pool_push (prefetch_pool, data, NULL);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_gegl_buffer_prefetch_func (PrefetchData *data,
+                                gpointer      user_data)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (data->buffer, &data->rect, 0, NULL,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter));
+
+  g_object_unref (data->buffer);
+
+  g_slice_free (PrefetchData, data);
+}
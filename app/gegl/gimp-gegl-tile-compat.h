@@ -32,5 +32,8 @@ gboolean   gimp_gegl_buffer_get_tile_rect   (GeglBuffer    *buffer,
                                              gint           tile_num,
                                              GeglRectangle *rect);
 
+void       gimp_gegl_buffer_prefetch        (GeglBuffer          *buffer,
+                                             const GeglRectangle *rect);
+
 
 #endif /* __GIMP_GEGL_TILE_COMPAT_H__ */
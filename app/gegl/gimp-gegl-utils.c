@@ -139,6 +139,32 @@ gimp_gegl_node_get_format (GeglNode    *node,
   return format;
 }
 
+/*  returns TRUE if each output pixel of @node only depends on the
+ *  input pixel at the same position, so the node can safely write
+ *  back into the buffer it reads from
+ */
+gboolean
+gimp_gegl_node_is_point_operation (GeglNode *node)
+{
+  GeglOperation *op;
+  gboolean       is_point = FALSE;
+
+  g_return_val_if_fail (GEGL_IS_NODE (node), FALSE);
+
+  g_object_get (node, "gegl-operation", &op, NULL);
+
+  if (op)
+    {
+      is_point = (GEGL_IS_OPERATION_POINT_FILTER (op)   ||
+                  GEGL_IS_OPERATION_POINT_COMPOSER (op) ||
+                  GEGL_IS_OPERATION_POINT_COMPOSER3 (op));
+
+      g_object_unref (op);
+    }
+
+  return is_point;
+}
+
 gboolean
 gimp_gegl_param_spec_has_key (GParamSpec  *pspec,
                               const gchar *key,
@@ -151,3 +177,46 @@ gimp_gegl_param_spec_has_key (GParamSpec  *pspec,
 
   return FALSE;
 }
+
+/*  returns a new buffer, with its extent at (0, 0), holding the
+ *  contents of 'area' of 'buffer'.  the new buffer's tile grid is
+ *  aligned with that of 'buffer', so that the whole tiles of 'area'
+ *  are shared copy-on-write, instead of being copied.
+ */
+GeglBuffer *
+gimp_gegl_buffer_dup_area (GeglBuffer          *buffer,
+                           const GeglRectangle *area)
+{
+  GeglBuffer *new_buffer;
+  gint        shift_x;
+  gint        shift_y;
+  gint        tile_width;
+  gint        tile_height;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (area != NULL, NULL);
+
+  g_object_get (buffer,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  new_buffer = g_object_new (GEGL_TYPE_BUFFER,
+                             "format",      gegl_buffer_get_format (buffer),
+                             "x",           0,
+                             "y",           0,
+                             "width",       area->width,
+                             "height",      area->height,
+                             "shift-x",     shift_x + area->x,
+                             "shift-y",     shift_y + area->y,
+                             "tile-width",  tile_width,
+                             "tile-height", tile_height,
+                             NULL);
+
+  gegl_buffer_copy (buffer, area, GEGL_ABYSS_NONE,
+                    new_buffer, GEGL_RECTANGLE (0, 0, 0, 0));
+
+  return new_buffer;
+}
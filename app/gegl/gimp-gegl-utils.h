@@ -33,10 +33,15 @@ void         gimp_gegl_progress_connect   (GeglNode      *node,
 
 const Babl * gimp_gegl_node_get_format    (GeglNode      *node,
                                            const gchar   *pad_name);
+gboolean     gimp_gegl_node_is_point_operation
+                                          (GeglNode      *node);
 
 gboolean     gimp_gegl_param_spec_has_key (GParamSpec    *pspec,
                                            const gchar   *key,
                                            const gchar   *value);
 
+GeglBuffer * gimp_gegl_buffer_dup_area    (GeglBuffer          *buffer,
+                                           const GeglRectangle *area);
+
 
 #endif /* __GIMP_GEGL_UTILS_H__ */
@@ -20,6 +20,10 @@
 
 #include "config.h"
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
 #include <gio/gio.h>
 #include <gegl.h>
 
@@ -30,11 +34,15 @@
 #include "operations/gimp-operations.h"
 
 #include "core/gimp.h"
+#include "core/gimp-memory-budget.h"
+#include "core/gimp-parallel.h"
 
 #include "gimp-babl.h"
 #include "gimp-gegl.h"
 
 
+static void  gimp_gegl_init_huge_pages        (GimpGeglConfig *config);
+static void  gimp_gegl_notify_swap_compression (GimpGeglConfig *config);
 static void  gimp_gegl_notify_tile_cache_size (GimpGeglConfig *config);
 static void  gimp_gegl_notify_num_processors  (GimpGeglConfig *config);
 static void  gimp_gegl_notify_use_opencl      (GimpGeglConfig *config);
@@ -50,12 +58,19 @@ gimp_gegl_init (Gimp *gimp)
 
   config = GIMP_GEGL_CONFIG (gimp->config);
 
+  gimp_gegl_init_huge_pages (config);
+
   g_object_set (gegl_config (),
                 "tile-cache-size", (guint64) config->tile_cache_size,
                 "threads",         config->num_processors,
                 "use-opencl",      config->use_opencl,
                 NULL);
 
+  gimp_gegl_notify_swap_compression (config);
+
+  g_signal_connect (config, "notify::swap-compression",
+                    G_CALLBACK (gimp_gegl_notify_swap_compression),
+                    NULL);
   g_signal_connect (config, "notify::tile-cache-size",
                     G_CALLBACK (gimp_gegl_notify_tile_cache_size),
                     NULL);
@@ -66,11 +81,56 @@ gimp_gegl_init (Gimp *gimp)
                     G_CALLBACK (gimp_gegl_notify_use_opencl),
                     NULL);
 
+  gimp_parallel_init (gimp);
+  gimp_memory_budget_init (gimp);
+
   gimp_babl_init ();
 
   gimp_operations_init (gimp);
 }
 
+void
+gimp_gegl_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  gimp_memory_budget_exit (gimp);
+  gimp_parallel_exit (gimp);
+}
+
+static void
+gimp_gegl_init_huge_pages (GimpGeglConfig *config)
+{
+#if defined (__GLIBC__) && defined (M_MMAP_THRESHOLD)
+  if (config->use_huge_pages)
+    {
+      /*  by default, glibc gives each tile larger than 128k an mmap() of
+       *  its own, which is never backed by huge pages.  allocate tiles
+       *  from the heap instead, and grow and trim it in steps of several
+       *  huge pages, so that transparent huge pages can back it.  tiles
+       *  are placed on the NUMA node of the thread which first writes
+       *  them, which is the kernel's default policy.
+       */
+      mallopt (M_MMAP_THRESHOLD, 32 * 1024 * 1024);
+      mallopt (M_TOP_PAD,        64 * 1024 * 1024);
+      mallopt (M_TRIM_THRESHOLD, 128 * 1024 * 1024);
+    }
+#endif
+}
+
+static void
+gimp_gegl_notify_swap_compression (GimpGeglConfig *config)
+{
+  /*  only newer GEGL versions compress the swap  */
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (gegl_config ()),
+                                    "swap-compression"))
+    {
+      g_object_set (gegl_config (),
+                    "swap-compression", config->swap_compression,
+                    NULL);
+    }
+}
+
 static void
 gimp_gegl_notify_tile_cache_size (GimpGeglConfig *config)
 {
@@ -31,7 +31,8 @@ enum
   PROP_FORMAT,
   PROP_TILE_WIDTH,
   PROP_TILE_HEIGHT,
-  PROP_WHOLE_TILE
+  PROP_WHOLE_TILE,
+  PROP_RENDER_LEVELS
 };
 
 
@@ -47,6 +48,7 @@ static void     gimp_tile_handler_validate_get_property  (GObject         *objec
 
 static void     gimp_tile_handler_validate_real_validate (GimpTileHandlerValidate *validate,
                                                           const GeglRectangle     *rect,
+                                                          gdouble                  scale,
                                                           const Babl              *format,
                                                           gpointer                 dest_buf,
                                                           gint                     dest_stride);
@@ -97,6 +99,17 @@ gimp_tile_handler_validate_class_init (GimpTileHandlerValidateClass *klass)
                                                          FALSE,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT));
+
+  /*  whether tiles of the mipmap levels above 0 are rendered directly
+   *  at their scale, when the corresponding level-0 area is dirty,
+   *  instead of being downscaled from rendered level-0 tiles
+   */
+  g_object_class_install_property (object_class, PROP_RENDER_LEVELS,
+                                   g_param_spec_boolean ("render-levels",
+                                                         NULL, NULL,
+                                                         FALSE,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT));
 }
 
 static void
@@ -113,10 +126,17 @@ static void
 gimp_tile_handler_validate_finalize (GObject *object)
 {
   GimpTileHandlerValidate *validate = GIMP_TILE_HANDLER_VALIDATE (object);
+  gint                     i;
 
   g_clear_object (&validate->graph);
   g_clear_pointer (&validate->dirty_region, cairo_region_destroy);
 
+  for (i = 0; i < GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS; i++)
+    g_clear_pointer (&validate->level_dirty_regions[i], cairo_region_destroy);
+
+  g_clear_object (&validate->prerendered);
+  g_clear_pointer (&validate->prerendered_region, cairo_region_destroy);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -142,6 +162,9 @@ gimp_tile_handler_validate_set_property (GObject      *object,
     case PROP_WHOLE_TILE:
       validate->whole_tile = g_value_get_boolean (value);
       break;
+    case PROP_RENDER_LEVELS:
+      validate->render_levels = g_value_get_boolean (value);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -171,6 +194,9 @@ gimp_tile_handler_validate_get_property (GObject    *object,
     case PROP_WHOLE_TILE:
       g_value_set_boolean (value, validate->whole_tile);
       break;
+    case PROP_RENDER_LEVELS:
+      g_value_set_boolean (value, validate->render_levels);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -181,6 +207,7 @@ gimp_tile_handler_validate_get_property (GObject    *object,
 static void
 gimp_tile_handler_validate_real_validate (GimpTileHandlerValidate *validate,
                                           const GeglRectangle     *rect,
+                                          gdouble                  scale,
                                           const Babl              *format,
                                           gpointer                 dest_buf,
                                           gint                     dest_stride)
@@ -193,7 +220,7 @@ gimp_tile_handler_validate_real_validate (GimpTileHandlerValidate *validate,
               rect.height);
 #endif
 
-  gegl_node_blit (validate->graph, 1.0, rect, format,
+  gegl_node_blit (validate->graph, scale, rect, format,
                   dest_buf, dest_stride,
                   GEGL_BLIT_DEFAULT);
 }
@@ -240,6 +267,7 @@ gimp_tile_handler_validate_validate (GeglTileSource *source,
                              tile_rect.y,
                              tile_rect.width,
                              tile_rect.height),
+             1.0,
              validate->format,
              gegl_tile_get_data (tile),
              tile_stride);
@@ -289,6 +317,7 @@ gimp_tile_handler_validate_validate (GeglTileSource *source,
                                  blit_rect.y,
                                  blit_rect.width,
                                  blit_rect.height),
+                 1.0,
                  validate->format,
                  gegl_tile_get_data (tile) +
                  (blit_rect.y % validate->tile_height) * tile_stride +
@@ -305,6 +334,120 @@ gimp_tile_handler_validate_validate (GeglTileSource *source,
   return tile;
 }
 
+static gboolean
+gimp_tile_handler_validate_is_prerendered (GimpTileHandlerValidate     *validate,
+                                           const cairo_rectangle_int_t *tile_rect,
+                                           gint                         z)
+{
+  GeglRectangle extent;
+  GeglRectangle rect;
+
+  if (! validate->prerendered || z < validate->prerendered_z)
+    return FALSE;
+
+  extent.x      = 0;
+  extent.y      = 0;
+  extent.width  = gegl_buffer_get_width  (validate->prerendered) <<
+                  validate->prerendered_z;
+  extent.height = gegl_buffer_get_height (validate->prerendered) <<
+                  validate->prerendered_z;
+
+  /*  the tiles at the edges extend past the prerendered level  */
+  if (! gegl_rectangle_intersect (&rect, &extent,
+                                  (const GeglRectangle *) tile_rect))
+    return FALSE;
+
+  return cairo_region_contains_rectangle (validate->prerendered_region,
+                                          (cairo_rectangle_int_t *) &rect) ==
+         CAIRO_REGION_OVERLAP_IN;
+}
+
+/*  renders the tile (x, y) of level z directly at the level's scale,
+ *  or takes it from the prerendered level, if it is dirty, and the
+ *  corresponding level-0 area isn't rendered either.  returns NULL if
+ *  the tile should be fetched normally, in which case it's either
+ *  valid, or gets downscaled from the level below.
+ */
+static GeglTile *
+gimp_tile_handler_validate_validate_level (GeglTileSource *source,
+                                           gint            x,
+                                           gint            y,
+                                           gint            z)
+{
+  GimpTileHandlerValidate *validate = GIMP_TILE_HANDLER_VALIDATE (source);
+  cairo_region_t          *level_region;
+  cairo_rectangle_int_t    tile_rect;
+  GeglTile                *tile;
+  gint                     tile_bpp;
+  gint                     tile_stride;
+
+  level_region = validate->level_dirty_regions[z - 1];
+
+  if (! level_region || cairo_region_is_empty (level_region))
+    return NULL;
+
+  /*  the area of the tile in level-0 coordinates  */
+  tile_rect.x      = (x * validate->tile_width)  << z;
+  tile_rect.y      = (y * validate->tile_height) << z;
+  tile_rect.width  = validate->tile_width  << z;
+  tile_rect.height = validate->tile_height << z;
+
+  if (cairo_region_contains_rectangle (level_region, &tile_rect) ==
+      CAIRO_REGION_OVERLAP_OUT)
+    {
+      return NULL;
+    }
+
+  cairo_region_subtract_rectangle (level_region, &tile_rect);
+
+  if (cairo_region_contains_rectangle (validate->dirty_region, &tile_rect) ==
+      CAIRO_REGION_OVERLAP_OUT)
+    {
+      return NULL;
+    }
+
+  tile = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (source), x, y, z);
+
+  tile_bpp    = babl_format_get_bytes_per_pixel (validate->format);
+  tile_stride = tile_bpp * validate->tile_width;
+
+  gegl_tile_lock (tile);
+
+  if (gimp_tile_handler_validate_is_prerendered (validate, &tile_rect, z))
+    {
+      /*  the prerendered level is downscaled further for the levels
+       *  above it
+       */
+      gegl_buffer_get (validate->prerendered,
+                       GEGL_RECTANGLE (x * validate->tile_width,
+                                       y * validate->tile_height,
+                                       validate->tile_width,
+                                       validate->tile_height),
+                       1.0 / (1 << (z - validate->prerendered_z)),
+                       validate->format,
+                       gegl_tile_get_data (tile),
+                       tile_stride,
+                       GEGL_ABYSS_NONE);
+    }
+  else
+    {
+      GIMP_TILE_HANDLER_VALIDATE_GET_CLASS (validate)->validate
+        (validate,
+         GEGL_RECTANGLE (x * validate->tile_width,
+                         y * validate->tile_height,
+                         validate->tile_width,
+                         validate->tile_height),
+         1.0 / (1 << z),
+         validate->format,
+         gegl_tile_get_data (tile),
+         tile_stride);
+    }
+
+  gegl_tile_unlock (tile);
+
+  return tile;
+}
+
 static gpointer
 gimp_tile_handler_validate_command (GeglTileSource  *source,
                                     GeglTileCommand  command,
@@ -316,7 +459,34 @@ gimp_tile_handler_validate_command (GeglTileSource  *source,
   GimpTileHandlerValidate *validate = GIMP_TILE_HANDLER_VALIDATE (source);
   gpointer                 retval;
 
-  validate->max_z = MAX (validate->max_z, z);
+  if (z > validate->max_z)
+    {
+      gint level;
+
+      /*  a level that is used for the first time has no tiles yet, its
+       *  dirty area is that of level 0
+       */
+      for (level = validate->max_z + 1;
+           level <= MIN (z, GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS);
+           level++)
+        {
+          validate->level_dirty_regions[level - 1] =
+            cairo_region_copy (validate->dirty_region);
+        }
+
+      validate->max_z = z;
+    }
+
+  if (command == GEGL_TILE_GET                   &&
+      z > 0                                      &&
+      z <= GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS &&
+      validate->render_levels)
+    {
+      retval = gimp_tile_handler_validate_validate_level (source, x, y, z);
+
+      if (retval)
+        return retval;
+    }
 
   retval = gegl_tile_handler_source_command (source, command, x, y, z, data);
 
@@ -405,6 +575,10 @@ gimp_tile_handler_validate_invalidate (GimpTileHandlerValidate *validate,
           for (tile_y = tile_y1; tile_y < tile_y2; tile_y++)
             for (tile_x = tile_x1; tile_x < tile_x2; tile_x++)
               gegl_tile_source_void (source, tile_x, tile_y, tile_z);
+
+          if (tile_z <= GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS)
+            cairo_region_union_rectangle (validate->level_dirty_regions[tile_z - 1],
+                                          (cairo_rectangle_int_t *) rect);
         }
     }
 }
@@ -416,6 +590,104 @@ gimp_tile_handler_validate_undo_invalidate (GimpTileHandlerValidate *validate,
   g_return_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate));
   g_return_if_fail (rect != NULL);
 
+  /*  the level tiles of 'rect' have been voided by the invalidation,
+   *  and get downscaled from level 0 again, so only level 0 is
+   *  affected
+   */
   cairo_region_subtract_rectangle (validate->dirty_region,
                                    (cairo_rectangle_int_t *) rect);
 }
+
+void
+gimp_tile_handler_validate_discard (GimpTileHandlerValidate *validate,
+                                    const GeglRectangle     *rect)
+{
+  GeglTileSource *source;
+  GeglRectangle   area;
+  gint            tile_x1, tile_x2;
+  gint            tile_y1, tile_y2;
+  gint            tile_x;
+  gint            tile_y;
+
+  g_return_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate));
+  g_return_if_fail (rect != NULL);
+
+  if (! validate->discardable || rect->x < 0 || rect->y < 0)
+    return;
+
+  /*  only the tiles that are entirely inside 'rect' are dropped, their
+   *  memory is released, and they are validated again when accessed
+   */
+  tile_x1 = (rect->x + validate->tile_width  - 1) / validate->tile_width;
+  tile_y1 = (rect->y + validate->tile_height - 1) / validate->tile_height;
+  tile_x2 = (rect->x + rect->width)  / validate->tile_width;
+  tile_y2 = (rect->y + rect->height) / validate->tile_height;
+
+  if (tile_x1 >= tile_x2 || tile_y1 >= tile_y2)
+    return;
+
+  area.x      = tile_x1 * validate->tile_width;
+  area.y      = tile_y1 * validate->tile_height;
+  area.width  = (tile_x2 - tile_x1) * validate->tile_width;
+  area.height = (tile_y2 - tile_y1) * validate->tile_height;
+
+  gimp_tile_handler_validate_invalidate (validate, &area);
+
+  source = GEGL_TILE_SOURCE (validate);
+
+  for (tile_y = tile_y1; tile_y < tile_y2; tile_y++)
+    for (tile_x = tile_x1; tile_x < tile_x2; tile_x++)
+      gegl_tile_source_void (source, tile_x, tile_y, 0);
+}
+
+/*  sets a prerendered copy of level 'z' of the buffer, such as one that
+ *  was stored with an image, from which the tiles of level 'z' and above
+ *  are validated until the area they cover expires
+ */
+void
+gimp_tile_handler_validate_set_prerendered (GimpTileHandlerValidate *validate,
+                                            GeglBuffer              *buffer,
+                                            gint                     z)
+{
+  g_return_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate));
+  g_return_if_fail (buffer == NULL || GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (buffer == NULL ||
+                    (z > 0 && z <= GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS));
+
+  g_clear_object (&validate->prerendered);
+  g_clear_pointer (&validate->prerendered_region, cairo_region_destroy);
+
+  if (buffer)
+    {
+      cairo_rectangle_int_t rect;
+
+      rect.x      = 0;
+      rect.y      = 0;
+      rect.width  = gegl_buffer_get_width  (buffer) << z;
+      rect.height = gegl_buffer_get_height (buffer) << z;
+
+      validate->prerendered        = g_object_ref (buffer);
+      validate->prerendered_z      = z;
+      validate->prerendered_region = cairo_region_create_rectangle (&rect);
+    }
+}
+
+/*  marks 'rect' of the prerendered level as out of date, because what
+ *  the buffer renders has changed there
+ */
+void
+gimp_tile_handler_validate_expire_prerendered (GimpTileHandlerValidate *validate,
+                                               const GeglRectangle     *rect)
+{
+  g_return_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate));
+  g_return_if_fail (rect != NULL);
+
+  if (! validate->prerendered)
+    return;
+
+  cairo_region_subtract_rectangle (validate->prerendered_region,
+                                   (cairo_rectangle_int_t *) rect);
+
+  if (cairo_region_is_empty (validate->prerendered_region))
+    gimp_tile_handler_validate_set_prerendered (validate, NULL, 0);
+}
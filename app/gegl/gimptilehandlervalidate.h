@@ -20,6 +20,12 @@
 
 #include <gegl-buffer-backend.h>
 
+
+/*  the number of mipmap levels above level 0 whose validity is tracked
+ *  separately, when the handler renders levels directly
+ */
+#define GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS 16
+
 /***
  * GimpTileHandlerValidate is a GeglTileHandler that renders the
  * projection.
@@ -49,6 +55,23 @@ struct _GimpTileHandlerValidate
   gint             tile_height;
   gint             max_z;
   gboolean         whole_tile;
+  gboolean         render_levels;
+
+  /*  whether validated tiles may be discarded, and validated again
+   *  when next accessed, see gimp_tile_handler_validate_discard()
+   */
+  gboolean         discardable;
+
+  /*  a prerendered copy of level 'prerendered_z', from which the tiles
+   *  of that level and above are validated inside 'prerendered_region',
+   *  instead of being rendered
+   */
+  GeglBuffer      *prerendered;
+  gint             prerendered_z;
+  cairo_region_t  *prerendered_region;
+
+  /*  dirty regions of levels 1..max_z, in level-0 coordinates  */
+  cairo_region_t  *level_dirty_regions[GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS];
 };
 
 struct _GimpTileHandlerValidateClass
@@ -57,6 +80,7 @@ struct _GimpTileHandlerValidateClass
 
   void (* validate) (GimpTileHandlerValidate *validate,
                      const GeglRectangle     *rect,
+                     gdouble                  scale,
                      const Babl              *format,
                      gpointer                 dest_buf,
                      gint                     dest_stride);
@@ -75,6 +99,15 @@ void                      gimp_tile_handler_validate_invalidate      (GimpTileHa
                                                                       const GeglRectangle     *rect);
 void                      gimp_tile_handler_validate_undo_invalidate (GimpTileHandlerValidate *validate,
                                                                       const GeglRectangle     *rect);
+void                      gimp_tile_handler_validate_discard         (GimpTileHandlerValidate *validate,
+                                                                      const GeglRectangle     *rect);
+
+void                      gimp_tile_handler_validate_set_prerendered (GimpTileHandlerValidate *validate,
+                                                                      GeglBuffer              *buffer,
+                                                                      gint                     z);
+void                      gimp_tile_handler_validate_expire_prerendered
+                                                                     (GimpTileHandlerValidate *validate,
+                                                                      const GeglRectangle     *rect);
 
 
 G_END_DECLS
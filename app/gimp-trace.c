@@ -0,0 +1,233 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  A recorder for timed begin/end events and counters, enabled by
+ *  the --trace command line option, which names the file the trace is
+ *  written to on exit, in the Chrome trace event format (which is also
+ *  read by Perfetto).
+ *
+ *  Every thread records into a ring buffer of its own, so recording
+ *  takes no locks; only the oldest events of a thread are lost when
+ *  its ring buffer is full.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "gimp-trace.h"
+
+
+#define RING_SIZE 16384 /* events per thread */
+
+
+typedef struct
+{
+  const gchar *name;
+  gint64       time;
+  gint64       value;
+  gchar        phase;
+} GimpTraceEvent;
+
+typedef struct
+{
+  gint            tid;
+  volatile gint   n_events;
+  GimpTraceEvent  events[RING_SIZE];
+} GimpTraceThread;
+
+
+static GimpTraceThread * gimp_trace_get_thread (void);
+static void              gimp_trace_record     (gchar        phase,
+                                                const gchar *name,
+                                                gint64       value);
+
+
+gboolean gimp_trace_enabled = FALSE;
+
+static gchar   *trace_filename = NULL;
+static gint64   trace_start_time;
+static GPrivate trace_thread_key;
+static GMutex   trace_threads_mutex;
+static GSList  *trace_threads  = NULL;
+static gint     trace_n_tids   = 0;
+
+
+/*  public functions  */
+
+void
+gimp_trace_init (const gchar *filename)
+{
+  if (filename && *filename)
+    {
+      trace_filename   = g_strdup (filename);
+      trace_start_time = g_get_monotonic_time ();
+
+      gimp_trace_enabled = TRUE;
+    }
+}
+
+void
+gimp_trace_exit (void)
+{
+  if (trace_filename)
+    {
+      GFile  *file  = g_file_new_for_path (trace_filename);
+      GError *error = NULL;
+
+      if (! gimp_trace_dump (file, &error))
+        {
+          g_printerr ("Could not write trace to '%s': %s\n",
+                      trace_filename, error->message);
+          g_clear_error (&error);
+        }
+
+      g_object_unref (file);
+    }
+
+  gimp_trace_enabled = FALSE;
+
+  g_clear_pointer (&trace_filename, g_free);
+}
+
+gboolean
+gimp_trace_dump (GFile   *file,
+                 GError **error)
+{
+  GString  *string;
+  GSList   *list;
+  gboolean  first   = TRUE;
+  gboolean  success;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  string = g_string_new ("{\"traceEvents\":[\n");
+
+  g_mutex_lock (&trace_threads_mutex);
+
+  for (list = trace_threads; list; list = g_slist_next (list))
+    {
+      GimpTraceThread *thread   = list->data;
+      gint             n_events = g_atomic_int_get (&thread->n_events);
+      gint             i;
+
+      /*  events recorded while dumping may overwrite the oldest ones
+       *  we read, which only affects threads still recording
+       */
+      for (i = MAX (n_events - RING_SIZE, 0); i < n_events; i++)
+        {
+          const GimpTraceEvent *event = &thread->events[i % RING_SIZE];
+
+          if (! first)
+            g_string_append (string, ",\n");
+
+          first = FALSE;
+
+          g_string_append_printf (string,
+                                  "{\"name\":\"%s\",\"ph\":\"%c\","
+                                  "\"ts\":%" G_GINT64_FORMAT ","
+                                  "\"pid\":1,\"tid\":%d",
+                                  event->name, event->phase,
+                                  event->time - trace_start_time,
+                                  thread->tid);
+
+          if (event->phase == 'C')
+            {
+              g_string_append_printf (string,
+                                      ",\"args\":{\"value\":%" G_GINT64_FORMAT "}",
+                                      event->value);
+            }
+
+          g_string_append_c (string, '}');
+        }
+    }
+
+  g_mutex_unlock (&trace_threads_mutex);
+
+  g_string_append (string, "\n]}\n");
+
+  success = g_file_replace_contents (file, string->str, string->len,
+                                     NULL, FALSE, G_FILE_CREATE_NONE,
+                                     NULL, NULL, error);
+
+  g_string_free (string, TRUE);
+
+  return success;
+}
+
+void
+gimp_trace_begin (const gchar *name)
+{
+  gimp_trace_record ('B', name, 0);
+}
+
+void
+gimp_trace_end (const gchar *name)
+{
+  gimp_trace_record ('E', name, 0);
+}
+
+void
+gimp_trace_counter (const gchar *name,
+                    gint64       value)
+{
+  gimp_trace_record ('C', name, value);
+}
+
+
+/*  private functions  */
+
+static GimpTraceThread *
+gimp_trace_get_thread (void)
+{
+  GimpTraceThread *thread = g_private_get (&trace_thread_key);
+
+  if (G_UNLIKELY (! thread))
+    {
+      /*  never freed, the events of finished threads are dumped too  */
+      thread = g_new0 (GimpTraceThread, 1);
+
+      g_mutex_lock (&trace_threads_mutex);
+
+      thread->tid   = ++trace_n_tids;
+      trace_threads = g_slist_append (trace_threads, thread);
+
+      g_mutex_unlock (&trace_threads_mutex);
+
+      g_private_set (&trace_thread_key, thread);
+    }
+
+  return thread;
+}
+
+static void
+gimp_trace_record (gchar        phase,
+                   const gchar *name,
+                   gint64       value)
+{
+  GimpTraceThread *thread   = gimp_trace_get_thread ();
+  gint             n_events = thread->n_events;
+  GimpTraceEvent  *event    = &thread->events[n_events % RING_SIZE];
+
+  event->name  = name;
+  event->time  = g_get_monotonic_time ();
+  event->value = value;
+  event->phase = phase;
+
+  g_atomic_int_set (&thread->n_events, n_events + 1);
+}
@@ -0,0 +1,59 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_TRACE_H__
+#define __GIMP_TRACE_H__
+
+
+extern gboolean gimp_trace_enabled;
+
+
+void       gimp_trace_init    (const gchar  *filename);
+void       gimp_trace_exit    (void);
+
+gboolean   gimp_trace_dump    (GFile        *file,
+                               GError      **error);
+
+void       gimp_trace_begin   (const gchar  *name);
+void       gimp_trace_end     (const gchar  *name);
+void       gimp_trace_counter (const gchar  *name,
+                               gint64        value);
+
+
+/*  @name must be a string which stays valid until the trace is dumped,
+ *  usually a literal
+ */
+#define GIMP_TRACE_BEGIN(name) \
+        G_STMT_START { \
+        if (gimp_trace_enabled) \
+          gimp_trace_begin (name); \
+        } G_STMT_END
+
+#define GIMP_TRACE_END(name) \
+        G_STMT_START { \
+        if (gimp_trace_enabled) \
+          gimp_trace_end (name); \
+        } G_STMT_END
+
+#define GIMP_TRACE_COUNTER(name, value) \
+        G_STMT_START { \
+        if (gimp_trace_enabled) \
+          gimp_trace_counter (name, value); \
+        } G_STMT_END
+
+
+#endif /* __GIMP_TRACE_H__ */
@@ -31,6 +31,7 @@
 #include "config/gimpguiconfig.h"
 
 #include "core/gimp.h"
+#include "core/gimp-startup.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpcontext.h"
 #include "core/gimpimage.h"
@@ -430,6 +431,8 @@ gui_restore_callback (Gimp               *gimp,
   if (gimp->be_verbose)
     g_print ("INIT: %s\n", G_STRFUNC);
 
+  gimp_startup_begin ("interface");
+
   gui_vtable_init (gimp);
 
   if (! gui_config->show_tooltips)
@@ -474,11 +477,19 @@ gui_restore_callback (Gimp               *gimp,
                     NULL);
     }
 
+  gimp_startup_begin ("actions");
   actions_init (gimp);
+  gimp_startup_end ();
+
+  gimp_startup_begin ("menus");
   menus_init (gimp, global_action_factory);
+  gimp_startup_end ();
+
   gimp_render_init (gimp);
 
+  gimp_startup_begin ("dialogs");
   dialogs_init (gimp, global_menu_factory);
+  gimp_startup_end ();
 
   gimp_clipboard_init (gimp);
   if (gimp_get_clipboard_image (gimp))
@@ -490,14 +501,23 @@ gui_restore_callback (Gimp               *gimp,
                     G_CALLBACK (gui_clipboard_changed),
                     NULL);
 
+  gimp_startup_begin ("devices");
   gimp_devices_init (gimp);
   gimp_controllers_init (gimp);
+  gimp_startup_end ();
+
+  gimp_startup_begin ("sessionrc");
   session_init (gimp);
+  gimp_startup_end ();
 
   g_type_class_unref (g_type_class_ref (GIMP_TYPE_COLOR_SELECTOR_PALETTE));
 
   status_callback (NULL, _("Tool Options"), 1.0);
+  gimp_startup_begin ("tool options");
   gimp_tools_restore (gimp);
+  gimp_startup_end ();
+
+  gimp_startup_end ();
 }
 
 #ifdef GDK_WINDOWING_QUARTZ
@@ -537,11 +557,15 @@ gui_restore_after_callback (Gimp               *gimp,
 
   gimp->message_handler = GIMP_MESSAGE_BOX;
 
+  gimp_startup_begin ("interface");
+
   /*  load the recent documents after gimp_real_restore() because we
    *  need the mime-types implemented by plug-ins
    */
   status_callback (NULL, _("Documents"), 0.9);
+  gimp_startup_begin ("documents");
   gimp_recent_list_load (gimp);
+  gimp_startup_end ();
 
   /*  enable this to always have icons everywhere  */
   if (g_getenv ("GIMP_ICONS_LIKE_A_BOSS"))
@@ -554,6 +578,8 @@ gui_restore_after_callback (Gimp               *gimp,
                     NULL);
     }
 
+  gimp_startup_begin ("menus");
+
   if (gui_config->restore_accels)
     menus_restore (gimp);
 
@@ -567,6 +593,8 @@ gui_restore_after_callback (Gimp               *gimp,
                                                     gui_config->tearoff_menus);
   gimp_ui_manager_update (image_ui_manager, gimp);
 
+  gimp_startup_end ();
+
   /* Check that every accelerator is unique. */
   gtk_accel_map_foreach_unfiltered (NULL,
                                     gui_check_unique_accelerator);
@@ -651,6 +679,8 @@ gui_restore_after_callback (Gimp               *gimp,
       GimpDisplayShell *shell;
       GtkWidget        *toplevel;
 
+      gimp_startup_begin ("session");
+
       /*  create the empty display  */
       display = GIMP_DISPLAY (gimp_create_display (gimp, NULL,
                                                    GIMP_UNIT_PIXEL, 1.0,
@@ -667,8 +697,12 @@ gui_restore_after_callback (Gimp               *gimp,
       /*  move keyboard focus to the display  */
       toplevel = gtk_widget_get_toplevel (GTK_WIDGET (shell));
       gtk_window_present (GTK_WINDOW (toplevel));
+
+      gimp_startup_end ();
     }
 
+  gimp_startup_end ();
+
   /*  indicate that the application has finished loading  */
   gdk_notify_startup_complete ();
 
@@ -682,10 +716,26 @@ gui_exit_callback (Gimp     *gimp,
                    gboolean  force)
 {
   GimpGuiConfig  *gui_config = GIMP_GUI_CONFIG (gimp->config);
+  GList          *list;
 
   if (gimp->be_verbose)
     g_print ("EXIT: %s\n", G_STRFUNC);
 
+  /*  never quit while an image is being saved in the background, not
+   *  even when forced, we are running in its nested main loop
+   */
+  for (list = gimp_get_image_iter (gimp); list; list = g_list_next (list))
+    {
+      if (gimp_image_is_busy (list->data))
+        {
+          gimp_message_literal (gimp, NULL, GIMP_MESSAGE_WARNING,
+                                _("GIMP can't quit while an image is "
+                                  "being saved."));
+
+          return TRUE; /* stop exit for now */
+        }
+    }
+
   if (! force && gimp_displays_dirty (gimp))
     {
       GdkScreen *screen;
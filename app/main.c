@@ -77,6 +77,7 @@
 #endif
 
 #include "gimp-log.h"
+#include "gimp-trace.h"
 #include "gimp-intl.h"
 #include "gimp-version.h"
 
@@ -93,6 +94,10 @@ static gboolean  gimp_option_pdb_compat_mode  (const gchar  *option_name,
                                                const gchar  *value,
                                                gpointer      data,
                                                GError      **error);
+static gboolean  gimp_option_batch_job_memory (const gchar  *option_name,
+                                               const gchar  *value,
+                                               gpointer      data,
+                                               GError      **error);
 static gboolean  gimp_option_dump_gimprc      (const gchar  *option_name,
                                                const gchar  *value,
                                                gpointer      data,
@@ -120,6 +125,10 @@ static const gchar        *user_gimprc       = NULL;
 static const gchar        *session_name      = NULL;
 static const gchar        *batch_interpreter = NULL;
 static const gchar       **batch_commands    = NULL;
+static gint                batch_workers     = 0;
+static guint64             batch_job_memory  = 0;
+static const gchar        *trace_file        = NULL;
+static const gchar        *paint_record_file = NULL;
 static const gchar       **filenames         = NULL;
 static gboolean            as_new            = FALSE;
 static gboolean            no_interface      = FALSE;
@@ -127,6 +136,7 @@ static gboolean            no_data           = FALSE;
 static gboolean            no_fonts          = FALSE;
 static gboolean            no_splash         = FALSE;
 static gboolean            be_verbose        = FALSE;
+static gboolean            verbose_timing    = FALSE;
 static gboolean            new_instance      = FALSE;
 #if defined (USE_SYSV_SHM) || defined (USE_POSIX_SHM) || defined (G_OS_WIN32)
 static gboolean            use_shm           = TRUE;
@@ -164,6 +174,23 @@ static const GOptionEntry main_entries[] =
     G_OPTION_ARG_NONE, &be_verbose,
     N_("Be more verbose"), NULL
   },
+  {
+    "verbose-timing", 0, 0,
+    G_OPTION_ARG_NONE, &verbose_timing,
+    N_("Print how long each phase of the startup took"), NULL
+  },
+  {
+    "trace", 0, 0,
+    G_OPTION_ARG_FILENAME, &trace_file,
+    N_("Record a trace of GIMP's activity and write it to <filename> "
+       "on exit"), "<filename>"
+  },
+  {
+    "paint-record", 0, 0,
+    G_OPTION_ARG_FILENAME, &paint_record_file,
+    N_("Record the painted strokes to <filename>, for replaying them "
+       "with benchmark-paint-replay"), "<filename>"
+  },
   {
     "new-instance", 'n', 0,
     G_OPTION_ARG_NONE, &new_instance,
@@ -229,6 +256,18 @@ static const GOptionEntry main_entries[] =
     G_OPTION_ARG_STRING, &batch_interpreter,
     N_("The procedure to process batch commands with"), "<proc>"
   },
+  {
+    "batch-queue", 0, 0,
+    G_OPTION_ARG_INT, &batch_workers,
+    N_("Run batch commands read from stdin as independent jobs, "
+       "up to <n> at once"), "<n>"
+  },
+  {
+    "batch-job-memory", 0, 0,
+    G_OPTION_ARG_CALLBACK, gimp_option_batch_job_memory,
+    N_("Kill batch queue jobs whose images use more than <size> "
+       "of memory"), "<size>"
+  },
   {
     "console-messages", 'c', 0,
     G_OPTION_ARG_NONE, &console_messages,
@@ -482,10 +521,13 @@ main (int    argc,
       app_exit (EXIT_FAILURE);
     }
 
-  if (no_interface || be_verbose || console_messages || batch_commands != NULL)
+  gimp_trace_init (trace_file);
+
+  if (no_interface || be_verbose || console_messages ||
+      batch_commands != NULL || batch_workers > 0)
     gimp_open_console_window ();
 
-  if (no_interface)
+  if (no_interface || batch_workers > 0)
     new_instance = TRUE;
 
 #ifndef GIMP_CONSOLE_COMPILATION
@@ -521,17 +563,21 @@ main (int    argc,
            session_name,
            batch_interpreter,
            batch_commands,
+           batch_workers,
+           batch_job_memory,
            as_new,
            no_interface,
            no_data,
            no_fonts,
            no_splash,
            be_verbose,
+           verbose_timing,
            use_shm,
            use_cpu_accel,
            console_messages,
            use_debug_handler,
            show_playground,
+           paint_record_file,
            stack_trace_mode,
            pdb_compat_mode,
            backtrace_file);
@@ -663,6 +709,15 @@ gimp_option_pdb_compat_mode (const gchar  *option_name,
   return TRUE;
 }
 
+static gboolean
+gimp_option_batch_job_memory (const gchar  *option_name,
+                              const gchar  *value,
+                              gpointer      data,
+                              GError      **error)
+{
+  return gimp_memsize_deserialize (value, &batch_job_memory);
+}
+
 static gboolean
 gimp_option_dump_gimprc (const gchar  *option_name,
                          const gchar  *value,
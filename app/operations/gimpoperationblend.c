@@ -38,7 +38,11 @@
 #include "gimp-intl.h"
 
 
-//#define USE_GRADIENT_CACHE 1
+/*  the gradient is sampled at about one entry per pixel of its length,
+ *  and linearly interpolated between entries
+ */
+#define GRADIENT_CACHE_MIN_SIZE  4096
+#define GRADIENT_CACHE_MAX_SIZE  65536
 
 enum
 {
@@ -63,12 +67,8 @@ typedef struct
 {
   GimpGradient        *gradient;
   gboolean             reverse;
-#ifdef USE_GRADIENT_CACHE
-  GimpRGB             *gradient_cache;
+  const GimpRGB       *gradient_cache;
   gint                 gradient_cache_size;
-#else
-  GimpGradientSegment *last_seg;
-#endif
   gdouble              offset;
   gdouble              sx, sy;
   GimpGradientType     gradient_type;
@@ -82,19 +82,31 @@ typedef struct
 } RenderBlendData;
 
 
+/*  the supersampled rows are rendered in parallel, each row by a
+ *  single thread, so each row gets its own buffer
+ */
+typedef struct
+{
+  gfloat        *data;
+  GRand         *dither_rand;
+} PutPixelRow;
+
 typedef struct
 {
   GeglBuffer    *buffer;
-  gfloat        *row_data;
+  PutPixelRow   *rows;
   gint           roi_x;
+  gint           roi_y;
   gint           width;
-  GRand         *dither_rand;
+  gboolean       dither;
+  guint32        dither_seed;
 } PutPixelData;
 
 
 /*  local function prototypes  */
 
 static void     gimp_operation_blend_dispose      (GObject      *gobject);
+static void     gimp_operation_blend_finalize     (GObject      *gobject);
 static void     gimp_operation_blend_get_property (GObject      *object,
                                                    guint         property_id,
                                                    GValue       *value,
@@ -153,6 +165,18 @@ static gdouble  gradient_calc_shapeburst_dimpled_factor   (GeglBuffer *dist_buff
                                                            gdouble     x,
                                                            gdouble     y);
 
+static gdouble  gradient_calc_factor         (RenderBlendData    *rbd,
+                                              gdouble             x,
+                                              gdouble             y);
+static void     gradient_calc_row_factors    (RenderBlendData    *rbd,
+                                              gint                x,
+                                              gint                y,
+                                              gint                width,
+                                              gdouble            *factors,
+                                              gfloat             *dist_row);
+static void     gradient_factor_to_color     (RenderBlendData    *rbd,
+                                              gdouble             factor,
+                                              GimpRGB            *color);
 static void     gradient_render_pixel        (gdouble             x,
                                               gdouble             y,
                                               GimpRGB            *color,
@@ -163,6 +187,13 @@ static void     gradient_put_pixel           (gint                x,
                                               GimpRGB            *color,
                                               gpointer            put_pixel_data);
 
+static GArray * gimp_operation_blend_get_gradient_cache
+                                             (GimpOperationBlend  *self,
+                                              GimpGradient        *gradient,
+                                              gdouble              length);
+static void     gimp_operation_blend_invalidate_gradient_cache
+                                             (GimpOperationBlend  *self);
+
 static gboolean gimp_operation_blend_process (GeglOperation       *operation,
                                               GeglBuffer          *input,
                                               GeglBuffer          *output,
@@ -184,6 +215,7 @@ gimp_operation_blend_class_init (GimpOperationBlendClass *klass)
   GeglOperationFilterClass *filter_class    = GEGL_OPERATION_FILTER_CLASS (klass);
 
   object_class->dispose             = gimp_operation_blend_dispose;
+  object_class->finalize            = gimp_operation_blend_finalize;
   object_class->set_property        = gimp_operation_blend_set_property;
   object_class->get_property        = gimp_operation_blend_get_property;
 
@@ -317,6 +349,7 @@ gimp_operation_blend_class_init (GimpOperationBlendClass *klass)
 static void
 gimp_operation_blend_init (GimpOperationBlend *self)
 {
+  g_mutex_init (&self->gradient_cache_mutex);
 }
 
 static void
@@ -330,6 +363,18 @@ gimp_operation_blend_dispose (GObject *object)
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+static void
+gimp_operation_blend_finalize (GObject *object)
+{
+  GimpOperationBlend *self = GIMP_OPERATION_BLEND (object);
+
+  gimp_operation_blend_invalidate_gradient_cache (self);
+
+  g_mutex_clear (&self->gradient_cache_mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gimp_operation_blend_get_property (GObject    *object,
                                    guint       property_id,
@@ -423,6 +468,8 @@ gimp_operation_blend_set_property (GObject      *object,
       {
         GimpGradient *gradient = g_value_get_object (value);
 
+        gimp_operation_blend_invalidate_gradient_cache (self);
+
         if (self->gradient)
           {
             g_object_unref (self->gradient);
@@ -441,18 +488,22 @@ gimp_operation_blend_set_property (GObject      *object,
 
     case PROP_START_X:
       self->start_x = g_value_get_double (value);
+      gimp_operation_blend_invalidate_gradient_cache (self);
       break;
 
     case PROP_START_Y:
       self->start_y = g_value_get_double (value);
+      gimp_operation_blend_invalidate_gradient_cache (self);
       break;
 
     case PROP_END_X:
       self->end_x = g_value_get_double (value);
+      gimp_operation_blend_invalidate_gradient_cache (self);
       break;
 
     case PROP_END_Y:
       self->end_y = g_value_get_double (value);
+      gimp_operation_blend_invalidate_gradient_cache (self);
       break;
 
     case PROP_GRADIENT_TYPE:
@@ -469,6 +520,7 @@ gimp_operation_blend_set_property (GObject      *object,
 
     case PROP_GRADIENT_REVERSE:
       self->gradient_reverse = g_value_get_boolean (value);
+      gimp_operation_blend_invalidate_gradient_cache (self);
       break;
 
     case PROP_SUPERSAMPLE:
@@ -802,87 +854,174 @@ gradient_calc_shapeburst_dimpled_factor (GeglBuffer *dist_buffer,
   return value;
 }
 
-static void
-gradient_render_pixel (gdouble   x,
-                       gdouble   y,
-                       GimpRGB  *color,
-                       gpointer  render_data)
+static gdouble
+gradient_calc_factor (RenderBlendData *rbd,
+                      gdouble          x,
+                      gdouble          y)
 {
-  RenderBlendData *rbd = render_data;
-  gdouble          factor;
+  switch (rbd->gradient_type)
+    {
+    case GIMP_GRADIENT_LINEAR:
+      return gradient_calc_linear_factor (rbd->dist,
+                                          rbd->vec, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy);
 
-  /*  we want to calculate the color at the pixel's center  */
-  x += 0.5;
-  y += 0.5;
+    case GIMP_GRADIENT_BILINEAR:
+      return gradient_calc_bilinear_factor (rbd->dist,
+                                            rbd->vec, rbd->offset,
+                                            x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_RADIAL:
+      return gradient_calc_radial_factor (rbd->dist,
+                                          rbd->offset,
+                                          x - rbd->sx, y - rbd->sy);
 
-  /* Calculate blending factor */
+    case GIMP_GRADIENT_SQUARE:
+      return gradient_calc_square_factor (rbd->dist, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_CONICAL_SYMMETRIC:
+      return gradient_calc_conical_sym_factor (rbd->dist,
+                                               rbd->vec, rbd->offset,
+                                               x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_CONICAL_ASYMMETRIC:
+      return gradient_calc_conical_asym_factor (rbd->dist,
+                                                rbd->vec, rbd->offset,
+                                                x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
+      return gradient_calc_shapeburst_angular_factor (rbd->dist_buffer, x, y);
+
+    case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
+      return gradient_calc_shapeburst_spherical_factor (rbd->dist_buffer, x, y);
+
+    case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
+      return gradient_calc_shapeburst_dimpled_factor (rbd->dist_buffer, x, y);
+
+    case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
+      return gradient_calc_spiral_factor (rbd->dist,
+                                          rbd->vec, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy, TRUE);
+
+    case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
+      return gradient_calc_spiral_factor (rbd->dist,
+                                          rbd->vec, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy, FALSE);
+
+    default:
+      g_return_val_if_reached (0.0);
+    }
+}
+
+/*  Calculates the blending factors of a whole row of pixels, with the
+ *  switch on the gradient type outside of the loops.  The shapeburst
+ *  distances of the row are fetched at once into dist_row.
+ */
+static void
+gradient_calc_row_factors (RenderBlendData *rbd,
+                           gint             x,
+                           gint             y,
+                           gint             width,
+                           gdouble         *factors,
+                           gfloat          *dist_row)
+{
+  /*  we want to calculate the color at the pixel's center  */
+  const gdouble dx = x + 0.5 - rbd->sx;
+  const gdouble dy = y + 0.5 - rbd->sy;
+  gint          i;
 
   switch (rbd->gradient_type)
     {
     case GIMP_GRADIENT_LINEAR:
-      factor = gradient_calc_linear_factor (rbd->dist,
-                                            rbd->vec, rbd->offset,
-                                            x - rbd->sx, y - rbd->sy);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_linear_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  dx + i, dy);
       break;
 
     case GIMP_GRADIENT_BILINEAR:
-      factor = gradient_calc_bilinear_factor (rbd->dist,
-                                              rbd->vec, rbd->offset,
-                                              x - rbd->sx, y - rbd->sy);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_bilinear_factor (rbd->dist,
+                                                    rbd->vec, rbd->offset,
+                                                    dx + i, dy);
       break;
 
     case GIMP_GRADIENT_RADIAL:
-      factor = gradient_calc_radial_factor (rbd->dist,
-                                            rbd->offset,
-                                            x - rbd->sx, y - rbd->sy);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_radial_factor (rbd->dist, rbd->offset,
+                                                  dx + i, dy);
       break;
 
     case GIMP_GRADIENT_SQUARE:
-      factor = gradient_calc_square_factor (rbd->dist, rbd->offset,
-                                            x - rbd->sx, y - rbd->sy);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_square_factor (rbd->dist, rbd->offset,
+                                                  dx + i, dy);
       break;
 
     case GIMP_GRADIENT_CONICAL_SYMMETRIC:
-      factor = gradient_calc_conical_sym_factor (rbd->dist,
-                                                 rbd->vec, rbd->offset,
-                                                 x - rbd->sx, y - rbd->sy);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_conical_sym_factor (rbd->dist,
+                                                       rbd->vec, rbd->offset,
+                                                       dx + i, dy);
       break;
 
     case GIMP_GRADIENT_CONICAL_ASYMMETRIC:
-      factor = gradient_calc_conical_asym_factor (rbd->dist,
-                                                  rbd->vec, rbd->offset,
-                                                  x - rbd->sx, y - rbd->sy);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_conical_asym_factor (rbd->dist,
+                                                        rbd->vec, rbd->offset,
+                                                        dx + i, dy);
       break;
 
     case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
-      factor = gradient_calc_shapeburst_angular_factor (rbd->dist_buffer, x, y);
-      break;
-
     case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
-      factor = gradient_calc_shapeburst_spherical_factor (rbd->dist_buffer, x, y);
-      break;
-
     case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
-      factor = gradient_calc_shapeburst_dimpled_factor (rbd->dist_buffer, x, y);
+      gegl_buffer_get (rbd->dist_buffer, GEGL_RECTANGLE (x, y, width, 1), 1.0,
+                       NULL, dist_row,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      if (rbd->gradient_type == GIMP_GRADIENT_SHAPEBURST_ANGULAR)
+        {
+          for (i = 0; i < width; i++)
+            factors[i] = (gfloat) (1.0 - dist_row[i]);
+        }
+      else if (rbd->gradient_type == GIMP_GRADIENT_SHAPEBURST_SPHERICAL)
+        {
+          for (i = 0; i < width; i++)
+            factors[i] = (gfloat) (1.0 - sin (0.5 * G_PI * dist_row[i]));
+        }
+      else
+        {
+          for (i = 0; i < width; i++)
+            factors[i] = (gfloat) cos (0.5 * G_PI * dist_row[i]);
+        }
       break;
 
     case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
-      factor = gradient_calc_spiral_factor (rbd->dist,
-                                            rbd->vec, rbd->offset,
-                                            x - rbd->sx, y - rbd->sy, TRUE);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_spiral_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  dx + i, dy, TRUE);
       break;
 
     case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
-      factor = gradient_calc_spiral_factor (rbd->dist,
-                                            rbd->vec, rbd->offset,
-                                            x - rbd->sx, y - rbd->sy, FALSE);
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_spiral_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  dx + i, dy, FALSE);
       break;
 
     default:
       g_return_if_reached ();
       break;
     }
+}
 
+static inline void
+gradient_factor_to_color (RenderBlendData *rbd,
+                          gdouble          factor,
+                          GimpRGB         *color)
+{
   /* Adjust for repeat */
 
   switch (rbd->repeat)
@@ -923,16 +1062,38 @@ gradient_render_pixel (gdouble   x,
     }
   else
     {
-#ifdef USE_GRADIENT_CACHE
-      *color = rbd->gradient_cache[(gint) (factor * (rbd->gradient_cache_size - 1))];
-#else
-      rbd->last_seg = gimp_gradient_get_color_at (rbd->gradient, NULL,
-                                                  rbd->last_seg, factor,
-                                                  rbd->reverse, color);
-#endif
+      const GimpRGB *c;
+      gdouble        pos = factor * (rbd->gradient_cache_size - 1);
+      gint           i   = (gint) pos;
+      gdouble        t   = pos - i;
+
+      c = rbd->gradient_cache + i;
+
+      color->r = c[0].r + (c[1].r - c[0].r) * t;
+      color->g = c[0].g + (c[1].g - c[0].g) * t;
+      color->b = c[0].b + (c[1].b - c[0].b) * t;
+      color->a = c[0].a + (c[1].a - c[0].a) * t;
     }
 }
 
+static void
+gradient_render_pixel (gdouble   x,
+                       gdouble   y,
+                       GimpRGB  *color,
+                       gpointer  render_data)
+{
+  RenderBlendData *rbd = render_data;
+  gdouble          factor;
+
+  /*  we want to calculate the color at the pixel's center  */
+  x += 0.5;
+  y += 0.5;
+
+  factor = gradient_calc_factor (rbd, x, y);
+
+  gradient_factor_to_color (rbd, factor, color);
+}
+
 static void
 gradient_put_pixel (gint      x,
                     gint      y,
@@ -940,13 +1101,24 @@ gradient_put_pixel (gint      x,
                     gpointer  put_pixel_data)
 {
   PutPixelData *ppd   = put_pixel_data;
+  PutPixelRow  *row   = &ppd->rows[y - ppd->roi_y];
   const gint    index = x - ppd->roi_x;
-  gfloat       *dest  = ppd->row_data + 4 * index;
+  gfloat       *dest;
 
-  if (ppd->dither_rand)
+  if (index == 0)
+    {
+      row->data = g_new (gfloat, 4 * ppd->width);
+
+      if (ppd->dither)
+        row->dither_rand = g_rand_new_with_seed (ppd->dither_seed + y);
+    }
+
+  dest = row->data + 4 * index;
+
+  if (row->dither_rand)
     {
       gfloat r, g, b, a;
-      gint   i = g_rand_int (ppd->dither_rand);
+      gint   i = g_rand_int (row->dither_rand);
 
       r = color->r + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
       g = color->g + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
@@ -972,9 +1144,16 @@ gradient_put_pixel (gint      x,
 
   /* Paint whole row if we are on the rightmost pixel */
   if (index == (ppd->width - 1))
-    gegl_buffer_set (ppd->buffer, GEGL_RECTANGLE (ppd->roi_x, y, ppd->width, 1),
-                     0, babl_format ("R'G'B'A float"), ppd->row_data,
-                     GEGL_AUTO_ROWSTRIDE);
+    {
+      gegl_buffer_set (ppd->buffer, GEGL_RECTANGLE (ppd->roi_x, y, ppd->width, 1),
+                       0, babl_format ("R'G'B'A float"), row->data,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      g_clear_pointer (&row->data, g_free);
+
+      if (row->dither_rand)
+        g_clear_pointer (&row->dither_rand, g_rand_free);
+    }
 }
 
 static gboolean
@@ -992,6 +1171,7 @@ gimp_operation_blend_process (GeglOperation       *operation,
   const gdouble ey = self->end_y;
 
   RenderBlendData rbd = { 0, };
+  GArray         *gradient_cache;
 
   rbd.gradient = NULL;
   rbd.reverse  = self->gradient_reverse;
@@ -1001,24 +1181,11 @@ gimp_operation_blend_process (GeglOperation       *operation,
   else
     rbd.gradient = GIMP_GRADIENT (gimp_gradient_new (NULL, "Blend-Temp"));
 
-#ifdef USE_GRADIENT_CACHE
-  {
-    GimpGradientSegment *last_seg = NULL;
-    gint                 i;
-
-    rbd.gradient_cache_size = ceil (sqrt (SQR (sx - ex) + SQR (sy - ey)));
-    rbd.gradient_cache      = g_new0 (GimpRGB, rbd.gradient_cache_size);
+  gradient_cache = gimp_operation_blend_get_gradient_cache (
+                     self, rbd.gradient, sqrt (SQR (ex - sx) + SQR (ey - sy)));
 
-    for (i = 0; i < rbd.gradient_cache_size; i++)
-      {
-        gdouble factor = (gdouble) i / (gdouble) (rbd.gradient_cache_size - 1);
-
-        last_seg = gimp_gradient_get_color_at (rbd.gradient, NULL, last_seg,
-                                               factor, rbd.reverse,
-                                               rbd.gradient_cache + i);
-      }
-  }
-#endif
+  rbd.gradient_cache      = (const GimpRGB *) gradient_cache->data;
+  rbd.gradient_cache_size = gradient_cache->len;
 
   /* Calculate type-specific parameters */
 
@@ -1093,104 +1260,164 @@ gimp_operation_blend_process (GeglOperation       *operation,
   if (self->supersample)
     {
       PutPixelData  ppd = { 0, };
+      gint          n_threads;
 
       ppd.buffer      = output;
-      ppd.row_data    = g_malloc (sizeof (float) * 4 * result->width);
+      ppd.rows        = g_new0 (PutPixelRow, result->height);
       ppd.roi_x       = result->x;
+      ppd.roi_y       = result->y;
       ppd.width       = result->width;
+      ppd.dither      = self->dither;
       if (self->dither)
-        ppd.dither_rand = g_rand_new ();
-
-      gimp_adaptive_supersample_area (result->x, result->y,
-                                      result->x + result->width  - 1,
-                                      result->y + result->height - 1,
-                                      self->supersample_depth,
-                                      self->supersample_threshold,
-                                      gradient_render_pixel, &rbd,
-                                      gradient_put_pixel, &ppd,
-                                      NULL,
-                                      NULL);
-
-      if (self->dither)
-        g_rand_free (ppd.dither_rand);
-      g_free (ppd.row_data);
+        ppd.dither_seed = g_random_int ();
+
+      g_object_get (gegl_config (), "threads", &n_threads, NULL);
+
+      gimp_adaptive_supersample_area_parallel (result->x, result->y,
+                                               result->x + result->width  - 1,
+                                               result->y + result->height - 1,
+                                               self->supersample_depth,
+                                               self->supersample_threshold,
+                                               n_threads,
+                                               gradient_render_pixel, &rbd,
+                                               gradient_put_pixel, &ppd,
+                                               NULL,
+                                               NULL);
+
+      g_free (ppd.rows);
     }
   else
     {
       GeglBufferIterator *iter;
       GeglRectangle      *roi;
+      gdouble            *factors;
+      gfloat             *dist_row = NULL;
 
       iter = gegl_buffer_iterator_new (output, result, 0,
                                        babl_format ("R'G'B'A float"),
                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
       roi = &iter->roi[0];
 
+      factors = g_new (gdouble, result->width);
+
+      if (rbd.dist_buffer)
+        dist_row = g_new (gfloat, result->width);
+
       if (self->dither)
         rbd.seed = g_rand_new ();
 
       while (gegl_buffer_iterator_next (iter))
         {
-          gfloat *dest = iter->data[0];
-          gint    endx = roi->x + roi->width;
-          gint    endy = roi->y + roi->height;
+          gfloat *dest        = iter->data[0];
+          GRand  *dither_rand = NULL;
+          gint    endy        = roi->y + roi->height;
           gint    x, y;
 
           if (rbd.seed)
-            {
-              GRand *dither_rand = g_rand_new_with_seed (g_rand_int (rbd.seed));
+            dither_rand = g_rand_new_with_seed (g_rand_int (rbd.seed));
 
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-                    gfloat   r, g, b, a;
-                    gint     i = g_rand_int (dither_rand);
-
-                    gradient_render_pixel (x, y, &color, &rbd);
-
-                    r = color.r + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    g = color.g + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    b = color.b + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-
-                    if (color.a > 0.0 && color.a < 1.0)
-                      a = color.a + (gdouble) (i & 0xff) / 256.0 / 256.0;
-                    else
-                      a = color.a;
-
-                    *dest++ = MAX (r, 0.0);
-                    *dest++ = MAX (g, 0.0);
-                    *dest++ = MAX (b, 0.0);
-                    *dest++ = MAX (a, 0.0);
-                  }
-
-              g_rand_free (dither_rand);
-            }
-          else
+          for (y = roi->y; y < endy; y++)
             {
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-
-                    gradient_render_pixel (x, y, &color, &rbd);
-
-                    *dest++ = color.r;
-                    *dest++ = color.g;
-                    *dest++ = color.b;
-                    *dest++ = color.a;
-                  }
+              gradient_calc_row_factors (&rbd, roi->x, y, roi->width,
+                                         factors, dist_row);
+
+              if (dither_rand)
+                {
+                  for (x = 0; x < roi->width; x++)
+                    {
+                      GimpRGB  color;
+                      gfloat   r, g, b, a;
+                      gint     i = g_rand_int (dither_rand);
+
+                      gradient_factor_to_color (&rbd, factors[x], &color);
+
+                      r = color.r + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+                      g = color.g + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+                      b = color.b + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+
+                      if (color.a > 0.0 && color.a < 1.0)
+                        a = color.a + (gdouble) (i & 0xff) / 256.0 / 256.0;
+                      else
+                        a = color.a;
+
+                      *dest++ = MAX (r, 0.0);
+                      *dest++ = MAX (g, 0.0);
+                      *dest++ = MAX (b, 0.0);
+                      *dest++ = MAX (a, 0.0);
+                    }
+                }
+              else
+                {
+                  for (x = 0; x < roi->width; x++)
+                    {
+                      GimpRGB  color;
+
+                      gradient_factor_to_color (&rbd, factors[x], &color);
+
+                      *dest++ = color.r;
+                      *dest++ = color.g;
+                      *dest++ = color.b;
+                      *dest++ = color.a;
+                    }
+                }
             }
+
+          if (dither_rand)
+            g_rand_free (dither_rand);
         }
 
       if (self->dither)
         g_rand_free (rbd.seed);
+
+      g_free (factors);
+      g_free (dist_row);
     }
 
-#ifdef USE_GRADIENT_CACHE
-  g_free (rbd.gradient_cache);
-#endif
+  g_array_unref (gradient_cache);
 
   g_object_unref (rbd.gradient);
 
   return TRUE;
 }
+
+static GArray *
+gimp_operation_blend_get_gradient_cache (GimpOperationBlend *self,
+                                         GimpGradient       *gradient,
+                                         gdouble            length)
+{
+  GArray *cache;
+
+  g_mutex_lock (&self->gradient_cache_mutex);
+
+  if (! self->gradient_cache)
+    {
+      gint size;
+
+      size = CLAMP ((gint) ceil (length),
+                    GRADIENT_CACHE_MIN_SIZE, GRADIENT_CACHE_MAX_SIZE);
+
+      self->gradient_cache = g_array_sized_new (FALSE, FALSE,
+                                                sizeof (GimpRGB), size);
+      g_array_set_size (self->gradient_cache, size);
+
+      gimp_gradient_get_uniform_colors (gradient, NULL, 0.0, 1.0, size,
+                                        self->gradient_reverse,
+                                        (GimpRGB *) self->gradient_cache->data);
+    }
+
+  cache = g_array_ref (self->gradient_cache);
+
+  g_mutex_unlock (&self->gradient_cache_mutex);
+
+  return cache;
+}
+
+static void
+gimp_operation_blend_invalidate_gradient_cache (GimpOperationBlend *self)
+{
+  g_mutex_lock (&self->gradient_cache_mutex);
+
+  g_clear_pointer (&self->gradient_cache, g_array_unref);
+
+  g_mutex_unlock (&self->gradient_cache_mutex);
+}
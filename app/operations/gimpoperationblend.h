@@ -54,6 +54,9 @@ struct _GimpOperationBlend
   gdouble              supersample_threshold;
 
   gboolean             dither;
+
+  GArray              *gradient_cache;
+  GMutex               gradient_cache_mutex;
 };
 
 struct _GimpOperationBlendClass
@@ -29,9 +29,17 @@
 
 #include "operations-types.h"
 
+#include "gegl/gimp-gegl-distance.h"
+
 #include "gimpoperationborder.h"
 
 
+/*  from this radius on, the border is computed using a distance
+ *  transform
+ */
+#define DISTANCE_TRANSFORM_MIN_RADIUS 8
+
+
 enum
 {
   PROP_0,
@@ -64,6 +72,11 @@ static gboolean gimp_operation_border_process (GeglOperation       *operation,
                                                GeglBuffer          *output,
                                                const GeglRectangle *roi,
                                                gint                 level);
+static void
+       gimp_operation_border_process_distance (GimpOperationBorder *self,
+                                               GeglBuffer          *input,
+                                               GeglBuffer          *output,
+                                               const GeglRectangle *roi);
 
 
 G_DEFINE_TYPE (GimpOperationBorder, gimp_operation_border,
@@ -455,6 +468,14 @@ gimp_operation_border_process (GeglOperation       *operation,
       return TRUE;
     }
 
+  if (MAX (self->radius_x, self->radius_y) >= DISTANCE_TRANSFORM_MIN_RADIUS &&
+      roi->height > self->radius_y + 1)
+    {
+      gimp_operation_border_process_distance (self, input, output, roi);
+
+      return TRUE;
+    }
+
   max = g_new (gint16, roi->width + 2 * self->radius_x);
 
   for (i = 0; i < (roi->width + 2 * self->radius_x); i++)
@@ -745,3 +766,64 @@ gimp_operation_border_process (GeglOperation       *operation,
 
   return TRUE;
 }
+
+/* The density of each pixel only depends on the nearest transitional
+   pixel in each column within the radius, so instead of tracking the
+   transitions around each row, compute them all and let
+   gimp_gegl_distance_border() find the nearest ones, in time independent
+   of the radius.  Only used for regions taller than the radius, for which
+   the row-by-row code above sees all of the transitions. */
+static void
+gimp_operation_border_process_distance (GimpOperationBorder *self,
+                                        GeglBuffer          *input,
+                                        GeglBuffer          *output,
+                                        const GeglRectangle *roi)
+{
+  const Babl *format   = babl_format ("Y float");
+  gsize       n_pixels = (gsize) roi->width * roi->height;
+  gfloat     *src;
+  gfloat     *data;
+  gfloat     *edge;
+  gfloat     *buf[3];
+  gsize       i;
+  gint        y;
+
+  src  = g_new (gfloat, n_pixels);
+  data = g_new (gfloat, n_pixels);
+  edge = g_new (gfloat, roi->width);
+
+  gegl_buffer_get (input, roi, 1.0, format, src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /* Like above, the rows above and below the region are selected with
+     `self->edge_lock', and unselected otherwise. */
+  for (i = 0; i < roi->width; i++)
+    edge[i] = self->edge_lock ? 1.0 : 0.0;
+
+  for (y = 0; y < roi->height; y++)
+    {
+      buf[0] = y > 0 ? src + (gsize) (y - 1) * roi->width : edge;
+      buf[1] = src + (gsize) y * roi->width;
+      buf[2] = y + 1 < roi->height ? src + (gsize) (y + 1) * roi->width : edge;
+
+      compute_transition (data + (gsize) y * roi->width, buf, roi->width,
+                          self->edge_lock);
+    }
+
+  /* With `self->edge_lock', the code above takes the transitions of the
+     last row from the row before it. */
+  if (self->edge_lock)
+    memcpy (data + (gsize) (roi->height - 1) * roi->width,
+            data + (gsize) (roi->height - 2) * roi->width,
+            roi->width * sizeof (gfloat));
+
+  g_free (src);
+  g_free (edge);
+
+  gimp_gegl_distance_border (data, roi->width, roi->height,
+                             self->radius_x, self->radius_y, self->feather);
+
+  gegl_buffer_set (output, roi, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+}
@@ -19,6 +19,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -26,12 +28,27 @@
 
 #include "operations-types.h"
 
+#include "core/gimp-parallel.h"
+
 #include "gimpoperationcagecoefcalc.h"
 #include "gimpcageconfig.h"
 
 #include "gimp-intl.h"
 
 
+#define MIN_PARALLEL_SUB_SIZE 8
+
+
+typedef struct
+{
+  GimpCageConfig      *config;
+  GeglBuffer          *output;
+  const GeglRectangle *roi;
+  const Babl          *format;
+  gint                 n_cage_vertices;
+} CoefCalcData;
+
+
 static void           gimp_operation_cage_coef_calc_finalize         (GObject              *object);
 static void           gimp_operation_cage_coef_calc_get_property     (GObject              *object,
                                                                       guint                 property_id,
@@ -189,106 +206,146 @@ gimp_operation_cage_coef_calc_get_bounding_box (GeglOperation *operation)
   return gimp_cage_config_get_bounding_box (config);
 }
 
-static gboolean
-gimp_operation_cage_coef_calc_process (GeglOperation       *operation,
-                                       GeglBuffer          *output,
-                                       const GeglRectangle *roi,
-                                       gint                 level)
+static void
+gimp_operation_cage_coef_calc_pixel (GimpCageConfig *config,
+                                     gint            n_cage_vertices,
+                                     gint            x,
+                                     gint            y,
+                                     gfloat         *coef)
 {
-  GimpOperationCageCoefCalc *occc   = GIMP_OPERATION_CAGE_COEF_CALC (operation);
-  GimpCageConfig            *config = GIMP_CAGE_CONFIG (occc->config);
+  GimpCagePoint *current, *last;
+  gint           j;
 
-  const Babl *format;
+  memset (coef, 0, 2 * n_cage_vertices * sizeof (gfloat));
 
-  GeglBufferIterator *it;
-  guint               n_cage_vertices;
-  GimpCagePoint      *current, *last;
+  last = &(g_array_index (config->cage_points, GimpCagePoint, 0));
 
-  if (! config)
-    return FALSE;
+  for( j = 0; j < n_cage_vertices; j++)
+    {
+      GimpVector2 v1,v2,a,b,p;
+      gdouble BA,SRT,L0,L1,A0,A1,A10,L10, Q,S,R, absa;
+
+      current = &(g_array_index (config->cage_points, GimpCagePoint, (j+1) % n_cage_vertices));
+      v1 = last->src_point;
+      v2 = current->src_point;
+      p.x = x;
+      p.y = y;
+      a.x = v2.x - v1.x;
+      a.y = v2.y - v1.y;
+      absa = gimp_vector2_length (&a);
+
+      b.x = v1.x - x;
+      b.y = v1.y - y;
+      Q = a.x * a.x + a.y * a.y;
+      S = b.x * b.x + b.y * b.y;
+      R = 2.0 * (a.x * b.x + a.y * b.y);
+      BA = b.x * a.y - b.y * a.x;
+      SRT = sqrt(4.0 * S * Q - R * R);
+
+      L0 = log(S);
+      L1 = log(S + Q + R);
+      A0 = atan2(R, SRT) / SRT;
+      A1 = atan2(2.0 * Q + R, SRT) / SRT;
+      A10 = A1 - A0;
+      L10 = L1 - L0;
+
+      /* edge coef */
+      coef[j + n_cage_vertices] = (-absa / (4.0 * G_PI)) * ((4.0*S-(R*R)/Q) * A10 + (R / (2.0 * Q)) * L10 + L1 - 2.0);
+
+      if (isnan(coef[j + n_cage_vertices]))
+        {
+          coef[j + n_cage_vertices] = 0.0;
+        }
+
+      /* vertice coef */
+      if (!gimp_operation_cage_coef_calc_is_on_straight (&v1, &v2, &p))
+        {
+          coef[j] += (BA / (2.0 * G_PI)) * (L10 /(2.0*Q) - A10 * (2.0 + R / Q));
+          coef[(j+1)%n_cage_vertices] -= (BA / (2.0 * G_PI)) * (L10 / (2.0 * Q) - A10 * (R / Q));
+        }
 
-  format = babl_format_n (babl_type ("float"), 2 * gimp_cage_config_get_n_points (config));
+      last = current;
+    }
+}
 
-  n_cage_vertices   = gimp_cage_config_get_n_points (config);
+/*  Computes the coefficients of a range of rows of the roi.  Only the
+ *  runs of pixels inside the cage are written, so the tiles of the
+ *  output that lie entirely outside of the cage are never allocated.
+ */
+static void
+gimp_operation_cage_coef_calc_rows (gsize         offset,
+                                    gsize         size,
+                                    CoefCalcData *data)
+{
+  const GeglRectangle *roi    = data->roi;
+  gint                 stride = 2 * data->n_cage_vertices;
+  gfloat              *coef;
+  gint                 y;
 
-  it = gegl_buffer_iterator_new (output, roi, 0, format,
-                                 GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+  coef = g_new (gfloat, (gsize) stride * roi->width);
 
-  while (gegl_buffer_iterator_next (it))
+  for (y = roi->y + offset; y < roi->y + offset + size; y++)
     {
-      /* iterate inside the roi */
-      gint  n_pixels = it->length;
-      gint  x = it->roi->x; /* initial x                   */
-      gint  y = it->roi->y; /*           and y coordinates */
-      gint  j;
-
-      gfloat      *coef = it->data[0];
+      gint x = roi->x;
 
-      while(n_pixels--)
+      while (x < roi->x + roi->width)
         {
-          if (gimp_cage_config_point_inside(config, x, y))
+          gint x0;
+
+          while (x < roi->x + roi->width &&
+                 ! gimp_cage_config_point_inside (data->config, x, y))
             {
-              last = &(g_array_index (config->cage_points, GimpCagePoint, 0));
-
-              for( j = 0; j < n_cage_vertices; j++)
-                {
-                  GimpVector2 v1,v2,a,b,p;
-                  gdouble BA,SRT,L0,L1,A0,A1,A10,L10, Q,S,R, absa;
-
-                  current = &(g_array_index (config->cage_points, GimpCagePoint, (j+1) % n_cage_vertices));
-                  v1 = last->src_point;
-                  v2 = current->src_point;
-                  p.x = x;
-                  p.y = y;
-                  a.x = v2.x - v1.x;
-                  a.y = v2.y - v1.y;
-                  absa = gimp_vector2_length (&a);
-
-                  b.x = v1.x - x;
-                  b.y = v1.y - y;
-                  Q = a.x * a.x + a.y * a.y;
-                  S = b.x * b.x + b.y * b.y;
-                  R = 2.0 * (a.x * b.x + a.y * b.y);
-                  BA = b.x * a.y - b.y * a.x;
-                  SRT = sqrt(4.0 * S * Q - R * R);
-
-                  L0 = log(S);
-                  L1 = log(S + Q + R);
-                  A0 = atan2(R, SRT) / SRT;
-                  A1 = atan2(2.0 * Q + R, SRT) / SRT;
-                  A10 = A1 - A0;
-                  L10 = L1 - L0;
-
-                  /* edge coef */
-                  coef[j + n_cage_vertices] = (-absa / (4.0 * G_PI)) * ((4.0*S-(R*R)/Q) * A10 + (R / (2.0 * Q)) * L10 + L1 - 2.0);
-
-                  if (isnan(coef[j + n_cage_vertices]))
-                    {
-                      coef[j + n_cage_vertices] = 0.0;
-                    }
-
-                  /* vertice coef */
-                  if (!gimp_operation_cage_coef_calc_is_on_straight (&v1, &v2, &p))
-                    {
-                      coef[j] += (BA / (2.0 * G_PI)) * (L10 /(2.0*Q) - A10 * (2.0 + R / Q));
-                      coef[(j+1)%n_cage_vertices] -= (BA / (2.0 * G_PI)) * (L10 / (2.0 * Q) - A10 * (R / Q));
-                    }
-
-                  last = current;
-                }
+              x++;
             }
 
-          coef += 2 * n_cage_vertices;
+          x0 = x;
 
-          /* update x and y coordinates */
-          x++;
-          if (x >= (it->roi->x + it->roi->width))
+          while (x < roi->x + roi->width &&
+                 gimp_cage_config_point_inside (data->config, x, y))
             {
-              x = it->roi->x;
-              y++;
+              gimp_operation_cage_coef_calc_pixel (data->config,
+                                                   data->n_cage_vertices,
+                                                   x, y,
+                                                   coef + (x - x0) * stride);
+              x++;
+            }
+
+          if (x > x0)
+            {
+              gegl_buffer_set (data->output,
+                               GEGL_RECTANGLE (x0, y, x - x0, 1), 0,
+                               data->format, coef, GEGL_AUTO_ROWSTRIDE);
             }
         }
     }
 
+  g_free (coef);
+}
+
+static gboolean
+gimp_operation_cage_coef_calc_process (GeglOperation       *operation,
+                                       GeglBuffer          *output,
+                                       const GeglRectangle *roi,
+                                       gint                 level)
+{
+  GimpOperationCageCoefCalc *occc   = GIMP_OPERATION_CAGE_COEF_CALC (operation);
+  GimpCageConfig            *config = GIMP_CAGE_CONFIG (occc->config);
+  CoefCalcData               data;
+
+  if (! config)
+    return FALSE;
+
+  data.config          = config;
+  data.output          = output;
+  data.roi             = roi;
+  data.n_cage_vertices = gimp_cage_config_get_n_points (config);
+  data.format          = babl_format_n (babl_type ("float"),
+                                        2 * data.n_cage_vertices);
+
+  gimp_parallel_distribute_range (roi->height, MIN_PARALLEL_SUB_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                    gimp_operation_cage_coef_calc_rows,
+                                  &data);
+
   return TRUE;
 }
@@ -35,6 +35,10 @@
 #include "gimp-intl.h"
 
 
+/*  the pixels are converted to HSL in chunks of this size  */
+#define CHUNK_SIZE 256
+
+
 static gboolean gimp_operation_hue_saturation_process (GeglOperation       *operation,
                                                        void                *in_buf,
                                                        void                *out_buf,
@@ -181,97 +185,105 @@ gimp_operation_hue_saturation_process (GeglOperation       *operation,
 
   overlap = config->overlap / 2.0;
 
-  while (samples--)
+  while (samples > 0)
     {
-      GimpRGB  rgb;
-      GimpHSL  hsl;
-      gdouble  h;
-      gint     hue_counter;
-      gint     hue                 = 0;
-      gint     secondary_hue       = 0;
-      gboolean use_secondary_hue   = FALSE;
-      gfloat   primary_intensity   = 0.0;
-      gfloat   secondary_intensity = 0.0;
-
-      rgb.r = src[RED];
-      rgb.g = src[GREEN];
-      rgb.b = src[BLUE];
-      rgb.a = src[ALPHA];
-
-      gimp_rgb_to_hsl (&rgb, &hsl);
-
-      h = hsl.h * 6.0;
-
-      for (hue_counter = 0; hue_counter < 7; hue_counter++)
-        {
-          gdouble hue_threshold = (gdouble) hue_counter + 0.5;
+      gint n = MIN (samples, CHUNK_SIZE);
+      gint i;
+
+      /*  convert a chunk to HSL into dest, map it there, and convert
+       *  it back to RGB in place
+       */
+      gimp_rgb_to_hsl_array (src, dest, n);
 
-          if (h < ((gdouble) hue_threshold + overlap))
+      for (i = 0; i < n; i++)
+        {
+          GimpHSL  hsl;
+          gfloat  *hsla                = dest + 4 * i;
+          gdouble  h;
+          gint     hue_counter;
+          gint     hue                 = 0;
+          gint     secondary_hue       = 0;
+          gboolean use_secondary_hue   = FALSE;
+          gfloat   primary_intensity   = 0.0;
+          gfloat   secondary_intensity = 0.0;
+
+          hsl.h = hsla[0];
+          hsl.s = hsla[1];
+          hsl.l = hsla[2];
+
+          h = hsl.h * 6.0;
+
+          for (hue_counter = 0; hue_counter < 7; hue_counter++)
             {
-              hue = hue_counter;
+              gdouble hue_threshold = (gdouble) hue_counter + 0.5;
 
-              if (overlap > 0.0 && h > ((gdouble) hue_threshold - overlap))
+              if (h < ((gdouble) hue_threshold + overlap))
                 {
-                  use_secondary_hue = TRUE;
+                  hue = hue_counter;
 
-                  secondary_hue = hue_counter + 1;
+                  if (overlap > 0.0 && h > ((gdouble) hue_threshold - overlap))
+                    {
+                      use_secondary_hue = TRUE;
 
-                  secondary_intensity =
-                    (h - (gdouble) hue_threshold + overlap) / (2.0 * overlap);
+                      secondary_hue = hue_counter + 1;
 
-                  primary_intensity = 1.0 - secondary_intensity;
-                }
-              else
-                {
-                  use_secondary_hue = FALSE;
+                      secondary_intensity =
+                        (h - (gdouble) hue_threshold + overlap) / (2.0 * overlap);
+
+                      primary_intensity = 1.0 - secondary_intensity;
+                    }
+                  else
+                    {
+                      use_secondary_hue = FALSE;
+                    }
+
+                  break;
                 }
+            }
 
-              break;
+          if (hue >= 6)
+            {
+              hue = 0;
+              use_secondary_hue = FALSE;
             }
-        }
 
-      if (hue >= 6)
-        {
-          hue = 0;
-          use_secondary_hue = FALSE;
-        }
+          if (secondary_hue >= 6)
+            {
+              secondary_hue = 0;
+            }
 
-      if (secondary_hue >= 6)
-        {
-          secondary_hue = 0;
-        }
+          /*  transform into GimpHueRange values  */
+          hue++;
+          secondary_hue++;
 
-      /*  transform into GimpHueRange values  */
-      hue++;
-      secondary_hue++;
+          if (use_secondary_hue)
+            {
+              hsl.h = map_hue_overlap (config, hue, secondary_hue, hsl.h,
+                                       primary_intensity, secondary_intensity);
 
-      if (use_secondary_hue)
-        {
-          hsl.h = map_hue_overlap (config, hue, secondary_hue, hsl.h,
-                                   primary_intensity, secondary_intensity);
+              hsl.s = (map_saturation (config, hue,           hsl.s) * primary_intensity +
+                       map_saturation (config, secondary_hue, hsl.s) * secondary_intensity);
 
-          hsl.s = (map_saturation (config, hue,           hsl.s) * primary_intensity +
-                   map_saturation (config, secondary_hue, hsl.s) * secondary_intensity);
+              hsl.l = (map_lightness (config, hue,           hsl.l) * primary_intensity +
+                       map_lightness (config, secondary_hue, hsl.l) * secondary_intensity);
+            }
+          else
+            {
+              hsl.h = map_hue        (config, hue, hsl.h);
+              hsl.s = map_saturation (config, hue, hsl.s);
+              hsl.l = map_lightness  (config, hue, hsl.l);
+            }
 
-          hsl.l = (map_lightness (config, hue,           hsl.l) * primary_intensity +
-                   map_lightness (config, secondary_hue, hsl.l) * secondary_intensity);
+          hsla[0] = hsl.h;
+          hsla[1] = hsl.s;
+          hsla[2] = hsl.l;
         }
-      else
-        {
-          hsl.h = map_hue        (config, hue, hsl.h);
-          hsl.s = map_saturation (config, hue, hsl.s);
-          hsl.l = map_lightness  (config, hue, hsl.l);
-        }
-
-      gimp_hsl_to_rgb (&hsl, &rgb);
 
-      dest[RED]   = rgb.r;
-      dest[GREEN] = rgb.g;
-      dest[BLUE]  = rgb.b;
-      dest[ALPHA] = rgb.a;
+      gimp_hsl_to_rgb_array (dest, dest, n);
 
-      src  += 4;
-      dest += 4;
+      src     += 4 * n;
+      dest    += 4 * n;
+      samples -= n;
     }
 
   return TRUE;
@@ -27,8 +27,20 @@
 #include "gimpoperationpointfilter.h"
 
 
-static void   gimp_operation_point_filter_finalize (GObject       *object);
-static void   gimp_operation_point_filter_prepare  (GeglOperation *operation);
+static void       gimp_operation_point_filter_finalize       (GObject                  *object);
+static void       gimp_operation_point_filter_notify         (GObject                  *object,
+                                                              GParamSpec               *pspec);
+
+static void       gimp_operation_point_filter_prepare        (GeglOperation            *operation);
+static gboolean   gimp_operation_point_filter_process        (GeglOperation            *operation,
+                                                              GeglOperationContext     *context,
+                                                              const gchar              *output_prop,
+                                                              const GeglRectangle      *result,
+                                                              gint                      level);
+
+static void       gimp_operation_point_filter_invalidate_lut (GimpOperationPointFilter *self);
+static GBytes   * gimp_operation_point_filter_get_lut        (GimpOperationPointFilter *self,
+                                                              const Babl               *format);
 
 
 G_DEFINE_ABSTRACT_TYPE (GimpOperationPointFilter, gimp_operation_point_filter,
@@ -43,14 +55,17 @@ gimp_operation_point_filter_class_init (GimpOperationPointFilterClass *klass)
   GObjectClass        *object_class = G_OBJECT_CLASS (klass);
   GeglOperationClass  *operation_class = GEGL_OPERATION_CLASS (klass);
 
-  object_class->finalize = gimp_operation_point_filter_finalize;
+  object_class->finalize   = gimp_operation_point_filter_finalize;
+  object_class->notify     = gimp_operation_point_filter_notify;
 
   operation_class->prepare = gimp_operation_point_filter_prepare;
+  operation_class->process = gimp_operation_point_filter_process;
 }
 
 static void
 gimp_operation_point_filter_init (GimpOperationPointFilter *self)
 {
+  g_mutex_init (&self->lut_mutex);
 }
 
 static void
@@ -58,11 +73,35 @@ gimp_operation_point_filter_finalize (GObject *object)
 {
   GimpOperationPointFilter *self = GIMP_OPERATION_POINT_FILTER (object);
 
-  g_clear_object (&self->config);
+  if (self->config)
+    {
+      g_signal_handlers_disconnect_by_func (self->config,
+                                            gimp_operation_point_filter_invalidate_lut,
+                                            self);
+
+      g_clear_object (&self->config);
+    }
+
+  g_clear_pointer (&self->lut, g_bytes_unref);
+
+  g_mutex_clear (&self->lut_mutex);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gimp_operation_point_filter_notify (GObject    *object,
+                                    GParamSpec *pspec)
+{
+  GimpOperationPointFilter *self = GIMP_OPERATION_POINT_FILTER (object);
+
+  /*  any of the subclass' properties may affect the result  */
+  gimp_operation_point_filter_invalidate_lut (self);
+
+  if (G_OBJECT_CLASS (parent_class)->notify)
+    G_OBJECT_CLASS (parent_class)->notify (object, pspec);
+}
+
 void
 gimp_operation_point_filter_get_property (GObject    *object,
                                           guint       property_id,
@@ -103,8 +142,22 @@ gimp_operation_point_filter_set_property (GObject      *object,
 
     case GIMP_OPERATION_POINT_FILTER_PROP_CONFIG:
       if (self->config)
-        g_object_unref (self->config);
+        {
+          g_signal_handlers_disconnect_by_func (self->config,
+                                                gimp_operation_point_filter_invalidate_lut,
+                                                self);
+
+          g_object_unref (self->config);
+        }
+
       self->config = g_value_dup_object (value);
+
+      if (self->config)
+        {
+          g_signal_connect_swapped (self->config, "notify",
+                                    G_CALLBACK (gimp_operation_point_filter_invalidate_lut),
+                                    self);
+        }
       break;
 
    default:
@@ -116,14 +169,243 @@ gimp_operation_point_filter_set_property (GObject      *object,
 static void
 gimp_operation_point_filter_prepare (GeglOperation *operation)
 {
-  GimpOperationPointFilter *self = GIMP_OPERATION_POINT_FILTER (operation);
-  const Babl               *format;
+  GimpOperationPointFilter      *self  = GIMP_OPERATION_POINT_FILTER (operation);
+  GimpOperationPointFilterClass *klass = GIMP_OPERATION_POINT_FILTER_GET_CLASS (self);
+  const Babl                    *source_format;
+  const Babl                    *format;
 
   if (self->linear)
     format = babl_format ("RGBA float");
   else
     format = babl_format ("R'G'B'A float");
 
+  self->lut_format = NULL;
+
+  /*  for 8- and 16-bit input, map the integer components through a
+   *  lookup table, built from the float implementation, instead of
+   *  converting to float and back.
+   */
+  source_format = gegl_operation_get_source_format (operation, "input");
+
+  if (klass->separable && source_format)
+    {
+      const Babl *model = babl_format_get_model (source_format);
+      const Babl *type  = babl_format_get_type (source_format, 0);
+      gboolean    match;
+
+      if (self->linear)
+        {
+          match = (model == babl_model ("RGB")  ||
+                   model == babl_model ("RGBA") ||
+                   model == babl_model ("Y")    ||
+                   model == babl_model ("YA"));
+        }
+      else
+        {
+          match = (model == babl_model ("R'G'B'")  ||
+                   model == babl_model ("R'G'B'A") ||
+                   model == babl_model ("Y'")      ||
+                   model == babl_model ("Y'A"));
+        }
+
+      if (match && (type == babl_type ("u8") || type == babl_type ("u16")))
+        {
+          const Babl *lut_format;
+          GBytes     *lut;
+
+          if (type == babl_type ("u8"))
+            lut_format = babl_format (self->linear ? "RGBA u8" : "R'G'B'A u8");
+          else
+            lut_format = babl_format (self->linear ? "RGBA u16" : "R'G'B'A u16");
+
+          lut = gimp_operation_point_filter_get_lut (self, lut_format);
+
+          if (lut)
+            {
+              g_bytes_unref (lut);
+
+              self->lut_format = lut_format;
+              format           = lut_format;
+            }
+        }
+    }
+
   gegl_operation_set_format (operation, "input",  format);
   gegl_operation_set_format (operation, "output", format);
 }
+
+static gboolean
+gimp_operation_point_filter_process (GeglOperation        *operation,
+                                     GeglOperationContext *context,
+                                     const gchar          *output_prop,
+                                     const GeglRectangle  *result,
+                                     gint                  level)
+{
+  GimpOperationPointFilter *self = GIMP_OPERATION_POINT_FILTER (operation);
+  GeglBuffer               *input;
+  GeglBuffer               *output;
+  GeglBufferIterator       *iter;
+  GBytes                   *lut;
+
+  if (! self->lut_format)
+    {
+      return GEGL_OPERATION_CLASS (parent_class)->process (operation, context,
+                                                          output_prop, result,
+                                                          level);
+    }
+
+  input = gegl_operation_context_get_source (context, "input");
+
+  if (! input)
+    return FALSE;
+
+  lut = gimp_operation_point_filter_get_lut (self, self->lut_format);
+
+  if (! lut)
+    {
+      g_object_unref (input);
+
+      return FALSE;
+    }
+
+  output = gegl_operation_context_get_target (context, "output");
+
+  iter = gegl_buffer_iterator_new (output, result, level, self->lut_format,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, input, result, level, self->lut_format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  if (babl_format_get_bytes_per_pixel (self->lut_format) == 4)
+    {
+      const guint8 *table = g_bytes_get_data (lut, NULL);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guint8       *dest = iter->data[0];
+          const guint8 *src  = iter->data[1];
+          gint          n    = iter->length;
+
+          while (n--)
+            {
+              dest[0] = table[0 * 256 + src[0]];
+              dest[1] = table[1 * 256 + src[1]];
+              dest[2] = table[2 * 256 + src[2]];
+              dest[3] = table[3 * 256 + src[3]];
+
+              src  += 4;
+              dest += 4;
+            }
+        }
+    }
+  else
+    {
+      const guint16 *table = g_bytes_get_data (lut, NULL);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guint16       *dest = iter->data[0];
+          const guint16 *src  = iter->data[1];
+          gint           n    = iter->length;
+
+          while (n--)
+            {
+              dest[0] = table[0 * 65536 + src[0]];
+              dest[1] = table[1 * 65536 + src[1]];
+              dest[2] = table[2 * 65536 + src[2]];
+              dest[3] = table[3 * 65536 + src[3]];
+
+              src  += 4;
+              dest += 4;
+            }
+        }
+    }
+
+  g_bytes_unref (lut);
+  g_object_unref (input);
+
+  return TRUE;
+}
+
+static void
+gimp_operation_point_filter_invalidate_lut (GimpOperationPointFilter *self)
+{
+  g_mutex_lock (&self->lut_mutex);
+
+  g_clear_pointer (&self->lut, g_bytes_unref);
+
+  g_mutex_unlock (&self->lut_mutex);
+}
+
+/*  returns a new reference to the lookup table for 'format', building
+ *  it if necessary, by running the filter's float implementation over
+ *  all the component values.  the table holds, for each of the four
+ *  components, the output value of each input value.
+ */
+static GBytes *
+gimp_operation_point_filter_get_lut (GimpOperationPointFilter *self,
+                                     const Babl               *format)
+{
+  GBytes *lut = NULL;
+  gint    bpc;
+  gint    n_values;
+
+  bpc      = babl_format_get_bytes_per_pixel (format) / 4;
+  n_values = 1 << (8 * bpc);
+
+  g_mutex_lock (&self->lut_mutex);
+
+  if (self->lut && g_bytes_get_size (self->lut) != 4 * n_values * bpc)
+    g_clear_pointer (&self->lut, g_bytes_unref);
+
+  if (! self->lut)
+    {
+      GeglOperationPointFilterClass *point_class;
+      gfloat                        *values;
+      gint                           i;
+
+      point_class = GEGL_OPERATION_POINT_FILTER_GET_CLASS (self);
+
+      values = g_new (gfloat, 4 * n_values);
+
+      for (i = 0; i < n_values; i++)
+        {
+          values[4 * i + 0] =
+          values[4 * i + 1] =
+          values[4 * i + 2] =
+          values[4 * i + 3] = (gfloat) i / (n_values - 1);
+        }
+
+      if (point_class->process (GEGL_OPERATION (self),
+                                values, values, n_values,
+                                GEGL_RECTANGLE (0, 0, n_values, 1), 0))
+        {
+          gpointer table = g_malloc (4 * n_values * bpc);
+          gint     c;
+
+          for (c = 0; c < 4; c++)
+            {
+              for (i = 0; i < n_values; i++)
+                {
+                  gfloat value = CLAMP (values[4 * i + c], 0.0f, 1.0f);
+
+                  if (bpc == 1)
+                    ((guint8 *) table)[c * n_values + i] = value * 255.0f + 0.5f;
+                  else
+                    ((guint16 *) table)[c * n_values + i] = value * 65535.0f + 0.5f;
+                }
+            }
+
+          self->lut = g_bytes_new_take (table, 4 * n_values * bpc);
+        }
+
+      g_free (values);
+    }
+
+  if (self->lut)
+    lut = g_bytes_ref (self->lut);
+
+  g_mutex_unlock (&self->lut_mutex);
+
+  return lut;
+}
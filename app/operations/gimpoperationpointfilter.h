@@ -50,11 +50,21 @@ struct _GimpOperationPointFilter
 
   gboolean                  linear;
   GObject                  *config;
+
+  const Babl               *lut_format;
+  GBytes                   *lut;
+  GMutex                    lut_mutex;
 };
 
 struct _GimpOperationPointFilterClass
 {
   GeglOperationPointFilterClass  parent_class;
+
+  /*  whether each output component depends only on the same input
+   *  component, so that the filter can be applied to integer formats
+   *  through a per-component lookup table.
+   */
+  gboolean                       separable;
 };
 
 
@@ -76,6 +76,8 @@ gimp_operation_posterize_class_init (GimpOperationPosterizeClass *klass)
 
   point_class->process       = gimp_operation_posterize_process;
 
+  GIMP_OPERATION_POINT_FILTER_CLASS (klass)->separable = TRUE;
+
   gegl_operation_class_set_keys (operation_class,
                                  "name",        "gimp:posterize",
                                  "categories",  "color",
@@ -32,6 +32,10 @@
 #include "gimpoperationhslcolorlegacy.h"
 
 
+/*  the pixels are converted to HSL in chunks of this size  */
+#define CHUNK_SIZE 256
+
+
 static gboolean   gimp_operation_hsl_color_legacy_process (GeglOperation       *op,
                                                            void                *in,
                                                            void                *layer,
@@ -82,59 +86,63 @@ gimp_operation_hsl_color_legacy_process (GeglOperation       *op,
   gfloat                 *mask       = mask_p;
   gfloat                  opacity    = layer_mode->opacity;
 
-  while (samples--)
+  while (samples > 0)
     {
-      GimpHSL layer_hsl, out_hsl;
-      GimpRGB layer_rgb = {layer[0], layer[1], layer[2]};
-      GimpRGB out_rgb   = {in[0], in[1], in[2]};
-      gfloat  comp_alpha, new_alpha;
+      gfloat layer_hsl[4 * CHUNK_SIZE];
+      gfloat out_hsl[4 * CHUNK_SIZE];
+      gint   n = MIN (samples, CHUNK_SIZE);
+      gint   i;
 
-      comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
-      if (mask)
-        comp_alpha *= *mask;
+      gimp_rgb_to_hsl_array (layer, layer_hsl, n);
+      gimp_rgb_to_hsl_array (in, out_hsl, n);
 
-      new_alpha = in[ALPHA] + (1.0f - in[ALPHA]) * comp_alpha;
+      for (i = 0; i < n; i++)
+        {
+          out_hsl[4 * i + 0] = layer_hsl[4 * i + 0];
+          out_hsl[4 * i + 1] = layer_hsl[4 * i + 1];
+        }
 
-      if (comp_alpha && new_alpha)
+      gimp_hsl_to_rgb_array (out_hsl, out_hsl, n);
+
+      for (i = 0; i < n; i++)
         {
+          gfloat comp_alpha, new_alpha;
           gint   b;
-          gfloat out_tmp[3];
-          gfloat ratio = comp_alpha / new_alpha;
-
-          gimp_rgb_to_hsl (&layer_rgb, &layer_hsl);
-          gimp_rgb_to_hsl (&out_rgb, &out_hsl);
 
-          out_hsl.h = layer_hsl.h;
-          out_hsl.s = layer_hsl.s;
-          gimp_hsl_to_rgb (&out_hsl, &out_rgb);
+          comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
+          if (mask)
+            comp_alpha *= *mask;
 
-          out_tmp[0] = out_rgb.r;
-          out_tmp[1] = out_rgb.g;
-          out_tmp[2] = out_rgb.b;
+          new_alpha = in[ALPHA] + (1.0f - in[ALPHA]) * comp_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+          if (comp_alpha && new_alpha)
             {
-              out[b] = out_tmp[b] * ratio + in[b] * (1.0f - ratio);
-            }
-        }
-      else
-        {
-          gint b;
+              gfloat ratio = comp_alpha / new_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = out_hsl[4 * i + b] * ratio + in[b] * (1.0f - ratio);
+                }
+            }
+          else
             {
-              out[b] = in[b];
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = in[b];
+                }
             }
-        }
 
-      out[ALPHA] = in[ALPHA];
+          out[ALPHA] = in[ALPHA];
+
+          in    += 4;
+          layer += 4;
+          out   += 4;
 
-      in    += 4;
-      layer += 4;
-      out   += 4;
+          if (mask)
+            mask++;
+        }
 
-      if (mask)
-        mask++;
+      samples -= n;
     }
 
   return TRUE;
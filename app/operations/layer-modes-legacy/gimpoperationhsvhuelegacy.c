@@ -32,6 +32,10 @@
 #include "gimpoperationhsvhuelegacy.h"
 
 
+/*  the pixels are converted to HSV in chunks of this size  */
+#define CHUNK_SIZE 256
+
+
 static gboolean   gimp_operation_hsv_hue_legacy_process (GeglOperation       *op,
                                                          void                *in,
                                                          void                *layer,
@@ -82,64 +86,66 @@ gimp_operation_hsv_hue_legacy_process (GeglOperation       *op,
   gfloat                 *mask       = mask_p;
   gfloat                  opacity    = layer_mode->opacity;
 
-  while (samples--)
+  while (samples > 0)
     {
-      GimpHSV layer_hsv, out_hsv;
-      GimpRGB layer_rgb = {layer[0], layer[1], layer[2]};
-      GimpRGB out_rgb   = {in[0], in[1], in[2]};
-      gfloat  comp_alpha, new_alpha;
-
-      comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
-      if (mask)
-        comp_alpha *= *mask;
+      gfloat layer_hsv[4 * CHUNK_SIZE];
+      gfloat out_hsv[4 * CHUNK_SIZE];
+      gint   n = MIN (samples, CHUNK_SIZE);
+      gint   i;
 
-      new_alpha = in[ALPHA] + (1.0f - in[ALPHA]) * comp_alpha;
+      gimp_rgb_to_hsv_array (layer, layer_hsv, n);
+      gimp_rgb_to_hsv_array (in, out_hsv, n);
 
-      if (comp_alpha && new_alpha)
+      for (i = 0; i < n; i++)
         {
-          gint   b;
-          gfloat out_tmp[3];
-          gfloat ratio = comp_alpha / new_alpha;
-
-          gimp_rgb_to_hsv (&layer_rgb, &layer_hsv);
-          gimp_rgb_to_hsv (&out_rgb, &out_hsv);
-
           /*  Composition should have no effect if saturation is zero.
            *  otherwise, black would be painted red (see bug #123296).
            */
-          if (layer_hsv.s)
-            {
-              out_hsv.h = layer_hsv.h;
-            }
-          gimp_hsv_to_rgb (&out_hsv, &out_rgb);
+          if (layer_hsv[4 * i + 1])
+            out_hsv[4 * i + 0] = layer_hsv[4 * i + 0];
+        }
 
-          out_tmp[0] = out_rgb.r;
-          out_tmp[1] = out_rgb.g;
-          out_tmp[2] = out_rgb.b;
+      gimp_hsv_to_rgb_array (out_hsv, out_hsv, n);
 
-          for (b = RED; b < ALPHA; b++)
-            {
-              out[b] = out_tmp[b] * ratio + in[b] * (1.0f - ratio);
-            }
-        }
-      else
+      for (i = 0; i < n; i++)
         {
-          gint b;
+          gfloat comp_alpha, new_alpha;
+          gint   b;
+
+          comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
+          if (mask)
+            comp_alpha *= *mask;
+
+          new_alpha = in[ALPHA] + (1.0f - in[ALPHA]) * comp_alpha;
+
+          if (comp_alpha && new_alpha)
+            {
+              gfloat ratio = comp_alpha / new_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = out_hsv[4 * i + b] * ratio + in[b] * (1.0f - ratio);
+                }
+            }
+          else
             {
-              out[b] = in[b];
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = in[b];
+                }
             }
-        }
 
-      out[ALPHA] = in[ALPHA];
+          out[ALPHA] = in[ALPHA];
 
-      in    += 4;
-      layer += 4;
-      out   += 4;
+          in    += 4;
+          layer += 4;
+          out   += 4;
+
+          if (mask)
+            mask++;
+        }
 
-      if (mask)
-        mask++;
+      samples -= n;
     }
 
   return TRUE;
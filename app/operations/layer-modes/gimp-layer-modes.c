@@ -24,6 +24,8 @@
 #include <glib-object.h>
 #include <gegl.h>
 
+#include "libgimpbase/gimpbase.h"
+
 #include "../operations-types.h"
 
 #include "gegl/gimp-babl.h"
@@ -1101,6 +1103,51 @@ static const GimpLayerMode layer_mode_groups[][2] =
 };
 
 
+#if COMPILE_AVX2_INTRINISICS
+
+static const struct
+{
+  GimpLayerModeBlendFunc generic;
+  GimpLayerModeBlendFunc avx2;
+}
+blend_functions_avx2[] =
+{
+  { gimp_operation_layer_mode_blend_addition,
+    gimp_operation_layer_mode_blend_addition_avx2      },
+  { gimp_operation_layer_mode_blend_darken_only,
+    gimp_operation_layer_mode_blend_darken_only_avx2   },
+  { gimp_operation_layer_mode_blend_difference,
+    gimp_operation_layer_mode_blend_difference_avx2    },
+  { gimp_operation_layer_mode_blend_exclusion,
+    gimp_operation_layer_mode_blend_exclusion_avx2     },
+  { gimp_operation_layer_mode_blend_grain_extract,
+    gimp_operation_layer_mode_blend_grain_extract_avx2 },
+  { gimp_operation_layer_mode_blend_grain_merge,
+    gimp_operation_layer_mode_blend_grain_merge_avx2   },
+  { gimp_operation_layer_mode_blend_lighten_only,
+    gimp_operation_layer_mode_blend_lighten_only_avx2  },
+  { gimp_operation_layer_mode_blend_linear_burn,
+    gimp_operation_layer_mode_blend_linear_burn_avx2   },
+  { gimp_operation_layer_mode_blend_multiply,
+    gimp_operation_layer_mode_blend_multiply_avx2      },
+  { gimp_operation_layer_mode_blend_overlay,
+    gimp_operation_layer_mode_blend_overlay_avx2       },
+  { gimp_operation_layer_mode_blend_screen,
+    gimp_operation_layer_mode_blend_screen_avx2        },
+  { gimp_operation_layer_mode_blend_softlight,
+    gimp_operation_layer_mode_blend_softlight_avx2     },
+  { gimp_operation_layer_mode_blend_subtract,
+    gimp_operation_layer_mode_blend_subtract_avx2      }
+};
+
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+/*  the blend functions actually used for each mode, which may be
+ *  accelerated variants of the ones in layer_mode_infos
+ */
+static GimpLayerModeBlendFunc blend_functions[G_N_ELEMENTS (layer_mode_infos)];
+
+
 /*  public functions  */
 
 void
@@ -1111,6 +1158,25 @@ gimp_layer_modes_init (void)
   for (i = 0; i < G_N_ELEMENTS (layer_mode_infos); i++)
     {
       gimp_assert ((GimpLayerMode) i == layer_mode_infos[i].layer_mode);
+
+      blend_functions[i] = layer_mode_infos[i].blend_function;
+
+#if COMPILE_AVX2_INTRINISICS
+      if (blend_functions[i] &&
+          (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2))
+        {
+          gint j;
+
+          for (j = 0; j < G_N_ELEMENTS (blend_functions_avx2); j++)
+            {
+              if (blend_functions[i] == blend_functions_avx2[j].generic)
+                {
+                  blend_functions[i] = blend_functions_avx2[j].avx2;
+                  break;
+                }
+            }
+        }
+#endif /* COMPILE_AVX2_INTRINISICS */
     }
 }
 
@@ -1271,7 +1337,7 @@ gimp_layer_mode_get_blend_function (GimpLayerMode mode)
   if (! info)
     return NULL;
 
-  return info->blend_function;
+  return blend_functions[info - layer_mode_infos];
 }
 
 GimpLayerModeContext
@@ -0,0 +1,193 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-blend.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+/*  these functions process two RGBA pixels per iteration, and fall back to
+ *  the generic functions for a trailing odd pixel.  they evaluate the
+ *  generic functions' expressions in the same order, and without fused
+ *  multiply-add, so that their results are bit-identical for all samples
+ *  whose in[ALPHA] and layer[ALPHA] are nonzero.  the color values of
+ *  the other samples are unconstrained, as for the generic functions.
+ */
+
+
+#define V_ONE  _mm256_set1_ps (1.0f)
+#define V_HALF _mm256_set1_ps (0.5f)
+#define V_TWO  _mm256_set1_ps (2.0f)
+
+
+#define DEFINE_BLEND_FUNC_AVX2(name)                                          \
+void                                                                          \
+gimp_operation_layer_mode_blend_##name##_avx2 (const gfloat *in,              \
+                                               const gfloat *layer,           \
+                                               gfloat       *comp,            \
+                                               gint          samples)         \
+{                                                                             \
+  while (samples >= 2)                                                        \
+    {                                                                         \
+      __m256 v_in    = _mm256_loadu_ps (in);                                  \
+      __m256 v_layer = _mm256_loadu_ps (layer);                               \
+      __m256 v_comp;                                                          \
+                                                                              \
+      v_comp = blend_##name (v_in, v_layer);                                  \
+                                                                              \
+      /* comp[ALPHA] = layer[ALPHA] */                                        \
+      _mm256_storeu_ps (comp, _mm256_blend_ps (v_comp, v_layer, 0x88));      \
+                                                                              \
+      in      += 8;                                                           \
+      layer   += 8;                                                           \
+      comp    += 8;                                                           \
+      samples -= 2;                                                           \
+    }                                                                         \
+                                                                              \
+  if (samples)                                                                \
+    gimp_operation_layer_mode_blend_##name (in, layer, comp, samples);        \
+}
+
+
+static inline __m256
+blend_addition (__m256 in,
+                __m256 layer)
+{
+  return in + layer;
+}
+
+static inline __m256
+blend_darken_only (__m256 in,
+                   __m256 layer)
+{
+  return _mm256_min_ps (in, layer);
+}
+
+static inline __m256
+blend_difference (__m256 in,
+                  __m256 layer)
+{
+  return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), in - layer);
+}
+
+static inline __m256
+blend_exclusion (__m256 in,
+                 __m256 layer)
+{
+  return V_HALF - V_TWO * (in - V_HALF) * (layer - V_HALF);
+}
+
+static inline __m256
+blend_grain_extract (__m256 in,
+                     __m256 layer)
+{
+  return in - layer + V_HALF;
+}
+
+static inline __m256
+blend_grain_merge (__m256 in,
+                   __m256 layer)
+{
+  return in + layer - V_HALF;
+}
+
+static inline __m256
+blend_lighten_only (__m256 in,
+                    __m256 layer)
+{
+  return _mm256_max_ps (in, layer);
+}
+
+static inline __m256
+blend_linear_burn (__m256 in,
+                   __m256 layer)
+{
+  return in + layer - V_ONE;
+}
+
+static inline __m256
+blend_multiply (__m256 in,
+                __m256 layer)
+{
+  return in * layer;
+}
+
+static inline __m256
+blend_overlay (__m256 in,
+               __m256 layer)
+{
+  __m256 low  = V_TWO * in * layer;
+  __m256 high = V_ONE - V_TWO * (V_ONE - layer) * (V_ONE - in);
+
+  return _mm256_blendv_ps (high, low,
+                           _mm256_cmp_ps (in, V_HALF, _CMP_LT_OQ));
+}
+
+static inline __m256
+blend_screen (__m256 in,
+              __m256 layer)
+{
+  return V_ONE - (V_ONE - in) * (V_ONE - layer);
+}
+
+static inline __m256
+blend_softlight (__m256 in,
+                 __m256 layer)
+{
+  __m256 multiply = in * layer;
+  __m256 screen   = V_ONE - (V_ONE - in) * (V_ONE - layer);
+
+  return (V_ONE - in) * multiply + in * screen;
+}
+
+static inline __m256
+blend_subtract (__m256 in,
+                __m256 layer)
+{
+  return in - layer;
+}
+
+
+DEFINE_BLEND_FUNC_AVX2 (addition)
+DEFINE_BLEND_FUNC_AVX2 (darken_only)
+DEFINE_BLEND_FUNC_AVX2 (difference)
+DEFINE_BLEND_FUNC_AVX2 (exclusion)
+DEFINE_BLEND_FUNC_AVX2 (grain_extract)
+DEFINE_BLEND_FUNC_AVX2 (grain_merge)
+DEFINE_BLEND_FUNC_AVX2 (lighten_only)
+DEFINE_BLEND_FUNC_AVX2 (linear_burn)
+DEFINE_BLEND_FUNC_AVX2 (multiply)
+DEFINE_BLEND_FUNC_AVX2 (overlay)
+DEFINE_BLEND_FUNC_AVX2 (screen)
+DEFINE_BLEND_FUNC_AVX2 (softlight)
+DEFINE_BLEND_FUNC_AVX2 (subtract)
+
+#endif /* COMPILE_AVX2_INTRINISICS */
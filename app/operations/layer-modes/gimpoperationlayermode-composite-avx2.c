@@ -0,0 +1,272 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-composite-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-composite.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+/*  non-subtractive compositing functions.  these functions expect comp[ALPHA]
+ *  to be the same as layer[ALPHA].  when in[ALPHA] or layer[ALPHA] are zero,
+ *  the value of comp[RED..BLUE] is unconstrained (in particular, it may be
+ *  NaN).
+ *
+ *  like the blend functions in gimpoperationlayermode-blend-avx2.c, these
+ *  process two pixels at a time, and produce results that are bit-identical
+ *  to the generic functions.
+ */
+
+
+/* broadcasts the alpha component of each of the two pixels in 'v' to all
+ * the components of the same pixel.
+ */
+static inline __m256
+alpha_avx2 (__m256 v)
+{
+  return _mm256_permute_ps (v, _MM_SHUFFLE (3, 3, 3, 3));
+}
+
+static inline __m256
+mask_avx2 (const gfloat *mask)
+{
+  return _mm256_setr_ps (mask[0], mask[0], mask[0], mask[0],
+                         mask[1], mask[1], mask[1], mask[1]);
+}
+
+static inline __m256
+is_zero_avx2 (__m256 v)
+{
+  return _mm256_cmp_ps (v, _mm256_setzero_ps (), _CMP_EQ_OQ);
+}
+
+/* returns 'rgb' with the alpha component of both pixels replaced by 'a' */
+static inline __m256
+with_alpha_avx2 (__m256 rgb,
+                 __m256 a)
+{
+  return _mm256_blend_ps (rgb, a, 0x88);
+}
+
+
+void
+gimp_operation_layer_mode_composite_union_avx2 (const gfloat *in,
+                                                const gfloat *layer,
+                                                const gfloat *comp,
+                                                const gfloat *mask,
+                                                gfloat        opacity,
+                                                gfloat       *out,
+                                                gint          samples)
+{
+  const __m256 v_one     = _mm256_set1_ps (1.0f);
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+  while (samples >= 2)
+    {
+      __m256 v_in        = _mm256_loadu_ps (in);
+      __m256 v_layer     = _mm256_loadu_ps (layer);
+      __m256 v_comp      = _mm256_loadu_ps (comp);
+      __m256 in_alpha    = alpha_avx2 (v_in);
+      __m256 layer_alpha = alpha_avx2 (v_layer) * v_opacity;
+      __m256 new_alpha;
+      __m256 ratio;
+      __m256 v_out;
+
+      if (mask)
+        {
+          layer_alpha = layer_alpha * mask_avx2 (mask);
+          mask += 2;
+        }
+
+      new_alpha = layer_alpha + (v_one - layer_alpha) * in_alpha;
+      ratio     = layer_alpha / new_alpha;
+
+      v_out = ratio * (in_alpha * (v_comp - v_layer) + v_layer - v_in) + v_in;
+      v_out = _mm256_blendv_ps (v_out, v_layer, is_zero_avx2 (in_alpha));
+      v_out = _mm256_blendv_ps (v_out, v_in,
+                                _mm256_or_ps (is_zero_avx2 (layer_alpha),
+                                              is_zero_avx2 (new_alpha)));
+
+      _mm256_storeu_ps (out, with_alpha_avx2 (v_out, new_alpha));
+
+      in      += 8;
+      layer   += 8;
+      comp    += 8;
+      out     += 8;
+      samples -= 2;
+    }
+
+  if (samples)
+    {
+      gimp_operation_layer_mode_composite_union (in, layer, comp, mask,
+                                                 opacity, out, samples);
+    }
+}
+
+void
+gimp_operation_layer_mode_composite_clip_to_backdrop_avx2 (const gfloat *in,
+                                                           const gfloat *layer,
+                                                           const gfloat *comp,
+                                                           const gfloat *mask,
+                                                           gfloat        opacity,
+                                                           gfloat       *out,
+                                                           gint          samples)
+{
+  const __m256 v_one     = _mm256_set1_ps (1.0f);
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+  while (samples >= 2)
+    {
+      __m256 v_in        = _mm256_loadu_ps (in);
+      __m256 v_comp      = _mm256_loadu_ps (comp);
+      __m256 in_alpha    = alpha_avx2 (v_in);
+      __m256 layer_alpha = alpha_avx2 (v_comp) * v_opacity;
+      __m256 v_out;
+
+      if (mask)
+        {
+          layer_alpha = layer_alpha * mask_avx2 (mask);
+          mask += 2;
+        }
+
+      v_out = v_comp * layer_alpha + v_in * (v_one - layer_alpha);
+      v_out = _mm256_blendv_ps (v_out, v_in,
+                                _mm256_or_ps (is_zero_avx2 (in_alpha),
+                                              is_zero_avx2 (layer_alpha)));
+
+      _mm256_storeu_ps (out, with_alpha_avx2 (v_out, in_alpha));
+
+      in      += 8;
+      layer   += 8;
+      comp    += 8;
+      out     += 8;
+      samples -= 2;
+    }
+
+  if (samples)
+    {
+      gimp_operation_layer_mode_composite_clip_to_backdrop (in, layer, comp,
+                                                            mask, opacity, out,
+                                                            samples);
+    }
+}
+
+void
+gimp_operation_layer_mode_composite_clip_to_layer_avx2 (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        const gfloat *comp,
+                                                        const gfloat *mask,
+                                                        gfloat        opacity,
+                                                        gfloat       *out,
+                                                        gint          samples)
+{
+  const __m256 v_one     = _mm256_set1_ps (1.0f);
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+  while (samples >= 2)
+    {
+      __m256 v_in        = _mm256_loadu_ps (in);
+      __m256 v_layer     = _mm256_loadu_ps (layer);
+      __m256 v_comp      = _mm256_loadu_ps (comp);
+      __m256 in_alpha    = alpha_avx2 (v_in);
+      __m256 layer_alpha = alpha_avx2 (v_layer) * v_opacity;
+      __m256 v_out;
+
+      if (mask)
+        {
+          layer_alpha = layer_alpha * mask_avx2 (mask);
+          mask += 2;
+        }
+
+      v_out = v_comp * in_alpha + v_layer * (v_one - in_alpha);
+      v_out = _mm256_blendv_ps (v_out, v_layer, is_zero_avx2 (in_alpha));
+      v_out = _mm256_blendv_ps (v_out, v_in,    is_zero_avx2 (layer_alpha));
+
+      _mm256_storeu_ps (out, with_alpha_avx2 (v_out, layer_alpha));
+
+      in      += 8;
+      layer   += 8;
+      comp    += 8;
+      out     += 8;
+      samples -= 2;
+    }
+
+  if (samples)
+    {
+      gimp_operation_layer_mode_composite_clip_to_layer (in, layer, comp,
+                                                         mask, opacity, out,
+                                                         samples);
+    }
+}
+
+void
+gimp_operation_layer_mode_composite_intersection_avx2 (const gfloat *in,
+                                                       const gfloat *layer,
+                                                       const gfloat *comp,
+                                                       const gfloat *mask,
+                                                       gfloat        opacity,
+                                                       gfloat       *out,
+                                                       gint          samples)
+{
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+  while (samples >= 2)
+    {
+      __m256 v_in      = _mm256_loadu_ps (in);
+      __m256 v_comp    = _mm256_loadu_ps (comp);
+      __m256 new_alpha = alpha_avx2 (v_in) * alpha_avx2 (v_comp) * v_opacity;
+      __m256 v_out;
+
+      if (mask)
+        {
+          new_alpha = new_alpha * mask_avx2 (mask);
+          mask += 2;
+        }
+
+      v_out = _mm256_blendv_ps (v_comp, v_in, is_zero_avx2 (new_alpha));
+
+      _mm256_storeu_ps (out, with_alpha_avx2 (v_out, new_alpha));
+
+      in      += 8;
+      layer   += 8;
+      comp    += 8;
+      out     += 8;
+      samples -= 2;
+    }
+
+  if (samples)
+    {
+      gimp_operation_layer_mode_composite_intersection (in, layer, comp,
+                                                        mask, opacity, out,
+                                                        samples);
+    }
+}
+
+#endif /* COMPILE_AVX2_INTRINISICS */
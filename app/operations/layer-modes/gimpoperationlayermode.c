@@ -47,6 +47,13 @@
  */
 #define GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD 32
 
+/* the number of samples to blend and composite in one go, when blending and
+ * compositing are performed in the same color space.  the intermediate
+ * blend buffer is small enough to remain in the L1 cache between the two
+ * stages.
+ */
+#define GIMP_COMPOSITE_BLEND_BLOCK_SAMPLES 256
+
 
 enum
 {
@@ -102,6 +109,15 @@ static gboolean   gimp_operation_layer_mode_real_process   (GeglOperation
                                                             const GeglRectangle    *roi,
                                                             gint                    level);
 
+static gboolean   samples_are_transparent                  (const gfloat           *layer,
+                                                            const gfloat           *mask,
+                                                            glong                   samples);
+
+static CompositeFunc
+                  gimp_operation_layer_mode_get_composite_func
+                                                           (GimpOperationLayerMode *layer_mode,
+                                                            GimpLayerCompositeMode  composite_mode);
+
 static gboolean   process_last_node                        (GeglOperation       *operation,
                                                             void                *in,
                                                             void                *layer,
@@ -223,6 +239,16 @@ gimp_operation_layer_mode_class_init (GimpOperationLayerModeClass *klass)
   if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
     composite_clip_to_backdrop = gimp_operation_layer_mode_composite_clip_to_backdrop_sse2;
 #endif
+
+#if COMPILE_AVX2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2)
+    {
+      composite_union            = gimp_operation_layer_mode_composite_union_avx2;
+      composite_clip_to_backdrop = gimp_operation_layer_mode_composite_clip_to_backdrop_avx2;
+      composite_clip_to_layer    = gimp_operation_layer_mode_composite_clip_to_layer_avx2;
+      composite_intersection     = gimp_operation_layer_mode_composite_intersection_avx2;
+    }
+#endif
 }
 
 static void
@@ -517,8 +543,19 @@ gimp_operation_layer_mode_process (GeglOperation       *operation,
                                    const GeglRectangle *roi,
                                    gint                 level)
 {
-  return ((GimpOperationLayerMode *) operation)->function (
-    operation, in, layer, mask, out, samples, roi, level);
+  GimpOperationLayerMode *layer_mode = (GimpOperationLayerMode *) operation;
+  gint64                  start_time;
+  gboolean                result;
+
+  start_time = g_get_monotonic_time ();
+
+  result = layer_mode->function (operation, in, layer, mask, out,
+                                 samples, roi, level);
+
+  g_atomic_pointer_add (&layer_mode->render_cost,
+                        g_get_monotonic_time () - start_time);
+
+  return result;
 }
 
 static gboolean
@@ -541,6 +578,7 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
   GimpLayerColorSpace     composite_space         = layer_mode->composite_space;
   GimpLayerCompositeMode  composite_mode          = layer_mode->real_composite_mode;
   GimpLayerModeBlendFunc  blend_function          = layer_mode->blend_function;
+  CompositeFunc           composite_function;
   gboolean                composite_needs_in_color;
   gfloat                 *blend_in;
   gfloat                 *blend_layer;
@@ -569,6 +607,34 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
       samples -= GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
     }
 
+  /* sparse layers (text, small decals, mostly-empty group members) are
+   * fully transparent over most of their area.  when that's the case for
+   * the entire chunk, the non-subtractive composite functions leave the
+   * backdrop color untouched, so skip blending and compositing, and the
+   * color-space conversions, altogether.
+   */
+  if (! gimp_layer_mode_is_subtractive (layer_mode->layer_mode) &&
+      samples_are_transparent (layer, mask, samples))
+    {
+      if (in != out)
+        memcpy (out, in, 4 * sizeof (gfloat) * samples);
+
+      /* the layer region doesn't include the backdrop */
+      if (composite_mode == GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER ||
+          composite_mode == GIMP_LAYER_COMPOSITE_INTERSECTION)
+        {
+          glong i;
+
+          for (i = 0; i < samples; i++)
+            out[4 * i + ALPHA] = 0.0f;
+        }
+
+      return TRUE;
+    }
+
+  composite_function =
+    gimp_operation_layer_mode_get_composite_func (layer_mode, composite_mode);
+
   composite_needs_in_color =
     composite_mode == GIMP_LAYER_COMPOSITE_UNION ||
     composite_mode == GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP;
@@ -693,71 +759,35 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
   else
     {
       /* if both blending and compositing use the same color space, things are
-       * much simpler.
+       * much simpler.  blend and composite the samples in small blocks, so
+       * that the intermediate blend result stays in the cache, instead of
+       * making a round trip through memory for the entire chunk.
        */
+      gfloat blend_block[4 * GIMP_COMPOSITE_BLEND_BLOCK_SAMPLES];
 
-      if (in == out) /* in-place detected, avoid clobbering since we need to
-                        read 'in' for the compositing stage  */
+      while (samples > 0)
         {
-          blend_out = g_alloca (sizeof (gfloat) * 4 * samples);
-        }
+          gint count = MIN (samples, GIMP_COMPOSITE_BLEND_BLOCK_SAMPLES);
 
-      blend_function (blend_in, blend_layer, blend_out, samples);
-    }
+          blend_function (in, layer, blend_block, count);
 
-  if (! gimp_layer_mode_is_subtractive (layer_mode->layer_mode))
-    {
-      switch (composite_mode)
-        {
-        case GIMP_LAYER_COMPOSITE_UNION:
-        case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union (in, layer, blend_out, mask, opacity,
-                           out, samples);
-          break;
+          composite_function (in, layer, blend_block, mask, opacity,
+                              out, count);
 
-        case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop (in, layer, blend_out, mask, opacity,
-                                      out, samples);
-          break;
-
-        case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer (in, layer, blend_out, mask, opacity,
-                                   out, samples);
-          break;
+          in      += 4 * count;
+          layer   += 4 * count;
+          if (mask)
+            mask  +=     count;
+          out     += 4 * count;
 
-        case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection (in, layer, blend_out, mask, opacity,
-                                  out, samples);
-          break;
+          samples -= count;
         }
-    }
-  else
-    {
-      switch (composite_mode)
-        {
-        case GIMP_LAYER_COMPOSITE_UNION:
-        case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union_sub (in, layer, blend_out, mask, opacity,
-                               out, samples);
-          break;
-
-        case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop_sub (in, layer, blend_out, mask, opacity,
-                                          out, samples);
-          break;
 
-        case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer_sub (in, layer, blend_out, mask, opacity,
-                                       out, samples);
-          break;
-
-        case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection_sub (in, layer, blend_out, mask, opacity,
-                                      out, samples);
-          break;
-        }
+      return TRUE;
     }
 
+  composite_function (in, layer, blend_out, mask, opacity, out, samples);
+
   return TRUE;
 }
 
@@ -792,6 +822,82 @@ process_last_node (GeglOperation       *operation,
 }
 
 
+/* returns TRUE if the effective alpha of all the layer samples, that is,
+ * their alpha multiplied by the mask, is zero.  stops at the first
+ * nontransparent sample, so this is cheap for opaque content.
+ */
+static gboolean
+samples_are_transparent (const gfloat *layer,
+                         const gfloat *mask,
+                         glong         samples)
+{
+  glong i;
+
+  if (mask)
+    {
+      for (i = 0; i < samples; i++)
+        {
+          if (layer[4 * i + ALPHA] != 0.0f && mask[i] != 0.0f)
+            return FALSE;
+        }
+    }
+  else
+    {
+      for (i = 0; i < samples; i++)
+        {
+          if (layer[4 * i + ALPHA] != 0.0f)
+            return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static CompositeFunc
+gimp_operation_layer_mode_get_composite_func (GimpOperationLayerMode *layer_mode,
+                                              GimpLayerCompositeMode  composite_mode)
+{
+  if (! gimp_layer_mode_is_subtractive (layer_mode->layer_mode))
+    {
+      switch (composite_mode)
+        {
+        case GIMP_LAYER_COMPOSITE_UNION:
+        case GIMP_LAYER_COMPOSITE_AUTO:
+          return composite_union;
+
+        case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
+          return composite_clip_to_backdrop;
+
+        case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
+          return composite_clip_to_layer;
+
+        case GIMP_LAYER_COMPOSITE_INTERSECTION:
+          return composite_intersection;
+        }
+    }
+  else
+    {
+      switch (composite_mode)
+        {
+        case GIMP_LAYER_COMPOSITE_UNION:
+        case GIMP_LAYER_COMPOSITE_AUTO:
+          return composite_union_sub;
+
+        case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
+          return composite_clip_to_backdrop_sub;
+
+        case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
+          return composite_clip_to_layer_sub;
+
+        case GIMP_LAYER_COMPOSITE_INTERSECTION:
+          return composite_intersection_sub;
+        }
+    }
+
+  g_return_val_if_reached (composite_union);
+}
+
+
 /*  public functions  */
 
 
@@ -810,3 +916,24 @@ gimp_operation_layer_mode_get_affected_region (GimpOperationLayerMode *layer_mod
 
   return GIMP_LAYER_COMPOSITE_REGION_INTERSECTION;
 }
+
+/* the accumulated time, in microseconds, spent compositing pixels by this
+ * node since the last reset, which the projection does when it starts
+ * rendering.  chunks processed in parallel by several threads all add up,
+ * so this measures cpu time rather than wall-clock time.
+ */
+gint64
+gimp_operation_layer_mode_get_render_cost (GimpOperationLayerMode *layer_mode)
+{
+  g_return_val_if_fail (GIMP_IS_OPERATION_LAYER_MODE (layer_mode), 0);
+
+  return (gssize) g_atomic_pointer_get (&layer_mode->render_cost);
+}
+
+void
+gimp_operation_layer_mode_reset_render_cost (GimpOperationLayerMode *layer_mode)
+{
+  g_return_if_fail (GIMP_IS_OPERATION_LAYER_MODE (layer_mode));
+
+  g_atomic_pointer_set (&layer_mode->render_cost, 0);
+}
@@ -49,6 +49,9 @@ struct _GimpOperationLayerMode
   GimpLayerModeFunc            function;
   GimpLayerModeBlendFunc       blend_function;
   gboolean                     is_last_node;
+
+  /*  pointer-sized, so that it can be updated with g_atomic_pointer_add()  */
+  gssize                       render_cost;
 };
 
 struct _GimpOperationLayerModeClass
@@ -77,5 +80,8 @@ GType                    gimp_operation_layer_mode_get_type            (void) G_
 
 GimpLayerCompositeRegion gimp_operation_layer_mode_get_affected_region (GimpOperationLayerMode *layer_mode);
 
+gint64                   gimp_operation_layer_mode_get_render_cost     (GimpOperationLayerMode *layer_mode);
+void                     gimp_operation_layer_mode_reset_render_cost   (GimpOperationLayerMode *layer_mode);
+
 
 #endif /* __GIMP_OPERATION_LAYER_MODE_H__ */
@@ -0,0 +1,584 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* runs every combination of blend mode, composite mode, blend space and
+ * mask over random and edge-case samples, checks that the functions
+ * selected for this CPU agree with the generic ones within a tolerance,
+ * and reports the throughput of each combination in Mpix/s.
+ *
+ * unlike test-layer-modes, which requires the accelerated functions to
+ * be bit-identical, this also covers the color-space conversions and
+ * the subtractive modes, and is meant to be run by "make benchmark".
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gegl-plugin.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "app/operations/operations-types.h"
+
+#include "app/operations/layer-modes/gimp-layer-modes.h"
+#include "app/operations/layer-modes/gimpoperationlayermode-blend.h"
+#include "app/operations/layer-modes/gimpoperationlayermode-composite.h"
+
+
+/* an odd number, so that the scalar tail of the accelerated functions is
+ * exercised too
+ */
+#define N_SAMPLES      1023
+
+/* the minimal time, in seconds, each combination is timed for */
+#define BENCHMARK_TIME 0.02
+
+/* the maximal difference allowed between the generic and the selected
+ * functions, relative to the magnitude of the expected value
+ */
+#define TOLERANCE      1e-5
+
+
+typedef void (* CompositeFunc) (const gfloat *in,
+                                const gfloat *layer,
+                                const gfloat *comp,
+                                const gfloat *mask,
+                                gfloat        opacity,
+                                gfloat       *out,
+                                gint          samples);
+
+typedef struct
+{
+  CompositeFunc generic;
+  CompositeFunc accel;
+} CompositeFuncs;
+
+typedef struct
+{
+  GimpLayerMode          mode;
+  GimpLayerCompositeMode composite_mode;
+  GimpLayerColorSpace    composite_space;
+  GimpLayerColorSpace    blend_space;
+  gboolean               with_mask;
+  gfloat                 opacity;
+} Combination;
+
+
+typedef enum
+{
+  INPUT_RANDOM,
+  INPUT_EDGE_CASES,
+  N_INPUTS
+} Input;
+
+static const gchar *input_names[N_INPUTS] =
+{
+  "random",
+  "edge-cases"
+};
+
+static gfloat in_samples[N_INPUTS][4 * N_SAMPLES];
+static gfloat layer_samples[N_INPUTS][4 * N_SAMPLES];
+static gfloat mask_samples[N_INPUTS][N_SAMPLES];
+
+
+#if COMPILE_AVX2_INTRINISICS
+static const struct
+{
+  GimpLayerModeBlendFunc generic;
+  GimpLayerModeBlendFunc avx2;
+}
+blend_funcs_avx2[] =
+{
+#define BLEND_FUNC(name)                                  \
+  { gimp_operation_layer_mode_blend_##name,               \
+    gimp_operation_layer_mode_blend_##name##_avx2 }
+
+  BLEND_FUNC (addition),
+  BLEND_FUNC (darken_only),
+  BLEND_FUNC (difference),
+  BLEND_FUNC (exclusion),
+  BLEND_FUNC (grain_extract),
+  BLEND_FUNC (grain_merge),
+  BLEND_FUNC (lighten_only),
+  BLEND_FUNC (linear_burn),
+  BLEND_FUNC (multiply),
+  BLEND_FUNC (overlay),
+  BLEND_FUNC (screen),
+  BLEND_FUNC (softlight),
+  BLEND_FUNC (subtract)
+
+#undef BLEND_FUNC
+};
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+/* indexed by GimpLayerCompositeMode, the generic and selected functions
+ * of the nonsubtractive and the subtractive modes
+ */
+static CompositeFuncs composite_funcs[GIMP_LAYER_COMPOSITE_INTERSECTION + 1];
+static CompositeFuncs composite_funcs_sub[GIMP_LAYER_COMPOSITE_INTERSECTION + 1];
+
+static const gchar *composite_mode_names[] =
+{
+  "auto",
+  "union",
+  "clip-to-backdrop",
+  "clip-to-layer",
+  "intersection"
+};
+
+static const gchar *color_space_names[] =
+{
+  "auto",
+  "rgb-linear",
+  "rgb-perceptual",
+  "lab"
+};
+
+
+static void
+init_composite_funcs (void)
+{
+#define COMPOSITE_FUNCS(funcs, mode, name)                               \
+  funcs[GIMP_LAYER_COMPOSITE_##mode].generic =                           \
+    funcs[GIMP_LAYER_COMPOSITE_##mode].accel =                           \
+      gimp_operation_layer_mode_composite_##name
+
+  COMPOSITE_FUNCS (composite_funcs, UNION,            union);
+  COMPOSITE_FUNCS (composite_funcs, CLIP_TO_BACKDROP, clip_to_backdrop);
+  COMPOSITE_FUNCS (composite_funcs, CLIP_TO_LAYER,    clip_to_layer);
+  COMPOSITE_FUNCS (composite_funcs, INTERSECTION,     intersection);
+
+  COMPOSITE_FUNCS (composite_funcs_sub, UNION,            union_sub);
+  COMPOSITE_FUNCS (composite_funcs_sub, CLIP_TO_BACKDROP, clip_to_backdrop_sub);
+  COMPOSITE_FUNCS (composite_funcs_sub, CLIP_TO_LAYER,    clip_to_layer_sub);
+  COMPOSITE_FUNCS (composite_funcs_sub, INTERSECTION,     intersection_sub);
+
+#undef COMPOSITE_FUNCS
+
+  /* the same selection as gimp_operation_layer_mode_class_init() */
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
+    {
+      composite_funcs[GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP].accel =
+        gimp_operation_layer_mode_composite_clip_to_backdrop_sse2;
+    }
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+#if COMPILE_AVX2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2)
+    {
+      composite_funcs[GIMP_LAYER_COMPOSITE_UNION].accel =
+        gimp_operation_layer_mode_composite_union_avx2;
+      composite_funcs[GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP].accel =
+        gimp_operation_layer_mode_composite_clip_to_backdrop_avx2;
+      composite_funcs[GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER].accel =
+        gimp_operation_layer_mode_composite_clip_to_layer_avx2;
+      composite_funcs[GIMP_LAYER_COMPOSITE_INTERSECTION].accel =
+        gimp_operation_layer_mode_composite_intersection_avx2;
+    }
+#endif /* COMPILE_AVX2_INTRINISICS */
+}
+
+static GimpLayerModeBlendFunc
+get_generic_blend_func (GimpLayerModeBlendFunc blend_func)
+{
+#if COMPILE_AVX2_INTRINISICS
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (blend_funcs_avx2); i++)
+    {
+      if (blend_func == blend_funcs_avx2[i].avx2)
+        return blend_funcs_avx2[i].generic;
+    }
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+  return blend_func;
+}
+
+static gfloat
+random_alpha (GRand *grand)
+{
+  /* alpha values, with a fair amount of zeros and ones */
+  switch (g_rand_int_range (grand, 0, 4))
+    {
+    case 0:  return 0.0f;
+    case 1:  return 1.0f;
+    default: return g_rand_double (grand);
+    }
+}
+
+static void
+init_samples (GRand *grand)
+{
+  /* values on the boundaries of the blend functions' branches, and
+   * slightly out of gamut
+   */
+  const gfloat edge_values[] = { 0.0f, 1e-6f, 0.25f, 0.5f, 0.75f,
+                                 1.0f - 1e-6f, 1.0f, -0.25f, 1.25f };
+  const gfloat edge_alphas[] = { 0.0f, 1e-6f, 0.5f, 1.0f };
+  gint         i;
+  gint         c;
+
+  for (i = 0; i < N_SAMPLES; i++)
+    {
+      /* include some out-of-gamut values */
+      for (c = 0; c < ALPHA; c++)
+        {
+          in_samples[INPUT_RANDOM][4 * i + c]    = g_rand_double_range (grand,
+                                                                -0.25, 1.25);
+          layer_samples[INPUT_RANDOM][4 * i + c] = g_rand_double_range (grand,
+                                                                -0.25, 1.25);
+        }
+
+      in_samples[INPUT_RANDOM][4 * i + ALPHA]    = random_alpha (grand);
+      layer_samples[INPUT_RANDOM][4 * i + ALPHA] = random_alpha (grand);
+
+      mask_samples[INPUT_RANDOM][i] = g_rand_int_range (grand, 0, 4) ?
+                              g_rand_double (grand) : 0.0f;
+
+      /* walk through the combinations of the edge values, so that each
+       * layer value meets each backdrop value
+       */
+      for (c = 0; c < ALPHA; c++)
+        {
+          gint n = G_N_ELEMENTS (edge_values);
+
+          in_samples[INPUT_EDGE_CASES][4 * i + c]    = edge_values[(i + c) % n];
+          layer_samples[INPUT_EDGE_CASES][4 * i + c] = edge_values[(i / n + c) % n];
+        }
+
+      in_samples[INPUT_EDGE_CASES][4 * i + ALPHA] =
+        edge_alphas[i % G_N_ELEMENTS (edge_alphas)];
+      layer_samples[INPUT_EDGE_CASES][4 * i + ALPHA] =
+        edge_alphas[(i / G_N_ELEMENTS (edge_alphas)) %
+                    G_N_ELEMENTS (edge_alphas)];
+
+      mask_samples[INPUT_EDGE_CASES][i] =
+        edge_alphas[(i / 3) % G_N_ELEMENTS (edge_alphas)];
+    }
+}
+
+static gboolean
+values_match (gfloat expected,
+              gfloat result)
+{
+  if (isnan (expected) || isnan (result))
+    return isnan (expected) && isnan (result);
+
+  return fabs (expected - result) <= TOLERANCE * MAX (1.0, fabs (expected));
+}
+
+static gint
+compare_samples (const gchar  *what,
+                 const gfloat *in,
+                 const gfloat *layer,
+                 const gfloat *expected,
+                 const gfloat *result)
+{
+  gint i;
+
+  for (i = 0; i < N_SAMPLES; i++)
+    {
+      const gfloat *e = expected + 4 * i;
+      const gfloat *r = result   + 4 * i;
+      gint          c = ALPHA;
+
+      /* the blended color values are only constrained when both alphas
+       * are nonzero, and the output color only when the output alpha is
+       * nonzero
+       */
+      if (in[4 * i + ALPHA] != 0.0f && layer[4 * i + ALPHA] != 0.0f)
+        {
+          c = (e[ALPHA] != 0.0f) ? 0 : ALPHA;
+        }
+
+      for (; c < 4; c++)
+        {
+          if (! values_match (e[c], r[c]))
+            {
+              g_print ("%s: sample %d differs\n"
+                       "  expected: (%.9g, %.9g, %.9g, %.9g)\n"
+                       "  got:      (%.9g, %.9g, %.9g, %.9g)\n",
+                       what, i,
+                       e[0], e[1], e[2], e[3],
+                       r[0], r[1], r[2], r[3]);
+
+              return 1;
+            }
+        }
+    }
+
+  return 0;
+}
+
+static void
+process (const Combination     *combination,
+         GimpLayerModeBlendFunc blend_func,
+         CompositeFunc          composite_func,
+         const gfloat          *in,
+         const gfloat          *layer,
+         const gfloat          *mask,
+         gfloat                *out)
+{
+  gfloat comp[4 * N_SAMPLES];
+
+  if (combination->blend_space == combination->composite_space)
+    {
+      blend_func (in, layer, comp, N_SAMPLES);
+    }
+  else
+    {
+      const Babl *composite_format;
+      const Babl *blend_format;
+      gfloat      blend_in[4 * N_SAMPLES];
+      gfloat      blend_layer[4 * N_SAMPLES];
+
+      composite_format = gimp_layer_mode_get_format (combination->mode,
+                                                     combination->composite_space,
+                                                     combination->blend_space,
+                                                     NULL);
+      blend_format     = gimp_layer_mode_get_format (combination->mode,
+                                                     combination->blend_space,
+                                                     combination->blend_space,
+                                                     NULL);
+
+      babl_process (babl_fish (composite_format, blend_format),
+                    in, blend_in, N_SAMPLES);
+      babl_process (babl_fish (composite_format, blend_format),
+                    layer, blend_layer, N_SAMPLES);
+
+      blend_func (blend_in, blend_layer, comp, N_SAMPLES);
+
+      babl_process (babl_fish (blend_format, composite_format),
+                    comp, comp, N_SAMPLES);
+    }
+
+  composite_func (in, layer, comp, mask, combination->opacity,
+                  out, N_SAMPLES);
+}
+
+static gint
+test_combination (const Combination *combination,
+                  const gchar       *name)
+{
+  GimpLayerModeBlendFunc  blend_func;
+  const CompositeFuncs   *funcs;
+  gfloat                  expected[4 * N_SAMPLES];
+  gfloat                  result[4 * N_SAMPLES];
+  gint                    failures = 0;
+  gint                    i;
+
+  blend_func = gimp_layer_mode_get_blend_function (combination->mode);
+
+  if (gimp_layer_mode_is_subtractive (combination->mode))
+    funcs = &composite_funcs_sub[combination->composite_mode];
+  else
+    funcs = &composite_funcs[combination->composite_mode];
+
+  if (blend_func == get_generic_blend_func (blend_func) &&
+      funcs->accel == funcs->generic)
+    {
+      return 0;
+    }
+
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      const gfloat *m = combination->with_mask ? mask_samples[i] : NULL;
+      gchar        *what;
+
+      process (combination,
+               get_generic_blend_func (blend_func), funcs->generic,
+               in_samples[i], layer_samples[i], m, expected);
+      process (combination,
+               blend_func, funcs->accel,
+               in_samples[i], layer_samples[i], m, result);
+
+      what = g_strdup_printf ("%s (%s samples)", name, input_names[i]);
+
+      failures += compare_samples (what, in_samples[i], layer_samples[i],
+                                   expected, result);
+
+      g_free (what);
+    }
+
+  return failures;
+}
+
+static gdouble
+benchmark_combination (const Combination *combination)
+{
+  GimpLayerModeBlendFunc  blend_func;
+  CompositeFunc           composite_func;
+  gfloat                  out[4 * N_SAMPLES];
+  const gfloat           *m;
+  gint64                  start_time;
+  gint64                  elapsed;
+  gint64                  n_pixels = 0;
+
+  blend_func = gimp_layer_mode_get_blend_function (combination->mode);
+
+  if (gimp_layer_mode_is_subtractive (combination->mode))
+    composite_func = composite_funcs_sub[combination->composite_mode].accel;
+  else
+    composite_func = composite_funcs[combination->composite_mode].accel;
+
+  m = combination->with_mask ? mask_samples[INPUT_RANDOM] : NULL;
+
+  start_time = g_get_monotonic_time ();
+
+  do
+    {
+      gint i;
+
+      for (i = 0; i < 16; i++)
+        {
+          process (combination, blend_func, composite_func,
+                   in_samples[INPUT_RANDOM], layer_samples[INPUT_RANDOM], m, out);
+        }
+
+      n_pixels += 16 * N_SAMPLES;
+      elapsed   = g_get_monotonic_time () - start_time;
+    }
+  while (elapsed < BENCHMARK_TIME * G_TIME_SPAN_SECOND);
+
+  return (gdouble) n_pixels / elapsed;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GRand *grand;
+  gint   failures = 0;
+  gint   n_tests  = 0;
+  gint   mode;
+
+  gegl_init (&argc, &argv);
+
+  gimp_layer_modes_init ();
+  init_composite_funcs ();
+
+  grand = g_rand_new_with_seed (0);
+
+  init_samples (grand);
+
+  g_rand_free (grand);
+
+  g_print ("\nBenchmarking the layer-mode functions ...\n\n");
+  g_print ("%-28s %-17s %-15s %-5s %10s\n",
+           "mode", "composite mode", "blend space", "mask", "Mpix/s");
+
+  for (mode = 0; mode <= GIMP_LAYER_MODE_ANTI_ERASE; mode++)
+    {
+      const gchar            *mode_name;
+      GimpLayerColorSpace     composite_space;
+      GimpLayerColorSpace     default_blend_space;
+      GimpLayerCompositeMode  default_composite_mode;
+      gint                    composite_mode;
+      gint                    blend_space;
+
+      /* the legacy and the special modes have process functions of their
+       * own, which aren't split into blending and compositing
+       */
+      if (! gimp_layer_mode_get_blend_function (mode))
+        continue;
+
+      if (! gimp_enum_get_value (GIMP_TYPE_LAYER_MODE, mode,
+                                 NULL, &mode_name, NULL, NULL))
+        continue;
+
+      /* resolve the "auto" values the way the layer-mode operation does */
+      composite_space = gimp_layer_mode_get_composite_space (mode);
+      if (composite_space == GIMP_LAYER_COLOR_SPACE_AUTO)
+        composite_space = GIMP_LAYER_COLOR_SPACE_RGB_LINEAR;
+
+      default_blend_space = gimp_layer_mode_get_blend_space (mode);
+      if (default_blend_space == GIMP_LAYER_COLOR_SPACE_AUTO)
+        default_blend_space = composite_space;
+
+      default_composite_mode = gimp_layer_mode_get_composite_mode (mode);
+      if (default_composite_mode == GIMP_LAYER_COMPOSITE_AUTO)
+        default_composite_mode = GIMP_LAYER_COMPOSITE_UNION;
+
+      for (composite_mode = GIMP_LAYER_COMPOSITE_UNION;
+           composite_mode <= GIMP_LAYER_COMPOSITE_INTERSECTION;
+           composite_mode++)
+        {
+          if (! gimp_layer_mode_is_composite_mode_mutable (mode) &&
+              composite_mode != default_composite_mode)
+            continue;
+
+          for (blend_space = GIMP_LAYER_COLOR_SPACE_RGB_LINEAR;
+               blend_space <= GIMP_LAYER_COLOR_SPACE_LAB;
+               blend_space++)
+            {
+              gint with_mask;
+
+              if (! gimp_layer_mode_is_blend_space_mutable (mode) &&
+                  blend_space != default_blend_space)
+                continue;
+
+              for (with_mask = FALSE; with_mask <= TRUE; with_mask++)
+                {
+                  Combination combination;
+                  gchar      *name;
+
+                  combination.mode            = mode;
+                  combination.composite_mode  = composite_mode;
+                  combination.composite_space = composite_space;
+                  combination.blend_space     = blend_space;
+                  combination.with_mask       = with_mask;
+                  combination.opacity         = 0.75f;
+
+                  name = g_strdup_printf ("%s/%s/%s/%s",
+                                          mode_name,
+                                          composite_mode_names[composite_mode],
+                                          color_space_names[blend_space],
+                                          with_mask ? "mask" : "no-mask");
+
+                  n_tests++;
+                  failures += test_combination (&combination, name);
+
+                  g_print ("%-28s %-17s %-15s %-5s %10.1f\n",
+                           mode_name,
+                           composite_mode_names[composite_mode],
+                           color_space_names[blend_space],
+                           with_mask ? "yes" : "no",
+                           benchmark_combination (&combination));
+
+                  g_free (name);
+                }
+            }
+        }
+    }
+
+  if (failures)
+    {
+      g_print ("\n%d failures in %d combinations!\n\n", failures, n_tests);
+      return EXIT_FAILURE;
+    }
+  else
+    {
+      g_print ("\nAll %d combinations passed.\n\n", n_tests);
+      return EXIT_SUCCESS;
+    }
+}
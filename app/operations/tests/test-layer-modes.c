@@ -0,0 +1,252 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* checks that the accelerated layer-mode blend and composite functions
+ * produce results that are bit-identical to the generic ones.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "app/operations/operations-types.h"
+
+#include "app/operations/layer-modes/gimpoperationlayermode-blend.h"
+#include "app/operations/layer-modes/gimpoperationlayermode-composite.h"
+
+
+/* an odd number, so that the scalar tail of the accelerated functions is
+ * exercised too
+ */
+#define N_SAMPLES 1023
+
+
+typedef void (* BlendFunc)     (const gfloat *in,
+                                const gfloat *layer,
+                                gfloat       *comp,
+                                gint          samples);
+typedef void (* CompositeFunc) (const gfloat *in,
+                                const gfloat *layer,
+                                const gfloat *comp,
+                                const gfloat *mask,
+                                gfloat        opacity,
+                                gfloat       *out,
+                                gint          samples);
+
+
+static gfloat in[4 * N_SAMPLES];
+static gfloat layer[4 * N_SAMPLES];
+static gfloat comp[4 * N_SAMPLES];
+static gfloat mask[N_SAMPLES];
+
+
+static void
+init_samples (GRand *grand)
+{
+  gint i;
+
+  for (i = 0; i < 4 * N_SAMPLES; i++)
+    {
+      /* include some out-of-gamut values */
+      in[i]    = g_rand_double_range (grand, -0.25, 1.25);
+      layer[i] = g_rand_double_range (grand, -0.25, 1.25);
+    }
+
+  for (i = 0; i < N_SAMPLES; i++)
+    {
+      /* alpha values, with a fair amount of zeros and ones */
+      switch (g_rand_int_range (grand, 0, 4))
+        {
+        case 0:  in[4 * i + ALPHA] = 0.0f; break;
+        case 1:  in[4 * i + ALPHA] = 1.0f; break;
+        default: in[4 * i + ALPHA] = g_rand_double (grand); break;
+        }
+
+      switch (g_rand_int_range (grand, 0, 4))
+        {
+        case 0:  layer[4 * i + ALPHA] = 0.0f; break;
+        case 1:  layer[4 * i + ALPHA] = 1.0f; break;
+        default: layer[4 * i + ALPHA] = g_rand_double (grand); break;
+        }
+
+      /* put some values right on the switch-over point of the overlay
+       * branches
+       */
+      if (g_rand_int_range (grand, 0, 16) == 0)
+        in[4 * i + RED] = 0.5f;
+
+      mask[i] = g_rand_int_range (grand, 0, 4) ? g_rand_double (grand) : 0.0f;
+    }
+}
+
+static gint
+test_blend_func (const gchar *name,
+                 BlendFunc    generic,
+                 BlendFunc    accel)
+{
+  gfloat expected[4 * N_SAMPLES];
+  gfloat result[4 * N_SAMPLES];
+  gint   i;
+
+  generic (in, layer, expected, N_SAMPLES);
+  accel   (in, layer, result,   N_SAMPLES);
+
+  for (i = 0; i < N_SAMPLES; i++)
+    {
+      const gfloat *e = expected + 4 * i;
+      const gfloat *r = result   + 4 * i;
+
+      /* the color values are only constrained when both alphas are
+       * nonzero
+       */
+      if (in[4 * i + ALPHA] != 0.0f && layer[4 * i + ALPHA] != 0.0f)
+        {
+          if (memcmp (e, r, 4 * sizeof (gfloat)))
+            break;
+        }
+      else if (memcmp (e + ALPHA, r + ALPHA, sizeof (gfloat)))
+        {
+          break;
+        }
+    }
+
+  if (i < N_SAMPLES)
+    {
+      g_print ("blend %s: sample %d differs\n"
+               "  expected: (%.9g, %.9g, %.9g, %.9g)\n"
+               "  got:      (%.9g, %.9g, %.9g, %.9g)\n",
+               name, i,
+               expected[4 * i + 0], expected[4 * i + 1],
+               expected[4 * i + 2], expected[4 * i + 3],
+               result[4 * i + 0], result[4 * i + 1],
+               result[4 * i + 2], result[4 * i + 3]);
+      return 1;
+    }
+
+  return 0;
+}
+
+static gint
+test_composite_func (const gchar   *name,
+                     CompositeFunc  generic,
+                     CompositeFunc  accel)
+{
+  const gfloat opacities[] = { 1.0f, 0.5f, 0.0f };
+  gfloat       expected[4 * N_SAMPLES];
+  gfloat       result[4 * N_SAMPLES];
+  gint         o;
+
+  for (o = 0; o < 2 * G_N_ELEMENTS (opacities); o++)
+    {
+      const gfloat *m       = (o & 1) ? mask : NULL;
+      gfloat        opacity = opacities[o / 2];
+
+      generic (in, layer, comp, m, opacity, expected, N_SAMPLES);
+      accel   (in, layer, comp, m, opacity, result,   N_SAMPLES);
+
+      if (memcmp (expected, result, sizeof (expected)))
+        {
+          g_print ("composite %s: results differ (opacity %g, %s mask)\n",
+                   name, opacity, m ? "with" : "without");
+          return 1;
+        }
+    }
+
+  return 0;
+}
+
+int
+main (void)
+{
+  GRand *grand;
+  gint   failures = 0;
+  gint   n_tests  = 0;
+
+  g_print ("\nTesting the accelerated layer-mode functions ...\n");
+
+#if COMPILE_AVX2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2)
+    {
+      grand = g_rand_new_with_seed (0);
+
+      init_samples (grand);
+
+      /* the compositing functions expect comp[ALPHA] == layer[ALPHA] */
+      gimp_operation_layer_mode_blend_multiply (in, layer, comp, N_SAMPLES);
+
+#define TEST_BLEND(name)                                                \
+      n_tests++;                                                        \
+      failures += test_blend_func (#name,                               \
+                                   gimp_operation_layer_mode_blend_##name, \
+                                   gimp_operation_layer_mode_blend_##name##_avx2)
+
+      TEST_BLEND (addition);
+      TEST_BLEND (darken_only);
+      TEST_BLEND (difference);
+      TEST_BLEND (exclusion);
+      TEST_BLEND (grain_extract);
+      TEST_BLEND (grain_merge);
+      TEST_BLEND (lighten_only);
+      TEST_BLEND (linear_burn);
+      TEST_BLEND (multiply);
+      TEST_BLEND (overlay);
+      TEST_BLEND (screen);
+      TEST_BLEND (softlight);
+      TEST_BLEND (subtract);
+
+#undef TEST_BLEND
+
+#define TEST_COMPOSITE(name)                                            \
+      n_tests++;                                                        \
+      failures += test_composite_func (#name,                           \
+                                       gimp_operation_layer_mode_composite_##name, \
+                                       gimp_operation_layer_mode_composite_##name##_avx2)
+
+      TEST_COMPOSITE (union);
+      TEST_COMPOSITE (clip_to_backdrop);
+      TEST_COMPOSITE (clip_to_layer);
+      TEST_COMPOSITE (intersection);
+
+#undef TEST_COMPOSITE
+
+      g_rand_free (grand);
+    }
+  else
+    {
+      g_print ("AVX2 not supported by this CPU, skipping.\n");
+    }
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+  if (failures)
+    {
+      g_print ("%d out of %d functions failed!\n\n", failures, n_tests);
+      return EXIT_FAILURE;
+    }
+  else
+    {
+      g_print ("All %d functions passed.\n\n", n_tests);
+      return EXIT_SUCCESS;
+    }
+}
@@ -30,6 +30,7 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimpbrush.h"
 #include "core/gimpbrushgenerated.h"
 #include "core/gimpdrawable.h"
@@ -50,6 +51,11 @@
 
 #define EPSILON  0.00001
 
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+/*  the largest total size of the subsampled and solidified masks  */
+#define MAX_MASK_CACHES_SIZE  (32 * 1024 * 1024)
+
 enum
 {
   SET_BRUSH,
@@ -125,6 +131,16 @@ static const GimpTempBuf *
 static void      gimp_brush_core_invalidate_cache   (GimpBrush         *brush,
                                                      GimpBrushCore     *core);
 
+static GimpBrushCoreMaskCache *
+                 gimp_brush_core_get_mask_cache     (GimpBrushCore     *core,
+                                                     const GimpTempBuf *mask);
+static void      gimp_brush_core_add_to_mask_cache  (GimpBrushCore     *core,
+                                                     GimpBrushCoreMaskCache *cache,
+                                                     GimpTempBuf       *buf);
+static void      gimp_brush_core_clear_mask_cache   (GimpBrushCore     *core,
+                                                     GimpBrushCoreMaskCache *cache);
+static void      gimp_brush_core_clear_mask_caches  (GimpBrushCore     *core);
+
 /*  brush pipe utility functions  */
 static void  gimp_brush_core_paint_line_pixmap_mask (GimpDrawable      *drawable,
                                                      const GimpTempBuf *pixmap_mask,
@@ -188,7 +204,7 @@ gimp_brush_core_class_init (GimpBrushCoreClass *klass)
 static void
 gimp_brush_core_init (GimpBrushCore *core)
 {
-  gint i, j;
+  gint i;
 
   core->main_brush                   = NULL;
   core->brush                        = NULL;
@@ -201,25 +217,11 @@ gimp_brush_core_init (GimpBrushCore *core)
 
   core->pressure_brush               = NULL;
 
-  core->last_solid_brush_mask        = NULL;
-  core->solid_cache_invalid          = FALSE;
-
   core->transform_brush              = NULL;
   core->transform_pixmap             = NULL;
 
-  core->last_subsample_brush_mask    = NULL;
-  core->subsample_cache_invalid      = FALSE;
-
   core->rand                         = g_rand_new ();
 
-  for (i = 0; i < BRUSH_CORE_SOLID_SUBSAMPLE; i++)
-    {
-      for (j = 0; j < BRUSH_CORE_SOLID_SUBSAMPLE; j++)
-        {
-          core->solid_brushes[i][j] = NULL;
-        }
-    }
-
   for (i = 0; i < BRUSH_CORE_JITTER_LUTSIZE - 1; ++i)
     {
       core->jitter_lut_y[i] = cos (gimp_deg_to_rad (i * 360 /
@@ -229,34 +231,19 @@ gimp_brush_core_init (GimpBrushCore *core)
     }
 
   gimp_assert (BRUSH_CORE_SUBSAMPLE == KERNEL_SUBSAMPLE);
-
-  for (i = 0; i < KERNEL_SUBSAMPLE + 1; i++)
-    {
-      for (j = 0; j < KERNEL_SUBSAMPLE + 1; j++)
-        {
-          core->subsample_brushes[i][j] = NULL;
-        }
-    }
 }
 
 static void
 gimp_brush_core_finalize (GObject *object)
 {
   GimpBrushCore *core = GIMP_BRUSH_CORE (object);
-  gint           i, j;
 
   g_clear_pointer (&core->pressure_brush, gimp_temp_buf_unref);
 
-  for (i = 0; i < BRUSH_CORE_SOLID_SUBSAMPLE; i++)
-    for (j = 0; j < BRUSH_CORE_SOLID_SUBSAMPLE; j++)
-      g_clear_pointer (&core->solid_brushes[i][j], gimp_temp_buf_unref);
+  gimp_brush_core_clear_mask_caches (core);
 
   g_clear_pointer (&core->rand, g_rand_free);
 
-  for (i = 0; i < KERNEL_SUBSAMPLE + 1; i++)
-    for (j = 0; j < KERNEL_SUBSAMPLE + 1; j++)
-      g_clear_pointer (&core->subsample_brushes[i][j], gimp_temp_buf_unref);
-
   if (core->main_brush)
     {
       g_signal_handlers_disconnect_by_func (core->main_brush,
@@ -933,6 +920,112 @@ gimp_brush_core_set_brush (GimpBrushCore *core,
     g_signal_emit (core, core_signals[SET_BRUSH], 0, brush);
 }
 
+/*  returns the cache of subsampled and solidified versions of 'mask',
+ *  reusing the least recently used one if 'mask' has none yet.  the
+ *  cache holds a reference to the mask, so its address can't be reused
+ *  by another mask while it's cached.
+ */
+static GimpBrushCoreMaskCache *
+gimp_brush_core_get_mask_cache (GimpBrushCore     *core,
+                                const GimpTempBuf *mask)
+{
+  GimpBrushCoreMaskCache *cache = NULL;
+  gint                    i;
+
+  for (i = 0; i < BRUSH_CORE_N_MASK_CACHES; i++)
+    {
+      GimpBrushCoreMaskCache *c = &core->mask_caches[i];
+
+      if (c->mask == mask)
+        {
+          cache = c;
+          break;
+        }
+
+      if (! cache || ! c->mask ||
+          (cache->mask && c->last_use < cache->last_use))
+        {
+          cache = c;
+        }
+    }
+
+  if (cache->mask != mask)
+    {
+      gimp_brush_core_clear_mask_cache (core, cache);
+
+      cache->mask = gimp_temp_buf_ref ((GimpTempBuf *) mask);
+    }
+
+  cache->last_use = ++core->mask_caches_clock;
+
+  return cache;
+}
+
+/*  accounts for 'buf', just added to 'cache', and evicts the least
+ *  recently used other caches while the total size is too large
+ */
+static void
+gimp_brush_core_add_to_mask_cache (GimpBrushCore          *core,
+                                   GimpBrushCoreMaskCache *cache,
+                                   GimpTempBuf            *buf)
+{
+  gsize size = gimp_temp_buf_get_data_size (buf);
+
+  cache->size            += size;
+  core->mask_caches_size += size;
+
+  while (core->mask_caches_size > MAX_MASK_CACHES_SIZE)
+    {
+      GimpBrushCoreMaskCache *oldest = NULL;
+      gint                    i;
+
+      for (i = 0; i < BRUSH_CORE_N_MASK_CACHES; i++)
+        {
+          GimpBrushCoreMaskCache *c = &core->mask_caches[i];
+
+          if (c != cache && c->size > 0 &&
+              (! oldest || c->last_use < oldest->last_use))
+            {
+              oldest = c;
+            }
+        }
+
+      if (! oldest)
+        break;
+
+      gimp_brush_core_clear_mask_cache (core, oldest);
+    }
+}
+
+static void
+gimp_brush_core_clear_mask_cache (GimpBrushCore          *core,
+                                  GimpBrushCoreMaskCache *cache)
+{
+  gint i, j;
+
+  for (i = 0; i < BRUSH_CORE_SUBSAMPLE + 1; i++)
+    for (j = 0; j < BRUSH_CORE_SUBSAMPLE + 1; j++)
+      g_clear_pointer (&cache->subsample_brushes[i][j], gimp_temp_buf_unref);
+
+  for (i = 0; i < BRUSH_CORE_SOLID_SUBSAMPLE; i++)
+    for (j = 0; j < BRUSH_CORE_SOLID_SUBSAMPLE; j++)
+      g_clear_pointer (&cache->solid_brushes[i][j], gimp_temp_buf_unref);
+
+  g_clear_pointer (&cache->mask, gimp_temp_buf_unref);
+
+  core->mask_caches_size -= cache->size;
+  cache->size             = 0;
+}
+
+static void
+gimp_brush_core_clear_mask_caches (GimpBrushCore *core)
+{
+  gint i;
+
+  for (i = 0; i < BRUSH_CORE_N_MASK_CACHES; i++)
+    gimp_brush_core_clear_mask_cache (core, &core->mask_caches[i]);
+}
+
 void
 gimp_brush_core_set_dynamics (GimpBrushCore *core,
                               GimpDynamics  *dynamics)
@@ -1037,8 +1130,7 @@ gimp_brush_core_invalidate_cache (GimpBrush     *brush,
 {
   /* Make sure we don't cache data for a brush that has changed */
 
-  core->subsample_cache_invalid = TRUE;
-  core->solid_cache_invalid     = TRUE;
+  gimp_brush_core_clear_mask_caches (core);
 
   /* Notify of the brush change */
 
@@ -1050,19 +1142,83 @@ gimp_brush_core_invalidate_cache (GimpBrush     *brush,
  *             LOCAL FUNCTION DEFINITIONS                   *
  ************************************************************/
 
-static inline void
-rotate_pointers (gulong  **p,
-                 guint32   n)
+typedef struct
+{
+  const GimpTempBuf *mask;
+  GimpTempBuf       *dest;
+  const gint        *kernel;
+  gint               dest_offset_x;
+  gint               dest_offset_y;
+} SubsampleMaskData;
+
+/*  computes the rows [offset, offset + size) of a subsampled mask.  each
+ *  destination row is the sum of the kernel rows applied to the
+ *  KERNEL_HEIGHT source rows above it, so that disjoint row ranges can
+ *  be computed concurrently.
+ */
+static void
+gimp_brush_core_subsample_mask_rows (gsize              offset,
+                                     gsize              size,
+                                     SubsampleMaskData *data)
 {
-  guint32  i;
-  gulong  *tmp;
+  const guchar *mask_data   = gimp_temp_buf_get_data (data->mask);
+  guchar       *dest_data   = gimp_temp_buf_get_data (data->dest);
+  gint          mask_width  = gimp_temp_buf_get_width  (data->mask);
+  gint          mask_height = gimp_temp_buf_get_height (data->mask);
+  gint          dest_width  = gimp_temp_buf_get_width  (data->dest);
+  gulong       *accum;
+  gint          o;
 
-  tmp = p[0];
+  accum = g_new (gulong, dest_width + 1);
 
-  for (i = 0; i < n-1; i++)
-    p[i] = p[i+1];
+  for (o = offset; o < (gint) (offset + size); o++)
+    {
+      gint    i = o - data->dest_offset_y;
+      gulong  bias;
+      guchar *d;
+      gint    j, r;
 
-  p[i] = tmp;
+      /*  the row above the first source row, when the mask is shifted
+       *  down, doesn't receive anything
+       */
+      if (i < 0)
+        continue;
+
+      memset (accum, 0, sizeof (gulong) * (dest_width + 1));
+
+      for (r = 0; r < KERNEL_HEIGHT; r++)
+        {
+          const guchar *m;
+          const gint   *k = data->kernel + r * KERNEL_WIDTH;
+
+          if (i - r < 0 || i - r >= mask_height)
+            continue;
+
+          m = mask_data + (i - r) * mask_width;
+
+          for (j = 0; j < mask_width; j++)
+            {
+              gint offs = j + data->dest_offset_x;
+              gint s;
+
+              for (s = 0; s < KERNEL_WIDTH; s++)
+                accum[offs++] += m[j] * k[s];
+            }
+        }
+
+      /*  rows past the last source row round slightly differently  */
+      if (i < mask_height)
+        bias = 127;
+      else
+        bias = KERNEL_SUM / 2;
+
+      d = dest_data + o * dest_width;
+
+      for (j = 0; j < dest_width; j++)
+        *d++ = (accum[j] + bias) / KERNEL_SUM;
+    }
+
+  g_free (accum);
 }
 
 static const GimpTempBuf *
@@ -1071,24 +1227,19 @@ gimp_brush_core_subsample_mask (GimpBrushCore     *core,
                                 gdouble            x,
                                 gdouble            y)
 {
-  GimpTempBuf  *dest;
-  gdouble       left;
-  const guchar *m;
-  guchar       *d;
-  const gint   *k;
-  gint          index1;
-  gint          index2;
-  gint          dest_offset_x = 0;
-  gint          dest_offset_y = 0;
-  const gint   *kernel;
-  gint          i, j;
-  gint          r, s;
-  gulong       *accum[KERNEL_HEIGHT];
-  gint          offs;
-  gint          mask_width  = gimp_temp_buf_get_width  (mask);
-  gint          mask_height = gimp_temp_buf_get_height (mask);
-  gint          dest_width;
-  gint          dest_height;
+  GimpBrushCoreMaskCache *cache;
+  GimpTempBuf            *dest;
+  SubsampleMaskData       data;
+  gdouble                 left;
+  gint                    index1;
+  gint                    index2;
+  gint                    dest_offset_x = 0;
+  gint                    dest_offset_y = 0;
+  const gint             *kernel;
+  gint                    mask_width  = gimp_temp_buf_get_width  (mask);
+  gint                    mask_height = gimp_temp_buf_get_height (mask);
+  gint                    dest_width;
+  gint                    dest_height;
 
   while (x < 0)
     x += mask_width;
@@ -1128,21 +1279,10 @@ gimp_brush_core_subsample_mask (GimpBrushCore     *core,
 
   kernel = subsample[index2][index1];
 
-  if (mask == core->last_subsample_brush_mask &&
-      ! core->subsample_cache_invalid)
-    {
-      if (core->subsample_brushes[index2][index1])
-        return core->subsample_brushes[index2][index1];
-    }
-  else
-    {
-      for (i = 0; i < KERNEL_SUBSAMPLE + 1; i++)
-        for (j = 0; j < KERNEL_SUBSAMPLE + 1; j++)
-          g_clear_pointer (&core->subsample_brushes[i][j], gimp_temp_buf_unref);
+  cache = gimp_brush_core_get_mask_cache (core, mask);
 
-      core->last_subsample_brush_mask = mask;
-      core->subsample_cache_invalid   = FALSE;
-    }
+  if (cache->subsample_brushes[index2][index1])
+    return cache->subsample_brushes[index2][index1];
 
   dest = gimp_temp_buf_new (mask_width  + 2,
                             mask_height + 2,
@@ -1152,51 +1292,21 @@ gimp_brush_core_subsample_mask (GimpBrushCore     *core,
   dest_width  = gimp_temp_buf_get_width  (dest);
   dest_height = gimp_temp_buf_get_height (dest);
 
-  /* Allocate and initialize the accum buffer */
-  for (i = 0; i < KERNEL_HEIGHT ; i++)
-    accum[i] = g_new0 (gulong, dest_width + 1);
-
-  core->subsample_brushes[index2][index1] = dest;
-
-  m = gimp_temp_buf_get_data (mask);
-  for (i = 0; i < mask_height; i++)
-    {
-      for (j = 0; j < mask_width; j++)
-        {
-          k = kernel;
-          for (r = 0; r < KERNEL_HEIGHT; r++)
-            {
-              offs = j + dest_offset_x;
-              s = KERNEL_WIDTH;
-              while (s--)
-                accum[r][offs++] += *m * *k++;
-            }
-          m++;
-        }
-
-      /* store the accum buffer into the destination mask */
-      d = gimp_temp_buf_get_data (dest) + (i + dest_offset_y) * dest_width;
-      for (j = 0; j < dest_width; j++)
-        *d++ = (accum[0][j] + 127) / KERNEL_SUM;
-
-      rotate_pointers (accum, KERNEL_HEIGHT);
-
-      memset (accum[KERNEL_HEIGHT - 1], 0, sizeof (gulong) * dest_width);
-    }
+  cache->subsample_brushes[index2][index1] = dest;
 
-  /* store the rest of the accum buffer into the dest mask */
-  while (i + dest_offset_y < dest_height)
-    {
-      d = gimp_temp_buf_get_data (dest) + (i + dest_offset_y) * dest_width;
-      for (j = 0; j < dest_width; j++)
-        *d++ = (accum[0][j] + (KERNEL_SUM / 2)) / KERNEL_SUM;
+  data.mask          = mask;
+  data.dest          = dest;
+  data.kernel        = kernel;
+  data.dest_offset_x = dest_offset_x;
+  data.dest_offset_y = dest_offset_y;
 
-      rotate_pointers (accum, KERNEL_HEIGHT);
-      i++;
-    }
+  gimp_parallel_distribute_range (dest_height,
+                                  MAX (MIN_PARALLEL_SUB_AREA / dest_width, 1),
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_brush_core_subsample_mask_rows,
+                                  &data);
 
-  for (i = 0; i < KERNEL_HEIGHT ; i++)
-    g_free (accum[i]);
+  gimp_brush_core_add_to_mask_cache (core, cache, dest);
 
   return dest;
 }
@@ -1326,14 +1436,15 @@ gimp_brush_core_solidify_mask (GimpBrushCore     *core,
                                gdouble            x,
                                gdouble            y)
 {
-  GimpTempBuf  *dest;
-  const guchar *m;
-  gfloat       *d;
-  gint          dest_offset_x     = 0;
-  gint          dest_offset_y     = 0;
-  gint          brush_mask_width  = gimp_temp_buf_get_width  (brush_mask);
-  gint          brush_mask_height = gimp_temp_buf_get_height (brush_mask);
-  gint          i, j;
+  GimpBrushCoreMaskCache *cache;
+  GimpTempBuf            *dest;
+  const guchar           *m;
+  gfloat                 *d;
+  gint                    dest_offset_x     = 0;
+  gint                    dest_offset_y     = 0;
+  gint                    brush_mask_width  = gimp_temp_buf_get_width  (brush_mask);
+  gint                    brush_mask_height = gimp_temp_buf_get_height (brush_mask);
+  gint                    i, j;
 
   if ((brush_mask_width % 2) == 0)
     {
@@ -1353,28 +1464,17 @@ gimp_brush_core_solidify_mask (GimpBrushCore     *core,
         dest_offset_y++;
     }
 
-  if (! core->solid_cache_invalid &&
-      brush_mask == core->last_solid_brush_mask)
-    {
-      if (core->solid_brushes[dest_offset_y][dest_offset_x])
-        return core->solid_brushes[dest_offset_y][dest_offset_x];
-    }
-  else
-    {
-      for (i = 0; i < BRUSH_CORE_SOLID_SUBSAMPLE; i++)
-        for (j = 0; j < BRUSH_CORE_SOLID_SUBSAMPLE; j++)
-          g_clear_pointer (&core->solid_brushes[i][j], gimp_temp_buf_unref);
+  cache = gimp_brush_core_get_mask_cache (core, brush_mask);
 
-      core->last_solid_brush_mask = brush_mask;
-      core->solid_cache_invalid   = FALSE;
-    }
+  if (cache->solid_brushes[dest_offset_y][dest_offset_x])
+    return cache->solid_brushes[dest_offset_y][dest_offset_x];
 
   dest = gimp_temp_buf_new (brush_mask_width  + 2,
                             brush_mask_height + 2,
                             babl_format ("Y float"));
   gimp_temp_buf_data_clear (dest);
 
-  core->solid_brushes[dest_offset_y][dest_offset_x] = dest;
+  cache->solid_brushes[dest_offset_y][dest_offset_x] = dest;
 
   m = gimp_temp_buf_get_data (brush_mask);
   d = ((gfloat *) gimp_temp_buf_get_data (dest) +
@@ -1389,6 +1489,8 @@ gimp_brush_core_solidify_mask (GimpBrushCore     *core,
       d += 2;
     }
 
+  gimp_brush_core_add_to_mask_cache (core, cache, dest);
+
   return dest;
 }
 
@@ -1410,12 +1512,7 @@ gimp_brush_core_transform_mask (GimpBrushCore *core,
                                     core->reflect,
                                     core->hardness);
 
-  if (mask == core->transform_brush)
-    return mask;
-
-  core->transform_brush         = mask;
-  core->subsample_cache_invalid = TRUE;
-  core->solid_cache_invalid     = TRUE;
+  core->transform_brush = mask;
 
   return core->transform_brush;
 }
@@ -1438,11 +1535,7 @@ gimp_brush_core_transform_pixmap (GimpBrushCore *core,
                                         core->reflect,
                                         core->hardness);
 
-  if (pixmap == core->transform_pixmap)
-    return pixmap;
-
-  core->transform_pixmap        = pixmap;
-  core->subsample_cache_invalid = TRUE;
+  core->transform_pixmap = pixmap;
 
   return core->transform_pixmap;
 }
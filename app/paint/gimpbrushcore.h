@@ -25,6 +25,7 @@
 #define BRUSH_CORE_SUBSAMPLE        4
 #define BRUSH_CORE_SOLID_SUBSAMPLE  2
 #define BRUSH_CORE_JITTER_LUTSIZE   360
+#define BRUSH_CORE_N_MASK_CACHES    32
 
 
 #define GIMP_TYPE_BRUSH_CORE            (gimp_brush_core_get_type ())
@@ -37,6 +38,15 @@
 
 typedef struct _GimpBrushCoreClass GimpBrushCoreClass;
 
+typedef struct
+{
+  GimpTempBuf *mask;
+  GimpTempBuf *subsample_brushes[BRUSH_CORE_SUBSAMPLE + 1][BRUSH_CORE_SUBSAMPLE + 1];
+  GimpTempBuf *solid_brushes[BRUSH_CORE_SOLID_SUBSAMPLE][BRUSH_CORE_SOLID_SUBSAMPLE];
+  gsize        size;
+  guint        last_use;
+} GimpBrushCoreMaskCache;
+
 struct _GimpBrushCore
 {
   GimpPaintCore      parent_instance;
@@ -54,16 +64,15 @@ struct _GimpBrushCore
   /*  brush buffers  */
   GimpTempBuf       *pressure_brush;
 
-  GimpTempBuf       *solid_brushes[BRUSH_CORE_SOLID_SUBSAMPLE][BRUSH_CORE_SOLID_SUBSAMPLE];
-  const GimpTempBuf *last_solid_brush_mask;
-  gboolean           solid_cache_invalid;
-
   const GimpTempBuf *transform_brush;
   const GimpTempBuf *transform_pixmap;
 
-  GimpTempBuf       *subsample_brushes[BRUSH_CORE_SUBSAMPLE + 1][BRUSH_CORE_SUBSAMPLE + 1];
-  const GimpTempBuf *last_subsample_brush_mask;
-  gboolean           subsample_cache_invalid;
+  /*  the subsampled and solidified versions of the last few brush
+   *  masks, so that the masks of all symmetry strokes stay cached
+   */
+  GimpBrushCoreMaskCache  mask_caches[BRUSH_CORE_N_MASK_CACHES];
+  gsize                   mask_caches_size;
+  guint                   mask_caches_clock;
 
   gdouble            jitter;
   gdouble            jitter_lut_x[BRUSH_CORE_JITTER_LUTSIZE];
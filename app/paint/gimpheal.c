@@ -32,6 +32,7 @@
 
 #include "paint-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimpbrush.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpdynamics.h"
@@ -58,6 +59,12 @@
  * It could benefit from a multi-grid evaluation of an initial solution
  * before the main iteration loop.
  *
+ * Large masks, for which the over-relaxation stops at MAX_ITER before
+ * converging, are instead solved with a conjugate gradient, preconditioned
+ * with a multigrid V-cycle.  It converges in 10 to 15 iterations,
+ * whatever the size of the mask, and each of its passes is split across
+ * threads by rows.
+ *
  * I reduced the convergence criteria to 0.1% (0.001) as we are
  * dealing here with RGB integer components, more is overkill.
  *
@@ -342,6 +349,597 @@ gimp_heal_laplace_iteration (gfloat *pixels,
   return err;
 }
 
+/* Tolerate a total deviation-from-smoothness of 0.1 LSBs at 8bit depth. */
+#define EPSILON  (0.1/255)
+#define MAX_ITER 500
+
+/*  the multigrid solver, used for masks larger than MG_MIN_UNKNOWNS pixels  */
+#define MG_MIN_UNKNOWNS   (192 * 192)
+#define MG_MAX_DEPTH      4
+#define MG_MAX_ITER       100
+#define MG_COARSEST_SIZE  4
+#define MG_COARSEST_ITER  8
+#define MG_CORRECTION     1.5f
+#define MG_MAX_PARTS      64
+#define MG_MIN_PART_SIZE  4096
+
+typedef enum
+{
+  MG_OP_SMOOTH_RED,
+  MG_OP_SMOOTH_BLACK,
+  MG_OP_RESIDUAL,
+  MG_OP_RESTRICT,
+  MG_OP_PROLONG,
+  MG_OP_DIRECTION,
+  MG_OP_PRODUCT,
+  MG_OP_UPDATE,
+  MG_OP_DOT
+} MGOp;
+
+/*  the cells of a level are surrounded by a border of empty cells, so that
+ *  the neighbors of each cell can be accessed unconditionally
+ */
+#define MG_CELL(level, x, y) (((y) + 1) * (level)->stride + (x) + 1)
+
+typedef struct
+{
+  gint     width;
+  gint     height;
+  gint     stride;
+
+  /*  the operator: the diagonal, and the weights of the edges to the right
+   *  and bottom neighbors of each cell
+   */
+  guchar  *mask;
+  gfloat  *diag;
+  gfloat  *wx;
+  gfloat  *wy;
+
+  gfloat  *x;
+  gfloat  *b;
+  gfloat  *r;
+} MGLevel;
+
+typedef struct
+{
+  gint       depth;
+  gint       n_levels;
+  MGLevel   *levels;
+
+  /*  the conjugate gradient vectors, on the finest level  */
+  gfloat    *u;
+  gfloat    *r;
+  gfloat    *z;
+  gfloat    *p;
+  gfloat    *q;
+
+  /*  the current operation  */
+  MGOp       op;
+  MGLevel   *level;
+  gint       n_parts;
+  gfloat     alpha[MG_MAX_DEPTH];
+  gfloat     beta[MG_MAX_DEPTH];
+  gdouble    sums[MG_MAX_PARTS][MG_MAX_DEPTH];
+} MGSolver;
+
+
+/*  stores A v at cell 'o' of 'level' in 'result'  */
+static inline void
+gimp_heal_mg_apply (const MGLevel *level,
+                    const gfloat  *v,
+                    gint           depth,
+                    gint           o,
+                    gfloat        *result)
+{
+  const gint    s  = level->stride;
+  const gfloat  d  = level->diag[o];
+  const gfloat  wl = level->wx[o - 1];
+  const gfloat  wr = level->wx[o];
+  const gfloat  wt = level->wy[o - s];
+  const gfloat  wb = level->wy[o];
+  const gfloat *c  = v + o * depth;
+  gint          k;
+
+  for (k = 0; k < depth; k++)
+    {
+      result[k] = d * c[k] - (wl * c[k - depth]     +
+                              wr * c[k + depth]     +
+                              wt * c[k - s * depth] +
+                              wb * c[k + s * depth]);
+    }
+}
+
+static void
+gimp_heal_mg_rows (MGSolver *solver,
+                   gint      part,
+                   gint      y1,
+                   gint      y2)
+{
+  MGLevel    *level = solver->level;
+  const gint  depth = solver->depth;
+  const gint  width = level->width;
+  gdouble    *sum   = solver->sums[part];
+  gfloat      a[MG_MAX_DEPTH];
+  gint        x, y, k;
+
+  for (k = 0; k < depth; k++)
+    sum[k] = 0.0;
+
+  for (y = y1; y < y2; y++)
+    {
+      gint row = MG_CELL (level, 0, y);
+
+      switch (solver->op)
+        {
+        case MG_OP_SMOOTH_RED:
+        case MG_OP_SMOOTH_BLACK:
+          /*  Gauss-Seidel on the cells of one color, which only depend on
+           *  the cells of the other one.  a coarse cell can be left with
+           *  nothing but inner edges, and a zero diagonal.
+           */
+          for (x = (y + (solver->op == MG_OP_SMOOTH_BLACK)) & 1;
+               x < width;
+               x += 2)
+            {
+              gint o = row + x;
+
+              if (! level->mask[o] || level->diag[o] <= 0.0f)
+                continue;
+
+              gimp_heal_mg_apply (level, level->x, depth, o, a);
+
+              for (k = 0; k < depth; k++)
+                {
+                  level->x[o * depth + k] += (level->b[o * depth + k] - a[k]) /
+                                             level->diag[o];
+                }
+            }
+          break;
+
+        case MG_OP_RESIDUAL:
+          for (x = 0; x < width; x++)
+            {
+              gint o = row + x;
+
+              if (! level->mask[o])
+                continue;
+
+              gimp_heal_mg_apply (level, level->x, depth, o, a);
+
+              for (k = 0; k < depth; k++)
+                level->r[o * depth + k] = level->b[o * depth + k] - a[k];
+            }
+          break;
+
+        case MG_OP_RESTRICT:
+          /*  'level' is the coarse level, sum the residuals of the fine
+           *  cells of each coarse cell.  the residual is zero outside of
+           *  the mask, including the border.
+           */
+          {
+            MGLevel *fine = level - 1;
+
+            for (x = 0; x < width; x++)
+              {
+                gint o  = row + x;
+                gint fo = MG_CELL (fine, 2 * x, 2 * y);
+
+                for (k = 0; k < depth; k++)
+                  {
+                    level->b[o * depth + k] =
+                      fine->r[fo * depth + k]                        +
+                      fine->r[(fo + 1) * depth + k]                  +
+                      fine->r[(fo + fine->stride) * depth + k]       +
+                      fine->r[(fo + fine->stride + 1) * depth + k];
+
+                    level->x[o * depth + k] = 0.0f;
+                  }
+              }
+          }
+          break;
+
+        case MG_OP_PROLONG:
+          /*  'level' is the fine level, add the coarse correction.  the
+           *  correction of the piecewise constant interpolation is too
+           *  weak, and is boosted.
+           */
+          {
+            MGLevel *coarse = level + 1;
+
+            for (x = 0; x < width; x++)
+              {
+                gint o  = row + x;
+                gint co = MG_CELL (coarse, x / 2, y / 2);
+
+                if (! level->mask[o])
+                  continue;
+
+                for (k = 0; k < depth; k++)
+                  {
+                    level->x[o * depth + k] += MG_CORRECTION *
+                                               coarse->x[co * depth + k];
+                  }
+              }
+          }
+          break;
+
+        case MG_OP_DIRECTION:
+          /*  p = z + beta p  */
+          for (x = row * depth; x < (row + width) * depth; x += depth)
+            for (k = 0; k < depth; k++)
+              solver->p[x + k] = solver->z[x + k] + solver->beta[k] * solver->p[x + k];
+          break;
+
+        case MG_OP_PRODUCT:
+          /*  q = A p, sum = p . q  */
+          for (x = 0; x < width; x++)
+            {
+              gint o = row + x;
+
+              if (! level->mask[o])
+                continue;
+
+              gimp_heal_mg_apply (level, solver->p, depth, o, a);
+
+              for (k = 0; k < depth; k++)
+                {
+                  solver->q[o * depth + k] = a[k];
+                  sum[k] += solver->p[o * depth + k] * a[k];
+                }
+            }
+          break;
+
+        case MG_OP_UPDATE:
+          /*  u += alpha p, r -= alpha q, sum = r . r  */
+          for (x = row * depth; x < (row + width) * depth; x += depth)
+            for (k = 0; k < depth; k++)
+              {
+                solver->u[x + k] += solver->alpha[k] * solver->p[x + k];
+                solver->r[x + k] -= solver->alpha[k] * solver->q[x + k];
+
+                sum[k] += solver->r[x + k] * solver->r[x + k];
+              }
+          break;
+
+        case MG_OP_DOT:
+          /*  sum = r . z  */
+          for (x = row * depth; x < (row + width) * depth; x += depth)
+            for (k = 0; k < depth; k++)
+              sum[k] += solver->r[x + k] * solver->z[x + k];
+          break;
+        }
+    }
+}
+
+static void
+gimp_heal_mg_distribute (gint      i,
+                         gint      n,
+                         MGSolver *solver)
+{
+  gint height = solver->level->height;
+  gint part;
+
+  /*  the parts don't depend on the number of threads, and neither do the
+   *  sums
+   */
+  for (part = i; part < solver->n_parts; part += n)
+    {
+      gimp_heal_mg_rows (solver, part,
+                         (gint64) part       * height / solver->n_parts,
+                         (gint64) (part + 1) * height / solver->n_parts);
+    }
+}
+
+/*  runs 'op' over all rows of 'level', and returns the per-component sums
+ *  of the operation in 'sum', if not NULL
+ */
+static void
+gimp_heal_mg_run (MGSolver *solver,
+                  MGOp      op,
+                  MGLevel  *level,
+                  gdouble  *sum)
+{
+  gint part;
+  gint k;
+
+  solver->op      = op;
+  solver->level   = level;
+  solver->n_parts = CLAMP (level->width * level->height / MG_MIN_PART_SIZE,
+                           1, MIN (MG_MAX_PARTS, level->height));
+
+  if (solver->n_parts > 1)
+    {
+      gimp_parallel_distribute (solver->n_parts,
+                                (GimpParallelDistributeFunc) gimp_heal_mg_distribute,
+                                solver);
+    }
+  else
+    {
+      gimp_heal_mg_rows (solver, 0, 0, level->height);
+    }
+
+  if (sum)
+    {
+      for (k = 0; k < solver->depth; k++)
+        {
+          sum[k] = 0.0;
+
+          for (part = 0; part < solver->n_parts; part++)
+            sum[k] += solver->sums[part][k];
+        }
+    }
+}
+
+/*  approximately solves A x = b on level 'l', starting from x = 0, using a
+ *  V-cycle.  the smoothing order is reversed on the way up, which keeps
+ *  the cycle symmetric, as required by the conjugate gradient.
+ */
+static void
+gimp_heal_mg_cycle (MGSolver *solver,
+                    gint      l)
+{
+  MGLevel *level  = &solver->levels[l];
+  gint     n_iter = 1;
+  gint     i;
+
+  if (l == solver->n_levels - 1)
+    n_iter = MG_COARSEST_ITER;
+
+  for (i = 0; i < n_iter; i++)
+    {
+      gimp_heal_mg_run (solver, MG_OP_SMOOTH_RED,   level, NULL);
+      gimp_heal_mg_run (solver, MG_OP_SMOOTH_BLACK, level, NULL);
+    }
+
+  if (l < solver->n_levels - 1)
+    {
+      gimp_heal_mg_run (solver, MG_OP_RESIDUAL, level,     NULL);
+      gimp_heal_mg_run (solver, MG_OP_RESTRICT, level + 1, NULL);
+
+      gimp_heal_mg_cycle (solver, l + 1);
+
+      gimp_heal_mg_run (solver, MG_OP_PROLONG,  level,     NULL);
+    }
+
+  for (i = 0; i < n_iter; i++)
+    {
+      gimp_heal_mg_run (solver, MG_OP_SMOOTH_BLACK, level, NULL);
+      gimp_heal_mg_run (solver, MG_OP_SMOOTH_RED,   level, NULL);
+    }
+}
+
+static void
+gimp_heal_mg_level_init (MGLevel *level,
+                         gint     width,
+                         gint     height,
+                         gint     depth)
+{
+  gint size;
+
+  level->width  = width;
+  level->height = height;
+  level->stride = width + 2;
+
+  size = level->stride * (height + 2);
+
+  level->mask = g_new0 (guchar, size);
+  level->diag = g_new0 (gfloat, size);
+  level->wx   = g_new0 (gfloat, size);
+  level->wy   = g_new0 (gfloat, size);
+  level->r    = g_new0 (gfloat, size * depth);
+}
+
+/*  builds the coarse level of 'fine', as the Galerkin product of the fine
+ *  operator with the piecewise constant interpolation
+ */
+static void
+gimp_heal_mg_coarsen (const MGLevel *fine,
+                      MGLevel       *coarse,
+                      gint           depth)
+{
+  gint x, y;
+
+  gimp_heal_mg_level_init (coarse,
+                           (fine->width + 1) / 2, (fine->height + 1) / 2,
+                           depth);
+
+  coarse->x = g_new0 (gfloat, coarse->stride * (coarse->height + 2) * depth);
+  coarse->b = g_new0 (gfloat, coarse->stride * (coarse->height + 2) * depth);
+
+  for (y = 0; y < fine->height; y++)
+    for (x = 0; x < fine->width; x++)
+      {
+        gint fo = MG_CELL (fine,   x,     y);
+        gint co = MG_CELL (coarse, x / 2, y / 2);
+
+        if (! fine->mask[fo])
+          continue;
+
+        coarse->mask[co]  = TRUE;
+        coarse->diag[co] += fine->diag[fo];
+
+        /*  edges inside a coarse cell cancel out, edges between two coarse
+         *  cells add up
+         */
+        if (x & 1)
+          coarse->wx[co]   += fine->wx[fo];
+        else
+          coarse->diag[co] -= 2.0f * fine->wx[fo];
+
+        if (y & 1)
+          coarse->wy[co]   += fine->wy[fo];
+        else
+          coarse->diag[co] -= 2.0f * fine->wy[fo];
+      }
+}
+
+/* Solve the laplace equation for pixels using a conjugate gradient,
+ * preconditioned with a multigrid cycle, and store the result in-place.
+ */
+static void
+gimp_heal_laplace_mg (gfloat *pixels,
+                      gint    height,
+                      gint    depth,
+                      gint    width,
+                      guchar *mask)
+{
+  MGSolver *solver;
+  MGLevel  *fine;
+  gint      size;
+  gdouble   rz[MG_MAX_DEPTH] = { 0.0, };
+  gdouble   rr[MG_MAX_DEPTH] = { 0.0, };
+  gdouble   sum[MG_MAX_DEPTH];
+  gint      x, y, k, l, iter;
+
+  solver = g_new0 (MGSolver, 1);
+
+  solver->depth    = depth;
+  solver->n_levels = 1;
+
+  for (x = width, y = height;
+       MAX (x, y) > MG_COARSEST_SIZE;
+       x = (x + 1) / 2, y = (y + 1) / 2)
+    {
+      solver->n_levels++;
+    }
+
+  solver->levels = g_new0 (MGLevel, solver->n_levels);
+
+  fine = &solver->levels[0];
+
+  gimp_heal_mg_level_init (fine, width, height, depth);
+
+  size = fine->stride * (height + 2) * depth;
+
+  solver->u = g_new0 (gfloat, 5 * size);
+  solver->r = solver->u + 1 * size;
+  solver->z = solver->u + 2 * size;
+  solver->p = solver->u + 3 * size;
+  solver->q = solver->u + 4 * size;
+
+  /*  on the finest level, the cycle takes the residual of the conjugate
+   *  gradient to its preconditioned direction
+   */
+  fine->x = solver->z;
+  fine->b = solver->r;
+
+  /*  set up the operator, and the initial residual r = b - A u, where b
+   *  holds the fixed neighbors of each unknown.  neighbors off the edge
+   *  of the canvas are omitted, like in the over-relaxation.
+   */
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        const gint dx[4] = { 1, 0, -1,  0 };
+        const gint dy[4] = { 0, 1,  0, -1 };
+        gint       i     = y * width + x;
+        gint       o     = MG_CELL (fine, x, y);
+        gint       n;
+
+        if (! mask[i])
+          continue;
+
+        fine->mask[o] = TRUE;
+
+        if (x < width - 1 && mask[i + 1])
+          fine->wx[o] = 1.0f;
+        if (y < height - 1 && mask[i + width])
+          fine->wy[o] = 1.0f;
+
+        for (n = 0; n < 4; n++)
+          {
+            gint nx = x + dx[n];
+            gint ny = y + dy[n];
+
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+              continue;
+
+            fine->diag[o] += 1.0f;
+
+            for (k = 0; k < depth; k++)
+              solver->r[o * depth + k] += pixels[(ny * width + nx) * depth + k];
+          }
+
+        for (k = 0; k < depth; k++)
+          {
+            solver->u[o * depth + k]  = pixels[i * depth + k];
+            solver->r[o * depth + k] -= fine->diag[o] * pixels[i * depth + k];
+
+            rr[k] += (gdouble) solver->r[o * depth + k] *
+                               solver->r[o * depth + k];
+          }
+      }
+
+  for (l = 1; l < solver->n_levels; l++)
+    gimp_heal_mg_coarsen (&solver->levels[l - 1], &solver->levels[l], depth);
+
+  for (iter = 0; iter < MG_MAX_ITER; iter++)
+    {
+      gdouble err = 0.0;
+
+      for (k = 0; k < depth; k++)
+        err += rr[k];
+
+      if (err < EPSILON * EPSILON)
+        break;
+
+      /*  z = M^-1 r  */
+      memset (solver->z, 0, size * sizeof (gfloat));
+
+      gimp_heal_mg_cycle (solver, 0);
+
+      gimp_heal_mg_run (solver, MG_OP_DOT, fine, sum);
+
+      for (k = 0; k < depth; k++)
+        {
+          solver->beta[k] = iter > 0 && rz[k] > 0.0 ? sum[k] / rz[k] : 0.0;
+          rz[k]           = sum[k];
+        }
+
+      gimp_heal_mg_run (solver, MG_OP_DIRECTION, fine, NULL);
+      gimp_heal_mg_run (solver, MG_OP_PRODUCT,   fine, sum);
+
+      for (k = 0; k < depth; k++)
+        solver->alpha[k] = sum[k] > 0.0 ? rz[k] / sum[k] : 0.0;
+
+      gimp_heal_mg_run (solver, MG_OP_UPDATE, fine, rr);
+    }
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gint i = y * width + x;
+        gint o = MG_CELL (fine, x, y);
+
+        if (mask[i])
+          {
+            for (k = 0; k < depth; k++)
+              pixels[i * depth + k] = solver->u[o * depth + k];
+          }
+      }
+
+  for (l = 0; l < solver->n_levels; l++)
+    {
+      MGLevel *level = &solver->levels[l];
+
+      if (l > 0)
+        {
+          g_free (level->x);
+          g_free (level->b);
+        }
+
+      g_free (level->mask);
+      g_free (level->diag);
+      g_free (level->wx);
+      g_free (level->wy);
+      g_free (level->r);
+    }
+
+  g_free (solver->levels);
+  g_free (solver->u);
+  g_free (solver);
+}
+
 /* Solve the laplace equation for pixels and store the result in-place.
  */
 static void
@@ -351,15 +949,25 @@ gimp_heal_laplace_loop (gfloat *pixels,
                         gint    width,
                         guchar *mask)
 {
-  /* Tolerate a total deviation-from-smoothness of 0.1 LSBs at 8bit depth. */
-#define EPSILON  (0.1/255)
-#define MAX_ITER 500
-
   gint    i, j, iter, parity, nmask, zero;
   gfloat *Adiag;
   gint   *Aidx;
   gfloat  w;
 
+  if (depth <= MG_MAX_DEPTH)
+    {
+      nmask = 0;
+      for (i = 0; i < width * height; i++)
+        nmask += mask[i] != 0;
+
+      if (nmask >= MG_MIN_UNKNOWNS)
+        {
+          gimp_heal_laplace_mg (pixels, height, depth, width, mask);
+
+          return;
+        }
+    }
+
   Adiag = g_new (gfloat, width * height);
   Aidx  = g_new (gint, 5 * width * height);
 
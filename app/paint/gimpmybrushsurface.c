@@ -29,10 +29,53 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include "libgimpcolor/gimpcolor.h"
 
+#include "core/gimp-parallel.h"
+
 #include "gimpmybrushoptions.h"
 #include "gimpmybrushsurface.h"
 
 
+/*  between begin_atomic() and end_atomic(), the surface keeps the pixels
+ *  it touches in linear tiles of its own.  dabs are queued on the tiles
+ *  they overlap, and each tile's queue is applied in order, the tiles in
+ *  parallel, when the pixels are needed: before sampling a color, and at
+ *  end_atomic(), where the modified part of each tile is written back to
+ *  the buffer and the tiles are dropped.
+ */
+#define TILE_SIZE 64
+
+
+typedef struct
+{
+  GeglRectangle rect;
+  float         x;
+  float         y;
+  float         radius;
+  float         color_r;
+  float         color_g;
+  float         color_b;
+  float         color_a;
+  float         hardness;
+  float         aspect_ratio;
+  float         sn;
+  float         cs;
+  float         one_over_radius2;
+  float         segment1_slope;
+  float         segment2_slope;
+  float         r_aa_start;
+  float         normal_mode;
+  float         colorize;
+} GimpMybrushDab;
+
+typedef struct
+{
+  GeglRectangle  rect;
+  gfloat        *pixels;
+  gfloat        *mask;
+  GArray        *dabs;
+  GeglRectangle  dirty;
+} GimpMybrushTile;
+
 struct _GimpMybrushSurface
 {
   MyPaintSurface surface;
@@ -43,6 +86,10 @@ struct _GimpMybrushSurface
   GeglRectangle dirty;
   GimpComponentMask component_mask;
   GimpMybrushOptions *options;
+
+  GHashTable *tiles;
+  GPtrArray  *pending_tiles;
+  GArray     *dabs;
 };
 
 /* --- Taken from mypaint-tiled-surface.c --- */
@@ -230,6 +277,269 @@ calculate_dab_roi (float x,
   return *GEGL_RECTANGLE (x0, y0, x1 - x0, y1 - y0);
 }
 
+static guint
+gimp_mypaint_tile_hash (gconstpointer key)
+{
+  const GeglRectangle *rect = key;
+
+  return (guint) rect->x * 73856093u ^ (guint) rect->y * 19349663u;
+}
+
+static gboolean
+gimp_mypaint_tile_equal (gconstpointer a,
+                         gconstpointer b)
+{
+  const GeglRectangle *rect_a = a;
+  const GeglRectangle *rect_b = b;
+
+  return rect_a->x == rect_b->x && rect_a->y == rect_b->y;
+}
+
+static void
+gimp_mypaint_tile_free (GimpMybrushTile *tile)
+{
+  g_free (tile->pixels);
+  g_free (tile->mask);
+  g_array_free (tile->dabs, TRUE);
+
+  g_slice_free (GimpMybrushTile, tile);
+}
+
+/* returns the origin of the tile containing 'x', which must lie inside
+ * the buffer.  the tiles are aligned to the buffer's origin.
+ */
+static inline gint
+gimp_mypaint_tile_origin (gint x,
+                          gint extent_x)
+{
+  return x - (x - extent_x) % TILE_SIZE;
+}
+
+/* returns the tile containing pixel (x, y), which must lie inside the
+ * buffer, reading it from the buffer if it's not cached yet
+ */
+static GimpMybrushTile *
+gimp_mypaint_surface_get_tile (GimpMybrushSurface *surface,
+                               gint                x,
+                               gint                y)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (surface->buffer);
+  GimpMybrushTile     *tile;
+  GeglRectangle        key;
+
+  key.x = gimp_mypaint_tile_origin (x, extent->x);
+  key.y = gimp_mypaint_tile_origin (y, extent->y);
+
+  tile = g_hash_table_lookup (surface->tiles, &key);
+
+  if (! tile)
+    {
+      tile = g_slice_new0 (GimpMybrushTile);
+
+      tile->rect = *GEGL_RECTANGLE (key.x, key.y, TILE_SIZE, TILE_SIZE);
+      gegl_rectangle_intersect (&tile->rect, &tile->rect, extent);
+
+      tile->pixels = g_new (gfloat, tile->rect.width * tile->rect.height * 4);
+      tile->dabs   = g_array_new (FALSE, FALSE, sizeof (guint));
+
+      gegl_buffer_get (surface->buffer, &tile->rect, 1.0,
+                       babl_format ("R'G'B'A float"), tile->pixels,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      if (surface->paint_mask)
+        {
+          GeglRectangle mask_roi = tile->rect;
+          mask_roi.x -= surface->paint_mask_x;
+          mask_roi.y -= surface->paint_mask_y;
+
+          tile->mask = g_new (gfloat, tile->rect.width * tile->rect.height);
+
+          gegl_buffer_get (surface->paint_mask, &mask_roi, 1.0,
+                           babl_format ("Y float"), tile->mask,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+        }
+
+      g_hash_table_insert (surface->tiles, &tile->rect, tile);
+    }
+
+  return tile;
+}
+
+static void
+gimp_mypaint_surface_apply_dab (GimpMybrushSurface   *surface,
+                                GimpMybrushTile      *tile,
+                                const GimpMybrushDab *dab)
+{
+  GimpComponentMask component_mask = surface->component_mask;
+  GeglRectangle     roi;
+  int               iy, ix;
+
+  gegl_rectangle_intersect (&roi, &dab->rect, &tile->rect);
+
+  gegl_rectangle_bounding_box (&tile->dirty, &tile->dirty, &roi);
+
+  for (iy = roi.y; iy < roi.y + roi.height; iy++)
+    {
+      gint   offset = (iy - tile->rect.y) * tile->rect.width +
+                      (roi.x - tile->rect.x);
+      float *pixel  = tile->pixels + 4 * offset;
+      float *mask   = tile->mask ? tile->mask + offset : NULL;
+
+      for (ix = roi.x; ix < roi.x + roi.width; ix++)
+        {
+          float rr, base_alpha, alpha, dst_alpha, r, g, b, a;
+          if (dab->radius < 3.0f)
+            rr = calculate_rr_antialiased (ix, iy, dab->x, dab->y, dab->aspect_ratio, dab->sn, dab->cs, dab->one_over_radius2, dab->r_aa_start);
+          else
+            rr = calculate_rr (ix, iy, dab->x, dab->y, dab->aspect_ratio, dab->sn, dab->cs, dab->one_over_radius2);
+          base_alpha = calculate_alpha_for_rr (rr, dab->hardness, dab->segment1_slope, dab->segment2_slope);
+          alpha = base_alpha * dab->normal_mode;
+          if (mask)
+            alpha *= *mask;
+          dst_alpha = pixel[ALPHA];
+          /* a = alpha * color_a + dst_alpha * (1.0f - alpha);
+           * which converts to: */
+          a = alpha * (dab->color_a - dst_alpha) + dst_alpha;
+          r = pixel[RED];
+          g = pixel[GREEN];
+          b = pixel[BLUE];
+
+          if (a > 0.0f)
+            {
+              /* By definition the ratio between each color[] and pixel[] component in a non-pre-multipled blend always sums to 1.0f.
+               * Originaly this would have been "(color[n] * alpha * color_a + pixel[n] * dst_alpha * (1.0f - alpha)) / a",
+               * instead we only calculate the cheaper term. */
+              float src_term = (alpha * dab->color_a) / a;
+              float dst_term = 1.0f - src_term;
+              r = dab->color_r * src_term + r * dst_term;
+              g = dab->color_g * src_term + g * dst_term;
+              b = dab->color_b * src_term + b * dst_term;
+            }
+
+          if (dab->colorize > 0.0f && base_alpha > 0.0f)
+            {
+              alpha = base_alpha * dab->colorize;
+              a = alpha + dst_alpha - alpha * dst_alpha;
+              if (a > 0.0f)
+                {
+                  GimpHSL pixel_hsl, out_hsl;
+                  GimpRGB pixel_rgb = {dab->color_r, dab->color_g, dab->color_b};
+                  GimpRGB out_rgb   = {r, g, b};
+                  float src_term = alpha / a;
+                  float dst_term = 1.0f - src_term;
+
+                  gimp_rgb_to_hsl (&pixel_rgb, &pixel_hsl);
+                  gimp_rgb_to_hsl (&out_rgb, &out_hsl);
+
+                  out_hsl.h = pixel_hsl.h;
+                  out_hsl.s = pixel_hsl.s;
+                  gimp_hsl_to_rgb (&out_hsl, &out_rgb);
+
+                  r = (float)out_rgb.r * src_term + r * dst_term;
+                  g = (float)out_rgb.g * src_term + g * dst_term;
+                  b = (float)out_rgb.b * src_term + b * dst_term;
+                }
+            }
+
+          if (surface->options->no_erasing)
+            a = MAX (a, pixel[ALPHA]);
+
+          if (component_mask != GIMP_COMPONENT_MASK_ALL)
+            {
+              if (component_mask & GIMP_COMPONENT_MASK_RED)
+                pixel[RED]   = r;
+              if (component_mask & GIMP_COMPONENT_MASK_GREEN)
+                pixel[GREEN] = g;
+              if (component_mask & GIMP_COMPONENT_MASK_BLUE)
+                pixel[BLUE]  = b;
+              if (component_mask & GIMP_COMPONENT_MASK_ALPHA)
+                pixel[ALPHA] = a;
+            }
+          else
+            {
+              pixel[RED]   = r;
+              pixel[GREEN] = g;
+              pixel[BLUE]  = b;
+              pixel[ALPHA] = a;
+            }
+
+          pixel += 4;
+          if (mask)
+            mask += 1;
+        }
+    }
+}
+
+static void
+gimp_mypaint_surface_process_tiles (gint                i,
+                                    gint                n,
+                                    GimpMybrushSurface *surface)
+{
+  gint k;
+
+  for (k = i; k < surface->pending_tiles->len; k += n)
+    {
+      GimpMybrushTile *tile = g_ptr_array_index (surface->pending_tiles, k);
+      gint             d;
+
+      for (d = 0; d < tile->dabs->len; d++)
+        {
+          guint index = g_array_index (tile->dabs, guint, d);
+
+          gimp_mypaint_surface_apply_dab (surface, tile,
+                                          &g_array_index (surface->dabs,
+                                                          GimpMybrushDab,
+                                                          index));
+        }
+
+      g_array_set_size (tile->dabs, 0);
+    }
+}
+
+/* applies all the queued dabs to their tiles */
+static void
+gimp_mypaint_surface_process_dabs (GimpMybrushSurface *surface)
+{
+  if (surface->pending_tiles->len == 0)
+    return;
+
+  gimp_parallel_distribute (surface->pending_tiles->len,
+                            (GimpParallelDistributeFunc)
+                            gimp_mypaint_surface_process_tiles,
+                            surface);
+
+  g_ptr_array_set_size (surface->pending_tiles, 0);
+  g_array_set_size (surface->dabs, 0);
+}
+
+/* writes the modified tiles back to the buffer, and drops the cache */
+static void
+gimp_mypaint_surface_flush (GimpMybrushSurface *surface)
+{
+  GHashTableIter   iter;
+  GimpMybrushTile *tile;
+
+  gimp_mypaint_surface_process_dabs (surface);
+
+  g_hash_table_iter_init (&iter, surface->tiles);
+
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &tile))
+    {
+      if (tile->dirty.width > 0 && tile->dirty.height > 0)
+        {
+          gint offset = (tile->dirty.y - tile->rect.y) * tile->rect.width +
+                        (tile->dirty.x - tile->rect.x);
+
+          gegl_buffer_set (surface->buffer, &tile->dirty, 0,
+                           babl_format ("R'G'B'A float"),
+                           tile->pixels + 4 * offset,
+                           tile->rect.width * 4 * sizeof (gfloat));
+        }
+    }
+
+  g_hash_table_remove_all (surface->tiles);
+}
+
 static void
 gimp_mypaint_surface_get_color (MyPaintSurface *base_surface,
                                 float           x,
@@ -255,63 +565,66 @@ gimp_mypaint_surface_get_color (MyPaintSurface *base_surface,
 
   if (dabRect.width > 0 || dabRect.height > 0)
   {
+    const GeglRectangle *extent = gegl_buffer_get_extent (surface->buffer);
     const float one_over_radius2 = 1.0f / (radius * radius);
+    GimpMybrushTile *tile = NULL;
     float sum_weight = 0.0f;
     float sum_r = 0.0f;
     float sum_g = 0.0f;
     float sum_b = 0.0f;
     float sum_a = 0.0f;
+    int iy, ix;
 
-     /* Read in clamp mode to avoid transparency bleeding in at the edges */
-    GeglBufferIterator *iter = gegl_buffer_iterator_new (surface->buffer, &dabRect, 0,
-                                                         babl_format ("R'aG'aB'aA float"),
-                                                         GEGL_BUFFER_READ,
-                                                         GEGL_ABYSS_CLAMP);
-    if (surface->paint_mask)
-      {
-        GeglRectangle mask_roi = dabRect;
-        mask_roi.x -= surface->paint_mask_x;
-        mask_roi.y -= surface->paint_mask_y;
-        gegl_buffer_iterator_add (iter, surface->paint_mask, &mask_roi, 0,
-                                  babl_format ("Y float"),
-                                  GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-      }
+    if (extent->width <= 0 || extent->height <= 0)
+      return;
 
-    while (gegl_buffer_iterator_next (iter))
-      {
-        float *pixel = (float *)iter->data[0];
-        float *mask;
-        int iy, ix;
+    /* sample the pixels as the queued dabs leave them */
+    gimp_mypaint_surface_process_dabs (surface);
 
-        if (surface->paint_mask)
-          mask = iter->data[1];
-        else
-          mask = NULL;
+    for (iy = dabRect.y; iy < dabRect.y + dabRect.height; iy++)
+      {
+        /* Read in clamp mode to avoid transparency bleeding in at the edges */
+        int   py = CLAMP (iy, extent->y, extent->y + extent->height - 1);
+        float yy = (iy + 0.5f - y);
 
-        for (iy = iter->roi[0].y; iy < iter->roi[0].y + iter->roi[0].height; iy++)
+        for (ix = dabRect.x; ix < dabRect.x + dabRect.width; ix++)
           {
-            float yy = (iy + 0.5f - y);
-            for (ix = iter->roi[0].x; ix < iter->roi[0].x +  iter->roi[0].width; ix++)
+            int          px = CLAMP (ix, extent->x, extent->x + extent->width - 1);
+            gint         offset;
+            const float *pixel;
+            float        alpha;
+
+            /* pixel_weight == a standard dab with hardness = 0.5, aspect_ratio = 1.0, and angle = 0.0 */
+            float xx = (ix + 0.5f - x);
+            float rr = (yy * yy + xx * xx) * one_over_radius2;
+            float pixel_weight = 0.0f;
+            if (rr <= 1.0f)
+              pixel_weight = 1.0f - rr;
+
+            if (! tile ||
+                px <  tile->rect.x || px >= tile->rect.x + tile->rect.width ||
+                py <  tile->rect.y || py >= tile->rect.y + tile->rect.height)
               {
-                /* pixel_weight == a standard dab with hardness = 0.5, aspect_ratio = 1.0, and angle = 0.0 */
-                float xx = (ix + 0.5f - x);
-                float rr = (yy * yy + xx * xx) * one_over_radius2;
-                float pixel_weight = 0.0f;
-                if (rr <= 1.0f)
-                  pixel_weight = 1.0f - rr;
-                if (mask)
-                  pixel_weight *= *mask;
-
-                sum_r += pixel_weight * pixel[RED];
-                sum_g += pixel_weight * pixel[GREEN];
-                sum_b += pixel_weight * pixel[BLUE];
-                sum_a += pixel_weight * pixel[ALPHA];
-                sum_weight += pixel_weight;
-
-                pixel += 4;
-                if (mask)
-                  mask += 1;
+                tile = gimp_mypaint_surface_get_tile (surface, px, py);
               }
+
+            offset = (py - tile->rect.y) * tile->rect.width + (px - tile->rect.x);
+            pixel  = tile->pixels + 4 * offset;
+
+            /* the mask is only cached inside the buffer, and taken as
+             * zero outside of it
+             */
+            if (tile->mask)
+              pixel_weight *= (ix == px && iy == py) ? tile->mask[offset] : 0.0f;
+
+            /* the tiles are not premultiplied */
+            alpha = pixel[ALPHA];
+
+            sum_r += pixel_weight * (pixel[RED]   * alpha);
+            sum_g += pixel_weight * (pixel[GREEN] * alpha);
+            sum_b += pixel_weight * (pixel[BLUE]  * alpha);
+            sum_a += pixel_weight * alpha;
+            sum_weight += pixel_weight;
           }
       }
 
@@ -352,150 +665,69 @@ gimp_mypaint_surface_draw_dab (MyPaintSurface *base_surface,
                                float           lock_alpha,
                                float           colorize)
 {
-  GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
-  GeglBufferIterator *iter;
-  GeglRectangle       dabRect;
-  GimpComponentMask   component_mask = surface->component_mask;
+  GimpMybrushSurface  *surface = (GimpMybrushSurface *)base_surface;
+  const GeglRectangle *extent  = gegl_buffer_get_extent (surface->buffer);
+  GimpMybrushDab       dab;
+  guint                index;
+  gint                 tx, ty;
 
-  const float one_over_radius2 = 1.0f / (radius * radius);
   const double angle_rad = angle / 360 * 2 * M_PI;
-  const float cs = cos(angle_rad);
-  const float sn = sin(angle_rad);
-  float normal_mode;
-  float segment1_slope;
-  float segment2_slope;
-  float r_aa_start;
+
+  dab.x                = x;
+  dab.y                = y;
+  dab.radius           = radius;
+  dab.color_r          = color_r;
+  dab.color_g          = color_g;
+  dab.color_b          = color_b;
+  dab.color_a          = color_a;
+  dab.one_over_radius2 = 1.0f / (radius * radius);
+  dab.cs               = cos(angle_rad);
+  dab.sn               = sin(angle_rad);
 
   hardness = CLAMP (hardness, 0.0f, 1.0f);
-  segment1_slope = -(1.0f / hardness - 1.0f);
-  segment2_slope = -hardness / (1.0f - hardness);
+  dab.hardness       = hardness;
+  dab.segment1_slope = -(1.0f / hardness - 1.0f);
+  dab.segment2_slope = -hardness / (1.0f - hardness);
   aspect_ratio = MAX (1.0f, aspect_ratio);
+  dab.aspect_ratio = aspect_ratio;
 
-  r_aa_start = radius - 1.0f;
-  r_aa_start = MAX (r_aa_start, 0);
-  r_aa_start = (r_aa_start * r_aa_start) / aspect_ratio;
+  dab.r_aa_start = radius - 1.0f;
+  dab.r_aa_start = MAX (dab.r_aa_start, 0);
+  dab.r_aa_start = (dab.r_aa_start * dab.r_aa_start) / aspect_ratio;
 
-  normal_mode = opaque * (1.0f - colorize);
-  colorize = opaque * colorize;
+  dab.normal_mode = opaque * (1.0f - colorize);
+  dab.colorize    = opaque * colorize;
 
   /* FIXME: This should use the real matrix values to trim aspect_ratio dabs */
-  dabRect = calculate_dab_roi (x, y, radius);
-  gegl_rectangle_intersect (&dabRect, &dabRect, gegl_buffer_get_extent (surface->buffer));
+  dab.rect = calculate_dab_roi (x, y, radius);
+  gegl_rectangle_intersect (&dab.rect, &dab.rect, extent);
 
-  if (dabRect.width <= 0 || dabRect.height <= 0)
+  if (dab.rect.width <= 0 || dab.rect.height <= 0)
     return 0;
 
-  gegl_rectangle_bounding_box (&surface->dirty, &surface->dirty, &dabRect);
+  gegl_rectangle_bounding_box (&surface->dirty, &surface->dirty, &dab.rect);
 
-  iter = gegl_buffer_iterator_new (surface->buffer, &dabRect, 0,
-                                   babl_format ("R'G'B'A float"),
-                                   GEGL_BUFFER_READWRITE,
-                                   GEGL_ABYSS_NONE);
-  if (surface->paint_mask)
-    {
-      GeglRectangle mask_roi = dabRect;
-      mask_roi.x -= surface->paint_mask_x;
-      mask_roi.y -= surface->paint_mask_y;
-      gegl_buffer_iterator_add (iter, surface->paint_mask, &mask_roi, 0,
-                                babl_format ("Y float"),
-                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-    }
+  index = surface->dabs->len;
+  g_array_append_val (surface->dabs, dab);
 
-  while (gegl_buffer_iterator_next (iter))
+  for (ty = gimp_mypaint_tile_origin (dab.rect.y, extent->y);
+       ty < dab.rect.y + dab.rect.height;
+       ty += TILE_SIZE)
     {
-      float *pixel = (float *)iter->data[0];
-      float *mask;
-      int iy, ix;
-
-      if (surface->paint_mask)
-        mask = iter->data[1];
-      else
-        mask = NULL;
-
-      for (iy = iter->roi[0].y; iy < iter->roi[0].y + iter->roi[0].height; iy++)
+      for (tx = gimp_mypaint_tile_origin (dab.rect.x, extent->x);
+           tx < dab.rect.x + dab.rect.width;
+           tx += TILE_SIZE)
         {
-          for (ix = iter->roi[0].x; ix < iter->roi[0].x +  iter->roi[0].width; ix++)
-            {
-              float rr, base_alpha, alpha, dst_alpha, r, g, b, a;
-              if (radius < 3.0f)
-                rr = calculate_rr_antialiased (ix, iy, x, y, aspect_ratio, sn, cs, one_over_radius2, r_aa_start);
-              else
-                rr = calculate_rr (ix, iy, x, y, aspect_ratio, sn, cs, one_over_radius2);
-              base_alpha = calculate_alpha_for_rr (rr, hardness, segment1_slope, segment2_slope);
-              alpha = base_alpha * normal_mode;
-              if (mask)
-                alpha *= *mask;
-              dst_alpha = pixel[ALPHA];
-              /* a = alpha * color_a + dst_alpha * (1.0f - alpha);
-               * which converts to: */
-              a = alpha * (color_a - dst_alpha) + dst_alpha;
-              r = pixel[RED];
-              g = pixel[GREEN];
-              b = pixel[BLUE];
+          GimpMybrushTile *tile;
 
-              if (a > 0.0f)
-                {
-                  /* By definition the ratio between each color[] and pixel[] component in a non-pre-multipled blend always sums to 1.0f.
-                   * Originaly this would have been "(color[n] * alpha * color_a + pixel[n] * dst_alpha * (1.0f - alpha)) / a",
-                   * instead we only calculate the cheaper term. */
-                  float src_term = (alpha * color_a) / a;
-                  float dst_term = 1.0f - src_term;
-                  r = color_r * src_term + r * dst_term;
-                  g = color_g * src_term + g * dst_term;
-                  b = color_b * src_term + b * dst_term;
-                }
+          tile = gimp_mypaint_surface_get_tile (surface,
+                                                MAX (tx, dab.rect.x),
+                                                MAX (ty, dab.rect.y));
 
-              if (colorize > 0.0f && base_alpha > 0.0f)
-                {
-                  alpha = base_alpha * colorize;
-                  a = alpha + dst_alpha - alpha * dst_alpha;
-                  if (a > 0.0f)
-                    {
-                      GimpHSL pixel_hsl, out_hsl;
-                      GimpRGB pixel_rgb = {color_r, color_g, color_b};
-                      GimpRGB out_rgb   = {r, g, b};
-                      float src_term = alpha / a;
-                      float dst_term = 1.0f - src_term;
-
-                      gimp_rgb_to_hsl (&pixel_rgb, &pixel_hsl);
-                      gimp_rgb_to_hsl (&out_rgb, &out_hsl);
-
-                      out_hsl.h = pixel_hsl.h;
-                      out_hsl.s = pixel_hsl.s;
-                      gimp_hsl_to_rgb (&out_hsl, &out_rgb);
-
-                      r = (float)out_rgb.r * src_term + r * dst_term;
-                      g = (float)out_rgb.g * src_term + g * dst_term;
-                      b = (float)out_rgb.b * src_term + b * dst_term;
-                    }
-                }
-
-              if (surface->options->no_erasing)
-                a = MAX (a, pixel[ALPHA]);
+          if (tile->dabs->len == 0)
+            g_ptr_array_add (surface->pending_tiles, tile);
 
-              if (component_mask != GIMP_COMPONENT_MASK_ALL)
-                {
-                  if (component_mask & GIMP_COMPONENT_MASK_RED)
-                    pixel[RED]   = r;
-                  if (component_mask & GIMP_COMPONENT_MASK_GREEN)
-                    pixel[GREEN] = g;
-                  if (component_mask & GIMP_COMPONENT_MASK_BLUE)
-                    pixel[BLUE]  = b;
-                  if (component_mask & GIMP_COMPONENT_MASK_ALPHA)
-                    pixel[ALPHA] = a;
-                }
-              else
-                {
-                  pixel[RED]   = r;
-                  pixel[GREEN] = g;
-                  pixel[BLUE]  = b;
-                  pixel[ALPHA] = a;
-                }
-
-              pixel += 4;
-              if (mask)
-                mask += 1;
-            }
+          g_array_append_val (tile->dabs, index);
         }
     }
 
@@ -514,6 +746,8 @@ gimp_mypaint_surface_end_atomic (MyPaintSurface   *base_surface,
 {
   GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
 
+  gimp_mypaint_surface_flush (surface);
+
   roi->x         = surface->dirty.x;
   roi->y         = surface->dirty.y;
   roi->width     = surface->dirty.width;
@@ -526,6 +760,12 @@ gimp_mypaint_surface_destroy (MyPaintSurface *base_surface)
 {
   GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
 
+  gimp_mypaint_surface_flush (surface);
+
+  g_hash_table_unref (surface->tiles);
+  g_ptr_array_free (surface->pending_tiles, TRUE);
+  g_array_free (surface->dabs, TRUE);
+
   g_clear_object (&surface->buffer);
   g_clear_object (&surface->paint_mask);
 }
@@ -557,5 +797,12 @@ gimp_mypaint_surface_new (GeglBuffer         *buffer,
   surface->paint_mask_y         = paint_mask_y;
   surface->dirty                = *GEGL_RECTANGLE (0, 0, 0, 0);
 
+  surface->tiles         = g_hash_table_new_full (gimp_mypaint_tile_hash,
+                                                  gimp_mypaint_tile_equal,
+                                                  NULL,
+                                                  (GDestroyNotify) gimp_mypaint_tile_free);
+  surface->pending_tiles = g_ptr_array_new ();
+  surface->dabs          = g_array_new (FALSE, FALSE, sizeof (GimpMybrushDab));
+
   return surface;
 }
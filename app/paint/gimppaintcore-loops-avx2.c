@@ -0,0 +1,247 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppaintcore-loops-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "paint-types.h"
+
+#include "gimppaintcore-loops.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+/*  these functions evaluate the generic row kernels' expressions in the
+ *  same order and precision, without fused multiply-add, so that their
+ *  results are bit-identical.  the stipple variants of the mask
+ *  combination are computed in double precision, like the generic ones.
+ */
+
+
+/* loads 8 mask bytes as floats in [0, 1] */
+static inline __m256
+load_u8_mask_avx2 (const guint8 *mask)
+{
+  __m128i v = _mm_loadl_epi64 ((const __m128i *) mask);
+
+  return _mm256_cvtepi32_ps (_mm256_cvtepu8_epi32 (v)) /
+         _mm256_set1_ps (255.0f);
+}
+
+/* loads 4 mask bytes as floats in [0, 1] */
+static inline __m128
+load_u8_mask_4_avx2 (const guint8 *mask)
+{
+  gint32 bytes;
+
+  memcpy (&bytes, mask, sizeof (bytes));
+
+  return _mm_cvtepi32_ps (_mm_cvtepu8_epi32 (_mm_cvtsi32_si128 (bytes))) /
+         _mm_set1_ps (255.0f);
+}
+
+/* canvas += (1 - canvas) * mask * opacity, for 4 samples, in doubles */
+static inline void
+combine_stipple_avx2 (__m128  v_mask,
+                      gfloat *canvas,
+                      __m256d v_opacity)
+{
+  __m256d v_canvas = _mm256_cvtps_pd (_mm_loadu_ps (canvas));
+  __m256d v_delta;
+
+  v_delta = (_mm256_set1_pd (1.0) - v_canvas) * _mm256_cvtps_pd (v_mask) *
+            v_opacity;
+
+  _mm_storeu_ps (canvas, _mm256_cvtpd_ps (v_canvas + v_delta));
+}
+
+/* canvas += (opacity - canvas) * mask * opacity where opacity > canvas,
+ * for 8 samples
+ */
+static inline void
+combine_avx2 (__m256  v_mask,
+              gfloat *canvas,
+              __m256  v_opacity)
+{
+  __m256 v_canvas = _mm256_loadu_ps (canvas);
+  __m256 v_delta  = (v_opacity - v_canvas) * v_mask * v_opacity;
+
+  v_canvas = _mm256_blendv_ps (v_canvas, v_canvas + v_delta,
+                               _mm256_cmp_ps (v_opacity, v_canvas,
+                                              _CMP_GT_OQ));
+
+  _mm256_storeu_ps (canvas, v_canvas);
+}
+
+/* multiplies the alpha of 8 RGBA pixels by the 8 factors in 'v_factor' */
+static inline void
+mask_alpha_avx2 (__m256  v_factor,
+                 gfloat *paint)
+{
+  const __m256 v_one = _mm256_set1_ps (1.0f);
+  gint         k;
+
+  for (k = 0; k < 4; k++)
+    {
+      __m256 v_pair = _mm256_permutevar8x32_ps (
+                        v_factor,
+                        _mm256_setr_epi32 (0, 0, 0, 2 * k,
+                                           0, 0, 0, 2 * k + 1));
+
+      /* colors are multiplied by 1.0, which is exact */
+      v_pair = _mm256_blend_ps (v_one, v_pair, 0x88);
+
+      _mm256_storeu_ps (paint + 8 * k, _mm256_loadu_ps (paint + 8 * k) * v_pair);
+    }
+}
+
+
+void
+gimp_paint_core_loops_combine_mask_u8_avx2 (const guint8 *mask,
+                                            gfloat       *canvas,
+                                            gfloat        opacity,
+                                            gboolean      stipple,
+                                            gint          samples)
+{
+  if (stipple)
+    {
+      const __m256d v_opacity = _mm256_set1_pd (opacity);
+
+      while (samples >= 4)
+        {
+          combine_stipple_avx2 (load_u8_mask_4_avx2 (mask), canvas, v_opacity);
+
+          mask    += 4;
+          canvas  += 4;
+          samples -= 4;
+        }
+    }
+  else
+    {
+      const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+      while (samples >= 8)
+        {
+          combine_avx2 (load_u8_mask_avx2 (mask), canvas, v_opacity);
+
+          mask    += 8;
+          canvas  += 8;
+          samples -= 8;
+        }
+    }
+
+  if (samples)
+    {
+      gimp_paint_core_loops_combine_mask_u8 (mask, canvas, opacity, stipple,
+                                             samples);
+    }
+}
+
+void
+gimp_paint_core_loops_combine_mask_float_avx2 (const gfloat *mask,
+                                               gfloat       *canvas,
+                                               gfloat        opacity,
+                                               gboolean      stipple,
+                                               gint          samples)
+{
+  if (stipple)
+    {
+      const __m256d v_opacity = _mm256_set1_pd (opacity);
+
+      while (samples >= 4)
+        {
+          combine_stipple_avx2 (_mm_loadu_ps (mask), canvas, v_opacity);
+
+          mask    += 4;
+          canvas  += 4;
+          samples -= 4;
+        }
+    }
+  else
+    {
+      const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+      while (samples >= 8)
+        {
+          combine_avx2 (_mm256_loadu_ps (mask), canvas, v_opacity);
+
+          mask    += 8;
+          canvas  += 8;
+          samples -= 8;
+        }
+    }
+
+  if (samples)
+    {
+      gimp_paint_core_loops_combine_mask_float (mask, canvas, opacity, stipple,
+                                                samples);
+    }
+}
+
+void
+gimp_paint_core_loops_mask_alpha_u8_avx2 (const guint8 *mask,
+                                          gfloat       *paint,
+                                          gfloat        opacity,
+                                          gint          samples)
+{
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+  while (samples >= 8)
+    {
+      mask_alpha_avx2 (load_u8_mask_avx2 (mask) * v_opacity, paint);
+
+      mask    += 8;
+      paint   += 32;
+      samples -= 8;
+    }
+
+  if (samples)
+    gimp_paint_core_loops_mask_alpha_u8 (mask, paint, opacity, samples);
+}
+
+void
+gimp_paint_core_loops_mask_alpha_float_avx2 (const gfloat *mask,
+                                             gfloat       *paint,
+                                             gfloat        opacity,
+                                             gint          samples)
+{
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+
+  while (samples >= 8)
+    {
+      mask_alpha_avx2 (_mm256_loadu_ps (mask) * v_opacity, paint);
+
+      mask    += 8;
+      paint   += 32;
+      samples -= 8;
+    }
+
+  if (samples)
+    gimp_paint_core_loops_mask_alpha_float (mask, paint, opacity, samples);
+}
+
+#endif /* COMPILE_AVX2_INTRINISICS */
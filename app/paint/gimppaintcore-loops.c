@@ -20,10 +20,13 @@
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
+#include "libgimpbase/gimpbase.h"
+
 #include "paint-types.h"
 
 #include "operations/layer-modes/gimp-layer-modes.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimptempbuf.h"
 
 #include "operations/layer-modes/gimpoperationlayermode.h"
@@ -31,6 +34,168 @@
 #include "gimppaintcore-loops.h"
 
 
+/*  the loops below process the paint area in disjoint bands on the
+ *  gimp-parallel workers.  each call returns when the whole area is
+ *  done, so successive dabs are still applied in order.
+ */
+
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
+typedef struct
+{
+  const GimpTempBuf   *paint_mask;
+  const GeglRectangle *roi;
+  gint                 mask_start_offset;
+  GeglBuffer          *canvas_buffer;
+  gfloat               opacity;
+  gboolean             stipple;
+} CombinePaintMaskData;
+
+typedef struct
+{
+  GimpTempBuf         *paint_buf;
+  GeglBuffer          *canvas_buffer;
+  const GeglRectangle *roi;
+} CanvasBufferToPaintBufAlphaData;
+
+typedef struct
+{
+  const GimpTempBuf *paint_mask;
+  gint               mask_start_offset;
+  GimpTempBuf       *paint_buf;
+  gfloat             paint_opacity;
+} PaintMaskToPaintBufferData;
+
+typedef struct
+{
+  GeglBuffer             *src_buffer;
+  GeglBuffer             *dst_buffer;
+  GimpTempBuf            *paint_buf;
+  GeglBuffer             *mask_buffer;
+  const GeglRectangle    *roi;
+  gint                    mask_x_offset;
+  gint                    mask_y_offset;
+  const Babl             *iterator_format;
+  GimpOperationLayerMode *layer_mode;
+} DoLayerBlendData;
+
+typedef struct
+{
+  GeglBuffer        *src_buffer;
+  GeglBuffer        *aux_buffer;
+  GeglBuffer        *dst_buffer;
+  GimpComponentMask  mask;
+  const Babl        *iterator_format;
+} MaskComponentsOntoData;
+
+typedef struct
+{
+  void (* combine_mask_u8)    (const guint8 *mask,
+                               gfloat       *canvas,
+                               gfloat        opacity,
+                               gboolean      stipple,
+                               gint          samples);
+  void (* combine_mask_float) (const gfloat *mask,
+                               gfloat       *canvas,
+                               gfloat        opacity,
+                               gboolean      stipple,
+                               gint          samples);
+  void (* mask_alpha_u8)      (const guint8 *mask,
+                               gfloat       *paint,
+                               gfloat        opacity,
+                               gint          samples);
+  void (* mask_alpha_float)   (const gfloat *mask,
+                               gfloat       *paint,
+                               gfloat        opacity,
+                               gint          samples);
+} RowFuncs;
+
+
+static const RowFuncs *
+get_row_funcs (void)
+{
+  static RowFuncs funcs;
+  static gsize    initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      funcs.combine_mask_u8    = gimp_paint_core_loops_combine_mask_u8;
+      funcs.combine_mask_float = gimp_paint_core_loops_combine_mask_float;
+      funcs.mask_alpha_u8      = gimp_paint_core_loops_mask_alpha_u8;
+      funcs.mask_alpha_float   = gimp_paint_core_loops_mask_alpha_float;
+
+#if COMPILE_AVX2_INTRINISICS
+      if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2)
+        {
+          funcs.combine_mask_u8    = gimp_paint_core_loops_combine_mask_u8_avx2;
+          funcs.combine_mask_float = gimp_paint_core_loops_combine_mask_float_avx2;
+          funcs.mask_alpha_u8      = gimp_paint_core_loops_mask_alpha_u8_avx2;
+          funcs.mask_alpha_float   = gimp_paint_core_loops_mask_alpha_float_avx2;
+        }
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return &funcs;
+}
+
+
+static void
+combine_paint_mask_to_canvas_mask_area (const GeglRectangle  *area,
+                                        CombinePaintMaskData *data)
+{
+  GeglBufferIterator *iter;
+
+  const RowFuncs     *funcs       = get_row_funcs ();
+  const GeglRectangle roi         = *data->roi;
+  const gint          mask_stride = gimp_temp_buf_get_width (data->paint_mask);
+  const Babl         *mask_format = gimp_temp_buf_get_format (data->paint_mask);
+
+  if (mask_format != babl_format ("Y u8") &&
+      mask_format != babl_format ("Y float"))
+    {
+      g_warning("Mask format not supported: %s", babl_get_name (mask_format));
+      return;
+    }
+
+  iter = gegl_buffer_iterator_new (data->canvas_buffer, area, 0,
+                                   babl_format ("Y float"),
+                                   GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *out_pixel = (gfloat *)iter->data[0];
+      int iy;
+
+      for (iy = 0; iy < iter->roi[0].height; iy++)
+        {
+          int mask_offset = data->mask_start_offset +
+                            (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
+
+          if (mask_format == babl_format ("Y u8"))
+            {
+              const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (data->paint_mask);
+
+              funcs->combine_mask_u8 (&mask_data[mask_offset], out_pixel,
+                                      data->opacity, data->stipple,
+                                      iter->roi[0].width);
+            }
+          else
+            {
+              const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (data->paint_mask);
+
+              funcs->combine_mask_float (&mask_data[mask_offset], out_pixel,
+                                         data->opacity, data->stipple,
+                                         iter->roi[0].width);
+            }
+
+          out_pixel += iter->roi[0].width;
+        }
+    }
+}
+
 void
 combine_paint_mask_to_canvas_mask (const GimpTempBuf *paint_mask,
                                    gint               mask_x_offset,
@@ -41,145 +206,61 @@ combine_paint_mask_to_canvas_mask (const GimpTempBuf *paint_mask,
                                    gfloat             opacity,
                                    gboolean           stipple)
 {
-  GeglRectangle       roi;
-  GeglBufferIterator *iter;
-
-  const gint   mask_stride       = gimp_temp_buf_get_width (paint_mask);
-  const gint   mask_start_offset = mask_y_offset * mask_stride + mask_x_offset;
-  const Babl  *mask_format       = gimp_temp_buf_get_format (paint_mask);
-  GimpTempBuf *modified_mask     = gimp_temp_buf_copy (paint_mask);
-  gint         width;
-  gint         height;
+  CombinePaintMaskData data;
+  GeglRectangle        roi;
 
-  width  = gimp_temp_buf_get_width (modified_mask);
-  height = gimp_temp_buf_get_height (modified_mask);
+  const gint mask_stride = gimp_temp_buf_get_width (paint_mask);
 
   roi.x = x_offset;
   roi.y = y_offset;
-  roi.width  = width - mask_x_offset;
-  roi.height = height - mask_y_offset;
+  roi.width  = gimp_temp_buf_get_width (paint_mask) - mask_x_offset;
+  roi.height = gimp_temp_buf_get_height (paint_mask) - mask_y_offset;
+
+  data.paint_mask        = paint_mask;
+  data.roi               = &roi;
+  data.mask_start_offset = mask_y_offset * mask_stride + mask_x_offset;
+  data.canvas_buffer     = canvas_buffer;
+  data.opacity           = opacity;
+  data.stipple           = stipple;
+
+  gimp_parallel_distribute_area (&roi, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 combine_paint_mask_to_canvas_mask_area,
+                                 &data);
+}
 
-  iter = gegl_buffer_iterator_new (canvas_buffer, &roi, 0,
-                                   babl_format ("Y float"),
-                                   GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+static void
+canvas_buffer_to_paint_buf_alpha_area (const GeglRectangle             *area,
+                                       CanvasBufferToPaintBufAlphaData *data)
+{
+  GeglBufferIterator *iter;
 
-  if (stipple)
-    {
-      if (mask_format == babl_format ("Y u8"))
-        {
-          const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+  const RowFuncs     *funcs        = get_row_funcs ();
+  const GeglRectangle roi          = *data->roi;
+  const guint         paint_stride = gimp_temp_buf_get_width (data->paint_buf);
+  gfloat             *paint_data   = (gfloat *) gimp_temp_buf_get_data (data->paint_buf);
 
-          while (gegl_buffer_iterator_next (iter))
-            {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const guint8 *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      out_pixel[0] += (1.0 - out_pixel[0]) * (*mask_pixel / 255.0f) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
-            }
-        }
-      else if (mask_format == babl_format ("Y float"))
-        {
-          const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+  iter = gegl_buffer_iterator_new (data->canvas_buffer, area, 0,
+                                   babl_format ("Y float"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
-          while (gegl_buffer_iterator_next (iter))
-            {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const gfloat *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      out_pixel[0] += (1.0 - out_pixel[0]) * (*mask_pixel) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
-            }
-        }
-      else
-        {
-          g_warning("Mask format not supported: %s", babl_get_name (mask_format));
-        }
-    }
-  else
+  while (gegl_buffer_iterator_next (iter))
     {
-      if (mask_format == babl_format ("Y u8"))
-        {
-          const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+      gfloat *canvas_pixel = (gfloat *)iter->data[0];
+      int iy;
 
-          while (gegl_buffer_iterator_next (iter))
-            {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const guint8 *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      if (opacity > out_pixel[0])
-                        out_pixel[0] += (opacity - out_pixel[0]) * (*mask_pixel / 255.0f) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
-            }
-        }
-      else if (mask_format == babl_format ("Y float"))
+      for (iy = 0; iy < iter->roi[0].height; iy++)
         {
-          const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+          int paint_offset = (iy + iter->roi[0].y - roi.y) * paint_stride + iter->roi[0].x - roi.x;
+          float *paint_pixel = &paint_data[paint_offset * 4];
 
-          while (gegl_buffer_iterator_next (iter))
-            {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const gfloat *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      if (opacity > out_pixel[0])
-                        out_pixel[0] += (opacity - out_pixel[0]) * (*mask_pixel) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
-            }
-        }
-      else
-        {
-          g_warning("Mask format not supported: %s", babl_get_name (mask_format));
+          /* multiplying by 1.0 is exact, so this is paint *= canvas */
+          funcs->mask_alpha_float (canvas_pixel, paint_pixel, 1.0f,
+                                   iter->roi[0].width);
+
+          canvas_pixel += iter->roi[0].width;
         }
     }
-  gimp_temp_buf_unref (modified_mask);
 }
 
 void
@@ -189,38 +270,60 @@ canvas_buffer_to_paint_buf_alpha (GimpTempBuf  *paint_buf,
                                   gint          y_offset)
 {
   /* Copy the canvas buffer in rect to the paint buffer's alpha channel */
-  GeglRectangle roi;
-  GeglBufferIterator *iter;
-
-  const guint paint_stride = gimp_temp_buf_get_width (paint_buf);
-  gfloat *paint_data       = (gfloat *) gimp_temp_buf_get_data (paint_buf);
+  CanvasBufferToPaintBufAlphaData data;
+  GeglRectangle                   roi;
 
   roi.x = x_offset;
   roi.y = y_offset;
   roi.width  = gimp_temp_buf_get_width (paint_buf);
   roi.height = gimp_temp_buf_get_height (paint_buf);
 
-  iter = gegl_buffer_iterator_new (canvas_buffer, &roi, 0,
-                                   babl_format ("Y float"),
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  data.paint_buf     = paint_buf;
+  data.canvas_buffer = canvas_buffer;
+  data.roi           = &roi;
 
-  while (gegl_buffer_iterator_next (iter))
+  gimp_parallel_distribute_area (&roi, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 canvas_buffer_to_paint_buf_alpha_area,
+                                 &data);
+}
+
+static void
+paint_mask_to_paint_buffer_area (const GeglRectangle        *area,
+                                 PaintMaskToPaintBufferData *data)
+{
+  const RowFuncs *funcs        = get_row_funcs ();
+  const gint      paint_stride = gimp_temp_buf_get_width (data->paint_buf);
+  const gint      mask_stride  = gimp_temp_buf_get_width (data->paint_mask);
+  const Babl     *mask_format  = gimp_temp_buf_get_format (data->paint_mask);
+
+  int iy;
+  gfloat *paint_data = (gfloat *)gimp_temp_buf_get_data (data->paint_buf);
+
+  if (mask_format == babl_format ("Y u8"))
     {
-      gfloat *canvas_pixel = (gfloat *)iter->data[0];
-      int iy, ix;
+      const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (data->paint_mask);
+      mask_data += data->mask_start_offset;
 
-      for (iy = 0; iy < iter->roi[0].height; iy++)
+      for (iy = area->y; iy < area->y + area->height; iy++)
         {
-          int paint_offset = (iy + iter->roi[0].y - roi.y) * paint_stride + iter->roi[0].x - roi.x;
-          float *paint_pixel = &paint_data[paint_offset * 4];
-
-          for (ix = 0; ix < iter->roi[0].width; ix++)
-            {
-              paint_pixel[3] *= *canvas_pixel;
+          funcs->mask_alpha_u8 (&mask_data[iy * mask_stride + area->x],
+                                &paint_data[(iy * paint_stride + area->x) * 4],
+                                data->paint_opacity,
+                                area->width);
+        }
+    }
+  else if (mask_format == babl_format ("Y float"))
+    {
+      const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (data->paint_mask);
+      mask_data += data->mask_start_offset;
 
-              canvas_pixel += 1;
-              paint_pixel  += 4;
-            }
+      for (iy = area->y; iy < area->y + area->height; iy++)
+        {
+          funcs->mask_alpha_float (&mask_data[iy * mask_stride + area->x],
+                                   &paint_data[(iy * paint_stride + area->x) * 4],
+                                   data->paint_opacity,
+                                   area->width);
         }
     }
 }
@@ -232,56 +335,97 @@ paint_mask_to_paint_buffer (const GimpTempBuf  *paint_mask,
                             GimpTempBuf        *paint_buf,
                             gfloat              paint_opacity)
 {
+  PaintMaskToPaintBufferData data;
+
   gint width  = gimp_temp_buf_get_width (paint_buf);
   gint height = gimp_temp_buf_get_height (paint_buf);
 
-  const gint mask_stride       = gimp_temp_buf_get_width (paint_mask);
-  const gint mask_start_offset = mask_y_offset * mask_stride + mask_x_offset;
-  const Babl *mask_format      = gimp_temp_buf_get_format (paint_mask);
-
-  int iy, ix;
-  gfloat *paint_pixel = (gfloat *)gimp_temp_buf_get_data (paint_buf);
+  const gint mask_stride = gimp_temp_buf_get_width (paint_mask);
 
   /* Validate that the paint buffer is withing the bounds of the paint mask */
   g_return_if_fail (width <= gimp_temp_buf_get_width (paint_mask) - mask_x_offset);
   g_return_if_fail (height <= gimp_temp_buf_get_height (paint_mask) - mask_y_offset);
 
-  if (mask_format == babl_format ("Y u8"))
-    {
-      const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (paint_mask);
-      mask_data += mask_start_offset;
+  data.paint_mask        = paint_mask;
+  data.mask_start_offset = mask_y_offset * mask_stride + mask_x_offset;
+  data.paint_buf         = paint_buf;
+  data.paint_opacity     = paint_opacity;
 
-      for (iy = 0; iy < height; iy++)
-        {
-          int mask_offset = iy * mask_stride;
-          const guint8 *mask_pixel = &mask_data[mask_offset];
+  gimp_parallel_distribute_area (GEGL_RECTANGLE (0, 0, width, height),
+                                 MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 paint_mask_to_paint_buffer_area,
+                                 &data);
+}
 
-          for (ix = 0; ix < width; ix++)
-            {
-              paint_pixel[3] *= (((gfloat)*mask_pixel) / 255.0f) * paint_opacity;
+static void
+do_layer_blend_area (const GeglRectangle *area,
+                     DoLayerBlendData    *data)
+{
+  GeglRectangle           mask_area;
+  GeglRectangle           process_roi;
+  GeglBufferIterator     *iter;
+  GimpOperationLayerMode *layer_mode = data->layer_mode;
 
-              mask_pixel  += 1;
-              paint_pixel += 4;
-            }
-        }
+  const GeglRectangle roi          = *data->roi;
+  const guint         paint_stride = gimp_temp_buf_get_width (data->paint_buf);
+  gfloat             *paint_data   = (gfloat *) gimp_temp_buf_get_data (data->paint_buf);
+
+  mask_area.x = area->x - data->mask_x_offset;
+  mask_area.y = area->y - data->mask_y_offset;
+  mask_area.width  = area->width;
+  mask_area.height = area->height;
+
+  iter = gegl_buffer_iterator_new (data->dst_buffer, area, 0,
+                                   data->iterator_format,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, data->src_buffer, area, 0,
+                            data->iterator_format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  if (data->mask_buffer)
+    {
+      gegl_buffer_iterator_add (iter, data->mask_buffer, &mask_area, 0,
+                                babl_format ("Y float"),
+                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
     }
-  else if (mask_format == babl_format ("Y float"))
+
+  while (gegl_buffer_iterator_next (iter))
     {
-      const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (paint_mask);
-      mask_data += mask_start_offset;
+      gfloat *out_pixel  = (gfloat *) iter->data[0];
+      gfloat *in_pixel   = (gfloat *) iter->data[1];
+      gfloat *mask_pixel = NULL;
+      gfloat *paint_pixel;
+      gint    iy;
+
+      paint_pixel = paint_data + ((iter->roi[0].y - roi.y) * paint_stride + iter->roi[0].x - roi.x) * 4;
 
-      for (iy = 0; iy < height; iy++)
+      if (data->mask_buffer)
+        mask_pixel  = (gfloat *)iter->data[2];
+
+      process_roi.x = iter->roi[0].x;
+      process_roi.width  = iter->roi[0].width;
+      process_roi.height = 1;
+
+      for (iy = 0; iy < iter->roi[0].height; iy++)
         {
-          int mask_offset = iy * mask_stride;
-          const gfloat *mask_pixel = &mask_data[mask_offset];
+          process_roi.y = iter->roi[0].y + iy;
 
-          for (ix = 0; ix < width; ix++)
-            {
-              paint_pixel[3] *= (*mask_pixel) * paint_opacity;
+          layer_mode->function ((GeglOperation*) layer_mode,
+                                in_pixel,
+                                paint_pixel,
+                                mask_pixel,
+                                out_pixel,
+                                iter->roi[0].width,
+                                &process_roi,
+                                0);
 
-              mask_pixel  += 1;
-              paint_pixel += 4;
-            }
+          in_pixel    += iter->roi[0].width * 4;
+          out_pixel   += iter->roi[0].width * 4;
+          if (data->mask_buffer)
+            mask_pixel  += iter->roi[0].width;
+          paint_pixel += paint_stride * 4;
         }
     }
 }
@@ -299,16 +443,9 @@ do_layer_blend (GeglBuffer    *src_buffer,
                 GimpLayerMode  paint_mode)
 {
   GeglRectangle           roi;
-  GeglRectangle           mask_roi;
-  GeglRectangle           process_roi;
   const Babl             *iterator_format;
-  GeglBufferIterator     *iter;
-  guint                   paint_stride;
-  gfloat                 *paint_data;
   GimpOperationLayerMode  layer_mode;
-
-  paint_stride = gimp_temp_buf_get_width (paint_buf);
-  paint_data   = (gfloat *) gimp_temp_buf_get_data (paint_buf);
+  DoLayerBlendData        data;
 
   layer_mode.layer_mode          = paint_mode;
   layer_mode.opacity             = opacity;
@@ -329,63 +466,60 @@ do_layer_blend (GeglBuffer    *src_buffer,
   roi.width  = gimp_temp_buf_get_width (paint_buf);
   roi.height = gimp_temp_buf_get_height (paint_buf);
 
-  mask_roi.x = roi.x - mask_x_offset;
-  mask_roi.y = roi.y - mask_y_offset;
-  mask_roi.width  = roi.width;
-  mask_roi.height = roi.height;
-
   g_return_if_fail (gimp_temp_buf_get_format (paint_buf) == iterator_format);
 
-  iter = gegl_buffer_iterator_new (dst_buffer, &roi, 0,
-                                   iterator_format,
+  data.src_buffer      = src_buffer;
+  data.dst_buffer      = dst_buffer;
+  data.paint_buf       = paint_buf;
+  data.mask_buffer     = mask_buffer;
+  data.roi             = &roi;
+  data.mask_x_offset   = mask_x_offset;
+  data.mask_y_offset   = mask_y_offset;
+  data.iterator_format = iterator_format;
+  data.layer_mode      = &layer_mode;
+
+  gimp_parallel_distribute_area (&roi, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 do_layer_blend_area,
+                                 &data);
+}
+
+static void
+mask_components_onto_area (const GeglRectangle    *area,
+                           MaskComponentsOntoData *data)
+{
+  GeglBufferIterator *iter;
+  GimpComponentMask   mask = data->mask;
+
+  iter = gegl_buffer_iterator_new (data->dst_buffer, area, 0,
+                                   data->iterator_format,
                                    GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, src_buffer, &roi, 0,
-                            iterator_format,
+  gegl_buffer_iterator_add (iter, data->src_buffer, area, 0,
+                            data->iterator_format,
                             GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
-  if (mask_buffer)
-    {
-      gegl_buffer_iterator_add (iter, mask_buffer, &mask_roi, 0,
-                                babl_format ("Y float"),
-                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-    }
+  gegl_buffer_iterator_add (iter, data->aux_buffer, area, 0,
+                            data->iterator_format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      gfloat *out_pixel  = (gfloat *) iter->data[0];
-      gfloat *in_pixel   = (gfloat *) iter->data[1];
-      gfloat *mask_pixel = NULL;
-      gfloat *paint_pixel;
-      gint    iy;
-
-      paint_pixel = paint_data + ((iter->roi[0].y - roi.y) * paint_stride + iter->roi[0].x - roi.x) * 4;
-
-      if (mask_buffer)
-        mask_pixel  = (gfloat *)iter->data[2];
-
-      process_roi.x = iter->roi[0].x;
-      process_roi.width  = iter->roi[0].width;
-      process_roi.height = 1;
+      gfloat *dest    = (gfloat *)iter->data[0];
+      gfloat *src     = (gfloat *)iter->data[1];
+      gfloat *aux     = (gfloat *)iter->data[2];
+      glong   samples = iter->length;
 
-      for (iy = 0; iy < iter->roi[0].height; iy++)
+      while (samples--)
         {
-          process_roi.y = iter->roi[0].y + iy;
-
-          layer_mode.function ((GeglOperation*) &layer_mode,
-                               in_pixel,
-                               paint_pixel,
-                               mask_pixel,
-                               out_pixel,
-                               iter->roi[0].width,
-                               &process_roi,
-                               0);
+          dest[RED]   = (mask & GIMP_COMPONENT_MASK_RED)   ? aux[RED]   : src[RED];
+          dest[GREEN] = (mask & GIMP_COMPONENT_MASK_GREEN) ? aux[GREEN] : src[GREEN];
+          dest[BLUE]  = (mask & GIMP_COMPONENT_MASK_BLUE)  ? aux[BLUE]  : src[BLUE];
+          dest[ALPHA] = (mask & GIMP_COMPONENT_MASK_ALPHA) ? aux[ALPHA] : src[ALPHA];
 
-          in_pixel    += iter->roi[0].width * 4;
-          out_pixel   += iter->roi[0].width * 4;
-          if (mask_buffer)
-            mask_pixel  += iter->roi[0].width;
-          paint_pixel += paint_stride * 4;
+          src  += 4;
+          aux  += 4;
+          dest += 4;
         }
     }
 }
@@ -398,43 +532,113 @@ mask_components_onto (GeglBuffer        *src_buffer,
                       GimpComponentMask  mask,
                       gboolean           linear_mode)
 {
-  GeglBufferIterator *iter;
-  const Babl         *iterator_format;
+  MaskComponentsOntoData data;
+
+  data.src_buffer = src_buffer;
+  data.aux_buffer = aux_buffer;
+  data.dst_buffer = dst_buffer;
+  data.mask       = mask;
 
   if (linear_mode)
-    iterator_format = babl_format ("RGBA float");
+    data.iterator_format = babl_format ("RGBA float");
   else
-    iterator_format = babl_format ("R'G'B'A float");
+    data.iterator_format = babl_format ("R'G'B'A float");
 
-  iter = gegl_buffer_iterator_new (dst_buffer, roi, 0,
-                                   iterator_format,
-                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+  gimp_parallel_distribute_area (roi, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 mask_components_onto_area,
+                                 &data);
+}
 
-  gegl_buffer_iterator_add (iter, src_buffer, roi, 0,
-                            iterator_format,
-                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, aux_buffer, roi, 0,
-                            iterator_format,
-                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+/*  row kernels  */
 
-  while (gegl_buffer_iterator_next (iter))
+void
+gimp_paint_core_loops_combine_mask_u8 (const guint8 *mask,
+                                       gfloat       *canvas,
+                                       gfloat        opacity,
+                                       gboolean      stipple,
+                                       gint          samples)
+{
+  if (stipple)
     {
-      gfloat *dest    = (gfloat *)iter->data[0];
-      gfloat *src     = (gfloat *)iter->data[1];
-      gfloat *aux     = (gfloat *)iter->data[2];
-      glong   samples = iter->length;
+      while (samples--)
+        {
+          canvas[0] += (1.0 - canvas[0]) * (*mask / 255.0f) * opacity;
 
+          mask   += 1;
+          canvas += 1;
+        }
+    }
+  else
+    {
       while (samples--)
         {
-          dest[RED]   = (mask & GIMP_COMPONENT_MASK_RED)   ? aux[RED]   : src[RED];
-          dest[GREEN] = (mask & GIMP_COMPONENT_MASK_GREEN) ? aux[GREEN] : src[GREEN];
-          dest[BLUE]  = (mask & GIMP_COMPONENT_MASK_BLUE)  ? aux[BLUE]  : src[BLUE];
-          dest[ALPHA] = (mask & GIMP_COMPONENT_MASK_ALPHA) ? aux[ALPHA] : src[ALPHA];
+          if (opacity > canvas[0])
+            canvas[0] += (opacity - canvas[0]) * (*mask / 255.0f) * opacity;
 
-          src  += 4;
-          aux  += 4;
-          dest += 4;
+          mask   += 1;
+          canvas += 1;
         }
     }
 }
+
+void
+gimp_paint_core_loops_combine_mask_float (const gfloat *mask,
+                                          gfloat       *canvas,
+                                          gfloat        opacity,
+                                          gboolean      stipple,
+                                          gint          samples)
+{
+  if (stipple)
+    {
+      while (samples--)
+        {
+          canvas[0] += (1.0 - canvas[0]) * (*mask) * opacity;
+
+          mask   += 1;
+          canvas += 1;
+        }
+    }
+  else
+    {
+      while (samples--)
+        {
+          if (opacity > canvas[0])
+            canvas[0] += (opacity - canvas[0]) * (*mask) * opacity;
+
+          mask   += 1;
+          canvas += 1;
+        }
+    }
+}
+
+void
+gimp_paint_core_loops_mask_alpha_u8 (const guint8 *mask,
+                                     gfloat       *paint,
+                                     gfloat        opacity,
+                                     gint          samples)
+{
+  while (samples--)
+    {
+      paint[3] *= (((gfloat) *mask) / 255.0f) * opacity;
+
+      mask  += 1;
+      paint += 4;
+    }
+}
+
+void
+gimp_paint_core_loops_mask_alpha_float (const gfloat *mask,
+                                        gfloat       *paint,
+                                        gfloat        opacity,
+                                        gint          samples)
+{
+  while (samples--)
+    {
+      paint[3] *= (*mask) * opacity;
+
+      mask  += 1;
+      paint += 4;
+    }
+}
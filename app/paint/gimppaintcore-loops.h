@@ -52,3 +52,48 @@ void mask_components_onto               (GeglBuffer        *src_buffer,
                                          GeglRectangle     *roi,
                                          GimpComponentMask  mask,
                                          gboolean           linear_mode);
+
+
+/*  the per-row kernels of the loops above, and their accelerated variants  */
+
+void gimp_paint_core_loops_combine_mask_u8    (const guint8 *mask,
+                                               gfloat       *canvas,
+                                               gfloat        opacity,
+                                               gboolean      stipple,
+                                               gint          samples);
+void gimp_paint_core_loops_combine_mask_float (const gfloat *mask,
+                                               gfloat       *canvas,
+                                               gfloat        opacity,
+                                               gboolean      stipple,
+                                               gint          samples);
+void gimp_paint_core_loops_mask_alpha_u8      (const guint8 *mask,
+                                               gfloat       *paint,
+                                               gfloat        opacity,
+                                               gint          samples);
+void gimp_paint_core_loops_mask_alpha_float   (const gfloat *mask,
+                                               gfloat       *paint,
+                                               gfloat        opacity,
+                                               gint          samples);
+
+#if COMPILE_AVX2_INTRINISICS
+
+void gimp_paint_core_loops_combine_mask_u8_avx2    (const guint8 *mask,
+                                                    gfloat       *canvas,
+                                                    gfloat        opacity,
+                                                    gboolean      stipple,
+                                                    gint          samples);
+void gimp_paint_core_loops_combine_mask_float_avx2 (const gfloat *mask,
+                                                    gfloat       *canvas,
+                                                    gfloat        opacity,
+                                                    gboolean      stipple,
+                                                    gint          samples);
+void gimp_paint_core_loops_mask_alpha_u8_avx2      (const guint8 *mask,
+                                                    gfloat       *paint,
+                                                    gfloat        opacity,
+                                                    gint          samples);
+void gimp_paint_core_loops_mask_alpha_float_avx2   (const gfloat *mask,
+                                                    gfloat       *paint,
+                                                    gfloat        opacity,
+                                                    gint          samples);
+
+#endif /* COMPILE_AVX2_INTRINISICS */
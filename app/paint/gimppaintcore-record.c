@@ -0,0 +1,640 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  Recording of painted strokes, enabled by the --paint-record command
+ *  line option, which names the file the session is written to.  Every stroke is
+ *  stored with its paint method, its paint options and all of its
+ *  events (coordinates, pressure, tilt and so on, and their times), so
+ *  that it can be replayed against an image, either as fast as
+ *  possible or at the pace it was painted in, for profiling.
+ *
+ *  The file is rewritten after each stroke, in the same format as the
+ *  other config files:
+ *
+ *  (stroke "gimp-paintbrush" <ms since the first stroke>
+ *      (options <the serialized paint options>)
+ *      (event <x> <y> <pressure> <xtilt> <ytilt> <wheel> <velocity>
+ *             <direction> <xscale> <yscale> <angle> <reflect>
+ *             <ms since the start of the stroke>)
+ *      ...)
+ */
+
+#include "config.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpconfig/gimpconfig.h"
+
+#include "paint-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpcontext.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpimage.h"
+#include "core/gimppaintinfo.h"
+
+#include "gimppaintcore.h"
+#include "gimppaintcore-record.h"
+#include "gimppaintoptions.h"
+
+#include "gimp-intl.h"
+
+
+enum
+{
+  STROKE = 1,
+  OPTIONS,
+  EVENT
+};
+
+
+typedef struct
+{
+  GimpCoords  coords;
+  gint64      time;       /*  ms since the start of the stroke   */
+} GimpPaintRecordEvent;
+
+typedef struct
+{
+  gchar            *paint_info;
+  gint64            start_time; /*  ms since the start of the session  */
+  GimpPaintOptions *options;
+  GArray           *events;
+
+  gint64            start_monotonic_time;
+  guint32           first_event_time;
+} GimpPaintRecord;
+
+
+static void          gimp_paint_core_record_free         (GimpPaintRecord   *record);
+static void          gimp_paint_core_record_serialize    (GimpPaintRecord   *record,
+                                                          GimpConfigWriter  *writer);
+
+static GTokenType    gimp_paint_core_replay_parse_stroke (Gimp              *gimp,
+                                                          GScanner          *scanner,
+                                                          GimpPaintRecord   *record);
+static GTokenType    gimp_paint_core_replay_parse_event  (GScanner          *scanner,
+                                                          GimpPaintRecordEvent *event);
+static gboolean      gimp_paint_core_replay_stroke       (GimpPaintRecord   *record,
+                                                          GimpDrawable      *drawable,
+                                                          gint64             replay_start,
+                                                          gboolean           real_time,
+                                                          GError           **error);
+static void          gimp_paint_core_replay_wait         (gint64             until);
+
+
+static gchar   *record_filename      = NULL;
+static GString *record_session       = NULL;
+static gint64   record_session_start = 0;
+static gint     replay_depth         = 0;
+
+static const GimpCoords default_coords = GIMP_COORDS_DEFAULT_VALUES;
+
+
+/*  public functions  */
+
+void
+gimp_paint_core_record_init (const gchar *filename)
+{
+  g_free (record_filename);
+  record_filename = (filename && *filename) ? g_strdup (filename) : NULL;
+}
+
+void
+gimp_paint_core_record_start (GimpPaintCore    *core,
+                              GimpPaintOptions *paint_options,
+                              const GimpCoords *coords)
+{
+  GimpPaintRecord      *record;
+  GimpPaintRecordEvent  event;
+  gint64                now;
+
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+  g_return_if_fail (GIMP_IS_PAINT_OPTIONS (paint_options));
+  g_return_if_fail (coords != NULL);
+
+  gimp_paint_core_record_stop (core, FALSE);
+
+  /*  don't record the strokes we replay  */
+  if (! record_filename || replay_depth > 0)
+    return;
+
+  now = g_get_monotonic_time ();
+
+  if (! record_session)
+    {
+      record_session       = g_string_new ("# GIMP paint recording\n\n");
+      record_session_start = now;
+    }
+
+  record = g_slice_new0 (GimpPaintRecord);
+
+  record->paint_info = g_strdup (gimp_object_get_name (paint_options->paint_info));
+  record->start_time = (now - record_session_start) / 1000;
+
+  /*  keep the brush, dynamics and so on the options currently
+   *  inherit from the user context, too
+   */
+  record->options =
+    GIMP_PAINT_OPTIONS (gimp_config_duplicate (GIMP_CONFIG (paint_options)));
+  gimp_context_copy_properties (GIMP_CONTEXT (paint_options),
+                                GIMP_CONTEXT (record->options),
+                                GIMP_CONTEXT_PROP_MASK_PAINT);
+  gimp_context_define_properties (GIMP_CONTEXT (record->options),
+                                  GIMP_CONTEXT_PROP_MASK_PAINT, TRUE);
+
+  record->events = g_array_new (FALSE, FALSE, sizeof (GimpPaintRecordEvent));
+
+  record->start_monotonic_time = now;
+
+  event.coords = *coords;
+  event.time   = 0;
+
+  g_array_append_val (record->events, event);
+
+  core->record = record;
+}
+
+void
+gimp_paint_core_record_event (GimpPaintCore    *core,
+                              const GimpCoords *coords,
+                              guint32           time)
+{
+  GimpPaintRecord      *record;
+  GimpPaintRecordEvent  event;
+
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+  g_return_if_fail (coords != NULL);
+
+  record = core->record;
+
+  if (! record)
+    return;
+
+  event.coords = *coords;
+
+  /*  use the time of the input event, rather than the time we are
+   *  called at, which lags behind when painting can't keep up.
+   *  strokes painted by procedures have no event times.
+   */
+  if (time)
+    {
+      if (! record->first_event_time)
+        record->first_event_time = time;
+
+      event.time = (guint32) (time - record->first_event_time);
+    }
+  else
+    {
+      event.time = (g_get_monotonic_time () -
+                    record->start_monotonic_time) / 1000;
+    }
+
+  g_array_append_val (record->events, event);
+}
+
+void
+gimp_paint_core_record_stop (GimpPaintCore *core,
+                             gboolean       save)
+{
+  GimpPaintRecord *record;
+
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+
+  record = core->record;
+
+  if (! record)
+    return;
+
+  core->record = NULL;
+
+  if (save)
+    {
+      GimpConfigWriter *writer = gimp_config_writer_new_string (record_session);
+      const gchar      *filename;
+      GError           *error = NULL;
+
+      gimp_paint_core_record_serialize (record, writer);
+
+      gimp_config_writer_finish (writer, NULL, NULL);
+
+      filename = record_filename;
+
+      if (! g_file_set_contents (filename,
+                                 record_session->str, record_session->len,
+                                 &error))
+        {
+          g_printerr ("Could not write paint recording to '%s': %s\n",
+                      filename, error->message);
+          g_clear_error (&error);
+        }
+    }
+
+  gimp_paint_core_record_free (record);
+}
+
+gboolean
+gimp_paint_core_replay (Gimp          *gimp,
+                        GimpDrawable  *drawable,
+                        GFile         *file,
+                        gboolean       real_time,
+                        gint          *n_strokes,
+                        gint          *n_events,
+                        GError       **error)
+{
+  GScanner   *scanner;
+  GTokenType  token;
+  gint64      replay_start;
+  gint        strokes = 0;
+  gint        events  = 0;
+  GError     *my_error = NULL;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), FALSE);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), FALSE);
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  scanner = gimp_scanner_new_gfile (file, &my_error);
+
+  if (! scanner)
+    {
+      g_propagate_error (error, my_error);
+      return FALSE;
+    }
+
+  g_scanner_scope_add_symbol (scanner, 0, "stroke",
+                              GINT_TO_POINTER (STROKE));
+  g_scanner_scope_add_symbol (scanner, 0, "options",
+                              GINT_TO_POINTER (OPTIONS));
+  g_scanner_scope_add_symbol (scanner, 0, "event",
+                              GINT_TO_POINTER (EVENT));
+
+  replay_depth++;
+
+  replay_start = g_get_monotonic_time ();
+
+  token = G_TOKEN_LEFT_PAREN;
+
+  while (g_scanner_peek_next_token (scanner) == token)
+    {
+      token = g_scanner_get_next_token (scanner);
+
+      switch (token)
+        {
+        case G_TOKEN_LEFT_PAREN:
+          token = G_TOKEN_SYMBOL;
+          break;
+
+        case G_TOKEN_SYMBOL:
+          if (scanner->value.v_symbol == GINT_TO_POINTER (STROKE))
+            {
+              GimpPaintRecord record = { 0, };
+
+              token = gimp_paint_core_replay_parse_stroke (gimp, scanner,
+                                                           &record);
+
+              if (token == G_TOKEN_LEFT_PAREN &&
+                  ! gimp_paint_core_replay_stroke (&record, drawable,
+                                                   replay_start, real_time,
+                                                   &my_error))
+                {
+                  token = G_TOKEN_NONE;
+                }
+
+              if (token == G_TOKEN_LEFT_PAREN)
+                {
+                  strokes++;
+                  events += record.events->len;
+                }
+
+              g_free (record.paint_info);
+              g_clear_object (&record.options);
+              if (record.events)
+                g_array_free (record.events, TRUE);
+
+              /*  the error has been reported already  */
+              if (token == G_TOKEN_NONE)
+                {
+                  token = G_TOKEN_LEFT_PAREN;
+                  goto error;
+                }
+
+              if (token != G_TOKEN_LEFT_PAREN)
+                goto error;
+            }
+          token = G_TOKEN_RIGHT_PAREN;
+          break;
+
+        case G_TOKEN_RIGHT_PAREN:
+          token = G_TOKEN_LEFT_PAREN;
+          break;
+
+        default: /* do nothing */
+          break;
+        }
+    }
+
+ error:
+
+  if (token != G_TOKEN_LEFT_PAREN)
+    {
+      g_scanner_get_next_token (scanner);
+      g_scanner_unexp_token (scanner, token, NULL, NULL, NULL,
+                             _("fatal parse error"), TRUE);
+    }
+
+  replay_depth--;
+
+  gimp_scanner_destroy (scanner);
+
+  if (n_strokes) *n_strokes = strokes;
+  if (n_events)  *n_events  = events;
+
+  if (my_error)
+    {
+      g_propagate_error (error, my_error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_paint_core_record_free (GimpPaintRecord *record)
+{
+  g_free (record->paint_info);
+  g_clear_object (&record->options);
+  g_array_free (record->events, TRUE);
+
+  g_slice_free (GimpPaintRecord, record);
+}
+
+static void
+gimp_paint_core_record_serialize (GimpPaintRecord  *record,
+                                  GimpConfigWriter *writer)
+{
+  gint i;
+
+  gimp_config_writer_open (writer, "stroke");
+  gimp_config_writer_string (writer, record->paint_info);
+  gimp_config_writer_printf (writer, "%" G_GINT64_FORMAT, record->start_time);
+
+  gimp_config_writer_open (writer, "options");
+  gimp_config_serialize (GIMP_CONFIG (record->options), writer, NULL);
+  gimp_config_writer_close (writer);
+
+  for (i = 0; i < record->events->len; i++)
+    {
+      const GimpPaintRecordEvent *event;
+      const GimpCoords           *c;
+      const gdouble              *values[11];
+      gint                        j;
+
+      event = &g_array_index (record->events, GimpPaintRecordEvent, i);
+      c     = &event->coords;
+
+      values[0]  = &c->x;
+      values[1]  = &c->y;
+      values[2]  = &c->pressure;
+      values[3]  = &c->xtilt;
+      values[4]  = &c->ytilt;
+      values[5]  = &c->wheel;
+      values[6]  = &c->velocity;
+      values[7]  = &c->direction;
+      values[8]  = &c->xscale;
+      values[9]  = &c->yscale;
+      values[10] = &c->angle;
+
+      gimp_config_writer_open (writer, "event");
+
+      for (j = 0; j < G_N_ELEMENTS (values); j++)
+        {
+          gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+          g_ascii_formatd (buf, sizeof (buf), "%f", *values[j]);
+
+          gimp_config_writer_print (writer, buf, -1);
+        }
+
+      gimp_config_writer_printf (writer, "%d %" G_GINT64_FORMAT,
+                                 c->reflect ? 1 : 0, event->time);
+
+      gimp_config_writer_close (writer);
+    }
+
+  gimp_config_writer_close (writer);
+}
+
+static GTokenType
+gimp_paint_core_replay_parse_stroke (Gimp            *gimp,
+                                     GScanner        *scanner,
+                                     GimpPaintRecord *record)
+{
+  GimpPaintInfo *paint_info;
+  GTokenType     token;
+
+  if (! gimp_scanner_parse_string (scanner, &record->paint_info))
+    return G_TOKEN_STRING;
+
+  if (! gimp_scanner_parse_int64 (scanner, &record->start_time))
+    return G_TOKEN_INT;
+
+  paint_info = (GimpPaintInfo *)
+    gimp_container_get_child_by_name (gimp->paint_info_list,
+                                      record->paint_info);
+
+  if (! paint_info)
+    {
+      g_scanner_error (scanner, _("unknown paint method '%s'"),
+                       record->paint_info);
+      return G_TOKEN_NONE;
+    }
+
+  record->options =
+    GIMP_PAINT_OPTIONS (gimp_config_duplicate (GIMP_CONFIG (paint_info->paint_options)));
+  gimp_context_set_parent (GIMP_CONTEXT (record->options),
+                           gimp_get_user_context (gimp));
+
+  record->events = g_array_new (FALSE, FALSE, sizeof (GimpPaintRecordEvent));
+
+  token = G_TOKEN_LEFT_PAREN;
+
+  while (g_scanner_peek_next_token (scanner) == token)
+    {
+      token = g_scanner_get_next_token (scanner);
+
+      switch (token)
+        {
+        case G_TOKEN_LEFT_PAREN:
+          token = G_TOKEN_SYMBOL;
+          break;
+
+        case G_TOKEN_SYMBOL:
+          if (scanner->value.v_symbol == GINT_TO_POINTER (OPTIONS))
+            {
+              if (! gimp_config_deserialize (GIMP_CONFIG (record->options),
+                                             scanner, 2, NULL))
+                return G_TOKEN_NONE;
+            }
+          else if (scanner->value.v_symbol == GINT_TO_POINTER (EVENT))
+            {
+              GimpPaintRecordEvent event;
+
+              token = gimp_paint_core_replay_parse_event (scanner, &event);
+
+              if (token != G_TOKEN_RIGHT_PAREN)
+                return token;
+
+              g_array_append_val (record->events, event);
+            }
+          token = G_TOKEN_RIGHT_PAREN;
+          break;
+
+        case G_TOKEN_RIGHT_PAREN:
+          token = G_TOKEN_LEFT_PAREN;
+          break;
+
+        default: /* do nothing */
+          break;
+        }
+    }
+
+  return token;
+}
+
+static GTokenType
+gimp_paint_core_replay_parse_event (GScanner             *scanner,
+                                    GimpPaintRecordEvent *event)
+{
+  GimpCoords *c = &event->coords;
+  gdouble    *values[11];
+  gint        reflect;
+  gint        i;
+
+  *c = default_coords;
+
+  values[0]  = &c->x;
+  values[1]  = &c->y;
+  values[2]  = &c->pressure;
+  values[3]  = &c->xtilt;
+  values[4]  = &c->ytilt;
+  values[5]  = &c->wheel;
+  values[6]  = &c->velocity;
+  values[7]  = &c->direction;
+  values[8]  = &c->xscale;
+  values[9]  = &c->yscale;
+  values[10] = &c->angle;
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++)
+    {
+      if (! gimp_scanner_parse_float (scanner, values[i]))
+        return G_TOKEN_FLOAT;
+    }
+
+  if (! gimp_scanner_parse_int (scanner, &reflect))
+    return G_TOKEN_INT;
+
+  if (! gimp_scanner_parse_int64 (scanner, &event->time))
+    return G_TOKEN_INT;
+
+  c->reflect = reflect != 0;
+
+  return G_TOKEN_RIGHT_PAREN;
+}
+
+static gboolean
+gimp_paint_core_replay_stroke (GimpPaintRecord  *record,
+                               GimpDrawable     *drawable,
+                               gint64            replay_start,
+                               gboolean          real_time,
+                               GError          **error)
+{
+  GimpPaintOptions           *options = record->options;
+  GimpPaintCore              *core;
+  const GimpPaintRecordEvent *event;
+  gint64                      stroke_start;
+  gint                        i;
+
+  if (record->events->len == 0)
+    return TRUE;
+
+  if (real_time)
+    gimp_paint_core_replay_wait (replay_start + record->start_time * 1000);
+
+  core = g_object_new (options->paint_info->paint_type,
+                       "undo-desc", options->paint_info->blurb,
+                       NULL);
+
+  stroke_start = g_get_monotonic_time ();
+
+  event = &g_array_index (record->events, GimpPaintRecordEvent, 0);
+
+  if (! gimp_paint_core_start (core, drawable, options, &event->coords,
+                               error))
+    {
+      g_object_unref (core);
+
+      return FALSE;
+    }
+
+  core->last_coords = event->coords;
+
+  gimp_paint_core_paint (core, drawable, options,
+                         GIMP_PAINT_STATE_INIT, 0);
+
+  gimp_paint_core_paint (core, drawable, options,
+                         GIMP_PAINT_STATE_MOTION, 0);
+
+  for (i = 1; i < record->events->len; i++)
+    {
+      event = &g_array_index (record->events, GimpPaintRecordEvent, i);
+
+      if (real_time)
+        gimp_paint_core_replay_wait (stroke_start + event->time * 1000);
+
+      gimp_paint_core_interpolate (core, drawable, options,
+                                   &event->coords, event->time);
+    }
+
+  gimp_paint_core_paint (core, drawable, options,
+                         GIMP_PAINT_STATE_FINISH, 0);
+
+  gimp_paint_core_finish (core, drawable, TRUE);
+
+  gimp_paint_core_cleanup (core);
+
+  g_object_unref (core);
+
+  gimp_image_flush (gimp_item_get_image (GIMP_ITEM (drawable)));
+
+  return TRUE;
+}
+
+static void
+gimp_paint_core_replay_wait (gint64 until)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  if (until > now)
+    g_usleep (until - now);
+}
@@ -0,0 +1,48 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PAINT_CORE_RECORD_H__
+#define __GIMP_PAINT_CORE_RECORD_H__
+
+
+void       gimp_paint_core_record_init  (const gchar       *filename);
+
+
+/*  recording, called by GimpPaintCore  */
+
+void       gimp_paint_core_record_start (GimpPaintCore     *core,
+                                         GimpPaintOptions  *paint_options,
+                                         const GimpCoords  *coords);
+void       gimp_paint_core_record_event (GimpPaintCore     *core,
+                                         const GimpCoords  *coords,
+                                         guint32            time);
+void       gimp_paint_core_record_stop  (GimpPaintCore     *core,
+                                         gboolean           save);
+
+
+/*  replaying  */
+
+gboolean   gimp_paint_core_replay       (Gimp              *gimp,
+                                         GimpDrawable      *drawable,
+                                         GFile             *file,
+                                         gboolean           real_time,
+                                         gint              *n_strokes,
+                                         gint              *n_events,
+                                         GError           **error);
+
+
+#endif  /*  __GIMP_PAINT_CORE_RECORD_H__  */
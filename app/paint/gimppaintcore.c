@@ -36,6 +36,7 @@
 #include "gegl/gimpapplicator.h"
 
 #include "core/gimp.h"
+#include "core/gimp-latency.h"
 #include "core/gimp-utils.h"
 #include "core/gimpchannel.h"
 #include "core/gimpimage.h"
@@ -50,11 +51,13 @@
 #include "gimppaintcore.h"
 #include "gimppaintcoreundo.h"
 #include "gimppaintcore-loops.h"
+#include "gimppaintcore-record.h"
 #include "gimppaintoptions.h"
 
 #include "gimpairbrush.h"
 
 #include "gimp-intl.h"
+#include "gimp-trace.h"
 
 
 #define STROKE_BUFFER_INIT_SIZE 2000
@@ -117,6 +120,9 @@ static GimpUndo* gimp_paint_core_real_push_undo      (GimpPaintCore    *core,
                                                       GimpImage        *image,
                                                       const gchar      *undo_desc);
 
+static void      gimp_paint_core_previews_freeze     (GimpDrawable     *drawable);
+static void      gimp_paint_core_previews_thaw       (GimpDrawable     *drawable);
+
 
 G_DEFINE_TYPE (GimpPaintCore, gimp_paint_core, GIMP_TYPE_OBJECT)
 
@@ -162,6 +168,8 @@ gimp_paint_core_finalize (GObject *object)
 
   gimp_paint_core_cleanup (core);
 
+  gimp_paint_core_record_stop (core, FALSE);
+
   g_clear_pointer (&core->undo_desc, g_free);
 
   if (core->stroke_buffer)
@@ -291,6 +299,42 @@ gimp_paint_core_real_push_undo (GimpPaintCore *core,
                                NULL);
 }
 
+/*  Freeze the previews of the drawable, its parents and its image, so
+ *  they are rendered once when the stroke is done, instead of being
+ *  invalidated by each update of the stroke.
+ */
+static void
+gimp_paint_core_previews_freeze (GimpDrawable *drawable)
+{
+  GimpViewable *viewable;
+
+  for (viewable = GIMP_VIEWABLE (drawable);
+       viewable;
+       viewable = gimp_viewable_get_parent (viewable))
+    {
+      gimp_viewable_preview_freeze (viewable);
+    }
+
+  gimp_viewable_preview_freeze (
+    GIMP_VIEWABLE (gimp_item_get_image (GIMP_ITEM (drawable))));
+}
+
+static void
+gimp_paint_core_previews_thaw (GimpDrawable *drawable)
+{
+  GimpViewable *viewable;
+
+  for (viewable = GIMP_VIEWABLE (drawable);
+       viewable;
+       viewable = gimp_viewable_get_parent (viewable))
+    {
+      gimp_viewable_preview_thaw (viewable);
+    }
+
+  gimp_viewable_preview_thaw (
+    GIMP_VIEWABLE (gimp_item_get_image (GIMP_ITEM (drawable))));
+}
+
 
 /*  public functions  */
 
@@ -317,6 +361,7 @@ gimp_paint_core_paint (GimpPaintCore    *core,
       GimpSymmetry *sym;
       GimpImage    *image;
       GimpItem     *item;
+      gint64        start_time;
 
       item  = GIMP_ITEM (drawable);
       image = gimp_item_get_image (item);
@@ -331,10 +376,17 @@ gimp_paint_core_paint (GimpPaintCore    *core,
       sym = g_object_ref (gimp_image_get_active_symmetry (image));
       gimp_symmetry_set_origin (sym, drawable, &core->cur_coords);
 
+      GIMP_TRACE_BEGIN ("paint-core-paint");
+      start_time = g_get_monotonic_time ();
+
       core_class->paint (core, drawable,
                          paint_options,
                          sym, paint_state, time);
 
+      gimp_latency_record (GIMP_LATENCY_PAINT_DAB,
+                           g_get_monotonic_time () - start_time);
+      GIMP_TRACE_END ("paint-core-paint");
+
       g_object_unref (sym);
 
       core_class->post_paint (core, drawable,
@@ -481,8 +533,10 @@ gimp_paint_core_start (GimpPaintCore     *core,
         }
     }
 
-  /*  Freeze the drawable preview so that it isn't constantly updated.  */
-  gimp_viewable_preview_freeze (GIMP_VIEWABLE (drawable));
+  /*  Freeze the previews so that they aren't constantly updated.  */
+  gimp_paint_core_previews_freeze (drawable);
+
+  gimp_paint_core_record_start (core, paint_options, coords);
 
   return TRUE;
 }
@@ -498,6 +552,8 @@ gimp_paint_core_finish (GimpPaintCore *core,
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
   g_return_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)));
 
+  gimp_paint_core_record_stop (core, TRUE);
+
   g_clear_object (&core->applicator);
 
   if (core->stroke_buffer)
@@ -516,7 +572,7 @@ gimp_paint_core_finish (GimpPaintCore *core,
    */
   if ((core->x2 == core->x1) || (core->y2 == core->y1))
     {
-      gimp_viewable_preview_thaw (GIMP_VIEWABLE (drawable));
+      gimp_paint_core_previews_thaw (drawable);
       return;
     }
 
@@ -537,14 +593,8 @@ gimp_paint_core_finish (GimpPaintCore *core,
 
       GIMP_PAINT_CORE_GET_CLASS (core)->push_undo (core, image, NULL);
 
-      buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
-                                gimp_drawable_get_format (drawable));
-
-      gegl_buffer_copy (core->undo_buffer,
-                        GEGL_RECTANGLE (x, y, width, height),
-                        GEGL_ABYSS_NONE,
-                        buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      buffer = gimp_gegl_buffer_dup_area (core->undo_buffer,
+                                          GEGL_RECTANGLE (x, y, width, height));
 
       gimp_drawable_push_undo (drawable, NULL,
                                buffer, x, y, width, height);
@@ -557,7 +607,7 @@ gimp_paint_core_finish (GimpPaintCore *core,
   g_clear_object (&core->undo_buffer);
   g_clear_object (&core->saved_proj_buffer);
 
-  gimp_viewable_preview_thaw (GIMP_VIEWABLE (drawable));
+  gimp_paint_core_previews_thaw (drawable);
 }
 
 void
@@ -571,6 +621,8 @@ gimp_paint_core_cancel (GimpPaintCore *core,
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
   g_return_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)));
 
+  gimp_paint_core_record_stop (core, FALSE);
+
   /*  Determine if any part of the image has been altered--
    *  if nothing has, then just return...
    */
@@ -597,7 +649,7 @@ gimp_paint_core_cancel (GimpPaintCore *core,
 
   gimp_drawable_update (drawable, x, y, width, height);
 
-  gimp_viewable_preview_thaw (GIMP_VIEWABLE (drawable));
+  gimp_paint_core_previews_thaw (drawable);
 }
 
 void
@@ -626,6 +678,8 @@ gimp_paint_core_interpolate (GimpPaintCore    *core,
 
   core->cur_coords = *coords;
 
+  gimp_paint_core_record_event (core, coords, time);
+
   GIMP_PAINT_CORE_GET_CLASS (core)->interpolate (core, drawable,
                                                  paint_options, time);
 }
@@ -70,6 +70,10 @@ struct _GimpPaintCore
   GimpApplicator *applicator;
 
   GArray      *stroke_buffer;
+
+  gpointer     record;            /*  the stroke being recorded, see
+                                   *  gimppaintcore-record.c
+                                   */
 };
 
 struct _GimpPaintCoreClass
@@ -0,0 +1,313 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* checks that the accelerated paint core row kernels produce results
+ * that are bit-identical to the generic ones, and reports the time
+ * taken by both.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "paint/paint-types.h"
+
+#include "paint/gimppaintcore-loops.h"
+
+
+/* an odd number, so that the scalar tail of the accelerated functions is
+ * exercised too
+ */
+#define N_SAMPLES 1023
+#define N_ROUNDS  2000
+
+
+typedef void (* CombineMaskU8Func)    (const guint8 *mask,
+                                       gfloat       *canvas,
+                                       gfloat        opacity,
+                                       gboolean      stipple,
+                                       gint          samples);
+typedef void (* CombineMaskFloatFunc) (const gfloat *mask,
+                                       gfloat       *canvas,
+                                       gfloat        opacity,
+                                       gboolean      stipple,
+                                       gint          samples);
+typedef void (* MaskAlphaU8Func)      (const guint8 *mask,
+                                       gfloat       *paint,
+                                       gfloat        opacity,
+                                       gint          samples);
+typedef void (* MaskAlphaFloatFunc)   (const gfloat *mask,
+                                       gfloat       *paint,
+                                       gfloat        opacity,
+                                       gint          samples);
+
+
+static guint8 mask_u8[N_SAMPLES];
+static gfloat mask_float[N_SAMPLES];
+static gfloat canvas[N_SAMPLES];
+static gfloat paint[4 * N_SAMPLES];
+
+
+static void
+init_samples (GRand *grand)
+{
+  gint i;
+
+  for (i = 0; i < N_SAMPLES; i++)
+    {
+      mask_u8[i]    = g_rand_int_range (grand, 0, 256);
+      mask_float[i] = g_rand_double (grand);
+
+      /* a fair amount of untouched canvas */
+      canvas[i] = g_rand_int_range (grand, 0, 4) ? g_rand_double (grand) : 0.0f;
+    }
+
+  for (i = 0; i < 4 * N_SAMPLES; i++)
+    paint[i] = g_rand_double_range (grand, -0.25, 1.25);
+}
+
+static gint
+report (const gchar *name,
+        gboolean     differs,
+        gdouble      generic_time,
+        gdouble      accel_time)
+{
+  if (differs)
+    {
+      g_print ("%s: results differ\n", name);
+      return 1;
+    }
+
+  g_print ("%-20s generic %7.3f us, accelerated %7.3f us\n",
+           name,
+           1e6 * generic_time / N_ROUNDS,
+           1e6 * accel_time   / N_ROUNDS);
+
+  return 0;
+}
+
+static gint
+test_combine_mask (const gchar   *name,
+                   gconstpointer  mask,
+                   gpointer       generic,
+                   gpointer       accel,
+                   gboolean       is_u8,
+                   gboolean       stipple)
+{
+  const gfloat  opacity = 0.75f;
+  gfloat        expected[N_SAMPLES];
+  gfloat        result[N_SAMPLES];
+  GTimer       *timer   = g_timer_new ();
+  gdouble       generic_time;
+  gdouble       accel_time;
+  gint          i;
+
+  memcpy (expected, canvas, sizeof (canvas));
+  memcpy (result,   canvas, sizeof (canvas));
+
+  if (is_u8)
+    {
+      ((CombineMaskU8Func) generic) (mask, expected, opacity, stipple, N_SAMPLES);
+      ((CombineMaskU8Func) accel)   (mask, result,   opacity, stipple, N_SAMPLES);
+    }
+  else
+    {
+      ((CombineMaskFloatFunc) generic) (mask, expected, opacity, stipple, N_SAMPLES);
+      ((CombineMaskFloatFunc) accel)   (mask, result,   opacity, stipple, N_SAMPLES);
+    }
+
+  if (memcmp (expected, result, sizeof (expected)))
+    {
+      g_timer_destroy (timer);
+
+      return report (name, TRUE, 0.0, 0.0);
+    }
+
+  /* the canvas saturates quickly, so time the kernels on a fresh copy
+   * each round
+   */
+  g_timer_start (timer);
+  for (i = 0; i < N_ROUNDS; i++)
+    {
+      memcpy (expected, canvas, sizeof (canvas));
+
+      if (is_u8)
+        ((CombineMaskU8Func) generic) (mask, expected, opacity, stipple, N_SAMPLES);
+      else
+        ((CombineMaskFloatFunc) generic) (mask, expected, opacity, stipple, N_SAMPLES);
+    }
+  generic_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ROUNDS; i++)
+    {
+      memcpy (result, canvas, sizeof (canvas));
+
+      if (is_u8)
+        ((CombineMaskU8Func) accel) (mask, result, opacity, stipple, N_SAMPLES);
+      else
+        ((CombineMaskFloatFunc) accel) (mask, result, opacity, stipple, N_SAMPLES);
+    }
+  accel_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  return report (name, FALSE, generic_time, accel_time);
+}
+
+static gint
+test_mask_alpha (const gchar   *name,
+                 gconstpointer  mask,
+                 gpointer       generic,
+                 gpointer       accel,
+                 gboolean       is_u8)
+{
+  const gfloat  opacity = 0.75f;
+  gfloat        expected[4 * N_SAMPLES];
+  gfloat        result[4 * N_SAMPLES];
+  GTimer       *timer   = g_timer_new ();
+  gdouble       generic_time;
+  gdouble       accel_time;
+  gint          i;
+
+  memcpy (expected, paint, sizeof (paint));
+  memcpy (result,   paint, sizeof (paint));
+
+  if (is_u8)
+    {
+      ((MaskAlphaU8Func) generic) (mask, expected, opacity, N_SAMPLES);
+      ((MaskAlphaU8Func) accel)   (mask, result,   opacity, N_SAMPLES);
+    }
+  else
+    {
+      ((MaskAlphaFloatFunc) generic) (mask, expected, opacity, N_SAMPLES);
+      ((MaskAlphaFloatFunc) accel)   (mask, result,   opacity, N_SAMPLES);
+    }
+
+  if (memcmp (expected, result, sizeof (expected)))
+    {
+      g_timer_destroy (timer);
+
+      return report (name, TRUE, 0.0, 0.0);
+    }
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ROUNDS; i++)
+    {
+      memcpy (expected, paint, sizeof (paint));
+
+      if (is_u8)
+        ((MaskAlphaU8Func) generic) (mask, expected, opacity, N_SAMPLES);
+      else
+        ((MaskAlphaFloatFunc) generic) (mask, expected, opacity, N_SAMPLES);
+    }
+  generic_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ROUNDS; i++)
+    {
+      memcpy (result, paint, sizeof (paint));
+
+      if (is_u8)
+        ((MaskAlphaU8Func) accel) (mask, result, opacity, N_SAMPLES);
+      else
+        ((MaskAlphaFloatFunc) accel) (mask, result, opacity, N_SAMPLES);
+    }
+  accel_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  return report (name, FALSE, generic_time, accel_time);
+}
+
+int
+main (void)
+{
+  gint failures = 0;
+  gint n_tests  = 0;
+
+  g_print ("\nTesting the accelerated paint core kernels ...\n");
+
+#if COMPILE_AVX2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2)
+    {
+      GRand *grand = g_rand_new_with_seed (0);
+
+      init_samples (grand);
+
+      n_tests++;
+      failures += test_combine_mask ("combine u8",
+                                     mask_u8,
+                                     gimp_paint_core_loops_combine_mask_u8,
+                                     gimp_paint_core_loops_combine_mask_u8_avx2,
+                                     TRUE, FALSE);
+      n_tests++;
+      failures += test_combine_mask ("combine u8 stipple",
+                                     mask_u8,
+                                     gimp_paint_core_loops_combine_mask_u8,
+                                     gimp_paint_core_loops_combine_mask_u8_avx2,
+                                     TRUE, TRUE);
+      n_tests++;
+      failures += test_combine_mask ("combine float",
+                                     mask_float,
+                                     gimp_paint_core_loops_combine_mask_float,
+                                     gimp_paint_core_loops_combine_mask_float_avx2,
+                                     FALSE, FALSE);
+      n_tests++;
+      failures += test_combine_mask ("combine float stipple",
+                                     mask_float,
+                                     gimp_paint_core_loops_combine_mask_float,
+                                     gimp_paint_core_loops_combine_mask_float_avx2,
+                                     FALSE, TRUE);
+      n_tests++;
+      failures += test_mask_alpha ("mask alpha u8",
+                                   mask_u8,
+                                   gimp_paint_core_loops_mask_alpha_u8,
+                                   gimp_paint_core_loops_mask_alpha_u8_avx2,
+                                   TRUE);
+      n_tests++;
+      failures += test_mask_alpha ("mask alpha float",
+                                   mask_float,
+                                   gimp_paint_core_loops_mask_alpha_float,
+                                   gimp_paint_core_loops_mask_alpha_float_avx2,
+                                   FALSE);
+
+      g_rand_free (grand);
+    }
+  else
+    {
+      g_print ("AVX2 not supported by this CPU, skipping.\n");
+    }
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+  if (failures)
+    {
+      g_print ("%d out of %d kernels failed!\n\n", failures, n_tests);
+      return EXIT_FAILURE;
+    }
+  else
+    {
+      g_print ("All %d kernels passed.\n\n", n_tests);
+      return EXIT_SUCCESS;
+    }
+}
@@ -1028,6 +1028,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1094,6 +1095,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1123,6 +1125,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1152,6 +1155,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1181,6 +1185,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1210,6 +1215,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1239,6 +1245,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1268,6 +1275,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -1297,6 +1305,7 @@ register_drawable_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_drawable_id ("drawable",
                                                             "drawable",
@@ -37,6 +37,7 @@
 #include "core/gimpimage.h"
 #include "core/gimplayer.h"
 #include "core/gimpparamspecs.h"
+#include "file/file-map.h"
 #include "file/file-open.h"
 #include "file/file-save.h"
 #include "file/file-utils.h"
@@ -619,6 +620,47 @@ register_thumbnail_loader_invoker (GimpProcedure         *procedure,
                                            error ? *error : NULL);
 }
 
+static GimpValueArray *
+file_map_invoker (GimpProcedure         *procedure,
+                  Gimp                  *gimp,
+                  GimpContext           *context,
+                  GimpProgress          *progress,
+                  const GimpValueArray  *args,
+                  GError               **error)
+{
+  gboolean success = TRUE;
+  GimpValueArray *return_vals;
+  const gchar *pattern;
+  const gchar *procedure_name;
+  const gchar *output;
+  gint32 max_jobs;
+  gint32 num_processed = 0;
+  gint32 num_failed = 0;
+
+  pattern = g_value_get_string (gimp_value_array_index (args, 0));
+  procedure_name = g_value_get_string (gimp_value_array_index (args, 1));
+  output = g_value_get_string (gimp_value_array_index (args, 2));
+  max_jobs = g_value_get_int (gimp_value_array_index (args, 3));
+
+  if (success)
+    {
+      success = file_map (gimp, context, progress,
+                          pattern, procedure_name, output, max_jobs,
+                          &num_processed, &num_failed, error);
+    }
+
+  return_vals = gimp_procedure_get_return_values (procedure, success,
+                                                  error ? *error : NULL);
+
+  if (success)
+    {
+      g_value_set_int (gimp_value_array_index (return_vals, 1), num_processed);
+      g_value_set_int (gimp_value_array_index (return_vals, 2), num_failed);
+    }
+
+  return return_vals;
+}
+
 void
 register_fileops_procs (GimpPDB *pdb)
 {
@@ -1122,4 +1164,60 @@ register_fileops_procs (GimpPDB *pdb)
                                                        GIMP_PARAM_READWRITE));
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
+
+  /*
+   * gimp-file-map
+   */
+  procedure = gimp_procedure_new (file_map_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-file-map");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-file-map",
+                                     "Loads, processes and exports all files matching a pattern.",
+                                     "This procedure loads every file whose name matches @pattern, runs @procedure on its active drawable and exports the result to @output, where \"%s\" is replaced with the input file's name without its extension. Only the file name part of @pattern may contain wildcards. @procedure must take a run mode, an image and a drawable, its other arguments keep their default values; pass an empty string to only convert the files. Up to @max_jobs files are processed at the same time, each file moving on to its next step as soon as the previous one is done, so loading, processing and exporting of different files overlap. A @max_jobs of 0 uses the number of processors. Files that fail are reported and skipped.",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "1995-1996",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string ("pattern",
+                                                       "pattern",
+                                                       "The pattern of the files to process, like /photos/*.jpg",
+                                                       TRUE, FALSE, FALSE,
+                                                       NULL,
+                                                       GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string ("procedure-name",
+                                                       "procedure name",
+                                                       "The procedure to run on each image, or an empty string",
+                                                       FALSE, FALSE, FALSE,
+                                                       NULL,
+                                                       GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string ("output",
+                                                       "output",
+                                                       "The name of the files to export to, with %s for the input file's name",
+                                                       TRUE, FALSE, FALSE,
+                                                       NULL,
+                                                       GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("max-jobs",
+                                                      "max jobs",
+                                                      "The number of files processed at the same time, or 0",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("num-processed",
+                                                          "num processed",
+                                                          "The number of files processed",
+                                                          G_MININT32, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("num-failed",
+                                                          "num failed",
+                                                          "The number of files that failed",
+                                                          G_MININT32, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
 }
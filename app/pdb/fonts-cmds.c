@@ -46,7 +46,8 @@ fonts_refresh_invoker (GimpProcedure         *procedure,
                        const GimpValueArray  *args,
                        GError               **error)
 {
-  gimp_fonts_load (gimp, NULL);
+  gimp_fonts_load (gimp);
+  gimp_fonts_wait (gimp);
 
   return gimp_procedure_get_return_values (procedure, TRUE, NULL);
 }
@@ -69,6 +70,8 @@ fonts_get_list_invoker (GimpProcedure         *procedure,
 
   if (success)
     {
+      gimp_fonts_wait (gimp);
+
       font_list = gimp_container_get_filtered_name_array (gimp->fonts,
                                                           filter, &num_fonts);
     }
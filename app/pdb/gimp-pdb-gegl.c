@@ -0,0 +1,342 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-pdb-gegl.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gegl-paramspecs.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor.h"
+
+#include "pdb-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable-operation.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpparamspecs.h"
+
+#include "gegl/gimp-gegl-utils.h"
+
+#include "gimp-pdb-gegl.h"
+#include "gimppdb.h"
+#include "gimppdb-utils.h"
+#include "gimpprocedure.h"
+
+#include "gimp-intl.h"
+
+
+#define PROCEDURE_KEY          "gimp:procedure"
+#define OPERATION_DATA_KEY     "gimp-pdb-gegl-operation"
+
+/*  run-mode, image and drawable come before the operation's properties  */
+#define N_FIXED_ARGS           3
+
+
+static GimpProcedure  * gimp_pdb_gegl_proc_new     (GimpPDB              *pdb,
+                                                    const gchar          *operation,
+                                                    const gchar          *name);
+static GParamSpec     * gimp_pdb_gegl_param_spec   (GParamSpec           *pspec);
+static GimpValueArray * gimp_pdb_gegl_proc_invoker (GimpProcedure        *procedure,
+                                                    Gimp                 *gimp,
+                                                    GimpContext          *context,
+                                                    GimpProgress         *progress,
+                                                    const GimpValueArray *args,
+                                                    GError              **error);
+
+
+/*  public functions  */
+
+void
+gimp_pdb_gegl_procs_register (GimpPDB *pdb)
+{
+  gchar **operations;
+  guint   n_operations;
+  gint    i;
+
+  g_return_if_fail (GIMP_IS_PDB (pdb));
+
+  operations = gegl_list_operations (&n_operations);
+
+  for (i = 0; i < n_operations; i++)
+    {
+      const gchar   *name = gegl_operation_get_key (operations[i],
+                                                    PROCEDURE_KEY);
+      GimpProcedure *procedure;
+
+      if (! name)
+        continue;
+
+      if (gimp_pdb_lookup_procedure (pdb, name))
+        {
+          g_printerr ("GEGL operation \"%s\" tried to register procedure "
+                      "\"%s\", which already exists\n",
+                      operations[i], name);
+          continue;
+        }
+
+      procedure = gimp_pdb_gegl_proc_new (pdb, operations[i], name);
+
+      if (procedure)
+        {
+          if (pdb->gimp->be_verbose)
+            g_print ("Registering \"%s\" for GEGL operation \"%s\"\n",
+                     name, operations[i]);
+
+          gimp_pdb_register_procedure (pdb, procedure);
+          g_object_unref (procedure);
+        }
+    }
+
+  g_free (operations);
+}
+
+
+/*  private functions  */
+
+static GimpProcedure *
+gimp_pdb_gegl_proc_new (GimpPDB     *pdb,
+                        const gchar *operation,
+                        const gchar *name)
+{
+  GimpProcedure  *procedure;
+  GeglNode       *node;
+  GParamSpec    **pspecs;
+  guint           n_pspecs;
+  const gchar    *title;
+  const gchar    *description;
+  gchar          *author;
+  gboolean        is_filter;
+  gint            i;
+
+  /*  only operations with an input and an output can be applied to
+   *  drawables
+   */
+  node = gegl_node_new_child (NULL,
+                              "operation", operation,
+                              NULL);
+
+  is_filter = (gegl_node_has_pad (node, "input") &&
+               gegl_node_has_pad (node, "output"));
+
+  g_object_unref (node);
+
+  if (! is_filter)
+    {
+      g_printerr ("GEGL operation \"%s\" is not a filter and can't "
+                  "register procedure \"%s\"\n",
+                  operation, name);
+      return NULL;
+    }
+
+  title       = gegl_operation_get_key (operation, "title");
+  description = gegl_operation_get_key (operation, "description");
+
+  if (! title)
+    title = operation;
+
+  author = g_strdup_printf ("Procedure for GEGL operation '%s'", operation);
+
+  procedure = gimp_procedure_new (gimp_pdb_gegl_proc_invoker);
+  gimp_object_set_name (GIMP_OBJECT (procedure), name);
+  gimp_procedure_set_strings (procedure,
+                              name,
+                              title,
+                              description ? description : "",
+                              author,
+                              author,
+                              "",
+                              NULL);
+  g_free (author);
+
+  g_object_set_data_full (G_OBJECT (procedure), OPERATION_DATA_KEY,
+                          g_strdup (operation), (GDestroyNotify) g_free);
+
+  gimp_procedure_add_argument (procedure,
+                               g_param_spec_enum ("run-mode",
+                                                  "run mode",
+                                                  "The run mode",
+                                                  GIMP_TYPE_RUN_MODE,
+                                                  GIMP_RUN_INTERACTIVE,
+                                                  GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_image_id ("image",
+                                                         "image",
+                                                         "Input image (unused)",
+                                                         pdb->gimp, FALSE,
+                                                         GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_drawable_id ("drawable",
+                                                            "drawable",
+                                                            "Input drawable",
+                                                            pdb->gimp, FALSE,
+                                                            GIMP_PARAM_READWRITE));
+
+  pspecs = gegl_operation_list_properties (operation, &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      GParamSpec *pspec = gimp_pdb_gegl_param_spec (pspecs[i]);
+
+      /*  properties the PDB can't pass keep their default  */
+      if (pspec)
+        gimp_procedure_add_argument (procedure, pspec);
+    }
+
+  g_free (pspecs);
+
+  return procedure;
+}
+
+static GParamSpec *
+gimp_pdb_gegl_param_spec (GParamSpec *pspec)
+{
+  const gchar *name  = g_param_spec_get_name  (pspec);
+  const gchar *nick  = g_param_spec_get_nick  (pspec);
+  const gchar *blurb = g_param_spec_get_blurb (pspec);
+
+  if (! (pspec->flags & G_PARAM_WRITABLE) ||
+      (pspec->flags & G_PARAM_CONSTRUCT_ONLY))
+    return NULL;
+
+  if (! blurb)
+    blurb = nick;
+
+  if (G_IS_PARAM_SPEC_INT (pspec))
+    {
+      GParamSpecInt *ispec = G_PARAM_SPEC_INT (pspec);
+
+      return gimp_param_spec_int32 (name, nick, blurb,
+                                    ispec->minimum, ispec->maximum,
+                                    ispec->default_value,
+                                    GIMP_PARAM_READWRITE);
+    }
+  else if (G_IS_PARAM_SPEC_DOUBLE (pspec))
+    {
+      GParamSpecDouble *dspec = G_PARAM_SPEC_DOUBLE (pspec);
+
+      return g_param_spec_double (name, nick, blurb,
+                                  dspec->minimum, dspec->maximum,
+                                  dspec->default_value,
+                                  GIMP_PARAM_READWRITE);
+    }
+  else if (G_IS_PARAM_SPEC_BOOLEAN (pspec))
+    {
+      GParamSpecBoolean *bspec = G_PARAM_SPEC_BOOLEAN (pspec);
+
+      return g_param_spec_boolean (name, nick, blurb,
+                                   bspec->default_value,
+                                   GIMP_PARAM_READWRITE);
+    }
+  else if (G_IS_PARAM_SPEC_ENUM (pspec))
+    {
+      GParamSpecEnum *espec = G_PARAM_SPEC_ENUM (pspec);
+
+      return g_param_spec_enum (name, nick, blurb,
+                                pspec->value_type,
+                                espec->default_value,
+                                GIMP_PARAM_READWRITE);
+    }
+  else if (G_IS_PARAM_SPEC_STRING (pspec))
+    {
+      GParamSpecString *sspec = G_PARAM_SPEC_STRING (pspec);
+
+      return gimp_param_spec_string (name, nick, blurb,
+                                     FALSE, TRUE, FALSE,
+                                     sspec->default_value,
+                                     GIMP_PARAM_READWRITE);
+    }
+  else if (GEGL_IS_PARAM_SPEC_COLOR (pspec))
+    {
+      GeglColor *color = gegl_param_spec_color_get_default (pspec);
+      GimpRGB    rgb;
+
+      gimp_rgba_set (&rgb, 0.0, 0.0, 0.0, 1.0);
+
+      if (color)
+        gegl_color_get_rgba (color, &rgb.r, &rgb.g, &rgb.b, &rgb.a);
+
+      return gimp_param_spec_rgb (name, nick, blurb,
+                                  TRUE, &rgb,
+                                  GIMP_PARAM_READWRITE);
+    }
+
+  return NULL;
+}
+
+static GimpValueArray *
+gimp_pdb_gegl_proc_invoker (GimpProcedure         *procedure,
+                            Gimp                  *gimp,
+                            GimpContext           *context,
+                            GimpProgress          *progress,
+                            const GimpValueArray  *args,
+                            GError               **error)
+{
+  gboolean      success = TRUE;
+  GimpDrawable *drawable;
+
+  drawable = gimp_value_get_drawable (gimp_value_array_index (args, 2), gimp);
+
+  if (gimp_pdb_item_is_attached (GIMP_ITEM (drawable), NULL,
+                                 GIMP_PDB_ITEM_CONTENT, error) &&
+      gimp_pdb_item_is_not_group (GIMP_ITEM (drawable), error))
+    {
+      const gchar *operation = g_object_get_data (G_OBJECT (procedure),
+                                                  OPERATION_DATA_KEY);
+      GeglNode    *node;
+      gint         i;
+
+      node = gegl_node_new_child (NULL,
+                                  "operation", operation,
+                                  NULL);
+
+      for (i = N_FIXED_ARGS; i < procedure->num_args; i++)
+        {
+          GParamSpec *pspec = procedure->args[i];
+          GValue     *value = gimp_value_array_index (args, i);
+
+          if (GIMP_VALUE_HOLDS_RGB (value))
+            {
+              GimpRGB    rgb;
+              GeglColor *color;
+
+              gimp_value_get_rgb (value, &rgb);
+              color = gimp_gegl_color_new (&rgb);
+
+              gegl_node_set (node, pspec->name, color, NULL);
+
+              g_object_unref (color);
+            }
+          else
+            {
+              gegl_node_set_property (node, pspec->name, value);
+            }
+        }
+
+      gimp_drawable_apply_operation (drawable, progress,
+                                     gimp_procedure_get_blurb (procedure),
+                                     node);
+      g_object_unref (node);
+    }
+  else
+    success = FALSE;
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
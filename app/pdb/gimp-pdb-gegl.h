@@ -0,0 +1,32 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PDB_GEGL_H__
+#define __GIMP_PDB_GEGL_H__
+
+
+/*  A GEGL operation, which can come from a GEGL plug-in or from a
+ *  GIMP module, can set the key "gimp:procedure" to the name of a
+ *  procedure. GIMP then registers that procedure, which runs the
+ *  operation on a drawable's buffer in-process, instead of running a
+ *  plug-in. An operation should only set the key if it doesn't need
+ *  anything but GEGL, and is safe to be processed in several threads.
+ */
+void   gimp_pdb_gegl_procs_register (GimpPDB *pdb);
+
+
+#endif  /*  __GIMP_PDB_GEGL_H__  */
@@ -56,6 +56,8 @@ struct _GimpProcedure
   gchar            *date;           /* Date field                     */
   gchar            *deprecated;     /* Replacement if deprecated      */
 
+  gboolean          pure;           /* Has no side effects            */
+
   gint32            num_args;       /* Number of procedure arguments  */
   GParamSpec      **args;           /* Array of procedure arguments   */
 
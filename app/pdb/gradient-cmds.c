@@ -339,29 +339,27 @@ gradient_get_uniform_samples_invoker (GimpProcedure         *procedure,
 
       if (gradient)
         {
-          GimpGradientSegment *seg   = NULL;
-          gdouble              pos   = 0.0;
-          gdouble              delta = 1.0 / (num_samples - 1);
-          gdouble             *sample;
+          GimpRGB *colors;
+          gdouble *sample;
+          gint     i;
 
           num_color_samples = num_samples * 4;
 
           sample = color_samples = g_new (gdouble, num_color_samples);
+          colors = g_new (GimpRGB, num_samples);
 
-          while (num_samples--)
-            {
-              GimpRGB color;
-
-              seg = gimp_gradient_get_color_at (gradient, context, seg,
-                                                pos, reverse, &color);
-
-              *sample++ = color.r;
-              *sample++ = color.g;
-              *sample++ = color.b;
-              *sample++ = color.a;
+          gimp_gradient_get_uniform_colors (gradient, context, 0.0, 1.0,
+                                            num_samples, reverse, colors);
 
-              pos += delta;
+          for (i = 0; i < num_samples; i++)
+            {
+              *sample++ = colors[i].r;
+              *sample++ = colors[i].g;
+              *sample++ = colors[i].b;
+              *sample++ = colors[i].a;
             }
+
+          g_free (colors);
         }
       else
         success = FALSE;
@@ -407,28 +405,27 @@ gradient_get_custom_samples_invoker (GimpProcedure         *procedure,
 
       if (gradient)
         {
-          GimpGradientSegment *seg = NULL;
-          gdouble             *sample;
+          GimpRGB *colors;
+          gdouble *sample;
+          gint     i;
 
           num_color_samples = num_samples * 4;
 
           sample = color_samples = g_new (gdouble, num_color_samples);
+          colors = g_new (GimpRGB, num_samples);
 
-          while (num_samples--)
-            {
-              GimpRGB color;
-
-              seg = gimp_gradient_get_color_at (gradient, context,
-                                                seg, *positions,
-                                                reverse, &color);
-
-              *sample++ = color.r;
-              *sample++ = color.g;
-              *sample++ = color.b;
-              *sample++ = color.a;
+          gimp_gradient_get_colors (gradient, context, positions, num_samples,
+                                    reverse, colors);
 
-              positions++;
+          for (i = 0; i < num_samples; i++)
+            {
+              *sample++ = colors[i].r;
+              *sample++ = colors[i].g;
+              *sample++ = colors[i].b;
+              *sample++ = colors[i].a;
             }
+
+          g_free (colors);
         }
       else
         success = FALSE;
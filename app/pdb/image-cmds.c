@@ -1532,10 +1532,7 @@ image_get_metadata_invoker (GimpProcedure         *procedure,
 
   if (success)
     {
-      GimpMetadata *metadata = gimp_image_get_metadata (image);
-
-      if (metadata)
-        metadata_string = gimp_metadata_serialize (metadata);
+      metadata_string = g_strdup (gimp_image_get_metadata_string (image));
     }
 
   return_vals = gimp_procedure_get_return_values (procedure, success,
@@ -2981,6 +2978,7 @@ register_image_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_image_id ("image",
                                                          "image",
@@ -3071,6 +3069,7 @@ register_image_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_image_id ("image",
                                                          "image",
@@ -3100,6 +3099,7 @@ register_image_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_image_id ("image",
                                                          "image",
@@ -3152,6 +3152,7 @@ register_image_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_image_id ("image",
                                                          "image",
@@ -3186,6 +3187,7 @@ register_image_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_image_id ("image",
                                                          "image",
@@ -3220,6 +3222,7 @@ register_image_procs (GimpPDB *pdb)
                                      "Simon Budig",
                                      "2005",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_image_id ("image",
                                                          "image",
@@ -279,6 +279,70 @@ image_undo_thaw_invoker (GimpProcedure         *procedure,
   return return_vals;
 }
 
+static GimpValueArray *
+image_begin_tree_batch_invoker (GimpProcedure         *procedure,
+                                Gimp                  *gimp,
+                                GimpContext           *context,
+                                GimpProgress          *progress,
+                                const GimpValueArray  *args,
+                                GError               **error)
+{
+  gboolean success = TRUE;
+  GimpImage *image;
+
+  image = gimp_value_get_image (gimp_value_array_index (args, 0), gimp);
+
+  if (success)
+    {
+      GimpPlugIn  *plug_in   = gimp->plug_in_manager->current_plug_in;
+      const gchar *undo_desc = NULL;
+
+      if (plug_in)
+        {
+          success = gimp_plug_in_cleanup_tree_batch_begin (plug_in, image);
+
+          if (success)
+            undo_desc = gimp_plug_in_get_undo_desc (plug_in);
+        }
+
+      if (success)
+        gimp_image_begin_tree_batch (image, undo_desc);
+    }
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
+
+static GimpValueArray *
+image_end_tree_batch_invoker (GimpProcedure         *procedure,
+                              Gimp                  *gimp,
+                              GimpContext           *context,
+                              GimpProgress          *progress,
+                              const GimpValueArray  *args,
+                              GError               **error)
+{
+  gboolean success = TRUE;
+  GimpImage *image;
+
+  image = gimp_value_get_image (gimp_value_array_index (args, 0), gimp);
+
+  if (success)
+    {
+      GimpPlugIn *plug_in = gimp->plug_in_manager->current_plug_in;
+
+      if (plug_in)
+        success = gimp_plug_in_cleanup_tree_batch_end (plug_in, image);
+      else
+        success = gimp_image_is_tree_batch (image);
+
+      if (success)
+        gimp_image_end_tree_batch (image);
+    }
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
+
 void
 register_image_undo_procs (GimpPDB *pdb)
 {
@@ -474,4 +538,50 @@ register_image_undo_procs (GimpPDB *pdb)
                                                          GIMP_PARAM_READWRITE));
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
+
+  /*
+   * gimp-image-begin-tree-batch
+   */
+  procedure = gimp_procedure_new (image_begin_tree_batch_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-image-begin-tree-batch");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-image-begin-tree-batch",
+                                     "Starts a batch of changes to the image's layers, channels and paths.",
+                                     "This procedure starts a batch of changes to the structure of the image, for example when a script adds or reorders many layers. Until the batch is ended with 'gimp-image-end-tree-batch', the layers, channels and paths dialogs and the image preview are not updated, the image's displays are not redrawn, and all changes are combined into a single undo group. Batches can be nested.",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "1995-1996",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_image_id ("image",
+                                                         "image",
+                                                         "The image",
+                                                         pdb->gimp, FALSE,
+                                                         GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
+  /*
+   * gimp-image-end-tree-batch
+   */
+  procedure = gimp_procedure_new (image_end_tree_batch_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-image-end-tree-batch");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-image-end-tree-batch",
+                                     "Ends a batch of changes to the image's layers, channels and paths.",
+                                     "This procedure must be called once for each 'gimp-image-begin-tree-batch' call that is made. When the outermost batch ends, the dialogs, the image preview and the displays are updated once for all changes made in the batch.",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "1995-1996",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_image_id ("image",
+                                                         "image",
+                                                         "The image",
+                                                         pdb->gimp, FALSE,
+                                                         GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
 }
@@ -1295,6 +1295,7 @@ register_item_procs (GimpPDB *pdb)
                                      "Michael Natterer",
                                      "2010",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_item_id ("item",
                                                         "item",
@@ -1445,6 +1446,7 @@ register_item_procs (GimpPDB *pdb)
                                      "Spencer Kimball & Peter Mattis",
                                      "1995-1996",
                                      NULL);
+  procedure->pure = TRUE;
   gimp_procedure_add_argument (procedure,
                                gimp_param_spec_item_id ("item",
                                                         "item",
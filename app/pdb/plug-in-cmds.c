@@ -38,6 +38,7 @@
 #include "plug-in/gimpplugindef.h"
 #include "plug-in/gimppluginmanager-menu-branch.h"
 #include "plug-in/gimppluginmanager-query.h"
+#include "plug-in/gimppluginmanager-stats.h"
 #include "plug-in/gimppluginmanager.h"
 #include "plug-in/gimppluginprocedure.h"
 
@@ -93,6 +94,69 @@ plugins_query_invoker (GimpProcedure         *procedure,
   return return_vals;
 }
 
+static GimpValueArray *
+plugins_get_stats_invoker (GimpProcedure         *procedure,
+                           Gimp                  *gimp,
+                           GimpContext           *context,
+                           GimpProgress          *progress,
+                           const GimpValueArray  *args,
+                           GError               **error)
+{
+  gboolean success = TRUE;
+  GimpValueArray *return_vals;
+  const gchar *procedure_name;
+  gint32 n_runs = 0;
+  gdouble spawn_time = 0.0;
+  gdouble handshake_time = 0.0;
+  gdouble core_time = 0.0;
+  gdouble plug_in_time = 0.0;
+  gint32 n_messages = 0;
+  gint32 n_tiles = 0;
+  gdouble bytes_copied = 0.0;
+
+  procedure_name = g_value_get_string (gimp_value_array_index (args, 0));
+
+  if (success)
+    {
+      GimpPlugInStats stats;
+
+      if (! strlen (procedure_name))
+        procedure_name = NULL;
+
+      success = gimp_plug_in_manager_get_stats (gimp->plug_in_manager,
+                                                procedure_name, &stats);
+
+      if (success)
+        {
+          n_runs         = MIN (stats.n_runs,     G_MAXINT32);
+          spawn_time     = stats.spawn_time;
+          handshake_time = stats.handshake_time;
+          core_time      = stats.core_time;
+          plug_in_time   = stats.plug_in_time;
+          n_messages     = MIN (stats.n_messages, G_MAXINT32);
+          n_tiles        = MIN (stats.n_tiles,    G_MAXINT32);
+          bytes_copied   = stats.bytes_copied;
+        }
+    }
+
+  return_vals = gimp_procedure_get_return_values (procedure, success,
+                                                  error ? *error : NULL);
+
+  if (success)
+    {
+      g_value_set_int (gimp_value_array_index (return_vals, 1), n_runs);
+      g_value_set_double (gimp_value_array_index (return_vals, 2), spawn_time);
+      g_value_set_double (gimp_value_array_index (return_vals, 3), handshake_time);
+      g_value_set_double (gimp_value_array_index (return_vals, 4), core_time);
+      g_value_set_double (gimp_value_array_index (return_vals, 5), plug_in_time);
+      g_value_set_int (gimp_value_array_index (return_vals, 6), n_messages);
+      g_value_set_int (gimp_value_array_index (return_vals, 7), n_tiles);
+      g_value_set_double (gimp_value_array_index (return_vals, 8), bytes_copied);
+    }
+
+  return return_vals;
+}
+
 static GimpValueArray *
 plugin_domain_register_invoker (GimpProcedure         *procedure,
                                 Gimp                  *gimp,
@@ -495,6 +559,78 @@ register_plug_in_procs (GimpPDB *pdb)
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
 
+  /*
+   * gimp-plugins-get-stats
+   */
+  procedure = gimp_procedure_new (plugins_get_stats_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-plugins-get-stats");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-plugins-get-stats",
+                                     "Returns the statistics of the runs of a plug-in procedure.",
+                                     "This procedure returns how often a plug-in procedure was run in this session, and where the time of its runs went: starting the plug-in, waiting for its first message, the plug-in waiting for GIMP, and GIMP waiting for the plug-in. It also returns the number of messages and tiles sent between GIMP and the plug-in, and the number of bytes of pixel data copied. If @procedure_name is an empty string, the sums over all plug-in procedures are returned. The procedure fails if no plug-in procedure of that name was run yet.",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "1995-1996",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string ("procedure-name",
+                                                       "procedure name",
+                                                       "The procedure name, or an empty string",
+                                                       FALSE, FALSE, FALSE,
+                                                       NULL,
+                                                       GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("n-runs",
+                                                          "n runs",
+                                                          "The number of runs",
+                                                          G_MININT32, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_double ("spawn-time",
+                                                        "spawn time",
+                                                        "Seconds spent starting the plug-in",
+                                                        -G_MAXDOUBLE, G_MAXDOUBLE, 0,
+                                                        GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_double ("handshake-time",
+                                                        "handshake time",
+                                                        "Seconds until the plug-in sent its first message",
+                                                        -G_MAXDOUBLE, G_MAXDOUBLE, 0,
+                                                        GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_double ("core-time",
+                                                        "core time",
+                                                        "Seconds the plug-in waited for GIMP",
+                                                        -G_MAXDOUBLE, G_MAXDOUBLE, 0,
+                                                        GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_double ("plug-in-time",
+                                                        "plug in time",
+                                                        "Seconds GIMP waited for the plug-in",
+                                                        -G_MAXDOUBLE, G_MAXDOUBLE, 0,
+                                                        GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("n-messages",
+                                                          "n messages",
+                                                          "The number of wire messages",
+                                                          G_MININT32, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("n-tiles",
+                                                          "n tiles",
+                                                          "The number of tiles transferred",
+                                                          G_MININT32, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   g_param_spec_double ("bytes-copied",
+                                                        "bytes copied",
+                                                        "The number of bytes of pixel data copied",
+                                                        -G_MAXDOUBLE, G_MAXDOUBLE, 0,
+                                                        GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
   /*
    * gimp-plugin-domain-register
    */
@@ -48,6 +48,7 @@ struct _GimpPlugInCleanupImage
   gint       image_ID;
 
   gint       undo_group_count;
+  gint       tree_batch_count;
 };
 
 
@@ -127,7 +128,8 @@ gimp_plug_in_cleanup_undo_group_end (GimpPlugIn *plug_in,
   if (! cleanup)
     return FALSE;
 
-  if (cleanup->undo_group_count == gimp_image_get_undo_group_count (image) - 1)
+  if (cleanup->undo_group_count == gimp_image_get_undo_group_count (image) - 1 &&
+      cleanup->tree_batch_count == 0)
     {
       proc_frame->image_cleanups = g_list_remove (proc_frame->image_cleanups,
                                                   cleanup);
@@ -137,6 +139,55 @@ gimp_plug_in_cleanup_undo_group_end (GimpPlugIn *plug_in,
   return TRUE;
 }
 
+gboolean
+gimp_plug_in_cleanup_tree_batch_begin (GimpPlugIn *plug_in,
+                                       GimpImage  *image)
+{
+  GimpPlugInProcFrame    *proc_frame;
+  GimpPlugInCleanupImage *cleanup;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), FALSE);
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+
+  proc_frame = gimp_plug_in_get_proc_frame (plug_in);
+  cleanup    = gimp_plug_in_cleanup_image_get (proc_frame, image);
+
+  if (! cleanup)
+    {
+      cleanup = gimp_plug_in_cleanup_image_new (image);
+
+      cleanup->undo_group_count = gimp_image_get_undo_group_count (image);
+
+      proc_frame->image_cleanups = g_list_prepend (proc_frame->image_cleanups,
+                                                   cleanup);
+    }
+
+  cleanup->tree_batch_count++;
+
+  return TRUE;
+}
+
+gboolean
+gimp_plug_in_cleanup_tree_batch_end (GimpPlugIn *plug_in,
+                                     GimpImage  *image)
+{
+  GimpPlugInProcFrame    *proc_frame;
+  GimpPlugInCleanupImage *cleanup;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), FALSE);
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+
+  proc_frame = gimp_plug_in_get_proc_frame (plug_in);
+  cleanup    = gimp_plug_in_cleanup_image_get (proc_frame, image);
+
+  if (! cleanup || cleanup->tree_batch_count == 0)
+    return FALSE;
+
+  cleanup->tree_batch_count--;
+
+  return TRUE;
+}
+
 gboolean
 gimp_plug_in_cleanup_add_shadow (GimpPlugIn   *plug_in,
                                  GimpDrawable *drawable)
@@ -274,6 +325,21 @@ gimp_plug_in_cleanup_image (GimpPlugInProcFrame    *proc_frame,
 {
   GimpImage *image = cleanup->image;
 
+  if (cleanup->tree_batch_count > 0)
+    {
+      g_message ("Plug-in '%s' left image in a batch of layer changes, "
+                 "ending the batch.",
+                 gimp_procedure_get_label (proc_frame->procedure));
+
+      while (cleanup->tree_batch_count > 0 &&
+             gimp_image_is_tree_batch (image))
+        {
+          gimp_image_end_tree_batch (image);
+
+          cleanup->tree_batch_count--;
+        }
+    }
+
   if (gimp_image_get_undo_group_count (image) == 0)
     return;
 
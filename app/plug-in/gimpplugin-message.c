@@ -63,6 +63,15 @@ static void gimp_plug_in_handle_tile_put         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_tile_get         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
+static void gimp_plug_in_handle_tile_get_multi   (GimpPlugIn      *plug_in,
+                                                  GPTileReqMulti  *request);
+static void gimp_plug_in_handle_drawable_map     (GimpPlugIn      *plug_in,
+                                                  GPDrawableMap   *request);
+static GeglBuffer *
+            gimp_plug_in_get_tile_buffer         (GimpPlugIn      *plug_in,
+                                                  gint32           drawable_ID,
+                                                  gboolean         shadow,
+                                                  const Babl     **format);
 static void gimp_plug_in_handle_proc_run         (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
 static void gimp_plug_in_handle_proc_return      (GimpPlugIn      *plug_in,
@@ -75,6 +84,7 @@ static void gimp_plug_in_handle_proc_uninstall   (GimpPlugIn      *plug_in,
                                                   GPProcUninstall *proc_uninstall);
 static void gimp_plug_in_handle_extension_ack    (GimpPlugIn      *plug_in);
 static void gimp_plug_in_handle_has_init         (GimpPlugIn      *plug_in);
+static void gimp_plug_in_handle_persistent       (GimpPlugIn      *plug_in);
 
 
 /*  public functions  */
@@ -160,6 +170,18 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       gimp_plug_in_handle_has_init (plug_in);
       break;
+
+    case GP_TILE_REQ_MULTI:
+      gimp_plug_in_handle_tile_get_multi (plug_in, msg->data);
+      break;
+
+    case GP_DRAWABLE_MAP:
+      gimp_plug_in_handle_drawable_map (plug_in, msg->data);
+      break;
+
+    case GP_PERSISTENT:
+      gimp_plug_in_handle_persistent (plug_in);
+      break;
     }
 }
 
@@ -169,6 +191,9 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
 static void
 gimp_plug_in_handle_quit (GimpPlugIn *plug_in)
 {
+  /*  the plug-in is exiting, even if it asked to be kept  */
+  plug_in->persistent = FALSE;
+
   gimp_plug_in_close (plug_in, FALSE);
 }
 
@@ -221,6 +246,8 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
       return;
     }
 
+  plug_in->stats.n_messages++;
+
   if (msg.type != GP_TILE_DATA)
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -333,6 +360,10 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
                        GEGL_AUTO_ROWSTRIDE);
     }
 
+  plug_in->stats.n_tiles++;
+  plug_in->stats.bytes_copied += (babl_format_get_bytes_per_pixel (format) *
+                                  tile_rect.width * tile_rect.height);
+
   gimp_wire_destroy (&msg);
 
   if (! gp_tile_ack_write (plug_in->my_write, plug_in))
@@ -350,49 +381,18 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
 {
   GPTileData       tile_data;
   GimpWireMessage  msg;
-  GimpDrawable    *drawable;
   GeglBuffer      *buffer;
   const Babl      *format;
   GeglRectangle    tile_rect;
   gint             tile_size;
 
-  drawable = (GimpDrawable *) gimp_item_get_by_ID (plug_in->manager->gimp,
-                                                   request->drawable_ID);
+  buffer = gimp_plug_in_get_tile_buffer (plug_in,
+                                         request->drawable_ID,
+                                         request->shadow,
+                                         &format);
 
-  if (! GIMP_IS_DRAWABLE (drawable))
-    {
-      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
-                    "Plug-in \"%s\"\n(%s)\n\n"
-                    "tried reading from invalid drawable %d (killing)",
-                    gimp_object_get_name (plug_in),
-                    gimp_file_get_utf8_name (plug_in->file),
-                    request->drawable_ID);
-      gimp_plug_in_close (plug_in, TRUE);
-      return;
-    }
-  else if (gimp_item_is_removed (GIMP_ITEM (drawable)))
-    {
-      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
-                    "Plug-in \"%s\"\n(%s)\n\n"
-                    "tried reading from drawable %d which was removed "
-                    "from the image (killing)",
-                    gimp_object_get_name (plug_in),
-                    gimp_file_get_utf8_name (plug_in->file),
-                    request->drawable_ID);
-      gimp_plug_in_close (plug_in, TRUE);
-      return;
-    }
-
-  if (request->shadow)
-    {
-      buffer = gimp_drawable_get_shadow_buffer (drawable);
-
-      gimp_plug_in_cleanup_add_shadow (plug_in, drawable);
-    }
-  else
-    {
-      buffer = gimp_drawable_get_buffer (drawable);
-    }
+  if (! buffer)
+    return;
 
   if (! gimp_gegl_buffer_get_tile_rect (buffer,
                                         GIMP_PLUG_IN_TILE_WIDTH,
@@ -409,13 +409,6 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
       return;
     }
 
-  format = gegl_buffer_get_format (buffer);
-
-  if (! gimp_plug_in_precision_enabled (plug_in))
-    {
-      format = gimp_babl_compat_u8_format (format);
-    }
-
   tile_size = (babl_format_get_bytes_per_pixel (format) *
                tile_rect.width * tile_rect.height);
 
@@ -442,6 +435,9 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
                        GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
     }
 
+  plug_in->stats.n_tiles++;
+  plug_in->stats.bytes_copied += tile_size;
+
   if (! gp_tile_data_write (plug_in->my_write, &tile_data, plug_in))
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -458,6 +454,8 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
       return;
     }
 
+  plug_in->stats.n_messages++;
+
   if (msg.type != GP_TILE_ACK)
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -469,6 +467,283 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   gimp_wire_destroy (&msg);
 }
 
+static void
+gimp_plug_in_handle_tile_get_multi (GimpPlugIn     *plug_in,
+                                    GPTileReqMulti *request)
+{
+  GimpWireMessage  msg;
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  gboolean         use_shm;
+  gsize            offset = 0;
+  gint             i;
+
+  if (! request)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "requested too many tiles (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  buffer = gimp_plug_in_get_tile_buffer (plug_in,
+                                         request->drawable_ID,
+                                         request->shadow,
+                                         &format);
+
+  if (! buffer)
+    return;
+
+  use_shm = (plug_in->manager->shm != NULL);
+
+  /*  the tiles are sent one after the other, without waiting for an
+   *  ack for each of them.  in shared memory, they are placed back to
+   *  back, which always fits, see GP_TILE_SHM_N_TILES.
+   */
+  for (i = 0; i < request->n_tiles; i++)
+    {
+      GPTileData    tile_data;
+      GeglRectangle tile_rect;
+      gint          tile_size;
+
+      if (! gimp_gegl_buffer_get_tile_rect (buffer,
+                                            GIMP_PLUG_IN_TILE_WIDTH,
+                                            GIMP_PLUG_IN_TILE_HEIGHT,
+                                            request->tile_nums[i],
+                                            &tile_rect))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-in \"%s\"\n(%s)\n\n"
+                        "requested invalid tile (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_file_get_utf8_name (plug_in->file));
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+
+      tile_size = (babl_format_get_bytes_per_pixel (format) *
+                   tile_rect.width * tile_rect.height);
+
+      tile_data.drawable_ID = request->drawable_ID;
+      tile_data.tile_num    = request->tile_nums[i];
+      tile_data.shadow      = request->shadow;
+      tile_data.bpp         = babl_format_get_bytes_per_pixel (format);
+      tile_data.width       = tile_rect.width;
+      tile_data.height      = tile_rect.height;
+      tile_data.use_shm     = use_shm;
+      tile_data.data        = NULL;
+
+      if (use_shm)
+        {
+          gegl_buffer_get (buffer, &tile_rect, 1.0, format,
+                           gimp_plug_in_shm_get_addr (plug_in->manager->shm) +
+                           offset,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          offset += tile_size;
+        }
+      else
+        {
+          tile_data.data = g_malloc (tile_size);
+
+          gegl_buffer_get (buffer, &tile_rect, 1.0, format,
+                           tile_data.data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+        }
+
+      plug_in->stats.n_tiles++;
+      plug_in->stats.bytes_copied += tile_size;
+
+      if (! gp_tile_data_write (plug_in->my_write, &tile_data, plug_in))
+        {
+          g_free (tile_data.data);
+
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "%s: ERROR", G_STRFUNC);
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+
+      g_free (tile_data.data);
+    }
+
+  if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  plug_in->stats.n_messages++;
+
+  if (msg.type != GP_TILE_ACK)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "expected tile ack and received: %d", msg.type);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  gimp_wire_destroy (&msg);
+}
+
+static void
+gimp_plug_in_handle_drawable_map (GimpPlugIn    *plug_in,
+                                  GPDrawableMap *request)
+{
+  GPDrawableMap        drawable_map;
+  GimpWireMessage      msg;
+  GimpPlugInShm       *shm = NULL;
+  GeglBuffer          *buffer;
+  const GeglRectangle *extent;
+  const Babl          *format;
+  gboolean             success;
+
+  buffer = gimp_plug_in_get_tile_buffer (plug_in,
+                                         request->drawable_ID, FALSE,
+                                         &format);
+
+  if (! buffer)
+    return;
+
+  extent = gegl_buffer_get_extent (buffer);
+
+  drawable_map.drawable_ID = request->drawable_ID;
+  drawable_map.shm_ID      = -1;
+  drawable_map.bpp         = babl_format_get_bytes_per_pixel (format);
+  drawable_map.width       = extent->width;
+  drawable_map.height      = extent->height;
+
+  /*  the plug-in needs the ID of the tile segment to find the map's,
+   *  so drawables are only mapped along with it
+   */
+  if (plug_in->manager->shm)
+    {
+      shm = gimp_plug_in_shm_new_map ((gsize) drawable_map.bpp *
+                                      drawable_map.width       *
+                                      drawable_map.height);
+    }
+
+  if (shm)
+    {
+      gegl_buffer_get (buffer, extent, 1.0, format,
+                       gimp_plug_in_shm_get_addr (shm),
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      drawable_map.shm_ID = gimp_plug_in_shm_get_ID (shm);
+
+      plug_in->stats.bytes_copied += ((guint64) drawable_map.bpp *
+                                      drawable_map.width         *
+                                      drawable_map.height);
+    }
+
+  if (! gp_drawable_map_write (plug_in->my_write, &drawable_map, plug_in))
+    {
+      if (shm)
+        gimp_plug_in_shm_free (shm);
+
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (! shm)
+    return;
+
+  /*  once the plug-in has attached to the segment, it keeps it alive on
+   *  its own
+   */
+  success = gimp_wire_read_msg (plug_in->my_read, &msg, plug_in);
+
+  gimp_plug_in_shm_free (shm);
+
+  if (! success)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  plug_in->stats.n_messages++;
+
+  if (msg.type != GP_TILE_ACK)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "expected tile ack and received: %d", msg.type);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  gimp_wire_destroy (&msg);
+}
+
+/*  returns the buffer of the drawable a plug-in reads tiles from, and
+ *  the format they are sent in, or closes the plug-in and returns NULL
+ *  if it may not read from it
+ */
+static GeglBuffer *
+gimp_plug_in_get_tile_buffer (GimpPlugIn  *plug_in,
+                              gint32       drawable_ID,
+                              gboolean     shadow,
+                              const Babl **format)
+{
+  GimpDrawable *drawable;
+  GeglBuffer   *buffer;
+
+  drawable = (GimpDrawable *) gimp_item_get_by_ID (plug_in->manager->gimp,
+                                                   drawable_ID);
+
+  if (! GIMP_IS_DRAWABLE (drawable))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried reading from invalid drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+  else if (gimp_item_is_removed (GIMP_ITEM (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried reading from drawable %d which was removed "
+                    "from the image (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  if (shadow)
+    {
+      buffer = gimp_drawable_get_shadow_buffer (drawable);
+
+      gimp_plug_in_cleanup_add_shadow (plug_in, drawable);
+    }
+  else
+    {
+      buffer = gimp_drawable_get_buffer (drawable);
+    }
+
+  *format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      *format = gimp_babl_compat_u8_format (*format);
+    }
+
+  return buffer;
+}
+
 static void
 gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
                                 GimpPlugInProcFrame *proc_frame,
@@ -515,6 +790,7 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
   GimpValueArray      *args        = NULL;
   GimpValueArray      *return_vals = NULL;
   GError              *error       = NULL;
+  gboolean             pure;
 
   g_return_if_fail (proc_run != NULL);
   g_return_if_fail (proc_run->name != NULL);
@@ -599,6 +875,18 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
 
   gimp_value_array_unref (args);
 
+  pure = procedure && procedure->pure && ! error;
+
+  /*  anything but a pure procedure may have changed what pure
+   *  procedures return, the calling plug-in drops its cache by itself
+   */
+  if (! pure)
+    {
+      plug_in->pdb_cache = FALSE;
+
+      gimp_plug_in_manager_flush_pdb_caches (plug_in->manager);
+    }
+
   if (error)
     {
       gimp_plug_in_handle_proc_error (plug_in, proc_frame,
@@ -620,9 +908,13 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
        *  and canonical may be different too.
        */
       proc_return.name    = proc_run->name;
+      proc_return.call_ID = proc_run->call_ID;
       proc_return.nparams = gimp_value_array_length (return_vals);
       proc_return.params  = plug_in_args_to_params (return_vals, FALSE);
 
+      if (pure && gp_proc_pure_write (plug_in->my_write, plug_in))
+        plug_in->pdb_cache = TRUE;
+
       if (! gp_proc_return_write (plug_in->my_write, &proc_return, plug_in))
         {
           gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -962,3 +1254,22 @@ gimp_plug_in_handle_has_init (GimpPlugIn *plug_in)
       gimp_plug_in_close (plug_in, TRUE);
     }
 }
+
+static void
+gimp_plug_in_handle_persistent (GimpPlugIn *plug_in)
+{
+  if (plug_in->call_mode == GIMP_PLUG_IN_CALL_RUN)
+    {
+      plug_in->persistent = TRUE;
+    }
+  else
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent a PERSISTENT message while not in run().  "
+                    "This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+}
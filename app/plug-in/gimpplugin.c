@@ -96,6 +96,10 @@
 #include "gimp-intl.h"
 
 
+/*  the number of seconds an idle persistent plug-in is kept alive  */
+#define IDLE_TIMEOUT 30
+
+
 static void       gimp_plug_in_finalize      (GObject      *object);
 
 static gboolean   gimp_plug_in_write         (GIOChannel   *channel,
@@ -104,11 +108,22 @@ static gboolean   gimp_plug_in_write         (GIOChannel   *channel,
                                               gpointer      data);
 static gboolean   gimp_plug_in_flush         (GIOChannel   *channel,
                                               gpointer      data);
+static gboolean   gimp_plug_in_write_buffer  (GimpPlugIn   *plug_in,
+                                              GIOChannel   *channel);
 
 static gboolean   gimp_plug_in_recv_message  (GIOChannel   *channel,
                                               GIOCondition  cond,
                                               gpointer      data);
 
+static void       gimp_plug_in_add_input_watch
+                                             (GimpPlugIn   *plug_in);
+
+static void       gimp_plug_in_make_idle     (GimpPlugIn   *plug_in);
+static gboolean   gimp_plug_in_take_idle     (GimpPlugIn   *plug_in);
+static gboolean   gimp_plug_in_idle_timeout  (GimpPlugIn   *plug_in);
+
+static void       gimp_plug_in_add_run_stats (GimpPlugIn   *plug_in);
+
 
 
 G_DEFINE_TYPE (GimpPlugIn, gimp_plug_in, GIMP_TYPE_OBJECT)
@@ -140,6 +155,7 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->call_mode          = GIMP_PLUG_IN_CALL_NONE;
   plug_in->open               = FALSE;
   plug_in->hup                = FALSE;
+  plug_in->persistent         = FALSE;
   plug_in->pid                = 0;
 
   plug_in->my_read            = NULL;
@@ -148,6 +164,7 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->his_write          = NULL;
 
   plug_in->input_id           = 0;
+  plug_in->idle_id            = 0;
   plug_in->write_buffer_index = 0;
 
   plug_in->temp_procedures    = NULL;
@@ -157,6 +174,13 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->temp_proc_frames   = NULL;
 
   plug_in->plug_in_def        = NULL;
+
+  plug_in->handshake          = FALSE;
+  plug_in->run_time           = 0;
+  plug_in->message_time       = 0;
+
+  plug_in->return_func        = NULL;
+  plug_in->return_data        = NULL;
 }
 
 static void
@@ -233,6 +257,22 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
   g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), FALSE);
   g_return_val_if_fail (plug_in->call_mode == GIMP_PLUG_IN_CALL_NONE, FALSE);
 
+  /* Run the procedure in a persistent plug-in's idle process, if
+   * there is one.
+   */
+  if (call_mode == GIMP_PLUG_IN_CALL_RUN && gimp_plug_in_take_idle (plug_in))
+    {
+      if (! synchronous)
+        gimp_plug_in_add_input_watch (plug_in);
+
+      plug_in->open      = TRUE;
+      plug_in->call_mode = call_mode;
+
+      gimp_plug_in_manager_add_open_plug_in (plug_in->manager, plug_in);
+
+      return TRUE;
+    }
+
   /* Open two pipes. (Bidirectional communication).
    */
   if ((pipe (my_read) == -1) || (pipe (my_write) == -1))
@@ -274,7 +314,9 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
   g_io_channel_set_encoding (plug_in->his_read, NULL, NULL);
   g_io_channel_set_encoding (plug_in->his_write, NULL, NULL);
 
-  g_io_channel_set_buffered (plug_in->my_read, FALSE);
+  /*  my_read stays buffered, the wire reads messages in many small
+   *  pieces; writes are buffered by gimp_plug_in_write()
+   */
   g_io_channel_set_buffered (plug_in->my_write, FALSE);
   g_io_channel_set_buffered (plug_in->his_read, FALSE);
   g_io_channel_set_buffered (plug_in->his_write, FALSE);
@@ -375,21 +417,7 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
   g_clear_pointer (&plug_in->his_write, g_io_channel_unref);
 
   if (! synchronous)
-    {
-      GSource *source;
-
-      source = g_io_create_watch (plug_in->my_read,
-                                  G_IO_IN  | G_IO_PRI | G_IO_ERR | G_IO_HUP);
-
-      g_source_set_callback (source,
-                             (GSourceFunc) gimp_plug_in_recv_message, plug_in,
-                             NULL);
-
-      g_source_set_can_recurse (source, TRUE);
-
-      plug_in->input_id = g_source_attach (source, NULL);
-      g_source_unref (source);
-    }
+    gimp_plug_in_add_input_watch (plug_in);
 
   plug_in->open      = TRUE;
   plug_in->call_mode = call_mode;
@@ -420,6 +448,13 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
 
   plug_in->open = FALSE;
 
+  if (plug_in->run_time)
+    gimp_plug_in_add_run_stats (plug_in);
+
+  /*  Keep the process of a persistent plug-in for its next run.  */
+  if (! kill_it && plug_in->persistent)
+    gimp_plug_in_make_idle (plug_in);
+
   if (plug_in->pid)
     {
 #ifndef G_OS_WIN32
@@ -435,6 +470,13 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
           /*  give the plug-in some time (10 ms)  */
           g_usleep (10000);
         }
+      else if (plug_in->persistent && ! plug_in->hup)
+        {
+          /*  a persistent plug-in waits for its next run instead of
+           *  exiting on its own
+           */
+          gp_quit_write (plug_in->my_write, plug_in);
+        }
 
       /* If necessary, kill the filter. */
 
@@ -502,6 +544,14 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
       plug_in->input_id = 0;
     }
 
+  if (plug_in->idle_id)
+    {
+      g_source_remove (plug_in->idle_id);
+      plug_in->idle_id = 0;
+
+      gimp_plug_in_manager_remove_idle_plug_in (plug_in->manager, plug_in);
+    }
+
   /* Close the pipes. */
   g_clear_pointer (&plug_in->my_read,   g_io_channel_unref);
   g_clear_pointer (&plug_in->my_write,  g_io_channel_unref);
@@ -561,6 +611,19 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
   while (plug_in->temp_procedures)
     gimp_plug_in_remove_temp_proc (plug_in, plug_in->temp_procedures->data);
 
+  /* Hand the return values of an asynchronous run to its caller,
+   * NULL if the plug-in died before sending them.
+   */
+  if (plug_in->return_func)
+    {
+      GimpPlugInReturnFunc return_func = plug_in->return_func;
+
+      plug_in->return_func = NULL;
+
+      return_func (plug_in, plug_in->main_proc_frame.return_vals,
+                   plug_in->return_data);
+    }
+
   gimp_plug_in_manager_remove_open_plug_in (plug_in->manager, plug_in);
 }
 
@@ -588,19 +651,45 @@ gimp_plug_in_recv_message (GIOChannel   *channel,
   if (cond & (G_IO_IN | G_IO_PRI))
     {
       GimpWireMessage msg;
+      gboolean        outermost = (plug_in->message_time == 0);
 
       memset (&msg, 0, sizeof (GimpWireMessage));
 
+      /*  count the time from here until the message is handled as time
+       *  the plug-in waits for the core, unless this is a nested main
+       *  loop run while handling another message
+       */
+      if (outermost)
+        plug_in->message_time = g_get_monotonic_time ();
+
+      if (plug_in->handshake)
+        {
+          plug_in->stats.handshake_time = ((plug_in->message_time -
+                                            plug_in->run_time) /
+                                           (gdouble) G_TIME_SPAN_SECOND);
+          plug_in->handshake = FALSE;
+        }
+
       if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
         {
           gimp_plug_in_close (plug_in, TRUE);
         }
       else
         {
+          plug_in->stats.n_messages++;
+
           gimp_plug_in_handle_message (plug_in, &msg);
           gimp_wire_destroy (&msg);
           got_message = TRUE;
         }
+
+      if (outermost)
+        {
+          plug_in->stats.core_time += ((g_get_monotonic_time () -
+                                        plug_in->message_time) /
+                                       (gdouble) G_TIME_SPAN_SECOND);
+          plug_in->message_time = 0;
+        }
     }
 
   if (cond & (G_IO_ERR | G_IO_HUP))
@@ -649,7 +738,7 @@ gimp_plug_in_write (GIOChannel   *channel,
           memcpy (&plug_in->write_buffer[plug_in->write_buffer_index],
                   buf, bytes);
           plug_in->write_buffer_index += bytes;
-          if (! gimp_wire_flush (channel, plug_in))
+          if (! gimp_plug_in_write_buffer (plug_in, channel))
             return FALSE;
         }
       else
@@ -673,6 +762,19 @@ gimp_plug_in_flush (GIOChannel *channel,
 {
   GimpPlugIn *plug_in = data;
 
+  /*  every message is flushed once after it is written, the buffer
+   *  is only written out earlier when it is full
+   */
+  if (plug_in->write_buffer_index > 0)
+    plug_in->stats.n_messages++;
+
+  return gimp_plug_in_write_buffer (plug_in, channel);
+}
+
+static gboolean
+gimp_plug_in_write_buffer (GimpPlugIn *plug_in,
+                           GIOChannel *channel)
+{
   if (plug_in->write_buffer_index > 0)
     {
       GIOStatus  status;
@@ -721,6 +823,167 @@ gimp_plug_in_flush (GIOChannel *channel,
   return TRUE;
 }
 
+static void
+gimp_plug_in_add_input_watch (GimpPlugIn *plug_in)
+{
+  GSource *source;
+
+  source = g_io_create_watch (plug_in->my_read,
+                              G_IO_IN  | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+
+  g_source_set_callback (source,
+                         (GSourceFunc) gimp_plug_in_recv_message, plug_in,
+                         NULL);
+
+  g_source_set_can_recurse (source, TRUE);
+
+  plug_in->input_id = g_source_attach (source, NULL);
+  g_source_unref (source);
+}
+
+/*  hands the process of a persistent plug-in that returned from its
+ *  procedure over to a new, idle plug-in, which waits for the next run
+ *  of one of the plug-in's procedures
+ */
+static void
+gimp_plug_in_make_idle (GimpPlugIn *plug_in)
+{
+  GimpPlugInManager *manager   = plug_in->manager;
+  GimpProcedure     *procedure = plug_in->main_proc_frame.procedure;
+  GimpPlugIn        *idle;
+  GSList            *list;
+
+  if (plug_in->hup                                ||
+      ! plug_in->pid                              ||
+      plug_in->call_mode != GIMP_PLUG_IN_CALL_RUN ||
+      ! procedure                                 ||
+      procedure->proc_type != GIMP_PLUGIN)
+    {
+      return;
+    }
+
+  /*  keep one idle process per plug-in  */
+  for (list = manager->idle_plug_ins; list; list = g_slist_next (list))
+    {
+      GimpPlugIn *other = list->data;
+
+      if (g_file_equal (other->file, plug_in->file))
+        return;
+    }
+
+  idle = g_object_new (GIMP_TYPE_PLUG_IN, NULL);
+
+  gimp_object_set_name (GIMP_OBJECT (idle), gimp_object_get_name (plug_in));
+
+  idle->manager   = manager;
+  idle->file      = g_object_ref (plug_in->file);
+  idle->call_mode = GIMP_PLUG_IN_CALL_RUN;
+  idle->open      = TRUE;
+  idle->precision = plug_in->precision;
+  idle->pid       = plug_in->pid;
+  idle->my_read   = plug_in->my_read;
+  idle->my_write  = plug_in->my_write;
+
+  plug_in->pid        = 0;
+  plug_in->my_read    = NULL;
+  plug_in->my_write   = NULL;
+  plug_in->persistent = FALSE;
+
+  /*  notice if the idle plug-in quits or dies  */
+  gimp_plug_in_add_input_watch (idle);
+
+  idle->idle_id = g_timeout_add_seconds (IDLE_TIMEOUT,
+                                         (GSourceFunc) gimp_plug_in_idle_timeout,
+                                         idle);
+
+  gimp_plug_in_manager_add_open_plug_in (manager, idle);
+  gimp_plug_in_manager_add_idle_plug_in (manager, idle);
+
+  g_object_unref (idle);
+}
+
+/*  takes over the process of an idle plug-in for the same file  */
+static gboolean
+gimp_plug_in_take_idle (GimpPlugIn *plug_in)
+{
+  GimpProcedure *procedure = plug_in->main_proc_frame.procedure;
+  GSList        *list;
+
+  if (! procedure || procedure->proc_type != GIMP_PLUGIN)
+    return FALSE;
+
+  for (list = plug_in->manager->idle_plug_ins;
+       list;
+       list = g_slist_next (list))
+    {
+      GimpPlugIn *idle = list->data;
+
+      if (g_file_equal (idle->file, plug_in->file))
+        {
+          plug_in->precision = idle->precision;
+          plug_in->pid       = idle->pid;
+          plug_in->my_read   = idle->my_read;
+          plug_in->my_write  = idle->my_write;
+
+          idle->pid      = 0;
+          idle->my_read  = NULL;
+          idle->my_write = NULL;
+
+          gimp_plug_in_close (idle, FALSE);
+
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static gboolean
+gimp_plug_in_idle_timeout (GimpPlugIn *plug_in)
+{
+  plug_in->idle_id = 0;
+
+  gimp_plug_in_manager_remove_idle_plug_in (plug_in->manager, plug_in);
+
+  gimp_plug_in_close (plug_in, TRUE);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*  adds the statistics of the run that ends with closing the plug-in
+ *  to its procedure's
+ */
+static void
+gimp_plug_in_add_run_stats (GimpPlugIn *plug_in)
+{
+  GimpProcedure *procedure = plug_in->main_proc_frame.procedure;
+  gint64         now       = g_get_monotonic_time ();
+  gdouble        run_time;
+
+  /*  the run may end while its last message is being handled  */
+  if (plug_in->message_time)
+    {
+      plug_in->stats.core_time += ((now - plug_in->message_time) /
+                                   (gdouble) G_TIME_SPAN_SECOND);
+      plug_in->message_time = now;
+    }
+
+  run_time = (now - plug_in->run_time) / (gdouble) G_TIME_SPAN_SECOND;
+
+  plug_in->stats.n_runs++;
+  plug_in->stats.plug_in_time = MAX (run_time - plug_in->stats.core_time,
+                                     0.0);
+
+  if (procedure)
+    {
+      gimp_plug_in_manager_add_stats (plug_in->manager,
+                                      gimp_object_get_name (procedure),
+                                      &plug_in->stats);
+    }
+
+  plug_in->run_time = 0;
+}
+
 GimpPlugInProcFrame *
 gimp_plug_in_get_proc_frame (GimpPlugIn *plug_in)
 {
@@ -22,6 +22,7 @@
 
 
 #include "core/gimpobject.h"
+#include "gimppluginmanager-stats.h"
 #include "gimppluginprocframe.h"
 
 
@@ -48,6 +49,9 @@ struct _GimpPlugIn
   guint                open : 1;        /*  Is the plug-in open?              */
   guint                hup : 1;         /*  Did we receive a G_IO_HUP         */
   guint                precision : 1;   /*  True drawable precision enabled   */
+  guint                persistent : 1;  /*  Stays alive after returning       */
+  guint                pdb_cache : 1;   /*  May have cached PDB return values */
+  guint                handshake : 1;   /*  Waiting for the first message     */
   GPid                 pid;             /*  Plug-in's process id              */
 
   GIOChannel          *my_read;         /*  App's read and write channels     */
@@ -56,6 +60,7 @@ struct _GimpPlugIn
   GIOChannel          *his_write;
 
   guint                input_id;        /*  Id of input proc                  */
+  guint                idle_id;         /*  Id of the idle timeout            */
 
   gchar                write_buffer[WRITE_BUFFER_SIZE]; /* Buffer for writing */
   gint                 write_buffer_index;              /* Buffer index       */
@@ -69,6 +74,13 @@ struct _GimpPlugIn
   GList               *temp_proc_frames;
 
   GimpPlugInDef       *plug_in_def;     /*  Valid during query() and init()   */
+
+  GimpPlugInStats      stats;           /*  Statistics of the current run     */
+  gint64               run_time;        /*  When the procedure was run        */
+  gint64               message_time;    /*  When handling a message started   */
+
+  GimpPlugInReturnFunc return_func;     /*  Called when an asynchronous run   */
+  gpointer             return_data;     /*  ends                              */
 };
 
 struct _GimpPlugInClass
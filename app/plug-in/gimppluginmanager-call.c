@@ -35,6 +35,7 @@
 #include "config/gimpguiconfig.h"
 
 #include "core/gimp.h"
+#include "core/gimp-startup.h"
 #include "core/gimpprogress.h"
 
 #include "pdb/gimppdbcontext.h"
@@ -53,6 +54,11 @@
 #include "gimp-intl.h"
 
 
+static gboolean   gimp_plug_in_manager_query_recv  (GIOChannel   *channel,
+                                                    GIOCondition  cond,
+                                                    GimpPlugIn   *plug_in);
+
+
 static void
 gimp_allow_set_foreground_window (GimpPlugIn *plug_in)
 {
@@ -103,6 +109,129 @@ gimp_plug_in_manager_call_query (GimpPlugInManager *manager,
     }
 }
 
+void
+gimp_plug_in_manager_call_query_parallel (GimpPlugInManager  *manager,
+                                          GimpContext        *context,
+                                          GSList             *plug_in_defs,
+                                          gint                n_parallel,
+                                          GimpInitStatusFunc  status_callback)
+{
+  GMainContext *main_context;
+  GHashTable   *start_times;
+  GSList       *running    = NULL;
+  gint          n_plug_ins = g_slist_length (plug_in_defs);
+  gint          nth        = 0;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
+  g_return_if_fail (status_callback != NULL);
+
+  n_parallel = MAX (n_parallel, 1);
+
+  /*  open the plug-ins synchronously and watch them from a main
+   *  context of our own, so that nothing else is dispatched while
+   *  we wait for them
+   */
+  main_context = g_main_context_new ();
+
+  /*  the queries overlap, so each one is timed on its own  */
+  start_times = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  while (plug_in_defs || running)
+    {
+      GSList *list;
+      GSList *next;
+
+      while (plug_in_defs && g_slist_length (running) < n_parallel)
+        {
+          GimpPlugInDef *plug_in_def = plug_in_defs->data;
+          GimpPlugIn    *plug_in;
+          gchar         *basename;
+
+          plug_in_defs = g_slist_next (plug_in_defs);
+
+          basename =
+            g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
+          status_callback (NULL, basename,
+                           (gdouble) nth++ / (gdouble) n_plug_ins);
+          g_free (basename);
+
+          if (manager->gimp->be_verbose)
+            g_print ("Querying plug-in: '%s'\n",
+                     gimp_file_get_utf8_name (plug_in_def->file));
+
+          plug_in = gimp_plug_in_new (manager, context, NULL,
+                                      NULL, plug_in_def->file);
+
+          if (! plug_in)
+            continue;
+
+          plug_in->plug_in_def = plug_in_def;
+
+          if (gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_QUERY, TRUE))
+            {
+              GSource *source;
+              gint64  *start_time;
+
+              source = g_io_create_watch (plug_in->my_read,
+                                          G_IO_IN  | G_IO_PRI |
+                                          G_IO_ERR | G_IO_HUP);
+              g_source_set_callback (source,
+                                     (GSourceFunc) gimp_plug_in_manager_query_recv,
+                                     g_object_ref (plug_in),
+                                     (GDestroyNotify) g_object_unref);
+              g_source_attach (source, main_context);
+              g_source_unref (source);
+
+              start_time  = g_new (gint64, 1);
+              *start_time = g_get_monotonic_time ();
+
+              g_hash_table_insert (start_times, plug_in, start_time);
+
+              running = g_slist_prepend (running, plug_in);
+            }
+          else
+            {
+              g_object_unref (plug_in);
+            }
+        }
+
+      if (! running)
+        continue;
+
+      g_main_context_iteration (main_context, TRUE);
+
+      for (list = running; list; list = next)
+        {
+          GimpPlugIn *plug_in = list->data;
+
+          next = g_slist_next (list);
+
+          if (! plug_in->open)
+            {
+              const gint64 *start_time;
+              gchar        *basename;
+
+              start_time = g_hash_table_lookup (start_times, plug_in);
+              basename   = g_path_get_basename (
+                gimp_file_get_utf8_name (plug_in->plug_in_def->file));
+
+              gimp_startup_record (basename,
+                                   *start_time, g_get_monotonic_time ());
+
+              g_free (basename);
+              g_hash_table_remove (start_times, plug_in);
+
+              running = g_slist_delete_link (running, list);
+              g_object_unref (plug_in);
+            }
+        }
+    }
+
+  g_hash_table_unref (start_times);
+  g_main_context_unref (main_context);
+}
+
 void
 gimp_plug_in_manager_call_init (GimpPlugInManager *manager,
                                 GimpContext       *context,
@@ -175,6 +304,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       gint               display_ID;
       GObject           *screen;
       gint               monitor;
+      gint64             spawn_time;
+
+      spawn_time = g_get_monotonic_time ();
 
       if (! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
         {
@@ -193,6 +325,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
           return return_vals;
         }
 
+      plug_in->stats.spawn_time = ((g_get_monotonic_time () - spawn_time) /
+                                   (gdouble) G_TIME_SPAN_SECOND);
+
       display_ID = display ? gimp_get_display_ID (manager->gimp, display) : -1;
 
       config.version          = GIMP_PROTOCOL_VERSION;
@@ -220,8 +355,14 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
                                                        &screen, &monitor);
       config.monitor_number   = monitor;
       config.timestamp        = gimp_get_user_time (manager->gimp);
+      config.tile_cache_size  = MIN (gegl_config->tile_cache_size / 1024,
+                                     G_MAXUINT32);
+      config.num_threads      = (gegl_config->plug_in_threads > 0 ?
+                                 gegl_config->plug_in_threads :
+                                 gegl_config->num_processors);
 
       proc_run.name    = GIMP_PROCEDURE (procedure)->original_name;
+      proc_run.call_ID = 0;
       proc_run.nparams = gimp_value_array_length (args);
       proc_run.params  = plug_in_args_to_params (args, FALSE);
 
@@ -250,6 +391,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       g_free (config.display_name);
       g_free (proc_run.params);
 
+      plug_in->run_time  = g_get_monotonic_time ();
+      plug_in->handshake = TRUE;
+
       /* If this is an extension,
        * wait for an installation-confirmation message
        */
@@ -292,6 +436,71 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
   return return_vals;
 }
 
+static void
+gimp_plug_in_manager_call_run_async_opened (GimpPlugInManager  *manager,
+                                            GimpPlugIn         *plug_in,
+                                            GimpPlugIn        **started)
+{
+  if (! *started)
+    *started = plug_in;
+}
+
+/*  Runs the plug-in asynchronously, and calls return_func once, with
+ *  the return values, when the plug-in ends.  If the plug-in fails to
+ *  start, return_func is called before this returns NULL.  Otherwise,
+ *  the running plug-in is returned; closing it ends the run with
+ *  NULL return values.
+ */
+GimpPlugIn *
+gimp_plug_in_manager_call_run_async (GimpPlugInManager    *manager,
+                                     GimpContext          *context,
+                                     GimpProgress         *progress,
+                                     GimpPlugInProcedure  *procedure,
+                                     GimpValueArray       *args,
+                                     GimpPlugInReturnFunc  return_func,
+                                     gpointer              return_data)
+{
+  GimpValueArray *return_vals;
+  GimpPlugIn     *plug_in = NULL;
+  gulong          opened_id;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), NULL);
+  g_return_val_if_fail (GIMP_IS_PDB_CONTEXT (context), NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (procedure), NULL);
+  g_return_val_if_fail (args != NULL, NULL);
+  g_return_val_if_fail (return_func != NULL, NULL);
+
+  /*  the first plug-in opened while starting the run is ours  */
+  opened_id =
+    g_signal_connect (manager, "plug-in-opened",
+                      G_CALLBACK (gimp_plug_in_manager_call_run_async_opened),
+                      &plug_in);
+
+  return_vals = gimp_plug_in_manager_call_run (manager, context, progress,
+                                               procedure, args, FALSE, NULL);
+
+  g_signal_handler_disconnect (manager, opened_id);
+
+  if (return_vals || ! plug_in || ! plug_in->open)
+    {
+      if (! return_vals)
+        return_vals = gimp_procedure_get_return_values (GIMP_PROCEDURE (procedure),
+                                                        FALSE, NULL);
+
+      return_func (NULL, return_vals, return_data);
+
+      gimp_value_array_unref (return_vals);
+
+      return NULL;
+    }
+
+  plug_in->return_func = return_func;
+  plug_in->return_data = return_data;
+
+  return plug_in;
+}
+
 GimpValueArray *
 gimp_plug_in_manager_call_run_temp (GimpPlugInManager      *manager,
                                     GimpContext            *context,
@@ -319,6 +528,7 @@ gimp_plug_in_manager_call_run_temp (GimpPlugInManager      *manager,
                                                  procedure);
 
       proc_run.name    = GIMP_PROCEDURE (procedure)->original_name;
+      proc_run.call_ID = 0;
       proc_run.nparams = gimp_value_array_length (args);
       proc_run.params  = plug_in_args_to_params (args, FALSE);
 
@@ -361,3 +571,45 @@ gimp_plug_in_manager_call_run_temp (GimpPlugInManager      *manager,
 
   return return_vals;
 }
+
+
+/*  private functions  */
+
+static gboolean
+gimp_plug_in_manager_query_recv (GIOChannel   *channel,
+                                 GIOCondition  cond,
+                                 GimpPlugIn   *plug_in)
+{
+#ifdef G_OS_WIN32
+  /* Workaround for GLib bug #137968, see gimp_plug_in_recv_message() */
+  if (cond == 0)
+    return G_SOURCE_CONTINUE;
+#endif
+
+  if (! plug_in->open)
+    return G_SOURCE_REMOVE;
+
+  if (cond & (G_IO_IN | G_IO_PRI))
+    {
+      GimpWireMessage msg;
+
+      if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+        {
+          gimp_plug_in_close (plug_in, TRUE);
+        }
+      else
+        {
+          gimp_plug_in_handle_message (plug_in, &msg);
+          gimp_wire_destroy (&msg);
+        }
+    }
+  else
+    {
+      if (cond & G_IO_HUP)
+        plug_in->hup = TRUE;
+
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+
+  return plug_in->open ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
@@ -32,6 +32,7 @@
 #include "config/gimpcoreconfig.h"
 
 #include "core/gimp.h"
+#include "core/gimp-startup.h"
 #include "core/gimp-utils.h"
 
 #include "pdb/gimppdb.h"
@@ -104,18 +105,26 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
   context = gimp_pdb_context_new (gimp, context, TRUE);
 
   /* search for binaries in the plug-in directory path */
+  gimp_startup_begin ("search");
   gimp_plug_in_manager_search (manager, status_callback);
+  gimp_startup_end ();
 
   /* read the pluginrc file for cached data */
   pluginrc = gimp_plug_in_manager_get_pluginrc (manager);
 
+  gimp_startup_begin ("pluginrc");
   gimp_plug_in_manager_read_pluginrc (manager, pluginrc, status_callback);
+  gimp_startup_end ();
 
   /* query any plug-ins that changed since we last wrote out pluginrc */
+  gimp_startup_begin ("query");
   gimp_plug_in_manager_query_new (manager, context, status_callback);
+  gimp_startup_end ();
 
   /* initialize the plug-ins */
+  gimp_startup_begin ("init");
   gimp_plug_in_manager_init_plug_ins (manager, context, status_callback);
+  gimp_startup_end ();
 
   /* add the procedures to manager->plug_in_procedures */
   for (list = manager->plug_in_defs; list; list = list->next)
@@ -188,7 +197,9 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
   /* sort the load, save and export procedures, make the raw handler list */
   gimp_plug_in_manager_sort_file_procs (manager);
 
+  gimp_startup_begin ("extensions");
   gimp_plug_in_manager_run_extensions (manager, context, status_callback);
+  gimp_startup_end ();
 
   g_object_unref (context);
 }
@@ -425,46 +436,35 @@ gimp_plug_in_manager_query_new (GimpPlugInManager  *manager,
                                 GimpContext        *context,
                                 GimpInitStatusFunc  status_callback)
 {
+  GSList *query_defs = NULL;
   GSList *list;
-  gint    n_plugins;
 
   status_callback (_("Querying new Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->needs_query)
-        n_plugins++;
+        query_defs = g_slist_prepend (query_defs, plug_in_def);
     }
 
-  if (n_plugins)
+  if (query_defs)
     {
-      gint nth;
+      GimpGeglConfig *config = GIMP_GEGL_CONFIG (manager->gimp->config);
 
       manager->write_pluginrc = TRUE;
 
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
+      query_defs = g_slist_reverse (query_defs);
 
-          if (plug_in_def->needs_query)
-            {
-              gchar *basename;
+      /*  the plug-ins don't depend on each other, query as many of
+       *  them at a time as we use threads
+       */
+      gimp_plug_in_manager_call_query_parallel (manager, context, query_defs,
+                                                config->num_processors,
+                                                status_callback);
 
-              basename =
-                g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
-
-              if (manager->gimp->be_verbose)
-                g_print ("Querying plug-in: '%s'\n",
-                         gimp_file_get_utf8_name (plug_in_def->file));
-
-              gimp_plug_in_manager_call_query (manager, context, plug_in_def);
-            }
-        }
+      g_slist_free (query_defs);
     }
 
   status_callback (NULL, "", 1.0);
@@ -505,13 +505,16 @@ gimp_plug_in_manager_init_plug_ins (GimpPlugInManager  *manager,
                 g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
               status_callback (NULL, basename,
                                (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
 
               if (manager->gimp->be_verbose)
                 g_print ("Initializing plug-in: '%s'\n",
                          gimp_file_get_utf8_name (plug_in_def->file));
 
+              gimp_startup_begin ("%s", basename);
               gimp_plug_in_manager_call_init (manager, context, plug_in_def);
+              gimp_startup_end ();
+
+              g_free (basename);
             }
         }
     }
@@ -0,0 +1,156 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-stats.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include "plug-in-types.h"
+
+#include "gimppluginmanager.h"
+#include "gimppluginmanager-stats.h"
+
+
+/*  the statistics of all runs of a procedure are summed up, keyed by
+ *  the procedure's name.  the dashboard reads them from its sampling
+ *  thread, so the table is protected by a mutex.
+ */
+
+static void   gimp_plug_in_stats_add (GimpPlugInStats       *dest,
+                                      const GimpPlugInStats *src);
+
+
+/*  public functions  */
+
+void
+gimp_plug_in_manager_stats_init (GimpPlugInManager *manager)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+
+  g_mutex_init (&manager->stats_mutex);
+
+  manager->stats = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, g_free);
+}
+
+void
+gimp_plug_in_manager_stats_exit (GimpPlugInManager *manager)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+
+  g_clear_pointer (&manager->stats, g_hash_table_unref);
+
+  g_mutex_clear (&manager->stats_mutex);
+}
+
+void
+gimp_plug_in_manager_add_stats (GimpPlugInManager     *manager,
+                                const gchar           *procedure_name,
+                                const GimpPlugInStats *stats)
+{
+  GimpPlugInStats *proc_stats;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (procedure_name != NULL);
+  g_return_if_fail (stats != NULL);
+
+  g_mutex_lock (&manager->stats_mutex);
+
+  proc_stats = g_hash_table_lookup (manager->stats, procedure_name);
+
+  if (! proc_stats)
+    {
+      proc_stats = g_new0 (GimpPlugInStats, 1);
+
+      g_hash_table_insert (manager->stats,
+                           g_strdup (procedure_name), proc_stats);
+    }
+
+  gimp_plug_in_stats_add (proc_stats, stats);
+
+  g_mutex_unlock (&manager->stats_mutex);
+}
+
+/*  returns the statistics of the procedure called @procedure_name, or
+ *  the sum over all procedures if it is NULL.  returns FALSE if the
+ *  procedure was never run.
+ */
+gboolean
+gimp_plug_in_manager_get_stats (GimpPlugInManager *manager,
+                                const gchar       *procedure_name,
+                                GimpPlugInStats   *stats)
+{
+  gboolean found = FALSE;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), FALSE);
+  g_return_val_if_fail (stats != NULL, FALSE);
+
+  memset (stats, 0, sizeof (GimpPlugInStats));
+
+  g_mutex_lock (&manager->stats_mutex);
+
+  if (procedure_name)
+    {
+      GimpPlugInStats *proc_stats;
+
+      proc_stats = g_hash_table_lookup (manager->stats, procedure_name);
+
+      if (proc_stats)
+        {
+          *stats = *proc_stats;
+          found  = TRUE;
+        }
+    }
+  else
+    {
+      GHashTableIter  iter;
+      gpointer        proc_stats;
+
+      g_hash_table_iter_init (&iter, manager->stats);
+
+      while (g_hash_table_iter_next (&iter, NULL, &proc_stats))
+        {
+          gimp_plug_in_stats_add (stats, proc_stats);
+          found = TRUE;
+        }
+    }
+
+  g_mutex_unlock (&manager->stats_mutex);
+
+  return found;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_plug_in_stats_add (GimpPlugInStats       *dest,
+                        const GimpPlugInStats *src)
+{
+  dest->n_runs         += src->n_runs;
+  dest->spawn_time     += src->spawn_time;
+  dest->handshake_time += src->handshake_time;
+  dest->core_time      += src->core_time;
+  dest->plug_in_time   += src->plug_in_time;
+  dest->n_messages     += src->n_messages;
+  dest->n_tiles        += src->n_tiles;
+  dest->bytes_copied   += src->bytes_copied;
+}
@@ -0,0 +1,48 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-stats.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PLUG_IN_MANAGER_STATS_H__
+#define __GIMP_PLUG_IN_MANAGER_STATS_H__
+
+
+struct _GimpPlugInStats
+{
+  guint64 n_runs;
+  gdouble spawn_time;      /*  starting the plug-in's process, in seconds  */
+  gdouble handshake_time;  /*  until the plug-in's first message           */
+  gdouble core_time;       /*  the plug-in waiting for the core            */
+  gdouble plug_in_time;    /*  the core waiting for the plug-in            */
+  guint64 n_messages;      /*  wire messages, in both directions           */
+  guint64 n_tiles;         /*  tiles sent and received                     */
+  guint64 bytes_copied;    /*  pixel data copied to and from the plug-in   */
+};
+
+
+void       gimp_plug_in_manager_stats_init  (GimpPlugInManager     *manager);
+void       gimp_plug_in_manager_stats_exit  (GimpPlugInManager     *manager);
+
+void       gimp_plug_in_manager_add_stats   (GimpPlugInManager     *manager,
+                                             const gchar           *procedure_name,
+                                             const GimpPlugInStats *stats);
+gboolean   gimp_plug_in_manager_get_stats   (GimpPlugInManager     *manager,
+                                             const gchar           *procedure_name,
+                                             GimpPlugInStats       *stats);
+
+
+#endif  /*  __GIMP_PLUG_IN_MANAGER_STATS_H__  */
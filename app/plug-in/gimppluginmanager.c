@@ -25,6 +25,7 @@
 #include <gegl.h>
 
 #include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
 #include "libgimpconfig/gimpconfig.h"
 
 #include "plug-in-types.h"
@@ -34,6 +35,8 @@
 #include "core/gimp.h"
 #include "core/gimp-filter-history.h"
 #include "core/gimp-memsize.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpimage.h"
 #include "core/gimpmarshal.h"
 
 #include "pdb/gimppdb.h"
@@ -48,6 +51,7 @@
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
 #include "gimppluginmanager-menu-branch.h"
+#include "gimppluginmanager-stats.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
@@ -68,6 +72,13 @@ static void     gimp_plug_in_manager_finalize    (GObject    *object);
 static gint64   gimp_plug_in_manager_get_memsize (GimpObject *object,
                                                   gint64     *gui_size);
 
+static void     gimp_plug_in_manager_image_dirty  (GimpImage         *image,
+                                                   GimpDirtyMask      dirty_mask,
+                                                   GimpPlugInManager *manager);
+static void     gimp_plug_in_manager_image_remove (GimpContainer     *images,
+                                                   GimpImage         *image,
+                                                   GimpPlugInManager *manager);
+
 
 G_DEFINE_TYPE (GimpPlugInManager, gimp_plug_in_manager, GIMP_TYPE_OBJECT)
 
@@ -125,6 +136,7 @@ gimp_plug_in_manager_class_init (GimpPlugInManagerClass *klass)
 static void
 gimp_plug_in_manager_init (GimpPlugInManager *manager)
 {
+  gimp_plug_in_manager_stats_init (manager);
 }
 
 static void
@@ -160,6 +172,7 @@ gimp_plug_in_manager_finalize (GObject *object)
   gimp_plug_in_manager_locale_domain_exit (manager);
   gimp_plug_in_manager_help_domain_exit (manager);
   gimp_plug_in_manager_data_free (manager);
+  gimp_plug_in_manager_stats_exit (manager);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -189,6 +202,7 @@ gimp_plug_in_manager_get_memsize (GimpObject *object,
                                                (GimpMemsizeFunc)
                                                gimp_object_get_memsize,
                                                gui_size);
+  memsize += gimp_g_slist_get_memsize (manager->idle_plug_ins, 0);
   memsize += gimp_g_slist_get_memsize (manager->plug_in_stack, 0);
 
   memsize += 0; /* FIXME manager->shm */
@@ -247,6 +261,22 @@ gimp_plug_in_manager_initialize (GimpPlugInManager  *manager,
     manager->shm = gimp_plug_in_shm_new ();
 
   manager->debug = gimp_plug_in_debug_new ();
+
+  /*  plug-ins may cache the return values of pure procedures, which
+   *  change with the images
+   */
+  manager->image_dirty_handler =
+    gimp_container_add_handler (manager->gimp->images, "dirty",
+                                G_CALLBACK (gimp_plug_in_manager_image_dirty),
+                                manager);
+  manager->image_clean_handler =
+    gimp_container_add_handler (manager->gimp->images, "clean",
+                                G_CALLBACK (gimp_plug_in_manager_image_dirty),
+                                manager);
+
+  g_signal_connect (manager->gimp->images, "remove",
+                    G_CALLBACK (gimp_plug_in_manager_image_remove),
+                    manager);
 }
 
 void
@@ -254,6 +284,21 @@ gimp_plug_in_manager_exit (GimpPlugInManager *manager)
 {
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
 
+  if (manager->image_dirty_handler)
+    {
+      gimp_container_remove_handler (manager->gimp->images,
+                                     manager->image_dirty_handler);
+      gimp_container_remove_handler (manager->gimp->images,
+                                     manager->image_clean_handler);
+
+      manager->image_dirty_handler = 0;
+      manager->image_clean_handler = 0;
+
+      g_signal_handlers_disconnect_by_func (manager->gimp->images,
+                                            gimp_plug_in_manager_image_remove,
+                                            manager);
+    }
+
   while (manager->open_plug_ins)
     gimp_plug_in_close (manager->open_plug_ins->data, TRUE);
 
@@ -382,6 +427,29 @@ gimp_plug_in_manager_remove_open_plug_in (GimpPlugInManager *manager,
   g_object_unref (plug_in);
 }
 
+/*  idle plug-ins are persistent plug-ins waiting for their next run.
+ *  they are open plug-ins too, which keep them alive.
+ */
+void
+gimp_plug_in_manager_add_idle_plug_in (GimpPlugInManager *manager,
+                                       GimpPlugIn        *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  manager->idle_plug_ins = g_slist_prepend (manager->idle_plug_ins, plug_in);
+}
+
+void
+gimp_plug_in_manager_remove_idle_plug_in (GimpPlugInManager *manager,
+                                          GimpPlugIn        *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  manager->idle_plug_ins = g_slist_remove (manager->idle_plug_ins, plug_in);
+}
+
 void
 gimp_plug_in_manager_plug_in_push (GimpPlugInManager *manager,
                                    GimpPlugIn        *plug_in)
@@ -409,3 +477,45 @@ gimp_plug_in_manager_plug_in_pop (GimpPlugInManager *manager)
   else
     manager->current_plug_in = NULL;
 }
+
+void
+gimp_plug_in_manager_flush_pdb_caches (GimpPlugInManager *manager)
+{
+  GSList *list;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+
+  /*  a plug-in is only told once, until it caches return values again,
+   *  so that plug-ins which don't read their pipe don't get flooded
+   */
+  for (list = manager->open_plug_ins; list; list = g_slist_next (list))
+    {
+      GimpPlugIn *plug_in = list->data;
+
+      if (plug_in->pdb_cache && plug_in->open && ! plug_in->hup)
+        {
+          plug_in->pdb_cache = FALSE;
+
+          gp_proc_cache_flush_write (plug_in->my_write, plug_in);
+        }
+    }
+}
+
+
+/*  private functions  */
+
+static void
+gimp_plug_in_manager_image_dirty (GimpImage         *image,
+                                  GimpDirtyMask      dirty_mask,
+                                  GimpPlugInManager *manager)
+{
+  gimp_plug_in_manager_flush_pdb_caches (manager);
+}
+
+static void
+gimp_plug_in_manager_image_remove (GimpContainer     *images,
+                                   GimpImage         *image,
+                                   GimpPlugInManager *manager)
+{
+  gimp_plug_in_manager_flush_pdb_caches (manager);
+}
@@ -55,13 +55,20 @@ struct _GimpPlugInManager
 
   GimpPlugIn        *current_plug_in;
   GSList            *open_plug_ins;
+  GSList            *idle_plug_ins;
   GSList            *plug_in_stack;
 
+  GQuark             image_dirty_handler;
+  GQuark             image_clean_handler;
+
   GimpPlugInShm     *shm;
   GimpInterpreterDB *interpreter_db;
   GimpEnvironTable  *environ_table;
   GimpPlugInDebug   *debug;
   GList             *data_list;
+
+  GHashTable        *stats;
+  GMutex             stats_mutex;
 };
 
 struct _GimpPlugInManagerClass
@@ -105,9 +112,16 @@ void    gimp_plug_in_manager_add_open_plug_in     (GimpPlugInManager   *manager,
 void    gimp_plug_in_manager_remove_open_plug_in  (GimpPlugInManager   *manager,
                                                    GimpPlugIn          *plug_in);
 
+void    gimp_plug_in_manager_add_idle_plug_in     (GimpPlugInManager   *manager,
+                                                   GimpPlugIn          *plug_in);
+void    gimp_plug_in_manager_remove_idle_plug_in  (GimpPlugInManager   *manager,
+                                                   GimpPlugIn          *plug_in);
+
 void    gimp_plug_in_manager_plug_in_push         (GimpPlugInManager   *manager,
                                                    GimpPlugIn          *plug_in);
 void    gimp_plug_in_manager_plug_in_pop          (GimpPlugInManager   *manager);
 
+void    gimp_plug_in_manager_flush_pdb_caches     (GimpPlugInManager   *manager);
+
 
 #endif  /* __GIMP_PLUG_IN_MANAGER_H__ */
@@ -62,6 +62,9 @@
 
 #endif /* G_OS_WIN32 || G_WITH_CYGWIN */
 
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+
 #include "plug-in-types.h"
 
 #include "core/gimp-utils.h"
@@ -71,15 +74,20 @@
 #include "gimp-log.h"
 
 
-#define TILE_MAP_SIZE (GIMP_PLUG_IN_TILE_WIDTH * GIMP_PLUG_IN_TILE_HEIGHT * 32)
+/*  room for GP_TILE_SHM_N_TILES tiles of the largest pixel size  */
+#define TILE_MAP_SIZE (GIMP_PLUG_IN_TILE_WIDTH * GIMP_PLUG_IN_TILE_HEIGHT * 32 * \
+                       GP_TILE_SHM_N_TILES)
 
 #define ERRMSG_SHM_DISABLE "Disabling shared memory tile transport"
+#define ERRMSG_SHM_MAP     "Not mapping the drawable into shared memory"
 
 
 struct _GimpPlugInShm
 {
   gint    shm_ID;
   guchar *shm_addr;
+  gsize   size;
+  gint    serial;
 
 #if defined(USE_WIN32_SHM)
   HANDLE  shm_handle;
@@ -87,6 +95,17 @@ struct _GimpPlugInShm
 };
 
 
+static GimpPlugInShm * gimp_plug_in_shm_create   (gsize          size,
+                                                  gint           serial);
+
+#if defined(USE_WIN32_SHM) || defined(USE_POSIX_SHM)
+static void            gimp_plug_in_shm_get_name (gint           pid,
+                                                  gint           serial,
+                                                  gchar         *name,
+                                                  gsize          name_size);
+#endif
+
+
 GimpPlugInShm *
 gimp_plug_in_shm_new (void)
 {
@@ -95,15 +114,103 @@ gimp_plug_in_shm_new (void)
    *  we'll fall back on sending the data over the pipe.
    */
 
-  GimpPlugInShm *shm = g_slice_new0 (GimpPlugInShm);
+  return gimp_plug_in_shm_create (TILE_MAP_SIZE, -1);
+}
+
+/*  allocates a piece of shared memory of its own for one
+ *  GP_DRAWABLE_MAP request.  with SysV shared memory, its ID is the
+ *  segment's; otherwise, it is a serial number which, together with the ID
+ *  of the tile segment, names the segment.  returns NULL if the segment
+ *  can't be allocated.
+ */
+GimpPlugInShm *
+gimp_plug_in_shm_new_map (gsize size)
+{
+  static gint serial = 0;
+
+  g_return_val_if_fail (size > 0, NULL);
+
+  return gimp_plug_in_shm_create (size, serial++);
+}
+
+void
+gimp_plug_in_shm_free (GimpPlugInShm *shm)
+{
+  g_return_if_fail (shm != NULL);
+
+  if (shm->shm_ID != -1)
+    {
+
+#if defined (USE_SYSV_SHM)
+
+      shmdt (shm->shm_addr);
+
+#ifndef IPC_RMID_DEFERRED_RELEASE
+      shmctl (shm->shm_ID, IPC_RMID, NULL);
+#endif
+
+#elif defined(USE_WIN32_SHM)
+
+      if (shm->serial != -1)
+        UnmapViewOfFile (shm->shm_addr);
+
+      if (shm->shm_handle)
+        CloseHandle (shm->shm_handle);
+
+#elif defined(USE_POSIX_SHM)
+
+      gchar shm_handle[32];
+
+      munmap (shm->shm_addr, shm->size);
+
+      gimp_plug_in_shm_get_name (gimp_get_pid (), shm->serial,
+                                 shm_handle, sizeof (shm_handle));
+
+      shm_unlink (shm_handle);
+
+#endif
+
+      GIMP_LOG (SHM, "detached shared memory segment ID = %d", shm->shm_ID);
+    }
+
+  g_slice_free (GimpPlugInShm, shm);
+}
+
+gint
+gimp_plug_in_shm_get_ID (GimpPlugInShm *shm)
+{
+  g_return_val_if_fail (shm != NULL, -1);
+
+  return shm->shm_ID;
+}
+
+guchar *
+gimp_plug_in_shm_get_addr (GimpPlugInShm *shm)
+{
+  g_return_val_if_fail (shm != NULL, NULL);
+
+  return shm->shm_addr;
+}
+
+
+/*  private functions  */
+
+static GimpPlugInShm *
+gimp_plug_in_shm_create (gsize size,
+                         gint  serial)
+{
+  GimpPlugInShm *shm    = g_slice_new0 (GimpPlugInShm);
+  const gchar   *errmsg = serial == -1 ? ERRMSG_SHM_DISABLE : ERRMSG_SHM_MAP;
 
   shm->shm_ID = -1;
+  shm->size   = size;
+  shm->serial = serial;
 
 #if defined(USE_SYSV_SHM)
 
   /* Use SysV shared memory mechanisms for transferring tile data. */
   {
-    shm->shm_ID = shmget (IPC_PRIVATE, TILE_MAP_SIZE, IPC_CREAT | 0600);
+    shm->shm_ID = shmget (IPC_PRIVATE, size, IPC_CREAT | 0600);
 
     if (shm->shm_ID != -1)
       {
@@ -111,8 +218,8 @@ gimp_plug_in_shm_new (void)
 
         if (shm->shm_addr == (guchar *) -1)
           {
-            g_printerr ("shmat() failed: %s\n" ERRMSG_SHM_DISABLE,
-                        g_strerror (errno));
+            g_printerr ("shmat() failed: %s\n%s\n",
+                        g_strerror (errno), errmsg);
             shmctl (shm->shm_ID, IPC_RMID, NULL);
             shm->shm_ID = -1;
           }
@@ -124,8 +231,8 @@ gimp_plug_in_shm_new (void)
       }
     else
       {
-        g_printerr ("shmget() failed: %s\n" ERRMSG_SHM_DISABLE,
-                    g_strerror (errno));
+        g_printerr ("shmget() failed: %s\n%s\n",
+                    g_strerror (errno), errmsg);
       }
   }
 
@@ -140,12 +247,13 @@ gimp_plug_in_shm_new (void)
     pid = GetCurrentProcessId ();
 
     /* From the id, derive the file map name */
-    g_snprintf (fileMapName, sizeof (fileMapName), "GIMP%d.SHM", pid);
+    gimp_plug_in_shm_get_name (pid, serial, fileMapName, sizeof (fileMapName));
 
     /* Create the file mapping into paging space */
     shm->shm_handle = CreateFileMapping (INVALID_HANDLE_VALUE, NULL,
-                                         PAGE_READWRITE, 0,
-                                         TILE_MAP_SIZE,
+                                         PAGE_READWRITE,
+                                         (DWORD) ((guint64) size >> 32),
+                                         (DWORD) (size & 0xffffffff),
                                          fileMapName);
 
     if (shm->shm_handle)
@@ -153,23 +261,25 @@ gimp_plug_in_shm_new (void)
         /* Map the shared memory into our address space for use */
         shm->shm_addr = (guchar *) MapViewOfFile (shm->shm_handle,
                                                   FILE_MAP_ALL_ACCESS,
-                                                  0, 0, TILE_MAP_SIZE);
+                                                  0, 0, size);
 
         /* Verify that we mapped our view */
         if (shm->shm_addr)
           {
-            shm->shm_ID = pid;
+            shm->shm_ID = serial == -1 ? pid : serial;
           }
         else
           {
-            g_printerr ("MapViewOfFile error: %d... " ERRMSG_SHM_DISABLE,
-                        GetLastError ());
+            g_printerr ("MapViewOfFile error: %d... %s\n",
+                        GetLastError (), errmsg);
+
+            CloseHandle (shm->shm_handle);
           }
       }
     else
       {
-        g_printerr ("CreateFileMapping error: %d... " ERRMSG_SHM_DISABLE,
-                    GetLastError ());
+        g_printerr ("CreateFileMapping error: %d... %s\n",
+                    GetLastError (), errmsg);
       }
   }
 
@@ -185,37 +295,37 @@ gimp_plug_in_shm_new (void)
     pid = gimp_get_pid ();
 
     /* From the id, derive the file map name */
-    g_snprintf (shm_handle, sizeof (shm_handle), "/gimp-shm-%d", pid);
+    gimp_plug_in_shm_get_name (pid, serial, shm_handle, sizeof (shm_handle));
 
     /* Create the file mapping into paging space */
     shm_fd = shm_open (shm_handle, O_RDWR | O_CREAT, 0600);
 
     if (shm_fd != -1)
       {
-        if (ftruncate (shm_fd, TILE_MAP_SIZE) != -1)
+        if (ftruncate (shm_fd, size) != -1)
           {
             /* Map the shared memory into our address space for use */
-            shm->shm_addr = (guchar *) mmap (NULL, TILE_MAP_SIZE,
+            shm->shm_addr = (guchar *) mmap (NULL, size,
                                              PROT_READ | PROT_WRITE, MAP_SHARED,
                                              shm_fd, 0);
 
             /* Verify that we mapped our view */
             if (shm->shm_addr != MAP_FAILED)
               {
-                shm->shm_ID = pid;
+                shm->shm_ID = serial == -1 ? pid : serial;
               }
             else
               {
-                g_printerr ("mmap() failed: %s\n" ERRMSG_SHM_DISABLE,
-                            g_strerror (errno));
+                g_printerr ("mmap() failed: %s\n%s\n",
+                            g_strerror (errno), errmsg);
 
                 shm_unlink (shm_handle);
               }
           }
         else
           {
-            g_printerr ("ftruncate() failed: %s\n" ERRMSG_SHM_DISABLE,
-                        g_strerror (errno));
+            g_printerr ("ftruncate() failed: %s\n%s\n",
+                        g_strerror (errno), errmsg);
 
             shm_unlink (shm_handle);
           }
@@ -224,8 +334,8 @@ gimp_plug_in_shm_new (void)
       }
     else
       {
-        g_printerr ("shm_open() failed: %s\n" ERRMSG_SHM_DISABLE,
-                    g_strerror (errno));
+        g_printerr ("shm_open() failed: %s\n%s\n",
+                    g_strerror (errno), errmsg);
       }
   }
 
@@ -244,58 +354,29 @@ gimp_plug_in_shm_new (void)
   return shm;
 }
 
-void
-gimp_plug_in_shm_free (GimpPlugInShm *shm)
-{
-  g_return_if_fail (shm != NULL);
-
-  if (shm->shm_ID != -1)
-    {
-
-#if defined (USE_SYSV_SHM)
-
-      shmdt (shm->shm_addr);
-
-#ifndef IPC_RMID_DEFERRED_RELEASE
-      shmctl (shm->shm_ID, IPC_RMID, NULL);
-#endif
-
-#elif defined(USE_WIN32_SHM)
-
-      if (shm->shm_handle)
-        CloseHandle (shm->shm_handle);
-
-#elif defined(USE_POSIX_SHM)
+#if defined(USE_WIN32_SHM) || defined(USE_POSIX_SHM)
 
-      gchar shm_handle[32];
-
-      munmap (shm->shm_addr, TILE_MAP_SIZE);
-
-      g_snprintf (shm_handle, sizeof (shm_handle), "/gimp-shm-%d",
-                  shm->shm_ID);
-
-      shm_unlink (shm_handle);
-
-#endif
-
-      GIMP_LOG (SHM, "detached shared memory segment ID = %d", shm->shm_ID);
-    }
-
-  g_slice_free (GimpPlugInShm, shm);
-}
-
-gint
-gimp_plug_in_shm_get_ID (GimpPlugInShm *shm)
+/*  the tile segment is named after the core's process ID alone, the
+ *  segments of drawable maps after the process ID and their serial
+ *  number.  libgimp derives the same names.
+ */
+static void
+gimp_plug_in_shm_get_name (gint   pid,
+                           gint   serial,
+                           gchar *name,
+                           gsize  name_size)
 {
-  g_return_val_if_fail (shm != NULL, -1);
-
-  return shm->shm_ID;
+#if defined(USE_WIN32_SHM)
+  if (serial == -1)
+    g_snprintf (name, name_size, "GIMP%d.SHM", pid);
+  else
+    g_snprintf (name, name_size, "GIMP%d-%d.SHM", pid, serial);
+#else
+  if (serial == -1)
+    g_snprintf (name, name_size, "/gimp-shm-%d", pid);
+  else
+    g_snprintf (name, name_size, "/gimp-shm-%d-%d", pid, serial);
+#endif
 }
 
-guchar *
-gimp_plug_in_shm_get_addr (GimpPlugInShm *shm)
-{
-  g_return_val_if_fail (shm != NULL, NULL);
-
-  return shm->shm_addr;
-}
+#endif
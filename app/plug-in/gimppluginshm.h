@@ -22,6 +22,7 @@
 
 
 GimpPlugInShm * gimp_plug_in_shm_new      (void);
+GimpPlugInShm * gimp_plug_in_shm_new_map  (gsize          size);
 void            gimp_plug_in_shm_free     (GimpPlugInShm *shm);
 
 gint            gimp_plug_in_shm_get_ID   (GimpPlugInShm *shm);
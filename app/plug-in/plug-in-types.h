@@ -35,6 +35,12 @@ typedef struct _GimpPlugInManager    GimpPlugInManager;
 typedef struct _GimpPlugInMenuBranch GimpPlugInMenuBranch;
 typedef struct _GimpPlugInProcFrame  GimpPlugInProcFrame;
 typedef struct _GimpPlugInShm        GimpPlugInShm;
+typedef struct _GimpPlugInStats      GimpPlugInStats;
+
+
+typedef void (* GimpPlugInReturnFunc) (GimpPlugIn     *plug_in,
+                                       GimpValueArray *return_vals,
+                                       gpointer        user_data);
 
 
 #endif /* __PLUG_IN_TYPES_H__ */
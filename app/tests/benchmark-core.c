@@ -0,0 +1,582 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* times standard core workloads on synthetic images: projecting a
+ * stack of layers in each of a set of layer modes, painting a scripted
+ * stroke with each paint method, applying common filters, bucket
+ * filling, selecting by color and converting the image's precision and
+ * type.  prints a JSON array with one object per workload, see
+ * print_result().
+ *
+ * run with "make benchmark".  the image size can be given as the only
+ * argument, it defaults to 2048.  file round-trips are timed by
+ * benchmark-xcf, other formats are saved by plug-ins, which aren't run
+ * here.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpbrush.h"
+#include "core/gimpchannel.h"
+#include "core/gimpchannel-select.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpcontext.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpdrawable-bucket-fill.h"
+#include "core/gimpdrawable-operation.h"
+#include "core/gimpdynamics.h"
+#include "core/gimpfilloptions.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-convert-indexed.h"
+#include "core/gimpimage-convert-precision.h"
+#include "core/gimpimage-undo.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+#include "core/gimppaintinfo.h"
+#include "core/gimppickable.h"
+
+#include "paint/gimppaintcore.h"
+#include "paint/gimppaintcore-stroke.h"
+#include "paint/gimppaintoptions.h"
+
+#include "tests.h"
+#include "gimp-app-test-utils.h"
+
+
+#define DEFAULT_SIZE    2048
+#define N_LAYERS        8
+#define N_STROKE_POINTS 512
+
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *operation;
+  const gchar *first_property;
+  gdouble      value;
+} Filter;
+
+
+static const GimpLayerMode layer_modes[] =
+{
+  GIMP_LAYER_MODE_NORMAL,
+  GIMP_LAYER_MODE_MULTIPLY,
+  GIMP_LAYER_MODE_SCREEN,
+  GIMP_LAYER_MODE_OVERLAY,
+  GIMP_LAYER_MODE_DIFFERENCE,
+  GIMP_LAYER_MODE_ADDITION,
+  GIMP_LAYER_MODE_DARKEN_ONLY,
+  GIMP_LAYER_MODE_DODGE,
+  GIMP_LAYER_MODE_SOFTLIGHT,
+  GIMP_LAYER_MODE_HSV_HUE,
+  GIMP_LAYER_MODE_LCH_COLOR
+};
+
+static const gchar *paint_methods[] =
+{
+  "gimp-pencil",
+  "gimp-paintbrush",
+  "gimp-airbrush",
+  "gimp-eraser",
+  "gimp-ink",
+  "gimp-smudge",
+  "gimp-convolve",
+  "gimp-dodge-burn"
+};
+
+static const Filter filters[] =
+{
+  { "gaussian-blur", "gegl:gaussian-blur", "std-dev-x",  8.0 },
+  { "unsharp-mask",  "gegl:unsharp-mask",  "std-dev",    4.0 },
+  { "median-blur",   "gegl:median-blur",   "radius",     3.0 },
+  { "desaturate",    "gimp:desaturate",    NULL,         0.0 },
+  { "threshold",     "gimp:threshold",     "low",        0.5 }
+};
+
+static const GimpPrecision precisions[] =
+{
+  GIMP_PRECISION_U16_GAMMA,
+  GIMP_PRECISION_FLOAT_LINEAR,
+  GIMP_PRECISION_HALF_LINEAR
+};
+
+
+static gboolean first_result = TRUE;
+
+
+/*  prints one object of the JSON array, the throughput is in @unit per
+ *  second, and the peak RSS in KiB, or -1 if it is unknown
+ */
+static void
+print_result (const gchar *workload,
+              const gchar *variant,
+              gdouble      seconds,
+              gdouble      amount,
+              const gchar *unit,
+              gint64       peak_rss)
+{
+  gchar buf[2][G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_print ("%s  { \"workload\": \"%s\", \"variant\": \"%s\", "
+           "\"seconds\": %s, \"throughput\": %s, \"unit\": \"%s/s\", "
+           "\"peak-rss-kb\": %" G_GINT64_FORMAT " }",
+           first_result ? "" : ",\n",
+           workload, variant,
+           g_ascii_formatd (buf[0], sizeof (buf[0]), "%.4f", seconds),
+           g_ascii_formatd (buf[1], sizeof (buf[1]), "%.2f",
+                            seconds > 0.0 ? amount / seconds : 0.0),
+           unit,
+           peak_rss);
+
+  first_result = FALSE;
+}
+
+static void
+fill_layer (GimpLayer *layer,
+            guint      seed)
+{
+  GeglBuffer         *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (buffer, NULL, 0,
+                                   babl_format ("R'G'B'A u8"),
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      guchar *data = iter->data[0];
+      gint    x, y;
+
+      for (y = 0; y < iter->roi[0].height; y++)
+        {
+          gint sy = iter->roi[0].y + y;
+
+          for (x = 0; x < iter->roi[0].width; x++)
+            {
+              gint  sx    = iter->roi[0].x + x;
+              guint noise = ((guint) sx * 7919u + (guint) sy * 104729u +
+                             seed) * 2654435761u;
+
+              /*  smooth gradients with some noise, and translucent
+               *  bands, so that compositing isn't trivial
+               */
+              data[0] = (sx >> 3) + seed + ((noise >> 24) & 0x0f);
+              data[1] = (sy >> 3) + seed + ((noise >> 16) & 0x0f);
+              data[2] = ((sx + sy) >> 4) + ((noise >> 8) & 0x0f);
+              data[3] = ((sy >> 6) & 1) ? 0xff : 0x80;
+
+              data += 4;
+            }
+        }
+    }
+}
+
+static GimpImage *
+create_image (Gimp          *gimp,
+              gint           size,
+              gint           n_layers,
+              GimpPrecision  precision)
+{
+  GimpImage  *image;
+  const Babl *format;
+  gint        i;
+
+  image = gimp_image_new (gimp, size, size, GIMP_RGB, precision);
+
+  /*  undo would only measure copying the pixels once more  */
+  gimp_image_undo_disable (image);
+
+  format = gimp_image_get_layer_format (image, TRUE);
+
+  for (i = 0; i < n_layers; i++)
+    {
+      GimpLayer *layer;
+      gchar     *name = g_strdup_printf ("layer %d", i);
+
+      layer = gimp_layer_new (image, size, size, format, name,
+                              GIMP_OPACITY_OPAQUE, GIMP_LAYER_MODE_NORMAL);
+
+      g_free (name);
+
+      fill_layer (layer, i * 37);
+
+      gimp_image_add_layer (image, layer, NULL, 0, FALSE);
+    }
+
+  return image;
+}
+
+/*  reads the whole projection, which renders it  */
+static void
+render_projection (GimpImage *image)
+{
+  GimpPickable       *pickable = GIMP_PICKABLE (image);
+  GeglBufferIterator *iter;
+
+  gimp_pickable_flush (pickable);
+
+  iter = gegl_buffer_iterator_new (gimp_pickable_get_buffer (pickable),
+                                   NULL, 0, NULL,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter));
+}
+
+static void
+benchmark_layer_modes (Gimp *gimp,
+                       gint  size)
+{
+  GimpImage *image = create_image (gimp, size, N_LAYERS,
+                                   GIMP_PRECISION_U8_GAMMA);
+  gint       i;
+
+  for (i = 0; i < G_N_ELEMENTS (layer_modes); i++)
+    {
+      GList       *list;
+      const gchar *nick = NULL;
+      GTimer      *timer;
+
+      gimp_enum_get_value (GIMP_TYPE_LAYER_MODE, layer_modes[i],
+                           NULL, &nick, NULL, NULL);
+
+      /*  all layers but the bottom one  */
+      for (list = gimp_image_get_layer_iter (image);
+           list && list->next;
+           list = g_list_next (list))
+        {
+          gimp_layer_set_mode (list->data, layer_modes[i], FALSE);
+        }
+
+      /*  render once with the old mode's tiles dropped, but not timed,
+       *  so that the timed run doesn't include building the graph
+       */
+      render_projection (image);
+
+      gimp_image_invalidate (image, 0, 0, size, size);
+
+      gimp_test_utils_reset_peak_rss ();
+
+      timer = g_timer_new ();
+
+      render_projection (image);
+
+      print_result ("project-layers", nick,
+                    g_timer_elapsed (timer, NULL),
+                    (gdouble) size * size * N_LAYERS / 1e6, "megapixels",
+                    gimp_test_utils_get_peak_rss ());
+
+      g_timer_destroy (timer);
+    }
+
+  g_object_unref (image);
+}
+
+static void
+benchmark_paint (Gimp *gimp,
+                 gint  size)
+{
+  GimpContext *context = gimp_get_user_context (gimp);
+  GimpImage   *image   = create_image (gimp, size, 1,
+                                       GIMP_PRECISION_U8_GAMMA);
+  GimpLayer   *layer   = gimp_image_get_active_layer (image);
+  GimpCoords   coords[N_STROKE_POINTS];
+  gint         i;
+
+  if (! gimp_context_get_brush (context))
+    gimp_context_set_brush (context,
+                            GIMP_BRUSH (gimp_brush_get_standard (context)));
+
+  if (! gimp_context_get_dynamics (context))
+    gimp_context_set_dynamics (context,
+                               GIMP_DYNAMICS (gimp_dynamics_get_standard (context)));
+
+  /*  a zigzag over the whole image  */
+  for (i = 0; i < N_STROKE_POINTS; i++)
+    {
+      GimpCoords default_coords = GIMP_COORDS_DEFAULT_VALUES;
+
+      coords[i]   = default_coords;
+      coords[i].x = (gdouble) size * i / N_STROKE_POINTS;
+      coords[i].y = (i / 16) % 2 ? size * 0.75 : size * 0.25;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (paint_methods); i++)
+    {
+      GimpPaintInfo    *paint_info;
+      GimpPaintOptions *options;
+      GimpPaintCore    *core;
+      GTimer           *timer;
+      GError           *error = NULL;
+
+      paint_info = (GimpPaintInfo *)
+        gimp_container_get_child_by_name (gimp->paint_info_list,
+                                          paint_methods[i]);
+
+      if (! paint_info)
+        continue;
+
+      options = GIMP_PAINT_OPTIONS (gimp_config_duplicate (GIMP_CONFIG (paint_info->paint_options)));
+
+      gimp_context_define_properties (GIMP_CONTEXT (options),
+                                      GIMP_CONTEXT_PROP_MASK_PAINT,
+                                      FALSE);
+      gimp_context_set_parent (GIMP_CONTEXT (options), context);
+
+      core = g_object_new (paint_info->paint_type, NULL);
+
+      gimp_test_utils_reset_peak_rss ();
+
+      timer = g_timer_new ();
+
+      if (gimp_paint_core_stroke (core, GIMP_DRAWABLE (layer), options,
+                                  coords, N_STROKE_POINTS, FALSE, &error))
+        {
+          print_result ("paint-stroke", paint_methods[i],
+                        g_timer_elapsed (timer, NULL),
+                        N_STROKE_POINTS, "points",
+                        gimp_test_utils_get_peak_rss ());
+        }
+      else
+        {
+          g_printerr ("%s: painting failed: %s\n",
+                      paint_methods[i],
+                      error ? error->message : "unknown error");
+          g_clear_error (&error);
+        }
+
+      g_timer_destroy (timer);
+
+      g_object_unref (core);
+      g_object_unref (options);
+    }
+
+  g_object_unref (image);
+}
+
+static void
+benchmark_filters (Gimp *gimp,
+                   gint  size)
+{
+  GimpImage *image = create_image (gimp, size, 1, GIMP_PRECISION_U8_GAMMA);
+  GimpLayer *layer = gimp_image_get_active_layer (image);
+  gint       i;
+
+  for (i = 0; i < G_N_ELEMENTS (filters); i++)
+    {
+      GeglNode *node;
+      GTimer   *timer;
+
+      node = gegl_node_new_child (NULL,
+                                  "operation", filters[i].operation,
+                                  NULL);
+
+      if (filters[i].first_property)
+        {
+          gegl_node_set (node,
+                         filters[i].first_property, filters[i].value,
+                         NULL);
+        }
+
+      gimp_test_utils_reset_peak_rss ();
+
+      timer = g_timer_new ();
+
+      gimp_drawable_apply_operation (GIMP_DRAWABLE (layer), NULL,
+                                     filters[i].name, node);
+
+      print_result ("filter", filters[i].name,
+                    g_timer_elapsed (timer, NULL),
+                    (gdouble) size * size / 1e6, "megapixels",
+                    gimp_test_utils_get_peak_rss ());
+
+      g_timer_destroy (timer);
+
+      g_object_unref (node);
+    }
+
+  g_object_unref (image);
+}
+
+static void
+benchmark_select (Gimp *gimp,
+                  gint  size)
+{
+  GimpContext     *context = gimp_get_user_context (gimp);
+  GimpImage       *image   = create_image (gimp, size, 1,
+                                           GIMP_PRECISION_U8_GAMMA);
+  GimpLayer       *layer   = gimp_image_get_active_layer (image);
+  GimpFillOptions *options;
+  GimpRGB          color;
+  GTimer          *timer;
+
+  gimp_rgba_set (&color, 0.5, 0.5, 0.5, 1.0);
+
+  gimp_test_utils_reset_peak_rss ();
+
+  timer = g_timer_new ();
+
+  gimp_channel_select_by_color (gimp_image_get_mask (image),
+                                GIMP_DRAWABLE (layer), FALSE,
+                                &color, 0.25, FALSE,
+                                GIMP_SELECT_CRITERION_COMPOSITE,
+                                GIMP_CHANNEL_OP_REPLACE,
+                                TRUE, FALSE, 0.0, 0.0);
+
+  print_result ("select-by-color", "composite",
+                g_timer_elapsed (timer, NULL),
+                (gdouble) size * size / 1e6, "megapixels",
+                gimp_test_utils_get_peak_rss ());
+
+  gimp_channel_clear (gimp_image_get_mask (image), NULL, FALSE);
+
+  options = gimp_fill_options_new (gimp, context, FALSE);
+
+  gimp_test_utils_reset_peak_rss ();
+
+  g_timer_start (timer);
+
+  gimp_drawable_bucket_fill (GIMP_DRAWABLE (layer), options,
+                             FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
+                             0.25, FALSE, FALSE,
+                             size / 2, size / 2);
+
+  print_result ("bucket-fill", "composite",
+                g_timer_elapsed (timer, NULL),
+                (gdouble) size * size / 1e6, "megapixels",
+                gimp_test_utils_get_peak_rss ());
+
+  g_timer_destroy (timer);
+
+  g_object_unref (options);
+  g_object_unref (image);
+}
+
+static void
+benchmark_convert (Gimp *gimp,
+                   gint  size)
+{
+  gdouble megapixels = (gdouble) size * size * N_LAYERS / 1e6;
+  gint    i;
+
+  for (i = 0; i < G_N_ELEMENTS (precisions); i++)
+    {
+      GimpImage   *image = create_image (gimp, size, N_LAYERS,
+                                         GIMP_PRECISION_U8_GAMMA);
+      const gchar *nick  = NULL;
+      GTimer      *timer;
+
+      gimp_enum_get_value (GIMP_TYPE_PRECISION, precisions[i],
+                           NULL, &nick, NULL, NULL);
+
+      gimp_test_utils_reset_peak_rss ();
+
+      timer = g_timer_new ();
+
+      gimp_image_convert_precision (image, precisions[i],
+                                    GEGL_DITHER_NONE,
+                                    GEGL_DITHER_NONE,
+                                    GEGL_DITHER_NONE,
+                                    NULL);
+
+      print_result ("convert-precision", nick,
+                    g_timer_elapsed (timer, NULL),
+                    megapixels, "megapixels",
+                    gimp_test_utils_get_peak_rss ());
+
+      g_timer_destroy (timer);
+
+      g_object_unref (image);
+    }
+
+  {
+    GimpImage *image = create_image (gimp, size, N_LAYERS,
+                                     GIMP_PRECISION_U8_GAMMA);
+    GTimer    *timer;
+    GError    *error = NULL;
+
+    gimp_test_utils_reset_peak_rss ();
+
+    timer = g_timer_new ();
+
+    if (gimp_image_convert_indexed (image,
+                                    GIMP_CONVERT_PALETTE_GENERATE, 256,
+                                    FALSE,
+                                    GIMP_CONVERT_DITHER_FS, FALSE, FALSE,
+                                    NULL, NULL, &error))
+      {
+        print_result ("convert-indexed", "generate-256-fs",
+                      g_timer_elapsed (timer, NULL),
+                      megapixels, "megapixels",
+                      gimp_test_utils_get_peak_rss ());
+      }
+    else
+      {
+        g_printerr ("indexed conversion failed: %s\n",
+                    error ? error->message : "unknown error");
+        g_clear_error (&error);
+      }
+
+    g_timer_destroy (timer);
+
+    g_object_unref (image);
+  }
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  gint  size = DEFAULT_SIZE;
+
+  if (argc > 1)
+    size = MAX (atoi (argv[1]), 64);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  g_print ("[\n");
+
+  benchmark_layer_modes (gimp, size);
+  benchmark_paint       (gimp, size);
+  benchmark_filters     (gimp, size);
+  benchmark_select      (gimp, size);
+  benchmark_convert     (gimp, size);
+
+  g_print ("\n]\n");
+
+  gimp_exit (gimp, TRUE);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* replays a paint recording, made by running GIMP with --paint-record,
+ * headlessly and times it:
+ *
+ *   benchmark-paint-replay [--real-time] RECORDING [IMAGE.xcf]
+ *
+ * the strokes are painted on the active layer of the given image, or on
+ * a blank image of DEFAULT_SIZE pixels square.  with --real-time, the
+ * strokes are replayed at the pace they were painted in, otherwise as
+ * fast as possible.  prints a JSON object like benchmark-core does.
+ *
+ * "make benchmark" runs this without a recording, which does nothing.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpdrawable-fill.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+
+#include "paint/gimppaintcore-record.h"
+
+#include "xcf/xcf.h"
+
+#include "tests.h"
+#include "gimp-app-test-utils.h"
+
+
+#define DEFAULT_SIZE 4096
+
+
+static GimpImage *
+load_image (Gimp        *gimp,
+            const gchar *filename)
+{
+  GFile        *file  = g_file_new_for_commandline_arg (filename);
+  GInputStream *input;
+  GimpImage    *image = NULL;
+  GError       *error = NULL;
+
+  input = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+
+  if (input)
+    {
+      image = xcf_load_stream (gimp, input, file, NULL, &error);
+
+      g_object_unref (input);
+    }
+
+  if (! image)
+    {
+      g_printerr ("Could not load '%s': %s\n",
+                  filename, error ? error->message : "unknown error");
+      g_clear_error (&error);
+    }
+
+  g_object_unref (file);
+
+  return image;
+}
+
+static GimpImage *
+create_image (Gimp *gimp)
+{
+  GimpImage *image;
+  GimpLayer *layer;
+
+  image = gimp_image_new (gimp, DEFAULT_SIZE, DEFAULT_SIZE, GIMP_RGB,
+                          GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_layer_new (image, DEFAULT_SIZE, DEFAULT_SIZE,
+                          gimp_image_get_layer_format (image, FALSE),
+                          "Background",
+                          GIMP_OPACITY_OPAQUE, GIMP_LAYER_MODE_NORMAL);
+
+  gimp_drawable_fill (GIMP_DRAWABLE (layer),
+                      gimp_get_user_context (gimp), GIMP_FILL_WHITE);
+
+  gimp_image_add_layer (image, layer, NULL, 0, FALSE);
+
+  return image;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp        *gimp;
+  GimpImage   *image;
+  GimpLayer   *layer;
+  GFile       *file;
+  GTimer      *timer;
+  gboolean     real_time = FALSE;
+  const gchar *recording = NULL;
+  const gchar *image_filename = NULL;
+  gint         n_strokes;
+  gint         n_events;
+  gboolean     success;
+  GError      *error = NULL;
+  gint         i;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (! strcmp (argv[i], "--real-time"))
+        real_time = TRUE;
+      else if (! recording)
+        recording = argv[i];
+      else if (! image_filename)
+        image_filename = argv[i];
+    }
+
+  if (! recording)
+    {
+      g_print ("No paint recording given, nothing to replay.\n");
+
+      return EXIT_SUCCESS;
+    }
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  if (image_filename)
+    image = load_image (gimp, image_filename);
+  else
+    image = create_image (gimp);
+
+  if (! image || ! gimp_image_get_active_layer (image))
+    {
+      g_printerr ("No layer to paint on.\n");
+
+      return EXIT_FAILURE;
+    }
+
+  layer = gimp_image_get_active_layer (image);
+
+  file = g_file_new_for_commandline_arg (recording);
+
+  gimp_test_utils_reset_peak_rss ();
+
+  timer = g_timer_new ();
+
+  success = gimp_paint_core_replay (gimp, GIMP_DRAWABLE (layer), file,
+                                    real_time, &n_strokes, &n_events,
+                                    &error);
+
+  if (success)
+    {
+      gdouble seconds = g_timer_elapsed (timer, NULL);
+      gchar   buf[2][G_ASCII_DTOSTR_BUF_SIZE];
+
+      g_print ("{ \"workload\": \"paint-replay\", \"variant\": \"%s\", "
+               "\"strokes\": %d, \"events\": %d, "
+               "\"seconds\": %s, \"throughput\": %s, \"unit\": \"events/s\", "
+               "\"peak-rss-kb\": %" G_GINT64_FORMAT " }\n",
+               real_time ? "real-time" : "fast",
+               n_strokes, n_events,
+               g_ascii_formatd (buf[0], sizeof (buf[0]), "%.4f", seconds),
+               g_ascii_formatd (buf[1], sizeof (buf[1]), "%.2f",
+                                seconds > 0.0 ? n_events / seconds : 0.0),
+               gimp_test_utils_get_peak_rss ());
+    }
+  else
+    {
+      g_printerr ("Replaying '%s' failed: %s\n",
+                  recording, error->message);
+      g_clear_error (&error);
+    }
+
+  g_timer_destroy (timer);
+  g_object_unref (file);
+  g_object_unref (image);
+
+  gimp_exit (gimp, TRUE);
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
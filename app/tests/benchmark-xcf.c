@@ -0,0 +1,448 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* times saving and loading synthetic images with xcf_save_stream() and
+ * xcf_load_stream(), for each tile compression, and prints one line of
+ * tab separated values per operation, see print_header().
+ *
+ * run with "make benchmark".  the image size can be given as the only
+ * argument, it defaults to 1024.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpgrouplayer.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+
+#include "xcf/xcf.h"
+
+#include "tests.h"
+#include "gimp-app-test-utils.h"
+
+
+#define DEFAULT_SIZE 1024
+
+
+typedef enum
+{
+  CONTENT_DENSE,
+  CONTENT_SPARSE
+} Content;
+
+typedef struct
+{
+  const gchar   *name;
+  GimpPrecision  precision;
+  gint           n_layers;
+  gint           group_depth;
+  Content        content;
+} Scenario;
+
+typedef enum
+{
+  COMPRESSION_RLE,
+  COMPRESSION_ZLIB,
+  COMPRESSION_ZSTD
+} Compression;
+
+
+static const Scenario scenarios[] =
+{
+  { "layers-8bit-dense",   GIMP_PRECISION_U8_GAMMA,     16, 0, CONTENT_DENSE  },
+  { "layers-8bit-sparse",  GIMP_PRECISION_U8_GAMMA,     16, 0, CONTENT_SPARSE },
+  { "many-layers-8bit",    GIMP_PRECISION_U8_GAMMA,    128, 0, CONTENT_SPARSE },
+  { "deep-groups-8bit",    GIMP_PRECISION_U8_GAMMA,     16, 8, CONTENT_DENSE  },
+  { "layers-16bit-dense",  GIMP_PRECISION_U16_GAMMA,     8, 0, CONTENT_DENSE  },
+  { "layers-16bit-sparse", GIMP_PRECISION_U16_GAMMA,     8, 0, CONTENT_SPARSE },
+  { "layers-32bit-dense",  GIMP_PRECISION_FLOAT_LINEAR,  4, 0, CONTENT_DENSE  },
+  { "layers-32bit-sparse", GIMP_PRECISION_FLOAT_LINEAR,  4, 0, CONTENT_SPARSE }
+};
+
+static const gchar *compression_names[] =
+{
+  "rle",
+  "zlib",
+  "zstd"
+};
+
+
+static void
+fill_layer (GimpLayer *layer,
+            Content    content,
+            GRand     *grand)
+{
+  GeglBuffer    *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  GeglRectangle  rect   = *gegl_buffer_get_extent (buffer);
+  gint           n_rects;
+  gint           i;
+
+  /*  sparse layers have a few opaque rectangles on a transparent
+   *  background, dense layers are covered by a noisy gradient
+   */
+  if (content == CONTENT_SPARSE)
+    n_rects = 4;
+  else
+    n_rects = 1;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      GeglRectangle       area = rect;
+      GeglBufferIterator *iter;
+      guint               seed = g_rand_int (grand);
+
+      if (content == CONTENT_SPARSE)
+        {
+          area.width  = rect.width  / 8;
+          area.height = rect.height / 8;
+          area.x      = g_rand_int_range (grand, 0, rect.width  - area.width);
+          area.y      = g_rand_int_range (grand, 0, rect.height - area.height);
+        }
+
+      iter = gegl_buffer_iterator_new (buffer, &area, 0,
+                                       babl_format ("R'G'B'A u8"),
+                                       GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guchar *data = iter->data[0];
+          gint    x, y;
+
+          for (y = 0; y < iter->roi[0].height; y++)
+            {
+              gint sy = iter->roi[0].y + y;
+
+              for (x = 0; x < iter->roi[0].width; x++)
+                {
+                  gint  sx    = iter->roi[0].x + x;
+                  guint noise = ((guint) sx * 7919u + (guint) sy * 104729u +
+                                 seed) * 2654435761u;
+
+                  data[0] = sx + seed + ((noise >> 24) & 0x0f);
+                  data[1] = sy + seed + ((noise >> 16) & 0x0f);
+                  data[2] = sx + sy   + ((noise >>  8) & 0x0f);
+                  data[3] = 0xff;
+
+                  data += 4;
+                }
+            }
+        }
+    }
+}
+
+static GimpImage *
+create_image (Gimp           *gimp,
+              const Scenario *scenario,
+              gint            size,
+              gsize          *n_bytes,
+              GRand          *grand)
+{
+  GimpImage  *image;
+  GimpLayer  *parent = NULL;
+  const Babl *format;
+  gint        i;
+
+  image = gimp_image_new (gimp, size, size, GIMP_RGB, scenario->precision);
+
+  format = gimp_image_get_layer_format (image, TRUE);
+
+  *n_bytes = 0;
+
+  /*  a chain of nested groups, with the layers at the bottom  */
+  for (i = 0; i < scenario->group_depth; i++)
+    {
+      GimpLayer *group = gimp_group_layer_new (image);
+
+      gimp_image_add_layer (image, group, parent, 0, FALSE);
+
+      parent = group;
+    }
+
+  for (i = 0; i < scenario->n_layers; i++)
+    {
+      GimpLayer *layer;
+      gchar     *name = g_strdup_printf ("layer %d", i);
+
+      layer = gimp_layer_new (image, size, size, format, name,
+                              GIMP_OPACITY_OPAQUE, GIMP_LAYER_MODE_NORMAL);
+
+      g_free (name);
+
+      fill_layer (layer, scenario->content, grand);
+
+      gimp_image_add_layer (image, layer, parent, 0, FALSE);
+
+      *n_bytes += (gsize) size * size * babl_format_get_bytes_per_pixel (format);
+    }
+
+  return image;
+}
+
+static void
+set_compression (Gimp        *gimp,
+                 GimpImage   *image,
+                 Compression  compression)
+{
+  gimp_image_set_xcf_compression (image, compression == COMPRESSION_ZLIB);
+
+  g_object_set (gimp->config,
+                "xcf-zstd-level", compression == COMPRESSION_ZSTD ? 3 : 0,
+                NULL);
+}
+
+static void
+print_header (void)
+{
+  g_print ("scenario\tprecision\tlayers\tdepth\tcompression\toperation\t"
+           "seconds\tpixel-mb\tfile-mb\tmb-per-second\tpeak-rss-kb\n");
+}
+
+static void
+print_result (const Scenario *scenario,
+              Compression     compression,
+              const gchar    *operation,
+              gdouble         seconds,
+              gsize           n_bytes,
+              goffset         file_size,
+              gint64          peak_rss)
+{
+  GEnumClass *enum_class = g_type_class_ref (GIMP_TYPE_PRECISION);
+  GEnumValue *value      = g_enum_get_value (enum_class, scenario->precision);
+  gchar       buf[4][G_ASCII_DTOSTR_BUF_SIZE];
+  gdouble     mb         = n_bytes / (1024.0 * 1024.0);
+
+  g_print ("%s\t%s\t%d\t%d\t%s\t%s\t%s\t%s\t%s\t%s\t%" G_GINT64_FORMAT "\n",
+           scenario->name,
+           value->value_nick,
+           scenario->n_layers,
+           scenario->group_depth,
+           compression_names[compression],
+           operation,
+           g_ascii_formatd (buf[0], sizeof (buf[0]), "%.4f", seconds),
+           g_ascii_formatd (buf[1], sizeof (buf[1]), "%.1f", mb),
+           g_ascii_formatd (buf[2], sizeof (buf[2]), "%.1f",
+                            file_size / (1024.0 * 1024.0)),
+           g_ascii_formatd (buf[3], sizeof (buf[3]), "%.1f",
+                            seconds > 0.0 ? mb / seconds : 0.0),
+           peak_rss);
+
+  g_type_class_unref (enum_class);
+}
+
+static gboolean
+benchmark_load (Gimp           *gimp,
+                const Scenario *scenario,
+                Compression     compression,
+                GFile          *file,
+                gsize           n_bytes,
+                goffset         file_size,
+                gboolean        lazy)
+{
+  GInputStream *input;
+  GimpImage    *image;
+  GTimer       *timer;
+  gdouble       seconds;
+  GError       *error = NULL;
+
+  g_object_set (gimp->config,
+                "xcf-lazy-load", lazy,
+                NULL);
+
+  gimp_test_utils_reset_peak_rss ();
+
+  timer = g_timer_new ();
+
+  input = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+
+  if (input)
+    {
+      image = xcf_load_stream (gimp, input, file, NULL, &error);
+
+      g_object_unref (input);
+    }
+  else
+    {
+      image = NULL;
+    }
+
+  seconds = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  g_object_set (gimp->config,
+                "xcf-lazy-load", FALSE,
+                NULL);
+
+  if (! image)
+    {
+      g_printerr ("%s: loading failed: %s\n",
+                  scenario->name, error ? error->message : "unknown error");
+      g_clear_error (&error);
+
+      return FALSE;
+    }
+
+  print_result (scenario, compression, lazy ? "load-lazy" : "load",
+                seconds, n_bytes, file_size, gimp_test_utils_get_peak_rss ());
+
+  g_object_unref (image);
+
+  return TRUE;
+}
+
+static gboolean
+benchmark_scenario (Gimp           *gimp,
+                    const Scenario *scenario,
+                    Compression     compression,
+                    gint            size,
+                    GFile          *file,
+                    GRand          *grand)
+{
+  GimpImage     *image;
+  GOutputStream *output;
+  GFileInfo     *info;
+  GTimer        *timer;
+  gdouble        seconds;
+  gsize          n_bytes;
+  goffset        file_size;
+  gboolean       success;
+  GError        *error = NULL;
+
+  image = create_image (gimp, scenario, size, &n_bytes, grand);
+
+  set_compression (gimp, image, compression);
+
+  gimp_test_utils_reset_peak_rss ();
+
+  timer = g_timer_new ();
+
+  output = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
+                                            G_FILE_CREATE_NONE,
+                                            NULL, &error));
+
+  success = (output &&
+             xcf_save_stream (gimp, image, output, file, NULL, &error) &&
+             g_output_stream_close (output, NULL, &error));
+
+  seconds = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  g_clear_object (&output);
+  g_object_unref (image);
+
+  g_object_set (gimp->config,
+                "xcf-zstd-level", 0,
+                NULL);
+
+  if (! success)
+    {
+      g_printerr ("%s: saving failed: %s\n",
+                  scenario->name, error ? error->message : "unknown error");
+      g_clear_error (&error);
+
+      return FALSE;
+    }
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  file_size = info ? g_file_info_get_size (info) : 0;
+  g_clear_object (&info);
+
+  print_result (scenario, compression, "save",
+                seconds, n_bytes, file_size, gimp_test_utils_get_peak_rss ());
+
+  success = (benchmark_load (gimp, scenario, compression, file,
+                             n_bytes, file_size, FALSE) &&
+             benchmark_load (gimp, scenario, compression, file,
+                             n_bytes, file_size, TRUE));
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp        *gimp;
+  GRand       *grand;
+  GFile       *file;
+  gchar       *filename;
+  gint         size     = DEFAULT_SIZE;
+  gint         failures = 0;
+  Compression  compression;
+  gint         i;
+
+  if (argc > 1)
+    size = MAX (atoi (argv[1]), 64);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  filename = g_build_filename (g_get_tmp_dir (), "gimp-benchmark.xcf", NULL);
+  file = g_file_new_for_path (filename);
+  g_free (filename);
+
+  grand = g_rand_new_with_seed (0);
+
+  print_header ();
+
+  for (i = 0; i < G_N_ELEMENTS (scenarios); i++)
+    {
+      for (compression = COMPRESSION_RLE;
+           compression <= COMPRESSION_ZSTD;
+           compression++)
+        {
+#ifndef HAVE_ZSTD
+          if (compression == COMPRESSION_ZSTD)
+            continue;
+#endif
+
+          if (! benchmark_scenario (gimp, scenarios + i, compression, size,
+                                    file, grand))
+            failures++;
+        }
+    }
+
+  g_rand_free (grand);
+
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+
+  gimp_exit (gimp, TRUE);
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -17,6 +17,9 @@
 
 #include "config.h"
 
+#include <stdio.h>
+#include <string.h>
+
 #include <gegl.h>
 #include <gtk/gtk.h>
 
@@ -49,6 +52,10 @@
 #include <windows.h>
 #endif /* G_OS_WIN32 */
 
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
 void
 gimp_test_utils_set_env_to_subpath (const gchar *root_env_var,
                                     const gchar *subdir,
@@ -333,3 +340,61 @@ gimp_test_utils_create_image_from_dialog (Gimp *gimp)
   return image;
 }
 
+
+/**
+ * gimp_test_utils_reset_peak_rss:
+ *
+ * Resets the peak RSS returned by gimp_test_utils_get_peak_rss(), where
+ * the system allows it.  Otherwise it stays the peak of the whole run.
+ **/
+void
+gimp_test_utils_reset_peak_rss (void)
+{
+  FILE *file = fopen ("/proc/self/clear_refs", "w");
+
+  if (file)
+    {
+      fputs ("5", file);
+      fclose (file);
+    }
+}
+
+/**
+ * gimp_test_utils_get_peak_rss:
+ *
+ * Returns: the peak RSS in KiB, or -1 if it is unknown.
+ **/
+gint64
+gimp_test_utils_get_peak_rss (void)
+{
+  gint64  peak = -1;
+  FILE   *file = fopen ("/proc/self/status", "r");
+
+  if (file)
+    {
+      gchar line[256];
+
+      while (fgets (line, sizeof (line), file))
+        {
+          if (g_str_has_prefix (line, "VmHWM:"))
+            {
+              peak = g_ascii_strtoll (line + strlen ("VmHWM:"), NULL, 10);
+              break;
+            }
+        }
+
+      fclose (file);
+    }
+
+#ifdef G_OS_UNIX
+  if (peak < 0)
+    {
+      struct rusage usage;
+
+      if (getrusage (RUSAGE_SELF, &usage) == 0)
+        peak = usage.ru_maxrss;
+    }
+#endif
+
+  return peak;
+}
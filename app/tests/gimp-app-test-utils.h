@@ -34,5 +34,8 @@ GimpUIManager * gimp_test_utils_get_ui_manager       (Gimp        *gimp);
 GimpImage     * gimp_test_utils_create_image_from_dialog
                                                      (Gimp        *gimp);
 
+void            gimp_test_utils_reset_peak_rss       (void);
+gint64          gimp_test_utils_get_peak_rss         (void);
+
 
 #endif /* __GIMP_APP_TEST_UTILS_H__ */
@@ -0,0 +1,554 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 2009 Martin Nordholts
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "widgets/widgets-types.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+
+#include "widgets/gimpuimanager.h"
+
+#include "core/gimp.h"
+#include "core/gimpcontext.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+
+#include "operations/gimplevelsconfig.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define GIMP_TEST_IMAGE_SIZE 100
+
+#define ADD_IMAGE_TEST(function) \
+  g_test_add ("/gimp-core/" #function, \
+              GimpTestFixture, \
+              gimp, \
+              gimp_test_image_setup, \
+              function, \
+              gimp_test_image_teardown);
+
+#define ADD_TEST(function) \
+  g_test_add ("/gimp-core/" #function, \
+              GimpTestFixture, \
+              gimp, \
+              NULL, \
+              function, \
+              NULL);
+
+
+typedef struct
+{
+  GimpImage *image;
+} GimpTestFixture;
+
+
+static void gimp_test_image_setup    (GimpTestFixture *fixture,
+                                      gconstpointer    data);
+static void gimp_test_image_teardown (GimpTestFixture *fixture,
+                                      gconstpointer    data);
+
+
+/**
+ * gimp_test_image_setup:
+ * @fixture:
+ * @data:
+ *
+ * Test fixture setup for a single image.
+ **/
+static void
+gimp_test_image_setup (GimpTestFixture *fixture,
+                       gconstpointer    data)
+{
+  Gimp *gimp = GIMP (data);
+
+  fixture->image = gimp_image_new (gimp,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   GIMP_RGB,
+                                   GIMP_PRECISION_FLOAT_LINEAR);
+}
+
+/**
+ * gimp_test_image_teardown:
+ * @fixture:
+ * @data:
+ *
+ * Test fixture teardown for a single image.
+ **/
+static void
+gimp_test_image_teardown (GimpTestFixture *fixture,
+                          gconstpointer    data)
+{
+  g_object_unref (fixture->image);
+}
+
+/**
+ * rotate_non_overlapping:
+ * @fixture:
+ * @data:
+ *
+ * Super basic test that makes sure we can add a layer
+ * and call gimp_item_rotate with center at (0, -10)
+ * without triggering a failed assertion .
+ **/
+static void
+rotate_non_overlapping (GimpTestFixture *fixture,
+                        gconstpointer    data)
+{
+  Gimp        *gimp    = GIMP (data);
+  GimpImage   *image   = fixture->image;
+  GimpLayer   *layer;
+  GimpContext *context = gimp_context_new (gimp, "Test", NULL /*template*/);
+  gboolean     result;
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          babl_format ("R'G'B'A u8"),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  g_assert_cmpint (GIMP_IS_LAYER (layer), ==, TRUE);
+
+  result = gimp_image_add_layer (image,
+                                 layer,
+                                 GIMP_IMAGE_ACTIVE_PARENT,
+                                 0,
+                                 FALSE);
+
+  gimp_item_rotate (GIMP_ITEM (layer), context, GIMP_ROTATE_90, 0., -10., TRUE);
+
+  g_assert_cmpint (result, ==, TRUE);
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 1);
+  g_object_unref (context);
+}
+
+/**
+ * add_layer:
+ * @fixture:
+ * @data:
+ *
+ * Super basic test that makes sure we can add a layer.
+ **/
+static void
+add_layer (GimpTestFixture *fixture,
+           gconstpointer    data)
+{
+  GimpImage *image = fixture->image;
+  GimpLayer *layer;
+  gboolean   result;
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          babl_format ("R'G'B'A u8"),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  g_assert_cmpint (GIMP_IS_LAYER (layer), ==, TRUE);
+
+  result = gimp_image_add_layer (image,
+                                 layer,
+                                 GIMP_IMAGE_ACTIVE_PARENT,
+                                 0,
+                                 FALSE);
+
+  g_assert_cmpint (result, ==, TRUE);
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 1);
+}
+
+/**
+ * remove_layer:
+ * @fixture:
+ * @data:
+ *
+ * Super basic test that makes sure we can remove a layer.
+ **/
+static void
+remove_layer (GimpTestFixture *fixture,
+              gconstpointer    data)
+{
+  GimpImage *image = fixture->image;
+  GimpLayer *layer;
+  gboolean   result;
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          babl_format ("R'G'B'A u8"),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  g_assert_cmpint (GIMP_IS_LAYER (layer), ==, TRUE);
+
+  result = gimp_image_add_layer (image,
+                                 layer,
+                                 GIMP_IMAGE_ACTIVE_PARENT,
+                                 0,
+                                 FALSE);
+
+  g_assert_cmpint (result, ==, TRUE);
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 1);
+
+  gimp_image_remove_layer (image,
+                           layer,
+                           FALSE,
+                           NULL);
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+}
+
+/**
+ * white_graypoint_in_red_levels:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure the levels algorithm can handle when the graypoint is
+ * white. It's easy to get a divide by zero problem when trying to
+ * calculate what gamma will give a white graypoint.
+ **/
+static void
+white_graypoint_in_red_levels (GimpTestFixture *fixture,
+                               gconstpointer    data)
+{
+  GimpRGB              black   = { 0, 0, 0, 0 };
+  GimpRGB              gray    = { 1, 1, 1, 1 };
+  GimpRGB              white   = { 1, 1, 1, 1 };
+  GimpHistogramChannel channel = GIMP_HISTOGRAM_RED;
+  GimpLevelsConfig    *config;
+
+  config = g_object_new (GIMP_TYPE_LEVELS_CONFIG, NULL);
+
+  gimp_levels_config_adjust_by_colors (config,
+                                       channel,
+                                       &black,
+                                       &gray,
+                                       &white);
+
+  /* Make sure we didn't end up with an invalid gamma value */
+  g_object_set (config,
+                "gamma", config->gamma[channel],
+                NULL);
+}
+
+/*  the row-by-row gimp:grow, gimp:shrink and gimp:border, written out
+ *  pixel by pixel, to check the faster code paths they take for larger
+ *  radii against
+ */
+static gboolean
+selection_reference_selected (const gfloat *src,
+                              gint          width,
+                              gint          height,
+                              gint          x,
+                              gint          y,
+                              gboolean      edge_lock)
+{
+  if (x < 0 || x >= width || y < 0 || y >= height)
+    return edge_lock;
+
+  return src[y * width + x] >= 0.5;
+}
+
+static gboolean
+selection_reference_transition (const gfloat *src,
+                                gint          width,
+                                gint          height,
+                                gint          x,
+                                gint          y,
+                                gboolean      edge_lock)
+{
+  gint i, j;
+
+  /*  gimp:border takes the transitions of the last row from the row
+   *  before it with edge_lock
+   */
+  if (edge_lock && y == height - 1)
+    y--;
+
+  if (! selection_reference_selected (src, width, height, x, y, edge_lock))
+    return FALSE;
+
+  for (j = -1; j <= 1; j++)
+    for (i = -1; i <= 1; i++)
+      if (! selection_reference_selected (src, width, height,
+                                          x + i, y + j, edge_lock))
+        return TRUE;
+
+  return FALSE;
+}
+
+static void
+selection_reference (const gchar  *operation,
+                     const gfloat *src,
+                     gfloat       *dest,
+                     gint          width,
+                     gint          height,
+                     gint          radius_x,
+                     gint          radius_y,
+                     gboolean      edge_lock,
+                     gboolean      feather)
+{
+  gint *circ = g_new (gint, radius_x + 1);
+  gint  x, y;
+  gint  dx, dy;
+
+  for (dx = 0; dx <= radius_x; dx++)
+    {
+      gdouble tmp = dx > 0 ? dx - 0.5 : 0.0;
+
+      circ[dx] = RINT (radius_y /
+                       (gdouble) radius_x *
+                       sqrt (SQR (radius_x) - SQR (tmp)));
+    }
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gfloat value;
+
+        if (! strcmp (operation, "gimp:grow"))
+          {
+            value = 0.0;
+
+            for (dx = -radius_x; dx <= radius_x; dx++)
+              for (dy = -circ[ABS (dx)]; dy <= circ[ABS (dx)]; dy++)
+                if (selection_reference_selected (src, width, height,
+                                                  x + dx, y + dy, FALSE))
+                  value = 1.0;
+          }
+        else if (! strcmp (operation, "gimp:shrink"))
+          {
+            value = 1.0;
+
+            for (dx = -radius_x; dx <= radius_x; dx++)
+              for (dy = -circ[ABS (dx)]; dy <= circ[ABS (dx)]; dy++)
+                {
+                  gint sx = x + dx;
+                  gint sy = y + dy;
+
+                  /*  with edge_lock, the edge pixels extend outwards  */
+                  if (edge_lock)
+                    {
+                      sx = CLAMP (sx, 0, width  - 1);
+                      sy = CLAMP (sy, 0, height - 1);
+                    }
+
+                  if (! selection_reference_selected (src, width, height,
+                                                      sx, sy, FALSE))
+                    value = 0.0;
+                }
+          }
+        else
+          {
+            gdouble min_dist = 1.0;
+
+            for (dx = -radius_x; dx <= radius_x; dx++)
+              for (dy = -radius_y; dy <= radius_y; dy++)
+                {
+                  gdouble tmpx = ABS (dx) > 0 ? ABS (dx) - 0.5 : 0.0;
+                  gdouble tmpy = ABS (dy) > 0 ? ABS (dy) - 0.5 : 0.0;
+                  gdouble dist;
+
+                  if (x + dx < 0 || x + dx >= width ||
+                      y + dy < 0 || y + dy >= height)
+                    continue;
+
+                  if (! selection_reference_transition (src, width, height,
+                                                        x + dx, y + dy,
+                                                        edge_lock))
+                    continue;
+
+                  dist = ((tmpy * tmpy) / (radius_y * radius_y) +
+                          (tmpx * tmpx) / (radius_x * radius_x));
+
+                  min_dist = MIN (min_dist, dist);
+                }
+
+            if (min_dist < 1.0)
+              value = feather ? 1.0 - sqrt (min_dist) : 1.0;
+            else
+              value = 0.0;
+          }
+
+        dest[y * width + x] = value;
+      }
+
+  g_free (circ);
+}
+
+/**
+ * grow_shrink_border_large_radius:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure gimp:grow, gimp:shrink and gimp:border select the same
+ * pixels, with the same density, for the large radii they take a
+ * faster path for as they do row by row for small ones.
+ **/
+static void
+grow_shrink_border_large_radius (GimpTestFixture *fixture,
+                                 gconstpointer    data)
+{
+  static const gint   radii[][2]   = { {  2,  3 }, {  5,  4 }, {  8,  8 },
+                                       {  9,  3 }, {  3,  9 }, { 12,  5 },
+                                       {  1, 10 }, { 17, 13 } };
+  static const gchar *operations[] = { "gimp:grow",
+                                       "gimp:shrink",
+                                       "gimp:border" };
+  const Babl         *format       = babl_format ("Y float");
+  const gint          width        = 64;
+  const gint          height       = 48;
+  GeglRectangle       rect         = { 0, 0, width, height };
+  GeglBuffer         *src_buffer;
+  GeglBuffer         *dest_buffer;
+  gfloat             *src;
+  gfloat             *dest;
+  gfloat             *reference;
+  GRand              *rand;
+  gint                i, n, o;
+
+  src       = g_new0 (gfloat, width * height);
+  dest      = g_new  (gfloat, width * height);
+  reference = g_new  (gfloat, width * height);
+
+  /* Some scattered pixels and a few overlapping blobs */
+  rand = g_rand_new_with_seed (0);
+
+  for (i = 0; i < width * height; i++)
+    src[i] = g_rand_int_range (rand, 0, 100) < 3;
+
+  for (n = 0; n < 5; n++)
+    {
+      gint cx = g_rand_int_range (rand, 0, width);
+      gint cy = g_rand_int_range (rand, 0, height);
+      gint r  = g_rand_int_range (rand, 2, 16);
+      gint x, y;
+
+      for (y = 0; y < height; y++)
+        for (x = 0; x < width; x++)
+          if (SQR (x - cx) + SQR (y - cy) < SQR (r))
+            src[y * width + x] = 1.0;
+    }
+
+  g_rand_free (rand);
+
+  src_buffer = gegl_buffer_new (&rect, format);
+  gegl_buffer_set (src_buffer, &rect, 0, format, src, GEGL_AUTO_ROWSTRIDE);
+
+  for (n = 0; n < G_N_ELEMENTS (radii); n++)
+    for (o = 0; o < G_N_ELEMENTS (operations); o++)
+      for (i = 0; i < 4; i++)
+        {
+          gboolean  edge_lock = i & 1;
+          gboolean  feather   = i & 2;
+          GeglNode *node;
+          gint      j;
+
+          if ((o == 0 && edge_lock) || (o != 2 && feather))
+            continue;
+
+          node = gegl_node_new_child (NULL,
+                                      "operation", operations[o],
+                                      "radius-x",  radii[n][0],
+                                      "radius-y",  radii[n][1],
+                                      NULL);
+
+          if (o != 0)
+            gegl_node_set (node, "edge-lock", edge_lock, NULL);
+
+          if (o == 2)
+            gegl_node_set (node, "feather", feather, NULL);
+
+          dest_buffer = gegl_buffer_new (&rect, format);
+
+          gimp_gegl_apply_operation (src_buffer, NULL, NULL, node,
+                                     dest_buffer, NULL, FALSE);
+
+          g_object_unref (node);
+
+          gegl_buffer_get (dest_buffer, &rect, 1.0, format, dest,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          g_object_unref (dest_buffer);
+
+          selection_reference (operations[o], src, reference, width, height,
+                               radii[n][0], radii[n][1], edge_lock, feather);
+
+          for (j = 0; j < width * height; j++)
+            g_assert_cmpfloat (fabs (dest[j] - reference[j]), <, 1e-6);
+        }
+
+  g_object_unref (src_buffer);
+
+  g_free (src);
+  g_free (dest);
+  g_free (reference);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_IMAGE_TEST (add_layer);
+  ADD_IMAGE_TEST (remove_layer);
+  ADD_IMAGE_TEST (rotate_non_overlapping);
+  ADD_TEST (white_graypoint_in_red_levels);
+  ADD_TEST (grow_shrink_border_large_radius);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gio/gio.h>
 
 #include <fontconfig/fontconfig.h>
@@ -32,18 +34,41 @@
 #include "config/gimpcoreconfig.h"
 
 #include "core/gimp.h"
+#include "core/gimplist.h"
 
 #include "gimp-fonts.h"
+#include "gimpfont.h"
 #include "gimpfontlist.h"
 
 
-#define CONF_FNAME "fonts.conf"
+#define CONF_FNAME     "fonts.conf"
+#define SNAPSHOT_FNAME "fontlist"
+#define LOAD_DATA_KEY  "gimp-fonts-load-data"
+
+
+typedef struct
+{
+  Gimp      *gimp;
+  FcConfig  *config;
+  GThread   *thread;
+  GMutex     mutex;
+  GCond      cond;
+  guint      idle_id;
+  gboolean   caching_complete;
+  gboolean   success;
+} GimpFontsLoadFuncData;
 
 
-static gboolean gimp_fonts_load_fonts_conf (FcConfig *config,
-                                            GFile    *fonts_conf);
-static void     gimp_fonts_add_directories (FcConfig *config,
-                                            GList    *path);
+static void     gimp_fonts_notify_font_path (Gimp                  *gimp);
+static gpointer gimp_fonts_load_thread      (GimpFontsLoadFuncData *data);
+static gboolean gimp_fonts_load_idle        (GimpFontsLoadFuncData *data);
+static void     gimp_fonts_load_finish      (GimpFontsLoadFuncData *data);
+static void     gimp_fonts_snapshot_load    (Gimp                  *gimp);
+static void     gimp_fonts_snapshot_save    (Gimp                  *gimp);
+static gboolean gimp_fonts_load_fonts_conf  (FcConfig              *config,
+                                             GFile                 *fonts_conf);
+static void     gimp_fonts_add_directories  (FcConfig              *config,
+                                             GList                 *path);
 
 
 void
@@ -61,7 +86,7 @@ gimp_fonts_set_config (Gimp *gimp)
   g_return_if_fail (GIMP_IS_GIMP (gimp));
 
   g_signal_connect_swapped (gimp->config, "notify::font-path",
-                            G_CALLBACK (gimp_fonts_load),
+                            G_CALLBACK (gimp_fonts_notify_font_path),
                             gimp);
 }
 
@@ -74,62 +99,32 @@ gimp_fonts_exit (Gimp *gimp)
     {
       if (gimp->config)
         g_signal_handlers_disconnect_by_func (gimp->config,
-                                              G_CALLBACK (gimp_fonts_load),
+                                              G_CALLBACK (gimp_fonts_notify_font_path),
                                               gimp);
 
+      gimp_fonts_wait (gimp);
+
       g_clear_object (&gimp->fonts);
     }
 }
 
-typedef struct
-{
-  FcConfig  *config;
-  GMutex     mutex;
-  GCond      cond;
-  gboolean   caching_complete : 1;
-} GimpFontsLoadFuncData;
-
-static void
-gimp_fonts_load_func (FcConfig *config)
-{
-  if (! FcConfigBuildFonts (config))
-    FcConfigDestroy (config);
-  else
-    FcConfigSetCurrent (config);
-}
-
-static void
-gimp_fonts_load_thread (GimpFontsLoadFuncData *data)
-{
-  gimp_fonts_load_func (data->config);
-
-  g_mutex_lock (&data->mutex);
-  data->caching_complete = TRUE;
-  g_cond_signal (&data->cond);
-  g_mutex_unlock (&data->mutex);
-
-  g_thread_exit (0);
-}
-
 void
-gimp_fonts_load (Gimp               *gimp,
-                 GimpInitStatusFunc  status_callback)
+gimp_fonts_load (Gimp *gimp)
 {
-  FcConfig *config;
-  GFile    *fonts_conf;
-  GList    *path;
+  GimpFontsLoadFuncData *data;
+  FcConfig              *config;
+  GFile                 *fonts_conf;
+  GList                 *path;
 
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
   g_return_if_fail (GIMP_IS_FONT_LIST (gimp->fonts));
 
-  gimp_set_busy (gimp);
+  /*  a load with an older configuration may still be running  */
+  gimp_fonts_wait (gimp);
 
   if (gimp->be_verbose)
     g_print ("Loading fonts\n");
 
-  gimp_container_freeze (GIMP_CONTAINER (gimp->fonts));
-
-  gimp_container_clear (GIMP_CONTAINER (gimp->fonts));
-
   config = FcInitLoadConfig ();
 
   if (! config)
@@ -147,52 +142,66 @@ gimp_fonts_load (Gimp               *gimp,
   gimp_fonts_add_directories (config, path);
   g_list_free_full (path, (GDestroyNotify) g_object_unref);
 
-  if (status_callback)
-    {
-      gint64                 end_time;
-      GThread               *cache_thread;
-      GimpFontsLoadFuncData  data;
+  /*  on startup, list the fonts found last time until the real list
+   *  is ready
+   */
+  if (gimp_container_is_empty (gimp->fonts))
+    gimp_fonts_snapshot_load (gimp);
 
-      /* We perform font cache initialization in a separate thread, so
-       * in the case a cache rebuild is to be done it will not block
-       * the UI.
-       */
-      data.config = config;
-      g_mutex_init (&data.mutex);
-      g_cond_init (&data.cond);
-      data.caching_complete = FALSE;
+  /* We perform font cache initialization in a separate thread, so
+   * that a cache rebuild, which can take very long with many fonts
+   * installed, blocks neither startup nor the UI.  The font list is
+   * restored from an idle handler when the thread is done, or from
+   * gimp_fonts_wait() if fonts are needed before that.
+   */
+  data = g_slice_new0 (GimpFontsLoadFuncData);
 
-      cache_thread = g_thread_new ("font-cacher",
-                                   (GThreadFunc) gimp_fonts_load_thread,
-                                   &data);
+  data->gimp   = gimp;
+  data->config = config;
+  g_mutex_init (&data->mutex);
+  g_cond_init (&data->cond);
 
-      g_mutex_lock (&data.mutex);
+  g_object_set_data (G_OBJECT (gimp), LOAD_DATA_KEY, data);
 
-      end_time = g_get_monotonic_time () + 0.1 * G_TIME_SPAN_SECOND;
-      while (! data.caching_complete)
-        if (! g_cond_wait_until (&data.cond, &data.mutex, end_time))
-          {
-            status_callback (NULL, NULL, 0.6);
+  data->thread = g_thread_new ("font-cacher",
+                               (GThreadFunc) gimp_fonts_load_thread,
+                               data);
 
-            end_time += 0.1 * G_TIME_SPAN_SECOND;
-            continue;
-          }
+  return;
 
-      g_mutex_unlock (&data.mutex);
-      g_thread_join (cache_thread);
+ cleanup:
+  gimp_container_clear (GIMP_CONTAINER (gimp->fonts));
+}
 
-      g_mutex_clear (&data.mutex);
-      g_cond_clear (&data.cond);
-    }
-  else
+void
+gimp_fonts_wait (Gimp *gimp)
+{
+  GimpFontsLoadFuncData *data;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  data = g_object_get_data (G_OBJECT (gimp), LOAD_DATA_KEY);
+
+  if (! data)
+    return;
+
+  gimp_set_busy (gimp);
+
+  g_mutex_lock (&data->mutex);
+
+  while (! data->caching_complete)
+    g_cond_wait (&data->cond, &data->mutex);
+
+  if (data->idle_id)
     {
-      gimp_fonts_load_func (config);
+      g_source_remove (data->idle_id);
+      data->idle_id = 0;
     }
 
-  gimp_font_list_restore (GIMP_FONT_LIST (gimp->fonts));
+  g_mutex_unlock (&data->mutex);
+
+  gimp_fonts_load_finish (data);
 
- cleanup:
-  gimp_container_thaw (GIMP_CONTAINER (gimp->fonts));
   gimp_unset_busy (gimp);
 }
 
@@ -208,6 +217,180 @@ gimp_fonts_reset (Gimp *gimp)
   FcInitReinitialize ();
 }
 
+
+/*  private functions  */
+
+static void
+gimp_fonts_notify_font_path (Gimp *gimp)
+{
+  gimp_fonts_load (gimp);
+}
+
+static gpointer
+gimp_fonts_load_thread (GimpFontsLoadFuncData *data)
+{
+  gboolean success = FcConfigBuildFonts (data->config);
+
+  g_mutex_lock (&data->mutex);
+
+  data->success          = success;
+  data->caching_complete = TRUE;
+  data->idle_id          = g_idle_add ((GSourceFunc) gimp_fonts_load_idle,
+                                       data);
+
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->mutex);
+
+  return NULL;
+}
+
+static gboolean
+gimp_fonts_load_idle (GimpFontsLoadFuncData *data)
+{
+  g_mutex_lock (&data->mutex);
+  data->idle_id = 0;
+  g_mutex_unlock (&data->mutex);
+
+  gimp_fonts_load_finish (data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_fonts_load_finish (GimpFontsLoadFuncData *data)
+{
+  Gimp *gimp = data->gimp;
+
+  g_thread_join (data->thread);
+
+  g_object_set_data (G_OBJECT (gimp), LOAD_DATA_KEY, NULL);
+
+  gimp_container_freeze (GIMP_CONTAINER (gimp->fonts));
+
+  gimp_container_clear (GIMP_CONTAINER (gimp->fonts));
+
+  if (data->success)
+    {
+      /*  switch configurations only here, on the thread doing all
+       *  the text rendering
+       */
+      FcConfigSetCurrent (data->config);
+
+      gimp_font_list_restore (GIMP_FONT_LIST (gimp->fonts));
+    }
+  else
+    {
+      FcConfigDestroy (data->config);
+    }
+
+  gimp_container_thaw (GIMP_CONTAINER (gimp->fonts));
+
+  if (data->success)
+    gimp_fonts_snapshot_save (gimp);
+
+  g_mutex_clear (&data->mutex);
+  g_cond_clear (&data->cond);
+
+  g_slice_free (GimpFontsLoadFuncData, data);
+}
+
+/*  The snapshot is the font-path followed by the names of all fonts
+ *  found with it by the last load.  Its fonts have no pango context,
+ *  so they can be listed and selected but not previewed until the
+ *  real list replaces them.
+ */
+static void
+gimp_fonts_snapshot_load (Gimp *gimp)
+{
+  GFile  *file;
+  gchar  *contents;
+  gchar **lines;
+  gint    i;
+
+  if (! gimp->config->font_path)
+    return;
+
+  file = gimp_directory_file (SNAPSHOT_FNAME, NULL);
+
+  if (! g_file_load_contents (file, NULL, &contents, NULL, NULL, NULL))
+    {
+      g_object_unref (file);
+      return;
+    }
+
+  g_object_unref (file);
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  if (lines[0] && ! strcmp (lines[0], gimp->config->font_path))
+    {
+      if (gimp->be_verbose)
+        g_print ("Using font list snapshot\n");
+
+      gimp_container_freeze (GIMP_CONTAINER (gimp->fonts));
+
+      for (i = 1; lines[i]; i++)
+        {
+          GimpFont *font;
+
+          if (! *lines[i] || ! g_utf8_validate (lines[i], -1, NULL))
+            continue;
+
+          font = g_object_new (GIMP_TYPE_FONT,
+                               "name", lines[i],
+                               NULL);
+
+          gimp_container_add (GIMP_CONTAINER (gimp->fonts),
+                              GIMP_OBJECT (font));
+          g_object_unref (font);
+        }
+
+      gimp_container_thaw (GIMP_CONTAINER (gimp->fonts));
+    }
+
+  g_strfreev (lines);
+}
+
+static void
+gimp_fonts_snapshot_save (Gimp *gimp)
+{
+  GFile   *file;
+  GString *string;
+  GList   *list;
+  GError  *error = NULL;
+
+  if (! gimp->config->font_path)
+    return;
+
+  string = g_string_new (gimp->config->font_path);
+  g_string_append_c (string, '\n');
+
+  for (list = GIMP_LIST (gimp->fonts)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      g_string_append (string, gimp_object_get_name (list->data));
+      g_string_append_c (string, '\n');
+    }
+
+  file = gimp_directory_file (SNAPSHOT_FNAME, NULL);
+
+  if (! g_file_replace_contents (file, string->str, string->len,
+                                 NULL, FALSE, G_FILE_CREATE_NONE,
+                                 NULL, NULL, &error))
+    {
+      if (gimp->be_verbose)
+        g_print ("Could not save font list snapshot: %s\n",
+                 error->message);
+
+      g_clear_error (&error);
+    }
+
+  g_object_unref (file);
+  g_string_free (string, TRUE);
+}
+
 static gboolean
 gimp_fonts_load_fonts_conf (FcConfig *config,
                             GFile    *fonts_conf)
@@ -19,13 +19,13 @@
 #define __GIMP_FONTS_H__
 
 
-void   gimp_fonts_init       (Gimp               *gimp);
-void   gimp_fonts_set_config (Gimp               *gimp);
-void   gimp_fonts_exit       (Gimp               *gimp);
+void   gimp_fonts_init       (Gimp *gimp);
+void   gimp_fonts_set_config (Gimp *gimp);
+void   gimp_fonts_exit       (Gimp *gimp);
 
-void   gimp_fonts_load       (Gimp               *gimp,
-                              GimpInitStatusFunc  status_callback);
-void   gimp_fonts_reset      (Gimp               *gimp);
+void   gimp_fonts_load       (Gimp *gimp);
+void   gimp_fonts_wait       (Gimp *gimp);
+void   gimp_fonts_reset      (Gimp *gimp);
 
 
 #endif  /* __GIMP_FONTS_H__ */
@@ -33,6 +33,7 @@
 #include "vectors/gimpvectors.h"
 #include "vectors/gimpanchor.h"
 
+#include "gimp-fonts.h"
 #include "gimptext.h"
 #include "gimptext-vectors.h"
 #include "gimptextlayout.h"
@@ -82,6 +83,8 @@ gimp_text_vectors_new (GimpImage *image,
 
       gimp_image_get_resolution (image, &xres, &yres);
 
+      gimp_fonts_wait (image->gimp);
+
       layout = gimp_text_layout_new (text, xres, yres, &error);
       if (error)
         {
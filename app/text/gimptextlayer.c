@@ -37,6 +37,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpcontext.h"
 #include "core/gimpcontainer.h"
@@ -47,6 +48,7 @@
 #include "core/gimpitemtree.h"
 #include "core/gimpparasitelist.h"
 
+#include "gimp-fonts.h"
 #include "gimptext.h"
 #include "gimptextlayer.h"
 #include "gimptextlayer-transform.h"
@@ -64,6 +66,46 @@ enum
   PROP_MODIFIED
 };
 
+/*  the part of rendering a text layer that doesn't touch the layer,
+ *  and can therefore run on any thread
+ */
+typedef struct
+{
+  GimpTextLayer   *layer;
+  GimpText        *text;
+  gdouble          xres;
+  gdouble          yres;
+
+  GimpTextLayout  *layout;
+  gboolean         has_size;
+  gint             width;
+  gint             height;
+  cairo_surface_t *surface;
+  GError          *error;
+} GimpTextLayerRender;
+
+typedef struct
+{
+  GPtrArray *renders;
+  gint       next_render;
+} GimpTextLayerPrepareData;
+
+struct _GimpTextLayerPrivate
+{
+  /*  the last rendering, and what it was written to, so the next
+   *  rendering only needs to update the pixels that changed
+   */
+  cairo_surface_t     *render_surface;
+  GeglBuffer          *render_buffer;
+  GimpColorTransform  *render_transform;
+
+  /*  a rendering made ahead of time by gimp_text_layers_prepare_render()  */
+  GimpTextLayerRender *prepared;
+};
+
+/*  don't keep more prepared renderings than this around at once  */
+#define PREPARE_MAX_MEMSIZE (256 << 20)
+
 
 static void       gimp_text_layer_finalize       (GObject           *object);
 static void       gimp_text_layer_get_property   (GObject           *object,
@@ -111,7 +153,20 @@ static void       gimp_text_layer_convert_type   (GimpLayer         *layer,
 static void       gimp_text_layer_text_changed   (GimpTextLayer     *layer);
 static gboolean   gimp_text_layer_render         (GimpTextLayer     *layer);
 static void       gimp_text_layer_render_layout  (GimpTextLayer     *layer,
-                                                  GimpTextLayout    *layout);
+                                                  GimpTextLayerRender *render);
+static GimpTextLayerRender *
+                  gimp_text_layer_render_new     (GimpTextLayer     *layer);
+static void       gimp_text_layer_render_run     (GimpTextLayerRender *render);
+static void       gimp_text_layer_render_free    (GimpTextLayerRender *render);
+static void       gimp_text_layers_prepare_render_func
+                                                 (gint               i,
+                                                  gint               n,
+                                                  GimpTextLayerPrepareData *data);
+static void       gimp_text_layer_clear_render_cache
+                                                 (GimpTextLayer     *layer);
+static gboolean   gimp_text_layer_get_dirty_rect (cairo_surface_t   *old_surface,
+                                                  cairo_surface_t   *new_surface,
+                                                  GeglRectangle     *rect);
 
 
 G_DEFINE_TYPE (GimpTextLayer, gimp_text_layer, GIMP_TYPE_LAYER)
@@ -178,6 +233,8 @@ gimp_text_layer_class_init (GimpTextLayerClass *klass)
                             NULL, NULL,
                             FALSE,
                             GIMP_PARAM_STATIC_STRINGS);
+
+  g_type_class_add_private (klass, sizeof (GimpTextLayerPrivate));
 }
 
 static void
@@ -185,6 +242,10 @@ gimp_text_layer_init (GimpTextLayer *layer)
 {
   layer->text          = NULL;
   layer->text_parasite = NULL;
+
+  layer->private = G_TYPE_INSTANCE_GET_PRIVATE (layer,
+                                                GIMP_TYPE_TEXT_LAYER,
+                                                GimpTextLayerPrivate);
 }
 
 static void
@@ -192,6 +253,10 @@ gimp_text_layer_finalize (GObject *object)
 {
   GimpTextLayer *layer = GIMP_TEXT_LAYER (object);
 
+  gimp_text_layer_clear_render_cache (layer);
+
+  g_clear_pointer (&layer->private->prepared, gimp_text_layer_render_free);
+
   g_clear_object (&layer->text);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -259,6 +324,14 @@ gimp_text_layer_get_memsize (GimpObject *object,
   memsize += gimp_object_get_memsize (GIMP_OBJECT (text_layer->text),
                                       gui_size);
 
+  if (text_layer->private->render_surface)
+    {
+      cairo_surface_t *surface = text_layer->private->render_surface;
+
+      *gui_size += ((gint64) cairo_image_surface_get_stride (surface) *
+                    cairo_image_surface_get_height (surface));
+    }
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -324,6 +397,8 @@ gimp_text_layer_set_buffer (GimpDrawable *drawable,
   GimpTextLayer *layer = GIMP_TEXT_LAYER (drawable);
   GimpImage     *image = gimp_item_get_image (GIMP_ITEM (layer));
 
+  gimp_text_layer_clear_render_cache (layer);
+
   if (push_undo && ! layer->modified)
     gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_DRAWABLE_MOD,
                                  undo_desc);
@@ -355,6 +430,9 @@ gimp_text_layer_push_undo (GimpDrawable *drawable,
   GimpTextLayer *layer = GIMP_TEXT_LAYER (drawable);
   GimpImage     *image = gimp_item_get_image (GIMP_ITEM (layer));
 
+  /*  the pixels are about to be changed by something else than us  */
+  gimp_text_layer_clear_render_cache (layer);
+
   if (! layer->modified)
     gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_DRAWABLE, undo_desc);
 
@@ -568,6 +646,92 @@ gimp_text_layer_discard (GimpTextLayer *layer)
   gimp_text_layer_set_text (layer, NULL);
 }
 
+/**
+ * gimp_text_layers_prepare_render:
+ * @items: a list of #GimpItem
+ *
+ * Lays out and rasterizes the text of all text layers in @items in
+ * parallel, visible layers first, so that re-rendering them one by
+ * one afterwards, for example while converting the image, only needs
+ * to apply the results.  Does nothing for items that aren't unmodified
+ * text layers.
+ **/
+void
+gimp_text_layers_prepare_render (GList *items)
+{
+  GimpTextLayerPrepareData  data;
+  GList                    *visible = NULL;
+  GList                    *hidden  = NULL;
+  GList                    *layers;
+  GList                    *list;
+  gint64                    memsize = 0;
+
+  for (list = items; list; list = g_list_next (list))
+    {
+      GimpItem *item = list->data;
+
+      if (! gimp_item_is_text_layer (item))
+        continue;
+
+      if (gimp_item_is_visible (item))
+        visible = g_list_prepend (visible, item);
+      else
+        hidden = g_list_prepend (hidden, item);
+    }
+
+  layers = g_list_concat (g_list_reverse (visible), g_list_reverse (hidden));
+
+  if (! layers)
+    return;
+
+  gimp_fonts_wait (gimp_item_get_image (layers->data)->gimp);
+
+  data.renders     = g_ptr_array_new ();
+  data.next_render = 0;
+
+  for (list = layers; list; list = g_list_next (list))
+    {
+      GimpTextLayer *layer = list->data;
+      GimpItem      *item  = list->data;
+
+      if (gimp_container_is_empty (gimp_item_get_image (item)->gimp->fonts))
+        break;
+
+      /*  the rasterized text will be about as big as the layer  */
+      memsize += ((gint64) gimp_item_get_width  (item) *
+                  gimp_item_get_height (item) * 4);
+
+      if (memsize > PREPARE_MAX_MEMSIZE && data.renders->len > 0)
+        break;
+
+      g_clear_pointer (&layer->private->prepared,
+                       gimp_text_layer_render_free);
+
+      g_ptr_array_add (data.renders, gimp_text_layer_render_new (layer));
+    }
+
+  g_list_free (layers);
+
+  if (data.renders->len > 0)
+    {
+      gint i;
+
+      gimp_parallel_distribute (data.renders->len,
+                                (GimpParallelDistributeFunc)
+                                gimp_text_layers_prepare_render_func,
+                                &data);
+
+      for (i = 0; i < data.renders->len; i++)
+        {
+          GimpTextLayerRender *render = g_ptr_array_index (data.renders, i);
+
+          render->layer->private->prepared = render;
+        }
+    }
+
+  g_ptr_array_free (data.renders, TRUE);
+}
+
 gboolean
 gimp_item_is_text_layer (GimpItem *item)
 {
@@ -588,6 +752,20 @@ gimp_text_layer_get_format (GimpTextLayer *layer)
   return gimp_drawable_get_format (GIMP_DRAWABLE (layer));
 }
 
+static void
+gimp_text_layers_prepare_render_func (gint                      i,
+                                      gint                      n,
+                                      GimpTextLayerPrepareData *data)
+{
+  gint index;
+
+  while ((index = g_atomic_int_add (&data->next_render, 1)) <
+         (gint) data->renders->len)
+    {
+      gimp_text_layer_render_run (g_ptr_array_index (data->renders, index));
+    }
+}
+
 static void
 gimp_text_layer_text_changed (GimpTextLayer *layer)
 {
@@ -604,21 +782,23 @@ gimp_text_layer_text_changed (GimpTextLayer *layer)
       layer->text_parasite = NULL;
     }
 
+  /*  a prepared rendering shows the old text  */
+  g_clear_pointer (&layer->private->prepared, gimp_text_layer_render_free);
+
   gimp_text_layer_render (layer);
 }
 
 static gboolean
 gimp_text_layer_render (GimpTextLayer *layer)
 {
-  GimpDrawable   *drawable;
-  GimpItem       *item;
-  GimpImage      *image;
-  GimpTextLayout *layout;
-  gdouble         xres;
-  gdouble         yres;
-  gint            width;
-  gint            height;
-  GError         *error = NULL;
+  GimpDrawable        *drawable;
+  GimpItem            *item;
+  GimpImage           *image;
+  GimpTextLayerRender *render;
+  gdouble              xres;
+  gdouble              yres;
+  gint                 width;
+  gint                 height;
 
   if (! layer->text)
     return FALSE;
@@ -627,6 +807,8 @@ gimp_text_layer_render (GimpTextLayer *layer)
   item     = GIMP_ITEM (layer);
   image    = gimp_item_get_image (item);
 
+  gimp_fonts_wait (image->gimp);
+
   if (gimp_container_is_empty (image->gimp->fonts))
     {
       gimp_message_literal (image->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -637,16 +819,32 @@ gimp_text_layer_render (GimpTextLayer *layer)
 
   gimp_image_get_resolution (image, &xres, &yres);
 
-  layout = gimp_text_layout_new (layer->text, xres, yres, &error);
-  if (error)
+  render = layer->private->prepared;
+  layer->private->prepared = NULL;
+
+  if (! render              ||
+      render->text != layer->text ||
+      render->xres != xres  ||
+      render->yres != yres)
     {
-      gimp_message_literal (image->gimp, NULL, GIMP_MESSAGE_ERROR, error->message);
-      g_error_free (error);
+      g_clear_pointer (&render, gimp_text_layer_render_free);
+
+      render = gimp_text_layer_render_new (layer);
+      gimp_text_layer_render_run (render);
     }
 
+  if (render->error)
+    {
+      gimp_message_literal (image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            render->error->message);
+    }
+
+  width  = render->width;
+  height = render->height;
+
   g_object_freeze_notify (G_OBJECT (drawable));
 
-  if (gimp_text_layout_get_size (layout, &width, &height) &&
+  if (render->has_size &&
       (width  != gimp_item_get_width  (item) ||
        height != gimp_item_get_height (item) ||
        gimp_text_layer_get_format (layer) !=
@@ -709,9 +907,9 @@ gimp_text_layer_render (GimpTextLayer *layer)
     }
 
   if (width > 0 && height > 0)
-    gimp_text_layer_render_layout (layer, layout);
+    gimp_text_layer_render_layout (layer, render);
 
-  g_object_unref (layout);
+  gimp_text_layer_render_free (render);
 
   g_object_thaw_notify (G_OBJECT (drawable));
 
@@ -719,65 +917,257 @@ gimp_text_layer_render (GimpTextLayer *layer)
 }
 
 static void
-gimp_text_layer_render_layout (GimpTextLayer  *layer,
-                               GimpTextLayout *layout)
-{
-  GimpDrawable       *drawable = GIMP_DRAWABLE (layer);
-  GimpItem           *item     = GIMP_ITEM (layer);
-  GimpImage          *image    = gimp_item_get_image (item);
-  GeglBuffer         *buffer;
-  GimpColorTransform *transform;
-  cairo_t            *cr;
-  cairo_surface_t    *surface;
-  gint                width;
-  gint                height;
-  cairo_status_t      status;
+gimp_text_layer_render_layout (GimpTextLayer       *layer,
+                               GimpTextLayerRender *render)
+{
+  GimpTextLayerPrivate *private  = layer->private;
+  GimpDrawable         *drawable = GIMP_DRAWABLE (layer);
+  GimpItem             *item     = GIMP_ITEM (layer);
+  GimpImage            *image    = gimp_item_get_image (item);
+  GeglBuffer           *buffer;
+  GeglBuffer           *dest_buffer;
+  GimpColorTransform   *transform;
+  cairo_t              *cr;
+  cairo_surface_t      *surface;
+  GeglRectangle         rect;
+  gint                  width;
+  gint                  height;
+  cairo_status_t        status;
 
   g_return_if_fail (gimp_drawable_has_alpha (drawable));
 
   width  = gimp_item_get_width  (item);
   height = gimp_item_get_height (item);
 
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
-  status = cairo_surface_status (surface);
+  /*  use the text rasterized by gimp_text_layer_render_run(), if it
+   *  matches the layer
+   */
+  surface = render->surface;
+  render->surface = NULL;
 
-  if (status != CAIRO_STATUS_SUCCESS)
+  if (surface &&
+      (cairo_image_surface_get_width  (surface) != width ||
+       cairo_image_surface_get_height (surface) != height))
     {
-      GimpImage *image = gimp_item_get_image (item);
+      g_clear_pointer (&surface, cairo_surface_destroy);
+    }
 
-      gimp_message_literal (image->gimp, NULL, GIMP_MESSAGE_ERROR,
-                            _("Your text cannot be rendered. It is likely too big. "
-                              "Please make it shorter or use a smaller font."));
-      cairo_surface_destroy (surface);
-      return;
+  if (! surface)
+    {
+      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                            width, height);
+      status = cairo_surface_status (surface);
+
+      if (status != CAIRO_STATUS_SUCCESS)
+        {
+          gimp_message_literal (image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                                _("Your text cannot be rendered. It is likely too big. "
+                                  "Please make it shorter or use a smaller font."));
+          cairo_surface_destroy (surface);
+          return;
+        }
+
+      cr = cairo_create (surface);
+      gimp_text_layout_render (render->layout, cr, layer->text->base_dir,
+                               FALSE);
+      cairo_destroy (cr);
+
+      cairo_surface_flush (surface);
     }
 
-  cr = cairo_create (surface);
-  gimp_text_layout_render (layout, cr, layer->text->base_dir, FALSE);
-  cairo_destroy (cr);
+  dest_buffer = gimp_drawable_get_buffer (drawable);
+  transform   = gimp_image_get_color_transform_from_srgb_u8 (image);
 
-  cairo_surface_flush (surface);
+  /*  if the drawable still holds our last rendering, made with the
+   *  same color transform, only convert and update the pixels that
+   *  differ from it.  While typing, that's usually a single line.
+   */
+  if (private->render_surface                 &&
+      private->render_buffer    == dest_buffer &&
+      private->render_transform == transform)
+    {
+      if (! gimp_text_layer_get_dirty_rect (private->render_surface,
+                                            surface, &rect))
+        {
+          cairo_surface_destroy (surface);
+          return;
+        }
+    }
+  else
+    {
+      rect.x      = 0;
+      rect.y      = 0;
+      rect.width  = width;
+      rect.height = height;
+    }
 
   buffer = gimp_cairo_surface_create_buffer (surface);
 
-  transform = gimp_image_get_color_transform_from_srgb_u8 (image);
-
   if (transform)
     {
       gimp_color_transform_process_buffer (transform,
                                            buffer,
-                                           NULL,
-                                           gimp_drawable_get_buffer (drawable),
-                                           NULL);
+                                           &rect,
+                                           dest_buffer,
+                                           &rect);
     }
   else
     {
-      gegl_buffer_copy (buffer, NULL, GEGL_ABYSS_NONE,
-                        gimp_drawable_get_buffer (drawable), NULL);
+      gegl_buffer_copy (buffer,      &rect, GEGL_ABYSS_NONE,
+                        dest_buffer, &rect);
     }
 
   g_object_unref (buffer);
-  cairo_surface_destroy (surface);
 
-  gimp_drawable_update (drawable, 0, 0, width, height);
+  gimp_text_layer_clear_render_cache (layer);
+
+  private->render_surface   = surface;
+  private->render_buffer    = dest_buffer;
+  private->render_transform = transform ? g_object_ref (transform) : NULL;
+
+  gimp_drawable_update (drawable, rect.x, rect.y, rect.width, rect.height);
+}
+
+static GimpTextLayerRender *
+gimp_text_layer_render_new (GimpTextLayer *layer)
+{
+  GimpTextLayerRender *render = g_slice_new0 (GimpTextLayerRender);
+  GimpImage           *image  = gimp_item_get_image (GIMP_ITEM (layer));
+
+  render->layer = layer;
+  render->text  = g_object_ref (layer->text);
+
+  gimp_image_get_resolution (image, &render->xres, &render->yres);
+
+  return render;
+}
+
+/*  must not touch anything but @render, it runs on worker threads
+ *  from gimp_text_layers_prepare_render()
+ */
+static void
+gimp_text_layer_render_run (GimpTextLayerRender *render)
+{
+  render->layout = gimp_text_layout_new (render->text,
+                                         render->xres, render->yres,
+                                         &render->error);
+
+  render->has_size = gimp_text_layout_get_size (render->layout,
+                                                &render->width,
+                                                &render->height);
+
+  if (render->has_size && render->width > 0 && render->height > 0)
+    {
+      cairo_surface_t *surface;
+
+      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                            render->width, render->height);
+
+      /*  failure is reported when the layer is rendered  */
+      if (cairo_surface_status (surface) == CAIRO_STATUS_SUCCESS)
+        {
+          cairo_t *cr = cairo_create (surface);
+
+          gimp_text_layout_render (render->layout, cr,
+                                   render->text->base_dir, FALSE);
+          cairo_destroy (cr);
+
+          cairo_surface_flush (surface);
+
+          render->surface = surface;
+        }
+      else
+        {
+          cairo_surface_destroy (surface);
+        }
+    }
+}
+
+static void
+gimp_text_layer_render_free (GimpTextLayerRender *render)
+{
+  g_clear_object (&render->layout);
+  g_clear_object (&render->text);
+  g_clear_pointer (&render->surface, cairo_surface_destroy);
+  g_clear_error (&render->error);
+
+  g_slice_free (GimpTextLayerRender, render);
+}
+
+static void
+gimp_text_layer_clear_render_cache (GimpTextLayer *layer)
+{
+  GimpTextLayerPrivate *private = layer->private;
+
+  g_clear_pointer (&private->render_surface, cairo_surface_destroy);
+  g_clear_object (&private->render_transform);
+
+  /*  only used for comparison, not referenced  */
+  private->render_buffer = NULL;
+}
+
+static gboolean
+gimp_text_layer_get_dirty_rect (cairo_surface_t *old_surface,
+                                cairo_surface_t *new_surface,
+                                GeglRectangle   *rect)
+{
+  const guchar *old_data = cairo_image_surface_get_data (old_surface);
+  const guchar *new_data = cairo_image_surface_get_data (new_surface);
+  gint          stride   = cairo_image_surface_get_stride (new_surface);
+  gint          width    = cairo_image_surface_get_width  (new_surface);
+  gint          height   = cairo_image_surface_get_height (new_surface);
+  gint          x1       = width;
+  gint          y1       = height;
+  gint          x2       = 0;
+  gint          y2       = 0;
+  gint          y;
+
+  if (cairo_image_surface_get_width  (old_surface) != width  ||
+      cairo_image_surface_get_height (old_surface) != height ||
+      cairo_image_surface_get_stride (old_surface) != stride)
+    {
+      rect->x      = 0;
+      rect->y      = 0;
+      rect->width  = width;
+      rect->height = height;
+
+      return TRUE;
+    }
+
+  for (y = 0; y < height; y++)
+    {
+      const guint32 *old_row = (const guint32 *) (old_data + y * stride);
+      const guint32 *new_row = (const guint32 *) (new_data + y * stride);
+      gint           x;
+
+      if (! memcmp (old_row, new_row, width * 4))
+        continue;
+
+      for (x = 0; x < x1; x++)
+        if (old_row[x] != new_row[x])
+          {
+            x1 = x;
+            break;
+          }
+
+      for (x = width - 1; x >= x2; x--)
+        if (old_row[x] != new_row[x])
+          {
+            x2 = x + 1;
+            break;
+          }
+
+      y1 = MIN (y1, y);
+      y2 = y + 1;
+    }
+
+  if (y1 >= y2)
+    return FALSE;
+
+  rect->x      = x1;
+  rect->y      = y1;
+  rect->width  = x2 - x1;
+  rect->height = y2 - y1;
+
+  return TRUE;
 }
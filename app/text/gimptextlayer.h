@@ -33,11 +33,12 @@
 #define GIMP_TEXT_LAYER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIMP_TYPE_TEXT_LAYER, GimpTextLayerClass))
 
 
-typedef struct _GimpTextLayerClass GimpTextLayerClass;
+typedef struct _GimpTextLayerClass   GimpTextLayerClass;
+typedef struct _GimpTextLayerPrivate GimpTextLayerPrivate;
 
 struct _GimpTextLayer
 {
-  GimpLayer     layer;
+  GimpLayer             layer;
 
   GimpText     *text;
   const gchar  *text_parasite;  /*  parasite name that this text was set from,
@@ -48,6 +49,8 @@ struct _GimpTextLayer
   gboolean      modified;
 
   const Babl   *convert_format;
+
+  GimpTextLayerPrivate *private;
 };
 
 struct _GimpTextLayerClass
@@ -69,6 +72,9 @@ void        gimp_text_layer_set         (GimpTextLayer *layer,
                                          const gchar   *first_property_name,
                                          ...) G_GNUC_NULL_TERMINATED;
 
+void        gimp_text_layers_prepare_render
+                                        (GList         *items);
+
 gboolean    gimp_item_is_text_layer     (GimpItem      *item);
 
 
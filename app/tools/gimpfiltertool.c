@@ -157,6 +157,11 @@ static void      gimp_filter_tool_create_filter  (GimpFilterTool      *filter_to
 
 static void      gimp_filter_tool_flush          (GimpDrawableFilter  *filter,
                                                   GimpFilterTool      *filter_tool);
+
+static void      gimp_filter_tool_connect_shells (GimpFilterTool      *filter_tool);
+static void   gimp_filter_tool_disconnect_shells (GimpFilterTool      *filter_tool);
+static void   gimp_filter_tool_update_preview_area
+                                                 (GimpFilterTool      *filter_tool);
 static void      gimp_filter_tool_config_notify  (GObject             *object,
                                                   const GParamSpec    *pspec,
                                                   GimpFilterTool      *filter_tool);
@@ -942,6 +947,8 @@ gimp_filter_tool_halt (GimpFilterTool *filter_tool)
 
   if (filter_tool->filter)
     {
+      gimp_filter_tool_disconnect_shells (filter_tool);
+
       gimp_drawable_filter_abort (filter_tool->filter);
       g_clear_object (&filter_tool->filter);
 
@@ -985,6 +992,8 @@ gimp_filter_tool_commit (GimpFilterTool *filter_tool)
       if (! options->preview)
         gimp_drawable_filter_apply (filter_tool->filter, NULL);
 
+      gimp_filter_tool_disconnect_shells (filter_tool);
+
       gimp_tool_control_push_preserve (tool->control, TRUE);
 
       gimp_drawable_filter_commit (filter_tool->filter,
@@ -1047,6 +1056,8 @@ gimp_filter_tool_create_filter (GimpFilterTool *filter_tool)
 
   if (filter_tool->filter)
     {
+      gimp_filter_tool_disconnect_shells (filter_tool);
+
       gimp_drawable_filter_abort (filter_tool->filter);
       g_object_unref (filter_tool->filter);
     }
@@ -1069,6 +1080,8 @@ gimp_filter_tool_create_filter (GimpFilterTool *filter_tool)
                     G_CALLBACK (gimp_filter_tool_flush),
                     filter_tool);
 
+  gimp_filter_tool_connect_shells (filter_tool);
+
   gimp_gegl_progress_connect (filter_tool->operation,
                               GIMP_PROGRESS (filter_tool),
                               gimp_tool_get_undo_desc (tool));
@@ -1087,6 +1100,92 @@ gimp_filter_tool_flush (GimpDrawableFilter *filter,
   gimp_projection_flush (gimp_image_get_projection (image));
 }
 
+/*  only the part of the drawable which is visible in one of the image's
+ *  displays is filtered while previewing, the rest is filtered when it
+ *  is scrolled into view, or when the filter is committed
+ */
+static void
+gimp_filter_tool_connect_shells (GimpFilterTool *filter_tool)
+{
+  GimpTool  *tool  = GIMP_TOOL (filter_tool);
+  GimpImage *image = gimp_display_get_image (tool->display);
+  GList     *list;
+
+  for (list = gimp_get_display_iter (image->gimp);
+       list;
+       list = g_list_next (list))
+    {
+      GimpDisplay *display = list->data;
+
+      if (gimp_display_get_image (display) == image)
+        {
+          GimpDisplayShell *shell = gimp_display_get_shell (display);
+
+          g_signal_connect_object (shell, "scaled",
+                                   G_CALLBACK (gimp_filter_tool_update_preview_area),
+                                   filter_tool, G_CONNECT_SWAPPED);
+          g_signal_connect_object (shell, "scrolled",
+                                   G_CALLBACK (gimp_filter_tool_update_preview_area),
+                                   filter_tool, G_CONNECT_SWAPPED);
+          g_signal_connect_object (shell, "rotated",
+                                   G_CALLBACK (gimp_filter_tool_update_preview_area),
+                                   filter_tool, G_CONNECT_SWAPPED);
+        }
+    }
+
+  gimp_filter_tool_update_preview_area (filter_tool);
+}
+
+static void
+gimp_filter_tool_disconnect_shells (GimpFilterTool *filter_tool)
+{
+  GimpTool *tool = GIMP_TOOL (filter_tool);
+  GList    *list;
+
+  for (list = gimp_get_display_iter (tool->tool_info->gimp);
+       list;
+       list = g_list_next (list))
+    {
+      GimpDisplayShell *shell = gimp_display_get_shell (list->data);
+
+      g_signal_handlers_disconnect_by_func (shell,
+                                            gimp_filter_tool_update_preview_area,
+                                            filter_tool);
+    }
+}
+
+static void
+gimp_filter_tool_update_preview_area (GimpFilterTool *filter_tool)
+{
+  GimpTool      *tool  = GIMP_TOOL (filter_tool);
+  GimpImage     *image = gimp_display_get_image (tool->display);
+  GeglRectangle  area  = { 0, };
+  GList         *list;
+
+  if (! filter_tool->filter)
+    return;
+
+  for (list = gimp_get_display_iter (image->gimp);
+       list;
+       list = g_list_next (list))
+    {
+      GimpDisplay *display = list->data;
+
+      if (gimp_display_get_image (display) == image)
+        {
+          GeglRectangle rect;
+
+          gimp_display_shell_untransform_viewport (gimp_display_get_shell (display),
+                                                   &rect.x, &rect.y,
+                                                   &rect.width, &rect.height);
+
+          gegl_rectangle_bounding_box (&area, &area, &rect);
+        }
+    }
+
+  gimp_drawable_filter_set_preview_area (filter_tool->filter, &area);
+}
+
 static void
 gimp_filter_tool_config_notify (GObject          *object,
                                 const GParamSpec *pspec,
@@ -1347,6 +1446,8 @@ gimp_filter_tool_get_operation (GimpFilterTool *filter_tool)
 
   if (filter_tool->filter)
     {
+      gimp_filter_tool_disconnect_shells (filter_tool);
+
       gimp_drawable_filter_abort (filter_tool->filter);
       g_clear_object (&filter_tool->filter);
 
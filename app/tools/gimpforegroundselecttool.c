@@ -61,6 +61,9 @@
 
 #define FAR_OUTSIDE -10000
 
+/*  previews of larger unknown regions are solved downscaled first  */
+#define PREVIEW_MAX_PIXELS (1024 * 1024)
+
 
 typedef struct _StrokeUndo StrokeUndo;
 
@@ -149,6 +152,10 @@ static void   gimp_foreground_select_tool_commit         (GimpForegroundSelectTo
 static void   gimp_foreground_select_tool_set_trimap     (GimpForegroundSelectTool *fg_select);
 static void   gimp_foreground_select_tool_set_preview    (GimpForegroundSelectTool *fg_select);
 static void   gimp_foreground_select_tool_preview        (GimpForegroundSelectTool *fg_select);
+static void   gimp_foreground_select_tool_extract        (GimpForegroundSelectTool *fg_select,
+                                                          gboolean                  coarse);
+static gboolean gimp_foreground_select_tool_refine_idle  (GimpForegroundSelectTool *fg_select);
+static void   gimp_foreground_select_tool_cancel_refine  (GimpForegroundSelectTool *fg_select);
 
 static void   gimp_foreground_select_tool_stroke_paint   (GimpForegroundSelectTool *fg_select);
 static void   gimp_foreground_select_tool_cancel_paint   (GimpForegroundSelectTool *fg_select);
@@ -263,6 +270,9 @@ gimp_foreground_select_tool_finalize (GObject *object)
   if (fg_select->mask)
     g_warning ("%s: mask should be NULL at this point", G_STRLOC);
 
+  if (fg_select->refine_idle_id)
+    g_warning ("%s: refine idle should be removed at this point", G_STRLOC);
+
   if (fg_select->trimap)
     g_warning ("%s: mask should be NULL at this point", G_STRLOC);
 
@@ -929,6 +939,8 @@ gimp_foreground_select_tool_halt (GimpForegroundSelectTool *fg_select)
 {
   GimpTool *tool = GIMP_TOOL (fg_select);
 
+  gimp_foreground_select_tool_cancel_refine (fg_select);
+
   g_clear_object (&fg_select->trimap);
   g_clear_object (&fg_select->mask);
 
@@ -980,8 +992,13 @@ gimp_foreground_select_tool_commit (GimpForegroundSelectTool *fg_select)
     {
       GimpImage *image = gimp_display_get_image (tool->display);
 
-      if (fg_select->state != MATTING_STATE_PREVIEW_MASK)
-        gimp_foreground_select_tool_preview (fg_select);
+      if (fg_select->state != MATTING_STATE_PREVIEW_MASK ||
+          fg_select->mask_is_coarse)
+        {
+          gimp_foreground_select_tool_cancel_refine (fg_select);
+
+          gimp_foreground_select_tool_extract (fg_select, FALSE);
+        }
 
       gimp_channel_select_buffer (gimp_image_get_mask (image),
                                   C_("command", "Foreground Select"),
@@ -1006,6 +1023,8 @@ gimp_foreground_select_tool_set_trimap (GimpForegroundSelectTool *fg_select)
 
   g_return_if_fail (fg_select->trimap != NULL);
 
+  gimp_foreground_select_tool_cancel_refine (fg_select);
+
   options = GIMP_FOREGROUND_SELECT_TOOL_GET_OPTIONS (tool);
 
   gimp_foreground_select_options_get_mask_color (options, &color);
@@ -1054,6 +1073,28 @@ gimp_foreground_select_tool_set_preview (GimpForegroundSelectTool *fg_select)
 
 static void
 gimp_foreground_select_tool_preview (GimpForegroundSelectTool *fg_select)
+{
+  gimp_foreground_select_tool_cancel_refine (fg_select);
+
+  /*  show a quick approximation first, and replace it by the full
+   *  resolution result once the main loop is idle again
+   */
+  gimp_foreground_select_tool_extract (fg_select, TRUE);
+
+  gimp_foreground_select_tool_set_preview (fg_select);
+
+  if (fg_select->mask_is_coarse)
+    {
+      fg_select->refine_idle_id =
+        g_idle_add_full (G_PRIORITY_LOW,
+                         (GSourceFunc) gimp_foreground_select_tool_refine_idle,
+                         fg_select, NULL);
+    }
+}
+
+static void
+gimp_foreground_select_tool_extract (GimpForegroundSelectTool *fg_select,
+                                     gboolean                  coarse)
 {
   GimpTool                    *tool     = GIMP_TOOL (fg_select);
   GimpForegroundSelectOptions *options;
@@ -1064,15 +1105,57 @@ gimp_foreground_select_tool_preview (GimpForegroundSelectTool *fg_select)
 
   g_clear_object (&fg_select->mask);
 
-  fg_select->mask = gimp_drawable_foreground_extract (drawable,
-                                                      options->engine,
-                                                      options->iterations,
-                                                      options->levels,
-                                                      options->active_levels,
-                                                      fg_select->trimap,
-                                                      GIMP_PROGRESS (fg_select));
+  if (coarse)
+    {
+      fg_select->mask =
+        gimp_drawable_foreground_extract_preview (drawable,
+                                                  options->engine,
+                                                  options->iterations,
+                                                  options->levels,
+                                                  options->active_levels,
+                                                  fg_select->trimap,
+                                                  PREVIEW_MAX_PIXELS,
+                                                  &fg_select->mask_is_coarse,
+                                                  GIMP_PROGRESS (fg_select));
+    }
+  else
+    {
+      fg_select->mask =
+        gimp_drawable_foreground_extract (drawable,
+                                          options->engine,
+                                          options->iterations,
+                                          options->levels,
+                                          options->active_levels,
+                                          fg_select->trimap,
+                                          GIMP_PROGRESS (fg_select));
+
+      fg_select->mask_is_coarse = FALSE;
+    }
+}
+
+static gboolean
+gimp_foreground_select_tool_refine_idle (GimpForegroundSelectTool *fg_select)
+{
+  fg_select->refine_idle_id = 0;
 
-  gimp_foreground_select_tool_set_preview (fg_select);
+  if (fg_select->state == MATTING_STATE_PREVIEW_MASK)
+    {
+      gimp_foreground_select_tool_extract (fg_select, FALSE);
+
+      gimp_foreground_select_tool_set_preview (fg_select);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_foreground_select_tool_cancel_refine (GimpForegroundSelectTool *fg_select)
+{
+  if (fg_select->refine_idle_id)
+    {
+      g_source_remove (fg_select->refine_idle_id);
+      fg_select->refine_idle_id = 0;
+    }
 }
 
 static void
@@ -54,6 +54,8 @@ struct _GimpForegroundSelectTool
   GArray             *stroke;
   GeglBuffer         *trimap;
   GeglBuffer         *mask;
+  gboolean            mask_is_coarse;
+  guint               refine_idle_id;
 
   GList              *undo_stack;
   GList              *redo_stack;
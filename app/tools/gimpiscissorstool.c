@@ -112,6 +112,18 @@ struct _ICurve
   gboolean  closed;
 };
 
+/*  a compact copy of the gradient map around a segment, which the
+ *  path search reads instead of sampling the map per pixel
+ */
+typedef struct
+{
+  guint8 *data;
+  gint    x;
+  gint    y;
+  gint    width;
+  gint    height;
+} GradientWindow;
+
 
 /*  local function prototypes  */
 
@@ -173,14 +185,22 @@ static void          iscissors_convert         (GimpIscissorsTool *iscissors,
                                                 GimpDisplay       *display);
 static GeglBuffer  * gradient_map_new          (GimpPickable      *pickable);
 
-static void          find_optimal_path         (GeglBuffer        *gradient_map,
-                                                GimpTempBuf       *dp_buf,
+static void          gradient_window_init      (GradientWindow    *window,
+                                                GeglBuffer        *gradient_map,
                                                 gint               x1,
                                                 gint               y1,
                                                 gint               x2,
-                                                gint               y2,
-                                                gint               xs,
-                                                gint               ys);
+                                                gint               y2);
+static void          gradient_window_clear     (GradientWindow    *window);
+
+static void          find_optimal_path         (const GradientWindow *window,
+                                                GimpTempBuf          *dp_buf,
+                                                gint                  x1,
+                                                gint                  y1,
+                                                gint                  x2,
+                                                gint                  y2,
+                                                gint                  xs,
+                                                gint                  ys);
 static void          find_max_gradient         (GimpIscissorsTool *iscissors,
                                                 GimpPickable      *pickable,
                                                 gint              *x,
@@ -1528,17 +1548,23 @@ calculate_segment (GimpIscissorsTool *iscissors,
     {
       /*  If the bounding box has width and height...  */
 
-      GimpTempBuf *dp_buf; /*  dynamic programming buffer  */
-      gint         dp_width  = (x2 - x1);
-      gint         dp_height = (y2 - y1);
+      GimpTempBuf    *dp_buf; /*  dynamic programming buffer  */
+      GradientWindow  window;
+      gint            dp_width  = (x2 - x1);
+      gint            dp_height = (y2 - y1);
 
       dp_buf = gimp_temp_buf_new (dp_width, dp_height,
                                   babl_format ("Y u32"));
 
+      gradient_window_init (&window, iscissors->gradient_map,
+                            x1, y1, x2, y2);
+
       /*  find the optimal path of pixels from (x1, y1) to (x2, y2)  */
-      find_optimal_path (iscissors->gradient_map, dp_buf,
+      find_optimal_path (&window, dp_buf,
                          x1, y1, x2, y2, xs, ys);
 
+      gradient_window_clear (&window);
+
       /*  get a list of the pixels in the optimal path  */
       segment->points = plot_pixels (dp_buf, x1, y1, xs, ys, xe, ye);
 
@@ -1577,52 +1603,92 @@ calculate_segment (GimpIscissorsTool *iscissors,
 }
 
 
-/* badly need to get a replacement - this is _way_ too expensive */
-static gboolean
-gradient_map_value (GeglBuffer *map,
-                    gint        x,
-                    gint        y,
-                    guint8     *grad,
-                    guint8     *dir)
+/*  fetches the gradient map of (x1, y1) - (x2, y2), and a border of
+ *  one pixel, computing all of its missing tiles in parallel first.
+ *  pixels outside of the map are directionless and have no gradient.
+ */
+static void
+gradient_window_init (GradientWindow *window,
+                      GeglBuffer     *gradient_map,
+                      gint            x1,
+                      gint            y1,
+                      gint            x2,
+                      gint            y2)
 {
-  const GeglRectangle *extents;
+  GimpTileHandlerValidate *handler;
+  GeglRectangle            rect;
+  GeglRectangle            area;
+  gint                     i;
+
+  rect.x      = x1 - 1;
+  rect.y      = y1 - 1;
+  rect.width  = x2 - x1 + 2;
+  rect.height = y2 - y1 + 2;
+
+  window->x      = rect.x;
+  window->y      = rect.y;
+  window->width  = rect.width;
+  window->height = rect.height;
+  window->data   = g_new (guint8, rect.width * rect.height * COST_WIDTH);
+
+  for (i = 0; i < rect.width * rect.height; i++)
+    {
+      window->data[i * COST_WIDTH + 0] = 0;
+      window->data[i * COST_WIDTH + 1] = 255;
+    }
 
-  extents = gegl_buffer_get_extent (map);
+  if (! gegl_rectangle_intersect (&area, &rect,
+                                  gegl_buffer_get_extent (gradient_map)))
+    return;
 
-  if (x >= extents->x     &&
-      y >= extents->y     &&
-      x <  extents->width &&
-      y <  extents->height)
-    {
-      guint8 sample[2];
+  handler = gimp_tile_handler_validate_get_assigned (gradient_map);
 
-      gegl_buffer_sample (map, x, y, NULL, sample, NULL,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+  if (handler)
+    gimp_tile_handler_iscissors_prepare (GIMP_TILE_HANDLER_ISCISSORS (handler),
+                                         gradient_map, &area);
 
-      *grad = sample[0];
-      *dir  = sample[1];
+  gegl_buffer_get (gradient_map, &area, 1.0,
+                   gegl_buffer_get_format (gradient_map),
+                   window->data +
+                   ((area.y - rect.y) * rect.width +
+                    (area.x - rect.x)) * COST_WIDTH,
+                   rect.width * COST_WIDTH,
+                   GEGL_ABYSS_NONE);
+}
 
-      return TRUE;
-    }
+static void
+gradient_window_clear (GradientWindow *window)
+{
+  g_clear_pointer (&window->data, g_free);
+}
 
-  return FALSE;
+static inline void
+gradient_window_value (const GradientWindow *window,
+                       gint                  x,
+                       gint                  y,
+                       guint8               *grad,
+                       guint8               *dir)
+{
+  const guint8 *sample;
+
+  sample = window->data +
+           ((y - window->y) * window->width + (x - window->x)) * COST_WIDTH;
+
+  *grad = sample[0];
+  *dir  = sample[1];
 }
 
 static gint
-calculate_link (GeglBuffer *gradient_map,
-                gint        x,
-                gint        y,
-                guint32     pixel,
-                gint        link)
+calculate_link (const GradientWindow *window,
+                gint                  x,
+                gint                  y,
+                guint32               pixel,
+                gint                  link)
 {
   gint   value = 0;
   guint8 grad1, dir1, grad2, dir2;
 
-  if (! gradient_map_value (gradient_map, x, y, &grad1, &dir1))
-    {
-      grad1 = 0;
-      dir1 = 255;
-    }
+  gradient_window_value (window, x, y, &grad1, &dir1);
 
   /* Convert the gradient into a cost: large gradients are good, and
    * so have low cost. */
@@ -1638,11 +1704,7 @@ calculate_link (GeglBuffer *gradient_map,
   x += (gint8)(pixel & 0xff);
   y += (gint8)((pixel & 0xff00) >> 8);
 
-  if (! gradient_map_value (gradient_map, x, y, &grad2, &dir2))
-    {
-      grad2 = 0;
-      dir2 = 255;
-    }
+  gradient_window_value (window, x, y, &grad2, &dir2);
 
   value +=
     (direction_value[dir1][link] + direction_value[dir2][link]) * OMEGA_D;
@@ -1700,14 +1762,14 @@ plot_pixels (GimpTempBuf *dp_buf,
                        gimp_temp_buf_get_width (dp_buf))
 
 static void
-find_optimal_path (GeglBuffer  *gradient_map,
-                   GimpTempBuf *dp_buf,
-                   gint         x1,
-                   gint         y1,
-                   gint         x2,
-                   gint         y2,
-                   gint         xs,
-                   gint         ys)
+find_optimal_path (const GradientWindow *window,
+                   GimpTempBuf          *dp_buf,
+                   gint                  x1,
+                   gint                  y1,
+                   gint                  x2,
+                   gint                  y2,
+                   gint                  xs,
+                   gint                  ys)
 {
   gint     i, j, k;
   gint     x, y;
@@ -1780,7 +1842,7 @@ find_optimal_path (GeglBuffer  *gradient_map,
           for (k = 0; k < 8; k ++)
             if (pixel[k])
               {
-                link_cost[k] = calculate_link (gradient_map,
+                link_cost[k] = calculate_link (window,
                                                xs + j*dirx, ys + i*diry,
                                                pixel [k],
                                                ((k > 3) ? k - 4 : k));
@@ -25,6 +25,7 @@
 #include <gdk/gdkkeysyms.h>
 
 #include <npd/npd_common.h>
+#include <npd/deformation.h>
 
 #include "libgimpmath/gimpmath.h"
 #include "libgimpwidgets/gimpwidgets.h"
@@ -282,14 +283,19 @@ gimp_n_point_deformation_tool_start (GimpNPointDeformationTool *npd_tool,
   gegl_node_process (npd_tool->npd_node);
   gegl_node_get (npd_tool->npd_node, "model", &model, NULL);
 
+  /* from now on, the model is deformed by the deformation thread, and
+   * the node only renders it
+   */
+  gegl_node_set (npd_tool->npd_node, "rigidity", 0, NULL);
+
   npd_tool->model          = model;
   npd_tool->preview_buffer = preview_buffer;
   npd_tool->selected_cp    = NULL;
   npd_tool->hovering_cp    = NULL;
   npd_tool->selected_cps   = NULL;
   npd_tool->rubber_band    = FALSE;
-  npd_tool->lattice_points = g_new (GimpVector2,
-                                    5 * model->hidden_model->num_of_bones);
+  npd_tool->lattice_points = g_new0 (GimpVector2,
+                                     5 * model->hidden_model->num_of_bones);
 
   gimp_item_get_offset (GIMP_ITEM (tool->drawable),
                         &npd_tool->offset_x, &npd_tool->offset_y);
@@ -383,13 +389,18 @@ static void
 gimp_n_point_deformation_tool_set_options (GimpNPointDeformationTool    *npd_tool,
                                            GimpNPointDeformationOptions *npd_options)
 {
+  /* the rigidity is used by the deformation thread, the node only
+   * renders the model
+   */
   gegl_node_set (npd_tool->npd_node,
                  "square-size",       (gint) npd_options->square_size,
-                 "rigidity",          (gint) npd_options->rigidity,
+                 "rigidity",          0,
                  "asap-deformation",  npd_options->asap_deformation,
                  "mls-weights",       npd_options->mls_weights,
                  "mls-weights-alpha", npd_options->mls_weights_alpha,
                  NULL);
+
+  npd_tool->render_pending = TRUE;
 }
 
 static void
@@ -724,11 +735,13 @@ gimp_n_point_deformation_tool_oper_update (GimpTool         *tool,
   gimp_draw_tool_resume (draw_tool);
 }
 
-static void
+/*  Returns TRUE if the lattice changed since it was last prepared  */
+static gboolean
 gimp_n_point_deformation_tool_prepare_lattice (GimpNPointDeformationTool *npd_tool)
 {
-  NPDHiddenModel *hm     = npd_tool->model->hidden_model;
-  GimpVector2    *points = npd_tool->lattice_points;
+  NPDHiddenModel *hm      = npd_tool->model->hidden_model;
+  GimpVector2    *points  = npd_tool->lattice_points;
+  gboolean        changed = FALSE;
   gint            i, j;
 
   for (i = 0; i < hm->num_of_bones; i++)
@@ -736,9 +749,20 @@ gimp_n_point_deformation_tool_prepare_lattice (GimpNPointDeformationTool *npd_to
       NPDBone *bone = &hm->current_bones[i];
 
       for (j = 0; j < 4; j++)
-        gimp_vector2_set (&points[5 * i + j], bone->points[j].x, bone->points[j].y);
+        {
+          if (points[5 * i + j].x != bone->points[j].x ||
+              points[5 * i + j].y != bone->points[j].y)
+            {
+              gimp_vector2_set (&points[5 * i + j],
+                                bone->points[j].x, bone->points[j].y);
+              changed = TRUE;
+            }
+        }
+
       gimp_vector2_set (&points[5 * i + j], bone->points[0].x, bone->points[0].y);
     }
+
+  return changed;
 }
 
 static void
@@ -916,10 +940,18 @@ gimp_n_point_deformation_tool_deform_thread_func (gpointer data)
     {
       start = g_get_monotonic_time ();
 
-      gimp_n_point_deformation_tool_perform_deformation (npd_tool);
+      npd_deform_model (npd_tool->model, npd_options->rigidity);
 
-      if (npd_options->mesh_visible)
-        gimp_n_point_deformation_tool_prepare_lattice (npd_tool);
+      /* render the preview only if the model changed, all iterations
+       * since the last pass are rendered at once
+       */
+      if (gimp_n_point_deformation_tool_prepare_lattice (npd_tool) ||
+          npd_tool->render_pending)
+        {
+          npd_tool->render_pending = FALSE;
+
+          gimp_n_point_deformation_tool_perform_deformation (npd_tool);
+        }
 
       duration = g_get_monotonic_time () - start;
       if (duration < GIMP_NPD_MAXIMUM_DEFORMATION_DELAY)
@@ -982,7 +1014,7 @@ gimp_n_point_deformation_tool_apply_deformation (GimpNPointDeformationTool *npd_
   GimpNPointDeformationOptions *npd_options;
   GeglBuffer                   *buffer;
   GimpImage                    *image;
-  gint                          width, height, prev;
+  gint                          width, height;
 
   npd_options = GIMP_N_POINT_DEFORMATION_TOOL_GET_OPTIONS (npd_tool);
 
@@ -992,10 +1024,7 @@ gimp_n_point_deformation_tool_apply_deformation (GimpNPointDeformationTool *npd_
   width  = gegl_buffer_get_width  (buffer);
   height = gegl_buffer_get_height (buffer);
 
-  prev = npd_options->rigidity;
-  npd_options->rigidity = 0;
   gimp_n_point_deformation_tool_set_options (npd_tool, npd_options);
-  npd_options->rigidity = prev;
 
   gimp_drawable_push_undo (tool->drawable, _("N-Point Deformation"), NULL,
                            0, 0, width, height);
@@ -78,6 +78,7 @@ struct _GimpNPointDeformationTool
 
   gboolean          active;
   volatile gboolean deformation_active;
+  volatile gboolean render_pending;
   gboolean          rubber_band;
 };
 
@@ -757,6 +757,8 @@ gimp_seamless_clone_tool_create_filter (GimpSeamlessCloneTool *sc,
   g_signal_connect (sc->filter, "flush",
                     G_CALLBACK (gimp_seamless_clone_tool_filter_flush),
                     sc);
+
+  gegl_rectangle_set (&sc->rendered_area, 0, 0, 0, 0);
 }
 
 static void
@@ -778,6 +780,8 @@ gimp_seamless_clone_tool_filter_update (GimpSeamlessCloneTool *sc)
   gint              w, h;
   gint              off_x, off_y;
   GeglRectangle     visible;
+  GeglRectangle     paste_area;
+  GeglRectangle     update_area;
   GeglOperation    *op = NULL;
 
   GimpProgress     *progress;
@@ -814,20 +818,40 @@ gimp_seamless_clone_tool_filter_update (GimpSeamlessCloneTool *sc)
   visible.x -= off_x;
   visible.y -= off_y;
 
+  /* Outside of the paste, the output is the unchanged drawable, so
+   * only the areas covered by the previous and the current paste
+   * need to be rendered again
+   */
+  gegl_rectangle_set (&paste_area,
+                      sc->xoff - off_x, sc->yoff - off_y,
+                      sc->width,        sc->height);
+
+  gegl_rectangle_bounding_box (&update_area, &sc->rendered_area, &paste_area);
+
+  sc->rendered_area = paste_area;
+
+  if (! gegl_rectangle_intersect (&update_area, &update_area, &visible))
+    {
+      if (progress)
+        gimp_progress_end (progress);
+
+      return;
+    }
+
   g_object_get (sc->sc_node, "gegl-operation", &op, NULL);
-  /* If any cache of the visible area was present, clear it!
+  /* If any cache of the updated area was present, clear it!
    * We need to clear the cache in the sc_node, since that is
    * where the previous paste was located
    */
-  gegl_operation_invalidate (op, &visible, TRUE);
+  gegl_operation_invalidate (op, &update_area, TRUE);
   g_object_unref (op);
 
   /* Now update the image map and show this area */
-  gimp_drawable_filter_apply (sc->filter, NULL);
+  gimp_drawable_filter_apply (sc->filter, &update_area);
 
   /* Show update progress. */
   output = gegl_node_get_output_proxy (sc->render_node, "output");
-  processor = gegl_node_new_processor (output, NULL);
+  processor = gegl_node_new_processor (output, &update_area);
 
   while (gegl_processor_work (processor, &value))
     {
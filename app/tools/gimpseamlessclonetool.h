@@ -65,6 +65,10 @@ struct _GimpSeamlessCloneTool
   gint xoff, yoff;                /* The current offset of the paste */
   gint xoff_p, yoff_p;            /* The previous offset of the paste */
 
+  GeglRectangle rendered_area;    /* The area of the drawable covered
+                                   * by the last rendered paste, which
+                                   * has to be restored when it moves */
+
   gdouble xclick, yclick;         /* The image location of the last
                                    * mouse click. To be used when the
                                    * mouse is in motion, to recalculate
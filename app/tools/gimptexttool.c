@@ -42,6 +42,7 @@
 #include "core/gimptoolinfo.h"
 #include "core/gimpundostack.h"
 
+#include "text/gimp-fonts.h"
 #include "text/gimptext.h"
 #include "text/gimptext-vectors.h"
 #include "text/gimptextlayer.h"
@@ -1811,6 +1812,8 @@ gimp_text_tool_ensure_layout (GimpTextTool *text_tool)
 
       gimp_image_get_resolution (image, &xres, &yres);
 
+      gimp_fonts_wait (image->gimp);
+
       text_tool->layout = gimp_text_layout_new (text_tool->layer->text,
                                                 xres, yres, &error);
       if (error)
@@ -28,6 +28,7 @@
 
 #include "gegl/gimp-gegl-loops.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimppickable.h"
 
 #include "gimptilehandleriscissors.h"
@@ -40,6 +41,16 @@ enum
 };
 
 
+typedef struct
+{
+  GeglBuffer          *src;
+  const GeglRectangle *tiles;
+  gint                 n_tiles;
+  guint8             **data;
+  gint                 stride;
+} PrepareData;
+
+
 static void   gimp_tile_handler_iscissors_finalize     (GObject         *object);
 static void   gimp_tile_handler_iscissors_set_property (GObject         *object,
                                                         guint            property_id,
@@ -52,10 +63,19 @@ static void   gimp_tile_handler_iscissors_get_property (GObject         *object,
 
 static void   gimp_tile_handler_iscissors_validate     (GimpTileHandlerValidate *validate,
                                                         const GeglRectangle     *rect,
+                                                        gdouble                  scale,
                                                         const Babl              *format,
                                                         gpointer                 dest_buf,
                                                         gint                     dest_stride);
 
+static void   gimp_tile_handler_iscissors_compute      (GeglBuffer              *src,
+                                                        const GeglRectangle     *rect,
+                                                        gpointer                 dest_buf,
+                                                        gint                     dest_stride);
+static void   gimp_tile_handler_iscissors_prepare_tile (gint                     i,
+                                                        gint                     n,
+                                                        PrepareData             *data);
+
 
 G_DEFINE_TYPE (GimpTileHandlerIscissors, gimp_tile_handler_iscissors,
                GIMP_TYPE_TILE_HANDLER_VALIDATE)
@@ -171,22 +191,12 @@ static const gfloat blur_32[9] =
 static void
 gimp_tile_handler_iscissors_validate (GimpTileHandlerValidate *validate,
                                       const GeglRectangle     *rect,
+                                      gdouble                  scale,
                                       const Babl              *format,
                                       gpointer                 dest_buf,
                                       gint                     dest_stride)
 {
   GimpTileHandlerIscissors *iscissors = GIMP_TILE_HANDLER_ISCISSORS (validate);
-  GeglBuffer               *src;
-  GeglBuffer               *temp0;
-  GeglBuffer               *temp1;
-  GeglBuffer               *temp2;
-  gint                      stride1;
-  gint                      stride2;
-  gint                      i, j;
-
-  /*  temporary convolution buffers --  */
-  guchar *maxgrad_conv1;
-  guchar *maxgrad_conv2;
 
 #if 0
   g_printerr ("validating at %d %d %d %d\n",
@@ -198,7 +208,30 @@ gimp_tile_handler_iscissors_validate (GimpTileHandlerValidate *validate,
 
   gimp_pickable_flush (iscissors->pickable);
 
-  src = gimp_pickable_get_buffer (iscissors->pickable);
+  gimp_tile_handler_iscissors_compute (gimp_pickable_get_buffer (iscissors->pickable),
+                                       rect, dest_buf, dest_stride);
+}
+
+/*  computes the gradient map of @rect from @src.  it only touches
+ *  @src and its own temporary buffers, so it can run on any thread
+ *  as long as @src isn't validated lazily.
+ */
+static void
+gimp_tile_handler_iscissors_compute (GeglBuffer          *src,
+                                     const GeglRectangle *rect,
+                                     gpointer             dest_buf,
+                                     gint                 dest_stride)
+{
+  GeglBuffer *temp0;
+  GeglBuffer *temp1;
+  GeglBuffer *temp2;
+  gint        stride1;
+  gint        stride2;
+  gint        i, j;
+
+  /*  temporary convolution buffers --  */
+  guchar *maxgrad_conv1;
+  guchar *maxgrad_conv2;
 
   temp0 = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
                                            rect->width,
@@ -329,3 +362,147 @@ gimp_tile_handler_iscissors_new (GimpPickable *pickable)
                        "pickable",   pickable,
                        NULL);
 }
+
+/**
+ * gimp_tile_handler_iscissors_prepare:
+ * @iscissors: the #GimpTileHandlerIscissors assigned to @buffer
+ * @buffer:    the gradient map
+ * @rect:      the area that is about to be read
+ *
+ * Computes all invalid gradient map tiles intersecting @rect at once.
+ * The source pixels are read on the calling thread, and the tiles'
+ * gradients are then computed in parallel, instead of one by one as
+ * they are accessed.
+ */
+void
+gimp_tile_handler_iscissors_prepare (GimpTileHandlerIscissors *iscissors,
+                                     GeglBuffer               *buffer,
+                                     const GeglRectangle      *rect)
+{
+  GimpTileHandlerValidate *validate;
+  GeglRectangle            area;
+  GArray                  *tiles;
+  gint                     tile_x1, tile_x2;
+  gint                     tile_y1, tile_y2;
+  gint                     tile_x, tile_y;
+
+  g_return_if_fail (GIMP_IS_TILE_HANDLER_ISCISSORS (iscissors));
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (rect != NULL);
+
+  validate = GIMP_TILE_HANDLER_VALIDATE (iscissors);
+
+  if (cairo_region_is_empty (validate->dirty_region) ||
+      ! gegl_rectangle_intersect (&area, rect, gegl_buffer_get_extent (buffer)))
+    {
+      return;
+    }
+
+  tile_x1 = area.x / validate->tile_width;
+  tile_y1 = area.y / validate->tile_height;
+  tile_x2 = (area.x + area.width  - 1) / validate->tile_width  + 1;
+  tile_y2 = (area.y + area.height - 1) / validate->tile_height + 1;
+
+  tiles = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
+
+  for (tile_y = tile_y1; tile_y < tile_y2; tile_y++)
+    {
+      for (tile_x = tile_x1; tile_x < tile_x2; tile_x++)
+        {
+          cairo_rectangle_int_t tile_rect;
+
+          tile_rect.x      = tile_x * validate->tile_width;
+          tile_rect.y      = tile_y * validate->tile_height;
+          tile_rect.width  = validate->tile_width;
+          tile_rect.height = validate->tile_height;
+
+          if (cairo_region_contains_rectangle (validate->dirty_region,
+                                               &tile_rect) !=
+              CAIRO_REGION_OVERLAP_OUT)
+            {
+              g_array_append_val (tiles, tile_rect);
+            }
+        }
+    }
+
+  if (tiles->len > 1)
+    {
+      const GeglRectangle *tile_rects = (const GeglRectangle *) tiles->data;
+      GeglBuffer          *src_buffer;
+      PrepareData          data;
+      GeglRectangle        src_rect;
+      guint                i;
+
+      /*  the source may itself be validated lazily, which must happen
+       *  on this thread, so copy the source of all the tiles first
+       */
+      gimp_pickable_flush (iscissors->pickable);
+
+      src_buffer = gimp_pickable_get_buffer (iscissors->pickable);
+
+      src_rect = tile_rects[0];
+
+      for (i = 1; i < tiles->len; i++)
+        gegl_rectangle_bounding_box (&src_rect, &src_rect, &tile_rects[i]);
+
+      data.src = gegl_buffer_new (&src_rect,
+                                  gegl_buffer_get_format (src_buffer));
+
+      gegl_buffer_copy (src_buffer, &src_rect, GEGL_ABYSS_NONE,
+                        data.src,   &src_rect);
+
+      data.tiles   = tile_rects;
+      data.n_tiles = tiles->len;
+      data.stride  = validate->tile_width * COST_WIDTH;
+      data.data    = g_new (guint8 *, tiles->len);
+
+      for (i = 0; i < tiles->len; i++)
+        data.data[i] = g_malloc (data.stride * validate->tile_height);
+
+      gimp_parallel_distribute (tiles->len,
+                                (GimpParallelDistributeFunc)
+                                gimp_tile_handler_iscissors_prepare_tile,
+                                &data);
+
+      for (i = 0; i < tiles->len; i++)
+        {
+          GeglRectangle dest_rect;
+
+          /*  mark the tile valid first, so that writing it doesn't
+           *  validate it
+           */
+          gimp_tile_handler_validate_undo_invalidate (validate,
+                                                      &tile_rects[i]);
+
+          gegl_rectangle_intersect (&dest_rect, &tile_rects[i],
+                                    gegl_buffer_get_extent (buffer));
+
+          gegl_buffer_set (buffer, &dest_rect, 0, validate->format,
+                           data.data[i] +
+                           (dest_rect.y - tile_rects[i].y) * data.stride +
+                           (dest_rect.x - tile_rects[i].x) * COST_WIDTH,
+                           data.stride);
+
+          g_free (data.data[i]);
+        }
+
+      g_free (data.data);
+      g_object_unref (data.src);
+    }
+
+  g_array_free (tiles, TRUE);
+}
+
+static void
+gimp_tile_handler_iscissors_prepare_tile (gint         i,
+                                          gint         n,
+                                          PrepareData *data)
+{
+  gint t;
+
+  for (t = i; t < data->n_tiles; t += n)
+    {
+      gimp_tile_handler_iscissors_compute (data->src, &data->tiles[t],
+                                           data->data[t], data->stride);
+    }
+}
@@ -53,7 +53,11 @@ struct _GimpTileHandlerIscissorsClass
 
 GType             gimp_tile_handler_iscissors_get_type (void) G_GNUC_CONST;
 
-GeglTileHandler * gimp_tile_handler_iscissors_new      (GimpPickable *pickable);
+GeglTileHandler * gimp_tile_handler_iscissors_new      (GimpPickable             *pickable);
+
+void              gimp_tile_handler_iscissors_prepare  (GimpTileHandlerIscissors *iscissors,
+                                                        GeglBuffer               *buffer,
+                                                        const GeglRectangle      *rect);
 
 
 #endif /* __GIMP_TILE_HANDLER_ISCISSORS_H__ */
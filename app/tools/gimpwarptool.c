@@ -54,6 +54,7 @@
 
 #define STROKE_TIMER_MAX_FPS 20
 #define PREVIEW_SAMPLER      GEGL_SAMPLER_NEAREST
+#define MAX_UNDO_STROKES     16
 
 
 static void       gimp_warp_tool_control            (GimpTool              *tool,
@@ -134,6 +135,7 @@ static void       gimp_warp_tool_add_op             (GimpWarpTool          *wt,
 static void       gimp_warp_tool_remove_op          (GimpWarpTool          *wt,
                                                      GeglNode              *op);
 static void       gimp_warp_tool_free_op            (GeglNode              *op);
+static void       gimp_warp_tool_collapse_strokes   (GimpWarpTool          *wt);
 
 static void       gimp_warp_tool_animate            (GimpWarpTool          *wt);
 
@@ -325,6 +327,8 @@ gimp_warp_tool_button_release (GimpTool              *tool,
           wt->redo_stack = NULL;
         }
 
+      gimp_warp_tool_collapse_strokes (wt);
+
       gimp_tool_push_status (tool, tool->display,
                              _("Press ENTER to commit the transform"));
     }
@@ -1056,6 +1060,66 @@ gimp_warp_tool_free_op (GeglNode *op)
   gegl_node_remove_child (parent, op);
 }
 
+/*  Bakes the oldest stroke into the coordinates buffer once there are
+ *  more than MAX_UNDO_STROKES strokes in the chain, so the chain, and
+ *  the amount of work needed to render it, doesn't grow with every
+ *  stroke.  Baked strokes can no longer be undone.
+ */
+static void
+gimp_warp_tool_collapse_strokes (GimpWarpTool *wt)
+{
+  GeglNode      *node;
+  GeglNode      *oldest    = NULL;
+  GeglNode      *consumer  = NULL;
+  GeglNode      *coords;
+  GeglRectangle  bbox;
+  gint           n_strokes = 0;
+
+  g_return_if_fail (GEGL_IS_NODE (wt->render_node));
+
+  for (node = gegl_node_get_producer (wt->render_node, "aux", NULL);
+       ! strcmp (gegl_node_get_operation (node), "gegl:warp");
+       node = gegl_node_get_producer (node, "input", NULL))
+    {
+      consumer = oldest;
+      oldest   = node;
+
+      n_strokes++;
+    }
+
+  if (n_strokes <= MAX_UNDO_STROKES)
+    return;
+
+  bbox = gimp_warp_tool_get_stroke_bounds (oldest);
+
+  if (gegl_rectangle_intersect (&bbox, &bbox,
+                                gegl_buffer_get_extent (wt->coords_buffer)))
+    {
+      GeglBuffer *buffer;
+
+      /*  render into a separate buffer first, the stroke reads from
+       *  the coordinates buffer
+       */
+      buffer = gegl_buffer_new (&bbox,
+                                gegl_buffer_get_format (wt->coords_buffer));
+
+      gegl_node_blit_buffer (oldest, buffer, &bbox, 0, GEGL_ABYSS_NONE);
+
+      gegl_buffer_copy (buffer,            &bbox, GEGL_ABYSS_NONE,
+                        wt->coords_buffer, &bbox);
+
+      g_object_unref (buffer);
+    }
+
+  coords = gegl_node_get_producer (oldest, "input", NULL);
+
+  gegl_node_disconnect (oldest,   "input");
+  gegl_node_connect_to (coords,   "output",
+                        consumer, "input");
+
+  gegl_node_remove_child (wt->graph, oldest);
+}
+
 static void
 gimp_warp_tool_animate (GimpWarpTool *wt)
 {
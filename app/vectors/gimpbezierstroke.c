@@ -54,6 +54,9 @@ static gdouble
                                             GimpCoords            *ret_point,
                                             gdouble               *ret_pos,
                                             gint                   depth);
+static gdouble
+    gimp_bezier_stroke_segment_min_dist    (const GimpCoords      *beziercoords,
+                                            const GimpCoords      *coord);
 static gdouble
     gimp_bezier_stroke_nearest_tangent_get (GimpStroke            *stroke,
                                             const GimpCoords      *coord1,
@@ -600,12 +603,23 @@ gimp_bezier_stroke_nearest_point_get (GimpStroke        *stroke,
       if (count == 4)
         {
           segment_end = anchorlist->data;
-          dist = gimp_bezier_stroke_segment_nearest_point_get (segmentcoords,
-                                                               coord, precision,
-                                                               &point, &pos,
-                                                               10);
 
-          if (dist < min_dist || min_dist < 0)
+          /*  a segment lies within the bounds of its control points,
+           *  don't subdivide it if they are farther away than the
+           *  nearest point found so far
+           */
+          if (min_dist >= 0 &&
+              gimp_bezier_stroke_segment_min_dist (segmentcoords,
+                                                   coord) >= min_dist)
+            dist = -1;
+          else
+            dist = gimp_bezier_stroke_segment_nearest_point_get (segmentcoords,
+                                                                 coord,
+                                                                 precision,
+                                                                 &point, &pos,
+                                                                 10);
+
+          if (dist >= 0 && (dist < min_dist || min_dist < 0))
             {
               min_dist = dist;
 
@@ -771,6 +785,14 @@ gimp_bezier_stroke_segment_nearest_point_get (const GimpCoords *beziercoords,
                                                         &point1, &pos1,
                                                         depth - 1);
 
+  /*  the second half can't win if its bounds are already farther away  */
+  if (gimp_bezier_stroke_segment_min_dist (&(subdivided[3]), coord) >= dist1)
+    {
+      *ret_point = point1;
+      *ret_pos = 0.5 * pos1;
+      return dist1;
+    }
+
   dist2 = gimp_bezier_stroke_segment_nearest_point_get (&(subdivided[3]),
                                                         coord, precision,
                                                         &point2, &pos2,
@@ -790,6 +812,35 @@ gimp_bezier_stroke_segment_nearest_point_get (const GimpCoords *beziercoords,
     }
 }
 
+/*  Returns a lower bound of the distance between coord and any point
+ *  of the segment, namely the distance to the bounding box of its
+ *  control points in the x/y plane.
+ */
+static gdouble
+gimp_bezier_stroke_segment_min_dist (const GimpCoords *beziercoords,
+                                     const GimpCoords *coord)
+{
+  gdouble x1, y1, x2, y2;
+  gdouble dx, dy;
+  gint    i;
+
+  x1 = x2 = beziercoords[0].x;
+  y1 = y2 = beziercoords[0].y;
+
+  for (i = 1; i < 4; i++)
+    {
+      x1 = MIN (x1, beziercoords[i].x);
+      y1 = MIN (y1, beziercoords[i].y);
+      x2 = MAX (x2, beziercoords[i].x);
+      y2 = MAX (y2, beziercoords[i].y);
+    }
+
+  dx = MAX (0.0, MAX (x1 - coord->x, coord->x - x2));
+  dy = MAX (0.0, MAX (y1 - coord->y, coord->y - y2));
+
+  return sqrt (dx * dx + dy * dy);
+}
+
 
 static gdouble
 gimp_bezier_stroke_nearest_tangent_get (GimpStroke        *stroke,
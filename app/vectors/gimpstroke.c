@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -44,6 +46,18 @@ enum
   PROP_CLOSED
 };
 
+struct _GimpStrokePrivate
+{
+  /*  the last result of gimp_stroke_interpolate(), and the anchors
+   *  it was computed from
+   */
+  GArray   *interpolated;
+  gdouble   interpolated_precision;
+  gboolean  interpolated_closed;
+  gboolean  interpolated_stroke_closed;
+  GArray   *interpolated_anchors;
+};
+
 /* Prototypes */
 
 static void    gimp_stroke_set_property              (GObject      *object,
@@ -59,6 +73,9 @@ static void    gimp_stroke_finalize                  (GObject      *object);
 static gint64  gimp_stroke_get_memsize               (GimpObject   *object,
                                                       gint64       *gui_size);
 
+static gboolean gimp_stroke_interpolated_anchors_equal
+                                                     (GimpStroke   *stroke);
+
 static GimpAnchor * gimp_stroke_real_anchor_get      (GimpStroke       *stroke,
                                                       const GimpCoords *coord);
 static GimpAnchor * gimp_stroke_real_anchor_get_next (GimpStroke       *stroke,
@@ -260,11 +277,17 @@ gimp_stroke_class_init (GimpStrokeClass *klass)
                                                          FALSE,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT_ONLY));
+
+  g_type_class_add_private (klass, sizeof (GimpStrokePrivate));
 }
 
 static void
 gimp_stroke_init (GimpStroke *stroke)
 {
+  stroke->private = G_TYPE_INSTANCE_GET_PRIVATE (stroke,
+                                                 GIMP_TYPE_STROKE,
+                                                 GimpStrokePrivate);
+
   stroke->anchors = g_queue_new ();
 }
 
@@ -340,6 +363,12 @@ gimp_stroke_finalize (GObject *object)
   g_queue_free_full (stroke->anchors, (GDestroyNotify) gimp_anchor_free);
   stroke->anchors = NULL;
 
+  if (stroke->private->interpolated)
+    {
+      g_array_free (stroke->private->interpolated,         TRUE);
+      g_array_free (stroke->private->interpolated_anchors, TRUE);
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -352,6 +381,14 @@ gimp_stroke_get_memsize (GimpObject *object,
 
   memsize += gimp_g_queue_get_memsize (stroke->anchors, sizeof (GimpAnchor));
 
+  if (stroke->private->interpolated)
+    {
+      memsize += (stroke->private->interpolated->len *
+                  sizeof (GimpCoords) +
+                  stroke->private->interpolated_anchors->len *
+                  sizeof (GimpAnchor));
+    }
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -958,10 +995,103 @@ gimp_stroke_interpolate (GimpStroke *stroke,
                          gdouble     precision,
                          gboolean   *ret_closed)
 {
+  GimpStrokePrivate *private;
+  GArray            *points;
+  gboolean           closed = FALSE;
+
   g_return_val_if_fail (GIMP_IS_STROKE (stroke), NULL);
 
-  return GIMP_STROKE_GET_CLASS (stroke)->interpolate (stroke, precision,
-                                                      ret_closed);
+  private = stroke->private;
+
+  /*  flattening curves is expensive, and complex paths are
+   *  interpolated over and over for the same anchors, e.g. for their
+   *  bounds or by gimp_stroke_get_point_at_dist().  Anchors are
+   *  modified in many places, some of them outside of GimpStroke, so
+   *  the cached result is validated against a copy of them.
+   */
+  if (private->interpolated                          &&
+      private->interpolated_precision     == precision &&
+      private->interpolated_stroke_closed == stroke->closed &&
+      gimp_stroke_interpolated_anchors_equal (stroke))
+    {
+      points = g_array_sized_new (FALSE, FALSE, sizeof (GimpCoords),
+                                  private->interpolated->len);
+      g_array_append_vals (points,
+                           private->interpolated->data,
+                           private->interpolated->len);
+
+      if (ret_closed)
+        *ret_closed = private->interpolated_closed;
+
+      return points;
+    }
+
+  points = GIMP_STROKE_GET_CLASS (stroke)->interpolate (stroke, precision,
+                                                        &closed);
+
+  if (private->interpolated)
+    {
+      g_array_free (private->interpolated,         TRUE);
+      g_array_free (private->interpolated_anchors, TRUE);
+
+      private->interpolated         = NULL;
+      private->interpolated_anchors = NULL;
+    }
+
+  if (points)
+    {
+      GList *list;
+
+      private->interpolated = g_array_sized_new (FALSE, FALSE,
+                                                 sizeof (GimpCoords),
+                                                 points->len);
+      g_array_append_vals (private->interpolated, points->data, points->len);
+
+      private->interpolated_anchors =
+        g_array_sized_new (FALSE, FALSE, sizeof (GimpAnchor),
+                           g_queue_get_length (stroke->anchors));
+
+      for (list = stroke->anchors->head; list; list = g_list_next (list))
+        g_array_append_val (private->interpolated_anchors,
+                            *(GimpAnchor *) list->data);
+
+      private->interpolated_precision     = precision;
+      private->interpolated_closed        = closed;
+      private->interpolated_stroke_closed = stroke->closed;
+    }
+
+  if (ret_closed)
+    *ret_closed = closed;
+
+  return points;
+}
+
+static gboolean
+gimp_stroke_interpolated_anchors_equal (GimpStroke *stroke)
+{
+  GArray *anchors = stroke->private->interpolated_anchors;
+  GList  *list;
+  gint    i;
+
+  if (anchors->len != g_queue_get_length (stroke->anchors))
+    return FALSE;
+
+  for (list = stroke->anchors->head, i = 0;
+       list;
+       list = g_list_next (list), i++)
+    {
+      const GimpAnchor *anchor = list->data;
+      const GimpAnchor *cached = &g_array_index (anchors, GimpAnchor, i);
+
+      /*  the selection state doesn't affect the shape  */
+      if (anchor->type != cached->type ||
+          memcmp (&anchor->position, &cached->position, sizeof (GimpCoords)))
+        {
+          return FALSE;
+        }
+    }
+
+  return TRUE;
 }
 
 static GArray *
@@ -32,16 +32,19 @@
 #define GIMP_STROKE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIMP_TYPE_STROKE, GimpStrokeClass))
 
 
-typedef struct _GimpStrokeClass GimpStrokeClass;
+typedef struct _GimpStrokeClass   GimpStrokeClass;
+typedef struct _GimpStrokePrivate GimpStrokePrivate;
 
 struct _GimpStroke
 {
-  GimpObject  parent_instance;
-  gint        ID;
+  GimpObject         parent_instance;
+  gint               ID;
 
-  GQueue     *anchors;
+  GQueue            *anchors;
 
-  gboolean    closed;
+  gboolean           closed;
+
+  GimpStrokePrivate *private;
 };
 
 struct _GimpStrokeClass
@@ -89,6 +89,7 @@ typedef struct
 {
   gchar        *id;
   GList        *strokes;
+  GimpMatrix3  *transform;  /* of all enclosing elements, not yet applied */
 } SvgPath;
 
 
@@ -352,7 +353,13 @@ gimp_vectors_import (GimpImage    *image,
                 }
 
               for (list = path->strokes; list; list = list->next)
-                gimp_vectors_stroke_add (vectors, GIMP_STROKE (list->data));
+                {
+                  if (path->transform)
+                    gimp_stroke_transform (GIMP_STROKE (list->data),
+                                           path->transform, NULL);
+
+                  gimp_vectors_stroke_add (vectors, GIMP_STROKE (list->data));
+                }
 
               if (! merge)
                 gimp_vectors_thaw (vectors);
@@ -404,6 +411,9 @@ gimp_vectors_import (GimpImage    *image,
 
           g_list_free (path->strokes);
 
+          if (path->transform)
+            g_slice_free (GimpMatrix3, path->transform);
+
           g_slice_free (SvgPath, path);
         }
 
@@ -479,14 +489,18 @@ svg_parser_end_element (GMarkupParseContext  *context,
     {
       if (handler->transform)
         {
+          /*  only collect the transforms of nested elements here, the
+           *  strokes are transformed once when they are imported
+           */
           for (paths = handler->paths; paths; paths = paths->next)
             {
               SvgPath *path = paths->data;
-              GList   *list;
 
-              for (list = path->strokes; list; list = list->next)
-                gimp_stroke_transform (GIMP_STROKE (list->data),
-                                       handler->transform, NULL);
+              if (path->transform)
+                gimp_matrix3_mult (handler->transform, path->transform);
+              else
+                path->transform = g_slice_dup (GimpMatrix3,
+                                               handler->transform);
             }
 
           g_slice_free (GimpMatrix3, handler->transform);
@@ -27,6 +27,7 @@
 
 #include "libgimpmath/gimpmath.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpcoords.h"
 
@@ -40,16 +41,49 @@
 #define DX      2.0
 
 
-static void   gimp_stroke_warp_point   (GimpStroke  *stroke,
-                                        gdouble      x,
-                                        gdouble      y,
-                                        GimpCoords  *point_warped,
-                                        gdouble      y_offset,
-                                        gdouble      x_len);
+/*  the strokes of the guide path, interpolated once per warp, so
+ *  looking up points along them doesn't interpolate them again for
+ *  every single warped point
+ */
+typedef struct
+{
+  gdouble  length;    /* as returned by gimp_vectors_stroke_get_length() */
+  GArray  *points;    /* interpolated with EPSILON                       */
+  gdouble *dists;     /* the distance of each point from the start        */
+} WarpStroke;
 
-static void   gimp_vectors_warp_stroke (GimpVectors *vectors,
-                                        GimpStroke  *stroke,
-                                        gdouble      y_offset);
+typedef struct
+{
+  WarpStroke  *strokes;
+  gint         n_strokes;
+  gdouble      y_offset;
+  GimpStroke **strokes_in;
+} WarpData;
+
+
+static void       warp_data_init         (WarpData          *data,
+                                          GimpVectors       *vectors);
+static void       warp_data_clear        (WarpData          *data);
+
+static void       warp_point             (const WarpData    *data,
+                                          const GimpCoords  *point,
+                                          GimpCoords        *point_warped,
+                                          gdouble            y_offset);
+static void       warp_stroke_warp_point (const WarpStroke  *stroke,
+                                          gdouble            x,
+                                          gdouble            y,
+                                          GimpCoords        *point_warped,
+                                          gdouble            y_offset,
+                                          gdouble            x_len);
+static gboolean   warp_stroke_get_point_at_dist
+                                         (const WarpStroke  *stroke,
+                                          gdouble            dist,
+                                          GimpCoords        *position);
+
+static void       gimp_vectors_warp_strokes
+                                         (gsize              offset,
+                                          gsize              size,
+                                          WarpData          *data);
 
 
 void
@@ -58,56 +92,172 @@ gimp_vectors_warp_point (GimpVectors *vectors,
                          GimpCoords  *point_warped,
                          gdouble      y_offset)
 {
-  gdouble     x      = point->x;
-  gdouble     y      = point->y;
-  gdouble     len;
-  GList      *list;
-  GimpStroke *stroke;
+  WarpData data;
 
-  for (list = vectors->strokes->head;
+  warp_data_init (&data, vectors);
+
+  warp_point (&data, point, point_warped, y_offset);
+
+  warp_data_clear (&data);
+}
+
+void
+gimp_vectors_warp_vectors (GimpVectors *vectors,
+                           GimpVectors *vectors_in,
+                           gdouble      y_offset)
+{
+  WarpData  data;
+  GList    *list;
+  gint      n_strokes_in;
+  gint      i;
+
+  n_strokes_in = g_queue_get_length (vectors_in->strokes);
+
+  if (n_strokes_in == 0)
+    return;
+
+  warp_data_init (&data, vectors);
+
+  data.y_offset   = y_offset;
+  data.strokes_in = g_new (GimpStroke *, n_strokes_in);
+
+  for (list = vectors_in->strokes->head, i = 0;
        list;
-       list = g_list_next (list))
+       list = g_list_next (list), i++)
+    {
+      data.strokes_in[i] = list->data;
+    }
+
+  /*  the guide path is only read from now on, and every stroke's
+   *  anchors are only touched by one thread
+   */
+  gimp_parallel_distribute_range (n_strokes_in, 1,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_vectors_warp_strokes,
+                                  &data);
+
+  g_free (data.strokes_in);
+
+  warp_data_clear (&data);
+}
+
+
+/*  private functions  */
+
+static void
+warp_data_init (WarpData    *data,
+                GimpVectors *vectors)
+{
+  GList *list;
+  gint   i;
+
+  data->n_strokes  = g_queue_get_length (vectors->strokes);
+  data->strokes    = g_new0 (WarpStroke, data->n_strokes);
+  data->y_offset   = 0.0;
+  data->strokes_in = NULL;
+
+  for (list = vectors->strokes->head, i = 0;
+       list;
+       list = g_list_next (list), i++)
+    {
+      GimpStroke *stroke = list->data;
+      WarpStroke *warp   = &data->strokes[i];
+
+      warp->length = gimp_vectors_stroke_get_length (vectors, stroke);
+      warp->points = gimp_stroke_interpolate (stroke, EPSILON, NULL);
+
+      if (warp->points && warp->points->len > 0)
+        {
+          GimpCoords difference;
+          gdouble    length = 0.0;
+          gint       j;
+
+          warp->dists = g_new (gdouble, warp->points->len);
+
+          warp->dists[0] = 0.0;
+
+          for (j = 0; j < warp->points->len - 1; j++)
+            {
+              gimp_coords_difference (&g_array_index (warp->points,
+                                                      GimpCoords, j),
+                                      &g_array_index (warp->points,
+                                                      GimpCoords, j + 1),
+                                      &difference);
+
+              length += gimp_coords_length (&difference);
+
+              warp->dists[j + 1] = length;
+            }
+        }
+    }
+}
+
+static void
+warp_data_clear (WarpData *data)
+{
+  gint i;
+
+  for (i = 0; i < data->n_strokes; i++)
     {
-      stroke = list->data;
+      if (data->strokes[i].points)
+        g_array_free (data->strokes[i].points, TRUE);
 
-      len = gimp_vectors_stroke_get_length (vectors, stroke);
+      g_free (data->strokes[i].dists);
+    }
 
-      if (x < len || ! list->next)
+  g_free (data->strokes);
+}
+
+static void
+warp_point (const WarpData   *data,
+            const GimpCoords *point,
+            GimpCoords       *point_warped,
+            gdouble           y_offset)
+{
+  gdouble x   = point->x;
+  gdouble y   = point->y;
+  gdouble len = 0.0;
+  gint    i;
+
+  for (i = 0; i < data->n_strokes; i++)
+    {
+      len = data->strokes[i].length;
+
+      if (x < len || i == data->n_strokes - 1)
         break;
 
       x -= len;
     }
 
-  if (! list)
+  if (i == data->n_strokes)
     {
       point_warped->x = 0;
       point_warped->y = 0;
       return;
     }
 
-  gimp_stroke_warp_point (stroke, x, y, point_warped, y_offset, len);
+  warp_stroke_warp_point (&data->strokes[i], x, y, point_warped,
+                          y_offset, len);
 }
 
 static void
-gimp_stroke_warp_point (GimpStroke *stroke,
-                        gdouble     x,
-                        gdouble     y,
-                        GimpCoords *point_warped,
-                        gdouble     y_offset,
-                        gdouble     x_len)
+warp_stroke_warp_point (const WarpStroke *stroke,
+                        gdouble           x,
+                        gdouble           y,
+                        GimpCoords       *point_warped,
+                        gdouble           y_offset,
+                        gdouble           x_len)
 {
   GimpCoords point_zero  = { 0, };
   GimpCoords point_minus = { 0, };
   GimpCoords point_plus  = { 0, };
-  gdouble    slope;
   gdouble    dx, dy, nx, ny, len;
 
   if (x + DX >= x_len)
     {
       gdouble tx, ty;
 
-      if (! gimp_stroke_get_point_at_dist (stroke, x_len, EPSILON,
-                                           &point_zero, &slope))
+      if (! warp_stroke_get_point_at_dist (stroke, x_len, &point_zero))
         {
           point_warped->x = 0;
           point_warped->y = 0;
@@ -117,8 +267,7 @@ gimp_stroke_warp_point (GimpStroke *stroke,
       point_warped->x = point_zero.x;
       point_warped->y = point_zero.y;
 
-      if (! gimp_stroke_get_point_at_dist (stroke, x_len - DX, EPSILON,
-                                           &point_minus, &slope))
+      if (! warp_stroke_get_point_at_dist (stroke, x_len - DX, &point_minus))
         return;
 
       dx = point_zero.x - point_minus.x;
@@ -141,8 +290,7 @@ gimp_stroke_warp_point (GimpStroke *stroke,
       return;
     }
 
-  if (! gimp_stroke_get_point_at_dist (stroke, x, EPSILON,
-                                       &point_zero, &slope))
+  if (! warp_stroke_get_point_at_dist (stroke, x, &point_zero))
     {
       point_warped->x = 0;
       point_warped->y = 0;
@@ -152,12 +300,10 @@ gimp_stroke_warp_point (GimpStroke *stroke,
   point_warped->x = point_zero.x;
   point_warped->y = point_zero.y;
 
-  if (! gimp_stroke_get_point_at_dist (stroke, x - DX, EPSILON,
-                                       &point_minus, &slope))
+  if (! warp_stroke_get_point_at_dist (stroke, x - DX, &point_minus))
     return;
 
-  if (! gimp_stroke_get_point_at_dist (stroke, x + DX, EPSILON,
-                                       &point_plus, &slope))
+  if (! warp_stroke_get_point_at_dist (stroke, x + DX, &point_plus))
     return;
 
   dx = point_plus.x - point_minus.x;
@@ -175,36 +321,81 @@ gimp_stroke_warp_point (GimpStroke *stroke,
   point_warped->y = point_zero.y + ny * (y - y_offset);
 }
 
-static void
-gimp_vectors_warp_stroke (GimpVectors *vectors,
-                          GimpStroke  *stroke,
-                          gdouble      y_offset)
+/*  same as gimp_stroke_get_point_at_dist(), but with a binary search
+ *  in the precomputed distances
+ */
+static gboolean
+warp_stroke_get_point_at_dist (const WarpStroke *stroke,
+                               gdouble           dist,
+                               GimpCoords       *position)
 {
-  GList *list;
+  GimpCoords difference;
+  gint       n;
+  gint       lo, hi;
+  gdouble    u;
+
+  if (! stroke->points || stroke->points->len < 2)
+    return FALSE;
 
-  for (list = stroke->anchors->head; list; list = g_list_next (list))
+  n = stroke->points->len - 1;
+
+  if (stroke->dists[n] < dist)
+    return FALSE;
+
+  /*  find the first segment ending at or beyond dist  */
+  lo = 0;
+  hi = n - 1;
+
+  while (lo < hi)
     {
-      GimpAnchor *anchor = list->data;
+      gint mid = (lo + hi) / 2;
 
-      gimp_vectors_warp_point (vectors,
-                               &anchor->position, &anchor->position,
-                               y_offset);
+      if (stroke->dists[mid + 1] >= dist)
+        hi = mid;
+      else
+        lo = mid + 1;
     }
+
+  /*  skip empty segments  */
+  while (lo < n && stroke->dists[lo + 1] == stroke->dists[lo])
+    lo++;
+
+  if (lo == n)
+    return FALSE;
+
+  gimp_coords_difference (&g_array_index (stroke->points, GimpCoords, lo),
+                          &g_array_index (stroke->points, GimpCoords, lo + 1),
+                          &difference);
+
+  u = (dist - stroke->dists[lo]) / gimp_coords_length (&difference);
+
+  gimp_coords_mix (1 - u, &g_array_index (stroke->points, GimpCoords, lo),
+                   u,     &g_array_index (stroke->points, GimpCoords, lo + 1),
+                   position);
+
+  return TRUE;
 }
 
-void
-gimp_vectors_warp_vectors (GimpVectors *vectors,
-                           GimpVectors *vectors_in,
-                           gdouble      y_offset)
+static void
+gimp_vectors_warp_strokes (gsize     offset,
+                           gsize     size,
+                           WarpData *data)
 {
-  GList *list;
+  gsize i;
 
-  for (list = vectors_in->strokes->head;
-       list;
-       list = g_list_next (list))
+  for (i = offset; i < offset + size; i++)
     {
-      GimpStroke *stroke = list->data;
+      GList *list;
 
-      gimp_vectors_warp_stroke (vectors, stroke, y_offset);
+      for (list = data->strokes_in[i]->anchors->head;
+           list;
+           list = g_list_next (list))
+        {
+          GimpAnchor *anchor = list->data;
+
+          warp_point (data,
+                      &anchor->position, &anchor->position,
+                      data->y_offset);
+        }
     }
 }
@@ -40,7 +40,19 @@
 
 #include "widgets-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "core/gimp.h"
+#include "core/gimp-allocation.h"
+#include "core/gimp-latency.h"
+#include "core/gimp-stack-sampler.h"
+#include "core/gimp-startup.h"
+#include "core/gimpimage-undo.h"
+#include "core/gimpprojection.h"
+#include "core/gimptempbuf.h"
+
+#include "plug-in/gimppluginmanager.h"
+#include "plug-in/gimppluginmanager-stats.h"
 
 #include "gimpdocked.h"
 #include "gimpdashboard.h"
@@ -64,6 +76,10 @@
 #define CPU_ACTIVE_ON                  /* individual cpu usage is above */ 0.75
 #define CPU_ACTIVE_OFF                 /* individual cpu usage is below */ 0.25
 
+#define LOG_MAGIC                      "GIMPPLOG"
+#define LOG_VERSION                    1
+#define LOG_SAMPLE_INTERVAL            (G_TIME_SPAN_SECOND / 10)
+
 
 typedef enum
 {
@@ -84,8 +100,78 @@ typedef enum
   VARIABLE_SWAP_SIZE,
   VARIABLE_SWAP_LIMIT,
 
+  VARIABLE_SWAP_COMPRESSION,
+
+  VARIABLE_SWAP_QUEUED,
+  VARIABLE_SWAP_QUEUE_STALLS,
+  VARIABLE_SWAP_QUEUE_FULL,
+
+  VARIABLE_SWAP_READ,
+  VARIABLE_SWAP_READING,
+  VARIABLE_SWAP_WRITTEN,
+  VARIABLE_SWAP_WRITING,
+
   VARIABLE_SWAP_BUSY,
 
+  /* temp buf */
+  VARIABLE_TEMP_BUF_TOTAL,
+  VARIABLE_TEMP_BUF_POOLED,
+  VARIABLE_TEMP_BUF_POOL_LIMIT,
+
+  VARIABLE_TEMP_BUF_POOL_HIT_MISS,
+
+  /* plug-ins */
+  VARIABLE_PLUG_IN_RUNS,
+  VARIABLE_PLUG_IN_SPAWN_TIME,
+  VARIABLE_PLUG_IN_HANDSHAKE_TIME,
+  VARIABLE_PLUG_IN_CORE_TIME,
+  VARIABLE_PLUG_IN_PLUG_IN_TIME,
+
+  VARIABLE_PLUG_IN_MESSAGES,
+  VARIABLE_PLUG_IN_TILES,
+  VARIABLE_PLUG_IN_COPIED,
+
+  /* rendering */
+  VARIABLE_RENDER_FRAME_MEDIAN,
+  VARIABLE_RENDER_FRAME_95TH,
+  VARIABLE_RENDER_FRAME_MAXIMUM,
+
+  VARIABLE_RENDER_BACKLOG,
+
+  /* painting */
+  VARIABLE_PAINT_DAB_MEDIAN,
+  VARIABLE_PAINT_DAB_95TH,
+  VARIABLE_PAINT_DAB_MAXIMUM,
+
+  VARIABLE_PAINT_INPUT_MEDIAN,
+  VARIABLE_PAINT_INPUT_95TH,
+  VARIABLE_PAINT_INPUT_MAXIMUM,
+
+  /* undo */
+  VARIABLE_UNDO_OCCUPIED,
+  VARIABLE_UNDO_LIMIT,
+
+  /* allocations */
+  VARIABLE_ALLOCATION_TEMP_BUF,
+  VARIABLE_ALLOCATION_DRAWABLE,
+  VARIABLE_ALLOCATION_PROJECTION,
+  VARIABLE_ALLOCATION_CACHE,
+  VARIABLE_ALLOCATION_UNDO,
+
+  VARIABLE_ALLOCATION_TEMP_BUF_RATE,
+  VARIABLE_ALLOCATION_DRAWABLE_RATE,
+  VARIABLE_ALLOCATION_PROJECTION_RATE,
+  VARIABLE_ALLOCATION_CACHE_RATE,
+  VARIABLE_ALLOCATION_UNDO_RATE,
+
+  /* startup */
+  VARIABLE_STARTUP_TOTAL,
+  VARIABLE_STARTUP_DATA,
+  VARIABLE_STARTUP_FONTS,
+  VARIABLE_STARTUP_MODULES,
+  VARIABLE_STARTUP_PLUG_INS,
+  VARIABLE_STARTUP_INTERFACE,
+
 #ifdef HAVE_CPU_GROUP
   /* cpu */
   VARIABLE_CPU_USAGE,
@@ -102,11 +188,14 @@ typedef enum
 typedef enum
 {
   VARIABLE_TYPE_BOOLEAN,
+  VARIABLE_TYPE_COUNT,
   VARIABLE_TYPE_SIZE,
   VARIABLE_TYPE_SIZE_RATIO,
   VARIABLE_TYPE_INT_RATIO,
   VARIABLE_TYPE_PERCENTAGE,
-  VARIABLE_TYPE_DURATION
+  VARIABLE_TYPE_DURATION,
+  VARIABLE_TYPE_LATENCY,
+  VARIABLE_TYPE_RATE
 } VariableType;
 
 typedef enum
@@ -115,6 +204,13 @@ typedef enum
 
   GROUP_CACHE = FIRST_GROUP,
   GROUP_SWAP,
+  GROUP_TEMP_BUF,
+  GROUP_PLUG_IN,
+  GROUP_RENDER,
+  GROUP_PAINT,
+  GROUP_UNDO,
+  GROUP_ALLOCATION,
+  GROUP_STARTUP,
 #ifdef HAVE_CPU_GROUP
   GROUP_CPU,
 #endif
@@ -174,6 +270,7 @@ struct _VariableData
   union
   {
     gboolean  boolean;
+    guint64   count;
     guint64   size;       /* in bytes    */
     struct
     {
@@ -187,6 +284,8 @@ struct _VariableData
     } int_ratio;
     gdouble   percentage; /* from 0 to 1 */
     gdouble   duration;   /* in seconds  */
+    gdouble   latency;    /* in seconds  */
+    gdouble   rate;       /* in bytes per second */
   } value;
 };
 
@@ -234,6 +333,16 @@ struct _GimpDashboardPrivate
   GimpDashboardUpdateInteval    update_interval;
   GimpDashboardHistoryDuration  history_duration;
   gboolean                      low_swap_space_warning;
+
+  GFile                        *log_file;
+  GIOStream                    *log_iostream;
+  GDataOutputStream            *log_output;
+  gboolean                      log_stack_sampling;
+  gint64                        log_start_time;
+  gint64                        log_sample_time;
+  GHashTable                   *log_addresses;
+  GError                       *log_error;
+  gint                          log_error_idle_id;
 };
 
 
@@ -260,9 +369,11 @@ static void       gimp_dashboard_group_menu_item_toggled     (GimpDashboard
                                                               GtkCheckMenuItem    *item);
 
 static gpointer   gimp_dashboard_sample                      (GimpDashboard       *dashboard);
+static gboolean   gimp_dashboard_sample_variables            (GimpDashboard       *dashboard);
 
 static gboolean   gimp_dashboard_update                      (GimpDashboard       *dashboard);
 static gboolean   gimp_dashboard_low_swap_space              (GimpDashboard       *dashboard);
+static gboolean   gimp_dashboard_log_error                   (GimpDashboard       *dashboard);
 
 static void       gimp_dashboard_sample_gegl_config          (GimpDashboard       *dashboard,
                                                               Variable             variable);
@@ -270,6 +381,22 @@ static void       gimp_dashboard_sample_gegl_stats           (GimpDashboard
                                                               Variable             variable);
 static void       gimp_dashboard_sample_swap_limit           (GimpDashboard       *dashboard,
                                                               Variable             variable);
+static void       gimp_dashboard_sample_temp_buf_pool        (GimpDashboard       *dashboard,
+                                                              Variable             variable);
+static void       gimp_dashboard_sample_plug_in_stats        (GimpDashboard       *dashboard,
+                                                              Variable             variable);
+static void       gimp_dashboard_sample_latency              (GimpDashboard       *dashboard,
+                                                              Variable             variable);
+static void       gimp_dashboard_sample_render_backlog       (GimpDashboard       *dashboard,
+                                                              Variable             variable);
+static void       gimp_dashboard_sample_undo                 (GimpDashboard       *dashboard,
+                                                              Variable             variable);
+static void       gimp_dashboard_sample_allocation           (GimpDashboard       *dashboard,
+                                                              Variable             variable);
+static void       gimp_dashboard_reset_allocation            (GimpDashboard       *dashboard,
+                                                              Variable             variable);
+static void       gimp_dashboard_sample_startup              (GimpDashboard       *dashboard,
+                                                              Variable             variable);
 #ifdef HAVE_CPU_GROUP
 static void       gimp_dashboard_sample_cpu_usage            (GimpDashboard       *dashboard,
                                                               Variable             variable);
@@ -320,6 +447,23 @@ static gchar    * gimp_dashboard_field_to_string             (GimpDashboard
 static void       gimp_dashboard_label_set_text              (GtkLabel            *label,
                                                               const gchar         *text);
 
+static void       gimp_dashboard_log_sample                  (GimpDashboard       *dashboard);
+static gboolean   gimp_dashboard_log_close                   (GimpDashboard       *dashboard,
+                                                              GError             **error);
+static gboolean   gimp_dashboard_log_put_string              (GDataOutputStream   *output,
+                                                              const gchar         *string,
+                                                              GError             **error);
+static gboolean   gimp_dashboard_log_put_double              (GDataOutputStream   *output,
+                                                              gdouble              value,
+                                                              GError             **error);
+static gchar    * gimp_dashboard_log_get_string              (GDataInputStream    *input,
+                                                              GError             **error);
+static gboolean   gimp_dashboard_log_read                    (GInputStream        *base_input,
+                                                              GOutputStream       *output,
+                                                              gchar             ***names,
+                                                              goffset             *end,
+                                                              GError             **error);
+
 
 /*  static variables  */
 
@@ -407,6 +551,86 @@ static const VariableInfo variables[] =
     .sample_func      = gimp_dashboard_sample_swap_limit,
   },
 
+  [VARIABLE_SWAP_COMPRESSION] =
+  { .name             = "swap-compression",
+    .title            = NC_("dashboard-variable", "Compression"),
+    .description      = N_("Swap compression ratio"),
+    .type             = VARIABLE_TYPE_SIZE_RATIO,
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-total\0"
+                        "swap-total-uncompressed"
+  },
+
+  [VARIABLE_SWAP_QUEUED] =
+  { .name             = "swap-queued",
+    .title            = NC_("dashboard-variable", "Queued"),
+    .description      = N_("Size of data queued for writing to the swap"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .color            = {0.8, 0.8, 0.2, 0.5},
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-queued-total"
+  },
+
+  [VARIABLE_SWAP_QUEUE_STALLS] =
+  { .name             = "swap-queue-stalls",
+    .title            = NC_("dashboard-variable", "Queue stalls"),
+    .description      = N_("Number of times the writing to the swap has been "
+                           "stalled, due to a full queue"),
+    .type             = VARIABLE_TYPE_COUNT,
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-queue-stalls"
+  },
+
+  [VARIABLE_SWAP_QUEUE_FULL] =
+  { .name             = "swap-queue-full",
+    .title            = NC_("dashboard-variable", "Queue full"),
+    .description      = N_("Whether the swap queue is full"),
+    .type             = VARIABLE_TYPE_BOOLEAN,
+    .color            = {0.8, 0.8, 0.2, 1.0},
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-queue-full"
+  },
+
+  [VARIABLE_SWAP_READ] =
+  { .name             = "swap-read",
+    .title            = NC_("dashboard-variable", "Read"),
+    .description      = N_("Total amount of data read from the swap"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .color            = {0.2, 0.4, 1.0, 0.4},
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-read-total"
+  },
+
+  [VARIABLE_SWAP_READING] =
+  { .name             = "swap-reading",
+    .title            = NC_("dashboard-variable", "Reading"),
+    .description      = N_("Whether data is being read from the swap"),
+    .type             = VARIABLE_TYPE_BOOLEAN,
+    .color            = {0.2, 0.4, 1.0, 1.0},
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-reading"
+  },
+
+  [VARIABLE_SWAP_WRITTEN] =
+  { .name             = "swap-written",
+    .title            = NC_("dashboard-variable", "Written"),
+    .description      = N_("Total amount of data written to the swap"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .color            = {0.8, 0.3, 0.2, 0.4},
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-write-total"
+  },
+
+  [VARIABLE_SWAP_WRITING] =
+  { .name             = "swap-writing",
+    .title            = NC_("dashboard-variable", "Writing"),
+    .description      = N_("Whether data is being written to the swap"),
+    .type             = VARIABLE_TYPE_BOOLEAN,
+    .color            = {0.8, 0.3, 0.2, 1.0},
+    .sample_func      = gimp_dashboard_sample_gegl_stats,
+    .data             = "swap-writing"
+  },
+
   [VARIABLE_SWAP_BUSY] =
   { .name             = "swap-busy",
     .title            = NC_("dashboard-variable", "Busy"),
@@ -418,6 +642,388 @@ static const VariableInfo variables[] =
   },
 
 
+  /* temp buf variables */
+
+  [VARIABLE_TEMP_BUF_TOTAL] =
+  { .name             = "temp-buf-total",
+    .title            = NC_("dashboard-variable", "Total"),
+    .description      = N_("Total size of temporary buffers, including pooled ones"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_temp_buf_pool
+  },
+
+  [VARIABLE_TEMP_BUF_POOLED] =
+  { .name             = "temp-buf-pooled",
+    .title            = NC_("dashboard-variable", "Pooled"),
+    .description      = N_("Size of free temporary buffers kept for reuse"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .color            = {0.4, 0.4, 0.8, 1.0},
+    .sample_func      = gimp_dashboard_sample_temp_buf_pool
+  },
+
+  [VARIABLE_TEMP_BUF_POOL_LIMIT] =
+  { .name             = "temp-buf-pool-limit",
+    .title            = NC_("dashboard-variable", "Limit"),
+    .description      = N_("Temporary buffer pool size limit"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_temp_buf_pool
+  },
+
+  [VARIABLE_TEMP_BUF_POOL_HIT_MISS] =
+  { .name             = "temp-buf-pool-hit-miss",
+    .title            = NC_("dashboard-variable", "Hit/Miss"),
+    .description      = N_("Temporary buffer pool hit/miss ratio"),
+    .type             = VARIABLE_TYPE_INT_RATIO,
+    .sample_func      = gimp_dashboard_sample_temp_buf_pool
+  },
+
+
+  /* plug-in variables */
+
+  [VARIABLE_PLUG_IN_RUNS] =
+  { .name             = "plug-in-runs",
+    .title            = NC_("dashboard-variable", "Runs"),
+    .description      = N_("Number of plug-in runs"),
+    .type             = VARIABLE_TYPE_COUNT,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+  [VARIABLE_PLUG_IN_SPAWN_TIME] =
+  { .name             = "plug-in-spawn-time",
+    .title            = NC_("dashboard-variable", "Spawn"),
+    .description      = N_("Total amount of time spent starting plug-ins"),
+    .type             = VARIABLE_TYPE_DURATION,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+  [VARIABLE_PLUG_IN_HANDSHAKE_TIME] =
+  { .name             = "plug-in-handshake-time",
+    .title            = NC_("dashboard-variable", "Handshake"),
+    .description      = N_("Total amount of time until plug-ins answered "
+                           "their first call"),
+    .type             = VARIABLE_TYPE_DURATION,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+  [VARIABLE_PLUG_IN_CORE_TIME] =
+  { .name             = "plug-in-core-time",
+    .title            = NC_("dashboard-variable", "Core"),
+    .description      = N_("Total amount of time plug-ins waited for GIMP"),
+    .type             = VARIABLE_TYPE_DURATION,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+  [VARIABLE_PLUG_IN_PLUG_IN_TIME] =
+  { .name             = "plug-in-plug-in-time",
+    .title            = NC_("dashboard-variable", "Plug-in"),
+    .description      = N_("Total amount of time GIMP waited for plug-ins"),
+    .type             = VARIABLE_TYPE_DURATION,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+  [VARIABLE_PLUG_IN_MESSAGES] =
+  { .name             = "plug-in-messages",
+    .title            = NC_("dashboard-variable", "Messages"),
+    .description      = N_("Number of messages exchanged with plug-ins"),
+    .type             = VARIABLE_TYPE_COUNT,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+  [VARIABLE_PLUG_IN_TILES] =
+  { .name             = "plug-in-tiles",
+    .title            = NC_("dashboard-variable", "Tiles"),
+    .description      = N_("Number of tiles transferred to and from plug-ins"),
+    .type             = VARIABLE_TYPE_COUNT,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+  [VARIABLE_PLUG_IN_COPIED] =
+  { .name             = "plug-in-copied",
+    .title            = NC_("dashboard-variable", "Copied"),
+    .description      = N_("Size of pixel data copied to and from plug-ins"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_plug_in_stats
+  },
+
+
+  /* rendering variables */
+
+  [VARIABLE_RENDER_FRAME_MEDIAN] =
+  { .name             = "render-frame-median",
+    .title            = NC_("dashboard-variable", "Median"),
+    .description      = N_("Median time it recently took to draw the image "
+                           "on the canvas"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .color            = {0.3, 0.7, 0.3, 1.0},
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_DISPLAY_FRAME)
+  },
+
+  [VARIABLE_RENDER_FRAME_95TH] =
+  { .name             = "render-frame-95th",
+    .title            = NC_("dashboard-variable", "95th percentile"),
+    .description      = N_("Time 95% of the recent canvas draws took at most"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .color            = {0.3, 0.7, 0.3, 0.4},
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_DISPLAY_FRAME)
+  },
+
+  [VARIABLE_RENDER_FRAME_MAXIMUM] =
+  { .name             = "render-frame-maximum",
+    .title            = NC_("dashboard-variable", "Maximum"),
+    .description      = N_("Longest time it recently took to draw the image "
+                           "on the canvas"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_DISPLAY_FRAME)
+  },
+
+  [VARIABLE_RENDER_BACKLOG] =
+  { .name             = "render-backlog",
+    .title            = NC_("dashboard-variable", "Backlog"),
+    .description      = N_("Number of pixels the image projections still "
+                           "have to render"),
+    .type             = VARIABLE_TYPE_COUNT,
+    .sample_func      = gimp_dashboard_sample_render_backlog
+  },
+
+
+  /* painting variables */
+
+  [VARIABLE_PAINT_DAB_MEDIAN] =
+  { .name             = "paint-dab-median",
+    .title            = NC_("dashboard-variable", "Median"),
+    .description      = N_("Median time it recently took to paint a dab"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .color            = {0.7, 0.3, 0.7, 1.0},
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_PAINT_DAB)
+  },
+
+  [VARIABLE_PAINT_DAB_95TH] =
+  { .name             = "paint-dab-95th",
+    .title            = NC_("dashboard-variable", "95th percentile"),
+    .description      = N_("Time 95% of the recent dabs took at most"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .color            = {0.7, 0.3, 0.7, 0.4},
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_PAINT_DAB)
+  },
+
+  [VARIABLE_PAINT_DAB_MAXIMUM] =
+  { .name             = "paint-dab-maximum",
+    .title            = NC_("dashboard-variable", "Maximum"),
+    .description      = N_("Longest time it recently took to paint a dab"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_PAINT_DAB)
+  },
+
+  [VARIABLE_PAINT_INPUT_MEDIAN] =
+  { .name             = "paint-input-median",
+    .title            = NC_("dashboard-variable", "Input median"),
+    .description      = N_("Median time it recently took painting input "
+                           "to show up on the canvas"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_PAINT_INPUT)
+  },
+
+  [VARIABLE_PAINT_INPUT_95TH] =
+  { .name             = "paint-input-95th",
+    .title            = NC_("dashboard-variable", "Input 95th percentile"),
+    .description      = N_("Time 95% of the recent painting input took at "
+                           "most to show up on the canvas"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_PAINT_INPUT)
+  },
+
+  [VARIABLE_PAINT_INPUT_MAXIMUM] =
+  { .name             = "paint-input-maximum",
+    .title            = NC_("dashboard-variable", "Input maximum"),
+    .description      = N_("Longest time it recently took painting input "
+                           "to show up on the canvas"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_latency,
+    .data             = GINT_TO_POINTER (GIMP_LATENCY_PAINT_INPUT)
+  },
+
+
+  /* undo variables */
+
+  [VARIABLE_UNDO_OCCUPIED] =
+  { .name             = "undo-occupied",
+    .title            = NC_("dashboard-variable", "Occupied"),
+    .description      = N_("Size of the undo history of all images"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .color            = {0.2, 0.6, 0.8, 1.0},
+    .sample_func      = gimp_dashboard_sample_undo
+  },
+
+  [VARIABLE_UNDO_LIMIT] =
+  { .name             = "undo-limit",
+    .title            = NC_("dashboard-variable", "Limit"),
+    .description      = N_("Undo history size limit, per image"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_undo
+  },
+
+  /* allocation variables */
+
+  [VARIABLE_ALLOCATION_TEMP_BUF] =
+  { .name             = "allocation-temp-buf",
+    .title            = NC_("dashboard-variable", "Temporary"),
+    .description      = N_("Memory held by temporary buffers"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_TEMP_BUF)
+  },
+
+  [VARIABLE_ALLOCATION_DRAWABLE] =
+  { .name             = "allocation-drawable",
+    .title            = NC_("dashboard-variable", "Drawables"),
+    .description      = N_("Memory held by the pixels of layers and channels"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_DRAWABLE)
+  },
+
+  [VARIABLE_ALLOCATION_PROJECTION] =
+  { .name             = "allocation-projection",
+    .title            = NC_("dashboard-variable", "Projections"),
+    .description      = N_("Memory held by the projections of images and layer groups"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_PROJECTION)
+  },
+
+  [VARIABLE_ALLOCATION_CACHE] =
+  { .name             = "allocation-cache",
+    .title            = NC_("dashboard-variable", "Caches"),
+    .description      = N_("Memory held by view previews and transformed brushes"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_CACHE)
+  },
+
+  [VARIABLE_ALLOCATION_UNDO] =
+  { .name             = "allocation-undo",
+    .title            = NC_("dashboard-variable", "Undo"),
+    .description      = N_("Memory held by the undo history"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_UNDO)
+  },
+
+  [VARIABLE_ALLOCATION_TEMP_BUF_RATE] =
+  { .name             = "allocation-temp-buf-rate",
+    .title            = NC_("dashboard-variable", "Temporary rate"),
+    .description      = N_("Rate at which memory is allocated for temporary buffers"),
+    .type             = VARIABLE_TYPE_RATE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .reset_func       = gimp_dashboard_reset_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_TEMP_BUF)
+  },
+
+  [VARIABLE_ALLOCATION_DRAWABLE_RATE] =
+  { .name             = "allocation-drawable-rate",
+    .title            = NC_("dashboard-variable", "Drawables rate"),
+    .description      = N_("Rate at which memory is allocated for layer and channel pixels"),
+    .type             = VARIABLE_TYPE_RATE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .reset_func       = gimp_dashboard_reset_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_DRAWABLE)
+  },
+
+  [VARIABLE_ALLOCATION_PROJECTION_RATE] =
+  { .name             = "allocation-projection-rate",
+    .title            = NC_("dashboard-variable", "Projections rate"),
+    .description      = N_("Rate at which memory is allocated for projections"),
+    .type             = VARIABLE_TYPE_RATE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .reset_func       = gimp_dashboard_reset_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_PROJECTION)
+  },
+
+  [VARIABLE_ALLOCATION_CACHE_RATE] =
+  { .name             = "allocation-cache-rate",
+    .title            = NC_("dashboard-variable", "Caches rate"),
+    .description      = N_("Rate at which memory is allocated for view previews and transformed brushes"),
+    .type             = VARIABLE_TYPE_RATE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .reset_func       = gimp_dashboard_reset_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_CACHE)
+  },
+
+  [VARIABLE_ALLOCATION_UNDO_RATE] =
+  { .name             = "allocation-undo-rate",
+    .title            = NC_("dashboard-variable", "Undo rate"),
+    .description      = N_("Rate at which memory is allocated for the undo history"),
+    .type             = VARIABLE_TYPE_RATE,
+    .sample_func      = gimp_dashboard_sample_allocation,
+    .reset_func       = gimp_dashboard_reset_allocation,
+    .data             = GINT_TO_POINTER (GIMP_ALLOCATION_UNDO)
+  },
+
+
+  /* startup variables */
+
+  [VARIABLE_STARTUP_TOTAL] =
+  { .name             = "startup-total",
+    .title            = NC_("dashboard-variable", "Total"),
+    .description      = N_("Time GIMP took to start up"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_startup
+  },
+
+  [VARIABLE_STARTUP_DATA] =
+  { .name             = "startup-data",
+    .title            = NC_("dashboard-variable", "Data"),
+    .description      = N_("Time spent loading brushes, patterns and other data"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_startup,
+    .data             = "data"
+  },
+
+  [VARIABLE_STARTUP_FONTS] =
+  { .name             = "startup-fonts",
+    .title            = NC_("dashboard-variable", "Fonts"),
+    .description      = N_("Time spent loading fonts"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_startup,
+    .data             = "fonts"
+  },
+
+  [VARIABLE_STARTUP_MODULES] =
+  { .name             = "startup-modules",
+    .title            = NC_("dashboard-variable", "Modules"),
+    .description      = N_("Time spent loading modules"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_startup,
+    .data             = "modules"
+  },
+
+  [VARIABLE_STARTUP_PLUG_INS] =
+  { .name             = "startup-plug-ins",
+    .title            = NC_("dashboard-variable", "Plug-ins"),
+    .description      = N_("Time spent searching, querying and initializing plug-ins"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_startup,
+    .data             = "plug-ins"
+  },
+
+  [VARIABLE_STARTUP_INTERFACE] =
+  { .name             = "startup-interface",
+    .title            = NC_("dashboard-variable", "Interface"),
+    .description      = N_("Time spent setting up the user interface"),
+    .type             = VARIABLE_TYPE_LATENCY,
+    .sample_func      = gimp_dashboard_sample_startup,
+    .data             = "interface"
+  },
+
+
 #ifdef HAVE_CPU_GROUP
   /* cpu variables */
 
@@ -514,52 +1120,339 @@ static const GroupInfo groups[] =
                             .default_active = TRUE
                           },
 
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_SWAP_COMPRESSION,
+                            .default_active = FALSE
+                          },
+
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_SWAP_QUEUED,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_SWAP_QUEUE_FULL,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_SWAP_QUEUE_STALLS,
+                            .default_active = FALSE
+                          },
+
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_SWAP_READ,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_SWAP_READING,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_SWAP_WRITTEN,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_SWAP_WRITING,
+                            .default_active = FALSE
+                          },
+
                           {}
                         }
   },
 
-#ifdef HAVE_CPU_GROUP
-  /* cpu group */
-  [GROUP_CPU] =
-  { .name             = "cpu",
-    .title            = NC_("dashboard-group", "CPU"),
-    .description      = N_("CPU usage"),
+  /* temp buf group */
+  [GROUP_TEMP_BUF] =
+  { .name             = "temp-buf",
+    .title            = NC_("dashboard-group", "Temp Buffers"),
+    .description      = N_("Pooled temporary buffers"),
     .default_expanded = FALSE,
     .has_meter        = TRUE,
-    .meter_led        = VARIABLE_CPU_ACTIVE,
+    .meter_limit      = VARIABLE_TEMP_BUF_POOL_LIMIT,
     .fields           = (const FieldInfo[])
                         {
-                          { .variable       = VARIABLE_CPU_USAGE,
+                          { .variable       = VARIABLE_TEMP_BUF_POOLED,
                             .default_active = TRUE,
                             .show_in_header = TRUE,
-                            .meter_value    = 2
+                            .meter_value    = 1
+                          },
+                          { .variable       = VARIABLE_TEMP_BUF_POOL_LIMIT,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_TEMP_BUF_TOTAL,
+                            .default_active = FALSE
                           },
 
                           { VARIABLE_SEPARATOR },
 
-                          { .variable       = VARIABLE_CPU_ACTIVE_TIME,
-                            .default_active = FALSE,
-                            .meter_variable = VARIABLE_CPU_ACTIVE,
-                            .meter_value    = 1
+                          { .variable       = VARIABLE_TEMP_BUF_POOL_HIT_MISS,
+                            .default_active = FALSE
                           },
 
                           {}
                         }
-  }
-#endif /* HAVE_CPU_GROUP */
-};
-
+  },
 
-G_DEFINE_TYPE_WITH_CODE (GimpDashboard, gimp_dashboard, GIMP_TYPE_EDITOR,
-                         G_IMPLEMENT_INTERFACE (GIMP_TYPE_DOCKED,
-                                                gimp_dashboard_docked_iface_init))
+  /* plug-in group */
+  [GROUP_PLUG_IN] =
+  { .name             = "plug-in",
+    .title            = NC_("dashboard-group", "Plug-ins"),
+    .description      = N_("Plug-in calls"),
+    .default_expanded = FALSE,
+    .has_meter        = FALSE,
+    .fields           = (const FieldInfo[])
+                        {
+                          { .variable       = VARIABLE_PLUG_IN_RUNS,
+                            .default_active = TRUE,
+                            .show_in_header = TRUE
+                          },
+                          { .variable       = VARIABLE_PLUG_IN_SPAWN_TIME,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_PLUG_IN_HANDSHAKE_TIME,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_PLUG_IN_CORE_TIME,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_PLUG_IN_PLUG_IN_TIME,
+                            .default_active = TRUE
+                          },
 
-#define parent_class gimp_dashboard_parent_class
+                          { VARIABLE_SEPARATOR },
 
-static GimpDockedInterface *parent_docked_iface = NULL;
+                          { .variable       = VARIABLE_PLUG_IN_MESSAGES,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_PLUG_IN_TILES,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_PLUG_IN_COPIED,
+                            .default_active = TRUE
+                          },
 
+                          {}
+                        }
+  },
 
-/*  private functions  */
+  /* rendering group */
+  [GROUP_RENDER] =
+  { .name             = "render",
+    .title            = NC_("dashboard-group", "Rendering"),
+    .description      = N_("Drawing the image on the canvas"),
+    .default_expanded = FALSE,
+    .has_meter        = TRUE,
+    .meter_limit      = VARIABLE_RENDER_FRAME_MAXIMUM,
+    .fields           = (const FieldInfo[])
+                        {
+                          { .variable       = VARIABLE_RENDER_FRAME_MEDIAN,
+                            .default_active = TRUE,
+                            .show_in_header = TRUE,
+                            .meter_value    = 2
+                          },
+                          { .variable       = VARIABLE_RENDER_FRAME_95TH,
+                            .default_active = TRUE,
+                            .meter_value    = 1
+                          },
+                          { .variable       = VARIABLE_RENDER_FRAME_MAXIMUM,
+                            .default_active = FALSE
+                          },
+
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_RENDER_BACKLOG,
+                            .default_active = TRUE
+                          },
+
+                          {}
+                        }
+  },
+
+  /* painting group */
+  [GROUP_PAINT] =
+  { .name             = "paint",
+    .title            = NC_("dashboard-group", "Painting"),
+    .description      = N_("Painting dabs, and the latency of painting input"),
+    .default_expanded = FALSE,
+    .has_meter        = TRUE,
+    .meter_limit      = VARIABLE_PAINT_DAB_MAXIMUM,
+    .fields           = (const FieldInfo[])
+                        {
+                          { .variable       = VARIABLE_PAINT_DAB_MEDIAN,
+                            .default_active = TRUE,
+                            .show_in_header = TRUE,
+                            .meter_value    = 2
+                          },
+                          { .variable       = VARIABLE_PAINT_DAB_95TH,
+                            .default_active = TRUE,
+                            .meter_value    = 1
+                          },
+                          { .variable       = VARIABLE_PAINT_DAB_MAXIMUM,
+                            .default_active = FALSE
+                          },
+
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_PAINT_INPUT_MEDIAN,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_PAINT_INPUT_95TH,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_PAINT_INPUT_MAXIMUM,
+                            .default_active = FALSE
+                          },
+
+                          {}
+                        }
+  },
+
+  /* undo group */
+  [GROUP_UNDO] =
+  { .name             = "undo",
+    .title            = NC_("dashboard-group", "Undo"),
+    .description      = N_("Undo history"),
+    .default_expanded = FALSE,
+    .has_meter        = TRUE,
+    .meter_limit      = VARIABLE_UNDO_LIMIT,
+    .fields           = (const FieldInfo[])
+                        {
+                          { .variable       = VARIABLE_UNDO_OCCUPIED,
+                            .default_active = TRUE,
+                            .show_in_header = TRUE,
+                            .meter_value    = 1
+                          },
+                          { .variable       = VARIABLE_UNDO_LIMIT,
+                            .default_active = TRUE
+                          },
+
+                          {}
+                        }
+  },
+
+  /* allocation group */
+  [GROUP_ALLOCATION] =
+  { .name             = "allocation",
+    .title            = NC_("dashboard-group", "Allocations"),
+    .description      = N_("Memory held by each part of GIMP, and how fast "
+                           "it is allocated"),
+    .default_expanded = FALSE,
+    .has_meter        = FALSE,
+    .fields           = (const FieldInfo[])
+                        {
+                          { .variable       = VARIABLE_ALLOCATION_TEMP_BUF,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_DRAWABLE,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_PROJECTION,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_CACHE,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_UNDO,
+                            .default_active = TRUE
+                          },
+
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_ALLOCATION_TEMP_BUF_RATE,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_DRAWABLE_RATE,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_PROJECTION_RATE,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_CACHE_RATE,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_ALLOCATION_UNDO_RATE,
+                            .default_active = TRUE
+                          },
+
+                          {}
+                        }
+  },
+
+  /* startup group */
+  [GROUP_STARTUP] =
+  { .name             = "startup",
+    .title            = NC_("dashboard-group", "Startup"),
+    .description      = N_("Time spent in each phase of this session's "
+                           "startup"),
+    .default_expanded = FALSE,
+    .has_meter        = FALSE,
+    .fields           = (const FieldInfo[])
+                        {
+                          { .variable       = VARIABLE_STARTUP_TOTAL,
+                            .default_active = TRUE,
+                            .show_in_header = TRUE
+                          },
+
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_STARTUP_DATA,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_STARTUP_FONTS,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_STARTUP_MODULES,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_STARTUP_PLUG_INS,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_STARTUP_INTERFACE,
+                            .default_active = TRUE
+                          },
+
+                          {}
+                        }
+  },
+
+#ifdef HAVE_CPU_GROUP
+  /* cpu group */
+  [GROUP_CPU] =
+  { .name             = "cpu",
+    .title            = NC_("dashboard-group", "CPU"),
+    .description      = N_("CPU usage"),
+    .default_expanded = FALSE,
+    .has_meter        = TRUE,
+    .meter_led        = VARIABLE_CPU_ACTIVE,
+    .fields           = (const FieldInfo[])
+                        {
+                          { .variable       = VARIABLE_CPU_USAGE,
+                            .default_active = TRUE,
+                            .show_in_header = TRUE,
+                            .meter_value    = 2
+                          },
+
+                          { VARIABLE_SEPARATOR },
+
+                          { .variable       = VARIABLE_CPU_ACTIVE_TIME,
+                            .default_active = FALSE,
+                            .meter_variable = VARIABLE_CPU_ACTIVE,
+                            .meter_value    = 1
+                          },
+
+                          {}
+                        }
+  }
+#endif /* HAVE_CPU_GROUP */
+};
+
+
+G_DEFINE_TYPE_WITH_CODE (GimpDashboard, gimp_dashboard, GIMP_TYPE_EDITOR,
+                         G_IMPLEMENT_INTERFACE (GIMP_TYPE_DOCKED,
+                                                gimp_dashboard_docked_iface_init))
+
+#define parent_class gimp_dashboard_parent_class
+
+static GimpDockedInterface *parent_docked_iface = NULL;
+
+
+/*  private functions  */
 
 
 static void
@@ -873,6 +1766,15 @@ gimp_dashboard_dispose (GObject *object)
       g_clear_pointer (&priv->thread, g_thread_join);
     }
 
+  if (priv->log_output)
+    gimp_dashboard_log_close (dashboard, NULL);
+
+  if (priv->log_error_idle_id)
+    {
+      g_source_remove (priv->log_error_idle_id);
+      priv->log_error_idle_id = 0;
+    }
+
   if (priv->update_idle_id)
     {
       g_source_remove (priv->update_idle_id);
@@ -898,6 +1800,9 @@ gimp_dashboard_finalize (GObject *object)
   for (i = FIRST_GROUP; i < N_GROUPS; i++)
     g_free (priv->groups[i].fields);
 
+  g_clear_object (&priv->log_file);
+  g_clear_error (&priv->log_error);
+
   g_mutex_clear (&priv->mutex);
   g_cond_clear (&priv->cond);
 
@@ -1190,6 +2095,7 @@ gimp_dashboard_sample (GimpDashboard *dashboard)
   GimpDashboardUpdateInteval  update_interval;
   gint64                      end_time;
   gboolean                    seen_low_swap_space = FALSE;
+  gboolean                    variables_changed   = FALSE;
 
   g_mutex_lock (&priv->mutex);
 
@@ -1198,27 +2104,38 @@ gimp_dashboard_sample (GimpDashboard *dashboard)
 
   while (! priv->quit)
     {
-      if (! g_cond_wait_until (&priv->cond, &priv->mutex, end_time) ||
-          priv->update_now)
+      gint64 wait_time = end_time;
+      gint64 now;
+
+      /* while recording a log, sample at the log's rate too */
+      if (priv->log_output)
+        wait_time = MIN (wait_time, priv->log_sample_time);
+
+      g_cond_wait_until (&priv->cond, &priv->mutex, wait_time);
+
+      now = g_get_monotonic_time ();
+
+      if (priv->log_output && now >= priv->log_sample_time)
+        {
+          variables_changed |= gimp_dashboard_sample_variables (dashboard);
+
+          gimp_dashboard_log_sample (dashboard);
+
+          priv->log_sample_time += LOG_SAMPLE_INTERVAL;
+
+          /* if we fell behind, don't try to catch up */
+          if (priv->log_sample_time <= now)
+            priv->log_sample_time = now + LOG_SAMPLE_INTERVAL;
+        }
+
+      if (now >= end_time || priv->update_now)
         {
-          gboolean variables_changed = FALSE;
           Variable variable;
           Group    group;
           gint     field;
 
           /* sample all variables */
-          for (variable = FIRST_VARIABLE; variable < N_VARIABLES; variable++)
-            {
-              const VariableInfo *variable_info      = &variables[variable];
-              const VariableData *variable_data      = &priv->variables[variable];
-              VariableData        prev_variable_data = *variable_data;
-
-              variable_info->sample_func (dashboard, variable);
-
-              variables_changed = variables_changed ||
-                                  memcmp (variable_data, &prev_variable_data,
-                                          sizeof (VariableData));
-            }
+          variables_changed |= gimp_dashboard_sample_variables (dashboard);
 
           /* add samples to meters */
           for (group = FIRST_GROUP; group < N_GROUPS; group++)
@@ -1304,7 +2221,8 @@ gimp_dashboard_sample (GimpDashboard *dashboard)
                 }
             }
 
-          priv->update_now = FALSE;
+          variables_changed = FALSE;
+          priv->update_now  = FALSE;
 
           end_time = g_get_monotonic_time () +
                      update_interval * G_TIME_SPAN_SECOND / 1000;
@@ -1323,6 +2241,29 @@ gimp_dashboard_sample (GimpDashboard *dashboard)
   return NULL;
 }
 
+static gboolean
+gimp_dashboard_sample_variables (GimpDashboard *dashboard)
+{
+  GimpDashboardPrivate *priv              = dashboard->priv;
+  gboolean              variables_changed = FALSE;
+  Variable              variable;
+
+  for (variable = FIRST_VARIABLE; variable < N_VARIABLES; variable++)
+    {
+      const VariableInfo *variable_info      = &variables[variable];
+      const VariableData *variable_data      = &priv->variables[variable];
+      VariableData        prev_variable_data = *variable_data;
+
+      variable_info->sample_func (dashboard, variable);
+
+      variables_changed = variables_changed ||
+                          memcmp (variable_data, &prev_variable_data,
+                                  sizeof (VariableData));
+    }
+
+  return variables_changed;
+}
+
 static gboolean
 gimp_dashboard_update (GimpDashboard *dashboard)
 {
@@ -1402,6 +2343,37 @@ gimp_dashboard_low_swap_space (GimpDashboard *dashboard)
   return G_SOURCE_REMOVE;
 }
 
+static gboolean
+gimp_dashboard_log_error (GimpDashboard *dashboard)
+{
+  GimpDashboardPrivate *priv  = dashboard->priv;
+  GError               *error;
+
+  g_mutex_lock (&priv->mutex);
+
+  error = priv->log_error;
+
+  priv->log_error         = NULL;
+  priv->log_error_idle_id = 0;
+
+  g_mutex_unlock (&priv->mutex);
+
+  /* the log stream was dropped by the sampler thread, close it here */
+  gimp_dashboard_log_close (dashboard, NULL);
+
+  if (error)
+    {
+      gimp_message (priv->gimp, G_OBJECT (dashboard), GIMP_MESSAGE_ERROR,
+                    _("Error writing performance log '%s':\n%s"),
+                    gimp_file_get_utf8_name (priv->log_file),
+                    error->message);
+
+      g_error_free (error);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 gimp_dashboard_sample_gegl_config (GimpDashboard *dashboard,
                                    Variable       variable)
@@ -1490,70 +2462,331 @@ gimp_dashboard_sample_swap_limit (GimpDashboard *dashboard,
     }
 }
 
-#ifdef HAVE_CPU_GROUP
-
-#ifdef HAVE_SYS_TIMES_H
-
 static void
-gimp_dashboard_sample_cpu_usage (GimpDashboard *dashboard,
-                                 Variable       variable)
+gimp_dashboard_sample_temp_buf_pool (GimpDashboard *dashboard,
+                                     Variable       variable)
 {
-  GimpDashboardPrivate *priv            = dashboard->priv;
-  VariableData         *variable_data   = &priv->variables[variable];
-  static clock_t        prev_clock      = 0;
-  static clock_t        prev_usage;
-  clock_t               curr_clock;
-  clock_t               curr_usage;
-  struct tms            tms;
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+  guint64               total;
+  guint64               pooled;
+  guint64               hits;
+  guint64               misses;
 
-  curr_clock = times (&tms);
+  gimp_temp_buf_get_pool_stats (&total, &pooled, &hits, &misses);
 
-  if (curr_clock == (clock_t) -1)
+  variable_data->available = TRUE;
+
+  switch (variable)
     {
-      prev_clock = 0;
+    case VARIABLE_TEMP_BUF_TOTAL:
+      variable_data->value.size = total;
+      break;
 
-      variable_data->available = FALSE;
+    case VARIABLE_TEMP_BUF_POOLED:
+      variable_data->value.size = pooled;
+      break;
 
-      return;
-    }
+    case VARIABLE_TEMP_BUF_POOL_LIMIT:
+      variable_data->value.size = gimp_temp_buf_get_pool_limit ();
+      break;
 
-  curr_usage = tms.tms_utime + tms.tms_stime;
+    case VARIABLE_TEMP_BUF_POOL_HIT_MISS:
+      /*  only the ratio matters, keep the counts in range  */
+      while (hits > G_MAXINT || misses > G_MAXINT)
+        {
+          hits   /= 2;
+          misses /= 2;
+        }
 
-  if (prev_clock)
-    {
-      variable_data->available         = TRUE;
-      variable_data->value.percentage  = (gdouble) (curr_usage - prev_usage) /
-                                                   (curr_clock - prev_clock);
-      variable_data->value.percentage /= g_get_num_processors ();
-    }
-  else
-    {
-      variable_data->available         = FALSE;
-    }
+      variable_data->value.int_ratio.antecedent = hits;
+      variable_data->value.int_ratio.consequent = misses;
+      break;
 
-  prev_clock = curr_clock;
-  prev_usage = curr_usage;
+    default:
+      g_return_if_reached ();
+    }
 }
 
-#elif defined (G_OS_WIN32)
-
 static void
-gimp_dashboard_sample_cpu_usage (GimpDashboard *dashboard,
-                                 Variable       variable)
+gimp_dashboard_sample_plug_in_stats (GimpDashboard *dashboard,
+                                     Variable       variable)
 {
-  GimpDashboardPrivate *priv            = dashboard->priv;
-  VariableData         *variable_data   = &priv->variables[variable];
-  static guint64        prev_time       = 0;
-  static guint64        prev_usage;
-  guint64               curr_time;
-  guint64               curr_usage;
-  FILETIME              system_time;
-  FILETIME              process_creation_time;
-  FILETIME              process_exit_time;
-  FILETIME              process_kernel_time;
-  FILETIME              process_user_time;
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+  GimpPlugInStats       stats;
 
-  if (! GetProcessTimes (GetCurrentProcess (),
+  variable_data->available = FALSE;
+
+  if (! priv->gimp || ! priv->gimp->plug_in_manager)
+    return;
+
+  /*  treat no runs yet as zero, not as unavailable  */
+  gimp_plug_in_manager_get_stats (priv->gimp->plug_in_manager, NULL, &stats);
+
+  variable_data->available = TRUE;
+
+  switch (variable)
+    {
+    case VARIABLE_PLUG_IN_RUNS:
+      variable_data->value.count = stats.n_runs;
+      break;
+
+    case VARIABLE_PLUG_IN_SPAWN_TIME:
+      variable_data->value.duration = stats.spawn_time;
+      break;
+
+    case VARIABLE_PLUG_IN_HANDSHAKE_TIME:
+      variable_data->value.duration = stats.handshake_time;
+      break;
+
+    case VARIABLE_PLUG_IN_CORE_TIME:
+      variable_data->value.duration = stats.core_time;
+      break;
+
+    case VARIABLE_PLUG_IN_PLUG_IN_TIME:
+      variable_data->value.duration = stats.plug_in_time;
+      break;
+
+    case VARIABLE_PLUG_IN_MESSAGES:
+      variable_data->value.count = stats.n_messages;
+      break;
+
+    case VARIABLE_PLUG_IN_TILES:
+      variable_data->value.count = stats.n_tiles;
+      break;
+
+    case VARIABLE_PLUG_IN_COPIED:
+      variable_data->value.size = stats.bytes_copied;
+      break;
+
+    default:
+      g_return_if_reached ();
+    }
+}
+
+static void
+gimp_dashboard_sample_latency (GimpDashboard *dashboard,
+                               Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  const VariableInfo   *variable_info = &variables[variable];
+  VariableData         *variable_data = &priv->variables[variable];
+  GimpLatency           latency;
+  gdouble               median;
+  gdouble               percentile_95;
+  gdouble               maximum;
+
+  latency = GPOINTER_TO_INT (variable_info->data);
+
+  variable_data->available = gimp_latency_get_stats (latency,
+                                                     &median,
+                                                     &percentile_95,
+                                                     &maximum);
+
+  if (! variable_data->available)
+    return;
+
+  switch (variable)
+    {
+    case VARIABLE_RENDER_FRAME_MEDIAN:
+    case VARIABLE_PAINT_DAB_MEDIAN:
+    case VARIABLE_PAINT_INPUT_MEDIAN:
+      variable_data->value.latency = median;
+      break;
+
+    case VARIABLE_RENDER_FRAME_95TH:
+    case VARIABLE_PAINT_DAB_95TH:
+    case VARIABLE_PAINT_INPUT_95TH:
+      variable_data->value.latency = percentile_95;
+      break;
+
+    case VARIABLE_RENDER_FRAME_MAXIMUM:
+    case VARIABLE_PAINT_DAB_MAXIMUM:
+    case VARIABLE_PAINT_INPUT_MAXIMUM:
+      variable_data->value.latency = maximum;
+      break;
+
+    default:
+      g_return_if_reached ();
+    }
+}
+
+static void
+gimp_dashboard_sample_render_backlog (GimpDashboard *dashboard,
+                                      Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+
+  variable_data->available   = TRUE;
+  variable_data->value.count = gimp_projection_get_render_backlog ();
+}
+
+static void
+gimp_dashboard_sample_undo (GimpDashboard *dashboard,
+                            Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+
+  variable_data->available = FALSE;
+
+  switch (variable)
+    {
+    case VARIABLE_UNDO_OCCUPIED:
+      variable_data->available  = TRUE;
+      variable_data->value.size = gimp_image_undo_get_total_memsize ();
+      break;
+
+    case VARIABLE_UNDO_LIMIT:
+      if (priv->gimp && priv->gimp->config)
+        {
+          variable_data->available  = TRUE;
+          variable_data->value.size = priv->gimp->config->undo_size;
+        }
+      break;
+
+    default:
+      g_return_if_reached ();
+    }
+}
+
+static guint64 allocation_rate_prev_total[GIMP_N_ALLOCATIONS];
+static gint64  allocation_rate_prev_time[GIMP_N_ALLOCATIONS];
+
+static void
+gimp_dashboard_sample_allocation (GimpDashboard *dashboard,
+                                  Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  const VariableInfo   *variable_info = &variables[variable];
+  VariableData         *variable_data = &priv->variables[variable];
+  GimpAllocation        allocation;
+  guint64               live;
+  guint64               total;
+  gint64                curr_time;
+
+  allocation = GPOINTER_TO_INT (variable_info->data);
+
+  gimp_allocation_get_stats (allocation, &live, &total);
+
+  if (variable_info->type == VARIABLE_TYPE_SIZE)
+    {
+      variable_data->available  = TRUE;
+      variable_data->value.size = live;
+
+      return;
+    }
+
+  curr_time = g_get_monotonic_time ();
+
+  if (allocation_rate_prev_time[allocation] &&
+      curr_time > allocation_rate_prev_time[allocation])
+    {
+      variable_data->available  = TRUE;
+      variable_data->value.rate =
+        (gdouble) (total - allocation_rate_prev_total[allocation]) /
+        ((curr_time - allocation_rate_prev_time[allocation]) / 1000000.0);
+    }
+  else
+    {
+      variable_data->available = FALSE;
+    }
+
+  allocation_rate_prev_total[allocation] = total;
+  allocation_rate_prev_time[allocation]  = curr_time;
+}
+
+static void
+gimp_dashboard_reset_allocation (GimpDashboard *dashboard,
+                                 Variable       variable)
+{
+  const VariableInfo *variable_info = &variables[variable];
+  GimpAllocation      allocation;
+
+  allocation = GPOINTER_TO_INT (variable_info->data);
+
+  allocation_rate_prev_time[allocation] = 0;
+}
+
+static void
+gimp_dashboard_sample_startup (GimpDashboard *dashboard,
+                               Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  const VariableInfo   *variable_info = &variables[variable];
+  VariableData         *variable_data = &priv->variables[variable];
+
+  variable_data->available =
+    gimp_startup_get_duration (variable_info->data,
+                               &variable_data->value.latency);
+}
+
+#ifdef HAVE_CPU_GROUP
+
+#ifdef HAVE_SYS_TIMES_H
+
+static void
+gimp_dashboard_sample_cpu_usage (GimpDashboard *dashboard,
+                                 Variable       variable)
+{
+  GimpDashboardPrivate *priv            = dashboard->priv;
+  VariableData         *variable_data   = &priv->variables[variable];
+  static clock_t        prev_clock      = 0;
+  static clock_t        prev_usage;
+  clock_t               curr_clock;
+  clock_t               curr_usage;
+  struct tms            tms;
+
+  curr_clock = times (&tms);
+
+  if (curr_clock == (clock_t) -1)
+    {
+      prev_clock = 0;
+
+      variable_data->available = FALSE;
+
+      return;
+    }
+
+  curr_usage = tms.tms_utime + tms.tms_stime;
+
+  if (prev_clock)
+    {
+      variable_data->available         = TRUE;
+      variable_data->value.percentage  = (gdouble) (curr_usage - prev_usage) /
+                                                   (curr_clock - prev_clock);
+      variable_data->value.percentage /= g_get_num_processors ();
+    }
+  else
+    {
+      variable_data->available         = FALSE;
+    }
+
+  prev_clock = curr_clock;
+  prev_usage = curr_usage;
+}
+
+#elif defined (G_OS_WIN32)
+
+static void
+gimp_dashboard_sample_cpu_usage (GimpDashboard *dashboard,
+                                 Variable       variable)
+{
+  GimpDashboardPrivate *priv            = dashboard->priv;
+  VariableData         *variable_data   = &priv->variables[variable];
+  static guint64        prev_time       = 0;
+  static guint64        prev_usage;
+  guint64               curr_time;
+  guint64               curr_usage;
+  FILETIME              system_time;
+  FILETIME              process_creation_time;
+  FILETIME              process_exit_time;
+  FILETIME              process_kernel_time;
+  FILETIME              process_user_time;
+
+  if (! GetProcessTimes (GetCurrentProcess (),
                          &process_creation_time,
                          &process_exit_time,
                          &process_kernel_time,
@@ -1698,6 +2931,17 @@ gimp_dashboard_sample_object (GimpDashboard *dashboard,
         }
       break;
 
+    case VARIABLE_TYPE_COUNT:
+      if (g_object_class_find_property (klass, variable_info->data))
+        {
+          variable_data->available = TRUE;
+
+          g_object_get (object,
+                        variable_info->data, &variable_data->value.count,
+                        NULL);
+        }
+      break;
+
     case VARIABLE_TYPE_SIZE:
       if (g_object_class_find_property (klass, variable_info->data))
         {
@@ -1766,6 +3010,28 @@ gimp_dashboard_sample_object (GimpDashboard *dashboard,
                         NULL);
         }
       break;
+
+    case VARIABLE_TYPE_LATENCY:
+      if (g_object_class_find_property (klass, variable_info->data))
+        {
+          variable_data->available = TRUE;
+
+          g_object_get (object,
+                        variable_info->data, &variable_data->value.latency,
+                        NULL);
+        }
+      break;
+
+    case VARIABLE_TYPE_RATE:
+      if (g_object_class_find_property (klass, variable_info->data))
+        {
+          variable_data->available = TRUE;
+
+          g_object_get (object,
+                        variable_info->data, &variable_data->value.rate,
+                        NULL);
+        }
+      break;
     }
 }
 
@@ -2079,6 +3345,9 @@ gimp_dashboard_variable_to_boolean (GimpDashboard *dashboard,
         case VARIABLE_TYPE_BOOLEAN:
           return variable_data->value.boolean;
 
+        case VARIABLE_TYPE_COUNT:
+          return variable_data->value.count > 0;
+
         case VARIABLE_TYPE_SIZE:
           return variable_data->value.size > 0;
 
@@ -2095,6 +3364,12 @@ gimp_dashboard_variable_to_boolean (GimpDashboard *dashboard,
 
         case VARIABLE_TYPE_DURATION:
           return variable_data->value.duration != 0.0;
+
+        case VARIABLE_TYPE_LATENCY:
+          return variable_data->value.latency != 0.0;
+
+        case VARIABLE_TYPE_RATE:
+          return variable_data->value.rate != 0.0;
         }
     }
 
@@ -2116,6 +3391,9 @@ gimp_dashboard_variable_to_double (GimpDashboard *dashboard,
         case VARIABLE_TYPE_BOOLEAN:
           return variable_data->value.boolean ? 1.0 : 0.0;
 
+        case VARIABLE_TYPE_COUNT:
+          return variable_data->value.count;
+
         case VARIABLE_TYPE_SIZE:
           return variable_data->value.size;
 
@@ -2140,6 +3418,12 @@ gimp_dashboard_variable_to_double (GimpDashboard *dashboard,
 
         case VARIABLE_TYPE_DURATION:
           return variable_data->value.duration;
+
+        case VARIABLE_TYPE_LATENCY:
+          return variable_data->value.latency;
+
+        case VARIABLE_TYPE_RATE:
+          return variable_data->value.rate;
         }
     }
 
@@ -2172,6 +3456,12 @@ gimp_dashboard_field_to_string (GimpDashboard *dashboard,
                                                C_("dashboard-value", "No");
           break;
 
+        case VARIABLE_TYPE_COUNT:
+          str        = g_strdup_printf ("%" G_GUINT64_FORMAT,
+                                        variable_data->value.count);
+          static_str = FALSE;
+          break;
+
         case VARIABLE_TYPE_SIZE:
           str        = g_format_size_full (variable_data->value.size,
                                            G_FORMAT_SIZE_IEC_UNITS);
@@ -2242,6 +3532,30 @@ gimp_dashboard_field_to_string (GimpDashboard *dashboard,
           static_str = FALSE;
           show_limit = FALSE;
           break;
+
+        case VARIABLE_TYPE_LATENCY:
+          /* Translators: "ms" is an abbreviation for "milliseconds" */
+          str        = g_strdup_printf (C_("dashboard-value", "%.1f ms"),
+                                        1000.0 * variable_data->value.latency);
+          static_str = FALSE;
+          show_limit = FALSE;
+          break;
+
+        case VARIABLE_TYPE_RATE:
+          {
+            gchar *size;
+
+            size = g_format_size_full (MAX (variable_data->value.rate, 0.0),
+                                       G_FORMAT_SIZE_IEC_UNITS);
+
+            /* Translators: "/s" is an abbreviation for "per second" */
+            str        = g_strdup_printf (C_("dashboard-value", "%s/s"), size);
+            static_str = FALSE;
+            show_limit = FALSE;
+
+            g_free (size);
+          }
+          break;
         }
 
       if (show_limit               &&
@@ -2295,38 +3609,555 @@ gimp_dashboard_label_set_text (GtkLabel    *label,
 }
 
 
-/*  public functions  */
-
+/*  the performance log is a sequence of little-endian records, following
+ *  a header listing the names of the sampled variables:
+ *
+ *    "GIMPPLOG" <version: u32> <n-variables: u32> <name: string> ...
+ *
+ *  'M' <real time: i64, us> <sample interval: u32, ms>
+ *      starts a recording, either the first one or a resumed one
+ *  'S' <time since 'M': i64, us> <value: f64> ...
+ *      a sample of all variables, NaN for unavailable ones
+ *  'A' <address: u64> <symbol: string>
+ *      the symbol of an address, given once per recording
+ *  'B' <n-frames: u16> <address: u64> ...
+ *      the main thread's stack at the preceding sample, innermost first
+ *
+ *  strings are a u16 length followed by that many bytes.  a record that
+ *  was cut short, by a crash for example, ends the log.
+ */
 
-GtkWidget *
-gimp_dashboard_new (Gimp            *gimp,
-                    GimpMenuFactory *menu_factory)
+static void
+gimp_dashboard_log_sample (GimpDashboard *dashboard)
 {
-  GimpDashboard *dashboard;
-
-  dashboard = g_object_new (GIMP_TYPE_DASHBOARD,
-                            "menu-factory",    menu_factory,
-                            "menu-identifier", "<Dashboard>",
-                            "ui-path",         "/dashboard-popup",
-                            NULL);
+  GimpDashboardPrivate *priv   = dashboard->priv;
+  GDataOutputStream    *output = priv->log_output;
+  guintptr              frames[GIMP_STACK_SAMPLER_MAX_FRAMES];
+  gint                  n_frames = 0;
+  Variable              variable;
+  GError               *error    = NULL;
+  gboolean              success;
+  gint                  i;
 
-  dashboard->priv->gimp = gimp;
+  if (priv->log_stack_sampling)
+    n_frames = gimp_stack_sampler_sample (frames, G_N_ELEMENTS (frames));
 
-  return GTK_WIDGET (dashboard);
-}
+  success =
+    g_data_output_stream_put_byte  (output, 'S', NULL, &error) &&
+    g_data_output_stream_put_int64 (output,
+                                    g_get_monotonic_time () -
+                                    priv->log_start_time,
+                                    NULL, &error);
 
-void
-gimp_dashboard_reset (GimpDashboard *dashboard)
-{
-  GimpDashboardPrivate *priv;
-  Variable              variable;
-  Group                 group;
+  for (variable = FIRST_VARIABLE;
+       success && variable < N_VARIABLES;
+       variable++)
+    {
+      gdouble value = NAN;
 
-  g_return_if_fail (GIMP_IS_DASHBOARD (dashboard));
+      if (priv->variables[variable].available)
+        value = gimp_dashboard_variable_to_double (dashboard, variable);
 
-  priv = dashboard->priv;
+      success = gimp_dashboard_log_put_double (output, value, &error);
+    }
 
-  g_mutex_lock (&priv->mutex);
+  for (i = 0; success && i < n_frames; i++)
+    {
+      gchar *symbol;
+
+      if (g_hash_table_contains (priv->log_addresses,
+                                 (gpointer) frames[i]))
+        {
+          continue;
+        }
+
+      symbol = gimp_stack_sampler_get_symbol (frames[i]);
+
+      success =
+        g_data_output_stream_put_byte   (output, 'A', NULL, &error) &&
+        g_data_output_stream_put_uint64 (output, frames[i], NULL, &error) &&
+        gimp_dashboard_log_put_string   (output, symbol ? symbol : "",
+                                         &error);
+
+      g_free (symbol);
+
+      g_hash_table_add (priv->log_addresses, (gpointer) frames[i]);
+    }
+
+  if (success && n_frames > 0)
+    {
+      success =
+        g_data_output_stream_put_byte   (output, 'B', NULL, &error) &&
+        g_data_output_stream_put_uint16 (output, n_frames, NULL, &error);
+
+      for (i = 0; success && i < n_frames; i++)
+        {
+          success = g_data_output_stream_put_uint64 (output, frames[i],
+                                                     NULL, &error);
+        }
+    }
+
+  /* keep the log on disk up to date, in case we crash */
+  success = success &&
+            g_output_stream_flush (G_OUTPUT_STREAM (output), NULL, &error);
+
+  if (! success)
+    {
+      /* stop recording, and let the main thread close the log and
+       * report the error
+       */
+      g_clear_object (&priv->log_output);
+
+      g_clear_error (&priv->log_error);
+      priv->log_error = error;
+
+      if (! priv->log_error_idle_id)
+        {
+          priv->log_error_idle_id =
+            g_idle_add_full (G_PRIORITY_DEFAULT,
+                             (GSourceFunc) gimp_dashboard_log_error,
+                             dashboard, NULL);
+        }
+    }
+}
+
+static gboolean
+gimp_dashboard_log_close (GimpDashboard  *dashboard,
+                          GError        **error)
+{
+  GimpDashboardPrivate *priv = dashboard->priv;
+  GDataOutputStream    *output;
+  GIOStream            *iostream;
+  gboolean              stack_sampling;
+  gboolean              success = TRUE;
+
+  g_mutex_lock (&priv->mutex);
+
+  output         = priv->log_output;
+  iostream       = priv->log_iostream;
+  stack_sampling = priv->log_stack_sampling;
+
+  priv->log_output         = NULL;
+  priv->log_iostream       = NULL;
+  priv->log_stack_sampling = FALSE;
+
+  g_clear_pointer (&priv->log_addresses, g_hash_table_unref);
+
+  g_mutex_unlock (&priv->mutex);
+
+  if (stack_sampling)
+    gimp_stack_sampler_exit ();
+
+  if (output)
+    {
+      success = g_output_stream_close (G_OUTPUT_STREAM (output),
+                                       NULL, error);
+
+      g_object_unref (output);
+    }
+
+  if (iostream)
+    {
+      if (success)
+        success = g_io_stream_close (iostream, NULL, error);
+
+      g_object_unref (iostream);
+    }
+
+  return success;
+}
+
+static gboolean
+gimp_dashboard_log_put_string (GDataOutputStream  *output,
+                               const gchar        *string,
+                               GError            **error)
+{
+  gsize length = MIN (strlen (string), G_MAXUINT16);
+
+  return g_data_output_stream_put_uint16 (output, length, NULL, error) &&
+         g_output_stream_write_all (G_OUTPUT_STREAM (output),
+                                    string, length, NULL, NULL, error);
+}
+
+static gboolean
+gimp_dashboard_log_put_double (GDataOutputStream  *output,
+                               gdouble             value,
+                               GError            **error)
+{
+  union
+  {
+    gdouble d;
+    guint64 u;
+  } v;
+
+  v.d = value;
+
+  return g_data_output_stream_put_uint64 (output, v.u, NULL, error);
+}
+
+static gchar *
+gimp_dashboard_log_get_string (GDataInputStream  *input,
+                               GError           **error)
+{
+  GError *my_error = NULL;
+  guint16 length;
+  gchar  *string;
+  gsize   n_read;
+
+  length = g_data_input_stream_read_uint16 (input, NULL, &my_error);
+
+  if (my_error)
+    {
+      g_propagate_error (error, my_error);
+
+      return NULL;
+    }
+
+  string = g_malloc (length + 1);
+
+  if (! g_input_stream_read_all (G_INPUT_STREAM (input),
+                                 string, length, &n_read, NULL, error))
+    {
+      g_free (string);
+
+      return NULL;
+    }
+
+  if (n_read < length)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                           _("Unexpected end of file"));
+      g_free (string);
+
+      return NULL;
+    }
+
+  string[length] = '\0';
+
+  return string;
+}
+
+/* reads the log from @base_input, and, if @output is not NULL, writes it
+ * to @output as text.  returns the variable names listed in the log in
+ * @names, and the offset past the last complete record in @end.
+ */
+static gboolean
+gimp_dashboard_log_read (GInputStream   *base_input,
+                         GOutputStream  *output,
+                         gchar        ***names,
+                         goffset        *end,
+                         GError        **error)
+{
+  GDataInputStream  *input;
+  GHashTable        *symbols;
+  GString           *text;
+  gchar              magic[sizeof (LOG_MAGIC) - 1];
+  gchar            **variable_names = NULL;
+  guint32            n_variables    = 0;
+  guint32            version;
+  gint               n_recordings   = 0;
+  gsize              n_read;
+  goffset            offset;
+  GError            *my_error       = NULL;
+  gboolean           success        = FALSE;
+  guint32            i;
+
+  input = g_data_input_stream_new (base_input);
+
+  g_filter_input_stream_set_close_base_stream (G_FILTER_INPUT_STREAM (input),
+                                               FALSE);
+  g_data_input_stream_set_byte_order (input,
+                                      G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN);
+
+  symbols = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                   g_free, g_free);
+  text    = g_string_new (NULL);
+
+  /* header */
+  if (! g_input_stream_read_all (G_INPUT_STREAM (input),
+                                 magic, sizeof (magic), &n_read,
+                                 NULL, error))
+    {
+      goto out;
+    }
+
+  if (n_read < sizeof (magic) || memcmp (magic, LOG_MAGIC, sizeof (magic)))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                           _("Not a performance log"));
+      goto out;
+    }
+
+  version = g_data_input_stream_read_uint32 (input, NULL, &my_error);
+
+  if (! my_error && version != LOG_VERSION)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   _("Unsupported performance log version %u"),
+                   version);
+      goto out;
+    }
+
+  if (! my_error)
+    n_variables = g_data_input_stream_read_uint32 (input, NULL, &my_error);
+
+  if (! my_error && n_variables > G_MAXUINT16)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                           _("Not a performance log"));
+      goto out;
+    }
+
+  offset = sizeof (magic) + 4 + 4;
+
+  variable_names = g_new0 (gchar *, n_variables + 1);
+
+  for (i = 0; ! my_error && i < n_variables; i++)
+    {
+      variable_names[i] = gimp_dashboard_log_get_string (input, &my_error);
+
+      if (variable_names[i])
+        offset += 2 + strlen (variable_names[i]);
+    }
+
+  if (my_error)
+    {
+      g_propagate_error (error, my_error);
+      goto out;
+    }
+
+  /* records */
+  *end = offset;
+
+  while (TRUE)
+    {
+      guchar type;
+      gsize  size = 0;
+
+      if (g_input_stream_read (G_INPUT_STREAM (input), &type, 1,
+                               NULL, NULL) != 1)
+        {
+          break;
+        }
+
+      g_string_truncate (text, 0);
+
+      switch (type)
+        {
+        case 'M':
+          {
+            gint64     real_time;
+            GDateTime *date_time;
+            gchar     *date;
+
+            real_time = g_data_input_stream_read_int64 (input, NULL, &my_error);
+
+            if (! my_error)
+              g_data_input_stream_read_uint32 (input, NULL, &my_error);
+
+            size = 1 + 8 + 4;
+
+            g_hash_table_remove_all (symbols);
+
+            date_time = g_date_time_new_from_unix_local (
+              real_time / G_TIME_SPAN_SECOND);
+
+            if (date_time)
+              {
+                date = g_date_time_format (date_time, "%Y-%m-%d %H:%M:%S");
+
+                g_date_time_unref (date_time);
+              }
+            else
+              {
+                date = g_strdup ("?");
+              }
+
+            g_string_append_printf (text,
+                                    "%s# Recording started at %s\n"
+                                    "time",
+                                    n_recordings++ ? "\n" : "",
+                                    date);
+
+            for (i = 0; i < n_variables; i++)
+              g_string_append_printf (text, "\t%s", variable_names[i]);
+
+            g_string_append_c (text, '\n');
+
+            g_free (date);
+          }
+          break;
+
+        case 'S':
+          {
+            gchar  buffer[G_ASCII_DTOSTR_BUF_SIZE];
+            gint64 sample_time;
+
+            sample_time = g_data_input_stream_read_int64 (input, NULL,
+                                                          &my_error);
+
+            g_string_append (text,
+                             g_ascii_formatd (buffer, sizeof (buffer),
+                                              "%.3f",
+                                              (gdouble) sample_time /
+                                              G_TIME_SPAN_SECOND));
+
+            for (i = 0; ! my_error && i < n_variables; i++)
+              {
+                union
+                {
+                  gdouble d;
+                  guint64 u;
+                } v;
+
+                v.u = g_data_input_stream_read_uint64 (input, NULL, &my_error);
+
+                if (isnan (v.d))
+                  g_string_append (text, "\t-");
+                else
+                  g_string_append_printf (text, "\t%s",
+                                          g_ascii_formatd (buffer,
+                                                           sizeof (buffer),
+                                                           "%g", v.d));
+              }
+
+            g_string_append_c (text, '\n');
+
+            size = 1 + 8 + 8 * n_variables;
+          }
+          break;
+
+        case 'A':
+          {
+            gint64 *address = g_new (gint64, 1);
+            gchar  *symbol  = NULL;
+
+            *address = g_data_input_stream_read_uint64 (input, NULL, &my_error);
+
+            if (! my_error)
+              symbol = gimp_dashboard_log_get_string (input, &my_error);
+
+            if (symbol)
+              {
+                size = 1 + 8 + 2 + strlen (symbol);
+
+                g_hash_table_replace (symbols, address, symbol);
+              }
+            else
+              {
+                g_free (address);
+              }
+          }
+          break;
+
+        case 'B':
+          {
+            guint16 n_frames;
+
+            n_frames = g_data_input_stream_read_uint16 (input, NULL, &my_error);
+
+            for (i = 0; ! my_error && i < n_frames; i++)
+              {
+                gint64       address;
+                const gchar *symbol;
+
+                address = g_data_input_stream_read_uint64 (input, NULL,
+                                                           &my_error);
+                symbol  = g_hash_table_lookup (symbols, &address);
+
+                if (symbol && *symbol)
+                  g_string_append_printf (text, "\t#%u  %s\n", i, symbol);
+                else
+                  g_string_append_printf (text, "\t#%u  0x%" G_GINT64_MODIFIER "x\n",
+                                          i, address);
+              }
+
+            size = 1 + 2 + 8 * n_frames;
+          }
+          break;
+
+        default:
+          g_set_error (&my_error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                       _("Invalid record in performance log"));
+          break;
+        }
+
+      /* a record that was cut short ends the log */
+      if (my_error)
+        {
+          g_clear_error (&my_error);
+          break;
+        }
+
+      if (output &&
+          ! g_output_stream_write_all (output, text->str, text->len,
+                                       NULL, NULL, error))
+        {
+          goto out;
+        }
+
+      offset += size;
+      *end    = offset;
+    }
+
+  success = TRUE;
+
+  if (names)
+    {
+      *names         = variable_names;
+      variable_names = NULL;
+    }
+
+ out:
+  g_strfreev (variable_names);
+  g_string_free (text, TRUE);
+  g_hash_table_unref (symbols);
+  g_object_unref (input);
+
+  return success;
+}
+
+
+/*  public functions  */
+
+
+GtkWidget *
+gimp_dashboard_new (Gimp            *gimp,
+                    GimpMenuFactory *menu_factory)
+{
+  GimpDashboard *dashboard;
+
+  dashboard = g_object_new (GIMP_TYPE_DASHBOARD,
+                            "menu-factory",    menu_factory,
+                            "menu-identifier", "<Dashboard>",
+                            "ui-path",         "/dashboard-popup",
+                            NULL);
+
+  dashboard->priv->gimp = gimp;
+
+  return GTK_WIDGET (dashboard);
+}
+
+Gimp *
+gimp_dashboard_get_gimp (GimpDashboard *dashboard)
+{
+  g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), NULL);
+
+  return dashboard->priv->gimp;
+}
+
+void
+gimp_dashboard_reset (GimpDashboard *dashboard)
+{
+  GimpDashboardPrivate *priv;
+  Variable              variable;
+  Group                 group;
+
+  g_return_if_fail (GIMP_IS_DASHBOARD (dashboard));
+
+  priv = dashboard->priv;
+
+  g_mutex_lock (&priv->mutex);
 
   gegl_reset_stats ();
 
@@ -2467,3 +4298,247 @@ gimp_dashboard_get_low_swap_space_warning (GimpDashboard *dashboard)
 
   return dashboard->priv->low_swap_space_warning;
 }
+
+gboolean
+gimp_dashboard_log_start_recording (GimpDashboard  *dashboard,
+                                    GFile          *file,
+                                    GError        **error)
+{
+  GimpDashboardPrivate *priv;
+  GFileIOStream        *iostream;
+  GOutputStream        *buffered;
+  GDataOutputStream    *output;
+  GFileInfo            *info;
+  gboolean              resume  = FALSE;
+  gboolean              success = TRUE;
+  Variable              variable;
+
+  g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), FALSE);
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (! gimp_dashboard_log_is_recording (dashboard), FALSE);
+
+  priv = dashboard->priv;
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+  if (info)
+    {
+      resume = g_file_info_get_size (info) > 0;
+
+      g_object_unref (info);
+    }
+
+  if (resume)
+    {
+      GInputStream  *input;
+      gchar        **names;
+      goffset        end;
+
+      iostream = g_file_open_readwrite (file, NULL, error);
+
+      if (! iostream)
+        return FALSE;
+
+      input = g_io_stream_get_input_stream (G_IO_STREAM (iostream));
+
+      success = gimp_dashboard_log_read (input, NULL, &names, &end, error);
+
+      if (success)
+        {
+          success = g_strv_length (names) == N_VARIABLES - FIRST_VARIABLE;
+
+          for (variable = FIRST_VARIABLE;
+               success && variable < N_VARIABLES;
+               variable++)
+            {
+              success = ! strcmp (names[variable - FIRST_VARIABLE],
+                                  variables[variable].name);
+            }
+
+          if (! success)
+            {
+              g_set_error_literal (error,
+                                   G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                                   _("The performance log was recorded by a "
+                                     "different version of GIMP, and can't "
+                                     "be resumed."));
+            }
+
+          g_strfreev (names);
+        }
+
+      /* drop a record that was cut short, and append to the rest */
+      success = success &&
+                g_seekable_truncate (G_SEEKABLE (iostream), end,
+                                     NULL, error) &&
+                g_seekable_seek (G_SEEKABLE (iostream), end, G_SEEK_SET,
+                                 NULL, error);
+    }
+  else
+    {
+      iostream = g_file_replace_readwrite (file, NULL, FALSE,
+                                           G_FILE_CREATE_NONE, NULL, error);
+
+      if (! iostream)
+        return FALSE;
+    }
+
+  buffered = g_buffered_output_stream_new (
+    g_io_stream_get_output_stream (G_IO_STREAM (iostream)));
+  output   = g_data_output_stream_new (buffered);
+  g_object_unref (buffered);
+
+  g_data_output_stream_set_byte_order (output,
+                                       G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN);
+
+  if (success && ! resume)
+    {
+      success =
+        g_output_stream_write_all (G_OUTPUT_STREAM (output),
+                                   LOG_MAGIC, strlen (LOG_MAGIC),
+                                   NULL, NULL, error) &&
+        g_data_output_stream_put_uint32 (output, LOG_VERSION, NULL, error) &&
+        g_data_output_stream_put_uint32 (output,
+                                         N_VARIABLES - FIRST_VARIABLE,
+                                         NULL, error);
+
+      for (variable = FIRST_VARIABLE;
+           success && variable < N_VARIABLES;
+           variable++)
+        {
+          success = gimp_dashboard_log_put_string (output,
+                                                   variables[variable].name,
+                                                   error);
+        }
+    }
+
+  success =
+    success &&
+    g_data_output_stream_put_byte   (output, 'M', NULL, error) &&
+    g_data_output_stream_put_int64  (output, g_get_real_time (),
+                                     NULL, error) &&
+    g_data_output_stream_put_uint32 (output,
+                                     LOG_SAMPLE_INTERVAL / 1000,
+                                     NULL, error) &&
+    g_output_stream_flush (G_OUTPUT_STREAM (output), NULL, error);
+
+  if (! success)
+    {
+      g_object_unref (output);
+      g_io_stream_close (G_IO_STREAM (iostream), NULL, NULL);
+      g_object_unref (iostream);
+
+      return FALSE;
+    }
+
+  g_mutex_lock (&priv->mutex);
+
+  g_set_object (&priv->log_file, file);
+
+  priv->log_iostream       = G_IO_STREAM (iostream);
+  priv->log_output         = output;
+  priv->log_stack_sampling = gimp_stack_sampler_init ();
+  priv->log_start_time     = g_get_monotonic_time ();
+  priv->log_sample_time    = priv->log_start_time;
+  priv->log_addresses      = g_hash_table_new (NULL, NULL);
+
+  g_cond_signal (&priv->cond);
+
+  g_mutex_unlock (&priv->mutex);
+
+  return TRUE;
+}
+
+gboolean
+gimp_dashboard_log_stop_recording (GimpDashboard  *dashboard,
+                                   GError        **error)
+{
+  g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  return gimp_dashboard_log_close (dashboard, error);
+}
+
+gboolean
+gimp_dashboard_log_is_recording (GimpDashboard *dashboard)
+{
+  g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), FALSE);
+
+  return dashboard->priv->log_iostream != NULL;
+}
+
+GFile *
+gimp_dashboard_log_get_file (GimpDashboard *dashboard)
+{
+  g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), NULL);
+
+  return dashboard->priv->log_file;
+}
+
+gboolean
+gimp_dashboard_log_export (GimpDashboard  *dashboard,
+                           GFile          *file,
+                           GError        **error)
+{
+  GimpDashboardPrivate *priv;
+  GInputStream         *input;
+  GOutputStream        *output;
+  goffset               end;
+  gboolean              success;
+
+  g_return_val_if_fail (GIMP_IS_DASHBOARD (dashboard), FALSE);
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (dashboard->priv->log_file != NULL, FALSE);
+
+  priv = dashboard->priv;
+
+  /* export what was recorded so far, if still recording */
+  g_mutex_lock (&priv->mutex);
+
+  if (priv->log_output)
+    g_output_stream_flush (G_OUTPUT_STREAM (priv->log_output), NULL, NULL);
+
+  g_mutex_unlock (&priv->mutex);
+
+  input = G_INPUT_STREAM (g_file_read (priv->log_file, NULL, error));
+
+  if (! input)
+    return FALSE;
+
+  output = G_OUTPUT_STREAM (g_file_replace (file,
+                                            NULL, FALSE, G_FILE_CREATE_NONE,
+                                            NULL, error));
+
+  if (! output)
+    {
+      g_object_unref (input);
+
+      return FALSE;
+    }
+
+  success = gimp_dashboard_log_read (input, output, NULL, &end, error);
+
+  if (success)
+    {
+      success = g_output_stream_close (output, NULL, error);
+    }
+  else
+    {
+      GCancellable *cancellable = g_cancellable_new ();
+
+      /* closing with a cancelled cancellable leaves an existing file
+       * untouched
+       */
+      g_cancellable_cancel (cancellable);
+      g_output_stream_close (output, cancellable, NULL);
+      g_object_unref (cancellable);
+    }
+
+  g_object_unref (output);
+  g_object_unref (input);
+
+  return success;
+}
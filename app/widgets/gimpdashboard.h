@@ -54,6 +54,8 @@ GType                          gimp_dashboard_get_type                   (void)
 GtkWidget                    * gimp_dashboard_new                        (Gimp                         *gimp,
                                                                           GimpMenuFactory              *menu_factory);
 
+Gimp                         * gimp_dashboard_get_gimp                   (GimpDashboard                *dashboard);
+
 void                           gimp_dashboard_reset                      (GimpDashboard                *dashboard);
 
 void                           gimp_dashboard_set_update_interval        (GimpDashboard                *dashboard,
@@ -68,5 +70,17 @@ void                           gimp_dashboard_set_low_swap_space_warning (GimpDa
                                                                           gboolean                      low_swap_space_warning);
 gboolean                       gimp_dashboard_get_low_swap_space_warning (GimpDashboard                *dashboard);
 
+gboolean                       gimp_dashboard_log_start_recording        (GimpDashboard                *dashboard,
+                                                                          GFile                        *file,
+                                                                          GError                      **error);
+gboolean                       gimp_dashboard_log_stop_recording         (GimpDashboard                *dashboard,
+                                                                          GError                      **error);
+gboolean                       gimp_dashboard_log_is_recording           (GimpDashboard                *dashboard);
+GFile                        * gimp_dashboard_log_get_file               (GimpDashboard                *dashboard);
+
+gboolean                       gimp_dashboard_log_export                 (GimpDashboard                *dashboard,
+                                                                          GFile                        *file,
+                                                                          GError                      **error);
+
 
 #endif  /*  __GIMP_DASHBOARD_H__  */
@@ -141,35 +141,33 @@ gimp_gradient_select_run_callback (GimpPdbDialog  *dialog,
                                    gboolean        closing,
                                    GError        **error)
 {
-  GimpGradient        *gradient = GIMP_GRADIENT (object);
-  GimpGradientSegment *seg      = NULL;
-  gdouble             *values, *pv;
-  gdouble              pos, delta;
-  GimpRGB              color;
-  gint                 i;
-  GimpArray           *array;
-  GimpValueArray      *return_vals;
-
-  i      = GIMP_GRADIENT_SELECT (dialog)->sample_size;
-  pos    = 0.0;
-  delta  = 1.0 / (i - 1);
-
-  values = g_new (gdouble, 4 * i);
+  GimpGradient   *gradient = GIMP_GRADIENT (object);
+  gdouble        *values, *pv;
+  GimpRGB        *colors;
+  gint            n_samples;
+  gint            i;
+  GimpArray      *array;
+  GimpValueArray *return_vals;
+
+  n_samples = GIMP_GRADIENT_SELECT (dialog)->sample_size;
+
+  values = g_new (gdouble, 4 * n_samples);
+  colors = g_new (GimpRGB, n_samples);
   pv     = values;
 
-  while (i--)
-    {
-      seg = gimp_gradient_get_color_at (gradient, dialog->caller_context,
-                                        seg, pos, FALSE, &color);
-
-      *pv++ = color.r;
-      *pv++ = color.g;
-      *pv++ = color.b;
-      *pv++ = color.a;
+  gimp_gradient_get_uniform_colors (gradient, dialog->caller_context,
+                                    0.0, 1.0, n_samples, FALSE, colors);
 
-      pos += delta;
+  for (i = 0; i < n_samples; i++)
+    {
+      *pv++ = colors[i].r;
+      *pv++ = colors[i].g;
+      *pv++ = colors[i].b;
+      *pv++ = colors[i].a;
     }
 
+  g_free (colors);
+
   array = gimp_array_new ((guint8 *) values,
                           GIMP_GRADIENT_SELECT (dialog)->sample_size * 4 *
                           sizeof (gdouble),
@@ -669,6 +669,8 @@
 #define GIMP_HELP_DASHBOARD_HISTORY_DURATION      "gimp-dashboard-history-duration"
 #define GIMP_HELP_DASHBOARD_RESET                 "gimp-dashboard-reset"
 #define GIMP_HELP_DASHBOARD_LOW_SWAP_SPACE_WARNING "gimp-dashboard-low-swap-space-warning"
+#define GIMP_HELP_DASHBOARD_LOG_RECORD            "gimp-dashboard-log-record"
+#define GIMP_HELP_DASHBOARD_LOG_EXPORT            "gimp-dashboard-log-export"
 
 #define GIMP_HELP_DOCK                            "gimp-dock"
 #define GIMP_HELP_DOCK_CLOSE                      "gimp-dock-close"
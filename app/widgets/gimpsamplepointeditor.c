@@ -43,7 +43,8 @@
 #include "gimp-intl.h"
 
 
-#define N_POINTS 4
+#define N_POINTS        4
+#define UPDATE_INTERVAL 16 /* milliseconds, about one frame at 60 Hz */
 
 
 enum
@@ -452,12 +453,17 @@ gimp_sample_point_editor_dirty (GimpSamplePointEditor *editor,
   if (index >= 0)
     editor->dirty[index] = TRUE;
 
-  if (editor->dirty_idle_id)
-    g_source_remove (editor->dirty_idle_id);
-
-  editor->dirty_idle_id =
-    g_idle_add ((GSourceFunc) gimp_sample_point_editor_update,
-                editor);
+  /*  coalesce all updates arriving within a frame, instead of
+   *  postponing the update for as long as they keep arriving, which
+   *  would stall the colors while painting
+   */
+  if (! editor->dirty_idle_id)
+    {
+      editor->dirty_idle_id =
+        g_timeout_add (UPDATE_INTERVAL,
+                       (GSourceFunc) gimp_sample_point_editor_update,
+                       editor);
+    }
 }
 
 static gboolean
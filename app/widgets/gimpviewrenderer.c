@@ -53,6 +53,13 @@
 #include "gimp-priorities.h"
 
 
+/*  invalidated previews are re-rendered at most this many times per
+ *  second, so that a stream of invalidations (e.g. while painting)
+ *  doesn't keep the views busy
+ */
+#define MAX_UPDATES_PER_SECOND 8
+
+
 enum
 {
   UPDATE,
@@ -71,6 +78,7 @@ struct _GimpViewRendererPrivate
 
   gboolean            needs_render;
   guint               idle_id;
+  gint64              last_update;
 };
 
 
@@ -565,20 +573,37 @@ gimp_view_renderer_set_color_config (GimpViewRenderer *renderer,
 void
 gimp_view_renderer_invalidate (GimpViewRenderer *renderer)
 {
+  gint64 delay;
+
   g_return_if_fail (GIMP_IS_VIEW_RENDERER (renderer));
 
+  GIMP_VIEW_RENDERER_GET_CLASS (renderer)->invalidate (renderer);
+
+  /*  an update is already pending, it will pick up this invalidation
+   *  as well
+   */
   if (renderer->priv->idle_id)
-    {
-      g_source_remove (renderer->priv->idle_id);
-      renderer->priv->idle_id = 0;
-    }
+    return;
 
-  GIMP_VIEW_RENDERER_GET_CLASS (renderer)->invalidate (renderer);
+  delay = renderer->priv->last_update +
+          G_USEC_PER_SEC / MAX_UPDATES_PER_SECOND -
+          g_get_monotonic_time ();
 
-  renderer->priv->idle_id =
-    g_idle_add_full (GIMP_PRIORITY_VIEWABLE_IDLE,
-                     (GSourceFunc) gimp_view_renderer_idle_update,
-                     renderer, NULL);
+  if (delay > 0)
+    {
+      renderer->priv->idle_id =
+        g_timeout_add_full (GIMP_PRIORITY_VIEWABLE_IDLE,
+                            (delay + 999) / 1000,
+                            (GSourceFunc) gimp_view_renderer_idle_update,
+                            renderer, NULL);
+    }
+  else
+    {
+      renderer->priv->idle_id =
+        g_idle_add_full (GIMP_PRIORITY_VIEWABLE_IDLE,
+                         (GSourceFunc) gimp_view_renderer_idle_update,
+                         renderer, NULL);
+    }
 }
 
 void
@@ -592,6 +617,8 @@ gimp_view_renderer_update (GimpViewRenderer *renderer)
       renderer->priv->idle_id = 0;
     }
 
+  renderer->priv->last_update = g_get_monotonic_time ();
+
   g_signal_emit (renderer, renderer_signals[UPDATE], 0);
 }
 
@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gegl.h>
 #include <gtk/gtk.h>
 
@@ -36,8 +38,43 @@
 #include "gimpviewrendererdrawable.h"
 
 
-static void   gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
-                                                  GtkWidget        *widget);
+typedef struct
+{
+  GimpDrawable *drawable;
+  gint          src_x;
+  gint          src_y;
+  gint          src_width;
+  gint          src_height;
+  gint          dest_width;
+  gint          dest_height;
+} PreviewKey;
+
+struct _GimpViewRendererDrawablePrivate
+{
+  GCancellable *cancellable;
+  PreviewKey    pending_key;
+
+  GimpTempBuf  *render_buf;
+  PreviewKey    render_buf_key;
+  gboolean      render_buf_valid;
+  gboolean      render_buf_ready;
+};
+
+
+static void          gimp_view_renderer_drawable_dispose     (GObject                  *object);
+
+static void          gimp_view_renderer_drawable_invalidate  (GimpViewRenderer         *renderer);
+static void          gimp_view_renderer_drawable_render      (GimpViewRenderer         *renderer,
+                                                              GtkWidget                *widget);
+
+static GimpTempBuf * gimp_view_renderer_drawable_get_preview (GimpViewRendererDrawable *renderer,
+                                                              const PreviewKey         *key,
+                                                              gboolean                 *pending);
+static void          gimp_view_renderer_drawable_preview_ready
+                                                             (GimpDrawable             *drawable,
+                                                              GAsyncResult             *result,
+                                                              GimpViewRendererDrawable *renderer);
+static void          gimp_view_renderer_drawable_cancel      (GimpViewRendererDrawable *renderer);
 
 
 G_DEFINE_TYPE (GimpViewRendererDrawable, gimp_view_renderer_drawable,
@@ -49,14 +86,55 @@ G_DEFINE_TYPE (GimpViewRendererDrawable, gimp_view_renderer_drawable,
 static void
 gimp_view_renderer_drawable_class_init (GimpViewRendererDrawableClass *klass)
 {
+  GObjectClass          *object_class   = G_OBJECT_CLASS (klass);
   GimpViewRendererClass *renderer_class = GIMP_VIEW_RENDERER_CLASS (klass);
 
-  renderer_class->render = gimp_view_renderer_drawable_render;
+  object_class->dispose      = gimp_view_renderer_drawable_dispose;
+
+  renderer_class->invalidate = gimp_view_renderer_drawable_invalidate;
+  renderer_class->render     = gimp_view_renderer_drawable_render;
+
+  g_type_class_add_private (klass, sizeof (GimpViewRendererDrawablePrivate));
 }
 
 static void
 gimp_view_renderer_drawable_init (GimpViewRendererDrawable *renderer)
 {
+  renderer->priv = G_TYPE_INSTANCE_GET_PRIVATE (renderer,
+                                                GIMP_TYPE_VIEW_RENDERER_DRAWABLE,
+                                                GimpViewRendererDrawablePrivate);
+}
+
+static void
+gimp_view_renderer_drawable_dispose (GObject *object)
+{
+  GimpViewRendererDrawable *renderer = GIMP_VIEW_RENDERER_DRAWABLE (object);
+
+  gimp_view_renderer_drawable_cancel (renderer);
+
+  g_clear_pointer (&renderer->priv->render_buf, gimp_temp_buf_unref);
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+gimp_view_renderer_drawable_invalidate (GimpViewRenderer *renderer)
+{
+  GimpViewRendererDrawable *drawable_renderer;
+
+  drawable_renderer = GIMP_VIEW_RENDERER_DRAWABLE (renderer);
+
+  /*  keep the last preview around, to be drawn until the new one is
+   *  ready, unless we are being invalidated because it just got ready
+   */
+  if (! drawable_renderer->priv->render_buf_ready)
+    {
+      gimp_view_renderer_drawable_cancel (drawable_renderer);
+
+      drawable_renderer->priv->render_buf_valid = FALSE;
+    }
+
+  GIMP_VIEW_RENDERER_CLASS (parent_class)->invalidate (renderer);
 }
 
 static void
@@ -76,6 +154,7 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
   gdouble       yres       = 1.0;
   gboolean      scaling_up;
   GimpTempBuf  *render_buf = NULL;
+  gboolean      pending    = FALSE;
 
   drawable = GIMP_DRAWABLE (renderer->viewable);
   item     = GIMP_ITEM (drawable);
@@ -143,8 +222,9 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
                                         &src_x, &src_y,
                                         &src_width, &src_height))
             {
-              gint dest_width;
-              gint dest_height;
+              PreviewKey key;
+              gint       dest_width;
+              gint       dest_height;
 
               dest_width  = ROUND (((gdouble) renderer->width /
                                     (gdouble) gimp_image_get_width (image)) *
@@ -156,10 +236,16 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
               if (dest_width  < 1) dest_width  = 1;
               if (dest_height < 1) dest_height = 1;
 
-              render_buf = gimp_drawable_get_sub_preview (drawable,
-                                                          src_x, src_y,
-                                                          src_width, src_height,
-                                                          dest_width, dest_height);
+              key.drawable    = drawable;
+              key.src_x       = src_x;
+              key.src_y       = src_y;
+              key.src_width   = src_width;
+              key.src_height  = src_height;
+              key.dest_width  = dest_width;
+              key.dest_height = dest_height;
+
+              render_buf = gimp_view_renderer_drawable_get_preview (
+                GIMP_VIEW_RENDERER_DRAWABLE (renderer), &key, &pending);
             }
           else
             {
@@ -188,12 +274,26 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
     }
   else
     {
-      render_buf = gimp_viewable_get_new_preview (renderer->viewable,
-                                                  renderer->context,
-                                                  view_width,
-                                                  view_height);
+      PreviewKey key;
+
+      key.drawable    = drawable;
+      key.src_x       = 0;
+      key.src_y       = 0;
+      key.src_width   = gimp_item_get_width  (item);
+      key.src_height  = gimp_item_get_height (item);
+      key.dest_width  = view_width;
+      key.dest_height = view_height;
+
+      render_buf = gimp_view_renderer_drawable_get_preview (
+        GIMP_VIEW_RENDERER_DRAWABLE (renderer), &key, &pending);
     }
 
+  /*  while the preview is being rendered, keep showing the last one,
+   *  or the icon if there is none yet
+   */
+  if (pending && renderer->surface)
+    return;
+
   if (render_buf)
     {
       gint render_buf_x = 0;
@@ -244,3 +344,93 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
       gimp_view_renderer_render_icon (renderer, widget, icon_name);
     }
 }
+
+/*  returns the preview for 'key' if it's ready.  otherwise, starts
+ *  rendering it on another thread if it isn't being rendered already,
+ *  and sets 'pending'.
+ */
+static GimpTempBuf *
+gimp_view_renderer_drawable_get_preview (GimpViewRendererDrawable *renderer,
+                                         const PreviewKey         *key,
+                                         gboolean                 *pending)
+{
+  GimpViewRendererDrawablePrivate *priv = renderer->priv;
+
+  *pending = FALSE;
+
+  if (priv->render_buf_valid &&
+      ! memcmp (&priv->render_buf_key, key, sizeof (PreviewKey)))
+    {
+      if (priv->render_buf)
+        return gimp_temp_buf_ref (priv->render_buf);
+
+      return NULL;
+    }
+
+  *pending = TRUE;
+
+  if (priv->cancellable &&
+      ! memcmp (&priv->pending_key, key, sizeof (PreviewKey)))
+    {
+      return NULL;
+    }
+
+  gimp_view_renderer_drawable_cancel (renderer);
+
+  priv->cancellable = g_cancellable_new ();
+  priv->pending_key = *key;
+
+  gimp_drawable_get_sub_preview_async (
+    key->drawable,
+    key->src_x, key->src_y, key->src_width, key->src_height,
+    key->dest_width, key->dest_height,
+    priv->cancellable,
+    (GAsyncReadyCallback) gimp_view_renderer_drawable_preview_ready,
+    g_object_ref (renderer));
+
+  return NULL;
+}
+
+static void
+gimp_view_renderer_drawable_preview_ready (GimpDrawable             *drawable,
+                                           GAsyncResult             *result,
+                                           GimpViewRendererDrawable *renderer)
+{
+  GimpViewRendererDrawablePrivate *priv = renderer->priv;
+  GimpTempBuf                     *preview;
+
+  preview = gimp_drawable_get_sub_preview_finish (drawable, result, NULL);
+
+  if (g_task_get_cancellable (G_TASK (result)) == priv->cancellable)
+    {
+      g_clear_object (&priv->cancellable);
+
+      g_clear_pointer (&priv->render_buf, gimp_temp_buf_unref);
+
+      priv->render_buf       = preview;
+      priv->render_buf_key   = priv->pending_key;
+      priv->render_buf_valid = TRUE;
+
+      preview = NULL;
+
+      priv->render_buf_ready = TRUE;
+      gimp_view_renderer_invalidate (GIMP_VIEW_RENDERER (renderer));
+      priv->render_buf_ready = FALSE;
+    }
+
+  if (preview)
+    gimp_temp_buf_unref (preview);
+
+  g_object_unref (renderer);
+}
+
+static void
+gimp_view_renderer_drawable_cancel (GimpViewRendererDrawable *renderer)
+{
+  if (renderer->priv->cancellable)
+    {
+      g_cancellable_cancel (renderer->priv->cancellable);
+
+      g_clear_object (&renderer->priv->cancellable);
+    }
+}
@@ -158,33 +158,33 @@ gimp_view_renderer_gradient_render (GimpViewRenderer *renderer,
 {
   GimpViewRendererGradient *rendergrad = GIMP_VIEW_RENDERER_GRADIENT (renderer);
   GimpGradient             *gradient   = GIMP_GRADIENT (renderer->viewable);
-  GimpGradientSegment      *seg        = NULL;
   GimpColorTransform       *transform;
   guchar                   *buf;
   guchar                   *dest;
   gint                      dest_stride;
   gint                      x;
   gint                      y;
-  gdouble                   dx, cur_x;
-  GimpRGB                   color;
+  GimpRGB                  *colors;
 
-  buf   = g_alloca (4 * renderer->width);
-  dx    = (rendergrad->right - rendergrad->left) / (renderer->width - 1);
-  cur_x = rendergrad->left;
+  buf    = g_alloca (4 * renderer->width);
+  colors = g_new (GimpRGB, renderer->width);
+
+  gimp_gradient_get_uniform_colors (gradient, renderer->context,
+                                    rendergrad->left, rendergrad->right,
+                                    renderer->width, rendergrad->reverse,
+                                    colors);
 
   for (x = 0, dest = buf; x < renderer->width; x++, dest += 4)
     {
       guchar r, g, b, a;
 
-      seg = gimp_gradient_get_color_at (gradient, renderer->context, seg,
-                                        cur_x, rendergrad->reverse, &color);
-      cur_x += dx;
-
-      gimp_rgba_get_uchar (&color, &r, &g, &b, &a);
+      gimp_rgba_get_uchar (&colors[x], &r, &g, &b, &a);
 
       GIMP_CAIRO_ARGB32_SET_PIXEL (dest, r, g, b, a);
     }
 
+  g_free (colors);
+
   if (! renderer->surface)
     renderer->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
                                                     renderer->width,
@@ -0,0 +1,247 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "core/core-types.h"
+
+#include "xcf-private.h"
+#include "xcf-tile.h"
+
+#include "gimptilehandlerxcf.h"
+
+
+static void   gimp_tile_handler_xcf_finalize (GObject                 *object);
+
+static void   gimp_tile_handler_xcf_validate (GimpTileHandlerValidate *validate,
+                                              const GeglRectangle     *rect,
+                                              gdouble                  scale,
+                                              const Babl              *format,
+                                              gpointer                 dest_buf,
+                                              gint                     dest_stride);
+
+
+G_DEFINE_TYPE (GimpTileHandlerXcf, gimp_tile_handler_xcf,
+               GIMP_TYPE_TILE_HANDLER_VALIDATE)
+
+#define parent_class gimp_tile_handler_xcf_parent_class
+
+
+/*  the handlers of all lazily loaded images may read from their
+ *  streams concurrently, from different threads.  the reads are
+ *  serialized.
+ */
+static GMutex gimp_tile_handler_xcf_mutex;
+
+
+static void
+gimp_tile_handler_xcf_class_init (GimpTileHandlerXcfClass *klass)
+{
+  GObjectClass                 *object_class   = G_OBJECT_CLASS (klass);
+  GimpTileHandlerValidateClass *validate_class = GIMP_TILE_HANDLER_VALIDATE_CLASS (klass);
+
+  object_class->finalize   = gimp_tile_handler_xcf_finalize;
+
+  validate_class->validate = gimp_tile_handler_xcf_validate;
+}
+
+static void
+gimp_tile_handler_xcf_init (GimpTileHandlerXcf *xcf)
+{
+}
+
+static void
+gimp_tile_handler_xcf_finalize (GObject *object)
+{
+  GimpTileHandlerXcf *xcf = GIMP_TILE_HANDLER_XCF (object);
+
+  g_clear_pointer (&xcf->mapped, g_mapped_file_unref);
+  g_clear_object (&xcf->input);
+  g_clear_pointer (&xcf->offsets, g_free);
+  g_clear_pointer (&xcf->lengths, g_free);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gboolean
+gimp_tile_handler_xcf_load_tile (GimpTileHandlerXcf  *xcf,
+                                 gint                 i,
+                                 const Babl          *format,
+                                 const GeglRectangle *tile_rect,
+                                 guchar              *tile_data)
+{
+  guchar   *data;
+  gsize     bytes_read = 0;
+  gboolean  success;
+
+  if (xcf->mapped)
+    {
+      gsize size   = g_mapped_file_get_length (xcf->mapped);
+      gsize offset = MIN (xcf->offsets[i], size);
+
+      /* decode the tile in place, its data may extend past the end of
+       * the file, see xcf_load_level()
+       */
+      return xcf_tile_decode (xcf->file_version, xcf->compression, format,
+                              tile_rect->width, tile_rect->height,
+                              (const guchar *)
+                              g_mapped_file_get_contents (xcf->mapped) + offset,
+                              MIN (xcf->lengths[i], size - offset),
+                              tile_data);
+    }
+
+  data = g_malloc (xcf->lengths[i]);
+
+  g_mutex_lock (&gimp_tile_handler_xcf_mutex);
+
+  /* we may be reading past the end of the file here, see
+   * xcf_load_level()
+   */
+  if (g_seekable_seek (G_SEEKABLE (xcf->input), xcf->offsets[i], G_SEEK_SET,
+                       NULL, NULL))
+    {
+      g_input_stream_read_all (xcf->input, data, xcf->lengths[i],
+                               &bytes_read, NULL, NULL);
+    }
+
+  g_mutex_unlock (&gimp_tile_handler_xcf_mutex);
+
+  success = xcf_tile_decode (xcf->file_version, xcf->compression, format,
+                             tile_rect->width, tile_rect->height,
+                             data, bytes_read, tile_data);
+
+  g_free (data);
+
+  return success;
+}
+
+static void
+gimp_tile_handler_xcf_validate (GimpTileHandlerValidate *validate,
+                                const GeglRectangle     *rect,
+                                gdouble                  scale,
+                                const Babl              *format,
+                                gpointer                 dest_buf,
+                                gint                     dest_stride)
+{
+  GimpTileHandlerXcf *xcf = GIMP_TILE_HANDLER_XCF (validate);
+  gint                bpp = babl_format_get_bytes_per_pixel (format);
+  guchar             *tile_data;
+  gint                col1, col2;
+  gint                row1, row2;
+  gint                row;
+  gint                col;
+
+  /*  levels are never rendered directly, see "render-levels"  */
+  g_return_if_fail (scale == 1.0);
+
+  tile_data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+
+  col1 = rect->x / XCF_TILE_WIDTH;
+  row1 = rect->y / XCF_TILE_HEIGHT;
+  col2 = (rect->x + rect->width  - 1) / XCF_TILE_WIDTH;
+  row2 = (rect->y + rect->height - 1) / XCF_TILE_HEIGHT;
+
+  for (row = row1; row <= row2; row++)
+    {
+      for (col = col1; col <= col2; col++)
+        {
+          GeglRectangle tile_rect;
+          GeglRectangle area;
+          gint          i = row * xcf->n_tile_cols + col;
+          gint          y;
+
+          tile_rect.x      = col * XCF_TILE_WIDTH;
+          tile_rect.y      = row * XCF_TILE_HEIGHT;
+          tile_rect.width  = MIN (XCF_TILE_WIDTH,  xcf->width  - tile_rect.x);
+          tile_rect.height = MIN (XCF_TILE_HEIGHT, xcf->height - tile_rect.y);
+
+          if (! gegl_rectangle_intersect (&area, &tile_rect, rect))
+            continue;
+
+          if (i >= xcf->n_tiles ||
+              ! gimp_tile_handler_xcf_load_tile (xcf, i, format,
+                                                 &tile_rect, tile_data))
+            {
+              /*  a broken tile is loaded as empty, like by the
+               *  non-lazy loader
+               */
+              memset (tile_data, 0, tile_rect.width * tile_rect.height * bpp);
+            }
+
+          for (y = 0; y < area.height; y++)
+            {
+              memcpy ((guchar *) dest_buf +
+                      (area.y - rect->y + y) * dest_stride +
+                      (area.x - rect->x)     * bpp,
+                      tile_data +
+                      ((area.y - tile_rect.y + y) * tile_rect.width +
+                       (area.x - tile_rect.x)) * bpp,
+                      area.width * bpp);
+            }
+        }
+    }
+
+  g_free (tile_data);
+}
+
+
+/*  public functions  */
+
+GeglTileHandler *
+gimp_tile_handler_xcf_new (GMappedFile        *mapped,
+                           GInputStream       *input,
+                           gint                file_version,
+                           XcfCompressionType  compression,
+                           gint                width,
+                           gint                height,
+                           const goffset      *offsets,
+                           const gsize        *lengths)
+{
+  GimpTileHandlerXcf *xcf;
+
+  g_return_val_if_fail (mapped != NULL || G_IS_SEEKABLE (input), NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+  g_return_val_if_fail (offsets != NULL, NULL);
+  g_return_val_if_fail (lengths != NULL, NULL);
+
+  xcf = g_object_new (GIMP_TYPE_TILE_HANDLER_XCF, NULL);
+
+  if (mapped)
+    xcf->mapped = g_mapped_file_ref (mapped);
+  else
+    xcf->input  = g_object_ref (input);
+
+  xcf->file_version = file_version;
+  xcf->compression  = compression;
+  xcf->width        = width;
+  xcf->height       = height;
+  xcf->n_tile_cols  = (width  + XCF_TILE_WIDTH  - 1) / XCF_TILE_WIDTH;
+  xcf->n_tiles      = xcf->n_tile_cols *
+                      ((height + XCF_TILE_HEIGHT - 1) / XCF_TILE_HEIGHT);
+
+  xcf->offsets = g_memdup (offsets, xcf->n_tiles * sizeof (goffset));
+  xcf->lengths = g_memdup (lengths, xcf->n_tiles * sizeof (gsize));
+
+  return GEGL_TILE_HANDLER (xcf);
+}
@@ -0,0 +1,76 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_TILE_HANDLER_XCF_H__
+#define __GIMP_TILE_HANDLER_XCF_H__
+
+
+#include "gegl/gimptilehandlervalidate.h"
+
+
+/***
+ * GimpTileHandlerXcf is a GeglTileHandler that loads the tiles of a
+ * lazily loaded XCF level from the file, when they are first accessed.
+ * the file is read from its mapping, or from a seekable stream.
+ */
+
+#define GIMP_TYPE_TILE_HANDLER_XCF            (gimp_tile_handler_xcf_get_type ())
+#define GIMP_TILE_HANDLER_XCF(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_TILE_HANDLER_XCF, GimpTileHandlerXcf))
+#define GIMP_TILE_HANDLER_XCF_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  GIMP_TYPE_TILE_HANDLER_XCF, GimpTileHandlerXcfClass))
+#define GIMP_IS_TILE_HANDLER_XCF(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIMP_TYPE_TILE_HANDLER_XCF))
+#define GIMP_IS_TILE_HANDLER_XCF_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GIMP_TYPE_TILE_HANDLER_XCF))
+#define GIMP_TILE_HANDLER_XCF_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GIMP_TYPE_TILE_HANDLER_XCF, GimpTileHandlerXcfClass))
+
+
+typedef struct _GimpTileHandlerXcf      GimpTileHandlerXcf;
+typedef struct _GimpTileHandlerXcfClass GimpTileHandlerXcfClass;
+
+struct _GimpTileHandlerXcf
+{
+  GimpTileHandlerValidate  parent_instance;
+
+  GMappedFile             *mapped;
+  GInputStream            *input;
+  gint                     file_version;
+  XcfCompressionType       compression;
+  gint                     width;
+  gint                     height;
+  gint                     n_tile_cols;
+  gint                     n_tiles;
+  goffset                 *offsets;
+  gsize                   *lengths;
+};
+
+struct _GimpTileHandlerXcfClass
+{
+  GimpTileHandlerValidateClass  parent_class;
+};
+
+
+GType             gimp_tile_handler_xcf_get_type (void) G_GNUC_CONST;
+
+GeglTileHandler * gimp_tile_handler_xcf_new      (GMappedFile        *mapped,
+                                                  GInputStream       *input,
+                                                  gint                file_version,
+                                                  XcfCompressionType  compression,
+                                                  gint                width,
+                                                  gint                height,
+                                                  const goffset      *offsets,
+                                                  const gsize        *lengths);
+
+
+#endif /* __GIMP_TILE_HANDLER_XCF_H__ */
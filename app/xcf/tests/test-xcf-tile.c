@@ -0,0 +1,314 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* checks that the XCF tile RLE encoder produces the same output as the
+ * original, strided encoder, that its output decodes back to the
+ * original tile, and reports the time taken by both.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "core/core-types.h"
+
+#include "xcf/xcf-private.h"
+#include "xcf/xcf-tile.h"
+
+
+#define N_PIXELS (XCF_TILE_WIDTH * XCF_TILE_HEIGHT)
+#define N_ROUNDS 200
+
+
+typedef enum
+{
+  FILL_RANDOM,
+  FILL_FEW_VALUES,
+  FILL_RUNS,
+  FILL_CONSTANT
+} FillType;
+
+static const gchar *formats[] =
+{
+  "Y u8",
+  "Y'A u8",
+  "R'G'B' u8",
+  "R'G'B'A u8",
+  "R'G'B'A u16",
+  "RGBA float"
+};
+
+static const gchar *fill_names[] =
+{
+  "random",
+  "few values",
+  "runs",
+  "constant"
+};
+
+
+/*  the encoder as it was before it scanned byte planes contiguously  */
+static gsize
+reference_encode_rle (gint          bpp,
+                      const guchar *tile_data,
+                      gint          n_pixels,
+                      guchar       *rlebuf)
+{
+  gint len = 0;
+  gint i, j;
+
+  for (i = 0; i < bpp; i++)
+    {
+      const guchar *data   = tile_data + i;
+      gint          state  = 0;
+      gint          length = 0;
+      gint          size   = n_pixels;
+      guint         last   = -1;
+
+      while (size > 0)
+        {
+          switch (state)
+            {
+            case 0:
+              if ((length == 32768) ||
+                  ((size - length) <= 0) ||
+                  ((length > 1) && (last != *data)))
+                {
+                  if (length >= 128)
+                    {
+                      rlebuf[len++] = 127;
+                      rlebuf[len++] = (length >> 8);
+                      rlebuf[len++] = length & 0x00FF;
+                      rlebuf[len++] = last;
+                    }
+                  else
+                    {
+                      rlebuf[len++] = length - 1;
+                      rlebuf[len++] = last;
+                    }
+
+                  size -= length;
+                  length = 0;
+                }
+              else if ((length == 1) && (last != *data))
+                {
+                  state = 1;
+                }
+              break;
+
+            case 1:
+              if ((length == 32768) ||
+                  ((size - length) == 0) ||
+                  ((length > 0) && (last == *data) &&
+                   ((size - length) == 1 || last == data[bpp])))
+                {
+                  const guchar *t;
+
+                  if (!((length == 32768) || ((size - length) == 0)))
+                    {
+                      length--;
+                      data -= bpp;
+                    }
+
+                  state = 0;
+
+                  if (length >= 128)
+                    {
+                      rlebuf[len++] = 255 - 127;
+                      rlebuf[len++] = (length >> 8);
+                      rlebuf[len++] = length & 0x00FF;
+                    }
+                  else
+                    {
+                      rlebuf[len++] = 255 - (length - 1);
+                    }
+
+                  t = data - length * bpp;
+
+                  for (j = 0; j < length; j++)
+                    {
+                      rlebuf[len++] = *t;
+                      t += bpp;
+                    }
+
+                  size -= length;
+                  length = 0;
+                }
+              break;
+            }
+
+          if (size > 0)
+            {
+              length += 1;
+              last = *data;
+              data += bpp;
+            }
+        }
+    }
+
+  return len;
+}
+
+static void
+fill_tile (guchar   *tile_data,
+           gint      size,
+           FillType  fill,
+           GRand    *grand)
+{
+  gint i;
+
+  for (i = 0; i < size; i++)
+    {
+      switch (fill)
+        {
+        case FILL_RANDOM:
+          tile_data[i] = g_rand_int_range (grand, 0, 256);
+          break;
+
+        case FILL_FEW_VALUES:
+          tile_data[i] = g_rand_int_range (grand, 0, 3);
+          break;
+
+        case FILL_RUNS:
+          if (i > 0 && g_rand_int_range (grand, 0, 40))
+            tile_data[i] = tile_data[i - 1];
+          else
+            tile_data[i] = g_rand_int_range (grand, 0, 4);
+          break;
+
+        case FILL_CONSTANT:
+          tile_data[i] = 0x80;
+          break;
+        }
+    }
+}
+
+static gint
+test_tile (const gchar *format_name,
+           FillType     fill,
+           GRand       *grand)
+{
+  const Babl *format    = babl_format (format_name);
+  gint        bpp       = babl_format_get_bytes_per_pixel (format);
+  gint        tile_size = bpp * N_PIXELS;
+  gsize       max_size  = tile_size * XCF_TILE_MAX_DATA_LENGTH_FACTOR;
+  guchar     *tile_data = g_malloc (tile_size);
+  guchar     *decoded   = g_malloc (tile_size);
+  guchar     *expected  = g_malloc (max_size);
+  guchar     *result    = g_malloc (max_size);
+  GTimer     *timer;
+  gdouble     reference_time;
+  gdouble     encode_time;
+  gsize       expected_length;
+  gsize       length;
+  gint        failed    = 0;
+  gint        i;
+
+  fill_tile (tile_data, tile_size, fill, grand);
+
+  expected_length = reference_encode_rle (bpp, tile_data, N_PIXELS, expected);
+  length          = xcf_tile_encode_rle  (bpp, tile_data, N_PIXELS, result);
+
+  if (length != expected_length || memcmp (expected, result, length))
+    {
+      g_print ("%s, %s: encoded data differs\n",
+               format_name, fill_names[fill]);
+      failed = 1;
+    }
+  else if (! xcf_tile_decode (11, COMPRESS_RLE, format,
+                              XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                              result, length, decoded) ||
+           memcmp (tile_data, decoded, tile_size))
+    {
+      g_print ("%s, %s: decoded data differs\n",
+               format_name, fill_names[fill]);
+      failed = 1;
+    }
+
+  if (! failed)
+    {
+      timer = g_timer_new ();
+
+      for (i = 0; i < N_ROUNDS; i++)
+        reference_encode_rle (bpp, tile_data, N_PIXELS, expected);
+      reference_time = g_timer_elapsed (timer, NULL);
+
+      g_timer_start (timer);
+      for (i = 0; i < N_ROUNDS; i++)
+        xcf_tile_encode_rle (bpp, tile_data, N_PIXELS, result);
+      encode_time = g_timer_elapsed (timer, NULL);
+
+      g_timer_destroy (timer);
+
+      g_print ("%-12s %-11s reference %7.1f us, encoder %7.1f us\n",
+               format_name, fill_names[fill],
+               1e6 * reference_time / N_ROUNDS,
+               1e6 * encode_time    / N_ROUNDS);
+    }
+
+  g_free (tile_data);
+  g_free (decoded);
+  g_free (expected);
+  g_free (result);
+
+  return failed;
+}
+
+int
+main (void)
+{
+  GRand *grand;
+  gint   failures = 0;
+  gint   n_tests  = 0;
+  gint   i;
+  gint   fill;
+
+  g_print ("\nTesting the XCF tile RLE encoder ...\n");
+
+  babl_init ();
+
+  grand = g_rand_new_with_seed (0);
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    {
+      for (fill = FILL_RANDOM; fill <= FILL_CONSTANT; fill++)
+        {
+          n_tests++;
+          failures += test_tile (formats[i], fill, grand);
+        }
+    }
+
+  g_rand_free (grand);
+
+  babl_exit ();
+
+  if (failures)
+    {
+      g_print ("%d out of %d tiles failed!\n\n", failures, n_tests);
+      return EXIT_FAILURE;
+    }
+  else
+    {
+      g_print ("All %d tiles passed.\n\n", n_tests);
+      return EXIT_SUCCESS;
+    }
+}
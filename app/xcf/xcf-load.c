@@ -34,6 +34,7 @@
 #include "gegl/gimp-gegl-tile-compat.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpdrawable-private.h" /* eek */
 #include "core/gimpgrid.h"
@@ -51,7 +52,9 @@
 #include "core/gimplayer-new.h"
 #include "core/gimplayermask.h"
 #include "core/gimpparasitelist.h"
+#include "core/gimppickable.h"
 #include "core/gimpprogress.h"
+#include "core/gimpprojection.h"
 #include "core/gimpselection.h"
 #include "core/gimptemplate.h"
 
@@ -70,17 +73,37 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-seek.h"
+#include "xcf-stored-level.h"
+#include "xcf-tile.h"
 #include "xcf-utils.h"
 
+#include "gimptilehandlerxcf.h"
+
 #include "gimp-log.h"
 #include "gimp-intl.h"
 
 
 #define MAX_XCF_PARASITE_DATA_LEN (256L * 1024 * 1024)
 
+/*  the number of tiles of a level that are read at once  */
+#define XCF_LOAD_BATCH_SIZE 64
+
 /* #define GIMP_XCF_PATH_DEBUG */
 
 
+typedef struct
+{
+  XcfInfo       *info;
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  gint           first_tile;
+  gint           n_tiles;
+  const guchar **tile_data;
+  gsize         *tile_lengths;
+  volatile gint  failed;
+} XcfLoadLevelData;
+
+
 static void            xcf_load_add_masks     (GimpImage     *image);
 static gboolean        xcf_load_image_props   (XcfInfo       *info,
                                                GimpImage     *image);
@@ -106,24 +129,13 @@ static GimpChannel   * xcf_load_channel       (XcfInfo       *info,
                                                GimpImage     *image);
 static GimpLayerMask * xcf_load_layer_mask    (XcfInfo       *info,
                                                GimpImage     *image);
+static void            xcf_load_projection    (XcfInfo       *info,
+                                               GimpImage     *image);
 static gboolean        xcf_load_buffer        (XcfInfo       *info,
                                                GeglBuffer    *buffer);
 static gboolean        xcf_load_level         (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
-static gboolean        xcf_load_tile          (XcfInfo       *info,
                                                GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format);
-static gboolean        xcf_load_tile_rle      (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
-static gboolean        xcf_load_tile_zlib     (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
+                                               goffset        level_end);
 static GimpParasite  * xcf_load_parasite      (XcfInfo       *info);
 static gboolean        xcf_load_old_paths     (XcfInfo       *info,
                                                GimpImage     *image);
@@ -137,6 +149,19 @@ static gboolean        xcf_load_vector        (XcfInfo       *info,
 static gboolean        xcf_skip_unknown_prop  (XcfInfo       *info,
                                                gsize          size);
 
+static void   xcf_load_level_decode_tiles     (gint              i,
+                                               gint              n,
+                                               XcfLoadLevelData *data);
+static void   xcf_load_level_store            (XcfInfo          *info,
+                                               GeglBuffer       *buffer,
+                                               gint              n_tiles,
+                                               const goffset    *offsets,
+                                               const gsize      *lengths,
+                                               goffset           level_end);
+static void   xcf_load_level_buffer_changed   (GeglBuffer              *buffer,
+                                               const GeglRectangle     *rect,
+                                               GimpTileHandlerValidate *handler);
+
 
 #define xcf_progress_update(info) G_STMT_START  \
   {                                             \
@@ -525,6 +550,9 @@ xcf_load_image (Gimp     *gimp,
   if (info->floating_sel && info->floating_sel_drawable)
     floating_sel_attach (info->floating_sel, info->floating_sel_drawable);
 
+  if (info->projection_level > 0)
+    xcf_load_projection (info, image);
+
   if (info->active_layer)
     gimp_image_set_active_layer (image, info->active_layer);
 
@@ -688,7 +716,8 @@ xcf_load_image_props (XcfInfo   *info,
             if ((compression != COMPRESS_NONE) &&
                 (compression != COMPRESS_RLE) &&
                 (compression != COMPRESS_ZLIB) &&
-                (compression != COMPRESS_FRACTAL))
+                (compression != COMPRESS_FRACTAL) &&
+                (compression != COMPRESS_ZSTD))
               {
                 gimp_message (info->gimp, G_OBJECT (info->progress),
                               GIMP_MESSAGE_ERROR,
@@ -697,6 +726,17 @@ xcf_load_image_props (XcfInfo   *info,
                 return FALSE;
               }
 
+#ifndef HAVE_ZSTD
+            if (compression == COMPRESS_ZSTD)
+              {
+                gimp_message_literal (info->gimp, G_OBJECT (info->progress),
+                                      GIMP_MESSAGE_ERROR,
+                                      "zstd compression is not supported "
+                                      "by this build");
+                return FALSE;
+              }
+#endif
+
             info->compression = compression;
 
             gimp_image_set_xcf_compression (image,
@@ -914,6 +954,19 @@ xcf_load_image_props (XcfInfo   *info,
           }
          break;
 
+        case PROP_PROJECTION:
+          {
+            guint32 level;
+
+            xcf_read_int32  (info, &level, 1);
+            xcf_read_offset (info, &info->projection_offset, 1);
+
+            /* the projection is loaded after the layers and channels  */
+            if (level > 0 && level <= GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS)
+              info->projection_level = level;
+          }
+          break;
+
         case PROP_VECTORS:
           {
             goffset base = info->cp;
@@ -1849,12 +1902,43 @@ xcf_load_layer_mask (XcfInfo   *info,
   return NULL;
 }
 
+/*  loads the prerendered level of the projection, which is only a
+ *  shortcut, so a broken one is ignored
+ */
+static void
+xcf_load_projection (XcfInfo   *info,
+                     GimpImage *image)
+{
+  GimpProjection *projection = gimp_image_get_projection (image);
+  const Babl     *format;
+  GeglBuffer     *buffer;
+  gint            level      = info->projection_level;
+  gint            width;
+  gint            height;
+
+  if (! xcf_seek_pos (info, info->projection_offset, NULL))
+    return;
+
+  format = gimp_pickable_get_format (GIMP_PICKABLE (projection));
+
+  width  = (gimp_image_get_width  (image) + (1 << level) - 1) >> level;
+  height = (gimp_image_get_height (image) + (1 << level) - 1) >> level;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height), format);
+
+  if (xcf_load_buffer (info, buffer))
+    gimp_projection_set_prerendered_level (projection, buffer, level);
+
+  g_object_unref (buffer);
+}
+
 static gboolean
 xcf_load_buffer (XcfInfo    *info,
                  GeglBuffer *buffer)
 {
   const Babl *format;
   goffset     offset;
+  goffset     next_offset;
   gint        width;
   gint        height;
   gint        bpp;
@@ -1875,12 +1959,17 @@ xcf_load_buffer (XcfInfo    *info,
 
   xcf_read_offset (info, &offset, 1); /* top level */
 
+  /* the second level, if any, immediately follows the top level in files
+   * written by GIMP, which bounds the top level's last tile
+   */
+  xcf_read_offset (info, &next_offset, 1);
+
   /* seek to the level offset */
   if (! xcf_seek_pos (info, offset, NULL))
     return FALSE;
 
   /* read in the level */
-  if (! xcf_load_level (info, buffer))
+  if (! xcf_load_level (info, buffer, next_offset))
     return FALSE;
 
   /* discard levels below first.
@@ -1890,23 +1979,113 @@ xcf_load_buffer (XcfInfo    *info,
 }
 
 
+static void
+xcf_load_level_decode_tiles (gint              i,
+                             gint              n,
+                             XcfLoadLevelData *data)
+{
+  gint    bpp       = babl_format_get_bytes_per_pixel (data->format);
+  guchar *tile_data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+  gint    tile;
+
+  for (tile = i; tile < data->n_tiles; tile += n)
+    {
+      GeglRectangle rect;
+
+      gimp_gegl_buffer_get_tile_rect (data->buffer,
+                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                      data->first_tile + tile, &rect);
+
+      if (! xcf_tile_decode (data->info->file_version,
+                             data->info->compression,
+                             data->format,
+                             rect.width, rect.height,
+                             data->tile_data[tile],
+                             data->tile_lengths[tile],
+                             tile_data))
+        {
+          g_atomic_int_set (&data->failed, TRUE);
+          break;
+        }
+
+      if (! xcf_data_is_zero (tile_data, rect.width * rect.height * bpp))
+        {
+          gegl_buffer_set (data->buffer, &rect, 0, data->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE);
+        }
+    }
+
+  g_free (tile_data);
+}
+
+static void
+xcf_load_level_buffer_changed (GeglBuffer              *buffer,
+                               const GeglRectangle     *rect,
+                               GimpTileHandlerValidate *handler)
+{
+  handler->discardable = FALSE;
+}
+
+static void
+xcf_load_level_store (XcfInfo       *info,
+                      GeglBuffer    *buffer,
+                      gint           n_tiles,
+                      const goffset *offsets,
+                      const gsize   *lengths,
+                      goffset        level_end)
+{
+  XcfStoredLevel *level;
+
+  if (! info->file || n_tiles == 0)
+    return;
+
+  level = xcf_stored_level_new (info->file_version,
+                                info->compression,
+                                gegl_buffer_get_format (buffer),
+                                n_tiles, offsets, lengths);
+
+  /* the length of the last tile is only known if the next level
+   * follows it
+   */
+  if (level_end > offsets[n_tiles - 1] &&
+      level_end - offsets[n_tiles - 1] <= lengths[n_tiles - 1])
+    {
+      level->lengths[n_tiles - 1] = level_end - offsets[n_tiles - 1];
+    }
+  else
+    {
+      level->lengths[n_tiles - 1] = 0;
+    }
+
+  if (xcf_stored_level_set_file (level, info->file))
+    xcf_stored_level_attach (level, buffer);
+  else
+    xcf_stored_level_free (level);
+}
+
 static gboolean
 xcf_load_level (XcfInfo    *info,
-                GeglBuffer *buffer)
+                GeglBuffer *buffer,
+                goffset     level_end)
 {
-  const Babl *format;
-  gint        bpp;
-  goffset     saved_pos;
-  goffset     offset;
-  goffset     offset2;
-  goffset     max_data_length;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        width;
-  gint        height;
-  gint        i;
-  gint        fail;
+  XcfLoadLevelData  data;
+  const Babl       *format;
+  gint              bpp;
+  goffset           saved_pos;
+  goffset          *offsets;
+  gsize            *lengths;
+  goffset           max_data_length;
+  gint              n_tile_rows;
+  gint              n_tile_cols;
+  guint             ntiles;
+  guint             n_valid_tiles;
+  gint              width;
+  gint              height;
+  guchar           *read_buf = NULL;
+  gint              batch_size;
+  gint              i;
+  gint              j;
+  gboolean          success  = TRUE;
 
   format = gegl_buffer_get_format (buffer);
   bpp    = babl_format_get_bytes_per_pixel (format);
@@ -1925,404 +2104,196 @@ xcf_load_level (XcfInfo    *info,
   max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
                     XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
 
-  /* read in the first tile offset.
-   *  if it is '0', then this tile level is empty
-   *  and we can simply return.
-   */
-  xcf_read_offset (info, &offset, 1);
-  if (offset == 0)
-    return TRUE;
-
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
-  for (i = 0; i < ntiles; i++)
+
+  /* read in the whole offset table, including the zero offset that
+   * terminates it.  if the first offset is '0', then this tile level is
+   * empty and we can simply return.
+   */
+  offsets = g_new (goffset, ntiles + 1);
+
+  xcf_read_offset (info, offsets, 1);
+  if (offsets[0] == 0)
     {
-      GeglRectangle rect;
+      g_free (offsets);
+      return TRUE;
+    }
+
+  xcf_read_offset (info, offsets + 1, ntiles);
+
+  /* this is where the non-lazy loader used to leave the stream  */
+  saved_pos = info->cp;
+
+  /* calculate the amount of data of each tile, from the offset of the
+   * next tile.  the tiles up to the first error are still loaded.
+   */
+  lengths = g_new (gsize, ntiles);
 
-      fail = FALSE;
+  for (n_valid_tiles = 0; n_valid_tiles < ntiles; n_valid_tiles++)
+    {
+      goffset offset  = offsets[n_valid_tiles];
+      goffset offset2 = offsets[n_valid_tiles + 1];
 
       if (offset == 0)
         {
           gimp_message_literal (info->gimp, G_OBJECT (info->progress),
                                 GIMP_MESSAGE_ERROR,
                                 "not enough tiles found in level");
-          return FALSE;
+          success = FALSE;
+          break;
         }
 
-      /* save the current position as it is where the
-       *  next tile offset is stored.
-       */
-      saved_pos = info->cp;
-
-      /* read in the offset of the next tile so we can calculate the amount
-       * of data needed for this tile
-       */
-      xcf_read_offset (info, &offset2, 1);
-
       /* if the offset is 0 then we need to read in the maximum possible
        * allowing for negative compression
        */
       if (offset2 == 0)
         offset2 = offset + max_data_length;
 
-      /* seek to the tile offset */
-      if (! xcf_seek_pos (info, offset, NULL))
-        return FALSE;
-
       if (offset2 < offset || offset2 - offset > max_data_length)
         {
           gimp_message (info->gimp, G_OBJECT (info->progress),
                         GIMP_MESSAGE_ERROR,
                         "invalid tile data length: %" G_GOFFSET_FORMAT,
                         offset2 - offset);
-          return FALSE;
-        }
-
-      /* get the tile from the tile manager */
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
-
-      GIMP_LOG (XCF, "loading tile %d/%d", i + 1, ntiles);
-
-      /* read in the tile */
-      switch (info->compression)
-        {
-        case COMPRESS_NONE:
-          if (!xcf_load_tile (info, buffer, &rect, format))
-            fail = TRUE;
-          break;
-        case COMPRESS_RLE:
-          if (!xcf_load_tile_rle (info, buffer, &rect, format,
-                                  offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_ZLIB:
-          if (!xcf_load_tile_zlib (info, buffer, &rect, format,
-                                   offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_FRACTAL:
-          g_printerr ("xcf: fractal compression unimplemented. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
-          break;
-        default:
-          g_printerr ("xcf: unknown compression. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
+          success = FALSE;
           break;
         }
 
-      if (fail)
-        return FALSE;
-
-      GIMP_LOG (XCF, "loaded tile %d/%d", i + 1, ntiles);
-
-      /* restore the saved position so we'll be ready to
-       *  read the next offset.
-       */
-      if (!xcf_seek_pos (info, saved_pos, NULL))
-        return FALSE;
-
-      /* read in the offset of the next tile */
-      xcf_read_offset (info, &offset, 1);
+      lengths[n_valid_tiles] = offset2 - offset;
     }
 
-  if (offset != 0)
+  if (success && offsets[ntiles] != 0)
     {
       gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
                     "encountered garbage after reading level: %" G_GOFFSET_FORMAT,
-                    offset);
-      return FALSE;
+                    offsets[ntiles]);
+      success = FALSE;
     }
 
-  return TRUE;
-}
-
-static gboolean
-xcf_load_tile (XcfInfo       *info,
-               GeglBuffer    *buffer,
-               GeglRectangle *tile_rect,
-               const Babl    *format)
-{
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-
-  if (info->file_version <= 11)
+  if (success && info->lazy_load)
     {
-      xcf_read_int8 (info, tile_data, tile_size);
-    }
-  else
-    {
-      gint n_components = babl_format_get_n_components (format);
+      /* let the tiles be loaded when they are first accessed  */
+      GeglTileHandler *handler;
 
-      xcf_read_component (info, bpp / n_components, tile_data,
-                          tile_size / bpp * n_components);
-    }
-
-  if (! xcf_data_is_zero (tile_data, tile_size))
-    {
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
-    }
+      handler = gimp_tile_handler_xcf_new (info->mapped,
+                                           info->lazy_input,
+                                           info->file_version,
+                                           info->compression,
+                                           width, height,
+                                           offsets, lengths);
 
-  return TRUE;
-}
+      gimp_tile_handler_validate_assign (GIMP_TILE_HANDLER_VALIDATE (handler),
+                                         buffer);
 
-static gboolean
-xcf_load_tile_rle (XcfInfo       *info,
-                   GeglBuffer    *buffer,
-                   GeglRectangle *tile_rect,
-                   const Babl    *format,
-                   gint           data_length)
-{
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  guchar  nonzero   = FALSE;
-  gsize   bytes_read;
-  gint    i;
-  guchar *xcfdata;
-  guchar *xcfodata;
-  guchar *xcfdatalimit;
-
-  /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
-   * this tile (return TRUE without storing data) as if it did not
-   * contain any data.  It is better than returning FALSE, which would
-   * skip the whole hierarchy while there may still be some valid
-   * tiles in the file.
-   */
-  if (data_length <= 0)
-    return TRUE;
+      gimp_tile_handler_validate_invalidate (GIMP_TILE_HANDLER_VALIDATE (handler),
+                                             GEGL_RECTANGLE (0, 0,
+                                                             width, height));
 
-  xcfdata = xcfodata = g_alloca (data_length);
+      /*  the tiles can be read from the file again, until the buffer
+       *  is modified
+       */
+      GIMP_TILE_HANDLER_VALIDATE (handler)->discardable = TRUE;
 
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
+      gegl_buffer_signal_connect (buffer, "changed",
+                                  G_CALLBACK (xcf_load_level_buffer_changed),
+                                  handler);
 
-  if (bytes_read == 0)
-    return TRUE;
+      g_object_unref (handler);
 
-  xcfdatalimit = &xcfodata[bytes_read - 1];
+      xcf_load_level_store (info, buffer, ntiles, offsets, lengths, level_end);
 
-  for (i = 0; i < bpp; i++)
-    {
-      guchar *data  = tile_data + i;
-      gint    size  = tile_rect->width * tile_rect->height;
-      gint    count = 0;
-      guchar  val;
-      gint    length;
-      gint    j;
-
-      while (size > 0)
-        {
-          if (xcfdata > xcfdatalimit)
-            {
-              goto bogus_rle;
-            }
+      g_free (offsets);
+      g_free (lengths);
 
-          val = *xcfdata++;
+      return TRUE;
+    }
 
-          length = val;
-          if (length >= 128)
-            {
-              length = 255 - (length - 1);
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
+  /* the tiles are read in batches, which are decoded in parallel  */
+  batch_size = MIN (n_valid_tiles, XCF_LOAD_BATCH_SIZE);
 
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
+  data.info         = info;
+  data.buffer       = buffer;
+  data.format       = format;
+  data.tile_data    = g_new (const guchar *, batch_size);
+  data.tile_lengths = g_new (gsize, batch_size);
+  data.failed       = FALSE;
 
-              count += length;
-              size -= length;
+  /* a mapped file is decoded in place  */
+  if (! info->mapped)
+    read_buf = g_malloc (batch_size * max_data_length);
 
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
+  for (i = 0; i < n_valid_tiles && ! data.failed; i += batch_size)
+    {
+      data.first_tile = i;
+      data.n_tiles    = MIN (n_valid_tiles - i, batch_size);
 
-              if (&xcfdata[length-1] > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
+      for (j = 0; j < data.n_tiles; j++)
+        {
+          GIMP_LOG (XCF, "loading tile %d/%d", i + j + 1, ntiles);
 
-              while (length-- > 0)
-                {
-                  *data = *xcfdata++;
-                  nonzero |= *data;
-                  data += bpp;
-                }
-            }
-          else
+          if (info->mapped)
             {
-              length += 1;
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
+              gsize size = g_mapped_file_get_length (info->mapped);
 
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
-
-              count += length;
-              size -= length;
-
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
-
-              if (xcfdata > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
-
-              val = *xcfdata++;
-              nonzero |= val;
+              /* the data may extend past the end of the file  */
+              data.tile_data[j]    = (const guchar *)
+                                     g_mapped_file_get_contents (info->mapped) +
+                                     MIN (offsets[i + j], size);
+              data.tile_lengths[j] = MIN (lengths[i + j],
+                                          size - MIN (offsets[i + j], size));
 
-              for (j = 0; j < length; j++)
-                {
-                  *data = val;
-                  data += bpp;
-                }
+              continue;
             }
-        }
-    }
-
-  if (nonzero)
-    {
-      if (info->file_version >= 12)
-        {
-          gint n_components = babl_format_get_n_components (format);
-
-          xcf_read_from_be (bpp / n_components, tile_data,
-                            tile_size / bpp * n_components);
-        }
-
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
-    }
-
-  return TRUE;
-
- bogus_rle:
-  return FALSE;
-}
-
-static gboolean
-xcf_load_tile_zlib (XcfInfo       *info,
-                    GeglBuffer    *buffer,
-                    GeglRectangle *tile_rect,
-                    const Babl    *format,
-                    gint           data_length)
-{
-  z_stream  strm;
-  int       action;
-  int       status;
-  gint      bpp       = babl_format_get_bytes_per_pixel (format);
-  gint      tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar   *tile_data = g_alloca (tile_size);
-  gsize     bytes_read;
-  guchar   *xcfdata;
-
-  /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
-   * this tile (return TRUE without storing data) as if it did not
-   * contain any data.  It is better than returning FALSE, which would
-   * skip the whole hierarchy while there may still be some valid
-   * tiles in the file.
-   */
-  if (data_length <= 0)
-    return TRUE;
-
-  xcfdata = g_alloca (data_length);
-
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
-
-  if (bytes_read == 0)
-    return TRUE;
-
-  strm.next_out  = tile_data;
-  strm.avail_out = tile_size;
 
-  strm.zalloc    = Z_NULL;
-  strm.zfree     = Z_NULL;
-  strm.opaque    = Z_NULL;
-  strm.next_in   = xcfdata;
-  strm.avail_in  = bytes_read;
-
-  /* Initialize the stream decompression. */
-  status = inflateInit (&strm);
-  if (status != Z_OK)
-    return FALSE;
+          /* seek to the tile offset */
+          if (! xcf_seek_pos (info, offsets[i + j], NULL))
+            {
+              data.failed = TRUE;
+              break;
+            }
 
-  action = Z_NO_FLUSH;
+          data.tile_data[j] = read_buf + j * max_data_length;
 
-  while (status == Z_OK)
-    {
-      if (strm.avail_in == 0)
-        {
-          action = Z_FINISH;
+          /* we have to read directly instead of xcf_read_* because we
+           * may be reading past the end of the file here
+           */
+          g_input_stream_read_all (info->input,
+                                   read_buf + j * max_data_length,
+                                   lengths[i + j],
+                                   &data.tile_lengths[j], NULL, NULL);
+          info->cp += data.tile_lengths[j];
         }
 
-      status = inflate (&strm, action);
-
-      if (status == Z_STREAM_END)
+      if (! data.failed)
         {
-          /* All the data was successfully decoded. */
-          break;
-        }
-      else if (status == Z_BUF_ERROR)
-        {
-          g_printerr ("xcf: decompressed tile bigger than the expected size.");
-          inflateEnd (&strm);
-          return FALSE;
-        }
-      else if (status != Z_OK)
-        {
-          g_printerr ("xcf: tile decompression failed: %s", zError (status));
-          inflateEnd (&strm);
-          return FALSE;
+          gimp_parallel_distribute (data.n_tiles,
+                                    (GimpParallelDistributeFunc)
+                                    xcf_load_level_decode_tiles,
+                                    &data);
         }
     }
 
-  if (! xcf_data_is_zero (tile_data, tile_size))
-    {
-      if (info->file_version >= 12)
-        {
-          gint n_components = babl_format_get_n_components (format);
+  if (data.failed)
+    success = FALSE;
 
-          xcf_read_from_be (bpp / n_components, tile_data,
-                            tile_size / bpp * n_components);
-        }
+  if (success)
+    xcf_load_level_store (info, buffer, ntiles, offsets, lengths, level_end);
 
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
-    }
+  g_free (data.tile_data);
+  g_free (data.tile_lengths);
+  g_free (read_buf);
 
-  inflateEnd (&strm);
+  g_free (offsets);
+  g_free (lengths);
 
-  return TRUE;
+  /* restore the position after the offset table  */
+  if (success && ! xcf_seek_pos (info, saved_pos, NULL))
+    success = FALSE;
+
+  return success;
 }
 
 static GimpParasite *
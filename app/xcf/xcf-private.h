@@ -63,7 +63,8 @@ typedef enum
   PROP_COMPOSITE_MODE     = 35,
   PROP_COMPOSITE_SPACE    = 36,
   PROP_BLEND_SPACE        = 37,
-  PROP_FLOAT_COLOR        = 38
+  PROP_FLOAT_COLOR        = 38,
+  PROP_PROJECTION         = 39
 } PropType;
 
 typedef enum
@@ -71,9 +72,16 @@ typedef enum
   COMPRESS_NONE              =  0,
   COMPRESS_RLE               =  1,
   COMPRESS_ZLIB              =  2,  /* unused */
-  COMPRESS_FRACTAL           =  3   /* unused */
+  COMPRESS_FRACTAL           =  3,  /* unused */
+  COMPRESS_ZSTD              =  4   /* needs XCF version 14 */
 } XcfCompressionType;
 
+typedef enum
+{
+  XCF_ZSTD_FILTER_NONE       =  0,
+  XCF_ZSTD_FILTER_SHUFFLE    =  1   /* byte planes, for > 8-bit data */
+} XcfZstdFilterType;
+
 typedef enum
 {
   XCF_ORIENTATION_HORIZONTAL = 1,
@@ -110,7 +118,38 @@ struct _XcfInfo
   GimpLayer          *floating_sel;
   goffset             floating_sel_offset;
   XcfCompressionType  compression;
+  gint                compression_level;  /*  of zstd compression  */
   gint                file_version;
+
+  /*  the mapped file, when reading a local file  */
+  GMappedFile        *mapped;
+
+  /*  whether levels are loaded lazily, from the mapped file or, if the
+   *  file can't be mapped, from a separate stream of it
+   */
+  gboolean            lazy_load;
+  GInputStream       *lazy_input;
+
+  /*  while saving, the mappings of the files unchanged tiles are copied
+   *  from, and the levels stored in the file being written, by buffer
+   */
+  GHashTable         *copy_mapped_files;
+  GHashTable         *saved_levels;
+
+  /*  whether the tiles of the saved levels are written after the rest of
+   *  the image, from snapshots, and the levels that remain to be written
+   */
+  gboolean            defer_levels;
+  GList              *level_jobs;
+  volatile gint       n_level_jobs_done;
+
+  /*  whether a prerendered level of the projection is saved, which
+   *  level it is, and where its hierarchy's offset is written when
+   *  saving, or the offset itself when loading
+   */
+  gboolean            save_projection;
+  gint                projection_level;
+  goffset             projection_offset;
 };
 
 
@@ -17,6 +17,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gio/gio.h>
 
 #include "libgimpbase/gimpbase.h"
@@ -39,6 +41,26 @@ xcf_read_int8 (XcfInfo *info,
 {
   gsize bytes_read;
 
+  if (info->mapped)
+    {
+      gsize size = g_mapped_file_get_length (info->mapped);
+
+      bytes_read = 0;
+
+      if (info->cp < size)
+        {
+          bytes_read = MIN (count, size - info->cp);
+
+          memcpy (data,
+                  g_mapped_file_get_contents (info->mapped) + info->cp,
+                  bytes_read);
+        }
+
+      info->cp += bytes_read;
+
+      return bytes_read;
+    }
+
   g_input_stream_read_all (info->input, data, count,
                            &bytes_read, NULL, NULL);
 
@@ -20,6 +20,11 @@
 #include <string.h>
 #include <zlib.h>
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -31,8 +36,10 @@
 
 #include "gegl/gimp-babl-compat.h"
 #include "gegl/gimp-gegl-tile-compat.h"
+#include "gegl/gimptilehandlervalidate.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpchannel.h"
 #include "core/gimpdrawable.h"
@@ -48,7 +55,9 @@
 #include "core/gimplayer.h"
 #include "core/gimplayermask.h"
 #include "core/gimpparasitelist.h"
+#include "core/gimppickable.h"
 #include "core/gimpprogress.h"
+#include "core/gimpprojection.h"
 #include "core/gimpsamplepoint.h"
 
 #include "operations/layer-modes/gimp-layer-modes.h"
@@ -66,11 +75,58 @@
 #include "xcf-read.h"
 #include "xcf-save.h"
 #include "xcf-seek.h"
+#include "xcf-stored-level.h"
+#include "xcf-tile.h"
 #include "xcf-write.h"
 
 #include "gimp-intl.h"
 
 
+/*  the number of tiles of a level that are encoded at once  */
+#define XCF_SAVE_BATCH_SIZE 64
+
+/*  the saved level of the projection is the first one whose larger side
+ *  is at most this size
+ */
+#define XCF_SAVE_PROJECTION_SIZE 1024
+
+
+typedef struct
+{
+  XcfInfo    *info;
+  GeglBuffer *buffer;
+  const Babl *format;
+  gsize       max_data_length;
+  gint        first_tile;
+  gint        n_tiles;
+  guchar     *tile_data;
+  gssize     *tile_lengths;
+
+  /* the buffer's unchanged contents, as stored in an existing file  */
+  XcfStoredLevel *stored;
+  const guchar   *stored_data;
+  gsize           stored_data_size;
+} XcfSaveLevelData;
+
+/*  a level whose tiles remain to be written  */
+typedef struct
+{
+  GeglBuffer     *source;         /* the saved buffer                   */
+  GeglBuffer     *buffer;         /* the source, or a snapshot of it    */
+  const Babl     *format;
+  gint            n_tiles;
+  goffset         table_pos;      /* the position of the offset table   */
+  goffset         end_pos;        /* the end of the tiles, once written */
+
+  XcfStoredLevel *stored;
+  GMappedFile    *stored_mapped;
+
+  volatile gint   changed;        /* whether the source changed since
+                                   * the snapshot was taken
+                                   */
+} XcfSaveLevelJob;
+
+
 static gboolean xcf_save_image_props   (XcfInfo           *info,
                                         GimpImage         *image,
                                         GError           **error);
@@ -98,25 +154,24 @@ static gboolean xcf_save_channel       (XcfInfo           *info,
 static gboolean xcf_save_buffer        (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GError           **error);
+static GeglBuffer * xcf_save_render_projection
+                                       (GimpImage         *image,
+                                        gint               level);
 static gboolean xcf_save_level         (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GError           **error);
-static gboolean xcf_save_tile          (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
-                                        GError           **error);
-static gboolean xcf_save_tile_rle      (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
-                                        guchar            *rlebuf,
-                                        GError           **error);
-static gboolean xcf_save_tile_zlib     (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
+static gboolean xcf_save_level_job_run (XcfInfo           *info,
+                                        XcfSaveLevelJob   *job,
                                         GError           **error);
+static void     xcf_save_level_job_changed
+                                       (GeglBuffer        *buffer,
+                                        const GeglRectangle *rect,
+                                        XcfSaveLevelJob   *job);
+static void     xcf_save_level_job_free
+                                       (XcfSaveLevelJob   *job);
+static gboolean xcf_save_map_stored    (XcfInfo           *info,
+                                        XcfStoredLevel    *stored,
+                                        GMappedFile      **mapped_file);
 static gboolean xcf_save_parasite      (XcfInfo           *info,
                                         GimpParasite      *parasite,
                                         GError           **error);
@@ -130,6 +185,33 @@ static gboolean xcf_save_vectors       (XcfInfo           *info,
                                         GimpImage         *image,
                                         GError           **error);
 
+static void     xcf_save_level_encode_tiles
+                                       (gint               i,
+                                        gint               n,
+                                        XcfSaveLevelData  *data);
+static gssize   xcf_encode_tile        (XcfInfo           *info,
+                                        GeglBuffer        *buffer,
+                                        GeglRectangle     *tile_rect,
+                                        const Babl        *format,
+                                        guchar            *dest);
+static gssize   xcf_encode_tile_rle    (XcfInfo           *info,
+                                        GeglBuffer        *buffer,
+                                        GeglRectangle     *tile_rect,
+                                        const Babl        *format,
+                                        guchar            *rlebuf);
+static gssize   xcf_encode_tile_zlib   (XcfInfo           *info,
+                                        GeglBuffer        *buffer,
+                                        GeglRectangle     *tile_rect,
+                                        const Babl        *format,
+                                        guchar            *dest,
+                                        gsize              max_length);
+static gssize   xcf_encode_tile_zstd   (XcfInfo           *info,
+                                        GeglBuffer        *buffer,
+                                        GeglRectangle     *tile_rect,
+                                        const Babl        *format,
+                                        guchar            *dest,
+                                        gsize              max_length);
+
 
 /* private convenience macros */
 #define xcf_write_int32_check_error(info, data, count) G_STMT_START { \
@@ -275,6 +357,21 @@ xcf_save_image (XcfInfo    *info,
 
   max_progress = 1 + n_layers + n_channels;
 
+  /* pick the level of the projection to save along, if any */
+  if (info->save_projection)
+    {
+      gint size = MAX (gimp_image_get_width  (image),
+                       gimp_image_get_height (image));
+
+      info->projection_level = 0;
+
+      while ((size >> info->projection_level) > XCF_SAVE_PROJECTION_SIZE &&
+             info->projection_level < GIMP_TILE_HANDLER_VALIDATE_MAX_LEVELS)
+        {
+          info->projection_level++;
+        }
+    }
+
   /* write the property information for the image */
   xcf_check_error (xcf_save_image_props (info, image, error));
 
@@ -344,12 +441,85 @@ xcf_save_image (XcfInfo    *info,
    * the end of the channel offsets
    */
 
+  if (info->projection_level > 0)
+    {
+      GeglBuffer *buffer;
+      gboolean    success;
+
+      /* write the offset of the projection into its property, and the
+       * projection after the last channel
+       */
+      xcf_check_error (xcf_seek_pos (info, info->projection_offset, error));
+      xcf_write_offset_check_error (info, &offset, 1);
+
+      xcf_check_error (xcf_seek_pos (info, offset, error));
+
+      buffer = xcf_save_render_projection (image, info->projection_level);
+
+      success = xcf_save_buffer (info, buffer, error);
+
+      g_object_unref (buffer);
+
+      if (! success)
+        return FALSE;
+    }
+
   g_list_free (all_layers);
   g_list_free (all_channels);
 
   return ! g_output_stream_is_closed (info->output);
 }
 
+/*  writes the tiles of the levels that were deferred by xcf_save_image(),
+ *  at the end of the file.  doesn't touch the image, so it can run in a
+ *  separate thread while the image is being edited.
+ */
+gboolean
+xcf_save_level_jobs (XcfInfo  *info,
+                     GError  **error)
+{
+  GList *list;
+
+  info->level_jobs = g_list_reverse (info->level_jobs);
+
+  for (list = info->level_jobs; list; list = g_list_next (list))
+    {
+      XcfSaveLevelJob *job = list->data;
+
+      if (! xcf_save_level_job_run (info, job, error))
+        return FALSE;
+
+      /* the tiles of the next level are written after these ones */
+      if (! xcf_seek_pos (info, job->end_pos, error))
+        return FALSE;
+
+      g_atomic_int_inc (&info->n_level_jobs_done);
+    }
+
+  return TRUE;
+}
+
+/*  frees the deferred levels.  buffers that changed while their tiles
+ *  were being written don't get to remember where they were stored.
+ */
+void
+xcf_save_level_jobs_free (XcfInfo *info)
+{
+  GList *list;
+
+  for (list = info->level_jobs; list; list = g_list_next (list))
+    {
+      XcfSaveLevelJob *job = list->data;
+
+      if (g_atomic_int_get (&job->changed) && info->saved_levels)
+        g_hash_table_remove (info->saved_levels, job->source);
+
+      xcf_save_level_job_free (job);
+    }
+
+  g_clear_pointer (&info->level_jobs, g_list_free);
+}
+
 static gboolean
 xcf_save_image_props (XcfInfo    *info,
                       GimpImage  *image,
@@ -412,10 +582,9 @@ xcf_save_image_props (XcfInfo    *info,
 
   if (gimp_image_get_metadata (image))
     {
-      GimpMetadata *metadata = gimp_image_get_metadata (image);
-      gchar        *meta_string;
+      const gchar *meta_string;
 
-      meta_string = gimp_metadata_serialize (metadata);
+      meta_string = gimp_image_get_metadata_string (image);
 
       if (meta_string)
         {
@@ -424,10 +593,13 @@ xcf_save_image_props (XcfInfo    *info,
                                              strlen (meta_string) + 1,
                                              meta_string);
           gimp_parasite_list_add (private->parasites, meta_parasite);
-          g_free (meta_string);
         }
     }
 
+  if (info->projection_level > 0)
+    xcf_check_error (xcf_save_prop (info, image, PROP_PROJECTION, error,
+                                    info->projection_level));
+
   if (gimp_parasite_list_length (private->parasites) > 0)
     {
       xcf_check_error (xcf_save_prop (info, image, PROP_PARASITES, error,
@@ -685,6 +857,22 @@ xcf_save_prop (XcfInfo    *info,
       xcf_write_zero_offset_check_error (info, 1);
       break;
 
+    case PROP_PROJECTION:
+      {
+        guint32 level = va_arg (args, guint32);
+
+        size = 4 + info->bytes_per_offset;
+
+        xcf_write_prop_type_check_error (info, prop_type);
+        xcf_write_int32_check_error (info, &size, 1);
+
+        xcf_write_int32_check_error (info, &level, 1);
+
+        info->projection_offset = info->cp;
+        xcf_write_zero_offset_check_error (info, 1);
+      }
+      break;
+
     case PROP_OPACITY:
       {
         gdouble opacity      = va_arg (args, gdouble);
@@ -1500,172 +1688,509 @@ xcf_save_buffer (XcfInfo     *info,
   return TRUE;
 }
 
+static void
+xcf_save_level_encode_tiles (gint              i,
+                             gint              n,
+                             XcfSaveLevelData *data)
+{
+  gint tile;
+
+  for (tile = i; tile < data->n_tiles; tile += n)
+    {
+      GeglRectangle rect;
+      guchar       *dest = data->tile_data + tile * data->max_data_length;
+
+      if (data->stored_data)
+        {
+          goffset offset = data->stored->offsets[data->first_tile + tile];
+          gsize   length = data->stored->lengths[data->first_tile + tile];
+
+          /* copy the tile's data verbatim, if its length is known  */
+          if (length > 0                      &&
+              length <= data->max_data_length &&
+              offset <= data->stored_data_size &&
+              length <= data->stored_data_size - offset)
+            {
+              memcpy (dest, data->stored_data + offset, length);
+              data->tile_lengths[tile] = length;
+
+              continue;
+            }
+        }
+
+      gimp_gegl_buffer_get_tile_rect (data->buffer,
+                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                      data->first_tile + tile, &rect);
+
+      switch (data->info->compression)
+        {
+        case COMPRESS_NONE:
+          data->tile_lengths[tile] = xcf_encode_tile (data->info,
+                                                      data->buffer, &rect,
+                                                      data->format,
+                                                      dest);
+          break;
+        case COMPRESS_RLE:
+          data->tile_lengths[tile] = xcf_encode_tile_rle (data->info,
+                                                          data->buffer, &rect,
+                                                          data->format,
+                                                          dest);
+          break;
+        case COMPRESS_ZLIB:
+          data->tile_lengths[tile] = xcf_encode_tile_zlib (data->info,
+                                                           data->buffer, &rect,
+                                                           data->format,
+                                                           dest,
+                                                           data->max_data_length);
+          break;
+        case COMPRESS_ZSTD:
+          data->tile_lengths[tile] = xcf_encode_tile_zstd (data->info,
+                                                           data->buffer, &rect,
+                                                           data->format,
+                                                           dest,
+                                                           data->max_data_length);
+          break;
+        }
+    }
+}
+
+/*  renders level 'level' of the image's projection into a new buffer,
+ *  by pulling it from the projection's buffer at that level's scale
+ */
+static GeglBuffer *
+xcf_save_render_projection (GimpImage *image,
+                            gint       level)
+{
+  GimpPickable *pickable = GIMP_PICKABLE (gimp_image_get_projection (image));
+  const Babl   *format   = gimp_pickable_get_format (pickable);
+  GeglBuffer   *proj_buffer;
+  GeglBuffer   *buffer;
+  guchar       *data;
+  gint          width;
+  gint          height;
+  gint          y;
+
+  width  = (gimp_image_get_width  (image) + (1 << level) - 1) >> level;
+  height = (gimp_image_get_height (image) + (1 << level) - 1) >> level;
+
+  gimp_pickable_flush (pickable);
+
+  proj_buffer = gimp_pickable_get_buffer (pickable);
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height), format);
+
+  data = g_malloc ((gsize) width * XCF_TILE_HEIGHT *
+                   babl_format_get_bytes_per_pixel (format));
+
+  for (y = 0; y < height; y += XCF_TILE_HEIGHT)
+    {
+      GeglRectangle rect = { 0, y, width, MIN (XCF_TILE_HEIGHT, height - y) };
+
+      gegl_buffer_get (proj_buffer, &rect, 1.0 / (1 << level),
+                       format, data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_set (buffer, &rect, 0,
+                       format, data,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (data);
+
+  return buffer;
+}
+
 static gboolean
 xcf_save_level (XcfInfo     *info,
                 GeglBuffer  *buffer,
                 GError     **error)
 {
-  const Babl *format;
-  goffset    *offset_table;
-  goffset    *next_offset;
-  goffset     saved_pos;
-  goffset     offset;
-  goffset     max_data_length;
-  guint32     width;
-  guint32     height;
-  gint        bpp;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        i;
-  guchar     *rlebuf    = NULL;
-  GError     *tmp_error = NULL;
+  XcfSaveLevelJob *job;
+  const Babl      *format;
+  XcfStoredLevel  *stored;
+  goffset          table_pos;
+  guint32          width;
+  guint32          height;
+  gint             n_tile_rows;
+  gint             n_tile_cols;
+  guint            ntiles;
+  gboolean         success;
+  GError          *tmp_error = NULL;
 
   format = gegl_buffer_get_format (buffer);
 
   width  = gegl_buffer_get_width (buffer);
   height = gegl_buffer_get_height (buffer);
-  bpp    = babl_format_get_bytes_per_pixel (format);
 
   xcf_write_int32_check_error (info, (guint32 *) &width,  1);
   xcf_write_int32_check_error (info, (guint32 *) &height, 1);
 
-  saved_pos = info->cp;
-
-  /* maximal allowable size of on-disk tile data.  make it somewhat bigger than
-   * the uncompressed tile size, to allow for the possibility of negative
-   * compression.  xcf_load_level() enforces this limit.
-   */
-  max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
-                    XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
-
-  /* allocate a temporary buffer to store the rle data before it is
-   * written to disk
-   */
-  if (info->compression == COMPRESS_RLE)
-    rlebuf = g_alloca (max_data_length);
+  if (info->compression == COMPRESS_FRACTAL)
+    {
+      g_warning ("xcf: fractal compression unimplemented");
+      return FALSE;
+    }
 
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
 
-  /* allocate an offset table so we don't have to seek back after each
-   * tile, see bug #686862. allocate ntiles + 1 slots because a zero
+  /* 'table_pos' is the offset of the tile offset table  */
+  table_pos = info->cp;
+
+  /* write an empty offset table, with ntiles + 1 slots because a zero
    * offset indicates the offset table's end.
    */
-  offset_table = g_alloca ((ntiles + 1) * sizeof (goffset));
-  memset (offset_table, 0, (ntiles + 1) * sizeof (goffset));
-  next_offset = offset_table;
+  xcf_write_zero_offset_check_error (info, ntiles + 1);
 
-  /* 'saved_pos' is the offset of the tile offset table  */
-  saved_pos = info->cp;
+  job = g_slice_new0 (XcfSaveLevelJob);
 
-  /* write an empty offset table */
-  xcf_write_zero_offset_check_error (info, ntiles + 1);
+  job->source    = g_object_ref (buffer);
+  job->format    = format;
+  job->n_tiles   = ntiles;
+  job->table_pos = table_pos;
+
+  /* if the buffer didn't change since it was last loaded or saved, and
+   * its tiles were stored the same way they are saved now, copy them
+   * from the file they are stored in instead of encoding them.
+   */
+  stored = xcf_stored_level_get (buffer);
+
+  if (stored                                     &&
+      stored->file_version == info->file_version &&
+      stored->compression  == info->compression  &&
+      stored->format       == format             &&
+      stored->n_tiles      == ntiles             &&
+      xcf_save_map_stored (info, stored, &job->stored_mapped))
+    {
+      job->stored = xcf_stored_level_new (stored->file_version,
+                                          stored->compression,
+                                          stored->format,
+                                          stored->n_tiles,
+                                          stored->offsets,
+                                          stored->lengths);
+    }
+
+  if (info->defer_levels)
+    {
+      /* the tiles are written after the rest of the file, from a
+       * copy-on-write snapshot of the buffer, which is cheap to make
+       */
+      job->buffer = gegl_buffer_dup (buffer);
+
+      gegl_buffer_signal_connect (buffer, "changed",
+                                  G_CALLBACK (xcf_save_level_job_changed),
+                                  job);
+
+      info->level_jobs = g_list_prepend (info->level_jobs, job);
+
+      return TRUE;
+    }
+
+  job->buffer = g_object_ref (buffer);
+
+  success = xcf_save_level_job_run (info, job, error);
+
+  if (success)
+    {
+      /* seek to the end of the level */
+      success = xcf_seek_pos (info, job->end_pos, error);
+    }
+
+  xcf_save_level_job_free (job);
+
+  return success;
+}
+
+/*  writes the tiles of a level at the current position, possibly in a
+ *  separate thread, and fills in its offset table.  leaves the position
+ *  at the offset table's end; the end of the tiles is 'job->end_pos'.
+ */
+static gboolean
+xcf_save_level_job_run (XcfInfo          *info,
+                        XcfSaveLevelJob  *job,
+                        GError          **error)
+{
+  XcfSaveLevelData  data;
+  goffset          *offset_table;
+  goffset          *next_offset;
+  gsize            *lengths;
+  goffset           offset;
+  goffset           max_data_length;
+  gint              bpp;
+  gint              batch_size;
+  gint              i;
+  gint              j;
+  GError           *tmp_error = NULL;
+
+  bpp = babl_format_get_bytes_per_pixel (job->format);
+
+  /* maximal allowable size of on-disk tile data.  make it somewhat bigger than
+   * the uncompressed tile size, to allow for the possibility of negative
+   * compression.  xcf_load_level() enforces this limit.
+   */
+  max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
+                    XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
+
+  /* allocate an offset table so we don't have to seek back after each
+   * tile, see bug #686862.
+   */
+  offset_table = g_new0 (goffset, job->n_tiles + 1);
+  next_offset  = offset_table;
 
   /* 'offset' is where we will write the next tile */
   offset = info->cp;
 
-  for (i = 0; i < ntiles; i++)
+  /* the tiles are encoded in batches, in parallel, into a bounded
+   * buffer, and each batch is then written in order, so that the file
+   * is the same as if the tiles were encoded one by one.
+   */
+  batch_size = MIN (job->n_tiles, XCF_SAVE_BATCH_SIZE);
+
+  data.info            = info;
+  data.buffer          = job->buffer;
+  data.format          = job->format;
+  data.max_data_length = max_data_length;
+  data.tile_data       = g_malloc (batch_size * max_data_length);
+  data.tile_lengths    = g_new (gssize, batch_size);
+  data.stored          = job->stored;
+  data.stored_data     = NULL;
+
+  if (job->stored)
     {
-      GeglRectangle rect;
+      data.stored_data      = (const guchar *)
+                              g_mapped_file_get_contents (job->stored_mapped);
+      data.stored_data_size = g_mapped_file_get_length (job->stored_mapped);
+    }
 
-      /* store the offset in the table and increment the next pointer */
-      *next_offset++ = offset;
+  lengths = g_new (gsize, job->n_tiles);
 
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+  for (i = 0; i < job->n_tiles; i += batch_size)
+    {
+      data.first_tile = i;
+      data.n_tiles    = MIN (job->n_tiles - i, batch_size);
+
+      gimp_parallel_distribute (data.n_tiles,
+                                (GimpParallelDistributeFunc)
+                                xcf_save_level_encode_tiles,
+                                &data);
 
-      /* write out the tile. */
-      switch (info->compression)
+      /* while this batch is being written, read the tiles of the next
+       * batch in the background, in case they were swapped out.
+       */
+      if (! job->stored && i + batch_size < job->n_tiles)
         {
-        case COMPRESS_NONE:
-          xcf_check_error (xcf_save_tile (info, buffer, &rect, format,
-                                          error));
-          break;
-        case COMPRESS_RLE:
-          xcf_check_error (xcf_save_tile_rle (info, buffer, &rect, format,
-                                              rlebuf, error));
-          break;
-        case COMPRESS_ZLIB:
-          xcf_check_error (xcf_save_tile_zlib (info, buffer, &rect, format,
-                                               error));
-          break;
-        case COMPRESS_FRACTAL:
-          g_warning ("xcf: fractal compression unimplemented");
-          return FALSE;
+          GeglRectangle first;
+          GeglRectangle last;
+
+          gimp_gegl_buffer_get_tile_rect (job->buffer,
+                                          XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                          i + batch_size, &first);
+          gimp_gegl_buffer_get_tile_rect (job->buffer,
+                                          XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                          MIN (i + 2 * batch_size,
+                                               job->n_tiles) - 1,
+                                          &last);
+
+          gegl_rectangle_bounding_box (&first, &first, &last);
+
+          gimp_gegl_buffer_prefetch (job->buffer, &first);
         }
 
-      /* make sure the on-disk tile data didn't end up being too big.
-       * xcf_load_level() would refuse to load the file if it did.
-       */
-      if (info->cp < offset || info->cp - offset > max_data_length)
+      for (j = 0; j < data.n_tiles; j++)
         {
-          g_message ("xcf: invalid tile data length: %" G_GOFFSET_FORMAT,
-                     info->cp - offset);
-          return FALSE;
+          /* store the offset in the table and increment the next pointer */
+          *next_offset++ = offset;
+
+          /* make sure the on-disk tile data didn't end up being too big.
+           * xcf_load_level() would refuse to load the file if it did.
+           */
+          if (data.tile_lengths[j] < 0)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Error writing XCF: failed to compress tile"));
+
+              goto error;
+            }
+          else if (data.tile_lengths[j] > max_data_length)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Error writing XCF: invalid tile data length: "
+                             "%" G_GSSIZE_FORMAT),
+                           data.tile_lengths[j]);
+
+              goto error;
+            }
+
+          lengths[i + j] = data.tile_lengths[j];
+
+          /* write out the tile. */
+          xcf_write_int8 (info, data.tile_data + j * max_data_length,
+                          data.tile_lengths[j], &tmp_error);
+
+          if (tmp_error)
+            {
+              g_propagate_error (error, tmp_error);
+
+              goto error;
+            }
+
+          /* the next tile's offset is after the tile we just wrote */
+          offset = info->cp;
         }
+    }
 
-      /* the next tile's offset is after the tile we just wrote */
-      offset = info->cp;
+  g_free (data.tile_data);
+  g_free (data.tile_lengths);
+
+  /* remember where the tiles are stored, for the next save  */
+  if (info->saved_levels && job->n_tiles > 0)
+    {
+      g_hash_table_insert (info->saved_levels,
+                           g_object_ref (job->source),
+                           xcf_stored_level_new (info->file_version,
+                                                 info->compression,
+                                                 job->format,
+                                                 job->n_tiles, offset_table,
+                                                 lengths));
     }
 
+  g_free (lengths);
+
+  job->end_pos = offset;
+
   /* seek back to the offset table and write it  */
-  xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_offset_check_error (info, offset_table, ntiles + 1);
+  if (! xcf_seek_pos (info, job->table_pos, error))
+    {
+      g_free (offset_table);
+      return FALSE;
+    }
+
+  xcf_write_offset (info, offset_table, job->n_tiles + 1, &tmp_error);
+
+  g_free (offset_table);
 
-  /* seek to the end of the file */
-  xcf_check_error (xcf_seek_pos (info, offset, error));
+  if (tmp_error)
+    {
+      g_propagate_error (error, tmp_error);
+      return FALSE;
+    }
 
   return TRUE;
+
+ error:
+  g_free (data.tile_data);
+  g_free (data.tile_lengths);
+  g_free (lengths);
+  g_free (offset_table);
+
+  return FALSE;
+}
+
+static void
+xcf_save_level_job_changed (GeglBuffer          *buffer,
+                            const GeglRectangle *rect,
+                            XcfSaveLevelJob     *job)
+{
+  /* can be called from any thread  */
+  g_atomic_int_set (&job->changed, TRUE);
+}
+
+static void
+xcf_save_level_job_free (XcfSaveLevelJob *job)
+{
+  g_signal_handlers_disconnect_by_func (job->source,
+                                        xcf_save_level_job_changed,
+                                        job);
+
+  g_object_unref (job->source);
+  g_clear_object (&job->buffer);
+
+  if (job->stored)
+    xcf_stored_level_free (job->stored);
+
+  g_clear_pointer (&job->stored_mapped, g_mapped_file_unref);
+
+  g_slice_free (XcfSaveLevelJob, job);
 }
 
 static gboolean
-xcf_save_tile (XcfInfo        *info,
-               GeglBuffer     *buffer,
-               GeglRectangle  *tile_rect,
-               const Babl     *format,
-               GError        **error)
+xcf_save_map_stored (XcfInfo         *info,
+                     XcfStoredLevel  *stored,
+                     GMappedFile    **mapped_file)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  GError *tmp_error = NULL;
+  GMappedFile *mapped = NULL;
+  gchar       *key;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  if (! info->copy_mapped_files)
+    return FALSE;
+
+  key = xcf_stored_level_get_file_key (stored);
 
-  if (info->file_version <= 11)
+  if (! key)
+    return FALSE;
+
+  /* each file is only mapped once per save  */
+  if (! g_hash_table_lookup_extended (info->copy_mapped_files, key,
+                                      NULL, (gpointer *) &mapped))
     {
-      xcf_write_int8_check_error (info, tile_data, tile_size);
+      mapped = xcf_stored_level_map_file (stored);
+
+      g_hash_table_insert (info->copy_mapped_files, key, mapped);
     }
   else
+    {
+      g_free (key);
+    }
+
+  if (! mapped)
+    return FALSE;
+
+  *mapped_file = g_mapped_file_ref (mapped);
+
+  return TRUE;
+}
+
+/*  the tile encoders below are called from multiple threads at once.
+ *  they write the tile's on-disk data to 'dest', which can hold the
+ *  maximal allowable tile data length, and return its length, or -1 on
+ *  error.
+ */
+
+static gssize
+xcf_encode_tile (XcfInfo       *info,
+                 GeglBuffer    *buffer,
+                 GeglRectangle *tile_rect,
+                 const Babl    *format,
+                 guchar        *dest)
+{
+  gint bpp       = babl_format_get_bytes_per_pixel (format);
+  gint tile_size = bpp * tile_rect->width * tile_rect->height;
+
+  gegl_buffer_get (buffer, tile_rect, 1.0, format, dest,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (info->file_version >= 12)
     {
       gint n_components = babl_format_get_n_components (format);
 
-      xcf_write_component_check_error (info, bpp / n_components, tile_data,
-                                       tile_size / bpp * n_components);
+      xcf_write_to_be (bpp / n_components, dest,
+                       tile_size / bpp * n_components);
     }
 
-  return TRUE;
+  return tile_size;
 }
 
-static gboolean
-xcf_save_tile_rle (XcfInfo        *info,
-                   GeglBuffer     *buffer,
-                   GeglRectangle  *tile_rect,
-                   const Babl     *format,
-                   guchar         *rlebuf,
-                   GError        **error)
+static gssize
+xcf_encode_tile_rle (XcfInfo       *info,
+                     GeglBuffer    *buffer,
+                     GeglRectangle *tile_rect,
+                     const Babl    *format,
+                     guchar        *rlebuf)
 {
   gint    bpp       = babl_format_get_bytes_per_pixel (format);
   gint    tile_size = bpp * tile_rect->width * tile_rect->height;
   guchar *tile_data = g_alloca (tile_size);
-  gint    len       = 0;
-  gint    i, j;
-  GError *tmp_error  = NULL;
 
   gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
@@ -1678,127 +2203,21 @@ xcf_save_tile_rle (XcfInfo        *info,
                        tile_size / bpp * n_components);
     }
 
-  for (i = 0; i < bpp; i++)
-    {
-      const guchar *data   = tile_data + i;
-      gint          state  = 0;
-      gint          length = 0;
-      gint          count  = 0;
-      gint          size   = tile_rect->width * tile_rect->height;
-      guint         last   = -1;
-
-      while (size > 0)
-        {
-          switch (state)
-            {
-            case 0:
-              /* in state 0 we try to find a long sequence of
-               *  matching values.
-               */
-              if ((length == 32768) ||
-                  ((size - length) <= 0) ||
-                  ((length > 1) && (last != *data)))
-                {
-                  count += length;
-
-                  if (length >= 128)
-                    {
-                      rlebuf[len++] = 127;
-                      rlebuf[len++] = (length >> 8);
-                      rlebuf[len++] = length & 0x00FF;
-                      rlebuf[len++] = last;
-                    }
-                  else
-                    {
-                      rlebuf[len++] = length - 1;
-                      rlebuf[len++] = last;
-                    }
-
-                  size -= length;
-                  length = 0;
-                }
-              else if ((length == 1) && (last != *data))
-                {
-                  state = 1;
-                }
-              break;
-
-            case 1:
-              /* in state 1 we try and find a long sequence of
-               *  non-matching values.
-               */
-              if ((length == 32768) ||
-                  ((size - length) == 0) ||
-                  ((length > 0) && (last == *data) &&
-                   ((size - length) == 1 || last == data[bpp])))
-                {
-                  const guchar *t;
-
-                  /* if we came here because of a new run, backup one */
-                  if (!((length == 32768) || ((size - length) == 0)))
-                    {
-                      length--;
-                      data -= bpp;
-                    }
-
-                  count += length;
-                  state = 0;
-
-                  if (length >= 128)
-                    {
-                      rlebuf[len++] = 255 - 127;
-                      rlebuf[len++] = (length >> 8);
-                      rlebuf[len++] = length & 0x00FF;
-                    }
-                  else
-                    {
-                      rlebuf[len++] = 255 - (length - 1);
-                    }
-
-                  t = data - length * bpp;
-
-                  for (j = 0; j < length; j++)
-                    {
-                      rlebuf[len++] = *t;
-                      t += bpp;
-                    }
-
-                  size -= length;
-                  length = 0;
-                }
-              break;
-            }
-
-          if (size > 0)
-            {
-              length += 1;
-              last = *data;
-              data += bpp;
-            }
-        }
-
-      if (count != (tile_rect->width * tile_rect->height))
-        g_message ("xcf: uh oh! xcf rle tile saving error: %d", count);
-    }
-
-  xcf_write_int8_check_error (info, rlebuf, len);
-
-  return TRUE;
+  return xcf_tile_encode_rle (bpp, tile_data,
+                              tile_rect->width * tile_rect->height, rlebuf);
 }
 
-static gboolean
-xcf_save_tile_zlib (XcfInfo        *info,
-                    GeglBuffer     *buffer,
-                    GeglRectangle  *tile_rect,
-                    const Babl     *format,
-                    GError        **error)
+static gssize
+xcf_encode_tile_zlib (XcfInfo       *info,
+                      GeglBuffer    *buffer,
+                      GeglRectangle *tile_rect,
+                      const Babl    *format,
+                      guchar        *dest,
+                      gsize          max_length)
 {
   gint      bpp       = babl_format_get_bytes_per_pixel (format);
   gint      tile_size = bpp * tile_rect->width * tile_rect->height;
   guchar   *tile_data = g_alloca (tile_size);
-  /* The buffer for compressed data. */
-  guchar   *buf       = g_alloca (tile_size);
-  GError   *tmp_error = NULL;
   z_stream  strm;
   int       action;
   int       status;
@@ -1821,12 +2240,12 @@ xcf_save_tile_zlib (XcfInfo        *info,
 
   status = deflateInit (&strm, Z_DEFAULT_COMPRESSION);
   if (status != Z_OK)
-    return FALSE;
+    return -1;
 
   strm.next_in   = tile_data;
   strm.avail_in  = tile_size;
-  strm.next_out  = buf;
-  strm.avail_out = tile_size;
+  strm.next_out  = dest;
+  strm.avail_out = max_length;
 
   action = Z_NO_FLUSH;
 
@@ -1840,26 +2259,23 @@ xcf_save_tile_zlib (XcfInfo        *info,
 
       status = deflate (&strm, action);
 
-      if (status == Z_STREAM_END || status == Z_BUF_ERROR)
+      if (status == Z_BUF_ERROR && strm.avail_out == 0)
         {
-          size_t write_size = tile_size - strm.avail_out;
-
-          xcf_write_int8_check_error (info, buf, write_size);
-
-          /* Reset next_out and avail_out. */
-          strm.next_out  = buf;
-          strm.avail_out = tile_size;
+          /* the compressed tile doesn't fit the allowable length */
+          deflateEnd (&strm);
+          return max_length + 1;
         }
-      else if (status != Z_OK)
+      else if (status != Z_OK && status != Z_BUF_ERROR &&
+               status != Z_STREAM_END)
         {
           g_printerr ("xcf: tile compression failed: %s", zError (status));
           deflateEnd (&strm);
-          return FALSE;
+          return -1;
         }
     }
 
   deflateEnd (&strm);
-  return TRUE;
+  return max_length - strm.avail_out;
 }
 
 static gboolean
@@ -2188,3 +2604,93 @@ xcf_save_vectors (XcfInfo    *info,
 
   return TRUE;
 }
+
+#ifdef HAVE_ZSTD
+
+static void
+xcf_free_zstd_context (ZSTD_CCtx *cctx)
+{
+  ZSTD_freeCCtx (cctx);
+}
+
+/*  each thread keeps its compression context, since creating one is
+ *  much more expensive than compressing a tile
+ */
+static GPrivate xcf_zstd_context =
+  G_PRIVATE_INIT ((GDestroyNotify) xcf_free_zstd_context);
+
+#endif
+
+static gssize
+xcf_encode_tile_zstd (XcfInfo       *info,
+                      GeglBuffer    *buffer,
+                      GeglRectangle *tile_rect,
+                      const Babl    *format,
+                      guchar        *dest,
+                      gsize          max_length)
+{
+#ifdef HAVE_ZSTD
+  gint       bpp          = babl_format_get_bytes_per_pixel (format);
+  gint       n_components = babl_format_get_n_components (format);
+  gint       bpc          = bpp / n_components;
+  gint       tile_size    = bpp * tile_rect->width * tile_rect->height;
+  guchar    *tile_data    = g_alloca (tile_size);
+  guchar    *src          = tile_data;
+  ZSTD_CCtx *cctx;
+  gsize      length;
+
+  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  xcf_write_to_be (bpc, tile_data, tile_size / bpc);
+
+  /* high bit depth data is split into byte planes first  */
+  if (bpc > 1)
+    {
+      src = g_alloca (tile_size);
+
+      xcf_tile_shuffle (bpc, tile_data, src, tile_size / bpc);
+
+      dest[0] = XCF_ZSTD_FILTER_SHUFFLE;
+    }
+  else
+    {
+      dest[0] = XCF_ZSTD_FILTER_NONE;
+    }
+
+  cctx = g_private_get (&xcf_zstd_context);
+
+  if (! cctx)
+    {
+      cctx = ZSTD_createCCtx ();
+
+      if (! cctx)
+        return -1;
+
+      g_private_set (&xcf_zstd_context, cctx);
+    }
+
+  length = ZSTD_compressCCtx (cctx,
+                              dest + 1, max_length - 1,
+                              src, tile_size,
+                              info->compression_level);
+
+  if (ZSTD_isError (length))
+    {
+      if (ZSTD_getErrorCode (length) == ZSTD_error_dstSize_tooSmall)
+        {
+          /* the compressed tile doesn't fit the allowable length */
+          return max_length + 1;
+        }
+
+      g_printerr ("xcf: tile compression failed: %s",
+                  ZSTD_getErrorName (length));
+      return -1;
+    }
+
+  return length + 1;
+#else
+  g_warning ("xcf: zstd compression is not supported by this build");
+  return -1;
+#endif
+}
@@ -19,9 +19,13 @@
 #define __XCF_SAVE_H__
 
 
-gboolean   xcf_save_image (XcfInfo    *info,
-                           GimpImage  *image,
-                           GError    **error);
+gboolean   xcf_save_image           (XcfInfo    *info,
+                                     GimpImage  *image,
+                                     GError    **error);
+
+gboolean   xcf_save_level_jobs      (XcfInfo    *info,
+                                     GError    **error);
+void       xcf_save_level_jobs_free (XcfInfo    *info);
 
 
 #endif  /* __XCF_SAVE_H__ */
@@ -32,7 +32,14 @@ xcf_seek_pos (XcfInfo  *info,
               goffset   pos,
               GError  **error)
 {
-  if (info->cp != pos)
+  if (info->mapped)
+    {
+      /*  reading past the end of the mapping reads nothing, like
+       *  reading past the end of the stream
+       */
+      info->cp = pos;
+    }
+  else if (info->cp != pos)
     {
       GError *my_error = NULL;
 
@@ -0,0 +1,262 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "core/core-types.h"
+
+#include "xcf-private.h"
+#include "xcf-stored-level.h"
+
+
+#define XCF_STORED_LEVEL_KEY "gimp-xcf-stored-level"
+
+
+static gboolean   xcf_stored_level_query_file     (GFile               *file,
+                                                   goffset             *size,
+                                                   guint64             *mtime,
+                                                   guint32             *mtime_usec);
+
+static void       xcf_stored_level_buffer_changed (GeglBuffer          *buffer,
+                                                   const GeglRectangle *rect,
+                                                   gpointer             data);
+
+
+/*  public functions  */
+
+XcfStoredLevel *
+xcf_stored_level_new (gint                file_version,
+                      XcfCompressionType  compression,
+                      const Babl         *format,
+                      gint                n_tiles,
+                      const goffset      *offsets,
+                      const gsize        *lengths)
+{
+  XcfStoredLevel *level;
+
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (n_tiles >= 0, NULL);
+  g_return_val_if_fail (offsets != NULL || n_tiles == 0, NULL);
+  g_return_val_if_fail (lengths != NULL || n_tiles == 0, NULL);
+
+  level = g_slice_new0 (XcfStoredLevel);
+
+  level->file_version = file_version;
+  level->compression  = compression;
+  level->format       = format;
+  level->n_tiles      = n_tiles;
+  level->offsets      = g_memdup (offsets, n_tiles * sizeof (goffset));
+  level->lengths      = g_memdup (lengths, n_tiles * sizeof (gsize));
+
+  return level;
+}
+
+void
+xcf_stored_level_free (XcfStoredLevel *level)
+{
+  g_return_if_fail (level != NULL);
+
+  g_clear_object (&level->file);
+
+  g_free (level->offsets);
+  g_free (level->lengths);
+
+  g_slice_free (XcfStoredLevel, level);
+}
+
+/*  associates the level with the file it is stored in, which has to be
+ *  complete.  the file's size and modification time are remembered, so
+ *  that later changes to the file can be detected.
+ */
+gboolean
+xcf_stored_level_set_file (XcfStoredLevel *level,
+                           GFile          *file)
+{
+  g_return_val_if_fail (level != NULL, FALSE);
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+  g_clear_object (&level->file);
+
+  if (! g_file_is_native (file) ||
+      ! xcf_stored_level_query_file (file,
+                                     &level->file_size,
+                                     &level->file_mtime,
+                                     &level->file_mtime_usec))
+    {
+      return FALSE;
+    }
+
+  level->file = g_object_ref (file);
+
+  return TRUE;
+}
+
+/*  returns whether the level's file is still the one it was stored in  */
+gboolean
+xcf_stored_level_is_current (XcfStoredLevel *level)
+{
+  goffset size;
+  guint64 mtime;
+  guint32 mtime_usec;
+
+  g_return_val_if_fail (level != NULL, FALSE);
+
+  if (! level->file)
+    return FALSE;
+
+  if (! xcf_stored_level_query_file (level->file, &size, &mtime, &mtime_usec))
+    return FALSE;
+
+  return (size       == level->file_size  &&
+          mtime      == level->file_mtime &&
+          mtime_usec == level->file_mtime_usec);
+}
+
+/*  returns a string identifying the level's file, as it was when the
+ *  level was stored in it
+ */
+gchar *
+xcf_stored_level_get_file_key (XcfStoredLevel *level)
+{
+  gchar *uri;
+  gchar *key;
+
+  g_return_val_if_fail (level != NULL, NULL);
+
+  if (! level->file)
+    return NULL;
+
+  uri = g_file_get_uri (level->file);
+
+  key = g_strdup_printf ("%s:%" G_GOFFSET_FORMAT ":%" G_GUINT64_FORMAT ":%u",
+                         uri,
+                         level->file_size,
+                         level->file_mtime,
+                         level->file_mtime_usec);
+
+  g_free (uri);
+
+  return key;
+}
+
+/*  maps the level's file, if it is still the one the level was stored
+ *  in
+ */
+GMappedFile *
+xcf_stored_level_map_file (XcfStoredLevel *level)
+{
+  GMappedFile *mapped = NULL;
+  gchar       *path;
+
+  g_return_val_if_fail (level != NULL, NULL);
+
+  if (! xcf_stored_level_is_current (level))
+    return NULL;
+
+  path = g_file_get_path (level->file);
+
+  if (path)
+    mapped = g_mapped_file_new (path, FALSE, NULL);
+
+  g_free (path);
+
+  /*  make sure the file wasn't replaced in the meantime  */
+  if (mapped &&
+      g_mapped_file_get_length (mapped) != level->file_size)
+    {
+      g_clear_pointer (&mapped, g_mapped_file_unref);
+    }
+
+  return mapped;
+}
+
+/*  attaches the level to 'buffer', which takes ownership of it.  the
+ *  level is dropped as soon as the buffer changes.
+ */
+void
+xcf_stored_level_attach (XcfStoredLevel *level,
+                         GeglBuffer     *buffer)
+{
+  g_return_if_fail (level != NULL);
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+
+  if (! g_object_get_data (G_OBJECT (buffer), XCF_STORED_LEVEL_KEY))
+    {
+      gegl_buffer_signal_connect (buffer, "changed",
+                                  G_CALLBACK (xcf_stored_level_buffer_changed),
+                                  NULL);
+    }
+
+  g_object_set_data_full (G_OBJECT (buffer), XCF_STORED_LEVEL_KEY, level,
+                          (GDestroyNotify) xcf_stored_level_free);
+}
+
+XcfStoredLevel *
+xcf_stored_level_get (GeglBuffer *buffer)
+{
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+
+  return g_object_get_data (G_OBJECT (buffer), XCF_STORED_LEVEL_KEY);
+}
+
+
+/*  private functions  */
+
+static gboolean
+xcf_stored_level_query_file (GFile   *file,
+                             goffset *size,
+                             guint64 *mtime,
+                             guint32 *mtime_usec)
+{
+  GFileInfo *info;
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, NULL);
+
+  if (! info)
+    return FALSE;
+
+  *size       = g_file_info_get_size (info);
+  *mtime      = g_file_info_get_attribute_uint64 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  *mtime_usec = g_file_info_get_attribute_uint32 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+  g_object_unref (info);
+
+  return TRUE;
+}
+
+static void
+xcf_stored_level_buffer_changed (GeglBuffer          *buffer,
+                                 const GeglRectangle *rect,
+                                 gpointer             data)
+{
+  g_signal_handlers_disconnect_by_func (buffer,
+                                        xcf_stored_level_buffer_changed,
+                                        NULL);
+
+  g_object_set_data (G_OBJECT (buffer), XCF_STORED_LEVEL_KEY, NULL);
+}
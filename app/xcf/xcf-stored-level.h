@@ -0,0 +1,63 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_STORED_LEVEL_H__
+#define __XCF_STORED_LEVEL_H__
+
+
+/*  where the unchanged contents of a buffer are stored in an XCF file,
+ *  so that they can be copied verbatim when the buffer is saved again
+ */
+typedef struct _XcfStoredLevel XcfStoredLevel;
+
+struct _XcfStoredLevel
+{
+  GFile              *file;
+  goffset             file_size;
+  guint64             file_mtime;
+  guint32             file_mtime_usec;
+
+  gint                file_version;
+  XcfCompressionType  compression;
+  const Babl         *format;
+
+  gint                n_tiles;
+  goffset            *offsets;
+  gsize              *lengths;  /*  0 if unknown  */
+};
+
+
+XcfStoredLevel * xcf_stored_level_new          (gint                file_version,
+                                                XcfCompressionType  compression,
+                                                const Babl         *format,
+                                                gint                n_tiles,
+                                                const goffset      *offsets,
+                                                const gsize        *lengths);
+void             xcf_stored_level_free         (XcfStoredLevel     *level);
+
+gboolean         xcf_stored_level_set_file     (XcfStoredLevel     *level,
+                                                GFile              *file);
+gboolean         xcf_stored_level_is_current   (XcfStoredLevel     *level);
+gchar          * xcf_stored_level_get_file_key (XcfStoredLevel     *level);
+GMappedFile    * xcf_stored_level_map_file     (XcfStoredLevel     *level);
+
+void             xcf_stored_level_attach       (XcfStoredLevel     *level,
+                                                GeglBuffer         *buffer);
+XcfStoredLevel * xcf_stored_level_get          (GeglBuffer         *buffer);
+
+
+#endif  /* __XCF_STORED_LEVEL_H__ */
@@ -0,0 +1,109 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * xcf-tile-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "xcf-tile-sse2.h"
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+#include <emmintrin.h>
+
+
+/*  these functions scan a byte plane 16 bytes at a time, and return
+ *  the same results as their generic counterparts in xcf-tile.c
+ */
+
+
+/*  returns the number of bytes at the start of 'data' which are equal
+ *  to the first one, at most 'max_length'
+ */
+gint
+xcf_tile_rle_run_length_sse2 (const guchar *data,
+                              gint          max_length)
+{
+  const __m128i v_first = _mm_set1_epi8 (data[0]);
+  gint          length  = 1;
+
+  while (length + 16 <= max_length)
+    {
+      __m128i v_data = _mm_loadu_si128 ((const __m128i *) (data + length));
+      gint    mask;
+
+      mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (v_data, v_first));
+
+      if (mask != 0xffff)
+        return length + g_bit_nth_lsf (~mask & 0xffff, -1);
+
+      length += 16;
+    }
+
+  while (length < max_length && data[length] == data[0])
+    length++;
+
+  return length;
+}
+
+/*  returns the length of the literal span at the start of the 'length'
+ *  bytes of 'data', which ends before the first run of three equal
+ *  bytes, or of two at the end of the data, at most 'max_length'
+ */
+gint
+xcf_tile_rle_literal_length_sse2 (const guchar *data,
+                                  gint          length,
+                                  gint          max_length)
+{
+  gint end = MIN (length, max_length);
+  gint i   = 1;
+
+  /*  compare data[i - 1 .. i + 16], staying clear of the last byte,
+   *  which is special-cased
+   */
+  while (i + 16 < length && i + 16 <= end)
+    {
+      __m128i v_prev = _mm_loadu_si128 ((const __m128i *) (data + i - 1));
+      __m128i v_cur  = _mm_loadu_si128 ((const __m128i *) (data + i));
+      __m128i v_next = _mm_loadu_si128 ((const __m128i *) (data + i + 1));
+      gint    mask;
+
+      mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (v_prev, v_cur),
+                                               _mm_cmpeq_epi8 (v_cur,  v_next)));
+
+      if (mask)
+        return i + g_bit_nth_lsf (mask, -1) - 1;
+
+      i += 16;
+    }
+
+  for (; i < end; i++)
+    {
+      if (data[i] == data[i - 1] &&
+          (i == length - 1 || data[i + 1] == data[i]))
+        {
+          return i - 1;
+        }
+    }
+
+  return end;
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -0,0 +1,35 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * xcf-tile-sse2.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_TILE_SSE2_H__
+#define __XCF_TILE_SSE2_H__
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+gint   xcf_tile_rle_run_length_sse2     (const guchar *data,
+                                         gint          max_length);
+gint   xcf_tile_rle_literal_length_sse2 (const guchar *data,
+                                         gint          length,
+                                         gint          max_length);
+
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+
+#endif /* __XCF_TILE_SSE2_H__ */
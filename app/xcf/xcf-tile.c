@@ -0,0 +1,607 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "xcf-private.h"
+#include "xcf-read.h"
+#include "xcf-tile.h"
+#include "xcf-tile-sse2.h"
+
+
+static gsize      xcf_tile_encode_rle_plane (const guchar  *data,
+                                             gint           size,
+                                             guchar        *dest,
+                                             gboolean       sse2);
+static gboolean   xcf_tile_decode_rle_plane (const guchar **data,
+                                             const guchar  *datalimit,
+                                             guchar        *dest,
+                                             gint           size);
+
+static gboolean   xcf_tile_decode_rle  (const Babl   *format,
+                                        gint          width,
+                                        gint          height,
+                                        const guchar *data,
+                                        gsize         data_length,
+                                        guchar       *tile_data);
+static gboolean   xcf_tile_decode_zlib (const Babl   *format,
+                                        gint          width,
+                                        gint          height,
+                                        const guchar *data,
+                                        gsize         data_length,
+                                        guchar       *tile_data);
+static gboolean   xcf_tile_decode_zstd (const Babl   *format,
+                                        gint          width,
+                                        gint          height,
+                                        const guchar *data,
+                                        gsize         data_length,
+                                        guchar       *tile_data);
+
+
+/*  public functions  */
+
+/*  decodes the on-disk 'data' of a width x height tile into 'tile_data',
+ *  in 'format'.  a tile without data is decoded as empty.  doesn't
+ *  touch any shared state, so it can be called from multiple threads at
+ *  once.
+ */
+gboolean
+xcf_tile_decode (gint                file_version,
+                 XcfCompressionType  compression,
+                 const Babl         *format,
+                 gint                width,
+                 gint                height,
+                 const guchar       *data,
+                 gsize               data_length,
+                 guchar             *tile_data)
+{
+  gint bpp;
+  gint tile_size;
+
+  g_return_val_if_fail (format != NULL, FALSE);
+  g_return_val_if_fail (data != NULL || data_length == 0, FALSE);
+  g_return_val_if_fail (tile_data != NULL, FALSE);
+
+  bpp       = babl_format_get_bytes_per_pixel (format);
+  tile_size = bpp * width * height;
+
+  switch (compression)
+    {
+    case COMPRESS_NONE:
+      memcpy (tile_data, data, MIN (data_length, tile_size));
+
+      if (data_length < tile_size)
+        memset (tile_data + data_length, 0, tile_size - data_length);
+      break;
+
+    case COMPRESS_RLE:
+      if (! xcf_tile_decode_rle (format, width, height,
+                                 data, data_length, tile_data))
+        return FALSE;
+      break;
+
+    case COMPRESS_ZLIB:
+      if (! xcf_tile_decode_zlib (format, width, height,
+                                  data, data_length, tile_data))
+        return FALSE;
+      break;
+
+    case COMPRESS_ZSTD:
+      if (! xcf_tile_decode_zstd (format, width, height,
+                                  data, data_length, tile_data))
+        return FALSE;
+      break;
+
+    case COMPRESS_FRACTAL:
+      g_printerr ("xcf: fractal compression unimplemented. "
+                  "Possibly corrupt XCF file.");
+      return FALSE;
+
+    default:
+      g_printerr ("xcf: unknown compression. "
+                  "Possibly corrupt XCF file.");
+      return FALSE;
+    }
+
+  if (file_version >= 12)
+    {
+      gint n_components = babl_format_get_n_components (format);
+
+      xcf_read_from_be (bpp / n_components, tile_data,
+                        tile_size / bpp * n_components);
+    }
+
+  return TRUE;
+}
+
+/*  RLE-encodes the 'n_pixels' pixels of 'bpp' bytes in 'tile_data' into
+ *  'dest', one byte plane after the other, and returns the encoded
+ *  length.  'dest' must have room for the worst case, which is a little
+ *  more than the unencoded size.
+ */
+gsize
+xcf_tile_encode_rle (gint          bpp,
+                     const guchar *tile_data,
+                     gint          n_pixels,
+                     guchar       *dest)
+{
+  const guchar *planes = tile_data;
+  gboolean      sse2   = FALSE;
+  gsize         length = 0;
+  gint          i;
+
+#if COMPILE_SSE2_INTRINISICS
+  sse2 = (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2) != 0;
+#endif
+
+  /*  the planes are scanned contiguously, rather than with a stride  */
+  if (bpp > 1)
+    {
+      guchar *shuffled = g_alloca (bpp * n_pixels);
+
+      xcf_tile_shuffle (bpp, tile_data, shuffled, n_pixels);
+
+      planes = shuffled;
+    }
+
+  for (i = 0; i < bpp; i++)
+    {
+      length += xcf_tile_encode_rle_plane (planes + i * n_pixels, n_pixels,
+                                           dest + length, sse2);
+    }
+
+  return length;
+}
+
+/*  splits 'count' values of 'bpc' bytes into byte planes, so that the
+ *  slowly changing high bytes of high bit depth values end up next to
+ *  each other, and compress better
+ */
+void
+xcf_tile_shuffle (gint          bpc,
+                  const guchar *src,
+                  guchar       *dest,
+                  gint          count)
+{
+  gint i;
+  gint j;
+
+  for (i = 0; i < count; i++)
+    {
+      for (j = 0; j < bpc; j++)
+        dest[j * count + i] = *src++;
+    }
+}
+
+/*  reverses xcf_tile_shuffle()  */
+void
+xcf_tile_unshuffle (gint          bpc,
+                    const guchar *src,
+                    guchar       *dest,
+                    gint          count)
+{
+  gint i;
+  gint j;
+
+  for (i = 0; i < count; i++)
+    {
+      for (j = 0; j < bpc; j++)
+        *dest++ = src[j * count + i];
+    }
+}
+
+
+/*  private functions  */
+
+/*  returns the number of bytes at the start of 'data' which are equal
+ *  to the first one, at most 'max_length'
+ */
+static gint
+xcf_tile_rle_run_length (const guchar *data,
+                         gint          max_length)
+{
+  gint length = 1;
+
+  while (length < max_length && data[length] == data[0])
+    length++;
+
+  return length;
+}
+
+/*  returns the length of the literal span at the start of the 'length'
+ *  bytes of 'data', which ends before the first run of three equal
+ *  bytes, or of two at the end of the data, at most 'max_length'
+ */
+static gint
+xcf_tile_rle_literal_length (const guchar *data,
+                             gint          length,
+                             gint          max_length)
+{
+  gint end = MIN (length, max_length);
+  gint i;
+
+  for (i = 1; i < end; i++)
+    {
+      if (data[i] == data[i - 1] &&
+          (i == length - 1 || data[i + 1] == data[i]))
+        {
+          return i - 1;
+        }
+    }
+
+  return end;
+}
+
+static gsize
+xcf_tile_encode_rle_plane (const guchar *data,
+                           gint          size,
+                           guchar       *dest,
+                           gboolean      sse2)
+{
+  guchar *d = dest;
+  gint    i = 0;
+
+  while (i < size)
+    {
+      gint length;
+
+#if COMPILE_SSE2_INTRINISICS
+      if (sse2)
+        length = xcf_tile_rle_run_length_sse2 (data + i,
+                                               MIN (size - i, 32768));
+      else
+#endif
+        length = xcf_tile_rle_run_length (data + i, MIN (size - i, 32768));
+
+      if (length > 1 || i + length == size)
+        {
+          if (length >= 128)
+            {
+              *d++ = 127;
+              *d++ = length >> 8;
+              *d++ = length & 0xff;
+            }
+          else
+            {
+              *d++ = length - 1;
+            }
+
+          *d++ = data[i];
+        }
+      else
+        {
+#if COMPILE_SSE2_INTRINISICS
+          if (sse2)
+            length = xcf_tile_rle_literal_length_sse2 (data + i, size - i,
+                                                       32768);
+          else
+#endif
+            length = xcf_tile_rle_literal_length (data + i, size - i, 32768);
+
+          if (length >= 128)
+            {
+              *d++ = 255 - 127;
+              *d++ = length >> 8;
+              *d++ = length & 0xff;
+            }
+          else
+            {
+              *d++ = 255 - (length - 1);
+            }
+
+          memcpy (d, data + i, length);
+          d += length;
+        }
+
+      i += length;
+    }
+
+  return d - dest;
+}
+
+static gboolean
+xcf_tile_decode_rle_plane (const guchar **data,
+                           const guchar  *datalimit,
+                           guchar        *dest,
+                           gint           size)
+{
+  const guchar *xcfdata = *data;
+
+  while (size > 0)
+    {
+      gint length;
+
+      if (xcfdata > datalimit)
+        return FALSE;
+
+      length = *xcfdata++;
+
+      if (length >= 128)
+        {
+          length = 255 - (length - 1);
+          if (length == 128)
+            {
+              if (xcfdata >= datalimit)
+                return FALSE;
+
+              length = (*xcfdata << 8) + xcfdata[1];
+              xcfdata += 2;
+            }
+
+          size -= length;
+
+          if (size < 0)
+            return FALSE;
+
+          if (&xcfdata[length - 1] > datalimit)
+            return FALSE;
+
+          memcpy (dest, xcfdata, length);
+          xcfdata += length;
+        }
+      else
+        {
+          length += 1;
+          if (length == 128)
+            {
+              if (xcfdata >= datalimit)
+                return FALSE;
+
+              length = (*xcfdata << 8) + xcfdata[1];
+              xcfdata += 2;
+            }
+
+          size -= length;
+
+          if (size < 0)
+            return FALSE;
+
+          if (xcfdata > datalimit)
+            return FALSE;
+
+          memset (dest, *xcfdata++, length);
+        }
+
+      dest += length;
+    }
+
+  *data = xcfdata;
+
+  return TRUE;
+}
+
+static gboolean
+xcf_tile_decode_rle (const Babl   *format,
+                     gint          width,
+                     gint          height,
+                     const guchar *data,
+                     gsize         data_length,
+                     guchar       *tile_data)
+{
+  gint          bpp;
+  gint          n_pixels;
+  gint          tile_size;
+  const guchar *xcfdata;
+  const guchar *xcfdatalimit;
+  guchar       *planes;
+  gint          i;
+
+  bpp       = babl_format_get_bytes_per_pixel (format);
+  n_pixels  = width * height;
+  tile_size = bpp * n_pixels;
+
+  /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
+   * this tile as if it did not contain any data.  It is better than
+   * failing, which would skip the whole hierarchy while there may still
+   * be some valid tiles in the file.
+   */
+  if (data_length == 0)
+    {
+      memset (tile_data, 0, tile_size);
+      return TRUE;
+    }
+
+  xcfdata      = data;
+  xcfdatalimit = &data[data_length - 1];
+
+  /*  the byte planes are decoded contiguously, and interleaved
+   *  afterwards
+   */
+  if (bpp > 1)
+    planes = g_alloca (tile_size);
+  else
+    planes = tile_data;
+
+  for (i = 0; i < bpp; i++)
+    {
+      if (! xcf_tile_decode_rle_plane (&xcfdata, xcfdatalimit,
+                                       planes + i * n_pixels, n_pixels))
+        return FALSE;
+    }
+
+  if (bpp > 1)
+    xcf_tile_unshuffle (bpp, planes, tile_data, n_pixels);
+
+  return TRUE;
+}
+
+static gboolean
+xcf_tile_decode_zlib (const Babl   *format,
+                      gint          width,
+                      gint          height,
+                      const guchar *data,
+                      gsize         data_length,
+                      guchar       *tile_data)
+{
+  z_stream  strm;
+  int       action;
+  int       status;
+  gint      bpp;
+  gint      tile_size;
+
+  bpp       = babl_format_get_bytes_per_pixel (format);
+  tile_size = bpp * width * height;
+
+  memset (tile_data, 0, tile_size);
+
+  /* see xcf_tile_decode_rle()  */
+  if (data_length == 0)
+    return TRUE;
+
+  strm.next_out  = tile_data;
+  strm.avail_out = tile_size;
+
+  strm.zalloc    = Z_NULL;
+  strm.zfree     = Z_NULL;
+  strm.opaque    = Z_NULL;
+  strm.next_in   = (guchar *) data;
+  strm.avail_in  = data_length;
+
+  /* Initialize the stream decompression. */
+  status = inflateInit (&strm);
+  if (status != Z_OK)
+    return FALSE;
+
+  action = Z_NO_FLUSH;
+
+  while (status == Z_OK)
+    {
+      if (strm.avail_in == 0)
+        {
+          action = Z_FINISH;
+        }
+
+      status = inflate (&strm, action);
+
+      if (status == Z_STREAM_END)
+        {
+          /* All the data was successfully decoded. */
+          break;
+        }
+      else if (status == Z_BUF_ERROR)
+        {
+          g_printerr ("xcf: decompressed tile bigger than the expected size.");
+          inflateEnd (&strm);
+          return FALSE;
+        }
+      else if (status != Z_OK)
+        {
+          g_printerr ("xcf: tile decompression failed: %s", zError (status));
+          inflateEnd (&strm);
+          return FALSE;
+        }
+    }
+
+  inflateEnd (&strm);
+
+  return TRUE;
+}
+
+/*  a zstd tile starts with a byte naming the filter applied to the data,
+ *  followed by a zstd frame
+ */
+static gboolean
+xcf_tile_decode_zstd (const Babl   *format,
+                      gint          width,
+                      gint          height,
+                      const guchar *data,
+                      gsize         data_length,
+                      guchar       *tile_data)
+{
+#ifdef HAVE_ZSTD
+  gint    bpp;
+  gint    tile_size;
+  guint8  filter;
+  guchar *dest;
+  gsize   frame_length;
+  gsize   length;
+
+  bpp       = babl_format_get_bytes_per_pixel (format);
+  tile_size = bpp * width * height;
+
+  /* see xcf_tile_decode_rle()  */
+  if (data_length == 0)
+    {
+      memset (tile_data, 0, tile_size);
+      return TRUE;
+    }
+
+  filter = data[0];
+
+  if (filter == XCF_ZSTD_FILTER_NONE)
+    dest = tile_data;
+  else if (filter == XCF_ZSTD_FILTER_SHUFFLE)
+    dest = g_alloca (tile_size);
+  else
+    {
+      g_printerr ("xcf: unknown tile filter %d.", filter);
+      return FALSE;
+    }
+
+  /* the data may include the beginning of the next tile  */
+  frame_length = ZSTD_findFrameCompressedSize (data + 1, data_length - 1);
+
+  if (ZSTD_isError (frame_length))
+    {
+      g_printerr ("xcf: tile decompression failed: %s",
+                  ZSTD_getErrorName (frame_length));
+      return FALSE;
+    }
+
+  length = ZSTD_decompress (dest, tile_size, data + 1, frame_length);
+
+  if (ZSTD_isError (length))
+    {
+      g_printerr ("xcf: tile decompression failed: %s",
+                  ZSTD_getErrorName (length));
+      return FALSE;
+    }
+  else if (length != tile_size)
+    {
+      g_printerr ("xcf: decompressed tile has the wrong size.");
+      return FALSE;
+    }
+
+  if (filter == XCF_ZSTD_FILTER_SHUFFLE)
+    {
+      gint n_components = babl_format_get_n_components (format);
+      gint bpc          = bpp / n_components;
+
+      xcf_tile_unshuffle (bpc, dest, tile_data, tile_size / bpc);
+    }
+
+  return TRUE;
+#else
+  g_printerr ("xcf: zstd compression is not supported by this build.");
+  return FALSE;
+#endif
+}
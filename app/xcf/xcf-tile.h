@@ -0,0 +1,46 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_TILE_H__
+#define __XCF_TILE_H__
+
+
+gsize      xcf_tile_encode_rle (gint                bpp,
+                                const guchar       *tile_data,
+                                gint                n_pixels,
+                                guchar             *dest);
+
+gboolean   xcf_tile_decode     (gint                file_version,
+                                XcfCompressionType  compression,
+                                const Babl         *format,
+                                gint                width,
+                                gint                height,
+                                const guchar       *data,
+                                gsize               data_length,
+                                guchar             *tile_data);
+
+void       xcf_tile_shuffle    (gint                bpc,
+                                const guchar       *src,
+                                guchar             *dest,
+                                gint                count);
+void       xcf_tile_unshuffle  (gint                bpc,
+                                const guchar       *src,
+                                guchar             *dest,
+                                gint                count);
+
+
+#endif  /* __XCF_TILE_H__ */
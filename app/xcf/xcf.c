@@ -25,10 +25,16 @@
 #include <glib/gstdio.h>
 #include <gegl.h>
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "libgimpbase/gimpbase.h"
 
 #include "core/core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "core/gimp.h"
 #include "core/gimpimage.h"
 #include "core/gimpparamspecs.h"
@@ -42,14 +48,26 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-save.h"
+#include "xcf-stored-level.h"
 
 #include "gimp-intl.h"
+#include "gimp-trace.h"
 
 
 typedef GimpImage * GimpXcfLoaderFunc (Gimp     *gimp,
                                        XcfInfo  *info,
                                        GError  **error);
 
+typedef struct
+{
+  XcfInfo       *info;
+  gint           n_level_jobs;
+
+  gboolean       success;
+  GError        *error;
+  volatile gint  done;
+} XcfSaveThreadData;
+
 
 static GimpValueArray * xcf_load_invoker (GimpProcedure         *procedure,
                                           Gimp                  *gimp,
@@ -64,6 +82,19 @@ static GimpValueArray * xcf_save_invoker (GimpProcedure         *procedure,
                                           const GimpValueArray  *args,
                                           GError               **error);
 
+static gboolean   xcf_save_stream_internal          (Gimp           *gimp,
+                                                     GimpImage      *image,
+                                                     GOutputStream  *output,
+                                                     GFile          *output_file,
+                                                     GimpProgress   *progress,
+                                                     gboolean        in_background,
+                                                     GError        **error);
+static gboolean   xcf_save_level_jobs_in_background (XcfInfo        *info,
+                                                     GimpImage      *image,
+                                                     GError        **error);
+
+static void       xcf_save_mapped_file_unref        (GMappedFile    *mapped);
+
 
 static GimpXcfLoaderFunc * const xcf_loaders[] =
 {
@@ -80,7 +111,8 @@ static GimpXcfLoaderFunc * const xcf_loaders[] =
   xcf_load_image,   /* version 10 */
   xcf_load_image,   /* version 11 */
   xcf_load_image,   /* version 12 */
-  xcf_load_image    /* version 13 */
+  xcf_load_image,   /* version 13 */
+  xcf_load_image    /* version 14 */
 };
 
 
@@ -279,6 +311,48 @@ xcf_load_stream (Gimp          *gimp,
   info.file             = input_file;
   info.compression      = COMPRESS_NONE;
 
+  if (input_file && g_file_is_native (input_file))
+    {
+      gchar *path = g_file_get_path (input_file);
+
+      /*  local files are read from a mapping, which makes parsing and
+       *  seeking cheap, and lets tiles be decoded in place.  files
+       *  that can't be mapped are read from the stream.
+       */
+      if (path)
+        info.mapped = g_mapped_file_new (path, FALSE, NULL);
+
+      g_free (path);
+
+      /*  with xcf-lazy-load set, the pixels of local files are only
+       *  read when they are first accessed, from the mapping or from a
+       *  stream of their own, which are kept open as long as the image
+       *  needs them
+       */
+      if (gimp->config->xcf_lazy_load)
+        {
+          if (info.mapped)
+            {
+              info.lazy_load = TRUE;
+            }
+          else
+            {
+              GFileInputStream *lazy_input = g_file_read (input_file,
+                                                          NULL, NULL);
+
+              if (lazy_input && g_seekable_can_seek (G_SEEKABLE (lazy_input)))
+                {
+                  info.lazy_load  = TRUE;
+                  info.lazy_input = G_INPUT_STREAM (lazy_input);
+                }
+              else if (lazy_input)
+                {
+                  g_object_unref (lazy_input);
+                }
+            }
+        }
+    }
+
   if (progress)
     gimp_progress_start (progress, FALSE, _("Opening '%s'"), filename);
 
@@ -312,7 +386,9 @@ xcf_load_stream (Gimp          *gimp,
       if (info.file_version >= 0 &&
           info.file_version < G_N_ELEMENTS (xcf_loaders))
         {
+          GIMP_TRACE_BEGIN ("xcf-load");
           image = (*(xcf_loaders[info.file_version])) (gimp, &info, error);
+          GIMP_TRACE_END ("xcf-load");
 
           if (! image)
             success = FALSE;
@@ -328,6 +404,9 @@ xcf_load_stream (Gimp          *gimp,
         }
     }
 
+  g_clear_object (&info.lazy_input);
+  g_clear_pointer (&info.mapped, g_mapped_file_unref);
+
   if (progress)
     gimp_progress_end (progress);
 
@@ -341,6 +420,28 @@ xcf_save_stream (Gimp           *gimp,
                  GFile          *output_file,
                  GimpProgress   *progress,
                  GError        **error)
+{
+  gboolean success;
+
+  GIMP_TRACE_BEGIN ("xcf-save");
+  success = xcf_save_stream_internal (gimp, image, output, output_file,
+                                      progress, FALSE, error);
+  GIMP_TRACE_END ("xcf-save");
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static gboolean
+xcf_save_stream_internal (Gimp           *gimp,
+                          GimpImage      *image,
+                          GOutputStream  *output,
+                          GFile          *output_file,
+                          GimpProgress   *progress,
+                          gboolean        in_background,
+                          GError        **error)
 {
   XcfInfo      info     = { 0, };
   const gchar *filename;
@@ -365,25 +466,84 @@ xcf_save_stream (Gimp           *gimp,
   info.bytes_per_offset = 4;
   info.progress         = progress;
   info.file             = output_file;
+  info.defer_levels     = in_background;
+
+  /*  the progress may be destroyed with its display while the image is
+   *  saved in the background
+   */
+  if (in_background && progress)
+    g_object_ref (progress);
 
   if (gimp_image_get_xcf_compression (image))
     info.compression = COMPRESS_ZLIB;
   else
     info.compression = COMPRESS_RLE;
 
+#ifdef HAVE_ZSTD
+  /*  with xcf-zstd-level set, tiles are compressed with zstd at that
+   *  level instead, which is much faster than zlib at a similar ratio
+   */
+  if (gimp->config->xcf_zstd_level > 0)
+    {
+      info.compression       = COMPRESS_ZSTD;
+      info.compression_level = MIN (gimp->config->xcf_zstd_level,
+                                    ZSTD_maxCLevel ());
+    }
+#endif
+
+  /*  with xcf-save-projection set, a downscaled copy of the projection
+   *  is saved along, which is shown while the image is rendered after
+   *  loading it
+   */
+  info.save_projection = gimp->config->xcf_save_projection;
+
   info.file_version = gimp_image_get_xcf_version (image,
                                                   info.compression ==
                                                   COMPRESS_ZLIB,
                                                   NULL, NULL);
 
+  /*  need version 14 for zstd compression  */
+  if (info.compression == COMPRESS_ZSTD)
+    info.file_version = MAX (14, info.file_version);
+
   if (info.file_version >= 11)
     info.bytes_per_offset = 8;
 
+  /*  the tiles of buffers that didn't change since they were last loaded
+   *  or saved are copied from the file they are stored in, and when
+   *  saving a local file, the saved buffers remember where their tiles
+   *  are stored in it
+   */
+  info.copy_mapped_files = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free,
+                                                  (GDestroyNotify)
+                                                  xcf_save_mapped_file_unref);
+
+  if (output_file && g_file_is_native (output_file))
+    {
+      info.saved_levels = g_hash_table_new_full (g_direct_hash,
+                                                 g_direct_equal,
+                                                 g_object_unref,
+                                                 (GDestroyNotify)
+                                                 xcf_stored_level_free);
+    }
+
   if (progress)
     gimp_progress_start (progress, FALSE, _("Saving '%s'"), filename);
 
   success = xcf_save_image (&info, image, &my_error);
 
+  if (success && info.level_jobs)
+    {
+      if (in_background)
+        success = xcf_save_level_jobs_in_background (&info, image,
+                                                     &my_error);
+      else
+        success = xcf_save_level_jobs (&info, &my_error);
+    }
+
+  xcf_save_level_jobs_free (&info);
+
   if (success)
     {
       if (progress)
@@ -392,6 +552,36 @@ xcf_save_stream (Gimp           *gimp,
       success = g_output_stream_close (info.output, NULL, &my_error);
     }
 
+  g_hash_table_unref (info.copy_mapped_files);
+
+  if (info.saved_levels)
+    {
+      if (success)
+        {
+          GHashTableIter  iter;
+          GeglBuffer     *buffer;
+          XcfStoredLevel *level;
+
+          g_hash_table_iter_init (&iter, info.saved_levels);
+
+          while (g_hash_table_iter_next (&iter,
+                                         (gpointer *) &buffer,
+                                         (gpointer *) &level))
+            {
+              g_hash_table_iter_steal (&iter);
+
+              if (xcf_stored_level_set_file (level, output_file))
+                xcf_stored_level_attach (level, buffer);
+              else
+                xcf_stored_level_free (level);
+
+              g_object_unref (buffer);
+            }
+        }
+
+      g_hash_table_unref (info.saved_levels);
+    }
+
   if (! success && my_error)
     g_propagate_prefixed_error (error, my_error,
                                 _("Error writing '%s': "), filename);
@@ -399,11 +589,86 @@ xcf_save_stream (Gimp           *gimp,
   if (progress)
     gimp_progress_end (progress);
 
+  if (in_background && progress)
+    g_object_unref (progress);
+
   return success;
 }
 
+static gpointer
+xcf_save_thread (XcfSaveThreadData *data)
+{
+  data->success = xcf_save_level_jobs (data->info, &data->error);
 
-/*  private functions  */
+  g_atomic_int_set (&data->done, TRUE);
+
+  /*  wake up the main loop  */
+  g_main_context_wakeup (NULL);
+
+  return NULL;
+}
+
+static gboolean
+xcf_save_thread_progress (XcfSaveThreadData *data)
+{
+  gimp_progress_set_value (data->info->progress,
+                           (gdouble)
+                           g_atomic_int_get (&data->info->n_level_jobs_done) /
+                           (gdouble) data->n_level_jobs);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/*  writes the deferred levels in a separate thread, from the snapshots
+ *  taken by xcf_save_image(), while the main loop keeps running, so that
+ *  the image can be edited meanwhile
+ */
+static gboolean
+xcf_save_level_jobs_in_background (XcfInfo    *info,
+                                   GimpImage  *image,
+                                   GError    **error)
+{
+  XcfSaveThreadData  data     = { 0, };
+  GThread           *thread;
+  guint              progress = 0;
+
+  data.info         = info;
+  data.n_level_jobs = g_list_length (info->level_jobs);
+
+  thread = g_thread_new ("xcf-save",
+                         (GThreadFunc) xcf_save_thread, &data);
+
+  if (info->progress)
+    {
+      gimp_progress_set_value (info->progress, 0.0);
+
+      progress = g_timeout_add (100,
+                                (GSourceFunc) xcf_save_thread_progress,
+                                &data);
+    }
+
+  /*  the image can be edited meanwhile, but not closed or saved
+   *  again, and GIMP doesn't quit until the file is written
+   */
+  gimp_image_set_busy (image, TRUE);
+  gimp_unset_busy (info->gimp);
+
+  while (! g_atomic_int_get (&data.done))
+    g_main_context_iteration (NULL, TRUE);
+
+  gimp_set_busy (info->gimp);
+  gimp_image_set_busy (image, FALSE);
+
+  if (progress)
+    g_source_remove (progress);
+
+  g_thread_join (thread);
+
+  if (data.error)
+    g_propagate_error (error, data.error);
+
+  return data.success;
+}
 
 static GimpValueArray *
 xcf_load_invoker (GimpProcedure         *procedure,
@@ -462,6 +727,7 @@ xcf_save_invoker (GimpProcedure         *procedure,
                   GError               **error)
 {
   GimpValueArray *return_vals;
+  GimpRunMode     run_mode;
   GimpImage      *image;
   const gchar    *uri;
   GFile          *file;
@@ -471,9 +737,10 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
   gimp_set_busy (gimp);
 
-  image = gimp_value_get_image (gimp_value_array_index (args, 1), gimp);
-  uri   = g_value_get_string (gimp_value_array_index (args, 3));
-  file  = g_file_new_for_uri (uri);
+  run_mode = g_value_get_enum (gimp_value_array_index (args, 0));
+  image    = gimp_value_get_image (gimp_value_array_index (args, 1), gimp);
+  uri      = g_value_get_string (gimp_value_array_index (args, 3));
+  file     = g_file_new_for_uri (uri);
 
   output = G_OUTPUT_STREAM (g_file_replace (file,
                                             NULL, FALSE, G_FILE_CREATE_NONE,
@@ -481,7 +748,13 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
   if (output)
     {
-      success = xcf_save_stream (gimp, image, output, file, progress, error);
+      /*  interactive saves write the pixels in the background, so that
+       *  the user can keep working on the image
+       */
+      success = xcf_save_stream_internal (gimp, image, output, file, progress,
+                                          run_mode == GIMP_RUN_INTERACTIVE &&
+                                          ! gimp->no_interface,
+                                          error);
 
       g_object_unref (output);
     }
@@ -501,3 +774,11 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
   return return_vals;
 }
+
+static void
+xcf_save_mapped_file_unref (GMappedFile *mapped)
+{
+  /*  files that couldn't be mapped are remembered as NULL  */
+  if (mapped)
+    g_mapped_file_unref (mapped);
+}
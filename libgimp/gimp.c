@@ -109,6 +109,7 @@
 #include "libgimpbase/gimpwire.h"
 
 #include "gimp.h"
+#include "gimppdbcache.h"
 #include "gimpunitcache.h"
 
 #include "libgimp-intl.h"
@@ -125,7 +126,7 @@
  **/
 
 
-#define TILE_MAP_SIZE (_tile_width * _tile_height * 32)
+#define TILE_MAP_SIZE (_tile_width * _tile_height * 32 * GP_TILE_SHM_N_TILES)
 
 #define ERRMSG_SHM_FAILED "Could not attach to gimp shared memory segment"
 
@@ -144,6 +145,11 @@ typedef enum
 
 #define WRITE_BUFFER_SIZE  1024
 
+/*  At most this many asynchronous calls are on their way, so that
+ *  GIMP is never stuck writing return values nobody reads.
+ */
+#define MAX_ASYNC_CALLS  32
+
 void gimp_read_expect_msg   (GimpWireMessage *msg,
                              gint             type);
 
@@ -172,6 +178,18 @@ static void       gimp_proc_run                (GPProcRun       *proc_run);
 static void       gimp_temp_proc_run           (GPProcRun       *proc_run);
 static void       gimp_process_message         (GimpWireMessage *msg);
 static void       gimp_single_message          (void);
+static void       gimp_pending_messages        (void);
+static GList    * gimp_async_find              (guint32          call_ID);
+static gint       gimp_async_compare           (gconstpointer    a,
+                                                gconstpointer    b,
+                                                gpointer         data);
+static void       gimp_async_return            (GList           *link,
+                                                GPProcReturn    *proc_return);
+static void       gimp_async_dispatch          (gint32           call_ID);
+static gboolean   gimp_async_idle              (gpointer         data);
+static gboolean   gimp_async_read              (GIOChannel      *channel,
+                                                GIOCondition     condition,
+                                                gpointer         data);
 static gboolean   gimp_extension_read          (GIOChannel      *channel,
                                                 GIOCondition     condition,
                                                 gpointer         data);
@@ -215,8 +233,33 @@ static GimpStackTraceMode stack_trace_mode = GIMP_STACK_TRACE_NEVER;
 
 static GHashTable    *temp_proc_ht       = NULL;
 
+static gboolean       _persistent        = FALSE;
+static gboolean       _proc_pure         = FALSE;
+static gboolean       _extension_enabled = FALSE;
+
+/*  the ID of the last call sent to GIMP, synchronous or not  */
+static gint32         last_call_ID       = 0;
+
+/*  the calls made with gimp_run_procedure_async(), which have not
+ *  returned yet, in the order they were made, and which have returned
+ *  but wait for their callback, ordered by their ID
+ */
+static GQueue         async_pending      = G_QUEUE_INIT;
+static GQueue         async_returned     = G_QUEUE_INIT;
+static guint          async_idle_ID      = 0;
+static guint          async_watch_ID     = 0;
+
 static guint          gimp_debug_flags   = 0;
 
+typedef struct
+{
+  gint32                    call_ID;
+  GimpRunProcedureCallback  callback;
+  gpointer                  user_data;
+  gint                      n_return_vals;
+  GimpParam                *return_vals;
+} GimpAsyncCall;
+
 static const GDebugKey gimp_debug_keys[] =
 {
   { "pid",            GIMP_DEBUG_PID            },
@@ -509,7 +552,9 @@ gimp_main (const GimpPlugInInfo *info,
   g_io_channel_set_encoding (_readchannel, NULL, NULL);
   g_io_channel_set_encoding (_writechannel, NULL, NULL);
 
-  g_io_channel_set_buffered (_readchannel, FALSE);
+  /*  messages are read in many small pieces, let GIOChannel buffer
+   *  them; writes are buffered by gimp_write() instead
+   */
   g_io_channel_set_buffered (_writechannel, FALSE);
 
   g_io_channel_set_close_on_unref (_readchannel, TRUE);
@@ -1078,10 +1123,22 @@ gimp_read_expect_msg (GimpWireMessage *msg,
       if (! gimp_wire_read_msg (_readchannel, msg, NULL))
         gimp_quit ();
 
+      /*  the return values of asynchronous calls can come at any time  */
+      if (msg->type == GP_PROC_RETURN &&
+          gimp_async_find (((GPProcReturn *) msg->data)->call_ID))
+        {
+          gimp_process_message (msg);
+          gimp_wire_destroy (msg);
+          continue;
+        }
+
       if (msg->type == type)
         return; /* up to the caller to call wire_destroy() */
 
-      if (msg->type == GP_TEMP_PROC_RUN || msg->type == GP_QUIT)
+      if (msg->type == GP_TEMP_PROC_RUN    ||
+          msg->type == GP_QUIT             ||
+          msg->type == GP_PROC_PURE        ||
+          msg->type == GP_PROC_CACHE_FLUSH)
         {
           gimp_process_message (msg);
         }
@@ -1124,6 +1181,7 @@ gimp_run_procedure2 (const gchar     *name,
   GPProcReturn    *proc_return;
   GimpWireMessage  msg;
   GimpParam       *return_vals;
+  gboolean         pure;
 
   g_return_val_if_fail (name != NULL, NULL);
   g_return_val_if_fail (n_return_vals != NULL, NULL);
@@ -1133,14 +1191,43 @@ gimp_run_procedure2 (const gchar     *name,
   proc_run.params  = (GPParam *) params;
 
   gp_lock ();
+
+  /*  GIMP may have flushed the cache in the meantime  */
+  if (! _gimp_pdb_cache_is_empty ())
+    gimp_pending_messages ();
+
+  return_vals = _gimp_pdb_cache_lookup (name, n_params, params,
+                                        n_return_vals);
+
+  if (return_vals)
+    {
+      gp_unlock ();
+
+      gimp_set_pdb_error (return_vals, *n_return_vals);
+
+      return return_vals;
+    }
+
+  proc_run.call_ID = ++last_call_ID;
+
   if (! gp_proc_run_write (_writechannel, &proc_run, NULL))
     gimp_quit ();
 
   gimp_read_expect_msg (&msg, GP_PROC_RETURN);
-  gp_unlock ();
+
+  /*  GP_PROC_PURE immediately precedes the GP_PROC_RETURN  */
+  pure       = _proc_pure;
+  _proc_pure = FALSE;
 
   proc_return = msg.data;
 
+  /*  calls made from a temporary procedure run in the meantime have
+   *  returned before, so this can only be the return of this call
+   */
+  if (proc_return->call_ID != proc_run.call_ID)
+    g_error ("unexpected return values of call %u, expected call %u",
+             proc_return->call_ID, proc_run.call_ID);
+
   *n_return_vals = proc_return->nparams;
   return_vals    = (GimpParam *) proc_return->params;
 
@@ -1149,11 +1236,117 @@ gimp_run_procedure2 (const gchar     *name,
 
   gimp_wire_destroy (&msg);
 
+  if (pure)
+    _gimp_pdb_cache_insert (name, n_params, params,
+                            *n_return_vals, return_vals);
+  else
+    _gimp_pdb_cache_flush ();
+
+  gp_unlock ();
+
   gimp_set_pdb_error (return_vals, *n_return_vals);
 
   return return_vals;
 }
 
+/**
+ * gimp_run_procedure_async:
+ * @name:      the name of the procedure to run
+ * @n_params:  the number of parameters the procedure takes.
+ * @params:    the procedure's parameters array.
+ * @callback:  the function to call with the return values, or %NULL
+ * @user_data: data to pass to @callback
+ *
+ * Like gimp_run_procedure2(), but returns right after sending the
+ * call to GIMP, so that many independent calls can be made without
+ * waiting for each of them. The return values are matched to the
+ * calls by their ID, so it doesn't matter in which order GIMP
+ * answers them.
+ *
+ * @callback is called from the main loop, in the order of the calls,
+ * or from gimp_run_procedure_async_wait(). The return values passed
+ * to it are freed after it returns. A plug-in which doesn't run a
+ * main loop should call gimp_run_procedure_async_wait() with the ID
+ * of its last call before it is done.
+ *
+ * Return value: the ID of the call, to pass to
+ * gimp_run_procedure_async_wait().
+ *
+ * Since: 2.10
+ **/
+gint32
+gimp_run_procedure_async (const gchar              *name,
+                          gint                      n_params,
+                          const GimpParam          *params,
+                          GimpRunProcedureCallback  callback,
+                          gpointer                  user_data)
+{
+  GPProcRun      proc_run;
+  GimpAsyncCall *call;
+
+  g_return_val_if_fail (name != NULL, -1);
+
+  gp_lock ();
+
+  while (g_queue_get_length (&async_pending) >= MAX_ASYNC_CALLS)
+    gimp_single_message ();
+
+  /*  there is no telling which calls are pure before they return  */
+  _gimp_pdb_cache_flush ();
+
+  call = g_slice_new0 (GimpAsyncCall);
+
+  call->call_ID   = ++last_call_ID;
+  call->callback  = callback;
+  call->user_data = user_data;
+
+  proc_run.name    = (gchar *) name;
+  proc_run.call_ID = call->call_ID;
+  proc_run.nparams = n_params;
+  proc_run.params  = (GPParam *) params;
+
+  if (! gp_proc_run_write (_writechannel, &proc_run, NULL))
+    gimp_quit ();
+
+  g_queue_push_tail (&async_pending, call);
+
+  /*  when extensions are enabled, their watch reads the return values  */
+  if (! _extension_enabled && ! async_watch_ID)
+    async_watch_ID = g_io_add_watch (_readchannel, G_IO_IN | G_IO_PRI,
+                                     gimp_async_read, NULL);
+
+  gp_unlock ();
+
+  return call->call_ID;
+}
+
+/**
+ * gimp_run_procedure_async_wait:
+ * @call_ID: the ID returned by gimp_run_procedure_async()
+ *
+ * Waits until the call @call_ID and all calls made before it have
+ * returned, and runs their callbacks, which were not run yet.
+ *
+ * Since: 2.10
+ **/
+void
+gimp_run_procedure_async_wait (gint32 call_ID)
+{
+  gp_lock ();
+
+  /*  the pending calls are in the order they were made  */
+  while (! g_queue_is_empty (&async_pending) &&
+         ((GimpAsyncCall *) g_queue_peek_head (&async_pending))->call_ID <=
+         call_ID)
+    {
+      gimp_single_message ();
+    }
+
+  gp_unlock ();
+
+  gimp_async_dispatch (call_ID);
+}
+
 /**
  * gimp_destroy_params:
  * @params:   the #GimpParam array to destroy
@@ -1314,6 +1507,94 @@ gimp_shm_addr (void)
   return _shm_addr;
 }
 
+/*  attaches to the shared memory segment of a GP_DRAWABLE_MAP reply,
+ *  returns NULL on failure
+ */
+guchar *
+_gimp_shm_map (gint  map_ID,
+               gsize size)
+{
+  guchar *addr = NULL;
+
+  if (_shm_ID == -1)
+    return NULL;
+
+#if defined(USE_SYSV_SHM)
+
+  addr = (guchar *) shmat (map_ID, NULL, 0);
+
+  if (addr == (guchar *) -1)
+    addr = NULL;
+
+#elif defined(USE_WIN32_SHM)
+
+  {
+    gchar  fileMapName[128];
+    HANDLE map_handle;
+
+    g_snprintf (fileMapName, sizeof (fileMapName), "GIMP%d-%d.SHM",
+                _shm_ID, map_ID);
+
+    map_handle = OpenFileMapping (FILE_MAP_ALL_ACCESS, 0, fileMapName);
+
+    if (map_handle)
+      {
+        /*  the view keeps the mapping alive  */
+        addr = (guchar *) MapViewOfFile (map_handle, FILE_MAP_ALL_ACCESS,
+                                         0, 0, size);
+
+        CloseHandle (map_handle);
+      }
+  }
+
+#elif defined(USE_POSIX_SHM)
+
+  {
+    gchar map_file[32];
+    gint  shm_fd;
+
+    g_snprintf (map_file, sizeof (map_file), "/gimp-shm-%d-%d",
+                _shm_ID, map_ID);
+
+    shm_fd = shm_open (map_file, O_RDWR, 0600);
+
+    if (shm_fd != -1)
+      {
+        addr = (guchar *) mmap (NULL, size,
+                                PROT_READ | PROT_WRITE, MAP_SHARED,
+                                shm_fd, 0);
+
+        if (addr == MAP_FAILED)
+          addr = NULL;
+
+        close (shm_fd);
+      }
+  }
+
+#endif
+
+  return addr;
+}
+
+void
+_gimp_shm_unmap (guchar *addr,
+                 gsize   size)
+{
+#if defined(USE_SYSV_SHM)
+
+  shmdt ((char *) addr);
+
+#elif defined(USE_WIN32_SHM)
+
+  UnmapViewOfFile (addr);
+
+#elif defined(USE_POSIX_SHM)
+
+  munmap (addr, size);
+
+#endif
+}
+
 /**
  * gimp_gamma:
  *
@@ -1635,14 +1916,18 @@ gimp_extension_ack (void)
 void
 gimp_extension_enable (void)
 {
-  static gboolean callback_added = FALSE;
-
-  if (! callback_added)
+  if (! _extension_enabled)
     {
+      if (async_watch_ID)
+        {
+          g_source_remove (async_watch_ID);
+          async_watch_ID = 0;
+        }
+
       g_io_add_watch (_readchannel, G_IO_IN | G_IO_PRI, gimp_extension_read,
                       NULL);
 
-      callback_added = TRUE;
+      _extension_enabled = TRUE;
     }
 }
 
@@ -1667,6 +1952,15 @@ gimp_extension_process (guint timeout)
 #ifndef G_OS_WIN32
   gint select_val;
 
+  /*  the read channel is buffered, it may hold a complete message
+   *  already
+   */
+  if (g_io_channel_get_buffer_condition (_readchannel) & G_IO_IN)
+    {
+      gimp_single_message ();
+      return;
+    }
+
   do
     {
       fd_set readfds;
@@ -1703,6 +1997,12 @@ gimp_extension_process (guint timeout)
    */
   GPollFD pollfd;
 
+  if (g_io_channel_get_buffer_condition (_readchannel) & G_IO_IN)
+    {
+      gimp_single_message ();
+      return;
+    }
+
   if (timeout == 0)
     timeout = -1;
 
@@ -1713,6 +2013,28 @@ gimp_extension_process (guint timeout)
 #endif
 }
 
+/**
+ * gimp_plugin_set_persistent:
+ * @persistent: whether the plug-in's process may be run again
+ *
+ * Lets the plug-in's process stay alive after the procedure currently
+ * being run returns, so that GIMP can run the next call of one of the
+ * plug-in's procedures in it, instead of starting the plug-in again.
+ * GIMP quits the process when it has been idle for a while.
+ *
+ * Call this from the run procedure. It applies to the current call
+ * only, and should only be used by plug-ins that don't depend on
+ * their global state being reset between calls, for example when
+ * they are run non-interactively. It has no effect for extensions.
+ *
+ * Since: 2.10
+ **/
+void
+gimp_plugin_set_persistent (gboolean persistent)
+{
+  _persistent = persistent ? TRUE : FALSE;
+}
+
 /**
  * gimp_parasite_find:
  * @name: The name of the parasite to find.
@@ -2069,6 +2391,8 @@ gimp_loop (void)
           break;
 
         case GP_TILE_REQ:
+        case GP_TILE_REQ_MULTI:
+        case GP_DRAWABLE_MAP:
         case GP_TILE_ACK:
         case GP_TILE_DATA:
           g_warning ("unexpected tile message received (should not happen)");
@@ -2076,9 +2400,15 @@ gimp_loop (void)
 
         case GP_PROC_RUN:
           gimp_proc_run (msg.data);
-          gimp_wire_destroy (&msg);
-          gimp_close ();
-          return;
+
+          /*  a persistent plug-in waits for its next run  */
+          if (! _persistent)
+            {
+              gimp_wire_destroy (&msg);
+              gimp_close ();
+              return;
+            }
+          break;
 
         case GP_PROC_RETURN:
           g_warning ("unexpected proc return message received (should not happen)");
@@ -2099,6 +2429,18 @@ gimp_loop (void)
         case GP_HAS_INIT:
           g_warning ("unexpected has init message received (should not happen)");
           break;
+
+        case GP_PERSISTENT:
+          g_warning ("unexpected persistent message received (should not happen)");
+          break;
+
+        case GP_PROC_PURE:
+          g_warning ("unexpected proc pure message received (should not happen)");
+          break;
+
+        case GP_PROC_CACHE_FLUSH:
+          _gimp_pdb_cache_flush ();
+          break;
         }
 
       gimp_wire_destroy (&msg);
@@ -2127,9 +2469,6 @@ gimp_config (GPConfig *config)
       gimp_quit ();
     }
 
-  _tile_width       = config->tile_width;
-  _tile_height      = config->tile_height;
-  _shm_ID           = config->shm_ID;
   _check_size       = config->check_size;
   _check_type       = config->check_type;
   _install_cmap     = config->install_cmap     ? TRUE : FALSE;
@@ -2140,11 +2479,27 @@ gimp_config (GPConfig *config)
   _export_iptc      = config->export_iptc      ? TRUE : FALSE;
   _min_colors       = config->min_colors;
   _gdisp_ID         = config->gdisp_ID;
-  _wm_class         = g_strdup (config->wm_class);
-  _display_name     = g_strdup (config->display_name);
   _monitor_number   = config->monitor_number;
   _timestamp        = config->timestamp;
 
+  g_free (_wm_class);
+  g_free (_display_name);
+
+  _wm_class         = g_strdup (config->wm_class);
+  _display_name     = g_strdup (config->display_name);
+
+  _gimp_tile_cache_set_default (config->tile_cache_size);
+
+  /*  a persistent plug-in is configured again for each of its runs,
+   *  the rest stays the same
+   */
+  if (_tile_width != -1)
+    return;
+
+  _tile_width       = config->tile_width;
+  _tile_height      = config->tile_height;
+  _shm_ID           = config->shm_ID;
+
   if (config->app_name)
     g_set_application_name (config->app_name);
 
@@ -2155,6 +2510,11 @@ gimp_config (GPConfig *config)
                 "application-license", "GPL3",
                 NULL);
 
+  if (config->num_threads > 0)
+    g_object_set (gegl_config (),
+                  "threads", config->num_threads,
+                  NULL);
+
   if (_shm_ID != -1)
     {
 #if defined(USE_SYSV_SHM)
@@ -2249,15 +2609,27 @@ gimp_proc_run (GPProcRun *proc_run)
       GimpParam    *return_vals;
       gint          n_return_vals;
 
+      _persistent = FALSE;
+
+      /*  a persistent plug-in's cache is from its last run  */
+      _gimp_pdb_cache_flush ();
+
       (* PLUG_IN_INFO.run_proc) (proc_run->name,
                                  proc_run->nparams,
                                  (GimpParam *) proc_run->params,
                                  &n_return_vals, &return_vals);
 
+      /*  the run is over, so are its asynchronous calls  */
+      gimp_run_procedure_async_wait (last_call_ID);
+
       proc_return.name    = proc_run->name;
+      proc_return.call_ID = proc_run->call_ID;
       proc_return.nparams = n_return_vals;
       proc_return.params  = (GPParam *) return_vals;
 
+      if (_persistent && ! gp_persistent_write (_writechannel, NULL))
+        gimp_quit ();
+
       if (! gp_proc_return_write (_writechannel, &proc_return, NULL))
         gimp_quit ();
     }
@@ -2288,6 +2660,7 @@ gimp_temp_proc_run (GPProcRun *proc_run)
                     &n_return_vals, &return_vals);
 
       proc_return.name    = proc_run->name;
+      proc_return.call_ID = proc_run->call_ID;
       proc_return.nparams = n_return_vals;
       proc_return.params  = (GPParam *) return_vals;
 
@@ -2308,6 +2681,8 @@ gimp_process_message (GimpWireMessage *msg)
       gimp_config (msg->data);
       break;
     case GP_TILE_REQ:
+    case GP_TILE_REQ_MULTI:
+    case GP_DRAWABLE_MAP:
     case GP_TILE_ACK:
     case GP_TILE_DATA:
       g_warning ("unexpected tile message received (should not happen)");
@@ -2316,7 +2691,15 @@ gimp_process_message (GimpWireMessage *msg)
       g_warning ("unexpected proc run message received (should not happen)");
       break;
     case GP_PROC_RETURN:
-      g_warning ("unexpected proc return message received (should not happen)");
+      {
+        GPProcReturn *proc_return = msg->data;
+        GList        *link        = gimp_async_find (proc_return->call_ID);
+
+        if (link)
+          gimp_async_return (link, proc_return);
+        else
+          g_warning ("unexpected proc return message received (should not happen)");
+      }
       break;
     case GP_TEMP_PROC_RUN:
       gimp_temp_proc_run (msg->data);
@@ -2330,6 +2713,15 @@ gimp_process_message (GimpWireMessage *msg)
     case GP_HAS_INIT:
       g_warning ("unexpected has init message received (should not happen)");
       break;
+    case GP_PERSISTENT:
+      g_warning ("unexpected persistent message received (should not happen)");
+      break;
+    case GP_PROC_PURE:
+      _proc_pure = TRUE;
+      break;
+    case GP_PROC_CACHE_FLUSH:
+      _gimp_pdb_cache_flush ();
+      break;
     }
 }
 
@@ -2347,6 +2739,147 @@ gimp_single_message (void)
   gimp_wire_destroy (&msg);
 }
 
+/*  processes the messages GIMP sent without being asked, like
+ *  GP_PROC_CACHE_FLUSH, without waiting for more
+ */
+static void
+gimp_pending_messages (void)
+{
+  while (TRUE)
+    {
+      GPollFD pollfd;
+
+      if (! (g_io_channel_get_buffer_condition (_readchannel) & G_IO_IN))
+        {
+#ifndef G_OS_WIN32
+          pollfd.fd      = g_io_channel_unix_get_fd (_readchannel);
+          pollfd.events  = G_IO_IN;
+          pollfd.revents = 0;
+
+          if (g_poll (&pollfd, 1, 0) != 1)
+            return;
+#else
+          g_io_channel_win32_make_pollfd (_readchannel, G_IO_IN, &pollfd);
+
+          if (g_io_channel_win32_poll (&pollfd, 1, 0) != 1)
+            return;
+#endif
+        }
+
+      gimp_single_message ();
+    }
+}
+
+static GList *
+gimp_async_find (guint32 call_ID)
+{
+  GList *list;
+
+  for (list = async_pending.head; list; list = g_list_next (list))
+    {
+      GimpAsyncCall *call = list->data;
+
+      if (call->call_ID == call_ID)
+        return list;
+    }
+
+  return NULL;
+}
+
+static gint
+gimp_async_compare (gconstpointer a,
+                    gconstpointer b,
+                    gpointer      data)
+{
+  const GimpAsyncCall *call_a = a;
+  const GimpAsyncCall *call_b = b;
+
+  return call_a->call_ID - call_b->call_ID;
+}
+
+static void
+gimp_async_return (GList        *link,
+                   GPProcReturn *proc_return)
+{
+  GimpAsyncCall *call = link->data;
+
+  g_queue_delete_link (&async_pending, link);
+
+  /*  the cache can't be filled from an asynchronous call  */
+  _proc_pure = FALSE;
+
+  call->n_return_vals = proc_return->nparams;
+  call->return_vals   = (GimpParam *) proc_return->params;
+
+  proc_return->nparams = 0;
+  proc_return->params  = NULL;
+
+  g_queue_insert_sorted (&async_returned, call, gimp_async_compare, NULL);
+
+  if (! async_idle_ID)
+    async_idle_ID = g_idle_add (gimp_async_idle, NULL);
+
+  if (g_queue_is_empty (&async_pending) && async_watch_ID)
+    {
+      g_source_remove (async_watch_ID);
+      async_watch_ID = 0;
+    }
+}
+
+/*  runs the callbacks of the returned calls up to 'call_ID', in the
+ *  order of the calls, stopping at the first call which didn't return
+ *  yet
+ */
+static void
+gimp_async_dispatch (gint32 call_ID)
+{
+  while (! g_queue_is_empty (&async_returned))
+    {
+      GimpAsyncCall *call    = g_queue_peek_head (&async_returned);
+      GimpAsyncCall *pending = g_queue_peek_head (&async_pending);
+
+      if (call->call_ID > call_ID ||
+          (pending && pending->call_ID < call->call_ID))
+        break;
+
+      g_queue_pop_head (&async_returned);
+
+      gimp_set_pdb_error (call->return_vals, call->n_return_vals);
+
+      if (call->callback)
+        call->callback (call->call_ID,
+                        call->n_return_vals, call->return_vals,
+                        call->user_data);
+
+      gimp_destroy_params (call->return_vals, call->n_return_vals);
+
+      g_slice_free (GimpAsyncCall, call);
+    }
+}
+
+static gboolean
+gimp_async_idle (gpointer data)
+{
+  async_idle_ID = 0;
+
+  gimp_async_dispatch (G_MAXINT32);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gimp_async_read (GIOChannel  *channel,
+                 GIOCondition condition,
+                 gpointer     data)
+{
+  gp_lock ();
+  gimp_single_message ();
+  gp_unlock ();
+
+  /*  gimp_async_return() removed the watch after the last call  */
+  return async_watch_ID != 0;
+}
+
 static gboolean
 gimp_extension_read (GIOChannel  *channel,
                      GIOCondition condition,
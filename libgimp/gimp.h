@@ -87,6 +87,10 @@ typedef void (* GimpRunProc)   (const gchar      *name,
                                 const GimpParam  *param,
                                 gint             *n_return_vals,
                                 GimpParam       **return_vals);
+typedef void (* GimpRunProcedureCallback) (gint32           call_ID,
+                                           gint             n_return_vals,
+                                           const GimpParam *return_vals,
+                                           gpointer         user_data);
 
 
 /**
@@ -282,6 +286,10 @@ void           gimp_extension_enable    (void);
  */
 void           gimp_extension_process   (guint            timeout);
 
+/* Keep the plug-in's process alive for its next run
+ */
+void           gimp_plugin_set_persistent (gboolean         persistent);
+
 /* Run a procedure in the procedure database. The parameters are
  *  specified via the variable length argument list. The return
  *  values are returned in the 'GimpParam*' array.
@@ -299,6 +307,20 @@ GimpParam    * gimp_run_procedure2      (const gchar     *name,
                                          gint             n_params,
                                          const GimpParam *params);
 
+/* Run a procedure in the procedure database, and pass its return
+ *  values to 'callback' later.
+ */
+gint32         gimp_run_procedure_async (const gchar     *name,
+                                         gint             n_params,
+                                         const GimpParam *params,
+                                         GimpRunProcedureCallback callback,
+                                         gpointer         user_data);
+
+/* Run the callbacks of the procedure started by
+ *  'gimp_run_procedure_async' and of all procedures started before it.
+ */
+void           gimp_run_procedure_async_wait (gint32     call_ID);
+
 /* Destroy the an array of parameters. This is useful for
  *  destroying the return values returned by a call to
  *  'gimp_run_procedure'.
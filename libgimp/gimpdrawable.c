@@ -22,6 +22,9 @@
 
 #define GIMP_DISABLE_DEPRECATION_WARNINGS
 
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpbase/gimpwire.h"
+
 #include "gimp.h"
 
 #include "gimptilebackendplugin.h"
@@ -31,6 +34,26 @@
 #define TILE_HEIGHT gimp_tile_height()
 
 
+typedef struct
+{
+  guchar *data;
+  gsize   size;
+} MappedData;
+
+
+void           gimp_read_expect_msg (GimpWireMessage *msg,
+                                     gint             type);
+guchar       * _gimp_shm_map        (gint             map_ID,
+                                     gsize            size);
+void           _gimp_shm_unmap      (guchar          *addr,
+                                     gsize            size);
+
+static guchar * gimp_drawable_map   (gint32           drawable_ID,
+                                     const Babl      *format,
+                                     MappedData      *mapped);
+static void     gimp_drawable_unmap (MappedData      *mapped);
+
+
 /**
  * gimp_drawable_get:
  * @drawable_ID: the ID of the drawable
@@ -730,6 +753,67 @@ gimp_drawable_get_shadow_buffer (gint32 drawable_ID)
   return NULL;
 }
 
+/**
+ * gimp_drawable_get_mapped_buffer:
+ * @drawable_ID: the ID of the #GimpDrawable to get the buffer for.
+ *
+ * Returns a #GeglBuffer holding a snapshot of a specified drawable's
+ * pixels. Unlike with gimp_drawable_get_buffer(), the pixels are not
+ * transferred tile by tile: the core places all of them in a shared
+ * memory segment of their own, which the buffer uses directly.
+ *
+ * The buffer may be written to, but its data is never synced back
+ * with the core drawable. If the drawable can't be mapped, for
+ * example when shared memory is not available, the buffer is an
+ * ordinary copy of the drawable's pixels.
+ *
+ * Return value: The #GeglBuffer.
+ *
+ * See Also: gimp_drawable_get_buffer()
+ *
+ * Since: 2.10
+ */
+GeglBuffer *
+gimp_drawable_get_mapped_buffer (gint32 drawable_ID)
+{
+  GeglBuffer *buffer;
+  GeglBuffer *drawable_buffer;
+  const Babl *format;
+  MappedData *mapped;
+
+  gimp_plugin_enable_precision ();
+
+  if (! gimp_item_is_valid (drawable_ID))
+    return NULL;
+
+  format = gimp_drawable_get_format (drawable_ID);
+  mapped = g_slice_new0 (MappedData);
+
+  if (gimp_drawable_map (drawable_ID, format, mapped))
+    {
+      GeglRectangle extent = { 0, 0,
+                               gimp_drawable_width  (drawable_ID),
+                               gimp_drawable_height (drawable_ID) };
+
+      return gegl_buffer_linear_new_from_data (mapped->data, format, &extent,
+                                               GEGL_AUTO_ROWSTRIDE,
+                                               (GDestroyNotify) gimp_drawable_unmap,
+                                               mapped);
+    }
+
+  g_slice_free (MappedData, mapped);
+
+  drawable_buffer = gimp_drawable_get_buffer (drawable_ID);
+
+  if (! drawable_buffer)
+    return NULL;
+
+  buffer = gegl_buffer_dup (drawable_buffer);
+  g_object_unref (drawable_buffer);
+
+  return buffer;
+}
+
 /**
  * gimp_drawable_get_format:
  * @drawable_ID: the ID of the #GimpDrawable to get the format for.
@@ -799,3 +883,75 @@ gimp_drawable_get_format (gint32 drawable_ID)
 
   return format;
 }
+
+
+/*  private functions  */
+
+static guchar *
+gimp_drawable_map (gint32      drawable_ID,
+                   const Babl *format,
+                   MappedData *mapped)
+{
+  extern GIOChannel *_writechannel;
+
+  GPDrawableMap    drawable_map;
+  GPDrawableMap   *reply;
+  GimpWireMessage  msg;
+
+  if (gimp_shm_ID () == -1)
+    return NULL;
+
+  drawable_map.drawable_ID = drawable_ID;
+  drawable_map.shm_ID      = -1;
+  drawable_map.bpp         = 0;
+  drawable_map.width       = 0;
+  drawable_map.height      = 0;
+
+  gp_lock ();
+  if (! gp_drawable_map_write (_writechannel, &drawable_map, NULL))
+    gimp_quit ();
+
+  gimp_read_expect_msg (&msg, GP_DRAWABLE_MAP);
+
+  reply = msg.data;
+
+  if (reply->drawable_ID != drawable_ID)
+    {
+      g_message ("received drawable map did not match the requested drawable");
+      gimp_quit ();
+    }
+
+  if (reply->shm_ID != -1)
+    {
+      mapped->size = ((gsize) reply->bpp * reply->width * reply->height);
+      mapped->data = _gimp_shm_map (reply->shm_ID, mapped->size);
+
+      /*  the core releases its side of the segment once we are attached  */
+      if (! gp_tile_ack_write (_writechannel, NULL))
+        gimp_quit ();
+
+      if (mapped->data &&
+          (reply->bpp    != babl_format_get_bytes_per_pixel (format) ||
+           reply->width  != gimp_drawable_width  (drawable_ID)       ||
+           reply->height != gimp_drawable_height (drawable_ID)))
+        {
+          g_message ("received drawable map did not match the drawable");
+
+          _gimp_shm_unmap (mapped->data, mapped->size);
+          mapped->data = NULL;
+        }
+    }
+  gp_unlock ();
+
+  gimp_wire_destroy (&msg);
+
+  return mapped->data;
+}
+
+static void
+gimp_drawable_unmap (MappedData *mapped)
+{
+  _gimp_shm_unmap (mapped->data, mapped->size);
+
+  g_slice_free (MappedData, mapped);
+}
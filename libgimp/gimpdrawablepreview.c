@@ -86,6 +86,11 @@ static void  gimp_drawable_preview_style_set     (GtkWidget       *widget,
                                                   GtkStyle        *prev_style);
 
 static void  gimp_drawable_preview_draw_original (GimpPreview     *preview);
+static void  gimp_drawable_preview_draw_area     (GimpPreview     *preview,
+                                                  gint             x,
+                                                  gint             y,
+                                                  gint             width,
+                                                  gint             height);
 static void  gimp_drawable_preview_draw_thumb    (GimpPreview     *preview,
                                                   GimpPreviewArea *area,
                                                   gint             width,
@@ -126,6 +131,7 @@ gimp_drawable_preview_class_init (GimpDrawablePreviewClass *klass)
   preview_class->draw        = gimp_drawable_preview_draw_original;
   preview_class->draw_thumb  = gimp_drawable_preview_draw_thumb;
   preview_class->draw_buffer = gimp_drawable_preview_draw_buffer;
+  preview_class->draw_area   = gimp_drawable_preview_draw_area;
 
   g_type_class_add_private (object_class, sizeof (GimpDrawablePreviewPrivate));
 
@@ -329,6 +335,43 @@ gimp_drawable_preview_draw_original (GimpPreview *preview)
   g_free (buffer);
 }
 
+static void
+gimp_drawable_preview_draw_area (GimpPreview *preview,
+                                 gint         x,
+                                 gint         y,
+                                 gint         width,
+                                 gint         height)
+{
+  GimpDrawablePreviewPrivate *priv = GIMP_DRAWABLE_PREVIEW_GET_PRIVATE (preview);
+  guchar                     *buffer;
+  gint                        bpp;
+  GimpImageType               type;
+
+  if (priv->drawable_ID < 1)
+    return;
+
+  buffer = gimp_drawable_get_sub_thumbnail_data (priv->drawable_ID,
+                                                 x, y, width, height,
+                                                 &width, &height, &bpp);
+
+  switch (bpp)
+    {
+    case 1: type = GIMP_GRAY_IMAGE; break;
+    case 2: type = GIMP_GRAYA_IMAGE; break;
+    case 3: type = GIMP_RGB_IMAGE; break;
+    case 4: type = GIMP_RGBA_IMAGE; break;
+    default:
+      g_free (buffer);
+      return;
+    }
+
+  gimp_preview_area_draw (GIMP_PREVIEW_AREA (preview->area),
+                          x - preview->xmin - preview->xoff,
+                          y - preview->ymin - preview->yoff,
+                          width, height, type, buffer, width * bpp);
+  g_free (buffer);
+}
+
 static void
 gimp_drawable_preview_draw_thumb (GimpPreview     *preview,
                                   GimpPreviewArea *area,
@@ -0,0 +1,340 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimppdbcache.c
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gimp.h"
+
+#include "gimppdbcache.h"
+
+
+/*  the cache caches the return values of procedures which GIMP
+ *  reported as pure, keyed by the procedure's name and arguments.
+ *  it is flushed whenever the plug-in runs a procedure that isn't
+ *  pure, and when GIMP sends GP_PROC_CACHE_FLUSH.
+ */
+
+#define MAX_CACHE_ENTRIES 1024
+
+
+typedef struct
+{
+  GimpParam *values;
+  gint       n_values;
+} GimpPDBCacheEntry;
+
+
+static GBytes    * gimp_pdb_cache_key         (const gchar       *name,
+                                               gint               n_params,
+                                               const GimpParam   *params);
+static gboolean    gimp_pdb_cache_cacheable   (const GimpParam   *values,
+                                               gint               n_values);
+static GimpParam * gimp_pdb_cache_copy_values (const GimpParam   *values,
+                                               gint               n_values);
+static void        gimp_pdb_cache_entry_free  (GimpPDBCacheEntry *entry);
+
+
+static GHashTable *pdb_cache = NULL;
+
+
+gboolean
+_gimp_pdb_cache_is_empty (void)
+{
+  return ! pdb_cache || g_hash_table_size (pdb_cache) == 0;
+}
+
+GimpParam *
+_gimp_pdb_cache_lookup (const gchar     *name,
+                        gint             n_params,
+                        const GimpParam *params,
+                        gint            *n_return_vals)
+{
+  GimpPDBCacheEntry *entry = NULL;
+  GBytes            *key;
+
+  if (_gimp_pdb_cache_is_empty ())
+    return NULL;
+
+  key = gimp_pdb_cache_key (name, n_params, params);
+
+  if (key)
+    {
+      entry = g_hash_table_lookup (pdb_cache, key);
+
+      g_bytes_unref (key);
+    }
+
+  if (! entry)
+    return NULL;
+
+  *n_return_vals = entry->n_values;
+
+  return gimp_pdb_cache_copy_values (entry->values, entry->n_values);
+}
+
+void
+_gimp_pdb_cache_insert (const gchar     *name,
+                        gint             n_params,
+                        const GimpParam *params,
+                        gint             n_return_vals,
+                        const GimpParam *return_vals)
+{
+  GimpPDBCacheEntry *entry;
+  GBytes            *key;
+
+  if (! gimp_pdb_cache_cacheable (return_vals, n_return_vals))
+    return;
+
+  key = gimp_pdb_cache_key (name, n_params, params);
+
+  if (! key)
+    return;
+
+  if (! pdb_cache)
+    pdb_cache = g_hash_table_new_full (g_bytes_hash,
+                                       g_bytes_equal,
+                                       (GDestroyNotify) g_bytes_unref,
+                                       (GDestroyNotify) gimp_pdb_cache_entry_free);
+
+  /*  there is no point in being clever about which entries to drop,
+   *  the whole cache goes away with the next non-pure call anyway
+   */
+  if (g_hash_table_size (pdb_cache) >= MAX_CACHE_ENTRIES)
+    g_hash_table_remove_all (pdb_cache);
+
+  entry = g_slice_new (GimpPDBCacheEntry);
+
+  entry->values   = gimp_pdb_cache_copy_values (return_vals, n_return_vals);
+  entry->n_values = n_return_vals;
+
+  g_hash_table_replace (pdb_cache, key, entry);
+}
+
+void
+_gimp_pdb_cache_flush (void)
+{
+  if (pdb_cache)
+    g_hash_table_remove_all (pdb_cache);
+}
+
+
+/*  private functions  */
+
+static GBytes *
+gimp_pdb_cache_key (const gchar     *name,
+                    gint             n_params,
+                    const GimpParam *params)
+{
+  GByteArray *key = g_byte_array_new ();
+  gint        i;
+
+  g_byte_array_append (key, (const guint8 *) name, strlen (name) + 1);
+
+  for (i = 0; i < n_params; i++)
+    {
+      const GimpParamData *data = &params[i].data;
+
+      g_byte_array_append (key,
+                           (const guint8 *) &params[i].type,
+                           sizeof (params[i].type));
+
+      switch (params[i].type)
+        {
+        case GIMP_PDB_INT32:
+        case GIMP_PDB_ITEM:
+        case GIMP_PDB_DISPLAY:
+        case GIMP_PDB_IMAGE:
+        case GIMP_PDB_LAYER:
+        case GIMP_PDB_CHANNEL:
+        case GIMP_PDB_DRAWABLE:
+        case GIMP_PDB_SELECTION:
+        case GIMP_PDB_VECTORS:
+        case GIMP_PDB_STATUS:
+          g_byte_array_append (key,
+                               (const guint8 *) &data->d_int32,
+                               sizeof (data->d_int32));
+          break;
+
+        case GIMP_PDB_INT16:
+          g_byte_array_append (key,
+                               (const guint8 *) &data->d_int16,
+                               sizeof (data->d_int16));
+          break;
+
+        case GIMP_PDB_INT8:
+          g_byte_array_append (key, &data->d_int8, 1);
+          break;
+
+        case GIMP_PDB_FLOAT:
+          g_byte_array_append (key,
+                               (const guint8 *) &data->d_float,
+                               sizeof (data->d_float));
+          break;
+
+        case GIMP_PDB_COLOR:
+          g_byte_array_append (key,
+                               (const guint8 *) &data->d_color,
+                               sizeof (data->d_color));
+          break;
+
+        case GIMP_PDB_STRING:
+          {
+            /*  tell NULL from ""  */
+            guint8 is_set = data->d_string != NULL;
+
+            g_byte_array_append (key, &is_set, 1);
+
+            if (is_set)
+              g_byte_array_append (key,
+                                   (const guint8 *) data->d_string,
+                                   strlen (data->d_string) + 1);
+          }
+          break;
+
+        default:
+          /*  arrays and parasites are not worth it  */
+          g_byte_array_unref (key);
+          return NULL;
+        }
+    }
+
+  return g_byte_array_free_to_bytes (key);
+}
+
+static gboolean
+gimp_pdb_cache_cacheable (const GimpParam *values,
+                          gint             n_values)
+{
+  gint i;
+
+  if (n_values < 1                         ||
+      values[0].type != GIMP_PDB_STATUS    ||
+      values[0].data.d_status != GIMP_PDB_SUCCESS)
+    return FALSE;
+
+  for (i = 1; i < n_values; i++)
+    {
+      switch (values[i].type)
+        {
+        case GIMP_PDB_INT32:
+        case GIMP_PDB_INT16:
+        case GIMP_PDB_INT8:
+        case GIMP_PDB_FLOAT:
+        case GIMP_PDB_STRING:
+        case GIMP_PDB_COLOR:
+        case GIMP_PDB_ITEM:
+        case GIMP_PDB_DISPLAY:
+        case GIMP_PDB_IMAGE:
+        case GIMP_PDB_LAYER:
+        case GIMP_PDB_CHANNEL:
+        case GIMP_PDB_DRAWABLE:
+        case GIMP_PDB_SELECTION:
+        case GIMP_PDB_VECTORS:
+        case GIMP_PDB_STATUS:
+          break;
+
+        case GIMP_PDB_INT32ARRAY:
+        case GIMP_PDB_INT16ARRAY:
+        case GIMP_PDB_INT8ARRAY:
+        case GIMP_PDB_FLOATARRAY:
+        case GIMP_PDB_STRINGARRAY:
+        case GIMP_PDB_COLORARRAY:
+          /*  the length of an array is the value before it  */
+          if (values[i - 1].type != GIMP_PDB_INT32)
+            return FALSE;
+          break;
+
+        default:
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static GimpParam *
+gimp_pdb_cache_copy_values (const GimpParam *values,
+                            gint             n_values)
+{
+  GimpParam *copy = g_memdup (values, n_values * sizeof (GimpParam));
+  gint       i;
+
+  for (i = 1; i < n_values; i++)
+    {
+      const GimpParamData *src  = &values[i].data;
+      GimpParamData       *dest = &copy[i].data;
+      gint                 n    = MAX (0, values[i - 1].data.d_int32);
+      gint                 j;
+
+      switch (values[i].type)
+        {
+        case GIMP_PDB_STRING:
+          dest->d_string = g_strdup (src->d_string);
+          break;
+
+        case GIMP_PDB_INT32ARRAY:
+          dest->d_int32array = g_memdup (src->d_int32array,
+                                         n * sizeof (gint32));
+          break;
+
+        case GIMP_PDB_INT16ARRAY:
+          dest->d_int16array = g_memdup (src->d_int16array,
+                                         n * sizeof (gint16));
+          break;
+
+        case GIMP_PDB_INT8ARRAY:
+          dest->d_int8array = g_memdup (src->d_int8array,
+                                        n * sizeof (guint8));
+          break;
+
+        case GIMP_PDB_FLOATARRAY:
+          dest->d_floatarray = g_memdup (src->d_floatarray,
+                                         n * sizeof (gdouble));
+          break;
+
+        case GIMP_PDB_COLORARRAY:
+          dest->d_colorarray = g_memdup (src->d_colorarray,
+                                         n * sizeof (GimpRGB));
+          break;
+
+        case GIMP_PDB_STRINGARRAY:
+          dest->d_stringarray = g_new (gchar *, n);
+
+          for (j = 0; j < n; j++)
+            dest->d_stringarray[j] = g_strdup (src->d_stringarray[j]);
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  return copy;
+}
+
+static void
+gimp_pdb_cache_entry_free (GimpPDBCacheEntry *entry)
+{
+  gimp_destroy_params (entry->values, entry->n_values);
+
+  g_slice_free (GimpPDBCacheEntry, entry);
+}
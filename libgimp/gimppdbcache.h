@@ -0,0 +1,42 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimppdbcache.h
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PDB_CACHE_H__
+#define __GIMP_PDB_CACHE_H__
+
+G_BEGIN_DECLS
+
+
+G_GNUC_INTERNAL gboolean    _gimp_pdb_cache_is_empty (void);
+G_GNUC_INTERNAL GimpParam * _gimp_pdb_cache_lookup   (const gchar     *name,
+                                                      gint             n_params,
+                                                      const GimpParam *params,
+                                                      gint            *n_return_vals);
+G_GNUC_INTERNAL void        _gimp_pdb_cache_insert   (const gchar     *name,
+                                                      gint             n_params,
+                                                      const GimpParam *params,
+                                                      gint             n_return_vals,
+                                                      const GimpParam *return_vals);
+G_GNUC_INTERNAL void        _gimp_pdb_cache_flush    (void);
+
+
+G_END_DECLS
+
+#endif /*  __GIMP_PDB_CACHE_H__ */
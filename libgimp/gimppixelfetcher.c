@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #define GIMP_DISABLE_DEPRECATION_WARNINGS
 
 #include "gimp.h"
@@ -35,9 +37,19 @@
  * special treatment for neighbourhoods which are completely inside a
  * tile is called for. It hides the special treatment of tile borders,
  * making plug-in code more readable and shorter.
+ *
+ * Instead of fetching a neighbourhood pixel by pixel,
+ * gimp_pixel_fetcher_get_block() returns it all at once, from a
+ * window of pixels which is fetched ahead, including the pixels
+ * beyond the drawable's edges.
  **/
 
 
+/*  the least size of the window of prefetched pixels, in tiles  */
+#define WINDOW_TILES_X 4
+#define WINDOW_TILES_Y 2
+
+
 struct _GimpPixelFetcher
 {
   gint                      col, row;
@@ -52,6 +64,13 @@ struct _GimpPixelFetcher
   GimpTile                 *tile;
   gboolean                  tile_dirty;
   gboolean                  shadow;
+  gboolean                  has_alpha;
+
+  guchar                   *window;
+  gsize                     window_alloc;
+  gint                      win_x, win_y;
+  gint                      win_width, win_height;
+  gboolean                  win_valid;
 };
 
 
@@ -60,6 +79,7 @@ struct _GimpPixelFetcher
 static guchar * gimp_pixel_fetcher_provide_tile (GimpPixelFetcher *pf,
                                                  gint              x,
                                                  gint              y);
+static void     gimp_pixel_fetcher_fill_window  (GimpPixelFetcher *pf);
 
 
 /*  public functions  */
@@ -113,6 +133,7 @@ gimp_pixel_fetcher_new (GimpDrawable *drawable,
   pf->tile          = NULL;
   pf->tile_dirty    = FALSE;
   pf->shadow        = shadow;
+  pf->has_alpha     = gimp_drawable_has_alpha (drawable->drawable_id);
 
   return pf;
 }
@@ -131,6 +152,8 @@ gimp_pixel_fetcher_destroy (GimpPixelFetcher *pf)
   if (pf->tile)
     gimp_tile_unref (pf->tile, pf->tile_dirty);
 
+  g_free (pf->window);
+
   g_slice_free (GimpPixelFetcher, pf);
 }
 
@@ -147,6 +170,9 @@ gimp_pixel_fetcher_set_edge_mode (GimpPixelFetcher         *pf,
 {
   g_return_if_fail (pf != NULL);
 
+  if (mode != pf->mode)
+    pf->win_valid = FALSE;
+
   pf->mode = mode;
 }
 
@@ -177,6 +203,8 @@ gimp_pixel_fetcher_set_bg_color (GimpPixelFetcher *pf,
                           pf->bg_color, pf->bg_color + 1, pf->bg_color + 2);
       break;
     }
+
+  pf->win_valid = FALSE;
 }
 
 /**
@@ -299,6 +327,215 @@ gimp_pixel_fetcher_put_pixel (GimpPixelFetcher *pf,
   while (--i);
 
   pf->tile_dirty = TRUE;
+
+  if (x >= pf->win_x && x < pf->win_x + pf->win_width &&
+      y >= pf->win_y && y < pf->win_y + pf->win_height)
+    {
+      pf->win_valid = FALSE;
+    }
+}
+
+/**
+ * gimp_pixel_fetcher_get_block:
+ * @pf:        a pointer to a previously initialized #GimpPixelFetcher.
+ * @x:         the x coordinate of the block's top-left pixel.
+ * @y:         the y coordinate of the block's top-left pixel.
+ * @width:     the width of the block.
+ * @height:    the height of the block.
+ * @rowstride: return location for the distance between the block's
+ *             rows, in bytes.
+ *
+ * Gets a block of pixels from the pixel region, such as the
+ * neighbourhood of a pixel, much faster than getting its pixels one
+ * by one with gimp_pixel_fetcher_get_pixel().
+ *
+ * The pixels outside the drawable are filled in according to the
+ * edge mode.  With %GIMP_PIXEL_FETCHER_EDGE_NONE they are zero, and
+ * unlike with gimp_pixel_fetcher_get_pixel(), the pixels inside the
+ * drawable but outside the selection are returned too.
+ *
+ * The block is fetched ahead together with the pixels around it, so
+ * fetching overlapping or neighbouring blocks is cheap.
+ *
+ * Return value: the block's top-left pixel.  The block belongs to
+ *               @pf, and is valid until @pf is used again.
+ *
+ * Since: 2.10.10
+ **/
+const guchar *
+gimp_pixel_fetcher_get_block (GimpPixelFetcher *pf,
+                              gint              x,
+                              gint              y,
+                              gint              width,
+                              gint              height,
+                              gint             *rowstride)
+{
+  g_return_val_if_fail (pf != NULL, NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+  g_return_val_if_fail (rowstride != NULL, NULL);
+
+  if (! pf->win_valid                              ||
+      x          <  pf->win_x                      ||
+      y          <  pf->win_y                      ||
+      x + width  >  pf->win_x + pf->win_width      ||
+      y + height >  pf->win_y + pf->win_height)
+    {
+      gint win_width  = MAX (width,  WINDOW_TILES_X * pf->tile_width);
+      gint win_height = MAX (height, WINDOW_TILES_Y * pf->tile_height);
+
+      /*  leave some room behind the block too, for callers which
+       *  don't always move forward
+       */
+      pf->win_x      = x - (win_width  - width)  / 4;
+      pf->win_y      = y - (win_height - height) / 4;
+      pf->win_width  = win_width;
+      pf->win_height = win_height;
+
+      gimp_pixel_fetcher_fill_window (pf);
+    }
+
+  *rowstride = pf->win_width * pf->img_bpp;
+
+  return (pf->window +
+          (y - pf->win_y) * *rowstride +
+          (x - pf->win_x) * pf->img_bpp);
+}
+
+/**
+ * gimp_pixel_fetcher_get_pixel_bilinear:
+ * @pf:    a pointer to a previously initialized #GimpPixelFetcher.
+ * @x:     the x coordinate to sample at.
+ * @y:     the y coordinate to sample at.
+ * @pixel: the memory location where to return the pixel.
+ *
+ * Samples the pixel region at a fractional position, interpolating
+ * bilinearly between the four pixels around it.  Integer coordinates
+ * fall on pixels.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_pixel_fetcher_get_pixel_bilinear (GimpPixelFetcher *pf,
+                                       gdouble           x,
+                                       gdouble           y,
+                                       guchar           *pixel)
+{
+  const guchar *block;
+  guchar       *values[4];
+  gint          rowstride;
+  gdouble       fx = floor (x);
+  gdouble       fy = floor (y);
+
+  g_return_if_fail (pf != NULL);
+  g_return_if_fail (pixel != NULL);
+
+  block = gimp_pixel_fetcher_get_block (pf, (gint) fx, (gint) fy, 2, 2,
+                                        &rowstride);
+
+  values[0] = (guchar *) block;
+  values[1] = (guchar *) block + pf->img_bpp;
+  values[2] = (guchar *) block + rowstride;
+  values[3] = (guchar *) block + rowstride + pf->img_bpp;
+
+  gimp_bilinear_pixels_8 (pixel, x - fx, y - fy,
+                          pf->img_bpp, pf->has_alpha, values);
+}
+
+/**
+ * gimp_pixel_fetcher_get_pixel_bicubic:
+ * @pf:    a pointer to a previously initialized #GimpPixelFetcher.
+ * @x:     the x coordinate to sample at.
+ * @y:     the y coordinate to sample at.
+ * @pixel: the memory location where to return the pixel.
+ *
+ * Samples the pixel region at a fractional position, interpolating
+ * between the sixteen pixels around it with a Catmull-Rom spline.
+ * Integer coordinates fall on pixels.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_pixel_fetcher_get_pixel_bicubic (GimpPixelFetcher *pf,
+                                      gdouble           x,
+                                      gdouble           y,
+                                      guchar           *pixel)
+{
+  const guchar *block;
+  gint          rowstride;
+  gdouble       fx = floor (x);
+  gdouble       fy = floor (y);
+  gdouble       wx[4];
+  gdouble       wy[4];
+  gdouble       sum[4] = { 0.0, };
+  gint          bpp;
+  gint          n_colors;
+  gint          i, j, b;
+
+  g_return_if_fail (pf != NULL);
+  g_return_if_fail (pixel != NULL);
+
+  bpp      = pf->img_bpp;
+  n_colors = pf->has_alpha ? bpp - 1 : bpp;
+
+  block = gimp_pixel_fetcher_get_block (pf, (gint) fx - 1, (gint) fy - 1, 4, 4,
+                                        &rowstride);
+
+  x -= fx;
+  y -= fy;
+
+  wx[0] = ((2.0 - x) * x - 1.0) * x * 0.5;
+  wx[1] = ((3.0 * x - 5.0) * x * x + 2.0) * 0.5;
+  wx[2] = ((4.0 - 3.0 * x) * x + 1.0) * x * 0.5;
+  wx[3] = (x - 1.0) * x * x * 0.5;
+
+  wy[0] = ((2.0 - y) * y - 1.0) * y * 0.5;
+  wy[1] = ((3.0 * y - 5.0) * y * y + 2.0) * 0.5;
+  wy[2] = ((4.0 - 3.0 * y) * y + 1.0) * y * 0.5;
+  wy[3] = (y - 1.0) * y * y * 0.5;
+
+  for (j = 0; j < 4; j++)
+    {
+      const guchar *p = block + j * rowstride;
+
+      for (i = 0; i < 4; i++, p += bpp)
+        {
+          gdouble w = wx[i] * wy[j];
+
+          /*  weigh the colors by alpha, like gimp_bilinear_pixels_8()  */
+          if (pf->has_alpha)
+            {
+              sum[n_colors] += w * p[n_colors];
+
+              w *= p[n_colors];
+            }
+
+          for (b = 0; b < n_colors; b++)
+            sum[b] += w * p[b];
+        }
+    }
+
+  if (pf->has_alpha)
+    {
+      gdouble alpha = CLAMP (sum[n_colors], 0.0, 255.0);
+
+      pixel[n_colors] = RINT (alpha);
+
+      if (alpha > 0.0)
+        {
+          for (b = 0; b < n_colors; b++)
+            pixel[b] = RINT (CLAMP (sum[b] / sum[n_colors], 0.0, 255.0));
+        }
+      else
+        {
+          for (b = 0; b < n_colors; b++)
+            pixel[b] = 0;
+        }
+    }
+  else
+    {
+      for (b = 0; b < n_colors; b++)
+        pixel[b] = RINT (CLAMP (sum[b], 0.0, 255.0));
+    }
 }
 
 
@@ -332,3 +569,76 @@ gimp_pixel_fetcher_provide_tile (GimpPixelFetcher *pf,
 
   return pf->tile->data + pf->img_bpp * (pf->tile->ewidth * rowoff + coloff);
 }
+
+static void
+gimp_pixel_fetcher_fill_window (GimpPixelFetcher *pf)
+{
+  const gint  bpp       = pf->img_bpp;
+  const gint  rowstride = pf->win_width * bpp;
+  gsize       size      = (gsize) rowstride * pf->win_height;
+  gint        x1, y1, x2, y2;
+  gint        x, y;
+
+  if (size > pf->window_alloc)
+    {
+      g_free (pf->window);
+
+      pf->window       = g_malloc (size);
+      pf->window_alloc = size;
+    }
+
+  /*  copy the part inside the drawable, tile by tile  */
+
+  x1 = MAX (pf->win_x, 0);
+  y1 = MAX (pf->win_y, 0);
+  x2 = MIN (pf->win_x + pf->win_width,  pf->img_width);
+  y2 = MIN (pf->win_y + pf->win_height, pf->img_height);
+
+  for (y = y1; y < y2; y = (y / pf->tile_height + 1) * pf->tile_height)
+    {
+      gint rows = MIN (y2, (y / pf->tile_height + 1) * pf->tile_height) - y;
+
+      for (x = x1; x < x2; x = (x / pf->tile_width + 1) * pf->tile_width)
+        {
+          gint          cols = MIN (x2, (x / pf->tile_width + 1) * pf->tile_width) - x;
+          const guchar *src  = gimp_pixel_fetcher_provide_tile (pf, x, y);
+          guchar       *dest;
+          gint          i;
+
+          dest = pf->window + (y - pf->win_y) * rowstride + (x - pf->win_x) * bpp;
+
+          for (i = 0; i < rows; i++)
+            {
+              memcpy (dest, src, cols * bpp);
+
+              src  += pf->tile->ewidth * bpp;
+              dest += rowstride;
+            }
+        }
+    }
+
+  /*  pad the rest according to the edge mode, once for the window
+   *  instead of for every pixel fetched from it
+   */
+
+  if (x1 > pf->win_x || y1 > pf->win_y ||
+      x2 < pf->win_x + pf->win_width || y2 < pf->win_y + pf->win_height)
+    {
+      for (y = pf->win_y; y < pf->win_y + pf->win_height; y++)
+        {
+          guchar *dest = pf->window + (y - pf->win_y) * rowstride;
+
+          for (x = pf->win_x; x < pf->win_x + pf->win_width; x++, dest += bpp)
+            {
+              if (x >= x1 && x < x2 && y >= y1 && y < y2)
+                continue;
+
+              memset (dest, 0, bpp);
+
+              gimp_pixel_fetcher_get_pixel (pf, x, y, dest);
+            }
+        }
+    }
+
+  pf->win_valid = TRUE;
+}
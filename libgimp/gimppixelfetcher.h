@@ -71,6 +71,24 @@ void   gimp_pixel_fetcher_put_pixel     (GimpPixelFetcher         *pf,
                                          gint                      y,
                                          const guchar             *pixel);
 
+GIMP_DEPRECATED
+const guchar * gimp_pixel_fetcher_get_block (GimpPixelFetcher     *pf,
+                                             gint                  x,
+                                             gint                  y,
+                                             gint                  width,
+                                             gint                  height,
+                                             gint                 *rowstride);
+GIMP_DEPRECATED
+void   gimp_pixel_fetcher_get_pixel_bilinear (GimpPixelFetcher    *pf,
+                                              gdouble              x,
+                                              gdouble              y,
+                                              guchar              *pixel);
+GIMP_DEPRECATED
+void   gimp_pixel_fetcher_get_pixel_bicubic  (GimpPixelFetcher    *pf,
+                                              gdouble              x,
+                                              gdouble              y,
+                                              guchar              *pixel);
+
 G_END_DECLS
 
 #endif /* __GIMP_PIXEL_FETCHER_H__ */
@@ -41,9 +41,15 @@
 #define TILE_WIDTH  gimp_tile_width()
 #define TILE_HEIGHT gimp_tile_height()
 
+/*  the number of portions per thread handed out at once by
+ *  gimp_pixel_rgns_process_parallel()
+ */
+#define PORTIONS_PER_THREAD 4
+
 
 typedef struct _GimpPixelRgnHolder    GimpPixelRgnHolder;
 typedef struct _GimpPixelRgnIterator  GimpPixelRgnIterator;
+typedef struct _GimpPixelRgnBatch     GimpPixelRgnBatch;
 
 struct _GimpPixelRgnHolder
 {
@@ -64,6 +70,22 @@ struct _GimpPixelRgnIterator
   gint    process_count;
 };
 
+struct _GimpPixelRgnBatch
+{
+  GimpPixelRgnsFunc   func;
+  gpointer            data;
+  gint                nrgns;
+
+  GimpPixelRgn       *portions;      /* n_portions * nrgns regions        */
+  GimpPixelRgn      **prs;           /* pointers into portions, or NULL   */
+  gint                n_portions;
+  gint                next_portion;  /* accessed atomically               */
+
+  GMutex              mutex;
+  GCond               cond;
+  gint                n_remaining;
+};
+
 
 static gint     gimp_get_portion_width    (GimpPixelRgnIterator *pri);
 static gint     gimp_get_portion_height   (GimpPixelRgnIterator *pri);
@@ -71,6 +93,14 @@ static gpointer gimp_pixel_rgns_configure (GimpPixelRgnIterator *pri);
 static void     gimp_pixel_rgn_configure  (GimpPixelRgnHolder   *prh,
                                            GimpPixelRgnIterator *pri);
 
+static void     gimp_pixel_rgn_batch_run    (GimpPixelRgnBatch    *batch);
+static void     gimp_pixel_rgn_batch_thread (GimpPixelRgnBatch    *batch,
+                                             gpointer              unused);
+
+
+static GThreadPool *portion_pool = NULL;
+
+
 /**
  * gimp_pixel_rgn_init:
  * @pr:        a pointer to a #GimpPixelRgn variable.
@@ -803,6 +833,148 @@ gimp_pixel_rgns_process (gpointer pri_ptr)
   return gimp_pixel_rgns_configure (pri);
 }
 
+/**
+ * gimp_pixel_rgns_process_parallel:
+ * @nrgns:     the number of regions.
+ * @prs:       an array of @nrgns pointers to initialized #GimpPixelRgn.
+ * @n_threads: the number of threads to use, or 0 to use one per processor.
+ * @func:      the function to call for each portion of the regions.
+ * @data:      user data to pass to @func.
+ *
+ * Iterates over the regions like gimp_pixel_rgns_register2() and
+ * gimp_pixel_rgns_process() do, but calls @func for the tile-aligned
+ * portions on up to @n_threads threads at once.
+ *
+ * The tiles are still only fetched and written back on the calling
+ * thread, a batch of a few portions per thread at a time: @func must
+ * therefore not call into libgimp, and must not rely on the order in
+ * which the portions are processed.  @func is passed an array of
+ * @nrgns regions, in the order of @prs, which are only valid for the
+ * duration of the call.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_pixel_rgns_process_parallel (gint                nrgns,
+                                  GimpPixelRgn      **prs,
+                                  gint                n_threads,
+                                  GimpPixelRgnsFunc   func,
+                                  gpointer            data)
+{
+  GimpPixelRgnBatch batch;
+  gpointer          pri;
+  gint              max_portions;
+
+  g_return_if_fail (nrgns > 0);
+  g_return_if_fail (prs != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (n_threads <= 0)
+    n_threads = g_get_num_processors ();
+
+  n_threads = MAX (n_threads, 1);
+
+  if (n_threads > 1 && g_once_init_enter (&portion_pool))
+    {
+      GThreadPool *pool;
+
+      pool = g_thread_pool_new ((GFunc) gimp_pixel_rgn_batch_thread,
+                                NULL, -1, FALSE, NULL);
+
+      g_once_init_leave (&portion_pool, pool);
+    }
+
+  max_portions = n_threads * PORTIONS_PER_THREAD;
+
+  batch.func     = func;
+  batch.data     = data;
+  batch.nrgns    = nrgns;
+  batch.portions = g_new (GimpPixelRgn, max_portions * nrgns);
+  batch.prs      = g_new (GimpPixelRgn *, max_portions * nrgns);
+
+  g_mutex_init (&batch.mutex);
+  g_cond_init (&batch.cond);
+
+  pri = gimp_pixel_rgns_register2 (nrgns, prs);
+
+  while (pri)
+    {
+      gint n_workers;
+      gint p;
+      gint i;
+
+      /*  collect a batch of portions.  every portion keeps an extra
+       *  reference on its tiles, so they stay around after the
+       *  iterator moved on
+       */
+      for (batch.n_portions = 0;
+           pri && batch.n_portions < max_portions;
+           batch.n_portions++)
+        {
+          GimpPixelRgn **portion = batch.prs + batch.n_portions * nrgns;
+
+          for (i = 0; i < nrgns; i++)
+            {
+              if (! prs[i])
+                {
+                  portion[i] = NULL;
+                  continue;
+                }
+
+              portion[i]  = batch.portions + batch.n_portions * nrgns + i;
+              *portion[i] = *prs[i];
+
+              if (prs[i]->drawable)
+                gimp_tile_ref (gimp_drawable_get_tile2 (prs[i]->drawable,
+                                                        prs[i]->shadow,
+                                                        prs[i]->x,
+                                                        prs[i]->y));
+            }
+
+          pri = gimp_pixel_rgns_process (pri);
+        }
+
+      batch.next_portion = 0;
+
+      n_workers = MIN (n_threads, batch.n_portions) - 1;
+
+      batch.n_remaining = n_workers;
+
+      for (i = 0; i < n_workers; i++)
+        g_thread_pool_push (portion_pool, &batch, NULL);
+
+      gimp_pixel_rgn_batch_run (&batch);
+
+      g_mutex_lock (&batch.mutex);
+
+      while (batch.n_remaining > 0)
+        g_cond_wait (&batch.cond, &batch.mutex);
+
+      g_mutex_unlock (&batch.mutex);
+
+      /*  drop the extra references, which writes back the dirty tiles
+       *  once nothing else holds on to them
+       */
+      for (p = 0; p < batch.n_portions * nrgns; p++)
+        {
+          GimpPixelRgn *pr = batch.prs[p];
+
+          if (pr && pr->drawable)
+            gimp_tile_unref (gimp_drawable_get_tile2 (pr->drawable,
+                                                      pr->shadow,
+                                                      pr->x,
+                                                      pr->y),
+                             pr->dirty);
+        }
+    }
+
+  g_mutex_clear (&batch.mutex);
+  g_cond_clear (&batch.cond);
+
+  g_free (batch.portions);
+  g_free (batch.prs);
+}
+
 
 static gint
 gimp_get_portion_width (GimpPixelRgnIterator *pri)
@@ -963,3 +1135,26 @@ gimp_pixel_rgn_configure (GimpPixelRgnHolder   *prh,
   prh->pr->w = pri->portion_width;
   prh->pr->h = pri->portion_height;
 }
+
+static void
+gimp_pixel_rgn_batch_run (GimpPixelRgnBatch *batch)
+{
+  gint p;
+
+  while ((p = g_atomic_int_add (&batch->next_portion, 1)) < batch->n_portions)
+    batch->func (batch->prs + p * batch->nrgns, batch->nrgns, batch->data);
+}
+
+static void
+gimp_pixel_rgn_batch_thread (GimpPixelRgnBatch *batch,
+                             gpointer           unused)
+{
+  gimp_pixel_rgn_batch_run (batch);
+
+  g_mutex_lock (&batch->mutex);
+
+  if (--batch->n_remaining == 0)
+    g_cond_signal (&batch->cond);
+
+  g_mutex_unlock (&batch->mutex);
+}
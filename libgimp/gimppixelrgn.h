@@ -30,6 +30,21 @@ G_BEGIN_DECLS
 /* For information look into the C source or the html documentation */
 
 
+/**
+ * GimpPixelRgnsFunc:
+ * @prs:   the portions of the registered regions to process.
+ * @nrgns: the number of regions.
+ * @data:  user data passed to gimp_pixel_rgns_process_parallel().
+ *
+ * The type of function called by gimp_pixel_rgns_process_parallel()
+ * for each tile-aligned portion of the regions.  It may run on any
+ * thread, and must not call into libgimp.
+ **/
+typedef void (* GimpPixelRgnsFunc) (GimpPixelRgn **prs,
+                                    gint           nrgns,
+                                    gpointer       data);
+
+
 struct _GimpPixelRgn
 {
   guchar       *data;          /* pointer to region data */
@@ -115,6 +130,13 @@ gpointer  gimp_pixel_rgns_register2 (gint           nrgns,
                                      GimpPixelRgn **prs);
 GIMP_DEPRECATED_FOR(gegl_buffer_iterator_next)
 gpointer  gimp_pixel_rgns_process   (gpointer       pri_ptr);
+GIMP_DEPRECATED_FOR(gegl_buffer_iterator_new)
+void      gimp_pixel_rgns_process_parallel
+                                    (gint               nrgns,
+                                     GimpPixelRgn     **prs,
+                                     gint               n_threads,
+                                     GimpPixelRgnsFunc  func,
+                                     gpointer           data);
 
 
 G_END_DECLS
@@ -42,30 +42,45 @@
  **/
 
 
-/*  This is the percentage of the maximum cache size that
- *  should be cleared from the cache when an eviction is
- *  necessary.
+/*  Unless the plug-in asks for more, its tile cache can hold this
+ *  fraction of the core's tile cache.
  */
-#define FREE_QUANTUM 0.1
+#define DEFAULT_CACHE_FRACTION 8
+
+/*  This many tiles are fetched ahead of a tile that had to be fetched
+ *  right after its neighbor.
+ */
+#define PREFETCH_N_TILES (GP_TILE_SHM_N_TILES - 1)
 
 
-void         gimp_read_expect_msg   (GimpWireMessage *msg,
-                                     gint             type);
+void          gimp_read_expect_msg     (GimpWireMessage *msg,
+                                        gint             type);
 
-static void  gimp_tile_get          (GimpTile        *tile);
-static void  gimp_tile_put          (GimpTile        *tile);
-static void  gimp_tile_cache_insert (GimpTile        *tile);
-static void  gimp_tile_cache_flush  (GimpTile        *tile);
+static void   gimp_tile_get            (GimpTile        *tile);
+static void   gimp_tile_get_multi      (GimpTile       **tiles,
+                                        gint             n_tiles);
+static void   gimp_tile_get_prefetch   (GimpTile        *tile);
+static void   gimp_tile_put            (GimpTile        *tile);
+static void   gimp_tile_cache_insert   (GimpTile        *tile);
+static void   gimp_tile_cache_flush    (GimpTile        *tile);
+static gulong gimp_tile_cache_get_size (void);
 
 
 /*  private variables  */
 
-static GHashTable * tile_hash_table = NULL;
-static GList      * tile_list_head  = NULL;
-static GList      * tile_list_tail  = NULL;
-static gulong       max_tile_size   = 0;
-static gulong       cur_cache_size  = 0;
-static gulong       max_cache_size  = 0;
+static GHashTable * tile_hash_table    = NULL;
+static GQueue       tile_queue         = G_QUEUE_INIT;
+static gulong       cur_cache_size     = 0;
+static gulong       max_cache_size     = 0;
+static gulong       default_cache_size = 0;
+
+/*  the last tile which was fetched, to tell the access direction  */
+static gint32       last_drawable_ID   = -1;
+static guint        last_shadow        = FALSE;
+static guint        last_tile_num      = 0;
+
+
+#define TILE_DATA_SIZE(tile) ((tile)->ewidth * (tile)->eheight * (tile)->bpp)
 
 
 /*  public functions  */
@@ -79,7 +94,7 @@ gimp_tile_ref (GimpTile *tile)
 
   if (tile->ref_count == 1)
     {
-      gimp_tile_get (tile);
+      gimp_tile_get_prefetch (tile);
       tile->dirty = FALSE;
     }
 
@@ -136,6 +151,9 @@ gimp_tile_flush (GimpTile *tile)
  * Sets the size of the tile cache on the plug-in side. The tile cache
  * is used to reduce the number of tiles exchanged between the GIMP core
  * and the plug-in. See also gimp_tile_cache_ntiles().
+ *
+ * The cache is never made smaller than its default size, which is
+ * derived from the tile cache size in GIMP's preferences.
  **/
 void
 gimp_tile_cache_size (gulong kilobytes)
@@ -165,6 +183,47 @@ gimp_tile_cache_ntiles (gulong ntiles)
                          gimp_tile_height () * 4 + 1023) / 1024);
 }
 
+/*  like gimp_tile_ref() for each of the 'n_tiles' tiles, which must all
+ *  be tiles of the same drawable, and all be shadow tiles or not.  the
+ *  tiles which are not referenced yet are fetched with as few requests
+ *  as possible.
+ */
+void
+_gimp_tile_ref_multi (GimpTile **tiles,
+                      gint       n_tiles)
+{
+  GimpTile **fetch   = g_newa (GimpTile *, n_tiles);
+  gint       n_fetch = 0;
+  gint       i;
+
+  g_return_if_fail (tiles != NULL || n_tiles == 0);
+
+  for (i = 1; i < n_tiles; i++)
+    {
+      g_return_if_fail (tiles[i]->drawable == tiles[0]->drawable &&
+                        tiles[i]->shadow   == tiles[0]->shadow);
+    }
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile *tile = tiles[i];
+
+      tile->ref_count++;
+
+      if (tile->ref_count == 1)
+        {
+          fetch[n_fetch++] = tile;
+          tile->dirty = FALSE;
+        }
+    }
+
+  for (i = 0; i < n_fetch; i += GP_TILE_SHM_N_TILES)
+    gimp_tile_get_multi (fetch + i, MIN (n_fetch - i, GP_TILE_SHM_N_TILES));
+
+  for (i = 0; i < n_tiles; i++)
+    gimp_tile_cache_insert (tiles[i]);
+}
+
 void
 _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
 {
@@ -172,7 +231,7 @@ _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
 
   g_return_if_fail (drawable != NULL);
 
-  list = tile_list_head;
+  list = tile_queue.head;
   while (list)
     {
       GimpTile *tile = list->data;
@@ -184,6 +243,14 @@ _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
     }
 }
 
+void
+_gimp_tile_cache_set_default (gulong kilobytes)
+{
+  guint64 size = (guint64) kilobytes * 1024 / DEFAULT_CACHE_FRACTION;
+
+  default_cache_size = MIN (size, G_MAXULONG);
+}
+
 
 /*  private functions  */
 
@@ -236,6 +303,153 @@ gimp_tile_get (GimpTile *tile)
   gimp_wire_destroy (&msg);
 }
 
+static void
+gimp_tile_get_multi (GimpTile **tiles,
+                     gint       n_tiles)
+{
+  extern GIOChannel *_writechannel;
+
+  GPTileReqMulti  tile_req;
+  guint32         tile_nums[GP_TILE_SHM_N_TILES];
+  gsize           offset = 0;
+  gint            i;
+
+  if (n_tiles == 1)
+    {
+      gimp_tile_get (tiles[0]);
+      return;
+    }
+
+  for (i = 0; i < n_tiles; i++)
+    tile_nums[i] = tiles[i]->tile_num;
+
+  tile_req.drawable_ID = tiles[0]->drawable->drawable_id;
+  tile_req.shadow      = tiles[0]->shadow;
+  tile_req.n_tiles     = n_tiles;
+  tile_req.tile_nums   = tile_nums;
+
+  gp_lock ();
+  if (! gp_tile_req_multi_write (_writechannel, &tile_req, NULL))
+    gimp_quit ();
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile        *tile = tiles[i];
+      GPTileData      *tile_data;
+      GimpWireMessage  msg;
+      gsize            size = tile->ewidth * tile->eheight * tile->bpp;
+
+      gimp_read_expect_msg (&msg, GP_TILE_DATA);
+
+      tile_data = msg.data;
+      if (tile_data->drawable_ID != tile->drawable->drawable_id ||
+          tile_data->tile_num    != tile->tile_num              ||
+          tile_data->shadow      != tile->shadow                ||
+          tile_data->width       != tile->ewidth                ||
+          tile_data->height      != tile->eheight               ||
+          tile_data->bpp         != tile->bpp)
+        {
+          g_message ("received tile info did not match computed tile info");
+          gimp_quit ();
+        }
+
+      /*  the tiles are back to back in shared memory  */
+      if (tile_data->use_shm)
+        {
+          tile->data = g_memdup (gimp_shm_addr () + offset, size);
+
+          offset += size;
+        }
+      else
+        {
+          tile->data = tile_data->data;
+          tile_data->data = NULL;
+        }
+
+      gimp_wire_destroy (&msg);
+    }
+
+  if (! gp_tile_ack_write (_writechannel, NULL))
+    gimp_quit ();
+  gp_unlock ();
+}
+
+/*  fetches 'tile' like gimp_tile_get(), and if it follows the last
+ *  fetched tile, in the same row or column, also the next few tiles in
+ *  that direction, as far as they fit into the cache.  the prefetched
+ *  tiles are referenced only by the cache.
+ */
+static void
+gimp_tile_get_prefetch (GimpTile *tile)
+{
+  GimpDrawable *drawable = tile->drawable;
+  GimpTile     *tiles[PREFETCH_N_TILES + 1];
+  gint          n_tiles  = 1;
+  guint         n_cols   = drawable->ntile_cols;
+  guint         step     = 0;
+  gint          i;
+
+  tiles[0] = tile;
+
+  if (drawable->drawable_id == last_drawable_ID &&
+      tile->shadow          == last_shadow)
+    {
+      if (tile->tile_num == last_tile_num + 1 && tile->tile_num % n_cols)
+        step = 1;
+      else if (tile->tile_num == last_tile_num + n_cols)
+        step = n_cols;
+    }
+
+  if (step)
+    {
+      gulong cache_size = gimp_tile_cache_get_size ();
+      gulong size       = TILE_DATA_SIZE (tile);
+      gint   n_prefetch = 0;
+      guint  tile_num   = tile->tile_num;
+
+      /*  leave room for 'tile' itself  */
+      if (cache_size > cur_cache_size + size)
+        n_prefetch = MIN ((cache_size - cur_cache_size - size) / size,
+                          PREFETCH_N_TILES);
+
+      while (n_tiles <= n_prefetch)
+        {
+          GimpTile *next;
+
+          tile_num += step;
+
+          if ((step == 1 && tile_num % n_cols == 0) ||
+              tile_num >= n_cols * drawable->ntile_rows)
+            break;
+
+          next = gimp_drawable_get_tile (drawable, tile->shadow,
+                                         tile_num / n_cols,
+                                         tile_num % n_cols);
+
+          /*  already there, the tiles after it most likely too  */
+          if (next->ref_count > 0)
+            break;
+
+          next->ref_count++;
+          next->dirty = FALSE;
+
+          tiles[n_tiles++] = next;
+        }
+    }
+
+  gimp_tile_get_multi (tiles, n_tiles);
+
+  for (i = 1; i < n_tiles; i++)
+    {
+      gimp_tile_cache_insert (tiles[i]);
+      gimp_tile_unref (tiles[i], FALSE);
+    }
+
+  last_drawable_ID = drawable->drawable_id;
+  last_shadow      = tile->shadow;
+  last_tile_num    = tiles[n_tiles - 1]->tile_num;
+}
+
 static void
 gimp_tile_put (GimpTile *tile)
 {
@@ -287,89 +501,57 @@ gimp_tile_put (GimpTile *tile)
   gimp_wire_destroy (&msg);
 }
 
-/* This function is nearly identical to the function 'tile_cache_insert'
- *  in the file 'tile_cache.c' which is part of the main gimp application.
+/*  the cache keeps the tiles in the order they were last used, and
+ *  drops the least recently used ones to make room.
  */
 static void
 gimp_tile_cache_insert (GimpTile *tile)
 {
-  GList *list;
+  GList  *list;
+  gulong  cache_size;
+  gulong  size;
 
-  if (!tile_hash_table)
-    {
-      tile_hash_table = g_hash_table_new (g_direct_hash, NULL);
-      max_tile_size = gimp_tile_width () * gimp_tile_height () * 4;
-    }
+  if (! tile_hash_table)
+    tile_hash_table = g_hash_table_new (g_direct_hash, NULL);
 
-  /* First check and see if the tile is already
-   *  in the cache. In that case we will simply place
-   *  it at the end of the tile list to indicate that
-   *  it was the most recently accessed tile.
+  /* If the tile is already in the cache, move it to the end of
+   *  the queue to mark it as the most recently used tile.
    */
   list = g_hash_table_lookup (tile_hash_table, tile);
 
   if (list)
     {
-      /* The tile was already in the cache. Place it at
-       *  the end of the tile list.
-       */
-
-      /* If the tile is already at the end of the list, we are done */
-      if (list == tile_list_tail)
-        return;
-
-      /* At this point we have at least two elements in our list */
-      g_assert (tile_list_head != tile_list_tail);
-
-      tile_list_head = g_list_remove_link (tile_list_head, list);
+      if (list != tile_queue.tail)
+        {
+          g_queue_unlink (&tile_queue, list);
+          g_queue_push_tail_link (&tile_queue, list);
+        }
 
-      tile_list_tail = g_list_last (g_list_concat (tile_list_tail, list));
+      return;
     }
-  else
-    {
-      /* The tile was not in the cache. First check and see
-       *  if there is room in the cache. If not then we'll have
-       *  to make room first. Note: it might be the case that the
-       *  cache is smaller than the size of a tile in which case
-       *  it won't be possible to put it in the cache.
-       */
 
-      if ((cur_cache_size + max_tile_size) > max_cache_size)
-        {
-          while (tile_list_head &&
-                 (cur_cache_size +
-                  max_cache_size * FREE_QUANTUM) > max_cache_size)
-            {
-              gimp_tile_cache_flush ((GimpTile *) tile_list_head->data);
-            }
-
-          if ((cur_cache_size + max_tile_size) > max_cache_size)
-            return;
-        }
+  cache_size = gimp_tile_cache_get_size ();
+  size       = TILE_DATA_SIZE (tile);
 
-      /* Place the tile at the end of the tile list.
-       */
-      tile_list_tail = g_list_append (tile_list_tail, tile);
+  /* The cache might be smaller than the tile, in which case
+   *  it won't be possible to put it in the cache.
+   */
+  if (size > cache_size)
+    return;
 
-      if (! tile_list_head)
-        tile_list_head = tile_list_tail;
+  while (cur_cache_size + size > cache_size)
+    gimp_tile_cache_flush (tile_queue.head->data);
 
-      tile_list_tail = g_list_last (tile_list_tail);
+  g_queue_push_tail (&tile_queue, tile);
 
-      /* Add the tiles list node to the tile hash table.
-       */
-      g_hash_table_insert (tile_hash_table, tile, tile_list_tail);
+  g_hash_table_insert (tile_hash_table, tile, tile_queue.tail);
 
-      /* Note the increase in the number of bytes the cache
-       *  is referencing.
-       */
-      cur_cache_size += max_tile_size;
+  cur_cache_size += size;
 
-      /* Reference the tile so that it won't be returned to
-       *  the main gimp application immediately.
-       */
-      tile->ref_count++;
-    }
+  /* Reference the tile so that it won't be returned to
+   *  the main gimp application immediately.
+   */
+  tile->ref_count++;
 }
 
 static void
@@ -380,35 +562,23 @@ gimp_tile_cache_flush (GimpTile *tile)
   if (! tile_hash_table)
     return;
 
-  /* Find where the tile is in the cache.
-   */
   list = g_hash_table_lookup (tile_hash_table, tile);
 
   if (list)
     {
-      /* If the tile is in the cache, then remove it from the
-       *  tile list.
-       */
-      if (list == tile_list_tail)
-        tile_list_tail = tile_list_tail->prev;
-
-      tile_list_head = g_list_remove_link (tile_list_head, list);
-
-      if (! tile_list_head)
-        tile_list_tail = NULL;
-
-      /* Remove the tile from the tile hash table.
-       */
+      g_queue_delete_link (&tile_queue, list);
       g_hash_table_remove (tile_hash_table, tile);
-      g_list_free (list);
 
-      /* Note the decrease in the number of bytes the cache
-       *  is referencing.
-       */
-      cur_cache_size -= max_tile_size;
+      cur_cache_size -= TILE_DATA_SIZE (tile);
 
       /* Unreference the tile.
        */
       gimp_tile_unref (tile, FALSE);
     }
 }
+
+static gulong
+gimp_tile_cache_get_size (void)
+{
+  return MAX (max_cache_size, default_cache_size);
+}
@@ -60,9 +60,12 @@ GIMP_DEPRECATED
 void    gimp_tile_cache_ntiles (gulong     ntiles);
 
 
-/*  private function  */
+/*  private functions  */
 
+G_GNUC_INTERNAL void _gimp_tile_ref_multi            (GimpTile    **tiles,
+                                                      gint          n_tiles);
 G_GNUC_INTERNAL void _gimp_tile_cache_flush_drawable (GimpDrawable *drawable);
+G_GNUC_INTERNAL void _gimp_tile_cache_set_default    (gulong        kilobytes);
 
 
 G_END_DECLS
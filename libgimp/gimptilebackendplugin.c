@@ -175,8 +175,11 @@ gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
   GimpTileBackendPluginPrivate *priv    = backend_plugin->priv;
   GeglTileBackend              *backend = GEGL_TILE_BACKEND (backend_plugin);
   GeglTile                     *tile;
+  GimpTile                    **gimp_tiles;
+  gint                          n_gimp_tiles = 0;
   gint                          tile_size;
   gint                          u, v;
+  gint                          i;
   gint                          mul = priv->mul;
   guchar                       *tile_data;
 
@@ -187,6 +190,27 @@ gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
   tile       = gegl_tile_new (tile_size);
   tile_data  = gegl_tile_get_data (tile);
 
+  gimp_tiles = g_newa (GimpTile *, mul * mul);
+
+  for (u = 0; u < mul; u++)
+    {
+      for (v = 0; v < mul; v++)
+        {
+          if (x + u >= priv->drawable->ntile_cols ||
+              y + v >= priv->drawable->ntile_rows)
+            continue;
+
+          gimp_tiles[n_gimp_tiles++] = gimp_drawable_get_tile (priv->drawable,
+                                                               priv->shadow,
+                                                               y + v, x + u);
+        }
+    }
+
+  /*  fetch the tiles which are not cached with a single request  */
+  _gimp_tile_ref_multi (gimp_tiles, n_gimp_tiles);
+
+  i = 0;
+
   for (u = 0; u < mul; u++)
     {
       for (v = 0; v < mul; v++)
@@ -197,10 +221,7 @@ gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
               y + v >= priv->drawable->ntile_rows)
             continue;
 
-          gimp_tile = gimp_drawable_get_tile (priv->drawable,
-                                              priv->shadow,
-                                              y + v, x + u);
-          gimp_tile_ref (gimp_tile);
+          gimp_tile = gimp_tiles[i++];
 
           {
             gint ewidth           = gimp_tile->ewidth;
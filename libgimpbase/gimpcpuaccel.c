@@ -130,6 +130,11 @@ enum
   ARCH_X86_INTEL_FEATURE_AVX      = 1 << 28
 };
 
+enum
+{
+  ARCH_X86_INTEL_FEATURE_AVX2     = 1 << 5
+};
+
 #if !defined(ARCH_X86_64) && (defined(PIC) || defined(__PIC__))
 #define cpuid(op,eax,ebx,ecx,edx)  \
   __asm__ ("movl %%ebx, %%esi\n\t" \
@@ -140,6 +145,16 @@ enum
              "=c" (ecx),           \
              "=d" (edx)            \
            : "0" (op))
+#define cpuid_count(op,count,eax,ebx,ecx,edx) \
+  __asm__ ("movl %%ebx, %%esi\n\t"            \
+           "cpuid\n\t"                        \
+           "xchgl %%ebx,%%esi"                \
+           : "=a" (eax),                      \
+             "=S" (ebx),                      \
+             "=c" (ecx),                      \
+             "=d" (edx)                       \
+           : "0" (op),                        \
+             "2" (count))
 #else
 #define cpuid(op,eax,ebx,ecx,edx)  \
   __asm__ ("cpuid"                 \
@@ -148,6 +163,14 @@ enum
              "=c" (ecx),           \
              "=d" (edx)            \
            : "0" (op))
+#define cpuid_count(op,count,eax,ebx,ecx,edx) \
+  __asm__ ("cpuid"                            \
+           : "=a" (eax),                      \
+             "=b" (ebx),                      \
+             "=c" (ecx),                      \
+             "=d" (edx)                       \
+           : "0" (op),                        \
+             "2" (count))
 #endif
 
 
@@ -261,6 +284,20 @@ arch_accel_intel (void)
 
     if (ecx & ARCH_X86_INTEL_FEATURE_AVX)
       caps |= GIMP_CPU_ACCEL_X86_AVX;
+
+    /*  AVX2 is reported in the extended feature flags of leaf 7  */
+    if (caps & GIMP_CPU_ACCEL_X86_AVX)
+      {
+        cpuid (0, eax, ebx, ecx, edx);
+
+        if (eax >= 7)
+          {
+            cpuid_count (7, 0, eax, ebx, ecx, edx);
+
+            if (ebx & ARCH_X86_INTEL_FEATURE_AVX2)
+              caps |= GIMP_CPU_ACCEL_X86_AVX2;
+          }
+      }
 #endif /* USE_SSE */
   }
 #endif /* USE_MMX */
@@ -41,6 +41,7 @@ typedef enum
   GIMP_CPU_ACCEL_X86_SSE4_1  = 0x00800000,
   GIMP_CPU_ACCEL_X86_SSE4_2  = 0x00400000,
   GIMP_CPU_ACCEL_X86_AVX     = 0x00200000,
+  GIMP_CPU_ACCEL_X86_AVX2    = 0x00100000,
 
   /* powerpc accelerations */
   GIMP_CPU_ACCEL_PPC_ALTIVEC = 0x04000000
@@ -52,6 +52,14 @@ static void _gp_tile_req_write           (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_tile_req_destroy         (GimpWireMessage  *msg);
 
+static void _gp_tile_req_multi_read      (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_req_multi_write     (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_req_multi_destroy   (GimpWireMessage  *msg);
+
 static void _gp_tile_ack_read            (GIOChannel       *channel,
                                           GimpWireMessage  *msg,
                                           gpointer          user_data);
@@ -68,6 +76,14 @@ static void _gp_tile_data_write          (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_tile_data_destroy        (GimpWireMessage  *msg);
 
+static void _gp_drawable_map_read        (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_drawable_map_write       (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_drawable_map_destroy     (GimpWireMessage  *msg);
+
 static void _gp_proc_run_read            (GIOChannel       *channel,
                                           GimpWireMessage  *msg,
                                           gpointer          user_data);
@@ -141,6 +157,30 @@ static void _gp_has_init_write           (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_has_init_destroy         (GimpWireMessage  *msg);
 
+static void _gp_persistent_read          (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_persistent_write         (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_persistent_destroy       (GimpWireMessage  *msg);
+
+static void _gp_proc_pure_read           (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_pure_write          (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_pure_destroy        (GimpWireMessage  *msg);
+
+static void _gp_proc_cache_flush_read    (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_cache_flush_write   (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_cache_flush_destroy (GimpWireMessage  *msg);
+
 
 
 void
@@ -198,6 +238,26 @@ gp_init (void)
                       _gp_has_init_read,
                       _gp_has_init_write,
                       _gp_has_init_destroy);
+  gimp_wire_register (GP_TILE_REQ_MULTI,
+                      _gp_tile_req_multi_read,
+                      _gp_tile_req_multi_write,
+                      _gp_tile_req_multi_destroy);
+  gimp_wire_register (GP_DRAWABLE_MAP,
+                      _gp_drawable_map_read,
+                      _gp_drawable_map_write,
+                      _gp_drawable_map_destroy);
+  gimp_wire_register (GP_PERSISTENT,
+                      _gp_persistent_read,
+                      _gp_persistent_write,
+                      _gp_persistent_destroy);
+  gimp_wire_register (GP_PROC_PURE,
+                      _gp_proc_pure_read,
+                      _gp_proc_pure_write,
+                      _gp_proc_pure_destroy);
+  gimp_wire_register (GP_PROC_CACHE_FLUSH,
+                      _gp_proc_cache_flush_read,
+                      _gp_proc_cache_flush_write,
+                      _gp_proc_cache_flush_destroy);
 }
 
 gboolean
@@ -256,6 +316,25 @@ gp_tile_req_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_tile_req_multi_write (GIOChannel     *channel,
+                         GPTileReqMulti *tile_req_multi,
+                         gpointer        user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_TILE_REQ_MULTI;
+  msg.data = tile_req_multi;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 gboolean
 gp_tile_ack_write (GIOChannel *channel,
                    gpointer    user_data)
@@ -293,6 +372,25 @@ gp_tile_data_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_drawable_map_write (GIOChannel    *channel,
+                       GPDrawableMap *drawable_map,
+                       gpointer       user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_DRAWABLE_MAP;
+  msg.data = drawable_map;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 gboolean
 gp_proc_run_write (GIOChannel *channel,
                    GPProcRun  *proc_run,
@@ -443,6 +541,58 @@ gp_has_init_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_persistent_write (GIOChannel *channel,
+                     gpointer    user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PERSISTENT;
+  msg.data = NULL;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_proc_pure_write (GIOChannel *channel,
+                    gpointer    user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_PURE;
+  msg.data = NULL;
+
+  /*  always followed by a GP_PROC_RETURN, don't flush  */
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_proc_cache_flush_write (GIOChannel *channel,
+                           gpointer    user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_CACHE_FLUSH;
+  msg.data = NULL;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 /*  quit  */
 
 static void
@@ -544,6 +694,13 @@ _gp_config_read (GIOChannel      *channel,
   if (! _gimp_wire_read_int32 (channel,
                                &config->timestamp, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &config->tile_cache_size, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &config->num_threads, 1,
+                               user_data))
+    goto cleanup;
 
   msg->data = config;
   return;
@@ -640,6 +797,14 @@ _gp_config_write (GIOChannel      *channel,
                                 (const guint32 *) &config->timestamp, 1,
                                 user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &config->tile_cache_size, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &config->num_threads, 1,
+                                user_data))
+    return;
 }
 
 static void
@@ -712,6 +877,80 @@ _gp_tile_req_destroy (GimpWireMessage *msg)
     g_slice_free (GPTileReq, msg->data);
 }
 
+/*  tile_req_multi  */
+
+static void
+_gp_tile_req_multi_read (GIOChannel      *channel,
+                         GimpWireMessage *msg,
+                         gpointer         user_data)
+{
+  GPTileReqMulti *tile_req_multi = g_slice_new0 (GPTileReqMulti);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &tile_req_multi->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_req_multi->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_req_multi->n_tiles, 1, user_data))
+    goto cleanup;
+
+  if (tile_req_multi->n_tiles > GP_TILE_SHM_N_TILES)
+    goto cleanup;
+
+  tile_req_multi->tile_nums = g_new (guint32, tile_req_multi->n_tiles);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               tile_req_multi->tile_nums,
+                               tile_req_multi->n_tiles, user_data))
+    goto cleanup;
+
+  msg->data = tile_req_multi;
+  return;
+
+ cleanup:
+  g_free (tile_req_multi->tile_nums);
+  g_slice_free (GPTileReqMulti, tile_req_multi);
+  msg->data = NULL;
+}
+
+static void
+_gp_tile_req_multi_write (GIOChannel      *channel,
+                          GimpWireMessage *msg,
+                          gpointer         user_data)
+{
+  GPTileReqMulti *tile_req_multi = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &tile_req_multi->drawable_ID,
+                                1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_req_multi->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_req_multi->n_tiles, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                tile_req_multi->tile_nums,
+                                tile_req_multi->n_tiles, user_data))
+    return;
+}
+
+static void
+_gp_tile_req_multi_destroy (GimpWireMessage *msg)
+{
+  GPTileReqMulti *tile_req_multi = msg->data;
+
+  if (tile_req_multi)
+    {
+      g_free (tile_req_multi->tile_nums);
+      g_slice_free (GPTileReqMulti, tile_req_multi);
+    }
+}
+
 /*  tile_ack  */
 
 static void
@@ -844,6 +1083,76 @@ _gp_tile_data_destroy (GimpWireMessage *msg)
     }
 }
 
+/*  drawable_map  */
+
+static void
+_gp_drawable_map_read (GIOChannel      *channel,
+                       GimpWireMessage *msg,
+                       gpointer         user_data)
+{
+  GPDrawableMap *drawable_map = g_slice_new0 (GPDrawableMap);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &drawable_map->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &drawable_map->shm_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &drawable_map->bpp, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &drawable_map->width, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &drawable_map->height, 1, user_data))
+    goto cleanup;
+
+  msg->data = drawable_map;
+  return;
+
+ cleanup:
+  g_slice_free (GPDrawableMap, drawable_map);
+  msg->data = NULL;
+}
+
+static void
+_gp_drawable_map_write (GIOChannel      *channel,
+                        GimpWireMessage *msg,
+                        gpointer         user_data)
+{
+  GPDrawableMap *drawable_map = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &drawable_map->drawable_ID,
+                                1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &drawable_map->shm_ID,
+                                1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &drawable_map->bpp, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &drawable_map->width, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &drawable_map->height, 1, user_data))
+    return;
+}
+
+static void
+_gp_drawable_map_destroy (GimpWireMessage *msg)
+{
+  GPDrawableMap *drawable_map = msg->data;
+
+  if (drawable_map)
+    g_slice_free (GPDrawableMap, drawable_map);
+}
+
 /*  proc_run  */
 
 static void
@@ -855,6 +1164,12 @@ _gp_proc_run_read (GIOChannel      *channel,
 
   if (! _gimp_wire_read_string (channel, &proc_run->name, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &proc_run->call_ID, 1, user_data))
+    {
+      g_free (proc_run->name);
+      goto cleanup;
+    }
 
   _gp_params_read (channel,
                    &proc_run->params, (guint *) &proc_run->nparams,
@@ -877,6 +1192,9 @@ _gp_proc_run_write (GIOChannel      *channel,
 
   if (! _gimp_wire_write_string (channel, &proc_run->name, 1, user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &proc_run->call_ID, 1, user_data))
+    return;
 
   _gp_params_write (channel, proc_run->params, proc_run->nparams, user_data);
 }
@@ -906,6 +1224,12 @@ _gp_proc_return_read (GIOChannel      *channel,
 
   if (! _gimp_wire_read_string (channel, &proc_return->name, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &proc_return->call_ID, 1, user_data))
+    {
+      g_free (proc_return->name);
+      goto cleanup;
+    }
 
   _gp_params_read (channel,
                    &proc_return->params, (guint *) &proc_return->nparams,
@@ -928,6 +1252,9 @@ _gp_proc_return_write (GIOChannel      *channel,
 
   if (! _gimp_wire_write_string (channel, &proc_return->name, 1, user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &proc_return->call_ID, 1, user_data))
+    return;
 
   _gp_params_write (channel,
                     proc_return->params, proc_return->nparams, user_data);
@@ -1881,3 +2208,66 @@ static void
 _gp_has_init_destroy (GimpWireMessage *msg)
 {
 }
+
+/* persistent */
+
+static void
+_gp_persistent_read (GIOChannel      *channel,
+                     GimpWireMessage *msg,
+                     gpointer         user_data)
+{
+}
+
+static void
+_gp_persistent_write (GIOChannel      *channel,
+                      GimpWireMessage *msg,
+                      gpointer         user_data)
+{
+}
+
+static void
+_gp_persistent_destroy (GimpWireMessage *msg)
+{
+}
+
+/* proc_pure */
+
+static void
+_gp_proc_pure_read (GIOChannel      *channel,
+                    GimpWireMessage *msg,
+                    gpointer         user_data)
+{
+}
+
+static void
+_gp_proc_pure_write (GIOChannel      *channel,
+                     GimpWireMessage *msg,
+                     gpointer         user_data)
+{
+}
+
+static void
+_gp_proc_pure_destroy (GimpWireMessage *msg)
+{
+}
+
+/* proc_cache_flush */
+
+static void
+_gp_proc_cache_flush_read (GIOChannel      *channel,
+                           GimpWireMessage *msg,
+                           gpointer         user_data)
+{
+}
+
+static void
+_gp_proc_cache_flush_write (GIOChannel      *channel,
+                            GimpWireMessage *msg,
+                            gpointer         user_data)
+{
+}
+
+static void
+_gp_proc_cache_flush_destroy (GimpWireMessage *msg)
+{
+}
@@ -26,7 +26,7 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x0016
+#define GIMP_PROTOCOL_VERSION  0x001D
 
 
 enum
@@ -43,14 +43,46 @@ enum
   GP_PROC_INSTALL,
   GP_PROC_UNINSTALL,
   GP_EXTENSION_ACK,
-  GP_HAS_INIT
+  GP_HAS_INIT,
+  GP_TILE_REQ_MULTI,
+  GP_DRAWABLE_MAP,
+  GP_PERSISTENT,
+  GP_PROC_PURE,
+  GP_PROC_CACHE_FLUSH
 };
 
 
+/* The shared memory used for transferring tiles has room for this
+ * many tiles of the largest pixel size.  A GP_TILE_REQ_MULTI
+ * requests at most this many tiles.
+ */
+#define GP_TILE_SHM_N_TILES  8
+
+/* A plug-in that sends GP_PERSISTENT before its GP_PROC_RETURN stays
+ * alive afterwards.  The core then either runs it again, by sending
+ * another GP_CONFIG and GP_PROC_RUN, or sends it GP_QUIT, or closes
+ * the pipe.
+ */
+
+/* The core sends GP_PROC_PURE before the GP_PROC_RETURN of a
+ * procedure that has no side effects, the plug-in may then cache the
+ * return values.  GP_PROC_CACHE_FLUSH tells the plug-in to drop all
+ * cached return values, it can arrive at any time.
+ */
+
+/* A GP_PROC_RETURN carries the call_ID of the GP_PROC_RUN it answers,
+ * so that a plug-in can have several calls on their way and match the
+ * return values to them, in whatever order they arrive.  The same
+ * goes for GP_TEMP_PROC_RUN and GP_TEMP_PROC_RETURN.
+ */
+
+
 typedef struct _GPConfig        GPConfig;
 typedef struct _GPTileReq       GPTileReq;
+typedef struct _GPTileReqMulti  GPTileReqMulti;
 typedef struct _GPTileAck       GPTileAck;
 typedef struct _GPTileData      GPTileData;
+typedef struct _GPDrawableMap   GPDrawableMap;
 typedef struct _GPParam         GPParam;
 typedef struct _GPParamDef      GPParamDef;
 typedef struct _GPProcRun       GPProcRun;
@@ -82,6 +114,8 @@ struct _GPConfig
   gchar   *display_name;
   gint32   monitor_number;
   guint32  timestamp;
+  guint32  tile_cache_size;  /* the core's tile cache size, in kilobytes */
+  gint32   num_threads;      /* how many threads the plug-in should use   */
 };
 
 struct _GPTileReq
@@ -91,6 +125,20 @@ struct _GPTileReq
   guint32  shadow;
 };
 
+/* Requests the data of several tiles of a drawable at once.  The core
+ * answers with one GP_TILE_DATA per tile, in the requested order, and
+ * the plug-in acknowledges all of them with a single GP_TILE_ACK.  When
+ * the tiles go through shared memory, they are laid out there back to
+ * back.
+ */
+struct _GPTileReqMulti
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  guint32  n_tiles;
+  guint32 *tile_nums;
+};
+
 struct _GPTileData
 {
   gint32   drawable_ID;
@@ -103,6 +151,22 @@ struct _GPTileData
   guchar  *data;
 };
 
+/* Asks the core to place a snapshot of all of a drawable's pixels in a
+ * shared memory segment of its own.  The plug-in sends it with shm_ID
+ * set to -1, the core answers with a GP_DRAWABLE_MAP that holds the
+ * segment's ID, or -1 if it could not create one.  After attaching to
+ * the segment, the plug-in sends a GP_TILE_ACK, and the core releases
+ * its side of the segment.
+ */
+struct _GPDrawableMap
+{
+  gint32   drawable_ID;
+  gint32   shm_ID;
+  guint32  bpp;
+  guint32  width;
+  guint32  height;
+};
+
 struct _GPParam
 {
   guint32 type;
@@ -153,6 +217,7 @@ struct _GPParamDef
 struct _GPProcRun
 {
   gchar   *name;
+  guint32  call_ID;
   guint32  nparams;
   GPParam *params;
 };
@@ -160,6 +225,7 @@ struct _GPProcRun
 struct _GPProcReturn
 {
   gchar   *name;
+  guint32  call_ID;
   guint32  nparams;
   GPParam *params;
 };
@@ -197,11 +263,17 @@ gboolean  gp_config_write           (GIOChannel      *channel,
 gboolean  gp_tile_req_write         (GIOChannel      *channel,
                                      GPTileReq       *tile_req,
                                      gpointer         user_data);
+gboolean  gp_tile_req_multi_write   (GIOChannel      *channel,
+                                     GPTileReqMulti  *tile_req_multi,
+                                     gpointer         user_data);
 gboolean  gp_tile_ack_write         (GIOChannel      *channel,
                                      gpointer         user_data);
 gboolean  gp_tile_data_write        (GIOChannel      *channel,
                                      GPTileData      *tile_data,
                                      gpointer         user_data);
+gboolean  gp_drawable_map_write     (GIOChannel      *channel,
+                                     GPDrawableMap   *drawable_map,
+                                     gpointer         user_data);
 gboolean  gp_proc_run_write         (GIOChannel      *channel,
                                      GPProcRun       *proc_run,
                                      gpointer         user_data);
@@ -224,6 +296,12 @@ gboolean  gp_extension_ack_write    (GIOChannel      *channel,
                                      gpointer         user_data);
 gboolean  gp_has_init_write         (GIOChannel      *channel,
                                      gpointer         user_data);
+gboolean  gp_persistent_write       (GIOChannel      *channel,
+                                     gpointer         user_data);
+gboolean  gp_proc_pure_write        (GIOChannel      *channel,
+                                     gpointer         user_data);
+gboolean  gp_proc_cache_flush_write (GIOChannel      *channel,
+                                     gpointer         user_data);
 
 void      gp_params_destroy         (GPParam         *params,
                                      gint             nparams);
@@ -27,6 +27,13 @@
 #include "gimpwire.h"
 
 
+/*  the number of values that are converted to and from wire byte
+ *  order at a time, so that arrays are sent and received in large
+ *  blocks instead of one value at a time
+ */
+#define WIRE_CHUNK_SIZE 256
+
+
 typedef struct _GimpWireHandler  GimpWireHandler;
 
 struct _GimpWireHandler
@@ -376,35 +383,24 @@ _gimp_wire_read_double (GIOChannel *channel,
                         gint        count,
                         gpointer    user_data)
 {
-  gdouble *t;
-  guint8   tmp[8];
-  gint     i;
-
   g_return_val_if_fail (count >= 0, FALSE);
 
-  t = (gdouble *) tmp;
-
-  for (i = 0; i < count; i++)
+  if (count > 0)
     {
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      gint j;
-#endif
+      gint i;
 
-      if (! _gimp_wire_read_int8 (channel, tmp, 8, user_data))
+      if (! _gimp_wire_read_int8 (channel,
+                                  (guint8 *) data, count * 8, user_data))
         return FALSE;
 
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      for (j = 0; j < 4; j++)
+      for (i = 0; i < count; i++)
         {
-          guint8 swap;
+          guint64 tmp;
 
-          swap       = tmp[j];
-          tmp[j]     = tmp[7 - j];
-          tmp[7 - j] = swap;
+          memcpy (&tmp, &data[i], 8);
+          tmp = GUINT64_FROM_BE (tmp);
+          memcpy (&data[i], &tmp, 8);
         }
-#endif
-
-      data[i] = *t;
     }
 
   return TRUE;
@@ -476,18 +472,21 @@ _gimp_wire_write_int32 (GIOChannel    *channel,
 {
   g_return_val_if_fail (count >= 0, FALSE);
 
-  if (count > 0)
+  while (count > 0)
     {
-      gint i;
+      guint32 tmp[WIRE_CHUNK_SIZE];
+      gint    n = MIN (count, WIRE_CHUNK_SIZE);
+      gint    i;
 
-      for (i = 0; i < count; i++)
-        {
-          guint32 tmp = g_htonl (data[i]);
+      for (i = 0; i < n; i++)
+        tmp[i] = g_htonl (data[i]);
 
-          if (! _gimp_wire_write_int8 (channel,
-                                       (const guint8 *) &tmp, 4, user_data))
-            return FALSE;
-        }
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tmp, n * 4, user_data))
+        return FALSE;
+
+      data  += n;
+      count -= n;
     }
 
   return TRUE;
@@ -501,18 +500,21 @@ _gimp_wire_write_int16 (GIOChannel    *channel,
 {
   g_return_val_if_fail (count >= 0, FALSE);
 
-  if (count > 0)
+  while (count > 0)
     {
-      gint i;
+      guint16 tmp[WIRE_CHUNK_SIZE];
+      gint    n = MIN (count, WIRE_CHUNK_SIZE);
+      gint    i;
 
-      for (i = 0; i < count; i++)
-        {
-          guint16 tmp = g_htons (data[i]);
+      for (i = 0; i < n; i++)
+        tmp[i] = g_htons (data[i]);
 
-          if (! _gimp_wire_write_int8 (channel,
-                                       (const guint8 *) &tmp, 2, user_data))
-            return FALSE;
-        }
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tmp, n * 2, user_data))
+        return FALSE;
+
+      data  += n;
+      count -= n;
     }
 
   return TRUE;
@@ -535,47 +537,25 @@ _gimp_wire_write_double (GIOChannel    *channel,
                          gint           count,
                          gpointer       user_data)
 {
-  gdouble *t;
-  guint8   tmp[8];
-  gint     i;
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-  gint     j;
-#endif
-
   g_return_val_if_fail (count >= 0, FALSE);
 
-  t = (gdouble *) tmp;
-
-  for (i = 0; i < count; i++)
+  while (count > 0)
     {
-      *t = data[i];
+      guint64 tmp[WIRE_CHUNK_SIZE];
+      gint    n = MIN (count, WIRE_CHUNK_SIZE);
+      gint    i;
 
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      for (j = 0; j < 4; j++)
-        {
-          guint8 swap;
+      memcpy (tmp, data, n * 8);
 
-          swap       = tmp[j];
-          tmp[j]     = tmp[7 - j];
-          tmp[7 - j] = swap;
-        }
-#endif
+      for (i = 0; i < n; i++)
+        tmp[i] = GUINT64_TO_BE (tmp[i]);
 
-      if (! _gimp_wire_write_int8 (channel, tmp, 8, user_data))
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tmp, n * 8, user_data))
         return FALSE;
 
-#if 0
-      {
-        gint k;
-
-        g_print ("Wire representation of %f:\t", data[i]);
-
-        for (k = 0; k < 8; k++)
-          g_print ("%02x ", tmp[k]);
-
-        g_print ("\n");
-      }
-#endif
+      data  += n;
+      count -= n;
     }
 
   return TRUE;
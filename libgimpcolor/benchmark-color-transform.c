@@ -0,0 +1,128 @@
+/* times gimp_color_transform_process_buffer() converting a large buffer
+ * from sRGB to Adobe RGB, at each bit depth lcms supports, with one
+ * thread and with as many threads as there are processors, and reports
+ * the throughput in Mpix/s.  meant to be run by "make benchmark".
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <babl/babl.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <glib-object.h>
+#include <cairo.h>
+
+#include "gimpcolor.h"
+
+
+#define SIZE     2048
+#define N_ROUNDS 4
+
+
+static const gchar *formats[] =
+{
+  "R'G'B'A u8",
+  "R'G'B'A u16",
+  "R'G'B'A half",
+  "R'G'B'A float"
+};
+
+
+static gdouble
+benchmark_format (GimpColorProfile *src_profile,
+                  GimpColorProfile *dest_profile,
+                  const Babl       *format,
+                  gint              n_threads)
+{
+  GimpColorTransform *transform;
+  GeglBuffer         *src;
+  GeglBuffer         *dest;
+  GeglColor          *color;
+  GTimer             *timer;
+  gdouble             elapsed;
+  gint                i;
+
+  g_object_set (gegl_config (), "threads", n_threads, NULL);
+
+  transform = gimp_color_transform_new (src_profile,  format,
+                                        dest_profile, format,
+                                        GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                                        GIMP_COLOR_TRANSFORM_FLAGS_BLACK_POINT_COMPENSATION);
+
+  if (! transform)
+    return 0.0;
+
+  src  = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE), format);
+  dest = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE), format);
+
+  color = gegl_color_new ("rgba(0.2, 0.4, 0.6, 0.8)");
+  gegl_buffer_set_color (src, NULL, color);
+  g_object_unref (color);
+
+  /*  warm up the buffers' tiles  */
+  gimp_color_transform_process_buffer (transform, src, NULL, dest, NULL);
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < N_ROUNDS; i++)
+    gimp_color_transform_process_buffer (transform, src, NULL, dest, NULL);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  g_object_unref (src);
+  g_object_unref (dest);
+  g_object_unref (transform);
+
+  return (gdouble) SIZE * SIZE * N_ROUNDS / elapsed / 1000000.0;
+}
+
+int
+main (void)
+{
+  GimpColorProfile *src_profile;
+  GimpColorProfile *dest_profile;
+  gint              n_threads;
+  gint              i;
+
+  gegl_init (NULL, NULL);
+
+  /*  time the lcms transforms, not the babl ones  */
+  g_setenv ("GIMP_COLOR_TRANSFORM_DISABLE_BABL", "1", TRUE);
+
+  src_profile  = gimp_color_profile_new_rgb_srgb ();
+  dest_profile = gimp_color_profile_new_rgb_adobe ();
+
+  n_threads = g_get_num_processors ();
+
+  g_print ("\nBenchmarking gimp_color_transform_process_buffer() ...\n\n");
+  g_print ("%-16s %14s %14s (%d threads)\n",
+           "format", "single", "parallel", n_threads);
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    {
+      const Babl *format = babl_format (formats[i]);
+      gdouble     single;
+      gdouble     multi;
+
+      single = benchmark_format (src_profile, dest_profile, format, 1);
+      multi  = benchmark_format (src_profile, dest_profile, format, n_threads);
+
+      g_print ("%-16s %7.1f Mpix/s %7.1f Mpix/s (%.1fx)\n",
+               formats[i], single, multi,
+               single > 0.0 ? multi / single : 0.0);
+    }
+
+  g_print ("\n");
+
+  g_object_unref (src_profile);
+  g_object_unref (dest_profile);
+
+  gegl_exit ();
+
+  return EXIT_SUCCESS;
+}
@@ -18,6 +18,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <babl/babl.h>
 #include <glib-object.h>
 
@@ -49,6 +51,12 @@
 /*********************************************************************/
 
 
+/*  bands of the area rendered by different threads are at least this
+ *  many rows high
+ */
+#define MIN_BAND_ROWS 16
+
+
 typedef struct _GimpSampleType GimpSampleType;
 
 struct _GimpSampleType
@@ -57,6 +65,69 @@ struct _GimpSampleType
   GimpRGB color;
 };
 
+typedef struct
+{
+  gint              x1;
+  gint              y1;
+  gint              x2;
+  gint              y2;
+  gint              max_depth;
+  gdouble           threshold;
+  gint              sub_pixel_size;
+  gint              row_size;
+  GimpRenderFunc    render_func;
+  gpointer          render_data;
+  GimpPutPixelFunc  put_pixel_func;
+  gpointer          put_pixel_data;
+} GimpSupersampleArea;
+
+/*  gimp_adaptive_supersample_area_parallel() splits the area into
+ *  horizontal bands.  the samples on the edges between bands are
+ *  rendered up front and shared by the bands above and below them
+ */
+typedef struct
+{
+  const GimpSupersampleArea *area;
+  gint                       n_bands;
+  GimpSampleType           **edges;
+
+  GThread                   *caller;
+  GimpProgressFunc           progress_func;
+  gpointer                   progress_data;
+  gint                       done_rows;   /* atomic */
+  gulong                     num_samples; /* protected by mutex */
+
+  GMutex                     mutex;
+  GCond                      cond;
+  gint                       n_remaining;
+} GimpSupersampleBands;
+
+typedef struct
+{
+  GimpSupersampleBands *bands;
+  gint                  band;
+} GimpSupersampleBand;
+
+
+static gulong   gimp_adaptive_supersample_rows         (const GimpSupersampleArea *area,
+                                                        gint                       y1,
+                                                        gint                       y2,
+                                                        const GimpSampleType      *top_edge,
+                                                        const GimpSampleType      *bottom_edge,
+                                                        GimpProgressFunc           progress_func,
+                                                        gpointer                   progress_data);
+static gulong   gimp_adaptive_supersample_band         (GimpSupersampleBands      *bands,
+                                                        gint                       band);
+static void     gimp_adaptive_supersample_band_thread  (GimpSupersampleBand       *band,
+                                                        gpointer                   user_data);
+static void     gimp_adaptive_supersample_band_progress (gint                      min,
+                                                         gint                      max,
+                                                         gint                      current,
+                                                         gpointer                  data);
+
+
+static GThreadPool *band_pool = NULL;
+
 
 static gulong
 gimp_render_sub_pixel (gint             max_depth,
@@ -238,6 +309,26 @@ gimp_render_sub_pixel (gint             max_depth,
   return num_samples;
 }
 
+/**
+ * gimp_adaptive_supersample_area:
+ * @x1:             left edge of the area
+ * @y1:             top edge of the area
+ * @x2:             right edge of the area, inclusive
+ * @y2:             bottom edge of the area, inclusive
+ * @max_depth:      maximal subdivision depth
+ * @threshold:      color distance above which a pixel is subdivided
+ * @render_func:    function rendering a single sample
+ * @render_data:    data passed to @render_func
+ * @put_pixel_func: function storing a finished pixel
+ * @put_pixel_data: data passed to @put_pixel_func
+ * @progress_func:  function called after each row, or %NULL
+ * @progress_data:  data passed to @progress_func
+ *
+ * Renders the area row by row, subdividing pixels whose corners
+ * differ by more than @threshold.
+ *
+ * Return value: the number of samples rendered.
+ **/
 gulong
 gimp_adaptive_supersample_area (gint              x1,
                                 gint              y1,
@@ -252,34 +343,234 @@ gimp_adaptive_supersample_area (gint              x1,
                                 GimpProgressFunc  progress_func,
                                 gpointer          progress_data)
 {
-  gint             x, y, width;                 /* Counters, width of region */
+  GimpSupersampleArea area;
+
+  g_return_val_if_fail (render_func != NULL, 0);
+  g_return_val_if_fail (put_pixel_func != NULL, 0);
+
+  area.x1             = x1;
+  area.y1             = y1;
+  area.x2             = x2;
+  area.y2             = y2;
+  area.max_depth      = max_depth;
+  area.threshold      = threshold;
+  area.sub_pixel_size = 1 << max_depth;
+  area.row_size       = area.sub_pixel_size * (x2 - x1 + 1) + 1;
+  area.render_func    = render_func;
+  area.render_data    = render_data;
+  area.put_pixel_func = put_pixel_func;
+  area.put_pixel_data = put_pixel_data;
+
+  return gimp_adaptive_supersample_rows (&area, y1, y2, NULL, NULL,
+                                         progress_func, progress_data);
+}
+
+/**
+ * gimp_adaptive_supersample_area_parallel:
+ * @x1:             left edge of the area
+ * @y1:             top edge of the area
+ * @x2:             right edge of the area, inclusive
+ * @y2:             bottom edge of the area, inclusive
+ * @max_depth:      maximal subdivision depth
+ * @threshold:      color distance above which a pixel is subdivided
+ * @n_threads:      the maximal number of threads to render with
+ * @render_func:    function rendering a single sample
+ * @render_data:    data passed to @render_func
+ * @put_pixel_func: function storing a finished pixel
+ * @put_pixel_data: data passed to @put_pixel_func
+ * @progress_func:  function called after each row, or %NULL
+ * @progress_data:  data passed to @progress_func
+ *
+ * Like gimp_adaptive_supersample_area(), but splits the area into
+ * horizontal bands which are rendered by up to @n_threads threads,
+ * and produces the same pixels.
+ *
+ * @render_func and @put_pixel_func are called concurrently, and must
+ * be thread-safe.  All the pixels of a row are put left to right, by
+ * the same thread.  @progress_func is only called from the calling
+ * thread, with the number of finished rows, in any order, in place of
+ * the current row.
+ *
+ * Return value: the number of samples rendered.
+ *
+ * Since: 2.10.10
+ **/
+gulong
+gimp_adaptive_supersample_area_parallel (gint              x1,
+                                         gint              y1,
+                                         gint              x2,
+                                         gint              y2,
+                                         gint              max_depth,
+                                         gdouble           threshold,
+                                         gint              n_threads,
+                                         GimpRenderFunc    render_func,
+                                         gpointer          render_data,
+                                         GimpPutPixelFunc  put_pixel_func,
+                                         gpointer          put_pixel_data,
+                                         GimpProgressFunc  progress_func,
+                                         gpointer          progress_data)
+{
+  GimpSupersampleArea   area;
+  GimpSupersampleBands  bands = { 0, };
+  GimpSupersampleBand  *band_data;
+  gulong                num_samples;
+  gint                  band;
+  gint                  i;
+
+  g_return_val_if_fail (render_func != NULL, 0);
+  g_return_val_if_fail (put_pixel_func != NULL, 0);
+
+  bands.n_bands = MIN (n_threads, (y2 - y1 + 1) / MIN_BAND_ROWS);
+
+  if (bands.n_bands <= 1)
+    return gimp_adaptive_supersample_area (x1, y1, x2, y2,
+                                           max_depth, threshold,
+                                           render_func, render_data,
+                                           put_pixel_func, put_pixel_data,
+                                           progress_func, progress_data);
+
+  area.x1             = x1;
+  area.y1             = y1;
+  area.x2             = x2;
+  area.y2             = y2;
+  area.max_depth      = max_depth;
+  area.threshold      = threshold;
+  area.sub_pixel_size = 1 << max_depth;
+  area.row_size       = area.sub_pixel_size * (x2 - x1 + 1) + 1;
+  area.render_func    = render_func;
+  area.render_data    = render_data;
+  area.put_pixel_func = put_pixel_func;
+  area.put_pixel_data = put_pixel_data;
+
+  bands.area          = &area;
+  bands.caller        = g_thread_self ();
+  bands.progress_func = progress_func;
+  bands.progress_data = progress_data;
+
+  /*  render the pixel corners on the edges between the bands, which
+   *  every pixel next to an edge needs, so neither band renders them
+   *  again.  they are rendered at the same coordinates as in
+   *  gimp_render_sub_pixel(), so the result doesn't change
+   */
+  bands.edges = g_new (GimpSampleType *, bands.n_bands - 1);
+
+  for (band = 1; band < bands.n_bands; band++)
+    {
+      GimpSampleType *edge = g_new0 (GimpSampleType, area.row_size);
+      gint            y;
+
+      y = y1 + (gint64) (y2 - y1 + 1) * band / bands.n_bands;
+
+      for (i = 0; i <= x2 - x1; i++)
+        {
+          GimpSampleType *sample = &edge[i * area.sub_pixel_size];
+
+          render_func ((x1 + i) - 0.5, y - 0.5, &sample->color, render_data);
+          sample->ready = TRUE;
+        }
+
+      render_func (x2 + 0.5, y - 0.5,
+                   &edge[area.row_size - 1].color, render_data);
+      edge[area.row_size - 1].ready = TRUE;
+
+      bands.edges[band - 1] = edge;
+      bands.num_samples    += x2 - x1 + 2;
+    }
+
+  if (g_once_init_enter (&band_pool))
+    {
+      GThreadPool *pool;
+
+      pool = g_thread_pool_new ((GFunc) gimp_adaptive_supersample_band_thread,
+                                NULL, -1, FALSE, NULL);
+
+      g_once_init_leave (&band_pool, pool);
+    }
+
+  g_mutex_init (&bands.mutex);
+  g_cond_init (&bands.cond);
+
+  bands.n_remaining = bands.n_bands - 1;
+
+  band_data = g_new (GimpSupersampleBand, bands.n_bands);
+
+  for (band = 1; band < bands.n_bands; band++)
+    {
+      band_data[band].bands = &bands;
+      band_data[band].band  = band;
+
+      g_thread_pool_push (band_pool, &band_data[band], NULL);
+    }
+
+  /*  the first band is rendered by the calling thread, which reports
+   *  the progress of all of them
+   */
+  num_samples = gimp_adaptive_supersample_band (&bands, 0);
+
+  g_mutex_lock (&bands.mutex);
+
+  bands.num_samples += num_samples;
+
+  while (bands.n_remaining > 0)
+    {
+      g_cond_wait (&bands.cond, &bands.mutex);
+
+      if (progress_func)
+        (* progress_func) (y1, y2,
+                           y1 + g_atomic_int_get (&bands.done_rows) - 1,
+                           progress_data);
+    }
+
+  g_mutex_unlock (&bands.mutex);
+
+  g_mutex_clear (&bands.mutex);
+  g_cond_clear (&bands.cond);
+
+  for (band = 0; band < bands.n_bands - 1; band++)
+    g_free (bands.edges[band]);
+
+  g_free (bands.edges);
+  g_free (band_data);
+
+  return bands.num_samples;
+}
+
+
+/*  private functions  */
+
+static gulong
+gimp_adaptive_supersample_rows (const GimpSupersampleArea *area,
+                                gint                       y1,
+                                gint                       y2,
+                                const GimpSampleType      *top_edge,
+                                const GimpSampleType      *bottom_edge,
+                                GimpProgressFunc           progress_func,
+                                gpointer                   progress_data)
+{
+  gint             x, y;                        /* Counters */
   gint             xt, xtt, yt;                 /* Temporary counters */
   gint             sub_pixel_size;              /* Number of samples per pixel (1D) */
+  gint             row_size;                    /* Number of samples per row */
   GimpRGB          color;                       /* Rendered pixel's color */
   GimpSampleType   tmp_sample;                  /* For swapping samples */
   GimpSampleType  *top_row, *bot_row, *tmp_row; /* Sample rows */
   GimpSampleType **block;                       /* Sample block matrix */
   gulong           num_samples;
 
-  g_return_val_if_fail (render_func != NULL, 0);
-  g_return_val_if_fail (put_pixel_func != NULL, 0);
-
   /* Initialize color */
 
   gimp_rgba_set (&color, 0.0, 0.0, 0.0, 0.0);
 
-  /* Calculate sub-pixel size */
-
-  sub_pixel_size = 1 << max_depth;
+  sub_pixel_size = area->sub_pixel_size;
 
   /* Create row arrays */
 
-  width = x2 - x1 + 1;
+  row_size = area->row_size;
 
-  top_row = g_new (GimpSampleType, sub_pixel_size * width + 1);
-  bot_row = g_new (GimpSampleType, sub_pixel_size * width + 1);
+  top_row = g_new (GimpSampleType, row_size);
+  bot_row = g_new (GimpSampleType, row_size);
 
-  for (x = 0; x < (sub_pixel_size * width + 1); x++)
+  for (x = 0; x < row_size; x++)
     {
       top_row[x].ready = FALSE;
 
@@ -290,6 +581,11 @@ gimp_adaptive_supersample_area (gint              x1,
       gimp_rgba_set (&bot_row[x].color, 0.0, 0.0, 0.0, 0.0);
     }
 
+  /* Start from the samples shared with the band above */
+
+  if (top_edge)
+    memcpy (top_row, top_edge, row_size * sizeof (GimpSampleType));
+
   /* Allocate block matrix */
 
   block = g_new (GimpSampleType *, sub_pixel_size + 1); /* Rows */
@@ -314,7 +610,7 @@ gimp_adaptive_supersample_area (gint              x1,
     {
       /* Clear the bottom row */
 
-      for (xt = 0; xt < (sub_pixel_size * width + 1); xt++)
+      for (xt = 0; xt < row_size; xt++)
         bot_row[xt].ready = FALSE;
 
       /* Clear first column */
@@ -324,7 +620,7 @@ gimp_adaptive_supersample_area (gint              x1,
 
       /* Render row */
 
-      for (x = x1; x <= x2; x++)
+      for (x = area->x1; x <= area->x2; x++)
         {
           /* Initialize block by clearing all but first row/column */
 
@@ -334,27 +630,41 @@ gimp_adaptive_supersample_area (gint              x1,
 
           /* Copy samples from top row to block */
 
-          for (xtt = 0, xt = (x - x1) * sub_pixel_size;
+          for (xtt = 0, xt = (x - area->x1) * sub_pixel_size;
                xtt < (sub_pixel_size + 1);
                xtt++, xt++)
             block[0][xtt] = top_row[xt];
 
+          /* Copy samples shared with the band below to block */
+
+          if (y == y2 && bottom_edge)
+            {
+              for (xtt = 0, xt = (x - area->x1) * sub_pixel_size;
+                   xtt < (sub_pixel_size + 1);
+                   xtt++, xt++)
+                {
+                  if (bottom_edge[xt].ready)
+                    block[sub_pixel_size][xtt] = bottom_edge[xt];
+                }
+            }
+
           /* Render pixel on (x, y) */
 
-          num_samples += gimp_render_sub_pixel (max_depth, 1, block, x, y, 0, 0,
+          num_samples += gimp_render_sub_pixel (area->max_depth, 1, block,
+                                                x, y, 0, 0,
                                                 sub_pixel_size, sub_pixel_size,
-                                                threshold, sub_pixel_size,
+                                                area->threshold, sub_pixel_size,
                                                 &color,
-                                                render_func, render_data);
+                                                area->render_func,
+                                                area->render_data);
 
-          if (put_pixel_func)
-            (* put_pixel_func) (x, y, &color, put_pixel_data);
+          (* area->put_pixel_func) (x, y, &color, area->put_pixel_data);
 
           /* Copy block information to rows */
 
-          top_row[(x - x1 + 1) * sub_pixel_size] = block[0][sub_pixel_size];
+          top_row[(x - area->x1 + 1) * sub_pixel_size] = block[0][sub_pixel_size];
 
-          for (xtt = 0, xt = (x - x1) * sub_pixel_size;
+          for (xtt = 0, xt = (x - area->x1) * sub_pixel_size;
                xtt < (sub_pixel_size + 1);
                xtt++, xt++)
             bot_row[xt] = block[sub_pixel_size][xtt];
@@ -392,3 +702,64 @@ gimp_adaptive_supersample_area (gint              x1,
 
   return num_samples;
 }
+
+static gulong
+gimp_adaptive_supersample_band (GimpSupersampleBands *bands,
+                                gint                  band)
+{
+  const GimpSupersampleArea *area   = bands->area;
+  gint                       height = area->y2 - area->y1 + 1;
+  gint                       y1;
+  gint                       y2;
+
+  y1 = area->y1 + (gint64) height * band       / bands->n_bands;
+  y2 = area->y1 + (gint64) height * (band + 1) / bands->n_bands - 1;
+
+  return gimp_adaptive_supersample_rows (area, y1, y2,
+                                         band > 0 ?
+                                         bands->edges[band - 1] : NULL,
+                                         band < bands->n_bands - 1 ?
+                                         bands->edges[band] : NULL,
+                                         gimp_adaptive_supersample_band_progress,
+                                         bands);
+}
+
+static void
+gimp_adaptive_supersample_band_thread (GimpSupersampleBand *band,
+                                       gpointer             user_data)
+{
+  GimpSupersampleBands *bands = band->bands;
+  gulong                num_samples;
+
+  num_samples = gimp_adaptive_supersample_band (bands, band->band);
+
+  g_mutex_lock (&bands->mutex);
+
+  bands->num_samples += num_samples;
+
+  bands->n_remaining--;
+  g_cond_signal (&bands->cond);
+
+  g_mutex_unlock (&bands->mutex);
+}
+
+static void
+gimp_adaptive_supersample_band_progress (gint     min,
+                                         gint     max,
+                                         gint     current,
+                                         gpointer data)
+{
+  GimpSupersampleBands *bands = data;
+  gint                  done_rows;
+
+  done_rows = g_atomic_int_add (&bands->done_rows, 1) + 1;
+
+  if (bands->progress_func && g_thread_self () == bands->caller)
+    {
+      const GimpSupersampleArea *area = bands->area;
+
+      (* bands->progress_func) (area->y1, area->y2,
+                                area->y1 + done_rows - 1,
+                                bands->progress_data);
+    }
+}
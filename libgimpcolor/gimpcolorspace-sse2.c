@@ -0,0 +1,304 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimpcolorspace-sse2.c
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gimpcolorspace-sse2.h"
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+#include <emmintrin.h>
+
+
+/*  the pixels are converted 4 at a time, transposed so that each
+ *  register holds one component of all 4 pixels.  the branches of the
+ *  scalar conversions become masks, and all of them are computed.
+ */
+
+#define SELECT(mask, a, b) \
+  _mm_or_ps (_mm_and_ps ((mask), (a)), _mm_andnot_ps ((mask), (b)))
+
+
+void
+gimp_rgb_to_hsv_array_sse2 (const gfloat *rgba,
+                            gfloat       *hsva,
+                            gint          n_pixels)
+{
+  const __m128 zero    = _mm_setzero_ps ();
+  const __m128 one     = _mm_set1_ps (1.0f);
+  const __m128 two     = _mm_set1_ps (2.0f);
+  const __m128 four    = _mm_set1_ps (4.0f);
+  const __m128 six     = _mm_set1_ps (6.0f);
+  const __m128 epsilon = _mm_set1_ps (0.0001f);
+  gint         i;
+
+  for (i = 0; i < n_pixels; i += 4, rgba += 16, hsva += 16)
+    {
+      __m128 r = _mm_loadu_ps (rgba + 0);
+      __m128 g = _mm_loadu_ps (rgba + 4);
+      __m128 b = _mm_loadu_ps (rgba + 8);
+      __m128 a = _mm_loadu_ps (rgba + 12);
+      __m128 max, min, delta, chroma;
+      __m128 h, s, hr, hg, hb;
+
+      _MM_TRANSPOSE4_PS (r, g, b, a);
+
+      max   = _mm_max_ps (r, _mm_max_ps (g, b));
+      min   = _mm_min_ps (r, _mm_min_ps (g, b));
+      delta = _mm_sub_ps (max, min);
+
+      chroma = _mm_cmpgt_ps (delta, epsilon);
+
+      s = _mm_and_ps (chroma,
+                      _mm_div_ps (delta, SELECT (chroma, max, one)));
+
+      delta = SELECT (chroma, delta, one);
+
+      hr = _mm_div_ps (_mm_sub_ps (g, b), delta);
+      hr = _mm_add_ps (hr, _mm_and_ps (_mm_cmplt_ps (hr, zero), six));
+      hg = _mm_add_ps (two,  _mm_div_ps (_mm_sub_ps (b, r), delta));
+      hb = _mm_add_ps (four, _mm_div_ps (_mm_sub_ps (r, g), delta));
+
+      h = SELECT (_mm_cmpeq_ps (r, max), hr,
+                  SELECT (_mm_cmpeq_ps (g, max), hg, hb));
+      h = _mm_and_ps (chroma, _mm_div_ps (h, six));
+
+      _MM_TRANSPOSE4_PS (h, s, max, a);
+
+      _mm_storeu_ps (hsva + 0,  h);
+      _mm_storeu_ps (hsva + 4,  s);
+      _mm_storeu_ps (hsva + 8,  max);
+      _mm_storeu_ps (hsva + 12, a);
+    }
+}
+
+void
+gimp_hsv_to_rgb_array_sse2 (const gfloat *hsva,
+                            gfloat       *rgba,
+                            gint          n_pixels)
+{
+  const __m128 zero  = _mm_setzero_ps ();
+  const __m128 one   = _mm_set1_ps (1.0f);
+  const __m128 two   = _mm_set1_ps (2.0f);
+  const __m128 three = _mm_set1_ps (3.0f);
+  const __m128 four  = _mm_set1_ps (4.0f);
+  const __m128 five  = _mm_set1_ps (5.0f);
+  const __m128 six   = _mm_set1_ps (6.0f);
+  gint         i;
+
+  for (i = 0; i < n_pixels; i += 4, hsva += 16, rgba += 16)
+    {
+      __m128 h = _mm_loadu_ps (hsva + 0);
+      __m128 s = _mm_loadu_ps (hsva + 4);
+      __m128 v = _mm_loadu_ps (hsva + 8);
+      __m128 a = _mm_loadu_ps (hsva + 12);
+      __m128 fi, f, w, q, t;
+      __m128 m0, m1, m2, m3, m4, m5;
+      __m128 gray;
+      __m128 r, g, b;
+
+      _MM_TRANSPOSE4_PS (h, s, v, a);
+
+      h = SELECT (_mm_cmpeq_ps (h, one), zero, h);
+      h = _mm_mul_ps (h, six);
+
+      fi = _mm_cvtepi32_ps (_mm_cvttps_epi32 (h));
+      fi = _mm_max_ps (_mm_min_ps (fi, five), zero);
+      f  = _mm_sub_ps (h, fi);
+
+      w = _mm_mul_ps (v, _mm_sub_ps (one, s));
+      q = _mm_mul_ps (v, _mm_sub_ps (one, _mm_mul_ps (s, f)));
+      t = _mm_mul_ps (v, _mm_sub_ps (one,
+                                     _mm_mul_ps (s, _mm_sub_ps (one, f))));
+
+      m0 = _mm_cmpeq_ps (fi, zero);
+      m1 = _mm_cmpeq_ps (fi, one);
+      m2 = _mm_cmpeq_ps (fi, two);
+      m3 = _mm_cmpeq_ps (fi, three);
+      m4 = _mm_cmpeq_ps (fi, four);
+      m5 = _mm_cmpeq_ps (fi, five);
+
+      r = SELECT (_mm_or_ps (m0, m5), v,
+                  SELECT (m1, q,
+                          SELECT (_mm_or_ps (m2, m3), w, t)));
+      g = SELECT (m0, t,
+                  SELECT (_mm_or_ps (m1, m2), v,
+                          SELECT (m3, q, w)));
+      b = SELECT (_mm_or_ps (m0, m1), w,
+                  SELECT (m2, t,
+                          SELECT (_mm_or_ps (m3, m4), v, q)));
+
+      gray = _mm_cmpeq_ps (s, zero);
+
+      r = SELECT (gray, v, r);
+      g = SELECT (gray, v, g);
+      b = SELECT (gray, v, b);
+
+      _MM_TRANSPOSE4_PS (r, g, b, a);
+
+      _mm_storeu_ps (rgba + 0,  r);
+      _mm_storeu_ps (rgba + 4,  g);
+      _mm_storeu_ps (rgba + 8,  b);
+      _mm_storeu_ps (rgba + 12, a);
+    }
+}
+
+void
+gimp_rgb_to_hsl_array_sse2 (const gfloat *rgba,
+                            gfloat       *hsla,
+                            gint          n_pixels)
+{
+  const __m128 zero      = _mm_setzero_ps ();
+  const __m128 half      = _mm_set1_ps (0.5f);
+  const __m128 one       = _mm_set1_ps (1.0f);
+  const __m128 two       = _mm_set1_ps (2.0f);
+  const __m128 four      = _mm_set1_ps (4.0f);
+  const __m128 six       = _mm_set1_ps (6.0f);
+  const __m128 undefined = _mm_set1_ps (-1.0f);
+  gint         i;
+
+  for (i = 0; i < n_pixels; i += 4, rgba += 16, hsla += 16)
+    {
+      __m128 r = _mm_loadu_ps (rgba + 0);
+      __m128 g = _mm_loadu_ps (rgba + 4);
+      __m128 b = _mm_loadu_ps (rgba + 8);
+      __m128 a = _mm_loadu_ps (rgba + 12);
+      __m128 max, min, sum, delta, chroma;
+      __m128 h, s, l, hr, hg, hb;
+      __m128 denom;
+
+      _MM_TRANSPOSE4_PS (r, g, b, a);
+
+      max   = _mm_max_ps (r, _mm_max_ps (g, b));
+      min   = _mm_min_ps (r, _mm_min_ps (g, b));
+      sum   = _mm_add_ps (max, min);
+      delta = _mm_sub_ps (max, min);
+
+      l = _mm_mul_ps (sum, half);
+
+      chroma = _mm_cmpneq_ps (max, min);
+
+      denom = SELECT (_mm_cmple_ps (l, half), sum,
+                      _mm_sub_ps (_mm_sub_ps (two, max), min));
+      denom = SELECT (chroma, denom, one);
+
+      s = _mm_and_ps (chroma, _mm_div_ps (delta, denom));
+
+      delta = SELECT (chroma, delta, one);
+
+      hr = _mm_div_ps (_mm_sub_ps (g, b), delta);
+      hg = _mm_add_ps (two,  _mm_div_ps (_mm_sub_ps (b, r), delta));
+      hb = _mm_add_ps (four, _mm_div_ps (_mm_sub_ps (r, g), delta));
+
+      h = SELECT (_mm_cmpeq_ps (r, max), hr,
+                  SELECT (_mm_cmpeq_ps (g, max), hg, hb));
+      h = _mm_div_ps (h, six);
+      h = _mm_add_ps (h, _mm_and_ps (_mm_cmplt_ps (h, zero), one));
+      h = SELECT (chroma, h, undefined);
+
+      _MM_TRANSPOSE4_PS (h, s, l, a);
+
+      _mm_storeu_ps (hsla + 0,  h);
+      _mm_storeu_ps (hsla + 4,  s);
+      _mm_storeu_ps (hsla + 8,  l);
+      _mm_storeu_ps (hsla + 12, a);
+    }
+}
+
+static inline __m128
+gimp_hsl_value_sse2 (__m128 n1,
+                     __m128 n2,
+                     __m128 hue)
+{
+  const __m128 zero  = _mm_setzero_ps ();
+  const __m128 one   = _mm_set1_ps (1.0f);
+  const __m128 three = _mm_set1_ps (3.0f);
+  const __m128 four  = _mm_set1_ps (4.0f);
+  const __m128 six   = _mm_set1_ps (6.0f);
+  __m128       d     = _mm_sub_ps (n2, n1);
+  __m128       up;
+  __m128       down;
+
+  hue = _mm_add_ps (_mm_sub_ps (hue,
+                                _mm_and_ps (_mm_cmpgt_ps (hue, six), six)),
+                    _mm_and_ps (_mm_cmplt_ps (hue, zero), six));
+
+  up   = _mm_add_ps (n1, _mm_mul_ps (d, hue));
+  down = _mm_add_ps (n1, _mm_mul_ps (d, _mm_sub_ps (four, hue)));
+
+  return SELECT (_mm_cmplt_ps (hue, one), up,
+                 SELECT (_mm_cmplt_ps (hue, three), n2,
+                         SELECT (_mm_cmplt_ps (hue, four), down, n1)));
+}
+
+void
+gimp_hsl_to_rgb_array_sse2 (const gfloat *hsla,
+                            gfloat       *rgba,
+                            gint          n_pixels)
+{
+  const __m128 zero = _mm_setzero_ps ();
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128 one  = _mm_set1_ps (1.0f);
+  const __m128 two  = _mm_set1_ps (2.0f);
+  const __m128 six  = _mm_set1_ps (6.0f);
+  gint         i;
+
+  for (i = 0; i < n_pixels; i += 4, hsla += 16, rgba += 16)
+    {
+      __m128 h = _mm_loadu_ps (hsla + 0);
+      __m128 s = _mm_loadu_ps (hsla + 4);
+      __m128 l = _mm_loadu_ps (hsla + 8);
+      __m128 a = _mm_loadu_ps (hsla + 12);
+      __m128 m1, m2;
+      __m128 gray;
+      __m128 r, g, b;
+
+      _MM_TRANSPOSE4_PS (h, s, l, a);
+
+      m2 = SELECT (_mm_cmple_ps (l, half),
+                   _mm_mul_ps (l, _mm_add_ps (one, s)),
+                   _mm_sub_ps (_mm_add_ps (l, s), _mm_mul_ps (l, s)));
+      m1 = _mm_sub_ps (_mm_mul_ps (two, l), m2);
+
+      h = _mm_mul_ps (h, six);
+
+      r = gimp_hsl_value_sse2 (m1, m2, _mm_add_ps (h, two));
+      g = gimp_hsl_value_sse2 (m1, m2, h);
+      b = gimp_hsl_value_sse2 (m1, m2, _mm_sub_ps (h, two));
+
+      gray = _mm_cmpeq_ps (s, zero);
+
+      r = SELECT (gray, l, r);
+      g = SELECT (gray, l, g);
+      b = SELECT (gray, l, b);
+
+      _MM_TRANSPOSE4_PS (r, g, b, a);
+
+      _mm_storeu_ps (rgba + 0,  r);
+      _mm_storeu_ps (rgba + 4,  g);
+      _mm_storeu_ps (rgba + 8,  b);
+      _mm_storeu_ps (rgba + 12, a);
+    }
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
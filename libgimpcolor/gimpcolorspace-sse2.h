@@ -0,0 +1,45 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimpcolorspace-sse2.h
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_COLOR_SPACE_SSE2_H__
+#define __GIMP_COLOR_SPACE_SSE2_H__
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+/*  these convert n_pixels, which must be a multiple of 4  */
+
+void   gimp_rgb_to_hsv_array_sse2 (const gfloat *rgba,
+                                   gfloat       *hsva,
+                                   gint          n_pixels);
+void   gimp_hsv_to_rgb_array_sse2 (const gfloat *hsva,
+                                   gfloat       *rgba,
+                                   gint          n_pixels);
+void   gimp_rgb_to_hsl_array_sse2 (const gfloat *rgba,
+                                   gfloat       *hsla,
+                                   gint          n_pixels);
+void   gimp_hsl_to_rgb_array_sse2 (const gfloat *hsla,
+                                   gfloat       *rgba,
+                                   gint          n_pixels);
+
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+
+#endif /* __GIMP_COLOR_SPACE_SSE2_H__ */
@@ -21,11 +21,13 @@
 #include <babl/babl.h>
 #include <glib-object.h>
 
+#include "libgimpbase/gimpbase.h"
 #include "libgimpmath/gimpmath.h"
 
 #include "gimpcolortypes.h"
 
 #include "gimpcolorspace.h"
+#include "gimpcolorspace-sse2.h"
 #include "gimprgb.h"
 #include "gimphsv.h"
 
@@ -47,6 +49,11 @@
 #define GIMP_HSV_UNDEFINED -1.0
 #define GIMP_HSL_UNDEFINED -1.0
 
+
+#if COMPILE_SSE2_INTRINISICS
+static gboolean   gimp_color_space_use_sse2 (void);
+#endif
+
 /*********************************
  *   color conversion routines   *
  *********************************/
@@ -404,6 +411,422 @@ gimp_cmyk_to_rgb (const GimpCMYK *cmyk,
 }
 
 
+/*  packed float array functions  */
+
+/**
+ * gimp_rgb_to_hsv_array:
+ * @rgba:     @n_pixels RGBA pixels, as 4 floats each
+ * @hsva:     returns the @n_pixels converted to HSVA, as 4 floats each
+ * @n_pixels: the number of pixels to convert
+ *
+ * Does the same conversion as gimp_rgb_to_hsv(), for a whole array of
+ * pixels at once, using SIMD instructions where available.  @rgba and
+ * @hsva may be the same buffer.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_rgb_to_hsv_array (const gfloat *rgba,
+                       gfloat       *hsva,
+                       gint          n_pixels)
+{
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+  g_return_if_fail (hsva != NULL || n_pixels == 0);
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_color_space_use_sse2 ())
+    {
+      gint n = n_pixels & ~3;
+
+      gimp_rgb_to_hsv_array_sse2 (rgba, hsva, n);
+
+      rgba     += 4 * n;
+      hsva     += 4 * n;
+      n_pixels -= n;
+    }
+#endif
+
+  while (n_pixels--)
+    {
+      gfloat r = rgba[0];
+      gfloat g = rgba[1];
+      gfloat b = rgba[2];
+      gfloat max, min, delta;
+
+      max = MAX (r, MAX (g, b));
+      min = MIN (r, MIN (g, b));
+
+      delta = max - min;
+
+      hsva[2] = max;
+
+      if (delta > 0.0001f)
+        {
+          gfloat h;
+
+          hsva[1] = delta / max;
+
+          if (r == max)
+            {
+              h = (g - b) / delta;
+              if (h < 0.0f)
+                h += 6.0f;
+            }
+          else if (g == max)
+            {
+              h = 2.0f + (b - r) / delta;
+            }
+          else
+            {
+              h = 4.0f + (r - g) / delta;
+            }
+
+          hsva[0] = h / 6.0f;
+        }
+      else
+        {
+          hsva[0] = 0.0f;
+          hsva[1] = 0.0f;
+        }
+
+      hsva[3] = rgba[3];
+
+      rgba += 4;
+      hsva += 4;
+    }
+}
+
+/**
+ * gimp_hsv_to_rgb_array:
+ * @hsva:     @n_pixels HSVA pixels, as 4 floats each
+ * @rgba:     returns the @n_pixels converted to RGBA, as 4 floats each
+ * @n_pixels: the number of pixels to convert
+ *
+ * Does the same conversion as gimp_hsv_to_rgb(), for a whole array of
+ * pixels at once, using SIMD instructions where available.  @hsva and
+ * @rgba may be the same buffer.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_hsv_to_rgb_array (const gfloat *hsva,
+                       gfloat       *rgba,
+                       gint          n_pixels)
+{
+  g_return_if_fail (hsva != NULL || n_pixels == 0);
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_color_space_use_sse2 ())
+    {
+      gint n = n_pixels & ~3;
+
+      gimp_hsv_to_rgb_array_sse2 (hsva, rgba, n);
+
+      hsva     += 4 * n;
+      rgba     += 4 * n;
+      n_pixels -= n;
+    }
+#endif
+
+  while (n_pixels--)
+    {
+      gfloat h = hsva[0];
+      gfloat s = hsva[1];
+      gfloat v = hsva[2];
+      gfloat a = hsva[3];
+
+      if (s == 0.0f)
+        {
+          rgba[0] = v;
+          rgba[1] = v;
+          rgba[2] = v;
+        }
+      else
+        {
+          gfloat f, w, q, t;
+          gint   i;
+
+          if (h == 1.0f)
+            h = 0.0f;
+
+          h *= 6.0f;
+
+          i = CLAMP ((gint) h, 0, 5);
+          f = h - i;
+          w = v * (1.0f - s);
+          q = v * (1.0f - s * f);
+          t = v * (1.0f - s * (1.0f - f));
+
+          switch (i)
+            {
+            case 0: rgba[0] = v; rgba[1] = t; rgba[2] = w; break;
+            case 1: rgba[0] = q; rgba[1] = v; rgba[2] = w; break;
+            case 2: rgba[0] = w; rgba[1] = v; rgba[2] = t; break;
+            case 3: rgba[0] = w; rgba[1] = q; rgba[2] = v; break;
+            case 4: rgba[0] = t; rgba[1] = w; rgba[2] = v; break;
+            case 5: rgba[0] = v; rgba[1] = w; rgba[2] = q; break;
+            }
+        }
+
+      rgba[3] = a;
+
+      hsva += 4;
+      rgba += 4;
+    }
+}
+
+/**
+ * gimp_rgb_to_hsl_array:
+ * @rgba:     @n_pixels RGBA pixels, as 4 floats each
+ * @hsla:     returns the @n_pixels converted to HSLA, as 4 floats each
+ * @n_pixels: the number of pixels to convert
+ *
+ * Does the same conversion as gimp_rgb_to_hsl(), for a whole array of
+ * pixels at once, using SIMD instructions where available.  Like
+ * there, the hue of achromatic pixels is -1.  @rgba and @hsla may be
+ * the same buffer.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_rgb_to_hsl_array (const gfloat *rgba,
+                       gfloat       *hsla,
+                       gint          n_pixels)
+{
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+  g_return_if_fail (hsla != NULL || n_pixels == 0);
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_color_space_use_sse2 ())
+    {
+      gint n = n_pixels & ~3;
+
+      gimp_rgb_to_hsl_array_sse2 (rgba, hsla, n);
+
+      rgba     += 4 * n;
+      hsla     += 4 * n;
+      n_pixels -= n;
+    }
+#endif
+
+  while (n_pixels--)
+    {
+      gfloat r = rgba[0];
+      gfloat g = rgba[1];
+      gfloat b = rgba[2];
+      gfloat max, min, l;
+
+      max = MAX (r, MAX (g, b));
+      min = MIN (r, MIN (g, b));
+
+      l = (max + min) / 2.0f;
+
+      if (max == min)
+        {
+          hsla[0] = GIMP_HSL_UNDEFINED;
+          hsla[1] = 0.0f;
+        }
+      else
+        {
+          gfloat delta = max - min;
+          gfloat h;
+
+          if (l <= 0.5f)
+            hsla[1] = delta / (max + min);
+          else
+            hsla[1] = delta / (2.0f - max - min);
+
+          if (r == max)
+            h = (g - b) / delta;
+          else if (g == max)
+            h = 2.0f + (b - r) / delta;
+          else
+            h = 4.0f + (r - g) / delta;
+
+          h /= 6.0f;
+
+          if (h < 0.0f)
+            h += 1.0f;
+
+          hsla[0] = h;
+        }
+
+      hsla[2] = l;
+      hsla[3] = rgba[3];
+
+      rgba += 4;
+      hsla += 4;
+    }
+}
+
+static inline gfloat
+gimp_hsl_value_float (gfloat n1,
+                      gfloat n2,
+                      gfloat hue)
+{
+  if (hue > 6.0f)
+    hue -= 6.0f;
+  else if (hue < 0.0f)
+    hue += 6.0f;
+
+  if (hue < 1.0f)
+    return n1 + (n2 - n1) * hue;
+  else if (hue < 3.0f)
+    return n2;
+  else if (hue < 4.0f)
+    return n1 + (n2 - n1) * (4.0f - hue);
+  else
+    return n1;
+}
+
+/**
+ * gimp_hsl_to_rgb_array:
+ * @hsla:     @n_pixels HSLA pixels, as 4 floats each
+ * @rgba:     returns the @n_pixels converted to RGBA, as 4 floats each
+ * @n_pixels: the number of pixels to convert
+ *
+ * Does the same conversion as gimp_hsl_to_rgb(), for a whole array of
+ * pixels at once, using SIMD instructions where available.  @hsla and
+ * @rgba may be the same buffer.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_hsl_to_rgb_array (const gfloat *hsla,
+                       gfloat       *rgba,
+                       gint          n_pixels)
+{
+  g_return_if_fail (hsla != NULL || n_pixels == 0);
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_color_space_use_sse2 ())
+    {
+      gint n = n_pixels & ~3;
+
+      gimp_hsl_to_rgb_array_sse2 (hsla, rgba, n);
+
+      hsla     += 4 * n;
+      rgba     += 4 * n;
+      n_pixels -= n;
+    }
+#endif
+
+  while (n_pixels--)
+    {
+      gfloat h = hsla[0];
+      gfloat s = hsla[1];
+      gfloat l = hsla[2];
+      gfloat a = hsla[3];
+
+      if (s == 0.0f)
+        {
+          rgba[0] = l;
+          rgba[1] = l;
+          rgba[2] = l;
+        }
+      else
+        {
+          gfloat m1, m2;
+
+          if (l <= 0.5f)
+            m2 = l * (1.0f + s);
+          else
+            m2 = l + s - l * s;
+
+          m1 = 2.0f * l - m2;
+
+          rgba[0] = gimp_hsl_value_float (m1, m2, h * 6.0f + 2.0f);
+          rgba[1] = gimp_hsl_value_float (m1, m2, h * 6.0f);
+          rgba[2] = gimp_hsl_value_float (m1, m2, h * 6.0f - 2.0f);
+        }
+
+      rgba[3] = a;
+
+      hsla += 4;
+      rgba += 4;
+    }
+}
+
+/**
+ * gimp_rgb_to_cmyk_array:
+ * @rgba:     @n_pixels RGBA pixels, as 4 floats each
+ * @pullout:  A scaling value (0-1) indicating how much black should be
+ *            pulled out
+ * @cmyka:    returns the @n_pixels converted to CMYKA, as 5 floats each
+ * @n_pixels: the number of pixels to convert
+ *
+ * Does the same conversion as gimp_rgb_to_cmyk(), for a whole array
+ * of pixels at once.  The loop is branch-free, so that the compiler
+ * can vectorize it.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_rgb_to_cmyk_array (const gfloat *rgba,
+                        gfloat        pullout,
+                        gfloat       *cmyka,
+                        gint          n_pixels)
+{
+  gint i;
+
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+  g_return_if_fail (cmyka != NULL || n_pixels == 0);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      gfloat c = 1.0f - rgba[4 * i + 0];
+      gfloat m = 1.0f - rgba[4 * i + 1];
+      gfloat y = 1.0f - rgba[4 * i + 2];
+      gfloat k = MIN (1.0f, MIN (c, MIN (m, y))) * pullout;
+      gfloat scale;
+
+      scale = k < 1.0f ? 1.0f / (1.0f - k) : 0.0f;
+
+      cmyka[5 * i + 0] = (c - k) * scale;
+      cmyka[5 * i + 1] = (m - k) * scale;
+      cmyka[5 * i + 2] = (y - k) * scale;
+      cmyka[5 * i + 3] = k;
+      cmyka[5 * i + 4] = rgba[4 * i + 3];
+    }
+}
+
+/**
+ * gimp_cmyk_to_rgb_array:
+ * @cmyka:    @n_pixels CMYKA pixels, as 5 floats each
+ * @rgba:     returns the @n_pixels converted to RGBA, as 4 floats each
+ * @n_pixels: the number of pixels to convert
+ *
+ * Does the same conversion as gimp_cmyk_to_rgb(), for a whole array
+ * of pixels at once.  The loop is branch-free, so that the compiler
+ * can vectorize it.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_cmyk_to_rgb_array (const gfloat *cmyka,
+                        gfloat       *rgba,
+                        gint          n_pixels)
+{
+  gint i;
+
+  g_return_if_fail (cmyka != NULL || n_pixels == 0);
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      gfloat k     = MIN (cmyka[5 * i + 3], 1.0f);
+      gfloat scale = 1.0f - k;
+
+      rgba[4 * i + 0] = 1.0f - (cmyka[5 * i + 0] * scale + k);
+      rgba[4 * i + 1] = 1.0f - (cmyka[5 * i + 1] * scale + k);
+      rgba[4 * i + 2] = 1.0f - (cmyka[5 * i + 2] * scale + k);
+      rgba[4 * i + 3] = cmyka[5 * i + 4];
+    }
+}
+
+
 #define GIMP_RETURN_RGB(x, y, z) { rgb->r = x; rgb->g = y; rgb->b = z; return; }
 
 /****************************************************************************
@@ -1101,3 +1524,21 @@ gimp_hsv_to_rgb4 (guchar  *rgb,
   rgb[1] = ROUND (saturation * 255.0);
   rgb[2] = ROUND (value      * 255.0);
 }
+
+
+/*  private functions  */
+
+#if COMPILE_SSE2_INTRINISICS
+
+static gboolean
+gimp_color_space_use_sse2 (void)
+{
+  static gint use_sse2 = -1;
+
+  if (use_sse2 < 0)
+    use_sse2 = (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2) != 0;
+
+  return use_sse2;
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
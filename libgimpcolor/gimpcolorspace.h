@@ -48,6 +48,30 @@ void   gimp_hsl_to_rgb          (const GimpHSL  *hsl,
 void   gimp_cmyk_to_rgb         (const GimpCMYK *cmyk,
                                  GimpRGB        *rgb);
 
+
+/*  packed float array functions  */
+
+void   gimp_rgb_to_hsv_array    (const gfloat   *rgba,
+                                 gfloat         *hsva,
+                                 gint            n_pixels);
+void   gimp_rgb_to_hsl_array    (const gfloat   *rgba,
+                                 gfloat         *hsla,
+                                 gint            n_pixels);
+void   gimp_rgb_to_cmyk_array   (const gfloat   *rgba,
+                                 gfloat          pullout,
+                                 gfloat         *cmyka,
+                                 gint            n_pixels);
+
+void   gimp_hsv_to_rgb_array    (const gfloat   *hsva,
+                                 gfloat         *rgba,
+                                 gint            n_pixels);
+void   gimp_hsl_to_rgb_array    (const gfloat   *hsla,
+                                 gfloat         *rgba,
+                                 gint            n_pixels);
+void   gimp_cmyk_to_rgb_array   (const gfloat   *cmyka,
+                                 gfloat         *rgba,
+                                 gint            n_pixels);
+
 GIMP_DEPRECATED
 void   gimp_rgb_to_hwb          (const GimpRGB  *rgb,
                                  gdouble        *hue,
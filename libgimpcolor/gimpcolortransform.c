@@ -23,6 +23,7 @@
 
 #include "config.h"
 
+#include <math.h>
 #include <string.h>
 
 #include <lcms2.h>
@@ -65,6 +66,33 @@ enum
 };
 
 
+/*  the number of nodes per dimension of the 3D lookup table  */
+#define LUT_SIZE 33
+
+/*  the smallest number of pixels worth processing in a thread of its own  */
+#define MIN_BAND_PIXELS (256 * 256)
+
+/*  the number of recently created transforms kept for reuse  */
+#define CACHE_SIZE 16
+
+
+/*  a 3D lookup table replacing an lcms transform from 8-bit or 16-bit
+ *  RGB(A) to float RGB(A), a combination lcms doesn't optimize.  the
+ *  nodes are spaced along a power curve, denser towards black, and the
+ *  table is evaluated by tetrahedral interpolation.
+ */
+typedef struct
+{
+  gint    src_bpc;        /* 1 or 2 */
+  gint    src_channels;   /* 3 or 4 */
+  gint    dest_channels;  /* 3 or 4 */
+  gfloat  alpha_scale;
+
+  gfloat *positions;      /* input value -> node position */
+  gfloat *nodes;          /* LUT_SIZE^3 RGB triplets, red major */
+} GimpColorTransformLut;
+
+
 struct _GimpColorTransformPrivate
 {
   GimpColorProfile *src_profile;
@@ -76,10 +104,71 @@ struct _GimpColorTransformPrivate
   const Babl       *dest_space_format;
 
   cmsHTRANSFORM     transform;
+
+  GimpColorTransformLut *lut;
 };
 
 
-static void   gimp_color_transform_finalize (GObject *object);
+/*  gimp_color_transform_process_buffer() splits the area into
+ *  horizontal bands, which are processed in parallel
+ */
+typedef struct
+{
+  GimpColorTransform *transform;
+  GeglBuffer         *src_buffer;
+  GeglRectangle       src_rect;
+  GeglBuffer         *dest_buffer;
+  GeglRectangle       dest_rect;
+  gint                n_bands;
+
+  GThread            *caller;
+  gint                total_pixels;
+  gint                done_pixels;   /* atomic */
+
+  GMutex              mutex;
+  GCond               cond;
+  gint                n_remaining;
+} GimpColorTransformBuffer;
+
+typedef struct
+{
+  GimpColorTransformBuffer *data;
+  gint                      band;
+} GimpColorTransformBand;
+
+
+static void   gimp_color_transform_finalize     (GObject                   *object);
+
+static void   gimp_color_transform_create_lut   (GimpColorTransform        *transform,
+                                                 cmsUInt32Number            lcms_src_format,
+                                                 cmsUInt32Number            lcms_dest_format,
+                                                 GimpColorTransformFlags    flags);
+static void   gimp_color_transform_free_lut     (GimpColorTransformLut     *lut);
+static void   gimp_color_transform_process_lut  (const GimpColorTransformLut *lut,
+                                                 gconstpointer              src,
+                                                 gpointer                   dest,
+                                                 gsize                      length);
+static void   gimp_color_transform_do_transform (GimpColorTransformPrivate *priv,
+                                                 gconstpointer              src,
+                                                 gpointer                   dest,
+                                                 gsize                      length);
+static void   gimp_color_transform_process_band (GimpColorTransformBuffer  *data,
+                                                 gint                       band);
+static void   gimp_color_transform_band_thread  (GimpColorTransformBand    *band,
+                                                 gpointer                   user_data);
+
+static gchar              * gimp_color_transform_cache_key    (GimpColorProfile         *src_profile,
+                                                               const Babl               *src_format,
+                                                               GimpColorProfile         *dest_profile,
+                                                               const Babl               *dest_format,
+                                                               GimpColorProfile         *proof_profile,
+                                                               GimpColorRenderingIntent  intent,
+                                                               GimpColorRenderingIntent  proof_intent,
+                                                               GimpColorTransformFlags   flags);
+static const gchar        * gimp_color_transform_checksum     (GimpColorProfile         *profile);
+static GimpColorTransform * gimp_color_transform_cache_lookup (const gchar              *key);
+static GimpColorTransform * gimp_color_transform_cache_insert (gchar                    *key,
+                                                               GimpColorTransform       *transform);
 
 
 G_DEFINE_TYPE (GimpColorTransform, gimp_color_transform,
@@ -91,6 +180,24 @@ static guint gimp_color_transform_signals[LAST_SIGNAL] = { 0 };
 
 static gchar *lcms_last_error = NULL;
 
+static GThreadPool *band_pool = NULL;
+
+/*  transforms are expensive to create, and the same ones are requested
+ *  over and over, by the displays, pickers, thumbnails and so on.  the
+ *  last CACHE_SIZE ones are therefore kept, keyed on everything they
+ *  are created from, and handed out again.  the least recently used
+ *  one is dropped first.
+ */
+static GMutex      cache_mutex;
+static GHashTable *cache     = NULL;  /* key -> link in cache_lru */
+static GQueue      cache_lru = G_QUEUE_INIT;
+
+typedef struct
+{
+  gchar              *key;
+  GimpColorTransform *transform;
+} GimpColorTransformCacheEntry;
+
 
 static void
 lcms_error_clear (void)
@@ -152,6 +259,7 @@ gimp_color_transform_finalize (GObject *object)
   g_clear_object (&transform->priv->dest_profile);
 
   g_clear_pointer (&transform->priv->transform, cmsDeleteTransform);
+  g_clear_pointer (&transform->priv->lut, gimp_color_transform_free_lut);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -168,6 +276,10 @@ gimp_color_transform_finalize (GObject *object)
  *
  * This function creates an color transform.
  *
+ * Transforms are cached, so the returned transform may be shared with
+ * other callers.  Handlers connected to its "progress" signal must be
+ * disconnected when done.
+ *
  * Return value: the #GimpColorTransform, or %NULL if no transform is needed
  *               to convert between pixels of @src_profile and @dest_profile.
  *
@@ -187,6 +299,7 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
   cmsHPROFILE                dest_lcms;
   cmsUInt32Number            lcms_src_format;
   cmsUInt32Number            lcms_dest_format;
+  gchar                     *key;
   GError                    *error = NULL;
 
   g_return_val_if_fail (GIMP_IS_COLOR_PROFILE (src_profile), NULL);
@@ -197,6 +310,20 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
   if (gimp_color_transform_can_gegl_copy (src_profile, dest_profile))
     return NULL;
 
+  key = gimp_color_transform_cache_key (src_profile,  src_format,
+                                        dest_profile, dest_format,
+                                        NULL,
+                                        rendering_intent, 0, flags);
+
+  transform = gimp_color_transform_cache_lookup (key);
+
+  if (transform)
+    {
+      g_free (key);
+
+      return transform;
+    }
+
   transform = g_object_new (GIMP_TYPE_COLOR_TRANSFORM, NULL);
 
   priv = transform->priv;
@@ -233,7 +360,8 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
                   G_STRFUNC,
                   gimp_color_profile_get_label (src_profile),
                   gimp_color_profile_get_label (dest_profile));
-      return transform;
+
+      return gimp_color_transform_cache_insert (key, transform);
     }
 
   priv->src_space_format  = NULL;
@@ -269,10 +397,16 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
   if (! priv->transform)
     {
       g_object_unref (transform);
-      transform = NULL;
+      g_free (key);
+
+      return NULL;
     }
 
-  return transform;
+  gimp_color_transform_create_lut (transform,
+                                   lcms_src_format, lcms_dest_format,
+                                   flags);
+
+  return gimp_color_transform_cache_insert (key, transform);
 }
 
 /**
@@ -288,6 +422,9 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
  *
  * This function creates a simulation / proofing color transform.
  *
+ * Like gimp_color_transform_new(), the returned transform may be
+ * shared with other callers.
+ *
  * Return value: the #GimpColorTransform, or %NULL.
  *
  * Since: 2.10
@@ -309,6 +446,7 @@ gimp_color_transform_new_proofing (GimpColorProfile         *src_profile,
   cmsHPROFILE                proof_lcms;
   cmsUInt32Number            lcms_src_format;
   cmsUInt32Number            lcms_dest_format;
+  gchar                     *key;
 
   g_return_val_if_fail (GIMP_IS_COLOR_PROFILE (src_profile), NULL);
   g_return_val_if_fail (src_format != NULL, NULL);
@@ -316,6 +454,20 @@ gimp_color_transform_new_proofing (GimpColorProfile         *src_profile,
   g_return_val_if_fail (dest_format != NULL, NULL);
   g_return_val_if_fail (GIMP_IS_COLOR_PROFILE (proof_profile), NULL);
 
+  key = gimp_color_transform_cache_key (src_profile,  src_format,
+                                        dest_profile, dest_format,
+                                        proof_profile,
+                                        display_intent, proof_intent, flags);
+
+  transform = gimp_color_transform_cache_lookup (key);
+
+  if (transform)
+    {
+      g_free (key);
+
+      return transform;
+    }
+
   transform = g_object_new (GIMP_TYPE_COLOR_TRANSFORM, NULL);
 
   priv = transform->priv;
@@ -354,10 +506,16 @@ gimp_color_transform_new_proofing (GimpColorProfile         *src_profile,
   if (! priv->transform)
     {
       g_object_unref (transform);
-      transform = NULL;
+      g_free (key);
+
+      return NULL;
     }
 
-  return transform;
+  gimp_color_transform_create_lut (transform,
+                                   lcms_src_format, lcms_dest_format,
+                                   flags);
+
+  return gimp_color_transform_cache_insert (key, transform);
 }
 
 /**
@@ -417,7 +575,7 @@ gimp_color_transform_process_pixels (GimpColorTransform *transform,
 
   if (priv->transform)
     {
-      cmsDoTransform (priv->transform, src, dest, length);
+      gimp_color_transform_do_transform (priv, src, dest, length);
     }
   else
     {
@@ -460,87 +618,80 @@ gimp_color_transform_process_buffer (GimpColorTransform  *transform,
                                      GeglBuffer          *dest_buffer,
                                      const GeglRectangle *dest_rect)
 {
-  GimpColorTransformPrivate *priv;
-  GeglBufferIterator        *iter;
-  gint                       total_pixels;
-  gint                       done_pixels = 0;
+  GimpColorTransformBuffer  data  = { 0, };
+  GimpColorTransformBand   *bands = NULL;
+  gint                      n_threads;
+  gint                      band;
 
   g_return_if_fail (GIMP_IS_COLOR_TRANSFORM (transform));
   g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
   g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
 
-  priv = transform->priv;
+  data.transform   = transform;
+  data.src_buffer  = src_buffer;
+  data.src_rect    = src_rect  ? *src_rect  :
+                                 *gegl_buffer_get_extent (src_buffer);
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = dest_rect ? *dest_rect :
+                                 *gegl_buffer_get_extent (dest_buffer);
+  data.caller      = g_thread_self ();
 
-  if (src_rect)
-    {
-      total_pixels = src_rect->width * src_rect->height;
-    }
-  else
-    {
-      total_pixels = (gegl_buffer_get_width  (src_buffer) *
-                      gegl_buffer_get_height (src_buffer));
-    }
+  data.total_pixels = data.src_rect.width * data.src_rect.height;
 
-  if (src_buffer != dest_buffer)
-    {
-      iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0,
-                                       priv->src_format,
-                                       GEGL_ACCESS_READ,
-                                       GEGL_ABYSS_NONE);
+  /*  use as many threads as GEGL does, without making the bands too
+   *  small to be worth it
+   */
+  g_object_get (gegl_config (), "threads", &n_threads, NULL);
 
-      gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
-                                priv->dest_format,
-                                GEGL_ACCESS_WRITE,
-                                GEGL_ABYSS_NONE);
+  data.n_bands = MIN (n_threads, data.total_pixels / MIN_BAND_PIXELS);
+  data.n_bands = CLAMP (data.n_bands, 1, data.src_rect.height);
 
-      while (gegl_buffer_iterator_next (iter))
+  if (data.n_bands > 1)
+    {
+      if (g_once_init_enter (&band_pool))
         {
-          if (priv->transform)
-            {
-              cmsDoTransform (priv->transform,
-                              iter->data[0], iter->data[1], iter->length);
-            }
-          else
-            {
-              babl_process (babl_fish (priv->src_space_format,
-                                       priv->dest_space_format),
-                            iter->data[0], iter->data[1], iter->length);
-            }
+          GThreadPool *pool;
 
-          done_pixels += iter->roi[0].width * iter->roi[0].height;
+          pool = g_thread_pool_new ((GFunc) gimp_color_transform_band_thread,
+                                    NULL, -1, FALSE, NULL);
 
-          g_signal_emit (transform, gimp_color_transform_signals[PROGRESS], 0,
-                         (gdouble) done_pixels /
-                         (gdouble) total_pixels);
+          g_once_init_leave (&band_pool, pool);
+        }
+
+      g_mutex_init (&data.mutex);
+      g_cond_init (&data.cond);
+
+      data.n_remaining = data.n_bands - 1;
+
+      bands = g_new (GimpColorTransformBand, data.n_bands);
+
+      for (band = 1; band < data.n_bands; band++)
+        {
+          bands[band].data = &data;
+          bands[band].band = band;
+
+          g_thread_pool_push (band_pool, &bands[band], NULL);
         }
     }
-  else
+
+  /*  the first band is processed by the calling thread, which is also
+   *  the only one emitting "progress"
+   */
+  gimp_color_transform_process_band (&data, 0);
+
+  if (data.n_bands > 1)
     {
-      iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0,
-                                       priv->src_format,
-                                       GEGL_ACCESS_READWRITE,
-                                       GEGL_ABYSS_NONE);
+      g_mutex_lock (&data.mutex);
 
-      while (gegl_buffer_iterator_next (iter))
-        {
-          if (priv->transform)
-            {
-              cmsDoTransform (priv->transform,
-                              iter->data[0], iter->data[0], iter->length);
-            }
-          else
-            {
-              babl_process (babl_fish (priv->src_space_format,
-                                       priv->dest_space_format),
-                            iter->data[0], iter->data[0], iter->length);
-            }
+      while (data.n_remaining > 0)
+        g_cond_wait (&data.cond, &data.mutex);
 
-          done_pixels += iter->roi[0].width * iter->roi[0].height;
+      g_mutex_unlock (&data.mutex);
 
-          g_signal_emit (transform, gimp_color_transform_signals[PROGRESS], 0,
-                         (gdouble) done_pixels /
-                         (gdouble) total_pixels);
-        }
+      g_mutex_clear (&data.mutex);
+      g_cond_clear (&data.cond);
+
+      g_free (bands);
     }
 
   g_signal_emit (transform, gimp_color_transform_signals[PROGRESS], 0,
@@ -598,3 +749,518 @@ gimp_color_transform_can_gegl_copy (GimpColorProfile *src_profile,
 
   return FALSE;
 }
+
+
+/*  private functions  */
+
+static gboolean
+gimp_color_transform_lut_format_ok (cmsUInt32Number format)
+{
+  return (T_COLORSPACE (format) == PT_RGB &&
+          T_CHANNELS (format)   == 3      &&
+          T_EXTRA (format)      <= 1      &&
+          ! T_PLANAR (format)             &&
+          ! T_DOSWAP (format)             &&
+          ! T_SWAPFIRST (format)          &&
+          ! T_ENDIAN16 (format)           &&
+          ! T_FLAVOR (format));
+}
+
+static void
+gimp_color_transform_create_lut (GimpColorTransform      *transform,
+                                 cmsUInt32Number          lcms_src_format,
+                                 cmsUInt32Number          lcms_dest_format,
+                                 GimpColorTransformFlags  flags)
+{
+  GimpColorTransformPrivate *priv = transform->priv;
+  GimpColorTransformLut     *lut;
+  const Babl                *model;
+  gint                       codes[LUT_SIZE];
+  gint                       max_value;
+  gdouble                    gamma;
+  gpointer                   src;
+  gfloat                     *dest;
+  gint                       n_nodes;
+  gint                       i, r, g, b;
+
+  /*  lcms optimizes transforms between integer formats itself, and the
+   *  callers asking for exactness or gamut checking get the real thing
+   */
+  if (flags & (GIMP_COLOR_TRANSFORM_FLAGS_NOOPTIMIZE |
+               GIMP_COLOR_TRANSFORM_FLAGS_GAMUT_CHECK))
+    return;
+
+  if (g_getenv ("GIMP_COLOR_TRANSFORM_DISABLE_LUT"))
+    return;
+
+  if (! gimp_color_transform_lut_format_ok (lcms_src_format)  ||
+      ! gimp_color_transform_lut_format_ok (lcms_dest_format) ||
+      T_FLOAT (lcms_src_format)                               ||
+      (T_BYTES (lcms_src_format) != 1 &&
+       T_BYTES (lcms_src_format) != 2)                        ||
+      ! T_FLOAT (lcms_dest_format)                            ||
+      T_BYTES (lcms_dest_format) != 4)
+    {
+      return;
+    }
+
+  lut = g_slice_new0 (GimpColorTransformLut);
+
+  lut->src_bpc       = T_BYTES (lcms_src_format);
+  lut->src_channels  = 3 + T_EXTRA (lcms_src_format);
+  lut->dest_channels = 3 + T_EXTRA (lcms_dest_format);
+
+  max_value        = (lut->src_bpc == 1) ? 255 : 65535;
+  lut->alpha_scale = 1.0f / max_value;
+
+  /*  space the nodes along a power curve, so that they are denser in
+   *  the shadows, where display transforms are steepest.  linear input
+   *  needs a stronger curve.
+   */
+  model = babl_format_get_model (priv->src_format);
+
+  if (model == babl_model ("RGB") || model == babl_model ("RGBA"))
+    gamma = 3.0;
+  else
+    gamma = 2.0;
+
+  for (i = 0; i < LUT_SIZE; i++)
+    {
+      codes[i] = floor (pow ((gdouble) i / (LUT_SIZE - 1), gamma) * max_value +
+                        0.5);
+
+      if (i > 0)
+        codes[i] = MAX (codes[i], codes[i - 1] + 1);
+    }
+
+  codes[LUT_SIZE - 1] = max_value;
+
+  lut->positions = g_new (gfloat, max_value + 1);
+
+  for (i = 0, r = 0; r <= max_value; r++)
+    {
+      while (i < LUT_SIZE - 2 && r >= codes[i + 1])
+        i++;
+
+      lut->positions[r] = i + (gfloat) (r - codes[i]) /
+                              (gfloat) (codes[i + 1] - codes[i]);
+    }
+
+  /*  run the nodes through lcms  */
+  n_nodes = LUT_SIZE * LUT_SIZE * LUT_SIZE;
+
+  src  = g_malloc (n_nodes * lut->src_channels * lut->src_bpc);
+  dest = g_new (gfloat, n_nodes * lut->dest_channels);
+
+  for (i = 0, r = 0; r < LUT_SIZE; r++)
+    for (g = 0; g < LUT_SIZE; g++)
+      for (b = 0; b < LUT_SIZE; b++, i++)
+        {
+          gint values[4];
+          gint c;
+
+          values[0] = codes[r];
+          values[1] = codes[g];
+          values[2] = codes[b];
+          values[3] = max_value;
+
+          for (c = 0; c < lut->src_channels; c++)
+            {
+              if (lut->src_bpc == 1)
+                ((guint8 *) src)[i * lut->src_channels + c] = values[c];
+              else
+                ((guint16 *) src)[i * lut->src_channels + c] = values[c];
+            }
+        }
+
+  cmsDoTransform (priv->transform, src, dest, n_nodes);
+
+  lut->nodes = g_new (gfloat, n_nodes * 3);
+
+  for (i = 0; i < n_nodes; i++)
+    {
+      lut->nodes[3 * i + 0] = dest[i * lut->dest_channels + 0];
+      lut->nodes[3 * i + 1] = dest[i * lut->dest_channels + 1];
+      lut->nodes[3 * i + 2] = dest[i * lut->dest_channels + 2];
+    }
+
+  g_free (src);
+  g_free (dest);
+
+  priv->lut = lut;
+}
+
+static void
+gimp_color_transform_free_lut (GimpColorTransformLut *lut)
+{
+  g_free (lut->positions);
+  g_free (lut->nodes);
+
+  g_slice_free (GimpColorTransformLut, lut);
+}
+
+static inline void
+gimp_color_transform_lut_eval (const GimpColorTransformLut *lut,
+                               gfloat                       fr,
+                               gfloat                       fg,
+                               gfloat                       fb,
+                               gfloat                      *out)
+{
+  const gint    sb = 3;
+  const gint    sg = 3 * LUT_SIZE;
+  const gint    sr = 3 * LUT_SIZE * LUT_SIZE;
+  const gfloat *c000;
+  gint          ir = MIN ((gint) fr, LUT_SIZE - 2);
+  gint          ig = MIN ((gint) fg, LUT_SIZE - 2);
+  gint          ib = MIN ((gint) fb, LUT_SIZE - 2);
+  gfloat        dr = fr - ir;
+  gfloat        dg = fg - ig;
+  gfloat        db = fb - ib;
+  gint          o1, o2;
+  gfloat        w1, w2, w3;
+  gint          c;
+
+  c000 = lut->nodes + ir * sr + ig * sg + ib * sb;
+
+  /*  pick the tetrahedron containing the point: walk from c000 to c111
+   *  along the axes, in order of decreasing fraction
+   */
+  if (dr >= dg)
+    {
+      if (dg >= db)
+        { o1 = sr;      o2 = sr + sg; w1 = dr; w2 = dg; w3 = db; }
+      else if (dr >= db)
+        { o1 = sr;      o2 = sr + sb; w1 = dr; w2 = db; w3 = dg; }
+      else
+        { o1 = sb;      o2 = sr + sb; w1 = db; w2 = dr; w3 = dg; }
+    }
+  else
+    {
+      if (db >= dg)
+        { o1 = sb;      o2 = sg + sb; w1 = db; w2 = dg; w3 = dr; }
+      else if (db >= dr)
+        { o1 = sg;      o2 = sg + sb; w1 = dg; w2 = db; w3 = dr; }
+      else
+        { o1 = sg;      o2 = sr + sg; w1 = dg; w2 = dr; w3 = db; }
+    }
+
+  for (c = 0; c < 3; c++)
+    {
+      out[c] = c000[c] +
+               w1 * (c000[o1 + c]           - c000[c])      +
+               w2 * (c000[o2 + c]           - c000[o1 + c]) +
+               w3 * (c000[sr + sg + sb + c] - c000[o2 + c]);
+    }
+}
+
+static void
+gimp_color_transform_process_lut (const GimpColorTransformLut *lut,
+                                  gconstpointer                src,
+                                  gpointer                     dest,
+                                  gsize                        length)
+{
+  const gint  src_channels  = lut->src_channels;
+  const gint  dest_channels = lut->dest_channels;
+  gfloat     *d             = dest;
+
+  if (lut->src_bpc == 1)
+    {
+      const guint8 *s = src;
+
+      while (length--)
+        {
+          gimp_color_transform_lut_eval (lut,
+                                         lut->positions[s[0]],
+                                         lut->positions[s[1]],
+                                         lut->positions[s[2]],
+                                         d);
+
+          if (dest_channels == 4)
+            d[3] = (src_channels == 4) ? s[3] * lut->alpha_scale : 1.0f;
+
+          s += src_channels;
+          d += dest_channels;
+        }
+    }
+  else
+    {
+      const guint16 *s = src;
+
+      while (length--)
+        {
+          gimp_color_transform_lut_eval (lut,
+                                         lut->positions[s[0]],
+                                         lut->positions[s[1]],
+                                         lut->positions[s[2]],
+                                         d);
+
+          if (dest_channels == 4)
+            d[3] = (src_channels == 4) ? s[3] * lut->alpha_scale : 1.0f;
+
+          s += src_channels;
+          d += dest_channels;
+        }
+    }
+}
+
+static void
+gimp_color_transform_do_transform (GimpColorTransformPrivate *priv,
+                                   gconstpointer              src,
+                                   gpointer                   dest,
+                                   gsize                      length)
+{
+  /*  the lut's source and destination formats differ, so the lut is
+   *  never used in-place
+   */
+  if (priv->lut && src != dest)
+    gimp_color_transform_process_lut (priv->lut, src, dest, length);
+  else
+    cmsDoTransform (priv->transform, src, dest, length);
+}
+
+static void
+gimp_color_transform_process_band (GimpColorTransformBuffer *data,
+                                   gint                      band)
+{
+  GimpColorTransformPrivate *priv = data->transform->priv;
+  GeglRectangle              src_rect;
+  GeglRectangle              dest_rect;
+  GeglBufferIterator        *iter;
+  gint                       y1;
+  gint                       y2;
+
+  y1 = (gint64) data->src_rect.height * band       / data->n_bands;
+  y2 = (gint64) data->src_rect.height * (band + 1) / data->n_bands;
+
+  src_rect         = data->src_rect;
+  src_rect.y      += y1;
+  src_rect.height  = y2 - y1;
+
+  dest_rect         = data->dest_rect;
+  dest_rect.y      += y1;
+  dest_rect.height  = y2 - y1;
+
+  /*  cmsDoTransform() only reads from the transform, and keeps its
+   *  one-pixel cache on the stack, so the bands can share it
+   */
+  if (data->src_buffer != data->dest_buffer)
+    {
+      iter = gegl_buffer_iterator_new (data->src_buffer, &src_rect, 0,
+                                       priv->src_format,
+                                       GEGL_ACCESS_READ,
+                                       GEGL_ABYSS_NONE);
+
+      gegl_buffer_iterator_add (iter, data->dest_buffer, &dest_rect, 0,
+                                priv->dest_format,
+                                GEGL_ACCESS_WRITE,
+                                GEGL_ABYSS_NONE);
+    }
+  else
+    {
+      iter = gegl_buffer_iterator_new (data->src_buffer, &src_rect, 0,
+                                       priv->src_format,
+                                       GEGL_ACCESS_READWRITE,
+                                       GEGL_ABYSS_NONE);
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gpointer dest = iter->data[data->src_buffer != data->dest_buffer];
+      gint     done_pixels;
+
+      if (priv->transform)
+        {
+          gimp_color_transform_do_transform (priv,
+                                             iter->data[0], dest,
+                                             iter->length);
+        }
+      else
+        {
+          babl_process (babl_fish (priv->src_space_format,
+                                   priv->dest_space_format),
+                        iter->data[0], dest, iter->length);
+        }
+
+      done_pixels = iter->roi[0].width * iter->roi[0].height;
+      done_pixels = g_atomic_int_add (&data->done_pixels, done_pixels) +
+                    done_pixels;
+
+      if (g_thread_self () == data->caller)
+        {
+          g_signal_emit (data->transform,
+                         gimp_color_transform_signals[PROGRESS], 0,
+                         (gdouble) done_pixels /
+                         (gdouble) data->total_pixels);
+        }
+    }
+}
+
+static void
+gimp_color_transform_band_thread (GimpColorTransformBand *band,
+                                  gpointer                user_data)
+{
+  GimpColorTransformBuffer *data = band->data;
+
+  gimp_color_transform_process_band (data, band->band);
+
+  g_mutex_lock (&data->mutex);
+
+  if (--data->n_remaining == 0)
+    g_cond_signal (&data->cond);
+
+  g_mutex_unlock (&data->mutex);
+}
+
+static gchar *
+gimp_color_transform_cache_key (GimpColorProfile         *src_profile,
+                                const Babl               *src_format,
+                                GimpColorProfile         *dest_profile,
+                                const Babl               *dest_format,
+                                GimpColorProfile         *proof_profile,
+                                GimpColorRenderingIntent  intent,
+                                GimpColorRenderingIntent  proof_intent,
+                                GimpColorTransformFlags   flags)
+{
+  gchar *key;
+
+  g_mutex_lock (&cache_mutex);
+
+  /*  babl formats are never freed, so their addresses identify them.
+   *  the environment variables change which kind of transform is
+   *  created, and are set by the tests.
+   */
+  key = g_strdup_printf ("%s %p %s %p %s %d %d %d %d %d",
+                         gimp_color_transform_checksum (src_profile),
+                         src_format,
+                         gimp_color_transform_checksum (dest_profile),
+                         dest_format,
+                         proof_profile ?
+                         gimp_color_transform_checksum (proof_profile) : "-",
+                         intent, proof_intent, flags,
+                         g_getenv ("GIMP_COLOR_TRANSFORM_DISABLE_BABL") != NULL,
+                         g_getenv ("GIMP_COLOR_TRANSFORM_DISABLE_LUT")  != NULL);
+
+  g_mutex_unlock (&cache_mutex);
+
+  return key;
+}
+
+/*  called with cache_mutex held  */
+static const gchar *
+gimp_color_transform_checksum (GimpColorProfile *profile)
+{
+  static GQuark  quark = 0;
+  gchar         *checksum;
+
+  if (! quark)
+    quark = g_quark_from_static_string ("gimp-color-transform-checksum");
+
+  checksum = g_object_get_qdata (G_OBJECT (profile), quark);
+
+  if (! checksum)
+    {
+      const gsize   header_len = sizeof (cmsICCHeader);
+      const guint8 *data;
+      gsize         length;
+
+      data = gimp_color_profile_get_icc_profile (profile, &length);
+
+      /*  ignore the header, like gimp_color_profile_is_equal()  */
+      if (length > header_len)
+        checksum = g_compute_checksum_for_data (G_CHECKSUM_MD5,
+                                                data + header_len,
+                                                length - header_len);
+      else
+        checksum = g_compute_checksum_for_data (G_CHECKSUM_MD5,
+                                                data, length);
+
+      g_object_set_qdata_full (G_OBJECT (profile), quark,
+                               checksum, g_free);
+    }
+
+  return checksum;
+}
+
+static GimpColorTransform *
+gimp_color_transform_cache_lookup (const gchar *key)
+{
+  GimpColorTransform *transform = NULL;
+
+  g_mutex_lock (&cache_mutex);
+
+  if (cache)
+    {
+      GList *link = g_hash_table_lookup (cache, key);
+
+      if (link)
+        {
+          GimpColorTransformCacheEntry *entry = link->data;
+
+          g_queue_unlink (&cache_lru, link);
+          g_queue_push_head_link (&cache_lru, link);
+
+          transform = g_object_ref (entry->transform);
+        }
+    }
+
+  g_mutex_unlock (&cache_mutex);
+
+  return transform;
+}
+
+/*  takes ownership of @key and @transform, and returns the cached
+ *  transform, which is a different one if another thread created the
+ *  same transform in the meantime
+ */
+static GimpColorTransform *
+gimp_color_transform_cache_insert (gchar              *key,
+                                   GimpColorTransform *transform)
+{
+  GList *link;
+
+  g_mutex_lock (&cache_mutex);
+
+  if (! cache)
+    cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  link = g_hash_table_lookup (cache, key);
+
+  if (link)
+    {
+      GimpColorTransformCacheEntry *entry = link->data;
+
+      g_object_unref (transform);
+      g_free (key);
+
+      transform = entry->transform;
+    }
+  else
+    {
+      GimpColorTransformCacheEntry *entry;
+
+      entry = g_slice_new (GimpColorTransformCacheEntry);
+
+      entry->key       = key;
+      entry->transform = transform;
+
+      g_queue_push_head (&cache_lru, entry);
+      g_hash_table_insert (cache, entry->key, cache_lru.head);
+
+      if (cache_lru.length > CACHE_SIZE)
+        {
+          entry = g_queue_pop_tail (&cache_lru);
+
+          g_hash_table_remove (cache, entry->key);
+
+          g_object_unref (entry->transform);
+          g_free (entry->key);
+          g_slice_free (GimpColorTransformCacheEntry, entry);
+        }
+    }
+
+  g_object_ref (transform);
+
+  g_mutex_unlock (&cache_mutex);
+
+  return transform;
+}
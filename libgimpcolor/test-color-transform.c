@@ -0,0 +1,217 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Spencer Kimball and Peter Mattis
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/* compares the lookup-table fast path of GimpColorTransform against the
+ * plain lcms transform, and reports the time taken by both
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+#include <babl/babl.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <glib-object.h>
+#include <cairo.h>
+
+#include "gimpcolor.h"
+
+
+#define N_PIXELS  (256 * 256)
+#define N_ROUNDS  16
+
+/*  the largest acceptable difference, in 8-bit steps  */
+#define MAX_ERROR 0.5
+
+
+typedef struct
+{
+  const gchar *src_format;
+  const gchar *dest_format;
+} FormatPair;
+
+static const FormatPair pairs[] =
+{
+  { "RGBA u16",     "R'G'B'A float" },
+  { "R'G'B'A u16",  "R'G'B'A float" },
+  { "R'G'B' u8",    "R'G'B'A float" },
+  { "R'G'B'A u8",   "R'G'B' float"  }
+};
+
+
+static GimpColorTransform *
+create_transform (GimpColorProfile *src_profile,
+                  const Babl       *src_format,
+                  GimpColorProfile *dest_profile,
+                  const Babl       *dest_format,
+                  gboolean          use_lut)
+{
+  GimpColorTransform *transform;
+
+  if (use_lut)
+    g_unsetenv ("GIMP_COLOR_TRANSFORM_DISABLE_LUT");
+  else
+    g_setenv ("GIMP_COLOR_TRANSFORM_DISABLE_LUT", "1", TRUE);
+
+  transform = gimp_color_transform_new (src_profile,  src_format,
+                                        dest_profile, dest_format,
+                                        GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                                        GIMP_COLOR_TRANSFORM_FLAGS_BLACK_POINT_COMPENSATION);
+
+  g_unsetenv ("GIMP_COLOR_TRANSFORM_DISABLE_LUT");
+
+  return transform;
+}
+
+static gdouble
+time_transform (GimpColorTransform *transform,
+                const Babl         *src_format,
+                gconstpointer       src,
+                const Babl         *dest_format,
+                gpointer            dest)
+{
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+  gint    i;
+
+  for (i = 0; i < N_ROUNDS; i++)
+    {
+      gimp_color_transform_process_pixels (transform,
+                                           src_format,  src,
+                                           dest_format, dest,
+                                           N_PIXELS);
+    }
+
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+static gint
+test_format_pair (GimpColorProfile *src_profile,
+                  GimpColorProfile *dest_profile,
+                  const FormatPair *pair,
+                  GRand            *grand)
+{
+  const Babl         *src_format  = babl_format (pair->src_format);
+  const Babl         *dest_format = babl_format (pair->dest_format);
+  GimpColorTransform *lcms;
+  GimpColorTransform *lut;
+  gint                src_bpp     = babl_format_get_bytes_per_pixel (src_format);
+  gint                n_channels  = babl_format_get_n_components (dest_format);
+  guint8             *src;
+  gfloat             *expected;
+  gfloat             *result;
+  gdouble             lcms_time;
+  gdouble             lut_time;
+  gdouble             max_error   = 0.0;
+  gint                i;
+
+  lcms = create_transform (src_profile, src_format,
+                           dest_profile, dest_format, FALSE);
+  lut  = create_transform (src_profile, src_format,
+                           dest_profile, dest_format, TRUE);
+
+  if (! lcms || ! lut)
+    {
+      g_print ("%s -> %s: failed to create the transforms\n",
+               pair->src_format, pair->dest_format);
+
+      g_clear_object (&lcms);
+      g_clear_object (&lut);
+
+      return 1;
+    }
+
+  src      = g_malloc (N_PIXELS * src_bpp);
+  expected = g_new (gfloat, N_PIXELS * n_channels);
+  result   = g_new (gfloat, N_PIXELS * n_channels);
+
+  for (i = 0; i < N_PIXELS * src_bpp; i++)
+    src[i] = g_rand_int_range (grand, 0, 256);
+
+  lcms_time = time_transform (lcms, src_format, src, dest_format, expected);
+  lut_time  = time_transform (lut,  src_format, src, dest_format, result);
+
+  for (i = 0; i < N_PIXELS * n_channels; i++)
+    max_error = MAX (max_error, fabs (result[i] - expected[i]));
+
+  g_print ("%s -> %s: max. error %.3f/255, lcms %.1f ms, lut %.1f ms\n",
+           pair->src_format, pair->dest_format,
+           max_error * 255.0,
+           1000.0 * lcms_time / N_ROUNDS,
+           1000.0 * lut_time  / N_ROUNDS);
+
+  g_free (src);
+  g_free (expected);
+  g_free (result);
+
+  g_object_unref (lcms);
+  g_object_unref (lut);
+
+  return max_error * 255.0 > MAX_ERROR;
+}
+
+int
+main (void)
+{
+  GimpColorProfile *src_profile;
+  GimpColorProfile *dest_profile;
+  GRand            *grand;
+  gint              failures = 0;
+  gint              i;
+
+  g_print ("\nTesting the GIMP color transform lookup tables ...\n");
+
+  gegl_init (NULL, NULL);
+
+  /*  the lookup tables are only used for lcms transforms  */
+  g_setenv ("GIMP_COLOR_TRANSFORM_DISABLE_BABL", "1", TRUE);
+
+  src_profile  = gimp_color_profile_new_rgb_srgb ();
+  dest_profile = gimp_color_profile_new_rgb_adobe ();
+
+  grand = g_rand_new_with_seed (0);
+
+  for (i = 0; i < G_N_ELEMENTS (pairs); i++)
+    failures += test_format_pair (src_profile, dest_profile, pairs + i, grand);
+
+  g_rand_free (grand);
+
+  g_object_unref (src_profile);
+  g_object_unref (dest_profile);
+
+  gegl_exit ();
+
+  if (failures)
+    {
+      g_print ("%d out of %d format pairs failed!\n\n",
+               failures, (int) G_N_ELEMENTS (pairs));
+      return EXIT_FAILURE;
+    }
+  else
+    {
+      g_print ("All %d format pairs passed.\n\n", (int) G_N_ELEMENTS (pairs));
+      return EXIT_SUCCESS;
+    }
+}
@@ -23,6 +23,10 @@
 
 #include <glib-object.h>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "gimpmath.h"
 
 
@@ -491,6 +495,162 @@ gimp_matrix3_transform_point (const GimpMatrix3 *matrix,
            matrix->coeff[1][2]) * w;
 }
 
+/*  the body of gimp_matrix3_transform_points(), which is inlined with
+ *  a constant @affine, so that the affine case gets its own loop
+ *  without the division
+ */
+static inline void
+gimp_matrix3_transform_points_internal (const GimpMatrix3 *matrix,
+                                        const GimpVector2 *points,
+                                        gint               n_points,
+                                        GimpVector2       *new_points,
+                                        const gboolean     affine)
+{
+  gint i;
+
+#if defined (__SSE2__)
+  /*  x and y of a point are transformed together, as the two halves
+   *  of a register
+   */
+  const __m128d c0 = _mm_set_pd (matrix->coeff[1][0], matrix->coeff[0][0]);
+  const __m128d c1 = _mm_set_pd (matrix->coeff[1][1], matrix->coeff[0][1]);
+  const __m128d c2 = _mm_set_pd (matrix->coeff[1][2], matrix->coeff[0][2]);
+
+  for (i = 0; i < n_points; i++)
+    {
+      const gdouble x = points[i].x;
+      const gdouble y = points[i].y;
+      __m128d       p;
+
+      p = _mm_add_pd (_mm_add_pd (_mm_mul_pd (c0, _mm_set1_pd (x)),
+                                  _mm_mul_pd (c1, _mm_set1_pd (y))),
+                      c2);
+
+      if (! affine)
+        {
+          gdouble w = (matrix->coeff[2][0] * x +
+                       matrix->coeff[2][1] * y +
+                       matrix->coeff[2][2]);
+
+          w = (w == 0.0) ? 1.0 : 1.0 / w;
+
+          p = _mm_mul_pd (p, _mm_set1_pd (w));
+        }
+
+      _mm_storeu_pd (&new_points[i].x, p);
+    }
+#else
+  for (i = 0; i < n_points; i++)
+    {
+      const gdouble x = points[i].x;
+      const gdouble y = points[i].y;
+      gdouble       w = 1.0;
+
+      if (! affine)
+        {
+          w = (matrix->coeff[2][0] * x +
+               matrix->coeff[2][1] * y +
+               matrix->coeff[2][2]);
+
+          w = (w == 0.0) ? 1.0 : 1.0 / w;
+        }
+
+      new_points[i].x = (matrix->coeff[0][0] * x +
+                         matrix->coeff[0][1] * y +
+                         matrix->coeff[0][2]) * w;
+      new_points[i].y = (matrix->coeff[1][0] * x +
+                         matrix->coeff[1][1] * y +
+                         matrix->coeff[1][2]) * w;
+    }
+#endif
+}
+
+/**
+ * gimp_matrix3_transform_points:
+ * @matrix:     The transformation matrix.
+ * @points:     An array of @n_points points.
+ * @n_points:   The number of points.
+ * @new_points: Returns the @n_points transformed points.
+ *
+ * Transforms an array of points, like gimp_matrix3_transform_point()
+ * does for a single one.  Affine matrices take a faster path without
+ * the perspective division.  @points and @new_points may be the same
+ * array.
+ *
+ * Since: 2.10.10
+ */
+void
+gimp_matrix3_transform_points (const GimpMatrix3 *matrix,
+                               const GimpVector2 *points,
+                               gint               n_points,
+                               GimpVector2       *new_points)
+{
+  g_return_if_fail (matrix != NULL);
+  g_return_if_fail (points != NULL || n_points == 0);
+  g_return_if_fail (new_points != NULL || n_points == 0);
+
+  if (matrix->coeff[2][0] == 0.0 &&
+      matrix->coeff[2][1] == 0.0 &&
+      matrix->coeff[2][2] == 1.0)
+    {
+      gimp_matrix3_transform_points_internal (matrix, points, n_points,
+                                              new_points, TRUE);
+    }
+  else
+    {
+      gimp_matrix3_transform_points_internal (matrix, points, n_points,
+                                              new_points, FALSE);
+    }
+}
+
+/**
+ * gimp_matrix3_transform_bounds:
+ * @matrix: The transformation matrix.
+ * @x1:     The left edge of the rectangle.
+ * @y1:     The top edge of the rectangle.
+ * @x2:     The right edge of the rectangle.
+ * @y2:     The bottom edge of the rectangle.
+ * @newx1:  Returns the left edge of the transformed bounding box.
+ * @newy1:  Returns the top edge of the transformed bounding box.
+ * @newx2:  Returns the right edge of the transformed bounding box.
+ * @newy2:  Returns the bottom edge of the transformed bounding box.
+ *
+ * Transforms the four corners of a rectangle, and returns the
+ * bounding box of the result.
+ *
+ * Since: 2.10.10
+ */
+void
+gimp_matrix3_transform_bounds (const GimpMatrix3 *matrix,
+                               gdouble            x1,
+                               gdouble            y1,
+                               gdouble            x2,
+                               gdouble            y2,
+                               gdouble           *newx1,
+                               gdouble           *newy1,
+                               gdouble           *newx2,
+                               gdouble           *newy2)
+{
+  GimpVector2 corners[4] = { { x1, y1 }, { x2, y1 }, { x1, y2 }, { x2, y2 } };
+
+  g_return_if_fail (matrix != NULL);
+
+  gimp_matrix3_transform_points (matrix, corners, 4, corners);
+
+  if (newx1)
+    *newx1 = MIN (MIN (corners[0].x, corners[1].x),
+                  MIN (corners[2].x, corners[3].x));
+  if (newy1)
+    *newy1 = MIN (MIN (corners[0].y, corners[1].y),
+                  MIN (corners[2].y, corners[3].y));
+  if (newx2)
+    *newx2 = MAX (MAX (corners[0].x, corners[1].x),
+                  MAX (corners[2].x, corners[3].x));
+  if (newy2)
+    *newy2 = MAX (MAX (corners[0].y, corners[1].y),
+                  MAX (corners[2].y, corners[3].y));
+}
+
 /**
  * gimp_matrix3_mult:
  * @matrix1: The first input matrix.
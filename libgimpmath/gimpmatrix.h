@@ -116,6 +116,21 @@ void          gimp_matrix3_transform_point (const GimpMatrix3 *matrix,
                                             gdouble            y,
                                             gdouble           *newx,
                                             gdouble           *newy);
+void          gimp_matrix3_transform_points
+                                           (const GimpMatrix3 *matrix,
+                                            const GimpVector2 *points,
+                                            gint               n_points,
+                                            GimpVector2       *new_points);
+void          gimp_matrix3_transform_bounds
+                                           (const GimpMatrix3 *matrix,
+                                            gdouble            x1,
+                                            gdouble            y1,
+                                            gdouble            x2,
+                                            gdouble            y2,
+                                            gdouble           *newx1,
+                                            gdouble           *newy1,
+                                            gdouble           *newx2,
+                                            gdouble           *newy2);
 
 
 /*****************/
@@ -1,5 +1,11 @@
 /*
  * gimp-thumbnail-list.c
+ *
+ * Lists the thumbnails in the thumbnail repository, or, given image
+ * files, checks (and with --create, creates) their thumbnails in a
+ * batch:
+ *
+ *   gimp-thumbnail-list [--create] [--threads=N] [IMAGE...]
  */
 
 #include <string.h>
@@ -21,11 +27,22 @@ static gboolean  parse_option_path  (const gchar  *option_name,
                                      GError      **error);
 static void      process_folder     (const gchar  *folder);
 static void      process_thumbnail  (const gchar  *filename);
+static void      process_images     (gchar       **images);
+static void      process_image      (GimpThumbnail *thumbnail,
+                                     GdkPixbuf     *pixbuf,
+                                     const GError  *error,
+                                     gpointer       data);
+static void      process_images_done (GObject      *source,
+                                      GAsyncResult *result,
+                                      gpointer      data);
 
 
 static GimpThumbState  option_state   = STATE_NONE;
 static gboolean        option_verbose = FALSE;
 static gchar          *option_path    = NULL;
+static gboolean        option_create  = FALSE;
+static gint            option_threads = 4;
+static gchar         **option_images  = NULL;
 
 
 static const GOptionEntry main_entries[] =
@@ -48,6 +65,21 @@ static const GOptionEntry main_entries[] =
     G_OPTION_ARG_NONE, &option_verbose,
     "Print additional info per matched file", NULL
   },
+  {
+    "create", 'c', 0,
+    G_OPTION_ARG_NONE, &option_create,
+    "Create the missing thumbnails of the given images", NULL
+  },
+  {
+    "threads", 't', 0,
+    G_OPTION_ARG_INT, &option_threads,
+    "Number of threads checking the given images (default: 4)", "<n>"
+  },
+  {
+    G_OPTION_REMAINING, 0, 0,
+    G_OPTION_ARG_FILENAME_ARRAY, &option_images,
+    NULL, NULL
+  },
   { NULL }
 };
 
@@ -66,7 +98,7 @@ main (gint   argc,
 
   thumb_folder = gimp_thumb_get_thumb_base_dir ();
 
-  context = g_option_context_new (NULL);
+  context = g_option_context_new ("[IMAGE...]");
   g_option_context_add_main_entries (context, main_entries, NULL);
 
   if (! g_option_context_parse (context, &argc, &argv, &error))
@@ -75,6 +107,13 @@ main (gint   argc,
       return -1;
     }
 
+  if (option_images)
+    {
+      process_images (option_images);
+
+      return 0;
+    }
+
   dir = g_dir_open (thumb_folder, 0, &error);
 
   if (! dir)
@@ -249,3 +288,90 @@ process_thumbnail (const gchar *filename)
 
   g_object_unref (thumbnail);
 }
+
+static void
+process_images (gchar **images)
+{
+  GMainLoop  *loop;
+  gchar     **uris;
+  gint        n_images = g_strv_length (images);
+  gint        i;
+
+  uris = g_new0 (gchar *, n_images + 1);
+
+  for (i = 0; i < n_images; i++)
+    {
+      GFile *file = g_file_new_for_commandline_arg (images[i]);
+
+      uris[i] = g_file_get_uri (file);
+
+      g_object_unref (file);
+    }
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  gimp_thumb_batch_async ((const gchar * const *) uris,
+                          option_create ?
+                          GIMP_THUMB_BATCH_CREATE : GIMP_THUMB_BATCH_LOAD,
+                          GIMP_THUMB_SIZE_NORMAL,
+                          NULL, NULL,
+                          "gimp-thumbnail-list",
+                          MAX (option_threads, 1),
+                          NULL,
+                          process_image, NULL,
+                          process_images_done, loop);
+
+  g_main_loop_run (loop);
+
+  g_main_loop_unref (loop);
+  g_strfreev (uris);
+}
+
+static void
+process_image (GimpThumbnail *thumbnail,
+               GdkPixbuf     *pixbuf,
+               const GError  *error,
+               gpointer       data)
+{
+  GEnumValue *state;
+
+  if (error)
+    {
+      if (option_state == STATE_ERROR)
+        {
+          if (option_verbose)
+            g_print ("%s '%s'\n", thumbnail->image_uri, error->message);
+          else
+            g_print ("%s\n", thumbnail->image_uri);
+        }
+
+      return;
+    }
+
+  if (option_state != STATE_NONE && thumbnail->thumb_state != option_state)
+    return;
+
+  if (option_path && ! strstr (thumbnail->image_uri, option_path))
+    return;
+
+  state = g_enum_get_value (g_type_class_peek (GIMP_TYPE_THUMB_STATE),
+                            thumbnail->thumb_state);
+
+  if (option_verbose)
+    g_print ("%s '%s' %s\n",
+             thumbnail->image_uri,
+             thumbnail->thumb_filename ? thumbnail->thumb_filename : "",
+             state ? state->value_nick : "");
+  else
+    g_print ("%s\n", thumbnail->image_uri);
+}
+
+static void
+process_images_done (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      data)
+{
+  gimp_thumb_batch_finish (result, NULL);
+
+  g_main_loop_quit (data);
+}
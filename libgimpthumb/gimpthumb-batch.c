@@ -0,0 +1,362 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * Thumbnail handling according to the Thumbnail Managing Standard.
+ * http://triq.net/~pearl/thumbnail-spec/
+ *
+ *  * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "gimpthumb-types.h"
+#include "gimpthumb-batch.h"
+#include "gimpthumb-error.h"
+#include "gimpthumbnail.h"
+
+#include "libgimp/libgimp-intl.h"
+
+
+/**
+ * SECTION: gimpthumb-batch
+ * @title: GimpThumb-batch
+ * @short_description: Checking and creating many thumbnails at once
+ *
+ * Functions to check, load and create the thumbnails of many files
+ * on worker threads, without blocking the caller.
+ **/
+
+
+typedef struct
+{
+  GimpThumbBatchMode   mode;
+  GimpThumbSize        size;
+  GimpThumbCreateFunc  create_func;
+  gpointer             create_data;
+  gchar               *software;
+  GimpThumbBatchFunc   callback;
+  gpointer             callback_data;
+
+  GMainContext        *context;
+  GThreadPool         *pool;
+  GTask               *task;
+  gint                 n_remaining;
+} GimpThumbBatch;
+
+typedef struct
+{
+  GimpThumbBatch *batch;
+  GimpThumbnail  *thumbnail;
+  GdkPixbuf      *pixbuf;
+  GError         *error;
+} GimpThumbBatchItem;
+
+
+static void       gimp_thumb_batch_item_thread (GimpThumbBatchItem *item,
+                                                GimpThumbBatch     *batch);
+static gboolean   gimp_thumb_batch_item_done   (GimpThumbBatchItem *item);
+static void       gimp_thumb_batch_free        (GimpThumbBatch     *batch);
+
+
+/*  public functions  */
+
+/**
+ * gimp_thumb_batch_async:
+ * @uris:          a %NULL-terminated array of escaped URIs
+ * @mode:          what to do for each URI
+ * @size:          the preferred size of the thumbnails
+ * @create_func:   function creating the missing thumbnails, or %NULL
+ *                 to use gimp_thumb_create_pixbuf()
+ * @create_data:   data passed to @create_func
+ * @software:      a string describing the software creating the
+ *                 thumbnails, used with %GIMP_THUMB_BATCH_CREATE
+ * @n_threads:     the number of worker threads
+ * @cancellable:   a #GCancellable, or %NULL
+ * @callback:      function called for each URI, or %NULL
+ * @callback_data: data passed to @callback
+ * @done_callback: function called when the batch is done
+ * @done_data:     data passed to @done_callback
+ *
+ * Checks the image files of @uris and their thumbnails on up to
+ * @n_threads worker threads, and depending on @mode, loads or
+ * creates the thumbnails too.
+ *
+ * @callback and @done_callback are called in the thread-default main
+ * context of the caller.  @callback is not called any more once
+ * @cancellable is cancelled.  Call gimp_thumb_batch_finish() from
+ * @done_callback.
+ *
+ * @create_func is called from the worker threads and must be
+ * thread-safe.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_thumb_batch_async (const gchar * const  *uris,
+                        GimpThumbBatchMode    mode,
+                        GimpThumbSize         size,
+                        GimpThumbCreateFunc   create_func,
+                        gpointer              create_data,
+                        const gchar          *software,
+                        gint                  n_threads,
+                        GCancellable         *cancellable,
+                        GimpThumbBatchFunc    callback,
+                        gpointer              callback_data,
+                        GAsyncReadyCallback   done_callback,
+                        gpointer              done_data)
+{
+  GimpThumbBatch *batch;
+  gint            i;
+
+  g_return_if_fail (uris != NULL);
+  g_return_if_fail (mode != GIMP_THUMB_BATCH_CREATE || software != NULL);
+  g_return_if_fail (n_threads > 0);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  batch = g_slice_new0 (GimpThumbBatch);
+
+  batch->mode          = mode;
+  batch->size          = size;
+  batch->create_func   = create_func ? create_func : gimp_thumb_create_pixbuf;
+  batch->create_data   = create_data;
+  batch->software      = g_strdup (software);
+  batch->callback      = callback;
+  batch->callback_data = callback_data;
+  batch->context       = g_main_context_ref_thread_default ();
+
+  batch->task = g_task_new (NULL, cancellable, done_callback, done_data);
+  g_task_set_source_tag (batch->task, gimp_thumb_batch_async);
+
+  batch->n_remaining = g_strv_length ((gchar **) uris);
+
+  if (batch->n_remaining == 0)
+    {
+      g_task_return_boolean (batch->task, TRUE);
+      gimp_thumb_batch_free (batch);
+
+      return;
+    }
+
+  batch->pool = g_thread_pool_new ((GFunc) gimp_thumb_batch_item_thread,
+                                   batch, n_threads, FALSE, NULL);
+
+  for (i = 0; uris[i]; i++)
+    {
+      GimpThumbBatchItem *item = g_slice_new0 (GimpThumbBatchItem);
+
+      item->batch     = batch;
+      item->thumbnail = gimp_thumbnail_new ();
+
+      gimp_thumbnail_set_uri (item->thumbnail, uris[i]);
+
+      g_thread_pool_push (batch->pool, item, NULL);
+    }
+}
+
+/**
+ * gimp_thumb_batch_finish:
+ * @result: the #GAsyncResult passed to the done callback
+ * @error:  return location for possible errors
+ *
+ * Finishes a batch started with gimp_thumb_batch_async().
+ *
+ * Return value: %TRUE if all the URIs were processed, %FALSE if the
+ *               batch was cancelled.
+ *
+ * Since: 2.10.10
+ **/
+gboolean
+gimp_thumb_batch_finish (GAsyncResult  *result,
+                         GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * gimp_thumb_create_pixbuf:
+ * @thumbnail: a #GimpThumbnail object
+ * @size:      the size of the thumbnail
+ * @user_data: unused
+ * @error:     return location for possible errors
+ *
+ * The default #GimpThumbCreateFunc, which creates the thumbnail of
+ * a local image using the formats known to GdkPixbuf.
+ *
+ * Return value: the thumbnail, or %NULL on failure.
+ *
+ * Since: 2.10.10
+ **/
+GdkPixbuf *
+gimp_thumb_create_pixbuf (GimpThumbnail  *thumbnail,
+                          GimpThumbSize   size,
+                          gpointer        user_data,
+                          GError        **error)
+{
+  GdkPixbufFormat *format;
+  GdkPixbuf       *pixbuf;
+  gchar           *filename;
+  gint             width;
+  gint             height;
+
+  g_return_val_if_fail (GIMP_IS_THUMBNAIL (thumbnail), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  filename = g_filename_from_uri (thumbnail->image_uri, NULL, error);
+
+  if (! filename)
+    return NULL;
+
+  format = gdk_pixbuf_get_file_info (filename, &width, &height);
+
+  if (! format)
+    {
+      gchar *utf8 = g_filename_display_name (filename);
+
+      g_set_error (error, GIMP_THUMB_ERROR, GIMP_THUMB_ERROR_OPEN,
+                   _("Could not open '%s'"), utf8);
+
+      g_free (utf8);
+      g_free (filename);
+
+      return NULL;
+    }
+
+  pixbuf = gdk_pixbuf_new_from_file_at_size (filename, size, size, error);
+
+  if (pixbuf)
+    {
+      gchar **mime_types = gdk_pixbuf_format_get_mime_types (format);
+      gchar  *type       = gdk_pixbuf_format_get_description (format);
+
+      g_object_set (thumbnail,
+                    "image-width",    width,
+                    "image-height",   height,
+                    "image-type",     type,
+                    "image-mimetype", mime_types ? mime_types[0] : NULL,
+                    NULL);
+
+      g_free (type);
+      g_strfreev (mime_types);
+    }
+
+  g_free (filename);
+
+  return pixbuf;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_thumb_batch_item_thread (GimpThumbBatchItem *item,
+                              GimpThumbBatch     *batch)
+{
+  GimpThumbnail *thumbnail = item->thumbnail;
+
+  if (g_cancellable_is_cancelled (g_task_get_cancellable (batch->task)))
+    {
+      /*  skip the remaining URIs, but still account for them  */
+    }
+  else if (batch->mode == GIMP_THUMB_BATCH_PEEK)
+    {
+      gimp_thumbnail_peek_image (thumbnail);
+    }
+  else
+    {
+      item->pixbuf = gimp_thumbnail_load_thumb (thumbnail, batch->size, NULL);
+
+      if (batch->mode == GIMP_THUMB_BATCH_CREATE            &&
+          thumbnail->thumb_state != GIMP_THUMB_STATE_OK     &&
+          thumbnail->image_state == GIMP_THUMB_STATE_EXISTS &&
+          ! gimp_thumbnail_has_failed (thumbnail))
+        {
+          GdkPixbuf *pixbuf;
+
+          g_clear_object (&item->pixbuf);
+
+          pixbuf = batch->create_func (thumbnail, batch->size,
+                                       batch->create_data, &item->error);
+
+          if (pixbuf)
+            {
+              if (gimp_thumbnail_save_thumb (thumbnail, pixbuf,
+                                             batch->software, &item->error))
+                {
+                  gimp_thumbnail_delete_failure (thumbnail);
+
+                  item->pixbuf = gimp_thumbnail_load_thumb (thumbnail,
+                                                            batch->size,
+                                                            NULL);
+                }
+
+              g_object_unref (pixbuf);
+            }
+          else
+            {
+              gimp_thumbnail_save_failure (thumbnail, batch->software, NULL);
+            }
+        }
+    }
+
+  g_main_context_invoke (batch->context,
+                         (GSourceFunc) gimp_thumb_batch_item_done,
+                         item);
+}
+
+static gboolean
+gimp_thumb_batch_item_done (GimpThumbBatchItem *item)
+{
+  GimpThumbBatch *batch = item->batch;
+
+  if (batch->callback &&
+      ! g_cancellable_is_cancelled (g_task_get_cancellable (batch->task)))
+    {
+      batch->callback (item->thumbnail, item->pixbuf, item->error,
+                       batch->callback_data);
+    }
+
+  g_object_unref (item->thumbnail);
+  g_clear_object (&item->pixbuf);
+  g_clear_error (&item->error);
+
+  g_slice_free (GimpThumbBatchItem, item);
+
+  if (--batch->n_remaining == 0)
+    {
+      g_task_return_boolean (batch->task, TRUE);
+      gimp_thumb_batch_free (batch);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_thumb_batch_free (GimpThumbBatch *batch)
+{
+  if (batch->pool)
+    g_thread_pool_free (batch->pool, FALSE, FALSE);
+
+  g_object_unref (batch->task);
+  g_main_context_unref (batch->context);
+  g_free (batch->software);
+
+  g_slice_free (GimpThumbBatch, batch);
+}
@@ -0,0 +1,91 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * Thumbnail handling according to the Thumbnail Managing Standard.
+ * http://triq.net/~pearl/thumbnail-spec/
+ *
+ *  * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__GIMP_THUMB_H_INSIDE__) && !defined (GIMP_THUMB_COMPILATION)
+#error "Only <libgimpthumb/gimpthumb.h> can be included directly."
+#endif
+
+#ifndef __GIMP_THUMB_BATCH_H__
+#define __GIMP_THUMB_BATCH_H__
+
+G_BEGIN_DECLS
+
+
+/**
+ * GimpThumbBatchFunc:
+ * @thumbnail: the #GimpThumbnail of one of the URIs
+ * @pixbuf:    the URI's thumbnail, or %NULL
+ * @error:     the error creating the thumbnail, or %NULL
+ * @user_data: the data passed to gimp_thumb_batch_async()
+ *
+ * Called for each URI of a batch, in the order they are done.
+ *
+ * Since: 2.10.10
+ **/
+typedef void        (* GimpThumbBatchFunc)  (GimpThumbnail  *thumbnail,
+                                             GdkPixbuf      *pixbuf,
+                                             const GError   *error,
+                                             gpointer        user_data);
+
+/**
+ * GimpThumbCreateFunc:
+ * @thumbnail: the #GimpThumbnail of one of the URIs
+ * @size:      the size of the thumbnail to create
+ * @user_data: the data passed to gimp_thumb_batch_async()
+ * @error:     return location for possible errors
+ *
+ * Renders the thumbnail of an image, and can set the image properties
+ * of @thumbnail stored with it.  Called from worker threads.
+ *
+ * Return value: the thumbnail, or %NULL on failure.
+ *
+ * Since: 2.10.10
+ **/
+typedef GdkPixbuf * (* GimpThumbCreateFunc) (GimpThumbnail  *thumbnail,
+                                             GimpThumbSize   size,
+                                             gpointer        user_data,
+                                             GError        **error);
+
+
+void        gimp_thumb_batch_async    (const gchar * const  *uris,
+                                       GimpThumbBatchMode    mode,
+                                       GimpThumbSize         size,
+                                       GimpThumbCreateFunc   create_func,
+                                       gpointer              create_data,
+                                       const gchar          *software,
+                                       gint                  n_threads,
+                                       GCancellable         *cancellable,
+                                       GimpThumbBatchFunc    callback,
+                                       gpointer              callback_data,
+                                       GAsyncReadyCallback   done_callback,
+                                       gpointer              done_data);
+gboolean    gimp_thumb_batch_finish   (GAsyncResult         *result,
+                                       GError              **error);
+
+GdkPixbuf * gimp_thumb_create_pixbuf  (GimpThumbnail        *thumbnail,
+                                       GimpThumbSize         size,
+                                       gpointer              user_data,
+                                       GError              **error);
+
+
+G_END_DECLS
+
+#endif /* __GIMP_THUMB_BATCH_H__ */
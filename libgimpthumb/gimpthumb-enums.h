@@ -37,6 +37,28 @@ G_BEGIN_DECLS
  **/
 
 
+/**
+ * GimpThumbBatchMode:
+ * @GIMP_THUMB_BATCH_PEEK:   only check the image files
+ * @GIMP_THUMB_BATCH_LOAD:   also load the valid thumbnails
+ * @GIMP_THUMB_BATCH_CREATE: also create the missing and outdated thumbnails
+ *
+ * What gimp_thumb_batch_async() does for each file.
+ *
+ * Since: 2.10.10
+ **/
+#define GIMP_TYPE_THUMB_BATCH_MODE (gimp_thumb_batch_mode_get_type ())
+
+GType gimp_thumb_batch_mode_get_type (void) G_GNUC_CONST;
+
+typedef enum
+{
+  GIMP_THUMB_BATCH_PEEK,
+  GIMP_THUMB_BATCH_LOAD,
+  GIMP_THUMB_BATCH_CREATE
+} GimpThumbBatchMode;
+
+
 /**
  * GimpThumbFileType:
  * @GIMP_THUMB_FILE_TYPE_NONE:    file does not exist
@@ -841,8 +841,10 @@ gimp_thumb_png_lookup (const gchar   *name,
 static const gchar *
 gimp_thumb_png_name (const gchar *uri)
 {
-  static gchar name[40];
+  /*  thumbnails are looked up from gimp_thumb_batch_async()'s threads  */
+  static GPrivate  name_private = G_PRIVATE_INIT (g_free);
 
+  gchar     *name;
   GChecksum *checksum;
   guchar     digest[16];
   gsize      len = sizeof (digest);
@@ -853,6 +855,14 @@ gimp_thumb_png_name (const gchar *uri)
   g_checksum_get_digest (checksum, digest, &len);
   g_checksum_free (checksum);
 
+  name = g_private_get (&name_private);
+
+  if (! name)
+    {
+      name = g_malloc (40);
+      g_private_set (&name_private, name);
+    }
+
   for (i = 0; i < len; i++)
     {
       guchar n;
@@ -28,6 +28,7 @@
 #include "gimpwidgets.h"
 
 #include "gimppreview.h"
+#include "gimppreview-private.h"
 
 #include "libgimp/libgimp-intl.h"
 
@@ -61,7 +62,14 @@ enum
 
 typedef struct
 {
-  GtkWidget *controls;
+  GtkWidget      *controls;
+
+  /*  the part of the preview not covered by the last rendering, in
+   *  preview coordinates, or NULL for all of it
+   */
+  cairo_region_t *invalid_region;
+  GCancellable   *cancellable;
+  gboolean        rendering;
 } GimpPreviewPrivate;
 
 #define GIMP_PREVIEW_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIMP_TYPE_PREVIEW, GimpPreviewPrivate))
@@ -100,6 +108,7 @@ static void      gimp_preview_toggle_callback     (GtkWidget        *toggle,
 
 static void      gimp_preview_notify_checks       (GimpPreview      *preview);
 
+static void      gimp_preview_queue_invalidate    (GimpPreview      *preview);
 static gboolean  gimp_preview_invalidate_now      (GimpPreview      *preview);
 static void      gimp_preview_real_set_cursor     (GimpPreview      *preview);
 static void      gimp_preview_real_transform      (GimpPreview      *preview,
@@ -178,6 +187,7 @@ gimp_preview_class_init (GimpPreviewClass *klass)
   klass->set_cursor               = gimp_preview_real_set_cursor;
   klass->transform                = gimp_preview_real_transform;
   klass->untransform              = gimp_preview_real_untransform;
+  klass->draw_area                = NULL;
 
   g_type_class_add_private (object_class, sizeof (GimpPreviewPrivate));
 
@@ -227,6 +237,9 @@ gimp_preview_init (GimpPreview *preview)
 
   preview->timeout_id = 0;
 
+  priv->invalid_region = NULL;
+  priv->cancellable    = g_cancellable_new ();
+
   preview->xmin   = preview->ymin = 0;
   preview->xmax   = preview->ymax = 1;
   preview->width  = preview->xmax - preview->xmin;
@@ -304,7 +317,8 @@ gimp_preview_init (GimpPreview *preview)
 static void
 gimp_preview_dispose (GObject *object)
 {
-  GimpPreview *preview = GIMP_PREVIEW (object);
+  GimpPreview        *preview = GIMP_PREVIEW (object);
+  GimpPreviewPrivate *priv    = GIMP_PREVIEW_GET_PRIVATE (preview);
 
   if (preview->timeout_id)
     {
@@ -312,6 +326,9 @@ gimp_preview_dispose (GObject *object)
       preview->timeout_id = 0;
     }
 
+  g_clear_pointer (&priv->invalid_region, cairo_region_destroy);
+  g_clear_object (&priv->cancellable);
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -481,16 +498,52 @@ gimp_preview_notify_checks (GimpPreview *preview)
   gimp_preview_invalidate (preview);
 }
 
+static void
+gimp_preview_queue_invalidate (GimpPreview *preview)
+{
+  if (preview->update_preview)
+    {
+      if (preview->timeout_id)
+        g_source_remove (preview->timeout_id);
+
+      preview->timeout_id =
+        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, PREVIEW_TIMEOUT,
+                            (GSourceFunc) gimp_preview_invalidate_now,
+                            preview, NULL);
+    }
+}
+
 static gboolean
 gimp_preview_invalidate_now (GimpPreview *preview)
 {
-  GtkWidget        *toplevel = gtk_widget_get_toplevel (GTK_WIDGET (preview));
-  GimpPreviewClass *class    = GIMP_PREVIEW_GET_CLASS (preview);
-
-  gimp_preview_draw (preview);
+  GimpPreviewPrivate *priv     = GIMP_PREVIEW_GET_PRIVATE (preview);
+  GtkWidget          *toplevel = gtk_widget_get_toplevel (GTK_WIDGET (preview));
+  GimpPreviewClass   *class    = GIMP_PREVIEW_GET_CLASS (preview);
 
   preview->timeout_id = 0;
 
+  /*  an "invalidated" handler iterating the main loop must not get
+   *  called again from within, retry once it returned
+   */
+  if (priv->rendering)
+    {
+      gimp_preview_queue_invalidate (preview);
+
+      return FALSE;
+    }
+
+  /*  after a scroll, the exposed strips already show the original  */
+  if (! priv->invalid_region)
+    gimp_preview_draw (preview);
+
+  if (g_cancellable_is_cancelled (priv->cancellable))
+    {
+      g_object_unref (priv->cancellable);
+      priv->cancellable = g_cancellable_new ();
+    }
+
+  priv->rendering = TRUE;
+
   if (toplevel && gtk_widget_get_realized (toplevel))
     {
       gdk_window_set_cursor (gtk_widget_get_window (toplevel),
@@ -510,6 +563,14 @@ gimp_preview_invalidate_now (GimpPreview *preview)
       g_signal_emit (preview, preview_signals[INVALIDATED], 0);
     }
 
+  priv->rendering = FALSE;
+
+  /*  unless the rendering was cancelled, what is shown is current now  */
+  g_clear_pointer (&priv->invalid_region, cairo_region_destroy);
+
+  if (! g_cancellable_is_cancelled (priv->cancellable))
+    priv->invalid_region = cairo_region_create ();
+
   return FALSE;
 }
 
@@ -748,7 +809,11 @@ gimp_preview_get_area (GimpPreview  *preview)
 void
 gimp_preview_draw (GimpPreview *preview)
 {
-  GimpPreviewClass *class = GIMP_PREVIEW_GET_CLASS (preview);
+  GimpPreviewPrivate *priv  = GIMP_PREVIEW_GET_PRIVATE (preview);
+  GimpPreviewClass   *class = GIMP_PREVIEW_GET_CLASS (preview);
+
+  /*  the original replaces whatever was rendered  */
+  g_clear_pointer (&priv->invalid_region, cairo_region_destroy);
 
   if (class->draw)
     class->draw (preview);
@@ -791,23 +856,89 @@ gimp_preview_draw_buffer (GimpPreview  *preview,
  * toplevel window containing the @preview and on the preview area
  * itself.
  *
+ * If the signal is currently being emitted, the preview's cancellable
+ * is cancelled, see gimp_preview_get_cancellable().
+ *
  * Since: 2.2
  **/
 void
 gimp_preview_invalidate (GimpPreview *preview)
 {
+  GimpPreviewPrivate *priv;
+
   g_return_if_fail (GIMP_IS_PREVIEW (preview));
 
-  if (preview->update_preview)
-    {
-      if (preview->timeout_id)
-        g_source_remove (preview->timeout_id);
+  priv = GIMP_PREVIEW_GET_PRIVATE (preview);
 
-      preview->timeout_id =
-        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, PREVIEW_TIMEOUT,
-                            (GSourceFunc) gimp_preview_invalidate_now,
-                            preview, NULL);
-    }
+  g_clear_pointer (&priv->invalid_region, cairo_region_destroy);
+
+  if (priv->rendering)
+    g_cancellable_cancel (priv->cancellable);
+
+  gimp_preview_queue_invalidate (preview);
+}
+
+/**
+ * gimp_preview_get_invalid_region:
+ * @preview: a #GimpPreview widget
+ *
+ * Returns the part of the @preview which needs to be rendered, in the
+ * coordinates returned by gimp_preview_get_position().
+ *
+ * This is all of the @preview, except when it was only scrolled since
+ * it was last rendered: then the previously rendered pixels are kept,
+ * and only the newly exposed strips need to be rendered.  An
+ * "invalidated" handler can use this to render just these strips, and
+ * draw them with gimp_preview_area_draw() or
+ * gimp_drawable_preview_draw_region().
+ *
+ * Return value: a newly allocated #cairo_region_t, free it with
+ *               cairo_region_destroy().
+ *
+ * Since: 2.10.10
+ **/
+cairo_region_t *
+gimp_preview_get_invalid_region (GimpPreview *preview)
+{
+  GimpPreviewPrivate    *priv;
+  cairo_rectangle_int_t  rect;
+
+  g_return_val_if_fail (GIMP_IS_PREVIEW (preview), NULL);
+
+  priv = GIMP_PREVIEW_GET_PRIVATE (preview);
+
+  if (priv->invalid_region)
+    return cairo_region_copy (priv->invalid_region);
+
+  gimp_preview_get_position (preview, &rect.x, &rect.y);
+  gimp_preview_get_size (preview, &rect.width, &rect.height);
+
+  return cairo_region_create_rectangle (&rect);
+}
+
+/**
+ * gimp_preview_get_cancellable:
+ * @preview: a #GimpPreview widget
+ *
+ * Returns a #GCancellable which gets cancelled when the @preview is
+ * invalidated again, or scrolled, while the "invalidated" signal is
+ * emitted.
+ *
+ * A lengthy "invalidated" handler which keeps the user interface
+ * responsive, by iterating the main loop now and then, should check it
+ * and return early once it got cancelled: the preview is going to be
+ * invalidated again.
+ *
+ * Return value: the @preview's #GCancellable for the current rendering.
+ *
+ * Since: 2.10.10
+ **/
+GCancellable *
+gimp_preview_get_cancellable (GimpPreview *preview)
+{
+  g_return_val_if_fail (GIMP_IS_PREVIEW (preview), NULL);
+
+  return GIMP_PREVIEW_GET_PRIVATE (preview)->cancellable;
 }
 
 /**
@@ -855,3 +986,70 @@ gimp_preview_get_controls (GimpPreview *preview)
 
   return GIMP_PREVIEW_GET_PRIVATE (preview)->controls;
 }
+
+
+/*  private functions  */
+
+void
+_gimp_preview_scroll (GimpPreview *preview,
+                      gint         old_xoff,
+                      gint         old_yoff)
+{
+  GimpPreviewPrivate    *priv  = GIMP_PREVIEW_GET_PRIVATE (preview);
+  GimpPreviewClass      *class = GIMP_PREVIEW_GET_CLASS (preview);
+  cairo_rectangle_int_t  view;
+  cairo_rectangle_int_t  old_view;
+  cairo_region_t        *exposed;
+  gint                   dx;
+  gint                   dy;
+  gint                   i;
+
+  dx = preview->xoff - old_xoff;
+  dy = preview->yoff - old_yoff;
+
+  if (dx == 0 && dy == 0)
+    return;
+
+  if (! class->draw_area || priv->rendering ||
+      ABS (dx) >= preview->width || ABS (dy) >= preview->height)
+    {
+      gimp_preview_draw (preview);
+      gimp_preview_invalidate (preview);
+
+      return;
+    }
+
+  /*  keep what was rendered, and only draw the original into the
+   *  newly exposed strips
+   */
+  gimp_preview_area_scroll (GIMP_PREVIEW_AREA (preview->area), dx, dy);
+
+  gimp_preview_get_position (preview, &view.x, &view.y);
+  gimp_preview_get_size (preview, &view.width, &view.height);
+
+  old_view    = view;
+  old_view.x -= dx;
+  old_view.y -= dy;
+
+  exposed = cairo_region_create_rectangle (&view);
+  cairo_region_subtract_rectangle (exposed, &old_view);
+
+  for (i = 0; i < cairo_region_num_rectangles (exposed); i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (exposed, i, &rect);
+
+      class->draw_area (preview, rect.x, rect.y, rect.width, rect.height);
+    }
+
+  if (priv->invalid_region)
+    {
+      cairo_region_union (priv->invalid_region, exposed);
+      cairo_region_intersect_rectangle (priv->invalid_region, &view);
+    }
+
+  cairo_region_destroy (exposed);
+
+  gimp_preview_queue_invalidate (preview);
+}
@@ -93,8 +93,13 @@ struct _GimpPreviewClass
                           gint            *dest_x,
                           gint            *dest_y);
 
+  void   (* draw_area)   (GimpPreview     *preview,
+                          gint             x,
+                          gint             y,
+                          gint             width,
+                          gint             height);
+
   /* Padding for future expansion */
-  void (* _gimp_reserved3) (void);
   void (* _gimp_reserved4) (void);
 };
 
@@ -138,6 +143,9 @@ void        gimp_preview_draw_buffer        (GimpPreview  *preview,
 
 void        gimp_preview_invalidate         (GimpPreview  *preview);
 
+cairo_region_t * gimp_preview_get_invalid_region (GimpPreview *preview);
+GCancellable   * gimp_preview_get_cancellable    (GimpPreview *preview);
+
 void        gimp_preview_set_default_cursor (GimpPreview  *preview,
                                              GdkCursor    *cursor);
 
@@ -1712,6 +1712,66 @@ gimp_preview_area_fill (GimpPreviewArea *area,
   gimp_preview_area_queue_draw (area, x, y, width, height);
 }
 
+/**
+ * gimp_preview_area_scroll:
+ * @area: a #GimpPreviewArea
+ * @dx:   horizontal scroll distance
+ * @dy:   vertical scroll distance
+ *
+ * Moves the contents of @area by -@dx, -@dy, as when the view on the
+ * previewed image moved by @dx, @dy, and queues a redraw.  The newly
+ * exposed pixels keep their old contents until they are drawn.
+ *
+ * This allows to keep the previously rendered pixels when a preview
+ * is scrolled, and to only render the newly exposed strips.
+ *
+ * Since: 2.10.10
+ **/
+void
+gimp_preview_area_scroll (GimpPreviewArea *area,
+                          gint             dx,
+                          gint             dy)
+{
+  gint width;
+  gint height;
+  gint src_x, src_y;
+  gint dest_x, dest_y;
+  gint row;
+
+  g_return_if_fail (GIMP_IS_PREVIEW_AREA (area));
+
+  if (! area->buf || (dx == 0 && dy == 0))
+    return;
+
+  width  = area->width  - ABS (dx);
+  height = area->height - ABS (dy);
+
+  if (width > 0 && height > 0)
+    {
+      src_x  = MAX (dx, 0);
+      src_y  = MAX (dy, 0);
+      dest_x = MAX (-dx, 0);
+      dest_y = MAX (-dy, 0);
+
+      if (dy > 0)
+        {
+          for (row = 0; row < height; row++)
+            memmove (area->buf + (dest_y + row) * area->rowstride + dest_x * 3,
+                     area->buf + (src_y  + row) * area->rowstride + src_x  * 3,
+                     width * 3);
+        }
+      else
+        {
+          for (row = height - 1; row >= 0; row--)
+            memmove (area->buf + (dest_y + row) * area->rowstride + dest_x * 3,
+                     area->buf + (src_y  + row) * area->rowstride + src_x  * 3,
+                     width * 3);
+        }
+    }
+
+  gimp_preview_area_queue_draw (area, 0, 0, area->width, area->height);
+}
+
 /**
  * gimp_preview_area_set_offsets:
  * @area: a #GimpPreviewArea
@@ -109,6 +109,10 @@ void        gimp_preview_area_fill             (GimpPreviewArea *area,
                                                 guchar           green,
                                                 guchar           blue);
 
+void        gimp_preview_area_scroll           (GimpPreviewArea *area,
+                                                gint             dx,
+                                                gint             dy);
+
 void        gimp_preview_area_set_offsets      (GimpPreviewArea *area,
                                                 gint             x,
                                                 gint             y);
@@ -29,6 +29,7 @@
 #include "gimpicons.h"
 #include "gimppreviewarea.h"
 #include "gimpscrolledpreview.h"
+#include "gimppreview-private.h"
 #include "gimp3migration.h"
 
 #include "libgimp/libgimp-intl.h"
@@ -438,11 +439,14 @@ gimp_scrolled_preview_area_event (GtkWidget           *area,
           if (GIMP_PREVIEW (preview)->xoff != x ||
               GIMP_PREVIEW (preview)->yoff != y)
             {
+              gint old_xoff = GIMP_PREVIEW (preview)->xoff;
+              gint old_yoff = GIMP_PREVIEW (preview)->yoff;
+
               gtk_adjustment_set_value (hadj, x);
               gtk_adjustment_set_value (vadj, y);
 
-              gimp_preview_draw (GIMP_PREVIEW (preview));
-              gimp_preview_invalidate (GIMP_PREVIEW (preview));
+              _gimp_preview_scroll (GIMP_PREVIEW (preview),
+                                    old_xoff, old_yoff);
             }
 
           gdk_event_request_motions (mevent);
@@ -518,6 +522,8 @@ gimp_scrolled_preview_h_scroll (GtkAdjustment *hadj,
                                 GimpPreview   *preview)
 {
   GimpScrolledPreviewPrivate *priv = GIMP_SCROLLED_PREVIEW_GET_PRIVATE (preview);
+  gint                        old_xoff = preview->xoff;
+  gint                        old_yoff = preview->yoff;
 
   preview->xoff = gtk_adjustment_get_value (hadj);
 
@@ -525,10 +531,7 @@ gimp_scrolled_preview_h_scroll (GtkAdjustment *hadj,
                                  preview->xoff, preview->yoff);
 
   if (! (priv->in_drag || priv->frozen))
-    {
-      gimp_preview_draw (preview);
-      gimp_preview_invalidate (preview);
-    }
+    _gimp_preview_scroll (preview, old_xoff, old_yoff);
 }
 
 static void
@@ -536,6 +539,8 @@ gimp_scrolled_preview_v_scroll (GtkAdjustment *vadj,
                                 GimpPreview   *preview)
 {
   GimpScrolledPreviewPrivate *priv = GIMP_SCROLLED_PREVIEW_GET_PRIVATE (preview);
+  gint                        old_xoff = preview->xoff;
+  gint                        old_yoff = preview->yoff;
 
   preview->yoff = gtk_adjustment_get_value (vadj);
 
@@ -543,10 +548,7 @@ gimp_scrolled_preview_v_scroll (GtkAdjustment *vadj,
                                  preview->xoff, preview->yoff);
 
   if (! (priv->in_drag || priv->frozen))
-    {
-      gimp_preview_draw (preview);
-      gimp_preview_invalidate (preview);
-    }
+    _gimp_preview_scroll (preview, old_xoff, old_yoff);
 }
 
 static gboolean
@@ -619,6 +619,12 @@ sub generate {
                                      @{[$proc->{deprecated} ? "\"$proc->{deprecated}\"" : 'NULL']});
 CODE
 
+	if ($proc->{pure}) {
+	    $out->{register} .= <<CODE;
+  procedure->pure = TRUE;
+CODE
+	}
+
         $argc = 0;
 
         foreach $arg (@inargs) {
@@ -26,8 +26,8 @@
  * TODO:
  *  pdb interface - should we bother?
  *
- *  speedups (caching?  most bottlenecks seem to be in pixelrgns)
- *    -> do pixelrgns properly!
+ *  speedups: frames are fetched and scaled once per window size and
+ *  kept in a bounded cache, which is filled ahead of the playhead.
  */
 
 #include "config.h"
@@ -46,6 +46,9 @@
 #define PLUG_IN_ROLE   "gimp-animation-play"
 #define DITHERTYPE     GDK_RGB_DITHER_NORMAL
 
+/* memory allowed for scaled frames kept ahead of the playhead */
+#define FRAME_CACHE_SIZE (128 * 1024 * 1024)
+
 
 typedef enum
 {
@@ -111,6 +114,9 @@ static gboolean    repaint_da                (GtkWidget       *darea,
                                               gpointer         data);
 
 static void        init_frames               (void);
+static void        frame_cache_flush         (void);
+static guchar    * frame_cache_get           (gint32           whichframe);
+static void        frame_cache_prefetch      (void);
 static void        render_frame              (gint32           whichframe);
 static void        show_frame                (void);
 static void        total_alpha_preview       (void);
@@ -175,12 +181,22 @@ static gchar             *shape_preview_mask        = NULL;
 
 static gint32             total_frames              = 0;
 static gint32            *frames                    = NULL;
-static guchar            *rawframe                  = NULL;
 static guint32           *frame_durations           = NULL;
 static guint              frame_number              = 0;
 
+/* Scaled R'G'B'A frames, valid for one drawing size and scale. */
+static guchar           **frame_cache               = NULL;
+static gint               frame_cache_count         = 0;
+static gint               frame_cache_capacity      = 0;
+static guint              frame_cache_width         = 0;
+static guint              frame_cache_height        = 0;
+static gdouble            frame_cache_scale         = 0.0;
+static guint              frame_cache_idle          = 0;
+
 static gboolean           playing                   = FALSE;
 static guint              timer                     = 0;
+static gint64             frame_deadline            = 0;
+static guint              dropped_frames            = 0;
 static gboolean           detached                  = FALSE;
 static gdouble            scale, shape_scale;
 
@@ -357,9 +373,8 @@ da_size_callback (GtkWidget *widget,
           g_free (new_entry_text);
         }
 
-      /* Update the rawframe. */
-      g_free (rawframe);
-      rawframe = g_malloc ((unsigned long) drawing_area_width * drawing_area_height * 4);
+      /* Cached frames were scaled for the previous size. */
+      frame_cache_flush ();
 
       /* As we re-allocated the drawn data, let's render it again. */
       if (frame_number < total_frames)
@@ -409,9 +424,8 @@ sda_size_callback (GtkWidget *widget,
           g_free (new_entry_text);
         }
 
-      /* Update the rawframe. */
-      g_free (rawframe);
-      rawframe = g_malloc ((unsigned long) shape_drawing_area_width * shape_drawing_area_height * 4);
+      /* Cached frames were scaled for the previous size. */
+      frame_cache_flush ();
 
       if (frame_number < total_frames)
         render_frame (frame_number);
@@ -1010,9 +1024,13 @@ init_frames (void)
   DisposeType   disposal = settings.default_frame_disposal;
   gchar        *layer_name;
 
+  /* Cleanup before re-generation. */
+  frame_cache_flush ();
+  g_free (frame_cache);
+  frame_cache = NULL;
+
   total_frames = total_layers;
 
-  /* Cleanup before re-generation. */
   if (frames)
     {
       gimp_image_delete (frames_image_id);
@@ -1021,7 +1039,8 @@ init_frames (void)
     }
   frames = g_try_malloc0_n (total_frames, sizeof (gint32));
   frame_durations = g_try_malloc0_n (total_frames, sizeof (guint32));
-  if (! frames || ! frame_durations)
+  frame_cache = g_try_malloc0_n (total_frames, sizeof (guchar *));
+  if (! frames || ! frame_durations || ! frame_cache)
     {
       gimp_message (_("Memory could not be allocated to the frame container."));
       gtk_main_quit ();
@@ -1115,11 +1134,167 @@ initialize (void)
 
 /* Rendering Functions */
 
+/* Frame cache.
+ *
+ * Fetching a frame from the core and scaling it to the drawing area is
+ * what playback spends its time on, so every frame is fetched once per
+ * drawing size and kept, up to FRAME_CACHE_SIZE bytes.  The frames
+ * following the playhead are fetched from an idle handler between two
+ * timer ticks; the fetch itself talks to the core and therefore stays in
+ * the main thread.
+ */
+
+static void
+frame_cache_flush (void)
+{
+  gint i;
+
+  if (frame_cache_idle)
+    {
+      g_source_remove (frame_cache_idle);
+      frame_cache_idle = 0;
+    }
+
+  if (frame_cache)
+    {
+      for (i = 0; i < total_frames; i++)
+        g_clear_pointer (&frame_cache[i], g_free);
+    }
+
+  frame_cache_count = 0;
+  frame_cache_width = 0;
+  frame_cache_height = 0;
+}
+
+static void
+frame_cache_get_target (guint   *drawing_width,
+                        guint   *drawing_height,
+                        gdouble *drawing_scale)
+{
+  if (detached)
+    {
+      *drawing_width  = shape_drawing_area_width;
+      *drawing_height = shape_drawing_area_height;
+      *drawing_scale  = shape_scale;
+    }
+  else
+    {
+      *drawing_width  = drawing_area_width;
+      *drawing_height = drawing_area_height;
+      *drawing_scale  = scale;
+    }
+}
+
+/* Number of frames the playhead still has to go through before it
+ * reaches whichframe.
+ */
+static gint
+frame_cache_distance (gint32 whichframe)
+{
+  return (whichframe - (gint32) frame_number + total_frames) % total_frames;
+}
+
+static guchar *
+frame_cache_get (gint32 whichframe)
+{
+  GeglBuffer *buffer;
+  guint       drawing_width, drawing_height;
+  gdouble     drawing_scale;
+  gsize       frame_size;
+
+  frame_cache_get_target (&drawing_width, &drawing_height, &drawing_scale);
+
+  if (drawing_width  != frame_cache_width  ||
+      drawing_height != frame_cache_height ||
+      drawing_scale  != frame_cache_scale)
+    {
+      frame_cache_flush ();
+
+      frame_size = (gsize) drawing_width * drawing_height * 4;
+
+      frame_cache_width    = drawing_width;
+      frame_cache_height   = drawing_height;
+      frame_cache_scale    = drawing_scale;
+      frame_cache_capacity = CLAMP (FRAME_CACHE_SIZE / MAX (frame_size, 1),
+                                    1, total_frames);
+    }
+
+  if (frame_cache[whichframe])
+    return frame_cache[whichframe];
+
+  if (frame_cache_count >= frame_cache_capacity)
+    {
+      gint victim   = -1;
+      gint distance = -1;
+      gint i;
+
+      /* Drop the frame which will be needed last. */
+      for (i = 0; i < total_frames; i++)
+        {
+          if (frame_cache[i] && frame_cache_distance (i) > distance)
+            {
+              victim   = i;
+              distance = frame_cache_distance (i);
+            }
+        }
+
+      g_clear_pointer (&frame_cache[victim], g_free);
+      frame_cache_count--;
+    }
+
+  frame_cache[whichframe] = g_malloc ((gsize) drawing_width *
+                                      drawing_height * 4);
+  frame_cache_count++;
+
+  buffer = gimp_drawable_get_buffer (frames[whichframe]);
+
+  /* Fetch and scale the whole raw new frame */
+  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, drawing_width, drawing_height),
+                   drawing_scale, babl_format ("R'G'B'A u8"),
+                   frame_cache[whichframe], GEGL_AUTO_ROWSTRIDE,
+                   GEGL_ABYSS_CLAMP);
+
+  g_object_unref (buffer);
+
+  return frame_cache[whichframe];
+}
+
+static gboolean
+frame_cache_prefetch_idle (gpointer data)
+{
+  gint i;
+
+  /* One frame per call, so that timer ticks and redraws get through. */
+  for (i = 1; i < frame_cache_capacity; i++)
+    {
+      gint32 whichframe = (frame_number + i) % total_frames;
+
+      if (! frame_cache[whichframe])
+        {
+          frame_cache_get (whichframe);
+          return G_SOURCE_CONTINUE;
+        }
+    }
+
+  frame_cache_idle = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+frame_cache_prefetch (void)
+{
+  if (! frame_cache_idle && total_frames > 1)
+    frame_cache_idle = g_idle_add_full (G_PRIORITY_LOW,
+                                        frame_cache_prefetch_idle,
+                                        NULL, NULL);
+}
+
 static void
 render_frame (gint32 whichframe)
 {
-  GeglBuffer    *buffer;
   gint           i, j, k;
+  guchar        *rawframe;
   guchar        *srcptr;
   guchar        *destptr;
   GtkWidget     *da;
@@ -1149,12 +1324,7 @@ render_frame (gint32 whichframe)
       total_alpha_preview ();
     }
 
-  buffer = gimp_drawable_get_buffer (frames[whichframe]);
-
-  /* Fetch and scale the whole raw new frame */
-  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, drawing_width, drawing_height),
-                   drawing_scale, babl_format ("R'G'B'A u8"),
-                   rawframe, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+  rawframe = frame_cache_get (whichframe);
 
   /* Number of pixels. */
   i = drawing_width * drawing_height;
@@ -1207,8 +1377,8 @@ render_frame (gint32 whichframe)
                        GDK_RGB_DITHER_MAX : DITHERTYPE),
                       preview_data, drawing_width * 3);
 
-  /* clean up */
-  g_object_unref (buffer);
+  if (playing)
+    frame_cache_prefetch ();
 }
 
 static void
@@ -1221,7 +1391,12 @@ show_frame (void)
                                  ((gfloat) frame_number /
                                   (gfloat) (total_frames - 0.999)));
 
-  text = g_strdup_printf (_("Frame %d of %d"), frame_number + 1, total_frames);
+  if (dropped_frames > 0)
+    text = g_strdup_printf (_("Frame %d of %d (%u dropped)"),
+                            frame_number + 1, total_frames, dropped_frames);
+  else
+    text = g_strdup_printf (_("Frame %d of %d"),
+                            frame_number + 1, total_frames);
   gtk_progress_bar_set_text (GTK_PROGRESS_BAR (progress), text);
   g_free (text);
 }
@@ -1312,6 +1487,8 @@ window_destroy (GtkWidget *widget)
   if (playing)
     remove_timer ();
 
+  frame_cache_flush ();
+
   if (shape_window)
     gtk_widget_destroy (GTK_WIDGET (shape_window));
 
@@ -1319,21 +1496,50 @@ window_destroy (GtkWidget *widget)
 }
 
 
+/* Duration of a frame on screen, in microseconds. */
+static gint64
+get_frame_duration (gint32 whichframe)
+{
+  return (gint64) (frame_durations[whichframe] *
+                   get_duration_factor (settings.duration_index) * 1000.0);
+}
+
 static gint
 advance_frame_callback (gpointer data)
 {
-  gdouble duration;
+  gint64 now;
+  gint64 delay;
 
   remove_timer();
 
-  duration = frame_durations[(frame_number + 1) % total_frames];
+  now = g_get_monotonic_time ();
+
+  /* frame_deadline is when the current frame's time is up.  Skip the
+   * frames whose whole time slot has passed as well, rather than
+   * letting playback fall further behind.
+   */
+  frame_number = (frame_number + 1) % total_frames;
 
-  timer = g_timeout_add (duration * get_duration_factor (settings.duration_index),
-                         advance_frame_callback, NULL);
+  while (now >= frame_deadline + get_frame_duration (frame_number))
+    {
+      frame_deadline += get_frame_duration (frame_number);
+      frame_number = (frame_number + 1) % total_frames;
+      dropped_frames++;
+
+      /* More than a second behind, start over from now. */
+      if (now - frame_deadline > 1000000)
+        frame_deadline = now;
+    }
 
-  do_step ();
+  frame_deadline += get_frame_duration (frame_number);
+
+  render_frame (frame_number);
   show_frame ();
 
+  delay = MAX (frame_deadline - g_get_monotonic_time (), 0);
+
+  timer = g_timeout_add (delay / 1000, advance_frame_callback, NULL);
+
   return FALSE;
 }
 
@@ -1348,10 +1554,15 @@ play_callback (GtkToggleAction *action)
 
   if (playing)
     {
-      timer = g_timeout_add ((gdouble) frame_durations[frame_number] *
-                             get_duration_factor (settings.duration_index),
+      frame_deadline = g_get_monotonic_time () +
+                       get_frame_duration (frame_number);
+      dropped_frames = 0;
+
+      timer = g_timeout_add (get_frame_duration (frame_number) / 1000,
                              advance_frame_callback, NULL);
 
+      frame_cache_prefetch ();
+
       gtk_action_set_icon_name (GTK_ACTION (action), "media-playback-pause");
     }
   else
@@ -59,6 +59,12 @@ enum
   DISPOSE_REPLACE
 };
 
+enum
+{
+  GIF_PALETTE_GLOBAL,
+  GIF_PALETTE_LOCAL
+};
+
 typedef struct
 {
   gint     interlace;
@@ -69,6 +75,7 @@ typedef struct
   gboolean always_use_default_delay;
   gboolean always_use_default_dispose;
   gboolean as_animation;
+  gint     palette;
 } GIFSaveVals;
 
 
@@ -87,6 +94,12 @@ static gboolean  save_image            (GFile            *file,
                                         gint32            orig_image_ID,
                                         GError          **error);
 
+static gboolean  save_rgb_image        (GFile            *file,
+                                        gint32            image_ID,
+                                        gint32           *layers,
+                                        gint              nlayers,
+                                        gboolean          is_gif89,
+                                        GError          **error);
 static GimpPDBStatusType sanity_check  (GFile            *file,
                                         gint32           *image_ID,
                                         GimpRunMode       run_mode,
@@ -119,7 +132,8 @@ static GIFSaveVals gsvals =
   0,       /* default_dispose = "don't care"       */
   FALSE,   /* don't always use default_delay       */
   FALSE,   /* don't always use default_dispose     */
-  FALSE    /* as_animation                         */
+  FALSE,   /* as_animation                         */
+  GIF_PALETTE_GLOBAL  /* one palette for all RGB frames */
 };
 
 
@@ -149,7 +163,8 @@ query (void)
     COMMON_SAVE_ARGS,
     { GIMP_PDB_INT32,    "as-animation", "Export GIF as animation?" },
     { GIMP_PDB_INT32,    "force-delay", "(animated gif) Use specified delay for all frames?" },
-    { GIMP_PDB_INT32,    "force-dispose", "(animated gif) Use specified disposal for all frames?" }
+    { GIMP_PDB_INT32,    "force-dispose", "(animated gif) Use specified disposal for all frames?" },
+    { GIMP_PDB_INT32,    "palette", "(RGB images) Palette to quantize the frames to { GLOBAL (0), PER-FRAME (1) }" }
   };
 
   gimp_install_procedure (SAVE_PROC,
@@ -165,7 +180,7 @@ query (void)
                           "Spencer Kimball, Peter Mattis, Adam Moss, David Koblas",
                           "1995-1997",
                           N_("GIF image"),
-                          "INDEXED*, GRAY*",
+                          "RGB*, INDEXED*, GRAY*",
                           GIMP_PLUGIN,
                           G_N_ELEMENTS (save_args), 0,
                           save_args, NULL);
@@ -184,7 +199,7 @@ query (void)
                           "Spencer Kimball, Peter Mattis, Adam Moss, David Koblas",
                           "1995-1997",
                           N_("GIF image"),
-                          "INDEXED*, GRAY*",
+                          "RGB*, INDEXED*, GRAY*",
                           GIMP_PLUGIN,
                           G_N_ELEMENTS (save2_args), 0,
                           save2_args, NULL);
@@ -263,7 +278,7 @@ run (const gchar      *name,
 
             case GIMP_RUN_NONINTERACTIVE:
               /*  Make sure all the arguments are there!  */
-              if (nparams != 9 && nparams != 12)
+              if (nparams != 9 && nparams != 12 && nparams != 13)
                 {
                   status = GIMP_PDB_CALLING_ERROR;
                 }
@@ -280,6 +295,11 @@ run (const gchar      *name,
                       gsvals.always_use_default_delay   = (param[10].data.d_int32) ? TRUE : FALSE;
                       gsvals.always_use_default_dispose = (param[11].data.d_int32) ? TRUE : FALSE;
                     }
+                  if (nparams == 13)
+                    {
+                      gsvals.palette = (param[12].data.d_int32 ?
+                                        GIF_PALETTE_LOCAL : GIF_PALETTE_GLOBAL);
+                    }
                 }
               break;
 
@@ -302,6 +322,7 @@ run (const gchar      *name,
             case GIMP_RUN_WITH_LAST_VALS:
                 {
                   GimpExportCapabilities capabilities =
+                    GIMP_EXPORT_CAN_HANDLE_RGB     |
                     GIMP_EXPORT_CAN_HANDLE_INDEXED |
                     GIMP_EXPORT_CAN_HANDLE_GRAY    |
                     GIMP_EXPORT_CAN_HANDLE_ALPHA;
@@ -835,9 +856,16 @@ save_image (GFile   *file,
       break;
 
     default:
-      g_message (_("Cannot export RGB color images. Convert to "
-                   "indexed color or grayscale first."));
-      return FALSE;
+      {
+        gboolean success;
+
+        /*  RGB frames are quantized while they are exported  */
+        success = save_rgb_image (file, image_ID, layers, nlayers,
+                                  is_gif89, error);
+        g_free (layers);
+
+        return success;
+      }
     }
 
 
@@ -1282,6 +1310,18 @@ save_dialog (gint32 image_ID)
                     G_CALLBACK (comment_entry_callback),
                     NULL);
 
+  /* Palette selector, only used when exporting RGB images */
+  file_gif_combo_box_int_init (builder, "palette-combo",
+                               gsvals.palette, &gsvals.palette,
+                               _("Shared by all frames"),
+                               GIF_PALETTE_GLOBAL,
+                               _("One per frame"),
+                               GIF_PALETTE_LOCAL,
+                               NULL);
+  gtk_widget_set_sensitive (GTK_WIDGET (gtk_builder_get_object (builder,
+                                                                "palette-hbox")),
+                            gimp_image_base_type (image_ID) == GIMP_RGB);
+
   /*  additional animated gif parameter settings  */
   file_gif_toggle_button_init (builder, "loop-forever",
                                gsvals.loop, &gsvals.loop);
@@ -2513,6 +2553,953 @@ char_flush (GOutputStream  *output,
 }
 
 
+/*  Direct export of RGB images.
+ *
+ *  Instead of converting the image to indexed in place, every frame is
+ *  quantized on its own, against either one palette shared by all
+ *  frames or a palette of its own.  A full-canvas frame following a
+ *  frame that is left in place is cropped to the rectangle where it
+ *  differs from that frame.  Quantization, diffing and LZW encoding of
+ *  a batch of frames run in parallel; the main thread only fetches the
+ *  layers and writes the encoded frames in order.
+ */
+
+#define GIF_HIST_BITS  5
+#define GIF_HIST_SIZE  (1 << (3 * GIF_HIST_BITS))
+#define GIF_HIST_KEY(p) ((((p)[0] >> 3) << (2 * GIF_HIST_BITS)) | \
+                         (((p)[1] >> 3) << GIF_HIST_BITS)       | \
+                         ((p)[2] >> 3))
+
+/* the global palette is built from frames sampled down to this size */
+#define GIF_PALETTE_SAMPLE_SIZE 512
+
+typedef struct
+{
+  guint64 count[GIF_HIST_SIZE];
+  guint64 sum[GIF_HIST_SIZE][3];
+} GifHistogram;
+
+typedef struct
+{
+  gint    lo[3];
+  gint    hi[3];
+  guint64 count;
+} GifBox;
+
+typedef struct
+{
+  gint   n_colors;
+  guchar colors[MAXCOLORS * 3];
+} GifPalette;
+
+typedef struct _GifFrame GifFrame;
+
+struct _GifFrame
+{
+  /*  set up by the main thread  */
+  guchar           *pixels;      /* R'G'B'A u8 layer pixels            */
+  gint              offset_x;
+  gint              offset_y;
+  gint              width;
+  gint              height;
+  gboolean          opaque;      /* no pixel below 50% alpha           */
+  gint              disposal;
+  gint              delay;
+  GifFrame         *prev;        /* crop to the change against it      */
+  const GifPalette *palette;     /* shared palette, NULL for own one   */
+  gboolean          reserve;     /* the shared palette leaves room for
+                                  * a transparent index               */
+  gboolean          interlace;
+
+  /*  computed by the job  */
+  GifPalette        local;
+  gint              x, y;
+  gint              cols, rows;
+  gint              transparent;
+  gint              bpp;
+  GByteArray       *lzw;
+};
+
+typedef struct
+{
+  /*  hash table of the LZW string table, as in compress()  */
+  glong       htab[HSIZE];
+  gushort     codetab[HSIZE];
+
+  gint        init_bits;
+  gint        n_bits;
+  gint        maxcode;
+  gint        free_ent;
+  gint        clear_code;
+  gint        eof_code;
+  gboolean    clear_flg;
+
+  gulong      accum;
+  gint        bits;
+  GByteArray *out;
+} GifLzw;
+
+
+static GThreadPool *frame_pool    = NULL;
+static GMutex       frame_mutex;
+static GCond        frame_cond;
+static gint         frame_pending = 0;
+
+
+static void
+gif_histogram_add (GifHistogram *hist,
+                   const guchar *pixels,
+                   gint          n_pixels)
+{
+  while (n_pixels--)
+    {
+      if (pixels[3] >= 128)
+        {
+          gint key = GIF_HIST_KEY (pixels);
+
+          hist->count[key]++;
+          hist->sum[key][0] += pixels[0];
+          hist->sum[key][1] += pixels[1];
+          hist->sum[key][2] += pixels[2];
+        }
+
+      pixels += 4;
+    }
+}
+
+static guint64
+gif_box_shrink (const GifHistogram *hist,
+                GifBox             *box)
+{
+  gint lo[3] = { 31, 31, 31 };
+  gint hi[3] = { 0, 0, 0 };
+  gint c[3];
+
+  box->count = 0;
+
+  for (c[0] = box->lo[0]; c[0] <= box->hi[0]; c[0]++)
+    for (c[1] = box->lo[1]; c[1] <= box->hi[1]; c[1]++)
+      for (c[2] = box->lo[2]; c[2] <= box->hi[2]; c[2]++)
+        {
+          gint    key   = ((c[0] << (2 * GIF_HIST_BITS)) |
+                           (c[1] << GIF_HIST_BITS)       |
+                           c[2]);
+          guint64 count = hist->count[key];
+          gint    i;
+
+          if (! count)
+            continue;
+
+          box->count += count;
+
+          for (i = 0; i < 3; i++)
+            {
+              lo[i] = MIN (lo[i], c[i]);
+              hi[i] = MAX (hi[i], c[i]);
+            }
+        }
+
+  if (box->count)
+    {
+      memcpy (box->lo, lo, sizeof (lo));
+      memcpy (box->hi, hi, sizeof (hi));
+    }
+
+  return box->count;
+}
+
+/*  Median cut over the histogram; returns the number of colors  */
+static gint
+gif_median_cut (const GifHistogram *hist,
+                gint                max_colors,
+                GifPalette         *palette)
+{
+  GifBox boxes[MAXCOLORS];
+  gint   n_boxes = 1;
+  gint   b;
+
+  boxes[0].lo[0] = boxes[0].lo[1] = boxes[0].lo[2] = 0;
+  boxes[0].hi[0] = boxes[0].hi[1] = boxes[0].hi[2] = 31;
+
+  if (! gif_box_shrink (hist, &boxes[0]))
+    {
+      /*  nothing opaque at all  */
+      palette->n_colors = 1;
+      palette->colors[0] = palette->colors[1] = palette->colors[2] = 0;
+
+      return 1;
+    }
+
+  while (n_boxes < max_colors)
+    {
+      GifBox  *box   = NULL;
+      guint64  half;
+      guint64  sum   = 0;
+      gint     axis  = 0;
+      gint     split;
+      gint     i;
+
+      /*  split the most populated box which can be split  */
+      for (b = 0; b < n_boxes; b++)
+        {
+          if ((boxes[b].hi[0] > boxes[b].lo[0] ||
+               boxes[b].hi[1] > boxes[b].lo[1] ||
+               boxes[b].hi[2] > boxes[b].lo[2]) &&
+              (! box || boxes[b].count > box->count))
+            {
+              box = &boxes[b];
+            }
+        }
+
+      if (! box)
+        break;
+
+      for (i = 1; i < 3; i++)
+        {
+          if (box->hi[i] - box->lo[i] > box->hi[axis] - box->lo[axis])
+            axis = i;
+        }
+
+      /*  find the plane where half of the box's pixels are reached  */
+      half = box->count / 2;
+
+      for (split = box->lo[axis]; split < box->hi[axis]; split++)
+        {
+          GifBox plane = *box;
+
+          plane.lo[axis] = plane.hi[axis] = split;
+
+          sum += gif_box_shrink (hist, &plane);
+
+          if (sum >= half)
+            break;
+        }
+
+      if (split == box->hi[axis])
+        split--;
+
+      boxes[n_boxes] = *box;
+      boxes[n_boxes].lo[axis] = split + 1;
+      box->hi[axis] = split;
+
+      gif_box_shrink (hist, box);
+      gif_box_shrink (hist, &boxes[n_boxes]);
+
+      n_boxes++;
+    }
+
+  /*  every box is represented by the mean of its pixels  */
+  for (b = 0; b < n_boxes; b++)
+    {
+      guint64 sum[3] = { 0, 0, 0 };
+      gint    c[3];
+      gint    i;
+
+      for (c[0] = boxes[b].lo[0]; c[0] <= boxes[b].hi[0]; c[0]++)
+        for (c[1] = boxes[b].lo[1]; c[1] <= boxes[b].hi[1]; c[1]++)
+          for (c[2] = boxes[b].lo[2]; c[2] <= boxes[b].hi[2]; c[2]++)
+            {
+              gint key = ((c[0] << (2 * GIF_HIST_BITS)) |
+                          (c[1] << GIF_HIST_BITS)       |
+                          c[2]);
+
+              for (i = 0; i < 3; i++)
+                sum[i] += hist->sum[key][i];
+            }
+
+      for (i = 0; i < 3; i++)
+        palette->colors[b * 3 + i] = (sum[i] + boxes[b].count / 2) /
+                                     boxes[b].count;
+    }
+
+  palette->n_colors = n_boxes;
+
+  return n_boxes;
+}
+
+static gint
+gif_palette_lookup (const GifPalette *palette,
+                    const guchar     *pixel)
+{
+  const guchar *color = palette->colors;
+  gint          best  = 0;
+  gint          best_dist = G_MAXINT;
+  gint          i;
+
+  for (i = 0; i < palette->n_colors; i++, color += 3)
+    {
+      gint dr   = color[0] - pixel[0];
+      gint dg   = color[1] - pixel[1];
+      gint db   = color[2] - pixel[2];
+      gint dist = dr * dr + dg * dg + db * db;
+
+      if (dist < best_dist)
+        {
+          best      = i;
+          best_dist = dist;
+        }
+    }
+
+  return best;
+}
+
+static void
+gif_lzw_output (GifLzw *lzw,
+                gint    code)
+{
+  lzw->accum &= masks[lzw->bits];
+
+  if (lzw->bits > 0)
+    lzw->accum |= ((gulong) code << lzw->bits);
+  else
+    lzw->accum = code;
+
+  lzw->bits += lzw->n_bits;
+
+  while (lzw->bits >= 8)
+    {
+      guchar c = lzw->accum & 0xff;
+
+      g_byte_array_append (lzw->out, &c, 1);
+
+      lzw->accum >>= 8;
+      lzw->bits   -= 8;
+    }
+
+  /*  grow the code size exactly like output_code() does  */
+  if (lzw->free_ent > lzw->maxcode || lzw->clear_flg)
+    {
+      if (lzw->clear_flg)
+        {
+          lzw->maxcode   = MAXCODE (lzw->n_bits = lzw->init_bits);
+          lzw->clear_flg = FALSE;
+        }
+      else
+        {
+          ++lzw->n_bits;
+
+          if (lzw->n_bits == maxbits)
+            lzw->maxcode = maxmaxcode;
+          else
+            lzw->maxcode = MAXCODE (lzw->n_bits);
+        }
+    }
+
+  if (code == lzw->eof_code)
+    {
+      while (lzw->bits > 0)
+        {
+          guchar c = lzw->accum & 0xff;
+
+          g_byte_array_append (lzw->out, &c, 1);
+
+          lzw->accum >>= 8;
+          lzw->bits   -= 8;
+        }
+    }
+}
+
+/*  A reentrant version of normal_compress(), writing to memory  */
+static void
+gif_lzw_encode (GifLzw       *lzw,
+                const guchar *indices,
+                gint          width,
+                gint          height,
+                gboolean      interlace,
+                gint          bpp)
+{
+  static const gint starts[] = { 0, 4, 2, 1 };
+  static const gint steps[]  = { 8, 8, 4, 2 };
+  gint  init_code_size = MAX (bpp, 2);
+  gint  hshift = 0;
+  gint  n_passes;
+  gint  pass;
+  glong fcode;
+  gint  ent = -1;
+
+  lzw->init_bits  = init_code_size + 1;
+  lzw->n_bits     = lzw->init_bits;
+  lzw->maxcode    = MAXCODE (lzw->n_bits);
+  lzw->clear_code = 1 << init_code_size;
+  lzw->eof_code   = lzw->clear_code + 1;
+  lzw->free_ent   = lzw->clear_code + 2;
+  lzw->clear_flg  = FALSE;
+  lzw->accum      = 0;
+  lzw->bits       = 0;
+
+  for (fcode = (glong) hsize; fcode < 65536L; fcode *= 2L)
+    ++hshift;
+  hshift = 8 - hshift;
+
+  memset (lzw->htab, 0xff, sizeof (lzw->htab));
+
+  gif_lzw_output (lzw, lzw->clear_code);
+
+  n_passes = interlace ? 4 : 1;
+
+  for (pass = 0; pass < n_passes; pass++)
+    {
+      gint y;
+
+      for (y = interlace ? starts[pass] : 0;
+           y < height;
+           y += interlace ? steps[pass] : 1)
+        {
+          const guchar *row = indices + y * width;
+          gint          x;
+
+          for (x = 0; x < width; x++)
+            {
+              gint c = row[x];
+              gint i;
+              gint disp;
+
+              if (ent < 0)
+                {
+                  ent = c;
+                  continue;
+                }
+
+              fcode = (glong) (((glong) c << maxbits) + ent);
+              i     = ((c << hshift) ^ ent);
+
+              if (lzw->htab[i] == fcode)
+                {
+                  ent = lzw->codetab[i];
+                  continue;
+                }
+              else if (lzw->htab[i] >= 0)
+                {
+                  disp = (i == 0) ? 1 : hsize - i;
+
+                  do
+                    {
+                      if ((i -= disp) < 0)
+                        i += hsize;
+                    }
+                  while (lzw->htab[i] != fcode && lzw->htab[i] >= 0);
+
+                  if (lzw->htab[i] == fcode)
+                    {
+                      ent = lzw->codetab[i];
+                      continue;
+                    }
+                }
+
+              gif_lzw_output (lzw, ent);
+              ent = c;
+
+              if (lzw->free_ent < maxmaxcode)
+                {
+                  lzw->codetab[i] = lzw->free_ent++;
+                  lzw->htab[i]    = fcode;
+                }
+              else
+                {
+                  memset (lzw->htab, 0xff, sizeof (lzw->htab));
+                  lzw->free_ent  = lzw->clear_code + 2;
+                  lzw->clear_flg = TRUE;
+
+                  gif_lzw_output (lzw, lzw->clear_code);
+                }
+            }
+        }
+    }
+
+  gif_lzw_output (lzw, ent);
+  gif_lzw_output (lzw, lzw->eof_code);
+}
+
+static void
+gif_frame_job_func (GifFrame *frame,
+                    gpointer  user_data)
+{
+  const GifPalette *palette;
+  GifLzw           *lzw;
+  gint16           *cache;
+  guchar           *indices;
+  gboolean          has_transparent = FALSE;
+  gint              x, y;
+
+  /*  the rectangle that changed against the previous frame  */
+  frame->x    = 0;
+  frame->y    = 0;
+  frame->cols = frame->width;
+  frame->rows = frame->height;
+
+  if (frame->prev)
+    {
+      gint x1 = frame->width, y1 = frame->height;
+      gint x2 = -1,           y2 = -1;
+
+      for (y = 0; y < frame->height; y++)
+        {
+          const guchar *s = frame->pixels       + y * frame->width * 4;
+          const guchar *p = frame->prev->pixels + y * frame->width * 4;
+
+          for (x = 0; x < frame->width; x++, s += 4, p += 4)
+            {
+              if (s[0] != p[0] || s[1] != p[1] || s[2] != p[2])
+                {
+                  x1 = MIN (x1, x);
+                  x2 = MAX (x2, x);
+                  y1 = MIN (y1, y);
+                  y2 = MAX (y2, y);
+                }
+            }
+        }
+
+      if (x2 < 0)
+        {
+          /*  an unchanged frame still needs one pixel  */
+          x1 = x2 = y1 = y2 = 0;
+        }
+
+      frame->x    = x1;
+      frame->y    = y1;
+      frame->cols = x2 - x1 + 1;
+      frame->rows = y2 - y1 + 1;
+    }
+
+  for (y = frame->y; y < frame->y + frame->rows && ! has_transparent; y++)
+    {
+      const guchar *s = frame->pixels + (y * frame->width + frame->x) * 4;
+
+      for (x = 0; x < frame->cols; x++, s += 4)
+        {
+          if (s[3] < 128)
+            {
+              has_transparent = TRUE;
+              break;
+            }
+        }
+    }
+
+  if (frame->palette)
+    {
+      palette = frame->palette;
+
+      frame->transparent = has_transparent ? palette->n_colors : -1;
+      frame->bpp         = colors_to_bpp (palette->n_colors +
+                                          (frame->reserve ? 1 : 0));
+    }
+  else
+    {
+      GifHistogram *hist = g_new0 (GifHistogram, 1);
+
+      for (y = frame->y; y < frame->y + frame->rows; y++)
+        gif_histogram_add (hist,
+                           frame->pixels +
+                           (y * frame->width + frame->x) * 4,
+                           frame->cols);
+
+      gif_median_cut (hist, MAXCOLORS - (has_transparent ? 1 : 0),
+                      &frame->local);
+      g_free (hist);
+
+      palette = &frame->local;
+
+      frame->transparent = has_transparent ? palette->n_colors : -1;
+      frame->bpp         = colors_to_bpp (palette->n_colors +
+                                          (has_transparent ? 1 : 0));
+    }
+
+  /*  map the rectangle to palette indices  */
+  cache   = g_new (gint16, GIF_HIST_SIZE);
+  indices = g_new (guchar, frame->cols * frame->rows);
+
+  memset (cache, 0xff, GIF_HIST_SIZE * sizeof (gint16));
+
+  for (y = 0; y < frame->rows; y++)
+    {
+      const guchar *s = frame->pixels +
+                        ((frame->y + y) * frame->width + frame->x) * 4;
+      guchar       *d = indices + y * frame->cols;
+
+      for (x = 0; x < frame->cols; x++, s += 4)
+        {
+          if (s[3] < 128)
+            {
+              d[x] = frame->transparent;
+            }
+          else
+            {
+              gint key = GIF_HIST_KEY (s);
+
+              if (cache[key] < 0)
+                cache[key] = gif_palette_lookup (palette, s);
+
+              d[x] = cache[key];
+            }
+        }
+    }
+
+  g_free (cache);
+
+  lzw = g_new (GifLzw, 1);
+  lzw->out = frame->lzw = g_byte_array_new ();
+
+  gif_lzw_encode (lzw, indices, frame->cols, frame->rows,
+                  frame->interlace && frame->rows > 4, frame->bpp);
+
+  g_free (lzw);
+  g_free (indices);
+
+  g_mutex_lock (&frame_mutex);
+
+  if (--frame_pending == 0)
+    g_cond_signal (&frame_cond);
+
+  g_mutex_unlock (&frame_mutex);
+}
+
+/* Processes the frames in parallel, and waits for all of them */
+static void
+gif_process_frames (GifFrame *frames,
+                    gint      n_frames)
+{
+  gint i;
+
+  if (! frame_pool)
+    {
+      frame_pool = g_thread_pool_new ((GFunc) gif_frame_job_func, NULL,
+                                      g_get_num_processors (),
+                                      FALSE, NULL);
+    }
+
+  g_mutex_lock (&frame_mutex);
+
+  for (i = 0; i < n_frames; i++)
+    {
+      frame_pending++;
+      g_thread_pool_push (frame_pool, &frames[i], NULL);
+    }
+
+  while (frame_pending > 0)
+    g_cond_wait (&frame_cond, &frame_mutex);
+
+  g_mutex_unlock (&frame_mutex);
+}
+
+static gboolean
+gif_encode_frame (GOutputStream  *output,
+                  GifFrame       *frame,
+                  GError        **error)
+{
+  const GifPalette *palette = frame->palette;
+  guint             i;
+  gint              flags   = 0;
+
+  if (frame->interlace && frame->rows > 4)
+    flags |= 0x40;
+
+  if (! palette)
+    flags |= 0x80 | (frame->bpp - 1);
+
+  if (! put_byte (output, ',', error)                            ||
+      ! put_word (output, frame->offset_x + frame->x, error)     ||
+      ! put_word (output, frame->offset_y + frame->y, error)     ||
+      ! put_word (output, frame->cols, error)                    ||
+      ! put_word (output, frame->rows, error)                    ||
+      ! put_byte (output, flags, error))
+    return FALSE;
+
+  /*  the local color table  */
+  if (! palette)
+    {
+      guchar table[MAXCOLORS * 3] = { 0, };
+
+      memcpy (table, frame->local.colors, frame->local.n_colors * 3);
+
+      if (! g_output_stream_write_all (output, table,
+                                       bpp_to_colors (frame->bpp) * 3,
+                                       NULL, NULL, error))
+        return FALSE;
+    }
+
+  if (! put_byte (output, MAX (frame->bpp, 2), error))
+    return FALSE;
+
+  for (i = 0; i < frame->lzw->len; i += 255)
+    {
+      guint len = MIN (255, frame->lzw->len - i);
+
+      if (! put_byte (output, len, error) ||
+          ! g_output_stream_write_all (output, frame->lzw->data + i, len,
+                                       NULL, NULL, error))
+        return FALSE;
+    }
+
+  return put_byte (output, 0, error);
+}
+
+static gboolean
+save_rgb_image (GFile         *file,
+                gint32         image_ID,
+                gint32        *layers,
+                gint           nlayers,
+                gboolean       is_gif89,
+                GError       **error)
+{
+  const Babl    *format = babl_format ("R'G'B'A u8");
+  GOutputStream *output;
+  GifPalette     global;
+  GifFrame      *frames;
+  GifFrame      *last     = NULL;
+  gboolean       reserve  = FALSE;
+  gboolean       success  = TRUE;
+  gint           width    = gimp_image_width (image_ID);
+  gint           height   = gimp_image_height (image_ID);
+  gint           n_jobs   = g_get_num_processors ();
+  gint           bpp;
+  gint           Red[MAXCOLORS];
+  gint           Green[MAXCOLORS];
+  gint           Blue[MAXCOLORS];
+  gint           done     = 0;
+  gint           i;
+
+  for (i = 0; i < nlayers; i++)
+    {
+      if (gimp_drawable_has_alpha (layers[i]))
+        {
+          reserve  = TRUE;
+          is_gif89 = TRUE;
+        }
+    }
+
+  gimp_progress_init_printf (_("Exporting '%s'"),
+                             gimp_file_get_utf8_name (file));
+
+  /*  the shared palette, from a sample of every frame  */
+  if (gsvals.palette == GIF_PALETTE_GLOBAL)
+    {
+      GifHistogram *hist = g_new0 (GifHistogram, 1);
+
+      for (i = 0; i < nlayers; i++)
+        {
+          GeglBuffer *buffer = gimp_drawable_get_buffer (layers[i]);
+          gint        cols   = gimp_drawable_width  (layers[i]);
+          gint        rows   = gimp_drawable_height (layers[i]);
+          gdouble     scale;
+          guchar     *sample;
+
+          scale = MIN (1.0, (gdouble) GIF_PALETTE_SAMPLE_SIZE /
+                            MAX (cols, rows));
+          cols  = MAX (1, cols * scale);
+          rows  = MAX (1, rows * scale);
+
+          sample = g_new (guchar, cols * rows * 4);
+
+          gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, cols, rows), scale,
+                           format, sample,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          gif_histogram_add (hist, sample, cols * rows);
+
+          g_free (sample);
+          g_object_unref (buffer);
+        }
+
+      gif_median_cut (hist, MAXCOLORS - (reserve ? 1 : 0), &global);
+      g_free (hist);
+
+      bpp = colors_to_bpp (global.n_colors + (reserve ? 1 : 0));
+
+      for (i = 0; i < MAXCOLORS; i++)
+        {
+          if (i < global.n_colors)
+            {
+              Red[i]   = global.colors[i * 3 + 0];
+              Green[i] = global.colors[i * 3 + 1];
+              Blue[i]  = global.colors[i * 3 + 2];
+            }
+          else
+            {
+              Red[i] = Green[i] = Blue[i] = 0;
+            }
+        }
+    }
+  else
+    {
+      /*  every frame brings its own table  */
+      bpp = 1;
+
+      Red[0] = Green[0] = Blue[0] = 0;
+      Red[1] = Green[1] = Blue[1] = 255;
+    }
+
+  output = G_OUTPUT_STREAM (g_file_replace (file,
+                                            NULL, FALSE, G_FILE_CREATE_NONE,
+                                            NULL, error));
+  if (output)
+    {
+      GDataOutputStream *data_output;
+
+      data_output = g_data_output_stream_new (output);
+      g_object_unref (output);
+
+      g_data_output_stream_set_byte_order (data_output,
+                                           G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN);
+
+      output = G_OUTPUT_STREAM (data_output);
+    }
+  else
+    {
+      return FALSE;
+    }
+
+  if (! gif_encode_header (output, is_gif89, width, height, 0,
+                           bpp, Red, Green, Blue, get_pixel, error))
+    success = FALSE;
+
+  if (success && nlayers > 1 && gsvals.loop)
+    success = gif_encode_loop_ext (output, 0, error);
+
+  if (success && gsvals.save_comment && globalcomment)
+    success = gif_encode_comment_ext (output, globalcomment, error);
+
+  frames = g_new0 (GifFrame, n_jobs);
+
+  /*  frames go bottom layer first, a batch at a time  */
+  for (i = nlayers - 1; i >= 0 && success; )
+    {
+      gint n_frames = 0;
+      gint f;
+
+      for (; i >= 0 && n_frames < n_jobs; i--, n_frames++)
+        {
+          GifFrame   *frame  = &frames[n_frames];
+          GifFrame   *prev   = n_frames > 0 ? &frames[n_frames - 1] : last;
+          GeglBuffer *buffer = gimp_drawable_get_buffer (layers[i]);
+          gchar      *layer_name;
+          gint        n;
+
+          memset (frame, 0, sizeof (GifFrame));
+
+          gimp_drawable_offsets (layers[i],
+                                 &frame->offset_x, &frame->offset_y);
+          frame->width  = gimp_drawable_width  (layers[i]);
+          frame->height = gimp_drawable_height (layers[i]);
+          frame->pixels = g_new (guchar, frame->width * frame->height * 4);
+
+          gegl_buffer_get (buffer,
+                           GEGL_RECTANGLE (0, 0, frame->width, frame->height),
+                           1.0, format, frame->pixels,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+          g_object_unref (buffer);
+
+          frame->opaque = TRUE;
+
+          for (n = 0; n < frame->width * frame->height; n++)
+            {
+              if (frame->pixels[n * 4 + 3] < 128)
+                {
+                  frame->opaque = FALSE;
+                  break;
+                }
+            }
+
+          if (i > 0 && ! gsvals.always_use_default_dispose)
+            {
+              layer_name = gimp_item_get_name (layers[i - 1]);
+              frame->disposal = parse_disposal_tag (layer_name);
+              g_free (layer_name);
+            }
+          else
+            {
+              frame->disposal = gsvals.default_dispose;
+            }
+
+          layer_name = gimp_item_get_name (layers[i]);
+          frame->delay = parse_ms_tag (layer_name);
+          g_free (layer_name);
+
+          if (frame->delay < 0 || gsvals.always_use_default_delay)
+            frame->delay = (gsvals.default_delay + 5) / 10;
+          else
+            frame->delay = (frame->delay + 5) / 10;
+
+          /* don't allow a CPU-sucking completely 0-delay looping anim */
+          if (nlayers > 1 && gsvals.loop && frame->delay == 0)
+            frame->delay = 1;
+
+          /*  only a full, opaque frame drawn over another one which
+           *  was left in place can be cropped to their difference
+           */
+          if (prev                                     &&
+              prev->disposal != DISPOSE_REPLACE        &&
+              prev->opaque && frame->opaque            &&
+              prev->offset_x == 0 && prev->offset_y == 0 &&
+              frame->offset_x == 0 && frame->offset_y == 0 &&
+              prev->width  == width  && frame->width  == width &&
+              prev->height == height && frame->height == height)
+            {
+              frame->prev = prev;
+            }
+
+          frame->palette   = gsvals.palette == GIF_PALETTE_GLOBAL ?
+                             &global : NULL;
+          frame->reserve   = reserve;
+          frame->interlace = gsvals.interlace;
+        }
+
+      gif_process_frames (frames, n_frames);
+
+      /*  the previous batch's last frame isn't needed any longer  */
+      if (last)
+        {
+          g_free (last->pixels);
+          g_free (last);
+          last = NULL;
+        }
+
+      for (f = 0; f < n_frames; f++)
+        {
+          GifFrame *frame = &frames[f];
+
+          if (success && is_gif89)
+            success = gif_encode_graphic_control_ext (output,
+                                                      frame->disposal,
+                                                      frame->delay,
+                                                      nlayers,
+                                                      frame->cols,
+                                                      frame->rows,
+                                                      frame->transparent,
+                                                      frame->bpp,
+                                                      get_pixel,
+                                                      error);
+
+          if (success)
+            success = gif_encode_frame (output, frame, error);
+
+          g_byte_array_free (frame->lzw, TRUE);
+
+          if (f < n_frames - 1)
+            g_free (frame->pixels);
+
+          gimp_progress_update ((gdouble) ++done / (gdouble) nlayers);
+        }
+
+      last = g_memdup (&frames[n_frames - 1], sizeof (GifFrame));
+      last->prev = NULL;
+    }
+
+  if (last)
+    {
+      g_free (last->pixels);
+      g_free (last);
+    }
+
+  g_free (frames);
+
+  if (success)
+    success = gif_encode_close (output, error);
+
+  g_object_unref (output);
+
+  return success;
+}
+
 /*  Save interface functions  */
 
 static void
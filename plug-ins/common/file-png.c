@@ -141,6 +141,25 @@ typedef struct
 }
 PngGlobals;
 
+/* A band of rows handed from save_image() to the row writer thread */
+typedef struct
+{
+  guchar  *pixel;
+  guchar **pixels;
+  gint     num;
+}
+PngSaveBand;
+
+typedef struct
+{
+  png_structp   pp;
+  GAsyncQueue  *filled;
+  GAsyncQueue  *empty;
+  PngSaveBand  *current;
+  gint          failed;
+}
+PngSaveWriter;
+
 
 /*
  * Local functions...
@@ -162,6 +181,7 @@ static gboolean  save_image                (const gchar      *filename,
                                             gint32            drawable_ID,
                                             gint32            orig_image_ID,
                                             GError          **error);
+static gpointer  save_write_rows_func      (PngSaveWriter    *writer);
 
 static int       respin_cmap               (png_structp       pp,
                                             png_infop         info,
@@ -222,6 +242,9 @@ static const PngSaveVals defaults =
 static PngSaveVals pngvals;
 static PngGlobals  pngg;
 
+/* Marks the end of the bands queued for the row writer thread */
+static PngSaveBand save_band_end;
+
 
 /*
  * 'main()' - Main entry - just call gimp_main()...
@@ -437,6 +460,12 @@ run (const gchar      *name,
   if (nparams)
     run_mode = param[0].data.d_int32;
 
+  /*  non-interactive calls, as made by scripts and batch processing,
+   *  don't depend on anything left over from earlier calls
+   */
+  if (run_mode == GIMP_RUN_NONINTERACTIVE)
+    gimp_plugin_set_persistent (TRUE);
+
   INIT_I18N ();
   gegl_init (NULL, NULL);
 
@@ -1453,7 +1482,7 @@ save_image (const gchar  *filename,
             gint32        orig_image_ID,
             GError      **error)
 {
-  gint              i, k;             /* Looping vars */
+  gint              i, j, k;          /* Looping vars */
   gint              bpp = 0;          /* Bytes per pixel */
   gint              type;             /* Type of drawable/layer */
   gint              num_passes;       /* Number of interlace passes in file */
@@ -1475,6 +1504,11 @@ save_image (const gchar  *filename,
   guchar          **pixels;           /* Pixel rows */
   guchar           *fixed;            /* Fixed-up pixel data */
   guchar           *pixel;            /* Pixel data */
+  PngSaveBand       bands[2];         /* Bands of pixel rows */
+  PngSaveBand      *band;             /* Band being fetched */
+  PngSaveWriter     writer;           /* Row writer thread state */
+  GThread          *thread;           /* Row writer thread */
+  jmp_buf           saved_jmpbuf;     /* libpng error target */
   gdouble           xres, yres;       /* GIMP resolution (dpi) */
   png_color_16      background;       /* Background color */
   png_time          mod_time;         /* Modification time (ie NOW) */
@@ -1968,17 +2002,40 @@ save_image (const gchar  *filename,
     png_set_packing (pp);
 
   /*
-   * Allocate memory for "tile_height" rows and export the image...
+   * Allocate memory for two bands of "tile_height" rows and export the
+   * image, fetching the next band while the writer thread compresses
+   * the current one...
    */
 
   tile_height = gimp_tile_height ();
-  pixel = g_new (guchar, tile_height * width * bpp);
-  pixels = g_new (guchar *, tile_height);
 
-  for (i = 0; i < tile_height; i++)
-    pixels[i] = pixel + width * bpp * i;
+  for (j = 0; j < G_N_ELEMENTS (bands); j++)
+    {
+      bands[j].pixel  = g_new (guchar, tile_height * width * bpp);
+      bands[j].pixels = g_new (guchar *, tile_height);
 
-  for (pass = 0; pass < num_passes; pass++)
+      for (i = 0; i < tile_height; i++)
+        bands[j].pixels[i] = bands[j].pixel + width * bpp * i;
+    }
+
+  writer.pp      = pp;
+  writer.filled  = g_async_queue_new ();
+  writer.empty   = g_async_queue_new ();
+  writer.current = NULL;
+  writer.failed  = FALSE;
+
+  for (j = 0; j < G_N_ELEMENTS (bands); j++)
+    g_async_queue_push (writer.empty, &bands[j]);
+
+  /* the writer thread sets up its own longjmp() target */
+  memcpy (saved_jmpbuf, png_jmpbuf (pp), sizeof (jmp_buf));
+
+  thread = g_thread_new ("png-write",
+                         (GThreadFunc) save_write_rows_func, &writer);
+
+  for (pass = 0;
+       pass < num_passes && ! g_atomic_int_get (&writer.failed);
+       pass++)
     {
       /* This works if you are only writing one row at a time... */
       for (begin = 0, end = tile_height;
@@ -1989,6 +2046,13 @@ save_image (const gchar  *filename,
 
           num = end - begin;
 
+          band   = g_async_queue_pop (writer.empty);
+          pixel  = band->pixel;
+          pixels = band->pixels;
+
+          if (g_atomic_int_get (&writer.failed))
+            break;
+
           gegl_buffer_get (buffer,
                            GEGL_RECTANGLE (0, begin, width, num),
                            1.0,
@@ -2064,7 +2128,8 @@ save_image (const gchar  *filename,
                 }
             }
 
-          png_write_rows (pp, pixels, num);
+          band->num = num;
+          g_async_queue_push (writer.filled, band);
 
           gimp_progress_update (((double) pass + (double) end /
                                  (double) height) /
@@ -2072,14 +2137,33 @@ save_image (const gchar  *filename,
         }
     }
 
+  g_async_queue_push (writer.filled, &save_band_end);
+  g_thread_join (thread);
+
+  memcpy (png_jmpbuf (pp), saved_jmpbuf, sizeof (jmp_buf));
+
+  g_async_queue_unref (writer.filled);
+  g_async_queue_unref (writer.empty);
+
+  for (j = 0; j < G_N_ELEMENTS (bands); j++)
+    {
+      g_free (bands[j].pixel);
+      g_free (bands[j].pixels);
+    }
+
+  if (writer.failed)
+    {
+      g_set_error (error, 0, 0,
+                   _("Error while exporting '%s'. Could not export image."),
+                   gimp_filename_to_utf8 (filename));
+      return FALSE;
+    }
+
   gimp_progress_update (1.0);
 
   png_write_end (pp, info);
   png_destroy_write_struct (&pp, &info);
 
-  g_free (pixel);
-  g_free (pixels);
-
   /*
    * Done with the file...
    */
@@ -2098,6 +2182,36 @@ save_image (const gchar  *filename,
   return TRUE;
 }
 
+/* Compresses and writes the bands queued by save_image(), so that
+ * deflating a band overlaps with fetching the next one
+ */
+static gpointer
+save_write_rows_func (PngSaveWriter *writer)
+{
+  PngSaveBand *band;
+
+  /* libpng reports errors by longjmp()ing, which must not leave this
+   * thread; after an error, the remaining bands are just handed back
+   */
+  if (setjmp (png_jmpbuf (writer->pp)))
+    {
+      g_atomic_int_set (&writer->failed, TRUE);
+      g_async_queue_push (writer->empty, writer->current);
+    }
+
+  while ((band = g_async_queue_pop (writer->filled)) != &save_band_end)
+    {
+      writer->current = band;
+
+      if (! g_atomic_int_get (&writer->failed))
+        png_write_rows (writer->pp, band->pixels, band->num);
+
+      g_async_queue_push (writer->empty, band);
+    }
+
+  return NULL;
+}
+
 static gboolean
 ia_has_transparent_pixels (GeglBuffer *buffer)
 {
@@ -259,62 +259,33 @@ ripple_vertical (gint      x,
                  gint      bpp,
                  gpointer  data)
 {
-  RippleParam_t    *param  = data;
-  GimpPixelFetcher *pft    = param->pft;
-  const gint        height = param->height;
-  guchar            pixel[2][4];
-  gdouble           needy;
-  gint              yi, yi_a;
+  RippleParam_t *param = data;
+  const guchar  *src;
+  gint           rowstride;
+  gdouble        needy;
+  gint           yi;
+
+  /* The pixel fetcher's edge mode takes care of the edges. */
 
   needy = y + displace_amount (x);
   yi = floor (needy);
-  yi_a = yi + 1;
-
-  if (rvals.edges == WRAP)
-    {
-      /* Tile the image. */
-
-      needy = fmod (needy, height);
-
-      if (needy < 0.0)
-        needy += height;
-
-      yi = yi % height;
-
-      if (yi < 0)
-        yi += height;
-
-      yi_a = yi_a % height;
-    }
-  else if (rvals.edges == SMEAR)
-    {
-      /* Smear out the edges of the image by repeating pixels. */
-
-      needy = CLAMP (needy, 0, height - 1);
-      yi    = CLAMP (yi,    0, height - 1);
-      yi_a  = CLAMP (yi_a,  0, height - 1);
-    }
 
   if (rvals.antialias)
     {
-      if (yi >= 0 && yi < height)
-        gimp_pixel_fetcher_get_pixel (pft, x, yi  , pixel[0]);
-      else
-        memset (pixel[0], 0, 4);
+      guchar pixel[2][4];
 
-      if (yi_a >= 0 && yi_a < height)
-        gimp_pixel_fetcher_get_pixel (pft, x, yi_a, pixel[1]);
-      else
-        memset (pixel[1], 0, 4);
+      src = gimp_pixel_fetcher_get_block (param->pft, x, yi, 1, 2, &rowstride);
+
+      memcpy (pixel[0], src,             bpp);
+      memcpy (pixel[1], src + rowstride, bpp);
 
       average_two_pixels (dest, pixel, needy - yi, bpp, param->has_alpha);
     }
   else
     {
-      if (yi >= 0 && yi < height)
-        gimp_pixel_fetcher_get_pixel (pft, x, yi, dest);
-      else
-        memset (dest, 0, bpp);
+      src = gimp_pixel_fetcher_get_block (param->pft, x, yi, 1, 1, &rowstride);
+
+      memcpy (dest, src, bpp);
     }
 }
 
@@ -325,63 +296,33 @@ ripple_horizontal (gint      x,
                    gint      bpp,
                    gpointer  data)
 {
-  RippleParam_t    *param = data;
-  GimpPixelFetcher *pft   = param->pft;
-  const gint        width = param->width;
-  guchar            pixel[2][4];
-  gdouble           needx;
-  gint              xi, xi_a;
+  RippleParam_t *param = data;
+  const guchar  *src;
+  gint           rowstride;
+  gdouble        needx;
+  gint           xi;
+
+  /* The pixel fetcher's edge mode takes care of the edges. */
 
   needx = x + displace_amount (y);
   xi = floor (needx);
-  xi_a = xi + 1;
-
-  if (rvals.edges == WRAP)
-    {
-      /* Tile the image. */
-
-      needx = fmod (needx, width);
-
-      while (needx < 0.0)
-        needx += width;
-
-      xi = (xi % width);
-
-      while (xi < 0)
-        xi += width;
-
-      xi_a = (xi+1) % width;
-    }
-  else if (rvals.edges == SMEAR)
-    {
-      /* Smear out the edges of the image by repeating pixels. */
-
-      needx = CLAMP (needx, 0, width - 1);
-      xi    = CLAMP (xi,    0, width - 1);
-      xi_a  = CLAMP (xi_a,  0, width - 1);
-    }
 
   if (rvals.antialias)
     {
-      if (xi >= 0 && xi < width)
-        gimp_pixel_fetcher_get_pixel (pft, xi,   y, pixel[0]);
-      else
-        memset (pixel[0], 0, 4);
+      guchar pixel[2][4];
 
-      if (xi_a >= 0 && xi_a < width)
-        gimp_pixel_fetcher_get_pixel (pft, xi_a, y, pixel[1]);
-      else
-        memset (pixel[1], 0, 4);
+      src = gimp_pixel_fetcher_get_block (param->pft, xi, y, 2, 1, &rowstride);
+
+      memcpy (pixel[0], src,       bpp);
+      memcpy (pixel[1], src + bpp, bpp);
 
       average_two_pixels (dest, pixel, needx - xi, bpp, param->has_alpha);
     }
-
   else
     {
-      if (xi >= 0 && xi < width)
-        gimp_pixel_fetcher_get_pixel (pft, xi, y, dest);
-      else
-        memset (dest, 0, bpp);
+      src = gimp_pixel_fetcher_get_block (param->pft, xi, y, 1, 1, &rowstride);
+
+      memcpy (dest, src, bpp);
     }
 }
 
@@ -410,6 +351,24 @@ ripple (GimpDrawable *drawable,
                       (rvals.orientation == GIMP_ORIENTATION_VERTICAL));
     }
 
+  switch (rvals.edges)
+    {
+    case SMEAR:
+      gimp_pixel_fetcher_set_edge_mode (param.pft,
+                                        GIMP_PIXEL_FETCHER_EDGE_SMEAR);
+      break;
+
+    case WRAP:
+      gimp_pixel_fetcher_set_edge_mode (param.pft,
+                                        GIMP_PIXEL_FETCHER_EDGE_WRAP);
+      break;
+
+    case BLANK:
+      gimp_pixel_fetcher_set_edge_mode (param.pft,
+                                        GIMP_PIXEL_FETCHER_EDGE_BLACK);
+      break;
+    }
+
   if (preview)
     {
       guchar *buffer, *d;
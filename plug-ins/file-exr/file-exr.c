@@ -25,9 +25,27 @@
 #include "openexr-wrapper.h"
 
 #define LOAD_PROC       "file-exr-load"
+#define SAVE_PROC       "file-exr-save"
 #define PLUG_IN_BINARY  "file-exr"
+#define PLUG_IN_ROLE    "gimp-file-exr"
 #define PLUG_IN_VERSION "0.0.0"
 
+#define SAVE_TILE_SIZE  64
+
+
+typedef struct
+{
+  gint     compression;
+  gboolean mipmaps;
+} ExrSaveVals;
+
+typedef struct
+{
+  gint         n_parts;
+  GeglBuffer **buffers;
+  const Babl **formats;
+} ExrSaveData;
+
 
 /*
  * Declare some local functions.
@@ -42,6 +60,25 @@ static void     run              (const gchar      *name,
 static gint32   load_image       (const gchar      *filename,
                                   gboolean          interactive,
                                   GError          **error);
+static gboolean load_layer       (EXRLoader        *loader,
+                                  gint32            image,
+                                  gint              index,
+                                  gdouble           progress_start,
+                                  gdouble           progress_end);
+static gboolean load_dialog      (EXRLoader        *loader,
+                                  gboolean         *selected);
+
+static gboolean save_image       (const gchar      *filename,
+                                  gint32            image_ID,
+                                  GError          **error);
+static gint     save_read_func   (gint              part,
+                                  gint              level,
+                                  gint              y,
+                                  gint              width,
+                                  gint              height,
+                                  gchar            *pixels,
+                                  gpointer          user_data);
+static gboolean save_dialog      (void);
 
 static void     sanitize_comment (gchar            *comment);
 
@@ -57,6 +94,12 @@ const GimpPlugInInfo PLUG_IN_INFO =
   run,   /* run_proc   */
 };
 
+static ExrSaveVals exrsvals =
+{
+  COMPRESSION_PIZ, /* compression */
+  FALSE            /* mipmaps     */
+};
+
 
 MAIN ()
 
@@ -75,6 +118,17 @@ query (void)
     { GIMP_PDB_IMAGE, "image", "Output image" }
   };
 
+  static const GimpParamDef save_args[] =
+  {
+    { GIMP_PDB_INT32,    "run-mode",     "The run mode { RUN-INTERACTIVE (0), RUN-NONINTERACTIVE (1) }" },
+    { GIMP_PDB_IMAGE,    "image",        "Input image" },
+    { GIMP_PDB_DRAWABLE, "drawable",     "Drawable to save" },
+    { GIMP_PDB_STRING,   "filename",     "The name of the file to save the image in" },
+    { GIMP_PDB_STRING,   "raw-filename", "The name of the file to save the image in" },
+    { GIMP_PDB_INT32,    "compression",  "Compression type: { NONE (0), RLE (1), ZIP (2), PIZ (3), DWAA (4) }" },
+    { GIMP_PDB_INT32,    "mipmaps",      "Write mipmap levels (0/1)" }
+  };
+
   gimp_install_procedure (LOAD_PROC,
                           "Loads files in the OpenEXR file format",
                           "This plug-in loads OpenEXR files. ",
@@ -95,6 +149,23 @@ query (void)
                                     "exr",
                                     "",
                                     "0,long,0x762f3101");
+
+  gimp_install_procedure (SAVE_PROC,
+                          "Saves files in the OpenEXR file format",
+                          "This plug-in saves OpenEXR files.  Each layer "
+                          "is written as a tiled part, named after the "
+                          "layer.",
+                          "GIMP developers",
+                          "GIMP developers",
+                          PLUG_IN_VERSION,
+                          N_("OpenEXR image"),
+                          "RGB*, GRAY*",
+                          GIMP_PLUGIN,
+                          G_N_ELEMENTS (save_args), 0,
+                          save_args, NULL);
+
+  gimp_register_file_handler_mime (SAVE_PROC, "image/x-exr");
+  gimp_register_save_handler (SAVE_PROC, "exr", "");
 }
 
 static void
@@ -132,10 +203,89 @@ run (const gchar      *name,
           values[1].type = GIMP_PDB_IMAGE;
           values[1].data.d_image = image_ID;
         }
-      else
+      else if (error)
         {
           status = GIMP_PDB_EXECUTION_ERROR;
         }
+      else
+        {
+          status = GIMP_PDB_CANCEL;
+        }
+    }
+  else if (strcmp (name, SAVE_PROC) == 0)
+    {
+      gint32           image_ID    = param[1].data.d_int32;
+      gint32           drawable_ID = param[2].data.d_int32;
+      GimpExportReturn export      = GIMP_EXPORT_CANCEL;
+
+      run_mode = param[0].data.d_int32;
+
+      switch (run_mode)
+        {
+        case GIMP_RUN_INTERACTIVE:
+        case GIMP_RUN_WITH_LAST_VALS:
+          gimp_ui_init (PLUG_IN_BINARY, FALSE);
+
+          export = gimp_export_image (&image_ID, &drawable_ID, "OpenEXR",
+                                      GIMP_EXPORT_CAN_HANDLE_RGB   |
+                                      GIMP_EXPORT_CAN_HANDLE_GRAY  |
+                                      GIMP_EXPORT_CAN_HANDLE_ALPHA |
+                                      GIMP_EXPORT_CAN_HANDLE_LAYERS);
+
+          if (export == GIMP_EXPORT_CANCEL)
+            {
+              values[0].data.d_status = GIMP_PDB_CANCEL;
+              return;
+            }
+          break;
+
+        default:
+          break;
+        }
+
+      switch (run_mode)
+        {
+        case GIMP_RUN_INTERACTIVE:
+          gimp_get_data (SAVE_PROC, &exrsvals);
+
+          if (! save_dialog ())
+            status = GIMP_PDB_CANCEL;
+          break;
+
+        case GIMP_RUN_NONINTERACTIVE:
+          if (nparams == 7)
+            {
+              exrsvals.compression = param[5].data.d_int32;
+              exrsvals.mipmaps     = param[6].data.d_int32 ? TRUE : FALSE;
+
+              if (exrsvals.compression < COMPRESSION_NONE ||
+                  exrsvals.compression > COMPRESSION_DWAA)
+                status = GIMP_PDB_CALLING_ERROR;
+            }
+          else
+            {
+              status = GIMP_PDB_CALLING_ERROR;
+            }
+          break;
+
+        case GIMP_RUN_WITH_LAST_VALS:
+          gimp_get_data (SAVE_PROC, &exrsvals);
+          break;
+
+        default:
+          break;
+        }
+
+      if (status == GIMP_PDB_SUCCESS)
+        {
+          if (save_image (param[3].data.d_string, image_ID, &error))
+            gimp_set_data (SAVE_PROC, &exrsvals, sizeof (ExrSaveVals));
+          else
+            status = GIMP_PDB_EXECUTION_ERROR;
+        }
+
+      if (export == GIMP_EXPORT_EXPORT)
+        gimp_image_delete (image_ID);
     }
   else
     {
@@ -160,18 +310,14 @@ load_image (const gchar  *filename,
   EXRLoader        *loader;
   gint              width;
   gint              height;
-  gboolean          has_alpha;
   GimpImageBaseType image_type;
   GimpPrecision     image_precision;
   gint32            image = -1;
-  GimpImageType     layer_type;
-  gint32            layer;
-  const Babl       *format;
-  GeglBuffer       *buffer = NULL;
-  gint              bpp;
-  gint              tile_height;
-  gchar            *pixels = NULL;
-  gint              begin;
+  gint              n_layers;
+  gboolean         *selected = NULL;
+  gint              n_selected;
+  gint              n_loaded;
+  gint              i;
   gint32            success = FALSE;
   gchar            *comment;
   GimpMetadata     *metadata;
@@ -206,8 +352,6 @@ load_image (const gchar  *filename,
       goto out;
     }
 
-  has_alpha = exr_loader_has_alpha (loader) ? TRUE : FALSE;
-
   switch (exr_loader_get_precision (loader))
     {
     case PREC_UINT:
@@ -230,11 +374,9 @@ load_image (const gchar  *filename,
     {
     case IMAGE_TYPE_RGB:
       image_type = GIMP_RGB;
-      layer_type = has_alpha ? GIMP_RGBA_IMAGE : GIMP_RGB_IMAGE;
       break;
     case IMAGE_TYPE_GRAY:
       image_type = GIMP_GRAY;
-      layer_type = has_alpha ? GIMP_GRAYA_IMAGE : GIMP_GRAY_IMAGE;
       break;
     default:
       g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
@@ -243,6 +385,18 @@ load_image (const gchar  *filename,
       goto out;
     }
 
+  /*  only the first layer, the unprefixed channels if there are any, is
+   *  loaded by default; the header alone tells which other layers (AOVs)
+   *  the file has, and none of their pixels are decoded unless they
+   *  are picked in the dialog
+   */
+  n_layers = exr_loader_get_n_layers (loader);
+  selected = g_new0 (gboolean, n_layers);
+  selected[0] = TRUE;
+
+  if (interactive && n_layers > 1 && ! load_dialog (loader, selected))
+    goto out;
+
   image = gimp_image_new_with_precision (width, height,
                                          image_type, image_precision);
   if (image == -1)
@@ -255,47 +409,29 @@ load_image (const gchar  *filename,
 
   gimp_image_set_filename (image, filename);
 
-  layer = gimp_layer_new (image, _("Background"), width, height,
-                          layer_type, 100,
-                          gimp_image_get_default_new_layer_mode (image));
-  gimp_image_insert_layer (image, layer, -1, 0);
-
-  buffer = gimp_drawable_get_buffer (layer);
-  format = gimp_drawable_get_format (layer);
-  bpp = babl_format_get_bytes_per_pixel (format);
-
-  tile_height = gimp_tile_height ();
-  pixels = g_new0 (gchar, tile_height * width * bpp);
-
-  for (begin = 0; begin < height; begin += tile_height)
+  for (i = 0, n_selected = 0; i < n_layers; i++)
     {
-      gint end;
-      gint num;
-      gint i;
+      if (selected[i])
+        n_selected++;
+    }
 
-      end = MIN (begin + tile_height, height);
-      num = end - begin;
+  /*  insert the layers bottom-up, so that the first one ends up on top  */
+  for (i = n_layers - 1, n_loaded = 0; i >= 0; i--)
+    {
+      if (! selected[i])
+        continue;
 
-      for (i = 0; i < num; i++)
+      if (! load_layer (loader, image, i,
+                        (gdouble)  n_loaded      / (gdouble) n_selected,
+                        (gdouble) (n_loaded + 1) / (gdouble) n_selected))
         {
-          gint retval;
-
-          retval = exr_loader_read_pixel_row (loader,
-                                              pixels + (i * width * bpp),
-                                              bpp, begin + i);
-          if (retval < 0)
-            {
-              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                           _("Error reading pixel data from '%s'"),
-                           gimp_filename_to_utf8 (filename));
-              goto out;
-            }
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Error reading pixel data from '%s'"),
+                       gimp_filename_to_utf8 (filename));
+          goto out;
         }
 
-      gegl_buffer_set (buffer, GEGL_RECTANGLE (0, begin, width, num),
-                       0, NULL, pixels, GEGL_AUTO_ROWSTRIDE);
-
-      gimp_progress_update ((gdouble) begin / (gdouble) height);
+      n_loaded++;
     }
 
   /* try to load an icc profile, it will be generated on the fly if
@@ -377,11 +513,7 @@ load_image (const gchar  *filename,
   success = TRUE;
 
  out:
-  if (buffer)
-    g_object_unref (buffer);
-
-  if (pixels)
-    g_free (pixels);
+  g_free (selected);
 
   if (loader)
     exr_loader_unref (loader);
@@ -395,6 +527,406 @@ load_image (const gchar  *filename,
   return -1;
 }
 
+static gboolean
+load_layer (EXRLoader *loader,
+            gint32     image,
+            gint       index,
+            gdouble    progress_start,
+            gdouble    progress_end)
+{
+  const gchar   *name;
+  gboolean       has_alpha;
+  GimpImageType  layer_type;
+  gint32         layer;
+  const Babl    *format;
+  GeglBuffer    *buffer;
+  gint           width;
+  gint           height;
+  gint           bpp;
+  gint           band_height;
+  gint           n_bands;
+  gboolean       decreasing_y;
+  gchar         *pixels;
+  gint           band;
+  gboolean       success = TRUE;
+
+  name      = exr_loader_get_layer_name (loader, index);
+  has_alpha = exr_loader_layer_has_alpha (loader, index) ? TRUE : FALSE;
+  width     = gimp_image_width  (image);
+  height    = gimp_image_height (image);
+
+  if (gimp_image_base_type (image) == GIMP_GRAY)
+    layer_type = has_alpha ? GIMP_GRAYA_IMAGE : GIMP_GRAY_IMAGE;
+  else
+    layer_type = has_alpha ? GIMP_RGBA_IMAGE : GIMP_RGB_IMAGE;
+
+  layer = gimp_layer_new (image,
+                          name && *name ? name : _("Background"),
+                          width, height,
+                          layer_type, 100,
+                          gimp_image_get_default_new_layer_mode (image));
+  gimp_image_insert_layer (image, layer, -1, 0);
+
+  /*  only the first layer is visible, the others are usually AOVs  */
+  if (index > 0)
+    gimp_item_set_visible (layer, FALSE);
+
+  /*  read the layer's pixels in its own channel layout and type, and
+   *  let gegl_buffer_set() convert them to the layer's format
+   */
+  switch (exr_loader_get_layer_precision (loader, index))
+    {
+    case PREC_UINT:
+      format = babl_type ("u32");
+      break;
+    case PREC_HALF:
+      format = babl_type ("half");
+      break;
+    case PREC_FLOAT:
+    default:
+      format = babl_type ("float");
+      break;
+    }
+
+  if (exr_loader_get_layer_image_type (loader, index) == IMAGE_TYPE_GRAY)
+    format = babl_format_new (babl_model (has_alpha ? "YA" : "Y"),
+                              format,
+                              babl_component ("Y"),
+                              has_alpha ? babl_component ("A") : NULL,
+                              NULL);
+  else
+    format = babl_format_new (babl_model (has_alpha ? "RGBA" : "RGB"),
+                              format,
+                              babl_component ("R"),
+                              babl_component ("G"),
+                              babl_component ("B"),
+                              has_alpha ? babl_component ("A") : NULL,
+                              NULL);
+
+  buffer = gimp_drawable_get_buffer (layer);
+  bpp    = babl_format_get_bytes_per_pixel (format);
+
+  /*  read the pixels in bands aligned to the file's tiles or line
+   *  blocks, at least a tile high, and in the file's own line order, so
+   *  that OpenEXR decodes each band in one go, using all cores
+   */
+  band_height  = exr_loader_get_band_height (loader);
+  band_height *= MAX (1, (gimp_tile_height () + band_height - 1) / band_height);
+  n_bands      = (height + band_height - 1) / band_height;
+  decreasing_y = exr_loader_is_decreasing_y (loader);
+
+  pixels = g_new0 (gchar, (gsize) band_height * width * bpp);
+
+  for (band = 0; band < n_bands; band++)
+    {
+      gint begin;
+      gint num;
+
+      if (decreasing_y)
+        begin = (n_bands - band - 1) * band_height;
+      else
+        begin = band * band_height;
+
+      num = MIN (begin + band_height, height) - begin;
+
+      if (exr_loader_read_pixel_rows (loader, index,
+                                      pixels, bpp, begin, num) < 0)
+        {
+          success = FALSE;
+          break;
+        }
+
+      gegl_buffer_set (buffer, GEGL_RECTANGLE (0, begin, width, num),
+                       0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+
+      gimp_progress_update (progress_start +
+                            (progress_end - progress_start) *
+                            (gdouble) (band + 1) / (gdouble) n_bands);
+    }
+
+  g_free (pixels);
+  g_object_unref (buffer);
+
+  return success;
+}
+
+static gboolean
+load_dialog (EXRLoader *loader,
+             gboolean  *selected)
+{
+  GtkWidget *dialog;
+  GtkWidget *vbox;
+  GtkWidget *label;
+  GtkWidget *scrolled_window;
+  GtkWidget *list_box;
+  gint       n_layers;
+  gint       i;
+  gboolean   run;
+
+  gimp_ui_init (PLUG_IN_BINARY, FALSE);
+
+  n_layers = exr_loader_get_n_layers (loader);
+
+  dialog = gimp_dialog_new (_("Open OpenEXR Layers"), PLUG_IN_ROLE,
+                            NULL, 0,
+                            gimp_standard_help_func, LOAD_PROC,
+
+                            _("_Cancel"), GTK_RESPONSE_CANCEL,
+                            _("_Open"),   GTK_RESPONSE_OK,
+
+                            NULL);
+
+  gimp_window_set_transient (GTK_WINDOW (dialog));
+
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (vbox), 12);
+  gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
+                      vbox, TRUE, TRUE, 0);
+  gtk_widget_show (vbox);
+
+  label = gtk_label_new (_("Select the layers to open:"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+  gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
+  gtk_widget_show (label);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+  gtk_widget_set_size_request (scrolled_window, -1, 240);
+  gtk_box_pack_start (GTK_BOX (vbox), scrolled_window, TRUE, TRUE, 0);
+  gtk_widget_show (scrolled_window);
+
+  list_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 2);
+  gtk_container_set_border_width (GTK_CONTAINER (list_box), 6);
+  gtk_scrolled_window_add_with_viewport (GTK_SCROLLED_WINDOW (scrolled_window),
+                                         list_box);
+  gtk_widget_show (list_box);
+
+  for (i = 0; i < n_layers; i++)
+    {
+      const gchar *name = exr_loader_get_layer_name (loader, i);
+      GtkWidget   *toggle;
+
+      toggle = gtk_check_button_new_with_label (name && *name ?
+                                                name : _("Background"));
+      gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (toggle), selected[i]);
+      gtk_box_pack_start (GTK_BOX (list_box), toggle, FALSE, FALSE, 0);
+      gtk_widget_show (toggle);
+
+      g_signal_connect (toggle, "toggled",
+                        G_CALLBACK (gimp_toggle_button_update),
+                        &selected[i]);
+    }
+
+  gtk_widget_show (dialog);
+
+  run = (gimp_dialog_run (GIMP_DIALOG (dialog)) == GTK_RESPONSE_OK);
+
+  gtk_widget_destroy (dialog);
+
+  /*  opening no layer at all makes no sense  */
+  for (i = 0; run && i < n_layers; i++)
+    {
+      if (selected[i])
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+save_image (const gchar  *filename,
+            gint32        image_ID,
+            GError      **error)
+{
+  EXRSaver     *saver;
+  ExrSaveData   data;
+  gint         *layers;
+  gint          n_layers;
+  EXRImageType  image_type;
+  EXRPrecision  precision;
+  gboolean      success = FALSE;
+  gint          i;
+
+  gimp_progress_init_printf (_("Exporting '%s'"),
+                             gimp_filename_to_utf8 (filename));
+
+  layers = gimp_image_get_layers (image_ID, &n_layers);
+
+  if (gimp_image_base_type (image_ID) == GIMP_GRAY)
+    image_type = IMAGE_TYPE_GRAY;
+  else
+    image_type = IMAGE_TYPE_RGB;
+
+  /*  EXR only has half, float and uint channels; integer images are
+   *  written as half, which represents their values losslessly
+   */
+  switch (gimp_image_get_precision (image_ID))
+    {
+    case GIMP_PRECISION_U8_LINEAR:
+    case GIMP_PRECISION_U8_GAMMA:
+    case GIMP_PRECISION_U16_LINEAR:
+    case GIMP_PRECISION_U16_GAMMA:
+    case GIMP_PRECISION_HALF_LINEAR:
+    case GIMP_PRECISION_HALF_GAMMA:
+      precision = PREC_HALF;
+      break;
+
+    default:
+      precision = PREC_FLOAT;
+      break;
+    }
+
+  saver = exr_saver_new (exrsvals.compression, SAVE_TILE_SIZE,
+                         exrsvals.mipmaps);
+
+  data.n_parts = n_layers;
+  data.buffers = g_new0 (GeglBuffer *, n_layers);
+  data.formats = g_new0 (const Babl *, n_layers);
+
+  for (i = 0; saver && i < n_layers; i++)
+    {
+      gboolean has_alpha = gimp_drawable_has_alpha (layers[i]);
+      gint     offset_x;
+      gint     offset_y;
+
+      gimp_drawable_offsets (layers[i], &offset_x, &offset_y);
+
+      if (exr_saver_add_part (saver, gimp_item_get_name (layers[i]),
+                              offset_x, offset_y,
+                              gimp_drawable_width  (layers[i]),
+                              gimp_drawable_height (layers[i]),
+                              image_type, has_alpha, precision) < 0)
+        goto out;
+
+      data.buffers[i] = gimp_drawable_get_buffer (layers[i]);
+      data.formats[i] = babl_format_new (
+        babl_model (image_type == IMAGE_TYPE_GRAY ?
+                    (has_alpha ? "YA"   : "Y")    :
+                    (has_alpha ? "RGBA" : "RGB")),
+        babl_type (precision == PREC_HALF ? "half" : "float"),
+        NULL);
+    }
+
+  /*  the pixels are pulled from the layers' buffers a row of tiles at a
+   *  time while writing, rather than through an interleaved copy of the
+   *  whole image
+   */
+  if (saver &&
+      exr_saver_write (saver, filename,
+                       gimp_image_width  (image_ID),
+                       gimp_image_height (image_ID),
+                       save_read_func, &data) == 0)
+    {
+      success = TRUE;
+    }
+
+ out:
+  if (! success)
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                 _("Error writing to file '%s'"),
+                 gimp_filename_to_utf8 (filename));
+
+  for (i = 0; i < n_layers; i++)
+    {
+      if (data.buffers[i])
+        g_object_unref (data.buffers[i]);
+    }
+
+  g_free (data.buffers);
+  g_free (data.formats);
+  g_free (layers);
+
+  if (saver)
+    exr_saver_free (saver);
+
+  gimp_progress_update (1.0);
+
+  return success;
+}
+
+static gint
+save_read_func (gint      part,
+                gint      level,
+                gint      y,
+                gint      width,
+                gint      height,
+                gchar    *pixels,
+                gpointer  user_data)
+{
+  ExrSaveData *data = user_data;
+  GeglBuffer  *buffer = data->buffers[part];
+
+  /*  lower mipmap levels are read straight from the buffer's own
+   *  box-filtered mipmap
+   */
+  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, y, width, height),
+                   1.0 / (gdouble) (1 << level),
+                   data->formats[part], pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (level == 0)
+    {
+      gimp_progress_update (((gdouble) part +
+                             (gdouble) (y + height) /
+                             (gdouble) gegl_buffer_get_height (buffer)) /
+                            (gdouble) data->n_parts);
+    }
+
+  return 0;
+}
+
+static gboolean
+save_dialog (void)
+{
+  GtkWidget *dialog;
+  GtkWidget *vbox;
+  GtkWidget *frame;
+  GtkWidget *toggle;
+  gboolean   run;
+
+  dialog = gimp_export_dialog_new (_("OpenEXR"), PLUG_IN_BINARY, SAVE_PROC);
+
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (vbox), 12);
+  gtk_box_pack_start (GTK_BOX (gimp_export_dialog_get_content_area (dialog)),
+                      vbox, TRUE, TRUE, 0);
+  gtk_widget_show (vbox);
+
+  frame = gimp_int_radio_group_new (TRUE, _("Compression"),
+                                    G_CALLBACK (gimp_radio_button_update),
+                                    &exrsvals.compression,
+                                    exrsvals.compression,
+
+                                    _("_None"), COMPRESSION_NONE, NULL,
+                                    _("_RLE"),  COMPRESSION_RLE,  NULL,
+                                    _("_ZIP"),  COMPRESSION_ZIP,  NULL,
+                                    _("_PIZ"),  COMPRESSION_PIZ,  NULL,
+                                    _("_DWAA"), COMPRESSION_DWAA, NULL,
+
+                                    NULL);
+  gtk_box_pack_start (GTK_BOX (vbox), frame, FALSE, FALSE, 0);
+  gtk_widget_show (frame);
+
+  toggle = gtk_check_button_new_with_mnemonic (_("Write _mipmap levels"));
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (toggle),
+                                exrsvals.mipmaps);
+  gtk_box_pack_start (GTK_BOX (vbox), toggle, FALSE, FALSE, 0);
+  gtk_widget_show (toggle);
+
+  g_signal_connect (toggle, "toggled",
+                    G_CALLBACK (gimp_toggle_button_update),
+                    &exrsvals.mipmaps);
+
+  gtk_widget_show (dialog);
+
+  run = (gimp_dialog_run (GIMP_DIALOG (dialog)) == GTK_RESPONSE_OK);
+
+  gtk_widget_destroy (dialog);
+
+  return run;
+}
+
 /* copy & pasted from file-jpeg/jpeg-load.c */
 static void
 sanitize_comment (gchar *comment)
@@ -13,11 +13,18 @@
 
 #include <ImfInputFile.h>
 #include <ImfChannelList.h>
+#include <ImfMultiPartOutputFile.h>
+#include <ImfPartType.h>
 #include <ImfRgbaFile.h>
 #include <ImfRgbaYca.h>
 #include <ImfStandardAttributes.h>
+#include <ImfThreading.h>
+#include <ImfTiledOutputPart.h>
 
+#include <exception>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "exr-attribute-blob.h"
 
@@ -36,117 +43,183 @@ static bool XYZ_equal(cmsCIEXYZ *a, cmsCIEXYZ *b)
 
 struct _EXRLoader
 {
+  // A group of channels loaded as one GIMP layer: the unprefixed
+  // channels, or the channels of one EXR layer ("diffuse.R", ...).
+  struct Layer
+  {
+    std::string name;
+    std::string prefix;
+    EXRImageType image_type;
+    bool has_alpha;
+    PixelType pt;
+    int bpc;
+  };
+
   _EXRLoader(const char* filename) :
     refcount_(1),
     file_(filename),
     data_window_(file_.header().dataWindow()),
     channels_(file_.header().channels())
   {
-    const Channel* chan;
+    std::set<std::string> layer_names;
+    Layer layer;
 
-    if (channels_.findChannel("R") ||
-        channels_.findChannel("G") ||
-        channels_.findChannel("B"))
-      {
-        format_string_ = "RGB";
-        image_type_ = IMAGE_TYPE_RGB;
+    // This only looks at the header, no pixel data is decoded until a
+    // layer is actually read.
+    if (describeLayer("", layer))
+      layers_.push_back(layer);
 
-        if ((chan = channels_.findChannel("R")))
-          pt_ = chan->type;
-        else if ((chan = channels_.findChannel("G")))
-          pt_ = chan->type;
-        else
-          pt_ = channels_.findChannel("B")->type;
-      }
-    else if (channels_.findChannel("Y") &&
-             (channels_.findChannel("RY") ||
-              channels_.findChannel("BY")))
+    channels_.layers(layer_names);
+
+    for (std::set<std::string>::const_iterator i = layer_names.begin();
+         i != layer_names.end();
+         ++i)
       {
-        format_string_ = "RGB";
-        image_type_ = IMAGE_TYPE_RGB;
+        if (describeLayer(*i, layer))
+          layers_.push_back(layer);
+      }
 
-        pt_ = channels_.findChannel("Y")->type;
+    if (layers_.empty())
+      throw std::exception();
+  }
 
-        // FIXME: no chroma handling for now.
-        throw;
-      }
-    else if (channels_.findChannel("Y"))
+  bool describeLayer(const std::string& name,
+                     Layer& layer) const
+  {
+    const std::string prefix = name.empty() ? name : name + ".";
+    const Channel* chan;
+
+    layer.name = name;
+    layer.prefix = prefix;
+
+    if (findChannel(prefix, "R") ||
+        findChannel(prefix, "G") ||
+        findChannel(prefix, "B"))
       {
-        format_string_ = "Y";
-        image_type_ = IMAGE_TYPE_GRAY;
+        layer.image_type = IMAGE_TYPE_RGB;
 
-        pt_ = channels_.findChannel("Y")->type;
+        if ((chan = findChannel(prefix, "R")))
+          layer.pt = chan->type;
+        else if ((chan = findChannel(prefix, "G")))
+          layer.pt = chan->type;
+        else
+          layer.pt = findChannel(prefix, "B")->type;
       }
-    else
+    else if (findChannel(prefix, "Y") &&
+             (findChannel(prefix, "RY") ||
+              findChannel(prefix, "BY")))
       {
-        throw;
+        // FIXME: no chroma handling for now.
+        return false;
       }
-
-    if (channels_.findChannel("A"))
+    else if ((chan = findChannel(prefix, "Y")))
       {
-        format_string_.append("A");
-        has_alpha_ = true;
+        layer.image_type = IMAGE_TYPE_GRAY;
+        layer.pt = chan->type;
       }
     else
       {
-        has_alpha_ = false;
+        return false;
       }
 
-    switch (pt_)
+    layer.has_alpha = findChannel(prefix, "A") != NULL;
+
+    switch (layer.pt)
       {
       case UINT:
-        format_string_.append(" u32");
-        bpc_ = 4;
+      case FLOAT:
+        layer.bpc = 4;
         break;
       case HALF:
-        format_string_.append(" half");
-        bpc_ = 2;
+        layer.bpc = 2;
         break;
-      case FLOAT:
       default:
-        format_string_.append(" float");
-        bpc_ = 4;
+        layer.pt = FLOAT;
+        layer.bpc = 4;
       }
+
+    return true;
+  }
+
+  const Channel* findChannel(const std::string& prefix,
+                             const char* name) const
+  {
+    return channels_.findChannel((prefix + name).c_str());
   }
 
-  int readPixelRow(char* pixels,
-                   int bpp,
-                   int row)
+  int readPixelRows(int index,
+                    char* pixels,
+                    int bpp,
+                    int row,
+                    int n_rows)
   {
+    const Layer& layer = layers_.at(index);
+    const std::string& prefix = layer.prefix;
+    const PixelType pt = layer.pt;
+    const int bpc = layer.bpc;
     const int actual_row = data_window_.min.y + row;
+    const size_t stride = (size_t) getWidth() * bpp;
     FrameBuffer fb;
     // This is necessary because OpenEXR expects the buffer to begin at
     // (0, 0). Though it probably results in some unmapped address,
     // hopefully OpenEXR will not make use of it. :/
-    char* base = pixels - (data_window_.min.x * bpp);
+    char* base = pixels - (data_window_.min.x * bpp) - (actual_row * stride);
 
-    switch (image_type_)
+    // Only the layer's own channels are put into the frame buffer, so
+    // the channels of other layers are never converted.
+    switch (layer.image_type)
       {
       case IMAGE_TYPE_GRAY:
-        fb.insert("Y", Slice(pt_, base, bpp, 0, 1, 1, 0.5));
-        if (hasAlpha())
+        fb.insert(prefix + "Y", Slice(pt, base, bpp, stride, 1, 1, 0.5));
+        if (layer.has_alpha)
           {
-            fb.insert("A", Slice(pt_, base + bpc_, bpp, 0, 1, 1, 1.0));
+            fb.insert(prefix + "A", Slice(pt, base + bpc, bpp, stride, 1, 1, 1.0));
           }
         break;
 
       case IMAGE_TYPE_RGB:
       default:
-        fb.insert("R", Slice(pt_, base + (bpc_ * 0), bpp, 0, 1, 1, 0.0));
-        fb.insert("G", Slice(pt_, base + (bpc_ * 1), bpp, 0, 1, 1, 0.0));
-        fb.insert("B", Slice(pt_, base + (bpc_ * 2), bpp, 0, 1, 1, 0.0));
-        if (hasAlpha())
+        fb.insert(prefix + "R", Slice(pt, base + (bpc * 0), bpp, stride, 1, 1, 0.0));
+        fb.insert(prefix + "G", Slice(pt, base + (bpc * 1), bpp, stride, 1, 1, 0.0));
+        fb.insert(prefix + "B", Slice(pt, base + (bpc * 2), bpp, stride, 1, 1, 0.0));
+        if (layer.has_alpha)
           {
-            fb.insert("A", Slice(pt_, base + (bpc_ * 3), bpp, 0, 1, 1, 1.0));
+            fb.insert(prefix + "A", Slice(pt, base + (bpc * 3), bpp, stride, 1, 1, 1.0));
           }
       }
 
+    // Reading a whole band at once lets OpenEXR decompress all the line
+    // blocks or tiles it covers in parallel, on its global thread pool.
     file_.setFrameBuffer(fb);
-    file_.readPixels(actual_row);
+    file_.readPixels(actual_row, actual_row + n_rows - 1);
 
     return 0;
   }
 
+  int getBandHeight() const {
+    const Header& header = file_.header();
+
+    // Bands aligned to the file's tiles or line blocks don't decompress
+    // any chunk twice.  256 rows is a multiple of the line-block height
+    // of every compression method.
+    if (header.hasTileDescription())
+      return MAX (header.tileDescription().ySize, 1);
+
+    return 256;
+  }
+
+  bool isDecreasingY() const {
+    return file_.header().lineOrder() == DECREASING_Y;
+  }
+
+  int getNLayers() const {
+    return layers_.size();
+  }
+
+  const char* getLayerName(int index) const {
+    return layers_.at(index).name.c_str();
+  }
+
   int getWidth() const {
     return data_window_.max.x - data_window_.min.x + 1;
   }
@@ -155,10 +228,10 @@ struct _EXRLoader
     return data_window_.max.y - data_window_.min.y + 1;
   }
 
-  EXRPrecision getPrecision() const {
+  EXRPrecision getPrecision(int index) const {
     EXRPrecision prec;
 
-    switch (pt_)
+    switch (layers_.at(index).pt)
       {
       case UINT:
         prec = PREC_UINT;
@@ -174,12 +247,12 @@ struct _EXRLoader
     return prec;
   }
 
-  EXRImageType getImageType() const {
-    return image_type_;
+  EXRImageType getImageType(int index) const {
+    return layers_.at(index).image_type;
   }
 
-  int hasAlpha() const {
-    return has_alpha_ ? 1 : 0;
+  int hasAlpha(int index) const {
+    return layers_.at(index).has_alpha ? 1 : 0;
   }
 
   GimpColorProfile *getProfile() const {
@@ -338,11 +411,219 @@ struct _EXRLoader
   InputFile file_;
   const Box2i data_window_;
   const ChannelList& channels_;
-  PixelType pt_;
-  int bpc_;
-  EXRImageType image_type_;
-  bool has_alpha_;
-  std::string format_string_;
+  std::vector<Layer> layers_;
+};
+
+struct _EXRSaver
+{
+  struct Part
+  {
+    std::string name;
+    Box2i data_window;
+    EXRImageType image_type;
+    bool has_alpha;
+    PixelType pt;
+    int bpc;
+  };
+
+  _EXRSaver(EXRCompression compression,
+            int tile_size,
+            bool mipmaps) :
+    tile_size_(tile_size),
+    mipmaps_(mipmaps)
+  {
+    switch (compression)
+      {
+      case COMPRESSION_NONE:
+        compression_ = NO_COMPRESSION;
+        break;
+      case COMPRESSION_RLE:
+        compression_ = RLE_COMPRESSION;
+        break;
+      case COMPRESSION_ZIP:
+        compression_ = ZIP_COMPRESSION;
+        break;
+      case COMPRESSION_DWAA:
+        compression_ = DWAA_COMPRESSION;
+        break;
+      case COMPRESSION_PIZ:
+      default:
+        compression_ = PIZ_COMPRESSION;
+      }
+  }
+
+  void addPart(const char* name,
+               int x,
+               int y,
+               int width,
+               int height,
+               EXRImageType image_type,
+               bool has_alpha,
+               EXRPrecision precision)
+  {
+    Part part;
+
+    part.name = name;
+    part.data_window = Box2i(V2i(x, y), V2i(x + width - 1, y + height - 1));
+    part.image_type = image_type;
+    part.has_alpha = has_alpha;
+
+    switch (precision)
+      {
+      case PREC_UINT:
+        part.pt = UINT;
+        part.bpc = 4;
+        break;
+      case PREC_HALF:
+        part.pt = HALF;
+        part.bpc = 2;
+        break;
+      case PREC_FLOAT:
+      default:
+        part.pt = FLOAT;
+        part.bpc = 4;
+      }
+
+    parts_.push_back(part);
+  }
+
+  int write(const char* filename,
+            int width,
+            int height,
+            EXRReadFunc read_func,
+            void* user_data)
+  {
+    const Box2i display_window(V2i(0, 0), V2i(width - 1, height - 1));
+    std::vector<Header> headers;
+
+    if (parts_.empty())
+      return -1;
+
+    for (size_t i = 0; i < parts_.size(); i++)
+      {
+        const Part& part = parts_[i];
+        Header header(display_window, part.data_window,
+                      1, V2f(0, 0), 1, INCREASING_Y, compression_);
+
+        header.setName(part.name);
+        header.setType(TILEDIMAGE);
+        header.setTileDescription(
+          TileDescription(tile_size_, tile_size_,
+                          mipmaps_ ? MIPMAP_LEVELS : ONE_LEVEL,
+                          ROUND_DOWN));
+
+        switch (part.image_type)
+          {
+          case IMAGE_TYPE_GRAY:
+            header.channels().insert("Y", Channel(part.pt));
+            break;
+
+          case IMAGE_TYPE_RGB:
+          default:
+            header.channels().insert("R", Channel(part.pt));
+            header.channels().insert("G", Channel(part.pt));
+            header.channels().insert("B", Channel(part.pt));
+          }
+
+        if (part.has_alpha)
+          header.channels().insert("A", Channel(part.pt));
+
+        headers.push_back(header);
+      }
+
+    MultiPartOutputFile file(filename, &headers[0], headers.size());
+
+    for (size_t i = 0; i < parts_.size(); i++)
+      {
+        if (writePart(file, i, read_func, user_data) < 0)
+          return -1;
+      }
+
+    return 0;
+  }
+
+  // Writes the part one row of tiles at a time, so that only a band of
+  // pixels is ever held in memory, while OpenEXR compresses the tiles of
+  // each row in parallel.
+  int writePart(MultiPartOutputFile& file,
+                int index,
+                EXRReadFunc read_func,
+                void* user_data)
+  {
+    const Part& part = parts_[index];
+    TiledOutputPart out(file, index);
+    int n_channels;
+    int bpp;
+
+    if (part.image_type == IMAGE_TYPE_GRAY)
+      n_channels = 1;
+    else
+      n_channels = 3;
+
+    if (part.has_alpha)
+      n_channels++;
+
+    bpp = part.bpc * n_channels;
+
+    for (int level = 0; level < out.numLevels(); level++)
+      {
+        const Box2i level_window = out.dataWindowForLevel(level);
+        const int level_width = level_window.max.x - level_window.min.x + 1;
+        const size_t stride = (size_t) level_width * bpp;
+        std::vector<char> band(stride * tile_size_);
+
+        for (int ty = 0; ty < out.numYTiles(level); ty++)
+          {
+            const Box2i tile_window = out.dataWindowForTile(0, ty, level);
+            const int rows = tile_window.max.y - tile_window.min.y + 1;
+            FrameBuffer fb;
+            char* base;
+
+            if (read_func(index, level,
+                          tile_window.min.y - level_window.min.y,
+                          level_width, rows,
+                          &band[0], user_data) < 0)
+              return -1;
+
+            // As for reading, OpenEXR expects the buffer to begin at (0, 0).
+            base = &band[0] - (level_window.min.x * bpp) -
+                   (tile_window.min.y * stride);
+
+            switch (part.image_type)
+              {
+              case IMAGE_TYPE_GRAY:
+                fb.insert("Y", Slice(part.pt, base, bpp, stride));
+                if (part.has_alpha)
+                  {
+                    fb.insert("A", Slice(part.pt, base + part.bpc,
+                                         bpp, stride));
+                  }
+                break;
+
+              case IMAGE_TYPE_RGB:
+              default:
+                fb.insert("R", Slice(part.pt, base + (part.bpc * 0), bpp, stride));
+                fb.insert("G", Slice(part.pt, base + (part.bpc * 1), bpp, stride));
+                fb.insert("B", Slice(part.pt, base + (part.bpc * 2), bpp, stride));
+                if (part.has_alpha)
+                  {
+                    fb.insert("A", Slice(part.pt, base + (part.bpc * 3),
+                                         bpp, stride));
+                  }
+              }
+
+            out.setFrameBuffer(fb);
+            out.writeTiles(0, out.numXTiles(level) - 1, ty, ty, level);
+          }
+      }
+
+    return 0;
+  }
+
+  std::vector<Part> parts_;
+  Compression compression_;
+  int tile_size_;
+  bool mipmaps_;
 };
 
 EXRLoader*
@@ -354,6 +635,7 @@ exr_loader_new (const char *filename)
   try
     {
       Imf::BlobAttribute::registerAttributeType();
+      Imf::setGlobalThreadCount(g_get_num_processors ());
       file = new EXRLoader(filename);
     }
   catch (...)
@@ -417,22 +699,98 @@ exr_loader_get_height (EXRLoader *loader)
 EXRImageType
 exr_loader_get_image_type (EXRLoader *loader)
 {
-  // This does not throw.
-  return loader->getImageType();
+  return exr_loader_get_layer_image_type (loader, 0);
 }
 
 EXRPrecision
 exr_loader_get_precision (EXRLoader *loader)
 {
-  // This does not throw.
-  return loader->getPrecision();
+  return exr_loader_get_layer_precision (loader, 0);
 }
 
 int
 exr_loader_has_alpha (EXRLoader *loader)
+{
+  return exr_loader_layer_has_alpha (loader, 0);
+}
+
+int
+exr_loader_get_n_layers (EXRLoader *loader)
 {
   // This does not throw.
-  return loader->hasAlpha();
+  return loader->getNLayers();
+}
+
+const char *
+exr_loader_get_layer_name (EXRLoader *loader,
+                           int layer)
+{
+  const char *name;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      name = loader->getLayerName(layer);
+    }
+  catch (...)
+    {
+      name = NULL;
+    }
+
+  return name;
+}
+
+EXRImageType
+exr_loader_get_layer_image_type (EXRLoader *loader,
+                                 int layer)
+{
+  EXRImageType image_type;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      image_type = loader->getImageType(layer);
+    }
+  catch (...)
+    {
+      image_type = IMAGE_TYPE_RGB;
+    }
+
+  return image_type;
+}
+
+EXRPrecision
+exr_loader_get_layer_precision (EXRLoader *loader,
+                                int layer)
+{
+  EXRPrecision precision;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      precision = loader->getPrecision(layer);
+    }
+  catch (...)
+    {
+      precision = PREC_FLOAT;
+    }
+
+  return precision;
+}
+
+int
+exr_loader_layer_has_alpha (EXRLoader *loader,
+                            int layer)
+{
+  int has_alpha;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      has_alpha = loader->hasAlpha(layer);
+    }
+  catch (...)
+    {
+      has_alpha = 0;
+    }
+
+  return has_alpha;
 }
 
 GimpColorProfile *
@@ -462,16 +820,107 @@ exr_loader_get_xmp (EXRLoader *loader,
 }
 
 int
-exr_loader_read_pixel_row (EXRLoader *loader,
-                           char *pixels,
-                           int bpp,
-                           int row)
+exr_loader_get_band_height (EXRLoader *loader)
+{
+  // This does not throw.
+  return loader->getBandHeight();
+}
+
+int
+exr_loader_is_decreasing_y (EXRLoader *loader)
+{
+  // This does not throw.
+  return loader->isDecreasingY() ? 1 : 0;
+}
+
+int
+exr_loader_read_pixel_rows (EXRLoader *loader,
+                            int layer,
+                            char *pixels,
+                            int bpp,
+                            int row,
+                            int n_rows)
+{
+  int retval = -1;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      retval = loader->readPixelRows(layer, pixels, bpp, row, n_rows);
+    }
+  catch (...)
+    {
+      retval = -1;
+    }
+
+  return retval;
+}
+
+EXRSaver *
+exr_saver_new (EXRCompression compression,
+               int tile_size,
+               int mipmaps)
+{
+  EXRSaver* saver;
+
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      Imf::setGlobalThreadCount(g_get_num_processors ());
+      saver = new EXRSaver(compression, tile_size, mipmaps ? true : false);
+    }
+  catch (...)
+    {
+      saver = NULL;
+    }
+
+  return saver;
+}
+
+void
+exr_saver_free (EXRSaver *saver)
+{
+  delete saver;
+}
+
+int
+exr_saver_add_part (EXRSaver *saver,
+                    const char *name,
+                    int x,
+                    int y,
+                    int width,
+                    int height,
+                    EXRImageType image_type,
+                    int has_alpha,
+                    EXRPrecision precision)
+{
+  int retval = 0;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      saver->addPart(name, x, y, width, height,
+                     image_type, has_alpha ? true : false, precision);
+    }
+  catch (...)
+    {
+      retval = -1;
+    }
+
+  return retval;
+}
+
+int
+exr_saver_write (EXRSaver *saver,
+                 const char *filename,
+                 int width,
+                 int height,
+                 EXRReadFunc read_func,
+                 void *user_data)
 {
   int retval = -1;
   // Don't let any exceptions propagate to the C layer.
   try
     {
-      retval = loader->readPixelRow(pixels, bpp, row);
+      retval = saver->write(filename, width, height, read_func, user_data);
     }
   catch (...)
     {
@@ -14,6 +14,7 @@ extern "C" {
  * exposed to more than this.
  */
 typedef struct _EXRLoader EXRLoader;
+typedef struct _EXRSaver  EXRSaver;
 
 typedef enum {
   PREC_UINT,
@@ -26,6 +27,26 @@ typedef enum {
   IMAGE_TYPE_GRAY
 } EXRImageType;
 
+typedef enum {
+  COMPRESSION_NONE,
+  COMPRESSION_RLE,
+  COMPRESSION_ZIP,
+  COMPRESSION_PIZ,
+  COMPRESSION_DWAA
+} EXRCompression;
+
+/* Fills the band of rows [y, y + height) of the given mipmap level of a
+ * part, in the part's own coordinates, with interleaved pixels.
+ * Returns 0 on success, a negative value to abort writing.
+ */
+typedef int (* EXRReadFunc) (int   part,
+                             int   level,
+                             int   y,
+                             int   width,
+                             int   height,
+                             char *pixels,
+                             void *user_data);
+
 EXRLoader *
 exr_loader_new (const char *filename);
 
@@ -50,6 +71,25 @@ exr_loader_get_image_type (EXRLoader *loader);
 int
 exr_loader_has_alpha (EXRLoader *loader);
 
+int
+exr_loader_get_n_layers (EXRLoader *loader);
+
+const char *
+exr_loader_get_layer_name (EXRLoader *loader,
+                           int layer);
+
+EXRImageType
+exr_loader_get_layer_image_type (EXRLoader *loader,
+                                 int layer);
+
+EXRPrecision
+exr_loader_get_layer_precision (EXRLoader *loader,
+                                int layer);
+
+int
+exr_loader_layer_has_alpha (EXRLoader *loader,
+                            int layer);
+
 GimpColorProfile *
 exr_loader_get_profile (EXRLoader *loader);
 
@@ -65,10 +105,45 @@ exr_loader_get_xmp (EXRLoader *loader,
                     guint *size);
 
 int
-exr_loader_read_pixel_row (EXRLoader *loader,
-                           char *pixels,
-                           int bpp,
-                           int row);
+exr_loader_get_band_height (EXRLoader *loader);
+
+int
+exr_loader_is_decreasing_y (EXRLoader *loader);
+
+int
+exr_loader_read_pixel_rows (EXRLoader *loader,
+                            int layer,
+                            char *pixels,
+                            int bpp,
+                            int row,
+                            int n_rows);
+
+EXRSaver *
+exr_saver_new (EXRCompression compression,
+               int tile_size,
+               int mipmaps);
+
+void
+exr_saver_free (EXRSaver *saver);
+
+int
+exr_saver_add_part (EXRSaver *saver,
+                    const char *name,
+                    int x,
+                    int y,
+                    int width,
+                    int height,
+                    EXRImageType image_type,
+                    int has_alpha,
+                    EXRPrecision precision);
+
+int
+exr_saver_write (EXRSaver *saver,
+                 const char *filename,
+                 int width,
+                 int height,
+                 EXRReadFunc read_func,
+                 void *user_data);
 
 #ifdef __cplusplus
 }
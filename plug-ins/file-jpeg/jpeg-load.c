@@ -46,6 +46,10 @@ static gboolean  jpeg_load_resolution       (gint32    image_ID,
 
 static void      jpeg_load_sanitize_comment (gchar    *comment);
 
+static gint      jpeg_load_scale_denom      (struct jpeg_decompress_struct
+                                                       *cinfo,
+                                             gint      size_hint);
+
 static gpointer  jpeg_load_cmyk_transform   (guint8   *profile_data,
                                              gsize     profile_len);
 static void      jpeg_load_cmyk_to_rgb      (guchar   *buf,
@@ -59,6 +63,7 @@ gint32
 load_image (const gchar  *filename,
             GimpRunMode   runmode,
             gboolean      preview,
+            gint          size_hint,
             gboolean     *resolution_loaded,
             GError      **error)
 {
@@ -75,6 +80,7 @@ load_image (const gchar  *filename,
   GeglBuffer      *buffer = NULL;
   const Babl      *format;
   gint             tile_height;
+  gint             scale_denom;
   gint             i;
   cmsHTRANSFORM    cmyk_transform = NULL;
 
@@ -160,6 +166,18 @@ load_image (const gchar  *filename,
 
   cinfo.dct_method = JDCT_FLOAT;
 
+  /* Step 4.1: when a reduced size will do, let the IDCT do the
+   * downscaling, which skips most of the decoding work
+   */
+  scale_denom = jpeg_load_scale_denom (&cinfo, size_hint);
+
+  if (scale_denom > 1)
+    {
+      cinfo.scale_num   = 1;
+      cinfo.scale_denom = scale_denom;
+      cinfo.dct_method  = JDCT_IFAST;
+    }
+
   /* Step 5: Start decompressor */
 
   jpeg_start_decompress (&cinfo);
@@ -295,6 +313,21 @@ load_image (const gchar  *filename,
             *resolution_loaded = TRUE;
         }
 
+      /* keep the physical size of a reduced image */
+      if (scale_denom > 1)
+        {
+          gdouble xresolution;
+          gdouble yresolution;
+
+          gimp_image_get_resolution (image_ID, &xresolution, &yresolution);
+          gimp_image_set_resolution (image_ID,
+                                     xresolution / scale_denom,
+                                     yresolution / scale_denom);
+
+          if (resolution_loaded)
+            *resolution_loaded = TRUE;
+        }
+
       /* if we found any comments, then make a parasite for them */
       if (comment_buffer && comment_buffer->len)
         {
@@ -512,8 +545,29 @@ jpeg_load_sanitize_comment (gchar *comment)
     }
 }
 
+/* Picks the largest of the IDCT's 1/2, 1/4 and 1/8 scale factors
+ * which still leaves the image at least size_hint pixels on its
+ * longer side; returns 1 for a full size load.
+ */
+static gint
+jpeg_load_scale_denom (struct jpeg_decompress_struct *cinfo,
+                       gint                           size_hint)
+{
+  gint size  = MAX (cinfo->image_width, cinfo->image_height);
+  gint denom = 1;
+
+  if (size_hint <= 0)
+    return 1;
+
+  while (denom < 8 && (size + 2 * denom - 1) / (2 * denom) >= size_hint)
+    denom *= 2;
+
+  return denom;
+}
+
 gint32
 load_thumbnail_image (GFile         *file,
+                      gint           size,
                       gint          *width,
                       gint          *height,
                       GimpImageType *type,
@@ -527,9 +581,29 @@ load_thumbnail_image (GFile         *file,
   gimp_progress_init_printf (_("Opening thumbnail for '%s'"),
                              g_file_get_parse_name (file));
 
-  image_ID = gimp_image_metadata_load_thumbnail (file, error);
+  image_ID = gimp_image_metadata_load_thumbnail (file, NULL);
+
+  /*  an Exif thumbnail smaller than requested would only be upscaled  */
+  if (image_ID > 0 &&
+      MAX (gimp_image_width (image_ID), gimp_image_height (image_ID)) < size)
+    {
+      gimp_image_delete (image_ID);
+      image_ID = -1;
+    }
+
+  /*  otherwise, decode the image itself at reduced size  */
   if (image_ID < 1)
-    return -1;
+    {
+      gchar *filename = g_file_get_path (file);
+
+      image_ID = load_image (filename, GIMP_RUN_NONINTERACTIVE, FALSE,
+                             size, NULL, error);
+
+      g_free (filename);
+
+      if (image_ID < 1)
+        return -1;
+    }
 
   cinfo.err = jpeg_std_error (&jerr.pub);
   jerr.pub.error_exit     = my_error_exit;
@@ -75,7 +75,8 @@ query (void)
   {
     { GIMP_PDB_INT32,    "run-mode",     "The run mode { RUN-INTERACTIVE (0), RUN-NONINTERACTIVE (1) }" },
     { GIMP_PDB_STRING,   "filename",     "The name of the file to load" },
-    { GIMP_PDB_STRING,   "raw-filename", "The name of the file to load" }
+    { GIMP_PDB_STRING,   "raw-filename", "The name of the file to load" },
+    { GIMP_PDB_INT32,    "size-hint",    "Load at a reduced size of at least this many pixels on the longer side, for previews (0 = full size)" }
   };
   static const GimpParamDef load_return_vals[] =
   {
@@ -133,7 +134,8 @@ query (void)
 
   gimp_install_procedure (LOAD_THUMB_PROC,
                           "Loads a thumbnail from a JPEG image",
-                          "Loads a thumbnail from a JPEG image (only if it exists)",
+                          "Loads the Exif thumbnail from a JPEG image, or "
+                          "decodes the image at a reduced size if it has none",
                           "Mukund Sivaraman <muks@mukund.org>, Sven Neumann <sven@gimp.org>",
                           "Mukund Sivaraman <muks@mukund.org>, Sven Neumann <sven@gimp.org>",
                           "November 15, 2004",
@@ -211,6 +213,7 @@ run (const gchar      *name,
         }
 
       image_ID = load_image (param[1].data.d_string, run_mode, FALSE,
+                             nparams > 3 ? param[3].data.d_int32 : 0,
                              &resolution_loaded, &error);
 
       if (image_ID != -1)
@@ -259,7 +262,8 @@ run (const gchar      *name,
           gint          height = 0;
           GimpImageType type   = -1;
 
-          image_ID = load_thumbnail_image (file, &width, &height, &type,
+          image_ID = load_thumbnail_image (file, param[1].data.d_int32,
+                                           &width, &height, &type,
                                            &error);
 
           g_object_unref (file);
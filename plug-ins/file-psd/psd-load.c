@@ -99,6 +99,15 @@ static gint             read_channel_data          (PSDchannel     *channel,
                                                     guint32         comp_len,
                                                     GError        **error);
 
+static gint             read_layer_bands           (gint32         layer_id,
+                                                    PSDimage      *img_a,
+                                                    PSDchannel   **lyr_chn,
+                                                    const guint16 *channel_idx,
+                                                    guint16        layer_channels,
+                                                    gboolean       alpha,
+                                                    FILE          *f,
+                                                    GError       **error);
+
 static void             convert_1_bit              (const gchar *src,
                                                     gchar       *dst,
                                                     guint32      rows,
@@ -1127,6 +1136,7 @@ add_layers (gint32     image_id,
   gint32                lm_w;                  /* Layer mask width */
   gint32                lm_h;                  /* Layer mask height */
   gint32                layer_size;
+  glong                 layer_end;
   gint32                layer_id = -1;
   gint32                mask_id = -1;
   gint32                active_layer_id = -1;
@@ -1216,6 +1226,9 @@ add_layers (gint32     image_id,
               lyr_chn[cidx]->rows = lyr_a[lidx]->bottom - lyr_a[lidx]->top;
               lyr_chn[cidx]->columns = lyr_a[lidx]->right - lyr_a[lidx]->left;
               lyr_chn[cidx]->data = NULL;
+              lyr_chn[cidx]->compression = PSD_COMP_RAW;
+              lyr_chn[cidx]->data_start = -1;
+              lyr_chn[cidx]->rle_pack_len = NULL;
 
               if (lyr_chn[cidx]->id == PSD_CHANNEL_EXTRA_MASK)
                 {
@@ -1273,11 +1286,40 @@ add_layers (gint32     image_id,
                 }
               if (lyr_a[lidx]->chn_info[cidx].data_len > COMP_MODE_SIZE)
                 {
+                  gboolean streamed;
+
+                  /* Raw and RLE pixel channels are not decoded into
+                   * full-size planes here, but only located in the
+                   * file, and decoded straight into interleaved bands
+                   * by read_layer_bands()
+                   */
+                  streamed = (lyr_chn[cidx]->id != PSD_CHANNEL_MASK &&
+                              img_a->bps >= 8                       &&
+                              lyr_chn[cidx]->rows > 0               &&
+                              lyr_chn[cidx]->columns > 0            &&
+                              lyr_chn[cidx]->rows <= G_MAXINT32 /
+                                                     lyr_chn[cidx]->columns /
+                                                     (img_a->bps / 8));
+
                   switch (comp_mode)
                     {
                       case PSD_COMP_RAW:        /* Planar raw data */
                         IFDBG(3) g_debug ("Raw data length: %d",
                                           lyr_a[lidx]->chn_info[cidx].data_len - 2);
+                        if (streamed)
+                          {
+                            /* Decoded band by band when drawing the layer */
+                            lyr_chn[cidx]->compression = PSD_COMP_RAW;
+                            lyr_chn[cidx]->data_start = ftell (f);
+                            if (fseek (f, lyr_a[lidx]->chn_info[cidx].data_len - 2,
+                                       SEEK_CUR) < 0)
+                              {
+                                psd_set_error (feof (f), errno, error);
+                                return -1;
+                              }
+                            break;
+                          }
+
                         if (read_channel_data (lyr_chn[cidx], img_a->bps,
                                                PSD_COMP_RAW, NULL, f, 0,
                                                error) < 1)
@@ -1303,6 +1345,22 @@ add_layers (gint32     image_id,
                             rle_pack_len[rowi] = GUINT16_FROM_BE (rle_pack_len[rowi]);
                           }
 
+                        if (streamed)
+                          {
+                            /* Decoded band by band when drawing the layer */
+                            lyr_chn[cidx]->compression = PSD_COMP_RLE;
+                            lyr_chn[cidx]->data_start = ftell (f);
+                            lyr_chn[cidx]->rle_pack_len = rle_pack_len;
+                            if (fseek (f, lyr_a[lidx]->chn_info[cidx].data_len - 2 -
+                                          lyr_chn[cidx]->rows * 2,
+                                       SEEK_CUR) < 0)
+                              {
+                                psd_set_error (feof (f), errno, error);
+                                return -1;
+                              }
+                            break;
+                          }
+
                         IFDBG(3) g_debug ("RLE decode - data");
                         if (read_channel_data (lyr_chn[cidx], img_a->bps,
                                                PSD_COMP_RLE, rle_pack_len, f, 0,
@@ -1330,6 +1388,9 @@ add_layers (gint32     image_id,
                 }
             }
 
+          /* The layer's undecoded channel data is read out of order */
+          layer_end = ftell (f);
+
           /* Draw layer */
 
           alpha = FALSE;
@@ -1360,7 +1421,7 @@ add_layers (gint32     image_id,
                   alpha = TRUE;
                   alpha_chn = cidx;
                 }
-              else if (lyr_chn[cidx]->data)
+              else if (lyr_chn[cidx]->data || lyr_chn[cidx]->data_start >= 0)
                 {
                   channel_idx[layer_channels] = cidx;   /* Assumes in sane order */
                   layer_channels++;                     /* RGB, Lab, CMYK etc.   */
@@ -1507,29 +1568,16 @@ add_layers (gint32     image_id,
                     }
                   else
                     {
-                      layer_size = l_w * l_h;
-                      bps = img_a->bps / 8;
-                      if (bps == 0)
-                        bps++;
-                      pixels = g_malloc (layer_size * layer_channels * bps);
-                      for (cidx = 0; cidx < layer_channels; ++cidx)
+                      if (read_layer_bands (layer_id, img_a, lyr_chn,
+                                            channel_idx, layer_channels,
+                                            alpha, f, error) < 0)
+                        return -1;
+
+                      if (fseek (f, layer_end, SEEK_SET) < 0)
                         {
-                          IFDBG(3) g_debug ("Start channel %d", channel_idx[cidx]);
-                          for (i = 0; i < layer_size; ++i)
-                            memcpy (&pixels[((i * layer_channels) + cidx) * bps],
-                                    &lyr_chn[channel_idx[cidx]]->data[i * bps], bps);
-                          g_free (lyr_chn[channel_idx[cidx]]->data);
+                          psd_set_error (feof (f), errno, error);
+                          return -1;
                         }
-
-                      buffer = gimp_drawable_get_buffer (layer_id);
-                      gegl_buffer_set (buffer,
-                                       GEGL_RECTANGLE (0, 0,
-                                                       gegl_buffer_get_width (buffer),
-                                                       gegl_buffer_get_height (buffer)),
-                                       0, get_layer_format (img_a, alpha),
-                                       pixels, GEGL_AUTO_ROWSTRIDE);
-                      g_object_unref (buffer);
-                      g_free (pixels);
                     }
                 }
 
@@ -1647,7 +1695,10 @@ add_layers (gint32     image_id,
 
           for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
             if (lyr_chn[cidx])
-              g_free (lyr_chn[cidx]);
+              {
+                g_free (lyr_chn[cidx]->rle_pack_len);
+                g_free (lyr_chn[cidx]);
+              }
           g_free (lyr_chn);
         }
       g_free (lyr_a[lidx]->chn_info);
@@ -2040,6 +2091,178 @@ zzfree (voidpf opaque, voidpf address)
   g_free (address);
 }
 
+static gint
+read_layer_bands (gint32         layer_id,
+                  PSDimage      *img_a,
+                  PSDchannel   **lyr_chn,
+                  const guint16 *channel_idx,
+                  guint16        layer_channels,
+                  gboolean       alpha,
+                  FILE          *f,
+                  GError       **error)
+{
+  GeglBuffer *buffer;
+  glong       offsets[MAX_CHANNELS];
+  gchar      *pixels;
+  gchar      *line;
+  gchar      *src      = NULL;
+  gsize       src_size = 0;
+  guint32     rows;
+  guint32     columns;
+  guint32     readline_len;
+  gint        band_height;
+  gint        begin;
+  gint        bps;
+  gint        cidx;
+  gint        i, j;
+  gint        ret = 0;
+
+  rows         = lyr_chn[channel_idx[0]]->rows;
+  columns      = lyr_chn[channel_idx[0]]->columns;
+  bps          = MAX (img_a->bps / 8, 1);
+  readline_len = columns * bps;
+  band_height  = gimp_tile_height ();
+
+  for (cidx = 0; cidx < layer_channels; ++cidx)
+    offsets[cidx] = lyr_chn[channel_idx[cidx]]->data_start;
+
+  pixels = g_malloc0 ((gsize) band_height * columns * layer_channels * bps);
+  line   = g_malloc (readline_len);
+  buffer = gimp_drawable_get_buffer (layer_id);
+
+  for (begin = 0; begin < rows; begin += band_height)
+    {
+      gint num = MIN (band_height, rows - begin);
+
+      for (cidx = 0; cidx < layer_channels; ++cidx)
+        {
+          PSDchannel  *chn = lyr_chn[channel_idx[cidx]];
+          const gchar *packed;
+
+          /* A channel without any data stays zero */
+          if (! chn->data && chn->data_start < 0)
+            continue;
+
+          /* Read all of the band's packed rows of the channel at once */
+          if (! chn->data)
+            {
+              gsize len = 0;
+
+              if (chn->compression == PSD_COMP_RLE)
+                {
+                  for (i = 0; i < num; ++i)
+                    len += chn->rle_pack_len[begin + i];
+                }
+              else
+                {
+                  len = (gsize) readline_len * num;
+                }
+
+              if (len > src_size)
+                {
+                  src      = g_realloc (src, len);
+                  src_size = len;
+                }
+
+              if (fseek (f, offsets[cidx], SEEK_SET) < 0 ||
+                  (len > 0 && fread (src, len, 1, f) < 1))
+                {
+                  psd_set_error (feof (f), errno, error);
+                  ret = -1;
+                  goto out;
+                }
+
+              offsets[cidx] += len;
+            }
+
+          packed = src;
+
+          for (i = 0; i < num; ++i)
+            {
+              const gchar *row;
+              gchar       *dst;
+
+              dst = pixels + ((gsize) i * columns * layer_channels + cidx) * bps;
+
+              /* Channels decoded by read_channel_data() are already in
+               * native byte order
+               */
+              if (chn->data)
+                {
+                  row = chn->data + (gsize) (begin + i) * readline_len;
+
+                  for (j = 0; j < columns; ++j)
+                    memcpy (dst + j * layer_channels * bps, row + j * bps, bps);
+
+                  continue;
+                }
+
+              if (chn->compression == PSD_COMP_RLE)
+                {
+                  /* FIXME check for errors returned from decode packbits */
+                  decode_packbits (packed, line,
+                                   chn->rle_pack_len[begin + i], readline_len);
+                  row = line;
+                  packed += chn->rle_pack_len[begin + i];
+                }
+              else
+                {
+                  row = packed;
+                  packed += readline_len;
+                }
+
+              switch (bps)
+                {
+                case 4:
+                  for (j = 0; j < columns; ++j)
+                    {
+                      guint32 value;
+
+                      memcpy (&value, row + j * 4, 4);
+                      value = GUINT32_FROM_BE (value);
+                      memcpy (dst + j * layer_channels * 4, &value, 4);
+                    }
+                  break;
+
+                case 2:
+                  for (j = 0; j < columns; ++j)
+                    {
+                      guint16 value;
+
+                      memcpy (&value, row + j * 2, 2);
+                      value = GUINT16_FROM_BE (value);
+                      memcpy (dst + j * layer_channels * 2, &value, 2);
+                    }
+                  break;
+
+                default:
+                  for (j = 0; j < columns; ++j)
+                    dst[j * layer_channels] = row[j];
+                  break;
+                }
+            }
+        }
+
+      gegl_buffer_set (buffer, GEGL_RECTANGLE (0, begin, columns, num),
+                       0, get_layer_format (img_a, alpha),
+                       pixels, GEGL_AUTO_ROWSTRIDE);
+    }
+
+ out:
+  for (cidx = 0; cidx < layer_channels; ++cidx)
+    {
+      g_free (lyr_chn[channel_idx[cidx]]->data);
+      lyr_chn[channel_idx[cidx]]->data = NULL;
+    }
+
+  g_object_unref (buffer);
+  g_free (src);
+  g_free (line);
+  g_free (pixels);
+
+  return ret;
+}
+
 static gint
 read_channel_data (PSDchannel     *channel,
                    guint16         bps,
@@ -132,8 +132,25 @@ typedef struct PsdImageData
   PSD_Layer         *lLayers;     /* Layer list */
 } PSD_Image_Data;
 
+/* The RLE compression of one channel of a band of rows */
+typedef struct PsdCompressJob
+{
+  const guchar *data;         /* First sample of the band's channel */
+  gint32        width;        /* Columns */
+  gint32        rows;         /* Rows in the band */
+  gint32        stride;       /* Bytes per pixel of data */
+  gint16       *lengths;      /* Compressed length of each band row */
+  guchar       *scratch;      /* Compressed band */
+  GByteArray   *rle;          /* Compressed rows of the channel so far */
+} PSD_Compress_Job;
+
 static PSD_Image_Data PSDImageData;
 
+static GThreadPool *compress_pool    = NULL;
+static GMutex       compress_mutex;
+static GCond        compress_cond;
+static gint         compress_pending = 0;
+
 /* Declare some local functions.
  */
 
@@ -194,6 +211,11 @@ static void          write_pixel_data     (FILE          *fd,
                                            gint32         rowlenOffset,
                                            gboolean       write_mask);
 
+static void          compress_job_func    (PSD_Compress_Job *job,
+                                           gpointer          user_data);
+static void          compress_jobs        (PSD_Compress_Job *jobs,
+                                           gint              n_jobs);
+
 static gint32        create_merged_image  (gint32         imageID);
 
 static const Babl  * get_pixel_format     (gint32         drawableID);
@@ -1178,6 +1200,60 @@ save_layer_and_mask (FILE   *fd,
   fseek (fd, eof_pos, SEEK_SET);
 }
 
+static void
+compress_job_func (PSD_Compress_Job *job,
+                   gpointer          user_data)
+{
+  gint32 len;
+
+  len = get_compress_channel_data ((guchar *) job->data,
+                                   job->width,
+                                   job->rows,
+                                   job->stride,
+                                   job->lengths,
+                                   job->scratch);
+
+  g_byte_array_append (job->rle, job->scratch, len);
+
+  g_mutex_lock (&compress_mutex);
+
+  if (--compress_pending == 0)
+    g_cond_signal (&compress_cond);
+
+  g_mutex_unlock (&compress_mutex);
+}
+
+/* Compresses the jobs in parallel, and waits for all of them */
+static void
+compress_jobs (PSD_Compress_Job *jobs,
+               gint              n_jobs)
+{
+  gint i;
+
+  if (! compress_pool)
+    {
+      compress_pool = g_thread_pool_new ((GFunc) compress_job_func, NULL,
+                                         g_get_num_processors (),
+                                         FALSE, NULL);
+    }
+
+  g_mutex_lock (&compress_mutex);
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      if (jobs[i].rows > 0)
+        {
+          compress_pending++;
+          g_thread_pool_push (compress_pool, &jobs[i], NULL);
+        }
+    }
+
+  while (compress_pending > 0)
+    g_cond_wait (&compress_cond, &compress_mutex);
+
+  g_mutex_unlock (&compress_mutex);
+}
+
 static void
 write_pixel_data (FILE     *fd,
                   gint32    drawableID,
@@ -1185,21 +1261,27 @@ write_pixel_data (FILE     *fd,
                   gint32    ltable_offset,
                   gboolean  write_mask)
 {
-  GeglBuffer   *buffer = gimp_drawable_get_buffer (drawableID);
-  const Babl   *format;
-  gint32        maskID;
-  gint32        tile_height = gimp_tile_height ();
-  gint32        height = gegl_buffer_get_height (buffer);
-  gint32        width  = gegl_buffer_get_width (buffer);
-  gint32        bytes;
-  gint32        colors;
-  gint32        y;
-  gint32        len;                  /* Length of compressed data */
-  gint16       *LengthsTable;         /* Lengths of every compressed row */
-  guchar       *rledata;              /* Compressed data from a region */
-  guchar       *data;                 /* Temporary copy of pixel data */
-  glong         length_table_pos;     /* position in file of the length table */
-  int           i, j;
+  GeglBuffer       *buffer = gimp_drawable_get_buffer (drawableID);
+  GeglBuffer       *mbuffer = NULL;
+  const Babl       *format;
+  const Babl       *mformat = NULL;
+  gint32            maskID;
+  gint32            tile_height = gimp_tile_height ();
+  gint32            height = gegl_buffer_get_height (buffer);
+  gint32            width  = gegl_buffer_get_width (buffer);
+  gint32            mheight = 0;
+  gint32            mwidth  = 0;
+  gint32            bytes;
+  gint32            colors;
+  gint32            y;
+  gint32            len;              /* Length of compressed data */
+  gint              n_chans;          /* Channels, including the mask */
+  PSD_Compress_Job *jobs;             /* Compression of every channel */
+  gint16          **LengthsTable;     /* Lengths of every compressed row */
+  guchar           *data;             /* Temporary copy of pixel data */
+  guchar           *mdata = NULL;     /* Temporary copy of mask data */
+  glong             length_table_pos; /* position in file of the length table */
+  int               i, j;
 
   IFDBG printf (" Function: write_pixel_data, drw %d, lto %d\n",
                 drawableID, ltable_offset);
@@ -1209,8 +1291,16 @@ write_pixel_data (FILE     *fd,
   else
     maskID = -1;
 
+  if (maskID != -1)
+    {
+      mbuffer = gimp_drawable_get_buffer (maskID);
+      mformat = get_mask_format (maskID);
+      mwidth  = width;
+      mheight = height;
+    }
+
   /* groups have empty channel data, but may have a mask */
-  if (gimp_item_is_group (drawableID) && maskID == -1)
+  if (gimp_item_is_group (drawableID))
     {
       width  = 0;
       height = 0;
@@ -1229,104 +1319,99 @@ write_pixel_data (FILE     *fd,
       ! gimp_drawable_is_indexed (drawableID))
     colors -= 1;
 
-  LengthsTable = g_new (gint16, height);
-  rledata = g_new (guchar, (MIN (height, tile_height) *
-                            (width + 10 + (width / 100))));
+  n_chans = bytes + (maskID != -1 ? 1 : 0);
 
-  data = g_new (guchar, MIN (height, tile_height) * width * bytes);
+  /* The channels are written one after the other, so each band of
+   * pixels is fetched only once, its channels are compressed in
+   * parallel, and the compressed rows are kept until all bands are
+   * done
+   */
+  jobs         = g_new0 (PSD_Compress_Job, n_chans);
+  LengthsTable = g_new0 (gint16 *, n_chans);
 
-  /* groups have empty channel data */
-  if (gimp_item_is_group (drawableID))
+  for (i = 0; i < n_chans; i++)
     {
-      width  = 0;
-      height = 0;
+      gint32 chan_width  = (i < bytes) ? width  : mwidth;
+      gint32 chan_height = (i < bytes) ? height : mheight;
+
+      LengthsTable[i]  = g_new0 (gint16, MAX (chan_height, 1));
+      jobs[i].width    = chan_width;
+      jobs[i].stride   = (i < bytes) ? bytes : 1;
+      jobs[i].scratch  = g_new (guchar, (MIN (chan_height, tile_height) *
+                                         (chan_width + 10 + (chan_width / 100))) + 1);
+      jobs[i].rle      = g_byte_array_new ();
     }
 
-  for (i = 0; i < bytes; i++)
-    {
-      gint chan;
+  data = g_new (guchar, MIN (height, tile_height) * width * bytes + 1);
 
-      len = 0;
+  if (maskID != -1)
+    mdata = g_new (guchar, MIN (mheight, tile_height) * mwidth + 1);
 
-      if (bytes != colors && ltable_offset == 0) /* Need to write alpha channel first, except in image data section */
+  for (y = 0; y < MAX (height, mheight); y += tile_height)
+    {
+      for (i = 0; i < bytes; i++)
         {
-          if (i == 0)
+          gint chan;
+
+          if (bytes != colors && ltable_offset == 0) /* Need to write alpha channel first, except in image data section */
             {
-              chan = bytes - 1;
+              if (i == 0)
+                {
+                  chan = bytes - 1;
+                }
+              else
+                {
+                  chan = i - 1;
+                }
             }
           else
             {
-              chan = i - 1;
+              chan = i;
             }
-        }
-      else
-        {
-          chan = i;
-        }
 
-      if (ChanLenPosition)
-        {
-          write_gint16 (fd, 1, "Compression type (RLE)");
-          len += 2;
+          jobs[i].data    = &data[chan];
+          jobs[i].rows    = CLAMP (height - y, 0, tile_height);
+          jobs[i].lengths = jobs[i].rows > 0 ? &LengthsTable[i][y] : NULL;
         }
 
-      if (ltable_offset > 0)
+      if (jobs[0].rows > 0)
         {
-          length_table_pos = ltable_offset + 2 * chan * height;
-        }
-      else
-        {
-          length_table_pos = ftell(fd);
-
-          xfwrite (fd, LengthsTable, height * sizeof(gint16),
-                   "Dummy RLE length");
-          len += height * sizeof(gint16);
-          IF_DEEP_DBG printf ("\t\t\t\t. ltable, pos %ld len %d\n", length_table_pos, len);
-        }
-
-      for (y = 0; y < height; y += tile_height)
-        {
-          int tlen;
           gegl_buffer_get (buffer,
-                           GEGL_RECTANGLE (0, y,
-                                           width,
-                                           MIN (height - y, tile_height)),
+                           GEGL_RECTANGLE (0, y, width, jobs[0].rows),
                            1.0, format, data,
                            GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-          tlen = get_compress_channel_data (&data[chan],
-                                             width,
-                                             MIN(height - y, tile_height),
-                                             bytes,
-                                             &LengthsTable[y],
-                                             rledata);
-          len += tlen;
-          xfwrite (fd, rledata, tlen, "Compressed pixel data");
-          IF_DEEP_DBG printf ("\t\t\t\t. Writing compressed pixels, stream of %d\n", tlen);
         }
 
-      /* Write compressed lengths table */
-      fseek (fd, length_table_pos, SEEK_SET);
-      for (j = 0; j < height; j++) /* write real length table */
-        write_gint16 (fd, LengthsTable[j], "RLE length");
-
-      if (ChanLenPosition)    /* Update total compressed length */
+      /* Write layer mask, as last channel, id -2 */
+      if (maskID != -1)
         {
-          fseek (fd, ChanLenPosition[i], SEEK_SET);
-          write_gint32 (fd, len, "channel data length");
-          IFDBG printf ("\t\tUpdating data len to %d\n", len);
+          jobs[bytes].data    = mdata;
+          jobs[bytes].rows    = CLAMP (mheight - y, 0, tile_height);
+          jobs[bytes].lengths = (jobs[bytes].rows > 0 ?
+                                 &LengthsTable[bytes][y] : NULL);
+
+          if (jobs[bytes].rows > 0)
+            {
+              gegl_buffer_get (mbuffer,
+                               GEGL_RECTANGLE (0, y, mwidth, jobs[bytes].rows),
+                               1.0, mformat, mdata,
+                               GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+            }
         }
-      fseek (fd, 0, SEEK_END);
-      IF_DEEP_DBG printf ("\t\t\t\t. Cur pos %ld\n", ftell(fd));
+
+      compress_jobs (jobs, n_chans);
     }
 
-  /* Write layer mask, as last channel, id -2 */
-  if (maskID != -1)
+  for (i = 0; i < n_chans; i++)
     {
-      GeglBuffer *mbuffer = gimp_drawable_get_buffer (maskID);
-      const Babl *mformat = get_mask_format(maskID);
+      gint32 chan_height = (i < bytes) ? height : mheight;
+      gint   chan;
 
-      width  = gegl_buffer_get_width (buffer);
-      height = gegl_buffer_get_height (buffer);
+      /* the mask's length table follows a gap of one channel */
+      if (i < bytes)
+        chan = i;
+      else
+        chan = bytes + 1;
 
       len = 0;
 
@@ -1334,72 +1419,57 @@ write_pixel_data (FILE     *fd,
         {
           write_gint16 (fd, 1, "Compression type (RLE)");
           len += 2;
-          IF_DEEP_DBG printf ("\t\t\t\t. ChanLenPos, len %d\n", len);
         }
 
       if (ltable_offset > 0)
         {
-          length_table_pos = ltable_offset + 2 * (bytes+1) * height;
-          IF_DEEP_DBG printf ("\t\t\t\t. ltable, pos %ld\n",
-                              length_table_pos);
+          /* the length tables of all channels precede the data */
+          length_table_pos = ltable_offset + 2 * chan * chan_height;
+
+          fseek (fd, length_table_pos, SEEK_SET);
+          for (j = 0; j < chan_height; j++)
+            write_gint16 (fd, LengthsTable[i][j], "RLE length");
+          fseek (fd, 0, SEEK_END);
         }
       else
         {
-          length_table_pos = ftell(fd);
-
-          xfwrite (fd, LengthsTable, height * sizeof(gint16),
-                   "Dummy RLE length");
-          len += height * sizeof(gint16);
-          IF_DEEP_DBG printf ("\t\t\t\t. ltable, pos %ld len %d\n",
-                              length_table_pos, len);
+          for (j = 0; j < chan_height; j++)
+            write_gint16 (fd, LengthsTable[i][j], "RLE length");
+          len += chan_height * sizeof (gint16);
         }
 
-      for (y = 0; y < height; y += tile_height)
-        {
-          int tlen;
-          gegl_buffer_get (mbuffer,
-                           GEGL_RECTANGLE (0, y,
-                                           width,
-                                           MIN (height - y, tile_height)),
-                           1.0, mformat, data,
-                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-          tlen = get_compress_channel_data (&data[0],
-                                            width,
-                                            MIN(height - y, tile_height),
-                                            1,
-                                            &LengthsTable[y],
-                                            rledata);
-          len += tlen;
-          xfwrite (fd, rledata, tlen, "Compressed mask data");
-          IF_DEEP_DBG printf ("\t\t\t\t. Writing compressed mask, stream of %d\n", tlen);
-        }
-
-      /* Write compressed lengths table */
-      fseek (fd, length_table_pos, SEEK_SET); /*POS WHERE???*/
-      for (j = 0; j < height; j++) /* write real length table */
-        {
-          write_gint16 (fd, LengthsTable[j], "RLE length");
-          IF_DEEP_DBG printf ("\t\t\t\t. Updating RLE len %d\n",
-                              LengthsTable[j]);
-        }
+      xfwrite (fd, jobs[i].rle->data, jobs[i].rle->len,
+               "Compressed pixel data");
+      len += jobs[i].rle->len;
 
       if (ChanLenPosition)    /* Update total compressed length */
         {
-          fseek (fd, ChanLenPosition[bytes], SEEK_SET); /*+bytes OR SOMETHING*/
+          fseek (fd, ChanLenPosition[i], SEEK_SET);
           write_gint32 (fd, len, "channel data length");
-          IFDBG printf ("\t\tUpdating data len to %d, at %ld\n", len, ftell(fd));
+          IFDBG printf ("\t\tUpdating data len to %d\n", len);
+          fseek (fd, 0, SEEK_END);
         }
-      fseek (fd, 0, SEEK_END);
+
       IF_DEEP_DBG printf ("\t\t\t\t. Cur pos %ld\n", ftell(fd));
+    }
 
-      g_object_unref (mbuffer);
+  for (i = 0; i < n_chans; i++)
+    {
+      g_free (LengthsTable[i]);
+      g_free (jobs[i].scratch);
+      g_byte_array_free (jobs[i].rle, TRUE);
     }
 
+  g_free (LengthsTable);
+  g_free (jobs);
+
+  if (mbuffer)
+    g_object_unref (mbuffer);
+
   g_object_unref (buffer);
 
   g_free (data);
-  g_free (rledata);
-  g_free (LengthsTable);
+  g_free (mdata);
 }
 
 static void
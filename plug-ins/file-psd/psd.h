@@ -607,6 +607,9 @@ typedef struct
   gchar        *data;                   /* Channel image data */
   guint32       rows;                   /* Channel rows */
   guint32       columns;                /* Channel columns */
+  guint16       compression;            /* Compression of undecoded data */
+  glong         data_start;             /* File offset of undecoded data */
+  guint16      *rle_pack_len;           /* Packed row lengths (RLE only) */
 } PSDchannel;
 
 /* PSD Channel data structure */
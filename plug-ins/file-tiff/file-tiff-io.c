@@ -66,53 +66,79 @@ static gint      tiff_io_close         (thandle_t    handle);
 static toff_t    tiff_io_get_file_size (thandle_t    handle);
 
 
-static TiffIO tiff_io = { 0, };
+/* the thread that opened the first handle; libtiff messages raised
+ * on any other thread (parallel strip decoding) go to stderr only
+ */
+static GThread *tiff_io_main_thread = NULL;
 
 
+/* every handle gets its own TiffIO, so that several handles on the
+ * same file can be open at once, e.g. one per decoding thread
+ */
 TIFF *
 tiff_open (GFile        *file,
            const gchar  *mode,
            GError      **error)
 {
-  TIFFSetWarningHandler (tiff_io_warning);
-  TIFFSetErrorHandler (tiff_io_error);
+  TiffIO *tiff_io;
+  TIFF   *tif;
+
+  if (! tiff_io_main_thread)
+    {
+      tiff_io_main_thread = g_thread_self ();
+
+      TIFFSetWarningHandler (tiff_io_warning);
+      TIFFSetErrorHandler (tiff_io_error);
+    }
+
+  tiff_io = g_slice_new0 (TiffIO);
 
-  tiff_io.file = file;
+  tiff_io->file = file;
 
   if (! strcmp (mode, "r"))
     {
-      tiff_io.input = G_INPUT_STREAM (g_file_read (file, NULL, error));
-      if (! tiff_io.input)
-        return NULL;
+      tiff_io->input = G_INPUT_STREAM (g_file_read (file, NULL, error));
+      if (! tiff_io->input)
+        {
+          g_slice_free (TiffIO, tiff_io);
+          return NULL;
+        }
 
-      tiff_io.stream = G_OBJECT (tiff_io.input);
+      tiff_io->stream = G_OBJECT (tiff_io->input);
     }
   else
     {
-      tiff_io.output = G_OUTPUT_STREAM (g_file_replace (file,
-                                                        NULL, FALSE,
-                                                        G_FILE_CREATE_NONE,
-                                                        NULL, error));
-      if (! tiff_io.output)
-        return NULL;
-
-      tiff_io.stream = G_OBJECT (tiff_io.output);
+      tiff_io->output = G_OUTPUT_STREAM (g_file_replace (file,
+                                                         NULL, FALSE,
+                                                         G_FILE_CREATE_NONE,
+                                                         NULL, error));
+      if (! tiff_io->output)
+        {
+          g_slice_free (TiffIO, tiff_io);
+          return NULL;
+        }
+
+      tiff_io->stream = G_OBJECT (tiff_io->output);
     }
 
 #if 0
 #warning FIXME !can_seek code is broken
-  tiff_io.can_seek = g_seekable_can_seek (G_SEEKABLE (tiff_io.stream));
+  tiff_io->can_seek = g_seekable_can_seek (G_SEEKABLE (tiff_io->stream));
 #endif
-  tiff_io.can_seek = TRUE;
-
-  return TIFFClientOpen ("file-tiff", mode,
-                         (thandle_t) &tiff_io,
-                         tiff_io_read,
-                         tiff_io_write,
-                         tiff_io_seek,
-                         tiff_io_close,
-                         tiff_io_get_file_size,
-                         NULL, NULL);
+  tiff_io->can_seek = TRUE;
+
+  tif = TIFFClientOpen ("file-tiff", mode,
+                        (thandle_t) tiff_io,
+                        tiff_io_read,
+                        tiff_io_write,
+                        tiff_io_seek,
+                        tiff_io_close,
+                        tiff_io_get_file_size,
+                        NULL, NULL);
+
+  /* TIFFClientOpen() calls the close proc itself on failure */
+
+  return tif;
 }
 
 static void
@@ -154,7 +180,7 @@ tiff_io_warning (const gchar *module,
     return;
 
   /* Other unknown fields are only reported to stderr. */
-  if (tag > 0)
+  if (tag > 0 || g_thread_self () != tiff_io_main_thread)
     {
       gchar *msg = g_strdup_vprintf (fmt, ap);
 
@@ -178,6 +204,16 @@ tiff_io_error (const gchar *module,
   if (! strcmp (fmt, "Compression algorithm does not support random access"))
     return;
 
+  if (g_thread_self () != tiff_io_main_thread)
+    {
+      gchar *msg = g_strdup_vprintf (fmt, ap);
+
+      g_printerr ("%s\n", msg);
+      g_free (msg);
+
+      return;
+    }
+
   g_logv (G_LOG_DOMAIN, G_LOG_LEVEL_MESSAGE, fmt, ap);
 }
 
@@ -411,16 +447,8 @@ tiff_io_close (thandle_t handle)
     }
 
   g_object_unref (io->stream);
-  io->stream = NULL;
-  io->input  = NULL;
-  io->output = NULL;
-
   g_free (io->buffer);
-  io->buffer = NULL;
-
-  io->allocated = 0;
-  io->used      = 0;
-  io->position  = 0;
+  g_slice_free (TiffIO, io);
 
   return closed ? 0 : -1;
 }
@@ -52,6 +52,7 @@
 #include <libgimp/gimp.h>
 #include <libgimp/gimpui.h>
 
+#include "file-tiff-io.h"
 #include "file-tiff-load.h"
 
 #include "libgimp/stdplugins-intl.h"
@@ -59,6 +60,9 @@
 
 #define PLUG_IN_ROLE "gimp-file-tiff-load"
 
+/* strips decoding to more than this are read scanline by scanline */
+#define LOAD_MAX_CHUNK_SIZE (16 * 1024 * 1024)
+
 
 typedef struct
 {
@@ -76,6 +80,35 @@ typedef struct
   guchar     *pixel;
 } ChannelData;
 
+typedef enum
+{
+  LOAD_CHUNK_TILES,
+  LOAD_CHUNK_STRIPS,
+  LOAD_CHUNK_SCANLINES
+} LoadChunkMode;
+
+typedef struct
+{
+  gint    index;
+  guchar *data;
+} TiffChunk;
+
+typedef struct
+{
+  LoadChunkMode  mode;
+  tsize_t        chunk_size;
+  gint           n_chunks;
+  volatile gint  next_chunk;
+  GAsyncQueue   *empty;
+  GAsyncQueue   *filled;
+} TiffDecodeState;
+
+typedef struct
+{
+  TiffDecodeState *state;
+  TIFF            *tif;
+} TiffDecoder;
+
 
 /* Declare some local functions */
 
@@ -83,13 +116,29 @@ static GimpColorProfile * load_profile     (TIFF         *tif);
 
 static void               load_rgba        (TIFF         *tif,
                                             ChannelData  *channel);
-static void               load_contiguous  (TIFF         *tif,
+static void               load_contiguous  (GFile        *file,
+                                            TIFF         *tif,
                                             ChannelData  *channel,
                                             const Babl   *type,
                                             gushort       bps,
                                             gushort       spp,
                                             gboolean      is_bw,
                                             gint          extra);
+static void               load_decode_chunk     (TIFF          *tif,
+                                                 TiffChunk     *chunk,
+                                                 LoadChunkMode  mode,
+                                                 gint           index,
+                                                 tsize_t        size);
+static gpointer           load_decode_thread    (gpointer       data);
+static void               load_contiguous_chunk (ChannelData   *channel,
+                                                 gint           extra,
+                                                 const Babl    *src_format,
+                                                 const guchar  *data,
+                                                 gint           rowstride,
+                                                 guint32        x,
+                                                 guint32        y,
+                                                 guint32        cols,
+                                                 guint32        rows);
 static void               load_separate    (TIFF         *tif,
                                             ChannelData  *channel,
                                             const Babl   *type,
@@ -974,7 +1023,7 @@ load_image (GFile              *file,
         }
       else if (planar == PLANARCONFIG_CONTIG)
         {
-          load_contiguous (tif, channel, type, bps, spp, is_bw, extra);
+          load_contiguous (file, tif, channel, type, bps, spp, is_bw, extra);
         }
       else
         {
@@ -1364,7 +1413,143 @@ load_paths (TIFF *tif,
 
 
 static void
-load_contiguous (TIFF        *tif,
+load_decode_chunk (TIFF          *tif,
+                   TiffChunk     *chunk,
+                   LoadChunkMode  mode,
+                   gint           index,
+                   tsize_t        size)
+{
+  tsize_t result;
+
+  chunk->index = index;
+
+  switch (mode)
+    {
+    case LOAD_CHUNK_TILES:
+      result = TIFFReadEncodedTile (tif, index, chunk->data, size);
+      break;
+
+    case LOAD_CHUNK_STRIPS:
+      result = TIFFReadEncodedStrip (tif, index, chunk->data, size);
+      break;
+
+    default:
+      result = TIFFReadScanline (tif, chunk->data, index, 0) < 0 ? -1 : size;
+      break;
+    }
+
+  /* a broken chunk leaves a black hole instead of garbage */
+  if (result < 0)
+    memset (chunk->data, 0, size);
+}
+
+static gpointer
+load_decode_thread (gpointer data)
+{
+  TiffDecoder     *decoder = data;
+  TiffDecodeState *state   = decoder->state;
+
+  while (TRUE)
+    {
+      TiffChunk *chunk = g_async_queue_pop (state->empty);
+      gint       index = g_atomic_int_add (&state->next_chunk, 1);
+
+      if (index >= state->n_chunks)
+        {
+          g_async_queue_push (state->empty, chunk);
+          break;
+        }
+
+      load_decode_chunk (decoder->tif, chunk,
+                         state->mode, index, state->chunk_size);
+
+      g_async_queue_push (state->filled, chunk);
+    }
+
+  return NULL;
+}
+
+static void
+load_contiguous_chunk (ChannelData  *channel,
+                       gint          extra,
+                       const Babl   *src_format,
+                       const guchar *data,
+                       gint          rowstride,
+                       guint32       x,
+                       guint32       y,
+                       guint32       cols,
+                       guint32       rows)
+{
+  GeglBuffer *src_buf;
+  gint        src_bpp;
+  gint        offset;
+  gint        i;
+
+  /* a single destination has the same memory layout as the file */
+  if (extra == 0)
+    {
+      gegl_buffer_set (channel[0].buffer,
+                       GEGL_RECTANGLE (x, y, cols, rows), 0,
+                       channel[0].format, data, rowstride);
+      return;
+    }
+
+  src_buf = gegl_buffer_linear_new_from_data (data,
+                                              src_format,
+                                              GEGL_RECTANGLE (0, 0, cols, rows),
+                                              rowstride,
+                                              NULL, NULL);
+
+  src_bpp = babl_format_get_bytes_per_pixel (src_format);
+  offset  = 0;
+
+  for (i = 0; i <= extra; i++)
+    {
+      GeglBufferIterator *iter;
+      gint                dest_bpp;
+
+      dest_bpp = babl_format_get_bytes_per_pixel (channel[i].format);
+
+      iter = gegl_buffer_iterator_new (src_buf,
+                                       GEGL_RECTANGLE (0, 0, cols, rows),
+                                       0, NULL,
+                                       GEGL_ACCESS_READ,
+                                       GEGL_ABYSS_NONE);
+      gegl_buffer_iterator_add (iter, channel[i].buffer,
+                                GEGL_RECTANGLE (x, y, cols, rows),
+                                0, channel[i].format,
+                                GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guchar *s      = iter->data[0];
+          guchar *d      = iter->data[1];
+          gint    length = iter->length;
+
+          s += offset;
+
+          while (length--)
+            {
+              memcpy (d, s, dest_bpp);
+              d += dest_bpp;
+              s += src_bpp;
+            }
+        }
+
+      offset += dest_bpp;
+    }
+
+  g_object_unref (src_buf);
+}
+
+/* Contiguous images are decoded a whole tile or strip at a time.  When
+ * there is more than one of those, they are decompressed by a couple of
+ * threads, each with its own handle on the file, while this thread
+ * copies the finished chunks into the drawables.
+ */
+static void
+load_contiguous (GFile       *file,
+                 TIFF        *tif,
                  ChannelData *channel,
                  const Babl  *type,
                  gushort      bps,
@@ -1372,46 +1557,65 @@ load_contiguous (TIFF        *tif,
                  gboolean     is_bw,
                  gint         extra)
 {
-  guint32     image_width;
-  guint32     image_height;
-  guint32     tile_width;
-  guint32     tile_height;
-  gint        bytes_per_pixel;
-  const Babl *src_format;
-  guchar     *buffer;
-  guchar     *bw_buffer = NULL;
-  gdouble     progress  = 0.0;
-  gdouble     one_row;
-  guint32     y;
-  gint        i;
+  TiffDecodeState  state;
+  TiffDecoder     *decoders  = NULL;
+  GThread        **threads   = NULL;
+  gint             n_threads = 0;
+  gint             n_buffers;
+  guint32          image_width;
+  guint32          image_height;
+  guint32          tile_width;
+  guint32          tile_height;
+  guint32          tiles_across;
+  gint             bytes_per_pixel;
+  const Babl      *src_format;
+  TiffChunk       *chunk;
+  guchar          *bw_buffer = NULL;
+  gint             n_done;
+  gint             i;
 
   g_printerr ("%s\n", __func__);
 
   TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &image_width);
   TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &image_height);
 
-  tile_width = image_width;
-
   if (TIFFIsTiled (tif))
     {
       TIFFGetField (tif, TIFFTAG_TILEWIDTH,  &tile_width);
       TIFFGetField (tif, TIFFTAG_TILELENGTH, &tile_height);
 
-      buffer = g_malloc (TIFFTileSize (tif));
+      state.mode       = LOAD_CHUNK_TILES;
+      state.chunk_size = TIFFTileSize (tif);
     }
   else
     {
-      tile_width  = image_width;
-      tile_height = 1;
+      tile_width = image_width;
 
-      buffer = g_malloc (TIFFScanlineSize (tif));
+      TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &tile_height);
+      tile_height = MIN (tile_height, image_height);
+
+      state.mode       = LOAD_CHUNK_STRIPS;
+      state.chunk_size = TIFFVStripSize (tif, tile_height);
+
+      /*  huge strips (usually one strip for the whole image) are
+       *  still read a scanline at a time
+       */
+      if (state.chunk_size > LOAD_MAX_CHUNK_SIZE)
+        {
+          tile_height = 1;
+
+          state.mode       = LOAD_CHUNK_SCANLINES;
+          state.chunk_size = TIFFScanlineSize (tif);
+        }
     }
 
+  tiles_across   = (image_width  + tile_width  - 1) / tile_width;
+  state.n_chunks = tiles_across * ((image_height + tile_height - 1) /
+                                   tile_height);
+
   if (is_bw)
     bw_buffer = g_malloc (tile_width * tile_height);
 
-  one_row = (gdouble) tile_height / (gdouble) image_height;
-
   src_format = babl_format_n (type, spp);
 
   /* consistency check */
@@ -1423,84 +1627,126 @@ load_contiguous (TIFF        *tif,
               bytes_per_pixel,
               babl_format_get_bytes_per_pixel (src_format));
 
-  for (y = 0; y < image_height; y += tile_height)
+  state.next_chunk = 0;
+  state.empty      = g_async_queue_new ();
+  state.filled     = g_async_queue_new ();
+
+  /*  scanlines have to be read in order, through the one handle  */
+  if (state.mode != LOAD_CHUNK_SCANLINES && state.n_chunks > 1)
     {
-      guint32 x;
+      gint max_threads = MIN (g_get_num_processors (), state.n_chunks);
+
+      decoders = g_new0 (TiffDecoder, max_threads);
+      threads  = g_new0 (GThread *, max_threads);
 
-      for (x = 0; x < image_width; x += tile_width)
+      for (i = 0; i < max_threads; i++)
         {
-          GeglBuffer *src_buf;
-          guint32     rows;
-          guint32     cols;
-          gint        offset;
+          TiffDecoder *decoder = &decoders[n_threads];
 
-          gimp_progress_update (progress + one_row *
-                                ((gdouble) x / (gdouble) image_width));
+          decoder->state = &state;
+          decoder->tif   = tiff_open (file, "r", NULL);
 
-          if (TIFFIsTiled (tif))
-            TIFFReadTile (tif, buffer, x, y, 0, 0);
-          else
-            TIFFReadScanline (tif, buffer, y, 0);
+          if (! decoder->tif)
+            break;
 
-          cols = MIN (image_width  - x, tile_width);
-          rows = MIN (image_height - y, tile_height);
+          if (! TIFFSetDirectory (decoder->tif, TIFFCurrentDirectory (tif)))
+            {
+              TIFFClose (decoder->tif);
+              break;
+            }
 
-          if (is_bw)
-            convert_bit2byte (buffer, bw_buffer, cols, rows);
+          n_threads++;
+        }
 
-          src_buf = gegl_buffer_linear_new_from_data (is_bw ? bw_buffer : buffer,
-                                                      src_format,
-                                                      GEGL_RECTANGLE (0, 0, cols, rows),
-                                                      tile_width * bytes_per_pixel,
-                                                      NULL, NULL);
+      /*  a single helper thread would only add overhead  */
+      if (n_threads < 2)
+        {
+          for (i = 0; i < n_threads; i++)
+            TIFFClose (decoders[i].tif);
 
-          offset = 0;
+          n_threads = 0;
+        }
+    }
 
-          for (i = 0; i <= extra; i++)
-            {
-              GeglBufferIterator *iter;
-              gint                src_bpp;
-              gint                dest_bpp;
-
-              src_bpp  = babl_format_get_bytes_per_pixel (src_format);
-              dest_bpp = babl_format_get_bytes_per_pixel (channel[i].format);
-
-              iter = gegl_buffer_iterator_new (src_buf,
-                                               GEGL_RECTANGLE (0, 0, cols, rows),
-                                               0, NULL,
-                                               GEGL_ACCESS_READ,
-                                               GEGL_ABYSS_NONE);
-              gegl_buffer_iterator_add (iter, channel[i].buffer,
-                                        GEGL_RECTANGLE (x, y, cols, rows),
-                                        0, channel[i].format,
-                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-
-              while (gegl_buffer_iterator_next (iter))
-                {
-                  guchar *s      = iter->data[0];
-                  guchar *d      = iter->data[1];
-                  gint    length = iter->length;
+  /*  two chunks in flight per thread bound the memory use  */
+  n_buffers = MAX (1, 2 * n_threads);
 
-                  s += offset;
+  for (i = 0; i < n_buffers; i++)
+    {
+      chunk = g_slice_new (TiffChunk);
+      chunk->data = g_malloc (state.chunk_size);
 
-                  while (length--)
-                    {
-                      memcpy (d, s, dest_bpp);
-                      d += dest_bpp;
-                      s += src_bpp;
-                    }
-                }
+      g_async_queue_push (state.empty, chunk);
+    }
 
-              offset += dest_bpp;
-            }
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_new ("tiff-decode", load_decode_thread,
+                               &decoders[i]);
+
+  for (n_done = 0; n_done < state.n_chunks; n_done++)
+    {
+      const guchar *data;
+      gint          rowstride;
+      guint32       x, y;
+      guint32       cols, rows;
 
-          g_object_unref (src_buf);
+      if (n_threads > 0)
+        {
+          chunk = g_async_queue_pop (state.filled);
         }
+      else
+        {
+          chunk = g_async_queue_pop (state.empty);
 
-      progress += one_row;
+          load_decode_chunk (tif, chunk, state.mode, n_done,
+                             state.chunk_size);
+        }
+
+      x = (chunk->index % tiles_across) * tile_width;
+      y = (chunk->index / tiles_across) * tile_height;
+
+      cols = MIN (image_width  - x, tile_width);
+      rows = MIN (image_height - y, tile_height);
+
+      if (is_bw)
+        {
+          convert_bit2byte (chunk->data, bw_buffer, tile_width, rows);
+
+          data      = bw_buffer;
+          rowstride = tile_width;
+        }
+      else
+        {
+          data      = chunk->data;
+          rowstride = tile_width * bytes_per_pixel;
+        }
+
+      load_contiguous_chunk (channel, extra, src_format, data, rowstride,
+                             x, y, cols, rows);
+
+      g_async_queue_push (state.empty, chunk);
+
+      gimp_progress_update ((gdouble) (n_done + 1) /
+                            (gdouble) state.n_chunks);
     }
 
-  g_free (buffer);
+  for (i = 0; i < n_threads; i++)
+    {
+      g_thread_join (threads[i]);
+      TIFFClose (decoders[i].tif);
+    }
+
+  while ((chunk = g_async_queue_try_pop (state.empty)))
+    {
+      g_free (chunk->data);
+      g_slice_free (TiffChunk, chunk);
+    }
+
+  g_async_queue_unref (state.empty);
+  g_async_queue_unref (state.filled);
+
+  g_free (threads);
+  g_free (decoders);
   g_free (bw_buffer);
 }
 
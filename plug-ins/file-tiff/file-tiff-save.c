@@ -48,6 +48,7 @@
 #include <string.h>
 
 #include <tiffio.h>
+#include <zlib.h>
 
 #include <libgimp/gimp.h>
 #include <libgimp/gimpui.h>
@@ -61,9 +62,34 @@
 #define PLUG_IN_ROLE "gimp-file-tiff-save"
 
 
+/* The deflate compression of one strip */
+typedef struct
+{
+  guchar   *src;            /* Strip rows, differenced in place        */
+  gint      rows;           /* Rows in the strip                       */
+  gint      bytesperrow;
+  gint      samplesperpixel;
+  gint      bytespersample; /* 0 when no predictor is used             */
+  guchar   *dest;           /* Compressed strip                        */
+  uLongf    dest_len;
+  gboolean  success;
+} TiffStripJob;
+
+
+static GThreadPool *strip_pool    = NULL;
+static GMutex       strip_mutex;
+static GCond        strip_cond;
+static gint         strip_pending = 0;
+
+
 static gboolean  save_paths             (TIFF          *tif,
                                          gint32         image);
 
+static void      strip_job_func         (TiffStripJob  *job,
+                                         gpointer       user_data);
+static void      compress_strips        (TiffStripJob  *jobs,
+                                         gint           n_jobs);
+
 static void      comment_entry_callback (GtkWidget     *widget,
                                          gchar        **comment);
 
@@ -254,6 +280,93 @@ save_paths (TIFF   *tif,
  * other special, indirect and consequential damages.
  */
 
+/* Applies the horizontal predictor to the strip's rows, and deflates
+ * them the way libtiff's ZIP codec would
+ */
+static void
+strip_job_func (TiffStripJob *job,
+                gpointer      user_data)
+{
+  if (job->bytespersample)
+    {
+      gint stride = job->samplesperpixel;
+      gint row;
+
+      for (row = 0; row < job->rows; row++)
+        {
+          guchar *line = job->src + row * job->bytesperrow;
+          gint    n    = job->bytesperrow / job->bytespersample;
+          gint    i;
+
+          switch (job->bytespersample)
+            {
+            case 1:
+              for (i = n - 1; i >= stride; i--)
+                line[i] -= line[i - stride];
+              break;
+
+            case 2:
+              {
+                guint16 *p = (guint16 *) line;
+
+                for (i = n - 1; i >= stride; i--)
+                  p[i] -= p[i - stride];
+              }
+              break;
+
+            case 4:
+              {
+                guint32 *p = (guint32 *) line;
+
+                for (i = n - 1; i >= stride; i--)
+                  p[i] -= p[i - stride];
+              }
+              break;
+            }
+        }
+    }
+
+  job->dest_len = compressBound (job->rows * job->bytesperrow);
+  job->success  = (compress2 (job->dest, &job->dest_len,
+                              job->src, job->rows * job->bytesperrow,
+                              Z_DEFAULT_COMPRESSION) == Z_OK);
+
+  g_mutex_lock (&strip_mutex);
+
+  if (--strip_pending == 0)
+    g_cond_signal (&strip_cond);
+
+  g_mutex_unlock (&strip_mutex);
+}
+
+/* Compresses the strips in parallel, and waits for all of them */
+static void
+compress_strips (TiffStripJob *jobs,
+                 gint          n_jobs)
+{
+  gint i;
+
+  if (! strip_pool)
+    {
+      strip_pool = g_thread_pool_new ((GFunc) strip_job_func, NULL,
+                                      g_get_num_processors (),
+                                      FALSE, NULL);
+    }
+
+  g_mutex_lock (&strip_mutex);
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      strip_pending++;
+      g_thread_pool_push (strip_pool, &jobs[i], NULL);
+    }
+
+  while (strip_pending > 0)
+    g_cond_wait (&strip_cond, &strip_mutex);
+
+  g_mutex_unlock (&strip_mutex);
+}
+
 gboolean
 save_image (GFile        *file,
             TiffSaveVals *tsvals,
@@ -773,12 +886,93 @@ save_image (GFile        *file,
   if (!is_bw && drawable_type == GIMP_INDEXED_IMAGE)
     TIFFSetField (tif, TIFFTAG_COLORMAP, red, grn, blu);
 
-  /* array to rearrange data */
-  src  = g_new (guchar, bytesperrow * tile_height);
-  data = g_new (guchar, bytesperrow);
+  /*  Deflated strips are compressed here, several at a time, and
+   *  handed to libtiff as raw strips.  Everything else goes through
+   *  libtiff's scanline interface.
+   */
+  if (compression == COMPRESSION_ADOBE_DEFLATE && ! is_bw &&
+      (predictor == 0 ||
+       bitspersample == 8 || bitspersample == 16 || bitspersample == 32))
+    {
+      TiffStripJob *jobs;
+      gint          n_jobs = g_get_num_processors ();
+      gint          strip  = 0;
+
+      jobs = g_new0 (TiffStripJob, n_jobs);
+
+      for (i = 0; i < n_jobs; i++)
+        {
+          jobs[i].src             = g_new (guchar, bytesperrow * tile_height);
+          jobs[i].dest            = g_new (guchar,
+                                           compressBound (bytesperrow *
+                                                          tile_height));
+          jobs[i].bytesperrow     = bytesperrow;
+          jobs[i].samplesperpixel = samplesperpixel;
+          jobs[i].bytespersample  = predictor ? bitspersample / 8 : 0;
+        }
+
+      success = TRUE;
+
+      for (y = 0; y < rows && success; y = yend)
+        {
+          gint n_band = 0;
+
+          for (yend = y; yend < rows && n_band < n_jobs; yend += tile_height)
+            {
+              jobs[n_band].rows = MIN (tile_height, rows - yend);
+
+              gegl_buffer_get (buffer,
+                               GEGL_RECTANGLE (0, yend,
+                                               cols, jobs[n_band].rows), 1.0,
+                               format, jobs[n_band].src,
+                               GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+              n_band++;
+            }
+
+          yend = MIN (yend, rows);
+
+          compress_strips (jobs, n_band);
+
+          for (i = 0; i < n_band && success; i++, strip++)
+            {
+              success = (jobs[i].success &&
+                         TIFFWriteRawStrip (tif, strip,
+                                            jobs[i].dest,
+                                            jobs[i].dest_len) >= 0);
+            }
+
+          gimp_progress_update ((gdouble) yend / (gdouble) rows);
+        }
+
+      for (i = 0; i < n_jobs; i++)
+        {
+          g_free (jobs[i].src);
+          g_free (jobs[i].dest);
+        }
+
+      g_free (jobs);
+
+      if (! success)
+        {
+          g_message (_("Failed a strip write on row %d"),
+                     (strip - 1) * tile_height);
+          goto out;
+        }
+
+      y = rows;
+    }
+  else
+    {
+      /* array to rearrange data */
+      src  = g_new (guchar, bytesperrow * tile_height);
+      data = g_new (guchar, bytesperrow);
+
+      y = 0;
+    }
 
   /* Now write the TIFF data. */
-  for (y = 0; y < rows; y = yend)
+  for (; y < rows; y = yend)
     {
       yend = y + tile_height;
       yend = MIN (yend, rows);
@@ -137,20 +137,24 @@ load_image (const gchar *filename,
 
   if (! animation)
     {
-      uint8_t *outdata;
+      WebPDecoderConfig config;
 
-      /* Attempt to decode the data as a WebP image */
-      outdata = WebPDecodeRGBA (indata, indatalen, &width, &height);
+      if (! WebPInitDecoderConfig (&config))
+        return -1;
+
+      /* Let libwebp filter and decode in parallel */
+      config.options.use_threads = 1;
+      config.output.colorspace   = MODE_RGBA;
 
-      /* Check to ensure the image data was loaded correctly */
-      if (! outdata)
+      /* Attempt to decode the data as a WebP image */
+      if (WebPDecode (indata, indatalen, &config) != VP8_STATUS_OK)
         return -1;
 
-      create_layer (image_ID, outdata, 0, _("Background"),
-                    width, height);
+      create_layer (image_ID, config.output.u.RGBA.rgba, 0, _("Background"),
+                    config.output.width, config.output.height);
 
       /* Free the image data */
-      free (outdata);
+      WebPFreeDecBuffer (&config.output);
     }
   else
     {
@@ -177,6 +181,8 @@ load_image (const gchar *filename,
         }
 
       /* dec_options.color_mode is MODE_RGBA by default here */
+      dec_options.use_threads = 1;
+
       dec = WebPAnimDecoderNew (&wp_data, &dec_options);
       if (! dec)
         {
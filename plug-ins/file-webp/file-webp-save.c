@@ -42,6 +42,30 @@
 #include "libgimp/stdplugins-intl.h"
 
 
+/* Frames fetched ahead of the animation encoder */
+#define N_FRAMES_IN_FLIGHT 3
+
+
+/* A frame on its way to the animation encoder */
+typedef struct
+{
+  guchar   *buffer;     /* NULL marks the end of the animation */
+  gint      width;
+  gint      height;
+  gboolean  has_alpha;
+  gint      timestamp;
+} WebPAnimFrame;
+
+typedef struct
+{
+  WebPAnimEncoder *enc;
+  WebPConfig       config;
+  GAsyncQueue     *frames;   /* Frames to encode              */
+  GAsyncQueue     *slots;    /* One token per frame in flight */
+  volatile gint    status;
+} WebPAnimPipeline;
+
+
 int           webp_anim_file_writer (FILE              *outfile,
                                      const uint8_t     *data,
                                      size_t             data_size);
@@ -207,6 +231,7 @@ save_layer (const gchar    *filename,
       config.lossless      = params->lossless;
       config.method        = 6;  /* better quality */
       config.alpha_quality = params->alpha_quality;
+      config.thread_level  = 1;
 
       /* Prepare the WebP structure */
       WebPPictureInit (&picture);
@@ -467,6 +492,80 @@ combine_buffers (GeglBuffer *layer_buffer,
   return buffer;
 }
 
+/* Encodes the frames queued by save_animation(), so that fetching the
+ * next layer overlaps with encoding the previous one
+ */
+static gpointer
+encode_frames_func (gpointer data)
+{
+  WebPAnimPipeline *pipeline = data;
+
+  while (TRUE)
+    {
+      WebPAnimFrame *frame = g_async_queue_pop (pipeline->frames);
+      WebPPicture    picture;
+      gint           bpp;
+      gboolean       status;
+
+      if (! frame->buffer)
+        {
+          g_slice_free (WebPAnimFrame, frame);
+          break;
+        }
+
+      /* After an error, the remaining frames are only released */
+      if (g_atomic_int_get (&pipeline->status))
+        {
+          bpp = frame->has_alpha ? 4 : 3;
+
+          WebPPictureInit (&picture);
+          picture.use_argb = 1;
+          picture.width    = frame->width;
+          picture.height   = frame->height;
+
+          /* Use the appropriate function to import the data from the buffer */
+          if (! frame->has_alpha)
+            {
+              status = WebPPictureImportRGB (&picture, frame->buffer,
+                                             frame->width * bpp);
+            }
+          else
+            {
+              status = WebPPictureImportRGBA (&picture, frame->buffer,
+                                              frame->width * bpp);
+            }
+
+          if (! status)
+            {
+              g_printerr ("%s: memory error in WebPPictureImportRGB(A)().",
+                          G_STRFUNC);
+            }
+          /* Perform the actual encode */
+          else if (! WebPAnimEncoderAdd (pipeline->enc, &picture,
+                                         frame->timestamp,
+                                         &pipeline->config))
+            {
+              g_printerr ("ERROR[%d]: %s\n",
+                          picture.error_code,
+                          webp_error_string (picture.error_code));
+              status = FALSE;
+            }
+
+          WebPPictureFree (&picture);
+
+          if (! status)
+            g_atomic_int_set (&pipeline->status, FALSE);
+        }
+
+      g_free (frame->buffer);
+      g_slice_free (WebPAnimFrame, frame);
+
+      g_async_queue_push (pipeline->slots, GINT_TO_POINTER (1));
+    }
+
+  return NULL;
+}
+
 gboolean
 save_animation (const gchar    *filename,
                 gint32          nLayers,
@@ -489,6 +588,8 @@ save_animation (const gchar    *filename,
   int                    frame_timestamp = 0;
   WebPAnimEncoder       *enc = NULL;
   GeglBuffer            *prev_frame = NULL;
+  WebPAnimPipeline       pipeline;
+  GThread               *encoder;
 
   if (nLayers < 1)
     return FALSE;
@@ -539,18 +640,53 @@ save_animation (const gchar    *filename,
           enc_options.kmin = params->kf_distance - 1;
         }
 
+      enc = WebPAnimEncoderNew (gimp_image_width (image_ID),
+                                gimp_image_height (image_ID),
+                                &enc_options);
+      if (! enc)
+        {
+          g_printerr ("ERROR: enc == null\n");
+          status = FALSE;
+          break;
+        }
+
+      WebPConfigPreset (&pipeline.config, params->preset, params->quality);
+
+      pipeline.config.lossless      = params->lossless;
+      pipeline.config.method        = 6;  /* better quality */
+      pipeline.config.alpha_quality = params->alpha_quality;
+      pipeline.config.exact         = 1;
+      pipeline.config.thread_level  = 1;
+
+      pipeline.enc    = enc;
+      pipeline.frames = g_async_queue_new ();
+      pipeline.slots  = g_async_queue_new ();
+      pipeline.status = TRUE;
+
+      for (loop = 0; loop < N_FRAMES_IN_FLIGHT; loop++)
+        g_async_queue_push (pipeline.slots, GINT_TO_POINTER (1));
+
+      encoder = g_thread_new ("webp-encode", encode_frames_func, &pipeline);
+
       for (loop = 0; loop < nLayers; loop++)
         {
           GeglBuffer       *geglbuffer;
           GeglBuffer       *current_frame;
           GeglRectangle     extent;
-          WebPConfig        config;
-          WebPPicture       picture;
-          WebPMemoryWriter  mw = { 0 };
+          WebPAnimFrame    *frame;
           gint32            drawable = allLayers[nLayers - 1 - loop];
           gint              delay = get_layer_delay (drawable);
           gboolean          needs_combine = get_layer_needs_combine (drawable);
 
+          /* Wait until the encoder is ready for another frame */
+          g_async_queue_pop (pipeline.slots);
+
+          if (! g_atomic_int_get (&pipeline.status))
+            {
+              status = FALSE;
+              break;
+            }
+
           /* Obtain the drawable type */
           has_alpha = gimp_drawable_has_alpha (drawable);
 
@@ -570,44 +706,16 @@ save_animation (const gchar    *filename,
           w = extent.width;
           h = extent.height;
 
-          if (loop == 0)
-            {
-              enc = WebPAnimEncoderNew (w, h, &enc_options);
-              if (! enc)
-                {
-                  g_printerr ("ERROR: enc == null\n");
-                  status = FALSE;
-                  break;
-                }
-            }
-
           /* Attempt to allocate a buffer of the appropriate size */
           buffer = g_try_malloc (w * h * bpp);
           if (! buffer)
             {
               g_printerr ("Buffer error: 'buffer null'\n");
+              g_object_unref (geglbuffer);
               status = FALSE;
               break;
             }
 
-          WebPConfigPreset (&config, params->preset, params->quality);
-
-          config.lossless      = params->lossless;
-          config.method        = 6;  /* better quality */
-          config.alpha_quality = params->alpha_quality;
-          config.exact         = 1;
-
-          WebPMemoryWriterInit (&mw);
-
-          /* Prepare the WebP structure */
-          WebPPictureInit (&picture);
-          picture.use_argb      = 1;
-          picture.argb_stride   = w * bpp;
-          picture.width         = w;
-          picture.height        = h;
-          picture.custom_ptr    = &mw;
-          picture.writer        = WebPMemoryWrite;
-
           if (loop == 0 || ! needs_combine)
             {
               g_clear_object (&prev_frame);
@@ -627,41 +735,31 @@ save_animation (const gchar    *filename,
           gegl_buffer_get (current_frame, &extent, 1.0, format, buffer,
                            GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-          /* Use the appropriate function to import the data from the buffer */
-          if (! has_alpha)
-            {
-              status = WebPPictureImportRGB (&picture, buffer, w * bpp);
-            }
-          else
-            {
-              status = WebPPictureImportRGBA (&picture, buffer, w * bpp);
-            }
-          g_free (buffer);
-
-          if (! status)
-            {
-              g_printerr ("%s: memory error in WebPPictureImportRGB(A)().",
-                          G_STRFUNC);
-            }
-          /* Perform the actual encode */
-          else if (! WebPAnimEncoderAdd (enc, &picture, frame_timestamp, &config))
-            {
-              g_printerr ("ERROR[%d]: %s\n",
-                          picture.error_code,
-                          webp_error_string (picture.error_code));
-              status = FALSE;
-            }
+          /* Hand the frame to the encoder thread */
+          frame = g_slice_new (WebPAnimFrame);
 
-          WebPMemoryWriterClear (&mw);
-          WebPPictureFree (&picture);
+          frame->buffer    = buffer;
+          frame->width     = w;
+          frame->height    = h;
+          frame->has_alpha = has_alpha;
+          frame->timestamp = frame_timestamp;
 
-          if (status == FALSE)
-            break;
+          g_async_queue_push (pipeline.frames, frame);
 
           gimp_progress_update ((loop + 1.0) / nLayers);
           frame_timestamp += (delay <= 0 || force_delay) ? default_delay : delay;
         }
 
+      /* Let the encoder finish the frames it was given */
+      g_async_queue_push (pipeline.frames, g_slice_new0 (WebPAnimFrame));
+      g_thread_join (encoder);
+
+      g_async_queue_unref (pipeline.frames);
+      g_async_queue_unref (pipeline.slots);
+
+      if (! pipeline.status)
+        status = FALSE;
+
       if (status == FALSE)
         break;
 
@@ -66,6 +66,230 @@ typedef accum_t abucket[4];
    if (tt_ > dest) dest = tt_;                 \
 }
 
+/* the samples of a batch, and the filtering of the accumulation
+ * buffer into the image, are split into jobs which run on a pool of
+ * threads.  each sample job iterates with its own random generator
+ * into its own histogram; the histograms are summed afterwards.
+ */
+
+typedef struct
+{
+  void (* func) (gpointer job);
+} render_job;
+
+typedef struct
+{
+  render_job     job;
+  control_point *cp;
+  bucket        *cmap;
+  bucket        *buckets;
+  point         *points;
+  GRand         *rand;
+  double        *bounds;
+  double        *size;
+  int            width, height;
+  int            n_sub_batches;
+} sample_job;
+
+typedef struct
+{
+  render_job     job;
+  abucket       *accumulate;
+  double        *filter;
+  int            filter_width;
+  int            width;
+  int            oversample;
+  double         g;
+  unsigned char *out;
+  int            out_width;
+  int            nchan;
+  int            image_width;
+  int            y1, y2;
+} filter_job;
+
+static GThreadPool *render_pool    = NULL;
+static GMutex       render_mutex;
+static GCond        render_cond;
+static gint         render_pending = 0;
+static gint         render_done    = 0;   /* sub batches or rows */
+
+static void
+render_job_func (render_job *job,
+                 gpointer    user_data)
+{
+  job->func (job);
+
+  g_mutex_lock (&render_mutex);
+
+  if (--render_pending == 0)
+    g_cond_signal (&render_cond);
+
+  g_mutex_unlock (&render_mutex);
+}
+
+/* runs the jobs in parallel and waits for all of them, calling
+ * progress with progress_base + 0.5 * (done units / n_units) now
+ * and then if it is non-NULL.
+ */
+static void
+run_jobs (gpointer  jobs,
+          gsize     job_size,
+          int       n_jobs,
+          int       n_units,
+          double    progress_base,
+          int       progress(double))
+{
+  int i;
+
+  if (! render_pool)
+    {
+      render_pool = g_thread_pool_new ((GFunc) render_job_func, NULL,
+                                       g_get_num_processors (),
+                                       FALSE, NULL);
+    }
+
+  g_atomic_int_set (&render_done, 0);
+
+  g_mutex_lock (&render_mutex);
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      render_pending++;
+      g_thread_pool_push (render_pool, (char *) jobs + i * job_size, NULL);
+    }
+
+  while (render_pending > 0)
+    {
+      if (progress)
+        {
+          gint64 end_time = g_get_monotonic_time () + G_TIME_SPAN_SECOND / 10;
+
+          if (! g_cond_wait_until (&render_cond, &render_mutex, end_time) &&
+              n_units > 0)
+            {
+              g_mutex_unlock (&render_mutex);
+              (*progress)(progress_base +
+                          0.5 * g_atomic_int_get (&render_done) / n_units);
+              g_mutex_lock (&render_mutex);
+            }
+        }
+      else
+        {
+          g_cond_wait (&render_cond, &render_mutex);
+        }
+    }
+
+  g_mutex_unlock (&render_mutex);
+}
+
+/* generate n_sub_batches * SUB_BATCH_SIZE samples, and merge them
+ * into the job's buckets, looking up colors
+ */
+static void
+sample_job_func (gpointer data)
+{
+  sample_job *job    = data;
+  double     *bounds = job->bounds;
+  double     *size   = job->size;
+  int         sub_batch, j;
+
+  for (sub_batch = 0; sub_batch < job->n_sub_batches; sub_batch++)
+    {
+      job->points[0][0] = g_rand_double_range (job->rand, -1, 1);
+      job->points[0][1] = g_rand_double_range (job->rand, -1, 1);
+      job->points[0][2] = g_rand_double (job->rand);
+      iterate (job->cp, SUB_BATCH_SIZE, FUSE, job->points, job->rand);
+
+      for (j = 0; j < SUB_BATCH_SIZE; j++)
+        {
+          int k, color_index;
+          double *p = job->points[j];
+          bucket *b;
+
+          /* Note that we must test if p[0] and p[1] is "within"
+           * the valid bounds rather than "not outside", because
+           * p[0] and p[1] might be NaN.
+           */
+          if (p[0] >= bounds[0] &&
+              p[1] >= bounds[1] &&
+              p[0] <= bounds[2] &&
+              p[1] <= bounds[3])
+            {
+              color_index = (int) (p[2] * CMAP_SIZE);
+
+              if (color_index < 0)
+                color_index = 0;
+              else if (color_index > CMAP_SIZE - 1)
+                color_index = CMAP_SIZE - 1;
+
+              b = job->buckets +
+                  (int) (job->width * (p[0] - bounds[0]) * size[0]) +
+                  job->width * (int) (job->height * (p[1] - bounds[1]) * size[1]);
+
+              for (k = 0; k < 4; k++)
+                bump_no_overflow(b[0][k], job->cmap[color_index][k], short);
+            }
+        }
+
+      g_atomic_int_inc (&render_done);
+    }
+}
+
+/* filter rows y1 to y2 of the accumulation buffer down into the image */
+static void
+filter_job_func (gpointer data)
+{
+  filter_job *job = data;
+  int         i, j, x, y;
+  double      t[4];
+
+  y = job->y1 * job->oversample;
+  for (j = job->y1; j < job->y2; j++)
+    {
+      x = 0;
+      for (i = 0; i < job->image_width; i++)
+        {
+          int            ii, jj, a;
+          unsigned char *p;
+          t[0] = t[1] = t[2] = t[3] = 0.0;
+          for (ii = 0; ii < job->filter_width; ii++)
+            for (jj = 0; jj < job->filter_width; jj++)
+              {
+                double k = job->filter[ii + jj * job->filter_width];
+                abucket *a = job->accumulate + x + ii + (y + jj) * job->width;
+
+                t[0] += k * a[0][0];
+                t[1] += k * a[0][1];
+                t[2] += k * a[0][2];
+                t[3] += k * a[0][3];
+              }
+          /* FIXME: we should probably use glib facilities to make
+           * this code readable
+           */
+          p = job->out + job->nchan * (i + j * job->out_width);
+          a = 256.0 * pow((double) t[0] / PREFILTER_WHITE, job->g) + 0.5;
+          if (a < 0) a = 0; else if (a > 255) a = 255;
+          p[0] = a;
+          a = 256.0 * pow((double) t[1] / PREFILTER_WHITE, job->g) + 0.5;
+          if (a < 0) a = 0; else if (a > 255) a = 255;
+          p[1] = a;
+          a = 256.0 * pow((double) t[2] / PREFILTER_WHITE, job->g) + 0.5;
+          if (a < 0) a = 0; else if (a > 255) a = 255;
+          p[2] = a;
+          if (job->nchan > 3)
+            {
+              a = 256.0 * pow((double) t[3] / PREFILTER_WHITE, job->g) + 0.5;
+              if (a < 0) a = 0; else if (a > 255) a = 255;
+              p[3] = a;
+            }
+          x += job->oversample;
+        }
+      y += job->oversample;
+
+      g_atomic_int_inc (&render_done);
+    }
+}
+
 /* sum of entries of vector to 1 */
 static void
 normalize_vector(double *v,
@@ -88,7 +312,7 @@ render_rectangle (frame_spec    *spec,
                   int            nchan,
                   int progress(double))
 {
-  int      i, j, k, nsamples, nbuckets, batch_size, batch_num, sub_batch;
+  int      i, j, k, nsamples, nbuckets, batch_size, batch_num;
   bucket  *buckets;
   abucket *accumulate;
   point   *points;
@@ -101,7 +325,9 @@ render_rectangle (frame_spec    *spec,
   int      nbatches = spec->cps[0].nbatches;
   bucket   cmap[CMAP_SIZE];
   int      gutter_width;
-  int      sbc;
+  int      n_jobs = g_get_num_processors ();
+  sample_job *sample_jobs;
+  filter_job *filter_jobs;
 
   image_width = spec->cps[0].width;
   if (field)
@@ -187,13 +413,32 @@ render_rectangle (frame_spec    *spec,
       points = (point *)  (last_block + (sizeof (bucket) + sizeof (abucket)) * nbuckets);
     }
 
+  /* the first sample job uses the buckets and points above, the
+   * others get their own
+   */
+  sample_jobs = g_new0 (sample_job, n_jobs);
+  for (i = 0; i < n_jobs; i++)
+    {
+      sample_jobs[i].job.func = sample_job_func;
+      sample_jobs[i].cmap     = cmap;
+      sample_jobs[i].buckets  = i ? g_new (bucket, nbuckets) : buckets;
+      sample_jobs[i].points   = i ? g_new (point, SUB_BATCH_SIZE) : points;
+      sample_jobs[i].rand     = g_rand_new_with_seed (g_random_int ());
+      sample_jobs[i].bounds   = bounds;
+      sample_jobs[i].size     = size;
+      sample_jobs[i].width    = width;
+      sample_jobs[i].height   = height;
+    }
+
   memset ((char *) accumulate, 0, sizeof (abucket) * nbuckets);
   for (batch_num = 0; batch_num < nbatches; batch_num++)
     {
       double        batch_time;
       double        sample_density;
       control_point cp;
-      memset ((char *) buckets, 0, sizeof (bucket) * nbuckets);
+      int           n_sub_batches;
+      for (i = 0; i < n_jobs; i++)
+        memset ((char *) sample_jobs[i].buckets, 0, sizeof (bucket) * nbuckets);
       batch_time = spec->time + temporal_deltas[batch_num];
 
       /* interpolate and get a control point */
@@ -254,50 +499,28 @@ render_rectangle (frame_spec    *spec,
                         (oversample * oversample));
       batch_size = nsamples / cp.nbatches;
 
-      sbc = 0;
-      for (sub_batch = 0;
-           sub_batch < batch_size;
-           sub_batch += SUB_BATCH_SIZE)
+      n_sub_batches = (batch_size + SUB_BATCH_SIZE - 1) / SUB_BATCH_SIZE;
+      if (n_sub_batches < 0)
+        n_sub_batches = 0;
+
+      for (i = 0; i < n_jobs; i++)
         {
-          if (progress && (sbc++ % 32) == 0)
-              (*progress)(0.5 * sub_batch / (double) batch_size);
-          /* generate a sub_batch_size worth of samples */
-          points[0][0] = random_uniform11 ();
-          points[0][1] = random_uniform11 ();
-          points[0][2] = random_uniform01 ();
-          iterate (&cp, SUB_BATCH_SIZE, FUSE, points);
-
-          /* merge them into buckets, looking up colors */
-          for (j = 0; j < SUB_BATCH_SIZE; j++)
-            {
-              int k, color_index;
-              double *p = points[j];
-              bucket *b;
-
-              /* Note that we must test if p[0] and p[1] is "within"
-               * the valid bounds rather than "not outside", because
-               * p[0] and p[1] might be NaN.
-               */
-              if (p[0] >= bounds[0] &&
-                  p[1] >= bounds[1] &&
-                  p[0] <= bounds[2] &&
-                  p[1] <= bounds[3])
-                {
-                  color_index = (int) (p[2] * CMAP_SIZE);
-
-                  if (color_index < 0)
-                    color_index = 0;
-                  else if (color_index > CMAP_SIZE - 1)
-                    color_index = CMAP_SIZE - 1;
-
-                  b = buckets +
-                      (int) (width * (p[0] - bounds[0]) * size[0]) +
-                      width * (int) (height * (p[1] - bounds[1]) * size[1]);
-
-                  for (k = 0; k < 4; k++)
-                    bump_no_overflow(b[0][k], cmap[color_index][k], short);
-                }
-            }
+          sample_jobs[i].cp            = &cp;
+          sample_jobs[i].n_sub_batches = (n_sub_batches / n_jobs +
+                                          (i < n_sub_batches % n_jobs));
+        }
+
+      run_jobs (sample_jobs, sizeof (sample_job), n_jobs,
+                n_sub_batches, 0.0, progress);
+
+      /* sum the histograms into the first one */
+      for (i = 1; i < n_jobs; i++)
+        {
+          bucket *src = sample_jobs[i].buckets;
+
+          for (j = 0; j < nbuckets; j++)
+            for (k = 0; k < 4; k++)
+              bump_no_overflow(buckets[j][k], src[j][k], short);
         }
 
       if (1)
@@ -336,61 +559,43 @@ render_rectangle (frame_spec    *spec,
               }
         }
     }
+  for (i = 0; i < n_jobs; i++)
+    {
+      if (i)
+        {
+          g_free (sample_jobs[i].buckets);
+          g_free (sample_jobs[i].points);
+        }
+      g_rand_free (sample_jobs[i].rand);
+    }
+  g_free (sample_jobs);
+
   /*
    * filter the accumulation buffer down into the image
    */
-  if (1)
+  filter_jobs = g_new0 (filter_job, n_jobs);
+  for (i = 0; i < n_jobs; i++)
     {
-      int    x, y;
-      double t[4];
-      double g = 1.0 / spec->cps[0].gamma;
-      y = 0;
-      for (j = 0; j < image_height; j++)
-        {
-          if (progress && (j % 32) == 0)
-            (*progress)(0.5 + 0.5 * j / (double)image_height);
-          x = 0;
-          for (i = 0; i < image_width; i++)
-            {
-              int            ii, jj, a;
-              unsigned char *p;
-              t[0] = t[1] = t[2] = t[3] = 0.0;
-              for (ii = 0; ii < filter_width; ii++)
-                for (jj = 0; jj < filter_width; jj++)
-                  {
-                    double k = filter[ii + jj * filter_width];
-                    abucket *a = accumulate + x + ii + (y + jj) * width;
-
-                    t[0] += k * a[0][0];
-                    t[1] += k * a[0][1];
-                    t[2] += k * a[0][2];
-                    t[3] += k * a[0][3];
-                  }
-              /* FIXME: we should probably use glib facilities to make
-               * this code readable
-               */
-              p = out + nchan * (i + j * out_width);
-              a = 256.0 * pow((double) t[0] / PREFILTER_WHITE, g) + 0.5;
-              if (a < 0) a = 0; else if (a > 255) a = 255;
-              p[0] = a;
-              a = 256.0 * pow((double) t[1] / PREFILTER_WHITE, g) + 0.5;
-              if (a < 0) a = 0; else if (a > 255) a = 255;
-              p[1] = a;
-              a = 256.0 * pow((double) t[2] / PREFILTER_WHITE, g) + 0.5;
-              if (a < 0) a = 0; else if (a > 255) a = 255;
-              p[2] = a;
-              if (nchan > 3)
-                {
-                  a = 256.0 * pow((double) t[3] / PREFILTER_WHITE, g) + 0.5;
-                  if (a < 0) a = 0; else if (a > 255) a = 255;
-                  p[3] = a;
-                }
-              x += oversample;
-            }
-          y += oversample;
-        }
+      filter_jobs[i].job.func     = filter_job_func;
+      filter_jobs[i].accumulate   = accumulate;
+      filter_jobs[i].filter       = filter;
+      filter_jobs[i].filter_width = filter_width;
+      filter_jobs[i].width        = width;
+      filter_jobs[i].oversample   = oversample;
+      filter_jobs[i].g            = 1.0 / spec->cps[0].gamma;
+      filter_jobs[i].out          = out;
+      filter_jobs[i].out_width    = out_width;
+      filter_jobs[i].nchan        = nchan;
+      filter_jobs[i].image_width  = image_width;
+      filter_jobs[i].y1           = (image_height * i) / n_jobs;
+      filter_jobs[i].y2           = (image_height * (i + 1)) / n_jobs;
     }
 
+  run_jobs (filter_jobs, sizeof (filter_job), n_jobs,
+            image_height, 0.5, progress);
+
+  g_free (filter_jobs);
+
   free (filter);
   free (temporal_filter);
   free (temporal_deltas);
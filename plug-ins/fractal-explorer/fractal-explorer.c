@@ -98,6 +98,23 @@ static gfloat        cy = -0.2;
 GimpDrawable        *drawable;
 static GList        *fractalexplorer_list = NULL;
 
+/* rows rendered per job of explorer_render_rows() */
+#define RENDER_JOB_ROWS 8
+
+typedef struct
+{
+  guchar *dest;
+  gint    row;
+  gint    n_rows;
+  gint    row_width;
+  gint    bpp;
+} RenderJob;
+
+static GThreadPool  *render_pool    = NULL;
+static GMutex        render_mutex;
+static GCond         render_cond;
+static gint          render_pending = 0;
+
 explorer_interface_t wint =
 {
     NULL,                       /* preview */
@@ -397,7 +414,6 @@ run (const gchar      *name,
 static void
 explorer (GimpDrawable * drawable)
 {
-  GimpPixelRgn  srcPR;
   GimpPixelRgn  destPR;
   gint          width;
   gint          height;
@@ -407,8 +423,8 @@ explorer (GimpDrawable * drawable)
   gint          y;
   gint          w;
   gint          h;
-  guchar       *src_row;
-  guchar       *dest_row;
+  gint          n_rows;
+  guchar       *dest_rows;
 
   /* Get the input area. This is the bounding box of the selection in
    *  the image (or the entire image if there is no selection). Only
@@ -426,12 +442,11 @@ explorer (GimpDrawable * drawable)
   height = drawable->height;
   bpp  = drawable->bpp;
 
-  /*  allocate row buffers  */
-  src_row  = g_new (guchar, bpp * w);
-  dest_row = g_new (guchar, bpp * w);
+  /*  allocate a strip of rows, rendered in parallel  */
+  n_rows    = MIN (h, gimp_tile_height () * 4);
+  dest_rows = g_new (guchar, bpp * w * n_rows);
 
-  /*  initialize the pixel regions  */
-  gimp_pixel_rgn_init (&srcPR, drawable, 0, 0, width, height, FALSE, FALSE);
+  /*  initialize the pixel region  */
   gimp_pixel_rgn_init (&destPR, drawable, 0, 0, width, height, TRUE, TRUE);
 
   xbild = width;
@@ -449,21 +464,20 @@ explorer (GimpDrawable * drawable)
                                             colormap[i].b);
     }
 
-  for (row = y; row < y + h; row++)
+  for (row = y; row < y + h; row += n_rows)
     {
-      gimp_pixel_rgn_get_row (&srcPR, src_row, x, row, w);
+      gint rows = MIN (n_rows, y + h - row);
 
-      explorer_render_row (src_row,
-                           dest_row,
-                           row,
-                           w,
-                           bpp);
+      explorer_render_rows (dest_rows,
+                            row,
+                            rows,
+                            w,
+                            bpp);
 
       /*  store the dest  */
-      gimp_pixel_rgn_set_row (&destPR, dest_row, x, row, w);
+      gimp_pixel_rgn_set_rect (&destPR, dest_rows, x, row, w, rows);
 
-      if ((row % 10) == 0)
-        gimp_progress_update ((double) row / (double) h);
+      gimp_progress_update ((double) (row - y + rows) / (double) h);
     }
   gimp_progress_update (1.0);
 
@@ -472,24 +486,25 @@ explorer (GimpDrawable * drawable)
   gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
   gimp_drawable_update (drawable->drawable_id, x, y, w, h);
 
-  g_free (src_row);
-  g_free (dest_row);
+  g_free (dest_rows);
 }
 
 /**********************************************************************
- FUNCTION: explorer_render_row
+ FUNCTION: explorer_iterate
  *********************************************************************/
 
-void
-explorer_render_row (const guchar *src_row,
-                     guchar       *dest_row,
-                     gint          row,
-                     gint          row_width,
-                     gint          bpp)
+/* Iterates the pixel at (a, b) until it escapes, and returns the
+ * number of iterations done; the final point is returned in px, py.
+ */
+static gint
+explorer_iterate (gdouble  a,
+                  gdouble  b,
+                  gdouble  cx,
+                  gdouble  cy,
+                  gint     iteration,
+                  gdouble *px,
+                  gdouble *py)
 {
-  gint    col;
-  gdouble a;
-  gdouble b;
   gdouble x;
   gdouble y;
   gdouble oldx;
@@ -503,149 +518,279 @@ explorer_render_row (const guchar *src_row,
   gdouble foldyinitx;
   gdouble foldyinity;
   gdouble xx = 0;
-  gdouble adjust;
-  gdouble cx;
-  gdouble cy;
   gint    counter;
-  gint    color;
-  gint    iteration;
-  gint    useloglog;
-  gdouble log2;
 
-  cx = wvals.cx;
-  cy = wvals.cy;
-  useloglog = wvals.useloglog;
-  iteration = wvals.iter;
-  log2 = log (2.0);
+  if (wvals.fractaltype != 0)
+    {
+      tmpx = x = a;
+      tmpy = y = b;
+    }
+  else
+    {
+      x = 0;
+      y = 0;
+    }
 
-  for (col = 0; col < row_width; col++)
+  for (counter = 0; counter < iteration; counter++)
+    {
+      oldx=x;
+      oldy=y;
+
+      switch (wvals.fractaltype)
+        {
+        case TYPE_MANDELBROT:
+          xx = x * x - y * y + a;
+          y = 2.0 * x * y + b;
+          break;
+
+        case TYPE_JULIA:
+          xx = x * x - y * y + cx;
+          y = 2.0 * x * y + cy;
+          break;
+
+        case TYPE_BARNSLEY_1:
+          foldxinitx = oldx * cx;
+          foldyinity = oldy * cy;
+          foldxinity = oldx * cy;
+          foldyinitx = oldy * cx;
+          /* orbit calculation */
+          if (oldx >= 0)
+            {
+              xx = (foldxinitx - cx - foldyinity);
+              y  = (foldyinitx - cy + foldxinity);
+            }
+          else
+            {
+              xx = (foldxinitx + cx - foldyinity);
+              y  = (foldyinitx + cy + foldxinity);
+            }
+          break;
+
+        case TYPE_BARNSLEY_2:
+          foldxinitx = oldx * cx;
+          foldyinity = oldy * cy;
+          foldxinity = oldx * cy;
+          foldyinitx = oldy * cx;
+          /* orbit calculation */
+          if (foldxinity + foldyinitx >= 0)
+            {
+              xx = foldxinitx - cx - foldyinity;
+              y  = foldyinitx - cy + foldxinity;
+            }
+          else
+            {
+              xx = foldxinitx + cx - foldyinity;
+              y  = foldyinitx + cy + foldxinity;
+            }
+          break;
+
+        case TYPE_BARNSLEY_3:
+          foldxinitx  = oldx * oldx;
+          foldyinity  = oldy * oldy;
+          foldxinity  = oldx * oldy;
+          /* orbit calculation */
+          if (oldx > 0)
+            {
+              xx = foldxinitx - foldyinity - 1.0;
+              y  = foldxinity * 2;
+            }
+          else
+            {
+              xx = foldxinitx - foldyinity -1.0 + cx * oldx;
+              y  = foldxinity * 2;
+              y += cy * oldx;
+            }
+          break;
+
+        case TYPE_SPIDER:
+          /* { c=z=pixel: z=z*z+c; c=c/2+z, |z|<=4 } */
+          xx = x*x - y*y + tmpx + cx;
+          y = 2 * oldx * oldy + tmpy +cy;
+          tmpx = tmpx/2 + xx;
+          tmpy = tmpy/2 + y;
+          break;
+
+        case TYPE_MAN_O_WAR:
+          xx = x*x - y*y + tmpx + cx;
+          y = 2.0 * x * y + tmpy + cy;
+          tmpx = oldx;
+          tmpy = oldy;
+          break;
+
+        case TYPE_LAMBDA:
+          tempsqrx = x * x;
+          tempsqry = y * y;
+          tempsqrx = oldx - tempsqrx + tempsqry;
+          tempsqry = -(oldy * oldx);
+          tempsqry += tempsqry + oldy;
+          xx = cx * tempsqrx - cy * tempsqry;
+          y = cx * tempsqry + cy * tempsqrx;
+          break;
+
+        case TYPE_SIERPINSKI:
+          xx = oldx + oldx;
+          y = oldy + oldy;
+          if (oldy > .5)
+            y = y - 1;
+          else if (oldx > .5)
+            xx = xx - 1;
+          break;
+
+        default:
+          break;
+        }
+
+      x = xx;
+
+      if (((x * x) + (y * y)) >= 4.0)
+        break;
+    }
+
+  *px = x;
+  *py = y;
+
+  return counter;
+}
+
+/**********************************************************************
+ FUNCTION: explorer_iterate_quadratic
+ *********************************************************************/
+
+#define EXPLORER_LANES 8
+
+/* Does what explorer_iterate() does for up to EXPLORER_LANES
+ * Mandelbrot or Julia pixels of a row at once.  The lanes iterate in
+ * lockstep, and a lane that escaped keeps its values, so each one ends
+ * exactly where explorer_iterate() would; without branches in the
+ * loop body, the compiler can keep the lanes in vector registers.
+ */
+static void
+explorer_iterate_quadratic (gint     col,
+                            gint     row,
+                            gint     n,
+                            gdouble  cx,
+                            gdouble  cy,
+                            gint     iteration,
+                            gint    *counters,
+                            gdouble *px,
+                            gdouble *py)
+{
+  gdouble x[EXPLORER_LANES];
+  gdouble y[EXPLORER_LANES];
+  gdouble cr[EXPLORER_LANES];
+  gdouble ci[EXPLORER_LANES];
+  gint    active[EXPLORER_LANES];
+  gint    n_active = n;
+  gint    counter;
+  gint    l;
+
+  for (l = 0; l < EXPLORER_LANES; l++)
     {
-      a = xmin + (double) col * xdiff;
-      b = ymin + (double) row * ydiff;
-      if (wvals.fractaltype != 0)
+      gdouble a = xmin + (double) (col + MIN (l, n - 1)) * xdiff;
+      gdouble b = ymin + (double) row * ydiff;
+
+      if (wvals.fractaltype == TYPE_MANDELBROT)
         {
-          tmpx = x = a;
-          tmpy = y = b;
+          x[l]  = 0;
+          y[l]  = 0;
+          cr[l] = a;
+          ci[l] = b;
         }
       else
         {
-          x = 0;
-          y = 0;
+          x[l]  = a;
+          y[l]  = b;
+          cr[l] = cx;
+          ci[l] = cy;
         }
 
-      for (counter = 0; counter < iteration; counter++)
+      active[l]   = l < n;
+      counters[l] = iteration;
+    }
+
+  for (counter = 0; counter < iteration && n_active > 0; counter++)
+    {
+      n_active = 0;
+
+      for (l = 0; l < EXPLORER_LANES; l++)
         {
-          oldx=x;
-          oldy=y;
+          gdouble xx      = x[l] * x[l] - y[l] * y[l] + cr[l];
+          gdouble yy      = 2.0 * x[l] * y[l] + ci[l];
+          gint    escaped = ((xx * xx) + (yy * yy)) >= 4.0;
 
-          switch (wvals.fractaltype)
-            {
-            case TYPE_MANDELBROT:
-              xx = x * x - y * y + a;
-              y = 2.0 * x * y + b;
-              break;
-
-            case TYPE_JULIA:
-              xx = x * x - y * y + cx;
-              y = 2.0 * x * y + cy;
-              break;
-
-            case TYPE_BARNSLEY_1:
-              foldxinitx = oldx * cx;
-              foldyinity = oldy * cy;
-              foldxinity = oldx * cy;
-              foldyinitx = oldy * cx;
-              /* orbit calculation */
-              if (oldx >= 0)
-                {
-                  xx = (foldxinitx - cx - foldyinity);
-                  y  = (foldyinitx - cy + foldxinity);
-                }
-              else
-                {
-                  xx = (foldxinitx + cx - foldyinity);
-                  y  = (foldyinitx + cy + foldxinity);
-                }
-              break;
-
-            case TYPE_BARNSLEY_2:
-              foldxinitx = oldx * cx;
-              foldyinity = oldy * cy;
-              foldxinity = oldx * cy;
-              foldyinitx = oldy * cx;
-              /* orbit calculation */
-              if (foldxinity + foldyinitx >= 0)
-                {
-                  xx = foldxinitx - cx - foldyinity;
-                  y  = foldyinitx - cy + foldxinity;
-                }
-              else
-                {
-                  xx = foldxinitx + cx - foldyinity;
-                  y  = foldyinitx + cy + foldxinity;
-                }
-              break;
-
-            case TYPE_BARNSLEY_3:
-              foldxinitx  = oldx * oldx;
-              foldyinity  = oldy * oldy;
-              foldxinity  = oldx * oldy;
-              /* orbit calculation */
-              if (oldx > 0)
-                {
-                  xx = foldxinitx - foldyinity - 1.0;
-                  y  = foldxinity * 2;
-                }
-              else
-                {
-                  xx = foldxinitx - foldyinity -1.0 + cx * oldx;
-                  y  = foldxinity * 2;
-                  y += cy * oldx;
-                }
-              break;
-
-            case TYPE_SPIDER:
-              /* { c=z=pixel: z=z*z+c; c=c/2+z, |z|<=4 } */
-              xx = x*x - y*y + tmpx + cx;
-              y = 2 * oldx * oldy + tmpy +cy;
-              tmpx = tmpx/2 + xx;
-              tmpy = tmpy/2 + y;
-              break;
-
-            case TYPE_MAN_O_WAR:
-              xx = x*x - y*y + tmpx + cx;
-              y = 2.0 * x * y + tmpy + cy;
-              tmpx = oldx;
-              tmpy = oldy;
-              break;
-
-            case TYPE_LAMBDA:
-              tempsqrx = x * x;
-              tempsqry = y * y;
-              tempsqrx = oldx - tempsqrx + tempsqry;
-              tempsqry = -(oldy * oldx);
-              tempsqry += tempsqry + oldy;
-              xx = cx * tempsqrx - cy * tempsqry;
-              y = cx * tempsqry + cy * tempsqrx;
-              break;
-
-            case TYPE_SIERPINSKI:
-              xx = oldx + oldx;
-              y = oldy + oldy;
-              if (oldy > .5)
-                y = y - 1;
-              else if (oldx > .5)
-                xx = xx - 1;
-              break;
-
-            default:
-              break;
-            }
+          x[l] = active[l] ? xx : x[l];
+          y[l] = active[l] ? yy : y[l];
 
-          x = xx;
+          counters[l] = (active[l] && escaped) ? counter : counters[l];
+          active[l]   = active[l] && ! escaped;
 
-          if (((x * x) + (y * y)) >= 4.0)
-            break;
+          n_active += active[l];
+        }
+    }
+
+  for (l = 0; l < n; l++)
+    {
+      px[l] = x[l];
+      py[l] = y[l];
+    }
+}
+
+/**********************************************************************
+ FUNCTION: explorer_render_row
+ *********************************************************************/
+
+void
+explorer_render_row (const guchar *src_row,
+                     guchar       *dest_row,
+                     gint          row,
+                     gint          row_width,
+                     gint          bpp)
+{
+  gint     col;
+  gdouble  x;
+  gdouble  y;
+  gdouble  adjust;
+  gdouble  cx;
+  gdouble  cy;
+  gint     counter;
+  gint     color;
+  gint     iteration;
+  gint     useloglog;
+  gdouble  log2;
+  gboolean quadratic;
+  gint     counters[EXPLORER_LANES];
+  gdouble  xs[EXPLORER_LANES];
+  gdouble  ys[EXPLORER_LANES];
+
+  cx = wvals.cx;
+  cy = wvals.cy;
+  useloglog = wvals.useloglog;
+  iteration = wvals.iter;
+  log2 = log (2.0);
+  quadratic = (wvals.fractaltype == TYPE_MANDELBROT ||
+               wvals.fractaltype == TYPE_JULIA);
+
+  for (col = 0; col < row_width; col++)
+    {
+      if (quadratic)
+        {
+          gint l = col % EXPLORER_LANES;
+
+          if (l == 0)
+            explorer_iterate_quadratic (col, row,
+                                        MIN (EXPLORER_LANES, row_width - col),
+                                        cx, cy, iteration,
+                                        counters, xs, ys);
+
+          counter = counters[l];
+          x       = xs[l];
+          y       = ys[l];
+        }
+      else
+        {
+          counter = explorer_iterate (xmin + (double) col * xdiff,
+                                      ymin + (double) row * ydiff,
+                                      cx, cy, iteration, &x, &y);
         }
 
       if (useloglog)
@@ -678,6 +823,77 @@ explorer_render_row (const guchar *src_row,
     }
 }
 
+/**********************************************************************
+ FUNCTION: explorer_render_rows
+ *********************************************************************/
+
+static void
+render_job_func (RenderJob *job,
+                 gpointer   user_data)
+{
+  gint i;
+
+  for (i = 0; i < job->n_rows; i++)
+    explorer_render_row (NULL,
+                         job->dest + i * job->row_width * job->bpp,
+                         job->row + i,
+                         job->row_width,
+                         job->bpp);
+
+  g_mutex_lock (&render_mutex);
+
+  if (--render_pending == 0)
+    g_cond_signal (&render_cond);
+
+  g_mutex_unlock (&render_mutex);
+}
+
+/* Renders n_rows rows starting at row into dest, in jobs of a few
+ * rows each run by a thread pool.  The cost of a row varies a lot
+ * across a fractal, so small jobs keep all processors busy.
+ */
+void
+explorer_render_rows (guchar *dest,
+                      gint    row,
+                      gint    n_rows,
+                      gint    row_width,
+                      gint    bpp)
+{
+  gint       n_jobs = (n_rows + RENDER_JOB_ROWS - 1) / RENDER_JOB_ROWS;
+  RenderJob *jobs;
+  gint       i;
+
+  if (n_jobs == 0)
+    return;
+
+  if (! render_pool)
+    render_pool = g_thread_pool_new ((GFunc) render_job_func, NULL,
+                                     g_get_num_processors (), FALSE, NULL);
+
+  jobs = g_new (RenderJob, n_jobs);
+
+  g_mutex_lock (&render_mutex);
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      jobs[i].row       = row + i * RENDER_JOB_ROWS;
+      jobs[i].n_rows    = MIN (RENDER_JOB_ROWS, row + n_rows - jobs[i].row);
+      jobs[i].dest      = dest + (gsize) i * RENDER_JOB_ROWS * row_width * bpp;
+      jobs[i].row_width = row_width;
+      jobs[i].bpp       = bpp;
+
+      render_pending++;
+      g_thread_pool_push (render_pool, &jobs[i], NULL);
+    }
+
+  while (render_pending > 0)
+    g_cond_wait (&render_cond, &render_mutex);
+
+  g_mutex_unlock (&render_mutex);
+
+  g_free (jobs);
+}
+
 static void
 delete_dialog_callback (GtkWidget *widget,
                         gboolean   delete,
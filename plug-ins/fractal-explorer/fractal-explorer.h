@@ -208,9 +208,14 @@ extern GimpDrawable   *drawable;
   Global functions
  *********************************************************************/
 
-void explorer_render_row (const guchar *src_row,
-                          guchar       *dest_row,
-                          gint          row,
-                          gint          row_width,
-                          gint          bpp);
+void explorer_render_row  (const guchar *src_row,
+                           guchar       *dest_row,
+                           gint          row,
+                           gint          row_width,
+                           gint          bpp);
+void explorer_render_rows (guchar       *dest,
+                           gint          row,
+                           gint          n_rows,
+                           gint          row_width,
+                           gint          bpp);
 #endif
@@ -38,6 +38,49 @@
 
 static gimpressionist_vals_t runningvals;
 
+/* A stroke, placed in series so that the random numbers are drawn in
+ * a fixed order, and then chosen, colored and painted by the jobs
+ * below, in parallel.
+ */
+typedef struct
+{
+  int    tx, ty;        /* top left corner of the brush */
+  int    on, sn;        /* orientation and size, if not adaptive */
+  double pick;          /* chooses among equally good brushes */
+  double noise[3];      /* color noise */
+  int    n;             /* brush */
+  int    r, g, b;       /* color */
+  int    band;          /* band painting it, or -1 if painted last */
+} stroke_t;
+
+typedef struct
+{
+  void (* func) (gpointer job);
+  int    first, last;   /* rows or strokes */
+} repaint_job_t;
+
+/* What the jobs of a repaint work on.  repaint() is not reentrant,
+ * so a single one does.
+ */
+static struct
+{
+  ppm_t    *p, *a;
+  ppm_t    *tmp, *atmp;
+  ppm_t    *map;
+  ppm_t    *brushes, *shadows;
+  double   *brushes_sum;
+  int       num_brushes;
+  int       maxbrushwidth, maxbrushheight;
+  stroke_t *strokes;
+  int       n_strokes;
+} ctx;
+
+static GThreadPool *repaint_pool    = NULL;
+static GMutex       repaint_mutex;
+static GCond        repaint_cond;
+static gint         repaint_pending = 0;
+static gint         repaint_done    = 0;
+
 static double
 get_siz_from_pcvals (double x, double y)
 {
@@ -126,7 +169,8 @@ get_hue (guchar *rgb)
 static int
 choose_best_brush (ppm_t *p, ppm_t *a, int tx, int ty,
                    ppm_t *brushes, int num_brushes,
-                   double *brushes_sum, int start, int step)
+                   double *brushes_sum, int start, int step,
+                   double pick)
 {
   double dev, thissum;
   double bestdev = 0.0;
@@ -217,7 +261,7 @@ choose_best_brush (ppm_t *p, ppm_t *a, int tx, int ty,
       return 0;
     }
 
-  i = g_rand_int_range (random_generator, 0, g_list_length (brlist));
+  i = MIN (pick * g_list_length (brlist), g_list_length (brlist) - 1);
   best = (long)((g_list_nth (brlist,i))->data);
   g_list_free (brlist);
 
@@ -346,6 +390,343 @@ apply_brush (ppm_t *brush,
     }
 }
 
+static void
+repaint_job_func (repaint_job_t *job,
+                  gpointer       user_data)
+{
+  job->func (job);
+
+  g_mutex_lock (&repaint_mutex);
+
+  if (--repaint_pending == 0)
+    g_cond_signal (&repaint_cond);
+
+  g_mutex_unlock (&repaint_mutex);
+}
+
+static void
+repaint_progress (double progress)
+{
+  if (runningvals.run)
+    {
+      gimp_progress_update (progress);
+    }
+  else
+    {
+      char tmps[40];
+
+      g_snprintf (tmps, sizeof (tmps), "%.1f %%", 100 * progress);
+      preview_set_button_label (tmps);
+
+      while (gtk_events_pending ())
+        gtk_main_iteration ();
+    }
+}
+
+/* Runs n_jobs jobs in parallel, and waits for them.  The jobs count
+ * what they have done of n_units in repaint_done, which is reported
+ * as progress from start to end.
+ */
+static void
+run_jobs (repaint_job_t *jobs,
+          gsize          job_size,
+          int            n_jobs,
+          int            n_units,
+          double         start,
+          double         end)
+{
+  int i;
+
+  if (! repaint_pool)
+    repaint_pool = g_thread_pool_new ((GFunc) repaint_job_func, NULL,
+                                      g_get_num_processors (), FALSE, NULL);
+
+  g_atomic_int_set (&repaint_done, 0);
+
+  g_mutex_lock (&repaint_mutex);
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      repaint_pending++;
+      g_thread_pool_push (repaint_pool, (char *) jobs + i * job_size, NULL);
+    }
+
+  while (repaint_pending > 0)
+    {
+      gint64 end_time = g_get_monotonic_time () + G_TIME_SPAN_SECOND / 10;
+
+      if (! g_cond_wait_until (&repaint_cond, &repaint_mutex, end_time))
+        {
+          g_mutex_unlock (&repaint_mutex);
+          repaint_progress (start + (end - start) *
+                            g_atomic_int_get (&repaint_done) /
+                            MAX (n_units, 1));
+          g_mutex_lock (&repaint_mutex);
+        }
+    }
+
+  g_mutex_unlock (&repaint_mutex);
+}
+
+/* Splits first..last into one job per processor, and runs them */
+static void
+run_split (void (* func) (gpointer job),
+           int     first,
+           int     last,
+           double  start,
+           double  end)
+{
+  int            n_jobs = MAX (1, MIN (g_get_num_processors (), last - first));
+  repaint_job_t *jobs   = g_new (repaint_job_t, n_jobs);
+  int            i;
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      jobs[i].func  = func;
+      jobs[i].first = first + (gint64) (last - first) * i / n_jobs;
+      jobs[i].last  = first + (gint64) (last - first) * (i + 1) / n_jobs;
+    }
+
+  run_jobs (jobs, sizeof (repaint_job_t), n_jobs, last - first, start, end);
+
+  g_free (jobs);
+}
+
+/* Rows of the manual orientation map */
+static void
+orient_map_job (gpointer data)
+{
+  repaint_job_t *job = data;
+  ppm_t         *map = ctx.map;
+  int            x, y;
+
+  for (y = job->first; y < job->last; y++)
+    {
+      guchar *dstrow = &map->col[y * map->width * 3];
+      double tmpy = y / (double)map->height;
+      for (x = 0; x < map->width; x++)
+        {
+          dstrow[x * 3] = get_pixel_value(90 -
+                                          get_direction(x /
+                                                        (double)map->width,
+                                                        tmpy, 1));
+        }
+    }
+}
+
+/* Rows of the manual size map */
+static void
+size_map_job (gpointer data)
+{
+  repaint_job_t *job = data;
+  ppm_t         *map = ctx.map;
+  int            x, y;
+
+  for (y = job->first; y < job->last; y++)
+    {
+      guchar *dstrow = &map->col[y * map->width * 3];
+      double tmpy = y / (double)map->height;
+
+      for (x = 0; x < map->width; x++)
+        {
+          dstrow[x * 3] = 255 * (1.0 - get_siz_from_pcvals (x / (double)map->width, tmpy));
+        }
+    }
+}
+
+/* Chooses the brush and color of strokes */
+static void
+stroke_job (gpointer data)
+{
+  repaint_job_t *job = data;
+  ppm_t         *p   = ctx.p;
+  int            i;
+
+  for (i = job->first; i < job->last; i++)
+    {
+      stroke_t *stroke = &ctx.strokes[i];
+      ppm_t    *brush;
+      int       sn = stroke->sn;
+      int       on = stroke->on;
+      int       tx = stroke->tx;
+      int       ty = stroke->ty;
+      int       r, g, b, n, x, y, h;
+
+      /* Handle Adaptive selections */
+      if (runningvals.orient_type == ORIENTATION_ADAPTIVE)
+        {
+          if (runningvals.size_type == SIZE_TYPE_ADAPTIVE)
+            n = choose_best_brush (p, ctx.a, tx, ty, ctx.brushes,
+                                   ctx.num_brushes, ctx.brushes_sum, 0, 1,
+                                   stroke->pick);
+          else
+            {
+              int st = sn * runningvals.orient_num;
+              n = choose_best_brush (p, ctx.a, tx, ty, ctx.brushes,
+                                     st+runningvals.orient_num,
+                                     ctx.brushes_sum, st, 1, stroke->pick);
+            }
+        }
+      else
+        {
+          if (runningvals.size_type == SIZE_TYPE_ADAPTIVE)
+            n = choose_best_brush (p, ctx.a, tx, ty, ctx.brushes,
+                                   ctx.num_brushes, ctx.brushes_sum,
+                                   on, runningvals.orient_num, stroke->pick);
+          else
+            n = sn * runningvals.orient_num + on;
+        }
+      /* Should never happen, but hey... */
+      if (n < 0)
+        n = 0;
+      else if (n >= ctx.num_brushes)
+        n = ctx.num_brushes - 1;
+
+      brush = &ctx.brushes[n];
+
+      /* Calculate color - avg. of in-brush pixels */
+      if (runningvals.color_type == 0)
+        {
+          double thissum = ctx.brushes_sum[n];
+
+          r = g = b = 0;
+          for (y = 0; y < brush->height; y++)
+            {
+              guchar *row = &p->col[(ty + y) * p->width * 3];
+
+              for (x = 0; x < brush->width; x++)
+                {
+                  int k = (tx + x) * 3;
+                  double v;
+
+                  if ((h = brush->col[y * brush->width * 3 + x * 3]))
+                    {
+                      v = h / 255.0;
+                      r += row[k+0] * v;
+                      g += row[k+1] * v;
+                      b += row[k+2] * v;
+                    }
+                }
+            }
+          r = r * 255.0 / thissum;
+          g = g * 255.0 / thissum;
+          b = b * 255.0 / thissum;
+        }
+      else if (runningvals.color_type == 1)
+        {
+          guchar *pixel;
+
+          y = ty + (brush->height / 2);
+          x = tx + (brush->width / 2);
+          pixel = &p->col[y*p->width * 3 + x * 3];
+          r = pixel[0];
+          g = pixel[1];
+          b = pixel[2];
+        }
+      else
+        {
+          /* No such color_type! */
+          r = g = b = 0;
+        }
+      if (runningvals.color_noise > 0.0)
+        {
+#define BOUNDS(a) (((a) < 0) ? (a) : ((a) > 255) ? 255 : (a))
+#define MYASSIGN(a, d) \
+    { \
+        a = a + (d); \
+        a = BOUNDS(a) ;       \
+    }
+          MYASSIGN (r, stroke->noise[0]);
+          MYASSIGN (g, stroke->noise[1]);
+          MYASSIGN (b, stroke->noise[2]);
+#undef BOUNDS
+#undef MYASSIGN
+        }
+
+      stroke->n = n;
+      stroke->r = r;
+      stroke->g = g;
+      stroke->b = b;
+
+      g_atomic_int_inc (&repaint_done);
+    }
+}
+
+static void
+paint_stroke (stroke_t *stroke)
+{
+  ppm_t *brush  = &ctx.brushes[stroke->n];
+  ppm_t *shadow = ctx.shadows ? &ctx.shadows[stroke->n] : NULL;
+  ppm_t *tmp    = ctx.tmp;
+  ppm_t *atmp   = ctx.atmp;
+  int    tx     = stroke->tx;
+  int    ty     = stroke->ty;
+  int    r      = stroke->r;
+  int    g      = stroke->g;
+  int    b      = stroke->b;
+
+  apply_brush (brush, shadow, tmp, atmp, tx,ty, r,g,b);
+
+  if (runningvals.general_tileable && runningvals.general_paint_edges)
+    {
+      int orig_width = tmp->width - 2 * ctx.maxbrushwidth;
+      int orig_height = tmp->height - 2 * ctx.maxbrushheight;
+      int dox = 0, doy = 0;
+
+      if (tx < ctx.maxbrushwidth)
+        {
+          apply_brush (brush, shadow, tmp, atmp, tx+orig_width,ty, r,g,b);
+          dox = -1;
+        }
+      else if (tx > orig_width)
+        {
+          apply_brush (brush, shadow, tmp, atmp, tx-orig_width,ty, r,g,b);
+          dox = 1;
+        }
+      if (ty < ctx.maxbrushheight)
+        {
+          apply_brush (brush, shadow, tmp, atmp, tx,ty+orig_height, r,g,b);
+          doy = 1;
+        }
+      else if (ty > orig_height)
+        {
+          apply_brush (brush, shadow, tmp, atmp, tx,ty-orig_height, r,g,b);
+          doy = -1;
+        }
+      if (doy)
+        {
+          if (dox < 0)
+            apply_brush (brush, shadow, tmp, atmp,
+                         tx+orig_width, ty + doy * orig_height, r, g, b);
+          if (dox > 0)
+            apply_brush (brush, shadow, tmp, atmp,
+                         tx-orig_width, ty + doy * orig_height, r, g, b);
+        }
+    }
+}
+
+/* Paints the strokes which lie within the bands first to last, in
+ * order.  Bands painted at the same time don't touch the same rows.
+ */
+static void
+paint_job (gpointer data)
+{
+  repaint_job_t *job = data;
+  int            i;
+
+  for (i = 0; i < ctx.n_strokes; i++)
+    {
+      stroke_t *stroke = &ctx.strokes[i];
+
+      if (stroke->band >= job->first && stroke->band < job->last)
+        {
+          paint_stroke (stroke);
+
+          g_atomic_int_inc (&repaint_done);
+        }
+    }
+}
+
 void
 repaint (ppm_t *p, ppm_t *a)
 {
@@ -353,20 +734,17 @@ repaint (ppm_t *p, ppm_t *a)
   int         tx = 0, ty = 0;
   ppm_t       tmp = {0, 0, NULL};
   ppm_t       atmp = {0, 0, NULL};
-  int         r, g, b, h, i, j, on, sn;
+  int         h, i, j, on, sn;
   int         num_brushes, maxbrushwidth, maxbrushheight;
   guchar      back[3] = {0, 0, 0};
   ppm_t      *brushes, *shadows;
-  ppm_t      *brush, *shadow = NULL;
   double     *brushes_sum;
   int         cx, cy, maxdist;
   double      scale, relief, startangle, anglespan, density, bgamma;
-  int         max_progress;
   ppm_t       paper_ppm = {0, 0, NULL};
   ppm_t       dirmap = {0, 0, NULL};
   ppm_t       sizmap = {0, 0, NULL};
   int        *xpos = NULL, *ypos = NULL;
-  int         progstep;
   static int  running = 0;
 
   int dropshadow = pcvals.general_drop_shadow;
@@ -463,8 +841,6 @@ repaint (ppm_t *p, ppm_t *a)
       brushes_sum[i] = sum_brush (&brushes[i]);
     }
 
-  brush = &brushes[0];
-
   maxbrushwidth = maxbrushheight = 0;
   for (i = 0; i < num_brushes; i++)
     {
@@ -673,18 +1049,8 @@ repaint (ppm_t *p, ppm_t *a)
 
     case ORIENTATION_MANUAL:
       ppm_new (&dirmap, p->width-maxbrushwidth*2, p->height-maxbrushheight*2);
-      for (y = 0; y < dirmap.height; y++)
-        {
-          guchar *dstrow = &dirmap.col[y * dirmap.width * 3];
-          double tmpy = y / (double)dirmap.height;
-          for (x = 0; x < dirmap.width; x++)
-            {
-              dstrow[x * 3] = get_pixel_value(90 -
-                                              get_direction(x /
-                                                            (double)dirmap.width,
-                                                            tmpy, 1));
-            }
-        }
+      ctx.map = &dirmap;
+      run_split (orient_map_job, 0, dirmap.height, 0.0, 0.0);
       edgepad (&dirmap,
                maxbrushwidth, maxbrushwidth,
                maxbrushheight, maxbrushheight);
@@ -774,17 +1140,8 @@ repaint (ppm_t *p, ppm_t *a)
       ppm_new (&sizmap,
                p->width-maxbrushwidth * 2,
                p->height-maxbrushheight * 2);
-
-      for (y = 0; y < sizmap.height; y++)
-        {
-          guchar *dstrow = &sizmap.col[y * sizmap.width * 3];
-          double tmpy = y / (double)sizmap.height;
-
-          for (x = 0; x < sizmap.width; x++)
-            {
-              dstrow[x * 3] = 255 * (1.0 - get_siz_from_pcvals (x / (double)sizmap.width, tmpy));
-            }
-        }
+      ctx.map = &sizmap;
+      run_split (size_map_job, 0, sizmap.height, 0.0, 0.0);
       edgepad (&sizmap,
                maxbrushwidth, maxbrushwidth,
                maxbrushheight, maxbrushheight);
@@ -809,11 +1166,6 @@ repaint (ppm_t *p, ppm_t *a)
   if (i < 1)
     i = 1;
 
-  max_progress = i;
-  progstep = max_progress / 30;
-  if (progstep < 10)
-    progstep = 10;
-
   if (runningvals.place_type == PLACEMENT_TYPE_EVEN_DIST)
     {
       int j;
@@ -839,29 +1191,23 @@ repaint (ppm_t *p, ppm_t *a)
         }
     }
 
+  ctx.p              = p;
+  ctx.a              = a;
+  ctx.tmp            = &tmp;
+  ctx.atmp           = &atmp;
+  ctx.brushes        = brushes;
+  ctx.shadows        = shadows;
+  ctx.brushes_sum    = brushes_sum;
+  ctx.num_brushes    = num_brushes;
+  ctx.maxbrushwidth  = maxbrushwidth;
+  ctx.maxbrushheight = maxbrushheight;
+  ctx.strokes        = g_new (stroke_t, i);
+  ctx.n_strokes      = 0;
+
+  /* Place the strokes */
   for (; i; i--)
     {
-      int n;
-      double thissum;
-
-      if (i % progstep == 0)
-        {
-          if(runningvals.run)
-            {
-              gimp_progress_update (0.8 - 0.8 * ((double)i / max_progress));
-            }
-          else
-            {
-              char tmps[40];
-
-              g_snprintf (tmps, sizeof (tmps),
-                          "%.1f %%", 100 * (1.0 - ((double)i / max_progress)));
-              preview_set_button_label (tmps);
-
-              while(gtk_events_pending())
-                gtk_main_iteration();
-            }
-        }
+      stroke_t *stroke;
 
       if (runningvals.place_type == PLACEMENT_TYPE_RANDOM)
         {
@@ -950,143 +1296,111 @@ repaint (ppm_t *p, ppm_t *a)
           break;
       }
 
-      /* Handle Adaptive selections */
-      if (runningvals.orient_type == ORIENTATION_ADAPTIVE)
-        {
-          if (runningvals.size_type == SIZE_TYPE_ADAPTIVE)
-            n = choose_best_brush (p, a, tx-maxbrushwidth/2,
-                                  ty-maxbrushheight/2, brushes,
-                                  num_brushes, brushes_sum, 0, 1);
-          else
-            {
-              int st = sn * runningvals.orient_num;
-              n = choose_best_brush (p, a, tx-maxbrushwidth/2,
-                                    ty-maxbrushheight/2, brushes,
-                                    st+runningvals.orient_num, brushes_sum,
-                                    st, 1);
-            }
-        }
-      else
+      stroke = &ctx.strokes[ctx.n_strokes++];
+
+      stroke->tx = tx - maxbrushwidth / 2;
+      stroke->ty = ty - maxbrushheight / 2;
+      stroke->on = on;
+      stroke->sn = sn;
+      stroke->pick = 0.0;
+      stroke->noise[0] = stroke->noise[1] = stroke->noise[2] = 0.0;
+
+      if (runningvals.orient_type == ORIENTATION_ADAPTIVE ||
+          runningvals.size_type == SIZE_TYPE_ADAPTIVE)
+        stroke->pick = g_rand_double (random_generator);
+
+      if (runningvals.color_noise > 0.0)
         {
-          if (runningvals.size_type == SIZE_TYPE_ADAPTIVE)
-            n = choose_best_brush (p, a, tx-maxbrushwidth/2,
-                                    ty-maxbrushheight/2, brushes,
-                                    num_brushes, brushes_sum,
-                                    on, runningvals.orient_num);
-          else
-            n = sn * runningvals.orient_num + on;
+          double v = runningvals.color_noise;
+
+          for (j = 0; j < 3; j++)
+            stroke->noise[j] = g_rand_double_range (random_generator,
+                                                    -v/2.0, v/2.0);
         }
-      /* Should never happen, but hey... */
-      if (n < 0)
-        n = 0;
-      else if (n >= num_brushes)
-        n = num_brushes - 1;
+    }
 
-      tx -= maxbrushwidth/2;
-      ty -= maxbrushheight/2;
+  /* Choose their brushes and colors */
+  run_split (stroke_job, 0, ctx.n_strokes, 0.0, 0.4);
+
+  /* Paint them, in bands of rows which are painted in parallel.
+   * Strokes which reach out of their band are painted in order
+   * after the bands, as are strokes which wrap around the edges.
+   */
+  {
+    int            shadow_top    = 0;
+    int            shadow_bottom = 0;
+    int            foot_height;
+    int            n_bands;
+    int            n_band_strokes = 0;
+    repaint_job_t *jobs;
+
+    if (dropshadow)
+      {
+        int sy = pcvals.general_shadow_depth - shadowblur * 2;
 
-      brush = &brushes[n];
-      if (dropshadow)
-        shadow = &shadows[n];
-      thissum = brushes_sum[n];
+        shadow_top    = MIN (0, sy);
+        shadow_bottom = MAX (maxbrushheight,
+                             sy + maxbrushheight + shadowblur * 4);
+      }
+    else
+      {
+        shadow_bottom = maxbrushheight;
+      }
+    foot_height = shadow_bottom - shadow_top;
 
-      /* Calculate color - avg. of in-brush pixels */
-      if (runningvals.color_type == 0)
-        {
-          r = g = b = 0;
-          for (y = 0; y < brush->height; y++)
-            {
-              guchar *row = &p->col[(ty + y) * p->width * 3];
+    n_bands = MIN (g_get_num_processors (),
+                   tmp.height / MAX (4 * foot_height, 1));
+    n_bands = MAX (n_bands, 1);
 
-              for (x = 0; x < brush->width; x++)
-                {
-                  int k = (tx + x) * 3;
-                  double v;
+    for (i = 0; i < ctx.n_strokes; i++)
+      {
+        stroke_t *stroke = &ctx.strokes[i];
+        int       y1     = stroke->ty + shadow_top;
+        int       y2     = stroke->ty + shadow_bottom;
+        int       band   = (gint64) MAX (y1, 0) * n_bands / tmp.height;
+        gboolean  wraps;
+
+        wraps = (runningvals.general_tileable &&
+                 runningvals.general_paint_edges &&
+                 (stroke->tx < maxbrushwidth ||
+                  stroke->tx > tmp.width - 2 * maxbrushwidth ||
+                  stroke->ty < maxbrushheight ||
+                  stroke->ty > tmp.height - 2 * maxbrushheight));
+
+        if (! wraps &&
+            y2 <= (gint64) tmp.height * (band + 1) / n_bands &&
+            band < n_bands)
+          {
+            stroke->band = band;
+            n_band_strokes++;
+          }
+        else
+          {
+            stroke->band = -1;
+          }
+      }
 
-                  if ((h = brush->col[y * brush->width * 3 + x * 3]))
-                    {
-                      v = h / 255.0;
-                      r += row[k+0] * v;
-                      g += row[k+1] * v;
-                      b += row[k+2] * v;
-                    }
-                }
-            }
-          r = r * 255.0 / thissum;
-          g = g * 255.0 / thissum;
-          b = b * 255.0 / thissum;
-        }
-      else if (runningvals.color_type == 1)
-        {
-          guchar *pixel;
+    jobs = g_new (repaint_job_t, n_bands);
+    for (i = 0; i < n_bands; i++)
+      {
+        jobs[i].func  = paint_job;
+        jobs[i].first = i;
+        jobs[i].last  = i + 1;
+      }
 
-          y = ty + (brush->height / 2);
-          x = tx + (brush->width / 2);
-          pixel = &p->col[y*p->width * 3 + x * 3];
-          r = pixel[0];
-          g = pixel[1];
-          b = pixel[2];
-        }
-      else
-        {
-          /* No such color_type! */
-          r = g = b = 0;
-        }
-      if (runningvals.color_noise > 0.0)
-        {
-          double v = runningvals.color_noise;
-#define BOUNDS(a) (((a) < 0) ? (a) : ((a) > 255) ? 255 : (a))
-#define MYASSIGN(a) \
-    { \
-        a = a + g_rand_double_range (random_generator, -v/2.0, v/2.0); \
-        a = BOUNDS(a) ;       \
-    }
-          MYASSIGN (r);
-          MYASSIGN (g);
-          MYASSIGN (b);
-#undef BOUNDS
-#undef MYASSIGN
-        }
+    run_jobs (jobs, sizeof (repaint_job_t), n_bands, n_band_strokes,
+              0.4, 0.8);
 
-      apply_brush (brush, shadow, &tmp, &atmp, tx,ty, r,g,b);
+    g_free (jobs);
 
-      if (runningvals.general_tileable && runningvals.general_paint_edges)
-        {
-          int orig_width = tmp.width - 2 * maxbrushwidth;
-          int orig_height = tmp.height - 2 * maxbrushheight;
-          int dox = 0, doy = 0;
+    for (i = 0; i < ctx.n_strokes; i++)
+      if (ctx.strokes[i].band < 0)
+        paint_stroke (&ctx.strokes[i]);
+  }
+
+  g_free (ctx.strokes);
+  ctx.strokes = NULL;
 
-          if (tx < maxbrushwidth)
-            {
-              apply_brush (brush, shadow, &tmp, &atmp, tx+orig_width,ty, r,g,b);
-              dox = -1;
-            }
-          else if (tx > orig_width)
-            {
-              apply_brush (brush, shadow, &tmp, &atmp, tx-orig_width,ty, r,g,b);
-              dox = 1;
-            }
-          if (ty < maxbrushheight)
-            {
-              apply_brush (brush, shadow, &tmp, &atmp, tx,ty+orig_height, r,g,b);
-              doy = 1;
-            }
-          else if (ty > orig_height)
-            {
-              apply_brush (brush, shadow, &tmp, &atmp, tx,ty-orig_height, r,g,b);
-              doy = -1;
-            }
-          if (doy)
-            {
-              if (dox < 0)
-                apply_brush (brush, shadow, &tmp, &atmp,
-                             tx+orig_width, ty + doy * orig_height, r, g, b);
-              if (dox > 0)
-                apply_brush (brush, shadow, &tmp, &atmp,
-                             tx-orig_width, ty + doy * orig_height, r, g, b);
-            }
-        }
-    }
   for (i = 0; i < num_brushes; i++)
     {
       ppm_kill (&brushes[i]);
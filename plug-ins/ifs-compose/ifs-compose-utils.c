@@ -30,12 +30,66 @@
 #include "ifs-compose.h"
 
 
+/* points generated by each chain between two painting passes */
+#define IFS_CHUNK 16384
+
 typedef struct
 {
   GdkPoint point;
   gdouble angle;
 } SortPoint;
 
+/* A point of the attractor, with its color */
+typedef struct
+{
+  gdouble x, y;
+  guchar  r, g, b;
+} IfsPoint;
+
+/* An independent random walk over the attractor.  Each thread of
+ * ifs_render() runs one chain, and keeps the points it generates in
+ * its own buffer until they are painted.
+ */
+typedef struct
+{
+  GRand    *rand;
+  gdouble   x, y;
+  gdouble   r, g, b;
+  gint      skip;
+  gint      n_steps;
+  IfsPoint *points;
+  gint      n_points;
+} IfsChain;
+
+typedef struct
+{
+  AffElement    **elements;
+  guint32        *prob;
+  gint            width;
+  gint            height;
+  gint            subdivide;
+  gint            band_y;
+  gint            band_height;
+  guchar         *data;
+  guchar         *mask;
+  guchar         *nhits;
+  guchar         *brush;
+  gint            brush_size;
+  gdouble         brush_offset;
+  gboolean        preview;
+  IfsChain       *chains;
+  gint            n_chains;
+} IfsRender;
+
+typedef struct
+{
+  void     (* func) (IfsRender *render,
+                     gint       first,
+                     gint       last);
+  IfsRender *render;
+  gint       first, last;
+} IfsJob;
+
 
 /* local functions */
 static void     aff_element_compute_click_boundary (AffElement     *elem,
@@ -47,6 +101,12 @@ static guchar * create_brush                       (IfsComposeVals *ifsvals,
                                                     gdouble        *brush_offset);
 
 
+static GThreadPool *ifs_render_pool    = NULL;
+static GMutex       ifs_render_mutex;
+static GCond        ifs_render_cond;
+static gint         ifs_render_pending = 0;
+
+
 void
 aff2_translate (Aff2    *naff,
                 gdouble  x,
@@ -882,6 +942,256 @@ create_brush (IfsComposeVals *ifsvals,
   return brush;
 }
 
+/* Advances the chains first..last - 1 by their n_steps, keeping the
+ * points which fall on the image.
+ */
+static void
+ifs_render_generate (IfsRender *render,
+                     gint       first,
+                     gint       last)
+{
+  gint c;
+
+  for (c = first; c < last; c++)
+    {
+      IfsChain *chain = &render->chains[c];
+      gint      i;
+
+      chain->n_points = 0;
+
+      for (i = 0; i < chain->n_steps; i++)
+        {
+          guint32  p0 = g_rand_int (chain->rand);
+          gint     k  = 0;
+          gint     ri, gi, bi;
+          gdouble  x, y;
+
+          while (p0 > render->prob[k])
+            k++;
+
+          aff2_apply (&render->elements[k]->trans,
+                      chain->x, chain->y, &chain->x, &chain->y);
+          aff3_apply (&render->elements[k]->color_trans,
+                      chain->r, chain->g, chain->b,
+                      &chain->r, &chain->g, &chain->b);
+
+          if (chain->skip > 0)
+            {
+              chain->skip--;
+              continue;
+            }
+
+          ri = (gint) (255.0 * chain->r + 0.5);
+          gi = (gint) (255.0 * chain->g + 0.5);
+          bi = (gint) (255.0 * chain->b + 0.5);
+
+          if ((ri < 0) || (ri > 255) ||
+              (gi < 0) || (gi > 255) ||
+              (bi < 0) || (bi > 255))
+            continue;
+
+          x = chain->x;
+          y = chain->y;
+
+          if (render->preview)
+            {
+              if ((x >= render->width) ||
+                  (y >= (render->band_y + render->band_height)) ||
+                  (x < 0) || (y < render->band_y))
+                continue;
+            }
+          else
+            {
+              if ((x >= render->width * render->subdivide) ||
+                  (y >= render->height * render->subdivide) ||
+                  (x < 0) || (y < 0))
+                continue;
+            }
+
+          chain->points[chain->n_points].x = x;
+          chain->points[chain->n_points].y = y;
+          chain->points[chain->n_points].r = ri;
+          chain->points[chain->n_points].g = gi;
+          chain->points[chain->n_points].b = bi;
+          chain->n_points++;
+        }
+    }
+}
+
+/* Paints the points of all chains which touch rows first..last - 1 of
+ * the band, clipped to those rows.
+ */
+static void
+ifs_render_paint (IfsRender *render,
+                  gint       first,
+                  gint       last)
+{
+  gint     width        = render->width;
+  gint     subdivide    = render->subdivide;
+  gint     band_y       = render->band_y;
+  guchar  *data         = render->data;
+  guchar  *mask         = render->mask;
+  guchar  *nhits        = render->nhits;
+  guchar  *brush        = render->brush;
+  gint     brush_size   = render->brush_size;
+  gdouble  brush_offset = render->brush_offset;
+  gint     c, i;
+
+  for (c = 0; c < render->n_chains; c++)
+    for (i = 0; i < render->chains[c].n_points; i++)
+      {
+        const IfsPoint *point = &render->chains[c].points[i];
+        gdouble         x     = point->x;
+        gdouble         y     = point->y;
+        guchar         *ptr;
+
+        if (render->preview)
+          {
+            gint row = (gint) (y - band_y);
+
+            if (row < first || row >= last)
+              continue;
+
+            ptr = data + 3 * (row * width + (gint) x);
+
+            *ptr++ = point->r;
+            *ptr++ = point->g;
+            *ptr   = point->b;
+          }
+        else
+          {
+            gint ii;
+            gint jj;
+            gint jj0   = floor (y - brush_offset - band_y * subdivide);
+            gint ii0   = floor (x - brush_offset);
+            gint jjmin = 0;
+            gint iimin = 0;
+            gint jjmax;
+            gint iimax;
+
+            if (ii0 < 0)
+              iimin = - ii0;
+            else
+              iimin = 0;
+
+            if (jj0 < first)
+              jjmin = first - jj0;
+            else
+              jjmin = 0;
+
+            if (jj0 + brush_size >= last)
+              jjmax = last - jj0;
+            else
+              jjmax = brush_size;
+
+            if (ii0 + brush_size >= subdivide * width)
+              iimax = subdivide * width - ii0;
+            else
+              iimax = brush_size;
+
+            for (jj = jjmin; jj < jjmax; jj++)
+              for (ii = iimin; ii < iimax; ii++)
+                {
+                  guint m_old;
+                  guint m_new;
+                  guint m_pix;
+                  guint n_hits;
+                  guint old_scale;
+                  guint pix_scale;
+                  gint  index = (jj0 + jj) * width * subdivide + ii0 + ii;
+
+                  n_hits = nhits[index];
+                  if (n_hits == 255)
+                    continue;
+
+                  m_pix = brush[jj * brush_size + ii];
+                  if (!m_pix)
+                    continue;
+
+                  nhits[index] = ++n_hits;
+                  m_old = mask[index];
+                  m_new = m_old + m_pix - m_old * m_pix / 255;
+                  mask[index] = m_new;
+
+                  /* relative probability that old colored pixel is on top */
+                  old_scale = m_old * (255 * n_hits - m_pix);
+
+                  /* relative probability that new colored pixel is on top */
+                  pix_scale = m_pix * ((255 - m_old) * n_hits + m_old);
+
+                  ptr = data + 3 * index;
+
+                  *ptr = ((old_scale * (*ptr) + pix_scale * point->r) /
+                          (old_scale + pix_scale));
+                  ptr++;
+
+                  *ptr = ((old_scale * (*ptr) + pix_scale * point->g) /
+                          (old_scale + pix_scale));
+                  ptr++;
+
+                  *ptr = ((old_scale * (*ptr) + pix_scale * point->b) /
+                          (old_scale + pix_scale));
+                }
+          }
+      }
+}
+
+static void
+ifs_render_job_func (IfsJob   *job,
+                     gpointer  user_data)
+{
+  job->func (job->render, job->first, job->last);
+
+  g_mutex_lock (&ifs_render_mutex);
+
+  if (--ifs_render_pending == 0)
+    g_cond_signal (&ifs_render_cond);
+
+  g_mutex_unlock (&ifs_render_mutex);
+}
+
+/* Splits first..last into n_jobs jobs running func, and waits for them */
+static void
+ifs_render_run (IfsRender *render,
+                void     (* func) (IfsRender *render,
+                                   gint       first,
+                                   gint       last),
+                gint       first,
+                gint       last,
+                gint       n_jobs)
+{
+  IfsJob *jobs;
+  gint    i;
+
+  n_jobs = CLAMP (n_jobs, 1, MAX (last - first, 1));
+  jobs   = g_new (IfsJob, n_jobs);
+
+  if (! ifs_render_pool)
+    ifs_render_pool = g_thread_pool_new ((GFunc) ifs_render_job_func, NULL,
+                                         g_get_num_processors (), FALSE,
+                                         NULL);
+
+  g_mutex_lock (&ifs_render_mutex);
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      jobs[i].func   = func;
+      jobs[i].render = render;
+      jobs[i].first  = first + (gint64) (last - first) * i / n_jobs;
+      jobs[i].last   = first + (gint64) (last - first) * (i + 1) / n_jobs;
+
+      ifs_render_pending++;
+      g_thread_pool_push (ifs_render_pool, &jobs[i], NULL);
+    }
+
+  while (ifs_render_pending > 0)
+    g_cond_wait (&ifs_render_cond, &ifs_render_mutex);
+
+  g_mutex_unlock (&ifs_render_mutex);
+
+  g_free (jobs);
+}
+
 void
 ifs_render (AffElement     **elements,
             gint             num_elements,
@@ -896,19 +1206,19 @@ ifs_render (AffElement     **elements,
             guchar          *nhits,
             gboolean         preview)
 {
-  gint     i, k, n;
-  gdouble  x, y;
-  gdouble  r, g, b;
-  gint     ri, gi, bi;
-  guint32  p0, psum;
-  gdouble  pt;
-  guchar  *ptr;
-  guint32 *prob;
-  gdouble *fprob;
-  gint     subdivide;
-  guchar  *brush = NULL;
-  gint     brush_size   = 1;
-  gdouble  brush_offset = 0.0;
+  IfsRender render;
+  gint      i;
+  gint      n_threads = g_get_num_processors ();
+  gint      n_rows;
+  gint      done;
+  guint32   psum;
+  gdouble   pt;
+  guint32  *prob;
+  gdouble  *fprob;
+  gint      subdivide;
+  guchar   *brush = NULL;
+  gint      brush_size   = 1;
+  gdouble   brush_offset = 0.0;
 
   if (preview)
     subdivide = 1;
@@ -957,131 +1267,67 @@ ifs_render (AffElement     **elements,
   if (!preview)
     brush = create_brush (vals, &brush_size, &brush_offset);
 
-  x = y = 0;
-  r = g = b = 0;
-
-  /* n is used to limit the number of progress updates */
-  n = nsteps / 32;
-
-  /* now run the iteration */
-  for (i = 0; i < nsteps; i++)
+  render.elements     = elements;
+  render.prob         = prob;
+  render.width        = width;
+  render.height       = height;
+  render.subdivide    = subdivide;
+  render.band_y       = band_y;
+  render.band_height  = band_height;
+  render.data         = data;
+  render.mask         = mask;
+  render.nhits        = nhits;
+  render.brush        = brush;
+  render.brush_size   = brush_size;
+  render.brush_offset = brush_offset;
+  render.preview      = preview;
+  render.n_chains     = CLAMP (nsteps / 1000, 1, n_threads);
+  render.chains       = g_new0 (IfsChain, render.n_chains);
+
+  for (i = 0; i < render.n_chains; i++)
     {
-      if (!preview && ((i % n) == 0))
-        gimp_progress_update ((gdouble) i / (gdouble) nsteps);
+      render.chains[i].rand   = g_rand_new_with_seed (g_random_int ());
+      render.chains[i].skip   = 50;
+      render.chains[i].points = g_new (IfsPoint, IFS_CHUNK);
+    }
 
-      p0 = g_random_int ();
-      k = 0;
+  /* rows the painting is split by */
+  if (preview)
+    n_rows = band_height;
+  else
+    n_rows = band_height * subdivide;
 
-      while (p0 > prob[k])
-        k++;
+  /* now run the iteration, IFS_CHUNK steps per chain at a time: all
+   * chains walk in parallel, then each thread paints the new points on
+   * its own rows of the band
+   */
+  for (done = 0; done < nsteps; )
+    {
+      gint steps = MIN (nsteps - done, render.n_chains * IFS_CHUNK);
 
-      aff2_apply (&elements[k]->trans, x, y, &x, &y);
-      aff3_apply (&elements[k]->color_trans, r, g, b, &r, &g, &b);
+      for (i = 0; i < render.n_chains; i++)
+        render.chains[i].n_steps =
+          (gint64) steps * (i + 1) / render.n_chains -
+          (gint64) steps * i / render.n_chains;
 
-      if (i < 50)
-        continue;
+      ifs_render_run (&render, ifs_render_generate,
+                      0, render.n_chains, render.n_chains);
+      ifs_render_run (&render, ifs_render_paint,
+                      0, n_rows, n_threads);
 
-      ri = (gint) (255.0 * r + 0.5);
-      gi = (gint) (255.0 * g + 0.5);
-      bi = (gint) (255.0 * b + 0.5);
+      done += steps;
 
-      if ((ri < 0) || (ri > 255) ||
-          (gi < 0) || (gi > 255) ||
-          (bi < 0) || (bi > 255))
-        continue;
+      if (!preview)
+        gimp_progress_update ((gdouble) done / (gdouble) nsteps);
+    }
 
-      if (preview)
-        {
-          if ((x < width) && (y < (band_y + band_height)) &&
-              (x >= 0) && (y >= band_y))
-            {
-              ptr = data + 3 * (((gint) (y - band_y)) * width + (gint) x);
+  for (i = 0; i < render.n_chains; i++)
+    {
+      g_rand_free (render.chains[i].rand);
+      g_free (render.chains[i].points);
+    }
 
-              *ptr++ = ri;
-              *ptr++ = gi;
-              *ptr   = bi;
-            }
-        }
-      else
-        {
-          if ((x < width * subdivide) && (y < height * subdivide) &&
-              (x >= 0) && (y >= 0))
-            {
-              gint ii;
-              gint jj;
-              gint jj0   = floor (y - brush_offset - band_y * subdivide);
-              gint ii0   = floor (x - brush_offset);
-              gint jjmin = 0;
-              gint iimin = 0;
-              gint jjmax;
-              gint iimax;
-
-              if (ii0 < 0)
-                iimin = - ii0;
-              else
-                iimin = 0;
-
-              if (jj0 < 0)
-                jjmin = - jj0;
-              else
-                jjmin = 0;
-
-              if (jj0 + brush_size >= subdivide * band_height)
-                jjmax = subdivide * band_height - jj0;
-              else
-                jjmax = brush_size;
-
-              if (ii0 + brush_size >= subdivide * width)
-                iimax = subdivide * width - ii0;
-              else
-                iimax = brush_size;
-
-              for (jj = jjmin; jj < jjmax; jj++)
-                for (ii = iimin; ii < iimax; ii++)
-                  {
-                    guint m_old;
-                    guint m_new;
-                    guint m_pix;
-                    guint n_hits;
-                    guint old_scale;
-                    guint pix_scale;
-                    gint  index = (jj0 + jj) * width * subdivide + ii0 + ii;
-
-                    n_hits = nhits[index];
-                    if (n_hits == 255)
-                      continue;
-
-                    m_pix = brush[jj * brush_size + ii];
-                    if (!m_pix)
-                      continue;
-
-                    nhits[index] = ++n_hits;
-                    m_old = mask[index];
-                    m_new = m_old + m_pix - m_old * m_pix / 255;
-                    mask[index] = m_new;
-
-                    /* relative probability that old colored pixel is on top */
-                    old_scale = m_old * (255 * n_hits - m_pix);
-
-                    /* relative probability that new colored pixel is on top */
-                    pix_scale = m_pix * ((255 - m_old) * n_hits + m_old);
-
-                    ptr = data + 3 * index;
-
-                    *ptr = ((old_scale * (*ptr) + pix_scale * ri) /
-                            (old_scale + pix_scale));
-                    ptr++;
-
-                    *ptr = ((old_scale * (*ptr) + pix_scale * gi) /
-                            (old_scale + pix_scale));
-                    ptr++;
-
-                    *ptr = ((old_scale * (*ptr) + pix_scale * bi) /
-                            (old_scale + pix_scale));
-                  }
-            }
-        }
-    } /* main iteration */
+  g_free (render.chains);
 
   if (!preview )
     gimp_progress_update (1.0);
@@ -16,6 +16,100 @@
 #include "libgimp/stdplugins-intl.h"
 
 
+/* Rows rendered by one job of the render pool */
+#define BAND_HEIGHT 32
+
+typedef struct
+{
+  gint     y1, y2;      /* Rows of the band                          */
+  guchar  *data;        /* Rendered rows, set by the job             */
+  gboolean done;
+} RenderBand;
+
+static GThreadPool  *render_pool    = NULL;
+static GMutex        render_mutex;
+static GCond         render_cond;
+
+static get_ray_func  render_ray_func;
+static guchar        render_bpp;
+static gboolean      render_has_alpha;
+
+
+/**************************************************************/
+/* Render a band of rows.  This runs in a thread of the pool, */
+/* with its own copy of the normals precompute_normals() uses */
+/**************************************************************/
+
+static void
+render_band (RenderBand *band,
+             gpointer    user_data)
+{
+  ShadeState  *state;
+  gboolean     bump_mapped;
+  gint         xcount, ycount;
+  gint32       index = 0;
+  GimpRGB      color;
+  GimpVector3  p;
+
+  bump_mapped = (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1);
+
+  state = shade_state_new ();
+  shade_state_set_current (state);
+
+  /* The normals of a row depend on the two rows before it, so
+   * compute those first; the first band starts like the whole
+   * image used to.
+   */
+  if (bump_mapped)
+    {
+      if (band->y1 < 2)
+        {
+          if (height >= 2)
+            interpol_row (0, width, 0);
+
+          for (ycount = 0; ycount < band->y1; ycount++)
+            precompute_normals (0, width, ycount);
+        }
+      else
+        {
+          precompute_normals (0, width, band->y1 - 2);
+          precompute_normals (0, width, band->y1 - 1);
+        }
+    }
+
+  band->data = g_new (guchar, (gsize) render_bpp * width *
+                              (band->y2 - band->y1));
+
+  for (ycount = band->y1; ycount < band->y2; ycount++)
+    {
+      if (bump_mapped)
+        precompute_normals (0, width, ycount);
+
+      for (xcount = 0; xcount < width; xcount++)
+        {
+          p = int_to_pos (xcount, ycount);
+          color = (* render_ray_func) (&p);
+
+          band->data[index++] = (guchar) (color.r * 255.0);
+          band->data[index++] = (guchar) (color.g * 255.0);
+          band->data[index++] = (guchar) (color.b * 255.0);
+
+          if (render_has_alpha)
+            band->data[index++] = (guchar) (color.a * 255.0);
+        }
+    }
+
+  shade_state_set_current (NULL);
+  shade_state_free (state);
+
+  g_mutex_lock (&render_mutex);
+
+  band->done = TRUE;
+  g_cond_signal (&render_cond);
+
+  g_mutex_unlock (&render_mutex);
+}
+
 /*************/
 /* Main loop */
 /*************/
@@ -23,20 +117,13 @@
 void
 compute_image (void)
 {
-  gint         xcount, ycount;
-  GimpRGB       color;
-  glong        progress_counter = 0;
-  GimpVector3  p;
   gint32       new_image_id = -1;
   gint32       new_layer_id = -1;
-  gint32       index;
-  guchar      *row = NULL;
-  guchar       obpp;
-  gboolean     has_alpha;
+  RenderBand  *bands;
+  gint         n_bands;
+  gint         i;
   get_ray_func ray_func;
 
-
-
   if (mapvals.create_new_image == TRUE ||
       (mapvals.transparent_background == TRUE &&
        ! gimp_drawable_has_alpha (input_drawable->drawable_id)))
@@ -97,47 +184,58 @@ compute_image (void)
   gimp_pixel_rgn_init (&dest_region, output_drawable,
 		       0, 0, width, height, TRUE, TRUE);
 
-  obpp = gimp_drawable_bpp (output_drawable->drawable_id);
-  has_alpha = gimp_drawable_has_alpha (output_drawable->drawable_id);
-
-  row = g_new (guchar, obpp * width);
+  render_ray_func  = ray_func;
+  render_bpp       = gimp_drawable_bpp (output_drawable->drawable_id);
+  render_has_alpha = gimp_drawable_has_alpha (output_drawable->drawable_id);
 
   gimp_progress_init (_("Lighting Effects"));
 
-  /* Init the first row */
-  if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1 && height >= 2)
-    interpol_row (0, width, 0);
+  /* The pixel regions may only be used from this thread, so read
+   * everything the shading needs up front
+   */
+  image_cache_pixels ();
 
-  for (ycount = 0; ycount < height; ycount++)
+  if (! render_pool)
     {
-      if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1)
-	precompute_normals (0, width, ycount);
+      render_pool = g_thread_pool_new ((GFunc) render_band, NULL,
+                                       g_get_num_processors (),
+                                       FALSE, NULL);
+    }
 
-      index = 0;
+  n_bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+  bands   = g_new0 (RenderBand, n_bands);
 
-      for (xcount = 0; xcount < width; xcount++)
-	{
-	  p = int_to_pos (xcount, ycount);
-	  color = (* ray_func) (&p);
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].y1 = i * BAND_HEIGHT;
+      bands[i].y2 = MIN (bands[i].y1 + BAND_HEIGHT, height);
+
+      g_thread_pool_push (render_pool, &bands[i], NULL);
+    }
 
-	  row[index++] = (guchar) (color.r * 255.0);
-	  row[index++] = (guchar) (color.g * 255.0);
-	  row[index++] = (guchar) (color.b * 255.0);
+  /* Write the bands in order as they are finished */
+  for (i = 0; i < n_bands; i++)
+    {
+      g_mutex_lock (&render_mutex);
+
+      while (! bands[i].done)
+        g_cond_wait (&render_cond, &render_mutex);
 
-	  if (has_alpha)
-	    row[index++] = (guchar) (color.a * 255.0);
+      g_mutex_unlock (&render_mutex);
 
-	  if ((progress_counter++ % width) == 0)
-	    gimp_progress_update ((gdouble) progress_counter /
-				  (gdouble) maxcounter);
-	}
+      gimp_pixel_rgn_set_rect (&dest_region, bands[i].data,
+                               0, bands[i].y1,
+                               width, bands[i].y2 - bands[i].y1);
+      g_free (bands[i].data);
 
-      gimp_pixel_rgn_set_row (&dest_region, row, 0, ycount, width);
+      gimp_progress_update ((gdouble) bands[i].y2 / (gdouble) height);
     }
 
   gimp_progress_update (1.0);
 
-  g_free (row);
+  g_free (bands);
+
+  image_free_cached_pixels ();
 
   /* Update image */
   /* ============ */
@@ -32,6 +32,12 @@ GimpRGB         peek            (gint          x,
 				gint          y);
 GimpRGB         peek_env_map    (gint          x,
 				gint          y);
+void           peek_map_row    (guchar       *row,
+				gint          x,
+				gint          y,
+				gint          w);
+void           image_cache_pixels       (void);
+void           image_free_cached_pixels (void);
 void           poke            (gint          x,
 				gint          y,
 				GimpRGB       *color);
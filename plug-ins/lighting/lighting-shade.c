@@ -11,14 +11,35 @@
 #include "lighting-shade.h"
 
 
-static GimpVector3 *triangle_normals[2] = { NULL, NULL };
-static GimpVector3 *vertex_normals[3]   = { NULL, NULL, NULL };
-static gdouble     *heights[3] = { NULL, NULL, NULL };
+/* The normals and heights of the rows around the one being shaded.
+ * precompute_normals() advances them by one row, so each thread that
+ * renders rows needs its own set, see shade_state_set_current().
+ */
+struct _ShadeState
+{
+  GimpVector3 *triangle_normals[2];
+  GimpVector3 *vertex_normals[3];
+  gdouble     *heights[3];
+  guchar      *bumprow;
+};
+
+static ShadeState   default_state = { { NULL, }, { NULL, }, { NULL, }, NULL };
+static GPrivate     current_state;
+
 static gdouble      xstep, ystep;
-static guchar      *bumprow = NULL;
 
 static gint pre_w = -1;
 static gint pre_h = -1;
+static gint pre_bpp = 1;    /* of the bump map, looked up once so that */
+                            /* rendering threads need no PDB calls     */
+
+static inline ShadeState *
+shade_state_get (void)
+{
+  ShadeState *state = g_private_get (&current_state);
+
+  return state ? state : &default_state;
+}
 
 /*****************/
 /* Phong shading */
@@ -31,7 +52,8 @@ phong_shade (GimpVector3 *position,
              GimpVector3 *lightposition,
              GimpRGB      *diff_col,
              GimpRGB      *light_col,
-             LightType    light_type)
+             LightType    light_type,
+             gdouble      diffuse_int)
 {
   GimpRGB       diffuse_color, specular_color;
   gdouble      nl, rv, dist;
@@ -82,7 +104,7 @@ phong_shade (GimpVector3 *position,
       /* =================================================== */
 
       diffuse_color = *light_col;
-      gimp_rgb_multiply (&diffuse_color, mapvals.material.diffuse_int);
+      gimp_rgb_multiply (&diffuse_color, diffuse_int);
       diffuse_color.r *= diff_col->r;
       diffuse_color.g *= diff_col->g;
       diffuse_color.b *= diff_col->b;
@@ -107,64 +129,108 @@ phong_shade (GimpVector3 *position,
   return diffuse_color;
 }
 
-void
-precompute_init (gint w,
-                 gint h)
+static void
+shade_state_clear (ShadeState *state)
 {
   gint n;
-  gint bpp=1;
-
-  xstep = 1.0 / (gdouble) width;
-  ystep = 1.0 / (gdouble) height;
-
-  pre_w = w;
-  pre_h = h;
 
   for (n = 0; n < 3; n++)
     {
-      if (vertex_normals[n] != NULL)
-        g_free (vertex_normals[n]);
-      if (heights[n] != NULL)
-        g_free (heights[n]);
-
-      heights[n] = g_new (gdouble, w);
-      vertex_normals[n] = g_new (GimpVector3, w);
+      g_clear_pointer (&state->heights[n], g_free);
+      g_clear_pointer (&state->vertex_normals[n], g_free);
     }
 
   for (n = 0; n < 2; n++)
-    if (triangle_normals[n] != NULL)
-      g_free (triangle_normals[n]);
+    g_clear_pointer (&state->triangle_normals[n], g_free);
 
-  if (bumprow != NULL)
-    {
-      g_free (bumprow);
-      bumprow = NULL;
-    }
-  if (mapvals.bumpmap_id != -1)
+  g_clear_pointer (&state->bumprow, g_free);
+}
+
+static void
+shade_state_init (ShadeState *state,
+                  gint        w)
+{
+  gint n;
+
+  shade_state_clear (state);
+
+  for (n = 0; n < 3; n++)
     {
-      bpp = gimp_drawable_bpp(mapvals.bumpmap_id);
+      state->heights[n] = g_new (gdouble, w);
+      state->vertex_normals[n] = g_new (GimpVector3, w);
     }
 
-  bumprow = g_new (guchar, w * bpp);
+  state->bumprow = g_new (guchar, w * pre_bpp);
 
-  triangle_normals[0] = g_new (GimpVector3, (w << 1) + 2);
-  triangle_normals[1] = g_new (GimpVector3, (w << 1) + 2);
+  state->triangle_normals[0] = g_new (GimpVector3, (w << 1) + 2);
+  state->triangle_normals[1] = g_new (GimpVector3, (w << 1) + 2);
 
   for (n = 0; n < (w << 1) + 1; n++)
     {
-      gimp_vector3_set (&triangle_normals[0][n], 0.0, 0.0, 1.0);
-      gimp_vector3_set (&triangle_normals[1][n], 0.0, 0.0, 1.0);
+      gimp_vector3_set (&state->triangle_normals[0][n], 0.0, 0.0, 1.0);
+      gimp_vector3_set (&state->triangle_normals[1][n], 0.0, 0.0, 1.0);
     }
 
   for (n = 0; n < w; n++)
     {
-      gimp_vector3_set (&vertex_normals[0][n], 0.0, 0.0, 1.0);
-      gimp_vector3_set (&vertex_normals[1][n], 0.0, 0.0, 1.0);
-      gimp_vector3_set (&vertex_normals[2][n], 0.0, 0.0, 1.0);
-      heights[0][n] = 0.0;
-      heights[1][n] = 0.0;
-      heights[2][n] = 0.0;
+      gimp_vector3_set (&state->vertex_normals[0][n], 0.0, 0.0, 1.0);
+      gimp_vector3_set (&state->vertex_normals[1][n], 0.0, 0.0, 1.0);
+      gimp_vector3_set (&state->vertex_normals[2][n], 0.0, 0.0, 1.0);
+      state->heights[0][n] = 0.0;
+      state->heights[1][n] = 0.0;
+      state->heights[2][n] = 0.0;
+    }
+}
+
+void
+precompute_init (gint w,
+                 gint h)
+{
+  xstep = 1.0 / (gdouble) width;
+  ystep = 1.0 / (gdouble) height;
+
+  pre_w = w;
+  pre_h = h;
+
+  pre_bpp = 1;
+  if (mapvals.bumpmap_id != -1)
+    {
+      pre_bpp = gimp_drawable_bpp(mapvals.bumpmap_id);
     }
+
+  shade_state_init (&default_state, w);
+}
+
+/* Per-thread shading state, initialized like the one precompute_init()
+ * sets up.  Must be called after precompute_init().
+ */
+
+ShadeState *
+shade_state_new (void)
+{
+  ShadeState *state = g_slice_new0 (ShadeState);
+
+  shade_state_init (state, pre_w);
+
+  return state;
+}
+
+void
+shade_state_free (ShadeState *state)
+{
+  shade_state_clear (state);
+
+  g_slice_free (ShadeState, state);
+}
+
+/* Makes the shading functions called from this thread use STATE,
+ * or the default state if STATE is NULL.
+ */
+
+void
+shade_state_set_current (ShadeState *state)
+{
+  g_private_set (&current_state, state);
 }
 
 
@@ -182,17 +248,15 @@ interpol_row (gint x1,
   gint          bpp = 1;
   guchar* bumprow1 = NULL;
   guchar* bumprow2 = NULL;
+  ShadeState   *state = shade_state_get ();
 
-  if (mapvals.bumpmap_id != -1)
-    {
-      bpp = gimp_drawable_bpp(mapvals.bumpmap_id);
-    }
+  bpp = pre_bpp;
 
   bumprow1 = g_new (guchar, pre_w * bpp);
   bumprow2 = g_new (guchar, pre_w * bpp);
 
-  gimp_pixel_rgn_get_row (&bump_region, bumprow1, x1, y, x2 - x1);
-  gimp_pixel_rgn_get_row (&bump_region, bumprow2, x1, y+1, x2 - x1);
+  peek_map_row (bumprow1, x1, y, x2 - x1);
+  peek_map_row (bumprow2, x1, y+1, x2 - x1);
 
   if (mapvals.bumpmaptype > 0)
     {
@@ -232,13 +296,13 @@ interpol_row (gint x1,
 
       if (mapvals.bumpmaptype > 0)
         {
-          heights[1][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval1] / 255.0;
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval] / 255.0;
+          state->heights[1][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval1] / 255.0;
+          state->heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval] / 255.0;
         }
       else
         {
-          heights[1][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval1 / 255.0;
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval / 255.0;
+          state->heights[1][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval1 / 255.0;
+          state->heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval / 255.0;
         }
     }
 
@@ -248,21 +312,21 @@ interpol_row (gint x1,
       /* heights rows 1 and 2 are inverted */
       p1.x = 0.0;
       p1.y = ystep;
-      p1.z = heights[1][n] - heights[2][n];
+      p1.z = state->heights[1][n] - state->heights[2][n];
 
       p2.x = xstep;
       p2.y = ystep;
-      p2.z = heights[1][n+1] - heights[2][n];
+      p2.z = state->heights[1][n+1] - state->heights[2][n];
 
       p3.x = xstep;
       p3.y = 0.0;
-      p3.z = heights[2][n+1] - heights[2][n];
+      p3.z = state->heights[2][n+1] - state->heights[2][n];
 
-      triangle_normals[1][i] = gimp_vector3_cross_product (&p2, &p1);
-      triangle_normals[1][i+1] = gimp_vector3_cross_product (&p3, &p2);
+      state->triangle_normals[1][i] = gimp_vector3_cross_product (&p2, &p1);
+      state->triangle_normals[1][i+1] = gimp_vector3_cross_product (&p3, &p2);
 
-      gimp_vector3_normalize (&triangle_normals[1][i]);
-      gimp_vector3_normalize (&triangle_normals[1][i+1]);
+      gimp_vector3_normalize (&state->triangle_normals[1][i]);
+      gimp_vector3_normalize (&state->triangle_normals[1][i+1]);
 
       i += 2;
     }
@@ -287,31 +351,29 @@ precompute_normals (gint x1,
   guchar      *map = NULL;
   gint bpp = 1;
   guchar mapval;
+  ShadeState  *state = shade_state_get ();
 
 
   /* First, compute the heights */
   /* ========================== */
 
-  tmpv                = triangle_normals[0];
-  triangle_normals[0] = triangle_normals[1];
-  triangle_normals[1] = tmpv;
+  tmpv                       = state->triangle_normals[0];
+  state->triangle_normals[0] = state->triangle_normals[1];
+  state->triangle_normals[1] = tmpv;
 
-  tmpv              = vertex_normals[0];
-  vertex_normals[0] = vertex_normals[1];
-  vertex_normals[1] = vertex_normals[2];
-  vertex_normals[2] = tmpv;
+  tmpv                     = state->vertex_normals[0];
+  state->vertex_normals[0] = state->vertex_normals[1];
+  state->vertex_normals[1] = state->vertex_normals[2];
+  state->vertex_normals[2] = tmpv;
 
-  tmpd       = heights[0];
-  heights[0] = heights[1];
-  heights[1] = heights[2];
-  heights[2] = tmpd;
+  tmpd              = state->heights[0];
+  state->heights[0] = state->heights[1];
+  state->heights[1] = state->heights[2];
+  state->heights[2] = tmpd;
 
-  if (mapvals.bumpmap_id != -1)
-    {
-      bpp = gimp_drawable_bpp(mapvals.bumpmap_id);
-    }
+  bpp = pre_bpp;
 
-  gimp_pixel_rgn_get_row (&bump_region, bumprow, x1, y, x2 - x1);
+  peek_map_row (state->bumprow, x1, y, x2 - x1);
 
   if (mapvals.bumpmaptype > 0)
     {
@@ -332,14 +394,14 @@ precompute_normals (gint x1,
         {
           if (bpp>1)
             {
-              mapval = (guchar)((float)((bumprow[n * bpp] +bumprow[n * bpp +1] + bumprow[n * bpp + 2])/3.0 )) ;
+              mapval = (guchar)((float)((state->bumprow[n * bpp] +state->bumprow[n * bpp +1] + state->bumprow[n * bpp + 2])/3.0 )) ;
             }
           else
             {
-              mapval = bumprow[n * bpp];
+              mapval = state->bumprow[n * bpp];
             }
 
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval] / 255.0;
+          state->heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval] / 255.0;
         }
     }
   else
@@ -348,13 +410,13 @@ precompute_normals (gint x1,
         {
           if (bpp>1)
             {
-              mapval = (guchar)((float)((bumprow[n * bpp] +bumprow[n * bpp +1] + bumprow[n * bpp + 2])/3.0 )) ;
+              mapval = (guchar)((float)((state->bumprow[n * bpp] +state->bumprow[n * bpp +1] + state->bumprow[n * bpp + 2])/3.0 )) ;
             }
           else
             {
-              mapval = bumprow[n * bpp];
+              mapval = state->bumprow[n * bpp];
             }
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval / 255.0;
+          state->heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval / 255.0;
         }
     }
 
@@ -366,21 +428,21 @@ precompute_normals (gint x1,
     {
       p1.x = 0.0;
       p1.y = ystep;
-      p1.z = heights[2][n] - heights[1][n];
+      p1.z = state->heights[2][n] - state->heights[1][n];
 
       p2.x = xstep;
       p2.y = ystep;
-      p2.z = heights[2][n+1] - heights[1][n];
+      p2.z = state->heights[2][n+1] - state->heights[1][n];
 
       p3.x = xstep;
       p3.y = 0.0;
-      p3.z = heights[1][n+1] - heights[1][n];
+      p3.z = state->heights[1][n+1] - state->heights[1][n];
 
-      triangle_normals[1][i] = gimp_vector3_cross_product (&p2, &p1);
-      triangle_normals[1][i+1] = gimp_vector3_cross_product (&p3, &p2);
+      state->triangle_normals[1][i] = gimp_vector3_cross_product (&p2, &p1);
+      state->triangle_normals[1][i+1] = gimp_vector3_cross_product (&p3, &p2);
 
-      gimp_vector3_normalize (&triangle_normals[1][i]);
-      gimp_vector3_normalize (&triangle_normals[1][i+1]);
+      gimp_vector3_normalize (&state->triangle_normals[1][i]);
+      gimp_vector3_normalize (&state->triangle_normals[1][i+1]);
 
       i += 2;
     }
@@ -399,14 +461,14 @@ precompute_normals (gint x1,
         {
           if (y > 0)
             {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i-1]);
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i-2]);
+              gimp_vector3_add (&normal, &normal, &state->triangle_normals[0][i-1]);
+              gimp_vector3_add (&normal, &normal, &state->triangle_normals[0][i-2]);
               nv += 2;
             }
 
           if (y < pre_h)
             {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[1][i-1]);
+              gimp_vector3_add (&normal, &normal, &state->triangle_normals[1][i-1]);
               nv++;
             }
         }
@@ -415,22 +477,22 @@ precompute_normals (gint x1,
         {
           if (y > 0)
             {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i]);
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i+1]);
+              gimp_vector3_add (&normal, &normal, &state->triangle_normals[0][i]);
+              gimp_vector3_add (&normal, &normal, &state->triangle_normals[0][i+1]);
               nv += 2;
             }
 
           if (y < pre_h)
             {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[1][i]);
-              gimp_vector3_add (&normal, &normal, &triangle_normals[1][i+1]);
+              gimp_vector3_add (&normal, &normal, &state->triangle_normals[1][i]);
+              gimp_vector3_add (&normal, &normal, &state->triangle_normals[1][i+1]);
               nv += 2;
             }
         }
 
       gimp_vector3_mul (&normal, 1.0 / (gdouble) nv);
       gimp_vector3_normalize (&normal);
-      vertex_normals[1][n] = normal;
+      state->vertex_normals[1][n] = normal;
 
       i += 2;
     }
@@ -467,8 +529,8 @@ sphere_to_image (GimpVector3 *normal,
                  gdouble     *u,
                  gdouble     *v)
 {
-  static gdouble     alpha, fac;
-  static GimpVector3 cross_prod;
+  gdouble            alpha, fac;
+  GimpVector3        cross_prod;
   static GimpVector3 firstaxis  = { 1.0, 0.0, 0.0 };
   static GimpVector3 secondaxis = { 0.0, 1.0, 0.0 };
 
@@ -516,12 +578,13 @@ get_ray_color (GimpVector3 *position)
   gdouble       xf, yf;
   GimpVector3   normal, *p;
   gint          k;
+  ShadeState   *state = shade_state_get ();
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
   x = RINT (xf);
 
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && state->heights[1][x] == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -553,11 +616,12 @@ get_ray_color (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
           else
             {
-              normal = vertex_normals[1][(gint) RINT (xf)];
+              normal = state->vertex_normals[1][(gint) RINT (xf)];
 
               light_color = phong_shade (position,
                                          &mapvals.viewpoint,
@@ -565,7 +629,8 @@ get_ray_color (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
 
           gimp_rgb_add (&color_sum, &light_color);
@@ -587,7 +652,7 @@ get_ray_color_ref (GimpVector3 *position)
   gdouble      xf, yf;
   GimpVector3  normal, *p, v, r;
   gint         k;
-  gdouble      tmpval;
+  ShadeState  *state = shade_state_get ();
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
@@ -596,10 +661,10 @@ get_ray_color_ref (GimpVector3 *position)
   if (mapvals.bump_mapped == FALSE || mapvals.bumpmap_id == -1)
     normal = mapvals.planenormal;
   else
-    normal = vertex_normals[1][(gint) RINT (xf)];
+    normal = state->vertex_normals[1][(gint) RINT (xf)];
   gimp_vector3_normalize (&normal);
 
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && state->heights[1][x] == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -628,7 +693,8 @@ get_ray_color_ref (GimpVector3 *position)
                                      p,
                                      &color,
                                      &color_int,
-                                     mapvals.lightsource[0].type);
+                                     mapvals.lightsource[0].type,
+                                     mapvals.material.diffuse_int);
         }
 
       gimp_vector3_sub (&v, &mapvals.viewpoint, position);
@@ -643,18 +709,14 @@ get_ray_color_ref (GimpVector3 *position)
       env_color = peek_env_map (RINT (env_width * xf),
                                 RINT (env_height * yf));
 
-      tmpval = mapvals.material.diffuse_int;
-      mapvals.material.diffuse_int = 0.;
-
       light_color = phong_shade (position,
                                  &mapvals.viewpoint,
                                  &normal,
                                  &r,
                                  &color,
                                  &env_color,
-                                 DIRECTIONAL_LIGHT);
-
-      mapvals.material.diffuse_int = tmpval;
+                                 DIRECTIONAL_LIGHT,
+                                 0.0);
 
       gimp_rgb_add (&color_sum, &light_color);
     }
@@ -674,13 +736,14 @@ get_ray_color_no_bilinear (GimpVector3 *position)
   gdouble       xf, yf;
   GimpVector3   normal, *p;
   gint          k;
+  ShadeState   *state = shade_state_get ();
 
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
   x = RINT (xf);
 
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && state->heights[1][x] == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -712,11 +775,12 @@ get_ray_color_no_bilinear (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
           else
             {
-              normal = vertex_normals[1][x];
+              normal = state->vertex_normals[1][x];
 
               light_color = phong_shade (position,
                                          &mapvals.viewpoint,
@@ -724,7 +788,8 @@ get_ray_color_no_bilinear (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
 
           gimp_rgb_add (&color_sum, &light_color);
@@ -746,7 +811,7 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
   gdouble      xf, yf;
   GimpVector3  normal, *p, v, r;
   gint         k;
-  gdouble      tmpval;
+  ShadeState  *state = shade_state_get ();
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
@@ -755,10 +820,10 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
   if (mapvals.bump_mapped == FALSE || mapvals.bumpmap_id == -1)
     normal = mapvals.planenormal;
   else
-    normal = vertex_normals[1][(gint) RINT (xf)];
+    normal = state->vertex_normals[1][(gint) RINT (xf)];
   gimp_vector3_normalize (&normal);
 
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && state->heights[1][x] == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -787,7 +852,8 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[0].type);
+                                         mapvals.lightsource[0].type,
+                                         mapvals.material.diffuse_int);
         }
 
       gimp_vector3_sub (&v, &mapvals.viewpoint, position);
@@ -802,18 +868,14 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
       env_color = peek_env_map (RINT (env_width * xf),
                                 RINT (env_height * yf));
 
-      tmpval = mapvals.material.diffuse_int;
-      mapvals.material.diffuse_int = 0.;
-
       light_color = phong_shade (position,
                                  &mapvals.viewpoint,
                                  &normal,
                                  &r,
                                  &color,
                                  &env_color,
-                                 DIRECTIONAL_LIGHT);
-
-      mapvals.material.diffuse_int = tmpval;
+                                 DIRECTIONAL_LIGHT,
+                                 0.0);
 
       gimp_rgb_add (&color_sum, &light_color);
     }
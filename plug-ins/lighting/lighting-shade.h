@@ -3,6 +3,8 @@
 
 typedef GimpRGB (* get_ray_func) (GimpVector3 *vector);
 
+typedef struct _ShadeState ShadeState;
+
 GimpRGB get_ray_color                 (GimpVector3 *position);
 GimpRGB get_ray_color_no_bilinear     (GimpVector3 *position);
 GimpRGB get_ray_color_ref             (GimpVector3 *position);
@@ -17,4 +19,8 @@ void    interpol_row                  (gint         x1,
                                        gint         x2,
                                        gint         y);
 
+ShadeState * shade_state_new          (void);
+void    shade_state_free              (ShadeState  *state);
+void    shade_state_set_current       (ShadeState  *state);
+
 #endif  /* __LIGHTING_SHADE_H__ */
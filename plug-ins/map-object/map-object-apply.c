@@ -19,6 +19,24 @@
 #include "libgimp/stdplugins-intl.h"
 
 
+/* Rows rendered by one job of the render pool */
+#define BAND_HEIGHT 32
+
+typedef struct
+{
+  gint y1, y2;
+} RenderBand;
+
+static GThreadPool *render_pool    = NULL;
+static GMutex       render_mutex;
+static GCond        render_cond;
+static gint         render_pending = 0;
+
+/* The rendered image, written to the output drawable at the end */
+static guchar      *render_pixels  = NULL;
+static gint         render_bpp;
+
+
 /*************/
 /* Main loop */
 /*************/
@@ -205,6 +223,49 @@ render (gdouble   x,
   *col = get_ray_color (&pos);
 }
 
+static void
+put_pixel (gint      x,
+           gint      y,
+           GimpRGB  *color,
+           gpointer  data)
+{
+  guchar col[4];
+
+  gimp_rgba_get_uchar (color, &col[0], &col[1], &col[2], &col[3]);
+
+  memcpy (render_pixels + ((gsize) y * width + x) * render_bpp,
+          col, render_bpp);
+}
+
+/* Renders a band of rows without antialiasing.  This runs in a */
+/* thread of the pool, and only reads the cached drawables     */
+
+static void
+render_band (RenderBand *band,
+             gpointer    user_data)
+{
+  gint        xcount, ycount;
+  GimpRGB     color;
+  GimpVector3 p;
+
+  for (ycount = band->y1; ycount < band->y2; ycount++)
+    {
+      for (xcount = 0; xcount < width; xcount++)
+        {
+          p = int_to_pos (xcount, ycount);
+          color = (* get_ray_color) (&p);
+          put_pixel (xcount, ycount, &color, NULL);
+        }
+    }
+
+  g_mutex_lock (&render_mutex);
+
+  render_pending--;
+  g_cond_signal (&render_cond);
+
+  g_mutex_unlock (&render_mutex);
+}
+
 static void
 show_progress (gint     min,
                gint     max,
@@ -222,10 +283,6 @@ show_progress (gint     min,
 void
 compute_image (void)
 {
-  gint         xcount, ycount;
-  GimpRGB      color;
-  glong        progress_counter = 0;
-  GimpVector3  p;
   gint32       new_image_id = -1;
   gint32       new_layer_id = -1;
   gboolean     insert_layer = FALSE;
@@ -284,35 +341,74 @@ compute_image (void)
         break;
     }
 
+  /* The pixel regions may only be used from this thread, so read
+   * everything the shading needs up front, and render into memory
+   */
+  image_cache_pixels ();
+
+  render_bpp    = output_drawable->bpp;
+  render_pixels = g_malloc ((gsize) width * height * render_bpp);
+
   if (mapvals.antialiasing == FALSE)
     {
-      for (ycount = 0; ycount < height; ycount++)
+      RenderBand *bands;
+      gint        n_bands;
+      gint        i;
+
+      if (! render_pool)
+        {
+          render_pool = g_thread_pool_new ((GFunc) render_band, NULL,
+                                           g_get_num_processors (),
+                                           FALSE, NULL);
+        }
+
+      n_bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+      bands   = g_new (RenderBand, n_bands);
+
+      g_mutex_lock (&render_mutex);
+
+      for (i = 0; i < n_bands; i++)
         {
-          for (xcount = 0; xcount < width; xcount++)
-            {
-              p = int_to_pos (xcount, ycount);
-              color = (* get_ray_color) (&p);
-              poke (xcount, ycount, &color, NULL);
-
-              if ((progress_counter++ % width) == 0)
-                gimp_progress_update ((gdouble) progress_counter /
-                                      (gdouble) maxcounter);
-            }
+          bands[i].y1 = i * BAND_HEIGHT;
+          bands[i].y2 = MIN (bands[i].y1 + BAND_HEIGHT, height);
+
+          render_pending++;
+          g_thread_pool_push (render_pool, &bands[i], NULL);
+        }
+
+      while (render_pending > 0)
+        {
+          g_cond_wait (&render_cond, &render_mutex);
+
+          gimp_progress_update ((gdouble) (n_bands - render_pending) /
+                                (gdouble) n_bands);
         }
+
+      g_mutex_unlock (&render_mutex);
+
+      g_free (bands);
     }
   else
     {
-      gimp_adaptive_supersample_area (0, 0,
-                                      width - 1, height - 1,
-                                      max_depth,
-                                      mapvals.pixeltreshold,
-                                      render,
-                                      NULL,
-                                      poke,
-                                      NULL,
-                                      show_progress,
-                                      NULL);
+      gimp_adaptive_supersample_area_parallel (0, 0,
+                                               width - 1, height - 1,
+                                               max_depth,
+                                               mapvals.pixeltreshold,
+                                               g_get_num_processors (),
+                                               render,
+                                               NULL,
+                                               put_pixel,
+                                               NULL,
+                                               show_progress,
+                                               NULL);
     }
+
+  gimp_pixel_rgn_set_rect (&dest_region, render_pixels, 0, 0, width, height);
+
+  g_clear_pointer (&render_pixels, g_free);
+
+  image_free_cached_pixels ();
+
   gimp_progress_update (1.0);
 
   /* Update the region */
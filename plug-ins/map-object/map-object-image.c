@@ -43,6 +43,13 @@ gdouble oldtreshold;
 
 gint border_x, border_y, border_w, border_h;
 
+/* in-memory copies of the mapped drawables, see image_cache_pixels() */
+static guchar   *source_pixels = NULL;
+static guchar   *box_pixels[6] = { NULL, };
+static gboolean  box_has_alpha[6];
+static guchar   *cylinder_pixels[2] = { NULL, };
+static gboolean  cylinder_has_alpha[2];
+
 /******************/
 /* Implementation */
 /******************/
@@ -51,11 +58,15 @@ GimpRGB
 peek (gint x,
       gint y)
 {
-  static guchar data[4];
+  guchar  buf[4];
+  guchar *data = buf;
 
   GimpRGB color;
 
-  gimp_pixel_rgn_get_pixel (&source_region, data, x, y);
+  if (source_pixels)
+    data = source_pixels + ((gsize) y * width + x) * source_region.bpp;
+  else
+    gimp_pixel_rgn_get_pixel (&source_region, data, x, y);
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -81,11 +92,23 @@ peek_box_image (gint image,
                 gint x,
                 gint y)
 {
-  static guchar data[4];
+  guchar  buf[4];
+  guchar *data = buf;
+  gboolean has_alpha;
 
   GimpRGB color;
 
-  gimp_pixel_rgn_get_pixel (&box_regions[image], data, x, y);
+  if (box_pixels[image])
+    {
+      data = box_pixels[image] + (((gsize) y * box_drawables[image]->width + x) *
+                                  box_regions[image].bpp);
+      has_alpha = box_has_alpha[image];
+    }
+  else
+    {
+      gimp_pixel_rgn_get_pixel (&box_regions[image], data, x, y);
+      has_alpha = gimp_drawable_has_alpha (box_drawables[image]->drawable_id);
+    }
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -93,7 +116,7 @@ peek_box_image (gint image,
 
   if (box_drawables[image]->bpp == 4)
     {
-      if (gimp_drawable_has_alpha (box_drawables[image]->drawable_id))
+      if (has_alpha)
         color.a = (gdouble) (data[3]) / 255.0;
       else
         color.a = 1.0;
@@ -111,11 +134,23 @@ peek_cylinder_image (gint image,
                      gint x,
                      gint y)
 {
-  static guchar data[4];
+  guchar  buf[4];
+  guchar *data = buf;
+  gboolean has_alpha;
 
   GimpRGB color;
 
-  gimp_pixel_rgn_get_pixel (&cylinder_regions[image],data, x, y);
+  if (cylinder_pixels[image])
+    {
+      data = cylinder_pixels[image] + (((gsize) y * cylinder_drawables[image]->width + x) *
+                                       cylinder_regions[image].bpp);
+      has_alpha = cylinder_has_alpha[image];
+    }
+  else
+    {
+      gimp_pixel_rgn_get_pixel (&cylinder_regions[image], data, x, y);
+      has_alpha = gimp_drawable_has_alpha (cylinder_drawables[image]->drawable_id);
+    }
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -123,7 +158,7 @@ peek_cylinder_image (gint image,
 
   if (cylinder_drawables[image]->bpp == 4)
     {
-      if (gimp_drawable_has_alpha (cylinder_drawables[image]->drawable_id))
+      if (has_alpha)
         color.a = (gdouble) (data[3]) / 255.0;
       else
         color.a = 1.0;
@@ -149,6 +184,69 @@ poke (gint      x,
   gimp_pixel_rgn_set_pixel (&dest_region, col, x, y);
 }
 
+/* Copies the drawables the current map type samples into memory,
+ * after init_compute() set up their pixel regions.  Reading from
+ * there is much faster than going through the pixel regions, and
+ * safe from several threads.
+ */
+
+void
+image_cache_pixels (void)
+{
+  gint i;
+
+  image_free_cached_pixels ();
+
+  source_pixels = g_malloc ((gsize) width * height * source_region.bpp);
+  gimp_pixel_rgn_get_rect (&source_region, source_pixels,
+                           0, 0, width, height);
+
+  if (mapvals.maptype == MAP_BOX)
+    {
+      for (i = 0; i < 6; i++)
+        {
+          GimpPixelRgn *region = &box_regions[i];
+
+          box_pixels[i] = g_malloc ((gsize) region->w * region->h *
+                                    region->bpp);
+          gimp_pixel_rgn_get_rect (region, box_pixels[i],
+                                   0, 0, region->w, region->h);
+
+          box_has_alpha[i] =
+            gimp_drawable_has_alpha (box_drawables[i]->drawable_id);
+        }
+    }
+  else if (mapvals.maptype == MAP_CYLINDER)
+    {
+      for (i = 0; i < 2; i++)
+        {
+          GimpPixelRgn *region = &cylinder_regions[i];
+
+          cylinder_pixels[i] = g_malloc ((gsize) region->w * region->h *
+                                         region->bpp);
+          gimp_pixel_rgn_get_rect (region, cylinder_pixels[i],
+                                   0, 0, region->w, region->h);
+
+          cylinder_has_alpha[i] =
+            gimp_drawable_has_alpha (cylinder_drawables[i]->drawable_id);
+        }
+    }
+}
+
+void
+image_free_cached_pixels (void)
+{
+  gint i;
+
+  g_clear_pointer (&source_pixels, g_free);
+
+  for (i = 0; i < 6; i++)
+    g_clear_pointer (&box_pixels[i], g_free);
+
+  for (i = 0; i < 2; i++)
+    g_clear_pointer (&cylinder_pixels[i], g_free);
+}
+
 gint
 checkbounds (gint x,
              gint y)
@@ -43,6 +43,8 @@ extern void        poke                     (gint          x,
                                              gint          y,
                                              GimpRGB      *color,
                                              gpointer      data);
+extern void        image_cache_pixels       (void);
+extern void        image_free_cached_pixels (void);
 extern GimpVector3 int_to_pos               (gint          x,
                                              gint          y);
 extern void        pos_to_int               (gdouble       x,
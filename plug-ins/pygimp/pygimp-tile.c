@@ -254,6 +254,57 @@ static PyMappingMethods tile_as_mapping = {
     (objobjargproc)tile_ass_sub, /*ass_sub*/
 };
 
+/* Tiles export their pixel data directly, as a (height, width, bpp)
+ * array of bytes, taking a writable view marks the tile dirty.
+ */
+static int
+tile_get_buffer(PyGimpTile *self, Py_buffer *view, int flags)
+{
+    GimpTile *tile = self->tile;
+    Py_ssize_t shape[3] = { tile->eheight, tile->ewidth, tile->bpp };
+
+    if (PyBuffer_FillInfo(view, (PyObject *)self, tile->data,
+                          (Py_ssize_t) tile->ewidth * tile->eheight * tile->bpp,
+                          FALSE, flags) < 0)
+        return -1;
+
+    if (flags & PyBUF_WRITABLE)
+        tile->dirty = TRUE;
+
+    if ((flags & PyBUF_ND) == PyBUF_ND) {
+        /* shape and strides are kept with the view */
+        Py_ssize_t *dims = g_new(Py_ssize_t, 6);
+
+        memcpy(dims, shape, sizeof(shape));
+        dims[3] = (Py_ssize_t) tile->ewidth * tile->bpp;
+        dims[4] = tile->bpp;
+        dims[5] = 1;
+
+        view->ndim = 3;
+        view->shape = dims;
+        view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ?
+                        dims + 3 : NULL;
+        view->internal = dims;
+    }
+
+    return 0;
+}
+
+static void
+tile_release_buffer(PyGimpTile *self, Py_buffer *view)
+{
+    g_free(view->internal);
+}
+
+static PyBufferProcs tile_as_buffer = {
+    (readbufferproc)0,                  /* bf_getreadbuffer */
+    (writebufferproc)0,                 /* bf_getwritebuffer */
+    (segcountproc)0,                    /* bf_getsegcount */
+    (charbufferproc)0,                  /* bf_getcharbuffer */
+    (getbufferproc)tile_get_buffer,     /* bf_getbuffer */
+    (releasebufferproc)tile_release_buffer, /* bf_releasebuffer */
+};
+
 PyTypeObject PyGimpTile_Type = {
     PyObject_HEAD_INIT(NULL)
     0,                                  /* ob_size */
@@ -275,8 +326,8 @@ PyTypeObject PyGimpTile_Type = {
     (reprfunc)0,                        /* tp_str */
     (getattrofunc)0,                    /* tp_getattro */
     (setattrofunc)0,                    /* tp_setattro */
-    0,					/* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT,	                /* tp_flags */
+    &tile_as_buffer,			/* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
     NULL, /* Documentation string */
     (traverseproc)0,			/* tp_traverse */
     (inquiry)0,				/* tp_clear */
@@ -309,6 +360,12 @@ pr_resize(PyGimpPixelRgn *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "iiii:resize", &x, &y, &w, &h))
 	return NULL;
 
+    if (self->n_exports > 0) {
+        PyErr_SetString(PyExc_BufferError,
+                        "can't resize a pixel region while its buffer is in use");
+        return NULL;
+    }
+
     gimp_pixel_rgn_resize(&(self->pr), x, y, w, h);
 
     Py_INCREF(Py_None);
@@ -317,8 +374,30 @@ pr_resize(PyGimpPixelRgn *self, PyObject *args)
 
 
 
+static PyObject *
+pr_write_buffer(PyGimpPixelRgn *self)
+{
+    GimpPixelRgn *pr = &(self->pr);
+
+    if (!pr->dirty) {
+        PyErr_SetString(pygimp_error, "pixel region is not writable");
+        return NULL;
+    }
+
+    if (self->n_exports == 0) {
+        PyErr_SetString(pygimp_error, "pixel region buffer is not in use");
+        return NULL;
+    }
+
+    gimp_pixel_rgn_set_rect(pr, self->buffer, pr->x, pr->y, pr->w, pr->h);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyMethodDef pr_methods[] = {
     {"resize",	(PyCFunction)pr_resize,	METH_VARARGS},
+    {"write_buffer",	(PyCFunction)pr_write_buffer,	METH_NOARGS},
 
     {NULL,		NULL}		/* sentinel */
 };
@@ -357,6 +436,9 @@ pygimp_pixel_rgn_new(PyGimpDrawable *drawable, int x, int y,
     self->drawable = drawable;
     Py_INCREF(drawable);
 
+    self->buffer = NULL;
+    self->n_exports = 0;
+
     return (PyObject *)self;
 }
 
@@ -364,6 +446,7 @@ pygimp_pixel_rgn_new(PyGimpDrawable *drawable, int x, int y,
 static void
 pr_dealloc(PyGimpPixelRgn *self)
 {
+    g_free(self->buffer);
     Py_DECREF(self->drawable);
     PyObject_DEL(self);
 }
@@ -494,22 +577,12 @@ pr_subscript(PyGimpPixelRgn *self, PyObject *key)
 }
 
 static int
-pr_ass_sub(PyGimpPixelRgn *self, PyObject *v, PyObject *w)
+pr_ass_sub_data(PyGimpPixelRgn *self, PyObject *v,
+                const guchar *buf, Py_ssize_t len)
 {
     GimpPixelRgn *pr = &(self->pr);
     PyObject *x, *y;
-    const guchar *buf;
-    Py_ssize_t len, x1, x2, xs, y1, y2, ys;
-
-    if (w == NULL) {
-        PyErr_SetString(PyExc_TypeError, "can't delete subscripts");
-        return -1;
-    }
-
-    if (!PyString_Check(w)) {
-        PyErr_SetString(PyExc_TypeError, "must assign string to subscript");
-        return -1;
-    }
+    Py_ssize_t x1, x2, xs, y1, y2, ys;
 
     if (!PyTuple_Check(v) || PyTuple_Size(v) != 2) {
         PyErr_SetString(PyExc_TypeError, "subscript must be a 2-tuple");
@@ -519,9 +592,8 @@ pr_ass_sub(PyGimpPixelRgn *self, PyObject *v, PyObject *w)
     if (!PyArg_ParseTuple(v, "OO", &x, &y))
         return -1;
 
-    buf = (const guchar *)PyString_AsString(w);
-    len = PyString_Size(w);
-    if (!buf || len > INT_MAX) {
+    if (len > INT_MAX) {
+        PyErr_SetString(PyExc_TypeError, "string is wrong length");
         return -1;
     }
 
@@ -630,12 +702,113 @@ pr_ass_sub(PyGimpPixelRgn *self, PyObject *v, PyObject *w)
     return 0;
 }
 
+static int
+pr_ass_sub(PyGimpPixelRgn *self, PyObject *v, PyObject *w)
+{
+    Py_buffer view;
+    int ret;
+
+    if (w == NULL) {
+        PyErr_SetString(PyExc_TypeError, "can't delete subscripts");
+        return -1;
+    }
+
+    /* strings, and anything else exporting contiguous memory (like
+     * numpy arrays), are assigned without an intermediate copy
+     */
+    if (!PyObject_CheckBuffer(w) ||
+        PyObject_GetBuffer(w, &view, PyBUF_SIMPLE) < 0) {
+        PyErr_Clear();
+        PyErr_SetString(PyExc_TypeError,
+                        "must assign string or contiguous buffer to subscript");
+        return -1;
+    }
+
+    ret = pr_ass_sub_data(self, v, view.buf, view.len);
+
+    PyBuffer_Release(&view);
+
+    return ret;
+}
+
 static PyMappingMethods pr_as_mapping = {
     pr_length,		/*mp_length*/
     (binaryfunc)pr_subscript,		/*mp_subscript*/
     (objobjargproc)pr_ass_sub,	/*mp_ass_subscript*/
 };
 
+/* Code to access pr objects as buffers
+ *
+ * The whole region is copied out of the tiles when the first view is
+ * taken, and is exported as a (height, width, bpp) array of bytes, so
+ * numpy.asarray(pr) works.  Views share the copy until all of them are
+ * released, write_buffer() copies it back if the region is dirty.
+ */
+
+static int
+pr_get_buffer(PyGimpPixelRgn *self, Py_buffer *view, int flags)
+{
+    GimpPixelRgn *pr = &(self->pr);
+
+    if ((flags & PyBUF_WRITABLE) && !pr->dirty) {
+        PyErr_SetString(PyExc_BufferError, "pixel region is not writable");
+        view->obj = NULL;
+        return -1;
+    }
+
+    if (self->n_exports == 0) {
+        g_free(self->buffer);
+        self->buffer = g_malloc((gsize) pr->w * pr->h * pr->bpp);
+
+        gimp_pixel_rgn_get_rect(pr, self->buffer, pr->x, pr->y, pr->w, pr->h);
+
+        self->shape[0] = pr->h;
+        self->shape[1] = pr->w;
+        self->shape[2] = pr->bpp;
+
+        self->strides[0] = (Py_ssize_t) pr->w * pr->bpp;
+        self->strides[1] = pr->bpp;
+        self->strides[2] = 1;
+    }
+
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+
+    view->buf = self->buffer;
+    view->len = (Py_ssize_t) pr->w * pr->h * pr->bpp;
+    view->readonly = !pr->dirty;
+    view->itemsize = 1;
+    view->format = (flags & PyBUF_FORMAT) ? "B" : NULL;
+    view->ndim = 3;
+    view->shape = ((flags & PyBUF_ND) == PyBUF_ND) ? self->shape : NULL;
+    view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ?
+                    self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    if (!view->shape)
+        view->ndim = 1;
+
+    self->n_exports++;
+
+    return 0;
+}
+
+static void
+pr_release_buffer(PyGimpPixelRgn *self, Py_buffer *view)
+{
+    self->n_exports--;
+}
+
+static PyBufferProcs pr_as_buffer = {
+    (readbufferproc)0,                  /* bf_getreadbuffer */
+    (writebufferproc)0,                 /* bf_getwritebuffer */
+    (segcountproc)0,                    /* bf_getsegcount */
+    (charbufferproc)0,                  /* bf_getcharbuffer */
+    (getbufferproc)pr_get_buffer,       /* bf_getbuffer */
+    (releasebufferproc)pr_release_buffer, /* bf_releasebuffer */
+};
+
 /* -------------------------------------------------------- */
 
 static PyObject *
@@ -719,8 +892,8 @@ PyTypeObject PyGimpPixelRgn_Type = {
     (reprfunc)0,                        /* tp_str */
     (getattrofunc)0,                    /* tp_getattro */
     (setattrofunc)0,                    /* tp_setattro */
-    0,					/* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT,	                /* tp_flags */
+    &pr_as_buffer,			/* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
     NULL, /* Documentation string */
     (traverseproc)0,			/* tp_traverse */
     (inquiry)0,				/* tp_clear */
@@ -98,6 +98,12 @@ typedef struct {
     PyObject_HEAD
     GimpPixelRgn pr;
     PyGimpDrawable *drawable; /* keep the drawable around */
+
+    /* the copy of the region handed out through the buffer protocol */
+    guchar *buffer;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+    int n_exports;
 } PyGimpPixelRgn;
 
 extern PyTypeObject PyGimpPixelRgn_Type;
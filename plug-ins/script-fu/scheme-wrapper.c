@@ -49,6 +49,15 @@
 
 #undef cons
 
+typedef struct
+{
+  gint          nparams;
+  gint          nreturn_vals;
+  GimpParamDef *params;
+  GimpParamDef *return_vals;
+} ProcInfo;
+
+
 static void     ts_init_constants                (scheme    *sc);
 static void     ts_init_enum                     (scheme    *sc,
                                                   GType      enum_type);
@@ -59,6 +68,13 @@ static pointer  script_fu_marshal_procedure_call (scheme    *sc,
                                                   pointer    a);
 static void     script_fu_marshal_destroy_args   (GimpParam *params,
                                                   gint       n_params);
+static const ProcInfo *
+                script_fu_lookup_proc_info       (const gchar *proc_name);
+static gdouble *
+                script_fu_vector_to_numbers      (scheme    *sc,
+                                                  pointer    vector,
+                                                  gint       n_elements,
+                                                  gint      *bad_element);
 
 static pointer  script_fu_register_call          (scheme    *sc,
                                                   pointer    a);
@@ -128,7 +144,8 @@ static const NamedConstant script_constants[] =
 };
 
 
-static scheme sc;
+static scheme      sc;
+static GHashTable *proc_info_cache = NULL;
 
 
 void
@@ -244,6 +261,16 @@ ts_get_success_msg (void)
   return "Success";
 }
 
+/*  forgets the cached PDB procedure signatures, to be called when
+ *  procedures might have been installed again with different arguments
+ */
+void
+ts_flush_proc_cache (void)
+{
+  if (proc_info_cache)
+    g_hash_table_remove_all (proc_info_cache);
+}
+
 void
 ts_stdout_output_func (TsOutputType  type,
                        const char   *string,
@@ -536,6 +563,100 @@ convert_string (gchar *str)
     }
 }
 
+static void
+proc_info_free (ProcInfo *info)
+{
+  gimp_destroy_paramdefs (info->params,      info->nparams);
+  gimp_destroy_paramdefs (info->return_vals, info->nreturn_vals);
+
+  g_slice_free (ProcInfo, info);
+}
+
+/*  looks up a procedure's signature, asking the PDB only the first time
+ *  a procedure is called
+ */
+static const ProcInfo *
+script_fu_lookup_proc_info (const gchar *proc_name)
+{
+  ProcInfo        *info;
+  gchar           *proc_blurb;
+  gchar           *proc_help;
+  gchar           *proc_author;
+  gchar           *proc_copyright;
+  gchar           *proc_date;
+  GimpPDBProcType  proc_type;
+  gint             nparams;
+  gint             nreturn_vals;
+  GimpParamDef    *params;
+  GimpParamDef    *return_vals;
+
+  if (! proc_info_cache)
+    proc_info_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free,
+                                             (GDestroyNotify) proc_info_free);
+
+  info = g_hash_table_lookup (proc_info_cache, proc_name);
+
+  if (info)
+    return info;
+
+  if (! gimp_procedural_db_proc_info (proc_name,
+                                      &proc_blurb,
+                                      &proc_help,
+                                      &proc_author,
+                                      &proc_copyright,
+                                      &proc_date,
+                                      &proc_type,
+                                      &nparams, &nreturn_vals,
+                                      &params, &return_vals))
+    {
+      return NULL;
+    }
+
+  g_free (proc_blurb);
+  g_free (proc_help);
+  g_free (proc_author);
+  g_free (proc_copyright);
+  g_free (proc_date);
+
+  info = g_slice_new (ProcInfo);
+
+  info->nparams      = nparams;
+  info->nreturn_vals = nreturn_vals;
+  info->params       = params;
+  info->return_vals  = return_vals;
+
+  g_hash_table_insert (proc_info_cache, g_strdup (proc_name), info);
+
+  return info;
+}
+
+/*  converts the first @n_elements of a vector of numbers in one go,
+ *  returns NULL and the index of the offending element in @bad_element
+ *  if one is not a number
+ */
+static gdouble *
+script_fu_vector_to_numbers (scheme  *sc,
+                             pointer  vector,
+                             gint     n_elements,
+                             gint    *bad_element)
+{
+  gdouble *numbers = g_new (gdouble, MAX (n_elements, 1));
+  gint     n;
+
+  n = sc->vptr->vector_reals (vector, numbers, n_elements);
+
+  if (n < n_elements)
+    {
+      g_free (numbers);
+      *bad_element = n;
+
+      return NULL;
+    }
+
+  return numbers;
+}
+
 /* This is called by the Scheme interpreter to allow calls to GIMP functions */
 static pointer
 script_fu_marshal_procedure_call (scheme  *sc,
@@ -545,14 +666,8 @@ script_fu_marshal_procedure_call (scheme  *sc,
   GimpParam       *values = NULL;
   gint             nvalues;
   gchar           *proc_name;
-  gchar           *proc_blurb;
-  gchar           *proc_help;
-  gchar           *proc_author;
-  gchar           *proc_copyright;
-  gchar           *proc_date;
-  GimpPDBProcType  proc_type;
+  const ProcInfo  *proc_info;
   gint             nparams;
-  gint             nreturn_vals;
   GimpParamDef    *params;
   GimpParamDef    *return_vals;
   gchar            error_str[1024];
@@ -600,15 +715,9 @@ script_fu_marshal_procedure_call (scheme  *sc,
   script_fu_interface_report_cc (proc_name);
 
   /*  Attempt to fetch the procedure from the database  */
-  if (! gimp_procedural_db_proc_info (proc_name,
-                                      &proc_blurb,
-                                      &proc_help,
-                                      &proc_author,
-                                      &proc_copyright,
-                                      &proc_date,
-                                      &proc_type,
-                                      &nparams, &nreturn_vals,
-                                      &params, &return_vals))
+  proc_info = script_fu_lookup_proc_info (proc_name);
+
+  if (! proc_info)
     {
 #ifdef DEBUG_MARSHALL
       g_printerr ("  Invalid procedure name\n");
@@ -618,17 +727,9 @@ script_fu_marshal_procedure_call (scheme  *sc,
       return foreign_error (sc, error_str, 0);
     }
 
-  /* Free the name and the description which are of no use here.  */
-  for (i = 0; i < nparams; i++)
-    {
-      g_free (params[i].name);
-      g_free (params[i].description);
-    }
-  for (i = 0; i < nreturn_vals; i++)
-    {
-      g_free (return_vals[i].name);
-      g_free (return_vals[i].description);
-    }
+  nparams     = proc_info->nparams;
+  params      = proc_info->params;
+  return_vals = proc_info->return_vals;
 
   /*  Check the supplied number of arguments  */
   if ((sc->vptr->list_length (sc, a) - 1) != nparams)
@@ -651,9 +752,10 @@ script_fu_marshal_procedure_call (scheme  *sc,
 
   for (i = 0; i < nparams; i++)
     {
-      gint32  n_elements;
-      pointer vector;
-      gint    j;
+      gint32   n_elements;
+      pointer  vector;
+      gdouble *numbers;
+      gint     j;
 
       a = sc->vptr->pair_cdr (a);
 
@@ -763,24 +865,22 @@ script_fu_marshal_procedure_call (scheme  *sc,
                   return foreign_error (sc, error_str, 0);
                 }
 
+              numbers = script_fu_vector_to_numbers (sc, vector, n_elements,
+                                                     &j);
+              if (! numbers)
+                {
+                  g_snprintf (error_str, sizeof (error_str),
+                              "Item %d in vector is not a number (argument %d for function %s)",
+                              j+1, i+1, proc_name);
+                  return foreign_error (sc, error_str, vector);
+                }
+
               args[i].data.d_int32array = g_new (gint32, n_elements);
 
               for (j = 0; j < n_elements; j++)
-                {
-                  pointer v_element = sc->vptr->vector_elem (vector, j);
+                args[i].data.d_int32array[j] = (gint32) (glong) numbers[j];
 
-                  /* FIXME: Check values in vector stay within range for each type. */
-                  if (!sc->vptr->is_number (v_element))
-                    {
-                      g_snprintf (error_str, sizeof (error_str),
-                                  "Item %d in vector is not a number (argument %d for function %s)",
-                                  j+1, i+1, proc_name);
-                      return foreign_error (sc, error_str, vector);
-                    }
-
-                  args[i].data.d_int32array[j] =
-                      (gint32) sc->vptr->ivalue (v_element);
-                }
+              g_free (numbers);
 
 #if DEBUG_MARSHALL
               {
@@ -815,23 +915,22 @@ script_fu_marshal_procedure_call (scheme  *sc,
                   return foreign_error (sc, error_str, 0);
                 }
 
+              numbers = script_fu_vector_to_numbers (sc, vector, n_elements,
+                                                     &j);
+              if (! numbers)
+                {
+                  g_snprintf (error_str, sizeof (error_str),
+                              "Item %d in vector is not a number (argument %d for function %s)",
+                              j+1, i+1, proc_name);
+                  return foreign_error (sc, error_str, vector);
+                }
+
               args[i].data.d_int16array = g_new (gint16, n_elements);
 
               for (j = 0; j < n_elements; j++)
-                {
-                  pointer v_element = sc->vptr->vector_elem (vector, j);
+                args[i].data.d_int16array[j] = (gint16) (glong) numbers[j];
 
-                  if (!sc->vptr->is_number (v_element))
-                    {
-                      g_snprintf (error_str, sizeof (error_str),
-                                  "Item %d in vector is not a number (argument %d for function %s)",
-                                  j+1, i+1, proc_name);
-                      return foreign_error (sc, error_str, vector);
-                    }
-
-                  args[i].data.d_int16array[j] =
-                      (gint16) sc->vptr->ivalue (v_element);
-                }
+              g_free (numbers);
 
 #if DEBUG_MARSHALL
               {
@@ -868,23 +967,22 @@ script_fu_marshal_procedure_call (scheme  *sc,
                   return foreign_error (sc, error_str, 0);
                 }
 
+              numbers = script_fu_vector_to_numbers (sc, vector, n_elements,
+                                                     &j);
+              if (! numbers)
+                {
+                  g_snprintf (error_str, sizeof (error_str),
+                              "Item %d in vector is not a number (argument %d for function %s)",
+                              j+1, i+1, proc_name);
+                  return foreign_error (sc, error_str, vector);
+                }
+
               args[i].data.d_int8array = g_new (guint8, n_elements);
 
               for (j = 0; j < n_elements; j++)
-                {
-                  pointer v_element = sc->vptr->vector_elem (vector, j);
+                args[i].data.d_int8array[j] = (guint8) (glong) numbers[j];
 
-                  if (!sc->vptr->is_number (v_element))
-                    {
-                      g_snprintf (error_str, sizeof (error_str),
-                                  "Item %d in vector is not a number (argument %d for function %s)",
-                                  j+1, i+1, proc_name);
-                      return foreign_error (sc, error_str, vector);
-                    }
-
-                  args[i].data.d_int8array[j] =
-                      (guint8) sc->vptr->ivalue (v_element);
-                }
+              g_free (numbers);
 
 #if DEBUG_MARSHALL
               {
@@ -921,23 +1019,21 @@ script_fu_marshal_procedure_call (scheme  *sc,
                   return foreign_error (sc, error_str, 0);
                 }
 
-              args[i].data.d_floatarray = g_new (gdouble, n_elements);
-
-              for (j = 0; j < n_elements; j++)
+              numbers = script_fu_vector_to_numbers (sc, vector, n_elements,
+                                                     &j);
+              if (! numbers)
                 {
-                  pointer v_element = sc->vptr->vector_elem (vector, j);
+                  g_snprintf (error_str, sizeof (error_str),
+                              "Item %d in vector is not a number (argument %d for function %s)",
+                              j+1, i+1, proc_name);
+                  return foreign_error (sc, error_str, vector);
+                }
 
-                  if (!sc->vptr->is_number (v_element))
-                    {
-                      g_snprintf (error_str, sizeof (error_str),
-                                  "Item %d in vector is not a number (argument %d for function %s)",
-                                  j+1, i+1, proc_name);
-                      return foreign_error (sc, error_str, vector);
-                    }
+              /*  FLOATARRAY values always went through single precision  */
+              for (j = 0; j < n_elements; j++)
+                numbers[j] = (gfloat) numbers[j];
 
-                  args[i].data.d_floatarray[j] =
-                      (gfloat) sc->vptr->rvalue (v_element);
-                }
+              args[i].data.d_floatarray = numbers;
 
 #if DEBUG_MARSHALL
               {
@@ -1565,15 +1661,6 @@ script_fu_marshal_procedure_call (scheme  *sc,
   /*  free up arguments and values  */
   script_fu_marshal_destroy_args (args, nparams);
 
-  /*  free the query information  */
-  g_free (proc_blurb);
-  g_free (proc_help);
-  g_free (proc_author);
-  g_free (proc_copyright);
-  g_free (proc_date);
-  g_free (params);
-  g_free (return_vals);
-
   /*  if we're in server mode, listen for additional commands for 10 ms  */
   if (script_fu_server_get_mode ())
     script_fu_server_listen (10);
@@ -80,7 +80,12 @@ typedef short sa_family_t;	/* Not defined by winsock */
 
 #define COMMAND_HEADER  3
 #define RESPONSE_HEADER 4
+#define REQUEST_ID_LEN  4
 #define MAGIC           'G'
+#define MAGIC_ID        'I'
+
+/*  default for the "script-fu-server-max-pending" gimprc token  */
+#define DEFAULT_MAX_PENDING 16
 
 #ifndef HAVE_DIFFTIME
 #define difftime(a,b) (((gdouble)(a)) - ((gdouble)(b)))
@@ -112,6 +117,17 @@ typedef short sa_family_t;	/* Not defined by winsock */
  *           MAGIC      ERROR?     RSP_LEN_H  RSP_LEN_L
  */
 
+/*  A command sent with MAGIC_ID instead of MAGIC carries a request ID
+ *  chosen by the client, which is sent back in the response, so that
+ *  clients pipelining several commands on one connection can match
+ *  the responses...
+ *    bytes: 1          2          3          4 - 7
+ *           MAGIC_ID   CMD_LEN_H  CMD_LEN_L  REQUEST_ID (big endian)
+ *
+ *    bytes: 1          2          3          4          5 - 8
+ *           MAGIC_ID   ERROR?     RSP_LEN_H  RSP_LEN_L  REQUEST_ID
+ */
+
 #define MAGIC_BYTE      0
 
 #define CMD_LEN_H_BYTE  1
@@ -127,11 +143,21 @@ typedef short sa_family_t;	/* Not defined by winsock */
 
 typedef struct
 {
-  gchar *command;
-  gint   filedes;
-  gint   request_no;
+  gchar    *command;
+  gint      filedes;
+  gint      request_no;
+  gboolean  has_id;
+  guint32   id;
+  gint      round;
 } SFCommand;
 
+typedef struct
+{
+  gchar *address;
+  gint   n_pending;   /*  queued commands of this client  */
+  gint   next_round;  /*  round of its next command       */
+} SFClient;
+
 typedef struct
 {
   GtkWidget *ip_entry;
@@ -168,6 +194,8 @@ static gint      make_socket        (const struct addrinfo
 static void      server_log         (const gchar *format,
                                      ...) G_GNUC_PRINTF (1, 2);
 static void      server_quit        (void);
+static void      server_listen      (struct timeval
+                                                 *tvp);
 
 static gboolean  server_interface   (void);
 static void      response_callback  (GtkWidget   *widget,
@@ -185,6 +213,8 @@ static const gint   server_socks_len = sizeof (server_socks) /
 static GList       *command_queue   = NULL;
 static gint         queue_length    = 0;
 static gint         request_no      = 0;
+static gint         current_round   = 0;
+static gint         max_pending     = DEFAULT_MAX_PENDING;
 static FILE        *server_log_file = NULL;
 static GHashTable  *clients         = NULL;
 static gboolean     script_fu_done  = FALSE;
@@ -274,12 +304,35 @@ script_fu_server_run (const gchar      *name,
   values[0].data.d_status = status;
 }
 
+static gint
+command_compare (const SFCommand *a,
+                 const SFCommand *b)
+{
+  if (a->round != b->round)
+    return a->round - b->round;
+
+  return a->request_no - b->request_no;
+}
+
+static void
+client_free (SFClient *client)
+{
+  g_free (client->address);
+  g_slice_free (SFClient, client);
+}
+
 static void
 script_fu_server_add_fd (gpointer key,
                          gpointer value,
                          gpointer data)
 {
-  FD_SET (GPOINTER_TO_INT (key), (SELECT_MASK *) data);
+  SFClient *client = value;
+
+  /*  don't read from clients with a full backlog, their commands
+   *  wait in the socket until some of the queued ones are done
+   */
+  if (client->n_pending < max_pending)
+    FD_SET (GPOINTER_TO_INT (key), (SELECT_MASK *) data);
 }
 
 static gboolean
@@ -287,7 +340,8 @@ script_fu_server_read_fd (gpointer key,
                           gpointer value,
                           gpointer data)
 {
-  gint fd = GPOINTER_TO_INT (key);
+  SFClient *client = value;
+  gint      fd     = GPOINTER_TO_INT (key);
 
   if (FD_ISSET (fd, (SELECT_MASK *) data))
     {
@@ -295,7 +349,7 @@ script_fu_server_read_fd (gpointer key,
         {
           GList *list;
 
-          server_log ("Server: disconnect from host %s.\n", (gchar *) value);
+          server_log ("Server: disconnect from host %s.\n", client->address);
 
           CLOSESOCKET (fd);
 
@@ -303,7 +357,7 @@ script_fu_server_read_fd (gpointer key,
               from the disconnected client.  */
           for (list = command_queue; list; list = list->next)
             {
-              SFCommand *cmd = (SFCommand *) command_queue->data;
+              SFCommand *cmd = (SFCommand *) list->data;
 
               if (cmd->filedes == fd)
                 cmd->filedes = -1;
@@ -321,17 +375,27 @@ script_fu_server_listen (gint timeout)
 {
   struct timeval  tv;
   struct timeval *tvp = NULL;
-  SELECT_MASK     fds;
-  gint            sockno;
 
   /*  Set time struct  */
   if (timeout)
     {
       tv.tv_sec  = timeout / 1000;
-      tv.tv_usec = timeout % 1000;
+      tv.tv_usec = (timeout % 1000) * 1000;
       tvp = &tv;
     }
 
+  server_listen (tvp);
+}
+
+/*  accepts connections and queues the commands which arrived, blocks
+ *  until there is something to do if @tvp is NULL
+ */
+static void
+server_listen (struct timeval *tvp)
+{
+  SELECT_MASK     fds;
+  gint            sockno;
+
   FD_ZERO (&fds);
   for (sockno = 0; sockno < server_socks_used; sockno++)
     {
@@ -381,8 +445,14 @@ script_fu_server_listen (gint timeout)
       (void) getnameinfo (&(client.sa), size, clientname, sizeof (clientname),
                           NULL, 0, NI_NUMERICHOST);
 
-      g_hash_table_insert (clients, GINT_TO_POINTER (new),
-                           g_strdup (clientname));
+      {
+        SFClient *sf_client = g_slice_new0 (SFClient);
+
+        sf_client->address    = g_strdup (clientname);
+        sf_client->next_round = current_round;
+
+        g_hash_table_insert (clients, GINT_TO_POINTER (new), sf_client);
+      }
 
       /* Determine port number */
       switch (client.family)
@@ -467,6 +537,7 @@ server_start (const gchar *listen_ip,
   gint             e;
   gint             sockno;
   gchar           *port_s;
+  gchar           *value;
   const gchar     *progress;
 
   memset (&hints, 0, sizeof (hints));
@@ -509,9 +580,18 @@ server_start (const gchar *listen_ip,
   if (! server_log_file)
     server_log_file = stdout;
 
-  /*  Set up the clientname hash table  */
+  /*  How many commands a client may have queued  */
+  value = gimp_gimprc_query ("script-fu-server-max-pending");
+
+  if (value)
+    {
+      max_pending = MAX (1, atoi (value));
+      g_free (value);
+    }
+
+  /*  Set up the client hash table  */
   clients = g_hash_table_new_full (g_direct_hash, NULL,
-                                   NULL, (GDestroyNotify) g_free);
+                                   NULL, (GDestroyNotify) client_free);
 
   progress = server_progress_install ();
 
@@ -524,7 +604,11 @@ server_start (const gchar *listen_ip,
 
       while (command_queue)
         {
-          SFCommand *cmd = (SFCommand *) command_queue->data;
+          SFCommand      *cmd = (SFCommand *) command_queue->data;
+          SFClient       *client;
+          struct timeval  tv  = { 0, 0 };
+
+          current_round = cmd->round;
 
           /*  Process the command  */
           execute_command (cmd);
@@ -533,9 +617,19 @@ server_start (const gchar *listen_ip,
           command_queue = g_list_remove (command_queue, cmd);
           queue_length--;
 
+          client = g_hash_table_lookup (clients,
+                                        GINT_TO_POINTER (cmd->filedes));
+          if (client)
+            client->n_pending--;
+
           /*  Free the request  */
           g_free (cmd->command);
           g_free (cmd);
+
+          /*  Queue what arrived meanwhile, without blocking, so that
+           *  it is scheduled together with the remaining commands
+           */
+          server_listen (&tv);
       }
     }
 
@@ -547,7 +641,8 @@ server_start (const gchar *listen_ip,
 static gboolean
 execute_command (SFCommand *cmd)
 {
-  guchar      buffer[RESPONSE_HEADER];
+  guchar      buffer[RESPONSE_HEADER + REQUEST_ID_LEN];
+  gint        header_len = RESPONSE_HEADER;
   GString    *response;
   time_t      clocknow;
   gboolean    error;
@@ -582,13 +677,21 @@ execute_command (SFCommand *cmd)
     }
   g_timer_destroy (timer);
 
-  buffer[MAGIC_BYTE]     = MAGIC;
+  buffer[MAGIC_BYTE]     = cmd->has_id ? MAGIC_ID : MAGIC;
   buffer[ERROR_BYTE]     = error ? TRUE : FALSE;
   buffer[RSP_LEN_H_BYTE] = (guchar) (response->len >> 8);
   buffer[RSP_LEN_L_BYTE] = (guchar) (response->len & 0xFF);
 
+  if (cmd->has_id)
+    {
+      guint32 id = g_htonl (cmd->id);
+
+      memcpy (buffer + RESPONSE_HEADER, &id, REQUEST_ID_LEN);
+      header_len += REQUEST_ID_LEN;
+    }
+
   /*  Write the response to the client  */
-  for (i = 0; i < RESPONSE_HEADER; i++)
+  for (i = 0; i < header_len; i++)
     if (cmd->filedes > 0 && send (cmd->filedes, buffer + i, 1, 0) < 0)
       {
         /*  Write error  */
@@ -609,39 +712,84 @@ execute_command (SFCommand *cmd)
   return FALSE;
 }
 
+/*  reads @len bytes, returns the number of bytes read, or -1 on EOF
+ *  or errors
+ */
 static gint
-read_from_client (gint filedes)
+recv_from_client (gint    filedes,
+                  gchar  *buffer,
+                  gint    len)
+{
+  gint nbytes;
+  gint i;
+
+  for (i = 0; i < len;)
+    {
+      nbytes = recv (filedes, buffer + i, len - i, 0);
+
+      if (nbytes <= 0)
+        {
+#ifndef G_OS_WIN32
+          if (nbytes < 0 && errno == EINTR)
+            continue;
+#endif
+          return (i > 0) ? i : -1;
+        }
+
+      i += nbytes;
+    }
+
+  return i;
+}
+
+static gboolean
+client_has_input (gint filedes)
+{
+  SELECT_MASK    fds;
+  struct timeval tv = { 0, 0 };
+
+  FD_ZERO (&fds);
+  FD_SET (filedes, &fds);
+
+  return select (filedes + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+static gint
+read_command (gint      filedes,
+              SFClient *client)
 {
   SFCommand *cmd;
   guchar     buffer[COMMAND_HEADER];
   gchar     *command;
-  gchar     *clientaddr;
   time_t     clock;
+  gboolean   has_id = FALSE;
+  guint32    id     = 0;
   gint       command_len;
   gint       nbytes;
-  gint       i;
 
-  for (i = 0; i < COMMAND_HEADER;)
+  nbytes = recv_from_client (filedes, (gchar *) buffer, COMMAND_HEADER);
+
+  if (nbytes != COMMAND_HEADER)
     {
-      nbytes = recv (filedes, buffer + i, COMMAND_HEADER - i, 0);
+      if (nbytes > 0)
+        server_log ("Error reading command header.\n");
 
-      if (nbytes < 0)
+      return -1;
+    }
+
+  if (buffer[MAGIC_BYTE] == MAGIC_ID)
+    {
+      if (recv_from_client (filedes, (gchar *) &id,
+                            REQUEST_ID_LEN) != REQUEST_ID_LEN)
         {
-#ifndef G_OS_WIN32
-          if (errno == EINTR)
-            continue;
-#endif
-          server_log ("Error reading command header.\n");
+          server_log ("Error reading request ID.\n");
           return -1;
         }
 
-      if (nbytes == 0)
-        return -1;  /* EOF */
-
-      i += nbytes;
+      id     = g_ntohl (id);
+      has_id = TRUE;
     }
-
-  if (buffer[MAGIC_BYTE] != MAGIC)
+  else if (buffer[MAGIC_BYTE] != MAGIC)
     {
       server_log ("Error in script-fu command transmission.\n");
       return -1;
@@ -650,23 +798,14 @@ read_from_client (gint filedes)
   command_len = (buffer [CMD_LEN_H_BYTE] << 8) | buffer [CMD_LEN_L_BYTE];
   command = g_new (gchar, command_len + 1);
 
-  for (i = 0; i < command_len;)
-    {
-      nbytes = recv (filedes, command + i, command_len - i, 0);
+  nbytes = recv_from_client (filedes, command, command_len);
 
-      if (nbytes <= 0)
-        {
-#ifndef G_OS_WIN32
-          if (nbytes < 0 && errno == EINTR)
-            continue;
-#endif
-           server_log ("Error reading command.  Read %d out of %d bytes.\n",
-                       i, command_len);
-           g_free (command);
-           return -1;
-        }
-
-      i += nbytes;
+  if (nbytes != command_len)
+    {
+      server_log ("Error reading command.  Read %d out of %d bytes.\n",
+                  MAX (nbytes, 0), command_len);
+      g_free (command);
+      return -1;
     }
 
   command[command_len] = '\0';
@@ -675,19 +814,53 @@ read_from_client (gint filedes)
   cmd->filedes    = filedes;
   cmd->command    = command;
   cmd->request_no = request_no ++;
+  cmd->has_id     = has_id;
+  cmd->id         = id;
+
+  /*  Commands are executed in rounds, one command per client and
+   *  round, so that a client with a long backlog doesn't hold up the
+   *  others.
+   */
+  cmd->round         = MAX (client->next_round, current_round + 1);
+  client->next_round = cmd->round + 1;
+  client->n_pending++;
 
   /*  Add the command to the queue  */
-  command_queue = g_list_append (command_queue, cmd);
+  command_queue = g_list_insert_sorted (command_queue, cmd,
+                                        (GCompareFunc) command_compare);
   queue_length ++;
 
-  /*  Get the client address from the address/socket table  */
-  clientaddr = g_hash_table_lookup (clients, GINT_TO_POINTER (cmd->filedes));
   time (&clock);
-  server_log ("Received request #%d from IP address %s: %s on %s,"
-              "[Request queue length: %d]",
-              cmd->request_no,
-                  clientaddr ? clientaddr : "<invalid>",
-                      cmd->command, ctime (&clock), queue_length);
+
+  if (has_id)
+    server_log ("Received request #%d (ID %u) from IP address %s: %s on %s,"
+                "[Request queue length: %d]",
+                cmd->request_no, cmd->id, client->address,
+                cmd->command, ctime (&clock), queue_length);
+  else
+    server_log ("Received request #%d from IP address %s: %s on %s,"
+                "[Request queue length: %d]",
+                cmd->request_no, client->address,
+                cmd->command, ctime (&clock), queue_length);
+
+  return 0;
+}
+
+static gint
+read_from_client (gint filedes)
+{
+  SFClient *client = g_hash_table_lookup (clients, GINT_TO_POINTER (filedes));
+
+  if (! client)
+    return -1;
+
+  /*  Read all commands the client has pipelined, up to its limit  */
+  do
+    {
+      if (read_command (filedes, client) < 0)
+        return -1;
+    }
+  while (client->n_pending < max_pending && client_has_input (filedes));
 
   return 0;
 }
@@ -374,6 +374,9 @@ script_fu_refresh_proc (const gchar      *name,
 
       g_list_free_full (path, (GDestroyNotify) g_object_unref);
 
+      /*  the scripts' procedures may have changed their arguments  */
+      ts_flush_proc_cache ();
+
       status = GIMP_PDB_SUCCESS;
     }
 
@@ -213,6 +213,7 @@ INTERFACE INLINE int is_vector(pointer p)    { return (type(p)==T_VECTOR); }
 INTERFACE static void fill_vector(pointer vec, pointer obj);
 INTERFACE static pointer vector_elem(pointer vec, int ielem);
 INTERFACE static pointer set_vector_elem(pointer vec, int ielem, pointer a);
+INTERFACE static int vector_reals(pointer vec, double *dest, int len);
 INTERFACE INLINE int is_number(pointer p)    { return (type(p)==T_NUMBER); }
 INTERFACE INLINE int is_integer(pointer p) {
   if (!is_number(p))
@@ -1124,6 +1125,21 @@ INTERFACE static pointer set_vector_elem(pointer vec, int ielem, pointer a) {
      }
 }
 
+/* copies the first len elements of a vector of numbers to dest, walking
+   the vector's cells directly.  returns the index of the first element
+   which is not a number, or len. */
+INTERFACE static int vector_reals(pointer vec, double *dest, int len) {
+     int i;
+     for(i=0; i<len; i++) {
+          pointer elem=(i%2==0) ? car(vec+1+i/2) : cdr(vec+1+i/2);
+          if(!is_number(elem)) {
+               return i;
+          }
+          dest[i]=rvalue(elem);
+     }
+     return len;
+}
+
 /* get new symbol */
 INTERFACE pointer mk_symbol(scheme *sc, const char *name) {
      pointer x;
@@ -4880,6 +4896,7 @@ static struct scheme_interface vtbl ={
   fill_vector,
   vector_elem,
   set_vector_elem,
+  vector_reals,
   is_port,
   is_pair,
   pair_car,
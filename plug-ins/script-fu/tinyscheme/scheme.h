@@ -213,6 +213,7 @@ struct scheme_interface {
   void (*fill_vector)(pointer vec, pointer elem);
   pointer (*vector_elem)(pointer vec, int ielem);
   pointer (*set_vector_elem)(pointer vec, int ielem, pointer newel);
+  int (*vector_reals)(pointer vec, double *dest, int len);
 
   int (*is_port)(pointer p);
 